@@ -1119,6 +1119,28 @@ core.register_chatcommand("days", {
 	end
 })
 
+-- in the order of MemorySubsystem
+local memory_subsystems = {
+	"mapblocks", "node_metadata", "static_objects", "block_cache",
+	"network_buffers", "lua_server", "lua_async", "lua_mapgen",
+}
+
+core.register_chatcommand("memory", {
+	description = S("Show the estimated memory usage of the server"),
+	privs = {server=true},
+	func = function(name, param)
+		local usage = core.get_memory_usage()
+		local lines = {}
+		for _, subsystem in ipairs(memory_subsystems) do
+			lines[#lines + 1] = string.format("%-16s %10.1f MiB",
+				subsystem, usage[subsystem] / 1048576)
+		end
+		lines[#lines + 1] = string.format("%-16s %10.1f MiB",
+			"total", usage.total / 1048576)
+		return true, S("Estimated memory usage:") .. "\n" .. table.concat(lines, "\n")
+	end
+})
+
 local function parse_shutdown_param(param)
 	local delay, reconnect, message
 	local one, two, three
@@ -1262,6 +1284,21 @@ core.register_chatcommand("clearobjects", {
 	end,
 })
 
+core.register_chatcommand("snapshot", {
+	params = S("[<name>]"),
+	description = S("Copy the map into the snapshots folder of the world, "
+		.. "while the server keeps running"),
+	privs = {server=true},
+	func = function(name, param)
+		local path, err = core.create_map_snapshot(param ~= "" and param or nil)
+		if not path then
+			return false, S("Could not create snapshot: @1", err)
+		end
+		core.log("action", name .. " creates a map snapshot in " .. path)
+		return true, S("Creating snapshot in @1 in the background.", path)
+	end,
+})
+
 core.register_chatcommand("msg", {
 	params = S("<name> <message>"),
 	description = S("Send a direct message to a player"),
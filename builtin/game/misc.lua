@@ -235,6 +235,41 @@ end
 core.dynamic_media_callbacks = {}
 
 
+-- Callbacks of core.find_path_async, by the id of the search
+local find_path_callbacks = {}
+
+function core.find_path_async(pos1, pos2, params, callback)
+	assert(type(params) == "table" and type(callback) == "function",
+		"Invalid core.find_path_async invocation")
+	local id = core.do_find_path_async(pos1, pos2, params.searchdistance or 16,
+		params.max_jump or 1, params.max_drop or 1, params.algorithm)
+	if not id then
+		return nil
+	end
+	find_path_callbacks[id] = {func = callback, mod_origin = core.get_last_run_mod()}
+	return id
+end
+
+function core.cancel_find_path(id)
+	if not find_path_callbacks[id] then
+		return false
+	end
+	find_path_callbacks[id] = nil
+	core.do_cancel_find_path(id)
+	return true
+end
+
+function core.find_path_async_handler(id, path)
+	local callback = find_path_callbacks[id]
+	if not callback then
+		return
+	end
+	find_path_callbacks[id] = nil
+	core.set_last_run_mod(callback.mod_origin)
+	callback.func(path)
+end
+
+
 -- Transfer of certain globals into seconday Lua environments
 -- see builtin/async/game.lua or builtin/emerge/register.lua for the unpacking
 
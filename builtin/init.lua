@@ -32,6 +32,10 @@ do
 	-- but we don't want to rely on this implementation detail.
 	local seed = 1048576 * (os.time() % 1048576)
 	seed = seed + core.get_us_time() % 1048576
+	local fixed_seed = core.settings and core.settings:get("fixed_random_seed")
+	if fixed_seed and fixed_seed ~= "" then
+		seed = tonumber(fixed_seed) or seed
+	end
 	math.randomseed(seed)
 end
 
@@ -47,6 +47,9 @@ function profiler.init_chatcommand()
 				return reporter.save(sampler.profile, args[1] or "txt", args[2])
 			elseif command == "reset" then
 				sampler.reset()
+				if core.get_step_phase_stats then
+					core.get_step_phase_stats(true)
+				end
 				return true, S("Statistics were reset.")
 			end
 
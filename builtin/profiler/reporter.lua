@@ -7,7 +7,7 @@ local S = core.get_translator("__builtin")
 -- but not the table itself, to keep it simple.
 
 local DIR_DELIM, LINE_DELIM = DIR_DELIM, "\n"
-local table, unpack, string, pairs, io, os = table, unpack, string, pairs, io, os
+local table, unpack, string, pairs, ipairs, io, os = table, unpack, string, pairs, ipairs, io, os
 local rep, sprintf, tonumber = string.rep, string.format, tonumber
 local core, settings = core, core.settings
 local reporter = {}
@@ -74,6 +74,15 @@ end
 -- ' | ' should break less with github than '-+-', when people are pasting there
 HR = sprintf("-%s-", table.concat(HR, " | "))
 
+local phase_row_format = sprintf(" %%-%ds | %%9s | %%9s | %%9s | %%9s | %%9s", widths[1])
+
+-- in order of the step
+local step_phases = {
+	"server_step", "environment", "active_blocks", "node_timers", "abms",
+	"globalstep", "objects", "liquids", "map_timers", "send_objects",
+	"send_object_messages", "map_events", "lua_gc",
+}
+
 local TxtFormatter = Formatter:new {
 	format_row = function(self, modname, instrument_name, statistics)
 		local label
@@ -123,6 +132,29 @@ local TxtFormatter = Formatter:new {
 		if not filter then
 			self:format_row("total", nil, profile.stats_total)
 		end
+		self:format_step_phases(filter)
+	end,
+	format_step_phases = function(self, filter)
+		local phases = core.get_step_phase_stats and core.get_step_phase_stats()
+		if not phases then
+			return
+		end
+		self:print()
+		self:print(S("Durations of the phases of the server step since the last reset:"))
+		self:print(phase_row_format, "phase", "count", "p50 Ms", "p95 Ms", "p99 Ms", "max Ms")
+		self:print(HR)
+		for _, name in ipairs(step_phases) do
+			local stats = phases[name]
+			if stats and filter_matches(filter, name) then
+				self:print(phase_row_format, name,
+					format_number(stats.count),
+					format_number(stats.p50 * 1e6),
+					format_number(stats.p95 * 1e6),
+					format_number(stats.p99 * 1e6),
+					format_number(stats.max * 1e6)
+				)
+			end
+		end
 	end
 }
 
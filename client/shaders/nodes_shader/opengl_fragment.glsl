@@ -1,4 +1,9 @@
+#ifdef USE_ARRAY_TEXTURE
+uniform sampler2DArray baseTexture;
+varying float varTextureLayer;
+#else
 uniform sampler2D baseTexture;
+#endif
 
 uniform vec3 dayLight;
 uniform lowp vec4 fogColor;
@@ -416,7 +421,11 @@ void main(void)
 	vec3 color;
 	vec2 uv = varTexCoord.st;
 
+#ifdef USE_ARRAY_TEXTURE
+	vec4 base = texture(baseTexture, vec3(uv, varTextureLayer)).rgba;
+#else
 	vec4 base = texture2D(baseTexture, uv).rgba;
+#endif
 	// If alpha is zero, we can just discard the pixel. This fixes transparency
 	// on GPUs like GC7000L, where GL_ALPHA_TEST is not implemented in mesa,
 	// and also on GLES 2, where GL_ALPHA_TEST is missing entirely.
@@ -14,6 +14,10 @@ varying vec3 vPosition;
 // cameraOffset + worldPosition (for large coordinates the limits of float
 // precision must be considered).
 varying vec3 worldPosition;
+#ifdef USE_ARRAY_TEXTURE
+// Layer of the base texture, the same at all vertices of a face
+varying float varTextureLayer;
+#endif
 // The centroid keyword ensures that after interpolation the texture coordinates
 // lie within the same bounds when MSAA is en- and disabled.
 // This fixes the stripes problem with nearest-neighbor textures and MSAA.
@@ -149,13 +153,19 @@ float snoise(vec3 p)
 
 void main(void)
 {
+	// map blocks drawn in one batch are placed by their offset
+	vec4 blockPosition = inVertexPosition + vec4(inDrawOffset, 0.0);
+
 	varTexCoord = inTexCoord0.st;
+#ifdef USE_ARRAY_TEXTURE
+	varTextureLayer = inTexCoord1.x;
+#endif
 
 	float disp_x;
 	float disp_z;
 // OpenGL < 4.3 does not support continued preprocessor lines
 #if (MATERIAL_TYPE == TILE_MATERIAL_WAVING_LEAVES && ENABLE_WAVING_LEAVES) || (MATERIAL_TYPE == TILE_MATERIAL_WAVING_PLANTS && ENABLE_WAVING_PLANTS)
-	vec4 pos2 = mWorld * inVertexPosition;
+	vec4 pos2 = mWorld * blockPosition;
 	float tOffset = (pos2.x + pos2.y) * 0.001 + pos2.z * 0.002;
 	disp_x = (smoothTriangleWave(animationTimer * 23.0 + tOffset) +
 		smoothTriangleWave(animationTimer * 11.0 + tOffset)) * 0.4;
@@ -164,7 +174,7 @@ void main(void)
 		smoothTriangleWave(animationTimer * 13.0 + tOffset)) * 0.5;
 #endif
 
-	vec4 pos = inVertexPosition;
+	vec4 pos = blockPosition;
 #if MATERIAL_WAVING_LIQUID && ENABLE_WAVING_WATER
 	// Generate waves with Perlin-type noise.
 	// The constants are calibrated such that they roughly
@@ -220,8 +230,8 @@ void main(void)
 	if (f_shadow_strength > 0.0) {
 #if MATERIAL_TYPE == TILE_MATERIAL_WAVING_PLANTS && ENABLE_WAVING_PLANTS
 		// The shadow shaders don't apply waving when creating the shadow-map.
-		// We are using the not waved inVertexPosition to avoid ugly self-shadowing.
-		vec4 shadow_pos = inVertexPosition;
+		// We are using the not waved blockPosition to avoid ugly self-shadowing.
+		vec4 shadow_pos = blockPosition;
 #else
 		vec4 shadow_pos = pos;
 #endif
@@ -3,6 +3,29 @@ uniform vec3 dayLight;
 uniform float animationTimer;
 uniform lowp vec4 materialColor;
 
+#ifdef USE_INSTANCING
+// each instance has its own world matrix and color, mWorldView and
+// mWorldViewProj don't include the world matrix
+uniform highp mat4 mInstanceWorld[MAX_INSTANCES];
+uniform lowp vec4 mInstanceColor[MAX_INSTANCES];
+
+highp mat4 instanceWorld;
+highp mat4 instanceWorldView;
+highp mat4 instanceWorldViewProj;
+
+void setupInstance()
+{
+	instanceWorld = mInstanceWorld[gl_InstanceID];
+	instanceWorldView = mWorldView * instanceWorld;
+	instanceWorldViewProj = mWorldViewProj * instanceWorld;
+}
+
+#define mWorld instanceWorld
+#define mWorldView instanceWorldView
+#define mWorldViewProj instanceWorldViewProj
+#define materialColor (mInstanceColor[gl_InstanceID])
+#endif
+
 varying vec3 vNormal;
 varying vec3 vPosition;
 varying vec3 worldPosition;
@@ -79,6 +102,36 @@ float mtsmoothstep(in float edge0, in float edge1, in float x)
 #endif
 
 
+#ifdef USE_SKINNING
+attribute vec4 inVertexJoints;
+attribute vec4 inVertexWeights;
+uniform highp mat4 mJoints[MAX_JOINTS];
+
+highp vec4 skinnedPosition;
+vec3 skinnedNormal;
+
+void skinVertex()
+{
+	float total = dot(inVertexWeights, vec4(1.0));
+	if (total == 0.0) {
+		// not attached to any joint
+		skinnedPosition = inVertexPosition;
+		skinnedNormal = inVertexNormal;
+		return;
+	}
+	highp mat4 skin =
+		inVertexWeights.x * mJoints[int(inVertexJoints.x)] +
+		inVertexWeights.y * mJoints[int(inVertexJoints.y)] +
+		inVertexWeights.z * mJoints[int(inVertexJoints.z)] +
+		inVertexWeights.w * mJoints[int(inVertexJoints.w)];
+	skinnedPosition = skin * inVertexPosition;
+	skinnedNormal = (skin * vec4(inVertexNormal, 0.0)).xyz;
+}
+
+#define inVertexPosition skinnedPosition
+#define inVertexNormal skinnedNormal
+#endif
+
 float directional_ambient(vec3 normal)
 {
 	vec3 v = normal * normal;
@@ -91,6 +144,12 @@ float directional_ambient(vec3 normal)
 
 void main(void)
 {
+#ifdef USE_INSTANCING
+	setupInstance();
+#endif
+#ifdef USE_SKINNING
+	skinVertex();
+#endif
 	varTexCoord = (mTexture * vec4(inTexCoord0.xy, 1.0, 1.0)).st;
 	gl_Position = mWorldViewProj * inVertexPosition;
 
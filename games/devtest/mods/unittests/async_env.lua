@@ -167,6 +167,29 @@ local function test_userdata_passing2(cb, _, pos)
 end
 unittests.register("test_userdata_passing2", test_userdata_passing2, {map=true, async=true})
 
+local function test_vmanip_snapshot(cb, _, pos)
+	local minp, maxp = pos:subtract(2), pos:add(2)
+	core.set_node(pos, {name="basenodes:stone"})
+	local vm = core.get_voxel_manip(minp, maxp)
+	local expect = core.find_nodes_in_area(minp, maxp, {"basenodes:stone"})
+	-- the snapshot must not see this
+	core.remove_node(pos)
+
+	core.handle_async(function(vm_, pos_, minp_, maxp_)
+		return vm_:find_node_near(pos_, 1, {"basenodes:stone"}, true),
+			vm_:find_nodes_in_area(minp_, maxp_, {"basenodes:stone"})
+	end, function(near, found)
+		if not vector.equals(near, pos) then
+			return cb("find_node_near did not use the snapshot")
+		end
+		if #found ~= #expect then
+			return cb("find_nodes_in_area result mismatch")
+		end
+		cb()
+	end, vm, pos, minp, maxp)
+end
+unittests.register("test_vmanip_snapshot", test_vmanip_snapshot, {map=true, async=true})
+
 local function test_portable_metatable_override()
 	assert(pcall(core.register_portable_metatable, "__builtin:vector", vector.metatable),
 			"Metatable name aliasing throws an error when it should be allowed")
@@ -79,9 +79,21 @@ local function test_metadata(meta)
 	meta:set_float("j", 0 / 0)
 	assert(core.is_nan(meta:get_float("j")))
 
+	local values = meta:get_strings({"a", "e", "none", "i"})
+	assert(#values == 4)
+	assert(values[1] == "1" and values[2] == "e" and values[3] == "")
+	assert(values[4] == "${f}")
+	meta:set_strings({a = "x", e = "", k = "k"})
+	assert(meta:get_string("a") == "x")
+	assert(not meta:contains("e"))
+	assert(meta:get_string("k") == "k")
+	assert(meta:get_string("b") == "2")
+	assert(not pcall(meta.set_strings, meta, {"x"}))
+
 	meta:from_table()
 	assert(next(meta:to_table().fields) == nil)
 	assert(#meta:get_keys() == 0)
+	assert(meta:get_strings({"a"})[1] == "")
 
 	assert(not meta:equals(compare_meta))
 end
@@ -106,6 +106,30 @@ local function test_node_callbacks(_, pos)
 end
 unittests.register("test_node_callbacks", test_node_callbacks, {map=true})
 
+local function test_voxelmanip_buffer(_, pos)
+	local vm = VoxelManip()
+	local c_air = core.CONTENT_AIR
+	local pmin, pmax = vm:initialize(pos, pos, {name="air", param2=3})
+	local area = VoxelArea(pmin, pmax)
+
+	local data = vm:get_data_buffer()
+	local param2 = vm:get_param2_data_buffer()
+	assert(#data == area:getVolume())
+	assert(data[1] == c_air and param2[#param2] == 3)
+
+	local i = area:indexp(pos)
+	data[i] = core.get_content_id("basenodes:stone")
+	param2[i] = 7
+	assert(vm:get_data()[i] == data[i])
+	assert(vm:get_param2_data()[i] == 7)
+	assert(not pcall(function() return data[0] end))
+	assert(not pcall(function() data[#data + 1] = c_air end))
+
+	assert(type(vm:get_data_pointer()) == "userdata")
+	assert(VoxelManip():get_data_pointer() == nil)
+end
+unittests.register("test_voxelmanip_buffer", test_voxelmanip_buffer, {map=true})
+
 local function test_hashing()
 	local input = "hello\000world"
 	assert(core.sha1(input) == "f85b420f1e43ebf88649dfcab302b898d889606c")
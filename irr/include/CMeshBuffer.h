@@ -143,4 +143,6 @@ typedef CMeshBuffer<video::S3DVertex> SMeshBuffer;
 typedef CMeshBuffer<video::S3DVertex2TCoords> SMeshBufferLightMap;
 //! Meshbuffer with vertices having tangents stored, e.g. for normal mapping
 typedef CMeshBuffer<video::S3DVertexTangents> SMeshBufferTangents;
+//! Meshbuffer with joint weights per vertex, for skinning in the vertex shader
+typedef CMeshBuffer<video::S3DVertexSkinned> SMeshBufferSkinned;
 } // end namespace scene
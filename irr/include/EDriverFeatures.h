@@ -133,6 +133,9 @@ enum E_VIDEO_DRIVER_FEATURE
 	//! Support for 2D array textures.
 	EVDF_TEXTURE_2D_ARRAY,
 
+	//! Support for IVideoDriver::drawMeshBufferInstanced in shaders
+	EVDF_DRAW_INSTANCED,
+
 	//! Only used for counting the elements of this enum
 	EVDF_COUNT
 };
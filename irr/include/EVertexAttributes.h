@@ -13,6 +13,9 @@ enum E_VERTEX_ATTRIBUTES
 	EVA_TCOORD1,
 	EVA_TANGENT,
 	EVA_BINORMAL,
+	EVA_JOINTS,
+	EVA_WEIGHTS,
+	EVA_DRAW_OFFSET,
 	EVA_COUNT
 };
 
@@ -25,6 +28,9 @@ const char *const sBuiltInVertexAttributeNames[] = {
 		"inTexCoord1",
 		"inVertexTangent",
 		"inVertexBinormal",
+		"inVertexJoints",
+		"inVertexWeights",
+		"inDrawOffset",
 		0,
 	};
 
@@ -123,6 +123,15 @@ class IAnimatedMeshSceneNode : public ISceneNode
 	/** Culling is unaffected. */
 	virtual void setRenderFromIdentity(bool On) = 0;
 
+	//! Skin the mesh in the vertex shader instead of on the CPU.
+	/** The materials must use a shader that reads the joint matrices
+	from IVideoDriver::getJointTransforms(). Meshes with too many joints
+	are still skinned on the CPU. */
+	virtual void setHardwareSkinning(bool enable) = 0;
+
+	//! Returns if the mesh is skinned in the vertex shader, if it can be
+	virtual bool getHardwareSkinning() const = 0;
+
 	//! Creates a clone of this scene node and its children.
 	/** \param newParent An optional new parent.
 	\param newManager An optional new scene manager.
@@ -18,6 +18,7 @@ namespace video
 
 class IVideoDriver;
 class IShaderConstantSetCallBack;
+class IShaderBinaryCache;
 
 //! Interface making it possible to create and use programs running on the GPU.
 class IGPUProgrammingServices
@@ -135,6 +136,12 @@ class IGPUProgrammingServices
 	\param material Number of the material type. Must not be a built-in
 	material. */
 	virtual void deleteShaderMaterial(s32 material) = 0;
+
+	//! Sets a cache for compiled shader programs.
+	/** It is only used where the driver can load program binaries.
+	\param cache The cache, or nullptr to not use one. It is not owned by
+	the driver and must stay alive until it is unset. */
+	virtual void setShaderBinaryCache(IShaderBinaryCache *cache) {}
 };
 
 } // end namespace video
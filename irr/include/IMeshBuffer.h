@@ -225,6 +225,9 @@ class IMeshBuffer : public virtual IReferenceCounted
 			case video::EVT_TANGENTS:
 				ret += sizeof(video::S3DVertexTangents) * getVertexCount();
 				break;
+			case video::EVT_SKINNED:
+				ret += sizeof(video::S3DVertexSkinned) * getVertexCount();
+				break;
 		}
 		switch (getIndexType()) {
 			case video::EIT_16BIT:
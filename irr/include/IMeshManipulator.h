@@ -129,6 +129,10 @@ class IMeshManipulator : public virtual IReferenceCounted
 				video::S3DVertexTangents *verts = (video::S3DVertexTangents *)buffer->getVertices();
 				func(verts[i]);
 			} break;
+			case video::EVT_SKINNED: {
+				video::S3DVertexSkinned *verts = (video::S3DVertexSkinned *)buffer->getVertices();
+				func(verts[i]);
+			} break;
 			}
 			if (boundingBoxUpdate) {
 				if (0 == i)
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "ISceneNode.h"
+#include "EMaterialTypes.h"
+#include <optional>
 
 namespace scene
 {
@@ -42,6 +44,18 @@ class IMeshSceneNode : public ISceneNode
 	/** This flag can be set by setSharedMaterials().
 	\return Whether the materials are shared. */
 	virtual bool isSharedMaterials() const = 0;
+
+	//! Lets the scene manager draw this node together with other mesh scene
+	//! nodes that share its mesh, with one instanced draw call per buffer.
+	/** Only solid buffers are drawn like this. The materials of the nodes
+	may only differ in their ColorParam, which is the color of the instance.
+	\param type Material type to draw the instances with, see
+	IVideoDriver::drawMeshBufferInstanced(). Nothing to always draw the
+	node on its own. */
+	virtual void setInstancedMaterialType(std::optional<video::E_MATERIAL_TYPE> type) = 0;
+
+	//! Returns the material type set by setInstancedMaterialType()
+	virtual std::optional<video::E_MATERIAL_TYPE> getInstancedMaterialType() const = 0;
 };
 
 } // end namespace scene
@@ -0,0 +1,41 @@
+// Copyright (C) 2026 Luanti contributors
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "irrTypes.h"
+#include <string>
+
+namespace video
+{
+
+//! Interface to keep compiled shader programs between runs.
+/** The driver asks it for a binary before it compiles a shader program and
+passes it every program that it had to compile. Programs are identified by
+their sources, the implementation has to add anything else that affects the
+binary, like the graphics driver and its version. */
+class IShaderBinaryCache
+{
+public:
+	virtual ~IShaderBinaryCache() = default;
+
+	//! Looks up the binary of a program.
+	/** \param vertexShader Source of the vertex shader, may be empty
+	\param pixelShader Source of the pixel shader, may be empty
+	\param format Returns the driver specific format of the binary
+	\param binary Returns the binary
+	\return True if a binary was found */
+	virtual bool loadProgram(const std::string &vertexShader,
+			const std::string &pixelShader, u32 &format, std::string &binary) = 0;
+
+	//! Stores the binary of a program.
+	virtual void storeProgram(const std::string &vertexShader,
+			const std::string &pixelShader, u32 format, const std::string &binary) = 0;
+
+	//! Called when a binary that was found is rejected by the driver.
+	virtual void rejectProgram(const std::string &vertexShader,
+			const std::string &pixelShader) {}
+};
+
+} // end namespace video
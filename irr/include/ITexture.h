@@ -72,6 +72,14 @@ enum E_TEXTURE_CREATION_FLAG
 	*/
 	ETCF_ALLOW_MEMORY_COPY = 0x00000080,
 
+	//! Allow the driver to free the video memory of the texture
+	/** The texture keeps a copy in main memory like with ETCF_ALLOW_MEMORY_COPY.
+	It is only uploaded when it is used for the first time, and again after
+	ITexture::evict() was called.
+	This is disabled by default.
+	*/
+	ETCF_ALLOW_EVICTION = 0x00000100,
+
 	/** This flag is never used, it only forces the compiler to compile
 	these enumeration values to 32 bit. */
 	ETCF_FORCE_32_BIT_DO_NOT_USE = 0x7fffffff
@@ -187,6 +195,20 @@ class ITexture : public virtual IReferenceCounted
 	needs mipmap regeneration. */
 	virtual void regenerateMipMapLevels(u32 layer = 0) = 0;
 
+	//! Frees the video memory of the texture.
+	/** Only works for textures created with ETCF_ALLOW_EVICTION. The texture
+	stays valid and is uploaded again when it is used the next time.
+	\return True if the texture was evicted. */
+	virtual bool evict() { return false; }
+
+	//! Check whether the texture is in video memory at the moment
+	virtual bool isResident() const { return true; }
+
+	//! Get the number of the frame in which the texture was last used
+	/** See IVideoDriver::getFrameNumber(). This is only tracked for textures
+	created with ETCF_ALLOW_EVICTION. */
+	u32 getLastUsedFrame() const { return LastUsedFrame; }
+
 	//! Get original size of the texture.
 	/** The texture is usually scaled, if it was created with an unoptimal
 	size. For example if the size was not a power of two. This method
@@ -286,6 +308,7 @@ class ITexture : public virtual IReferenceCounted
 	u32 Pitch;
 	bool HasMipMaps;
 	bool IsRenderTarget;
+	u32 LastUsedFrame = 0;
 	E_TEXTURE_TYPE Type;
 };
 
@@ -20,6 +20,7 @@
 #include "SOverrideMaterial.h"
 #include "S3DVertex.h" // E_VERTEX_TYPE
 #include "SVertexIndex.h" // E_INDEX_TYPE
+#include <vector>
 
 namespace io
 {
@@ -62,6 +63,31 @@ struct SFrameStats {
 	u32 HWBuffersActive = 0;
 };
 
+//! The instances of a mesh buffer for IVideoDriver::drawMeshBufferInstanced
+struct SDrawInstances {
+	//! Most instances that are drawn with one call
+	static constexpr u32 MAX_COUNT = 32;
+
+	//! World transformation of each instance
+	std::vector<core::matrix4> World;
+	//! Color of each instance, e.g. to light it
+	std::vector<SColor> Colors;
+};
+
+//! Mesh buffers for IVideoDriver::drawMeshBufferBatch
+struct SDrawBatch {
+	//! Buffers to draw, which all use the current material
+	std::vector<const scene::IMeshBuffer *> Buffers;
+	//! Translation of each buffer, on top of the world transformation
+	std::vector<core::vector3df> Offsets;
+
+	void clear()
+	{
+		Buffers.clear();
+		Offsets.clear();
+	}
+};
+
 //! Interface to driver which is able to perform 2d and 3d graphics functions.
 /** This interface is one of the most important interfaces of
 the Irrlicht Engine: All rendering and texture manipulation is done with
@@ -135,6 +161,16 @@ class IVideoDriver : public virtual IReferenceCounted
 	\return Matrix describing the transformation. */
 	virtual const core::matrix4 &getTransform(E_TRANSFORMATION_STATE state) const = 0;
 
+	//! Sets the joint matrices for skinning in the vertex shader.
+	/** The driver only keeps them for the shader callbacks, which
+	upload them along with the other constants.
+	\param transforms Matrices of the joints, must stay valid while
+	drawing. Nullptr if the drawn mesh isn't skinned in the shader. */
+	virtual void setJointTransforms(const std::vector<core::matrix4> *transforms) = 0;
+
+	//! Returns the joint matrices set by setJointTransforms
+	virtual const std::vector<core::matrix4> *getJointTransforms() const = 0;
+
 	//! Retrieve the number of image loaders
 	/** \return Number of image loaders */
 	virtual u32 getImageLoaderCount() const = 0;
@@ -758,6 +794,29 @@ class IVideoDriver : public virtual IReferenceCounted
 	/** \param mb Buffer to draw */
 	virtual void drawMeshBuffer(const scene::IMeshBuffer *mb) = 0;
 
+	//! Draws a mesh buffer several times with one draw call
+	/** Needs EVDF_DRAW_INSTANCED and a material whose shader places each
+	instance with the data from getDrawInstances(). Other drivers draw
+	the instances one by one and ignore their colors.
+	\param mb Buffer to draw
+	\param instances Up to SDrawInstances::MAX_COUNT instances */
+	virtual void drawMeshBufferInstanced(const scene::IMeshBuffer *mb,
+			const SDrawInstances &instances) = 0;
+
+	//! Draws several mesh buffers that share the current material
+	/** The material's shader must add the vertex attribute inDrawOffset to
+	the position, which is how the OpenGL 3 and OpenGL ES 2 drivers place
+	the buffers. They set up the material only once, and with multi-draw
+	indirect support they draw all buffers with a single call. Other
+	drivers draw the buffers one by one with a translated world
+	transformation.
+	\param batch Buffers to draw, with their offsets */
+	virtual void drawMeshBufferBatch(const SDrawBatch &batch) = 0;
+
+	//! Returns the instances that are being drawn, for the shader callbacks
+	/** \return Nullptr if the current draw isn't instanced */
+	virtual const SDrawInstances *getDrawInstances() const = 0;
+
 	/**
 	 * Draws a mesh from individual vertex and index buffers.
 	 * @param vb vertices to use
@@ -829,6 +888,10 @@ class IVideoDriver : public virtual IReferenceCounted
 	//! Return some statistics about the last frame
 	virtual SFrameStats getFrameStats() const = 0;
 
+	//! Returns the number of the current frame
+	/** The number is increased by every beginScene() call. */
+	virtual u32 getFrameNumber() const = 0;
+
 	//! Gets name of this video driver.
 	/** \return Returns the name of the video driver, e.g. in case
 	of the Direct3D8 driver, it would return "Direct3D 8.1". */
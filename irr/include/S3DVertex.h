@@ -25,7 +25,12 @@ enum E_VERTEX_TYPE
 	/** Usually used for tangent space normal mapping.
 		Usually tangent and binormal get send to shaders as texture coordinate sets 1 and 2.
 	*/
-	EVT_TANGENTS
+	EVT_TANGENTS,
+
+	//! Vertex with joint indices and weights, video::S3DVertexSkinned.
+	/** Used for skinning in the vertex shader, only supported by the
+		OpenGL 3 and OpenGL ES 2 drivers. */
+	EVT_SKINNED
 };
 
 //! Array holding the built in vertex type names
@@ -33,6 +38,7 @@ const char *const sBuiltInVertexTypeNames[] = {
 		"standard",
 		"2tcoords",
 		"tangents",
+		"skinned",
 		0,
 	};
 
@@ -270,6 +276,32 @@ struct S3DVertexTangents : public S3DVertex
 	}
 };
 
+//! Vertex with the joints that move it, for skinning in the vertex shader.
+/** Each vertex follows up to four joints. The weights add up to 1, or to 0
+	for a vertex that doesn't move.
+*/
+struct S3DVertexSkinned : public S3DVertex
+{
+	//! default constructor
+	S3DVertexSkinned() :
+			S3DVertex() {}
+
+	//! constructor from S3DVertex, the vertex doesn't move
+	constexpr S3DVertexSkinned(const S3DVertex &o) :
+			S3DVertex(o) {}
+
+	//! Indices of the joints
+	u8 JointIDs[4] = {0, 0, 0, 0};
+
+	//! Weights of the joints
+	f32 Weights[4] = {0, 0, 0, 0};
+
+	static E_VERTEX_TYPE getType()
+	{
+		return EVT_SKINNED;
+	}
+};
+
 inline u32 getVertexPitchFromType(E_VERTEX_TYPE vertexType)
 {
 	switch (vertexType) {
@@ -277,6 +309,8 @@ inline u32 getVertexPitchFromType(E_VERTEX_TYPE vertexType)
 		return sizeof(video::S3DVertex2TCoords);
 	case video::EVT_TANGENTS:
 		return sizeof(video::S3DVertexTangents);
+	case video::EVT_SKINNED:
+		return sizeof(video::S3DVertexSkinned);
 	default:
 		return sizeof(video::S3DVertex);
 	}
@@ -157,6 +157,8 @@ struct SSkinMeshBuffer final : public IMeshBuffer
 			recalculateBoundingBox(Vertices_Tangents);
 			break;
 		}
+		default:
+			break;
 		}
 	}
 
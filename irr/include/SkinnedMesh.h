@@ -75,6 +75,21 @@ class SkinnedMesh : public IAnimatedMesh
 	//! Performs a software skin on this mesh based on the given joint matrices
 	void skinMesh(const std::vector<core::matrix4> &animated_transforms);
 
+	//! Most joints that a mesh can have to be skinned in the vertex shader
+	static constexpr u32 MAX_HARDWARE_JOINTS = 48;
+
+	//! Returns copies of the mesh buffers in static pose, with the joints and
+	//! weights of each vertex, to be skinned in the vertex shader.
+	/** The copies are made on the first call, and again after setDirty().
+	
+eturn Nullptr if the mesh has more than MAX_HARDWARE_JOINTS joints. */
+	const std::vector<SMeshBufferSkinned *> *getHardwareSkinningBuffers();
+
+	//! Computes the matrices to skin the hardware skinning buffers with,
+	//! and moves rigidly animated buffers like skinMesh() does.
+	void getSkinningMatrices(const std::vector<core::matrix4> &global_matrices,
+			std::vector<core::matrix4> &skinning_matrices);
+
 	//! returns amount of mesh buffers.
 	u32 getMeshBufferCount() const override;
 
@@ -379,6 +394,11 @@ class SkinnedMesh : public IAnimatedMesh
 
 	void normalizeWeights();
 
+	//! Sets the transformation of buffers that are attached to a joint
+	void updateRigidTransforms(const std::vector<core::matrix4> &global_matrices);
+
+	void dropHardwareSkinningBuffers();
+
 	void calculateTangents(core::vector3df &normal,
 			core::vector3df &tangent, core::vector3df &binormal,
 			const core::vector3df &vt1, const core::vector3df &vt2, const core::vector3df &vt3,
@@ -387,6 +407,8 @@ class SkinnedMesh : public IAnimatedMesh
 	std::vector<SSkinMeshBuffer *> *SkinningBuffers; // Meshbuffer to skin, default is to skin localBuffers
 
 	std::vector<SSkinMeshBuffer *> LocalBuffers;
+	//! Copies of LocalBuffers for skinning in the vertex shader, made on demand
+	std::vector<SMeshBufferSkinned *> HardwareSkinningBuffers;
 	//! Mapping from meshbuffer number to bindable texture slot
 	std::vector<u32> TextureSlots;
 
@@ -211,7 +211,19 @@ void CAnimatedMeshSceneNode::render()
 
 	++PassCount;
 
-	scene::IMesh *m = getMeshForCurrentFrame();
+	const std::vector<SMeshBufferSkinned *> *skinned_buffers = nullptr;
+	if (HardwareSkinning && Mesh->getMeshType() == EAMT_SKINNED) {
+		auto *skinnedMesh = static_cast<SkinnedMesh *>(Mesh);
+		if (!skinnedMesh->isStatic())
+			skinned_buffers = skinnedMesh->getHardwareSkinningBuffers();
+		if (skinned_buffers) {
+			skinnedMesh->getSkinningMatrices(PerJoint.GlobalMatrices,
+					PerJoint.SkinningMatrices);
+			driver->setJointTransforms(&PerJoint.SkinningMatrices);
+		}
+	}
+
+	scene::IMesh *m = skinned_buffers ? Mesh : getMeshForCurrentFrame();
 	assert(m);
 
 	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
@@ -230,10 +242,12 @@ void CAnimatedMeshSceneNode::render()
 				driver->setTransform(video::ETS_WORLD, AbsoluteTransformation * ((SSkinMeshBuffer *)mb)->Transformation);
 
 			driver->setMaterial(material);
-			driver->drawMeshBuffer(mb);
+			driver->drawMeshBuffer(skinned_buffers ? (*skinned_buffers)[i] : mb);
 		}
 	}
 
+	if (skinned_buffers)
+		driver->setJointTransforms(nullptr);
 	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
 
 	// for debug purposes only:
@@ -673,6 +687,7 @@ ISceneNode *CAnimatedMeshSceneNode::clone(ISceneNode *newParent, ISceneManager *
 	newNode->PerJoint.SceneNodes = PerJoint.SceneNodes;
 	newNode->PerJoint.PreTransSaves = PerJoint.PreTransSaves;
 	newNode->RenderFromIdentity = RenderFromIdentity;
+	newNode->HardwareSkinning = HardwareSkinning;
 
 	return newNode;
 }
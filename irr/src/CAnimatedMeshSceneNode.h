@@ -134,6 +134,10 @@ class CAnimatedMeshSceneNode : public IAnimatedMeshSceneNode
 	//! render mesh ignoring its transformation. Used with ragdolls. (culling is unaffected)
 	void setRenderFromIdentity(bool On) override;
 
+	void setHardwareSkinning(bool enable) override { HardwareSkinning = enable; }
+
+	bool getHardwareSkinning() const override { return HardwareSkinning; }
+
 	//! Creates a clone of this scene node and its children.
 	/** \param newParent An optional new parent.
 	\param newManager An optional new scene manager.
@@ -168,6 +172,7 @@ class CAnimatedMeshSceneNode : public IAnimatedMeshSceneNode
 	bool Looping;
 	bool ReadOnlyMaterials;
 	bool RenderFromIdentity;
+	bool HardwareSkinning = false;
 
 	s32 PassCount;
 	std::function<void(f32)> OnAnimateCallback;
@@ -175,6 +180,8 @@ class CAnimatedMeshSceneNode : public IAnimatedMeshSceneNode
 	struct PerJointData {
 		std::vector<CBoneSceneNode *> SceneNodes;
 		std::vector<core::matrix4> GlobalMatrices;
+		//! For hardware skinning, set on the driver while rendering
+		std::vector<core::matrix4> SkinningMatrices;
 		std::vector<std::optional<core::Transform>> PreTransSaves;
 		void setN(u16 n) {
 			SceneNodes.clear();
@@ -6,6 +6,16 @@
 #include "SColor.h"
 #include "os.h"
 #include "irrString.h"
+#include <utility>
+
+// SSE2 is part of x86-64 and NEON of AArch64, so no runtime check is needed
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLORCONVERTER_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define COLORCONVERTER_NEON 1
+#endif
 
 // Warning: The naming of Irrlicht color formats
 // is not consistent regarding actual component order in memory.
@@ -271,8 +281,19 @@ void CColorConverter::convert_A8R8G8B8toR8G8B8(const void *sP, s32 sN, void *dP)
 {
 	u8 *sB = (u8 *)sP;
 	u8 *dB = (u8 *)dP;
+	s32 x = 0;
+
+#if COLORCONVERTER_NEON
+	for (; x + 16 <= sN; x += 16) {
+		const uint8x16x4_t px = vld4q_u8(sB);
+		const uint8x16x3_t out = {{px.val[2], px.val[1], px.val[0]}};
+		vst3q_u8(dB, out);
+		sB += 64;
+		dB += 48;
+	}
+#endif
 
-	for (s32 x = 0; x < sN; ++x) {
+	for (; x < sN; ++x) {
 		// sB[3] is alpha
 		dB[0] = sB[2];
 		dB[1] = sB[1];
@@ -374,8 +395,19 @@ void CColorConverter::convert_R8G8B8toA8R8G8B8(const void *sP, s32 sN, void *dP)
 {
 	u8 *sB = (u8 *)sP;
 	u32 *dB = (u32 *)dP;
+	s32 x = 0;
+
+#if COLORCONVERTER_NEON
+	for (; x + 16 <= sN; x += 16) {
+		const uint8x16x3_t px = vld3q_u8(sB);
+		const uint8x16x4_t out = {{px.val[2], px.val[1], px.val[0], vdupq_n_u8(0xff)}};
+		vst4q_u8(reinterpret_cast<u8 *>(dB), out);
+		sB += 48;
+		dB += 16;
+	}
+#endif
 
-	for (s32 x = 0; x < sN; ++x) {
+	for (; x < sN; ++x) {
 		*dB = 0xff000000 | (sB[0] << 16) | (sB[1] << 8) | sB[2];
 
 		sB += 3;
@@ -404,8 +436,26 @@ void CColorConverter::convert_A8R8G8B8toR8G8B8A8(const void *sP, s32 sN, void *d
 {
 	const u32 *sB = (const u32 *)sP;
 	u32 *dB = (u32 *)dP;
+	s32 x = 0;
 
-	for (s32 x = 0; x < sN; ++x) {
+#if COLORCONVERTER_SSE2
+	for (; x + 4 <= sN; x += 4) {
+		const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sB));
+		const __m128i out = _mm_or_si128(_mm_slli_epi32(px, 8), _mm_srli_epi32(px, 24));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dB), out);
+		sB += 4;
+		dB += 4;
+	}
+#elif COLORCONVERTER_NEON
+	for (; x + 4 <= sN; x += 4) {
+		const uint32x4_t px = vld1q_u32(sB);
+		vst1q_u32(dB, vsriq_n_u32(vshlq_n_u32(px, 8), px, 24));
+		sB += 4;
+		dB += 4;
+	}
+#endif
+
+	for (; x < sN; ++x) {
 		*dB++ = (*sB << 8) | (*sB >> 24);
 		++sB;
 	}
@@ -415,8 +465,31 @@ void CColorConverter::convert_A8R8G8B8toA8B8G8R8(const void *sP, s32 sN, void *d
 {
 	const u32 *sB = (const u32 *)sP;
 	u32 *dB = (u32 *)dP;
+	s32 x = 0;
+
+#if COLORCONVERTER_SSE2
+	const __m128i keep = _mm_set1_epi32(0xff00ff00);
+	const __m128i low = _mm_set1_epi32(0x000000ff);
+	for (; x + 4 <= sN; x += 4) {
+		const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sB));
+		__m128i out = _mm_and_si128(px, keep);
+		out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(px, 16), low));
+		out = _mm_or_si128(out, _mm_slli_epi32(_mm_and_si128(px, low), 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dB), out);
+		sB += 4;
+		dB += 4;
+	}
+#elif COLORCONVERTER_NEON
+	for (; x + 16 <= sN; x += 16) {
+		uint8x16x4_t px = vld4q_u8(reinterpret_cast<const u8 *>(sB));
+		std::swap(px.val[0], px.val[2]);
+		vst4q_u8(reinterpret_cast<u8 *>(dB), px);
+		sB += 16;
+		dB += 16;
+	}
+#endif
 
-	for (s32 x = 0; x < sN; ++x) {
+	for (; x < sN; ++x) {
 		*dB++ = (*sB & 0xff00ff00) | ((*sB & 0x00ff0000) >> 16) | ((*sB & 0x000000ff) << 16);
 		++sB;
 	}
@@ -8,14 +8,20 @@
 namespace io
 {
 
-CMemoryReadFile::CMemoryReadFile(const void *memory, long len, const io::path &fileName, bool d) :
-		Buffer(memory), Len(len), Pos(0), Filename(fileName), deleteMemoryWhenDropped(d)
-{}
+CMemoryReadFile::CMemoryReadFile(const void *memory, long len, const io::path &fileName, bool d,
+		IReferenceCounted *owner) :
+		Buffer(memory), Len(len), Pos(0), Filename(fileName), deleteMemoryWhenDropped(d), Owner(owner)
+{
+	if (Owner)
+		Owner->grab();
+}
 
 CMemoryReadFile::~CMemoryReadFile()
 {
 	if (deleteMemoryWhenDropped)
 		delete[] (c8 *)Buffer;
+	if (Owner)
+		Owner->drop();
 }
 
 //! returns how much was read
@@ -18,7 +18,10 @@ class CMemoryReadFile final : public IMemoryReadFile
 {
 public:
 	//! Constructor
-	CMemoryReadFile(const void *memory, long len, const io::path &fileName, bool deleteMemoryWhenDropped);
+	/** \param owner If set, it is kept alive as long as the file, for memory
+	that belongs to another object. */
+	CMemoryReadFile(const void *memory, long len, const io::path &fileName, bool deleteMemoryWhenDropped,
+			IReferenceCounted *owner = nullptr);
 
 	//! Destructor
 	virtual ~CMemoryReadFile();
@@ -56,6 +59,7 @@ class CMemoryReadFile final : public IMemoryReadFile
 	long Pos;
 	io::path Filename;
 	bool deleteMemoryWhenDropped;
+	IReferenceCounted *Owner;
 };
 
 /*!
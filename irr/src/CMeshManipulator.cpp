@@ -167,6 +167,14 @@ SMesh *CMeshManipulator::createMeshCopy(scene::IMesh *mesh) const
 			clone->addMeshBuffer(buffer);
 			buffer->drop();
 		} break;
+		case video::EVT_SKINNED: {
+			SMeshBufferSkinned *buffer = new SMeshBufferSkinned();
+			buffer->Material = mb->getMaterial();
+			copyVertices(mb->getVertexBuffer(), buffer->Vertices);
+			copyIndices(mb->getIndexBuffer(), buffer->Indices);
+			clone->addMeshBuffer(buffer);
+			buffer->drop();
+		} break;
 		} // end switch
 
 	} // end for all mesh buffers
@@ -61,6 +61,16 @@ class CMeshSceneNode : public IMeshSceneNode
 	\return Whether the materials are shared. */
 	bool isSharedMaterials() const override;
 
+	void setInstancedMaterialType(std::optional<video::E_MATERIAL_TYPE> type) override
+	{
+		InstancedMaterialType = type;
+	}
+
+	std::optional<video::E_MATERIAL_TYPE> getInstancedMaterialType() const override
+	{
+		return InstancedMaterialType;
+	}
+
 	//! Creates a clone of this scene node and its children.
 	ISceneNode *clone(ISceneNode *newParent = 0, ISceneManager *newManager = 0) override;
 
@@ -79,6 +89,7 @@ class CMeshSceneNode : public IMeshSceneNode
 
 	s32 PassCount;
 	bool SharedMaterials;
+	std::optional<video::E_MATERIAL_TYPE> InstancedMaterialType;
 };
 
 } // end namespace scene
@@ -195,6 +195,7 @@ void CNullDriver::deleteAllTextures()
 bool CNullDriver::beginScene(u16 clearFlag, SColor clearColor, f32 clearDepth, u8 clearStencil, const SExposedVideoData &videoData, core::rect<s32> *sourceRect)
 {
 	FrameStats = {};
+	FrameNumber++;
 	return true;
 }
 
@@ -1077,6 +1078,34 @@ void CNullDriver::drawBuffers(const scene::IVertexBuffer *vb,
 		primCount, vb->getType(), pType, ib->getType());
 }
 
+void CNullDriver::drawMeshBufferInstanced(const scene::IMeshBuffer *mb,
+		const SDrawInstances &instances)
+{
+	if (!mb)
+		return;
+
+	const core::matrix4 world = getTransform(ETS_WORLD);
+	for (const auto &transform : instances.World) {
+		setTransform(ETS_WORLD, transform);
+		drawMeshBuffer(mb);
+	}
+	setTransform(ETS_WORLD, world);
+}
+
+void CNullDriver::drawMeshBufferBatch(const SDrawBatch &batch)
+{
+	assert(batch.Offsets.size() == batch.Buffers.size());
+
+	const core::matrix4 world = getTransform(ETS_WORLD);
+	core::matrix4 translation;
+	for (size_t i = 0; i < batch.Buffers.size(); i++) {
+		translation.setTranslation(batch.Offsets[i]);
+		setTransform(ETS_WORLD, world * translation);
+		drawMeshBuffer(batch.Buffers[i]);
+	}
+	setTransform(ETS_WORLD, world);
+}
+
 //! Draws the normals of a mesh buffer
 void CNullDriver::drawMeshBufferNormals(const scene::IMeshBuffer *mb, f32 length, SColor color)
 {
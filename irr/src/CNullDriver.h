@@ -192,6 +192,8 @@ class CNullDriver : public IVideoDriver, public IGPUProgrammingServices
 
 	SFrameStats getFrameStats() const override;
 
+	u32 getFrameNumber() const override { return FrameNumber; }
+
 	//! \return Returns the name of the video driver. Example: In case of the DIRECT3D8
 	//! driver, it would return "Direct3D8.1".
 	const char *getName() const override;
@@ -268,6 +270,16 @@ class CNullDriver : public IVideoDriver, public IGPUProgrammingServices
 			mb->getPrimitiveCount(), mb->getPrimitiveType());
 	}
 
+	void drawMeshBufferInstanced(const scene::IMeshBuffer *mb,
+			const SDrawInstances &instances) override;
+
+	void drawMeshBufferBatch(const SDrawBatch &batch) override;
+
+	const SDrawInstances *getDrawInstances() const override
+	{
+		return DrawInstances;
+	}
+
 	// Note: this should handle hw buffers
 	virtual void drawBuffers(const scene::IVertexBuffer *vb,
 		const scene::IIndexBuffer *ib, u32 primCount,
@@ -430,6 +442,16 @@ class CNullDriver : public IVideoDriver, public IGPUProgrammingServices
 	//! Returns the transformation set by setTransform
 	const core::matrix4 &getTransform(E_TRANSFORMATION_STATE state) const override;
 
+	void setJointTransforms(const std::vector<core::matrix4> *transforms) override
+	{
+		JointTransforms = transforms;
+	}
+
+	const std::vector<core::matrix4> *getJointTransforms() const override
+	{
+		return JointTransforms;
+	}
+
 	//! Returns pointer to the IGPUProgrammingServices interface.
 	IGPUProgrammingServices *getGPUProgrammingServices() override;
 
@@ -697,9 +719,13 @@ class CNullDriver : public IVideoDriver, public IGPUProgrammingServices
 	core::rect<s32> ViewPort;
 	core::dimension2d<u32> ScreenSize;
 	core::matrix4 TransformationMatrix;
+	const std::vector<core::matrix4> *JointTransforms = nullptr;
+	//! Set while an instanced draw call is made
+	const SDrawInstances *DrawInstances = nullptr;
 
 	CFPSCounter FPSCounter;
 	SFrameStats FrameStats;
+	u32 FrameNumber = 0;
 
 	u32 MinVertexCountForVBO;
 
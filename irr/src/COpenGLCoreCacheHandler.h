@@ -62,6 +62,11 @@ class COpenGLCoreCacheHandler
 			E_DRIVER_TYPE type = DriverType;
 
 			if (index < MATERIAL_MAX_TEXTURES && index < TextureCount) {
+				if (texture && texture->getDriverType() == DriverType) {
+					auto *curTexture = const_cast<TOpenGLTexture *>(static_cast<const TOpenGLTexture *>(texture));
+					curTexture->makeResident(CacheHandler.Driver->getFrameNumber());
+				}
+
 				if (esa == EST_ACTIVE_ALWAYS)
 					CacheHandler.setActiveTexture(GL_TEXTURE0 + index);
 
@@ -46,7 +46,7 @@ class COpenGLCoreTexture : public ITexture
 	COpenGLCoreTexture(const io::path &name, const std::vector<IImage *> &srcImages, E_TEXTURE_TYPE type, TOpenGLDriver *driver) :
 			ITexture(name, type), Driver(driver), TextureType(GL_TEXTURE_2D),
 			TextureName(0), InternalFormat(GL_RGBA), PixelFormat(GL_RGBA), PixelType(GL_UNSIGNED_BYTE), MSAA(0), Converter(0), LockReadOnly(false), LockImage(0), LockLayer(0),
-			KeepImage(false), MipLevelStored(0)
+			KeepImage(false), Evictable(false), MipLevelStored(0)
 	{
 		assert(!srcImages.empty());
 
@@ -54,12 +54,16 @@ class COpenGLCoreTexture : public ITexture
 		assert(Type != ETT_2D_MS); // not supported by this constructor
 		TextureType = TextureTypeIrrToGL(Type);
 		HasMipMaps = Driver->getTextureCreationFlag(ETCF_CREATE_MIP_MAPS);
-		KeepImage = Driver->getTextureCreationFlag(ETCF_ALLOW_MEMORY_COPY);
+		KeepImage = Driver->getTextureCreationFlag(ETCF_ALLOW_MEMORY_COPY) ||
+				Driver->getTextureCreationFlag(ETCF_ALLOW_EVICTION);
 
 		getImageValues(srcImages[0]);
 		if (!InternalFormat)
 			return;
 
+		// compressed textures can't be kept in memory, see getImageValues()
+		Evictable = KeepImage && Driver->getTextureCreationFlag(ETCF_ALLOW_EVICTION);
+
 		char lbuf[128];
 		snprintf_irr(lbuf, sizeof(lbuf),
 			"COpenGLCoreTexture: Type = %d Size = %dx%d (%dx%d) ColorFormat = %d (%d)%s -> %#06x %#06x %#06x%s",
@@ -87,38 +91,11 @@ class COpenGLCoreTexture : public ITexture
 			tmpImages = &Images;
 		}
 
-		GL.GenTextures(1, &TextureName);
-		TEST_GL_ERROR(Driver);
-		if (!TextureName) {
-			os::Printer::log("COpenGLCoreTexture: texture not created", ELL_ERROR);
+		// Uploaded by makeResident() when the texture is bound the first time
+		if (Evictable)
 			return;
-		}
-
-		const COpenGLCoreTexture *prevTexture = Driver->getCacheHandler()->getTextureCache().get(0);
-		Driver->getCacheHandler()->getTextureCache().set(0, this);
-
-		GL.TexParameteri(TextureType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		GL.TexParameteri(TextureType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-		if (HasMipMaps) {
-			if (Driver->getTextureCreationFlag(ETCF_OPTIMIZED_FOR_SPEED))
-				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_FASTEST);
-			else if (Driver->getTextureCreationFlag(ETCF_OPTIMIZED_FOR_QUALITY))
-				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_NICEST);
-			else
-				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_DONT_CARE);
-		}
-		TEST_GL_ERROR(Driver);
-
-		initTexture(tmpImages->size());
 
-		for (size_t i = 0; i < tmpImages->size(); ++i)
-			uploadTexture(i, 0, (*tmpImages)[i]->getData());
-
-		if (HasMipMaps) {
-			for (size_t i = 0; i < tmpImages->size(); ++i)
-				regenerateMipMapLevels(i);
-		}
+		createTexture(*tmpImages);
 
 		if (!KeepImage) {
 			for (size_t i = 0; i < Images.size(); ++i)
@@ -126,20 +103,13 @@ class COpenGLCoreTexture : public ITexture
 
 			Images.clear();
 		}
-
-		if (!name.empty())
-			Driver->irrGlObjectLabel(GL_TEXTURE, TextureName, name.c_str());
-
-		Driver->getCacheHandler()->getTextureCache().set(0, prevTexture);
-
-		TEST_GL_ERROR(Driver);
 	}
 
 	COpenGLCoreTexture(const io::path &name, const core::dimension2d<u32> &size, E_TEXTURE_TYPE type, ECOLOR_FORMAT format, TOpenGLDriver *driver, u8 msaa = 0) :
 			ITexture(name, type),
 			Driver(driver), TextureType(GL_TEXTURE_2D),
 			TextureName(0), InternalFormat(GL_RGBA), PixelFormat(GL_RGBA), PixelType(GL_UNSIGNED_BYTE), MSAA(msaa), Converter(0), LockReadOnly(false), LockImage(0), LockLayer(0), KeepImage(false),
-			MipLevelStored(0)
+			Evictable(false), MipLevelStored(0)
 	{
 		DriverType = Driver->getDriverType();
 		assert(Type != ETT_2D_ARRAY); // not supported by this constructor
@@ -363,7 +333,8 @@ class COpenGLCoreTexture : public ITexture
 		if (!LockImage)
 			return;
 
-		if (!LockReadOnly) {
+		// An evicted texture is uploaded from the kept image when it's used
+		if (!LockReadOnly && (isResident() || MipLevelStored != 0)) {
 			const COpenGLCoreTexture *prevTexture = Driver->getCacheHandler()->getTextureCache().get(0);
 			Driver->getCacheHandler()->getTextureCache().set(0, this);
 
@@ -381,7 +352,7 @@ class COpenGLCoreTexture : public ITexture
 
 	void regenerateMipMapLevels(u32 layer = 0) override
 	{
-		if (!HasMipMaps || (Size.Width <= 1 && Size.Height <= 1))
+		if (!HasMipMaps || (Size.Width <= 1 && Size.Height <= 1) || !isResident())
 			return;
 
 		const COpenGLCoreTexture *prevTexture = Driver->getCacheHandler()->getTextureCache().get(0);
@@ -393,6 +364,39 @@ class COpenGLCoreTexture : public ITexture
 		Driver->getCacheHandler()->getTextureCache().set(0, prevTexture);
 	}
 
+	bool evict() override
+	{
+		if (!Evictable || !TextureName || LockImage)
+			return false;
+
+		Driver->getCacheHandler()->getTextureCache().remove(this);
+
+		GL.DeleteTextures(1, &TextureName);
+		TEST_GL_ERROR(Driver);
+		TextureName = 0;
+
+		return true;
+	}
+
+	bool isResident() const override
+	{
+		return !Evictable || TextureName;
+	}
+
+	//! Uploads the texture if it isn't in video memory, and remembers the frame it's used in.
+	/** Must be called before the texture is bound, since it uses the first texture unit. */
+	void makeResident(u32 frame)
+	{
+		if (!Evictable)
+			return;
+
+		LastUsedFrame = frame;
+		if (!TextureName) {
+			createTexture(Images);
+			StatesCache.IsCached = false;
+		}
+	}
+
 	GLenum getOpenGLTextureType() const
 	{
 		return TextureType;
@@ -492,6 +496,50 @@ class COpenGLCoreTexture : public ITexture
 		Pitch = Size.Width * IImage::getBitsPerPixelFromFormat(ColorFormat) / 8;
 	}
 
+	void createTexture(const std::vector<IImage *> &images)
+	{
+		GL.GenTextures(1, &TextureName);
+		TEST_GL_ERROR(Driver);
+		if (!TextureName) {
+			os::Printer::log("COpenGLCoreTexture: texture not created", ELL_ERROR);
+			return;
+		}
+
+		const COpenGLCoreTexture *prevTexture = Driver->getCacheHandler()->getTextureCache().get(0);
+		Driver->getCacheHandler()->getTextureCache().set(0, this);
+
+		GL.TexParameteri(TextureType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		GL.TexParameteri(TextureType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		if (HasMipMaps) {
+			if (Driver->getTextureCreationFlag(ETCF_OPTIMIZED_FOR_SPEED))
+				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_FASTEST);
+			else if (Driver->getTextureCreationFlag(ETCF_OPTIMIZED_FOR_QUALITY))
+				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_NICEST);
+			else
+				GL.Hint(GL_GENERATE_MIPMAP_HINT, GL_DONT_CARE);
+		}
+		TEST_GL_ERROR(Driver);
+
+		initTexture(images.size());
+
+		for (size_t i = 0; i < images.size(); ++i)
+			uploadTexture(i, 0, images[i]->getData());
+
+		if (HasMipMaps) {
+			for (size_t i = 0; i < images.size(); ++i)
+				regenerateMipMapLevels(i);
+		}
+
+		const io::path &name = NamedPath.getPath();
+		if (!name.empty())
+			Driver->irrGlObjectLabel(GL_TEXTURE, TextureName, name.c_str());
+
+		Driver->getCacheHandler()->getTextureCache().set(0, prevTexture);
+
+		TEST_GL_ERROR(Driver);
+	}
+
 	static void flipImageY(IImage *image)
 	{
 		const u32 pitch = image->getPitch();
@@ -692,6 +740,7 @@ class COpenGLCoreTexture : public ITexture
 	u32 LockLayer;
 
 	bool KeepImage;
+	bool Evictable;
 	std::vector<IImage*> Images;
 
 	u8 MipLevelStored;
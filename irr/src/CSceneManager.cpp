@@ -516,8 +516,20 @@ void CSceneManager::drawAll()
 
 		std::sort(SolidNodeList.begin(), SolidNodeList.end());
 
-		for (auto &it : SolidNodeList)
-			render_node(it.Node);
+		const bool instancing = Driver->queryFeature(video::EVDF_DRAW_INSTANCED) &&
+				!DebugDataBits;
+		for (size_t i = 0; i < SolidNodeList.size();) {
+			size_t count = 1;
+			while (instancing && i + count < SolidNodeList.size() &&
+					canDrawInstanced(SolidNodeList[i], SolidNodeList[i + count]))
+				++count;
+
+			if (count > 1)
+				drawInstanced(&SolidNodeList[i], count);
+			else
+				render_node(SolidNodeList[i].Node);
+			i += count;
+		}
 
 		SolidNodeList.clear();
 	}
@@ -563,6 +575,62 @@ void CSceneManager::drawAll()
 	CurrentRenderPass = ESNRP_NONE;
 }
 
+bool CSceneManager::canDrawInstanced(const DefaultNodeEntry &a, const DefaultNodeEntry &b) const
+{
+	if (!a.InstancedMesh || a.InstancedMesh != b.InstancedMesh)
+		return false;
+	auto *node_a = static_cast<IMeshSceneNode *>(a.Node);
+	auto *node_b = static_cast<IMeshSceneNode *>(b.Node);
+	if (node_a->getInstancedMaterialType() != node_b->getInstancedMaterialType() ||
+			node_a->isDebugDataVisible() || node_b->isDebugDataVisible())
+		return false;
+
+	const u32 count = node_a->getMaterialCount();
+	if (count != node_b->getMaterialCount())
+		return false;
+	const video::SColor color_a = node_a->getMaterial(0).ColorParam;
+	const video::SColor color_b = node_b->getMaterial(0).ColorParam;
+	for (u32 i = 0; i < count; ++i) {
+		video::SMaterial material = node_a->getMaterial(i);
+		const video::SMaterial &other = node_b->getMaterial(i);
+		// one color for each instance
+		if (material.ColorParam != color_a || other.ColorParam != color_b)
+			return false;
+		material.ColorParam = other.ColorParam;
+		if (material != other)
+			return false;
+	}
+	return true;
+}
+
+void CSceneManager::drawInstanced(const DefaultNodeEntry *entries, size_t count)
+{
+	auto *first = static_cast<IMeshSceneNode *>(entries[0].Node);
+	const IMesh *mesh = entries[0].InstancedMesh;
+	const video::E_MATERIAL_TYPE type = *first->getInstancedMaterialType();
+
+	for (u32 b = 0; b < mesh->getMeshBufferCount(); ++b) {
+		const IMeshBuffer *mb = mesh->getMeshBuffer(b);
+		video::SMaterial material = first->getMaterial(b);
+		if (Driver->needsTransparentRenderPass(material))
+			continue;
+		material.MaterialType = type;
+		Driver->setMaterial(material);
+
+		for (size_t i = 0; i < count; i += video::SDrawInstances::MAX_COUNT) {
+			const size_t end = std::min<size_t>(count, i + video::SDrawInstances::MAX_COUNT);
+			DrawInstances.World.clear();
+			DrawInstances.Colors.clear();
+			for (size_t j = i; j < end; ++j) {
+				ISceneNode *node = entries[j].Node;
+				DrawInstances.World.push_back(node->getAbsoluteTransformation());
+				DrawInstances.Colors.push_back(node->getMaterial(0).ColorParam);
+			}
+			Driver->drawMeshBufferInstanced(mb, DrawInstances);
+		}
+	}
+}
+
 //! Adds an external mesh loader.
 void CSceneManager::addExternalMeshLoader(IMeshLoader *externalLoader)
 {
@@ -7,6 +7,8 @@
 #include "SkinnedMesh.h"
 #include "ISceneManager.h"
 #include "ISceneNode.h"
+#include "IMeshSceneNode.h"
+#include "IVideoDriver.h"
 #include "ICursorControl.h"
 #include "irrString.h"
 #include "irrArray.h"
@@ -197,21 +199,44 @@ class CSceneManager final : public ISceneManager, public ISceneNode
 		DefaultNodeEntry(ISceneNode *n) :
 				Node(n)
 		{
-			if (n->getMaterialCount())
+			if (!n->getMaterialCount())
+				return;
+			if (n->getType() == ESNT_MESH) {
+				auto *mesh_node = static_cast<IMeshSceneNode *>(n);
+				if (mesh_node->getInstancedMaterialType())
+					InstancedMesh = mesh_node->getMesh();
+			}
+			if (InstancedMesh) {
+				// instances differ in their color, so keep them together
+				video::SMaterial material = n->getMaterial(0);
+				material.ColorParam = video::SColor(0);
+				Hash = std::hash<video::SMaterial>{}(material);
+			} else {
 				Hash = std::hash<video::SMaterial>{}(n->getMaterial(0));
+			}
 		}
 
 		bool operator<(const DefaultNodeEntry &other) const noexcept
 		{
-			return Hash < other.Hash;
+			if (Hash != other.Hash)
+				return Hash < other.Hash;
+			return std::less<IMesh *>{}(InstancedMesh, other.InstancedMesh);
 		}
 
 		ISceneNode *Node = nullptr;
+		//! The mesh, if the node may be drawn as an instance of it
+		IMesh *InstancedMesh = nullptr;
 
 	private:
 		size_t Hash = 0;
 	};
 
+	//! Returns if both nodes can be drawn in one instanced draw call
+	bool canDrawInstanced(const DefaultNodeEntry &a, const DefaultNodeEntry &b) const;
+
+	//! Draws solid nodes that share a mesh as instances of it
+	void drawInstanced(const DefaultNodeEntry *entries, size_t count);
+
 	//! sort on distance (center) to camera
 	struct TransparentNodeEntry
 	{
@@ -249,6 +274,7 @@ class CSceneManager final : public ISceneManager, public ISceneNode
 	std::vector<ISceneNode *> CameraList;
 	std::vector<ISceneNode *> SkyBoxList;
 	std::vector<DefaultNodeEntry> SolidNodeList;
+	video::SDrawInstances DrawInstances;
 	std::vector<TransparentNodeEntry> TransparentNodeList;
 	std::vector<TransparentNodeEntry> TransparentEffectNodeList;
 	std::vector<ISceneNode *> GuiNodeList;
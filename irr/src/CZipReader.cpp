@@ -7,11 +7,23 @@
 #include "os.h"
 
 #include "CFileList.h"
+#include "CMemoryFile.h"
 #include "CReadFile.h"
 #include "coreutil.h"
 
+#include <climits>
 #include <zlib.h> // use system lib
 
+#if defined(_IRR_WINDOWS_API_)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace io
 {
 
@@ -91,6 +103,14 @@ CZipReader::CZipReader(IFileSystem *fs, IReadFile *file, bool ignoreCase, bool i
 	if (File) {
 		File->grab();
 
+		mapArchive();
+		if (Mapped) {
+			// scan the headers from memory as well, the file is not needed anymore
+			IReadFile *view = new CMemoryReadFile(Data, DataSize, File->getFileName(), false);
+			File->drop();
+			File = view;
+		}
+
 		// load file entries
 		while (scanZipHeader()) {}
 
@@ -102,6 +122,75 @@ CZipReader::~CZipReader()
 {
 	if (File)
 		File->drop();
+	unmapArchive();
+}
+
+void CZipReader::mapArchive()
+{
+	if (File->getType() == ERFT_MEMORY_READ_FILE) {
+		Data = static_cast<const u8 *>(static_cast<IMemoryReadFile *>(File)->getBuffer());
+		DataSize = File->getSize();
+		return;
+	}
+	if (File->getType() != ERFT_READ_FILE)
+		return;
+
+	// Without a mapping everything is read through the file, which still works
+	const long size = File->getSize();
+	if (size <= 0 || size == LONG_MAX)
+		return;
+#if defined(_IRR_WINDOWS_API_)
+	HANDLE file = CreateFileA(File->getFileName().c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) {
+		void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+		// the view keeps the mapping alive
+		CloseHandle(mapping);
+		Data = static_cast<const u8 *>(ptr);
+	}
+	CloseHandle(file);
+#else
+	int fd = open(File->getFileName().c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	// the file might have changed since it was opened
+	if (fstat(fd, &st) == 0 && st.st_size == size) {
+		void *ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr != MAP_FAILED)
+			Data = static_cast<const u8 *>(ptr);
+	}
+	close(fd);
+#endif
+	if (Data) {
+		DataSize = size;
+		Mapped = true;
+	}
+}
+
+void CZipReader::unmapArchive()
+{
+	if (Mapped) {
+#if defined(_IRR_WINDOWS_API_)
+		UnmapViewOfFile(Data);
+#else
+		munmap(const_cast<u8 *>(Data), DataSize);
+#endif
+	}
+	Data = nullptr;
+	DataSize = 0;
+	Mapped = false;
+}
+
+const u8 *CZipReader::getEntryData(const SZipFileEntry &e) const
+{
+	const size_t size = e.header.DataDescriptor.CompressedSize;
+	if (!Data || e.Offset < 0 || (size_t)e.Offset > DataSize || size > DataSize - e.Offset)
+		return 0;
+	return Data + e.Offset;
 }
 
 //! get the archive type
@@ -298,6 +387,8 @@ IReadFile *CZipReader::createAndOpenFile(u32 index)
 	char buf[64];
 	s16 actualCompressionMethod = e.header.CompressionMethod;
 	IReadFile *decrypted = 0;
+	// with the archive in memory, entries are used in place
+	const u8 *entryData = getEntryData(e);
 	u8 *decryptedBuf = 0;
 	u32 decryptedSize = e.header.DataDescriptor.CompressedSize;
 	switch (actualCompressionMethod) {
@@ -305,6 +396,8 @@ IReadFile *CZipReader::createAndOpenFile(u32 index)
 	{
 		if (decrypted)
 			return decrypted;
+		else if (entryData)
+			return new CMemoryReadFile(entryData, decryptedSize, Files[index].FullName, false, this);
 		else
 			return createLimitReadFile(Files[index].FullName, File, e.Offset, decryptedSize);
 	}
@@ -319,19 +412,20 @@ IReadFile *CZipReader::createAndOpenFile(u32 index)
 			return 0;
 		}
 
-		u8 *pcData = decryptedBuf;
+		const u8 *pcData = decryptedBuf ? decryptedBuf : entryData;
 		if (!pcData) {
-			pcData = new u8[decryptedSize];
-			if (!pcData) {
+			u8 *readBuf = new u8[decryptedSize];
+			if (!readBuf) {
 				snprintf_irr(buf, 64, "Not enough memory for decompressing %s", Files[index].FullName.c_str());
 				os::Printer::log(buf, ELL_ERROR);
 				delete[] pBuf;
 				return 0;
 			}
 
-			// memset(pcData, 0, decryptedSize);
+			// memset(readBuf, 0, decryptedSize);
 			File->seek(e.Offset);
-			File->read(pcData, decryptedSize);
+			File->read(readBuf, decryptedSize);
+			pcData = readBuf;
 		}
 
 		// Setup the inflate stream.
@@ -358,7 +452,7 @@ IReadFile *CZipReader::createAndOpenFile(u32 index)
 
 		if (decrypted)
 			decrypted->drop();
-		else
+		else if (pcData != entryData)
 			delete[] pcData;
 
 		if (err != Z_OK) {
@@ -165,9 +165,22 @@ class CZipReader : public virtual IFileArchive, virtual CFileList
 
 	bool scanCentralDirectoryHeader();
 
+	//! maps the archive into memory, or uses it directly if it already is
+	void mapArchive();
+	void unmapArchive();
+
+	//! returns the data of an entry if the archive is in memory, or 0
+	const u8 *getEntryData(const SZipFileEntry &e) const;
+
 	io::IFileSystem *FileSystem;
 	IReadFile *File;
 
+	// the whole archive, if it is in memory
+	const u8 *Data = nullptr;
+	size_t DataSize = 0;
+	// whether Data belongs to a mapping of our own
+	bool Mapped = false;
+
 	// holds extended info about files
 	std::vector<SZipFileEntry> FileInfo;
 };
@@ -0,0 +1,125 @@
+// Copyright (C) 2026 Luanti contributors
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "BufferArena.h"
+
+#include <cassert>
+#include <mt_opengl.h>
+
+namespace video
+{
+
+void OpenGLBufferArena::init(size_t elementSize, size_t capacity)
+{
+	destroy();
+	assert(elementSize > 0 && capacity > 0);
+
+	GL.GenBuffers(1, &m_name);
+	if (!m_name)
+		return;
+	GL.BindBuffer(GL_ARRAY_BUFFER, m_name);
+	GL.BufferData(GL_ARRAY_BUFFER, elementSize * capacity, nullptr, GL_STATIC_DRAW);
+	GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_element_size = elementSize;
+	m_capacity = capacity;
+	m_free[0] = capacity;
+}
+
+size_t OpenGLBufferArena::allocate(const void *data, size_t count)
+{
+	if (!m_name || count == 0)
+		return npos;
+
+	// first fit keeps the front of the buffer densely used
+	auto it = m_free.begin();
+	while (it != m_free.end() && it->second < count)
+		++it;
+	if (it == m_free.end()) {
+		if (!grow(m_capacity + count))
+			return npos;
+		it = std::prev(m_free.end());
+		assert(it->second >= count);
+	}
+
+	const size_t offset = it->first;
+	const size_t remaining = it->second - count;
+	m_free.erase(it);
+	if (remaining > 0)
+		m_free[offset + count] = remaining;
+
+	GL.BindBuffer(GL_ARRAY_BUFFER, m_name);
+	GL.BufferSubData(GL_ARRAY_BUFFER, offset * m_element_size,
+		count * m_element_size, data);
+	GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return offset;
+}
+
+void OpenGLBufferArena::free(size_t offset, size_t count)
+{
+	if (count == 0)
+		return;
+	assert(offset + count <= m_capacity);
+
+	auto [it, inserted] = m_free.emplace(offset, count);
+	assert(inserted); // double free
+	(void)inserted;
+	// merge with the following range
+	auto next = std::next(it);
+	if (next != m_free.end() && it->first + it->second == next->first) {
+		it->second += next->second;
+		m_free.erase(next);
+	}
+	// and with the preceding one
+	if (it != m_free.begin()) {
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == it->first) {
+			prev->second += it->second;
+			m_free.erase(it);
+		}
+	}
+}
+
+bool OpenGLBufferArena::grow(size_t minCapacity)
+{
+	size_t capacity = m_capacity;
+	while (capacity < minCapacity)
+		capacity *= 2;
+
+	GLuint name = 0;
+	GL.GenBuffers(1, &name);
+	if (!name)
+		return false;
+	GL.BindBuffer(GL.COPY_WRITE_BUFFER, name);
+	GL.BufferData(GL.COPY_WRITE_BUFFER, capacity * m_element_size, nullptr, GL_STATIC_DRAW);
+	GL.BindBuffer(GL.COPY_READ_BUFFER, m_name);
+	GL.CopyBufferSubData(GL.COPY_READ_BUFFER, GL.COPY_WRITE_BUFFER, 0, 0,
+		m_capacity * m_element_size);
+	GL.BindBuffer(GL.COPY_READ_BUFFER, 0);
+	GL.BindBuffer(GL.COPY_WRITE_BUFFER, 0);
+	GL.DeleteBuffers(1, &m_name);
+	m_name = name;
+
+	// the new space goes at the end, possibly joining the last free range
+	auto last = m_free.empty() ? m_free.end() : std::prev(m_free.end());
+	if (last != m_free.end() && last->first + last->second == m_capacity)
+		last->second += capacity - m_capacity;
+	else
+		m_free[m_capacity] = capacity - m_capacity;
+	m_capacity = capacity;
+	return true;
+}
+
+void OpenGLBufferArena::destroy()
+{
+	if (m_name)
+		GL.DeleteBuffers(1, &m_name);
+	m_name = 0;
+	m_element_size = 0;
+	m_capacity = 0;
+	m_free.clear();
+}
+
+}
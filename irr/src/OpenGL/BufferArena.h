@@ -0,0 +1,76 @@
+// Copyright (C) 2026 Luanti contributors
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace video
+{
+
+/**
+ * One large GL buffer that many hardware buffers of the same element type
+ * are allocated from, so that they can be drawn together with one
+ * multi-draw call.
+ *
+ * Offsets and sizes are counted in elements. When the buffer is full it
+ * is grown, which keeps all existing offsets valid.
+ */
+class OpenGLBufferArena
+{
+public:
+	static constexpr size_t npos = SIZE_MAX;
+
+	/// @note does not create on GL side
+	OpenGLBufferArena() = default;
+	/// @note does not free on GL side
+	~OpenGLBufferArena() = default;
+
+	/// @return "name" (ID) of the buffer in GL
+	GLuint getName() const { return m_name; }
+	/// @return does this refer to an existing GL buffer?
+	bool exists() const { return m_name != 0; }
+
+	/// @return size of one element in bytes
+	size_t getElementSize() const { return m_element_size; }
+
+	/**
+	 * Create buffer in GL.
+	 * @param elementSize size of one element in bytes
+	 * @param capacity initial capacity in elements
+	 */
+	void init(size_t elementSize, size_t capacity);
+
+	/**
+	 * Allocate space and upload data to it.
+	 * @param data data pointer
+	 * @param count number of elements
+	 * @note modifies GL_ARRAY_BUFFER binding
+	 * @return offset of the data in elements, or `npos` on failure
+	 */
+	size_t allocate(const void *data, size_t count);
+
+	/// Return space from allocate() to the arena
+	void free(size_t offset, size_t count);
+
+	/**
+	 * Free buffer in GL.
+	 * @note modifies GL_ARRAY_BUFFER binding
+	 */
+	void destroy();
+
+private:
+	bool grow(size_t minCapacity);
+
+	GLuint m_name = 0;
+	size_t m_element_size = 0;
+	size_t m_capacity = 0;
+	// offset -> size of the unused ranges, adjacent ones are merged
+	std::map<size_t, size_t> m_free;
+};
+
+}
@@ -61,6 +61,32 @@ static const VertexType vtStandard = {
 		},
 };
 
+// Layout of static EVT_STANDARD hardware buffers on the GPU.
+// The normal is quantized, which saves 8 of 36 bytes per vertex.
+struct S3DVertexPacked
+{
+	core::vector3df Pos;
+	s8 Normal[4];
+	SColor Color;
+	core::vector2df TCoords;
+};
+static_assert(sizeof(S3DVertexPacked) == 28);
+
+static const VertexType vtStandardPacked = {
+		sizeof(S3DVertexPacked),
+		{
+				{EVA_POSITION, 3, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexPacked, Pos)},
+				{EVA_NORMAL, 3, GL_BYTE, VertexAttribute::Mode::Normalized, offsetof(S3DVertexPacked, Normal)},
+				{EVA_COLOR, 4, GL_UNSIGNED_BYTE, VertexAttribute::Mode::Normalized, offsetof(S3DVertexPacked, Color)},
+				{EVA_TCOORD0, 2, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexPacked, TCoords)},
+		},
+};
+
+static s8 packNormalComponent(f32 v)
+{
+	return static_cast<s8>(core::round32(core::clamp(v, -1.0f, 1.0f) * 127.0f));
+}
+
 // FIXME: this is actually UB because these vertex classes are not "standard-layout"
 // they violate the following requirement:
 // - only one class in the hierarchy has non-static data members
@@ -90,6 +116,19 @@ static const VertexType vtTangents = {
 		},
 };
 
+// joint indices are converted to floats, integer attributes need GLSL 1.30
+static const VertexType vtSkinned = {
+		sizeof(S3DVertexSkinned),
+		{
+				{EVA_POSITION, 3, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexSkinned, Pos)},
+				{EVA_NORMAL, 3, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexSkinned, Normal)},
+				{EVA_COLOR, 4, GL_UNSIGNED_BYTE, VertexAttribute::Mode::Normalized, offsetof(S3DVertexSkinned, Color)},
+				{EVA_TCOORD0, 2, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexSkinned, TCoords)},
+				{EVA_JOINTS, 4, GL_UNSIGNED_BYTE, VertexAttribute::Mode::Regular, offsetof(S3DVertexSkinned, JointIDs)},
+				{EVA_WEIGHTS, 4, GL_FLOAT, VertexAttribute::Mode::Regular, offsetof(S3DVertexSkinned, Weights)},
+		},
+};
+
 #pragma GCC diagnostic pop
 
 static const VertexType &getVertexTypeDescription(E_VERTEX_TYPE type)
@@ -101,6 +140,8 @@ static const VertexType &getVertexTypeDescription(E_VERTEX_TYPE type)
 		return vt2TCoords;
 	case EVT_TANGENTS:
 		return vtTangents;
+	case EVT_SKINNED:
+		return vtSkinned;
 	default:
 		IRR_CODE_UNREACHABLE();
 	}
@@ -168,6 +209,8 @@ COpenGL3DriverBase::COpenGL3DriverBase(const SIrrlichtCreationParameters &params
 COpenGL3DriverBase::~COpenGL3DriverBase()
 {
 	QuadIndexVBO.destroy();
+	StreamVertexBuffer.destroy();
+	StreamIndexBuffer.destroy();
 
 	deleteMaterialRenders();
 
@@ -177,6 +220,9 @@ COpenGL3DriverBase::~COpenGL3DriverBase()
 	deleteAllTextures();
 	removeAllOcclusionQueries();
 	removeAllHardwareBuffers();
+	VertexArena.destroy();
+	IndexArena.destroy();
+	StreamIndirectBuffer.destroy();
 
 	delete MaterialRenderer2DTexture;
 	delete MaterialRenderer2DNoTexture;
@@ -253,6 +299,22 @@ bool COpenGL3DriverBase::genericDriverInit(const core::dimension2d<u32> &screenS
 
 	initQuadsIndices();
 
+	const bool persistent = BufferStorageSupported && GL.BufferStorage && GL.FenceSync;
+	StreamVertexBuffer.init(GL_ARRAY_BUFFER, 4 << 20, persistent);
+	StreamIndexBuffer.init(GL_ELEMENT_ARRAY_BUFFER, 1 << 20, persistent);
+	os::Printer::log(persistent ? "Using persistently mapped stream buffers" :
+		"Using orphaned stream buffers", ELL_INFORMATION);
+
+	MultiDrawIndirectSupported = MultiDrawIndirectSupported &&
+		GL.MultiDrawElementsIndirect && GL.VertexAttribDivisor;
+	if (MultiDrawIndirectSupported) {
+		VertexArena.init(sizeof(S3DVertexPacked), (16 << 20) / sizeof(S3DVertexPacked));
+		IndexArena.init(sizeof(u16), (4 << 20) / sizeof(u16));
+		StreamIndirectBuffer.init(GL.DRAW_INDIRECT_BUFFER, 1 << 20, persistent);
+		os::Printer::log("Using multi-draw indirect for batches", ELL_INFORMATION);
+	}
+	TEST_GL_ERROR(this);
+
 	// reset cache handler
 	delete CacheHandler;
 	CacheHandler = new COpenGL3CacheHandler(this);
@@ -498,9 +560,33 @@ bool COpenGL3DriverBase::updateVertexHardwareBuffer(SHWBufferLink_opengl *HWBuff
 	const auto *vb = HWBuffer->VertexBuffer;
 	assert(vb);
 
+	// Static buffers (e.g. map meshes) are uploaded rarely and drawn a lot,
+	// so they are worth converting to a smaller format
+	HWBuffer->Packed = vb->getType() == EVT_STANDARD &&
+		vb->getHardwareMappingHint() == scene::EHM_STATIC;
+	if (HWBuffer->Packed) {
+		const auto *src = static_cast<const S3DVertex *>(vb->getData());
+		std::vector<S3DVertexPacked> packed(vb->getCount());
+		for (u32 i = 0; i < vb->getCount(); i++) {
+			packed[i].Pos = src[i].Pos;
+			packed[i].Normal[0] = packNormalComponent(src[i].Normal.X);
+			packed[i].Normal[1] = packNormalComponent(src[i].Normal.Y);
+			packed[i].Normal[2] = packNormalComponent(src[i].Normal.Z);
+			packed[i].Normal[3] = 0;
+			packed[i].Color = src[i].Color;
+			packed[i].TCoords = src[i].TCoords;
+		}
+		if (MultiDrawIndirectSupported && !packed.empty())
+			return uploadToArena(HWBuffer, VertexArena, packed.data(), packed.size());
+		releaseFromArena(HWBuffer);
+		return uploadHardwareBuffer(HWBuffer->Vbo, packed.data(),
+			packed.size() * sizeof(S3DVertexPacked), scene::EHM_STATIC);
+	}
+
 	const u32 vertexSize = getVertexPitchFromType(vb->getType());
 	const size_t bufferSize = vertexSize * vb->getCount();
 
+	releaseFromArena(HWBuffer);
 	return uploadHardwareBuffer(HWBuffer->Vbo, vb->getData(),
 		bufferSize, vb->getHardwareMappingHint());
 }
@@ -528,10 +614,42 @@ bool COpenGL3DriverBase::updateIndexHardwareBuffer(SHWBufferLink_opengl *HWBuffe
 
 	const size_t bufferSize = ib->getCount() * indexSize;
 
+	if (MultiDrawIndirectSupported && ib->getType() == EIT_16BIT &&
+			ib->getHardwareMappingHint() == scene::EHM_STATIC && ib->getCount() > 0)
+		return uploadToArena(HWBuffer, IndexArena, ib->getData(), ib->getCount());
+
+	releaseFromArena(HWBuffer);
 	return uploadHardwareBuffer(HWBuffer->Vbo, ib->getData(),
 		bufferSize, ib->getHardwareMappingHint());
 }
 
+bool COpenGL3DriverBase::uploadToArena(SHWBufferLink_opengl *HWBuffer,
+	OpenGLBufferArena &arena, const void *data, size_t count)
+{
+	releaseFromArena(HWBuffer);
+	HWBuffer->Vbo.destroy();
+
+	accountHWBufferUpload(count * arena.getElementSize());
+	const size_t offset = arena.allocate(data, count);
+	if (offset == OpenGLBufferArena::npos)
+		return false;
+
+	HWBuffer->Arena = &arena;
+	HWBuffer->ArenaOffset = offset;
+	HWBuffer->ArenaCount = count;
+	return (!TEST_GL_ERROR(this));
+}
+
+void COpenGL3DriverBase::releaseFromArena(SHWBufferLink_opengl *HWBuffer)
+{
+	if (!HWBuffer->Arena)
+		return;
+	HWBuffer->Arena->free(HWBuffer->ArenaOffset, HWBuffer->ArenaCount);
+	HWBuffer->Arena = nullptr;
+	HWBuffer->ArenaOffset = 0;
+	HWBuffer->ArenaCount = 0;
+}
+
 bool COpenGL3DriverBase::updateHardwareBuffer(SHWBufferLink *HWBuffer)
 {
 	if (!HWBuffer)
@@ -541,14 +659,14 @@ bool COpenGL3DriverBase::updateHardwareBuffer(SHWBufferLink *HWBuffer)
 
 	if (b->IsVertex) {
 		assert(b->VertexBuffer);
-		if (b->ChangedID != b->VertexBuffer->getChangedID() || !b->Vbo.exists()) {
+		if (b->ChangedID != b->VertexBuffer->getChangedID() || !b->exists()) {
 			if (!updateVertexHardwareBuffer(b))
 				return false;
 			b->ChangedID = b->VertexBuffer->getChangedID();
 		}
 	} else {
 		assert(b->IndexBuffer);
-		if (b->ChangedID != b->IndexBuffer->getChangedID() || !b->Vbo.exists()) {
+		if (b->ChangedID != b->IndexBuffer->getChangedID() || !b->exists()) {
 			if (!updateIndexHardwareBuffer(b))
 				return false;
 			b->ChangedID = b->IndexBuffer->getChangedID();
@@ -595,6 +713,7 @@ void COpenGL3DriverBase::deleteHardwareBuffer(SHWBufferLink *HWBuffer)
 		return;
 
 	auto *b = static_cast<SHWBufferLink_opengl *>(HWBuffer);
+	releaseFromArena(b);
 	b->Vbo.destroy();
 
 	CNullDriver::deleteHardwareBuffer(HWBuffer);
@@ -603,6 +722,132 @@ void COpenGL3DriverBase::deleteHardwareBuffer(SHWBufferLink *HWBuffer)
 void COpenGL3DriverBase::drawBuffers(const scene::IVertexBuffer *vb,
 	const scene::IIndexBuffer *ib, u32 PrimitiveCount,
 	scene::E_PRIMITIVE_TYPE PrimitiveType)
+{
+	drawBuffersInstanced(vb, ib, PrimitiveCount, PrimitiveType, 1);
+}
+
+void COpenGL3DriverBase::drawMeshBufferInstanced(const scene::IMeshBuffer *mb,
+		const SDrawInstances &instances)
+{
+	if (!mb || instances.World.empty())
+		return;
+	assert(instances.World.size() <= SDrawInstances::MAX_COUNT);
+	assert(instances.Colors.size() == instances.World.size());
+
+	// the shader places the instances, with the view and projection as usual
+	const core::matrix4 world = getTransform(ETS_WORLD);
+	setTransform(ETS_WORLD, core::IdentityMatrix);
+	DrawInstances = &instances;
+	drawBuffersInstanced(mb->getVertexBuffer(), mb->getIndexBuffer(),
+		mb->getPrimitiveCount(), mb->getPrimitiveType(), instances.World.size());
+	DrawInstances = nullptr;
+	setTransform(ETS_WORLD, world);
+}
+
+void COpenGL3DriverBase::drawMeshBufferBatch(const SDrawBatch &batch)
+{
+	assert(batch.Offsets.size() == batch.Buffers.size());
+	if (batch.Buffers.empty())
+		return;
+
+	// One call can only draw what is in the arenas
+	bool indirect = MultiDrawIndirectSupported;
+	for (const auto *mb : batch.Buffers) {
+		auto *hwvert = static_cast<SHWBufferLink_opengl *>(getBufferLink(mb->getVertexBuffer()));
+		auto *hwidx = static_cast<SHWBufferLink_opengl *>(getBufferLink(mb->getIndexBuffer()));
+		updateHardwareBuffer(hwvert);
+		updateHardwareBuffer(hwidx);
+		indirect = indirect && hwvert && hwidx &&
+			hwvert->Arena == &VertexArena && hwidx->Arena == &IndexArena &&
+			mb->getPrimitiveType() == scene::EPT_TRIANGLES;
+	}
+	if (indirect && drawBatchIndirect(batch))
+		return;
+
+	// The material and its shader constants are the same for all
+	// buffers, so only the offset has to change between the draws
+	setRenderStates3DMode();
+	LockRenderStateMode = true;
+	for (size_t i = 0; i < batch.Buffers.size(); i++) {
+		const auto *mb = batch.Buffers[i];
+		const core::vector3df &offset = batch.Offsets[i];
+		GL.VertexAttrib3f(EVA_DRAW_OFFSET, offset.X, offset.Y, offset.Z);
+		drawBuffersInstanced(mb->getVertexBuffer(), mb->getIndexBuffer(),
+			mb->getPrimitiveCount(), mb->getPrimitiveType(), 1);
+	}
+	LockRenderStateMode = false;
+	GL.VertexAttrib3f(EVA_DRAW_OFFSET, 0.0f, 0.0f, 0.0f);
+}
+
+bool COpenGL3DriverBase::drawBatchIndirect(const SDrawBatch &batch)
+{
+	// layout defined by GL
+	struct DrawElementsIndirectCommand
+	{
+		GLuint Count;
+		GLuint InstanceCount;
+		GLuint FirstIndex;
+		GLint BaseVertex;
+		GLuint BaseInstance;
+	};
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	commands.reserve(batch.Buffers.size());
+	u32 primitiveCount = 0;
+	for (size_t i = 0; i < batch.Buffers.size(); i++) {
+		const auto *mb = batch.Buffers[i];
+		const u32 count = mb->getPrimitiveCount();
+		if (!count)
+			continue;
+		auto *hwvert = static_cast<SHWBufferLink_opengl *>(mb->getVertexBuffer()->getHWBuffer());
+		auto *hwidx = static_cast<SHWBufferLink_opengl *>(mb->getIndexBuffer()->getHWBuffer());
+		// the instance selects the offset of this draw
+		commands.push_back({count * 3, 1, static_cast<GLuint>(hwidx->ArenaOffset),
+			static_cast<GLint>(hwvert->ArenaOffset), static_cast<GLuint>(i)});
+		primitiveCount += count;
+	}
+	if (commands.empty())
+		return true;
+
+	uintptr_t commandsBase = 0;
+	if (!streamData(StreamIndirectBuffer, commands.data(),
+			commands.size() * sizeof(DrawElementsIndirectCommand), commandsBase))
+		return false;
+	uintptr_t offsetsBase = 0;
+	if (!streamData(StreamVertexBuffer, batch.Offsets.data(),
+			batch.Offsets.size() * sizeof(core::vector3df), offsetsBase)) {
+		GL.BindBuffer(GL.DRAW_INDIRECT_BUFFER, 0);
+		return false;
+	}
+
+	FrameStats.Drawcalls++;
+	FrameStats.PrimitivesDrawn += primitiveCount;
+
+	setRenderStates3DMode();
+
+	GL.EnableVertexAttribArray(EVA_DRAW_OFFSET);
+	GL.VertexAttribPointer(EVA_DRAW_OFFSET, 3, GL_FLOAT, GL_FALSE,
+		sizeof(core::vector3df), reinterpret_cast<void *>(offsetsBase));
+	GL.VertexAttribDivisor(EVA_DRAW_OFFSET, 1);
+
+	GL.BindBuffer(GL_ARRAY_BUFFER, VertexArena.getName());
+	GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexArena.getName());
+	beginDraw(vtStandardPacked, 0);
+	GL.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+		reinterpret_cast<const void *>(commandsBase), commands.size(), 0);
+	endDraw(vtStandardPacked);
+
+	GL.VertexAttribDivisor(EVA_DRAW_OFFSET, 0);
+	GL.DisableVertexAttribArray(EVA_DRAW_OFFSET);
+	GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+	GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GL.BindBuffer(GL.DRAW_INDIRECT_BUFFER, 0);
+	return true;
+}
+
+void COpenGL3DriverBase::drawBuffersInstanced(const scene::IVertexBuffer *vb,
+	const scene::IIndexBuffer *ib, u32 PrimitiveCount,
+	scene::E_PRIMITIVE_TYPE PrimitiveType, u32 instanceCount)
 {
 	if (!vb || !ib)
 		return;
@@ -615,22 +860,40 @@ void COpenGL3DriverBase::drawBuffers(const scene::IVertexBuffer *vb,
 	const void *vertices = vb->getData();
 	if (hwvert) {
 		assert(hwvert->IsVertex);
-		assert(hwvert->Vbo.exists());
-		GL.BindBuffer(GL_ARRAY_BUFFER, hwvert->Vbo.getName());
+		assert(hwvert->exists());
+		GL.BindBuffer(GL_ARRAY_BUFFER, hwvert->getName());
 		vertices = nullptr;
+		BoundVertexOffset = hwvert->getByteOffset();
+		if (hwvert->Packed)
+			BoundVertexType = &vtStandardPacked;
 	}
 
 	const void *indexList = ib->getData();
 	if (hwidx) {
 		assert(!hwidx->IsVertex);
-		assert(hwidx->Vbo.exists());
-		GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, hwidx->Vbo.getName());
+		assert(hwidx->exists());
+		GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, hwidx->getName());
 		indexList = nullptr;
+		BoundIndexOffset = hwidx->getByteOffset();
 	}
 
-	drawVertexPrimitiveList(vertices, vb->getCount(), indexList,
-		PrimitiveCount, vb->getType(), PrimitiveType, ib->getType());
+	if (instanceCount == 1) {
+		drawVertexPrimitiveList(vertices, vb->getCount(), indexList,
+			PrimitiveCount, vb->getType(), PrimitiveType, ib->getType());
+	} else if (PrimitiveCount && vb->getCount() && checkPrimitiveCount(PrimitiveCount)) {
+		CNullDriver::drawVertexPrimitiveList(vertices, vb->getCount(), indexList,
+			PrimitiveCount, vb->getType(), PrimitiveType, ib->getType());
+		FrameStats.PrimitivesDrawn += PrimitiveCount * (instanceCount - 1);
+
+		setRenderStates3DMode();
+
+		drawGeneric(vertices, vb->getCount(), indexList, PrimitiveCount,
+			vb->getType(), PrimitiveType, ib->getType(), instanceCount);
+	}
 
+	BoundVertexType = nullptr;
+	BoundVertexOffset = 0;
+	BoundIndexOffset = 0;
 	if (hwvert)
 		GL.BindBuffer(GL_ARRAY_BUFFER, 0);
 	if (hwidx)
@@ -683,7 +946,7 @@ void COpenGL3DriverBase::drawVertexPrimitiveList(const void *vertices, u32 verte
 
 	setRenderStates3DMode();
 
-	drawGeneric(vertices, indexList, primitiveCount, vType, pType, iType);
+	drawGeneric(vertices, vertexCount, indexList, primitiveCount, vType, pType, iType);
 }
 
 //! draws a vertex primitive list in 2d
@@ -708,7 +971,7 @@ void COpenGL3DriverBase::draw2DVertexPrimitiveList(const void *vertices, u32 ver
 		Material.MaterialType == EMT_TRANSPARENT_ALPHA_CHANNEL
 	);
 
-	drawGeneric(vertices, indexList, primitiveCount, vType, pType, iType);
+	drawGeneric(vertices, vertexCount, indexList, primitiveCount, vType, pType, iType);
 }
 
 void COpenGL3DriverBase::draw2DImage(const video::ITexture *texture, const core::position2d<s32> &destPos,
@@ -977,63 +1240,125 @@ void COpenGL3DriverBase::drawQuad(const VertexType &vertexType, const S3DVertex
 
 void COpenGL3DriverBase::drawArrays(GLenum primitiveType, const VertexType &vertexType, const void *vertices, int vertexCount)
 {
-	beginDraw(vertexType, reinterpret_cast<uintptr_t>(vertices));
+	uintptr_t base = reinterpret_cast<uintptr_t>(vertices);
+	const bool streamed = streamData(StreamVertexBuffer, vertices,
+		vertexCount * vertexType.VertexSize, base);
+	beginDraw(vertexType, base);
 	GL.DrawArrays(primitiveType, 0, vertexCount);
 	endDraw(vertexType);
+	if (streamed)
+		GL.BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void COpenGL3DriverBase::drawElements(GLenum primitiveType, const VertexType &vertexType, const void *vertices, int vertexCount, const u16 *indices, int indexCount)
 {
-	beginDraw(vertexType, reinterpret_cast<uintptr_t>(vertices));
+	// indices may be an offset into a bound buffer, only stream the vertices
+	uintptr_t base = reinterpret_cast<uintptr_t>(vertices);
+	const bool streamed = streamData(StreamVertexBuffer, vertices,
+		vertexCount * vertexType.VertexSize, base);
+	beginDraw(vertexType, base);
 	GL.DrawRangeElements(primitiveType, 0, vertexCount - 1, indexCount, GL_UNSIGNED_SHORT, indices);
 	endDraw(vertexType);
+	if (streamed)
+		GL.BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void COpenGL3DriverBase::drawGeneric(const void *vertices, const void *indexList,
-		u32 primitiveCount,
-		E_VERTEX_TYPE vType, scene::E_PRIMITIVE_TYPE pType, E_INDEX_TYPE iType)
+bool COpenGL3DriverBase::streamData(OpenGLStreamBuffer &buffer, const void *data,
+		size_t size, uintptr_t &base)
 {
-	auto &vTypeDesc = getVertexTypeDescription(vType);
-	beginDraw(vTypeDesc, reinterpret_cast<uintptr_t>(vertices));
-	GLenum indexSize = 0;
-
-	switch (iType) {
-	case EIT_16BIT:
-		indexSize = GL_UNSIGNED_SHORT;
-		break;
-	case EIT_32BIT:
-		indexSize = GL_UNSIGNED_INT;
-		break;
-	}
+	if (!data)
+		return false;
+	const size_t offset = buffer.upload(data, size);
+	if (offset == OpenGLStreamBuffer::npos)
+		return false;
+	base = offset;
+	return true;
+}
 
+void COpenGL3DriverBase::drawGeneric(const void *vertices, u32 vertexCount,
+		const void *indexList, u32 primitiveCount,
+		E_VERTEX_TYPE vType, scene::E_PRIMITIVE_TYPE pType, E_INDEX_TYPE iType,
+		u32 instanceCount)
+{
+	GLenum mode;
+	GLsizei count;
 	switch (pType) {
 	case scene::EPT_POINTS:
 	case scene::EPT_POINT_SPRITES:
-		GL.DrawArrays(GL_POINTS, 0, primitiveCount);
+		mode = GL_POINTS;
+		count = primitiveCount;
 		break;
 	case scene::EPT_LINE_STRIP:
-		GL.DrawElements(GL_LINE_STRIP, primitiveCount + 1, indexSize, indexList);
+		mode = GL_LINE_STRIP;
+		count = primitiveCount + 1;
 		break;
 	case scene::EPT_LINE_LOOP:
-		GL.DrawElements(GL_LINE_LOOP, primitiveCount, indexSize, indexList);
+		mode = GL_LINE_LOOP;
+		count = primitiveCount;
 		break;
 	case scene::EPT_LINES:
-		GL.DrawElements(GL_LINES, primitiveCount * 2, indexSize, indexList);
+		mode = GL_LINES;
+		count = primitiveCount * 2;
 		break;
 	case scene::EPT_TRIANGLE_STRIP:
-		GL.DrawElements(GL_TRIANGLE_STRIP, primitiveCount + 2, indexSize, indexList);
+		mode = GL_TRIANGLE_STRIP;
+		count = primitiveCount + 2;
 		break;
 	case scene::EPT_TRIANGLE_FAN:
-		GL.DrawElements(GL_TRIANGLE_FAN, primitiveCount + 2, indexSize, indexList);
+		mode = GL_TRIANGLE_FAN;
+		count = primitiveCount + 2;
 		break;
 	case scene::EPT_TRIANGLES:
-		GL.DrawElements(GL_TRIANGLES, primitiveCount * 3, indexSize, indexList);
+		mode = GL_TRIANGLES;
+		count = primitiveCount * 3;
 		break;
 	default:
+		return;
+	}
+
+	GLenum indexSize = 0;
+	size_t indexBytes = 0;
+	switch (iType) {
+	case EIT_16BIT:
+		indexSize = GL_UNSIGNED_SHORT;
+		indexBytes = sizeof(u16);
+		break;
+	case EIT_32BIT:
+		indexSize = GL_UNSIGNED_INT;
+		indexBytes = sizeof(u32);
 		break;
 	}
 
+	// Non-null pointers refer to client memory, see drawBuffersInstanced()
+	auto &vTypeDesc = BoundVertexType ? *BoundVertexType : getVertexTypeDescription(vType);
+	uintptr_t verticesBase = vertices ? reinterpret_cast<uintptr_t>(vertices) : BoundVertexOffset;
+	const bool streamedVertices = streamData(StreamVertexBuffer, vertices,
+		vertexCount * vTypeDesc.VertexSize, verticesBase);
+	uintptr_t indicesBase = indexList ? reinterpret_cast<uintptr_t>(indexList) : BoundIndexOffset;
+	const bool streamedIndices = mode != GL_POINTS &&
+		streamData(StreamIndexBuffer, indexList, count * indexBytes, indicesBase);
+	const void *indices = reinterpret_cast<const void *>(indicesBase);
+
+	beginDraw(vTypeDesc, verticesBase);
+
+	if (mode == GL_POINTS) {
+		if (instanceCount > 1)
+			GL.DrawArraysInstanced(mode, 0, count, instanceCount);
+		else
+			GL.DrawArrays(mode, 0, count);
+	} else {
+		if (instanceCount > 1)
+			GL.DrawElementsInstanced(mode, count, indexSize, indices, instanceCount);
+		else
+			GL.DrawElements(mode, count, indexSize, indices);
+	}
+
 	endDraw(vTypeDesc);
+
+	if (streamedVertices)
+		GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+	if (streamedIndices)
+		GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void COpenGL3DriverBase::beginDraw(const VertexType &vertexType, uintptr_t verticesBase)
@@ -1644,6 +1969,21 @@ s32 COpenGL3DriverBase::addHighLevelShaderMaterial(
 	return nr;
 }
 
+void COpenGL3DriverBase::setShaderBinaryCache(IShaderBinaryCache *cache)
+{
+	if (cache) {
+		// drivers may support the functions, but no binary format
+		GLint formats = 0;
+		if (GL.GetProgramBinary && GL.ProgramBinary)
+			GL.GetIntegerv(GL.NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats <= 0) {
+			os::Printer::log("Shader program binaries are not supported", ELL_INFORMATION);
+			cache = nullptr;
+		}
+	}
+	ShaderBinaryCache = cache;
+}
+
 //! Returns a pointer to the IVideoDriver interface. (Implementation for
 //! IMaterialRendererServices)
 IVideoDriver *COpenGL3DriverBase::getVideoDriver()
@@ -9,6 +9,8 @@
 #include "SIrrCreationParameters.h"
 #include "Common.h"
 #include "VBO.h"
+#include "StreamBuffer.h"
+#include "BufferArena.h"
 #include "CNullDriver.h"
 #include "IMaterialRendererServices.h"
 #include "EDriverFeatures.h"
@@ -49,10 +51,28 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 		SHWBufferLink_opengl(const scene::IIndexBuffer *ib) : SHWBufferLink(ib) {}
 
 		OpenGLVBO Vbo;
+		//! vertices are stored as S3DVertexPacked, see updateVertexHardwareBuffer()
+		bool Packed = false;
+
+		//! If set, the data lives in this arena instead of Vbo
+		OpenGLBufferArena *Arena = nullptr;
+		//! Position in the arena, in elements
+		size_t ArenaOffset = 0;
+		size_t ArenaCount = 0;
+
+		bool exists() const { return Arena || Vbo.exists(); }
+		GLuint getName() const { return Arena ? Arena->getName() : Vbo.getName(); }
+		uintptr_t getByteOffset() const
+		{
+			return Arena ? ArenaOffset * Arena->getElementSize() : 0;
+		}
 	};
 
 	bool updateVertexHardwareBuffer(SHWBufferLink_opengl *HWBuffer);
 	bool updateIndexHardwareBuffer(SHWBufferLink_opengl *HWBuffer);
+	bool uploadToArena(SHWBufferLink_opengl *HWBuffer, OpenGLBufferArena &arena,
+		const void *data, size_t count);
+	void releaseFromArena(SHWBufferLink_opengl *HWBuffer);
 
 	//! updates hardware buffer if needed
 	bool updateHardwareBuffer(SHWBufferLink *HWBuffer) override;
@@ -70,6 +90,11 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 		const scene::IIndexBuffer *ib, u32 primCount,
 		scene::E_PRIMITIVE_TYPE pType = scene::EPT_TRIANGLES) override;
 
+	void drawMeshBufferInstanced(const scene::IMeshBuffer *mb,
+			const SDrawInstances &instances) override;
+
+	void drawMeshBufferBatch(const SDrawBatch &batch) override;
+
 	IRenderTarget *addRenderTarget() override;
 
 	void blitRenderTarget(IRenderTarget *from, IRenderTarget *to) override;
@@ -200,6 +225,11 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 	//! Returns pointer to the IGPUProgrammingServices interface.
 	IGPUProgrammingServices *getGPUProgrammingServices() override;
 
+	void setShaderBinaryCache(IShaderBinaryCache *cache) override;
+
+	//! Returns the shader binary cache, if program binaries are supported
+	IShaderBinaryCache *getShaderBinaryCache() const { return ShaderBinaryCache; }
+
 	//! Returns a pointer to the IVideoDriver interface.
 	IVideoDriver *getVideoDriver() override;
 
@@ -308,8 +338,25 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 	void drawElements(GLenum primitiveType, const VertexType &vertexType, const void *vertices, int vertexCount, const u16 *indices, int indexCount);
 	void drawElements(GLenum primitiveType, const VertexType &vertexType, uintptr_t vertices, uintptr_t indices, int indexCount);
 
-	void drawGeneric(const void *vertices, const void *indexList, u32 primitiveCount,
-		E_VERTEX_TYPE vType, scene::E_PRIMITIVE_TYPE pType, E_INDEX_TYPE iType);
+	void drawGeneric(const void *vertices, u32 vertexCount,
+		const void *indexList, u32 primitiveCount,
+		E_VERTEX_TYPE vType, scene::E_PRIMITIVE_TYPE pType, E_INDEX_TYPE iType,
+		u32 instanceCount = 1);
+
+	//! Copies client-side data to a stream buffer, which is left bound.
+	//! @param base replaced by the offset in the buffer on success
+	//! @return whether the data was copied
+	static bool streamData(OpenGLStreamBuffer &buffer, const void *data,
+		size_t size, uintptr_t &base);
+
+	//! Binds the hardware buffers, if there are any, and draws
+	void drawBuffersInstanced(const scene::IVertexBuffer *vb,
+		const scene::IIndexBuffer *ib, u32 primCount,
+		scene::E_PRIMITIVE_TYPE pType, u32 instanceCount);
+
+	//! Draws batch buffers that are all in the arenas with one call
+	//! @return false if the draw data could not be streamed
+	bool drawBatchIndirect(const SDrawBatch &batch);
 
 	void beginDraw(const VertexType &vertexType, uintptr_t verticesBase);
 	void endDraw(const VertexType &vertexType);
@@ -363,6 +410,8 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 
 	IContextManager *ContextManager;
 
+	IShaderBinaryCache *ShaderBinaryCache = nullptr;
+
 	void printTextureFormats();
 
 	bool EnableErrorTest;
@@ -370,6 +419,22 @@ class COpenGL3DriverBase : public CNullDriver, public IMaterialRendererServices,
 	OpenGLVBO QuadIndexVBO;
 	void initQuadsIndices(u32 max_vertex_count = 65536);
 
+	//! Receive client-side vertex and index arrays before drawing
+	OpenGLStreamBuffer StreamVertexBuffer;
+	OpenGLStreamBuffer StreamIndexBuffer;
+
+	//! Layout of the bound hardware vertex buffer, if it differs from its type
+	const VertexType *BoundVertexType = nullptr;
+	//! Byte offsets of the data in the bound hardware buffers
+	uintptr_t BoundVertexOffset = 0;
+	uintptr_t BoundIndexOffset = 0;
+
+	//! Static map-like buffers share these with multi-draw indirect
+	OpenGLBufferArena VertexArena;
+	OpenGLBufferArena IndexArena;
+	//! Receives the draw commands of drawBatchIndirect()
+	OpenGLStreamBuffer StreamIndirectBuffer;
+
 	void debugCb(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message);
 	static void APIENTRY debugCb(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam);
 };
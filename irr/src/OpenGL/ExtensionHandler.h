@@ -76,6 +76,8 @@ class COpenGL3ExtensionHandler : public COGLESCoreExtensionHandler
 			return TextureMultisampleSupported;
 		case EVDF_TEXTURE_2D_ARRAY:
 			return Texture2DArraySupported;
+		case EVDF_DRAW_INSTANCED:
+			return DrawInstancedSupported;
 		default:
 			return false;
 		};
@@ -177,7 +179,10 @@ class COpenGL3ExtensionHandler : public COGLESCoreExtensionHandler
 	bool BlendMinMaxSupported = false;
 	bool TextureMultisampleSupported = false;
 	bool Texture2DArraySupported = false;
+	bool DrawInstancedSupported = false;
 	bool KHRDebugSupported = false;
+	bool BufferStorageSupported = false;
+	bool MultiDrawIndirectSupported = false;
 	u32 MaxLabelLength = 0;
 };
 
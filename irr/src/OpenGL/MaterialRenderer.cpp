@@ -6,6 +6,7 @@
 
 #include "EVertexAttributes.h"
 #include "IGPUProgrammingServices.h"
+#include "IShaderBinaryCache.h"
 #include "IShaderConstantSetCallBack.h"
 #include "IVideoDriver.h"
 #include "os.h"
@@ -107,19 +108,31 @@ void COpenGL3MaterialRenderer::init(s32 &outMaterialTypeNr,
 	if (!Program)
 		return;
 
-	if (vertexShaderProgram)
-		if (!createShader(GL_VERTEX_SHADER, vertexShaderProgram))
-			return;
+	IShaderBinaryCache *cache = Driver->getShaderBinaryCache();
+	const std::string vs = vertexShaderProgram ? vertexShaderProgram : "";
+	const std::string ps = pixelShaderProgram ? pixelShaderProgram : "";
 
-	if (pixelShaderProgram)
-		if (!createShader(GL_FRAGMENT_SHADER, pixelShaderProgram))
-			return;
+	if (!cache || !loadBinary(cache, vs, ps)) {
+		if (vertexShaderProgram)
+			if (!createShader(GL_VERTEX_SHADER, vertexShaderProgram))
+				return;
 
-	for (size_t i = 0; i < EVA_COUNT; ++i)
-		GL.BindAttribLocation(Program, i, sBuiltInVertexAttributeNames[i]);
+		if (pixelShaderProgram)
+			if (!createShader(GL_FRAGMENT_SHADER, pixelShaderProgram))
+				return;
 
-	if (!linkProgram())
-		return;
+		for (size_t i = 0; i < EVA_COUNT; ++i)
+			GL.BindAttribLocation(Program, i, sBuiltInVertexAttributeNames[i]);
+
+		if (cache && GL.ProgramParameteri)
+			GL.ProgramParameteri(Program, GL.PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		if (!linkProgram())
+			return;
+
+		if (cache)
+			storeBinary(cache, vs, ps);
+	}
 
 	if (debugName)
 		Driver->irrGlObjectLabel(GL_PROGRAM, Program, debugName);
@@ -243,6 +256,15 @@ bool COpenGL3MaterialRenderer::linkProgram()
 			return false;
 		}
 
+		return queryUniforms();
+	}
+
+	return true;
+}
+
+bool COpenGL3MaterialRenderer::queryUniforms()
+{
+	if (Program) {
 		GLint num = 0;
 
 		GL.GetProgramiv(Program, GL_ACTIVE_UNIFORMS, &num);
@@ -290,6 +312,48 @@ bool COpenGL3MaterialRenderer::linkProgram()
 	return true;
 }
 
+bool COpenGL3MaterialRenderer::loadBinary(IShaderBinaryCache *cache,
+		const std::string &vs, const std::string &ps)
+{
+	u32 format;
+	std::string binary;
+	if (!cache->loadProgram(vs, ps, format, binary))
+		return false;
+
+	GL.ProgramBinary(Program, format, binary.data(), binary.size());
+
+	GLint status = 0;
+	GL.GetProgramiv(Program, GL_LINK_STATUS, &status);
+	if (status && queryUniforms())
+		return true;
+
+	// e.g. the driver was updated, compile it from the sources instead
+	os::Printer::log("GLSL program binary was rejected", ELL_INFORMATION);
+	cache->rejectProgram(vs, ps);
+	GL.DeleteProgram(Program);
+	Program = GL.CreateProgram();
+	UniformInfo.clear();
+	return false;
+}
+
+void COpenGL3MaterialRenderer::storeBinary(IShaderBinaryCache *cache,
+		const std::string &vs, const std::string &ps)
+{
+	GLint length = 0;
+	GL.GetProgramiv(Program, GL.PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::string binary(length, '\0');
+	GLenum format = 0;
+	GLsizei written = 0;
+	GL.GetProgramBinary(Program, length, &written, &format, binary.data());
+	if (written <= 0)
+		return;
+	binary.resize(written);
+	cache->storeProgram(vs, ps, format, binary);
+}
+
 void COpenGL3MaterialRenderer::setBasicRenderStates(const SMaterial &material,
 		const SMaterial &lastMaterial,
 		bool resetAllRenderstates)
@@ -71,6 +71,11 @@ class COpenGL3MaterialRenderer : public IMaterialRenderer, public IMaterialRende
 
 	bool createShader(GLenum shaderType, const char *shader);
 	bool linkProgram();
+	bool queryUniforms();
+
+	//! Loads the program from the binary cache, if it is there
+	bool loadBinary(IShaderBinaryCache *cache, const std::string &vs, const std::string &ps);
+	void storeBinary(IShaderBinaryCache *cache, const std::string &vs, const std::string &ps);
 
 	COpenGL3DriverBase *Driver;
 	IShaderConstantSetCallBack *CallBack;
@@ -0,0 +1,105 @@
+// Copyright (C) 2026 Luanti contributors
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "StreamBuffer.h"
+
+#include <cstring>
+
+namespace video
+{
+
+void OpenGLStreamBuffer::init(GLenum target, size_t size, bool persistent)
+{
+	destroy();
+	m_target = target;
+
+	GL.GenBuffers(1, &m_name);
+	if (!m_name)
+		return;
+	GL.BindBuffer(m_target, m_name);
+
+	if (persistent) {
+		const GLbitfield flags = GL.MAP_WRITE_BIT | GL.MAP_PERSISTENT_BIT |
+			GL.MAP_COHERENT_BIT;
+		GL.BufferStorage(m_target, size, nullptr, flags);
+		m_mapped = static_cast<u8 *>(GL.MapBufferRange(m_target, 0, size, flags));
+		if (!m_mapped) {
+			// storage is immutable, start over with a new buffer
+			GL.DeleteBuffers(1, &m_name);
+			GL.GenBuffers(1, &m_name);
+			GL.BindBuffer(m_target, m_name);
+		}
+	}
+	if (!m_mapped)
+		GL.BufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+
+	GL.BindBuffer(m_target, 0);
+	m_size = size;
+	m_offset = 0;
+	m_segment = 0;
+}
+
+size_t OpenGLStreamBuffer::upload(const void *data, size_t size)
+{
+	const size_t segment_size = m_size / SEGMENT_COUNT;
+	if (!m_name || size == 0 || size > segment_size)
+		return npos;
+
+	size_t offset = (m_offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	GL.BindBuffer(m_target, m_name);
+
+	if (m_mapped) {
+		if (offset + size > (m_segment + 1) * segment_size) {
+			// Draws using the current segment have all been issued
+			m_fences[m_segment] = GL.FenceSync(GL.SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_segment = (m_segment + 1) % SEGMENT_COUNT;
+			offset = m_segment * segment_size;
+
+			// Wait until the GPU is done with the next one
+			if (GLsync fence = m_fences[m_segment]) {
+				GLenum res;
+				do {
+					res = GL.ClientWaitSync(fence, GL.SYNC_FLUSH_COMMANDS_BIT,
+						1000000000ULL);
+				} while (res == GL.TIMEOUT_EXPIRED);
+				GL.DeleteSync(fence);
+				m_fences[m_segment] = nullptr;
+			}
+		}
+		memcpy(m_mapped + offset, data, size);
+	} else {
+		if (offset + size > m_size) {
+			// Let the driver hand out fresh memory instead of
+			// waiting for the GPU to finish with the old one
+			GL.BufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+			offset = 0;
+		}
+		GL.BufferSubData(m_target, offset, size, data);
+	}
+
+	m_offset = offset + size;
+	return offset;
+}
+
+void OpenGLStreamBuffer::destroy()
+{
+	for (GLsync &fence : m_fences) {
+		if (fence)
+			GL.DeleteSync(fence);
+		fence = nullptr;
+	}
+	if (m_name) {
+		if (m_mapped) {
+			GL.BindBuffer(m_target, m_name);
+			GL.UnmapBuffer(m_target);
+			GL.BindBuffer(m_target, 0);
+		}
+		GL.DeleteBuffers(1, &m_name);
+	}
+	m_name = 0;
+	m_size = 0;
+	m_mapped = nullptr;
+}
+
+}
@@ -0,0 +1,75 @@
+// Copyright (C) 2026 Luanti contributors
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#pragma once
+
+#include "Common.h"
+#include <mt_opengl.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace video
+{
+
+/**
+ * Ring buffer for data that is used for a single draw, e.g. client-side
+ * vertex arrays.
+ *
+ * With persistent mapping the buffer is split into segments that are only
+ * written again once a fence says the GPU is done with them. Otherwise
+ * the buffer is orphaned whenever it is full.
+ */
+class OpenGLStreamBuffer
+{
+public:
+	static constexpr size_t npos = SIZE_MAX;
+
+	/// @note does not create on GL side
+	OpenGLStreamBuffer() = default;
+	/// @note does not free on GL side
+	~OpenGLStreamBuffer() = default;
+
+	/// @return does this refer to an existing GL buffer?
+	bool exists() const { return m_name != 0; }
+
+	/// @return is the buffer persistently mapped?
+	bool isPersistent() const { return m_mapped != nullptr; }
+
+	/**
+	 * Create buffer in GL.
+	 * @param target buffer target, e.g. GL_ARRAY_BUFFER
+	 * @param size size of the whole buffer in bytes
+	 * @param persistent use a persistent mapping (needs buffer storage and sync objects)
+	 */
+	void init(GLenum target, size_t size, bool persistent);
+
+	/**
+	 * Append data to the buffer.
+	 * @note leaves the buffer bound to its target on success
+	 * @return offset of the data in the buffer, or `npos` if it does not fit
+	 */
+	size_t upload(const void *data, size_t size);
+
+	/**
+	 * Free buffer in GL.
+	 * @note modifies the binding of the target
+	 */
+	void destroy();
+
+private:
+	static constexpr u32 SEGMENT_COUNT = 3;
+	static constexpr size_t ALIGNMENT = 16;
+
+	GLenum m_target = 0;
+	GLuint m_name = 0;
+	size_t m_size = 0;
+	size_t m_offset = 0;
+
+	// Only used with persistent mapping
+	u8 *m_mapped = nullptr;
+	u32 m_segment = 0;
+	GLsync m_fences[SEGMENT_COUNT] = {};
+};
+
+}
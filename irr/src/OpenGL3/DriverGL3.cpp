@@ -70,7 +70,12 @@ void COpenGL3Driver::initFeatures()
 	BlendMinMaxSupported = true;
 	TextureMultisampleSupported = true;
 	Texture2DArraySupported = Version.Major >= 3 || queryExtension("GL_EXT_texture_array");
+	DrawInstancedSupported = true;
 	KHRDebugSupported = isVersionAtLeast(4, 6) || queryExtension("GL_KHR_debug");
+	BufferStorageSupported = isVersionAtLeast(4, 4) || queryExtension("GL_ARB_buffer_storage");
+	// baseInstance in the draw commands is what picks the offset of each draw
+	MultiDrawIndirectSupported = isVersionAtLeast(4, 3) ||
+		(queryExtension("GL_ARB_multi_draw_indirect") && queryExtension("GL_ARB_base_instance"));
 	if (KHRDebugSupported)
 		MaxLabelLength = GetInteger(GL.MAX_LABEL_LENGTH);
 
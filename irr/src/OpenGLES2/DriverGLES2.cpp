@@ -124,6 +124,10 @@ void COpenGLES2Driver::initFeatures()
 	TextureMultisampleSupported = isVersionAtLeast(3, 1);
 	Texture2DArraySupported = Version.Major >= 3 || queryExtension("GL_EXT_texture_array");
 	KHRDebugSupported = queryExtension("GL_KHR_debug");
+	// sync objects are needed too, which ES2 lacks
+	BufferStorageSupported = Version.Major >= 3 && queryExtension("GL_EXT_buffer_storage");
+	MultiDrawIndirectSupported = isVersionAtLeast(3, 1) &&
+		queryExtension("GL_EXT_multi_draw_indirect") && queryExtension("GL_EXT_base_instance");
 	if (KHRDebugSupported)
 		MaxLabelLength = GetInteger(GL.MAX_LABEL_LENGTH);
 
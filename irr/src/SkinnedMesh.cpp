@@ -32,6 +32,8 @@ SkinnedMesh::~SkinnedMesh()
 		if (buffer)
 			buffer->drop();
 	}
+
+	dropHardwareSkinningBuffers();
 }
 
 f32 SkinnedMesh::getMaxFrameNumber() const
@@ -92,12 +94,8 @@ core::aabbox3df SkinnedMesh::calculateBoundingBox(
 
 // Software Skinning
 
-void SkinnedMesh::skinMesh(const std::vector<core::matrix4> &global_matrices)
+void SkinnedMesh::updateRigidTransforms(const std::vector<core::matrix4> &global_matrices)
 {
-	if (!HasAnimation)
-		return;
-
-	// rigid animation
 	for (size_t i = 0; i < AllJoints.size(); ++i) {
 		auto *joint = AllJoints[i];
 		for (u32 attachedMeshIdx : joint->AttachedMeshes) {
@@ -105,6 +103,15 @@ void SkinnedMesh::skinMesh(const std::vector<core::matrix4> &global_matrices)
 			Buffer->Transformation = global_matrices[i];
 		}
 	}
+}
+
+void SkinnedMesh::skinMesh(const std::vector<core::matrix4> &global_matrices)
+{
+	if (!HasAnimation)
+		return;
+
+	// rigid animation
+	updateRigidTransforms(global_matrices);
 
 	// clear skinning helper array
 	for (std::vector<char> &buf : Vertices_Moved)
@@ -158,6 +165,86 @@ void SkinnedMesh::skinMesh(const std::vector<core::matrix4> &global_matrices)
 		buffer->setDirty(EBT_VERTEX);
 }
 
+// Hardware Skinning
+
+const std::vector<SMeshBufferSkinned *> *SkinnedMesh::getHardwareSkinningBuffers()
+{
+	if (AllJoints.size() > MAX_HARDWARE_JOINTS)
+		return nullptr;
+	if (!HardwareSkinningBuffers.empty() || LocalBuffers.empty())
+		return &HardwareSkinningBuffers;
+
+	HardwareSkinningBuffers.reserve(LocalBuffers.size());
+	for (auto *local : LocalBuffers) {
+		auto *buffer = new SMeshBufferSkinned();
+		auto &vertices = buffer->Vertices->Data;
+		vertices.reserve(local->getVertexCount());
+		for (u32 i = 0; i < local->getVertexCount(); ++i)
+			vertices.emplace_back(*local->getVertex(i));
+		buffer->Indices->Data = local->Indices->Data;
+		buffer->setPrimitiveType(local->getPrimitiveType());
+		buffer->Material = local->Material;
+		buffer->BoundingBox = local->BoundingBox;
+		buffer->setHardwareMappingHint(EHM_STATIC);
+		HardwareSkinningBuffers.push_back(buffer);
+	}
+
+	// Keep the strongest four weights of each vertex. They are normalized
+	// again, since the others were cut off.
+	for (u16 j = 0; j < AllJoints.size(); ++j) {
+		for (const auto &weight : AllJoints[j]->Weights) {
+			auto &vertex = HardwareSkinningBuffers[weight.buffer_id]->Vertices->Data[weight.vertex_id];
+			vertex.Pos = weight.StaticPos;
+			vertex.Normal = weight.StaticNormal;
+			u32 weakest = 0;
+			for (u32 k = 1; k < 4; ++k) {
+				if (vertex.Weights[k] < vertex.Weights[weakest])
+					weakest = k;
+			}
+			if (weight.strength > vertex.Weights[weakest]) {
+				vertex.JointIDs[weakest] = j;
+				vertex.Weights[weakest] = weight.strength;
+			}
+		}
+	}
+	for (auto *buffer : HardwareSkinningBuffers) {
+		for (auto &vertex : buffer->Vertices->Data) {
+			const f32 total = vertex.Weights[0] + vertex.Weights[1] +
+					vertex.Weights[2] + vertex.Weights[3];
+			if (total != 0 && total != 1) {
+				for (f32 &weight : vertex.Weights)
+					weight /= total;
+			}
+		}
+	}
+
+	return &HardwareSkinningBuffers;
+}
+
+void SkinnedMesh::getSkinningMatrices(const std::vector<core::matrix4> &global_matrices,
+		std::vector<core::matrix4> &skinning_matrices)
+{
+	assert(global_matrices.size() == AllJoints.size());
+	updateRigidTransforms(global_matrices);
+
+	skinning_matrices.resize(AllJoints.size());
+	for (size_t i = 0; i < AllJoints.size(); ++i) {
+		auto *joint = AllJoints[i];
+		// joints without weights aren't used by any vertex
+		if (joint->Weights.empty())
+			skinning_matrices[i].makeIdentity();
+		else
+			skinning_matrices[i] = global_matrices[i] * joint->GlobalInversedMatrix.value();
+	}
+}
+
+void SkinnedMesh::dropHardwareSkinningBuffers()
+{
+	for (auto *buffer : HardwareSkinningBuffers)
+		buffer->drop();
+	HardwareSkinningBuffers.clear();
+}
+
 //! Gets joint count.
 u32 SkinnedMesh::getJointCount() const
 {
@@ -232,6 +319,8 @@ void SkinnedMesh::setDirty(E_BUFFER_TYPE buffer)
 {
 	for (u32 i = 0; i < LocalBuffers.size(); ++i)
 		LocalBuffers[i]->setDirty(buffer);
+	// made again from the changed buffers when needed
+	dropHardwareSkinningBuffers();
 }
 
 void SkinnedMesh::refreshJointCache()
@@ -31,14 +31,25 @@ enum ActiveObjectType {
 
 struct ActiveObjectMessage
 {
-	ActiveObjectMessage(u16 id_, bool reliable_=true, std::string_view data_ = "") :
+	enum Priority : u8 {
+		// Sent to every client right away
+		PRIO_IMMEDIATE,
+		// Carries the whole current state of something, so clients that
+		// are less interested in the object may skip some of them
+		PRIO_STATE,
+	};
+
+	ActiveObjectMessage(u16 id_, bool reliable_=true, std::string_view data_ = "",
+			Priority priority_ = PRIO_IMMEDIATE) :
 		id(id_),
 		reliable(reliable_),
+		priority(priority_),
 		datastring(data_)
 	{}
 
 	u16 id;
 	bool reliable;
+	Priority priority;
 	std::string datastring;
 };
 
@@ -48,12 +48,14 @@ inline void fill(server::ActiveObjectMgr &mgr, size_t n)
 	}
 }
 
+using IndexType = server::ActiveObjectMgr::SpatialIndexType;
+
 }
 
-template <size_t N>
+template <size_t N, IndexType T>
 void benchGetObjectsInsideRadius(Catch::Benchmark::Chronometer &meter)
 {
-	server::ActiveObjectMgr mgr;
+	server::ActiveObjectMgr mgr(T);
 	size_t x;
 	std::vector<ServerActiveObject*> result;
 
@@ -72,10 +74,10 @@ void benchGetObjectsInsideRadius(Catch::Benchmark::Chronometer &meter)
 	mgr.clear(); // implementation expects this
 }
 
-template <size_t N>
+template <size_t N, IndexType T>
 void benchGetObjectsInArea(Catch::Benchmark::Chronometer &meter)
 {
-	server::ActiveObjectMgr mgr;
+	server::ActiveObjectMgr mgr(T);
 	size_t x;
 	std::vector<ServerActiveObject*> result;
 
@@ -97,22 +99,51 @@ void benchGetObjectsInArea(Catch::Benchmark::Chronometer &meter)
 	mgr.clear(); // implementation expects this
 }
 
-#define BENCH_INSIDE_RADIUS(_count) \
-	BENCHMARK_ADVANCED("inside_radius_" #_count)(Catch::Benchmark::Chronometer meter) \
-	{ benchGetObjectsInsideRadius<_count>(meter); };
-
-#define BENCH_IN_AREA(_count) \
-	BENCHMARK_ADVANCED("in_area_" #_count)(Catch::Benchmark::Chronometer meter) \
-	{ benchGetObjectsInArea<_count>(meter); };
+// Moves every object a bit, like walking entities do in a step
+template <size_t N, IndexType T>
+void benchUpdateObjectPos(Catch::Benchmark::Chronometer &meter)
+{
+	server::ActiveObjectMgr mgr(T);
+	std::vector<std::pair<u16, v3f>> objects;
+	for (size_t i = 0; i < N; i++) {
+		auto obj = std::make_unique<TestObject>(randpos());
+		ServerActiveObject *ptr = obj.get();
+		REQUIRE(mgr.registerObject(std::move(obj)));
+		objects.emplace_back(ptr->getId(), ptr->getBasePosition());
+	}
 
-TEST_CASE("ActiveObjectMgr") {
-	BENCH_INSIDE_RADIUS(200)
-	BENCH_INSIDE_RADIUS(1450)
-	BENCH_INSIDE_RADIUS(10000)
+	meter.measure([&] {
+		for (auto &it : objects) {
+			it.second += v3f(myrand_range(-5, 5), 0, myrand_range(-5, 5));
+			mgr.updateObjectPos(it.first, it.second);
+		}
+		return objects.size();
+	});
 
-	BENCH_IN_AREA(200)
-	BENCH_IN_AREA(1450)
-	BENCH_IN_AREA(10000)
+	mgr.clear(); // implementation expects this
 }
 
-// TODO benchmark active object manager update costs
+#define BENCH_INDEX(_name, _type) \
+	BENCHMARK_ADVANCED("inside_radius_200_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInsideRadius<200, _type>(meter); }; \
+	BENCHMARK_ADVANCED("inside_radius_1450_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInsideRadius<1450, _type>(meter); }; \
+	BENCHMARK_ADVANCED("inside_radius_10000_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInsideRadius<10000, _type>(meter); }; \
+	BENCHMARK_ADVANCED("in_area_200_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInArea<200, _type>(meter); }; \
+	BENCHMARK_ADVANCED("in_area_1450_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInArea<1450, _type>(meter); }; \
+	BENCHMARK_ADVANCED("in_area_10000_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchGetObjectsInArea<10000, _type>(meter); }; \
+	BENCHMARK_ADVANCED("update_pos_200_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchUpdateObjectPos<200, _type>(meter); }; \
+	BENCHMARK_ADVANCED("update_pos_1450_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchUpdateObjectPos<1450, _type>(meter); }; \
+	BENCHMARK_ADVANCED("update_pos_10000_" _name)(Catch::Benchmark::Chronometer meter) \
+	{ benchUpdateObjectPos<10000, _type>(meter); };
+
+TEST_CASE("ActiveObjectMgr") {
+	BENCH_INDEX("kdtree", server::ActiveObjectMgr::SPATIAL_INDEX_KD_TREE)
+	BENCH_INDEX("grid", server::ActiveObjectMgr::SPATIAL_INDEX_GRID)
+}
@@ -57,6 +57,54 @@ TEST_CASE("benchmark_lighting")
 		});
 	};
 
+	// Like a mass set_node() from a mod: many nodes change at once and
+	// the lighting is updated in one call.
+	BENCHMARK_ADVANCED("voxalgo::update_lighting_nodes bulk")(Catch::Benchmark::Chronometer meter) {
+		std::map<v3s16, MapBlock*> modified_blocks;
+		std::vector<std::pair<v3s16, MapNode>> oldnodes;
+		auto set_cube = [&] (MapNode n) {
+			oldnodes.clear();
+			for (s16 z = -5; z <= 4; z++)
+			for (s16 y = -8; y <= 0; y++)
+			for (s16 x = -5; x <= 4; x++) {
+				v3s16 p(x, y, z);
+				oldnodes.emplace_back(p, map.getNode(p));
+				map.setNode(p, n);
+			}
+			voxalgo::update_lighting_nodes(&map, oldnodes, modified_blocks);
+		};
+		meter.measure([&] {
+			set_cube(MapNode(content_wall));
+			set_cube(MapNode(CONTENT_AIR));
+		});
+	};
+
+	// Digging a tunnel next to a light inside solid stone
+	DummyMap cave(&gamedef, bpmin, bpmax);
+	cave.fill(bpmin, bpmax, MapNode(content_wall));
+	{
+		std::map<v3s16, MapBlock*> modified_blocks;
+		cave.addNodeAndUpdate(v3s16(-12, 0, 0), MapNode(content_light), modified_blocks);
+	}
+
+	BENCHMARK_ADVANCED("voxalgo::update_lighting_nodes cave")(Catch::Benchmark::Chronometer meter) {
+		std::map<v3s16, MapBlock*> modified_blocks;
+		std::vector<std::pair<v3s16, MapNode>> oldnodes;
+		meter.measure([&] {
+			oldnodes.clear();
+			for (s16 x = -11; x <= 12; x++)
+			for (s16 y = 0; y <= 1; y++) {
+				v3s16 p(x, y, 0);
+				cave.removeNodeAndUpdate(p, modified_blocks);
+				oldnodes.emplace_back(p, cave.getNode(p));
+			}
+			// Fill it again at once
+			for (auto &it : oldnodes)
+				cave.setNode(it.first, MapNode(content_wall));
+			voxalgo::update_lighting_nodes(&cave, oldnodes, modified_blocks);
+		});
+	};
+
 	BENCHMARK_ADVANCED("voxalgo::blit_back_with_light")(Catch::Benchmark::Chronometer meter) {
 		std::map<v3s16, MapBlock*> modified_blocks;
 		MMVManip vm(&map);
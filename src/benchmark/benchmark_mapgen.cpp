@@ -0,0 +1,270 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "dummymap.h"
+#include "emerge.h"
+#include "map_settings_manager.h"
+#include "mapgen/cavegen.h"
+#include "mapgen/dungeongen.h"
+#include "mapgen/mapgen.h"
+#include "mapgen/mg_biome.h"
+#include "nodedef.h"
+#include "server.h"
+#include "settings.h"
+#include "util/metricsbackend.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Chunks of the default size, in blocks
+static constexpr s16 CHUNK_SIZE = 5;
+// deep enough for caves and dungeons in every mapgen
+static const v3s16 CHUNK_UNDERGROUND(-2, -12, -2);
+// around water level
+static const v3s16 CHUNK_SURFACE(-2, -2, -2);
+
+static const char *const MAPGEN_NAMES[] = {
+	"v5", "v6", "v7", "flat", "fractal", "carpathian", "valleys"
+};
+
+static void register_mapgen_nodes(NodeDefManager *ndef)
+{
+	static const char *const ground[] = {
+		"mapgen_stone", "mapgen_desert_stone", "mapgen_dirt",
+		"mapgen_dirt_with_grass", "mapgen_dirt_with_snow", "mapgen_sand",
+		"mapgen_desert_sand", "mapgen_gravel", "mapgen_snowblock", "mapgen_ice",
+	};
+	static const char *const solid[] = {
+		"mapgen_cobble", "mapgen_mossycobble", "mapgen_stair_cobble",
+		"mapgen_stair_desert_stone", "mapgen_tree", "mapgen_jungletree",
+		"mapgen_pine_tree",
+	};
+	static const char *const translucent[] = {
+		"mapgen_leaves", "mapgen_jungleleaves", "mapgen_pine_needles",
+		"mapgen_apple", "mapgen_junglegrass", "mapgen_snow",
+	};
+	static const char *const liquids[] = {
+		"mapgen_water_source", "mapgen_river_water_source", "mapgen_lava_source",
+	};
+
+	for (const char *name : ground) {
+		ContentFeatures f;
+		f.name = name;
+		f.is_ground_content = true;
+		ndef->set(f.name, f);
+	}
+	for (const char *name : solid) {
+		ContentFeatures f;
+		f.name = name;
+		ndef->set(f.name, f);
+	}
+	for (const char *name : translucent) {
+		ContentFeatures f;
+		f.name = name;
+		f.light_propagates = true;
+		f.sunlight_propagates = true;
+		ndef->set(f.name, f);
+	}
+	for (const char *name : liquids) {
+		ContentFeatures f;
+		f.name = name;
+		f.drawtype = NDT_LIQUID;
+		f.liquid_type = LIQUID_SOURCE;
+		f.liquid_alternative_source = name;
+		f.light_propagates = true;
+		f.walkable = false;
+		ndef->set(f.name, f);
+	}
+
+	ndef->setNodeRegistrationStatus(true);
+	ndef->runNodeResolveCallbacks();
+}
+
+/*
+	Runs a mapgen the way an emerge thread would, without a map or a world.
+*/
+class MapgenBenchmark
+{
+public:
+	MapgenBenchmark(const std::string &mg_name) :
+		m_server("fakepath", SubgameSpec("fakespec", "fakespec"), true,
+			Address(), true, nullptr),
+		m_map_settings("")
+	{
+		register_mapgen_nodes(m_server.getWritableNodeDefManager());
+		m_map_settings.setMapSetting("mg_name", mg_name, true);
+		m_map_settings.setMapSetting("seed", "1337", true);
+
+		// every run would take the 2D noises from the column cache otherwise
+		const std::string cache_size = g_settings->get("mapgen_column_cache_size");
+		g_settings->set("mapgen_column_cache_size", "0");
+		m_emerge = std::make_unique<EmergeManager>(&m_server, &m_metrics);
+		g_settings->set("mapgen_column_cache_size", cache_size);
+
+		m_emerge->initMapgens(m_map_settings.makeMapgenParams());
+	}
+
+	Server *getServer() { return &m_server; }
+	Mapgen *getMapgen() { return m_emerge->m_mapgens.at(0); }
+
+private:
+	Server m_server;
+	MetricsBackend m_metrics;
+	MapSettingsManager m_map_settings;
+	std::unique_ptr<EmergeManager> m_emerge;
+};
+
+/*
+	A chunk and its overgeneration, filled with CONTENT_IGNORE like a chunk
+	that is about to be generated.
+*/
+struct BenchmarkChunk
+{
+	BenchmarkChunk(IGameDef *gamedef, v3s16 bpmin) :
+		map(gamedef, bpmin - 1, bpmin + CHUNK_SIZE)
+	{
+		data.seed = 1337;
+		data.blockpos_min = bpmin;
+		data.blockpos_max = bpmin + (CHUNK_SIZE - 1);
+		data.nodedef = gamedef->getNodeDefManager();
+		data.vmanip = new MMVManip(&map);
+		data.vmanip->initialEmerge(bpmin - 1, bpmin + CHUNK_SIZE, false);
+
+		node_min = data.blockpos_min * MAP_BLOCKSIZE;
+		node_max = (data.blockpos_max + 1) * MAP_BLOCKSIZE - v3s16(1, 1, 1);
+		full_node_min = (data.blockpos_min - 1) * MAP_BLOCKSIZE;
+		full_node_max = (data.blockpos_max + 2) * MAP_BLOCKSIZE - v3s16(1, 1, 1);
+	}
+
+	void fill(MapNode n)
+	{
+		MMVManip *vm = data.vmanip;
+		std::fill_n(vm->m_data, vm->m_area.getVolume(), n);
+	}
+
+	DummyMap map;
+	BlockMakeData data;
+	v3s16 node_min, node_max;
+	v3s16 full_node_min, full_node_max;
+};
+
+TEST_CASE("benchmark_cavegen")
+{
+	MapgenBenchmark mgb("v7");
+	Mapgen *mg = mgb.getMapgen();
+	const NodeDefManager *ndef = mg->ndef;
+	const MapNode n_stone(ndef->getId("mapgen_stone"));
+	const content_t c_water = ndef->getId("mapgen_water_source");
+	const content_t c_lava = ndef->getId("mapgen_lava_source");
+	const s32 seed = mg->seed;
+
+	BenchmarkChunk chunk(mgb.getServer(), CHUNK_UNDERGROUND);
+	MMVManip *vm = chunk.data.vmanip;
+	const v3s16 csize = chunk.node_max - chunk.node_min + 1;
+
+	// the surface is far above
+	std::vector<s16> heightmap(csize.X * csize.Z, 0);
+	BiomeGen *biomegen = mg->m_emerge->biomegen;
+	biomegen->calcBiomeNoise(chunk.node_min);
+	biome_t *biomemap = biomegen->getBiomes(heightmap.data(), chunk.node_min);
+
+	// included in all of the below
+	BENCHMARK("fill_chunk", i) {
+		chunk.fill(n_stone);
+		return vm->m_data[i % vm->m_area.getVolume()].getContent();
+	};
+
+	BENCHMARK("CavesRandomWalk", i) {
+		chunk.fill(n_stone);
+		PseudoRandom ps(21343 + i);
+		// like MapgenBasic with the default cave numbers
+		for (u32 j = 0; j < 4; j++) {
+			CavesRandomWalk cave(ndef, nullptr, seed, mg->water_level,
+				c_water, c_lava, 0.5f, biomegen);
+			cave.makeCave(vm, chunk.node_min, chunk.node_max, &ps, j >= 2,
+				chunk.node_max.Y, heightmap.data());
+		}
+		return vm->m_data[0].getContent();
+	};
+
+	NoiseParams np_cave1(0, 12, v3f(61, 61, 61), 52534, 3, 0.5, 2.0);
+	NoiseParams np_cave2(0, 12, v3f(67, 67, 67), 10325, 3, 0.5, 2.0);
+	BENCHMARK("CavesNoiseIntersection", i) {
+		chunk.fill(n_stone);
+		CavesNoiseIntersection caves_noise(ndef, mg->m_emerge->biomemgr,
+			biomegen, csize, &np_cave1, &np_cave2, seed, 0.09f);
+		caves_noise.generateCaves(vm, chunk.node_min, chunk.node_max, biomemap);
+		return vm->m_data[0].getContent();
+	};
+
+	NoiseParams np_cavern(0, 1, v3f(384, 128, 384), 723, 5, 0.63, 2.0);
+	BENCHMARK("CavernsNoise", i) {
+		chunk.fill(n_stone);
+		CavernsNoise caverns_noise(ndef, csize, &np_cavern, seed,
+			-256, 256, 0.7f);
+		return caverns_noise.generateCaverns(vm, chunk.node_min, chunk.node_max);
+	};
+
+	DungeonParams dp;
+	dp.seed                = seed;
+	dp.c_wall              = ndef->getId("mapgen_cobble");
+	dp.c_alt_wall          = ndef->getId("mapgen_mossycobble");
+	dp.c_stair             = ndef->getId("mapgen_stair_cobble");
+	dp.only_in_ground      = true;
+	dp.num_dungeons        = 2;
+	dp.notifytype          = GENNOTIFY_DUNGEON;
+	dp.num_rooms           = 8;
+	dp.room_size_min       = v3s16(5, 5, 5);
+	dp.room_size_max       = v3s16(12, 6, 12);
+	dp.room_size_large_min = v3s16(12, 6, 12);
+	dp.room_size_large_max = v3s16(16, 16, 16);
+	dp.large_room_chance   = 8;
+	dp.diagonal_dirs       = false;
+	dp.holesize            = v3s16(1, 3, 1);
+	dp.corridor_len_min    = 1;
+	dp.corridor_len_max    = 13;
+	dp.np_alt_wall =
+		NoiseParams(-0.4, 1.0, v3f(40.0, 40.0, 40.0), 32474, 6, 1.1, 2.0);
+
+	BENCHMARK("DungeonGen::generate", i) {
+		chunk.fill(n_stone);
+		DungeonGen dgen(ndef, nullptr, &dp);
+		dgen.generate(vm, 70033 + i, chunk.full_node_min, chunk.full_node_max);
+		return vm->m_data[0].getContent();
+	};
+}
+
+TEST_CASE("benchmark_mapgen")
+{
+	for (const char *mg_name : MAPGEN_NAMES) {
+		MapgenBenchmark mgb(mg_name);
+		Mapgen *mg = mgb.getMapgen();
+		const std::string prefix = std::string(mg_name) + "::";
+
+		// includes caves, dungeons, decorations and lighting
+		BenchmarkChunk underground(mgb.getServer(), CHUNK_UNDERGROUND);
+		BENCHMARK(prefix + "makeChunk_underground", i) {
+			underground.fill(MapNode(CONTENT_IGNORE));
+			mg->makeChunk(&underground.data);
+			return underground.data.vmanip->m_data[i % 100].getContent();
+		};
+
+		BenchmarkChunk surface(mgb.getServer(), CHUNK_SURFACE);
+		BENCHMARK(prefix + "makeChunk_surface", i) {
+			surface.fill(MapNode(CONTENT_IGNORE));
+			mg->makeChunk(&surface.data);
+			return surface.data.vmanip->m_data[i % 100].getContent();
+		};
+
+		// the lighting phase on its own, on the terrain generated above
+		BENCHMARK(prefix + "calcLighting_surface", i) {
+			mg->vm = surface.data.vmanip;
+			mg->calcLighting(surface.node_min - v3s16(0, 1, 0),
+				surface.node_max + v3s16(0, 1, 0),
+				surface.full_node_min, surface.full_node_max);
+			return surface.data.vmanip->m_data[i % 100].param1;
+		};
+	}
+}
@@ -0,0 +1,258 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "dummygamedef.h"
+#include "client/content_mapblock.h"
+#include "client/mapblock_mesh.h"
+#include "client/mesh.h"
+#include "client/meshgen/collector.h"
+#include "client/shader.h"
+#include "client/texturesource.h"
+#include "light.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "settings.h"
+#include <functional>
+
+namespace {
+
+// Knows no textures or shaders, every tile keeps its texture id
+class BenchmarkTextureSource : public ITextureSource
+{
+public:
+	video::ITexture *getTexture(const std::string &name, u32 *id) override
+	{
+		if (id)
+			*id = 0;
+		return nullptr;
+	}
+	u32 getTextureId(const std::string &name) override { return 0; }
+	std::string getTextureName(u32 id) override { return ""; }
+	video::ITexture *getTexture(u32 id) override { return nullptr; }
+	video::ITexture *getTextureForMesh(const std::string &name, u32 *id) override
+	{
+		return getTexture(name, id);
+	}
+	Palette *getPalette(const std::string &name) override { return nullptr; }
+	bool isKnownSourceImage(const std::string &name) override { return false; }
+	video::SColor getTextureAverageColor(const std::string &name) override
+	{
+		return video::SColor(0);
+	}
+	video::ITexture *getArrayTexture(const std::vector<u32> &ids) override
+	{
+		return nullptr;
+	}
+};
+
+class BenchmarkShaderSource : public IShaderSource
+{
+public:
+	const ShaderInfo &getShaderInfo(u32 id) override { return m_info; }
+	u32 getShader(const std::string &name, const ShaderConstants &input_const,
+			video::E_MATERIAL_TYPE base_mat) override
+	{
+		return 0;
+	}
+
+private:
+	ShaderInfo m_info;
+};
+
+struct MeshgenNodes
+{
+	content_t stone, dirt_with_grass, sand, tree, leaves, grass, mesh,
+		water_source, water_flowing;
+};
+
+content_t register_node(NodeDefManager *ndef, ContentFeatures f, u32 texture)
+{
+	for (TileDef &tiledef : f.tiledef)
+		tiledef.name = f.name + ".png";
+	for (TileSpec &tile : f.tiles)
+		tile.layers[0].texture_id = texture;
+	for (TileSpec &tile : f.special_tiles)
+		tile.layers[0].texture_id = texture;
+	return ndef->set(f.name, f);
+}
+
+MeshgenNodes register_meshgen_nodes(NodeDefManager *ndef)
+{
+	MeshgenNodes ret;
+	u32 texture = 1;
+
+	for (auto *id : {&ret.stone, &ret.dirt_with_grass, &ret.sand, &ret.tree}) {
+		ContentFeatures f;
+		f.name = "bench:node_" + std::to_string(texture);
+		*id = register_node(ndef, f, texture++);
+	}
+	{
+		ContentFeatures f;
+		f.name = "bench:leaves";
+		f.drawtype = NDT_ALLFACES;
+		f.param_type = CPT_LIGHT;
+		f.light_propagates = true;
+		f.solidness = 0;
+		f.alpha = ALPHAMODE_CLIP;
+		ret.leaves = register_node(ndef, f, texture++);
+	}
+	{
+		ContentFeatures f;
+		f.name = "bench:grass";
+		f.drawtype = NDT_PLANTLIKE;
+		f.param_type = CPT_LIGHT;
+		f.light_propagates = true;
+		f.sunlight_propagates = true;
+		f.solidness = 0;
+		f.walkable = false;
+		f.alpha = ALPHAMODE_CLIP;
+		ret.grass = register_node(ndef, f, texture++);
+	}
+	{
+		ContentFeatures f;
+		f.name = "bench:mesh";
+		f.drawtype = NDT_MESH;
+		f.param_type = CPT_LIGHT;
+		f.param_type_2 = CPT2_FACEDIR;
+		f.light_propagates = true;
+		f.solidness = 0;
+		// the node definition manager drops it
+		scene::IAnimatedMesh *cube = createCubeMesh(v3f(0.8f * BS));
+		f.mesh_ptr = cloneStaticMesh(cube);
+		cube->drop();
+		ret.mesh = register_node(ndef, f, texture++);
+	}
+	for (bool source : {true, false}) {
+		ContentFeatures f;
+		f.name = source ? "bench:water_source" : "bench:water_flowing";
+		f.drawtype = source ? NDT_LIQUID : NDT_FLOWINGLIQUID;
+		f.param_type = CPT_LIGHT;
+		f.param_type_2 = source ? CPT2_NONE : CPT2_FLOWINGLIQUID;
+		f.light_propagates = true;
+		f.solidness = source ? 1 : 0;
+		f.walkable = false;
+		f.alpha = ALPHAMODE_BLEND;
+		f.liquid_type = source ? LIQUID_SOURCE : LIQUID_FLOWING;
+		f.liquid_alternative_source = "bench:water_source";
+		f.liquid_alternative_flowing = "bench:water_flowing";
+		(source ? ret.water_source : ret.water_flowing) =
+			register_node(ndef, f, texture++);
+	}
+
+	ndef->setNodeRegistrationStatus(true);
+	ndef->runNodeResolveCallbacks();
+	ndef->resolveCrossrefs();
+	return ret;
+}
+
+// Returns the node at a position relative to the block that is meshed
+using SceneFunc = std::function<MapNode(v3s16 p)>;
+
+MapNode lit(content_t c, u8 light = LIGHT_SUN, u8 param2 = 0)
+{
+	return MapNode(c, light | (light << 4), param2);
+}
+
+// Fills the block at the origin and all of its neighbors
+void fill_scene(MeshMakeData &data, const SceneFunc &scene)
+{
+	data.fillBlockDataBegin(v3s16(0, 0, 0));
+	const VoxelArea &area = data.m_vmanip.m_area;
+	for (s16 z = area.MinEdge.Z; z <= area.MaxEdge.Z; z++)
+	for (s16 y = area.MinEdge.Y; y <= area.MaxEdge.Y; y++)
+	for (s16 x = area.MinEdge.X; x <= area.MaxEdge.X; x++)
+		data.m_vmanip.setNode(v3s16(x, y, z), scene(v3s16(x, y, z)));
+}
+
+}
+
+TEST_CASE("benchmark_meshgen")
+{
+	DummyGameDef gamedef;
+	const NodeDefManager *ndef = gamedef.getNodeDefManager();
+	const MeshgenNodes nodes = register_meshgen_nodes(
+		gamedef.getWritableNodeDefManager());
+	set_light_table(g_settings->getFloat("display_gamma"));
+
+	const auto flat = [&] (v3s16 p) {
+		if (p.Y < 8)
+			return MapNode(nodes.stone);
+		if (p.Y == 8)
+			return MapNode(nodes.dirt_with_grass);
+		return lit(CONTENT_AIR);
+	};
+
+	const auto caves = [&] (v3s16 p) {
+		if (noise3d_value(p.X / 6.0f, p.Y / 6.0f, p.Z / 6.0f, 1337) > 0.2f)
+			return lit(CONTENT_AIR, 0);
+		return MapNode(nodes.stone);
+	};
+
+	const auto forest = [&] (v3s16 p) {
+		if (p.Y <= 8)
+			return flat(p);
+		// a tree on every fifth column, grass and mesh nodes between them
+		const u32 rnd = (u32)(noise2d(p.X, p.Z, 42) * 1000 + 1000);
+		const bool trunk = (p.X % 5 + 5) % 5 == 2 && (p.Z % 5 + 5) % 5 == 2;
+		if (trunk && p.Y < 13)
+			return MapNode(nodes.tree);
+		if (p.Y >= 12 && p.Y < 15)
+			return lit(nodes.leaves, 12);
+		if (p.Y == 9 && rnd % 3 == 0)
+			return lit(nodes.grass);
+		if (p.Y == 9 && rnd % 7 == 1)
+			return lit(nodes.mesh, LIGHT_SUN, rnd % 24);
+		return lit(CONTENT_AIR);
+	};
+
+	const auto water = [&] (v3s16 p) {
+		if (p.Y < 4)
+			return MapNode(nodes.sand);
+		// a lake with flowing edges
+		const s16 d = std::max(std::abs(p.X - 8), std::abs(p.Z - 8));
+		if (p.Y < 8 && d < 12)
+			return lit(nodes.water_source);
+		if (p.Y == 7 && d < 15)
+			return lit(nodes.water_flowing, LIGHT_SUN, 7 - (d - 12) * 2);
+		if (p.Y < 8)
+			return MapNode(nodes.sand);
+		return lit(CONTENT_AIR);
+	};
+
+	const struct {
+		const char *name;
+		SceneFunc func;
+	} scenes[] = {
+		{"flat", flat},
+		{"caves", caves},
+		{"forest", forest},
+		{"water", water},
+	};
+
+	BenchmarkTextureSource tsrc;
+	BenchmarkShaderSource shdrsrc;
+
+	for (const auto &scene : scenes) {
+		for (bool smooth_lighting : {false, true}) {
+			MeshMakeData data(ndef, MAP_BLOCKSIZE, MeshGrid{1});
+			data.m_smooth_lighting = smooth_lighting;
+			fill_scene(data, scene.func);
+			const std::string name = std::string(scene.name) +
+				(smooth_lighting ? "_smooth" : "");
+
+			BENCHMARK("MapblockMeshGenerator_" + name) {
+				MeshCollector collector{v3f()};
+				MapblockMeshGenerator(&data, &collector).generate();
+				return collector.prebuffers[0].size();
+			};
+
+			// includes the mesh buffers, materials and the BSP tree
+			BENCHMARK("MapBlockMesh_" + name) {
+				MapBlockMesh mesh(&tsrc, &shdrsrc, &data);
+				return mesh.getMesh()->getMeshBufferCount();
+			};
+		}
+	}
+}
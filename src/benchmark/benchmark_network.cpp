@@ -0,0 +1,459 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "exceptions.h"
+#include "porting.h"
+#include "network/connection.h"
+#include "network/mtp/internal.h"
+#include "network/networkexceptions.h"
+#include "network/networkpacket.h"
+#include "network/networkprotocol.h"
+#include "network/peerhandler.h"
+#include "network/socket.h"
+#include "util/basic_macros.h"
+#include "util/serialize.h"
+
+using namespace con;
+
+/*
+	Packet contents
+*/
+
+// About the size of a compressed block with some variation in it
+static std::string make_block_data()
+{
+	std::mt19937 rng(42);
+	std::string data(4000, '\0');
+	for (char &c : data)
+		c = (char)(rng() % 16);
+	return data;
+}
+
+// Position updates like the ones sent for moving entities
+static std::vector<std::string> make_ao_messages()
+{
+	std::vector<std::string> messages;
+	for (int i = 0; i < 100; i++)
+		messages.emplace_back(60, (char)i);
+	return messages;
+}
+
+static std::string make_inventory()
+{
+	std::ostringstream os;
+	os << "List main 32\nWidth 0\n";
+	for (int i = 0; i < 32; i++)
+		os << "Item default:stone " << (i + 1) << "\n";
+	os << "EndInventoryList\nList craft 9\nWidth 3\n";
+	for (int i = 0; i < 9; i++)
+		os << "Empty\n";
+	os << "EndInventoryList\nEndInventory\n";
+	return os.str();
+}
+
+// Like a packet that was received from the connection, reading starts at
+// the beginning. There's no way to rewind, so every run gets its own copy.
+static void to_received(const NetworkPacket &sent, NetworkPacket &pkt)
+{
+	std::string raw(2, '\0');
+	writeU16((u8 *)&raw[0], sent.getCommand());
+	raw.append(sent.getString(0), sent.getSize());
+	pkt.clear();
+	pkt.putRawPacket((const u8 *)raw.data(), raw.size(), PEER_ID_SERVER);
+}
+
+TEST_CASE("benchmark_networkpacket")
+{
+	const std::string block_data = make_block_data();
+	const std::vector<std::string> ao_messages = make_ao_messages();
+	const std::string inventory = make_inventory();
+
+	BENCHMARK("write_blockdata", i) {
+		NetworkPacket pkt(TOCLIENT_BLOCKDATA, 2 + 2 + 2 + block_data.size(), 2);
+		pkt << v3s16(i, -i, 2 * i);
+		pkt.putRawString(block_data);
+		return pkt.getSize();
+	};
+
+	BENCHMARK_ADVANCED("read_blockdata")(Catch::Benchmark::Chronometer meter) {
+		NetworkPacket sent(TOCLIENT_BLOCKDATA, 0, 2);
+		sent << v3s16(1, 2, 3);
+		sent.putRawString(block_data);
+		std::vector<NetworkPacket> packets(meter.runs());
+		for (NetworkPacket &pkt : packets)
+			to_received(sent, pkt);
+		meter.measure([&] (int run) {
+			NetworkPacket &pkt = packets[run];
+			v3s16 p;
+			pkt >> p;
+			std::string data(pkt.getRemainingString(), pkt.getRemainingBytes());
+			return data.size() + p.X;
+		});
+	};
+
+	BENCHMARK("write_active_object_messages", i) {
+		NetworkPacket pkt(TOCLIENT_ACTIVE_OBJECT_MESSAGES, 0, 2);
+		for (size_t k = 0; k < ao_messages.size(); k++)
+			pkt << (u16)(i + k) << ao_messages[k];
+		return pkt.getSize();
+	};
+
+	BENCHMARK_ADVANCED("read_active_object_messages")(Catch::Benchmark::Chronometer meter) {
+		NetworkPacket sent(TOCLIENT_ACTIVE_OBJECT_MESSAGES, 0, 2);
+		for (size_t k = 0; k < ao_messages.size(); k++)
+			sent << (u16)k << ao_messages[k];
+		std::vector<NetworkPacket> packets(meter.runs());
+		for (NetworkPacket &pkt : packets)
+			to_received(sent, pkt);
+		meter.measure([&] (int run) {
+			NetworkPacket &pkt = packets[run];
+			size_t total = 0;
+			while (pkt.getRemainingBytes() > 0) {
+				u16 id;
+				std::string message;
+				pkt >> id >> message;
+				total += message.size() + id;
+			}
+			return total;
+		});
+	};
+
+	BENCHMARK("write_inventory", i) {
+		NetworkPacket pkt(TOCLIENT_INVENTORY, 0, 2);
+		pkt.putRawString(inventory);
+		return pkt.getSize();
+	};
+
+	BENCHMARK_ADVANCED("read_inventory")(Catch::Benchmark::Chronometer meter) {
+		NetworkPacket sent(TOCLIENT_INVENTORY, 0, 2);
+		sent.putRawString(inventory);
+		std::vector<NetworkPacket> packets(meter.runs());
+		for (NetworkPacket &pkt : packets)
+			to_received(sent, pkt);
+		meter.measure([&] (int run) {
+			NetworkPacket &pkt = packets[run];
+			std::istringstream is(std::string(pkt.getRemainingString(),
+				pkt.getRemainingBytes()), std::ios::binary);
+			size_t lines = 0;
+			std::string line;
+			while (std::getline(is, line))
+				lines++;
+			return lines;
+		});
+	};
+}
+
+/*
+	Buffers of the reliable protocol
+*/
+
+static const Address BENCH_ADDRESS(127, 0, 0, 1, 30000);
+
+static BufferedPacketPtr make_reliable(u16 seqnum, u32 size)
+{
+	SharedBuffer<u8> data(size);
+	memset(*data, 0, size);
+	return makePacket(BENCH_ADDRESS, makeReliablePacket(data, seqnum),
+		PROTOCOL_ID, 2, 0);
+}
+
+static void bench_reliable_insert(Catch::Benchmark::Chronometer &meter,
+		const std::vector<u16> &order)
+{
+	// insert() takes the packets, so every run needs a fresh set
+	std::vector<std::vector<BufferedPacketPtr>> runs(meter.runs());
+	for (auto &packets : runs) {
+		for (u16 seqnum : order)
+			packets.push_back(make_reliable(seqnum, 100));
+	}
+	std::vector<ReliablePacketBuffer> buffers(meter.runs());
+	meter.measure([&] (int run) {
+		ReliablePacketBuffer &buffer = buffers[run];
+		// just behind the first seqnum, so all of them are in the window
+		const u16 next_expected = SEQNUM_INITIAL - 1;
+		for (auto &p : runs[run])
+			buffer.insert(p, next_expected);
+		return buffer.size();
+	});
+}
+
+TEST_CASE("benchmark_mtp_buffers")
+{
+	constexpr u16 count = 1000;
+	std::vector<u16> order(count);
+	for (u16 i = 0; i < count; i++)
+		order[i] = SEQNUM_INITIAL + i;
+
+	BENCHMARK_ADVANCED("reliable_insert_1000_in_order")(Catch::Benchmark::Chronometer meter) {
+		bench_reliable_insert(meter, order);
+	};
+
+	BENCHMARK_ADVANCED("reliable_insert_1000_reversed")(Catch::Benchmark::Chronometer meter) {
+		std::vector<u16> reversed(order.rbegin(), order.rend());
+		bench_reliable_insert(meter, reversed);
+	};
+
+	BENCHMARK_ADVANCED("reliable_insert_1000_shuffled")(Catch::Benchmark::Chronometer meter) {
+		std::vector<u16> shuffled = order;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+		bench_reliable_insert(meter, shuffled);
+	};
+
+	BENCHMARK_ADVANCED("reliable_pop_1000")(Catch::Benchmark::Chronometer meter) {
+		std::vector<ReliablePacketBuffer> buffers(meter.runs());
+		for (auto &buffer : buffers) {
+			for (u16 seqnum : order) {
+				auto p = make_reliable(seqnum, 100);
+				buffer.insert(p, SEQNUM_INITIAL - 1);
+			}
+		}
+		meter.measure([&] (int run) {
+			size_t total = 0;
+			while (!buffers[run].empty())
+				total += buffers[run].popFirst()->size();
+			return total;
+		});
+	};
+
+	BENCHMARK_ADVANCED("split_reassemble_30k")(Catch::Benchmark::Chronometer meter) {
+		SharedBuffer<u8> data(30000);
+		memset(*data, 1, data.getSize());
+		std::vector<std::vector<BufferedPacketPtr>> runs(meter.runs());
+		u16 split_seqnum = SEQNUM_INITIAL;
+		for (auto &packets : runs) {
+			std::list<SharedBuffer<u8>> chunks;
+			makeAutoSplitPacket(data, 512 - BASE_HEADER_SIZE, split_seqnum, &chunks);
+			for (auto &chunk : chunks)
+				packets.push_back(makePacket(BENCH_ADDRESS, chunk, PROTOCOL_ID, 2, 0));
+		}
+		std::vector<IncomingSplitBuffer> buffers(meter.runs());
+		meter.measure([&] (int run) {
+			size_t size = 0;
+			for (auto &p : runs[run]) {
+				SharedBuffer<u8> whole = buffers[run].insert(p, true);
+				size += whole.getSize();
+			}
+			return size;
+		});
+	};
+}
+
+/*
+	Real connections over the loopback interface
+*/
+
+// A port nothing else listened on just now
+static u16 find_free_port()
+{
+	std::mt19937 rng(porting::getTimeUs());
+	for (int tries = 0; tries < 100; tries++) {
+		const u16 port = 40000 + rng() % 20000;
+		try {
+			UDPSocket socket(false);
+			socket.Bind(Address(127, 0, 0, 1, port));
+			return port;
+		} catch (const SocketException &e) {
+		}
+	}
+	throw BaseException("no free port found");
+}
+
+/*
+	Forwards datagrams between one client and the server, drops some of them
+	and delays the others, to see how the protocol copes with bad networks.
+*/
+class NetworkSimulator
+{
+public:
+	NetworkSimulator(u16 port, const Address &server, float loss, u32 latency_ms) :
+		m_server(server), m_loss(loss), m_latency_us((u64)latency_ms * 1000),
+		m_socket(false)
+	{
+		m_socket.Bind(Address(127, 0, 0, 1, port));
+		m_thread = std::thread([this] { run(); });
+	}
+
+	~NetworkSimulator()
+	{
+		m_stop = true;
+		m_thread.join();
+	}
+
+	DISABLE_CLASS_COPY(NetworkSimulator)
+
+private:
+	struct Delayed {
+		u64 release_us;
+		Address destination;
+		std::string data;
+	};
+
+	void run()
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+		std::deque<Delayed> queue;
+		std::vector<char> buffer(0x10000);
+		while (!m_stop) {
+			if (m_socket.WaitData(1)) {
+				Address sender;
+				int size;
+				while ((size = m_socket.Receive(sender, buffer.data(), buffer.size())) >= 0) {
+					const bool from_server = sender == m_server;
+					if (!from_server)
+						m_client = sender;
+					else if (m_client.getPort() == 0)
+						continue;
+					if (chance(rng) < m_loss)
+						continue;
+					queue.push_back({porting::getTimeUs() + m_latency_us,
+						from_server ? m_client : m_server,
+						std::string(buffer.data(), size)});
+				}
+			}
+			// the latency is constant, so the queue stays sorted
+			const u64 now = porting::getTimeUs();
+			while (!queue.empty() && queue.front().release_us <= now) {
+				const Delayed &d = queue.front();
+				try {
+					m_socket.Send(d.destination, d.data.data(), d.data.size());
+				} catch (const SendFailedException &e) {
+				}
+				queue.pop_front();
+			}
+		}
+	}
+
+	const Address m_server;
+	Address m_client;
+	const float m_loss;
+	const u64 m_latency_us;
+	UDPSocket m_socket;
+	std::atomic<bool> m_stop{false};
+	std::thread m_thread;
+};
+
+struct BenchPeerHandler : public PeerHandler
+{
+	void peerAdded(IPeer *peer) override { last_id = peer->id; }
+	void deletingPeer(IPeer *peer, bool timeout) override {}
+
+	std::atomic<session_t> last_id{0};
+};
+
+class BenchConnections
+{
+public:
+	// loss and latency are simulated between client and server if given
+	BenchConnections(float loss = 0.0f, u32 latency_ms = 0) :
+		server(512, 30.0f, false, &m_server_handler),
+		client(512, 30.0f, false, &m_client_handler)
+	{
+		const Address server_address(127, 0, 0, 1, find_free_port());
+		server.Serve(server_address);
+		Address client_target = server_address;
+		if (loss > 0 || latency_ms > 0) {
+			const u16 port = find_free_port();
+			m_simulator = std::make_unique<NetworkSimulator>(port, server_address,
+				loss, latency_ms);
+			client_target.setPort(port);
+		}
+		client.Connect(client_target);
+
+		const u64 deadline = porting::getTimeMs() + 10000;
+		NetworkPacket pkt;
+		while (!client.Connected() || m_server_handler.last_id == 0) {
+			if (porting::getTimeMs() > deadline)
+				throw BaseException("benchmark connection timed out");
+			pkt.clear();
+			client.TryReceive(&pkt);
+			pkt.clear();
+			server.TryReceive(&pkt);
+			sleep_ms(1);
+		}
+		client_id = m_server_handler.last_id;
+	}
+
+	// Receives count packets on to, returns their total size
+	static size_t receive(Connection &to, u32 count)
+	{
+		size_t total = 0;
+		NetworkPacket pkt;
+		for (u32 i = 0; i < count; i++) {
+			pkt.clear();
+			if (!to.ReceiveTimeoutMs(&pkt, 10000))
+				throw BaseException("benchmark packet timed out");
+			total += pkt.getSize();
+		}
+		return total;
+	}
+
+	size_t sendToClient(u32 count, u32 size)
+	{
+		NetworkPacket pkt(TOCLIENT_BLOCKDATA, size);
+		pkt.putRawString(std::string(size, 'x'));
+		for (u32 i = 0; i < count; i++)
+			server.Send(client_id, 2, &pkt, true);
+		return receive(client, count);
+	}
+
+	size_t roundTrip(u32 size)
+	{
+		NetworkPacket pkt(TOSERVER_PLAYERPOS, size);
+		pkt.putRawString(std::string(size, 'x'));
+		client.Send(PEER_ID_SERVER, 0, &pkt, true);
+		NetworkPacket reply;
+		if (!server.ReceiveTimeoutMs(&reply, 10000))
+			throw BaseException("benchmark packet timed out");
+		server.Send(client_id, 0, &reply, true);
+		return receive(client, 1);
+	}
+
+private:
+	BenchPeerHandler m_server_handler, m_client_handler;
+	std::unique_ptr<NetworkSimulator> m_simulator;
+
+public:
+	Connection server, client;
+	session_t client_id = 0;
+};
+
+TEST_CASE("benchmark_connection")
+{
+	BenchConnections direct;
+
+	BENCHMARK("loopback_round_trip_100b") {
+		return direct.roundTrip(100);
+	};
+
+	BENCHMARK("loopback_reliable_send_1000x1k") {
+		return direct.sendToClient(1000, 1000);
+	};
+
+	BENCHMARK("loopback_reliable_send_split_30k") {
+		return direct.sendToClient(1, 30000);
+	};
+}
+
+// Slower, each run waits for resends. Run with --run-benchmarks benchmark_lossy_connection
+TEST_CASE("benchmark_lossy_connection", "[.]")
+{
+	BenchConnections lossy(0.02f, 20);
+
+	BENCHMARK("lossy_round_trip_100b") {
+		return lossy.roundTrip(100);
+	};
+
+	BENCHMARK("lossy_reliable_send_100x1k") {
+		return lossy.sendToClient(100, 1000);
+	};
+}
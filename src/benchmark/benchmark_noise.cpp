@@ -0,0 +1,31 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "noise.h"
+
+// One mapchunk of the default size, with parameters similar to mapgen v7
+TEST_CASE("benchmark_noise")
+{
+	const NoiseParams np_2d(4, 70, v3f(600, 600, 600), 82341, 5, 0.6, 2.0);
+	const NoiseParams np_3d(0, 1, v3f(100, 100, 100), 3803, 5, 0.63, 2.0);
+	const NoiseParams np_3d_eased(0, 1, v3f(100, 100, 100), 3803, 5, 0.63, 2.0,
+		NOISE_FLAG_EASED);
+
+	Noise noise_2d(&np_2d, 1337, 80, 80);
+	Noise noise_3d(&np_3d, 1337, 80, 82, 80);
+	Noise noise_3d_eased(&np_3d_eased, 1337, 80, 82, 80);
+
+	BENCHMARK("noiseMap2D_80x80", i) {
+		return noise_2d.noiseMap2D(i * 80, 0)[0];
+	};
+
+	BENCHMARK("noiseMap3D_80x82x80", i) {
+		return noise_3d.noiseMap3D(i * 80, 0, 0)[0];
+	};
+
+	BENCHMARK("noiseMap3D_80x82x80_eased", i) {
+		return noise_3d_eased.noiseMap3D(i * 80, 0, 0)[0];
+	};
+}
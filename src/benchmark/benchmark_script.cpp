@@ -0,0 +1,221 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "emerge.h"
+#include "filesys.h"
+#include "server.h"
+#include "server/mods.h"
+#include "serverenvironment.h"
+#include "servermap.h"
+#include "scripting_server.h"
+#include "script/cpp_api/s_internal.h"
+#include "util/metricsbackend.h"
+#include <fstream>
+#include <memory>
+
+static const char *BENCHMARK_MOD = R"(
+core.register_node(":bench:stone", {})
+core.register_node(":bench:constructed", {
+	on_construct = function(pos) end,
+	on_timer = function(pos, elapsed) return false end,
+})
+core.register_entity(":bench:entity", {})
+)";
+
+// Fills the area, its blocks are created beforehand
+static const char *BENCHMARK_SETUP = R"(
+local vm = core.get_voxel_manip(vector.new(-32, -32, -32), vector.new(31, 31, 31))
+local emin, emax = vm:get_emerged_area()
+local area = VoxelArea(emin, emax)
+local data = vm:get_data()
+local c_stone = core.get_content_id("bench:stone")
+local c_air = core.CONTENT_AIR
+for i in area:iterp(emin, emax) do
+	data[i] = area:position(i).y < 0 and c_stone or c_air
+end
+vm:set_data(data)
+vm:write_to_map()
+
+for i = 1, 100 do
+	core.add_entity(vector.new(i % 20 - 10, 2, math.floor(i / 20) - 10), "bench:entity")
+end
+core.set_node(vector.new(0, 5, 0), {name = "bench:constructed"})
+)";
+
+// Each one runs a hot call many times, to keep the benchmark overhead low
+static const struct {
+	const char *name;
+	const char *code;
+} BENCHMARK_CALLS[] = {
+	{"get_node", R"(
+		local pos = vector.new(0, 0, 0)
+		for i = 1, 1000 do
+			pos.x = i % 32
+			core.get_node(pos)
+		end
+	)"},
+	{"set_node", R"(
+		local stone, air = {name = "bench:stone"}, {name = "air"}
+		local pos = vector.new(0, 0, 0)
+		for i = 1, 1000 do
+			pos.x = i % 32
+			core.set_node(pos, i % 2 == 0 and stone or air)
+		end
+	)"},
+	{"set_node_on_construct", R"(
+		local node = {name = "bench:constructed"}
+		local pos = vector.new(0, 6, 0)
+		for i = 1, 1000 do
+			pos.x = i % 32
+			core.set_node(pos, node)
+		end
+	)"},
+	{"bulk_set_node", R"(
+		local positions = {}
+		for i = 1, 1000 do
+			positions[i] = vector.new(i % 32, 7, math.floor(i / 32))
+		end
+		core.bulk_set_node(positions, {name = "bench:stone"})
+		core.bulk_set_node(positions, {name = "air"})
+	)"},
+	{"find_nodes_in_area", R"(
+		return #core.find_nodes_in_area(vector.new(-32, -32, -32),
+			vector.new(31, 31, 31), {"bench:constructed"})
+	)"},
+	{"get_objects_inside_radius", R"(
+		local pos = vector.new(0, 2, 0)
+		for i = 1, 100 do
+			core.get_objects_inside_radius(pos, 8)
+		end
+	)"},
+	{"voxelmanip_roundtrip", R"(
+		local vm = core.get_voxel_manip(vector.new(0, 0, 0), vector.new(31, 31, 31))
+		local data = vm:get_data()
+		local param2 = vm:get_param2_data()
+		vm:set_data(data)
+		vm:set_param2_data(param2)
+		vm:write_to_map()
+	)"},
+	{"metadata", R"(
+		local meta = core.get_meta(vector.new(0, 5, 0))
+		for i = 1, 1000 do
+			meta:set_string("key", tostring(i % 10))
+			meta:get_string("key")
+		end
+	)"},
+	{"itemstack", R"(
+		local def = {name = "bench:stone", count = 10, wear = 0, meta = {a = "b"}}
+		for i = 1, 1000 do
+			ItemStack(def):to_table()
+		end
+	)"},
+};
+
+namespace {
+
+class BenchmarkScripting : public ServerScripting
+{
+public:
+	BenchmarkScripting(Server *server) : ServerScripting(server) {}
+
+	// Compiles the code into a function and returns a registry reference
+	int load(const char *code)
+	{
+		SCRIPTAPI_PRECHECKHEADER
+
+		if (luaL_loadstring(L, code) != 0)
+			throw LuaError(lua_tostring(L, -1));
+		return luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
+	int call(int ref)
+	{
+		SCRIPTAPI_PRECHECKHEADER
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+		if (lua_pcall(L, 0, 1, 0) != 0)
+			throw LuaError(lua_tostring(L, -1));
+		return lua_tointeger(L, -1);
+	}
+};
+
+class BenchmarkServer : public Server
+{
+public:
+	BenchmarkServer(const std::string &path_world) :
+		Server(path_world, SubgameSpec("fakespec", "fakespec"), true,
+			Address(), true, nullptr)
+	{}
+
+	BenchmarkScripting *createScripting()
+	{
+		auto script = std::make_unique<BenchmarkScripting>(this);
+		BenchmarkScripting *ret = script.get();
+		m_script = std::move(script);
+		m_modmgr = std::make_unique<ServerModManager>(nullptr);
+		return ret;
+	}
+
+	void start() = delete;
+	void stop() = delete;
+};
+
+}
+
+TEST_CASE("benchmark_script")
+{
+	const std::string world_path = fs::CreateTempDir();
+	REQUIRE(!world_path.empty());
+	const std::string mod_file = world_path + DIR_DELIM "bench.lua";
+	{
+		std::ofstream ofs(mod_file, std::ios::out | std::ios::binary);
+		ofs << BENCHMARK_MOD;
+		std::ofstream ofs2(world_path + DIR_DELIM "world.mt",
+			std::ios::out | std::ios::binary);
+		ofs2 << "backend = dummy\n";
+	}
+
+	BenchmarkServer server(world_path);
+	BenchmarkScripting *script = server.createScripting();
+	script->loadBuiltin();
+	script->loadMod(mod_file, BUILTIN_MOD_NAME);
+
+	NodeDefManager *ndef = server.getWritableNodeDefManager();
+	ndef->setNodeRegistrationStatus(true);
+	ndef->runNodeResolveCallbacks();
+	ndef->resolveCrossrefs();
+
+	MetricsBackend mb;
+	EmergeManager emerge(&server, &mb);
+	auto map = std::make_unique<ServerMap>(world_path, &server, &emerge, &mb);
+	ServerEnvironment env(std::move(map), &server, &mb);
+	env.loadMeta();
+	script->initializeEnvironment(&env);
+
+	ServerMap &smap = env.getServerMap();
+	for (s16 z = -2; z < 2; z++)
+	for (s16 y = -2; y < 2; y++)
+	for (s16 x = -2; x < 2; x++)
+		smap.emergeBlock(v3s16(x, y, z), true);
+	script->call(script->load(BENCHMARK_SETUP));
+
+	for (const auto &it : BENCHMARK_CALLS) {
+		const int ref = script->load(it.code);
+		BENCHMARK(std::string("script_") + it.name) {
+			return script->call(ref);
+		};
+	}
+
+	// The engine calling into Lua, without any Lua code around it
+	const v3s16 timer_pos(0, 5, 0);
+	const MapNode timer_node = smap.getNode(timer_pos);
+	REQUIRE(timer_node.getContent() == ndef->getId("bench:constructed"));
+	BENCHMARK("script_node_on_timer_dispatch", i) {
+		return script->node_on_timer(timer_pos, timer_node, i * 0.1f);
+	};
+
+	env.deactivateBlocksAndObjects();
+	fs::RecursiveDelete(world_path);
+}
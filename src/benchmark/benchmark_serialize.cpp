@@ -4,8 +4,16 @@
 
 #include "catch.h"
 #include "util/serialize.h"
+#include "script/common/c_packer.h"
 #include <sstream>
 #include <ios>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lualib.h>
+}
 
 // Builds a string of exactly `length` characters by repeating `s` (rest cut off)
 static std::string makeRepeatTo(const std::string &s, size_t length)
@@ -54,3 +62,47 @@ static std::string makeRepeatTo(const std::string &s, size_t length)
 TEST_CASE("benchmark_serialize") {
 	BENCH_ALL()
 }
+
+// Similar to a large list of items with metadata
+static const char *PACK_LIST = R"(
+	local t = {}
+	for i = 1, 20000 do
+		t[i] = {name = "default:stone", count = i, wear = 0,
+			pos = {x = i, y = -i, z = 2 * i},
+			meta = {owner = "player" .. (i % 50), infotext = "some text"}}
+	end
+	return t
+)";
+
+static const char *PACK_STRING = R"(
+	return string.rep("abcdefgh", 128 * 1024)
+)";
+
+static void benchPack(const char *name, const char *code)
+{
+	lua_State *L = luaL_newstate();
+	luaL_openlibs(L);
+	REQUIRE(luaL_dostring(L, code) == 0);
+
+	BENCHMARK(std::string("script_pack_") + name) {
+		std::unique_ptr<PackedValue> pv(script_pack(L, -1));
+		return pv->i.size();
+	};
+
+	BENCHMARK_ADVANCED(std::string("script_unpack_") + name)(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::unique_ptr<PackedValue>> pvs;
+		for (int i = 0; i < meter.runs(); i++)
+			pvs.emplace_back(script_pack(L, -1));
+		meter.measure([&] (int i) {
+			script_unpack(L, pvs[i].get());
+			lua_pop(L, 1);
+		});
+	};
+
+	lua_close(L);
+}
+
+TEST_CASE("benchmark_script_pack") {
+	benchPack("list", PACK_LIST);
+	benchPack("string", PACK_STRING);
+}
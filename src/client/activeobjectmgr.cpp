@@ -10,6 +10,14 @@
 namespace client
 {
 
+// Objects are found along shootlines of a few nodes at most
+static constexpr f32 SELECTABLE_CELL_SIZE = 4 * BS;
+
+ActiveObjectMgr::ActiveObjectMgr() :
+	m_selectable_index(SELECTABLE_CELL_SIZE)
+{
+}
+
 ActiveObjectMgr::~ActiveObjectMgr()
 {
 	if (!m_active_objects.empty()) {
@@ -23,15 +31,38 @@ void ActiveObjectMgr::step(
 		float dtime, const std::function<void(ClientActiveObject *)> &f)
 {
 	size_t count = 0;
+	m_max_selection_radius = 0;
 	for (auto &ao_it : m_active_objects.iter()) {
 		if (!ao_it.second)
 			continue;
 		count++;
 		f(ao_it.second.get());
+		updateSelectableIndex(ao_it.second.get());
 	}
 	g_profiler->avg("ActiveObjectMgr: CAO count [#]", count);
 }
 
+void ActiveObjectMgr::updateSelectableIndex(ClientActiveObject *obj)
+{
+	const u16 id = obj->getId();
+	aabb3f selection_box{{0.0f, 0.0f, 0.0f}};
+	if (!obj->getSelectionBox(&selection_box)) {
+		if (m_selectable_index.contains(id))
+			m_selectable_index.remove(id);
+		return;
+	}
+
+	// Covers the box in any rotation
+	m_max_selection_radius = std::max(m_max_selection_radius, std::sqrt(std::max(
+		selection_box.MinEdge.getLengthSQ(), selection_box.MaxEdge.getLengthSQ())));
+
+	const auto pos = obj->getPosition().toArray();
+	if (m_selectable_index.contains(id))
+		m_selectable_index.update(pos, id);
+	else
+		m_selectable_index.insert(pos, id);
+}
+
 bool ActiveObjectMgr::registerObject(std::unique_ptr<ClientActiveObject> obj)
 {
 	assert(obj); // Pre-condition
@@ -53,6 +84,7 @@ bool ActiveObjectMgr::registerObject(std::unique_ptr<ClientActiveObject> obj)
 	}
 	infostream << "Client::ActiveObjectMgr::registerObject(): "
 			<< "added (id=" << obj->getId() << ")" << std::endl;
+	updateSelectableIndex(obj.get());
 	m_active_objects.put(obj->getId(), std::move(obj));
 	return true;
 }
@@ -69,6 +101,8 @@ void ActiveObjectMgr::removeObject(u16 id)
 		return;
 	}
 
+	if (m_selectable_index.contains(id))
+		m_selectable_index.remove(id);
 	obj->removeFromScene(true);
 }
 
@@ -96,14 +130,23 @@ std::vector<DistanceSortedActiveObject> ActiveObjectMgr::getActiveSelectableObje
 	f32 max_d = shootline.getLength();
 	v3f dir = shootline.getVector().normalize();
 
-	for (auto &ao_it : m_active_objects.iter()) {
-		ClientActiveObject *obj = ao_it.second.get();
+	// Any object whose selection box reaches the shootline's bounding box,
+	// with some room for objects that were moved by their parents
+	aabb3f range(shootline.start);
+	range.addInternalPoint(shootline.end);
+	const f32 pad = m_max_selection_radius + BS;
+	range.MinEdge -= v3f(pad);
+	range.MaxEdge += v3f(pad);
+
+	m_selectable_index.rangeQuery(range.MinEdge.toArray(), range.MaxEdge.toArray(),
+			[&] (auto, u16 id) {
+		ClientActiveObject *obj = m_active_objects.get(id).get();
 		if (!obj)
-			continue;
+			return;
 
 		aabb3f selection_box{{0.0f, 0.0f, 0.0f}};
 		if (!obj->getSelectionBox(&selection_box))
-			continue;
+			return;
 
 		v3f obj_center = obj->getPosition() + selection_box.getCenter();
 		f32 obj_radius_sq = selection_box.getExtent().getLengthSQ() / 4;
@@ -113,15 +156,15 @@ std::vector<DistanceSortedActiveObject> ActiveObjectMgr::getActiveSelectableObje
 		f32 b_sq = c.getLengthSQ() - a * a;  // distance from shootline to obj_center, squared
 
 		if (b_sq > obj_radius_sq)
-			continue;
+			return;
 
 		// backward- and far-plane
 		f32 obj_radius = std::sqrt(obj_radius_sq);
 		if (a < -obj_radius || a > max_d + obj_radius)
-			continue;
+			return;
 
 		dest.emplace_back(obj, a);
-	}
+	});
 	return dest;
 }
 
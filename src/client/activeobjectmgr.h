@@ -8,12 +8,14 @@
 #include <vector>
 #include "../activeobjectmgr.h"
 #include "clientobject.h"
+#include "util/spatial_grid.h"
 
 namespace client
 {
 class ActiveObjectMgr final : public ::ActiveObjectMgr<ClientActiveObject>
 {
 public:
+	ActiveObjectMgr();
 	~ActiveObjectMgr() override;
 
 	void step(float dtime,
@@ -27,6 +29,15 @@ class ActiveObjectMgr final : public ::ActiveObjectMgr<ClientActiveObject>
 	/// Gets all CAOs whose selection boxes may intersect the @p shootline.
 	/// @note CAOs without a selection box are not returned.
 	/// @note Distances are along the @p shootline.
+	/// @note Only finds CAOs where they were in the last step().
 	std::vector<DistanceSortedActiveObject> getActiveSelectableObjects(const core::line3d<f32> &shootline);
+
+private:
+	void updateSelectableIndex(ClientActiveObject *obj);
+
+	// Positions of the CAOs with a selection box as of their last step
+	SpatialHashGrid<3, f32, u16> m_selectable_index;
+	// Largest distance of a selection box corner from its CAO's position
+	f32 m_max_selection_radius = 0;
 };
 } // namespace client
@@ -0,0 +1,88 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "blockdecoder.h"
+#include <sstream>
+#include "exceptions.h"
+#include "mapblock.h"
+#include "threading/jobsystem.h"
+#include "util/hashing.h"
+
+BlockDecoder::BlockDecoder(IGameDef *gamedef) :
+	BlockDecoder(gamedef, &JobSystem::get())
+{
+}
+
+BlockDecoder::BlockDecoder(IGameDef *gamedef, JobSystem *jobs) :
+	m_gamedef(gamedef),
+	m_jobs(jobs)
+{
+}
+
+BlockDecoder::~BlockDecoder()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this] { return m_busy == 0; });
+}
+
+void BlockDecoder::enqueue(v3s16 pos, std::string data, u8 version, u8 flags)
+{
+	const u32 seq = m_next_seq++;
+	m_newest[pos] = seq;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_busy++;
+	}
+	// std::function needs a copyable callable
+	auto shared_data = std::make_shared<std::string>(std::move(data));
+	m_jobs->submit([this, pos, seq, shared_data, version, flags] {
+		work(pos, seq, *shared_data, version, flags);
+	});
+}
+
+void BlockDecoder::take(std::vector<Result> &results, bool wait)
+{
+	std::vector<Done> done;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (wait)
+			m_cv.wait(lock, [this] { return m_busy == 0; });
+		done.swap(m_done);
+	}
+
+	for (Done &it : done) {
+		auto newest = m_newest.find(it.result.pos);
+		// superseded by data that was received later
+		if (newest == m_newest.end() || newest->second != it.seq)
+			continue;
+		m_newest.erase(newest);
+		results.push_back(std::move(it.result));
+	}
+}
+
+void BlockDecoder::work(v3s16 pos, u32 seq, std::string &data, u8 version, u8 flags)
+{
+	Done done;
+	done.seq = seq;
+	done.result.pos = pos;
+	done.result.flags = flags;
+	try {
+		std::istringstream is(data, std::ios_base::binary);
+		auto block = std::make_unique<MapBlock>(pos, m_gamedef);
+		block->deSerialize(is, version, false);
+		block->deSerializeNetworkSpecific(is);
+		done.result.block = std::move(block);
+	} catch (const BaseException &e) {
+		done.result.error = e.what();
+	}
+	if ((flags & ENQUEUE_KEEP_DATA) && done.result.block) {
+		done.result.sha1 = hashing::sha1(data);
+		done.result.data = std::move(data);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_done.push_back(std::move(done));
+	m_busy--;
+	m_cv.notify_all();
+}
@@ -0,0 +1,95 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "util/basic_macros.h"
+
+class IGameDef;
+class JobSystem;
+class MapBlock;
+
+/*
+	Decompresses and deserializes the blocks received from the server as
+	jobs of the JobSystem, so that this doesn't hold up the client thread.
+
+	The blocks are decoded into MapBlocks that aren't part of the map. The
+	client thread takes them and moves their contents into the map with
+	MapBlock::takeContentsFrom().
+*/
+class BlockDecoder
+{
+public:
+	struct Result {
+		v3s16 pos;
+		// null if the data was broken
+		std::unique_ptr<MapBlock> block;
+		// what deserializing threw
+		std::string error;
+		// ENQUEUE_* flags the block was enqueued with
+		u8 flags = 0;
+		// with ENQUEUE_KEEP_DATA: the data and its SHA-1
+		std::string data;
+		std::string sha1;
+	};
+
+	enum : u8 {
+		// Keep the data and compute its SHA-1, for ClientBlockCache
+		ENQUEUE_KEEP_DATA = 0x01,
+		// The data was loaded from ClientBlockCache
+		ENQUEUE_FROM_CACHE = 0x02,
+	};
+
+	BlockDecoder(IGameDef *gamedef);
+	BlockDecoder(IGameDef *gamedef, JobSystem *jobs);
+	// Waits for the blocks that are being decoded
+	~BlockDecoder();
+
+	DISABLE_CLASS_COPY(BlockDecoder)
+
+	// data: the block as sent in TOCLIENT_BLOCKDATA after its position,
+	// version: serialization version of the server
+	void enqueue(v3s16 pos, std::string data, u8 version, u8 flags = 0);
+
+	// Is a block at pos being decoded?
+	bool isPending(v3s16 pos) const { return m_newest.count(pos) != 0; }
+	bool isPending() const { return !m_newest.empty(); }
+
+	// Takes the blocks that were decoded since the last call.
+	// If a block was received again before it was taken, only the newest
+	// version is returned.
+	// wait: wait until all blocks that are pending are decoded
+	void take(std::vector<Result> &results, bool wait = false);
+
+private:
+	struct Done {
+		u32 seq;
+		Result result;
+	};
+
+	void work(v3s16 pos, u32 seq, std::string &data, u8 version, u8 flags);
+
+	IGameDef *m_gamedef;
+	JobSystem *m_jobs;
+
+	// Only used by the client thread
+	u32 m_next_seq = 0;
+	// sequence number of the newest data of each pending block
+	std::unordered_map<v3s16, u32> m_newest;
+
+	std::mutex m_mutex;
+	// signaled when a block was decoded
+	std::condition_variable m_cv;
+	std::vector<Done> m_done;
+	// jobs submitted to the job system that didn't finish yet
+	size_t m_busy = 0;
+};
@@ -590,7 +590,7 @@ void Camera::setDigging(s32 button)
 void Camera::wield(const ItemStack &item)
 {
 	if (item.name != m_wield_item_next.name ||
-			item.metadata != m_wield_item_next.metadata) {
+			!item.metadataEquals(m_wield_item_next)) {
 		m_wield_item_next = item;
 		if (m_wield_change_timer > 0)
 			m_wield_change_timer = -m_wield_change_timer;
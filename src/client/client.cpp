@@ -7,12 +7,17 @@
 #include <sstream>
 #include <cmath>
 #include <IFileSystem.h>
+#include <IMeshCache.h>
 #include <json/json.h>
 #include "client.h"
+#include "client/blockdecoder.h"
+#include "client/clientblockcache.h"
 #include "client/fontengine.h"
+#include "client/frametimings.h"
 #include "network/clientopcodes.h"
 #include "network/connection.h"
 #include "network/networkpacket.h"
+#include "threading/jobsystem.h"
 #include "threading/mutex_auto_lock.h"
 #include "client/clientevent.h"
 #include "client/renderingengine.h"
@@ -20,6 +25,7 @@
 #include "client/texturepaths.h"
 #include "client/texturesource.h"
 #include "client/mesh_generator_thread.h"
+#include "client/modelcache.h"
 #include "client/particles.h"
 #include "client/localplayer.h"
 #include "util/auth.h"
@@ -46,6 +52,7 @@
 #include "database/database-files.h"
 #include "database/database-sqlite3.h"
 #include "serialization.h"
+#include "servermap.h"
 #include "guiscalingfilter.h"
 #include "script/scripting_client.h"
 #include "game.h"
@@ -134,6 +141,13 @@ Client::Client(
 		m_minimap = std::make_unique<Minimap>(this);
 	}
 
+	if (g_settings->getBool("model_disk_cache")) {
+		m_model_cache = std::make_unique<ModelCache>(
+			porting::path_cache + DIR_DELIM + "models");
+	}
+
+	m_block_decoder = std::make_unique<BlockDecoder>(this);
+
 	m_cache_save_interval = g_settings->getU16("server_map_save_interval");
 	m_mesh_grid = { g_settings->getU16("client_mesh_chunk") };
 }
@@ -314,6 +328,7 @@ void Client::Stop()
 		m_localdb->endSave();
 		m_localdb.reset();
 	}
+	m_block_cache.reset();
 
 	if (m_mods_loaded)
 		delete m_script;
@@ -332,16 +347,14 @@ Client::~Client()
 
 	deleteAuthData();
 
+	// the jobs use the definitions
+	waitForDefinitions();
+	m_block_decoder.reset();
+
 	m_mesh_update_manager->stop();
 	m_mesh_update_manager->wait();
 
-	MeshUpdateResult r;
-	while (m_mesh_update_manager->getNextResult(r)) {
-		for (auto block : r.map_blocks)
-			if (block)
-				block->refDrop();
-		delete r.mesh;
-	}
+	m_mesh_update_manager->discardResults();
 
 	// Delete detached inventories
 	for (auto &m_detached_inventorie : m_detached_inventories) {
@@ -391,6 +404,7 @@ void Client::connect(const Address &address, const std::string &address_name)
 	m_con->Connect(address);
 
 	initLocalMapSaving(address, m_address_name);
+	initBlockCache(address, m_address_name);
 }
 
 void Client::step(float dtime)
@@ -480,6 +494,10 @@ void Client::step(float dtime)
 		m_env.getMap().timerUpdate(map_timer_and_unload_dtime,
 			std::max(g_settings->getFloat("client_unload_unused_data_timeout"), 0.0f),
 			mapblock_limit, &deleted_blocks);
+		m_env.getClientMap().evictOverBudget(
+			(size_t)g_settings->getU32("client_block_memory_budget") * 1024 * 1024,
+			(size_t)g_settings->getU32("client_mesh_memory_budget") * 1024 * 1024,
+			&deleted_blocks);
 
 		// Send info to server
 
@@ -573,15 +591,37 @@ void Client::step(float dtime)
 		}
 	}
 
+	/*
+		Mesh what the camera sees first
+	*/
+	if (m_camera) {
+		m_mesh_update_manager->updateCamera(m_camera->getPosition(),
+			m_camera->getDirection(), m_camera->getFovMax());
+	}
+
 	/*
 		Replace updated meshes
 	*/
 	{
+		FrameTimingScope timing("Mesh results");
 		int num_processed_meshes = 0;
 		std::vector<v3s16> blocks_to_ack;
 		bool force_update_shadows = false;
+		bool map_changed = false;
+
+		// The blocks are acknowledged right away, only showing the meshes
+		// is spread over the frames
+		m_mesh_update_manager->collectResults(blocks_to_ack);
+		for (size_t i = 0; i < blocks_to_ack.size(); i += 255) {
+			sendGotBlocks(std::vector<v3s16>(blocks_to_ack.begin() + i,
+				blocks_to_ack.begin() + std::min(i + 255, blocks_to_ack.size())));
+		}
+
+		const u64 time_budget_us =
+			(u64)g_settings->getU32("mesh_update_time_budget") * 1000;
+		const u64 start_time_us = porting::getTimeUs();
 		MeshUpdateResult r;
-		while (m_mesh_update_manager->getNextResult(r))
+		while (m_mesh_update_manager->takeNearestResult(r))
 		{
 			num_processed_meshes++;
 
@@ -606,6 +646,7 @@ void Client::step(float dtime)
 				delete block->mesh;
 				block->mesh = nullptr;
 				block->solid_sides = r.solid_sides;
+				map_changed = true;
 
 				if (r.mesh) {
 					minimap_mapblocks = r.mesh->moveMinimapMapblocks();
@@ -638,32 +679,24 @@ void Client::step(float dtime)
 				}
 			}
 
-			for (auto p : r.ack_list) {
-				if (blocks_to_ack.size() == 255) {
-					sendGotBlocks(blocks_to_ack);
-					blocks_to_ack.clear();
-				}
-
-				blocks_to_ack.emplace_back(p);
-			}
-
 			for (auto block : r.map_blocks)
 				if (block)
 					block->refDrop();
-		}
-		if (blocks_to_ack.size() > 0) {
-				// Acknowledge block(s)
-				sendGotBlocks(blocks_to_ack);
+
+			// urgent results are taken first and always shown
+			if (!r.urgent && time_budget_us > 0 &&
+					porting::getTimeUs() - start_time_us >= time_budget_us)
+				break;
 		}
 
 		if (num_processed_meshes > 0)
 			g_profiler->graphAdd("num_processed_meshes", num_processed_meshes);
 
-		if (force_update_shadows && !g_settings->getFlag("performance_tradeoffs")) {
-			auto shadow = RenderingEngine::get_shadow_renderer();
-			if (shadow)
-				shadow->setForceUpdateShadowMap();
-		};
+		auto shadow = RenderingEngine::get_shadow_renderer();
+		if (shadow && map_changed)
+			shadow->setMapChanged();
+		if (shadow && force_update_shadows && !g_settings->getFlag("performance_tradeoffs"))
+			shadow->setForceUpdateShadowMap();
 	}
 
 	/*
@@ -778,51 +811,73 @@ void Client::step(float dtime)
 		m_localdb->endSave();
 		m_localdb->beginSave();
 	}
+	if (m_block_cache && m_block_cache_save_interval.step(dtime,
+			m_cache_save_interval)) {
+		m_block_cache->flush();
+	}
+}
+
+static const char *media_image_ext[] = {
+	".png", ".jpg", ".tga",
+	NULL
+};
+
+static const char *media_sound_ext[] = {
+	".0.ogg", ".1.ogg", ".2.ogg", ".3.ogg", ".4.ogg",
+	".5.ogg", ".6.ogg", ".7.ogg", ".8.ogg", ".9.ogg",
+	".ogg", NULL
+};
+
+static const char *media_model_ext[] = {
+	".x", ".b3d", ".obj", ".gltf", ".glb",
+	NULL
+};
+
+video::IImage *Client::decodeMediaImage(const std::string &data,
+	const std::string &filename)
+{
+	if (removeStringEnd(filename, media_image_ext).empty())
+		return nullptr;
+
+	io::IFileSystem *irrfs = m_rendering_engine->get_filesystem();
+	video::IVideoDriver *vdrv = m_rendering_engine->get_video_driver();
+
+	io::IReadFile *rfile = irrfs->createMemoryReadFile(
+			data.c_str(), data.size(), filename.c_str());
+
+	FATAL_ERROR_IF(!rfile, "Could not create irrlicht memory file.");
+
+	// Read image
+	video::IImage *img = vdrv->createImageFromFile(rfile);
+	rfile->drop();
+	return img;
 }
 
 bool Client::loadMedia(const std::string &data, const std::string &filename,
-	bool from_media_push)
+	const std::string &sha1, bool from_media_push, video::IImage *decoded)
 {
 	std::string name;
 
-	const char *image_ext[] = {
-		".png", ".jpg", ".tga",
-		NULL
-	};
-	name = removeStringEnd(filename, image_ext);
+	name = removeStringEnd(filename, media_image_ext);
 	if (!name.empty()) {
 		TRACESTREAM(<< "Client: Attempting to load image "
 			<< "file \"" << filename << "\"" << std::endl);
 
-		io::IFileSystem *irrfs = m_rendering_engine->get_filesystem();
-		video::IVideoDriver *vdrv = m_rendering_engine->get_video_driver();
-
-		io::IReadFile *rfile = irrfs->createMemoryReadFile(
-				data.c_str(), data.size(), filename.c_str());
-
-		FATAL_ERROR_IF(!rfile, "Could not create irrlicht memory file.");
-
-		// Read image
-		video::IImage *img = vdrv->createImageFromFile(rfile);
+		video::IImage *img = decoded ? decoded : decodeMediaImage(data, filename);
 		if (!img) {
 			errorstream<<"Client: Cannot create image from data of "
 					<<"file \""<<filename<<"\""<<std::endl;
-			rfile->drop();
 			return false;
 		}
 
 		m_tsrc->insertSourceImage(filename, img);
 		img->drop();
-		rfile->drop();
 		return true;
 	}
+	// only images are decoded beforehand
+	assert(!decoded);
 
-	const char *sound_ext[] = {
-		".0.ogg", ".1.ogg", ".2.ogg", ".3.ogg", ".4.ogg",
-		".5.ogg", ".6.ogg", ".7.ogg", ".8.ogg", ".9.ogg",
-		".ogg", NULL
-	};
-	name = removeStringEnd(filename, sound_ext);
+	name = removeStringEnd(filename, media_sound_ext);
 	if (!name.empty()) {
 		TRACESTREAM(<< "Client: Attempting to load sound file \""
 				<< filename << "\"" << std::endl);
@@ -833,18 +888,15 @@ bool Client::loadMedia(const std::string &data, const std::string &filename,
 		return true;
 	}
 
-	const char *model_ext[] = {
-		".x", ".b3d", ".obj", ".gltf", ".glb",
-		NULL
-	};
-	name = removeStringEnd(filename, model_ext);
+	name = removeStringEnd(filename, media_model_ext);
 	if (!name.empty()) {
 		TRACESTREAM(<<"Client: Storing model into memory "
 				"\""<<filename<<"\""<<std::endl);
-		if(m_mesh_data.count(filename))
+		if (m_mesh_data.count(filename) || m_mesh_loaders.erase(filename))
 			errorstream<<"Multiple models with name \""<<filename
 					<<"\" found; replacing previous model"<<std::endl;
 		m_mesh_data[filename] = data;
+		m_mesh_hashes[filename] = sha1;
 		return true;
 	}
 
@@ -871,6 +923,36 @@ bool Client::loadMedia(const std::string &data, const std::string &filename,
 	return false;
 }
 
+bool Client::isLazyMedia(const std::string &filename)
+{
+	return !removeStringEnd(filename, media_sound_ext).empty() ||
+		!removeStringEnd(filename, media_model_ext).empty();
+}
+
+bool Client::loadMediaLazy(const std::string &filename, const std::string &sha1,
+	std::function<std::string()> &&loader)
+{
+	std::string name(removeStringEnd(filename, media_sound_ext));
+	if (!name.empty()) {
+		if (!m_sound->loadSoundLazy(filename, std::move(loader)))
+			return false;
+		// "name[.num].ogg" is in group "name"
+		m_sound->addSoundToGroup(filename, name);
+		return true;
+	}
+
+	if (!removeStringEnd(filename, media_model_ext).empty()) {
+		if (m_mesh_data.erase(filename) || m_mesh_loaders.count(filename))
+			errorstream << "Multiple models with name \"" << filename
+				<< "\" found; replacing previous model" << std::endl;
+		m_mesh_loaders[filename] = std::move(loader);
+		m_mesh_hashes[filename] = sha1;
+		return true;
+	}
+
+	return false;
+}
+
 // Virtual methods from con::PeerHandler
 void Client::peerAdded(con::IPeer *peer)
 {
@@ -945,6 +1027,23 @@ void Client::initLocalMapSaving(const Address &address, const std::string &hostn
 	actionstream << "Local map saving started, map will be saved at '" << world_path << "'" << std::endl;
 }
 
+void Client::initBlockCache(const Address &address, const std::string &hostname)
+{
+	if (!g_settings->getBool("client_block_cache") || m_internal_server || m_block_cache)
+		return;
+
+	std::string name = "server_" + hostname + "_" + std::to_string(address.getPort());
+	str_replace(name, ':', '_');
+	const std::string dir = porting::path_cache + DIR_DELIM + "blocks" +
+		DIR_DELIM + name;
+	try {
+		m_block_cache = std::make_unique<ClientBlockCache>(dir);
+	} catch (const BaseException &e) {
+		errorstream << "Could not open the block cache at '" << dir
+			<< "': " << e.what() << std::endl;
+	}
+}
+
 void Client::ReceiveAll()
 {
 	NetworkPacket pkt;
@@ -972,6 +1071,47 @@ void Client::ReceiveAll()
 					 << e.what() << std::endl;
 		}
 	}
+
+	insertDecodedBlocks(false);
+	sendRequestBlocks();
+}
+
+void Client::insertDecodedBlocks(bool wait)
+{
+	std::vector<BlockDecoder::Result> results;
+	m_block_decoder->take(results, wait);
+
+	for (auto &result : results) {
+		const v3s16 p = result.pos;
+		if (!result.block) {
+			// Get it from the server instead
+			if (result.flags & BlockDecoder::ENQUEUE_FROM_CACHE) {
+				infostream << "Broken block " << p << " in the block cache: "
+					<< result.error << std::endl;
+				m_blocks_to_request.push_back(p);
+				continue;
+			}
+			throw SerializationError(result.error);
+		}
+
+		MapSector *sector = m_env.getMap().emergeSector(v2s16(p.X, p.Z));
+		MapBlock *block = sector->getBlockNoCreateNoEx(p.Y);
+		if (!block)
+			block = sector->createBlankBlock(p.Y);
+		block->takeContentsFrom(*result.block);
+
+		if (m_localdb) {
+			ServerMap::saveBlock(block, m_localdb.get());
+		}
+		if (m_block_cache && (result.flags & BlockDecoder::ENQUEUE_KEEP_DATA)) {
+			m_block_cache->store(p, result.sha1, m_server_ser_ver, result.data);
+		}
+
+		/*
+			Add it to mesh update queue and set it to be acknowledged after update.
+		*/
+		addUpdateMeshTaskWithEdge(p, true);
+	}
 }
 
 inline void Client::handleCommand(NetworkPacket* pkt)
@@ -1144,7 +1284,7 @@ void Client::sendInit(const std::string &playerName)
 {
 	NetworkPacket pkt(TOSERVER_INIT, 1 + 2 + 2 + (1 + playerName.size()));
 
-	pkt << SER_FMT_VER_HIGHEST_READ << (u16) 0 /* unused */;
+	pkt << SER_FMT_VER_HIGHEST_READ << (u16) NETPROTO_COMPRESSION_ZSTD_STREAM;
 	pkt << CLIENT_PROTOCOL_VERSION_MIN << LATEST_PROTOCOL_VERSION;
 	pkt << playerName;
 
@@ -1225,6 +1365,20 @@ void Client::sendGotBlocks(const std::vector<v3s16> &blocks)
 	Send(&pkt);
 }
 
+void Client::sendRequestBlocks()
+{
+	// The count is a u8
+	for (size_t i = 0; i < m_blocks_to_request.size(); i += 255) {
+		const size_t count = std::min<size_t>(255, m_blocks_to_request.size() - i);
+		NetworkPacket pkt(TOSERVER_REQUEST_BLOCKS, 1 + 6 * count);
+		pkt << (u8) count;
+		for (size_t j = i; j < i + count; j++)
+			pkt << m_blocks_to_request[j];
+		Send(&pkt);
+	}
+	m_blocks_to_request.clear();
+}
+
 void Client::sendRemovedSounds(const std::vector<s32> &soundList)
 {
 	size_t server_ids = soundList.size();
@@ -1371,13 +1525,14 @@ void Client::sendRespawnLegacy()
 void Client::sendReady()
 {
 	NetworkPacket pkt(TOSERVER_CLIENT_READY,
-			1 + 1 + 1 + 1 + 2 + sizeof(char) * strlen(g_version_hash) + 2);
+			1 + 1 + 1 + 1 + 2 + sizeof(char) * strlen(g_version_hash) + 2 + 1);
 
 	pkt << (u8) VERSION_MAJOR << (u8) VERSION_MINOR << (u8) VERSION_PATCH
 		<< (u8) 0 << (u16) strlen(g_version_hash);
 
 	pkt.putRawString(g_version_hash, (u16) strlen(g_version_hash));
 	pkt << (u16)FORMSPEC_API_VERSION;
+	pkt << (u8)(m_block_cache ? CLIENT_READY_BLOCK_CACHE : 0);
 	Send(&pkt);
 }
 
@@ -1427,6 +1582,27 @@ void Client::sendPlayerPos()
 	player->last_movement_speed  = movement_speed;
 	player->last_movement_dir    = movement_dir;
 
+	if (m_proto_ver >= 49) {
+		// Sent unreliably, the server drops packets older than the last one
+		const auto quantize = [] (f32 value, f32 scale) {
+			return (s16)std::clamp<f32>(std::round(value * scale), -32768, 32767);
+		};
+		const v3f speed = player->getSpeed();
+		NetworkPacket pkt(TOSERVER_PLAYER_MOVE, 2 + 12 + 6 + 2 + 2 + 2 + 1 + 1 + 1 + 1 + 2);
+		pkt << ++m_player_move_seq;
+		pkt << v3s32::from(player->getPosition() * 100);
+		pkt << v3s16(quantize(speed.X, MOVEMENT_SPEED_SCALE),
+			quantize(speed.Y, MOVEMENT_SPEED_SCALE),
+			quantize(speed.Z, MOVEMENT_SPEED_SCALE));
+		pkt << quantize(player->getPitch(), 100.0f);
+		pkt << (u16)std::round(wrapDegrees_0_360(player->getYaw()) * 100.0f);
+		pkt << (u16)keyPressed << camera_fov << wanted_range << (u8)camera_inverted;
+		pkt << (u8)std::round(std::clamp(movement_speed, 0.0f, 1.0f) * 255.0f);
+		pkt << quantize(movement_dir, 10000.0f);
+		Send(&pkt);
+		return;
+	}
+
 	NetworkPacket pkt(TOSERVER_PLAYERPOS, 12 + 12 + 4 + 4 + 4 + 1 + 1 + 1 + 4 + 4);
 
 	writePlayerPos(player, &map, &pkt, camera_inverted);
@@ -1731,11 +1907,13 @@ void Client::addUpdateMeshTask(v3s16 p, bool ack_to_server, bool urgent)
 	if (b == NULL)
 		return;
 
+	m_map_changes++;
 	m_mesh_update_manager->updateBlock(&m_env.getMap(), p, ack_to_server, urgent);
 }
 
 void Client::addUpdateMeshTaskWithEdge(v3s16 blockpos, bool ack_to_server, bool urgent)
 {
+	m_map_changes++;
 	m_mesh_update_manager->updateBlock(&m_env.getMap(), blockpos, ack_to_server, urgent, true);
 }
 
@@ -1745,6 +1923,7 @@ void Client::addUpdateMeshTaskForNode(v3s16 nodepos, bool ack_to_server, bool ur
 
 	v3s16 blockpos = getNodeBlockPos(nodepos);
 	v3s16 blockpos_relative = blockpos * MAP_BLOCKSIZE;
+	m_map_changes++;
 	m_mesh_update_manager->updateBlock(&m_env.getMap(), blockpos, ack_to_server, urgent, false);
 	// Leading edge
 	if (nodepos.X == blockpos_relative.X)
@@ -1815,6 +1994,49 @@ void Client::showUpdateProgressTexture(void *args, u32 progress, u32 max_progres
 		}
 }
 
+void Client::deserializeDefinitions(std::string data, bool nodedef,
+	std::atomic<bool> &received)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_definitions_mutex);
+		m_definition_jobs++;
+	}
+	// std::function needs a copyable callable
+	auto shared_data = std::make_shared<std::string>(std::move(data));
+	const u16 proto_ver = m_proto_ver;
+	JobSystem::get().submit([this, shared_data, nodedef, proto_ver, &received] {
+		std::string error;
+		try {
+			std::istringstream tmp_is(*shared_data, std::ios::binary);
+			std::stringstream tmp_os(std::ios::binary | std::ios::in | std::ios::out);
+			if (proto_ver >= 48)
+				decompressZstd(tmp_is, tmp_os);
+			else
+				decompressZlib(tmp_is, tmp_os);
+
+			if (nodedef)
+				m_nodedef->deSerialize(tmp_os, proto_ver);
+			else
+				m_itemdef->deSerialize(tmp_os, proto_ver);
+		} catch (const BaseException &e) {
+			error = e.what();
+		}
+
+		std::lock_guard<std::mutex> lock(m_definitions_mutex);
+		if (!error.empty() && m_definitions_error.empty())
+			m_definitions_error = error;
+		received = true;
+		m_definition_jobs--;
+		m_definitions_cv.notify_all();
+	});
+}
+
+void Client::waitForDefinitions()
+{
+	std::unique_lock<std::mutex> lock(m_definitions_mutex);
+	m_definitions_cv.wait(lock, [this] { return m_definition_jobs == 0; });
+}
+
 void Client::afterContentReceived()
 {
 	infostream<<"Client::afterContentReceived() started"<<std::endl;
@@ -1822,6 +2044,11 @@ void Client::afterContentReceived()
 	assert(m_nodedef_received); // pre-condition
 	assert(mediaReceived()); // pre-condition
 
+	waitForDefinitions();
+	if (!m_definitions_error.empty())
+		throw SerializationError("Received broken content definitions: " +
+			m_definitions_error);
+
 	// Clear cached pre-scaled 2D GUI images, as this cache
 	// might have images with the same name but different
 	// content from previous sessions.
@@ -2010,24 +2237,51 @@ ParticleManager* Client::getParticleManager()
 
 scene::IAnimatedMesh* Client::getMesh(const std::string &filename, bool cache)
 {
-	StringMap::const_iterator it = m_mesh_data.find(filename);
-	if (it == m_mesh_data.end()) {
-		errorstream << "Client::getMesh(): Mesh not found: \"" << filename
-			<< "\"" << std::endl;
-		return NULL;
+	scene::IMeshCache *mesh_cache = m_rendering_engine->get_scene_manager()->getMeshCache();
+	scene::IAnimatedMesh *mesh = mesh_cache->getMeshByName(filename);
+	auto it_hash = m_mesh_hashes.find(filename);
+	if (!mesh && m_model_cache && it_hash != m_mesh_hashes.end()) {
+		// doesn't need the model file to be read
+		mesh = m_model_cache->load(filename, it_hash->second);
+		if (mesh) {
+			mesh_cache->addMesh(filename, mesh);
+			mesh->drop();
+		}
 	}
-	const std::string &data    = it->second;
 
-	// Create the mesh, remove it from cache and return it
-	// This allows unique vertex colors and other properties for each instance
-	io::IReadFile *rfile = m_rendering_engine->get_filesystem()->createMemoryReadFile(
-			data.c_str(), data.size(), filename.c_str());
-	FATAL_ERROR_IF(!rfile, "Could not create/open RAM file");
+	if (!mesh) {
+		StringMap::const_iterator it = m_mesh_data.find(filename);
+		if (it == m_mesh_data.end()) {
+			auto it_loader = m_mesh_loaders.find(filename);
+			if (it_loader == m_mesh_loaders.end()) {
+				errorstream << "Client::getMesh(): Mesh not found: \"" << filename
+					<< "\"" << std::endl;
+				return NULL;
+			}
+			// read on first use, the data is kept for more instances
+			std::string data = it_loader->second();
+			m_mesh_loaders.erase(it_loader);
+			if (data.empty())
+				return nullptr;
+			it = m_mesh_data.emplace(filename, std::move(data)).first;
+		}
+		const std::string &data    = it->second;
 
-	scene::IAnimatedMesh *mesh = m_rendering_engine->get_scene_manager()->getMesh(rfile);
-	rfile->drop();
-	if (!mesh)
-		return nullptr;
+		io::IReadFile *rfile = m_rendering_engine->get_filesystem()->createMemoryReadFile(
+				data.c_str(), data.size(), filename.c_str());
+		FATAL_ERROR_IF(!rfile, "Could not create/open RAM file");
+
+		mesh = m_rendering_engine->get_scene_manager()->getMesh(rfile);
+		rfile->drop();
+		if (!mesh)
+			return nullptr;
+		// before anything animates it
+		if (m_model_cache && it_hash != m_mesh_hashes.end())
+			m_model_cache->store(filename, it_hash->second, mesh);
+	}
+
+	// Return the mesh, removed from the cache
+	// This allows unique vertex colors and other properties for each instance
 	mesh->grab();
 	if (!cache)
 		m_rendering_engine->removeMesh(mesh);
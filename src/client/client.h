@@ -6,9 +6,13 @@
 
 #include "clientenvironment.h"
 #include "irrlichttypes.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <ostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <unordered_set>
@@ -29,7 +33,9 @@
 
 #define CLIENT_CHAT_MESSAGE_LIMIT_PER_10S 10.0f
 
+class BlockDecoder;
 class Camera;
+class ClientBlockCache;
 class ClientMediaDownloader;
 class ISoundManager;
 class IWritableItemDefManager;
@@ -40,12 +46,14 @@ class MapDatabase;
 class MeshUpdateManager;
 class Minimap;
 class ModChannelMgr;
+class ModelCache;
 class MtEventManager;
 class NetworkPacket;
 class NodeDefManager;
 class ParticleManager;
 class RenderingEngine;
 class SingleMediaDownloader;
+class ZstdStreamDecompressor;
 struct ChatMessage;
 struct ClientDynamicInfo;
 struct ClientEvent;
@@ -60,6 +68,9 @@ struct ItemVisualsManager;
 namespace con {
 class IConnection;
 }
+namespace video {
+class IImage;
+}
 using sound_handle_t = int;
 
 enum LocalClientState {
@@ -167,6 +178,9 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void handleCommand_AccessDenied(NetworkPacket* pkt);
 	void handleCommand_RemoveNode(NetworkPacket* pkt);
 	void handleCommand_AddNode(NetworkPacket* pkt);
+	void handleCommand_NodesChanged(NetworkPacket* pkt);
+	void handleCommand_BlockHash(NetworkPacket* pkt);
+	void handleCommand_ObjectMovement(NetworkPacket* pkt);
 	void handleCommand_NodemetaChanged(NetworkPacket *pkt);
 	void handleCommand_BlockData(NetworkPacket* pkt);
 	void handleCommand_Inventory(NetworkPacket* pkt);
@@ -180,6 +194,9 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void handleCommand_Breath(NetworkPacket* pkt);
 	void handleCommand_MovePlayer(NetworkPacket* pkt);
 	void handleCommand_MovePlayerRel(NetworkPacket* pkt);
+	void handleCommand_Bundle(NetworkPacket* pkt);
+	void handleCommand_CompressedBundle(NetworkPacket* pkt);
+	void handleCommand_Transfer(NetworkPacket* pkt);
 	void handleCommand_DeathScreenLegacy(NetworkPacket* pkt);
 	void handleCommand_AnnounceMedia(NetworkPacket* pkt);
 	void handleCommand_Media(NetworkPacket* pkt);
@@ -192,7 +209,10 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void handleCommand_InventoryFormSpec(NetworkPacket* pkt);
 	void handleCommand_DetachedInventory(NetworkPacket* pkt);
 	void handleCommand_ShowFormSpec(NetworkPacket* pkt);
+	void handleCommand_ShowFormSpecDelta(NetworkPacket* pkt);
 	void handleCommand_SpawnParticle(NetworkPacket* pkt);
+	void handleCommand_ParticleDefinition(NetworkPacket* pkt);
+	void handleCommand_SpawnDefinedParticle(NetworkPacket* pkt);
 	void handleCommand_AddParticleSpawner(NetworkPacket* pkt);
 	void handleCommand_DeleteParticleSpawner(NetworkPacket* pkt);
 	void handleCommand_HudAdd(NetworkPacket* pkt);
@@ -304,6 +324,8 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	// Including blocks at appropriate edges
 	void addUpdateMeshTaskWithEdge(v3s16 blockpos, bool ack_to_server=false, bool urgent=false);
 	void addUpdateMeshTaskForNode(v3s16 nodepos, bool ack_to_server=false, bool urgent=false);
+	// Changes whenever a block is updated, which all changes of the map go through
+	u32 getMapChanges() const { return m_map_changes; }
 
 	bool hasClientEvents() const { return !m_client_event_queue.empty(); }
 	// Get event from queue. If queue is empty, it triggers an assertion failure.
@@ -313,6 +335,11 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 
 	bool reconnectRequested() const { return m_access_denied_reconnect; }
 
+	// Set if the server moved us to another server of the same world
+	bool transferRequested() const { return m_transfer_port != 0; }
+	const std::string &getTransferAddress() const { return m_transfer_address; }
+	u16 getTransferPort() const { return m_transfer_port; }
+
 	void setFatalError(const std::string &reason)
 	{
 		m_access_denied = true;
@@ -392,8 +419,22 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 
 	// The following set of functions is used by ClientMediaDownloader
 	// Insert a media file appropriately into the appropriate manager
+	// sha1: the checked SHA-1 of data
+	// decoded: the image decoded from data before, ownership is taken
 	bool loadMedia(const std::string &data, const std::string &filename,
-		bool from_media_push = false);
+		const std::string &sha1, bool from_media_push = false,
+		video::IImage *decoded = nullptr);
+
+	// Registers a sound or model that is only read by `loader` when it's
+	// first used. Returns false if the file is of another kind.
+	bool loadMediaLazy(const std::string &filename, const std::string &sha1,
+		std::function<std::string()> &&loader);
+	static bool isLazyMedia(const std::string &filename);
+
+	// Decodes an image media file, may be called from any thread
+	// Returns nullptr if the file is no image or broken
+	video::IImage *decodeMediaImage(const std::string &data,
+		const std::string &filename);
 
 	// Send a request for conventional media transfer
 	void request_media(const std::vector<std::string> &file_requests);
@@ -454,8 +495,19 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void deletingPeer(con::IPeer *peer, bool timeout) override;
 
 	void initLocalMapSaving(const Address &address, const std::string &hostname);
+	void initBlockCache(const Address &address, const std::string &hostname);
 
 	void ReceiveAll();
+	// Moves blocks that finished decoding into the map
+	// wait: first wait for the ones that are still being decoded
+	void insertDecodedBlocks(bool wait);
+
+	// Decompresses and deserializes item or node definitions as a job,
+	// so that the media can be received meanwhile. Sets received after.
+	void deserializeDefinitions(std::string data, bool nodedef,
+		std::atomic<bool> &received);
+	// Waits until the definitions are deserialized
+	void waitForDefinitions();
 
 	void sendPlayerPos();
 
@@ -467,6 +519,7 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void startAuth(AuthMechanism chosen_auth_mechanism);
 	void sendDeletedBlocks(std::vector<v3s16> &blocks);
 	void sendGotBlocks(const std::vector<v3s16> &blocks);
+	void sendRequestBlocks();
 	void sendRemovedSounds(const std::vector<s32> &soundList);
 
 	bool canSendChatMessage() const;
@@ -502,6 +555,8 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	// Used version of the protocol with server
 	// If 0, server init hasn't been received yet.
 	u16 m_proto_ver = 0;
+	// Sequence number of the last TOSERVER_PLAYER_MOVE
+	u16 m_player_move_seq = 0;
 
 	bool m_update_wielded_item = false;
 	std::unique_ptr<Inventory> m_inventory_from_server;
@@ -535,9 +590,18 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	bool m_access_denied = false;
 	bool m_access_denied_reconnect = false;
 	std::string m_access_denied_reason = "";
+	std::string m_transfer_address;
+	u16 m_transfer_port = 0;
+	u32 m_map_changes = 0;
 	std::queue<ClientEvent *> m_client_event_queue;
-	bool m_itemdef_received = false;
-	bool m_nodedef_received = false;
+	// Set by the jobs of deserializeDefinitions()
+	std::atomic<bool> m_itemdef_received{false};
+	std::atomic<bool> m_nodedef_received{false};
+	std::mutex m_definitions_mutex;
+	std::condition_variable m_definitions_cv;
+	u32 m_definition_jobs = 0;
+	// what the first broken definitions threw
+	std::string m_definitions_error;
 	bool m_activeobjects_received = false;
 	bool m_mods_loaded = false;
 
@@ -567,8 +631,32 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	// key = name
 	std::unordered_map<std::string, Inventory*> m_detached_inventories;
 
+	// Last formspec shown by the server, TOCLIENT_SHOW_FORMSPEC_DELTA changes it
+	std::string m_last_formspec;
+	std::string m_last_formspec_name;
+
+	// Serialized particle parameters by id, see TOCLIENT_PARTICLE_DEFINITION
+	std::unordered_map<u16, std::string> m_particle_definitions;
+
+	// Streams of TOCLIENT_COMPRESSED_BUNDLE, by channel
+	std::unique_ptr<ZstdStreamDecompressor> m_bundle_streams[3];
+
 	// Storage for mesh data for creating multiple instances of the same mesh
 	StringMap m_mesh_data;
+	// Models that aren't read yet, see loadMediaLazy()
+	std::unordered_map<std::string, std::function<std::string()>> m_mesh_loaders;
+	// SHA-1 of the models, to find them in m_model_cache
+	StringMap m_mesh_hashes;
+	// Skinned models that were built before, may be null
+	std::unique_ptr<ModelCache> m_model_cache;
+
+	// Decodes received blocks on other threads
+	std::unique_ptr<BlockDecoder> m_block_decoder;
+	// Blocks received from this server before, may be null
+	std::unique_ptr<ClientBlockCache> m_block_cache;
+	// Announced by TOCLIENT_BLOCK_HASH but not in m_block_cache
+	std::vector<v3s16> m_blocks_to_request;
+	IntervalLimiter m_block_cache_save_interval;
 
 	// own state
 	LocalClientState m_state;
@@ -0,0 +1,64 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "clientblockcache.h"
+#include "database/database-sqlite3.h"
+#include "filesys.h"
+#include "util/hashing.h"
+
+/*
+	Stored as:
+	u8 serialization version
+	u8[20] SHA-1 of the data
+	data as sent in TOCLIENT_BLOCKDATA after the position
+*/
+static constexpr size_t HEADER_SIZE = 1 + hashing::SHA1_DIGEST_SIZE;
+
+ClientBlockCache::ClientBlockCache(const std::string &dir)
+{
+	fs::CreateAllDirs(dir);
+	m_db = std::make_unique<MapDatabaseSQLite3>(dir, "blocks");
+	m_db->beginSave();
+}
+
+ClientBlockCache::~ClientBlockCache()
+{
+	m_db->endSave();
+}
+
+bool ClientBlockCache::load(v3s16 pos, const std::string &sha1, u8 version,
+		std::string &data)
+{
+	if (sha1.size() != hashing::SHA1_DIGEST_SIZE)
+		return false;
+
+	std::string stored;
+	m_db->loadBlock(pos, &stored);
+	if (stored.size() < HEADER_SIZE || (u8)stored[0] != version ||
+			stored.compare(1, sha1.size(), sha1) != 0)
+		return false;
+
+	data = stored.substr(HEADER_SIZE);
+	return true;
+}
+
+void ClientBlockCache::store(v3s16 pos, const std::string &sha1, u8 version,
+		std::string_view data)
+{
+	if (sha1.size() != hashing::SHA1_DIGEST_SIZE)
+		return;
+
+	std::string stored;
+	stored.reserve(HEADER_SIZE + data.size());
+	stored.push_back((char)version);
+	stored.append(sha1);
+	stored.append(data);
+	m_db->saveBlock(pos, stored);
+}
+
+void ClientBlockCache::flush()
+{
+	m_db->endSave();
+	m_db->beginSave();
+}
@@ -0,0 +1,40 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+
+class MapDatabase;
+
+/*
+	Keeps the blocks received from one server on disk, so that joining it
+	again only has to download the blocks that changed.
+
+	The server announces blocks with TOCLIENT_BLOCK_HASH, a block is only
+	used if the SHA-1 of its stored data and its serialization version
+	match.
+*/
+class ClientBlockCache
+{
+public:
+	ClientBlockCache(const std::string &dir);
+	~ClientBlockCache();
+
+	// Returns false if the block isn't stored with this hash
+	bool load(v3s16 pos, const std::string &sha1, u8 version, std::string &data);
+
+	void store(v3s16 pos, const std::string &sha1, u8 version,
+		std::string_view data);
+
+	// Writes the blocks stored since the last call to disk
+	void flush();
+
+private:
+	std::unique_ptr<MapDatabase> m_db;
+};
@@ -12,6 +12,7 @@
 #include "scripting_client.h"
 #include "mapblock_mesh.h"
 #include "mtevent.h"
+#include "network/networkprotocol.h"
 #include "collision.h"
 #include "nodedef.h"
 #include "profiler.h"
@@ -22,6 +23,7 @@
 #include "content_cao.h"
 #include "porting.h"
 #include <algorithm>
+#include "client/frametimings.h"
 #include "client/renderingengine.h"
 
 /*
@@ -227,8 +229,10 @@ void ClientEnvironment::step(float dtime)
 		}
 	}
 
-	if (m_client->modsLoaded())
+	if (m_client->modsLoaded()) {
+		FrameTimingScope timing("Lua");
 		m_script->environment_step(dtime);
+	}
 
 	// Update lighting on local player (used for wield item)
 	u32 day_night_ratio = getDayNightRatio();
@@ -383,6 +387,117 @@ void ClientEnvironment::processActiveObjectMessage(u16 id, const std::string &da
 	}
 }
 
+// Layout of AO_CMD_UPDATE_POSITION, see UnitSAO::generateUpdatePositionCommand()
+constexpr size_t AOM_UPDATE_POSITION_SIZE = 55;
+
+void ClientEnvironment::processActiveObjectMessages(const u8 *data, size_t size)
+{
+	/*
+		for all objects
+		{
+			u16 id
+			u16 message length
+			string message
+		}
+	*/
+	size_t pos = 0;
+	while (size - pos >= 4) {
+		const u16 id = readU16(&data[pos]);
+		const u16 len = readU16(&data[pos + 2]);
+		pos += 4;
+		if (len > size - pos) {
+			errorstream << "ClientEnvironment::processActiveObjectMessages(): "
+				<< "message for id=" << id << " is truncated" << std::endl;
+			break;
+		}
+		const u8 *msg = &data[pos];
+		pos += len;
+
+		if (len >= AOM_UPDATE_POSITION_SIZE && msg[0] == AO_CMD_UPDATE_POSITION) {
+			AOPositionUpdate &update = m_position_updates.emplace_back();
+			update.id = id;
+			update.position = readV3F32(&msg[1]);
+			update.velocity = readV3F32(&msg[13]);
+			update.acceleration = readV3F32(&msg[25]);
+			update.rotation = readV3F32(&msg[37]);
+			update.do_interpolate = msg[49];
+			update.is_end_position = msg[50];
+			update.update_interval = readF32(&msg[51]);
+			continue;
+		}
+
+		// keep the order of the messages
+		applyPositionUpdates();
+		processActiveObjectMessage(id, std::string(reinterpret_cast<const char *>(msg), len));
+	}
+	applyPositionUpdates();
+}
+
+void ClientEnvironment::processObjectMovement(u16 seq, const u8 *data, size_t size)
+{
+	/*
+		for all objects
+		{
+			u16 id
+			u8 flags
+			v3s32 position * 100
+			v3s16 velocity * MOVEMENT_SPEED_SCALE
+			if flags & MOVEMENT_ACCELERATION:
+				v3s16 acceleration * MOVEMENT_SPEED_SCALE
+			v3u16 rotation, 65536 = 360 degrees
+			u16 update interval in ms
+		}
+	*/
+	const auto read_speed = [] (const u8 *p) {
+		return v3f(readS16(p), readS16(p + 2), readS16(p + 4)) / MOVEMENT_SPEED_SCALE;
+	};
+	const auto read_rotation = [] (const u8 *p) {
+		return v3f(readU16(p), readU16(p + 2), readU16(p + 4)) * (360.0f / 65536.0f);
+	};
+
+	size_t pos = 0;
+	while (size - pos >= 27) {
+		const u8 *msg = &data[pos];
+		const u8 flags = msg[2];
+		const size_t len = (flags & MOVEMENT_ACCELERATION) ? 33 : 27;
+		if (len > size - pos) {
+			errorstream << "ClientEnvironment::processObjectMovement(): "
+				<< "data is truncated" << std::endl;
+			break;
+		}
+		pos += len;
+
+		AOPositionUpdate &update = m_position_updates.emplace_back();
+		update.id = readU16(msg);
+		update.position = v3f(readS32(&msg[3]), readS32(&msg[7]),
+			readS32(&msg[11])) / 100.0f;
+		update.velocity = read_speed(&msg[15]);
+		msg += 21;
+		if (flags & MOVEMENT_ACCELERATION) {
+			update.acceleration = read_speed(msg);
+			msg += 6;
+		} else {
+			update.acceleration = v3f();
+		}
+		update.rotation = read_rotation(msg);
+		update.do_interpolate = flags & MOVEMENT_INTERPOLATE;
+		update.is_end_position = flags & MOVEMENT_END_POSITION;
+		update.update_interval = readU16(&msg[6]) / 1000.0f;
+		update.seq = seq;
+	}
+	applyPositionUpdates();
+}
+
+void ClientEnvironment::applyPositionUpdates()
+{
+	for (const AOPositionUpdate &update : m_position_updates) {
+		ClientActiveObject *obj = getActiveObject(update.id);
+		if (obj)
+			obj->processPositionUpdate(update);
+	}
+	m_position_updates.clear();
+}
+
 /*
 	Callbacks for activeobjects
 */
@@ -97,6 +97,11 @@ class ClientEnvironment : public Environment
 	void removeActiveObject(u16 id);
 
 	void processActiveObjectMessage(u16 id, const std::string &data);
+	// Processes the messages of TOCLIENT_ACTIVE_OBJECT_MESSAGES in order.
+	// Position updates are decoded in bulk, without a stream for each.
+	void processActiveObjectMessages(const u8 *data, size_t size);
+	// Processes the data of TOCLIENT_OBJECT_MOVEMENT
+	void processObjectMovement(u16 seq, const u8 *data, size_t size);
 
 	/*
 		Callbacks for activeobjects
@@ -126,6 +131,12 @@ class ClientEnvironment : public Environment
 		const std::optional<Pointabilities> &pointabilities
 	);
 
+	// Whether objects with selection boxes may be on the shootline
+	bool hasSelectableObjects(const core::line3d<f32> &shootline_on_map)
+	{
+		return !m_ao_manager.getActiveSelectableObjects(shootline_on_map).empty();
+	}
+
 	const std::set<std::string> &getPlayerNames() { return m_player_names; }
 	void addPlayerName(const std::string &name) { m_player_names.insert(name); }
 	void removePlayerName(const std::string &name) { m_player_names.erase(name); }
@@ -138,6 +149,8 @@ class ClientEnvironment : public Environment
 	u64 getFrameTimeDelta() const { return m_frame_dtime; }
 
 private:
+	void applyPositionUpdates();
+
 	irr_ptr<ClientMap> m_map;
 	LocalPlayer *m_local_player = nullptr;
 	ITextureSource *m_texturesource;
@@ -145,6 +158,8 @@ class ClientEnvironment : public Environment
 	ClientScripting *m_script = nullptr;
 	client::ActiveObjectMgr m_ao_manager;
 	std::vector<ClientSimpleObject*> m_simple_objects;
+	// Decoded by processActiveObjectMessages() and not applied yet
+	std::vector<AOPositionUpdate> m_position_updates;
 	std::queue<ClientEnvEvent> m_client_event_queue;
 	IntervalLimiter m_active_object_light_update_interval;
 	std::set<std::string> m_player_names;
@@ -141,6 +141,8 @@ bool ClientLauncher::run(GameStartData &start_data, const Settings &cmd_args)
 	// It is then displayed before the menu shows on the next call to menu()
 	std::string error_message;
 	bool reconnect_requested = false;
+	// Set by the game if the server moved us to another server
+	ServerTransfer transfer;
 
 	bool first_loop = true;
 
@@ -175,21 +177,30 @@ bool ClientLauncher::run(GameStartData &start_data, const Settings &cmd_args)
 			guiroot = m_rendering_engine->get_gui_env()->addStaticText(L"",
 				core::rect<s32>(0, 0, 10000, 10000));
 
-			bool should_run_game = launch_game(error_message, reconnect_requested,
-				start_data, cmd_args);
-
-			// Reset the reconnect_requested flag
-			reconnect_requested = false;
-
-			// If skip_main_menu, we only want to startup once
-			if (skip_main_menu && !first_loop)
-				break;
-			first_loop = false;
-
-			if (!should_run_game) {
-				if (skip_main_menu)
+			if (transfer.port != 0) {
+				// Connect to the other server right away with the same
+				// name and password, without going through the menu
+				start_data.address = transfer.address;
+				start_data.socket_port = transfer.port;
+				start_data.local_server = false;
+				transfer = ServerTransfer();
+			} else {
+				bool should_run_game = launch_game(error_message, reconnect_requested,
+					start_data, cmd_args);
+
+				// Reset the reconnect_requested flag
+				reconnect_requested = false;
+
+				// If skip_main_menu, we only want to startup once
+				if (skip_main_menu && !first_loop)
 					break;
-				continue;
+				first_loop = false;
+
+				if (!should_run_game) {
+					if (skip_main_menu)
+						break;
+					continue;
+				}
 			}
 
 			// Break out of menu-game loop to shut down cleanly
@@ -203,7 +214,8 @@ bool ClientLauncher::run(GameStartData &start_data, const Settings &cmd_args)
 				start_data,
 				error_message,
 				chat_backend,
-				&reconnect_requested
+				&reconnect_requested,
+				&transfer
 			);
 #ifdef NDEBUG
 		} catch (std::exception &e) {
@@ -231,7 +243,7 @@ bool ClientLauncher::run(GameStartData &start_data, const Settings &cmd_args)
 			g_settings->updateConfigFile(g_settings_path.c_str());
 
 		// If no main menu, show error and exit
-		if (skip_main_menu) {
+		if (skip_main_menu && transfer.port == 0) {
 			if (!error_message.empty())
 				retval = false;
 			break;
@@ -16,6 +16,7 @@
 #include "settings.h"
 #include "camera.h"               // CameraModes
 #include "util/basic_macros.h"
+#include "util/thread.h"
 #include "util/tracy_wrapper.h"
 #include "client/renderingengine.h"
 
@@ -121,10 +122,11 @@ namespace {
 		return b >= a ? T(0) : (a - b);
 	}
 
-	// file-scope thread-local instances of the above two data structures, because
+	// file-scope thread-local instances of these data structures, because
 	// allocating memory in a hot path can be expensive.
 	thread_local MeshBufListMaps tl_meshbuflistmaps;
 	thread_local DrawDescriptorList tl_drawdescriptorlist;
+	thread_local video::SDrawBatch tl_drawbatch;
 }
 
 void CachedMeshBuffer::drop()
@@ -151,6 +153,31 @@ static const std::string ClientMap_settings[] = {
 	"transparency_sorting_distance",
 	"occlusion_culler",
 	"enable_raytraced_culling",
+	"enable_depth_culling",
+};
+
+/*
+	Builds the draw list of a ClientMap while the main thread renders
+*/
+class DrawListThread : public UpdateThread
+{
+public:
+	DrawListThread(ClientMap *map) : UpdateThread("DrawList"), m_map(map) {}
+
+	// Waits for the update requested with deferUpdate()
+	void waitDone() { m_done.wait(); }
+
+protected:
+	void doUpdate() override
+	{
+		m_map->buildDrawList();
+		m_map->sortTransparentMeshes();
+		m_done.post();
+	}
+
+private:
+	ClientMap *m_map;
+	Semaphore m_done;
 };
 
 ClientMap::ClientMap(
@@ -165,7 +192,8 @@ ClientMap::ClientMap(
 	m_client(client),
 	m_rendering_engine(rendering_engine),
 	m_control(control),
-	m_drawlist(MapBlockComparer(v3s16(0,0,0)))
+	m_drawlist(MapBlockComparer(v3s16(0,0,0))),
+	m_next_drawlist(MapBlockComparer(v3s16(0,0,0)))
 {
 
 	/*
@@ -179,6 +207,14 @@ ClientMap::ClientMap(
 		g_settings->registerChangedCallback(name, on_settings_changed, this);
 	// load all settings at once
 	onSettingChanged("", true);
+
+	// the mesh threads don't pick up changes either
+	m_mesh_lod_distance = g_settings->getU16("mesh_lod_distance") * BS;
+
+	if (g_settings->getBool("threaded_draw_list")) {
+		m_drawlist_thread = std::make_unique<DrawListThread>(this);
+		m_drawlist_thread->start();
+	}
 }
 
 void ClientMap::onSettingChanged(std::string_view name, bool all)
@@ -198,12 +234,20 @@ void ClientMap::onSettingChanged(std::string_view name, bool all)
 		m_loops_occlusion_culler = g_settings->get("occlusion_culler") == "loops";
 	if (all || name == "enable_raytraced_culling")
 		m_enable_raytraced_culling = g_settings->getBool("enable_raytraced_culling");
+	if (all || name == "enable_depth_culling")
+		m_enable_depth_culling = g_settings->getBool("enable_depth_culling");
 }
 
 ClientMap::~ClientMap()
 {
 	g_settings->deregisterAllChangedCallbacks(this);
 
+	if (m_drawlist_thread) {
+		finishDrawListUpdate();
+		m_drawlist_thread->stop();
+		m_drawlist_thread->wait();
+	}
+
 	for (auto &it : m_dynamic_buffers)
 		it.second.drop();
 }
@@ -353,20 +397,103 @@ class MapBlockFlags
 
 void ClientMap::updateDrawList()
 {
-	ScopeProfiler sp(g_profiler, "CM::updateDrawList()", SPT_AVG);
+	startDrawListUpdate();
+	finishDrawListUpdate();
+}
+
+void ClientMap::startDrawListUpdate()
+{
+	// one at a time
+	finishDrawListUpdate();
 
 	m_needs_update_drawlist = false;
+	m_sort_transparent = m_needs_update_transparent_meshes;
+	m_needs_update_transparent_meshes = false;
+	m_sort_group_by_buffers = m_cache_transparency_sorting_group_by_buffers;
+	m_sort_distance = m_cache_transparency_sorting_distance * BS;
 
-	for (auto &i : m_drawlist) {
-		MapBlock *block = i.second;
-		block->refDrop();
+	m_drawlist_pending = true;
+	if (m_drawlist_thread) {
+		m_drawlist_thread->deferUpdate();
+	} else {
+		buildDrawList();
+		sortTransparentMeshes();
 	}
-	m_drawlist.clear();
+}
 
-	for (auto &block : m_keeplist) {
+void ClientMap::finishDrawListUpdate()
+{
+	if (!m_drawlist_pending)
+		return;
+	if (m_drawlist_thread)
+		m_drawlist_thread->waitDone();
+	m_drawlist_pending = false;
+
+	// The thread doesn't touch the reference counts, they aren't atomic.
+	// Blocks in view are kept alive here, touchMapBlocks() only has to
+	// care about the ones out of view.
+	for (auto &i : m_next_drawlist) {
+		i.second->refGrab();
+		i.second->resetUsageTimer();
+	}
+	for (MapBlock *block : m_next_keeplist) {
+		block->refGrab();
+		block->resetUsageTimer();
+	}
+	for (auto &i : m_drawlist)
+		i.second->refDrop();
+	for (MapBlock *block : m_keeplist)
 		block->refDrop();
+
+	std::swap(m_drawlist, m_next_drawlist);
+	m_keeplist.swap(m_next_keeplist);
+	m_next_drawlist.clear();
+	m_next_keeplist.clear();
+
+	for (MapBlockMesh *mesh : m_sorted_meshes)
+		mesh->applyTransparentOrder();
+	for (MapBlockMesh *mesh : m_unsorted_meshes)
+		mesh->consolidateTransparentBuffers();
+	m_sorted_meshes.clear();
+	m_unsorted_meshes.clear();
+
+	updateMeshLods();
+}
+
+void ClientMap::updateMeshLods()
+{
+	if (m_mesh_lod_distance <= 0)
+		return;
+
+	// keeps meshes from being remade back and forth at a step
+	constexpr f32 margin = MAP_BLOCKSIZE * BS;
+
+	std::unordered_map<v3s16, MapBlockMesh *> lod_updates;
+	for (auto &i : m_drawlist) {
+		MapBlock *block = i.second;
+		MapBlockMesh *mesh = block->mesh;
+		if (!mesh)
+			continue;
+		const f32 d = m_camera_position.getDistanceFrom(
+				intToFloat(block->getPosRelative(), BS) + mesh->getBoundingSphereCenter());
+		const u16 lod = mesh->getLod();
+		if (lod >= getMeshLod(d - margin, m_mesh_lod_distance) &&
+				lod <= getMeshLod(d + margin, m_mesh_lod_distance))
+			continue;
+
+		// once, until the mesh is replaced
+		auto it = m_lod_updates.find(i.first);
+		if (it == m_lod_updates.end() || it->second != mesh)
+			m_client->addUpdateMeshTask(i.first);
+		lod_updates.emplace(i.first, mesh);
 	}
-	m_keeplist.clear();
+	m_lod_updates = std::move(lod_updates);
+	g_profiler->avg("CM: meshes with wrong LOD [#]", m_lod_updates.size());
+}
+
+void ClientMap::buildDrawList()
+{
+	ScopeProfiler sp(g_profiler, "CM::updateDrawList()", SPT_AVG);
 
 	const v3s16 cam_pos_nodes = floatToInt(m_camera_position, BS);
 
@@ -392,7 +519,7 @@ void ClientMap::updateDrawList()
 	}
 
 	const v3s16 camera_block = getContainerPos(cam_pos_nodes, MAP_BLOCKSIZE);
-	m_drawlist = decltype(m_drawlist)(MapBlockComparer(camera_block));
+	m_next_drawlist = decltype(m_next_drawlist)(MapBlockComparer(camera_block));
 
 	auto is_frustum_culled = m_client->getCamera()->getFrustumCuller();
 
@@ -481,13 +608,11 @@ void ClientMap::updateDrawList()
 					// (where all coordinate are divisible by the chunk size)
 					// Add them to the de-dup set.
 					shortlist.emplace(mesh_grid.getMeshPos(block->getPos()));
-					// All other blocks we can grab and add to the keeplist right away.
-					m_keeplist.push_back(block);
-					block->refGrab();
+					// All other blocks we can add to the keeplist right away.
+					m_next_keeplist.push_back(block);
 				} else if (mesh) {
 					// without mesh chunking we can add the block to the drawlist
-					block->refGrab();
-					m_drawlist.emplace(block->getPos(), block);
+					m_next_drawlist.emplace(block->getPos(), block);
 				}
 			}
 		}
@@ -509,6 +634,14 @@ void ClientMap::updateDrawList()
 		// [ visited | 0 | 0 | 0 | 0 | Z visible | Y visible | X visible ]
 		MapBlockFlags meshes_seen(mesh_grid.getCellPos(p_blocks_min), mesh_grid.getCellPos(p_blocks_max) + 1);
 
+		// Covers more than the view, as this list is used until the camera
+		// has turned by 0.2 rad, see Game::updateFrame()
+		const bool depth_culling = occlusion_culling_enabled && m_enable_depth_culling;
+		if (depth_culling)
+			m_occlusion_buffer.reset(m_camera_position, m_camera_direction, m_camera_fov / 2 + 0.2f);
+		// Number of blocks culled by the occlusion buffer
+		u32 blocks_depth_culled = 0;
+
 		// Start breadth-first search with the block the camera is in
 		blocks_to_consider.push(camera_mesh);
 		meshes_seen.getChunk(camera_cell).getBits(camera_cell) = 0x07; // mark all sides as visible
@@ -574,6 +707,17 @@ void ClientMap::updateDrawList()
 			// Occluded near sides will further occlude the far sides
 			u8 visible_outer_sides = flags & 0x07;
 
+			// Occlusion culling by the near blocks' solid sides, which also
+			// stops the search here
+			if (depth_culling && block_coord != camera_mesh) {
+				const f32 cell_size = mesh_grid.cell_size * MAP_BLOCKSIZE * BS;
+				v3f box_min = intToFloat(block_pos_nodes, BS) - 0.5f * BS;
+				if (m_occlusion_buffer.isOccluded(aabb3f(box_min, box_min + cell_size))) {
+					blocks_depth_culled++;
+					continue;
+				}
+			}
+
 			// Raytraced occlusion culling - send rays from the camera to the block's corners
 			if (occlusion_culling_enabled && m_enable_raytraced_culling &&
 					block && mesh &&
@@ -582,20 +726,20 @@ void ClientMap::updateDrawList()
 				continue;
 			}
 
+			if (depth_culling && block && block->solid_sides)
+				addMeshOccluders(block, mesh_grid.cell_size);
+
 			if (mesh_grid.cell_size > 1) {
 				// Block meshes are stored in the corner block of a chunk
 				// (where all coordinate are divisible by the chunk size)
 				// Add them to the de-dup set.
 				shortlist.emplace(block_coord.X, block_coord.Y, block_coord.Z);
-				// All other blocks we can grab and add to the keeplist right away.
-				if (block) {
-					m_keeplist.push_back(block);
-					block->refGrab();
-				}
+				// All other blocks we can add to the keeplist right away.
+				if (block)
+					m_next_keeplist.push_back(block);
 			} else if (mesh) {
 				// without mesh chunking we can add the block to the drawlist
-				block->refGrab();
-				m_drawlist.emplace(block_coord, block);
+				m_next_drawlist.emplace(block_coord, block);
 			}
 
 			// Decide which sides to traverse next or to block away
@@ -697,23 +841,22 @@ void ClientMap::updateDrawList()
 					traverse_far_side(+mesh_grid.cell_size);
 			}
 		}
+		g_profiler->avg("MapBlocks depth culled [#]", blocks_depth_culled);
 		g_profiler->avg("MapBlocks sides skipped [#]", sides_skipped);
 		g_profiler->avg("MapBlocks examined [#]", blocks_visited);
 	}
 	g_profiler->avg("MapBlocks shortlist [#]", shortlist.size());
 
-	assert(m_drawlist.empty() || shortlist.empty());
+	assert(m_next_drawlist.empty() || shortlist.empty());
 	for (auto pos : shortlist) {
 		MapBlock *block = getBlockNoCreateNoEx(pos);
-		if (block) {
-			block->refGrab();
-			m_drawlist.emplace(pos, block);
-		}
+		if (block)
+			m_next_drawlist.emplace(pos, block);
 	}
 
 	g_profiler->avg("MapBlocks occlusion culled [#]", blocks_occlusion_culled);
 	g_profiler->avg("MapBlocks frustum culled [#]", blocks_frustum_culled);
-	g_profiler->avg("MapBlocks drawn [#]", m_drawlist.size());
+	g_profiler->avg("MapBlocks drawn [#]", m_next_drawlist.size());
 }
 
 void ClientMap::touchMapBlocks()
@@ -729,27 +872,14 @@ void ClientMap::touchMapBlocks()
 	v3s16 p_blocks_max;
 	getBlocksInViewRange(cam_pos_nodes, &p_blocks_min, &p_blocks_max);
 
-	// Number of blocks currently loaded by the client
-	u32 blocks_loaded = 0;
 	// Number of blocks with mesh in rendering range
 	u32 blocks_in_range_with_mesh = 0;
 
-	for (const auto &sector_it : m_sectors) {
-		const MapSector *sector = sector_it.second;
-		v2s16 sp = sector->getPos();
-
-		blocks_loaded += sector->size();
-		if (!m_control.range_all) {
-			if (sp.X < p_blocks_min.X || sp.X > p_blocks_max.X ||
-					sp.Y < p_blocks_min.Z || sp.Y > p_blocks_max.Z)
+	auto touch_sector = [&] (const MapSector *sector) {
+		for (const auto &entry : sector->getBlocks()) {
+			if (entry.first < p_blocks_min.Y || entry.first > p_blocks_max.Y)
 				continue;
-		}
 
-		/*
-			Loop through blocks in sector
-		*/
-
-		for (const auto &entry : sector->getBlocks()) {
 			MapBlock *block = entry.second.get();
 			MapBlockMesh *mesh = block->mesh;
 
@@ -770,8 +900,7 @@ void ClientMap::touchMapBlocks()
 			}
 
 			// First, perform a simple distance check.
-			if (!m_control.range_all &&
-				mesh_sphere_center.getDistanceFrom(m_camera_position) >
+			if (mesh_sphere_center.getDistanceFrom(m_camera_position) >
 					m_control.wanted_range * BS + mesh_sphere_radius)
 				continue; // Out of range, skip.
 
@@ -779,10 +908,31 @@ void ClientMap::touchMapBlocks()
 			block->resetUsageTimer();
 			blocks_in_range_with_mesh++;
 		}
+	};
+
+	// Look up the sectors in view range, unless more of them are in range
+	// than loaded, so that this doesn't scale with all loaded blocks
+	const s64 sectors_in_range = (s64)(p_blocks_max.X - p_blocks_min.X + 1) *
+			(p_blocks_max.Z - p_blocks_min.Z + 1);
+	if (sectors_in_range < (s64)m_sectors.size()) {
+		for (s16 x = p_blocks_min.X; x <= p_blocks_max.X; x++)
+		for (s16 z = p_blocks_min.Z; z <= p_blocks_max.Z; z++) {
+			auto it = m_sectors.find(v2s16(x, z));
+			if (it != m_sectors.end())
+				touch_sector(it->second);
+		}
+	} else {
+		for (const auto &sector_it : m_sectors) {
+			v2s16 sp = sector_it.first;
+			if (sp.X < p_blocks_min.X || sp.X > p_blocks_max.X ||
+					sp.Y < p_blocks_min.Z || sp.Y > p_blocks_max.Z)
+				continue;
+			touch_sector(sector_it.second);
+		}
 	}
 
 	g_profiler->avg("MapBlock meshes in range [#]", blocks_in_range_with_mesh);
-	g_profiler->avg("MapBlocks loaded [#]", blocks_loaded);
+	g_profiler->avg("MapBlocks loaded [#]", m_block_index.size());
 }
 
 void MeshBufListMaps::addFromBlock(v3s16 block_pos, MapBlockMesh *block_mesh,
@@ -860,7 +1010,8 @@ static u32 transformBuffersToDrawOrder(
 	u32 can_merge = 0;
 	u32 total_vtx = 0, total_idx = 0;
 	for (auto &pair : src) {
-		if (pair.second->getVertexCount() < target_min_vertices) {
+		if (pair.second->getVertexCount() < target_min_vertices &&
+				pair.second->getVertexType() == video::EVT_STANDARD) {
 			can_merge++;
 			total_vtx += pair.second->getVertexCount();
 			total_idx += pair.second->getIndexCount();
@@ -872,7 +1023,9 @@ static u32 transformBuffersToDrawOrder(
 	for (auto it = src.rbegin(); it != src.rend(); ++it) {
 		v3f translate = get_world_pos(it->first);
 		auto *buf = it->second;
-		if (can_merge < 2 || buf->getVertexCount() >= target_min_vertices) {
+		// buffers with array textures already hold many tiles each
+		if (can_merge < 2 || buf->getVertexCount() >= target_min_vertices ||
+				buf->getVertexType() != video::EVT_STANDARD) {
 			draw_order.emplace_back(translate, buf);
 			continue;
 		}
@@ -1076,12 +1229,27 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 	u32 vertex_count = 0;
 	u32 drawcall_count = 0;
 	u32 material_swaps = 0;
+	u32 batch_count = 0;
 
 	// Render all mesh buffers in order
 	drawcall_count += draw_order.size();
 
+	// Buffers that share a material are handed to the driver together,
+	// which places them by their offsets
+	video::SDrawBatch &batch = tl_drawbatch;
+	batch.clear();
+	const auto flush_batch = [&] () {
+		if (batch.Buffers.empty())
+			return;
+		driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+		driver->drawMeshBufferBatch(batch);
+		batch.clear();
+		++batch_count;
+	};
+
 	for (auto &descriptor : draw_order) {
 		if (!descriptor.m_reuse_material) {
+			flush_batch();
 			auto &material = descriptor.getMaterial();
 
 			// Apply filter settings
@@ -1110,11 +1278,19 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 			material.TextureLayers[ShadowRenderer::TEXTURE_LAYER_SHADOW].Texture = nullptr;
 		}
 
+		if (!descriptor.m_use_partial_buffer) {
+			batch.Buffers.push_back(descriptor.m_buffer);
+			batch.Offsets.push_back(descriptor.m_pos);
+			vertex_count += descriptor.m_buffer->getVertexCount();
+			continue;
+		}
+
 		m.setTranslation(descriptor.m_pos);
 		driver->setTransform(video::ETS_WORLD, m);
 
 		vertex_count += descriptor.draw(driver);
 	}
+	flush_batch();
 
 	g_profiler->avg(prefix + "draw meshes [ms]", tt_draw.stop(true));
 
@@ -1145,6 +1321,7 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 
 	g_profiler->avg(prefix + "vertices drawn [#]", vertex_count);
 	g_profiler->avg(prefix + "drawcalls [#]", drawcall_count);
+	g_profiler->avg(prefix + "draw batches [#]", batch_count);
 	g_profiler->avg(prefix + "material swaps [#]", material_swaps);
 }
 
@@ -1494,6 +1671,11 @@ void ClientMap::renderMapShadows(video::IVideoDriver *driver,
 				local_material.BackfaceCulling = true;
 				local_material.FrontfaceCulling = false;
 			}
+			// the shadow shader can't sample array textures, these are all
+			// opaque anyway
+			if (auto *tex = local_material.getTexture(0);
+					tex && tex->getType() == video::ETT_2D_ARRAY)
+				local_material.setTexture(0, nullptr);
 			local_material.MaterialType = material.MaterialType;
 			local_material.BlendOperation = material.BlendOperation;
 			driver->setMaterial(local_material);
@@ -1576,11 +1758,130 @@ void ClientMap::updateDrawListShadow(v3f shadow_light_pos, v3f shadow_light_dir,
 	g_profiler->avg("SHADOW MapBlocks loaded [#]", blocks_loaded);
 }
 
+void ClientMap::evictOverBudget(size_t block_budget, size_t mesh_budget,
+		std::vector<v3s16> *evicted_blocks)
+{
+	if (block_budget == 0 && mesh_budget == 0)
+		return;
+
+	struct Candidate {
+		// higher is less valuable
+		f32 cost;
+		MapSector *sector;
+		MapBlock *block;
+		size_t block_bytes;
+		size_t mesh_bytes;
+	};
+
+	// A block that wasn't seen for 10 seconds costs like one that is a
+	// block further away
+	constexpr f32 cost_per_unseen_second = 0.1f;
+
+	const v3f cam_block = intToFloat(getNodeBlockPos(
+			floatToInt(m_camera_position, BS)), 1.0f);
+	std::vector<Candidate> candidates;
+	size_t block_bytes = 0;
+	size_t mesh_bytes = 0;
+	for (auto &sector_it : m_sectors) {
+		MapSector *sector = sector_it.second;
+		const MapSector *const_sector = sector;
+		for (const auto &entry : const_sector->getBlocks()) {
+			MapBlock *block = entry.second.get();
+			Candidate c;
+			c.sector = sector;
+			c.block = block;
+			c.block_bytes = sizeof(MapBlock) + block->getNodeDataMemoryUsage() +
+				block->m_node_metadata.getMemoryUsage();
+			c.mesh_bytes = block->mesh ? block->mesh->getMemoryUsage() : 0;
+			block_bytes += c.block_bytes;
+			mesh_bytes += c.mesh_bytes;
+
+			// drawn, or otherwise in use
+			if (block->refGet() != 0)
+				continue;
+			c.cost = cam_block.getDistanceFrom(intToFloat(block->getPos(), 1.0f)) +
+				block->getUsageTimer() * cost_per_unseen_second;
+			candidates.push_back(c);
+		}
+	}
+
+	g_profiler->avg("CM: block data [MiB]", block_bytes / (1024 * 1024));
+	g_profiler->avg("CM: block meshes [MiB]", mesh_bytes / (1024 * 1024));
+
+	const auto over_budget = [&] () {
+		return (block_budget > 0 && block_bytes > block_budget) ||
+			(mesh_budget > 0 && mesh_bytes > mesh_budget);
+	};
+	if (!over_budget())
+		return;
+
+	std::sort(candidates.begin(), candidates.end(),
+		[] (const Candidate &a, const Candidate &b) { return a.cost > b.cost; });
+
+	std::vector<v2s16> empty_sectors;
+	u32 evicted = 0;
+	for (const Candidate &c : candidates) {
+		if (!over_budget())
+			break;
+		const v3s16 p = c.block->getPos();
+		if (c.block->mesh)
+			invalidateMapBlockMesh(c.block->mesh);
+		block_bytes -= c.block_bytes;
+		mesh_bytes -= c.mesh_bytes;
+		c.sector->deleteBlock(c.block);
+		if (c.sector->empty())
+			empty_sectors.push_back(v2s16(p.X, p.Z));
+		if (evicted_blocks)
+			evicted_blocks->push_back(p);
+		evicted++;
+	}
+	deleteSectors(empty_sectors);
+
+	infostream << "ClientMap: Evicted " << evicted << " blocks over the memory budget, "
+		<< (block_bytes / 1024) << " KiB block data and " << (mesh_bytes / 1024)
+		<< " KiB meshes left" << std::endl;
+}
+
 void ClientMap::reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks)
 {
 	g_profiler->avg("CM::reportMetrics loaded blocks [#]", all_blocks);
 }
 
+void ClientMap::sortTransparentMeshes()
+{
+	if (!m_sort_transparent)
+		return;
+
+	ScopeProfiler sp(g_profiler, "CM::sortTransparentMeshes", SPT_AVG);
+	u32 sorted_blocks = 0;
+
+	for (auto &it : m_next_drawlist) {
+		MapBlock *block = it.second;
+		MapBlockMesh *blockmesh = block->mesh;
+		if (!blockmesh)
+			continue;
+
+		v3f mesh_sphere_center = intToFloat(block->getPosRelative(), BS)
+				+ blockmesh->getBoundingSphereCenter();
+		f32 mesh_sphere_radius = blockmesh->getBoundingRadius();
+		f32 distance_sq = m_camera_position.getDistanceFromSQ(mesh_sphere_center);
+
+		if (m_sort_distance > 0 &&
+				distance_sq <= std::pow(m_sort_distance + mesh_sphere_radius, 2.0f)) {
+			if (blockmesh->sortTransparentTriangles(m_camera_position,
+					block->getPos(), m_sort_group_by_buffers)) {
+				m_sorted_meshes.push_back(blockmesh);
+				++sorted_blocks;
+			}
+		} else {
+			blockmesh->resetTransparentOrder();
+			m_unsorted_meshes.push_back(blockmesh);
+		}
+	}
+
+	g_profiler->avg("CM::Transparent Buffers - Resorted", sorted_blocks);
+}
+
 void ClientMap::updateTransparentMeshBuffers()
 {
 	ScopeProfiler sp(g_profiler, "CM::updateTransparentMeshBuffers", SPT_AVG);
@@ -1589,15 +1890,14 @@ void ClientMap::updateTransparentMeshBuffers()
 	bool transparency_sorting_enabled = m_cache_transparency_sorting_distance > 0;
 	f32 sorting_distance = m_cache_transparency_sorting_distance * BS;
 
-	// Update the order of transparent mesh buffers in each mesh
+	// Later updates are done by sortTransparentMeshes()
 	for (auto it = m_drawlist.begin(); it != m_drawlist.end(); it++) {
 		MapBlock *block = it->second;
 		MapBlockMesh *blockmesh = block->mesh;
 		if (!blockmesh)
 			continue;
 
-		if (m_needs_update_transparent_meshes ||
-				blockmesh->getTransparentBuffers().size() == 0) {
+		if (blockmesh->getTransparentBuffers().size() == 0) {
 			bool do_sort_block = transparency_sorting_enabled;
 
 			if (do_sort_block) {
@@ -1623,7 +1923,6 @@ void ClientMap::updateTransparentMeshBuffers()
 
 	g_profiler->avg("CM::Transparent Buffers - Sorted", sorted_blocks);
 	g_profiler->avg("CM::Transparent Buffers - Unsorted", unsorted_blocks);
-	m_needs_update_transparent_meshes = false;
 }
 
 video::SMaterial &DrawDescriptor::getMaterial()
@@ -1642,6 +1941,35 @@ u32 DrawDescriptor::draw(video::IVideoDriver* driver)
 	}
 }
 
+void ClientMap::addMeshOccluders(MapBlock *mesh_block, u16 mesh_size)
+{
+	// The sides are opaque all the way through their nodes, so the plane
+	// through the node centers is used, out to the faces of the nodes
+	const v3f min = intToFloat(mesh_block->getPosRelative(), BS);
+	const v3f max = min + (mesh_size * MAP_BLOCKSIZE - 1) * BS;
+	const f32 r = 0.5f * BS;
+
+	// solid_sides are +Z-Z+Y-Y+X-X
+	for (int k = 0; k < 6; k++) {
+		if (!(mesh_block->solid_sides & (1 << k)))
+			continue;
+		const int axis = k / 2;
+		const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		const f32 plane = (k & 1) ? max[axis] : min[axis];
+		// seen edge-on
+		if (std::fabs(m_camera_position[axis] - plane) < r)
+			continue;
+
+		v3f corners[4];
+		for (int i = 0; i < 4; i++) {
+			corners[i][axis] = plane;
+			corners[i][u] = (i == 1 || i == 2) ? max[u] + r : min[u] - r;
+			corners[i][v] = (i >= 2) ? max[v] + r : min[v] - r;
+		}
+		m_occlusion_buffer.addOccluder(corners);
+	}
+}
+
 bool ClientMap::isMeshOccluded(MapBlock *mesh_block, u16 mesh_size, v3s16 cam_pos_nodes)
 {
 	if (mesh_size == 1)
@@ -7,8 +7,11 @@
 #include "irrlichttypes_bloated.h"
 #include "map.h"
 #include "camera.h"
+#include "occlusion_buffer.h"
+#include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 
 struct MapDrawControl
 {
@@ -52,6 +55,8 @@ using CachedMeshBuffers = std::unordered_map<std::string, CachedMeshBuffer>;
 	This is the only map class that is able to render itself on screen.
 */
 
+class DrawListThread;
+
 class ClientMap : public Map, public scene::ISceneNode
 {
 public:
@@ -90,11 +95,20 @@ class ClientMap : public Map, public scene::ISceneNode
 	void getBlocksInViewRange(v3s16 cam_pos_nodes,
 		v3s16 *p_blocks_min, v3s16 *p_blocks_max, float range=-1.0f);
 	void updateDrawList();
+	// Starts building the draw list, in a thread if enabled. The map must not
+	// be changed until finishDrawListUpdate(), but may be rendered.
+	void startDrawListUpdate();
+	// Waits for the draw list of startDrawListUpdate() and uses it
+	void finishDrawListUpdate();
 	// @brief Calculate statistics about the map and keep the blocks alive
 	void touchMapBlocks();
 	void updateDrawListShadow(v3f shadow_light_pos, v3f shadow_light_dir, float radius, float length);
 	// Returns true if draw list needs updating before drawing the next frame.
-	bool needsUpdateDrawList() { return m_needs_update_drawlist; }
+	// This includes the order of transparent triangles.
+	bool needsUpdateDrawList()
+	{
+		return m_needs_update_drawlist || m_needs_update_transparent_meshes;
+	}
 	void renderMap(video::IVideoDriver* driver, s32 pass);
 
 	void renderMapShadows(video::IVideoDriver *driver,
@@ -107,6 +121,16 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	void invalidateMapBlockMesh(MapBlockMesh *mesh);
 
+	/*
+		Unloads the least valuable blocks while the node data of all blocks
+		uses more than block_budget bytes, or their meshes more than
+		mesh_budget bytes. 0 means no budget.
+		Blocks are ranked by distance to the camera and by the time since
+		they were last seen. Blocks in the draw lists are kept.
+	*/
+	void evictOverBudget(size_t block_budget, size_t mesh_budget,
+		std::vector<v3s16> *evicted_blocks);
+
 	// For debug printing
 	void PrintInfo(std::ostream &out) override;
 
@@ -122,9 +146,21 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	void reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks) override;
 private:
+	friend class DrawListThread;
+
+	// Builds m_next_drawlist and m_next_keeplist, without grabbing the blocks
+	void buildDrawList();
+	// Remakes the meshes in the draw list whose level of detail is off
+	void updateMeshLods();
+
 	bool isMeshOccluded(MapBlock *mesh_block, u16 mesh_size, v3s16 cam_pos_nodes);
+	// Adds the solid sides of a mesh to the occlusion buffer
+	void addMeshOccluders(MapBlock *mesh_block, u16 mesh_size);
 
-	// update the vertex order in transparent mesh buffers
+	// Sorts the transparent triangles of the meshes in m_next_drawlist,
+	// which may be done by the draw list thread
+	void sortTransparentMeshes();
+	// Gives the transparent mesh buffers of new meshes an order
 	void updateTransparentMeshBuffers();
 
 	// Orders blocks by distance to the camera
@@ -161,6 +197,19 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	std::map<v3s16, MapBlock*, MapBlockComparer> m_drawlist;
 	std::vector<MapBlock*> m_keeplist;
+	// being built by buildDrawList()
+	std::map<v3s16, MapBlock*, MapBlockComparer> m_next_drawlist;
+	std::vector<MapBlock*> m_next_keeplist;
+	bool m_drawlist_pending = false;
+	std::unique_ptr<DrawListThread> m_drawlist_thread;
+	// Transparent sorting for the pending draw list. The settings are
+	// copied, so that they don't change while the thread runs.
+	bool m_sort_transparent = false;
+	bool m_sort_group_by_buffers = false;
+	f32 m_sort_distance = 0.0f;
+	// meshes with a new order, and meshes that are no longer sorted
+	std::vector<MapBlockMesh*> m_sorted_meshes;
+	std::vector<MapBlockMesh*> m_unsorted_meshes;
 	std::map<v3s16, MapBlock*> m_drawlist_shadow;
 	bool m_needs_update_drawlist;
 	CachedMeshBuffers m_dynamic_buffers;
@@ -173,4 +222,11 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	bool m_loops_occlusion_culler;
 	bool m_enable_raytraced_culling;
+	bool m_enable_depth_culling;
+
+	OcclusionBuffer m_occlusion_buffer;
+
+	f32 m_mesh_lod_distance;
+	// meshes that were found with a wrong level of detail, to be replaced
+	std::unordered_map<v3s16, MapBlockMesh *> m_lod_updates;
 };
@@ -9,12 +9,17 @@
 #include "filecache.h"
 #include "filesys.h"
 #include "log.h"
+#include "mediapack.h"
 #include "porting.h"
 #include "settings.h"
 #include "util/hex.h"
 #include "util/serialize.h"
 #include "util/hashing.h"
 #include "util/string.h"
+#include "threading/jobsystem.h"
+#include "threading/thread.h"
+#include "threading/workerpool.h"
+#include <IImage.h>
 #include <sstream>
 
 static std::string getMediaCacheDir()
@@ -22,22 +27,33 @@ static std::string getMediaCacheDir()
 	return porting::path_cache + DIR_DELIM + "media";
 }
 
+// The pack stays open while a downloader or any lazily loaded media uses it.
+// Only called from the main thread.
+static std::shared_ptr<MediaPack> getMediaPack()
+{
+	static std::weak_ptr<MediaPack> s_pack;
+	std::shared_ptr<MediaPack> pack = s_pack.lock();
+	if (!pack) {
+		pack = std::make_shared<MediaPack>(getMediaCacheDir() + DIR_DELIM "media.pack");
+		s_pack = pack;
+	}
+	return pack;
+}
+
 bool clientMediaUpdateCache(const std::string &raw_hash, const std::string &filedata)
 {
-	FileCache media_cache(getMediaCacheDir());
-	std::string sha1_hex = hex_encode(raw_hash);
-	if (!media_cache.exists(sha1_hex))
-		return media_cache.update(sha1_hex, filedata);
-	return false;
+	return getMediaPack()->add(raw_hash, filedata);
 }
 
 bool clientMediaUpdateCacheCopy(const std::string &raw_hash, const std::string &path)
 {
-	FileCache media_cache(getMediaCacheDir());
-	std::string sha1_hex = hex_encode(raw_hash);
-	if (!media_cache.exists(sha1_hex))
-		return media_cache.updateCopyFile(sha1_hex, path);
-	return false;
+	std::shared_ptr<MediaPack> pack = getMediaPack();
+	if (pack->exists(raw_hash))
+		return false;
+	std::string data;
+	if (!fs::ReadFile(path, data, true))
+		return false;
+	return pack->add(raw_hash, data);
 }
 
 /*
@@ -51,6 +67,15 @@ ClientMediaDownloader::ClientMediaDownloader():
 
 ClientMediaDownloader::~ClientMediaDownloader()
 {
+	{
+		std::unique_lock<std::mutex> lock(m_checked_mutex);
+		m_checked_cv.wait(lock, [this] { return m_checked.size() == m_checks_pending; });
+	}
+	for (CheckedFile &file : m_checked) {
+		if (file.image)
+			file.image->drop();
+	}
+
 	if (m_httpfetch_caller != HTTPFETCH_DISCARD)
 		httpfetch_caller_free(m_httpfetch_caller);
 
@@ -62,9 +87,9 @@ ClientMediaDownloader::~ClientMediaDownloader()
 }
 
 bool ClientMediaDownloader::loadMedia(Client *client, const std::string &data,
-		const std::string &name)
+		const std::string &name, const std::string &sha1, video::IImage *decoded)
 {
-	return client->loadMedia(data, name);
+	return client->loadMedia(data, name, sha1, false, decoded);
 }
 
 void ClientMediaDownloader::addFile(const std::string &name, const std::string &sha1)
@@ -134,9 +159,12 @@ void ClientMediaDownloader::step(Client *client)
 		m_initial_step_done = true;
 	}
 
+	const bool remote_busy = m_httpfetch_active || m_remote_file_checks;
+	const bool loaded_something = loadCheckedFiles(client);
+
 	// Remote media: check for completion of fetches
-	if (m_httpfetch_active) {
-		bool fetched_something = false;
+	if (remote_busy) {
+		bool fetched_something = loaded_something;
 		HTTPFetchResult fetch_result;
 
 		while (httpfetch_async_get(m_httpfetch_caller, fetch_result)) {
@@ -156,7 +184,7 @@ void ClientMediaDownloader::step(Client *client)
 		// Did all remote transfers end and no new ones can be started?
 		// If so, request still missing files from the server
 		// (Or report that we have all files.)
-		if (m_httpfetch_active == 0) {
+		if (m_httpfetch_active == 0 && m_remote_file_checks == 0) {
 			if (m_uncached_received_count < m_uncached_count) {
 				infostream << "Client: Failed to remote-fetch "
 					<< (m_uncached_count-m_uncached_received_count)
@@ -185,15 +213,49 @@ void ClientMediaDownloader::initialStep(Client *client)
 	u64 last_time = porting::getTimeMs();
 
 	// Check media cache
-	m_uncached_count = m_files.size();
-	for (auto &file_it : m_files) {
-		const std::string &name = file_it.first;
-		FileStatus *filestatus = file_it.second;
-		const std::string &sha1 = filestatus->sha1;
+	// The files are read and the images decoded on all cores, in chunks
+	// to keep the load screen going. They are loaded in order afterwards.
+	struct CachedFile {
+		const std::string *name;
+		FileStatus *filestatus;
+		bool lazy = false;
+		bool found = false;
+		std::string data;
+		video::IImage *image = nullptr;
+	};
+	std::vector<CachedFile> files;
+	files.reserve(m_files.size());
+	for (auto &file_it : m_files)
+		files.push_back({&file_it.first, file_it.second});
 
-		if (tryLoadFromCache(name, sha1, client)) {
-			filestatus->received = true;
-			m_uncached_count--;
+	WorkerPool pool("MediaDecode", std::max(Thread::getNumberOfProcessors(), 1U) - 1);
+	const size_t chunk_size = 64 * (pool.getThreadCount() + 1);
+
+	m_uncached_count = m_files.size();
+	for (size_t begin = 0; begin < files.size(); begin += chunk_size) {
+		const size_t count = std::min(chunk_size, files.size() - begin);
+		pool.run(count, [&] (size_t i) {
+			CachedFile &file = files[begin + i];
+			// sounds and models are only read when used
+			file.lazy = Client::isLazyMedia(*file.name) &&
+				m_media_pack->exists(file.filestatus->sha1);
+			if (file.lazy)
+				return;
+			file.found = loadFromCache(file.filestatus->sha1, file.data);
+			if (file.found)
+				file.image = client->decodeMediaImage(file.data, *file.name);
+		});
+
+		for (size_t i = begin; i < begin + count; i++) {
+			CachedFile &file = files[i];
+			// If found in cache, try to load it from there
+			if (file.lazy ? loadLazyFromCache(*file.name, file.filestatus->sha1, client) :
+					file.found && checkAndLoad(*file.name, file.filestatus->sha1,
+					file.data, true, client, file.image)) {
+				file.filestatus->received = true;
+				m_uncached_count--;
+			}
+			file.data = std::string();
 		}
 
 		u64 cur_time = porting::getTimeMs();
@@ -314,7 +376,7 @@ void ClientMediaDownloader::remoteHashSetReceived(
 }
 
 void ClientMediaDownloader::remoteMediaReceived(
-		const HTTPFetchResult &fetch_result,
+		HTTPFetchResult &fetch_result,
 		Client *client)
 {
 	// Some remote server sent us a file.
@@ -338,20 +400,85 @@ void ClientMediaDownloader::remoteMediaReceived(
 
 	RemoteServerStatus *remote = m_remotes[filestatus->current_remote];
 
-	filestatus->current_remote = -1;
 	remote->active_count--;
 
-	// If fetch succeeded, try to load media file
+	// If fetch succeeded, check it on a job thread and keep current_remote
+	// until then, so that the file isn't requested again meanwhile
 
 	if (fetch_result.succeeded) {
-		bool success = checkAndLoad(name, filestatus->sha1,
-				fetch_result.data, false, client);
+		checkAsync(name, filestatus->sha1, std::move(fetch_result.data),
+			false, client);
+		m_remote_file_checks++;
+	} else {
+		filestatus->current_remote = -1;
+	}
+}
+
+void ClientMediaDownloader::checkAsync(const std::string &name,
+		const std::string &sha1, std::string data, bool conventional,
+		Client *client)
+{
+	m_checks_pending++;
+	// std::function needs a copyable callable
+	auto file = std::make_shared<CheckedFile>();
+	file->name = name;
+	file->data = std::move(data);
+	file->conventional = conventional;
+	JobSystem::get().submit([this, file, sha1, client] {
+		file->sha1_matches = hashing::sha1(file->data) == sha1;
+		if (file->sha1_matches) {
+			file->image = client->decodeMediaImage(file->data, file->name);
+			m_media_pack->add(sha1, file->data);
+		}
+
+		std::lock_guard<std::mutex> lock(m_checked_mutex);
+		m_checked.push_back(std::move(*file));
+		m_checked_cv.notify_all();
+	});
+}
+
+bool ClientMediaDownloader::loadCheckedFiles(Client *client)
+{
+	std::vector<CheckedFile> checked;
+	{
+		std::lock_guard<std::mutex> lock(m_checked_mutex);
+		checked.swap(m_checked);
+	}
+	m_checks_pending -= checked.size();
+
+	for (CheckedFile &file : checked) {
+		FileStatus *filestatus = m_files[file.name];
+		const std::string sha1_hex = hex_encode(filestatus->sha1);
+		bool success = false;
+		if (!file.sha1_matches) {
+			infostream << "Client: Received media file " << sha1_hex
+				<< " \"" << file.name << "\" mismatches actual checksum"
+				<< std::endl;
+		} else if (!loadMedia(client, file.data, file.name, filestatus->sha1,
+				file.image)) {
+			infostream << "Client: Failed to load received media: "
+				<< sha1_hex << " \"" << file.name << "\"" << std::endl;
+		} else {
+			verbosestream << "Client: Loaded received media: "
+				<< sha1_hex << " \"" << file.name << "\"" << std::endl;
+			success = true;
+		}
+		if (!success && file.image)
+			file.image->drop();
+
+		// marked as received already, see conventionalTransferDone()
+		if (file.conventional)
+			continue;
+
+		m_remote_file_checks--;
+		filestatus->current_remote = -1;
 		if (success) {
 			filestatus->received = true;
 			assert(m_uncached_received_count < m_uncached_count);
 			m_uncached_received_count++;
 		}
 	}
+	return !checked.empty();
 }
 
 s32 ClientMediaDownloader::selectRemoteServer(FileStatus *filestatus)
@@ -396,8 +523,9 @@ void ClientMediaDownloader::startRemoteMediaTransfers()
 	for (auto files_iter = m_files.upper_bound(m_name_bound);
 			files_iter != m_files.end(); ++files_iter) {
 
-		// Abort if active fetch limit is exceeded
-		if (m_httpfetch_active >= m_httpfetch_active_limit)
+		// Abort if active fetch limit is exceeded, the files that are
+		// still being checked count too so that they can't pile up
+		if (m_httpfetch_active + (s32)m_remote_file_checks >= m_httpfetch_active_limit)
 			break;
 
 		const std::string &name = files_iter->first;
@@ -503,8 +631,8 @@ bool ClientMediaDownloader::conventionalTransferDone(
 	m_uncached_received_count++;
 
 	// Check that received file matches announced checksum
-	// If so, load it
-	checkAndLoad(name, filestatus->sha1, data, false, client);
+	// If so, load it in step()
+	checkAsync(name, filestatus->sha1, data, true, client);
 
 	return true;
 }
@@ -514,6 +642,7 @@ bool ClientMediaDownloader::conventionalTransferDone(
 */
 
 IClientMediaDownloader::IClientMediaDownloader():
+	m_media_pack(getMediaPack()),
 	m_media_cache(getMediaCacheDir()), m_write_to_cache(true)
 {
 }
@@ -521,19 +650,54 @@ IClientMediaDownloader::IClientMediaDownloader():
 bool IClientMediaDownloader::tryLoadFromCache(const std::string &name,
 	const std::string &sha1, Client *client)
 {
-	std::ostringstream tmp_os(std::ios_base::binary);
-	bool found_in_cache = m_media_cache.load(hex_encode(sha1), tmp_os);
+	std::string data;
 
 	// If found in cache, try to load it from there
-	if (found_in_cache)
-		return checkAndLoad(name, sha1, tmp_os.str(), true, client);
+	if (loadFromCache(sha1, data))
+		return checkAndLoad(name, sha1, data, true, client);
 
 	return false;
 }
 
+bool IClientMediaDownloader::loadFromCache(const std::string &sha1, std::string &data)
+{
+	if (m_media_pack->load(sha1, data))
+		return true;
+
+	// checkAndLoad() moves it into the pack
+	std::ostringstream tmp_os(std::ios_base::binary);
+	if (!m_media_cache.load(hex_encode(sha1), tmp_os))
+		return false;
+	data = tmp_os.str();
+	return true;
+}
+
+bool IClientMediaDownloader::loadLazyFromCache(const std::string &name,
+	const std::string &sha1, Client *client)
+{
+	auto loader = [pack = m_media_pack, name, sha1] () -> std::string {
+		std::string data;
+		if (!pack->load(sha1, data))
+			return "";
+		if (hashing::sha1(data) != sha1) {
+			errorstream << "Client: Cached media file " << hex_encode(sha1)
+				<< " \"" << name << "\" mismatches actual checksum" << std::endl;
+			return "";
+		}
+		return data;
+	};
+	if (!client->loadMediaLazy(name, sha1, std::move(loader)))
+		return false;
+
+	verbosestream << "Client: Registered cached media: "
+		<< hex_encode(sha1) << " \"" << name << "\"" << std::endl;
+	return true;
+}
+
 bool IClientMediaDownloader::checkAndLoad(
 		const std::string &name, const std::string &sha1,
-		const std::string &data, bool is_from_cache, Client *client)
+		const std::string &data, bool is_from_cache, Client *client,
+		video::IImage *decoded)
 {
 	const char *cached_or_received = is_from_cache ? "cached" : "received";
 	const char *cached_or_received_uc = is_from_cache ? "Cached" : "Received";
@@ -550,11 +714,13 @@ bool IClientMediaDownloader::checkAndLoad(
 			<< sha1_hex << " \"" << name << "\" "
 			<< "mismatches actual checksum " << data_sha1_hex
 			<< std::endl;
+		if (decoded)
+			decoded->drop();
 		return false;
 	}
 
 	// Checksum is ok, try loading the file
-	bool success = loadMedia(client, data, name);
+	bool success = loadMedia(client, data, name, sha1, decoded);
 	if (!success) {
 		infostream << "Client: "
 			<< "Failed to load " << cached_or_received << " media: "
@@ -568,9 +734,9 @@ bool IClientMediaDownloader::checkAndLoad(
 		<< sha1_hex << " \"" << name << "\""
 		<< std::endl;
 
-	// Update cache (unless we just loaded the file from the cache)
-	if (!is_from_cache && m_write_to_cache)
-		m_media_cache.update(sha1_hex, data);
+	// Update cache (unless the file is in the pack already)
+	if (m_write_to_cache)
+		m_media_pack->add(sha1, data);
 
 	return true;
 }
@@ -635,9 +801,9 @@ SingleMediaDownloader::~SingleMediaDownloader()
 }
 
 bool SingleMediaDownloader::loadMedia(Client *client, const std::string &data,
-		const std::string &name)
+		const std::string &name, const std::string &sha1, video::IImage *decoded)
 {
-	return client->loadMedia(data, name, true);
+	return client->loadMedia(data, name, sha1, true, decoded);
 }
 
 void SingleMediaDownloader::addFile(const std::string &name, const std::string &sha1)
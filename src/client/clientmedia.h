@@ -7,13 +7,20 @@
 #include "irrlichttypes.h"
 #include "filecache.h"
 #include "util/basic_macros.h"
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <unordered_map>
 
 class Client;
+class MediaPack;
 struct HTTPFetchResult;
+namespace video {
+	class IImage;
+}
 
 #define MTHASHSET_FILE_SIGNATURE 0x4d544853 // 'MTHS'
 #define MTHASHSET_FILE_NAME "index.mth"
@@ -67,24 +74,45 @@ class IClientMediaDownloader
 	virtual ~IClientMediaDownloader() = default;
 
 	// Forwards the call to the appropriate Client method
+	// decoded: see Client::loadMedia()
 	virtual bool loadMedia(Client *client, const std::string &data,
-		const std::string &name) = 0;
+		const std::string &name, const std::string &sha1,
+		video::IImage *decoded) = 0;
 
 	bool tryLoadFromCache(const std::string &name, const std::string &sha1,
 			Client *client);
 
+	// Reads a file from the media pack or the old file cache, thread-safe
+	bool loadFromCache(const std::string &sha1, std::string &data);
+
+	// Registers a sound or model in the media pack, which is only read and
+	// checked on first use
+	bool loadLazyFromCache(const std::string &name, const std::string &sha1,
+			Client *client);
+
+	// decoded: the image already decoded from data, ownership is taken
 	bool checkAndLoad(const std::string &name, const std::string &sha1,
-			const std::string &data, bool is_from_cache, Client *client);
+			const std::string &data, bool is_from_cache, Client *client,
+			video::IImage *decoded = nullptr);
 
-	// Filesystem-based media cache
+	std::shared_ptr<MediaPack> m_media_pack;
+	// Filesystem-based media cache of older versions, only read
 	FileCache m_media_cache;
 	bool m_write_to_cache;
 };
 
+/*
+	Downloads the media announced by the server.
+
+	Received files are checked, decoded and written to the media pack by
+	jobs of the JobSystem while the next ones are downloaded. Only loading
+	them into the client is left to step().
+*/
 class ClientMediaDownloader : public IClientMediaDownloader
 {
 public:
 	ClientMediaDownloader();
+	// Waits for the files that are being checked
 	~ClientMediaDownloader();
 
 	float getProgress() const {
@@ -100,7 +128,7 @@ class ClientMediaDownloader : public IClientMediaDownloader
 	}
 
 	bool isDone() const override {
-		return m_initial_step_done &&
+		return m_initial_step_done && m_checks_pending == 0 &&
 			m_uncached_received_count == m_uncached_count;
 	}
 
@@ -117,7 +145,8 @@ class ClientMediaDownloader : public IClientMediaDownloader
 
 protected:
 	bool loadMedia(Client *client, const std::string &data,
-			const std::string &name) override;
+			const std::string &name, const std::string &sha1,
+			video::IImage *decoded) override;
 
 	static std::string makeReferer(Client *client);
 
@@ -134,10 +163,26 @@ class ClientMediaDownloader : public IClientMediaDownloader
 		s32 active_count;
 	};
 
+	struct CheckedFile {
+		std::string name;
+		std::string data;
+		// null if it isn't an image
+		video::IImage *image = nullptr;
+		bool sha1_matches = false;
+		// received through TOCLIENT_MEDIA, so there's no other source
+		bool conventional = false;
+	};
+
 	void initialStep(Client *client);
 	void remoteHashSetReceived(const HTTPFetchResult &fetch_result);
-	void remoteMediaReceived(const HTTPFetchResult &fetch_result,
+	void remoteMediaReceived(HTTPFetchResult &fetch_result,
 			Client *client);
+	// Checks, decodes and caches a received file on a job thread
+	void checkAsync(const std::string &name, const std::string &sha1,
+			std::string data, bool conventional, Client *client);
+	// Loads the files that were checked since the last call,
+	// returns true if there were any
+	bool loadCheckedFiles(Client *client);
 	s32 selectRemoteServer(FileStatus *filestatus);
 	void startRemoteMediaTransfers();
 	void startConventionalTransfers(Client *client);
@@ -169,6 +214,16 @@ class ClientMediaDownloader : public IClientMediaDownloader
 	s32 m_outstanding_hash_sets = 0;
 	std::unordered_map<u64, std::string> m_remote_file_transfers;
 
+	// Files given to checkAsync() that loadCheckedFiles() didn't take yet,
+	// they count against m_httpfetch_active_limit
+	size_t m_checks_pending = 0;
+	// the part of them that was fetched from remote servers
+	size_t m_remote_file_checks = 0;
+	std::mutex m_checked_mutex;
+	// signaled when a file was checked
+	std::condition_variable m_checked_cv;
+	std::vector<CheckedFile> m_checked;
+
 	// All files up to this name have either been received from a
 	// remote server or failed on all remote servers, so those files
 	// don't need to be looked at again
@@ -207,7 +262,8 @@ class SingleMediaDownloader : public IClientMediaDownloader
 
 protected:
 	bool loadMedia(Client *client, const std::string &data,
-			const std::string &name) override;
+			const std::string &name, const std::string &sha1,
+			video::IImage *decoded) override;
 
 private:
 	void initialStep(Client *client);
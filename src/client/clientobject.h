@@ -26,6 +26,21 @@ namespace scene
 	class ISceneManager;
 }
 
+// AO_CMD_UPDATE_POSITION, decoded by ClientEnvironment::processActiveObjectMessages()
+struct AOPositionUpdate
+{
+	u16 id;
+	v3f position;
+	v3f velocity;
+	v3f acceleration;
+	v3f rotation;
+	bool do_interpolate;
+	bool is_end_position;
+	f32 update_interval;
+	// Sequence number of the TOCLIENT_OBJECT_MOVEMENT, 0 if unsequenced
+	u16 seq = 0;
+};
+
 class ClientActiveObject : public ActiveObject
 {
 public:
@@ -60,6 +75,7 @@ class ClientActiveObject : public ActiveObject
 
 	// Process a message sent by the server side object
 	virtual void processMessage(const std::string &data) {}
+	virtual void processPositionUpdate(const AOPositionUpdate &update) {}
 
 	virtual std::string infoText() { return ""; }
 	virtual std::string debugInfoText() { return ""; }
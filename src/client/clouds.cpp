@@ -93,34 +93,17 @@ void Clouds::updateMesh()
 		std::floor(center_of_drawing_in_noise_f.Y / cloud_size)
 	);
 
-	// Only update mesh if it has moved enough, this saves lots of GPU buffer uploads.
-	constexpr float max_d = 5 * BS;
-
-	if (!m_mesh_valid) {
-		// mesh was never created or invalidated
-	} else if (m_mesh_origin.getDistanceFrom(m_origin) >= max_d) {
-		// clouds moved
-	} else if (center_of_drawing_in_noise_i != m_last_noise_center) {
-		// noise offset changed
-		// I think in practice this never happens due to the camera offset
-		// being smaller than the cloud size.(?)
-	} else {
+	// The mesh is relative to the center cell and moved with the node, so it
+	// only has to be rebuilt when the camera or the clouds cross a cell.
+	if (m_mesh_valid && center_of_drawing_in_noise_i == m_last_noise_center)
 		return;
-	}
 
 	ScopeProfiler sp(g_profiler, "Clouds::updateMesh()", SPT_AVG);
-	m_mesh_origin = m_origin;
 	m_last_noise_center = center_of_drawing_in_noise_i;
 	m_mesh_valid = true;
 
 	const u32 num_faces_to_draw = is3D() ? 6 : 1;
 
-	// The world position of the integer center point of drawing in the noise
-	v2f world_center_of_drawing_in_noise_f = v2f(
-		center_of_drawing_in_noise_i.X * cloud_size,
-		center_of_drawing_in_noise_i.Y * cloud_size
-	) + m_origin;
-
 	// Colors with primitive shading
 
 	video::SColorf c_top_f(1, 1, 1, 1);
@@ -144,22 +127,36 @@ void Clouds::updateMesh()
 	video::SColor c_side_2 = c_side_2_f.toSColor();
 	video::SColor c_bottom = c_bottom_f.toSColor();
 
-	// Read noise
+	// Read noise, keeping what is still in range from the last time
 
-	std::vector<bool> grid(m_cloud_radius_i * 2 * m_cloud_radius_i * 2);
+	const s16 diameter = m_cloud_radius_i * 2;
+	std::vector<bool> grid(diameter * diameter);
+	const bool reuse = m_grid.size() == grid.size();
+	const v2s16 shift = center_of_drawing_in_noise_i - m_grid_center;
 
 	for(s16 zi = -m_cloud_radius_i; zi < m_cloud_radius_i; zi++) {
-		u32 si = (zi + m_cloud_radius_i) * m_cloud_radius_i * 2 + m_cloud_radius_i;
+		u32 si = (zi + m_cloud_radius_i) * diameter + m_cloud_radius_i;
 
 		for (s16 xi = -m_cloud_radius_i; xi < m_cloud_radius_i; xi++) {
 			u32 i = si + xi;
 
+			const s16 old_x = xi + shift.X;
+			const s16 old_z = zi + shift.Y;
+			if (reuse && old_x >= -m_cloud_radius_i && old_x < m_cloud_radius_i &&
+					old_z >= -m_cloud_radius_i && old_z < m_cloud_radius_i) {
+				grid[i] = m_grid[(old_z + m_cloud_radius_i) * diameter +
+					old_x + m_cloud_radius_i];
+				continue;
+			}
+
 			grid[i] = gridFilled(
 				xi + center_of_drawing_in_noise_i.X,
 				zi + center_of_drawing_in_noise_i.Y
 			);
 		}
 	}
+	m_grid.swap(grid);
+	m_grid_center = center_of_drawing_in_noise_i;
 
 
 	auto *mb = m_meshbuffer.get();
@@ -193,10 +190,10 @@ void Clouds::updateMesh()
 
 		u32 i = GETINDEX(xi, zi, m_cloud_radius_i);
 
-		if (!grid[i])
+		if (!m_grid[i])
 			continue;
 
-		v2f p0 = v2f(xi,zi)*cloud_size + world_center_of_drawing_in_noise_f;
+		v2f p0 = v2f(xi,zi)*cloud_size;
 
 		video::S3DVertex v[4] = {
 			video::S3DVertex(0,0,0, 0,0,0, c_top, 0, 1),
@@ -227,7 +224,7 @@ void Clouds::updateMesh()
 			case 1: // back
 				if (INAREA(xi, zi - 1, m_cloud_radius_i)) {
 					u32 j = GETINDEX(xi, zi - 1, m_cloud_radius_i);
-					if (grid[j])
+					if (m_grid[j])
 						continue;
 				}
 				if (soft_clouds_enabled) {
@@ -250,7 +247,7 @@ void Clouds::updateMesh()
 			case 2: //right
 				if (INAREA(xi + 1, zi, m_cloud_radius_i)) {
 					u32 j = GETINDEX(xi + 1, zi, m_cloud_radius_i);
-					if (grid[j])
+					if (m_grid[j])
 						continue;
 				}
 				if (soft_clouds_enabled) {
@@ -274,7 +271,7 @@ void Clouds::updateMesh()
 			case 3: // front
 				if (INAREA(xi, zi + 1, m_cloud_radius_i)) {
 					u32 j = GETINDEX(xi, zi + 1, m_cloud_radius_i);
-					if (grid[j])
+					if (m_grid[j])
 						continue;
 				}
 				if (soft_clouds_enabled) {
@@ -297,7 +294,7 @@ void Clouds::updateMesh()
 			case 4: // left
 				if (INAREA(xi - 1, zi, m_cloud_radius_i)) {
 					u32 j = GETINDEX(xi - 1, zi, m_cloud_radius_i);
-					if (grid[j])
+					if (m_grid[j])
 						continue;
 				}
 				if (soft_clouds_enabled) {
@@ -390,8 +387,9 @@ void Clouds::render()
 
 	// Update position
 	{
-		v2f off_origin = m_origin - m_mesh_origin;
-		v3f rel(off_origin.X, 0, off_origin.Y);
+		// the mesh is relative to the center cell, which moves with the clouds
+		v2f center = v2f(m_last_noise_center.X, m_last_noise_center.Y) * cloud_size + m_origin;
+		v3f rel(center.X, 0, center.Y);
 		rel -= intToFloat(m_camera_offset, BS);
 		setPosition(rel);
 		updateAbsolutePosition();
@@ -9,6 +9,7 @@
 #include "irr_ptr.h"
 #include "skyparams.h"
 #include <iostream>
+#include <vector>
 #include <ISceneNode.h>
 #include <SMaterial.h>
 #include <CMeshBuffer.h>
@@ -145,6 +146,8 @@ class Clouds : public scene::ISceneNode
 	void invalidateMesh()
 	{
 		m_mesh_valid = false;
+		// the parameters might change the noise too
+		m_grid.clear();
 	}
 
 	bool gridFilled(int x, int y) const;
@@ -156,10 +159,11 @@ class Clouds : public scene::ISceneNode
 
 	video::SMaterial m_material;
 	irr_ptr<scene::SMeshBuffer> m_meshbuffer;
-	// Value of m_origin at the time the mesh was last updated
-	v2f m_mesh_origin;
 	// Value of center_of_drawing_in_noise_i at the time the mesh was last updated
 	v2s16 m_last_noise_center;
+	// Filled cells around m_grid_center, kept to only read the new ones
+	std::vector<bool> m_grid;
+	v2s16 m_grid_center;
 	// Was the mesh ever generated?
 	bool m_mesh_valid = false;
 
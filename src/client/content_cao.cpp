@@ -7,6 +7,7 @@
 #include <ICameraSceneNode.h>
 #include <IMeshManipulator.h>
 #include <IAnimatedMeshSceneNode.h>
+#include <SkinnedMesh.h>
 #include "client/client.h"
 #include "client/renderingengine.h"
 #include "client/sound.h"
@@ -565,12 +566,12 @@ void GenericCAO::addToScene(ITextureSource *tsrc, scene::ISceneManager *smgr)
 	infostream << "GenericCAO::addToScene(): " <<
 		enum_to_string(es_ObjectVisual, m_prop.visual)<< std::endl;
 
+	MaterialType material_type = TILE_MATERIAL_BASIC;
 	if (m_prop.visual != OBJECTVISUAL_NODE &&
 			m_prop.visual != OBJECTVISUAL_WIELDITEM &&
 			m_prop.visual != OBJECTVISUAL_ITEM)
 	{
 		IShaderSource *shader_source = m_client->getShaderSource();
-		MaterialType material_type;
 
 		if (m_prop.shaded && m_prop.glow == 0)
 			material_type = (m_prop.use_texture_alpha) ?
@@ -588,6 +589,7 @@ void GenericCAO::addToScene(ITextureSource *tsrc, scene::ISceneManager *smgr)
 
 	m_matrixnode = m_smgr->addDummyTransformationSceneNode();
 	m_matrixnode->grab();
+	m_node_transform_valid = false;
 
 	auto setMaterial = [this] (video::SMaterial &mat) {
 		if (m_material_type != EMT_INVALID)
@@ -678,6 +680,19 @@ void GenericCAO::addToScene(ITextureSource *tsrc, scene::ISceneManager *smgr)
 			// set vertex colors to ensure alpha is set
 			setMeshColor(m_animated_meshnode->getMesh(), video::SColor(0xFFFFFFFF));
 
+			// skin animated meshes in the vertex shader if they aren't too big
+			auto *skinned = dynamic_cast<scene::SkinnedMesh *>(m_animated_meshnode->getMesh());
+			if (skinned && !skinned->isStatic() &&
+					skinned->getJointCount() <= scene::SkinnedMesh::MAX_HARDWARE_JOINTS &&
+					RenderingEngine::get_video_driver()->getDriverType() == video::EDT_OPENGL3 &&
+					g_settings->getBool("enable_hardware_skinning")) {
+				IShaderSource *shader_source = m_client->getShaderSource();
+				u32 shader_id = shader_source->getShader("object_shader",
+					material_type, NDT_NORMAL, false, true);
+				m_material_type = shader_source->getShaderInfo(shader_id).material;
+				m_animated_meshnode->setHardwareSkinning(true);
+			}
+
 			setSceneNodeMaterials(m_animated_meshnode);
 
 			m_animated_meshnode->forEachMaterial([this] (auto &mat) {
@@ -719,6 +734,9 @@ void GenericCAO::addToScene(ITextureSource *tsrc, scene::ISceneManager *smgr)
 			item.deSerialize(m_prop.wield_item, m_client->idef());
 		}
 		m_wield_meshnode = new WieldMeshSceneNode(m_smgr, -1);
+		// dropped items and the like often come in large numbers
+		m_wield_meshnode->setInstanced(g_settings->getBool("enable_entity_instancing") &&
+			RenderingEngine::get_video_driver()->queryFeature(video::EVDF_DRAW_INSTANCED));
 		m_wield_meshnode->setItem(item, m_client,
 			(m_prop.visual == OBJECTVISUAL_WIELDITEM));
 
@@ -764,7 +782,7 @@ void GenericCAO::addToScene(ITextureSource *tsrc, scene::ISceneManager *smgr)
 
 		if (m_animated_meshnode) {
 			auto *mesh = m_animated_meshnode->getMesh();
-			// skinning happens on the CPU
+			// skinning happens on the CPU, at least for the shadows
 			if (m_animated_meshnode->getJointCount() > 0)
 				mesh->setHardwareMappingHint(scene::EHM_STREAM, scene::EBT_VERTEX);
 			else
@@ -956,11 +974,22 @@ void GenericCAO::updateNodePos()
 		v3s16 camera_offset = m_env->getCameraOffset();
 		v3f pos = pos_translator.val_current -
 				intToFloat(camera_offset, BS);
+		// not a sprite: rotate
+		const bool rotate = node != m_spritenode;
+		v3f rot;
+		if (rotate)
+			rot = m_is_local_player ? -m_rotation : -rot_translator.val_current;
+
+		// Most objects stand still, spare them the trigonometry
+		if (m_node_transform_valid && pos == m_node_pos && rot == m_node_rot)
+			return;
+		m_node_transform_valid = true;
+		m_node_pos = pos;
+		m_node_rot = rot;
+
 		getPosRotMatrix().setTranslation(pos);
-		if (node != m_spritenode) { // rotate if not a sprite
-			v3f rot = m_is_local_player ? -m_rotation : -rot_translator.val_current;
+		if (rotate)
 			setPitchYawRoll(getPosRotMatrix(), rot);
-		}
 	}
 }
 
@@ -1391,6 +1420,7 @@ void GenericCAO::updateAttachments()
 	ClientActiveObject *parent = getParent();
 
 	m_attached_to_local = parent && parent->isLocalPlayer();
+	m_node_transform_valid = false;
 
 	/*
 	Following cases exist:
@@ -1463,6 +1493,37 @@ bool GenericCAO::visualExpiryRequired(const ObjectProperties &new_) const
 		(uses_legacy_texture && old.textures != new_.textures);
 }
 
+void GenericCAO::processPositionUpdate(const AOPositionUpdate &update)
+{
+	// Movement packets are unreliable, so they can arrive out of order
+	if (update.seq != 0) {
+		if (m_movement_seq != 0 && (s16)(update.seq - m_movement_seq) <= 0)
+			return;
+		m_movement_seq = update.seq;
+	}
+
+	// Not sent by the server if this object is an attachment.
+	// We might however get here if the server notices the object being detached before the client.
+	m_position = update.position;
+	m_velocity = update.velocity;
+	m_acceleration = update.acceleration;
+	m_rotation = wrapDegrees_0_360_v3f(update.rotation);
+
+	if(getParent() != NULL) // Just in case
+		return;
+
+	if(update.do_interpolate)
+	{
+		if(!m_prop.physical)
+			pos_translator.update(m_position, update.is_end_position,
+				update.update_interval);
+	} else {
+		pos_translator.init(m_position);
+	}
+	rot_translator.update(m_rotation, false, update.update_interval);
+	updateNodePos();
+}
+
 void GenericCAO::processMessage(const std::string &data)
 {
 	//infostream<<"GenericCAO: Got message"<<std::endl;
@@ -1521,30 +1582,17 @@ void GenericCAO::processMessage(const std::string &data)
 			updateMarker();
 		}
 	} else if (cmd == AO_CMD_UPDATE_POSITION) {
-		// Not sent by the server if this object is an attachment.
-		// We might however get here if the server notices the object being detached before the client.
-		m_position = readV3F32(is);
-		m_velocity = readV3F32(is);
-		m_acceleration = readV3F32(is);
-		m_rotation = readV3F32(is);
-
-		m_rotation = wrapDegrees_0_360_v3f(m_rotation);
-		bool do_interpolate = readU8(is);
-		bool is_end_position = readU8(is);
-		float update_interval = readF32(is);
-
-		if(getParent() != NULL) // Just in case
-			return;
-
-		if(do_interpolate)
-		{
-			if(!m_prop.physical)
-				pos_translator.update(m_position, is_end_position, update_interval);
-		} else {
-			pos_translator.init(m_position);
-		}
-		rot_translator.update(m_rotation, false, update_interval);
-		updateNodePos();
+		// Usually decoded by ClientEnvironment::processActiveObjectMessages()
+		AOPositionUpdate update;
+		update.id = getId();
+		update.position = readV3F32(is);
+		update.velocity = readV3F32(is);
+		update.acceleration = readV3F32(is);
+		update.rotation = readV3F32(is);
+		update.do_interpolate = readU8(is);
+		update.is_end_position = readU8(is);
+		update.update_interval = readF32(is);
+		processPositionUpdate(update);
 	} else if (cmd == AO_CMD_SET_TEXTURE_MOD) {
 		std::string mod = deSerializeString16(is);
 
@@ -93,6 +93,11 @@ class GenericCAO : public ClientActiveObject
 	WieldMeshSceneNode *m_wield_meshnode = nullptr;
 	scene::IBillboardSceneNode *m_spritenode = nullptr;
 	scene::IDummyTransformationSceneNode *m_matrixnode = nullptr;
+	// Last transform set by updateNodePos(), which skips it if unchanged.
+	// Cleared when m_matrixnode is set up otherwise.
+	bool m_node_transform_valid = false;
+	v3f m_node_pos;
+	v3f m_node_rot;
 	Nametag *m_nametag = nullptr;
 	MinimapMarker *m_marker = nullptr;
 	bool m_visuals_expired = false;
@@ -108,6 +113,8 @@ class GenericCAO : public ClientActiveObject
 	v3f m_velocity;
 	v3f m_acceleration;
 	v3f m_rotation;
+	// Sequence number of the last applied TOCLIENT_OBJECT_MOVEMENT
+	u16 m_movement_seq = 0;
 	u16 m_hp = 1;
 	SmoothTranslator<v3f> pos_translator;
 	SmoothTranslatorWrappedv3f rot_translator;
@@ -287,6 +294,7 @@ class GenericCAO : public ClientActiveObject
 	void updateAnimationSpeed();
 
 	void processMessage(const std::string &data) override;
+	void processPositionUpdate(const AOPositionUpdate &update) override;
 
 	bool directReportPunch(v3f dir, const ItemStack *punchitem,
 			const ItemStack *hand_item, float time_from_last_punch=1000000) override;
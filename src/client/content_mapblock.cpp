@@ -54,6 +54,16 @@ static const u8 light_indices[6][4] = {
 	{2, 6, 4, 0},
 };
 
+// Maps cuboid face index to the direction it faces
+static const v3s16 tile_dirs[6] = {
+	v3s16(0, 1, 0),
+	v3s16(0, -1, 0),
+	v3s16(1, 0, 0),
+	v3s16(-1, 0, 0),
+	v3s16(0, 0, 1),
+	v3s16(0, 0, -1)
+};
+
 // Standard index set to make a quad on 4 vertices
 static constexpr u16 quad_indices_02[] = {0, 1, 2, 2, 3, 0};
 static constexpr u16 quad_indices_13[] = {0, 1, 3, 3, 1, 2};
@@ -429,14 +439,6 @@ void MapblockMeshGenerator::drawAutoLightedCuboid(aabb3f box,
 void MapblockMeshGenerator::drawSolidNode()
 {
 	u8 faces = 0; // k-th bit will be set if k-th face is to be drawn.
-	static const v3s16 tile_dirs[6] = {
-		v3s16(0, 1, 0),
-		v3s16(0, -1, 0),
-		v3s16(1, 0, 0),
-		v3s16(-1, 0, 0),
-		v3s16(0, 0, 1),
-		v3s16(0, 0, -1)
-	};
 	TileSpec tiles[6];
 	u16 lights[6];
 	content_t n1 = cur_node.n.getContent();
@@ -472,6 +474,7 @@ void MapblockMeshGenerator::drawSolidNode()
 	if (!faces)
 		return;
 	u8 mask = faces ^ 0b0011'1111; // k-th bit is set if k-th face is to be *omitted*, as expected by cuboid drawing functions.
+	const bool merge = data->m_merge_solid_faces && cur_node.f->drawtype == NDT_NORMAL;
 	auto box = aabb3f(v3f(-0.5 * BS), v3f(0.5 * BS));
 	box.MinEdge += cur_node.origin;
 	box.MaxEdge += cur_node.origin;
@@ -485,6 +488,11 @@ void MapblockMeshGenerator::drawSolidNode()
 				lights[face][k] = LightPair(getSmoothLightSolid(
 						blockpos_nodes + cur_node.p, tile_dirs[face], corner, data));
 			}
+			// Only evenly lit faces are merged, the interpolation would differ otherwise
+			const LightPair *l = lights[face];
+			if (merge && l[0] == l[1] && l[0] == l[2] && l[0] == l[3] &&
+					addMergeableFace(face, tile_dirs[face], tiles[face], l[0]))
+				mask |= 1 << face;
 		}
 
 		drawCuboid(box, tiles, 6, nullptr, mask, [&] (int face, video::S3DVertex vertices[4]) {
@@ -500,6 +508,12 @@ void MapblockMeshGenerator::drawSolidNode()
 			return QuadDiagonal::Diag02;
 		});
 	} else {
+		for (int face = 0; merge && face < 6; ++face) {
+			if (!(mask & (1 << face)) && addMergeableFace(face, tile_dirs[face],
+					tiles[face], LightPair(lights[face])))
+				mask |= 1 << face;
+		}
+
 		drawCuboid(box, tiles, 6, nullptr, mask, [&] (int face, video::S3DVertex vertices[4]) {
 			video::SColor color = encode_light(lights[face], cur_node.f->light_source);
 			if (!cur_node.f->light_source)
@@ -513,6 +527,299 @@ void MapblockMeshGenerator::drawSolidNode()
 	}
 }
 
+static bool isSameTile(const TileSpec &a, const TileSpec &b)
+{
+	if (a.world_aligned != b.world_aligned || a.rotation != b.rotation)
+		return false;
+	for (int layer = 0; layer < MAX_TILE_LAYERS; layer++) {
+		if (a.layers[layer] != b.layers[layer])
+			return false;
+	}
+	return true;
+}
+
+// Queues a face of a solid node to be drawn by drawMergedFaces(),
+// returns false if it can't be merged and must be drawn right away.
+bool MapblockMeshGenerator::addMergeableFace(int face, v3s16 dir,
+		const TileSpec &tile, LightPair light)
+{
+	// Merged faces repeat the texture on them, so it must wrap around and
+	// look the same at every node
+	if (tile.world_aligned && tile.layers[0].scale > 1)
+		return false;
+	constexpr u8 tileable = MATERIAL_FLAG_TILEABLE_HORIZONTAL |
+			MATERIAL_FLAG_TILEABLE_VERTICAL;
+	for (const auto &layer : tile.layers) {
+		if (layer.empty())
+			continue;
+		if ((layer.material_flags & tileable) != tileable ||
+				(layer.material_flags & MATERIAL_FLAG_CRACK))
+			return false;
+		// Must stay sortable by node
+		if (layer.isTransparent())
+			return false;
+	}
+
+	video::SColor color = encode_light(light, cur_node.f->light_source);
+	if (!cur_node.f->light_source)
+		applyFacesShading(color, v3f::from(dir));
+	merge_faces[face].push_back({cur_node.p, tile, color});
+	return true;
+}
+
+// Draws the faces queued by addMergeableFace(), merging the ones that are
+// next to each other in the same plane and look the same into larger quads.
+// The faces are at positions of cells that are cell_size nodes large.
+void MapblockMeshGenerator::drawMergedFaces(s16 cell_size)
+{
+	// For each face: the axis across the faces, and the axes along the
+	// texture coordinates u and v, see setupCuboidVertices()
+	static const u8 face_axes[6][3] = {
+		{1, 0, 2}, // up
+		{1, 0, 2}, // down
+		{0, 2, 1}, // right
+		{0, 2, 1}, // left
+		{2, 0, 1}, // back
+		{2, 0, 1}, // front
+	};
+	const s32 side = data->m_side_length / cell_size;
+	std::vector<s32> grid(side * side);
+	// the faces may be just outside of the mesh, facing into it
+	std::vector<std::vector<u32>> slices(side + 2);
+
+	for (int face = 0; face < 6; face++) {
+		const auto &faces = merge_faces[face];
+		if (faces.empty())
+			continue;
+		const u8 *axes = face_axes[face];
+		for (auto &slice : slices)
+			slice.clear();
+		for (u32 i = 0; i < faces.size(); i++)
+			slices[faces[i].p[axes[0]] + 1].push_back(i);
+
+		for (s32 s = -1; s <= side; s++) {
+			if (slices[s + 1].empty())
+				continue;
+			std::fill(grid.begin(), grid.end(), -1);
+			for (u32 i : slices[s + 1])
+				grid[faces[i].p[axes[2]] * side + faces[i].p[axes[1]]] = i;
+
+			for (s32 v = 0; v < side; v++)
+			for (s32 u = 0; u < side; u++) {
+				if (grid[v * side + u] < 0)
+					continue;
+				const MergeableFace &first = faces[grid[v * side + u]];
+				auto matches = [&] (s32 u2, s32 v2) {
+					s32 i = grid[v2 * side + u2];
+					return i >= 0 && faces[i].color == first.color &&
+							isSameTile(faces[i].tile, first.tile);
+				};
+
+				// Grow along u first, then along v as long as whole rows match
+				s32 width = 1;
+				while (u + width < side && matches(u + width, v))
+					width++;
+				s32 height = 1;
+				for (; v + height < side; height++) {
+					s32 k = 0;
+					while (k < width && matches(u + k, v + height))
+						k++;
+					if (k < width)
+						break;
+				}
+
+				v3s16 pmin, pmax;
+				pmin[axes[0]] = pmax[axes[0]] = s;
+				pmin[axes[1]] = u;
+				pmax[axes[1]] = u + width - 1;
+				pmin[axes[2]] = v;
+				pmax[axes[2]] = v + height - 1;
+				pmin *= cell_size;
+				pmax = pmax * cell_size + (cell_size - 1);
+				aabb3f box(intToFloat(pmin, BS) - 0.5f * BS,
+						intToFloat(pmax, BS) + 0.5f * BS);
+				// The texture is repeated once per node
+				f32 txc[24];
+				for (int k = 0; k < 6; k++) {
+					txc[4 * k] = 0.0f;
+					txc[4 * k + 1] = 0.0f;
+					txc[4 * k + 2] = width * cell_size;
+					txc[4 * k + 3] = height * cell_size;
+				}
+				auto vertices = setupCuboidVertices(box, txc, &first.tile, 1, pmin);
+				for (int j = 0; j < 4; j++)
+					vertices[4 * face + j].Color = first.color;
+				collector->append(first.tile, &vertices[4 * face], 4, quad_indices, 6);
+
+				for (s32 dv = 0; dv < height; dv++)
+				for (s32 du = 0; du < width; du++)
+					grid[(v + dv) * side + u + du] = -1;
+			}
+		}
+	}
+}
+
+// Sums up the nodes of a cell, relative to blockpos_nodes and in units of
+// data->m_lod. The cell is filled if at least half of its nodes are.
+MapblockMeshGenerator::LodCell MapblockMeshGenerator::getLodCell(v3s16 cell) const
+{
+	const s16 size = data->m_lod;
+	const v3s16 p0 = blockpos_nodes + cell * size;
+	u32 counts[4] = {};
+	// topmost node of each kind
+	MapNode top[4];
+	v3s16 p;
+	for (p.Y = size - 1; p.Y >= 0; p.Y--)
+	for (p.Z = 0; p.Z < size; p.Z++)
+	for (p.X = 0; p.X < size; p.X++) {
+		MapNode n = data->m_vmanip.getNodeNoExNoEmerge(p0 + p);
+		LodKind kind = LOD_EMPTY;
+		if (n.getContent() == CONTENT_IGNORE) {
+			kind = LOD_UNKNOWN;
+		} else {
+			switch (nodedef->get(n).drawtype) {
+			case NDT_NORMAL:
+			case NDT_ALLFACES:
+			case NDT_ALLFACES_OPTIONAL:
+			case NDT_GLASSLIKE:
+			case NDT_GLASSLIKE_FRAMED:
+			case NDT_GLASSLIKE_FRAMED_OPTIONAL:
+				kind = LOD_SOLID;
+				break;
+			case NDT_LIQUID:
+			case NDT_FLOWINGLIQUID:
+				kind = LOD_LIQUID;
+				break;
+			default:
+				break;
+			}
+		}
+		if (counts[kind]++ == 0)
+			top[kind] = n;
+	}
+
+	LodCell c;
+	const u32 known = size * size * size - counts[LOD_UNKNOWN];
+	const u32 filled = counts[LOD_SOLID] + counts[LOD_LIQUID];
+	if (known == 0)
+		c.kind = LOD_UNKNOWN;
+	else if (filled * 2 < known)
+		c.kind = LOD_EMPTY;
+	else
+		c.kind = counts[LOD_SOLID] >= counts[LOD_LIQUID] ? LOD_SOLID : LOD_LIQUID;
+	c.full = counts[c.kind] == known;
+	c.filled = filled > 0;
+	c.n = top[c.kind];
+
+	// flowing liquids are drawn as their source
+	if (c.kind == LOD_LIQUID) {
+		const ContentFeatures &f = nodedef->get(c.n);
+		if (f.drawtype == NDT_FLOWINGLIQUID && f.liquid_alternative_source_id != CONTENT_IGNORE)
+			c.n = MapNode(f.liquid_alternative_source_id);
+	}
+	return c;
+}
+
+// Queues the face of a cell, lit by the brightest node in front of it
+void MapblockMeshGenerator::addLodFace(v3s16 cell, int face, const LodCell &c)
+{
+	const s16 size = data->m_lod;
+	const v3s16 dir = tile_dirs[face];
+	cur_node.p = cell * size;
+	cur_node.n = c.n;
+	cur_node.f = &nodedef->get(c.n);
+
+	TileSpec tile;
+	getTile(dir, &tile);
+	for (auto &layer : tile.layers) {
+		layer.material_flags &= ~MATERIAL_FLAG_CRACK;
+		if (c.kind == LOD_SOLID)
+			layer.material_flags |= MATERIAL_FLAG_BACKFACE_CULLING;
+	}
+
+	// the layer of nodes in front of the face
+	v3s16 front_min = blockpos_nodes + cur_node.p, front_max = front_min + (size - 1);
+	for (int axis = 0; axis < 3; axis++) {
+		if (dir[axis] > 0)
+			front_min[axis] = front_max[axis] = front_max[axis] + 1;
+		else if (dir[axis] < 0)
+			front_max[axis] = front_min[axis] = front_min[axis] - 1;
+	}
+	LightPair light{};
+	v3s16 p;
+	for (p.Z = front_min.Z; p.Z <= front_max.Z; p.Z++)
+	for (p.Y = front_min.Y; p.Y <= front_max.Y; p.Y++)
+	for (p.X = front_min.X; p.X <= front_max.X; p.X++) {
+		LightPair l(getFaceLight(c.n, data->m_vmanip.getNodeNoExNoEmerge(p), nodedef));
+		light.lightDay = std::max(light.lightDay, l.lightDay);
+		light.lightNight = std::max(light.lightNight, l.lightNight);
+	}
+
+	video::SColor color = encode_light(light, cur_node.f->light_source);
+	if (!cur_node.f->light_source)
+		applyFacesShading(color, v3f::from(dir));
+	merge_faces[face].push_back({cell, tile, color});
+}
+
+/*
+	Draws cells of data->m_lod nodes instead of the nodes. Each one is a
+	cube of the solid or liquid nodes in it, or nothing.
+
+	Neighbors may be drawn with a different level of detail. To not leave
+	holes between them, solid cells at the edge of the mesh always get their
+	sides unless the cell next to them is entirely solid, and the sides of
+	outside cells are drawn where the cell inside has some nodes of its own.
+*/
+void MapblockMeshGenerator::generateLod()
+{
+	ZoneScoped;
+
+	const s16 size = data->m_lod;
+	const s16 cells = data->m_side_length / size;
+	// with one cell around the mesh
+	const s16 stride = cells + 2;
+	std::vector<LodCell> grid(stride * stride * stride);
+	auto at = [&] (v3s16 c) -> LodCell & {
+		return grid[((c.Z + 1) * stride + c.Y + 1) * stride + c.X + 1];
+	};
+	auto inside = [&] (v3s16 c) {
+		return c.X >= 0 && c.Y >= 0 && c.Z >= 0 &&
+				c.X < cells && c.Y < cells && c.Z < cells;
+	};
+
+	v3s16 c;
+	for (c.Z = -1; c.Z <= cells; c.Z++)
+	for (c.Y = -1; c.Y <= cells; c.Y++)
+	for (c.X = -1; c.X <= cells; c.X++) {
+		// the corners and edges of the ring are never looked at
+		int outside = (c.X < 0 || c.X >= cells) + (c.Y < 0 || c.Y >= cells) +
+				(c.Z < 0 || c.Z >= cells);
+		if (outside <= 1)
+			at(c) = getLodCell(c);
+	}
+
+	for (c.Z = 0; c.Z < cells; c.Z++)
+	for (c.Y = 0; c.Y < cells; c.Y++)
+	for (c.X = 0; c.X < cells; c.X++) {
+		const LodCell &cell = at(c);
+		for (int face = 0; face < 6; face++) {
+			const v3s16 c2 = c + tile_dirs[face];
+			const LodCell &cell2 = at(c2);
+			if (cell2.kind == LOD_UNKNOWN)
+				continue;
+			const bool edge = !inside(c2);
+			if (cell.kind > cell2.kind ||
+					(edge && cell.kind == LOD_SOLID && !cell2.full))
+				addLodFace(c, face, cell);
+			// the side of the outside cell, facing into the mesh
+			if (edge && cell2.kind > cell.kind && cell.filled)
+				addLodFace(c2, face ^ 1, cell2);
+		}
+	}
+
+	drawMergedFaces(size);
+}
+
 u8 MapblockMeshGenerator::getNodeBoxMask(aabb3f box, u8 solid_neighbors, u8 sametype_neighbors) const
 {
 	const f32 NODE_BOUNDARY = 0.5 * BS;
@@ -1455,9 +1762,9 @@ bool MapblockMeshGenerator::isSameRail(v3s16 dir)
 	MapNode node2 = data->m_vmanip.getNodeNoEx(blockpos_nodes + cur_node.p + dir);
 	if (node2.getContent() == cur_node.n.getContent())
 		return true;
-	const ContentFeatures &def2 = nodedef->get(node2);
-	return ((def2.drawtype == NDT_RAILLIKE) &&
-		(def2.getGroup(raillike_groupname) == cur_rail.raillike_group));
+	return nodedef->getShapeFlags(node2).drawtype == NDT_RAILLIKE &&
+		nodedef->getGroupRating(node2.getContent(), cur_rail.group_id) ==
+			cur_rail.raillike_group;
 }
 
 namespace {
@@ -1503,7 +1810,9 @@ namespace {
 
 void MapblockMeshGenerator::drawRaillikeNode()
 {
-	cur_rail.raillike_group = cur_node.f->getGroup(raillike_groupname);
+	cur_rail.group_id = nodedef->getGroupId(raillike_groupname);
+	cur_rail.raillike_group = nodedef->getGroupRating(cur_node.n.getContent(),
+			cur_rail.group_id);
 
 	int code = 0;
 	int angle;
@@ -1811,11 +2120,22 @@ void MapblockMeshGenerator::generate()
 {
 	ZoneScoped;
 
+	if (data->m_lod > 1) {
+		generateLod();
+		return;
+	}
+
 	for (cur_node.p.Z = 0; cur_node.p.Z < data->m_side_length; cur_node.p.Z++)
 	for (cur_node.p.Y = 0; cur_node.p.Y < data->m_side_length; cur_node.p.Y++)
 	for (cur_node.p.X = 0; cur_node.p.X < data->m_side_length; cur_node.p.X++) {
 		cur_node.n = data->m_vmanip.getNodeNoEx(blockpos_nodes + cur_node.p);
+		// Most nodes are air, don't touch their features at all
+		if (nodedef->getShapeFlags(cur_node.n).drawtype == NDT_AIRLIKE)
+			continue;
 		cur_node.f = &nodedef->get(cur_node.n);
 		drawNode();
 	}
+
+	if (data->m_merge_solid_faces)
+		drawMergedFaces();
 }
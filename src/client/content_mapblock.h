@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <vector>
 #include "nodedef.h"
 
 struct MeshMakeData;
@@ -91,6 +92,39 @@ class MapblockMeshGenerator
 	void drawAutoLightedCuboid(aabb3f box, const TileSpec *tiles, int tile_count, f32 const *txc = nullptr, u8 mask = 0);
 	u8 getNodeBoxMask(aabb3f box, u8 solid_neighbors, u8 sametype_neighbors) const;
 
+// merging of solid faces
+	struct MergeableFace {
+		v3s16 p;
+		TileSpec tile;
+		video::SColor color;
+	};
+	// indexed by face, in the order of the cuboid faces
+	std::vector<MergeableFace> merge_faces[6];
+
+	bool addMergeableFace(int face, v3s16 dir, const TileSpec &tile, LightPair light);
+	void drawMergedFaces(s16 cell_size = 1);
+
+// simplified meshes, see MeshMakeData::m_lod
+	enum LodKind : u8 {
+		LOD_UNKNOWN, // not loaded
+		LOD_EMPTY,
+		LOD_LIQUID,
+		LOD_SOLID,
+	};
+	struct LodCell {
+		LodKind kind;
+		// all known nodes are of this kind
+		bool full;
+		// has some liquid or solid nodes, even if empty
+		bool filled;
+		// drawn for the whole cell
+		MapNode n;
+	};
+
+	LodCell getLodCell(v3s16 cell) const;
+	void addLodFace(v3s16 cell, int face, const LodCell &c);
+	void generateLod();
+
 // liquid-specific
 	struct LiquidData {
 		struct NeighborData {
@@ -124,6 +158,7 @@ class MapblockMeshGenerator
 	// name of the group that enables connecting to raillike nodes of different kind
 	static const std::string raillike_groupname;
 	struct RaillikeData {
+		u16 group_id; // of raillike_groupname
 		int raillike_group;
 	};
 	RaillikeData cur_rail;
@@ -14,6 +14,7 @@
 #include <cmath>
 #include <cstring>
 #include <unordered_set>
+#include <vector>
 
 /** reference to access font engine, has to be initialized by main */
 FontEngine *g_fontengine = nullptr;
@@ -34,6 +35,26 @@ static const char *settings[] = {
 	"dpi_change_notifier", "display_density_factor", "gui_scaling",
 };
 
+/// Characters that are rendered in the background for every new font,
+/// ASCII is loaded with the font itself
+static std::vector<char32_t> getPreloadCharacters()
+{
+	static const std::pair<char32_t, char32_t> ranges[] = {
+		{0x00A0, 0x017F}, // Latin-1 Supplement, Latin Extended-A
+		{0x0370, 0x03FF}, // Greek
+		{0x0400, 0x04FF}, // Cyrillic
+		{0x2010, 0x205E}, // General Punctuation
+		{0x20AC, 0x20AC}, // Euro sign
+		{0xFFFD, 0xFFFD}, // Replacement character
+	};
+	std::vector<char32_t> ret;
+	for (auto &range : ranges) {
+		for (char32_t c = range.first; c <= range.second; c++)
+			ret.push_back(c);
+	}
+	return ret;
+}
+
 FontEngine::FontEngine(gui::IGUIEnvironment* env) :
 	m_env(env)
 {
@@ -271,6 +292,8 @@ gui::IGUIFont *FontEngine::initFont(FontSpec spec)
 			FontSpec spec2(spec);
 			spec2.mode = _FM_Fallback;
 			font->setFallback(getFont(spec2, true));
+			// The fallback font is only asked for what this one lacks
+			font->preloadGlyphs(getPreloadCharacters());
 		}
 
 		return font;
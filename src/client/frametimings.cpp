@@ -0,0 +1,257 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "frametimings.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <IVideoDriver.h>
+#include <mt_opengl.h>
+#include "log.h"
+
+FrameTimings *g_frame_timings = nullptr;
+
+// Frames that may wait for their GPU times
+static constexpr size_t FRAMES_IN_FLIGHT = 5;
+// Weight of a new frame in the moving averages
+static constexpr float AVERAGE_WEIGHT = 0.05f;
+
+FrameTimings::FrameTimings(video::IVideoDriver *driver) :
+	m_frames(FRAMES_IN_FLIGHT)
+{
+	// the first stage is the whole frame
+	m_stages.push_back({"Frame"});
+
+	const auto type = driver->getDriverType();
+	if ((type != video::EDT_OPENGL && type != video::EDT_OPENGL3) ||
+			!GL.GenQueries || !GL.DeleteQueries || !GL.QueryCounter ||
+			!GL.GetQueryObjectuiv || !GL.GetQueryObjectui64v)
+		return;
+
+	// Timestamp queries are core since OpenGL 3.3
+	int major = 0, minor = 0;
+	auto version = reinterpret_cast<const char *>(GL.GetString(GL.VERSION));
+	if (version)
+		sscanf(version, "%d.%d", &major, &minor);
+	m_gpu_supported = major > 3 || (major == 3 && minor >= 3) ||
+			GL.IsExtensionPresent("GL_ARB_timer_query");
+	m_stages[0].has_gpu = m_gpu_supported;
+	verbosestream << "FrameTimings: GPU times "
+			<< (m_gpu_supported ? "supported" : "not supported") << std::endl;
+}
+
+FrameTimings::~FrameTimings()
+{
+	for (Frame &frame : m_frames) {
+		if (!frame.queries.empty())
+			GL.DeleteQueries(frame.queries.size(), frame.queries.data());
+	}
+}
+
+bool FrameTimings::openCSV(const std::string &path)
+{
+	m_csv.open(path, std::ios::trunc);
+	if (!m_csv.good()) {
+		errorstream << "FrameTimings: couldn't open " << path << std::endl;
+		m_csv.close();
+		return false;
+	}
+	m_csv_stages = 0;
+	actionstream << "Writing frame timings to " << path << std::endl;
+	return true;
+}
+
+size_t FrameTimings::getStage(const char *key)
+{
+	for (size_t i = 0; i < m_stages.size(); i++) {
+		if (m_stages[i].key == key || strcmp(m_stages[i].key, key) == 0)
+			return i;
+	}
+	m_stages.push_back({key});
+	return m_stages.size() - 1;
+}
+
+void FrameTimings::beginFrame()
+{
+	m_recording = m_enabled || m_csv.is_open();
+	if (!m_recording)
+		return;
+
+	Frame &frame = m_frames[m_current];
+	// The GPU is too far behind, don't wait for it
+	if (frame.pending)
+		publish(frame, false);
+
+	frame.number = m_frame_count++;
+	frame.cpu_ms.assign(m_stages.size(), 0.0f);
+	frame.gpu_ms.assign(m_stages.size(), 0.0f);
+	frame.query_stages.clear();
+	frame.last_query = 0;
+	m_open_steps.clear();
+	m_frame_start_us = porting::getTimeUs();
+}
+
+void FrameTimings::endFrame()
+{
+	if (m_recording) {
+		Frame &frame = m_frames[m_current];
+		frame.cpu_ms[0] = (porting::getTimeUs() - m_frame_start_us) / 1000.0f;
+		frame.pending = true;
+		m_current = (m_current + 1) % m_frames.size();
+		m_recording = false;
+	}
+
+	// Oldest first, the queries finish in order
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		Frame &frame = m_frames[(m_current + i) % m_frames.size()];
+		if (!frame.pending)
+			continue;
+		if (m_gpu_supported && !readGPUTimes(frame))
+			break;
+		publish(frame, m_gpu_supported);
+	}
+}
+
+void FrameTimings::addCPUTime(const char *stage, u64 time_us)
+{
+	if (!m_recording)
+		return;
+	const size_t index = getStage(stage);
+	Frame &frame = m_frames[m_current];
+	if (index >= frame.cpu_ms.size()) {
+		frame.cpu_ms.resize(index + 1, 0.0f);
+		frame.gpu_ms.resize(index + 1, 0.0f);
+	}
+	frame.cpu_ms[index] += time_us / 1000.0f;
+}
+
+size_t FrameTimings::beginStep(const char *stage)
+{
+	if (!m_recording)
+		return SIZE_MAX;
+
+	OpenStep step{getStage(stage), porting::getTimeUs(), SIZE_MAX};
+	if (m_gpu_supported) {
+		Frame &frame = m_frames[m_current];
+		step.query = frame.query_stages.size();
+		if (frame.queries.size() < 2 * (step.query + 1)) {
+			frame.queries.resize(2 * (step.query + 1));
+			GL.GenQueries(2, &frame.queries[2 * step.query]);
+		}
+		frame.query_stages.push_back(step.stage);
+		GL.QueryCounter(frame.queries[2 * step.query], GL.TIMESTAMP);
+	}
+	m_open_steps.push_back(step);
+	return m_open_steps.size() - 1;
+}
+
+void FrameTimings::endStep(size_t handle)
+{
+	if (!m_recording || handle >= m_open_steps.size())
+		return;
+
+	const OpenStep &step = m_open_steps[handle];
+	addCPUTime(m_stages[step.stage].key, porting::getTimeUs() - step.start_us);
+	if (step.query != SIZE_MAX) {
+		Frame &frame = m_frames[m_current];
+		frame.last_query = frame.queries[2 * step.query + 1];
+		GL.QueryCounter(frame.last_query, GL.TIMESTAMP);
+	}
+}
+
+bool FrameTimings::readGPUTimes(Frame &frame)
+{
+	if (frame.query_stages.empty())
+		return true;
+
+	u32 available = 0;
+	GL.GetQueryObjectuiv(frame.last_query, GL.QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	u64 first = U64_MAX, last = 0;
+	for (size_t i = 0; i < frame.query_stages.size(); i++) {
+		u64 begin = 0, end = 0;
+		GL.GetQueryObjectui64v(frame.queries[2 * i], GL.QUERY_RESULT, &begin);
+		GL.GetQueryObjectui64v(frame.queries[2 * i + 1], GL.QUERY_RESULT, &end);
+		if (end < begin)
+			continue;
+		const size_t stage = frame.query_stages[i];
+		if (stage >= frame.gpu_ms.size()) {
+			frame.cpu_ms.resize(stage + 1, 0.0f);
+			frame.gpu_ms.resize(stage + 1, 0.0f);
+		}
+		frame.gpu_ms[stage] += (end - begin) / 1e6f;
+		m_stages[stage].has_gpu = true;
+		first = std::min(first, begin);
+		last = std::max(last, end);
+	}
+	if (last >= first)
+		frame.gpu_ms[0] = (last - first) / 1e6f;
+	return true;
+}
+
+void FrameTimings::publish(Frame &frame, bool have_gpu)
+{
+	frame.pending = false;
+	for (size_t i = 0; i < m_stages.size(); i++) {
+		Stage &stage = m_stages[i];
+		const bool in_frame = i < frame.cpu_ms.size();
+		stage.cpu_ms += AVERAGE_WEIGHT *
+				((in_frame ? frame.cpu_ms[i] : 0.0f) - stage.cpu_ms);
+		if (have_gpu) {
+			stage.gpu_ms += AVERAGE_WEIGHT *
+					((in_frame ? frame.gpu_ms[i] : 0.0f) - stage.gpu_ms);
+		}
+	}
+	if (m_csv.is_open())
+		writeCSV(frame, have_gpu);
+}
+
+void FrameTimings::writeCSV(const Frame &frame, bool have_gpu)
+{
+	// A new header is written when stages are added
+	if (m_stages.size() > m_csv_stages) {
+		m_csv << "frame";
+		for (const Stage &stage : m_stages)
+			m_csv << "," << stage.key << " CPU," << stage.key << " GPU";
+		m_csv << "\n";
+		m_csv_stages = m_stages.size();
+	}
+
+	m_csv << frame.number;
+	for (size_t i = 0; i < m_stages.size(); i++) {
+		const bool in_frame = i < frame.cpu_ms.size();
+		m_csv << "," << (in_frame ? frame.cpu_ms[i] : 0.0f) << ",";
+		if (have_gpu && m_stages[i].has_gpu)
+			m_csv << (in_frame ? frame.gpu_ms[i] : 0.0f);
+	}
+	m_csv << "\n";
+}
+
+std::string FrameTimings::getOverlayText() const
+{
+	std::ostringstream os(std::ios_base::binary);
+	os << std::fixed << std::setprecision(2)
+		<< std::left << std::setw(18) << "Frame timings [ms]"
+		<< std::right << std::setw(8) << "CPU";
+	if (m_gpu_supported)
+		os << std::setw(8) << "GPU";
+
+	// the whole frame last
+	for (size_t n = 1; n <= m_stages.size(); n++) {
+		const Stage &stage = m_stages[n % m_stages.size()];
+		os << "\n" << std::left << std::setw(18) << stage.key
+			<< std::right << std::setw(8) << stage.cpu_ms;
+		if (!m_gpu_supported)
+			continue;
+		if (stage.has_gpu)
+			os << std::setw(8) << stage.gpu_ms;
+		else
+			os << std::setw(8) << "-";
+	}
+	return os.str();
+}
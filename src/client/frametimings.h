@@ -0,0 +1,136 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "irrlichttypes.h"
+#include "porting.h"
+#include "util/basic_macros.h"
+
+namespace video
+{
+	class IVideoDriver;
+}
+
+/*
+	Times the stages of the frames: scopes on the main thread on the CPU and
+	the steps of the render pipeline on the CPU and the GPU.
+
+	The GPU times come from timestamp queries. Their results are read some
+	frames later once they are available, so the CPU never waits for the GPU.
+*/
+class FrameTimings
+{
+public:
+	FrameTimings(video::IVideoDriver *driver);
+	~FrameTimings();
+
+	DISABLE_CLASS_COPY(FrameTimings)
+
+	// The timings are collected only while enabled or a CSV file is written
+	void setEnabled(bool enabled) { m_enabled = enabled; }
+	// Whether the current frame is timed
+	bool isRecording() const { return m_recording; }
+	bool hasGPUTimes() const { return m_gpu_supported; }
+
+	// Writes a line with the times of each frame in ms to the file
+	bool openCSV(const std::string &path);
+
+	void beginFrame();
+	// Also collects the GPU times of the previous frames that are available
+	void endFrame();
+
+	// stage: string literal, it is also the key of the stage
+	void addCPUTime(const char *stage, u64 time_us);
+
+	// Times a render step such that steps can be nested, returns the handle
+	// for endStep()
+	size_t beginStep(const char *stage);
+	void endStep(size_t handle);
+
+	// Table of the moving averages for the overlay
+	std::string getOverlayText() const;
+
+private:
+	struct Stage {
+		const char *key;
+		// moving averages in ms
+		float cpu_ms = 0.0f;
+		float gpu_ms = 0.0f;
+		bool has_gpu = false;
+	};
+
+	struct Frame {
+		u64 number = 0;
+		bool pending = false;
+		// by stage index, in ms
+		std::vector<float> cpu_ms;
+		std::vector<float> gpu_ms;
+		// pairs of begin and end timestamp queries, kept for the next frames
+		std::vector<u32> queries;
+		// stage of each pair in use
+		std::vector<size_t> query_stages;
+		// the query issued last
+		u32 last_query = 0;
+	};
+
+	struct OpenStep {
+		size_t stage;
+		u64 start_us;
+		// index of the query pair, or -1
+		size_t query;
+	};
+
+	size_t getStage(const char *key);
+	// Returns false if the results aren't available yet
+	bool readGPUTimes(Frame &frame);
+	void publish(Frame &frame, bool have_gpu);
+	void writeCSV(const Frame &frame, bool have_gpu);
+
+	bool m_gpu_supported = false;
+	bool m_enabled = false;
+	bool m_recording = false;
+
+	std::vector<Stage> m_stages;
+	std::vector<Frame> m_frames;
+	// of m_frames, receives the current frame
+	size_t m_current = 0;
+	u64 m_frame_count = 0;
+	u64 m_frame_start_us = 0;
+	std::vector<OpenStep> m_open_steps;
+
+	std::ofstream m_csv;
+	// stages listed in the last CSV header
+	size_t m_csv_stages = 0;
+};
+
+// Set while a game runs
+extern FrameTimings *g_frame_timings;
+
+// Adds the time until the end of the scope to a stage of g_frame_timings
+class FrameTimingScope
+{
+public:
+	FrameTimingScope(const char *stage) :
+		m_stage(g_frame_timings && g_frame_timings->isRecording() ? stage : nullptr)
+	{
+		if (m_stage)
+			m_start_us = porting::getTimeUs();
+	}
+
+	~FrameTimingScope()
+	{
+		if (m_stage && g_frame_timings)
+			g_frame_timings->addCPUTime(m_stage, porting::getTimeUs() - m_start_us);
+	}
+
+	DISABLE_CLASS_COPY(FrameTimingScope)
+
+private:
+	const char *m_stage;
+	u64 m_start_us = 0;
+};
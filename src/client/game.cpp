@@ -25,6 +25,7 @@
 #include "content/subgames.h"
 #include "client/event_manager.h"
 #include "fontengine.h"
+#include "frametimings.h"
 #include "gui/touchcontrols.h"
 #include "itemdef.h"
 #include "log.h"
@@ -540,6 +541,17 @@ struct GameRunData {
 	float time_of_day_smooth;
 };
 
+// Raycast of the last frame, see Game::updatePointedThing()
+struct PointedThingCache {
+	core::line3d<f32> shootline;
+	bool liquids_pointable;
+	// Points into the item definition
+	const std::optional<Pointabilities> *pointabilities;
+	bool look_for_object;
+	u32 map_changes;
+	PointedThing result;
+};
+
 class Game;
 
 struct ClientEventHandler
@@ -569,6 +581,7 @@ class Game {
 			const GameStartData &game_params,
 			std::string &error_message,
 			bool *reconnect,
+			ServerTransfer *transfer,
 			ChatBackend *chat_backend);
 
 	void run();
@@ -776,6 +789,7 @@ class Game {
 	QuicktuneShortcutter *quicktune = nullptr;
 
 	std::unique_ptr<GameUI> m_game_ui;
+	std::unique_ptr<FrameTimings> m_frame_timings;
 	irr_ptr<GUIChatConsole> gui_chat_console;
 	MapDrawControl *draw_control = nullptr;
 	Camera *camera = nullptr;
@@ -789,6 +803,7 @@ class Game {
 	std::unordered_map<u32, u32> m_hud_server_to_client;
 
 	GameRunData runData;
+	std::optional<PointedThingCache> m_pointed_cache;
 	Flags m_flags;
 
 	/* 'cache'
@@ -802,6 +817,7 @@ class Game {
 	volatile std::sig_atomic_t *kill;
 	std::string                *error_message;
 	bool                       *reconnect_requested;
+	ServerTransfer             *server_transfer;
 	PausedNodesList             paused_animated_nodes;
 
 	bool simple_singleplayer_mode;
@@ -940,6 +956,7 @@ bool Game::startup(volatile std::sig_atomic_t *kill,
 		const GameStartData &start_data,
 		std::string &error_message,
 		bool *reconnect,
+		ServerTransfer *transfer,
 		ChatBackend *chat_backend)
 {
 
@@ -949,6 +966,7 @@ bool Game::startup(volatile std::sig_atomic_t *kill,
 	this->kill                = kill;
 	this->error_message       = &error_message;
 	reconnect_requested       = reconnect;
+	server_transfer           = transfer;
 	this->input               = input;
 	this->chat_backend        = chat_backend;
 	simple_singleplayer_mode  = start_data.isSinglePlayer();
@@ -1038,6 +1056,7 @@ void Game::run()
 		draw_times.limit(device, &dtime);
 
 		framemarker.start();
+		m_frame_timings->beginFrame();
 
 		g_fontengine->handleReload();
 
@@ -1098,6 +1117,7 @@ void Game::run()
 		processPlayerInteraction(dtime, m_game_ui->m_flags.show_hud);
 		updateFrame(&graph, &stats, dtime, cam_view);
 		updateProfilerGraphs(&graph);
+		m_frame_timings->endFrame();
 
 		if (m_does_lost_focus_pause_game && !device->isWindowFocused() && !isMenuActive()) {
 			m_game_formspec.showPauseMenu();
@@ -1116,6 +1136,10 @@ void Game::run()
 
 void Game::shutdown()
 {
+	// Frames aren't timed anymore
+	g_frame_timings = nullptr;
+	m_frame_timings.reset();
+
 	// Delete text and menus first
 	m_game_ui->clearText();
 	m_game_formspec.reset();
@@ -1444,6 +1468,12 @@ bool Game::initGui()
 {
 	m_game_ui->init();
 
+	m_frame_timings = std::make_unique<FrameTimings>(driver);
+	const std::string frame_timings_csv = g_settings->get("frame_timings_csv");
+	if (!frame_timings_csv.empty())
+		m_frame_timings->openCSV(frame_timings_csv);
+	g_frame_timings = m_frame_timings.get();
+
 	// Remove stale "recent" chat messages from previous connections
 	chat_backend->clearRecentChat();
 
@@ -1717,6 +1747,12 @@ inline void Game::updateInteractTimers(f32 dtime)
  */
 inline bool Game::checkConnection()
 {
+	if (client->transferRequested()) {
+		server_transfer->address = client->getTransferAddress();
+		server_transfer->port = client->getTransferPort();
+		return false;
+	}
+
 	if (client->accessDenied()) {
 		*error_message = fmtgettext("Access denied. Reason: %s", client->accessDeniedReason().c_str());
 		*reconnect_requested = client->reconnectRequested();
@@ -1829,9 +1865,10 @@ void Game::updateStats(RunStats *stats, const FpsControl &draw_times,
 	/* Busytime average and jitter calculation
 	 */
 	jp = &stats->busy_time_jitter;
-	jp->avg = jp->avg + draw_times.getBusyMs() * 0.02;
+	const f32 busy_ms = draw_times.busy_time / 1000.0f;
+	jp->avg = jp->avg * 0.96 + busy_ms * 0.04;
 
-	jitter = draw_times.getBusyMs() - jp->avg;
+	jitter = busy_ms - jp->avg;
 
 	if (jitter > jp->max)
 		jp->max = jitter;
@@ -2326,6 +2363,7 @@ void Game::toggleDebug()
 	m_game_ui->m_flags.show_minimal_debug = state > 0;
 	m_game_ui->m_flags.show_basic_debug = state > 0 && has_basic_debug;
 	m_game_ui->m_flags.show_profiler_graph = state == 2;
+	m_frame_timings->setEnabled(state == 2);
 	draw_control->show_wireframe = state == 3;
 	smgr->setGlobalDebugData(state == 4 ? bbox_debug_flag : 0,
 			state == 4 ? 0 : bbox_debug_flag);
@@ -3322,9 +3360,24 @@ PointedThing Game::updatePointedThing(
 	runData.selected_object = NULL;
 	hud->pointing_at_object = false;
 
-	RaycastState s(shootline, look_for_object, liquids_pointable, pointabilities);
+	// Nodes stay where they are, so the last result holds until the ray or
+	// the map changes, unless there are objects on the way
 	PointedThing result;
-	env.continueRaycast(&s, &result);
+	const u32 map_changes = client->getMapChanges();
+	const auto &cache = m_pointed_cache;
+	if (cache && cache->shootline == shootline &&
+			cache->liquids_pointable == liquids_pointable &&
+			cache->pointabilities == &pointabilities &&
+			cache->look_for_object == look_for_object &&
+			cache->map_changes == map_changes &&
+			(!look_for_object || !env.hasSelectableObjects(shootline))) {
+		result = cache->result;
+	} else {
+		RaycastState s(shootline, look_for_object, liquids_pointable, pointabilities);
+		env.continueRaycast(&s, &result);
+		m_pointed_cache = PointedThingCache{shootline, liquids_pointable,
+			&pointabilities, look_for_object, map_changes, result};
+	}
 	if (result.type == POINTEDTHING_OBJECT) {
 		hud->pointing_at_object = true;
 
@@ -3634,7 +3687,7 @@ bool Game::nodePlacement(const ItemDefinition &selected_def,
 			|| predicted_f.param_type_2 == CPT2_COLORED_FACEDIR
 			|| predicted_f.param_type_2 == CPT2_COLORED_4DIR
 			|| predicted_f.param_type_2 == CPT2_COLORED_WALLMOUNTED)) {
-		const auto &indexstr = selected_item.metadata.
+		const auto &indexstr = selected_item.getMetadata().
 			getString("palette_index", 0);
 		if (!indexstr.empty()) {
 			s32 index = mystoi(indexstr);
@@ -3950,7 +4003,10 @@ void Game::updateFrame(ProfilerGraph *graph, RunStats *stats, f32 dtime,
 	/*
 		Update particles
 	*/
-	client->getParticleManager()->step(dtime);
+	{
+		FrameTimingScope timing("Particles");
+		client->getParticleManager()->step(dtime);
+	}
 
 	/*
 		Damage camera tilt
@@ -4009,7 +4065,8 @@ void Game::updateFrame(ProfilerGraph *graph, RunStats *stats, f32 dtime,
 			|| m_camera_offset_changed
 			|| client->getEnv().getClientMap().needsUpdateDrawList()) {
 		runData.update_draw_list_timer = 0;
-		client->getEnv().getClientMap().updateDrawList();
+		FrameTimingScope timing("Draw list");
+		client->getEnv().getClientMap().startDrawListUpdate();
 		runData.update_draw_list_last_cam_dir = camera_direction;
 	} else if (runData.touch_blocks_timer > touch_mapblock_delta) {
 		client->getEnv().getClientMap().touchMapBlocks();
@@ -4028,6 +4085,11 @@ void Game::updateFrame(ProfilerGraph *graph, RunStats *stats, f32 dtime,
 	*/
 	if (device->isWindowVisible())
 		drawScene(graph, stats);
+	// the map may change from here on
+	{
+		FrameTimingScope timing("Draw list");
+		client->getEnv().getClientMap().finishDrawListUpdate();
+	}
 	/*
 		==================== End scene ====================
 	*/
@@ -4144,6 +4206,9 @@ void Game::drawScene(ProfilerGraph *graph, RunStats *stats)
 	TimeTaker tt_draw("Draw scene", nullptr, PRECISION_MICRO);
 	this->driver->beginScene(true, true, sky_color);
 
+	// Inventory icons that were missing in the last frame
+	this->m_item_visuals_manager->renderIcons(this->client);
+
 	const LocalPlayer *player = this->client->getEnv().getLocalPlayer();
 	bool draw_wield_tool = (this->m_game_ui->m_flags.show_hud &&
 			(player->hud_flags & HUD_FLAG_WIELDITEM_VISIBLE) &&
@@ -4156,7 +4221,7 @@ void Game::drawScene(ProfilerGraph *graph, RunStats *stats)
 		draw_crosshair = false;
 
 	this->m_rendering_engine->draw_scene(sky_color, this->m_game_ui->m_flags.show_hud,
-			draw_wield_tool, draw_crosshair);
+			draw_wield_tool, draw_crosshair, stats->busy_time_jitter.avg);
 
 	/*
 		Profiler graph
@@ -4248,7 +4313,8 @@ void the_game(volatile std::sig_atomic_t *kill,
 		const GameStartData &start_data,
 		std::string &error_message,
 		ChatBackend &chat_backend,
-		bool *reconnect_requested) // Used for local game
+		bool *reconnect_requested, // Used for local game
+		ServerTransfer *transfer)
 {
 	Game game;
 
@@ -4260,7 +4326,7 @@ void the_game(volatile std::sig_atomic_t *kill,
 	try {
 
 		if (game.startup(kill, input, rendering_engine, start_data,
-				error_message, reconnect_requested, &chat_backend)) {
+				error_message, reconnect_requested, transfer, &chat_backend)) {
 			game.run();
 		}
 
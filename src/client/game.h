@@ -34,6 +34,12 @@ struct CameraOrientation {
 	f32 camera_pitch;  // "up/down"
 };
 
+// Server that the client was moved to (TOCLIENT_TRANSFER)
+struct ServerTransfer {
+	std::string address;
+	u16 port = 0;
+};
+
 #define GAME_FALLBACK_TIMEOUT 1.8f
 #define GAME_CONNECTION_TIMEOUT 10.0f
 
@@ -43,4 +49,5 @@ void the_game(volatile std::sig_atomic_t *kill,
 		const GameStartData &start_data,
 		std::string &error_message,
 		ChatBackend &chat_backend,
-		bool *reconnect_requested);
+		bool *reconnect_requested,
+		ServerTransfer *transfer);
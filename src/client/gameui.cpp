@@ -14,6 +14,7 @@
 #include "client.h"
 #include "clientmap.h"
 #include "fontengine.h"
+#include "frametimings.h"
 #include "hud.h" // HUD_FLAG_*
 #include "nodedef.h"
 #include "profiler.h"
@@ -82,6 +83,13 @@ void GameUI::init()
 	m_guitext_profiler->setOverrideFont(g_fontengine->getFont(
 		g_fontengine->getDefaultFontSize() * 0.9f, FM_Mono));
 	m_guitext_profiler->setVisible(false);
+
+	// Frame timings (size is updated when text is updated)
+	m_guitext_frame_timings = gui::StaticText::add(guienv, L"",
+		core::rect<s32>(0, 0, 0, 0), false, false, guiroot);
+	m_guitext_frame_timings->setOverrideFont(g_fontengine->getFont(
+		g_fontengine->getDefaultFontSize() * 0.9f, FM_Mono));
+	m_guitext_frame_timings->setVisible(false);
 }
 
 void GameUI::update(const RunStats &stats, Client *client, MapDrawControl *draw_control,
@@ -162,6 +170,26 @@ void GameUI::update(const RunStats &stats, Client *client, MapDrawControl *draw_
 
 	m_guitext2->setVisible(m_flags.show_basic_debug);
 
+	// In the lower right corner, the profiler graph is in the lower left one
+	const bool show_frame_timings = m_flags.show_profiler_graph && g_frame_timings;
+	if (show_frame_timings) {
+		EnrichedString str(utf8_to_wide(g_frame_timings->getOverlayText()));
+		str.setBackground(video::SColor(120, 0, 0, 0));
+		setStaticText(m_guitext_frame_timings, str);
+
+		core::dimension2d<u32> size = m_guitext_frame_timings->getOverrideFont()->
+				getDimension(str.c_str());
+		core::position2di lower_right(screensize.X - 6, screensize.Y - 10);
+		core::position2di upper_left = lower_right;
+		upper_left.X -= size.Width + 10;
+		upper_left.Y -= size.Height;
+
+		m_guitext_frame_timings->setRelativePosition(
+				core::rect<s32>(upper_left, lower_right));
+	}
+
+	m_guitext_frame_timings->setVisible(show_frame_timings);
+
 	setStaticText(m_guitext_info, m_infotext.c_str());
 	m_guitext_info->setVisible(m_flags.show_hud && g_menumgr.menuCount() == 0);
 
@@ -348,4 +376,9 @@ void GameUI::clearText()
 		m_guitext_profiler->remove();
 		m_guitext_profiler = nullptr;
 	}
+
+	if (m_guitext_frame_timings) {
+		m_guitext_frame_timings->remove();
+		m_guitext_frame_timings = nullptr;
+	}
 }
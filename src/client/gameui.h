@@ -103,4 +103,7 @@ class GameUI
 	gui::IGUIStaticText *m_guitext_profiler = nullptr; // Profiler text
 	u8 m_profiler_current_page = 0;
 	const u8 m_profiler_max_page = 3;
+
+	// Shown with the profiler graph
+	gui::IGUIStaticText *m_guitext_frame_timings = nullptr;
 };
@@ -0,0 +1,131 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "generatedimagecache.h"
+#include <cstring>
+#include <sstream>
+#include <IImage.h>
+#include <IVideoDriver.h>
+#include "exceptions.h"
+#include "imagesource.h"
+#include "log.h"
+#include "renderingengine.h"
+#include "serialization.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "util/serialize.h"
+#include "util/string.h"
+#include "version.h"
+
+/*
+	File format:
+	u8 version
+	u16 number of source images, for each:
+		string16 name
+		string16 SHA-1 of its pixels
+	u32 width, u32 height
+	zstd compressed pixels, ECF_A8R8G8B8
+*/
+static constexpr u8 FILE_VERSION = 1;
+
+GeneratedImageCache::GeneratedImageCache(const std::string &dir,
+		const std::string &settings) :
+	m_cache(dir),
+	m_key_prefix(std::string(g_version_hash) + '\n' + settings + '\n')
+{
+}
+
+std::string GeneratedImageCache::getFileName(const std::string &name) const
+{
+	return hex_encode(hashing::sha1(m_key_prefix + name));
+}
+
+bool GeneratedImageCache::isWorthCaching(const std::string &name)
+{
+	constexpr std::string_view mesh_suffix = "^[applyfiltersformesh";
+	std::string_view s = name;
+	if (str_ends_with(s, mesh_suffix))
+		s.remove_suffix(mesh_suffix.size());
+	// Source images and plain overlays are decoded or blitted quickly.
+	// Cracks use an image that is not tracked as their source.
+	return s.find('[') != std::string_view::npos &&
+		s.find("[crack") == std::string_view::npos;
+}
+
+video::IImage *GeneratedImageCache::load(const std::string &name,
+	ImageSource &imgsrc, std::set<std::string> &source_image_names)
+{
+	std::ostringstream os(std::ios::binary);
+	if (!m_cache.load(getFileName(name), os))
+		return nullptr;
+
+	try {
+		std::istringstream is(os.str(), std::ios::binary);
+		if (readU8(is) != FILE_VERSION)
+			return nullptr;
+
+		std::set<std::string> sources;
+		const u16 count = readU16(is);
+		for (u16 i = 0; i < count; i++) {
+			std::string source = deSerializeString16(is);
+			std::string hash = deSerializeString16(is);
+			if (hash.empty() || imgsrc.getSourceImageHash(source) != hash)
+				return nullptr;
+			sources.insert(std::move(source));
+		}
+
+		const u32 width = readU32(is), height = readU32(is);
+		if (width == 0 || width > ImageSource::MAX_IMAGE_DIMENSION ||
+				height == 0 || height > ImageSource::MAX_IMAGE_DIMENSION)
+			return nullptr;
+
+		std::ostringstream pixels(std::ios::binary);
+		decompressZstd(is, pixels);
+		const std::string data = pixels.str();
+		// partially written, or broken
+		if (data.size() != (size_t)width * height * 4)
+			return nullptr;
+
+		video::IImage *img = RenderingEngine::get_video_driver()->createImage(
+			video::ECF_A8R8G8B8, core::dimension2du(width, height));
+		memcpy(img->getData(), data.data(), data.size());
+		source_image_names.insert(sources.begin(), sources.end());
+		return img;
+	} catch (SerializationError &e) {
+		infostream << "GeneratedImageCache: ignoring broken image for \""
+			<< name << "\": " << e.what() << std::endl;
+		return nullptr;
+	}
+}
+
+void GeneratedImageCache::store(const std::string &name, video::IImage *img,
+	const std::set<std::string> &source_image_names, ImageSource &imgsrc)
+{
+	if (img->getColorFormat() != video::ECF_A8R8G8B8 ||
+			source_image_names.size() > U16_MAX)
+		return;
+
+	std::ostringstream os(std::ios::binary);
+	writeU8(os, FILE_VERSION);
+	writeU16(os, source_image_names.size());
+	for (const auto &source : source_image_names) {
+		std::string hash = imgsrc.getSourceImageHash(source);
+		// a dummy image was used instead
+		if (hash.empty())
+			return;
+		os << serializeString16(source) << serializeString16(hash);
+	}
+
+	const auto dim = img->getDimension();
+	writeU32(os, dim.Width);
+	writeU32(os, dim.Height);
+	// quick to compress while joining, decompression is quick anyway
+	compressZstd(reinterpret_cast<const u8 *>(img->getData()),
+		img->getImageDataSizeInBytes(), os, 1);
+
+	if (!m_cache.update(getFileName(name), os.str())) {
+		warningstream << "GeneratedImageCache: could not store image for \""
+			<< name << "\"" << std::endl;
+	}
+}
@@ -0,0 +1,49 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include "filecache.h"
+#include <set>
+#include <string>
+
+namespace video {
+	class IImage;
+}
+struct ImageSource;
+
+/*
+	Keeps images generated from texture modifiers on disk, so that joining
+	a server again doesn't have to generate them again.
+
+	An image is found by the hash of its texture string, the engine version
+	and the settings that change generated images. It is only used if the
+	pixels of all the source images that it was generated from are still
+	the same, so the cache can be shared by all servers.
+
+	Thread-safe, as long as the same image isn't stored twice at once.
+*/
+class GeneratedImageCache
+{
+public:
+	// settings: the settings that generated images depend on
+	GeneratedImageCache(const std::string &dir, const std::string &settings);
+
+	// Returns nullptr if the image isn't stored or outdated
+	// The returned image should be dropped.
+	video::IImage *load(const std::string &name, ImageSource &imgsrc,
+		std::set<std::string> &source_image_names);
+
+	void store(const std::string &name, video::IImage *img,
+		const std::set<std::string> &source_image_names, ImageSource &imgsrc);
+
+	// Returns false for texture strings that are quicker to generate
+	static bool isWorthCaching(const std::string &name);
+
+private:
+	std::string getFileName(const std::string &name) const;
+
+	FileCache m_cache;
+	std::string m_key_prefix;
+};
@@ -10,6 +10,22 @@
 #include <algorithm>
 #include <IVideoDriver.h>
 
+// SSE2 is part of x86-64 and NEON of AArch64, so no runtime check is needed
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define IMAGEFILTERS_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define IMAGEFILTERS_NEON 1
+#endif
+
+static bool use_simd = true;
+
+void imageFiltersUseSIMD(bool enable)
+{
+	use_simd = enable;
+}
+
 // Simple 2D bitmap class with just the functionality needed here
 class Bitmap {
 	u32 linesize, lines;
@@ -32,6 +48,12 @@ class Bitmap {
 		data[bytepos(index)] |= 1 << bitpos(index);
 	}
 
+	// Sets the bits of 8 pixels at once, index must be a multiple of 8
+	inline void set8(u32 index, u8 bits) {
+		assert(bitpos(index) == 0);
+		data[bytepos(index)] |= bits;
+	}
+
 	inline bool all() const {
 		for (u32 i = 0; i < data.size() - 1; i++) {
 			if (data[i] != 0xff)
@@ -52,6 +74,43 @@ class Bitmap {
 	}
 };
 
+// Marks the pixels of an A8R8G8B8 image with alpha above the threshold
+static void markOpaquePixels(const u32 *pixels, u32 count, u32 threshold, Bitmap &bitmap)
+{
+	u32 i = 0;
+	if (use_simd && threshold < 255) {
+#if IMAGEFILTERS_SSE2
+		const __m128i thr = _mm_set1_epi32(threshold);
+		for (; i + 8 <= count; i += 8) {
+			__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+			__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i + 4));
+			lo = _mm_cmpgt_epi32(_mm_srli_epi32(lo, 24), thr);
+			hi = _mm_cmpgt_epi32(_mm_srli_epi32(hi, 24), thr);
+			const int bits = _mm_movemask_ps(_mm_castsi128_ps(lo)) |
+				(_mm_movemask_ps(_mm_castsi128_ps(hi)) << 4);
+			if (bits)
+				bitmap.set8(i, bits);
+		}
+#elif IMAGEFILTERS_NEON
+		const uint8x8_t thr = vdup_n_u8(threshold);
+		const uint8x8_t weights = {1, 2, 4, 8, 16, 32, 64, 128};
+		for (; i + 8 <= count; i += 8) {
+			// deinterleave, val[3] is the alpha of each pixel
+			const uint8x8x4_t px = vld4_u8(reinterpret_cast<const u8 *>(pixels + i));
+			const uint8x8_t opaque = vcgt_u8(px.val[3], thr);
+			const u8 bits = vaddv_u8(vand_u8(opaque, weights));
+			if (bits)
+				bitmap.set8(i, bits);
+		}
+#endif
+	}
+	// the rest, or everything without SIMD
+	for (; i < count; i++) {
+		if ((pixels[i] >> 24) > threshold)
+			bitmap.set8(i & ~7U, 1 << (i & 7));
+	}
+}
+
 template <bool IS_A8R8G8B8>
 static void imageCleanTransparentWithInlining(video::IImage *src, u32 threshold)
 {
@@ -78,10 +137,15 @@ static void imageCleanTransparentWithInlining(video::IImage *src, u32 threshold)
 
 	// First pass: Mark all opaque pixels
 	// Note: loop y around x for better cache locality.
-	for (u32 ctry = 0; ctry < dim.Height; ctry++)
-	for (u32 ctrx = 0; ctrx < dim.Width; ctrx++) {
-		if (get_pixel(ctrx, ctry).getAlpha() > threshold)
-			bitmap.set(ctrx, ctry);
+	if constexpr (IS_A8R8G8B8) {
+		markOpaquePixels(reinterpret_cast<const u32 *>(src_data),
+			dim.Width * dim.Height, threshold, bitmap);
+	} else {
+		for (u32 ctry = 0; ctry < dim.Height; ctry++)
+		for (u32 ctrx = 0; ctrx < dim.Width; ctrx++) {
+			if (get_pixel(ctrx, ctry).getAlpha() > threshold)
+				bitmap.set(ctrx, ctry);
+		}
 	}
 
 	// Exit early if all pixels opaque
@@ -259,12 +323,89 @@ video::SColor imageAverageColor(const video::IImage *img)
 
 /**********************************/
 
-void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::IImage *dest)
+namespace {
+	// Integral of the color channels over the area of a destination pixel
+	struct PixelSum {
+		f32 r = 0, g = 0, b = 0, a = 0;
+
+		inline void add(f32 pa, video::SColor pxl) {
+			// Separate statements, so that they are not contracted
+			// into fused multiply-adds, like in PixelSumSIMD
+			const f32 wr = pa * pxl.getRed();
+			const f32 wg = pa * pxl.getGreen();
+			const f32 wb = pa * pxl.getBlue();
+			const f32 wa = pa * pxl.getAlpha();
+			r += wr;
+			g += wg;
+			b += wb;
+			a += wa;
+		}
+		inline void get(f32 &ra, f32 &ga, f32 &ba, f32 &aa) const {
+			ra = r;
+			ga = g;
+			ba = b;
+			aa = a;
+		}
+	};
+
+#if IMAGEFILTERS_SSE2 || IMAGEFILTERS_NEON
+	// Same as PixelSum with all channels in one register. The lanes are in
+	// memory order of A8R8G8B8, i.e. blue, green, red, alpha. Each lane
+	// sees the same operations as the scalar code, so the results match.
+	struct PixelSumSIMD {
+#if IMAGEFILTERS_SSE2
+		__m128 v = _mm_setzero_ps();
+
+		inline void add(f32 pa, video::SColor pxl) {
+			const __m128i zero = _mm_setzero_si128();
+			__m128i c = _mm_cvtsi32_si128(pxl.color);
+			c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(c, zero), zero);
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(pa), _mm_cvtepi32_ps(c)));
+		}
+		inline void get(f32 &ra, f32 &ga, f32 &ba, f32 &aa) const {
+			alignas(16) f32 out[4];
+			_mm_store_ps(out, v);
+			ba = out[0];
+			ga = out[1];
+			ra = out[2];
+			aa = out[3];
+		}
+#else
+		float32x4_t v = vdupq_n_f32(0);
+
+		inline void add(f32 pa, video::SColor pxl) {
+			const uint8x8_t c8 = vreinterpret_u8_u32(vdup_n_u32(pxl.color));
+			const uint32x4_t c = vmovl_u16(vget_low_u16(vmovl_u8(c8)));
+			v = vaddq_f32(v, vmulq_n_f32(vcvtq_f32_u32(c), pa));
+		}
+		inline void get(f32 &ra, f32 &ga, f32 &ba, f32 &aa) const {
+			ba = vgetq_lane_f32(v, 0);
+			ga = vgetq_lane_f32(v, 1);
+			ra = vgetq_lane_f32(v, 2);
+			aa = vgetq_lane_f32(v, 3);
+		}
+#endif
+	};
+#endif
+}
+
+template <bool IS_A8R8G8B8, typename Sum>
+static void imageScaleNNAAInline(video::IImage *src, const core::rect<s32> &srcrect, video::IImage *dest)
 {
 	f32 sx, sy, minsx, maxsx, minsy, maxsy, area, ra, ga, ba, aa, pw, ph, pa;
 	u32 dy, dx;
 	video::SColor pxl;
 
+	const u32 *const src_data = reinterpret_cast<const u32 *>(src->getData());
+	const u32 src_width = src->getDimension().Width;
+	auto get_pixel = [=](u32 x, u32 y) -> video::SColor {
+		if constexpr (IS_A8R8G8B8) {
+			return src_data[y*src_width + x];
+		} else {
+			return src->getPixel(x, y);
+		}
+	};
+
 	// Cache rectangle boundaries.
 	const f32 sox = srcrect.UpperLeftCorner.X;
 	const f32 soy = srcrect.UpperLeftCorner.Y;
@@ -296,10 +437,7 @@ void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::I
 		// Total area, and integral of r, g, b values over that area,
 		// initialized to zero, to be summed up in next loops.
 		area = 0;
-		ra = 0;
-		ga = 0;
-		ba = 0;
-		aa = 0;
+		Sum sum;
 
 		// Loop over the integral pixel positions described by those bounds.
 		for (sy = std::floor(minsy); sy < maxsy; sy++)
@@ -321,16 +459,14 @@ void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::I
 
 			// Get source pixel and add it to totals, weighted
 			// by covered area and alpha.
-			pxl = src->getPixel((u32)sx, (u32)sy);
+			pxl = get_pixel((u32)sx, (u32)sy);
 			area += pa;
-			ra += pa * pxl.getRed();
-			ga += pa * pxl.getGreen();
-			ba += pa * pxl.getBlue();
-			aa += pa * pxl.getAlpha();
+			sum.add(pa, pxl);
 		}
 
 		// Set the destination image pixel to the average color.
 		if (area > 0) {
+			sum.get(ra, ga, ba, aa);
 			pxl.setRed(ra / area + 0.5f);
 			pxl.setGreen(ga / area + 0.5f);
 			pxl.setBlue(ba / area + 0.5f);
@@ -344,3 +480,18 @@ void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::I
 		dest->setPixel(dx, dy, pxl);
 	}
 }
+
+void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::IImage *dest)
+{
+	if (src->getColorFormat() != video::ECF_A8R8G8B8) {
+		imageScaleNNAAInline<false, PixelSum>(src, srcrect, dest);
+		return;
+	}
+#if IMAGEFILTERS_SSE2 || IMAGEFILTERS_NEON
+	if (use_simd) {
+		imageScaleNNAAInline<true, PixelSumSIMD>(src, srcrect, dest);
+		return;
+	}
+#endif
+	imageScaleNNAAInline<true, PixelSum>(src, srcrect, dest);
+}
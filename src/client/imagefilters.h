@@ -39,3 +39,8 @@ video::SColor imageAverageColor(const video::IImage *img);
  * and downscaling.
  */
 void imageScaleNNAA(video::IImage *src, const core::rect<s32> &srcrect, video::IImage *dest);
+
+/* The filters above use SSE2 or NEON where the CPU has it. Disabling this
+ * makes them use only portable code, which tests compare the results to.
+ */
+void imageFiltersUseSIMD(bool enable);
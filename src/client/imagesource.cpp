@@ -11,9 +11,13 @@
 #include "settings.h"
 #include "texturepaths.h"
 #include "irrlicht_changes/printing.h"
+#include "threading/mutex_auto_lock.h"
 #include "util/base64.h"
+#include "util/hashing.h"
 #include "util/numeric.h"
+#include "util/serialize.h"
 #include "util/strfnd.h"
+#include <sstream>
 
 
 ////////////////////////////////
@@ -30,6 +34,8 @@ SourceImageCache::~SourceImageCache() {
 void SourceImageCache::insert(const std::string &name, video::IImage *img, bool prefer_local)
 {
 	assert(img); // Pre-condition
+	MutexAutoLock lock(m_mutex);
+	m_hashes.erase(name);
 	// Remove old image
 	auto n = m_images.find(name);
 	if (n != m_images.end()){
@@ -62,6 +68,7 @@ void SourceImageCache::insert(const std::string &name, video::IImage *img, bool
 
 video::IImage* SourceImageCache::get(const std::string &name)
 {
+	MutexAutoLock lock(m_mutex);
 	auto n = m_images.find(name);
 	if (n != m_images.end())
 		return n->second;
@@ -71,11 +78,15 @@ video::IImage* SourceImageCache::get(const std::string &name)
 // Primarily fetches from cache, secondarily tries to read from filesystem
 video::IImage* SourceImageCache::getOrLoad(const std::string &name)
 {
-	auto n = m_images.find(name);
-	if (n != m_images.end()){
-		n->second->grab(); // Grab for caller
-		return n->second;
+	{
+		MutexAutoLock lock(m_mutex);
+		auto n = m_images.find(name);
+		if (n != m_images.end()){
+			n->second->grab(); // Grab for caller
+			return n->second;
+		}
 	}
+	// Loaded without the lock, so that other threads can go on
 	video::IVideoDriver *driver = RenderingEngine::get_video_driver();
 	std::string path = getTexturePath(name);
 	if (path.empty()) {
@@ -86,14 +97,54 @@ video::IImage* SourceImageCache::getOrLoad(const std::string &name)
 	infostream << "SourceImageCache::getOrLoad(): Loading path \"" << path
 			<< "\"" << std::endl;
 	video::IImage *img = driver->createImageFromFile(path.c_str());
+	if (!img)
+		return nullptr;
 
-	if (img){
+	MutexAutoLock lock(m_mutex);
+	auto n = m_images.find(name);
+	if (n != m_images.end()) {
+		// another thread was faster
+		img->drop();
+		img = n->second;
+	} else {
 		m_images[name] = img;
-		img->grab(); // Grab for caller
 	}
+	img->grab(); // Grab for caller
 	return img;
 }
 
+void SourceImageCache::drop(video::IImage *img)
+{
+	MutexAutoLock lock(m_mutex);
+	img->drop();
+}
+
+std::string SourceImageCache::getHash(const std::string &name)
+{
+	{
+		MutexAutoLock lock(m_mutex);
+		auto it = m_hashes.find(name);
+		if (it != m_hashes.end())
+			return it->second;
+	}
+
+	video::IImage *img = getOrLoad(name);
+	if (!img)
+		return "";
+	std::ostringstream os(std::ios::binary);
+	writeU32(os, img->getDimension().Width);
+	writeU32(os, img->getDimension().Height);
+	writeU8(os, img->getColorFormat());
+	os.write(reinterpret_cast<const char *>(img->getData()),
+		img->getImageDataSizeInBytes());
+	std::string hash = hashing::sha1(os.str());
+	drop(img);
+
+	MutexAutoLock lock(m_mutex);
+	m_hashes[name] = hash;
+	return hash;
+}
+
 
 ////////////////////////////
 // Image Helper Functions //
@@ -1015,7 +1066,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 			blitBaseImage(image, baseimg);
 		}
 
-		image->drop();
+		m_sourcecache.drop(image);
 	}
 	else
 	{
@@ -1063,7 +1114,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 					draw_crack(img_crack, baseimg,
 						use_overlay, frame_count,
 						progression, driver, tiles);
-					img_crack->drop();
+					m_sourcecache.drop(img_crack);
 				}
 			}
 		}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <IImage.h>
+#include <mutex>
 #include <unordered_map>
 #include <set>
 #include <string>
@@ -16,6 +17,7 @@
 // A cache used for storing source images.
 // (A "source image" is an unmodified image directly taken from the filesystem.)
 // Does not contain modified images.
+// Thread-safe, the reference counts of the images are only changed under the lock.
 class SourceImageCache {
 public:
 	~SourceImageCache();
@@ -25,12 +27,22 @@ class SourceImageCache {
 	video::IImage* get(const std::string &name);
 
 	// Primarily fetches from cache, secondarily tries to read from filesystem.
+	// The returned image must be given back to drop().
 	video::IImage *getOrLoad(const std::string &name);
+
+	void drop(video::IImage *img);
+
+	// SHA-1 of the size and pixels of an image, empty if it can't be loaded
+	std::string getHash(const std::string &name);
 private:
 	std::unordered_map<std::string, video::IImage*> m_images;
+	std::unordered_map<std::string, std::string> m_hashes;
+	std::mutex m_mutex;
 };
 
 // Generates images using texture modifiers, and caches source images.
+// generateImage() may be called by several threads at once, as long as no
+// source images are inserted meanwhile.
 struct ImageSource {
 	ImageSource();
 
@@ -44,6 +56,12 @@ struct ImageSource {
 	// Insert a source image into the cache without touching the filesystem.
 	void insertSourceImage(const std::string &name, video::IImage *img, bool prefer_local);
 
+	// See SourceImageCache::getHash()
+	std::string getSourceImageHash(const std::string &name)
+	{
+		return m_sourcecache.getHash(name);
+	}
+
 	// This was picked so that the image buffer size fits in an s32 (assuming 32bpp).
 	// The exact value is 23170 but this provides some leeway.
 	// In theory something like 33333x123 could be allowed, but there is no strong
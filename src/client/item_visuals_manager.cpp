@@ -6,15 +6,38 @@
 
 #include "mesh.h"
 #include "client.h"
+#include "renderingengine.h"
 #include "texturesource.h"
 #include "itemdef.h"
 #include "inventory.h"
+#include "gui/drawItemStack.h"
+
+// Size of the icon atlas pages, and how many there can be
+constexpr s32 ICON_PAGE_SIZE = 1024;
+constexpr size_t ICON_PAGES_MAX = 16;
+// Larger icons are drawn directly
+constexpr s32 ICON_SIZE_MAX = 256;
 
 ItemVisualsManager::ItemVisuals::~ItemVisuals() {
 	if (wield_mesh.mesh)
 		wield_mesh.mesh->drop();
 }
 
+void ItemVisualsManager::clear()
+{
+	if (!m_icon_pages.empty()) {
+		video::IVideoDriver *driver = RenderingEngine::get_video_driver();
+		for (auto &page : m_icon_pages)
+			driver->removeTexture(page.texture);
+	}
+	m_icon_pages.clear();
+	m_pending_icons.clear();
+	m_icons.clear();
+
+	m_cached_item_visuals.clear();
+	m_shared_meshes.clear();
+}
+
 ItemVisualsManager::ItemVisuals *ItemVisualsManager::createItemVisuals( const ItemStack &item,
 		Client *client) const
 {
@@ -87,16 +110,125 @@ video::SColor ItemVisualsManager::getItemstackColor(const ItemStack &stack,
 	Client *client) const
 {
 	// Look for direct color definition
-	const std::string &colorstring = stack.metadata.getString("color", 0);
+	const std::string &colorstring = stack.getMetadata().getString("color", 0);
 	video::SColor directcolor;
 	if (!colorstring.empty() && parseColorString(colorstring, directcolor, true))
 		return directcolor;
 	// See if there is a palette
 	Palette *palette = getPalette(stack, client);
-	const std::string &index = stack.metadata.getString("palette_index", 0);
+	const std::string &index = stack.getMetadata().getString("palette_index", 0);
 	if (palette && !index.empty())
 		return (*palette)[mystoi(index, 0, 255)];
 	// Fallback color
 	return client->idef()->get(stack.name).color;
 }
 
+scene::IMesh *ItemVisualsManager::getSharedMesh(const std::string &key,
+	scene::IMesh *mesh) const
+{
+	sanity_check(std::this_thread::get_id() == m_main_thread);
+
+	auto &shared = m_shared_meshes[key];
+	if (!shared)
+		shared.grab(mesh);
+	return shared.get();
+}
+
+video::ITexture *ItemVisualsManager::getInventoryIcon(const ItemStack &item,
+	Client *client, core::dimension2d<s32> size, core::rect<s32> *area) const
+{
+	if (size.Width <= 0 || size.Height <= 0 ||
+			size.Width > ICON_SIZE_MAX || size.Height > ICON_SIZE_MAX)
+		return nullptr;
+
+	ItemVisuals *iv = createItemVisuals(item, client);
+	if (!iv || !iv->wield_mesh.mesh)
+		return nullptr;
+	// Animated textures have to be drawn every frame
+	for (auto &info : iv->wield_mesh.buffer_info) {
+		if (info.animation_info)
+			return nullptr;
+	}
+
+	const u32 color = getItemstackColor(item, client).color;
+	auto key = std::make_tuple(iv, color, size.Width, size.Height);
+	auto it = m_icons.find(key);
+	if (it == m_icons.end()) {
+		InventoryIcon &icon = m_icons[key];
+		icon.item = item;
+		icon.visuals = iv;
+		icon.area = core::rect<s32>(core::position2d<s32>(0, 0), size);
+		m_pending_icons.push_back(&icon);
+		return nullptr;
+	}
+
+	const InventoryIcon &icon = it->second;
+	if (icon.page < 0)
+		return nullptr;
+	*area = icon.area;
+	return m_icon_pages[icon.page].texture;
+}
+
+bool ItemVisualsManager::allocateIcon(InventoryIcon &icon, video::IVideoDriver *driver)
+{
+	const core::dimension2d<s32> size = icon.area.getSize();
+	const u32 per_row = ICON_PAGE_SIZE / size.Width;
+	const u32 capacity = per_row * (ICON_PAGE_SIZE / size.Height);
+
+	size_t i = 0;
+	for (; i < m_icon_pages.size(); i++) {
+		const IconPage &page = m_icon_pages[i];
+		if (page.cell_size == size && page.used < capacity)
+			break;
+	}
+
+	if (i == m_icon_pages.size()) {
+		if (m_icon_pages.size() >= ICON_PAGES_MAX)
+			return false;
+		video::ITexture *texture = driver->addRenderTargetTexture(
+			core::dimension2d<u32>(ICON_PAGE_SIZE, ICON_PAGE_SIZE),
+			"item_icons_" + std::to_string(i), video::ECF_A8R8G8B8);
+		if (!texture)
+			return false;
+		// Cells are only written once, so clear all of them now
+		driver->setRenderTarget(texture, video::ECBF_COLOR | video::ECBF_DEPTH,
+			video::SColor(0, 0, 0, 0));
+		m_icon_pages.push_back({texture, size});
+	}
+
+	IconPage &page = m_icon_pages[i];
+	const core::position2d<s32> pos((page.used % per_row) * size.Width,
+		(page.used / per_row) * size.Height);
+	page.used++;
+	icon.page = i;
+	icon.area = core::rect<s32>(pos, size);
+	return true;
+}
+
+void ItemVisualsManager::renderIcons(Client *client)
+{
+	if (m_pending_icons.empty())
+		return;
+
+	video::IVideoDriver *driver = RenderingEngine::get_video_driver();
+	const core::rect<s32> old_viewport = driver->getViewPort();
+	video::ITexture *target = nullptr;
+
+	for (InventoryIcon *icon : m_pending_icons) {
+		if (!driver->queryFeature(video::EVDF_RENDER_TO_TARGET) ||
+				!allocateIcon(*icon, driver))
+			continue;
+
+		video::ITexture *texture = m_icon_pages[icon->page].texture;
+		if (texture != target) {
+			driver->setRenderTarget(texture, video::ECBF_NONE);
+			target = texture;
+		}
+		drawItemMesh(driver, icon->item, &icon->visuals->wield_mesh,
+			icon->area, icon->area, core::matrix4(), client);
+	}
+	m_pending_icons.clear();
+
+	driver->setRenderTarget(nullptr, video::ECBF_NONE);
+	driver->setViewPort(old_viewport);
+}
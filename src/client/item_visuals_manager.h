@@ -7,14 +7,17 @@
 #include <string>
 #include <map>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 #include "wieldmesh.h" // ItemMesh
+#include "inventory.h" // ItemStack
+#include "irr_ptr.h"
 #include "util/basic_macros.h"
 
 class Client;
-struct ItemStack;
 typedef std::vector<video::SColor> Palette; // copied from src/client/texturesource.h
-namespace video { class ITexture; }
+namespace video { class ITexture; class IVideoDriver; }
 
 // Caches data needed to draw an itemstack
 
@@ -25,9 +28,7 @@ struct ItemVisualsManager
 		m_main_thread = std::this_thread::get_id();
 	}
 
-	void clear() {
-		m_cached_item_visuals.clear();
-	}
+	void clear();
 
 	// Get item inventory texture
 	video::ITexture* getInventoryTexture(const ItemStack &item, Client *client) const;
@@ -43,6 +44,20 @@ struct ItemVisualsManager
 	// tiles that do not define their own color.
 	video::SColor getItemstackColor(const ItemStack &stack, Client *client) const;
 
+	// Returns the mesh that item entities with these visuals share,
+	// which is the given one if there is none yet
+	scene::IMesh *getSharedMesh(const std::string &key, scene::IMesh *mesh) const;
+
+	// Returns the atlas texture that holds the icon of an item that is drawn
+	// as mesh, unrotated and at the given size, and the icon's area in it.
+	// Returns nullptr if it isn't rendered yet, renderIcons() does that.
+	video::ITexture *getInventoryIcon(const ItemStack &item, Client *client,
+		core::dimension2d<s32> size, core::rect<s32> *area) const;
+
+	// Renders the icons asked for since the last call into the atlas.
+	// Must be called outside of any other drawing, it switches render targets.
+	void renderIcons(Client *client);
+
 private:
 	struct ItemVisuals
 	{
@@ -60,10 +75,36 @@ struct ItemVisualsManager
 		DISABLE_CLASS_COPY(ItemVisuals);
 	};
 
+	// Mesh of an item rendered into a cell of an atlas page
+	struct InventoryIcon
+	{
+		ItemStack item;
+		ItemVisuals *visuals;
+		// -1 while pending, or if it couldn't be rendered
+		s32 page = -1;
+		core::rect<s32> area;
+	};
+
+	// Render target texture with cells of equal size, filled in order
+	struct IconPage
+	{
+		video::ITexture *texture;
+		core::dimension2d<s32> cell_size;
+		u32 used = 0;
+	};
+
 	// The id of the thread that is allowed to use irrlicht directly
 	std::thread::id m_main_thread;
 	// Cached textures and meshes
 	mutable std::unordered_map<std::string, std::unique_ptr<ItemVisuals>> m_cached_item_visuals;
+	// Meshes of item entities, see getSharedMesh
+	mutable std::unordered_map<std::string, irr_ptr<scene::IMesh>> m_shared_meshes;
+	// Icons by visuals, color and size
+	mutable std::map<std::tuple<ItemVisuals *, u32, s32, s32>, InventoryIcon> m_icons;
+	mutable std::vector<InventoryIcon *> m_pending_icons;
+	std::vector<IconPage> m_icon_pages;
 
 	ItemVisuals* createItemVisuals(const ItemStack &item, Client *client) const;
+	// Finds the cell of a pending icon, returns false if there is no space
+	bool allocateIcon(InventoryIcon &icon, video::IVideoDriver *driver);
 };
@@ -45,9 +45,10 @@ void MeshMakeData::fillBlockDataBegin(const v3s16 &blockpos)
 	v3s16 blockpos_nodes = m_blockpos*MAP_BLOCKSIZE;
 
 	m_vmanip.clear();
-	// extra 1 block thick layer around the mesh
-	VoxelArea voxel_area(blockpos_nodes - v3s16(1,1,1) * MAP_BLOCKSIZE,
-			blockpos_nodes + v3s16(1,1,1) * (m_side_length + MAP_BLOCKSIZE) - v3s16(1,1,1));
+	// Meshing looks at most 1 node beyond the mesh, so only this layer of
+	// the neighbors is needed
+	VoxelArea voxel_area(blockpos_nodes - v3s16(1,1,1),
+			blockpos_nodes + v3s16(1,1,1) * m_side_length);
 	m_vmanip.addArea(voxel_area);
 }
 
@@ -75,6 +76,26 @@ void MeshMakeData::setCrack(int crack_level, v3s16 crack_pos)
 		m_crack_pos_relative = crack_pos - m_blockpos*MAP_BLOCKSIZE;
 }
 
+u32 *MeshMakeData::getSmoothLightCache(const v3s16 &p, const v3s16 &corner)
+{
+	// a few MB would be too much for bigger mesh chunks
+	if (m_side_length > 2 * MAP_BLOCKSIZE)
+		return nullptr;
+
+	// the corner between the nodes, the same for the 8 nodes around it
+	const s32 size = m_side_length + 1;
+	const v3s16 rel = p - m_blockpos * MAP_BLOCKSIZE;
+	const s32 x = rel.X + (corner.X > 0), y = rel.Y + (corner.Y > 0),
+		z = rel.Z + (corner.Z > 0);
+	if (x < 0 || y < 0 || z < 0 || x >= size || y >= size || z >= size)
+		return nullptr;
+	const u32 octant = (corner.X > 0) | (corner.Y > 0) << 1 | (corner.Z > 0) << 2;
+
+	if (m_smooth_light_cache.empty())
+		m_smooth_light_cache.resize(size * size * size * 8, 0);
+	return &m_smooth_light_cache[((z * size + y) * size + x) * 8 + octant];
+}
+
 /*
 	Light and vertex color functions
 */
@@ -162,13 +183,13 @@ static u16 getSmoothLightCombined(const v3s16 &p,
 		MapNode n = data->m_vmanip.getNodeNoExNoEmerge(p + dirs[i]);
 		if (n.getContent() == CONTENT_IGNORE)
 			return true;
-		const ContentFeatures &f = ndef->get(n);
+		const ContentLightingFlags f = ndef->getLightingFlags(n);
 		if (f.light_source > light_source_max)
 			light_source_max = f.light_source;
-		// Check f.solidness because fast-style leaves look better this way
-		if (f.param_type == CPT_LIGHT && f.solidness != 2) {
-			u8 light_level_day = n.getLight(LIGHTBANK_DAY, f.getLightingFlags());
-			u8 light_level_night = n.getLight(LIGHTBANK_NIGHT, f.getLightingFlags());
+		// Check solidness because fast-style leaves look better this way
+		if (f.has_light && ndef->getShapeFlags(n).solidness != 2) {
+			u8 light_level_day = n.getLight(LIGHTBANK_DAY, f);
+			u8 light_level_night = n.getLight(LIGHTBANK_NIGHT, f);
 			if (light_level_day == LIGHT_SUN)
 				direct_sunlight = true;
 			light_day += decode_light(light_level_day);
@@ -263,6 +284,11 @@ u16 getSmoothLightSolid(const v3s16 &p, const v3s16 &face_dir, const v3s16 &corn
 */
 u16 getSmoothLightTransparent(const v3s16 &p, const v3s16 &corner, MeshMakeData *data)
 {
+	// Neighbouring faces share most of their corners
+	u32 *cached = data->getSmoothLightCache(p, corner);
+	if (cached && *cached)
+		return *cached & 0xFFFF;
+
 	const std::array<v3s16,8> dirs = {{
 		// Always shine light
 		v3s16(0,0,0),
@@ -276,7 +302,10 @@ u16 getSmoothLightTransparent(const v3s16 &p, const v3s16 &corner, MeshMakeData
 		v3s16(0,corner.Y,corner.Z),
 		v3s16(corner.X,corner.Y,corner.Z)
 	}};
-	return getSmoothLightCombined(p, dirs, data);
+	const u16 light = getSmoothLightCombined(p, dirs, data);
+	if (cached)
+		*cached = light | 0x10000;
+	return light;
 }
 
 void get_sunlight_color(video::SColorf *sunlight, u32 daynight_ratio)
@@ -572,6 +601,16 @@ void MapBlockBspTree::traverse(s32 node, v3f viewpoint, std::vector<s32> &output
 }
 
 
+void MapBlockBspTree::getViewCell(v3f viewpoint, std::vector<s8> &sides) const
+{
+	// traverse() visits all nodes
+	sides.resize(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++) {
+		const TreeNode &n = nodes[i];
+		float factor = n.normal.dotProduct(viewpoint - n.origin);
+		sides[i] = factor > 0 ? 1 : (factor < 0 ? -1 : 0);
+	}
+}
 
 /*
 	PartialMeshBuffer
@@ -589,9 +628,15 @@ void PartialMeshBuffer::draw(video::IVideoDriver *driver) const
 */
 
 MapBlockMesh::MapBlockMesh(Client *client, MeshMakeData *data):
-	m_tsrc(client->getTextureSource()),
-	m_shdrsrc(client->getShaderSource()),
+	MapBlockMesh(client->getTextureSource(), client->getShaderSource(), data)
+{}
+
+MapBlockMesh::MapBlockMesh(ITextureSource *tsrc, IShaderSource *shdrsrc,
+		MeshMakeData *data):
+	m_tsrc(tsrc),
+	m_shdrsrc(shdrsrc),
 	m_bounding_sphere_center((data->m_side_length * 0.5f - 0.5f) * BS),
+	m_lod(data->m_lod),
 	m_animation_force_timer(0), // force initial animation
 	m_last_crack(-1)
 {
@@ -625,7 +670,8 @@ MapBlockMesh::MapBlockMesh(Client *client, MeshMakeData *data):
 	// algin vertices to mesh grid, not meshgen area
 	v3f offset = intToFloat((data->m_blockpos - mesh_grid.getMeshPos(data->m_blockpos)) * MAP_BLOCKSIZE, BS);
 
-	MeshCollector collector(m_bounding_sphere_center, offset);
+	// tiles only have array textures if they are enabled
+	MeshCollector collector(m_bounding_sphere_center, offset, true);
 
 	{
 		// Generate everything
@@ -688,6 +734,24 @@ MapBlockMesh::MapBlockMesh(Client *client, MeshMakeData *data):
 				p.layer.applyMaterialOptions(material, layer);
 			}
 
+			if (p.uses_array_texture) {
+				// the layer goes into the second texture coordinate
+				auto *buf = new scene::SMeshBufferLightMap();
+				buf->Material = material;
+				auto &vertices = buf->Vertices->Data;
+				vertices.reserve(p.vertices.size());
+				for (u32 j = 0; j < p.vertices.size(); j++) {
+					const video::S3DVertex &v = p.vertices[j];
+					vertices.emplace_back(v.Pos, v.Normal, v.Color, v.TCoords,
+						v2f(p.array_layers[j], 0));
+				}
+				buf->Indices->Data = p.indices;
+				buf->recalculateBoundingBox();
+				mesh->addMeshBuffer(buf);
+				buf->drop();
+				continue;
+			}
+
 			scene::SMeshBuffer *buf = new scene::SMeshBuffer();
 			buf->Material = material;
 			if (p.layer.isTransparent()) {
@@ -719,6 +783,16 @@ MapBlockMesh::MapBlockMesh(Client *client, MeshMakeData *data):
 
 	m_bsp_tree.buildTree(&m_transparent_triangles, data->m_side_length);
 
+	m_memory_usage = m_transparent_triangles.size() * 3 * sizeof(u16);
+	for (auto &mesh : m_mesh) {
+		for (u32 i = 0; i < mesh->getMeshBufferCount(); i++) {
+			const scene::IMeshBuffer *buf = mesh->getMeshBuffer(i);
+			m_memory_usage += buf->getVertexCount() *
+				video::getVertexPitchFromType(buf->getVertexType()) +
+				buf->getIndexCount() * sizeof(u16);
+		}
+	}
+
 	// Check if animation is required for this mesh
 	m_has_animation =
 		!m_crack_materials.empty() ||
@@ -789,17 +863,71 @@ void MapBlockMesh::updateTransparentBuffers(v3f camera_pos, v3s16 block_pos,
 	if (m_transparent_triangles.empty())
 		return;
 
+	TransparentStrains strains;
+	sortTransparentStrains(camera_pos, block_pos, group_by_buffers, strains);
+
+	// arrange index sequences into partial buffers
+	m_transparent_buffers_consolidated = false;
+	m_transparent_buffers.clear();
+	m_transparent_buffers.reserve(strains.size());
+	for (auto &it : strains)
+		m_transparent_buffers.emplace_back(it.first, std::move(it.second));
+}
+
+bool MapBlockMesh::sortTransparentTriangles(v3f camera_pos, v3s16 block_pos,
+		bool group_by_buffers)
+{
+	if (m_transparent_triangles.empty())
+		return false;
+
+	v3f rel_camera_pos = camera_pos - intToFloat(block_pos * MAP_BLOCKSIZE, BS);
+	std::vector<s8> view_cell;
+	m_bsp_tree.getViewCell(rel_camera_pos, view_cell);
+	// the order would be the same
+	if (view_cell == m_sorted_view_cell && group_by_buffers == m_sorted_by_buffers)
+		return false;
+
+	m_sorted_view_cell = std::move(view_cell);
+	m_sorted_by_buffers = group_by_buffers;
+	m_pending_strains.clear();
+	sortTransparentStrains(camera_pos, block_pos, group_by_buffers, m_pending_strains);
+	return true;
+}
+
+void MapBlockMesh::applyTransparentOrder()
+{
+	// Usually only the order of the triangles changes, then the index
+	// buffers are updated instead of making new ones
+	bool same_layout = !m_transparent_buffers_consolidated &&
+		m_transparent_buffers.size() == m_pending_strains.size();
+	for (size_t i = 0; same_layout && i < m_pending_strains.size(); i++) {
+		same_layout = m_transparent_buffers[i].getBuffer() == m_pending_strains[i].first &&
+			m_transparent_buffers[i].getIndexCount() == m_pending_strains[i].second.size();
+	}
+
+	if (same_layout) {
+		for (size_t i = 0; i < m_pending_strains.size(); i++)
+			m_transparent_buffers[i].setIndices(std::move(m_pending_strains[i].second));
+	} else {
+		m_transparent_buffers_consolidated = false;
+		m_transparent_buffers.clear();
+		m_transparent_buffers.reserve(m_pending_strains.size());
+		for (auto &it : m_pending_strains)
+			m_transparent_buffers.emplace_back(it.first, std::move(it.second));
+	}
+	m_pending_strains.clear();
+}
+
+void MapBlockMesh::sortTransparentStrains(v3f camera_pos, v3s16 block_pos,
+		bool group_by_buffers, TransparentStrains &ordered_strains) const
+{
 	v3f block_posf = intToFloat(block_pos * MAP_BLOCKSIZE, BS);
 	v3f rel_camera_pos = camera_pos - block_posf;
 
 	std::vector<s32> triangle_refs;
 	m_bsp_tree.traverse(rel_camera_pos, triangle_refs);
 
-	// arrange index sequences into partial buffers
-	m_transparent_buffers_consolidated = false;
-	m_transparent_buffers.clear();
-
-	std::vector<std::pair<scene::SMeshBuffer *, std::vector<u16>>> ordered_strains;
+	TransparentStrains strains;
 	std::unordered_map<scene::SMeshBuffer *, size_t> strain_idxs;
 
 	if (group_by_buffers) {
@@ -813,9 +941,9 @@ void MapBlockMesh::updateTransparentBuffers(v3f camera_pos, v3s16 block_pos,
 				continue;
 			current_buffer = t.buffer;
 			auto [_it2, is_new] =
-				strain_idxs.emplace(current_buffer, ordered_strains.size());
+				strain_idxs.emplace(current_buffer, strains.size());
 			if (is_new)
-				ordered_strains.emplace_back(current_buffer, std::vector<u16>{});
+				strains.emplace_back(current_buffer, std::vector<u16>{});
 		}
 	}
 
@@ -829,10 +957,10 @@ void MapBlockMesh::updateTransparentBuffers(v3f camera_pos, v3s16 block_pos,
 			if (group_by_buffers) {
 				auto it = strain_idxs.find(current_buffer);
 				assert(it != strain_idxs.end());
-				current_strain = &ordered_strains[it->second].second;
+				current_strain = &strains[it->second].second;
 			} else {
-				ordered_strains.emplace_back(current_buffer, std::vector<u16>{});
-				current_strain = &ordered_strains.back().second;
+				strains.emplace_back(current_buffer, std::vector<u16>{});
+				current_strain = &strains.back().second;
 			}
 		}
 		current_strain->push_back(t.p1);
@@ -840,14 +968,14 @@ void MapBlockMesh::updateTransparentBuffers(v3f camera_pos, v3s16 block_pos,
 		current_strain->push_back(t.p3);
 	}
 
-	m_transparent_buffers.reserve(ordered_strains.size());
+	ordered_strains.reserve(strains.size());
 	if (group_by_buffers) {
 		// the order was reversed
-		for (auto it = ordered_strains.rbegin(); it != ordered_strains.rend(); ++it)
-			m_transparent_buffers.emplace_back(it->first, std::move(it->second));
+		for (auto it = strains.rbegin(); it != strains.rend(); ++it)
+			ordered_strains.emplace_back(it->first, std::move(it->second));
 	} else {
-		for (auto it = ordered_strains.begin(); it != ordered_strains.end(); ++it)
-			m_transparent_buffers.emplace_back(it->first, std::move(it->second));
+		for (auto it = strains.begin(); it != strains.end(); ++it)
+			ordered_strains.emplace_back(it->first, std::move(it->second));
 	}
 }
 
@@ -909,6 +1037,16 @@ video::SColor encode_light(u16 light, u8 emissive_light)
 	return video::SColor(r, b, b, b);
 }
 
+u16 getMeshLod(f32 distance, f32 lod_distance)
+{
+	if (lod_distance <= 0)
+		return 1;
+	u16 lod = 1;
+	while (lod < 8 && distance >= lod_distance * lod)
+		lod *= 2;
+	return lod;
+}
+
 u8 get_solid_sides(MeshMakeData *data)
 {
 	v3s16 blockpos_nodes = data->m_blockpos * MAP_BLOCKSIZE;
@@ -931,7 +1069,7 @@ u8 get_solid_sides(MeshMakeData *data)
 
 		for (u8 k = 0; k < 6; k++) {
 			const MapNode &top = data->m_vmanip.getNodeRefUnsafe(blockpos_nodes + positions[k]);
-			if (ndef->get(top).solidness != 2)
+			if (ndef->getShapeFlags(top).solidness != 2)
 				result &= ~(1 << k);
 		}
 	}
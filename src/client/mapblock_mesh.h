@@ -15,6 +15,7 @@
 #include <array>
 #include <map>
 #include <unordered_map>
+#include <vector>
 
 namespace video {
 	class IVideoDriver;
@@ -51,9 +52,19 @@ struct MeshMakeData
 	bool m_generate_minimap = false;
 	bool m_smooth_lighting = false;
 	bool m_enable_water_reflections = false;
+	// merge the faces of solid nodes into larger quads where possible
+	bool m_merge_solid_faces = false;
+	// size of the cells that the mesh is simplified to, in nodes.
+	// 1 for a full mesh, see getMeshLod().
+	u16 m_lod = 1;
 
 	const NodeDefManager *m_nodedef;
 
+	// Results of getSmoothLightTransparent(), for every node corner and
+	// each of the 8 nodes around it that the light can be taken from.
+	// Filled on first use, 0 if not computed yet.
+	std::vector<u32> m_smooth_light_cache;
+
 	MeshMakeData(const NodeDefManager *ndef, u16 side_lingth, MeshGrid mesh_grid);
 
 	/*
@@ -70,6 +81,12 @@ struct MeshMakeData
 		Set the (node) position of a crack
 	*/
 	void setCrack(int crack_level, v3s16 crack_pos);
+
+	/*
+		Where the smooth light at the corner of p is kept,
+		nullptr if it isn't cached
+	*/
+	u32 *getSmoothLightCache(const v3s16 &p, const v3s16 &corner);
 };
 
 // represents a triangle as indexes into the vertex buffer in SMeshBuffer
@@ -116,6 +133,12 @@ class MapBlockBspTree
 		traverse(root, viewpoint, output);
 	}
 
+	/**
+	 * Gets the side of each splitting plane that the viewpoint is on.
+	 * The order of traverse() is the same for viewpoints with equal sides.
+	 */
+	void getViewCell(v3f viewpoint, std::vector<s8> &sides) const;
+
 private:
 	// Tree node definition;
 	struct TreeNode
@@ -159,6 +182,15 @@ class PartialMeshBuffer
 
 	auto *getBuffer() const { return m_buffer; }
 
+	u32 getIndexCount() const { return m_indices->getCount(); }
+
+	/// Replaces the indices, keeping the hardware buffer
+	void setIndices(std::vector<u16> &&vertex_indices)
+	{
+		m_indices->Data = std::move(vertex_indices);
+		m_indices->setDirty();
+	}
+
 	void draw(video::IVideoDriver *driver) const;
 
 private:
@@ -180,6 +212,8 @@ class MapBlockMesh
 public:
 	// Builds the mesh given
 	MapBlockMesh(Client *client, MeshMakeData *data);
+	// The same without a client, e.g. for benchmarks
+	MapBlockMesh(ITextureSource *tsrc, IShaderSource *shdrsrc, MeshMakeData *data);
 	~MapBlockMesh();
 
 	// Main animation function, parameters:
@@ -242,6 +276,12 @@ class MapBlockMesh
 	/// Center of the bounding-sphere, in BS-space, relative to block pos.
 	v3f getBoundingSphereCenter() const { return m_bounding_sphere_center; }
 
+	/// Level of detail that the mesh was made with, see MeshMakeData::m_lod
+	u16 getLod() const { return m_lod; }
+
+	/// Approximate size of the vertex and index buffers, in bytes
+	size_t getMemoryUsage() const { return m_memory_usage; }
+
 	/** Update transparent buffers to render towards the camera.
 	 * @param group_by_buffers If true, triangles in the same buffer are batched
 	 *     into the same PartialMeshBuffer, resulting in fewer draw calls, but
@@ -252,6 +292,18 @@ class MapBlockMesh
 	void updateTransparentBuffers(v3f camera_pos, v3s16 block_pos, bool group_by_buffers);
 	void consolidateTransparentBuffers();
 
+	/**
+	 * Like updateTransparentBuffers(), but only sorts the triangles, which
+	 * can be done in another thread. Nothing is done if the camera is still
+	 * in the same cell of the BSP tree as for the last sort.
+	 * @return true if applyTransparentOrder() needs to be called
+	 */
+	bool sortTransparentTriangles(v3f camera_pos, v3s16 block_pos, bool group_by_buffers);
+	/// Forgets the last sort, so that the next one isn't skipped
+	void resetTransparentOrder() { m_sorted_view_cell.clear(); }
+	/// Uses the order of sortTransparentTriangles() for drawing
+	void applyTransparentOrder();
+
 	/// get the list of transparent buffers
 	const std::vector<PartialMeshBuffer> &getTransparentBuffers() const
 	{
@@ -259,6 +311,10 @@ class MapBlockMesh
 	}
 
 private:
+	typedef std::vector<std::pair<scene::SMeshBuffer *, std::vector<u16>>> TransparentStrains;
+
+	void sortTransparentStrains(v3f camera_pos, v3s16 block_pos, bool group_by_buffers,
+		TransparentStrains &strains) const;
 
 	irr_ptr<scene::IMesh> m_mesh[MAX_TILE_LAYERS];
 	std::vector<MinimapMapblock*> m_minimap_mapblocks;
@@ -267,6 +323,8 @@ class MapBlockMesh
 
 	f32 m_bounding_radius;
 	v3f m_bounding_sphere_center;
+	u16 m_lod;
+	size_t m_memory_usage;
 
 	// Must animate() be called before rendering?
 	bool m_has_animation;
@@ -291,6 +349,13 @@ class MapBlockMesh
 	std::vector<PartialMeshBuffer> m_transparent_buffers;
 	// Is m_transparent_buffers currently in consolidated form?
 	bool m_transparent_buffers_consolidated = false;
+
+	// Only used by sortTransparentTriangles() and applyTransparentOrder():
+	// BSP cell and grouping of the last sort
+	std::vector<s8> m_sorted_view_cell;
+	bool m_sorted_by_buffers = false;
+	// order that is waiting to be applied
+	TransparentStrains m_pending_strains;
 };
 
 /*!
@@ -346,6 +411,16 @@ void final_color_blend(video::SColor *result,
 void getNodeTileN(MapNode mn, const v3s16 &p, u8 tileindex, MeshMakeData *data, TileSpec &tile);
 void getNodeTile(MapNode mn, const v3s16 &p, const v3s16 &dir, MeshMakeData *data, TileSpec &tile);
 
+/**
+ * Returns the level of detail for a mesh, see MeshMakeData::m_lod.
+ * The cells are 2 nodes large from lod_distance on, 4 from twice and 8 from
+ * four times that.
+ * @param distance from the camera to the center of the mesh, in BS-space
+ * @param lod_distance distance of the first step, in BS-space,
+ *     0 for full meshes at any distance
+ */
+u16 getMeshLod(f32 distance, f32 lod_distance);
+
 /// Return bitset of the sides of the mesh that consist of solid nodes only
 /// Bits:
 /// 0 0 -Z +Z -X +X -Y +Y
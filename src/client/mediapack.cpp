@@ -0,0 +1,204 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "mediapack.h"
+#include "filesys.h"
+#include "log.h"
+#include "threading/mutex_auto_lock.h"
+#include "util/serialize.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char PACK_SIGNATURE[4] = {'L', 'M', 'P', 'K'};
+static constexpr u8 PACK_VERSION = 1;
+static constexpr u64 PACK_HEADER_SIZE = sizeof(PACK_SIGNATURE) + 1;
+static constexpr u64 SHA1_SIZE = 20;
+static constexpr u64 ENTRY_HEADER_SIZE = SHA1_SIZE + 4;
+
+MediaPack::MediaPack(const std::string &path) :
+	m_path(path)
+{
+	m_ok = open();
+	if (!m_ok)
+		warningstream << "MediaPack: Can't use \"" << m_path
+			<< "\", media won't be cached" << std::endl;
+}
+
+MediaPack::~MediaPack()
+{
+	unmap();
+}
+
+bool MediaPack::open()
+{
+	fs::CreateAllDirs(fs::RemoveLastPathComponent(m_path));
+
+	std::ifstream is(m_path, std::ios::binary);
+	char header[PACK_HEADER_SIZE];
+	if (!is.read(header, sizeof(header)) ||
+			memcmp(header, PACK_SIGNATURE, sizeof(PACK_SIGNATURE)) != 0 ||
+			(u8)header[sizeof(PACK_SIGNATURE)] != PACK_VERSION) {
+		if (is.is_open())
+			infostream << "MediaPack: Recreating \"" << m_path << "\"" << std::endl;
+		is.close();
+		std::ofstream os(m_path, std::ios::binary | std::ios::trunc);
+		os.write(PACK_SIGNATURE, sizeof(PACK_SIGNATURE));
+		os.put((char)PACK_VERSION);
+		if (!os.good())
+			return false;
+		m_end = PACK_HEADER_SIZE;
+		return true;
+	}
+
+	is.seekg(0, std::ios::end);
+	const u64 file_size = is.tellg();
+
+	// Only the entry headers are read to build the index
+	u64 pos = PACK_HEADER_SIZE;
+	char entry_header[ENTRY_HEADER_SIZE];
+	while (is.seekg(pos) && is.read(entry_header, sizeof(entry_header))) {
+		const u32 size = readU32((const u8 *)entry_header + SHA1_SIZE);
+		if (file_size - pos - ENTRY_HEADER_SIZE < size)
+			break;
+		m_index[std::string(entry_header, SHA1_SIZE)] = {pos + ENTRY_HEADER_SIZE, size};
+		pos += ENTRY_HEADER_SIZE + size;
+	}
+	if (pos != file_size)
+		infostream << "MediaPack: Ignoring " << (file_size - pos)
+			<< " bytes at the end of \"" << m_path << "\"" << std::endl;
+	m_end = pos;
+
+	is.close();
+	map();
+	verbosestream << "MediaPack: " << m_index.size() << " files in \""
+		<< m_path << "\"" << std::endl;
+	return true;
+}
+
+void MediaPack::map()
+{
+	// Without a mapping everything is read from disk, which still works
+#ifdef _WIN32
+	HANDLE file = CreateFileA(m_path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+			(u64)size.QuadPart <= std::numeric_limits<SIZE_T>::max()) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// the view keeps the mapping alive
+			CloseHandle(mapping);
+			if (ptr) {
+				m_data = (const char *)ptr;
+				m_mapped_size = size.QuadPart;
+			}
+		}
+	}
+	CloseHandle(file);
+#else
+	int fd = ::open(m_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+			(u64)st.st_size <= std::numeric_limits<size_t>::max()) {
+		void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr != MAP_FAILED) {
+			m_data = (const char *)ptr;
+			m_mapped_size = st.st_size;
+		}
+	}
+	close(fd);
+#endif
+
+	if (!m_data)
+		warningstream << "MediaPack: Failed to map \"" << m_path << "\"" << std::endl;
+}
+
+void MediaPack::unmap()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap((void *)m_data, m_mapped_size);
+#endif
+	m_data = nullptr;
+	m_mapped_size = 0;
+}
+
+bool MediaPack::exists(const std::string &sha1) const
+{
+	MutexAutoLock lock(m_mutex);
+	return m_index.count(sha1) != 0;
+}
+
+bool MediaPack::load(const std::string &sha1, std::string &data) const
+{
+	Entry entry;
+	{
+		MutexAutoLock lock(m_mutex);
+		auto it = m_index.find(sha1);
+		if (it == m_index.end())
+			return false;
+		entry = it->second;
+	}
+
+	if (entry.offset + entry.size <= m_mapped_size) {
+		data.assign(m_data + entry.offset, entry.size);
+		return true;
+	}
+
+	std::ifstream is(m_path, std::ios::binary);
+	data.resize(entry.size);
+	if (!is.seekg(entry.offset) || !is.read(&data[0], entry.size)) {
+		errorstream << "MediaPack: Failed to read from \"" << m_path << "\"" << std::endl;
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool MediaPack::add(const std::string &sha1, std::string_view data)
+{
+	if (!m_ok || sha1.size() != SHA1_SIZE || data.size() > U32_MAX)
+		return false;
+
+	MutexAutoLock lock(m_mutex);
+	if (m_index.count(sha1) != 0)
+		return false;
+
+	// Overwrites whatever isn't known to be complete
+	std::fstream os(m_path, std::ios::binary | std::ios::in | std::ios::out);
+	char size[4];
+	writeU32((u8 *)size, data.size());
+	os.seekp(m_end);
+	os.write(sha1.data(), SHA1_SIZE);
+	os.write(size, sizeof(size));
+	os.write(data.data(), data.size());
+	os.flush();
+	if (!os.good()) {
+		errorstream << "MediaPack: Failed to write to \"" << m_path << "\"" << std::endl;
+		return false;
+	}
+
+	m_index[sha1] = {m_end + ENTRY_HEADER_SIZE, (u32)data.size()};
+	m_end += ENTRY_HEADER_SIZE + data.size();
+	return true;
+}
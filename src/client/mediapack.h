@@ -0,0 +1,70 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+	All cached media files in a single file, indexed by their SHA-1.
+
+	The file is mapped into memory, so that joining a server doesn't open
+	every cached file, and files that are never used aren't read at all.
+
+	Format:
+	[4 bytes] signature: 'LMPK'
+	[u8] version: 1
+	For each file:
+		[20 bytes] raw SHA-1 of the data
+		[u32] size
+		[size bytes] data
+
+	Files are only ever appended. A truncated file at the end is overwritten
+	by the next one. The data isn't verified here, callers check the hash.
+*/
+class MediaPack
+{
+public:
+	MediaPack(const std::string &path);
+	~MediaPack();
+
+	DISABLE_CLASS_COPY(MediaPack)
+
+	// sha1 is the raw hash (20 bytes)
+	bool exists(const std::string &sha1) const;
+
+	// Thread-safe
+	bool load(const std::string &sha1, std::string &data) const;
+
+	// Appends the file unless it exists already
+	// returns true if something was written
+	bool add(const std::string &sha1, std::string_view data);
+
+private:
+	struct Entry {
+		u64 offset;
+		u32 size;
+	};
+
+	bool open();
+	void map();
+	void unmap();
+
+	std::string m_path;
+	bool m_ok = false;
+
+	// The file as it was when opened. Files appended later are read from disk.
+	const char *m_data = nullptr;
+	u64 m_mapped_size = 0;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_index;
+	// End of the last complete file
+	u64 m_end = 0;
+};
@@ -10,6 +10,8 @@
 #include "map.h"
 #include "util/directiontables.h"
 #include "porting.h"
+#include <algorithm>
+#include <limits>
 
 /*
 	QueuedMeshUpdate
@@ -61,6 +63,8 @@ MeshUpdateQueue::MeshUpdateQueue(Client *client):
 {
 	m_cache_smooth_lighting = g_settings->getBool("smooth_lighting");
 	m_cache_enable_water_reflections = g_settings->getBool("enable_water_reflections");
+	m_cache_merge_solid_faces = g_settings->getBool("merge_solid_faces");
+	m_cache_mesh_lod_distance = g_settings->getU16("mesh_lod_distance") * BS;
 }
 
 MeshUpdateQueue::~MeshUpdateQueue()
@@ -100,16 +104,16 @@ bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 		Find if block is already in queue.
 		If it is, update the data and quit.
 	*/
-	for (QueuedMeshUpdate *q : m_queue) {
-		if (q->p == mesh_position) {
-			if (ack_block_to_server)
-				q->ack_list.push_back(p);
-			q->crack_level = m_client->getCrackLevel();
-			q->crack_pos = m_client->getCrackPos();
-			q->urgent |= urgent;
-			q->retrieveBlocks(map, mesh_grid.cell_size);
-			return true;
-		}
+	auto it = m_queue_index.find(mesh_position);
+	if (it != m_queue_index.end()) {
+		QueuedMeshUpdate *q = it->second;
+		if (ack_block_to_server)
+			q->ack_list.push_back(p);
+		q->crack_level = m_client->getCrackLevel();
+		q->crack_pos = m_client->getCrackPos();
+		q->urgent |= urgent;
+		q->retrieveBlocks(map, mesh_grid.cell_size);
+		return true;
 	}
 
 	/*
@@ -134,12 +138,75 @@ bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 	q->crack_level = m_client->getCrackLevel();
 	q->crack_pos = m_client->getCrackPos();
 	q->urgent = urgent;
+	q->priority = getPriority(mesh_position, mesh_grid.cell_size);
 	q->retrieveBlocks(map, mesh_grid.cell_size);
-	m_queue.push_back(q);
+	insert(q);
 
 	return true;
 }
 
+void MeshUpdateQueue::insert(QueuedMeshUpdate *q)
+{
+	// after the ones of the same priority, to keep them in order
+	auto pos = std::upper_bound(m_queue.begin(), m_queue.end(), q->priority,
+		[] (f32 priority, const QueuedMeshUpdate *other) {
+			return priority < other->priority;
+		});
+	m_queue.insert(pos, q);
+	m_queue_index[q->p] = q;
+}
+
+f32 MeshUpdateQueue::getPriority(v3s16 mesh_pos, u16 cell_size) const
+{
+	if (!m_has_camera)
+		return 0.0f;
+
+	f32 d;
+	bool in_sight = isBlockInSight(mesh_pos + cell_size / 2, m_camera_pos,
+		m_camera_dir, m_camera_fov, std::numeric_limits<f32>::max(), &d);
+	// The ones behind are still needed soon when turning around
+	return in_sight ? d : d * 3 + MAP_BLOCKSIZE * BS;
+}
+
+u16 MeshUpdateQueue::getLod(v3s16 mesh_pos, u16 cell_size) const
+{
+	if (!m_has_camera)
+		return 1;
+
+	// like the bounding sphere center of the mesh
+	const v3f center = intToFloat(mesh_pos * MAP_BLOCKSIZE, BS) +
+		v3f((cell_size * MAP_BLOCKSIZE * 0.5f - 0.5f) * BS);
+	return getMeshLod(center.getDistanceFrom(m_camera_pos), m_cache_mesh_lod_distance);
+}
+
+void MeshUpdateQueue::setCamera(v3f pos, v3f dir, f32 fov)
+{
+	// Only resort when the order may have changed noticeably
+	constexpr f32 resort_distance = MAP_BLOCKSIZE * BS / 2;
+	const f32 resort_cos = std::cos(fov / 8);
+
+	MutexAutoLock lock(m_mutex);
+	if (m_has_camera && fov == m_camera_fov &&
+			pos.getDistanceFromSQ(m_camera_pos) < resort_distance * resort_distance &&
+			dir.dotProduct(m_camera_dir) > resort_cos)
+		return;
+
+	m_has_camera = true;
+	m_camera_pos = pos;
+	m_camera_dir = dir;
+	m_camera_fov = fov;
+	if (m_queue.empty())
+		return;
+
+	const u16 cell_size = m_client->getMeshGrid().cell_size;
+	for (QueuedMeshUpdate *q : m_queue)
+		q->priority = getPriority(q->p, cell_size);
+	std::stable_sort(m_queue.begin(), m_queue.end(),
+		[] (const QueuedMeshUpdate *a, const QueuedMeshUpdate *b) {
+			return a->priority < b->priority;
+		});
+}
+
 // Returned pointer must be deleted
 // Returns NULL if queue is empty
 QueuedMeshUpdate *MeshUpdateQueue::pop()
@@ -157,8 +224,11 @@ QueuedMeshUpdate *MeshUpdateQueue::pop()
 			if (m_inflight_blocks.find(q->p) != m_inflight_blocks.end())
 				continue;
 			m_queue.erase(i);
+			m_queue_index.erase(q->p);
 			m_urgents.erase(q->p);
 			m_inflight_blocks.insert(q->p);
+			// for the camera at the time the mesh is made
+			q->lod = getLod(q->p, m_client->getMeshGrid().cell_size);
 			result = q;
 			break;
 		}
@@ -193,13 +263,15 @@ void MeshUpdateQueue::fillDataFromMapBlocks(QueuedMeshUpdate *q)
 	for (pos.Y = q->p.Y - 1; pos.Y <= q->p.Y + mesh_grid.cell_size; pos.Y++) {
 		MapBlock *block = q->map_blocks[i++];
 		if (block)
-			block->copyTo(data->m_vmanip);
+			block->copyTo(data->m_vmanip, data->m_vmanip.m_area);
 	}
 
 	data->setCrack(q->crack_level, q->crack_pos);
 	data->m_generate_minimap = !!m_client->getMinimap();
 	data->m_smooth_lighting = m_cache_smooth_lighting;
 	data->m_enable_water_reflections = m_cache_enable_water_reflections;
+	data->m_merge_solid_faces = m_cache_merge_solid_faces;
+	data->m_lod = q->lod;
 }
 
 /*
@@ -217,7 +289,9 @@ void MeshUpdateWorkerThread::doUpdate()
 {
 	QueuedMeshUpdate *q;
 	while ((q = m_queue_in->pop())) {
-		ScopeProfiler sp(g_profiler, "Client: Mesh making (sum)");
+		static const ProfilerKey prof_key("Client: Mesh making (sum)",
+			SPT_ADD, PRECISION_MILLI);
+		ScopeProfiler sp(g_profiler, prof_key);
 
 		// This generates the mesh:
 		MapBlockMesh *mesh_new = new MapBlockMesh(m_client, q->data);
@@ -288,6 +362,12 @@ void MeshUpdateManager::updateBlock(Map *map, v3s16 p, bool ack_block_to_server,
 	deferUpdate();
 }
 
+void MeshUpdateManager::updateCamera(v3f pos, v3f dir, f32 fov)
+{
+	m_queue_in.setCamera(pos, dir, fov);
+	m_camera_pos = pos;
+}
+
 void MeshUpdateManager::putResult(const MeshUpdateResult &result)
 {
 	if (result.urgent)
@@ -311,6 +391,67 @@ bool MeshUpdateManager::getNextResult(MeshUpdateResult &r)
 	return false;
 }
 
+void MeshUpdateManager::collectResults(std::vector<v3s16> &acks)
+{
+	MeshUpdateResult r;
+	while (getNextResult(r)) {
+		acks.insert(acks.end(), r.ack_list.begin(), r.ack_list.end());
+		r.ack_list.clear();
+
+		auto [it, inserted] = m_collected_results.try_emplace(r.p);
+		if (!inserted) {
+			// there's no point in showing the older mesh for a frame
+			r.urgent |= it->second.urgent;
+			discardResult(it->second);
+		}
+		it->second = std::move(r);
+		r = MeshUpdateResult();
+	}
+}
+
+bool MeshUpdateManager::takeNearestResult(MeshUpdateResult &r)
+{
+	if (m_collected_results.empty())
+		return false;
+
+	const v3s16 camera_block = getNodeBlockPos(floatToInt(m_camera_pos, BS));
+	auto best = m_collected_results.end();
+	u32 best_distance = 0;
+	for (auto it = m_collected_results.begin(); it != m_collected_results.end(); ++it) {
+		const v3s16 d = it->first - camera_block;
+		u32 distance = d.X * d.X + d.Y * d.Y + d.Z * d.Z;
+		if (!it->second.urgent)
+			distance += 1U << 30;
+		if (best == m_collected_results.end() || distance < best_distance) {
+			best = it;
+			best_distance = distance;
+		}
+	}
+	r = std::move(best->second);
+	m_collected_results.erase(best);
+	return true;
+}
+
+void MeshUpdateManager::discardResults()
+{
+	MeshUpdateResult r;
+	while (getNextResult(r))
+		discardResult(r);
+	for (auto &it : m_collected_results)
+		discardResult(it.second);
+	m_collected_results.clear();
+}
+
+void MeshUpdateManager::discardResult(MeshUpdateResult &r)
+{
+	for (auto block : r.map_blocks)
+		if (block)
+			block->refDrop();
+	r.map_blocks.clear();
+	delete r.mesh;
+	r.mesh = nullptr;
+}
+
 void MeshUpdateManager::deferUpdate()
 {
 	for (auto &thread : m_workers)
@@ -24,6 +24,10 @@ struct QueuedMeshUpdate
 	MeshMakeData *data = nullptr; // This is generated in MeshUpdateQueue::pop()
 	std::vector<MapBlock*> map_blocks;
 	bool urgent = false;
+	// lower is sooner, see MeshUpdateQueue::getPriority()
+	f32 priority = 0.0f;
+	// see MeshMakeData::m_lod
+	u16 lod = 1;
 
 	QueuedMeshUpdate() = default;
 	~QueuedMeshUpdate();
@@ -76,6 +80,15 @@ class MeshUpdateQueue
 	// Marks a position as finished, unblocking the next update
 	void done(v3s16 pos);
 
+	/**
+	 * Sets the camera that updates are ordered by: the ones closest to it
+	 * and in its view come first.
+	 * @param pos camera position
+	 * @param dir unit vector of the camera direction
+	 * @param fov field of view in radians
+	 */
+	void setCamera(v3f pos, v3f dir, f32 fov);
+
 	size_t size()
 	{
 		MutexAutoLock lock(m_mutex);
@@ -84,7 +97,9 @@ class MeshUpdateQueue
 
 private:
 	Client *m_client;
+	// sorted by priority
 	std::vector<QueuedMeshUpdate *> m_queue;
+	std::unordered_map<v3s16, QueuedMeshUpdate *> m_queue_index;
 	std::unordered_set<v3s16> m_urgents;
 	std::unordered_set<v3s16> m_inflight_blocks;
 	std::mutex m_mutex;
@@ -92,6 +107,18 @@ class MeshUpdateQueue
 	// TODO: Add callback to update these when g_settings changes, and update all meshes
 	bool m_cache_smooth_lighting;
 	bool m_cache_enable_water_reflections;
+	bool m_cache_merge_solid_faces;
+	f32 m_cache_mesh_lod_distance;
+
+	// the camera when the queue was last sorted
+	bool m_has_camera = false;
+	v3f m_camera_pos;
+	v3f m_camera_dir;
+	f32 m_camera_fov = 0.0f;
+
+	f32 getPriority(v3s16 mesh_pos, u16 cell_size) const;
+	u16 getLod(v3s16 mesh_pos, u16 cell_size) const;
+	void insert(QueuedMeshUpdate *q);
 
 	void fillDataFromMapBlocks(QueuedMeshUpdate *q);
 };
@@ -137,9 +164,24 @@ class MeshUpdateManager
 	void updateBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent,
 			bool update_neighbors = false);
 	void putResult(const MeshUpdateResult &r);
+	// Sets the camera that the queued updates are ordered by
+	void updateCamera(v3f pos, v3f dir, f32 fov);
 	/// @note caller needs to refDrop() the affected map_blocks
 	bool getNextResult(MeshUpdateResult &r);
 
+	/*
+		Takes the results of the worker threads and drops those that were
+		replaced by a newer mesh of the same block, keeping their
+		acknowledgements. Only called by the main thread.
+		acks: filled with the blocks to acknowledge to the server
+	*/
+	void collectResults(std::vector<v3s16> &acks);
+	// Takes a collected result, the urgent ones first and then those nearest
+	// to the camera
+	/// @note caller needs to refDrop() the affected map_blocks
+	bool takeNearestResult(MeshUpdateResult &r);
+	// Drops all results that weren't taken
+	void discardResults();
 
 	void start();
 	void stop();
@@ -149,11 +191,16 @@ class MeshUpdateManager
 
 private:
 	void deferUpdate();
+	static void discardResult(MeshUpdateResult &r);
 
 
 	MeshUpdateQueue m_queue_in;
 	MutexedQueue<MeshUpdateResult> m_queue_out;
 	MutexedQueue<MeshUpdateResult> m_queue_out_urgent;
 
+	// Results taken by collectResults(), only used by the main thread
+	std::unordered_map<v3s16, MeshUpdateResult> m_collected_results;
+	v3f m_camera_pos;
+
 	std::vector<std::unique_ptr<MeshUpdateWorkerThread>> m_workers;
 };
@@ -21,7 +21,11 @@ void MeshCollector::append(const TileSpec &tile, const video::S3DVertex *vertice
 void MeshCollector::append(const TileLayer &layer, const video::S3DVertex *vertices,
 		u32 numVertices, const u16 *indices, u32 numIndices, u8 layernum)
 {
-	PreMeshBuffer &p = findBuffer(layer, layernum, numVertices);
+	// cracks need a texture of their own
+	const bool to_array = use_array_textures && layer.array_texture &&
+			!(layer.material_flags & MATERIAL_FLAG_CRACK);
+	PreMeshBuffer &p = to_array ? findArrayBuffer(layer, layernum, numVertices) :
+			findBuffer(layer, layernum, numVertices);
 
 	u32 vertex_count = p.vertices.size();
 	for (u32 i = 0; i < numVertices; i++) {
@@ -30,6 +34,14 @@ void MeshCollector::append(const TileLayer &layer, const video::S3DVertex *verti
 		m_bounding_radius_sq = std::max(m_bounding_radius_sq,
 				(vertices[i].Pos - m_center_pos).getLengthSQ());
 	}
+	if (to_array) {
+		// the tiles of the buffer can have different colors
+		if (layer.color != video::SColor(0xFFFFFFFF)) {
+			for (u32 i = vertex_count; i < p.vertices.size(); i++)
+				PreMeshBuffer::applyColor(p.vertices[i].Color, layer.color);
+		}
+		p.array_layers.resize(p.vertices.size(), layer.array_layer);
+	}
 
 	for (u32 i = 0; i < numIndices; i++)
 		p.indices.push_back(indices[i] + vertex_count);
@@ -43,8 +55,37 @@ PreMeshBuffer &MeshCollector::findBuffer(
 				"Mesh can't contain more than 65536 vertices");
 	std::vector<PreMeshBuffer> &buffers = prebuffers[layernum];
 	for (PreMeshBuffer &p : buffers)
-		if (p.layer == layer && p.vertices.size() + numVertices <= U16_MAX)
+		if (!p.uses_array_texture && p.layer == layer &&
+				p.vertices.size() + numVertices <= U16_MAX)
 			return p;
 	buffers.emplace_back(layer);
 	return buffers.back();
 }
+
+PreMeshBuffer &MeshCollector::findArrayBuffer(
+		const TileLayer &layer, u8 layernum, u32 numVertices)
+{
+	if (numVertices > U16_MAX)
+		throw std::invalid_argument(
+				"Mesh can't contain more than 65536 vertices");
+	std::vector<PreMeshBuffer> &buffers = prebuffers[layernum];
+	for (PreMeshBuffer &p : buffers)
+		if (p.uses_array_texture &&
+				p.layer.texture == layer.array_texture &&
+				p.layer.material_type == layer.material_type &&
+				p.layer.material_flags == layer.material_flags &&
+				p.layer.need_polygon_offset == layer.need_polygon_offset &&
+				p.vertices.size() + numVertices <= U16_MAX)
+			return p;
+
+	// the tile itself is only the first one in the buffer
+	TileLayer array_layer = layer;
+	array_layer.texture = layer.array_texture;
+	array_layer.texture_id = 0;
+	array_layer.shader_id = layer.array_shader_id;
+	array_layer.color = video::SColor(0xFFFFFFFF);
+	array_layer.has_color = true;
+	buffers.emplace_back(array_layer);
+	buffers.back().uses_array_texture = true;
+	return buffers.back();
+}
@@ -15,23 +15,30 @@ struct PreMeshBuffer
 	TileLayer layer;
 	std::vector<u16> indices;
 	std::vector<video::S3DVertex> vertices;
+	/// If true, `layer` draws from its array texture and the tiles of
+	/// the buffer differ in their layer of it. It is given for each vertex.
+	bool uses_array_texture = false;
+	std::vector<u16> array_layers;
 
 	PreMeshBuffer() = default;
 	explicit PreMeshBuffer(const TileLayer &layer) : layer(layer) {}
 
+	static void applyColor(video::SColor &c, video::SColor tc)
+	{
+		c.set(c.getAlpha(),
+			c.getRed() * tc.getRed() / 255U,
+			c.getGreen() * tc.getGreen() / 255U,
+			c.getBlue() * tc.getBlue() / 255U);
+	}
+
 	/// @brief Colorizes vertices as indicated by tile layer
 	void applyTileColor()
 	{
 		video::SColor tc = layer.color;
 		if (tc == video::SColor(0xFFFFFFFF))
 			return;
-		for (auto &vertex : vertices) {
-			video::SColor *c = &vertex.Color;
-			c->set(c->getAlpha(),
-				c->getRed() * tc.getRed() / 255U,
-				c->getGreen() * tc.getGreen() / 255U,
-				c->getBlue() * tc.getBlue() / 255U);
-		}
+		for (auto &vertex : vertices)
+			applyColor(vertex.Color, tc);
 	}
 };
 
@@ -42,10 +49,16 @@ struct MeshCollector
 	f32 m_bounding_radius_sq = 0.0f;
 	v3f m_center_pos;
 	v3f offset;
+	// put tiles that have an array texture into shared buffers
+	bool use_array_textures;
 
 	// center_pos: pos to use for bounding-sphere, in BS-space
 	// offset: offset added to vertices
-	MeshCollector(const v3f center_pos, v3f offset = v3f()) : m_center_pos(center_pos), offset(offset) {}
+	MeshCollector(const v3f center_pos, v3f offset = v3f(),
+			bool use_array_textures = false) :
+		m_center_pos(center_pos), offset(offset),
+		use_array_textures(use_array_textures)
+	{}
 
 	void append(const TileSpec &material,
 			const video::S3DVertex *vertices, u32 numVertices,
@@ -58,4 +71,5 @@ struct MeshCollector
 			u8 layernum);
 
 	PreMeshBuffer &findBuffer(const TileLayer &layer, u8 layernum, u32 numVertices);
+	PreMeshBuffer &findArrayBuffer(const TileLayer &layer, u8 layernum, u32 numVertices);
 };
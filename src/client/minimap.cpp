@@ -4,6 +4,7 @@
 
 #include "minimap.h"
 #include <cmath>
+#include <cstring>
 #include "client.h"
 #include "clientmap.h"
 #include "settings.h"
@@ -76,6 +77,7 @@ void MinimapUpdateThread::doUpdate()
 	QueuedMinimapUpdate update;
 
 	while (popBlockUpdate(&update)) {
+		m_tiles.erase(v2s16(update.pos.X, update.pos.Z));
 		if (update.data) {
 			// Swap two values in the map using single lookup
 			auto result = m_blocks_cache.insert(std::make_pair(update.pos, update.data));
@@ -108,50 +110,116 @@ void MinimapUpdateThread::getMap(v3s16 pos, s16 size, s16 height)
 	v3s16 blockpos_min = getNodeBlockPos(pos_min);
 	v3s16 blockpos_max = getNodeBlockPos(pos_max);
 
-// clear the map
-	for (int z = 0; z < size; z++)
-	for (int x = 0; x < size; x++) {
-		MinimapPixel &mmpixel = data->minimap_scan[x + z * size];
+	// The tiles depend on the vertical range, moving sideways only shifts them
+	if (data->mode.type != m_tiles_type || pos_min.Y != m_tiles_y_min ||
+			pos_max.Y != m_tiles_y_max) {
+		m_tiles.clear();
+		m_tiles_type = data->mode.type;
+		m_tiles_y_min = pos_min.Y;
+		m_tiles_y_max = pos_max.Y;
+	}
+	m_scan_id++;
+
+	v2s16 column;
+	for (column.Y = blockpos_min.Z; column.Y <= blockpos_max.Z; ++column.Y)
+	for (column.X = blockpos_min.X; column.X <= blockpos_max.X; ++column.X) {
+		auto result = m_tiles.try_emplace(column);
+		MinimapTile &tile = result.first->second;
+		if (result.second)
+			renderTile(tile, column, blockpos_min.Y, blockpos_max.Y, pos_min.Y);
+		tile.last_used = m_scan_id;
+
+		// copy the visible part, the image has north at the top
+		const s16 node_x = column.X * MAP_BLOCKSIZE;
+		const s16 node_z = column.Y * MAP_BLOCKSIZE;
+		const s16 x_min = std::max(node_x, pos_min.X);
+		const s16 x_max = std::min<s16>(node_x + MAP_BLOCKSIZE - 1, pos_max.X);
+		const s16 z_min = std::max(node_z, pos_min.Z);
+		const s16 z_max = std::min<s16>(node_z + MAP_BLOCKSIZE - 1, pos_max.Z);
+		const size_t count = (x_max - x_min + 1) * sizeof(u32);
+		for (s16 z = z_min; z <= z_max; z++) {
+			const u32 src = (z - node_z) * MAP_BLOCKSIZE + (x_min - node_x);
+			const u32 dst = (size - 1 - (z - pos_min.Z)) * size + (x_min - pos_min.X);
+			memcpy(&data->map_pixels[dst], &tile.color[src], count);
+			memcpy(&data->heightmap_pixels[dst], &tile.height[src], count);
+		}
+	}
+	data->scan_size = size;
+
+	// forget what scrolled out of view
+	for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+		if (it->second.last_used != m_scan_id)
+			it = m_tiles.erase(it);
+		else
+			++it;
+	}
+}
+
+void MinimapUpdateThread::renderTile(MinimapTile &tile, v2s16 column,
+	s16 block_y_min, s16 block_y_max, s16 y_min)
+{
+	MinimapPixel pixels[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	for (MinimapPixel &mmpixel : pixels) {
 		mmpixel.air_count = 0;
 		mmpixel.height = 0;
 		mmpixel.n = MapNode(CONTENT_AIR);
 	}
 
-// draw the map
-	v3s16 blockpos;
-	for (blockpos.Z = blockpos_min.Z; blockpos.Z <= blockpos_max.Z; ++blockpos.Z)
-	for (blockpos.Y = blockpos_min.Y; blockpos.Y <= blockpos_max.Y; ++blockpos.Y)
-	for (blockpos.X = blockpos_min.X; blockpos.X <= blockpos_max.X; ++blockpos.X) {
-		auto pblock = m_blocks_cache.find(blockpos);
+	for (s16 y = block_y_min; y <= block_y_max; y++) {
+		auto pblock = m_blocks_cache.find(v3s16(column.X, y, column.Y));
 		if (pblock == m_blocks_cache.end())
 			continue;
 		const MinimapMapblock &block = *pblock->second;
+		// heights are relative to the bottom of the scanned range
+		const s16 base = std::max<s16>(y * MAP_BLOCKSIZE, y_min) - y_min;
 
-		v3s16 block_node_min(blockpos * MAP_BLOCKSIZE);
-		v3s16 block_node_max(block_node_min + MAP_BLOCKSIZE - 1);
-		// clip
-		v3s16 range_min = componentwise_max(block_node_min, pos_min);
-		v3s16 range_max = componentwise_min(block_node_max, pos_max);
-
-		v3s16 pos;
-		pos.Y = range_min.Y;
-		for (pos.Z = range_min.Z; pos.Z <= range_max.Z; ++pos.Z)
-		for (pos.X = range_min.X; pos.X <= range_max.X; ++pos.X) {
-			v3s16 inblock_pos = pos - block_node_min;
-			const MinimapPixel &in_pixel =
-				block.data[inblock_pos.Z * MAP_BLOCKSIZE + inblock_pos.X];
-
-			v3s16 inmap_pos = pos - pos_min;
-			MinimapPixel &out_pixel =
-				data->minimap_scan[inmap_pos.X + inmap_pos.Z * size];
-
+		for (u32 i = 0; i < MAP_BLOCKSIZE * MAP_BLOCKSIZE; i++) {
+			const MinimapPixel &in_pixel = block.data[i];
+			MinimapPixel &out_pixel = pixels[i];
 			out_pixel.air_count += in_pixel.air_count;
 			if (in_pixel.n.param0 != CONTENT_AIR) {
 				out_pixel.n = in_pixel.n;
-				out_pixel.height = inmap_pos.Y + in_pixel.height;
+				out_pixel.height = base + in_pixel.height;
 			}
 		}
 	}
+
+	if (m_tiles_type == MINIMAP_TYPE_RADAR) {
+		video::SColor c(240, 0, 0, 0);
+		for (u32 i = 0; i < MAP_BLOCKSIZE * MAP_BLOCKSIZE; i++) {
+			const MinimapPixel &mmpixel = pixels[i];
+			if (mmpixel.air_count > 0)
+				c.setGreen(core::clamp(core::round32(32 + mmpixel.air_count * 8), 0, 255));
+			else
+				c.setGreen(0);
+			tile.color[i] = c.color;
+			tile.height[i] = 0;
+		}
+		return;
+	}
+
+	video::SColor tilecolor;
+	for (u32 i = 0; i < MAP_BLOCKSIZE * MAP_BLOCKSIZE; i++) {
+		const MinimapPixel &mmpixel = pixels[i];
+
+		const ContentFeatures &f = ndef->get(mmpixel.n);
+		const TileDef *tiledef = &f.tiledef[0];
+
+		// Color of the 0th tile (mostly this is the topmost)
+		if (tiledef->has_color)
+			tilecolor = tiledef->color;
+		else
+			mmpixel.n.getColor(f, &tilecolor);
+
+		tilecolor.setRed(tilecolor.getRed() * f.minimap_color.getRed() / 255);
+		tilecolor.setGreen(tilecolor.getGreen() * f.minimap_color.getGreen() / 255);
+		tilecolor.setBlue(tilecolor.getBlue() * f.minimap_color.getBlue() / 255);
+		tilecolor.setAlpha(240);
+		tile.color[i] = tilecolor.color;
+
+		u32 h = mmpixel.height;
+		tile.height[i] = video::SColor(255, h, h, h).color;
+	}
 }
 
 ////
@@ -196,6 +264,7 @@ Minimap::Minimap(Client *client)
 	// Initialize and start thread
 	m_minimap_update_thread = std::make_unique<MinimapUpdateThread>();
 	m_minimap_update_thread->data = data.get();
+	m_minimap_update_thread->ndef = m_ndef;
 	m_minimap_update_thread->start();
 }
 
@@ -377,53 +446,6 @@ void Minimap::setAngle(f32 angle)
 	m_angle = angle;
 }
 
-void Minimap::blitMinimapPixelsToImageRadar(video::IImage *map_image)
-{
-	video::SColor c(240, 0, 0, 0);
-	for (s16 x = 0; x < data->mode.map_size; x++)
-	for (s16 z = 0; z < data->mode.map_size; z++) {
-		MinimapPixel *mmpixel = &data->minimap_scan[x + z * data->mode.map_size];
-
-		if (mmpixel->air_count > 0)
-			c.setGreen(core::clamp(core::round32(32 + mmpixel->air_count * 8), 0, 255));
-		else
-			c.setGreen(0);
-
-		map_image->setPixel(x, data->mode.map_size - z - 1, c);
-	}
-}
-
-void Minimap::blitMinimapPixelsToImageSurface(
-	video::IImage *map_image, video::IImage *heightmap_image)
-{
-	// This variable creation/destruction has a 1% cost on rendering minimap
-	video::SColor tilecolor;
-	for (s16 x = 0; x < data->mode.map_size; x++)
-	for (s16 z = 0; z < data->mode.map_size; z++) {
-		MinimapPixel *mmpixel = &data->minimap_scan[x + z * data->mode.map_size];
-
-		const ContentFeatures &f = m_ndef->get(mmpixel->n);
-		const TileDef *tile = &f.tiledef[0];
-
-		// Color of the 0th tile (mostly this is the topmost)
-		if(tile->has_color)
-			tilecolor = tile->color;
-		else
-			mmpixel->n.getColor(f, &tilecolor);
-
-		tilecolor.setRed(tilecolor.getRed() * f.minimap_color.getRed() / 255);
-		tilecolor.setGreen(tilecolor.getGreen() * f.minimap_color.getGreen() / 255);
-		tilecolor.setBlue(tilecolor.getBlue() * f.minimap_color.getBlue() / 255);
-		tilecolor.setAlpha(240);
-
-		map_image->setPixel(x, data->mode.map_size - z - 1, tilecolor);
-
-		u32 h = mmpixel->height;
-		heightmap_image->setPixel(x,data->mode.map_size - z - 1,
-			video::SColor(255, h, h, h));
-	}
-}
-
 video::IImage *Minimap::getMinimapMask()
 {
 	if (data->minimap_shape_round) {
@@ -447,28 +469,60 @@ video::IImage *Minimap::getMinimapMask()
 	return data->minimap_mask_square;
 }
 
+void Minimap::updateTexture(video::ITexture *&texture, const char *name,
+	const u32 *pixels, u16 size, video::IImage *mask)
+{
+	core::dimension2d<u32> dim(size, size);
+	if (!texture || texture->getSize() != dim ||
+			texture->getColorFormat() != video::ECF_A8R8G8B8) {
+		if (texture)
+			driver->removeTexture(texture);
+		video::IImage *image = driver->createImage(video::ECF_A8R8G8B8, dim);
+		texture = driver->addTexture(name, image);
+		image->drop();
+	}
+
+	u32 *dst = reinterpret_cast<u32 *>(texture->lock(video::ETLM_WRITE_ONLY));
+	if (!dst) {
+		warningstream << "Minimap: lock failed for \"" << name << "\"" << std::endl;
+		return;
+	}
+	if (mask) {
+		// the mask is sampled at the resolution of the map
+		for (u32 y = 0; y < size; y++)
+		for (u32 x = 0; x < size; x++) {
+			const video::SColor mask_col = mask->getPixel(
+				x * MINIMAP_MAX_SX / size, y * MINIMAP_MAX_SY / size);
+			dst[y * size + x] = mask_col.getAlpha() ? pixels[y * size + x] : 0;
+		}
+	} else {
+		memcpy(dst, pixels, size * size * sizeof(u32));
+	}
+	texture->unlock();
+	texture->regenerateMipMapLevels();
+}
+
 video::ITexture *Minimap::getMinimapTexture()
 {
 	// update minimap textures when new scan is ready
 	if (data->map_invalidated && data->mode.type != MINIMAP_TYPE_TEXTURE)
 		return data->texture;
 
-	// create minimap and heightmap images in memory
-	core::dimension2d<u32> dim(data->mode.map_size, data->mode.map_size);
-	video::IImage *map_image       = driver->createImage(video::ECF_A8R8G8B8, dim);
-	video::IImage *heightmap_image = driver->createImage(video::ECF_A8R8G8B8, dim);
-	video::IImage *minimap_image   = driver->createImage(video::ECF_A8R8G8B8,
-		core::dimension2d<u32>(MINIMAP_MAX_SX, MINIMAP_MAX_SY));
+	video::IImage *minimap_mask = getMinimapMask();
 
-	// Blit MinimapPixels to images
-	switch(data->mode.type) {
+	// The textures stay at the size of the map, the GPU scales them when drawing
+	switch (data->mode.type) {
 	case MINIMAP_TYPE_OFF:
 		break;
 	case MINIMAP_TYPE_SURFACE:
-		blitMinimapPixelsToImageSurface(map_image, heightmap_image);
+		updateTexture(data->texture, "minimap__", data->map_pixels,
+			data->scan_size, minimap_mask);
+		updateTexture(data->heightmap_texture, "minimap_heightmap__",
+			data->heightmap_pixels, data->scan_size, nullptr);
 		break;
 	case MINIMAP_TYPE_RADAR:
-		blitMinimapPixelsToImageRadar(map_image);
+		updateTexture(data->texture, "minimap__", data->map_pixels,
+			data->scan_size, minimap_mask);
 		break;
 	case MINIMAP_TYPE_TEXTURE:
 		// FIXME: this is a pointless roundtrip through the gpu
@@ -479,6 +533,8 @@ video::ITexture *Minimap::getMinimapTexture()
 
 		auto dim = image->getDimension();
 
+		core::dimension2d<u32> map_dim(data->mode.map_size, data->mode.map_size);
+		video::IImage *map_image = driver->createImage(video::ECF_A8R8G8B8, map_dim);
 		map_image->fill(video::SColor(255, 0, 0, 0));
 		image->copyTo(map_image,
 			core::vector2d<int> {
@@ -490,31 +546,13 @@ video::ITexture *Minimap::getMinimapTexture()
 
 		image->drop();
 		texture->unlock();
-	}
-
-	map_image->copyToScaling(minimap_image);
-	map_image->drop();
 
-	video::IImage *minimap_mask = getMinimapMask();
-
-	for (s16 y = 0; y < MINIMAP_MAX_SY; y++)
-	for (s16 x = 0; x < MINIMAP_MAX_SX; x++) {
-		const video::SColor &mask_col = minimap_mask->getPixel(x, y);
-		if (!mask_col.getAlpha())
-			minimap_image->setPixel(x, y, video::SColor(0,0,0,0));
+		updateTexture(data->texture, "minimap__",
+			reinterpret_cast<const u32 *>(map_image->getData()),
+			data->mode.map_size, minimap_mask);
+		map_image->drop();
 	}
 
-	if (data->texture)
-		driver->removeTexture(data->texture);
-	if (data->heightmap_texture)
-		driver->removeTexture(data->heightmap_texture);
-
-	data->texture = driver->addTexture("minimap__", minimap_image);
-	data->heightmap_texture =
-		driver->addTexture("minimap_heightmap__", heightmap_image);
-	minimap_image->drop();
-	heightmap_image->drop();
-
 	data->map_invalidated = true;
 
 	return data->texture;
@@ -592,6 +630,9 @@ void Minimap::drawMinimap(core::rect<s32> rect)
 		tex.MinFilter = video::ETMINF_LINEAR_MIPMAP_LINEAR;
 		tex.MagFilter = video::ETMAGF_LINEAR;
 	});
+	// keep the nodes sharp when zoomed in
+	if (data->mode.type != MINIMAP_TYPE_TEXTURE)
+		material.TextureLayers[0].MagFilter = video::ETMAGF_NEAREST;
 	material.TextureLayers[0].Texture = minimap_texture;
 	material.TextureLayers[1].Texture = data->heightmap_texture;
 
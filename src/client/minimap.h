@@ -14,6 +14,7 @@
 #include "util/thread.h"
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace video {
@@ -73,7 +74,10 @@ struct MinimapData {
 	MinimapModeDef mode;
 	v3s16 pos;
 	v3s16 old_pos;
-	MinimapPixel minimap_scan[MINIMAP_MAX_SX * MINIMAP_MAX_SY];
+	// Result of the last scan, rows from north to south, A8R8G8B8
+	u32 map_pixels[MINIMAP_MAX_SX * MINIMAP_MAX_SY];
+	u32 heightmap_pixels[MINIMAP_MAX_SX * MINIMAP_MAX_SY];
+	u16 scan_size = 0;
 	bool map_invalidated;
 	bool minimap_shape_round;
 	video::IImage *minimap_mask_round = nullptr;
@@ -87,6 +91,13 @@ struct MinimapData {
 	video::ITexture *object_marker_red = nullptr;
 };
 
+// The pixels of one column of mapblocks, for the Y range and type of the last scan
+struct MinimapTile {
+	u32 color[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	u32 height[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	u32 last_used = 0;
+};
+
 struct QueuedMinimapUpdate {
 	v3s16 pos;
 	MinimapMapblock *data = nullptr;
@@ -103,14 +114,25 @@ class MinimapUpdateThread : public UpdateThread {
 	bool popBlockUpdate(QueuedMinimapUpdate *update);
 
 	MinimapData *data = nullptr;
+	const NodeDefManager *ndef = nullptr;
 
 protected:
 	virtual void doUpdate();
 
 private:
+	void renderTile(MinimapTile &tile, v2s16 column, s16 block_y_min,
+		s16 block_y_max, s16 y_min);
+
 	std::mutex m_queue_mutex;
 	std::deque<QueuedMinimapUpdate> m_update_queue;
 	std::map<v3s16, MinimapMapblock *> m_blocks_cache;
+
+	// Rendered block columns, only re-rendered when one of their blocks changes
+	std::unordered_map<v2s16, MinimapTile> m_tiles;
+	MinimapType m_tiles_type = MINIMAP_TYPE_OFF;
+	s16 m_tiles_y_min = 0;
+	s16 m_tiles_y_max = 0;
+	u32 m_scan_id = 0;
 };
 
 class Minimap {
@@ -145,10 +167,6 @@ class Minimap {
 	video::IImage *getMinimapMask();
 	video::ITexture *getMinimapTexture();
 
-	void blitMinimapPixelsToImageRadar(video::IImage *map_image);
-	void blitMinimapPixelsToImageSurface(video::IImage *map_image,
-		video::IImage *heightmap_image);
-
 	irr_ptr<scene::SMeshBuffer> createMinimapMeshBuffer();
 
 	MinimapMarker* addMarker(scene::ISceneNode *parent_node);
@@ -162,6 +180,10 @@ class Minimap {
 	std::unique_ptr<MinimapData> data;
 
 private:
+	// Uploads size x size pixels, replacing the texture if its size changed
+	void updateTexture(video::ITexture *&texture, const char *name,
+		const u32 *pixels, u16 size, video::IImage *mask);
+
 	ITextureSource *m_tsrc;
 	IShaderSource *m_shdrsrc;
 	const NodeDefManager *m_ndef;
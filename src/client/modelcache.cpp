@@ -0,0 +1,365 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "modelcache.h"
+#include <sstream>
+#include <vector>
+#include <SkinnedMesh.h>
+#include "exceptions.h"
+#include "log.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "util/serialize.h"
+#include "util/string.h"
+#include "version.h"
+
+/*
+	File format:
+	u8 version
+	u8 size of S3DVertex, S3DVertex2TCoords and S3DVertexTangents each
+	u8 source format
+	f32 frames per second
+	u32 number of mesh buffers, for each:
+		u32 texture slot
+		u8 vertex type, u8 primitive type
+		matrix transformation
+		u32 material type, u8 z-write, u8 backface culling,
+		u8 texture wrap U, u8 texture wrap V
+		u32 number of vertices, vertices as in memory
+		u32 number of indices, u16 indices as in memory
+	u32 number of joints, parents first, for each:
+		u8 has name, [string16 name]
+		u16 parent index + 1, 0 if none
+		u8 0: v3f translation, quaternion rotation, v3f scale
+		   1: matrix transformation
+		u8 has global inversed matrix, [matrix]
+		u32 number of attached mesh buffers, u32 each
+		position, rotation and scale keys, each:
+			u8 interpolate
+			u32 number of frames, frames as in memory
+		u32 number of weights, for each: u16 buffer, u32 vertex, f32 strength
+
+	Matrices are 16 f32 and quaternions are 4 f32 (X, Y, Z, W).
+	Vertices and frames aren't converted, the cache is only read where it is
+	written.
+*/
+static constexpr u8 FILE_VERSION = 1;
+
+namespace {
+
+void writeMatrix(std::ostream &os, const core::matrix4 &m)
+{
+	for (int i = 0; i < 16; i++)
+		writeF32(os, m[i]);
+}
+
+core::matrix4 readMatrix(std::istream &is)
+{
+	core::matrix4 m;
+	for (int i = 0; i < 16; i++)
+		m[i] = readF32(is);
+	return m;
+}
+
+void writeQuaternion(std::ostream &os, const core::quaternion &q)
+{
+	writeF32(os, q.X);
+	writeF32(os, q.Y);
+	writeF32(os, q.Z);
+	writeF32(os, q.W);
+}
+
+core::quaternion readQuaternion(std::istream &is)
+{
+	core::quaternion q;
+	q.X = readF32(is);
+	q.Y = readF32(is);
+	q.Z = readF32(is);
+	q.W = readF32(is);
+	return q;
+}
+
+template <typename T>
+void writeArray(std::ostream &os, const std::vector<T> &v)
+{
+	writeU32(os, v.size());
+	os.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+void writeChannel(std::ostream &os, const scene::SkinnedMesh::Channel<T> &channel)
+{
+	writeU8(os, channel.interpolate);
+	writeArray(os, channel.frames);
+}
+
+// Reads the number of following items, and makes sure that the file is
+// long enough for them so that broken files can't make us allocate a lot.
+u32 readCount(std::istream &is, size_t size, size_t item_size)
+{
+	const u32 count = readU32(is);
+	if (!is)
+		throw SerializationError("unexpected end of file");
+	const size_t pos = is.tellg();
+	if ((size - pos) / item_size < count)
+		throw SerializationError("count too large");
+	return count;
+}
+
+template <typename T>
+void readArray(std::istream &is, size_t size, std::vector<T> &v)
+{
+	v.resize(readCount(is, size, sizeof(T)));
+	is.read(reinterpret_cast<char *>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+void readChannel(std::istream &is, size_t size,
+		scene::SkinnedMesh::Channel<T> &channel)
+{
+	channel.interpolate = readU8(is);
+	readArray(is, size, channel.frames);
+}
+
+}
+
+ModelCache::ModelCache(const std::string &dir) :
+	m_cache(dir),
+	m_key_prefix(std::string(g_version_hash) + '\n')
+{
+}
+
+std::string ModelCache::getFileName(const std::string &filename,
+		const std::string &sha1) const
+{
+	// the extension picks the loader
+	std::string_view ext = filename;
+	const auto dot = ext.rfind('.');
+	ext = dot == std::string_view::npos ? "" : ext.substr(dot);
+	return hex_encode(hashing::sha1(m_key_prefix + lowercase(ext) + '\n' + sha1));
+}
+
+scene::IAnimatedMesh *ModelCache::load(const std::string &filename,
+		const std::string &sha1)
+{
+	std::ostringstream os(std::ios::binary);
+	if (!m_cache.load(getFileName(filename, sha1), os))
+		return nullptr;
+
+	const std::string file = os.str();
+	const size_t size = file.size();
+	std::istringstream is(file, std::ios::binary);
+	if (readU8(is) != FILE_VERSION ||
+			readU8(is) != sizeof(video::S3DVertex) ||
+			readU8(is) != sizeof(video::S3DVertex2TCoords) ||
+			readU8(is) != sizeof(video::S3DVertexTangents))
+		return nullptr;
+
+	const u8 format = readU8(is);
+	if (format > (u8)scene::SkinnedMesh::SourceFormat::OTHER)
+		return nullptr;
+	auto *mesh = new scene::SkinnedMeshBuilder(
+		static_cast<scene::SkinnedMesh::SourceFormat>(format));
+
+	try {
+		mesh->setAnimationSpeed(readF32(is));
+
+		const u32 buffer_count = readCount(is, size, 1);
+		for (u32 i = 0; i < buffer_count; i++) {
+			auto *buf = mesh->addMeshBuffer();
+			mesh->setTextureSlot(i, readU32(is));
+
+			const u8 vertex_type = readU8(is);
+			buf->PrimitiveType = static_cast<scene::E_PRIMITIVE_TYPE>(readU8(is));
+			buf->Transformation = readMatrix(is);
+
+			auto &material = buf->Material;
+			material.MaterialType = static_cast<video::E_MATERIAL_TYPE>(readU32(is));
+			material.ZWriteEnable = static_cast<video::E_ZWRITE>(readU8(is) & 3);
+			material.BackfaceCulling = readU8(is) != 0;
+			material.TextureLayers[0].TextureWrapU = readU8(is) & 0xf;
+			material.TextureLayers[0].TextureWrapV = readU8(is) & 0xf;
+
+			switch (vertex_type) {
+			case video::EVT_STANDARD:
+				readArray(is, size, buf->Vertices_Standard->Data);
+				break;
+			case video::EVT_2TCOORDS:
+				readArray(is, size, buf->Vertices_2TCoords->Data);
+				break;
+			case video::EVT_TANGENTS:
+				readArray(is, size, buf->Vertices_Tangents->Data);
+				break;
+			default:
+				throw SerializationError("unknown vertex type");
+			}
+			buf->VertexType = static_cast<video::E_VERTEX_TYPE>(vertex_type);
+
+			readArray(is, size, buf->Indices->Data);
+			const u32 vertex_count = buf->getVertexCount();
+			for (u16 index : buf->Indices->Data) {
+				if (index >= vertex_count)
+					throw SerializationError("index out of range");
+			}
+		}
+
+		auto &joints = mesh->getAllJoints();
+		const u32 joint_count = readCount(is, size, 1);
+		for (u32 i = 0; i < joint_count; i++) {
+			std::optional<std::string> name;
+			if (readU8(is))
+				name = deSerializeString16(is);
+
+			const u16 parent = readU16(is);
+			if (parent > i)
+				throw SerializationError("joints not sorted");
+			auto *joint = mesh->addJoint(parent ? joints[parent - 1] : nullptr);
+			joint->Name = std::move(name);
+
+			if (readU8(is) == 0) {
+				core::Transform transform;
+				transform.translation = readV3F32(is);
+				transform.rotation = readQuaternion(is);
+				transform.scale = readV3F32(is);
+				joint->transform = transform;
+			} else {
+				joint->transform = readMatrix(is);
+			}
+			if (readU8(is))
+				joint->GlobalInversedMatrix = readMatrix(is);
+
+			const u32 attached_count = readCount(is, size, sizeof(u32));
+			for (u32 j = 0; j < attached_count; j++) {
+				const u32 buffer = readU32(is);
+				if (buffer >= buffer_count)
+					throw SerializationError("buffer out of range");
+				joint->AttachedMeshes.push_back(buffer);
+			}
+
+			readChannel(is, size, joint->keys.position);
+			readChannel(is, size, joint->keys.rotation);
+			readChannel(is, size, joint->keys.scale);
+
+			const u32 weight_count = readCount(is, size, 10);
+			joint->Weights.resize(weight_count);
+			for (auto &weight : joint->Weights) {
+				weight.buffer_id = readU16(is);
+				weight.vertex_id = readU32(is);
+				weight.strength = readF32(is);
+				if (weight.buffer_id >= buffer_count || weight.vertex_id >=
+						mesh->getMeshBuffer(weight.buffer_id)->getVertexCount())
+					throw SerializationError("weight out of range");
+			}
+		}
+
+		// partially written
+		if (!is)
+			throw SerializationError("unexpected end of file");
+	} catch (SerializationError &e) {
+		infostream << "ModelCache: ignoring broken model for \""
+			<< filename << "\": " << e.what() << std::endl;
+		mesh->drop();
+		return nullptr;
+	}
+
+	return mesh->finalize();
+}
+
+void ModelCache::store(const std::string &filename, const std::string &sha1,
+		scene::IAnimatedMesh *mesh)
+{
+	if (mesh->getMeshType() != scene::EAMT_SKINNED)
+		return;
+	auto *skinned = static_cast<scene::SkinnedMesh *>(mesh);
+
+	std::ostringstream os(std::ios::binary);
+	try {
+		writeU8(os, FILE_VERSION);
+		writeU8(os, sizeof(video::S3DVertex));
+		writeU8(os, sizeof(video::S3DVertex2TCoords));
+		writeU8(os, sizeof(video::S3DVertexTangents));
+		writeU8(os, (u8)skinned->getSourceFormat());
+		writeF32(os, skinned->getAnimationSpeed());
+
+		const u32 buffer_count = skinned->getMeshBufferCount();
+		writeU32(os, buffer_count);
+		for (u32 i = 0; i < buffer_count; i++) {
+			const auto *buf = static_cast<scene::SSkinMeshBuffer *>(
+				skinned->getMeshBuffer(i));
+			writeU32(os, skinned->getTextureSlot(i));
+			writeU8(os, buf->VertexType);
+			writeU8(os, buf->PrimitiveType);
+			writeMatrix(os, buf->Transformation);
+
+			const auto &material = buf->Material;
+			writeU32(os, material.MaterialType);
+			writeU8(os, material.ZWriteEnable);
+			writeU8(os, material.BackfaceCulling);
+			writeU8(os, material.TextureLayers[0].TextureWrapU);
+			writeU8(os, material.TextureLayers[0].TextureWrapV);
+
+			switch (buf->VertexType) {
+			case video::EVT_STANDARD:
+				writeArray(os, buf->Vertices_Standard->Data);
+				break;
+			case video::EVT_2TCOORDS:
+				writeArray(os, buf->Vertices_2TCoords->Data);
+				break;
+			case video::EVT_TANGENTS:
+				writeArray(os, buf->Vertices_Tangents->Data);
+				break;
+			default:
+				return;
+			}
+			writeArray(os, buf->Indices->Data);
+		}
+
+		const auto &joints = skinned->getAllJoints();
+		writeU32(os, joints.size());
+		for (const auto *joint : joints) {
+			writeU8(os, joint->Name.has_value());
+			if (joint->Name)
+				os << serializeString16(*joint->Name);
+			writeU16(os, joint->ParentJointID ? *joint->ParentJointID + 1 : 0);
+
+			if (const auto *transform = std::get_if<core::Transform>(&joint->transform)) {
+				writeU8(os, 0);
+				writeV3F32(os, transform->translation);
+				writeQuaternion(os, transform->rotation);
+				writeV3F32(os, transform->scale);
+			} else {
+				writeU8(os, 1);
+				writeMatrix(os, std::get<core::matrix4>(joint->transform));
+			}
+			writeU8(os, joint->GlobalInversedMatrix.has_value());
+			if (joint->GlobalInversedMatrix)
+				writeMatrix(os, *joint->GlobalInversedMatrix);
+
+			writeU32(os, joint->AttachedMeshes.size());
+			for (u32 buffer : joint->AttachedMeshes)
+				writeU32(os, buffer);
+
+			writeChannel(os, joint->keys.position);
+			writeChannel(os, joint->keys.rotation);
+			writeChannel(os, joint->keys.scale);
+
+			writeU32(os, joint->Weights.size());
+			for (const auto &weight : joint->Weights) {
+				writeU16(os, weight.buffer_id);
+				writeU32(os, weight.vertex_id);
+				writeF32(os, weight.strength);
+			}
+		}
+	} catch (SerializationError &e) {
+		// e.g. a joint name that is too long
+		infostream << "ModelCache: can't store model \"" << filename
+			<< "\": " << e.what() << std::endl;
+		return;
+	}
+
+	if (!m_cache.update(getFileName(filename, sha1), os.str())) {
+		warningstream << "ModelCache: could not store model \""
+			<< filename << "\"" << std::endl;
+	}
+}
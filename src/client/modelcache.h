@@ -0,0 +1,42 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include "filecache.h"
+#include <string>
+
+namespace scene {
+	class IAnimatedMesh;
+}
+
+/*
+	Keeps skinned models (.b3d, .gltf, .glb, .x) on disk in the form that
+	they are used in, so that joining a server again doesn't have to parse
+	them and build their skeleton again.
+
+	A model is found by the SHA-1 of its file, which is already known from
+	the media announcement, its file extension and the engine version, so
+	the cache can be shared by all servers.
+*/
+class ModelCache
+{
+public:
+	ModelCache(const std::string &dir);
+
+	// Returns nullptr if the model isn't stored
+	// The returned mesh should be dropped.
+	scene::IAnimatedMesh *load(const std::string &filename, const std::string &sha1);
+
+	// The mesh must not have been animated yet.
+	// Does nothing for meshes that aren't skinned.
+	void store(const std::string &filename, const std::string &sha1,
+		scene::IAnimatedMesh *mesh);
+
+private:
+	std::string getFileName(const std::string &filename, const std::string &sha1) const;
+
+	FileCache m_cache;
+	std::string m_key_prefix;
+};
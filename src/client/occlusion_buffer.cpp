@@ -0,0 +1,174 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "occlusion_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "constants.h"
+
+// Closest depth that is projected, to keep away from the singularity
+static constexpr f32 NEAR_DEPTH = 0.1f * BS;
+static constexpr f32 FAR_DEPTH = std::numeric_limits<f32>::max();
+
+OcclusionBuffer::OcclusionBuffer() :
+	m_depth(SIZE * SIZE, FAR_DEPTH)
+{
+	m_tile_max.fill(FAR_DEPTH);
+}
+
+void OcclusionBuffer::reset(v3f camera_pos, v3f camera_dir, f32 half_angle)
+{
+	m_camera_pos = camera_pos;
+	m_forward = camera_dir;
+	m_forward.normalize();
+	v3f up = std::fabs(m_forward.Y) < 0.99f ? v3f(0, 1, 0) : v3f(0, 0, 1);
+	m_right = up.crossProduct(m_forward).normalize();
+	m_up = m_forward.crossProduct(m_right);
+	half_angle = std::min(half_angle, 1.4f);
+	m_scale = SIZE / 2 / std::tan(half_angle);
+
+	if (m_has_occluders) {
+		std::fill(m_depth.begin(), m_depth.end(), FAR_DEPTH);
+		m_tile_max.fill(FAR_DEPTH);
+		m_has_occluders = false;
+	}
+}
+
+bool OcclusionBuffer::project(v3f pos, v2f &screen, f32 &depth) const
+{
+	v3f d = pos - m_camera_pos;
+	depth = d.dotProduct(m_forward);
+	if (depth < NEAR_DEPTH)
+		return false;
+	f32 scale = m_scale / depth;
+	screen.X = d.dotProduct(m_right) * scale + SIZE / 2;
+	screen.Y = d.dotProduct(m_up) * scale + SIZE / 2;
+	return true;
+}
+
+void OcclusionBuffer::addOccluder(const v3f (&corners)[4])
+{
+	v2f p[4];
+	f32 max_depth = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		f32 depth;
+		if (!project(corners[i], p[i], depth))
+			return;
+		max_depth = std::max(max_depth, depth);
+	}
+
+	f32 area = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		const v2f &a = p[i], &b = p[(i + 1) % 4];
+		area += a.X * b.Y - b.X * a.Y;
+	}
+	// smaller than a pixel, or seen from the side
+	if (std::fabs(area) < 2.0f)
+		return;
+	const f32 sign = area > 0.0f ? 1.0f : -1.0f;
+
+	// Edge functions, positive inside. Each one is evaluated at the corner of
+	// a pixel that is farthest inside, so that it holds for the whole pixel.
+	f32 ea[4], eb[4], ec[4];
+	for (int i = 0; i < 4; i++) {
+		const v2f &a = p[i], &b = p[(i + 1) % 4];
+		ea[i] = sign * (a.Y - b.Y);
+		eb[i] = sign * (b.X - a.X);
+		ec[i] = sign * (a.X * b.Y - b.X * a.Y)
+			+ std::min(ea[i], 0.0f) + std::min(eb[i], 0.0f);
+	}
+
+	f32 min_x = p[0].X, max_x = p[0].X, min_y = p[0].Y, max_y = p[0].Y;
+	for (int i = 1; i < 4; i++) {
+		min_x = std::min(min_x, p[i].X);
+		max_x = std::max(max_x, p[i].X);
+		min_y = std::min(min_y, p[i].Y);
+		max_y = std::max(max_y, p[i].Y);
+	}
+	const s32 x0 = std::max<s32>(std::floor(min_x), 0);
+	const s32 x1 = std::min<s32>(std::ceil(max_x), SIZE);
+	const s32 y0 = std::max<s32>(std::floor(min_y), 0);
+	const s32 y1 = std::min<s32>(std::ceil(max_y), SIZE);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	bool written = false;
+	for (s32 y = y0; y < y1; y++)
+	for (s32 x = x0; x < x1; x++) {
+		bool inside = true;
+		for (int i = 0; i < 4 && inside; i++)
+			inside = ea[i] * x + eb[i] * y + ec[i] >= 0.0f;
+		if (!inside)
+			continue;
+		f32 &depth = m_depth[y * SIZE + x];
+		if (max_depth < depth) {
+			depth = max_depth;
+			written = true;
+		}
+	}
+
+	if (written) {
+		m_has_occluders = true;
+		updateTileMax(x0, y0, x1, y1);
+	}
+}
+
+void OcclusionBuffer::updateTileMax(s32 x0, s32 y0, s32 x1, s32 y1)
+{
+	for (s32 ty = y0 / TILE_SIZE; ty <= (y1 - 1) / (s32)TILE_SIZE; ty++)
+	for (s32 tx = x0 / TILE_SIZE; tx <= (x1 - 1) / (s32)TILE_SIZE; tx++) {
+		f32 max_depth = 0.0f;
+		for (u32 y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; y++)
+		for (u32 x = tx * TILE_SIZE; x < (tx + 1) * TILE_SIZE; x++)
+			max_depth = std::max(max_depth, m_depth[y * SIZE + x]);
+		m_tile_max[ty * TILES + tx] = max_depth;
+	}
+}
+
+bool OcclusionBuffer::isOccluded(const aabb3f &box) const
+{
+	if (!m_has_occluders)
+		return false;
+
+	f32 min_depth = FAR_DEPTH;
+	v2f min(FAR_DEPTH, FAR_DEPTH), max(-FAR_DEPTH, -FAR_DEPTH);
+	for (int i = 0; i < 8; i++) {
+		v3f corner(
+			(i & 1) ? box.MaxEdge.X : box.MinEdge.X,
+			(i & 2) ? box.MaxEdge.Y : box.MinEdge.Y,
+			(i & 4) ? box.MaxEdge.Z : box.MinEdge.Z);
+		v2f screen;
+		f32 depth;
+		if (!project(corner, screen, depth))
+			return false;
+		min_depth = std::min(min_depth, depth);
+		min.X = std::min(min.X, screen.X);
+		min.Y = std::min(min.Y, screen.Y);
+		max.X = std::max(max.X, screen.X);
+		max.Y = std::max(max.Y, screen.Y);
+	}
+	// may get into view when the camera turns
+	if (min.X < 0 || min.Y < 0 || max.X >= SIZE || max.Y >= SIZE)
+		return false;
+
+	// the pixels that the box may touch, inclusive
+	const s32 x0 = min.X, y0 = min.Y;
+	const s32 x1 = max.X, y1 = max.Y;
+	for (s32 ty = y0 / TILE_SIZE; ty <= y1 / (s32)TILE_SIZE; ty++)
+	for (s32 tx = x0 / TILE_SIZE; tx <= x1 / (s32)TILE_SIZE; tx++) {
+		if (m_tile_max[ty * TILES + tx] < min_depth)
+			continue;
+		const s32 ty0 = std::max<s32>(y0, ty * TILE_SIZE);
+		const s32 ty1 = std::min<s32>(y1, (ty + 1) * TILE_SIZE - 1);
+		const s32 tx0 = std::max<s32>(x0, tx * TILE_SIZE);
+		const s32 tx1 = std::min<s32>(x1, (tx + 1) * TILE_SIZE - 1);
+		for (s32 y = ty0; y <= ty1; y++)
+		for (s32 x = tx0; x <= tx1; x++) {
+			if (m_depth[y * SIZE + x] >= min_depth)
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_aabb3d.h"
+#include "irr_v2d.h"
+#include "irr_v3d.h"
+
+/*
+	A small software depth buffer, to find map blocks that are hidden behind
+	opaque block sides.
+
+	Occluders are rasterized conservatively: only pixels that they cover
+	entirely are written, with their farthest depth. A box is occluded if its
+	nearest point is behind the buffer at every pixel that it may cover.
+	So it never hides anything that is visible from the camera position,
+	in whatever order occluders and boxes come in.
+
+	The buffer keeps the maximum depth of each tile of pixels, so that the
+	test of a box mostly doesn't have to look at single pixels.
+*/
+class OcclusionBuffer
+{
+public:
+	static constexpr u32 SIZE = 128;
+	static constexpr u32 TILE_SIZE = 8;
+
+	OcclusionBuffer();
+
+	/**
+	 * Clears the buffer and sets up the view, which is square.
+	 * Boxes that reach outside of it are never occluded.
+	 * @param half_angle half of the view angle, in radians
+	 */
+	void reset(v3f camera_pos, v3f camera_dir, f32 half_angle);
+
+	// Adds an opaque convex quad, its corners in order around it
+	void addOccluder(const v3f (&corners)[4]);
+
+	// Returns true if the box is certainly hidden behind the occluders
+	bool isOccluded(const aabb3f &box) const;
+
+	bool hasOccluders() const { return m_has_occluders; }
+
+private:
+	static constexpr u32 TILES = SIZE / TILE_SIZE;
+
+	// false if the point is too close or behind the camera
+	bool project(v3f pos, v2f &screen, f32 &depth) const;
+	void updateTileMax(s32 x0, s32 y0, s32 x1, s32 y1);
+
+	v3f m_camera_pos;
+	v3f m_forward, m_right, m_up;
+	// pixels per unit of tangent
+	f32 m_scale = 1.0f;
+	bool m_has_occluders = false;
+
+	std::vector<f32> m_depth;
+	std::array<f32, TILES * TILES> m_tile_max;
+};
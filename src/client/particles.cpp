@@ -33,6 +33,57 @@ ClientParticleTexture::ClientParticleTexture(const ServerParticleTexture& p, ITe
 	ref = tsrc->getTexture(p.string);
 }
 
+/*
+	ParticleMotion
+*/
+
+void ParticleMotion::push(v3f p, v3f v, v3f a, v3f d)
+{
+	const v3f values[4] = {p, v, a, d};
+	std::vector<f32> *arrays[4] = {pos, vel, acc, drag};
+	for (int i = 0; i < 4; i++) {
+		arrays[i][0].push_back(values[i].X);
+		arrays[i][1].push_back(values[i].Y);
+		arrays[i][2].push_back(values[i].Z);
+	}
+}
+
+void ParticleMotion::swapRemove(size_t i)
+{
+	for (auto *arrays : {pos, vel, acc, drag}) {
+		for (int c = 0; c < 3; c++) {
+			arrays[c][i] = arrays[c].back();
+			arrays[c].pop_back();
+		}
+	}
+}
+
+void ParticleMotion::clear()
+{
+	for (auto *arrays : {pos, vel, acc, drag}) {
+		for (int c = 0; c < 3; c++)
+			arrays[c].clear();
+	}
+}
+
+void ParticleMotion::integrate(f32 dtime)
+{
+	const size_t n = size();
+	for (int c = 0; c < 3; c++) {
+		f32 *__restrict p = pos[c].data();
+		f32 *__restrict v = vel[c].data();
+		const f32 *__restrict a = acc[c].data();
+		const f32 *__restrict d = drag[c].data();
+		// same as the drag in Particle::step(), which keeps the sign
+		for (size_t i = 0; i < n; i++)
+			v[i] -= v[i] * (d[i] * dtime);
+		for (size_t i = 0; i < n; i++) {
+			p[i] += (v[i] + a[i] * 0.5f * dtime) * dtime;
+			v[i] += a[i] * dtime;
+		}
+	}
+}
+
 /*
 	Particle
 */
@@ -80,16 +131,25 @@ bool Particle::attachToBuffer(ParticleBuffer *buffer)
 	return false;
 }
 
+bool Particle::isBatchable() const
+{
+	return !m_p.collisiondetection &&
+		m_p.jitter.min.val == v3f() && m_p.jitter.max.val == v3f();
+}
+
 void Particle::step(float dtime, ClientEnvironment *env)
 {
-	m_time += dtime;
+	static thread_local const bool cheap_collision =
+			g_settings->getBool("cheap_particle_collision");
 
 	// apply drag (not handled by collisionMoveSimple) and brownian motion
 	v3f av = vecAbsolute(m_velocity);
 	av -= av * (m_p.drag * dtime);
 	m_velocity = av*vecSign(m_velocity) + v3f(m_p.jitter.pickWithin())*dtime;
 
-	if (m_p.collisiondetection) {
+	if (m_p.collisiondetection && cheap_collision) {
+		cheapCollisionMove(dtime, env, m_p.bounce.pickWithin());
+	} else if (m_p.collisiondetection) {
 		aabb3f box(v3f(-m_p.size / 2.0f), v3f(m_p.size / 2.0f));
 		v3f p_pos = m_pos * BS;
 		v3f p_velocity = m_velocity * BS;
@@ -132,6 +192,55 @@ void Particle::step(float dtime, ClientEnvironment *env)
 		m_velocity += m_acceleration * dtime;
 	}
 
+	updateVisuals(dtime, env, m_pos);
+}
+
+void Particle::stepBatched(float dtime, ClientEnvironment *env, v3f pos)
+{
+	updateVisuals(dtime, env, pos);
+}
+
+void Particle::cheapCollisionMove(float dtime, ClientEnvironment *env,
+	f32 bounciness)
+{
+	const NodeDefManager *ndef = env->getGameDef()->ndef();
+	Map &map = env->getClientMap();
+	const f32 half = m_p.size / BS / 2.0f;
+
+	const v3f move = (m_velocity + m_acceleration * 0.5f * dtime) * dtime;
+	m_velocity += m_acceleration * dtime;
+
+	// Moves along one axis after the other, and stops at the first
+	// walkable node that the side in front of the particle gets into.
+	bool collides = false;
+	f32 *pos[3] = {&m_pos.X, &m_pos.Y, &m_pos.Z};
+	f32 *vel[3] = {&m_velocity.X, &m_velocity.Y, &m_velocity.Z};
+	const f32 delta[3] = {move.X, move.Y, move.Z};
+	for (int i = 0; i < 3; i++) {
+		if (delta[i] == 0.0f)
+			continue;
+		v3f front = m_pos;
+		f32 *front_c[3] = {&front.X, &front.Y, &front.Z};
+		*front_c[i] += delta[i] + (delta[i] > 0.0f ? half : -half);
+
+		bool pos_ok;
+		MapNode n = map.getNode(floatToInt(front, 1.0f), &pos_ok);
+		if (pos_ok && ndef->get(n).walkable) {
+			collides = true;
+			*vel[i] = -*vel[i] * bounciness;
+		} else {
+			*pos[i] += delta[i];
+		}
+	}
+
+	if (collides && m_p.collision_removal)
+		m_expiration = -1.0f;
+}
+
+void Particle::updateVisuals(float dtime, ClientEnvironment *env, v3f pos)
+{
+	m_time += dtime;
+
 	if (m_p.animation.type != TAT_NONE) {
 		m_animation_time += dtime;
 		int frame_length_i = 0;
@@ -151,22 +260,22 @@ void Particle::step(float dtime, ClientEnvironment *env)
 		alpha = m_texture.tex -> alpha.blend(m_time / (m_expiration+0.1f));
 
 	// Update lighting
-	auto col = updateLight(env);
+	auto col = updateLight(env, pos);
 	col.setAlpha(255 * alpha);
 
 	// Update model
-	updateVertices(env, col);
+	updateVertices(env, col, pos);
 }
 
-video::SColor Particle::updateLight(ClientEnvironment *env)
+video::SColor Particle::updateLight(ClientEnvironment *env, v3f pos)
 {
 	u8 light = 0;
 	bool pos_ok;
 
 	v3s16 p = v3s16(
-		floor(m_pos.X+0.5),
-		floor(m_pos.Y+0.5),
-		floor(m_pos.Z+0.5)
+		floor(pos.X+0.5),
+		floor(pos.Y+0.5),
+		floor(pos.Z+0.5)
 	);
 	MapNode n = env->getClientMap().getNode(p, &pos_ok);
 	if (pos_ok)
@@ -182,7 +291,7 @@ video::SColor Particle::updateLight(ClientEnvironment *env)
 		m_light * m_base_color.getBlue() / 255);
 }
 
-void Particle::updateVertices(ClientEnvironment *env, video::SColor color)
+void Particle::updateVertices(ClientEnvironment *env, video::SColor color, v3f pos)
 {
 	f32 tx0, tx1, ty0, ty1;
 	v2f scale;
@@ -236,13 +345,13 @@ void Particle::updateVertices(ClientEnvironment *env, video::SColor color)
 		video::S3DVertex &vertex = vertices[i];
 		if (m_p.vertical) {
 			v3f ppos = player->getPosition() / BS;
-			vertex.Pos.rotateXZBy(std::atan2(ppos.Z - m_pos.Z, ppos.X - m_pos.X) /
+			vertex.Pos.rotateXZBy(std::atan2(ppos.Z - pos.Z, ppos.X - pos.X) /
 				core::DEGTORAD + 90);
 		} else {
 			vertex.Pos.rotateYZBy(player->getPitch());
 			vertex.Pos.rotateXZBy(player->getYaw());
 		}
-		vertex.Pos += m_pos * BS - intToFloat(camera_offset, BS);
+		vertex.Pos += pos * BS - intToFloat(camera_offset, BS);
 	}
 }
 
@@ -496,7 +605,7 @@ void ParticleSpawner::spawnParticle(ClientEnvironment *env, float radius,
 		));
 }
 
-void ParticleSpawner::step(float dtime, ClientEnvironment *env)
+void ParticleSpawner::step(float dtime, ClientEnvironment *env, f32 budget)
 {
 	m_time += dtime;
 
@@ -520,8 +629,9 @@ void ParticleSpawner::step(float dtime, ClientEnvironment *env)
 				--p.amount;
 
 				// Pretend to, but don't actually spawn a particle if it is
-				// attached to an unloaded object or distant from player.
-				if (!unloaded)
+				// attached to an unloaded object, distant from player or
+				// over the budget.
+				if (!unloaded && (budget >= 1.0f || myrand_float() < budget))
 					spawnParticle(env, radius, attached_absolute_pos_rot_matrix);
 
 				i = m_spawntimes.erase(i);
@@ -537,7 +647,7 @@ void ParticleSpawner::step(float dtime, ClientEnvironment *env)
 			return;
 
 		for (int i = 0; i <= p.amount; i++) {
-			if (myrand_float() < dtime)
+			if (myrand_float() < dtime * budget)
 				spawnParticle(env, radius, attached_absolute_pos_rot_matrix);
 		}
 	}
@@ -671,6 +781,9 @@ ParticleManager::~ParticleManager()
 
 void ParticleManager::step(float dtime)
 {
+	// smoothed, so that single slow frames don't cut the spawners
+	m_avg_dtime = m_avg_dtime == 0.0f ? dtime : m_avg_dtime * 0.9f + dtime * 0.1f;
+
 	stepParticles(dtime);
 	stepSpawners(dtime);
 	stepBuffers(dtime);
@@ -678,6 +791,13 @@ void ParticleManager::step(float dtime)
 
 void ParticleManager::stepSpawners(float dtime)
 {
+	// Spawners get all of their particles down to 30 FPS, less below,
+	// so that large ones don't slow down a frame rate that is already low.
+	constexpr f32 BUDGET_DTIME = 1.0f / 30.0f;
+	const f32 budget = core::clamp(BUDGET_DTIME / std::max(m_avg_dtime, 1e-3f),
+		0.1f, 1.0f);
+	g_profiler->avg("ParticleManager: spawner budget [%]", budget * 100.0f);
+
 	MutexAutoLock lock(m_spawner_list_lock);
 
 	for (size_t i = 0; i < m_dying_particle_spawners.size();) {
@@ -699,12 +819,21 @@ void ParticleManager::stepSpawners(float dtime)
 				m_dying_particle_spawners.push_back(std::move(ps));
 			it = m_particle_spawners.erase(it);
 		} else {
-			ps->step(dtime, m_env);
+			ps->step(dtime, m_env, budget);
 			++it;
 		}
 	}
 }
 
+static void release_from_parent(Particle &p)
+{
+	ParticleSpawner *parent = p.getParent();
+	if (parent) {
+		assert(parent->hasActive());
+		parent->decrActive();
+	}
+}
+
 void ParticleManager::stepParticles(float dtime)
 {
 	MutexAutoLock lock(m_particle_list_lock);
@@ -712,11 +841,7 @@ void ParticleManager::stepParticles(float dtime)
 	for (size_t i = 0; i < m_particles.size();) {
 		Particle &p = *m_particles[i];
 		if (p.isExpired()) {
-			ParticleSpawner *parent = p.getParent();
-			if (parent) {
-				assert(parent->hasActive());
-				parent->decrActive();
-			}
+			release_from_parent(p);
 			// delete
 			m_particles[i] = std::move(m_particles.back());
 			m_particles.pop_back();
@@ -725,6 +850,27 @@ void ParticleManager::stepParticles(float dtime)
 			++i;
 		}
 	}
+
+	// Expired ones are removed before they are moved, so that both lists
+	// stay parallel
+	for (size_t i = 0; i < m_batched_particles.size();) {
+		if (m_batched_particles[i]->isExpired()) {
+			release_from_parent(*m_batched_particles[i]);
+			m_batched_particles[i] = std::move(m_batched_particles.back());
+			m_batched_particles.pop_back();
+			m_batched_motion.swapRemove(i);
+		} else {
+			++i;
+		}
+	}
+	assert(m_batched_particles.size() == m_batched_motion.size());
+
+	m_batched_motion.integrate(dtime);
+	for (size_t i = 0; i < m_batched_particles.size(); i++)
+		m_batched_particles[i]->stepBatched(dtime, m_env, m_batched_motion.getPos(i));
+
+	g_profiler->avg("ParticleManager: batched particles [#]",
+		m_batched_particles.size());
 }
 
 void ParticleManager::stepBuffers(float dtime)
@@ -765,6 +911,8 @@ void ParticleManager::clearAll()
 	m_dying_particle_spawners.clear();
 
 	m_particles.clear();
+	m_batched_particles.clear();
+	m_batched_motion.clear();
 
 	// have to remove from scene first because it keeps a reference
 	for (auto &it : m_particle_buffers)
@@ -956,6 +1104,7 @@ void ParticleManager::reserveParticleSpace(size_t max_estimate)
 	MutexAutoLock lock(m_particle_list_lock);
 
 	m_particles.reserve(m_particles.size() + max_estimate);
+	m_batched_particles.reserve(m_batched_particles.size() + max_estimate);
 }
 
 static void setBlendMode(video::SMaterial &material, BlendMode blendmode)
@@ -1032,10 +1181,12 @@ bool ParticleManager::addParticle(std::unique_ptr<Particle> toadd)
 
 	auto material = getMaterialForParticle(toadd.get());
 
+	auto &particles = toadd->isBatchable() ? m_batched_particles : m_particles;
+
 	ParticleBuffer *found = nullptr;
 	// simple shortcut when multiple particles of the same type get added
-	if (!m_particles.empty()) {
-		auto &last = m_particles.back();
+	if (!particles.empty()) {
+		auto &last = particles.back();
 		if (last->getBuffer() && last->getBuffer()->getMaterial(0) == material)
 			found = last->getBuffer();
 	}
@@ -1059,7 +1210,11 @@ bool ParticleManager::addParticle(std::unique_ptr<Particle> toadd)
 		infostream << "ParticleManager: buffer full, dropping particle" << std::endl;
 		return false;
 	}
-	m_particles.push_back(std::move(toadd));
+	if (toadd->isBatchable()) {
+		m_batched_motion.push(toadd->getPos(), toadd->getVelocity(),
+			toadd->getAcceleration(), toadd->getDrag());
+	}
+	particles.push_back(std::move(toadd));
 	return true;
 }
 
@@ -61,6 +61,28 @@ struct ClientParticleTexRef
 class ParticleSpawner;
 class ParticleBuffer;
 
+/**
+ * Motion of the particles that neither collide nor jitter, as a structure of
+ * arrays, so that all of them are moved with a few loops that the compiler can
+ * vectorize. The particles keep their index, see ParticleManager.
+ */
+struct ParticleMotion
+{
+	std::vector<f32> pos[3], vel[3], acc[3], drag[3];
+
+	size_t size() const { return pos[0].size(); }
+
+	void push(v3f p, v3f v, v3f a, v3f d);
+	/// Moves the last particle to `i`
+	void swapRemove(size_t i);
+	void clear();
+
+	v3f getPos(size_t i) const { return v3f(pos[0][i], pos[1][i], pos[2][i]); }
+
+	/// Applies drag, velocity and acceleration, like Particle::step()
+	void integrate(f32 dtime);
+};
+
 class Particle
 {
 public:
@@ -79,6 +101,16 @@ class Particle
 	DISABLE_CLASS_COPY(Particle)
 
 	void step(float dtime, ClientEnvironment *env);
+	/// Like step(), with the position moved by ParticleMotion
+	void stepBatched(float dtime, ClientEnvironment *env, v3f pos);
+
+	/// @return true if the motion is independent of the map and of chance
+	bool isBatchable() const;
+
+	v3f getPos() const { return m_pos; }
+	v3f getVelocity() const { return m_velocity; }
+	v3f getAcceleration() const { return m_acceleration; }
+	v3f getDrag() const { return m_p.drag; }
 
 	bool isExpired () const
 	{ return m_expiration < m_time; }
@@ -94,8 +126,12 @@ class Particle
 	bool attachToBuffer(ParticleBuffer *buffer);
 
 private:
-	video::SColor updateLight(ClientEnvironment *env);
-	void updateVertices(ClientEnvironment *env, video::SColor color);
+	// Moves the particle through the map like a full node collision box would
+	void cheapCollisionMove(float dtime, ClientEnvironment *env, f32 bounciness);
+	// animation, lighting and vertices, everything but the motion
+	void updateVisuals(float dtime, ClientEnvironment *env, v3f pos);
+	video::SColor updateLight(ClientEnvironment *env, v3f pos);
+	void updateVertices(ClientEnvironment *env, video::SColor color, v3f pos);
 
 	ParticleBuffer *m_buffer = nullptr;
 	u16 m_index; // index in m_buffer
@@ -109,6 +145,7 @@ class Particle
 	ClientParticleTexRef m_texture;
 	v2f m_texpos;
 	v2f m_texsize;
+	// initial values only, if the particle is batched
 	v3f m_pos;
 	v3f m_velocity;
 	v3f m_acceleration;
@@ -132,7 +169,8 @@ class ParticleSpawner
 		std::vector<ClientParticleTexture> &&texpool,
 		ParticleManager *p_manager);
 
-	void step(float dtime, ClientEnvironment *env);
+	/// @param budget share of the particles that are actually spawned
+	void step(float dtime, ClientEnvironment *env, f32 budget);
 
 	bool getExpired() const
 	{ return p.amount <= 0 && p.time != 0; }
@@ -258,7 +296,11 @@ class ParticleManager
 
 	void clearAll();
 
+	// Particles that move by themselves
 	std::vector<std::unique_ptr<Particle>> m_particles;
+	// Batchable particles, their motion at the same index
+	std::vector<std::unique_ptr<Particle>> m_batched_particles;
+	ParticleMotion m_batched_motion;
 	std::unordered_map<u64, std::unique_ptr<ParticleSpawner>> m_particle_spawners;
 	std::vector<std::unique_ptr<ParticleSpawner>> m_dying_particle_spawners;
 	std::vector<irr_ptr<ParticleBuffer>> m_particle_buffers;
@@ -271,6 +313,9 @@ class ParticleManager
 
 	IntervalLimiter m_buffer_gc;
 
+	// Smoothed frame time, spawners get a smaller budget when it is too long
+	f32 m_avg_dtime = 0.0f;
+
 	std::mutex m_particle_list_lock;
 	std::mutex m_spawner_list_lock;
 };
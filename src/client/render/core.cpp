@@ -22,7 +22,7 @@ RenderingCore::~RenderingCore()
 }
 
 void RenderingCore::draw(video::SColor _skycolor, bool _show_hud,
-		bool _draw_wield_tool, bool _draw_crosshair)
+		bool _draw_wield_tool, bool _draw_crosshair, f32 _frame_busy_ms)
 {
 	v2u32 screensize = device->getVideoDriver()->getScreenSize();
 	virtual_size = v2u32(screensize.X * virtual_size_scale.X, screensize.Y * virtual_size_scale.Y);
@@ -31,6 +31,7 @@ void RenderingCore::draw(video::SColor _skycolor, bool _show_hud,
 	context.draw_crosshair = _draw_crosshair;
 	context.draw_wield_tool = _draw_wield_tool;
 	context.show_hud = _show_hud;
+	context.frame_busy_ms = _frame_busy_ms;
 
 	pipeline->reset(context);
 	pipeline->run(context);
@@ -43,7 +43,7 @@ class RenderingCore
 	RenderingCore &operator=(RenderingCore &&) = delete;
 
 	void draw(video::SColor _skycolor, bool _show_hud,
-			bool _draw_wield_tool, bool _draw_crosshair);
+			bool _draw_wield_tool, bool _draw_crosshair, f32 _frame_busy_ms);
 
 	v2u32 getVirtualSize() const;
 
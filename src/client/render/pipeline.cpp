@@ -4,6 +4,7 @@
 
 #include "pipeline.h"
 #include "client/client.h"
+#include "client/frametimings.h"
 #include "client/hud.h"
 #include "IRenderTarget.h"
 #include "SColor.h"
@@ -287,8 +288,16 @@ void RenderPipeline::run(PipelineContext &context)
 	for (auto &object : m_objects)
 		object->reset(context);
 
-	for (auto &step: m_pipeline)
+	for (auto &step: m_pipeline) {
+		const char *timing_name = g_frame_timings ? step->getTimingName() : nullptr;
+		if (!timing_name) {
+			step->run(context);
+			continue;
+		}
+		size_t timing = g_frame_timings->beginStep(timing_name);
 		step->run(context);
+		g_frame_timings->endStep(timing);
+	}
 
 	context.target_size = original_size;
 }
@@ -40,6 +40,8 @@ struct PipelineContext
 	bool show_hud {true};
 	bool draw_wield_tool {true};
 	bool draw_crosshair {true};
+	// moving average of the frame time without the FPS limit, 0 if unknown
+	f32 frame_busy_ms {0.0f};
 };
 
 /**
@@ -301,6 +303,12 @@ class RenderStep : virtual public RenderPipelineObject
 	 * Runs the step. This method is invoked by the pipeline.
 	 */
 	virtual void run(PipelineContext &context) = 0;
+
+	/**
+	 * Name of the stage in the frame timings, or nullptr to not time the step
+	 * (the steps of a nested pipeline are still timed).
+	 */
+	virtual const char *getTimingName() const { return nullptr; }
 };
 
 /**
@@ -12,6 +12,7 @@
 #include "client/minimap.h"
 #include "client/shadows/dynamicshadowsrender.h"
 #include <IGUIEnvironment.h>
+#include <cmath>
 
 /// Draw3D pipeline step
 void Draw3D::run(PipelineContext &context)
@@ -85,11 +86,50 @@ void UpscaleStep::run(PipelineContext &context)
 			core::rect<s32>(0, 0, lowres->getSize().Width, lowres->getSize().Height));
 }
 
+// class DynamicResolutionStep
+
+DynamicResolutionStep::DynamicResolutionStep(RenderPipeline *stage) :
+	m_stage(stage)
+{
+	m_target_ms = 1000.0f / rangelim(g_settings->getU32("dynamic_resolution_target_fps"), 10, 1000);
+	m_min_scale = rangelim(g_settings->getFloat("dynamic_resolution_min_scale"), 0.25f, 1.0f);
+}
+
+void DynamicResolutionStep::run(PipelineContext &context)
+{
+	// Scales are multiples of this, so that the render targets are only
+	// recreated once in a while
+	constexpr f32 SCALE_STEP = 1.0f / 16;
+	constexpr u32 SETTLE_FRAMES = 30;
+
+	if (context.frame_busy_ms <= 0.0f || ++m_frames_unchanged < SETTLE_FRAMES)
+		return;
+
+	// The cost of the 3D stage grows with the pixel count, which is the
+	// square of the scale. Not all of the frame time depends on it, so only
+	// move a few steps at a time.
+	const f32 ratio = m_target_ms / context.frame_busy_ms;
+	f32 scale = m_scale * std::sqrt(ratio);
+	scale = rangelim(scale, m_scale - 2 * SCALE_STEP, m_scale + 2 * SCALE_STEP);
+	scale = rangelim(std::round(scale / SCALE_STEP) * SCALE_STEP, m_min_scale, 1.0f);
+
+	// Going up needs some headroom, or the scale would toggle back and forth
+	if ((scale < m_scale && ratio < 0.95f) || (scale > m_scale && ratio > 1.15f)) {
+		m_scale = scale;
+		m_stage->setScale(v2f(m_scale));
+		m_frames_unchanged = 0;
+	}
+}
+
 std::unique_ptr<RenderStep> create3DStage(Client *client, v2f scale)
 {
 	RenderStep *step = new Draw3D();
 	if (g_settings->getBool("enable_post_processing")) {
 		RenderPipeline *pipeline = new RenderPipeline();
+		// takes effect from the next frame, as the pipeline applies its scale
+		// before running the steps
+		if (g_settings->getBool("dynamic_resolution"))
+			pipeline->addStep<DynamicResolutionStep>(pipeline);
 		pipeline->addStep(pipeline->own(std::unique_ptr<RenderStep>(step)));
 
 		auto effect = addPostProcessing(pipeline, step, scale, client);
@@ -18,6 +18,7 @@ class Draw3D : public RenderStep
 
 	virtual void reset(PipelineContext &context) override {}
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "3D"; }
 
 private:
 	RenderTarget *m_target {nullptr};
@@ -31,6 +32,7 @@ class DrawWield : public RenderStep
 
 	virtual void reset(PipelineContext &context) override {}
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "Wield item"; }
 
 private:
 	RenderTarget *m_target {nullptr};
@@ -47,6 +49,7 @@ class DrawHUD : public RenderStep
 
 	virtual void reset(PipelineContext &context) override {}
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "HUD"; }
 };
 
 class MapPostFxStep : public TrivialRenderStep
@@ -54,6 +57,7 @@ class MapPostFxStep : public TrivialRenderStep
 public:
 	virtual void setRenderTarget(RenderTarget *) override;
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "Map post-fx"; }
 private:
 	RenderTarget *target;
 };
@@ -62,6 +66,7 @@ class RenderShadowMapStep : public TrivialRenderStep
 {
 public:
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "Shadow map"; }
 };
 
 /**
@@ -76,11 +81,32 @@ class UpscaleStep : public RenderStep
 	virtual void setRenderTarget(RenderTarget *target) override { m_target = target; }
 	virtual void reset(PipelineContext &context) override {};
 	virtual void run(PipelineContext &context) override;
+	virtual const char *getTimingName() const override { return "Upscale"; }
 private:
 	RenderSource *m_source;
 	RenderTarget *m_target;
 };
 
+/**
+ * Adjusts the scale of the 3D stage (a pipeline with post-processing)
+ * to the measured frame time, so that the target FPS is reached.
+ * The post-processing pass scales the result up to the screen.
+ */
+class DynamicResolutionStep : public TrivialRenderStep
+{
+public:
+	DynamicResolutionStep(RenderPipeline *stage);
+
+	virtual void run(PipelineContext &context) override;
+private:
+	RenderPipeline *m_stage;
+	f32 m_target_ms;
+	f32 m_min_scale;
+	f32 m_scale {1.0f};
+	// since the last change, as the frame time average needs time to follow
+	u32 m_frames_unchanged {0};
+};
+
 std::unique_ptr<RenderStep> create3DStage(Client *client, v2f scale);
 RenderStep* addUpscaling(RenderPipeline *pipeline, RenderStep *previousStep, v2f downscale_factor, Client *client);
 
@@ -115,6 +115,11 @@ RenderStep *addPostProcessing(RenderPipeline *pipeline, RenderStep *previousStep
 	const bool enable_volumetric_light = g_settings->getBool("enable_volumetric_lighting") && enable_bloom;
 	const bool enable_auto_exposure = g_settings->getBool("enable_auto_exposure");
 
+	// The bright spots and the light rays only feed the blurred bloom
+	// texture, so they can be made at a lower resolution.
+	const f32 bloom_scale = rangelim(g_settings->getFloat("bloom_resolution_scale"), 0.25f, 1.0f);
+	const f32 volume_scale = rangelim(g_settings->getFloat("volumetric_lighting_resolution_scale"), 0.25f, 1.0f);
+
 	const std::string antialiasing = g_settings->get("antialiasing");
 	const u16 antialiasing_scale = MYMAX(2, g_settings->getU16("fsaa"));
 
@@ -186,22 +191,26 @@ RenderStep *addPostProcessing(RenderPipeline *pipeline, RenderStep *previousStep
 		}
 
 		if (enable_bloom) {
-			buffer->setTexture(TEXTURE_BLOOM, scale, "bloom", bloom_format);
+			buffer->setTexture(TEXTURE_BLOOM, scale * bloom_scale, "bloom", bloom_format);
 
 			// get bright spots
 			u32 shader_id = client->getShaderSource()->getShaderRaw("extract_bloom");
-			RenderStep *extract_bloom = pipeline->addStep<PostProcessingStep>(shader_id, std::vector<u8> { source, TEXTURE_EXPOSURE_1 });
+			auto extract_bloom = pipeline->addStep<PostProcessingStep>(shader_id, std::vector<u8> { source, TEXTURE_EXPOSURE_1 });
 			extract_bloom->setRenderSource(buffer);
+			if (bloom_scale < 1.0f)
+				extract_bloom->setBilinearFilter(0, true);
 			extract_bloom->setRenderTarget(pipeline->createOwned<TextureBufferOutput>(buffer, TEXTURE_BLOOM));
 			source = TEXTURE_BLOOM;
 		}
 
 		if (enable_volumetric_light) {
-			buffer->setTexture(TEXTURE_VOLUME, scale, "volume", bloom_format);
+			buffer->setTexture(TEXTURE_VOLUME, scale * volume_scale, "volume", bloom_format);
 
 			shader_id = client->getShaderSource()->getShaderRaw("volumetric_light");
 			auto volume = pipeline->addStep<PostProcessingStep>(shader_id, std::vector<u8> { source, TEXTURE_DEPTH });
 			volume->setRenderSource(buffer);
+			if (volume_scale != bloom_scale)
+				volume->setBilinearFilter(0, true);
 			volume->setRenderTarget(pipeline->createOwned<TextureBufferOutput>(buffer, TEXTURE_VOLUME));
 			source = TEXTURE_VOLUME;
 		}
@@ -259,7 +268,7 @@ RenderStep *addPostProcessing(RenderPipeline *pipeline, RenderStep *previousStep
 	shader_id = client->getShaderSource()->getShaderRaw("second_stage");
 	PostProcessingStep *effect = pipeline->createOwned<PostProcessingStep>(shader_id, std::vector<u8> { final_stage_source, TEXTURE_SCALE_UP, TEXTURE_EXPOSURE_2 });
 	pipeline->addStep(effect);
-	if (enable_ssaa)
+	if (enable_ssaa || g_settings->getBool("dynamic_resolution"))
 		effect->setBilinearFilter(0, true);
 	effect->setBilinearFilter(1, true);
 	effect->setRenderSource(buffer);
@@ -26,6 +26,7 @@ class PostProcessingStep : public RenderStep
 	void setRenderTarget(RenderTarget *target) override;
 	void reset(PipelineContext &context) override;
 	void run(PipelineContext &context) override;
+	const char *getTimingName() const override { return "Post-processing"; }
 
 	/**
 	 * Configure bilinear filtering for a specific texture layer
@@ -51,6 +52,7 @@ class ResolveMSAAStep : public TrivialRenderStep
 	ResolveMSAAStep(TextureBufferOutput *_msaa_fbo, TextureBufferOutput *_target_fbo) :
 			msaa_fbo(_msaa_fbo), target_fbo(_target_fbo) {};
 	void run(PipelineContext &context) override;
+	const char *getTimingName() const override { return "MSAA resolve"; }
 
 private:
 	TextureBufferOutput *msaa_fbo;
@@ -16,6 +16,7 @@ class DrawImageStep : public RenderStep
 
 	void reset(PipelineContext &context) override {}
 	void run(PipelineContext &context) override;
+	const char *getTimingName() const override { return "Side-by-side image"; }
 private:
 	u8 texture_index;
 	v2f offset;
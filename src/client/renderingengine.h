@@ -129,8 +129,9 @@ class RenderingEngine
 			gui::IGUIEnvironment *guienv, ITextureSource *tsrc,
 			float dtime = 0, int percent = 0, float *indef_pos = nullptr);
 
+	// frame_busy_ms: average time of recent frames, without sleeping
 	void draw_scene(video::SColor skycolor, bool show_hud,
-			bool draw_wield_tool, bool draw_crosshair);
+			bool draw_wield_tool, bool draw_crosshair, f32 frame_busy_ms);
 
 	void initialize(Client *client, Hud *hud);
 	void finalize();
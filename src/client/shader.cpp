@@ -9,14 +9,20 @@
 #include "irr_ptr.h"
 #include "debug.h"
 #include "filesys.h"
+#include "porting.h"
 #include "util/container.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "util/serialize.h"
 #include "util/thread.h"
 #include "settings.h"
 #include <ICameraSceneNode.h>
 #include <IGPUProgrammingServices.h>
 #include <IMaterialRenderer.h>
 #include <IMaterialRendererServices.h>
+#include <IShaderBinaryCache.h>
 #include <IShaderConstantSetCallBack.h>
+#include <SkinnedMesh.h>
 #include "client/renderingengine.h"
 #include "gettext.h"
 #include "log.h"
@@ -276,6 +282,9 @@ class MainShaderUniformSetter : public IShaderUniformSetter
 	video::SColor m_material_color;
 	CachedPixelShaderSetting<float, 4> m_material_color_setting{"materialColor"};
 
+	// colors of the instances that are drawn, as floats
+	std::vector<f32> m_instance_colors;
+
 public:
 	~MainShaderUniformSetter() = default;
 
@@ -321,6 +330,30 @@ class MainShaderUniformSetter : public IShaderUniformSetter
 
 		video::SColorf colorf(m_material_color);
 		m_material_color_setting.set(colorf, services);
+
+		// only set while a mesh is skinned in the vertex shader
+		auto *joints = driver->getJointTransforms();
+		if (joints && !joints->empty()) {
+			services->setVertexShaderConstant(
+				services->getVertexShaderConstantID("mJoints"),
+				joints->front().pointer(), joints->size() * 16);
+		}
+
+		// only set while instances are drawn
+		if (auto *instances = driver->getDrawInstances()) {
+			m_instance_colors.clear();
+			for (video::SColor color : instances->Colors) {
+				video::SColorf colorf(color);
+				m_instance_colors.insert(m_instance_colors.end(),
+					{colorf.r, colorf.g, colorf.b, colorf.a});
+			}
+			services->setVertexShaderConstant(
+				services->getVertexShaderConstantID("mInstanceWorld"),
+				instances->World.front().pointer(), instances->World.size() * 16);
+			services->setVertexShaderConstant(
+				services->getVertexShaderConstantID("mInstanceColor"),
+				m_instance_colors.data(), m_instance_colors.size());
+		}
 	}
 };
 
@@ -333,6 +366,74 @@ class MainShaderUniformSetterFactory : public IShaderUniformSetterFactory
 };
 
 
+/*
+	Keeps compiled shader programs in the cache directory, one file for
+	each program. The file name is a hash of the sources and the driver.
+*/
+class ShaderBinaryCache : public video::IShaderBinaryCache
+{
+public:
+	ShaderBinaryCache() :
+		m_path(porting::path_cache + DIR_DELIM + "shaders")
+	{
+		// binaries only work with the driver that made them
+		std::ostringstream os;
+		os << "1\n"; // format version of this cache
+		for (auto name : {GL.VENDOR, GL.RENDERER, GL.VERSION}) {
+			const char *str = reinterpret_cast<const char*>(GL.GetString(name));
+			os << (str ? str : "") << '\n';
+		}
+		m_driver = os.str();
+	}
+
+	bool loadProgram(const std::string &vertex_shader,
+		const std::string &pixel_shader, u32 &format, std::string &binary) override
+	{
+		std::string data;
+		if (!fs::ReadFile(getPath(vertex_shader, pixel_shader), data))
+			return false;
+		if (data.size() <= 4)
+			return false;
+		format = readU32(reinterpret_cast<const u8*>(data.data()));
+		binary = data.substr(4);
+		return true;
+	}
+
+	void storeProgram(const std::string &vertex_shader,
+		const std::string &pixel_shader, u32 format, const std::string &binary) override
+	{
+		if (!fs::CreateAllDirs(m_path)) {
+			errorstream << "ShaderBinaryCache: could not create " << m_path << std::endl;
+			return;
+		}
+		std::string data(4, '\0');
+		writeU32(reinterpret_cast<u8*>(&data[0]), format);
+		data.append(binary);
+		if (!fs::safeWriteToFile(getPath(vertex_shader, pixel_shader), data))
+			warningstream << "ShaderBinaryCache: could not write a program" << std::endl;
+	}
+
+	void rejectProgram(const std::string &vertex_shader,
+		const std::string &pixel_shader) override
+	{
+		fs::DeleteSingleFileOrEmptyDirectory(getPath(vertex_shader, pixel_shader));
+	}
+
+private:
+	std::string getPath(const std::string &vertex_shader,
+		const std::string &pixel_shader) const
+	{
+		std::string key = m_driver;
+		key.append(vertex_shader).push_back('\0');
+		key.append(pixel_shader);
+		return m_path + DIR_DELIM + hex_encode(hashing::sha1(key));
+	}
+
+	const std::string m_path;
+	std::string m_driver;
+};
+
+
 /*
 	ShaderSource
 */
@@ -414,6 +515,9 @@ class ShaderSource : public IWritableShaderSource
 	// Global uniform setter factories
 	std::vector<std::unique_ptr<IShaderUniformSetterFactory>> m_uniform_factories;
 
+	// Compiled programs on disk, if enabled
+	std::unique_ptr<ShaderBinaryCache> m_binary_cache;
+
 	// Generate shader given the shader name.
 	ShaderInfo generateShader(const std::string &name,
 		const ShaderConstants &input_const, video::E_MATERIAL_TYPE base_mat);
@@ -443,6 +547,15 @@ ShaderSource::ShaderSource()
 	// Add global stuff
 	addShaderConstantSetter(new MainShaderConstantSetter());
 	addShaderUniformSetterFactory(new MainShaderUniformSetterFactory());
+
+	auto *driver = RenderingEngine::get_video_driver();
+	auto *gpu = driver->getGPUProgrammingServices();
+	const auto type = driver->getDriverType();
+	if (gpu && (type == video::EDT_OPENGL3 || type == video::EDT_OGLES2) &&
+			g_settings->getBool("shader_cache")) {
+		m_binary_cache = std::make_unique<ShaderBinaryCache>();
+		gpu->setShaderBinaryCache(m_binary_cache.get());
+	}
 }
 
 ShaderSource::~ShaderSource()
@@ -452,6 +565,8 @@ ShaderSource::~ShaderSource()
 	// Delete materials
 	auto *gpu = RenderingEngine::get_video_driver()->getGPUProgrammingServices();
 	assert(gpu);
+	if (m_binary_cache)
+		gpu->setShaderBinaryCache(nullptr);
 	u32 n = 0;
 	for (ShaderInfo &i : m_shaderinfo_cache) {
 		if (!i.name.empty()) {
@@ -651,9 +766,11 @@ ShaderInfo ShaderSource::generateShader(const std::string &name,
 			attribute highp vec4 inVertexPosition;
 			attribute lowp vec4 inVertexColor;
 			attribute mediump vec2 inTexCoord0;
+			attribute mediump vec2 inTexCoord1;
 			attribute mediump vec3 inVertexNormal;
 			attribute mediump vec4 inVertexTangent;
 			attribute mediump vec4 inVertexBinormal;
+			attribute highp vec3 inDrawOffset;
 		)";
 		// Our vertex color has components reversed compared to what OpenGL
 		// normally expects, so we need to take that into account.
@@ -680,6 +797,7 @@ ShaderInfo ShaderSource::generateShader(const std::string &name,
 			#define inVertexNormal gl_Normal
 			#define inVertexTangent gl_MultiTexCoord1
 			#define inVertexBinormal gl_MultiTexCoord2
+			#define inDrawOffset vec3(0.0)
 		)";
 	}
 
@@ -773,11 +891,22 @@ ShaderInfo ShaderSource::generateShader(const std::string &name,
 */
 
 u32 IShaderSource::getShader(const std::string &name,
-	MaterialType material_type, NodeDrawType drawtype)
+	MaterialType material_type, NodeDrawType drawtype, bool array_texture,
+	bool skinning, bool instancing)
 {
 	ShaderConstants input_const;
 	input_const["MATERIAL_TYPE"] = (int)material_type;
 	input_const["DRAWTYPE"] = (int)drawtype;
+	if (array_texture)
+		input_const["USE_ARRAY_TEXTURE"] = 1;
+	if (skinning) {
+		input_const["USE_SKINNING"] = 1;
+		input_const["MAX_JOINTS"] = (int)scene::SkinnedMesh::MAX_HARDWARE_JOINTS;
+	}
+	if (instancing) {
+		input_const["USE_INSTANCING"] = 1;
+		input_const["MAX_INSTANCES"] = (int)video::SDrawInstances::MAX_COUNT;
+	}
 
 	video::E_MATERIAL_TYPE base_mat = video::EMT_SOLID;
 	switch (material_type) {
@@ -246,8 +246,14 @@ class IShaderSource {
 		const ShaderConstants &input_const, video::E_MATERIAL_TYPE base_mat) = 0;
 
 	/// @brief Helper: Generates or gets a shader suitable for nodes and entities
+	/// @param array_texture sample the base texture from an array texture,
+	///        with the layer in the second texture coordinate
+	/// @param skinning skin the mesh with the joints set on the driver
+	/// @param instancing place and color instances with the data set on the driver
 	u32 getShader(const std::string &name,
-		MaterialType material_type, NodeDrawType drawtype = NDT_NORMAL);
+		MaterialType material_type, NodeDrawType drawtype = NDT_NORMAL,
+		bool array_texture = false, bool skinning = false,
+		bool instancing = false);
 
 	/**
 	 * Helper: Generates or gets a shader for common, general use.
@@ -13,11 +13,22 @@
 
 using m4f = core::matrix4;
 
+// The map shadow is cached until the light turns farther than this.
+// The sun moves by about 0.3 degrees per second at the default time speed.
+static const float COS_LIGHT_STEP = std::cos(0.5f * core::DEGTORAD);
+
 void DirectionalLight::createSplitMatrices(const Camera *cam)
 {
 	static const float COS_15_DEG = 0.965926f;
 	v3f look = cam->getDirection().normalize();
 
+	// same for the light direction, so that the frustum only changes in steps
+	v3f light_dir = direction;
+	if (light_dir.dotProduct(last_direction) >= COS_LIGHT_STEP)
+		light_dir = last_direction;
+	else
+		last_direction = light_dir;
+
 	// if current look direction is < 15 degrees away from the captured
 	// look direction then stick to the captured value, otherwise recapture.
 	if (look.dotProduct(last_look) >= COS_15_DEG)
@@ -63,7 +74,7 @@ void DirectionalLight::createSplitMatrices(const Camera *cam)
 	v3f boundVec = (cam_pos_scene + farCorner * sfFar) - center_scene;
 	float radius = boundVec.getLength();
 	float length = radius * 3.0f;
-	v3f eye_displacement = direction * length;
+	v3f eye_displacement = light_dir * length;
 
 	// we must compute the viewmat with the position - the camera offset
 	// but the future_frustum position must be the actual world position
@@ -116,6 +127,15 @@ void DirectionalLight::updateFrustum(const Camera *cam, Client *client)
 
 	// update shadow frustum
 	createSplitMatrices(cam);
+
+	// Nothing moved and the map didn't change: keep the cached map shadow,
+	// only the entities are drawn again.
+	if (!map_changed && future_frustum.position == shadow_frustum.position &&
+			future_frustum.radius == shadow_frustum.radius &&
+			future_frustum.zFar == shadow_frustum.zFar)
+		return;
+	map_changed = false;
+
 	// get the draw list for shadows
 	client->getEnv().getClientMap().updateDrawListShadow(
 			getPosition(), getDirection(), future_frustum.radius, future_frustum.length);
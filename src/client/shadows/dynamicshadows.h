@@ -87,6 +87,10 @@ class DirectionalLight
 	/// If true, shadow map needs to be invalidated due to frustum change
 	bool should_update_map_shadow{true};
 
+	/// Makes the next frustum update redraw the map shadow, even if the
+	/// frustum stays the same
+	void setMapChanged() { map_changed = true; }
+
 	void commitFrustum();
 
 private:
@@ -102,6 +106,9 @@ class DirectionalLight
 
 	v3f last_cam_pos_world{0,0,0};
 	v3f last_look{0,1,0};
+	v3f last_direction{0,0,0};
+
+	bool map_changed{true};
 
 	shadowFrustum shadow_frustum;
 	shadowFrustum future_frustum;
@@ -17,6 +17,7 @@
 #include "IGPUProgrammingServices.h"
 #include "IMaterialRenderer.h"
 #include "IVideoDriver.h"
+#include "IAnimatedMeshSceneNode.h"
 
 ShadowRenderer::ShadowRenderer(IrrlichtDevice *device, Client *client) :
 		m_smgr(device->getSceneManager()), m_driver(device->getVideoDriver()),
@@ -161,6 +162,12 @@ void ShadowRenderer::setShadowIntensity(float shadow_intensity)
 		disable();
 }
 
+void ShadowRenderer::setMapChanged()
+{
+	for (DirectionalLight &light : m_light_list)
+		light.setMapChanged();
+}
+
 void ShadowRenderer::addNodeToShadowList(
 		scene::ISceneNode *node, E_SHADOW_MODE shadowMode)
 {
@@ -485,10 +492,23 @@ void ShadowRenderer::renderShadowObjects(
 			current_mat.FrontfaceCulling = false;
 		}
 
+		// the depth shader doesn't skin, so skin on the CPU for this pass
+		scene::IAnimatedMeshSceneNode *animated_node = nullptr;
+		if (shadow_node.node->getType() == scene::ESNT_ANIMATED_MESH) {
+			animated_node = static_cast<scene::IAnimatedMeshSceneNode *>(shadow_node.node);
+			if (!animated_node->getHardwareSkinning())
+				animated_node = nullptr;
+		}
+		if (animated_node)
+			animated_node->setHardwareSkinning(false);
+
 		m_driver->setTransform(video::ETS_WORLD,
 				shadow_node.node->getAbsoluteTransformation());
 		shadow_node.node->render();
 
+		if (animated_node)
+			animated_node->setHardwareSkinning(true);
+
 		// restore the material.
 
 		for (u32 m = 0; m < n_node_materials; m++) {
@@ -71,6 +71,8 @@ class ShadowRenderer
 	void update(video::ITexture *outputTarget = nullptr);
 	/// Force shadow map to be re-drawn in one go next frame
 	void setForceUpdateShadowMap() { m_force_update_shadow_map = true; }
+	/// Map meshes changed, the map shadow is drawn again over the next frames
+	void setMapChanged();
 	void drawDebug();
 
 	video::ITexture *get_texture()
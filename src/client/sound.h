@@ -6,6 +6,7 @@
 
 #include "irr_v3d.h"
 #include "config.h"
+#include <functional>
 #include <limits>
 #include <string>
 #include <unordered_map>
@@ -92,6 +93,13 @@ class ISoundManager
 	 * Same as `loadSoundFile`, but reads the OggVorbis file from memory.
 	 */
 	virtual bool loadSoundData(const std::string &name, std::string &&filedata) = 0;
+	/**
+	 * Same as `loadSoundData`, but the OggVorbis file is only got from `loader`
+	 * when the sound is first played. `loader` may be called from another
+	 * thread and returns an empty string on failure.
+	 */
+	virtual bool loadSoundLazy(const std::string &name,
+			std::function<std::string()> &&loader) = 0;
 	/**
 	 * Adds sound with name sound_name to group `group_name`. Creates the group
 	 * if non-existent.
@@ -165,6 +173,8 @@ class DummySoundManager final : public ISoundManager
 
 	bool loadSoundFile(const std::string &name, const std::string &filepath) override { return true; }
 	bool loadSoundData(const std::string &name, std::string &&filedata) override { return true; }
+	bool loadSoundLazy(const std::string &name,
+			std::function<std::string()> &&loader) override { return true; }
 	void addSoundToGroup(const std::string &sound_name, const std::string &group_name) override {};
 
 	void playSound(sound_handle_t id, const SoundSpec &spec) override { reportRemovedSound(id); }
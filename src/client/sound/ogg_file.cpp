@@ -158,8 +158,8 @@ std::optional<OggFileDecodeInfo> RAIIOggFile::getDecodeInfo(const std::string &f
 	return ret;
 }
 
-RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
-		ALuint pcm_start, ALuint pcm_end)
+std::optional<std::vector<char>> RAIIOggFile::decodeRange(
+		const OggFileDecodeInfo &decode_info, ALuint pcm_start, ALuint pcm_end)
 {
 	constexpr int endian = 0; // 0 for Little-Endian, 1 for Big-Endian
 	constexpr int word_size = 2; // we use s16 samples
@@ -174,7 +174,7 @@ RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
 		if (ov_pcm_seek(&m_file, pcm_start) != 0) {
 			warningstream << "Audio: Error decoding (could not seek): "
 					<< decode_info.name_for_logging << std::endl;
-			return RAIIALSoundBuffer();
+			return std::nullopt;
 		}
 		assert(ov_pcm_tell(&m_file) == pcm_start);
 		current_pcm = pcm_start;
@@ -183,7 +183,7 @@ RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
 	const size_t size = static_cast<size_t>(pcm_end - pcm_start)
 			* decode_info.bytes_per_sample;
 
-	std::unique_ptr<char[]> snd_buffer(new char[size]);
+	std::vector<char> snd_buffer(size);
 
 	// read size bytes
 	s64 last_byte_offset = current_pcm * decode_info.bytes_per_sample;
@@ -206,7 +206,7 @@ RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
 			}();
 			warningstream << "Audio: Error decoding (" << errstr << "): "
 					<< decode_info.name_for_logging << std::endl;
-			return RAIIALSoundBuffer();
+			return std::nullopt;
 		}
 
 		// This usually doesn't happen, but for some sounds ov_read seems to skip
@@ -221,7 +221,7 @@ RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
 			if (ov_pcm_seek(&m_file, expected_offset) != 0) {
 				warningstream << "Audio: Error decoding (could not seek): "
 						<< decode_info.name_for_logging << std::endl;
-				return RAIIALSoundBuffer();
+				return std::nullopt;
 			}
 			assert(ov_pcm_tell(&m_file) == expected_offset);
 			current_byte_offset = last_byte_offset + num_bytes;
@@ -231,9 +231,24 @@ RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
 		read_count += num_bytes;
 	}
 
+	return snd_buffer;
+}
+
+RAIIALSoundBuffer RAIIOggFile::loadBuffer(const OggFileDecodeInfo &decode_info,
+		ALuint pcm_start, ALuint pcm_end)
+{
+	std::optional<std::vector<char>> pcm = decodeRange(decode_info, pcm_start, pcm_end);
+	if (!pcm.has_value())
+		return RAIIALSoundBuffer();
+	return create_al_buffer(decode_info, *pcm);
+}
+
+RAIIALSoundBuffer create_al_buffer(const OggFileDecodeInfo &decode_info,
+		const std::vector<char> &pcm)
+{
 	// load buffer to openal
 	RAIIALSoundBuffer snd_buffer_id = RAIIALSoundBuffer::generate();
-	alBufferData(snd_buffer_id.get(), decode_info.format, &(snd_buffer[0]), size,
+	alBufferData(snd_buffer_id.get(), decode_info.format, pcm.data(), pcm.size(),
 			decode_info.freq);
 
 	ALenum error = alGetError();
@@ -12,6 +12,7 @@
 #include <vorbis/vorbisfile.h>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace sound {
 
@@ -67,16 +68,30 @@ struct RAIIOggFile {
 
 	/**
 	 * Main function for loading ogg vorbis sounds.
-	 * Loads exactly the specified interval of PCM-data, and creates an OpenAL
-	 * buffer with it.
+	 * Decodes exactly the specified interval of PCM-data. Doesn't use OpenAL,
+	 * so it may be called from any thread.
 	 *
 	 * @param decode_info Cached meta information of the file.
 	 * @param pcm_start First sample in the interval.
 	 * @param pcm_end One after last sample of the interval (=> exclusive).
+	 * @return The PCM-data, or std::nullopt on failure.
+	 */
+	std::optional<std::vector<char>> decodeRange(const OggFileDecodeInfo &decode_info,
+			ALuint pcm_start, ALuint pcm_end);
+
+	/**
+	 * Same as `decodeRange`, but creates an OpenAL buffer with the data.
+	 *
 	 * @return An AL sound buffer, or a 0-buffer on failure.
 	 */
 	RAIIALSoundBuffer loadBuffer(const OggFileDecodeInfo &decode_info, ALuint pcm_start,
 			ALuint pcm_end);
 };
 
+/**
+ * Creates an OpenAL buffer with PCM-data from `RAIIOggFile::decodeRange`.
+ */
+RAIIALSoundBuffer create_al_buffer(const OggFileDecodeInfo &decode_info,
+		const std::vector<char> &pcm);
+
 } // namespace sound
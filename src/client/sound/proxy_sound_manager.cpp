@@ -113,6 +113,19 @@ bool ProxySoundManager::loadSoundData(const std::string &name, std::string &&fil
 	return true;
 }
 
+bool ProxySoundManager::loadSoundLazy(const std::string &name,
+		std::function<std::string()> &&loader)
+{
+	// do not add twice
+	if (m_known_sound_names.count(name) != 0)
+		return false;
+
+	send(sound_manager_messages_to_mgr::LoadSoundLazy{name, std::move(loader)});
+
+	m_known_sound_names.insert(name);
+	return true;
+}
+
 void ProxySoundManager::addSoundToGroup(const std::string &sound_name,
 		const std::string &group_name)
 {
@@ -47,6 +47,8 @@ class ProxySoundManager final : public ISoundManager
 
 	bool loadSoundFile(const std::string &name, const std::string &filepath) override;
 	bool loadSoundData(const std::string &name, std::string &&filedata) override;
+	bool loadSoundLazy(const std::string &name,
+			std::function<std::string()> &&loader) override;
 	void addSoundToGroup(const std::string &sound_name, const std::string &group_name) override;
 
 	void playSound(sound_handle_t id, const SoundSpec &spec) override;
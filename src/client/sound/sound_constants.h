@@ -39,15 +39,21 @@
  *   * Step 3.2:
  *     We choose one random sound name from the given group.
  *   * Step 3.3:
- *     We open the sound (see `openSingleSound`).
- *     If the sound is already open (in `m_sound_datas_open`), we take that one.
- *     Otherwise we open it by calling `ISoundDataUnopen::open`. We choose (by
- *     sound length), whether it's a single-buffer (`SoundDataOpenBuffer`) or
- *     streamed (`SoundDataOpenStream`) sound.
- *     Single-buffer sounds are always completely loaded. Streamed sounds can be
+ *     If the sound is already open (in `m_sound_datas_open`), we take that one
+ *     and continue with step 3.4.
+ *     Otherwise the sound is moved from `m_sound_datas_unopen` to the
+ *     `SoundDecoder`, which calls `ISoundDataUnopen::decode` on one of its own
+ *     threads. We choose (by sound length), whether it's a single-buffer
+ *     (`SoundDataOpenBuffer`) or streamed (`SoundDataOpenStream`) sound.
+ *     Single-buffer sounds are completely decoded there. Streamed sounds can be
  *     partially loaded.
- *     The sound is erased from `m_sound_datas_unopen` and added to `m_sound_datas_open`.
- *     Open sounds are kept forever.
+ *     Until then, the sound waits in `m_sounds_waiting`. Sounds that are
+ *     louder or closer to the listener are decoded first.
+ *     The other sounds of the group are queued for decoding too, with the
+ *     lowest priority, so that the next random choice is ready to play.
+ *     Once decoded, the OpenAL buffers are created on our thread (see
+ *     `finishDecodedSounds`) and the sound is added to `m_sound_datas_open`.
+ *     Open sounds are kept forever, so often used sounds are decoded only once.
  *   * Step 3.4:
  *     We create the new `PlayingSound`. It has a `shared_ptr` to its open sound.
  *     If the open sound is streaming, the playing sound needs to be stepped using
@@ -93,6 +99,10 @@ constexpr f32 MIN_STREAM_BUFFER_LENGTH = 1.0f;
 constexpr f32 STREAM_BIGSTEP_TIME = 0.3f;
 // step duration for the OpenALSoundManager thread, in seconds
 constexpr f32 SOUNDTHREAD_DTIME = 0.016f;
+// number of threads that decode sounds for the OpenALSoundManager thread
+constexpr unsigned int SOUND_DECODE_THREADS = 2;
+// decode priority of sounds that are not waiting to be played
+constexpr f32 SOUND_DECODE_PRIORITY_BACKGROUND = -1.0f;
 
 static_assert(SOUND_DURATION_MAX_SINGLE >= MIN_STREAM_BUFFER_LENGTH * 2.0f,
 		"There's no benefit in streaming if we can't queue more than 2 buffers.");
@@ -14,25 +14,51 @@
 namespace sound {
 
 /*
- * ISoundDataOpen struct
+ * SoundDataDecoded struct
  */
 
-std::shared_ptr<ISoundDataOpen> ISoundDataOpen::fromOggFile(std::unique_ptr<RAIIOggFile> oggfile,
-		const std::string &filename_for_logging)
+std::optional<SoundDataDecoded> SoundDataDecoded::fromOggFile(
+		std::unique_ptr<RAIIOggFile> oggfile, const std::string &filename_for_logging)
 {
 	// Get some information about the OGG file
 	std::optional<OggFileDecodeInfo> decode_info = oggfile->getDecodeInfo(filename_for_logging);
 	if (!decode_info.has_value()) {
 		warningstream << "Audio: Error decoding "
 				<< filename_for_logging << std::endl;
-		return nullptr;
+		return std::nullopt;
 	}
 
+	SoundDataDecoded ret;
+	ret.m_decode_info = *decode_info;
+
 	// use duration (in seconds) to decide whether to load all at once or to stream
 	if (decode_info->length_seconds <= SOUND_DURATION_MAX_SINGLE) {
-		return std::make_shared<SoundDataOpenBuffer>(std::move(oggfile), *decode_info);
+		std::optional<std::vector<char>> pcm = oggfile->decodeRange(*decode_info,
+				0, decode_info->length_samples);
+		if (!pcm.has_value()) {
+			warningstream << "SoundDataDecoded: Failed to load sound \""
+					<< filename_for_logging << "\"" << std::endl;
+			return std::nullopt;
+		}
+		ret.m_pcm = std::move(*pcm);
 	} else {
-		return std::make_shared<SoundDataOpenStream>(std::move(oggfile), *decode_info);
+		ret.m_oggfile = std::move(oggfile);
+	}
+	return ret;
+}
+
+/*
+ * ISoundDataOpen struct
+ */
+
+std::shared_ptr<ISoundDataOpen> ISoundDataOpen::fromDecoded(SoundDataDecoded &&decoded)
+{
+	if (decoded.m_oggfile) {
+		return std::make_shared<SoundDataOpenStream>(std::move(decoded.m_oggfile),
+				decoded.m_decode_info);
+	} else {
+		return std::make_shared<SoundDataOpenBuffer>(decoded.m_decode_info,
+				decoded.m_pcm);
 	}
 }
 
@@ -40,7 +66,7 @@ std::shared_ptr<ISoundDataOpen> ISoundDataOpen::fromOggFile(std::unique_ptr<RAII
  * SoundDataUnopenBuffer struct
  */
 
-std::shared_ptr<ISoundDataOpen> SoundDataUnopenBuffer::open(const std::string &sound_name) &&
+std::optional<SoundDataDecoded> SoundDataUnopenBuffer::decode(const std::string &sound_name) &&
 {
 	// load from m_buffer
 
@@ -54,17 +80,31 @@ std::shared_ptr<ISoundDataOpen> SoundDataUnopenBuffer::open(const std::string &s
 			OggVorbisBufferSource::s_ov_callbacks) != 0) {
 		warningstream << "Audio: Error opening " << sound_name << " for decoding"
 				<< std::endl;
-		return nullptr;
+		return std::nullopt;
 	}
 
-	return ISoundDataOpen::fromOggFile(std::move(oggfile), sound_name);
+	return SoundDataDecoded::fromOggFile(std::move(oggfile), sound_name);
+}
+
+/*
+ * SoundDataUnopenLazy struct
+ */
+
+std::optional<SoundDataDecoded> SoundDataUnopenLazy::decode(const std::string &sound_name) &&
+{
+	std::string buffer = m_loader();
+	if (buffer.empty()) {
+		warningstream << "Audio: Failed to load " << sound_name << std::endl;
+		return std::nullopt;
+	}
+	return SoundDataUnopenBuffer(std::move(buffer)).decode(sound_name);
 }
 
 /*
  * SoundDataUnopenFile struct
  */
 
-std::shared_ptr<ISoundDataOpen> SoundDataUnopenFile::open(const std::string &sound_name) &&
+std::optional<SoundDataDecoded> SoundDataUnopenFile::decode(const std::string &sound_name) &&
 {
 	// load from file at m_path
 
@@ -73,21 +113,21 @@ std::shared_ptr<ISoundDataOpen> SoundDataUnopenFile::open(const std::string &sou
 	if (ov_fopen(m_path.c_str(), oggfile->get()) != 0) {
 		warningstream << "Audio: Error opening " << m_path << " for decoding"
 				<< std::endl;
-		return nullptr;
+		return std::nullopt;
 	}
 	oggfile->m_needs_clear = true;
 
-	return ISoundDataOpen::fromOggFile(std::move(oggfile), sound_name);
+	return SoundDataDecoded::fromOggFile(std::move(oggfile), sound_name);
 }
 
 /*
  * SoundDataOpenBuffer struct
  */
 
-SoundDataOpenBuffer::SoundDataOpenBuffer(std::unique_ptr<RAIIOggFile> oggfile,
-		const OggFileDecodeInfo &decode_info) : ISoundDataOpen(decode_info)
+SoundDataOpenBuffer::SoundDataOpenBuffer(const OggFileDecodeInfo &decode_info,
+		const std::vector<char> &pcm) : ISoundDataOpen(decode_info)
 {
-	m_buffer = oggfile->loadBuffer(m_decode_info, 0, m_decode_info.length_samples);
+	m_buffer = create_al_buffer(m_decode_info, pcm);
 	if (m_buffer.get() == 0) {
 		warningstream << "SoundDataOpenBuffer: Failed to load sound \""
 				<< m_decode_info.name_for_logging << "\"" << std::endl;
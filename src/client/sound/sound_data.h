@@ -9,12 +9,30 @@
 #pragma once
 
 #include "ogg_file.h"
+#include <functional>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <vector>
 
 namespace sound {
 
+/**
+ * An opened sound file, completely decoded if it's short enough to not be
+ * streamed. Made without OpenAL, so that it can happen on any thread.
+ */
+struct SoundDataDecoded
+{
+	OggFileDecodeInfo m_decode_info;
+	// Only for streamed sounds
+	std::unique_ptr<RAIIOggFile> m_oggfile;
+	// All PCM-data, only for sounds that are not streamed
+	std::vector<char> m_pcm;
+
+	static std::optional<SoundDataDecoded> fromOggFile(std::unique_ptr<RAIIOggFile> oggfile,
+		const std::string &filename_for_logging);
+};
+
 /**
  * Stores sound pcm data buffers.
  */
@@ -51,8 +69,10 @@ struct ISoundDataOpen
 	 */
 	virtual std::tuple<ALuint, ALuint, ALuint> getOrLoadBufferAt(ALuint offset) = 0;
 
-	static std::shared_ptr<ISoundDataOpen> fromOggFile(std::unique_ptr<RAIIOggFile> oggfile,
-		const std::string &filename_for_logging);
+	/**
+	 * Creates the OpenAL buffers for decoded data.
+	 */
+	static std::shared_ptr<ISoundDataOpen> fromDecoded(SoundDataDecoded &&decoded);
 };
 
 /**
@@ -62,9 +82,11 @@ struct ISoundDataUnopen
 {
 	virtual ~ISoundDataUnopen() = default;
 
+	// Opens and decodes the file. Doesn't use OpenAL, so it may be called from
+	// any thread.
 	// Note: The ISoundDataUnopen is moved (see &&). It is not meant to be kept
 	// after opening.
-	virtual std::shared_ptr<ISoundDataOpen> open(const std::string &sound_name) && = 0;
+	virtual std::optional<SoundDataDecoded> decode(const std::string &sound_name) && = 0;
 };
 
 /**
@@ -76,7 +98,20 @@ struct SoundDataUnopenBuffer final : ISoundDataUnopen
 
 	explicit SoundDataUnopenBuffer(std::string &&buffer) : m_buffer(std::move(buffer)) {}
 
-	std::shared_ptr<ISoundDataOpen> open(const std::string &sound_name) && override;
+	std::optional<SoundDataDecoded> decode(const std::string &sound_name) && override;
+};
+
+/**
+ * Sound file is got from a function when the sound is opened.
+ */
+struct SoundDataUnopenLazy final : ISoundDataUnopen
+{
+	std::function<std::string()> m_loader;
+
+	explicit SoundDataUnopenLazy(std::function<std::string()> &&loader) :
+			m_loader(std::move(loader)) {}
+
+	std::optional<SoundDataDecoded> decode(const std::string &sound_name) && override;
 };
 
 /**
@@ -88,7 +123,7 @@ struct SoundDataUnopenFile final : ISoundDataUnopen
 
 	explicit SoundDataUnopenFile(const std::string &path) : m_path(path) {}
 
-	std::shared_ptr<ISoundDataOpen> open(const std::string &sound_name) && override;
+	std::optional<SoundDataDecoded> decode(const std::string &sound_name) && override;
 };
 
 /**
@@ -99,8 +134,8 @@ struct SoundDataOpenBuffer final : ISoundDataOpen
 {
 	RAIIALSoundBuffer m_buffer;
 
-	SoundDataOpenBuffer(std::unique_ptr<RAIIOggFile> oggfile,
-			const OggFileDecodeInfo &decode_info);
+	SoundDataOpenBuffer(const OggFileDecodeInfo &decode_info,
+			const std::vector<char> &pcm);
 
 	bool isStreaming() const noexcept override { return false; }
 
@@ -0,0 +1,113 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "sound_decoder.h"
+
+#include "debug.h"
+#include "threading/thread.h"
+
+namespace sound {
+
+class SoundDecoderThread : public Thread
+{
+public:
+	SoundDecoderThread(SoundDecoder *decoder) :
+		Thread("SoundDecoder"),
+		m_decoder(decoder)
+	{}
+
+protected:
+	void *run() override
+	{
+		BEGIN_DEBUG_EXCEPTION_HANDLER
+
+		SoundDecoder::Job job;
+		while (m_decoder->popJob(job)) {
+			SoundDecoder::Result result{job.name, std::move(*job.data).decode(job.name)};
+			job.data.reset();
+			m_decoder->pushResult(std::move(result));
+		}
+
+		END_DEBUG_EXCEPTION_HANDLER
+
+		return nullptr;
+	}
+
+private:
+	SoundDecoder *m_decoder;
+};
+
+SoundDecoder::SoundDecoder(unsigned int num_threads)
+{
+	for (unsigned int i = 0; i < num_threads; i++) {
+		m_threads.emplace_back(std::make_unique<SoundDecoderThread>(this));
+		m_threads.back()->start();
+	}
+}
+
+SoundDecoder::~SoundDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_jobs_cv.notify_all();
+	for (auto &thread : m_threads)
+		thread->wait();
+}
+
+void SoundDecoder::push(const std::string &name, std::unique_ptr<ISoundDataUnopen> data,
+		f32 priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(Job{name, std::move(data), priority});
+	}
+	m_jobs_cv.notify_one();
+}
+
+void SoundDecoder::raisePriority(const std::string &name, f32 priority)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (Job &job : m_jobs) {
+		if (job.name == name) {
+			job.priority = std::max(job.priority, priority);
+			break;
+		}
+	}
+}
+
+std::vector<SoundDecoder::Result> SoundDecoder::takeResults()
+{
+	std::vector<Result> ret;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ret.swap(m_results);
+	return ret;
+}
+
+bool SoundDecoder::popJob(Job &job)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobs_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+	if (m_stop)
+		return false;
+
+	// the first one of the highest priority, the queue is short
+	auto best = m_jobs.begin();
+	for (auto it = m_jobs.begin() + 1; it != m_jobs.end(); ++it) {
+		if (it->priority > best->priority)
+			best = it;
+	}
+	job = std::move(*best);
+	m_jobs.erase(best);
+	return true;
+}
+
+void SoundDecoder::pushResult(Result &&result)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_results.push_back(std::move(result));
+}
+
+} // namespace sound
@@ -0,0 +1,71 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include "sound_data.h"
+#include "util/basic_macros.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+namespace sound {
+
+class SoundDecoderThread; // hidden
+
+/*
+ * Decodes sounds for the OpenALSoundManager thread on its own threads, so that
+ * a burst of new sounds doesn't hold up the updates of the playing sounds.
+ * Sounds with the highest priority are decoded first.
+ *
+ * Nothing here uses OpenAL, the buffers are created from the results by the
+ * OpenALSoundManager thread.
+ */
+class SoundDecoder
+{
+public:
+	struct Result {
+		std::string name;
+		// std::nullopt if decoding failed
+		std::optional<SoundDataDecoded> data;
+	};
+
+	SoundDecoder(unsigned int num_threads);
+	~SoundDecoder();
+
+	DISABLE_CLASS_COPY(SoundDecoder)
+
+	void push(const std::string &name, std::unique_ptr<ISoundDataUnopen> data,
+			f32 priority);
+
+	// Raises the priority of a sound that is still queued
+	void raisePriority(const std::string &name, f32 priority);
+
+	// Gives the sounds that were decoded since the last call
+	std::vector<Result> takeResults();
+
+private:
+	friend class SoundDecoderThread;
+
+	struct Job {
+		std::string name;
+		std::unique_ptr<ISoundDataUnopen> data;
+		f32 priority;
+	};
+
+	// Waits for the next job, returns false when stopping
+	bool popJob(Job &job);
+	void pushResult(Result &&result);
+
+	std::mutex m_mutex;
+	std::condition_variable m_jobs_cv;
+	bool m_stop = false;
+	// in order of pushing
+	std::vector<Job> m_jobs;
+	std::vector<Result> m_results;
+
+	std::vector<std::unique_ptr<SoundDecoderThread>> m_threads;
+};
+
+} // namespace sound
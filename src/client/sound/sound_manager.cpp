@@ -14,6 +14,7 @@
 #include "filesys.h"
 #include "porting.h"
 
+#include <algorithm>
 #include <limits>
 
 namespace sound {
@@ -69,26 +70,72 @@ void OpenALSoundManager::doFades(f32 dtime)
 	}
 }
 
-std::shared_ptr<ISoundDataOpen> OpenALSoundManager::openSingleSound(const std::string &sound_name)
+bool OpenALSoundManager::requestDecode(const std::string &sound_name, f32 priority)
 {
-	// if already open, nothing to do
-	auto it = m_sound_datas_open.find(sound_name);
-	if (it != m_sound_datas_open.end())
-		return it->second;
-
-	// find unopened data
 	auto it_unopen = m_sound_datas_unopen.find(sound_name);
-	if (it_unopen == m_sound_datas_unopen.end())
-		return nullptr;
-	std::unique_ptr<ISoundDataUnopen> unopn_snd = std::move(it_unopen->second);
-	m_sound_datas_unopen.erase(it_unopen);
+	if (it_unopen != m_sound_datas_unopen.end()) {
+		m_decoder.push(sound_name, std::move(it_unopen->second), priority);
+		m_sound_datas_unopen.erase(it_unopen);
+		m_sounds_decoding.emplace(sound_name, std::vector<sound_handle_t>());
+		return true;
+	}
 
-	// open
-	std::shared_ptr<ISoundDataOpen> opn_snd = std::move(*unopn_snd).open(sound_name);
-	if (!opn_snd)
-		return nullptr;
-	m_sound_datas_open.emplace(sound_name, opn_snd);
-	return opn_snd;
+	if (m_sounds_decoding.count(sound_name) != 0) {
+		m_decoder.raisePriority(sound_name, priority);
+		return true;
+	}
+
+	return false;
+}
+
+void OpenALSoundManager::finishDecodedSounds()
+{
+	for (SoundDecoder::Result &result : m_decoder.takeResults()) {
+		auto it_decoding = m_sounds_decoding.find(result.name);
+		assert(it_decoding != m_sounds_decoding.end());
+		std::vector<sound_handle_t> waiting_ids = std::move(it_decoding->second);
+		m_sounds_decoding.erase(it_decoding);
+
+		std::shared_ptr<ISoundDataOpen> lsnd;
+		if (result.data.has_value())
+			lsnd = ISoundDataOpen::fromDecoded(std::move(*result.data));
+		if (lsnd)
+			m_sound_datas_open.emplace(result.name, lsnd);
+		else
+			removeSoundFromGroups(result.name);
+
+		for (sound_handle_t id : waiting_ids) {
+			auto it_waiting = m_sounds_waiting.find(id);
+			if (it_waiting == m_sounds_waiting.end())
+				continue;
+			WaitingSound snd = std::move(it_waiting->second);
+			m_sounds_waiting.erase(it_waiting);
+
+			if (lsnd)
+				startPlayingSound(id, lsnd, snd);
+			else
+				reportRemovedSound(id);
+		}
+	}
+}
+
+void OpenALSoundManager::removeSoundFromGroups(const std::string &sound_name)
+{
+	for (auto &it : m_sound_groups) {
+		std::vector<std::string> &group_sounds = it.second;
+		group_sounds.erase(std::remove(group_sounds.begin(), group_sounds.end(),
+				sound_name), group_sounds.end());
+	}
+}
+
+f32 OpenALSoundManager::getAudibility(f32 volume,
+		const std::optional<std::pair<v3f, v3f>> &pos_vel_opt) const
+{
+	if (!pos_vel_opt.has_value())
+		return volume;
+	// gain falls off with the inverse distance, see PlayingSound
+	f32 distance = pos_vel_opt->first.getDistanceFrom(m_listener_pos);
+	return volume / std::max(distance, 1.0f);
 }
 
 std::string OpenALSoundManager::getLoadedSoundNameFromGroup(const std::string &group_name)
@@ -106,8 +153,9 @@ std::string OpenALSoundManager::getLoadedSoundNameFromGroup(const std::string &g
 		chosen_sound_name = group_sounds[j];
 
 		// find chosen one
-		std::shared_ptr<ISoundDataOpen> snd = openSingleSound(chosen_sound_name);
-		if (snd)
+		if (m_sound_datas_open.count(chosen_sound_name) != 0 ||
+				m_sound_datas_unopen.count(chosen_sound_name) != 0 ||
+				m_sounds_decoding.count(chosen_sound_name) != 0)
 			return chosen_sound_name;
 
 		// it doesn't exist
@@ -136,21 +184,14 @@ std::string OpenALSoundManager::getOrLoadLoadedSoundNameFromGroup(const std::str
 }
 
 std::shared_ptr<PlayingSound> OpenALSoundManager::createPlayingSound(
-		const std::string &sound_name, bool loop, f32 volume, f32 pitch,
-		f32 start_time, const std::optional<std::pair<v3f, v3f>> &pos_vel_opt)
+		const std::string &sound_name, std::shared_ptr<ISoundDataOpen> lsnd,
+		bool loop, f32 volume, f32 pitch, f32 start_time,
+		const std::optional<std::pair<v3f, v3f>> &pos_vel_opt)
 {
 	infostream << "OpenALSoundManager: Creating playing sound \"" << sound_name
 			<< "\"" << std::endl;
 	warn_if_al_error("before createPlayingSound");
 
-	std::shared_ptr<ISoundDataOpen> lsnd = openSingleSound(sound_name);
-	if (!lsnd) {
-		// does not happen because of the call to getLoadedSoundNameFromGroup
-		errorstream << "OpenALSoundManager::createPlayingSound: Sound \""
-				<< sound_name << "\" disappeared." << std::endl;
-		return nullptr;
-	}
-
 	if (lsnd->m_decode_info.is_stereo && pos_vel_opt.has_value()
 			&& m_warned_positional_stereo_sounds.find(sound_name)
 					== m_warned_positional_stereo_sounds.end()) {
@@ -215,9 +256,36 @@ void OpenALSoundManager::playSoundGeneric(sound_handle_t id, const std::string &
 		start_time = 0.0f;
 	}
 
+	WaitingSound snd{sound_name, loop, volume, pitch, start_time, pos_vel_opt,
+			std::nullopt};
+	if (fade > 0.0f)
+		snd.fade = {fade, target_fade_volume};
+
+	// get the other sounds of the group ready for the next time
+	for (const std::string &name : m_sound_groups[group_name]) {
+		if (name != sound_name)
+			requestDecode(name, SOUND_DECODE_PRIORITY_BACKGROUND);
+	}
+
 	// play it
-	std::shared_ptr<PlayingSound> sound = createPlayingSound(sound_name, loop,
-			volume, pitch, start_time, pos_vel_opt);
+	auto it_open = m_sound_datas_open.find(sound_name);
+	if (it_open != m_sound_datas_open.end()) {
+		startPlayingSound(id, it_open->second, snd);
+		return;
+	}
+
+	// or once it's decoded
+	requestDecode(sound_name, getAudibility(target_fade_volume, pos_vel_opt));
+	m_sounds_decoding[sound_name].push_back(id);
+	m_sounds_waiting.emplace(id, std::move(snd));
+}
+
+void OpenALSoundManager::startPlayingSound(sound_handle_t id,
+		std::shared_ptr<ISoundDataOpen> lsnd, const WaitingSound &snd)
+{
+	std::shared_ptr<PlayingSound> sound = createPlayingSound(snd.sound_name,
+			std::move(lsnd), snd.loop, snd.volume, snd.pitch, snd.start_time,
+			snd.pos_vel_opt);
 	if (!sound) {
 		reportRemovedSound(id);
 		return;
@@ -229,8 +297,8 @@ void OpenALSoundManager::playSoundGeneric(sound_handle_t id, const std::string &
 
 	m_sounds_playing.emplace(id, std::move(sound));
 
-	if (fade > 0.0f)
-		fadeSound(id, fade, target_fade_volume);
+	if (snd.fade.has_value())
+		fadeSound(id, snd.fade->first, snd.fade->second);
 }
 
 int OpenALSoundManager::removeDeadSounds()
@@ -280,6 +348,7 @@ void OpenALSoundManager::step(f32 dtime)
 		if (!m_sounds_playing.empty()) {
 			verbosestream << "OpenALSoundManager::step(): "
 					<< m_sounds_playing.size() << " playing sounds, "
+					<< m_sounds_waiting.size() << " waiting sounds, "
 					<< m_sound_datas_unopen.size() << " unopen sounds, "
 					<< m_sound_datas_open.size() << " open sounds and "
 					<< m_sound_groups.size() << " sound groups loaded."
@@ -295,6 +364,7 @@ void OpenALSoundManager::step(f32 dtime)
 		m_time_until_dead_removal = REMOVE_DEAD_SOUNDS_INTERVAL;
 	}
 
+	finishDecodedSounds();
 	doFades(dtime);
 	stepStreams(dtime);
 }
@@ -325,6 +395,7 @@ void OpenALSoundManager::updateListener(const v3f &pos_, const v3f &vel_,
 	v3f at = swap_handedness(at_);
 	v3f up = swap_handedness(up_);
 	ALfloat orientation[6] = {at.X, at.Y, at.Z, up.X, up.Y, up.Z};
+	m_listener_pos = pos;
 
 	alListener3f(AL_POSITION, pos.X, pos.Y, pos.Z);
 	alListener3f(AL_VELOCITY, vel.X, vel.Y, vel.Z);
@@ -347,7 +418,8 @@ void OpenALSoundManager::setListenerGain(f32 gain)
 bool OpenALSoundManager::loadSoundFile(const std::string &name, const std::string &filepath)
 {
 	// do not add twice
-	if (m_sound_datas_open.count(name) != 0 || m_sound_datas_unopen.count(name) != 0)
+	if (m_sound_datas_open.count(name) != 0 || m_sound_datas_unopen.count(name) != 0 ||
+			m_sounds_decoding.count(name) != 0)
 		return false;
 
 	// coarse check
@@ -361,7 +433,8 @@ bool OpenALSoundManager::loadSoundFile(const std::string &name, const std::strin
 bool OpenALSoundManager::loadSoundData(const std::string &name, std::string &&filedata)
 {
 	// do not add twice
-	if (m_sound_datas_open.count(name) != 0 || m_sound_datas_unopen.count(name) != 0)
+	if (m_sound_datas_open.count(name) != 0 || m_sound_datas_unopen.count(name) != 0 ||
+			m_sounds_decoding.count(name) != 0)
 		return false;
 
 	loadSoundDataNoCheck(name, std::move(filedata));
@@ -380,6 +453,12 @@ void OpenALSoundManager::loadSoundDataNoCheck(const std::string &name, std::stri
 	m_sound_datas_unopen.emplace(name, std::make_unique<SoundDataUnopenBuffer>(std::move(filedata)));
 }
 
+void OpenALSoundManager::loadSoundLazyNoCheck(const std::string &name,
+		std::function<std::string()> &&loader)
+{
+	m_sound_datas_unopen.emplace(name, std::make_unique<SoundDataUnopenLazy>(std::move(loader)));
+}
+
 void OpenALSoundManager::addSoundToGroup(const std::string &sound_name, const std::string &group_name)
 {
 	auto it_groups = m_sound_groups.find(group_name);
@@ -410,6 +489,15 @@ void OpenALSoundManager::playSoundAt(sound_handle_t id, const SoundSpec &spec,
 void OpenALSoundManager::stopSound(sound_handle_t sound)
 {
 	m_sounds_playing.erase(sound);
+
+	auto it_waiting = m_sounds_waiting.find(sound);
+	if (it_waiting != m_sounds_waiting.end()) {
+		// the id may be used again while the sound still decodes
+		std::vector<sound_handle_t> &ids = m_sounds_decoding[it_waiting->second.sound_name];
+		ids.erase(std::remove(ids.begin(), ids.end(), sound), ids.end());
+		m_sounds_waiting.erase(it_waiting);
+	}
+
 	reportRemovedSound(sound);
 }
 
@@ -418,6 +506,11 @@ void OpenALSoundManager::fadeSound(sound_handle_t soundid, f32 step, f32 target_
 	// Ignore the command if step isn't valid.
 	if (step == 0.0f)
 		return;
+	auto it_waiting = m_sounds_waiting.find(soundid);
+	if (it_waiting != m_sounds_waiting.end()) {
+		it_waiting->second.fade = {step, target_gain};
+		return;
+	}
 	auto sound_it = m_sounds_playing.find(soundid);
 	if (sound_it == m_sounds_playing.end())
 		return; // No sound to fade
@@ -432,6 +525,13 @@ void OpenALSoundManager::updateSoundPosVel(sound_handle_t id, const v3f &pos_,
 	v3f pos = swap_handedness(pos_);
 	v3f vel = swap_handedness(vel_);
 
+	auto it_waiting = m_sounds_waiting.find(id);
+	if (it_waiting != m_sounds_waiting.end()) {
+		if (it_waiting->second.pos_vel_opt.has_value())
+			it_waiting->second.pos_vel_opt = {pos, vel};
+		return;
+	}
+
 	auto i = m_sounds_playing.find(id);
 	if (i == m_sounds_playing.end())
 		return;
@@ -466,6 +566,8 @@ void *OpenALSoundManager::run()
 			mgr.loadSoundFileNoCheck(msg.name, msg.filepath); return Result::Ok; }
 		Result operator()(LoadSoundData &&msg) {
 			mgr.loadSoundDataNoCheck(msg.name, std::move(msg.filedata)); return Result::Ok; }
+		Result operator()(LoadSoundLazy &&msg) {
+			mgr.loadSoundLazyNoCheck(msg.name, std::move(msg.loader)); return Result::Ok; }
 		Result operator()(AddSoundToGroup &&msg) {
 			mgr.addSoundToGroup(msg.sound_name, msg.group_name); return Result::Ok; }
 
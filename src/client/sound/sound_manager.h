@@ -11,6 +11,7 @@
 #include "playing_sound.h"
 #include "al_extensions.h"
 #include "sound_constants.h"
+#include "sound_decoder.h"
 #include "sound_manager_messages.h"
 #include "../sound.h"
 #include "threading/thread.h"
@@ -50,6 +51,26 @@ class OpenALSoundManager final : public Thread
 	// sound groups
 	std::unordered_map<std::string, std::vector<std::string>> m_sound_groups;
 
+	// sounds that are being decoded, with the ids of the sounds waiting for them
+	std::unordered_map<std::string, std::vector<sound_handle_t>> m_sounds_decoding;
+	SoundDecoder m_decoder{SOUND_DECODE_THREADS};
+
+	// a sound to play once its data is decoded
+	struct WaitingSound {
+		std::string sound_name;
+		bool loop;
+		f32 volume;
+		f32 pitch;
+		f32 start_time;
+		std::optional<std::pair<v3f, v3f>> pos_vel_opt;
+		// step and target gain of a fade
+		std::optional<std::pair<f32, f32>> fade;
+	};
+	std::unordered_map<sound_handle_t, WaitingSound> m_sounds_waiting;
+
+	// in sound-space
+	v3f m_listener_pos;
+
 	// currently playing sounds
 	std::unordered_map<sound_handle_t, std::shared_ptr<PlayingSound>> m_sounds_playing;
 
@@ -77,20 +98,31 @@ class OpenALSoundManager final : public Thread
 	void doFades(f32 dtime);
 
 	/**
-	 * Gives the open sound for a loaded sound.
-	 * Opens the sound if currently unopened.
+	 * Queues an unopen sound for decoding, or raises its priority if it's
+	 * being decoded already.
 	 *
-	 * @param sound_name Name of the sound.
-	 * @return The open sound.
+	 * @return false if the sound is neither unopen nor being decoded.
+	 */
+	bool requestDecode(const std::string &sound_name, f32 priority);
+
+	/**
+	 * Creates the open sounds that were decoded, and plays the sounds that
+	 * waited for them.
 	 */
-	std::shared_ptr<ISoundDataOpen> openSingleSound(const std::string &sound_name);
+	void finishDecodedSounds();
+
+	// Removes a sound that could not be opened from all groups
+	void removeSoundFromGroups(const std::string &sound_name);
+
+	// Decode priority of a sound, about how loud it is at the listener
+	f32 getAudibility(f32 volume, const std::optional<std::pair<v3f, v3f>> &pos_vel_opt) const;
 
 	/**
 	 * Gets a random sound name from a group.
 	 *
 	 * @param group_name The name of the sound group.
-	 * @return The name of a sound in the group, or "" on failure. Getting the
-	 *         sound with `openSingleSound` directly afterwards will not fail.
+	 * @return The name of a sound in the group that is open, unopen or being
+	 *         decoded, or "" on failure.
 	 */
 	std::string getLoadedSoundNameFromGroup(const std::string &group_name);
 
@@ -101,8 +133,11 @@ class OpenALSoundManager final : public Thread
 	std::string getOrLoadLoadedSoundNameFromGroup(const std::string &group_name);
 
 	std::shared_ptr<PlayingSound> createPlayingSound(const std::string &sound_name,
-			bool loop, f32 volume, f32 pitch, f32 start_time,
-			const std::optional<std::pair<v3f, v3f>> &pos_vel_opt);
+			std::shared_ptr<ISoundDataOpen> lsnd, bool loop, f32 volume, f32 pitch,
+			f32 start_time, const std::optional<std::pair<v3f, v3f>> &pos_vel_opt);
+
+	void startPlayingSound(sound_handle_t id, std::shared_ptr<ISoundDataOpen> lsnd,
+			const WaitingSound &snd);
 
 	void playSoundGeneric(sound_handle_t id, const std::string &group_name, bool loop,
 			f32 volume, f32 fade, f32 pitch, bool use_local_fallback, f32 start_time,
@@ -137,6 +172,7 @@ class OpenALSoundManager final : public Thread
 	bool loadSoundData(const std::string &name, std::string &&filedata);
 	void loadSoundFileNoCheck(const std::string &name, const std::string &filepath);
 	void loadSoundDataNoCheck(const std::string &name, std::string &&filedata);
+	void loadSoundLazyNoCheck(const std::string &name, std::function<std::string()> &&loader);
 	void addSoundToGroup(const std::string &sound_name, const std::string &group_name);
 
 	void playSound(sound_handle_t id, const SoundSpec &spec);
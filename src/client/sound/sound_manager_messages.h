@@ -19,6 +19,7 @@ namespace sound_manager_messages_to_mgr {
 
 	struct LoadSoundFile { std::string name; std::string filepath; };
 	struct LoadSoundData { std::string name; std::string filedata; };
+	struct LoadSoundLazy { std::string name; std::function<std::string()> loader; };
 	struct AddSoundToGroup { std::string sound_name; std::string group_name; };
 
 	struct PlaySound { sound_handle_t id; SoundSpec spec; };
@@ -41,6 +42,7 @@ using SoundManagerMsgToMgr = std::variant<
 
 		sound_manager_messages_to_mgr::LoadSoundFile,
 		sound_manager_messages_to_mgr::LoadSoundData,
+		sound_manager_messages_to_mgr::LoadSoundLazy,
 		sound_manager_messages_to_mgr::AddSoundToGroup,
 
 		sound_manager_messages_to_mgr::PlaySound,
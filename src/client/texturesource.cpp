@@ -5,13 +5,20 @@
 #include "texturesource.h"
 
 #include <IVideoDriver.h>
+#include "filesys.h"
+#include "generatedimagecache.h"
 #include "guiscalingfilter.h"
 #include "imagefilters.h"
 #include "imagesource.h"
+#include "porting.h"
 #include "renderingengine.h"
 #include "settings.h"
 #include "texturepaths.h"
+#include "threading/thread.h"
+#include "threading/workerpool.h"
 #include "util/thread.h"
+#include <algorithm>
+#include <unordered_set>
 
 
 // Stores internal information about a texture.
@@ -130,21 +137,34 @@ class TextureSource final : public IWritableTextureSource
 
 	video::SColor getTextureAverageColor(const std::string &name);
 
+	video::ITexture *getArrayTexture(const std::vector<u32> &ids);
+
 	void setImageCaching(bool enabled);
 
+	void prefetchTexturesForMesh(const std::vector<std::string> &names);
+
 private:
 	// Gets or generates an image for a texture string
 	// Caller needs to drop the returned image
 	video::IImage *getOrGenerateImage(const std::string &name,
 		std::set<std::string> &source_image_names);
 
+	// Generates an image, or loads it from m_generated_cache
+	// Thread-safe like ImageSource::generateImage()
+	video::IImage *generateOrLoadImage(const std::string &name,
+		std::set<std::string> &source_image_names);
+
 	// The id of the thread that is allowed to use irrlicht directly
 	std::thread::id m_main_thread;
 
 	// Generates and caches source images
-	// This should be only accessed from the main thread
+	// This should be only accessed from the main thread, or from the
+	// workers of prefetchTexturesForMesh()
 	ImageSource m_imagesource;
 
+	// Generated images on disk, if enabled
+	std::unique_ptr<GeneratedImageCache> m_generated_cache;
+
 	// Is the image cache enabled?
 	bool m_image_cache_enabled = false;
 	// Caches finished texture images before they are uploaded to the GPU
@@ -156,9 +176,21 @@ class TextureSource final : public IWritableTextureSource
 	// You ARE expected to be holding m_textureinfo_cache_mutex
 	void rebuildTexture(video::IVideoDriver *driver, TextureInfo &ti);
 
+	// Copies the rebuilt texture into the array textures that contain it
+	// You ARE expected to be holding m_textureinfo_cache_mutex
+	void updateArrayLayers(u32 id);
+
 	// Generate a texture
 	u32 generateTexture(const std::string &name);
 
+	// Creates a texture that can be evicted if there is a texture budget
+	video::ITexture *addTexture(video::IVideoDriver *driver,
+		const std::string &name, video::IImage *img);
+
+	// Frees the video memory of the least recently used textures
+	// until they fit into the budget
+	void evictTextures(video::IVideoDriver *driver);
+
 	// Thread-safe cache of what source images are known (true = known)
 	MutexedMap<std::string, bool> m_source_image_existence;
 
@@ -173,6 +205,9 @@ class TextureSource final : public IWritableTextureSource
 	// Queued texture fetches (to be processed by the main thread)
 	RequestQueue<std::string, u32, std::thread::id, u8> m_get_texture_queue;
 
+	// Array textures and the texture ids of their layers
+	std::vector<std::pair<video::ITexture*, std::vector<u32>>> m_array_textures;
+
 	// Textures that have been overwritten with other ones
 	// but can't be deleted because the ITexture* might still be used
 	std::vector<video::ITexture*> m_texture_trash;
@@ -182,6 +217,11 @@ class TextureSource final : public IWritableTextureSource
 
 	// Cached from settings for making textures from meshes
 	bool mesh_filter_needed;
+
+	// Video memory for textures in bytes, 0 if unlimited
+	u64 m_texture_budget = 0;
+	// Frame in which evictTextures() last ran
+	u32 m_eviction_frame = 0;
 };
 
 IWritableTextureSource *createTextureSource()
@@ -205,6 +245,17 @@ TextureSource::TextureSource()
 			g_settings->getBool("trilinear_filter") ||
 			g_settings->getBool("bilinear_filter") ||
 			g_settings->getBool("anisotropic_filter");
+	m_texture_budget = (u64)g_settings->getU32("texture_memory_budget") << 20;
+
+	if (g_settings->getBool("texture_disk_cache")) {
+		// everything that ImageSource reads from the settings
+		std::string settings;
+		for (const char *name : {"mip_map", "trilinear_filter", "bilinear_filter",
+				"anisotropic_filter", "texture_min_size"})
+			settings.append(name).append("=").append(g_settings->get(name)).append(";");
+		m_generated_cache = std::make_unique<GeneratedImageCache>(
+			porting::path_cache + DIR_DELIM + "textures", settings);
+	}
 }
 
 TextureSource::~TextureSource()
@@ -223,6 +274,10 @@ TextureSource::~TextureSource()
 	}
 	m_textureinfo_cache.clear();
 
+	for (const auto &it : m_array_textures)
+		driver->removeTexture(it.first);
+	m_array_textures.clear();
+
 	for (auto t : m_texture_trash) {
 		driver->removeTexture(t);
 	}
@@ -242,7 +297,7 @@ video::IImage *TextureSource::getOrGenerateImage(const std::string &name,
 	}
 
 	std::set<std::string> tmp;
-	auto *img = m_imagesource.generateImage(name, tmp);
+	auto *img = generateOrLoadImage(name, tmp);
 	if (img && m_image_cache_enabled) {
 		img->grab();
 		m_image_cache[name] = {img, tmp};
@@ -328,7 +383,7 @@ u32 TextureSource::generateTexture(const std::string &name)
 
 	if (img) {
 		// Create texture from resulting image
-		tex = driver->addTexture(name.c_str(), img);
+		tex = addTexture(driver, name, img);
 		guiScalingCache(io::path(name.c_str()), driver, img);
 		img->drop();
 	}
@@ -345,6 +400,67 @@ u32 TextureSource::generateTexture(const std::string &name)
 	return id;
 }
 
+video::ITexture *TextureSource::addTexture(video::IVideoDriver *driver,
+		const std::string &name, video::IImage *img)
+{
+	if (!m_texture_budget)
+		return driver->addTexture(name.c_str(), img);
+
+	driver->setTextureCreationFlag(video::ETCF_ALLOW_EVICTION, true);
+	auto *tex = driver->addTexture(name.c_str(), img);
+	driver->setTextureCreationFlag(video::ETCF_ALLOW_EVICTION, false);
+	return tex;
+}
+
+static u64 getTextureMemory(const video::ITexture *tex)
+{
+	const auto dim = tex->getSize();
+	u64 size = video::IImage::getDataSizeFromFormat(tex->getColorFormat(),
+		dim.Width, dim.Height);
+	if (tex->hasMipMaps())
+		size += size / 3;
+	return size;
+}
+
+void TextureSource::evictTextures(video::IVideoDriver *driver)
+{
+	// Textures are only marked as used when drawn, so checking a few
+	// times per second is enough
+	const u32 frame = driver->getFrameNumber();
+	if (!m_texture_budget || frame - m_eviction_frame < 30)
+		return;
+	m_eviction_frame = frame;
+
+	MutexAutoLock lock(m_textureinfo_cache_mutex);
+
+	std::vector<video::ITexture*> resident;
+	u64 total = 0;
+	for (const auto &ti : m_textureinfo_cache) {
+		if (ti.texture && ti.texture->isResident()) {
+			resident.push_back(ti.texture);
+			total += getTextureMemory(ti.texture);
+		}
+	}
+	if (total <= m_texture_budget)
+		return;
+
+	std::sort(resident.begin(), resident.end(), [] (auto *a, auto *b) {
+		return a->getLastUsedFrame() < b->getLastUsedFrame();
+	});
+	u32 evicted = 0;
+	for (auto *tex : resident) {
+		// Don't evict what's on the screen right now
+		if (total <= m_texture_budget || tex->getLastUsedFrame() + 1 >= frame)
+			break;
+		if (tex->evict()) {
+			total -= getTextureMemory(tex);
+			evicted++;
+		}
+	}
+	verbosestream << "TextureSource: evicted " << evicted << " textures, "
+			<< (total >> 20) << " MiB left" << std::endl;
+}
+
 std::string TextureSource::getTextureName(u32 id)
 {
 	MutexAutoLock lock(m_textureinfo_cache_mutex);
@@ -452,6 +568,8 @@ void TextureSource::processQueue()
 
 		m_get_texture_queue.pushResult(request, generateTexture(request.key));
 	}
+
+	evictTextures(RenderingEngine::get_video_driver());
 }
 
 void TextureSource::insertSourceImage(const std::string &name, video::IImage *img)
@@ -469,12 +587,14 @@ void TextureSource::insertSourceImage(const std::string &name, video::IImage *im
 
 	// Recreate affected textures
 	u32 affected = 0;
-	for (TextureInfo &ti : m_textureinfo_cache) {
+	for (u32 id = 0; id < m_textureinfo_cache.size(); id++) {
+		TextureInfo &ti = m_textureinfo_cache[id];
 		if (ti.name.empty())
 			continue; // Skip dummy entry
 		// If the source image was used, we need to rebuild this texture
 		if (ti.sourceImages.find(name) != ti.sourceImages.end()) {
 			rebuildTexture(driver, ti);
+			updateArrayLayers(id);
 			affected++;
 		}
 	}
@@ -503,10 +623,12 @@ void TextureSource::rebuildImagesAndTextures()
 	assert(!m_image_cache_enabled || m_image_cache.empty());
 
 	// Recreate textures
-	for (TextureInfo &ti : m_textureinfo_cache) {
+	for (u32 id = 0; id < m_textureinfo_cache.size(); id++) {
+		TextureInfo &ti = m_textureinfo_cache[id];
 		if (ti.name.empty())
 			continue; // Skip dummy entry
 		rebuildTexture(driver, ti);
+		updateArrayLayers(id);
 	}
 
 	// FIXME: we should rebuild palettes too
@@ -538,7 +660,7 @@ void TextureSource::rebuildTexture(video::IVideoDriver *driver, TextureInfo &ti)
 		}
 	} else {
 		// create new one
-		t = driver->addTexture(ti.name.c_str(), img);
+		t = addTexture(driver, ti.name, img);
 	}
 	if (img)
 		guiScalingCache(io::path(ti.name.c_str()), driver, img);
@@ -552,6 +674,76 @@ void TextureSource::rebuildTexture(video::IVideoDriver *driver, TextureInfo &ti)
 		m_texture_trash.push_back(t_old);
 }
 
+void TextureSource::updateArrayLayers(u32 id)
+{
+	if (m_array_textures.empty())
+		return;
+
+	video::ITexture *t = m_textureinfo_cache[id].texture;
+	for (const auto &it : m_array_textures) {
+		video::ITexture *array = it.first;
+		for (u32 layer = 0; layer < it.second.size(); layer++) {
+			if (it.second[layer] != id)
+				continue;
+			// a texture of another size or format can't go into the array,
+			// the layer keeps the old image then
+			if (!t || t->getSize() != array->getSize() ||
+					t->getColorFormat() != array->getColorFormat()) {
+				warningstream << "TextureSource: \"" << m_textureinfo_cache[id].name
+					<< "\" no longer fits into its array texture" << std::endl;
+				continue;
+			}
+			std::set<std::string> unused;
+			video::IImage *img = getOrGenerateImage(m_textureinfo_cache[id].name, unused);
+			if (!img)
+				continue;
+			void *ptr = array->lock(video::ETLM_WRITE_ONLY, 0, layer);
+			if (ptr) {
+				memcpy(ptr, img->getData(), img->getImageDataSizeInBytes());
+				array->unlock();
+				array->regenerateMipMapLevels(layer);
+			}
+			img->drop();
+		}
+	}
+}
+
+video::ITexture *TextureSource::getArrayTexture(const std::vector<u32> &ids)
+{
+	sanity_check(std::this_thread::get_id() == m_main_thread);
+
+	video::IVideoDriver *driver = RenderingEngine::get_video_driver();
+	if (ids.empty() || !driver->queryFeature(video::EVDF_TEXTURE_2D_ARRAY))
+		return nullptr;
+
+	MutexAutoLock lock(m_textureinfo_cache_mutex);
+
+	std::vector<video::IImage*> images;
+	images.reserve(ids.size());
+	std::set<std::string> unused;
+	for (u32 id : ids) {
+		video::IImage *img = nullptr;
+		if (id > 0 && id < m_textureinfo_cache.size())
+			img = getOrGenerateImage(m_textureinfo_cache[id].name, unused);
+		if (!img)
+			break;
+		images.push_back(img);
+	}
+
+	video::ITexture *t = nullptr;
+	if (images.size() == ids.size()) {
+		std::string name = "__array_texture_" + std::to_string(m_array_textures.size());
+		// fails if the images are not all of the same size and format
+		t = driver->addArrayTexture(name.c_str(), images.data(), images.size());
+	}
+	for (video::IImage *img : images)
+		img->drop();
+
+	if (t)
+		m_array_textures.emplace_back(t, ids);
+	return t;
+}
+
 video::SColor TextureSource::getTextureAverageColor(const std::string &name)
 {
 	assert(std::this_thread::get_id() == m_main_thread);
@@ -578,3 +770,62 @@ void TextureSource::setImageCaching(bool enabled)
 		m_image_cache.clear();
 	}
 }
+
+video::IImage *TextureSource::generateOrLoadImage(const std::string &name,
+		std::set<std::string> &source_image_names)
+{
+	const bool cached = m_generated_cache &&
+		GeneratedImageCache::isWorthCaching(name);
+	if (cached) {
+		video::IImage *img = m_generated_cache->load(name, m_imagesource,
+			source_image_names);
+		if (img)
+			return img;
+	}
+
+	video::IImage *img = m_imagesource.generateImage(name, source_image_names);
+	if (img && cached)
+		m_generated_cache->store(name, img, source_image_names, m_imagesource);
+	return img;
+}
+
+void TextureSource::prefetchTexturesForMesh(const std::vector<std::string> &names)
+{
+	sanity_check(std::this_thread::get_id() == m_main_thread);
+	if (!m_image_cache_enabled)
+		return;
+
+	// Both the plain name and the one used by getTextureForMesh() are
+	// generated, the former is needed for the average color.
+	std::vector<std::string> todo;
+	std::unordered_set<std::string> seen;
+	const auto add = [&] (const std::string &name) {
+		if (!name.empty() && m_image_cache.count(name) == 0 &&
+				seen.insert(name).second)
+			todo.push_back(name);
+	};
+	for (const auto &name : names) {
+		add(name);
+		if (mesh_filter_needed && !name.empty())
+			add(name + "^[applyfiltersformesh");
+	}
+	if (todo.empty())
+		return;
+
+	std::vector<ImageInfo> images(todo.size());
+	{
+		WorkerPool pool("ImagePrefetch",
+			std::max(Thread::getNumberOfProcessors(), 1U) - 1);
+		pool.run(todo.size(), [&] (size_t i) {
+			images[i].image = generateOrLoadImage(todo[i],
+				images[i].sourceImages);
+		});
+	}
+
+	for (size_t i = 0; i < todo.size(); i++) {
+		if (images[i].image)
+			m_image_cache[todo[i]] = std::move(images[i]);
+	}
+	infostream << "TextureSource: prefetched " << todo.size() << " images"
+		<< std::endl;
+}
@@ -70,6 +70,15 @@ class ITextureSource : public ISimpleTextureSource
 	/// @brief Return average color of a texture string
 	virtual video::SColor getTextureAverageColor(const std::string &name)=0;
 
+	/**
+	 * Packs textures of the same size into the layers of an array texture,
+	 * in the given order. The layers follow changes of the textures.
+	 * Must be called from the main thread.
+	 * @param ids texture ids
+	 * @return the array texture, or nullptr if it can't be created
+	 */
+	virtual video::ITexture *getArrayTexture(const std::vector<u32> &ids)=0;
+
 	// Note: this method is here because caching is the decision of the
 	// API user, even if his access is read-only.
 
@@ -80,6 +89,14 @@ class ITextureSource : public ISimpleTextureSource
 	 * @note Disabling caching will flush the cache.
 	 */
 	virtual void setImageCaching(bool enabled) {};
+
+	/**
+	 * Generates the images of textures for meshes on all cores, for later
+	 * getTextureForMesh() and getTextureAverageColor() calls, which then
+	 * only have to upload them. Only works while image caching is enabled.
+	 * Must be called from the main thread.
+	 */
+	virtual void prefetchTexturesForMesh(const std::vector<std::string> &names) {};
 };
 
 class IWritableTextureSource : public ITextureSource
@@ -118,13 +118,23 @@ struct TileLayer
 
 	video::ITexture *texture = nullptr;
 
+	/// array texture that also contains `texture`, if any
+	/// @see NodeDefManager::updateTextures
+	video::ITexture *array_texture = nullptr;
+
 	u32 shader_id = 0;
 
 	u32 texture_id = 0;
 
+	/// shader to use together with `array_texture`
+	u32 array_shader_id = 0;
+
 	u16 animation_frame_length_ms = 0;
 	u16 animation_frame_count = 1;
 
+	/// index of `texture` in `array_texture`
+	u16 array_layer = 0;
+
 	MaterialType material_type = TILE_MATERIAL_BASIC;
 	u8 material_flags =
 		//0 // <- DEBUG, Use the one below
@@ -18,6 +18,7 @@
 #include "log.h"
 #include "util/numeric.h"
 #include <map>
+#include <sstream>
 #include <IMeshManipulator.h>
 #include "client/renderingengine.h"
 #include <SMesh.h>
@@ -345,6 +346,43 @@ static scene::SMesh *createGenericNodeMesh(Client *client, MapNode n,
 }
 
 void WieldMeshSceneNode::setItem(const ItemStack &item, Client *client, bool check_wield_image)
+{
+	createItemMesh(item, client, check_wield_image);
+	if (!m_instanced || !m_meshnode->isVisible())
+		return;
+
+	// everything that the mesh is made from
+	IItemDefManager *idef = client->getItemDefManager();
+	std::ostringstream key;
+	key << item.name << '\n';
+	if (check_wield_image)
+		key << item.getWieldImage(idef) << '\n' << item.getWieldOverlay(idef) << '\n';
+	key << item.getInventoryImage(idef) << '\n' << item.getInventoryOverlay(idef)
+		<< '\n' << m_base_color.color;
+	shareMesh(key.str(), client);
+}
+
+void WieldMeshSceneNode::shareMesh(const std::string &key, Client *client)
+{
+	scene::IMesh *mesh = m_meshnode->getMesh();
+	scene::IMesh *shared = client->getItemVisualsManager()->getSharedMesh(key, mesh);
+	if (shared != mesh) {
+		std::vector<video::SMaterial> materials;
+		for (u32 i = 0; i < m_meshnode->getMaterialCount(); ++i)
+			materials.push_back(m_meshnode->getMaterial(i));
+		m_meshnode->setMesh(shared);
+		for (u32 i = 0; i < materials.size(); ++i)
+			m_meshnode->getMaterial(i) = materials[i];
+	}
+
+	IShaderSource *shdrsrc = client->getShaderSource();
+	u32 shader_id = shdrsrc->getShader("object_shader", TILE_MATERIAL_BASIC,
+		NDT_NORMAL, false, false, true);
+	m_meshnode->setInstancedMaterialType(shdrsrc->getShaderInfo(shader_id).material);
+}
+
+void WieldMeshSceneNode::createItemMesh(const ItemStack &item, Client *client,
+		bool check_wield_image)
 {
 	ITextureSource *tsrc = client->getTextureSource();
 	IItemDefManager *idef = client->getItemDefManager();
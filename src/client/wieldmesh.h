@@ -105,6 +105,10 @@ class WieldMeshSceneNode : public scene::ISceneNode
 	void setItem(const ItemStack &item, Client *client,
 			bool check_wield_image = true);
 
+	// Shares the mesh with other nodes that show the same item, so that the
+	// scene manager can draw them at once. Must be called before setItem.
+	void setInstanced(bool instanced) { m_instanced = instanced; }
+
 	// Sets the vertex color of the wield mesh.
 	// Must only be used if the constructor was called with lighting = false
 	void setColor(video::SColor color);
@@ -118,11 +122,16 @@ class WieldMeshSceneNode : public scene::ISceneNode
 	virtual const aabb3f &getBoundingBox() const { return m_bounding_box; }
 
 private:
+	void createItemMesh(const ItemStack &item, Client *client,
+			bool check_wield_image);
 	void changeToMesh(scene::IMesh *mesh);
+	// Replaces the mesh by the shared one, keeping the materials
+	void shareMesh(const std::string &key, Client *client);
 
 	// Child scene node with the current wield mesh
 	scene::IMeshSceneNode *m_meshnode = nullptr;
 	video::E_MATERIAL_TYPE m_material_type;
+	bool m_instanced = false;
 
 	bool m_anisotropic_filter;
 	bool m_bilinear_filter;
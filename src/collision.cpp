@@ -3,7 +3,9 @@
 // Copyright (C) 2013 celeron55, Perttu Ahola <celeron55@gmail.com>
 
 #include "collision.h"
+#include <algorithm>
 #include <cmath>
+#include <unordered_map>
 #include "irr_aabb3d.h"
 #include "mapblock.h"
 #include "map.h"
@@ -27,34 +29,49 @@ bool g_collision_problems_encountered = false;
 
 namespace {
 
-struct NearbyCollisionInfo {
-	// node
-	NearbyCollisionInfo(bool is_ul, int bouncy, v3s16 pos, const aabb3f &box) :
-		obj(nullptr),
-		box(box),
-		position(pos),
-		bouncy(bouncy),
-		is_unloaded(is_ul),
-		is_step_up(false)
-	{}
-
-	// object
-	NearbyCollisionInfo(ActiveObject *obj, int bouncy, const aabb3f &box) :
-		obj(obj),
-		box(box),
-		bouncy(bouncy),
-		is_unloaded(false),
-		is_step_up(false)
-	{}
-
-	inline bool isObject() const { return obj != nullptr; }
-
-	ActiveObject *obj;
-	aabb3f box;
-	v3s16 position;
-	u8 bouncy;
-	// bitfield to save space
-	bool is_unloaded:1, is_step_up:1;
+// Most objects only need one or a few blocks; fast ones that need more
+// are left to collisionMoveSimple()
+constexpr size_t MAX_PREPARED_BLOCKS = 27;
+
+// Collision boxes of the nodes seen recently, relative to the node position.
+// They only depend on the node and the neighbors it connects to, so the
+// nodes of the same kind around every object only have to be resolved once.
+class NodeBoxCache
+{
+public:
+	struct Entry {
+		std::vector<aabb3f> boxes;
+		u8 bouncy;
+	};
+
+	const Entry &get(const NodeDefManager *nodedef, MapNode n, u8 neighbors)
+	{
+		if (nodedef != m_nodedef || nodedef->getModificationCounter() != m_counter ||
+				m_entries.size() >= MAX_ENTRIES) {
+			m_entries.clear();
+			m_nodedef = nodedef;
+			m_counter = nodedef->getModificationCounter();
+		}
+
+		const u32 key = n.getContent() | (u32)n.getParam2() << 16 |
+			(u32)neighbors << 24;
+		auto it = m_entries.find(key);
+		if (it != m_entries.end())
+			return it->second;
+
+		Entry &entry = m_entries[key];
+		n.getCollisionBoxes(nodedef, &entry.boxes, neighbors);
+		// Negative bouncy may have a meaning, but we need +value here.
+		entry.bouncy = abs(itemgroup_get(nodedef->get(n).groups, "bouncy"));
+		return entry;
+	}
+
+private:
+	static constexpr size_t MAX_ENTRIES = 4096;
+
+	const NodeDefManager *m_nodedef = nullptr;
+	u32 m_counter = 0;
+	std::unordered_map<u32, Entry> m_entries;
 };
 
 // Helper functions:
@@ -217,16 +234,16 @@ bool wouldCollideWithCeiling(
 	return false;
 }
 
-static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *gamedef,
-		Environment *env, std::vector<NearbyCollisionInfo> &cinfo)
+// get_block(bp) returns the block at a block position or nullptr,
+// get_neighbors(n, p) the neighbors that a node connects to
+template <typename GetBlock, typename GetNeighbors>
+static bool add_area_node_boxes(const v3s16 min, const v3s16 max,
+		const NodeDefManager *nodedef, GetBlock get_block,
+		GetNeighbors get_neighbors, std::vector<NearbyCollisionInfo> &cinfo)
 {
-	const auto *nodedef = gamedef->getNodeDefManager();
 	bool any_position_valid = false;
 
-	thread_local std::vector<aabb3f> nodeboxes;
-	Map *map = &env->getMap();
-
-	const bool air_walkable = nodedef->get(CONTENT_AIR).walkable;
+	thread_local NodeBoxCache nodebox_cache;
 
 	v3s16 last_bp(S16_MAX);
 	MapBlock *last_block = nullptr;
@@ -241,7 +258,7 @@ static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *game
 		v3s16 bp, relp;
 		getNodeBlockPosWithOffset(p, bp, relp);
 		if (bp != last_bp) {
-			last_block = map->getBlockNoCreateNoEx(bp);
+			last_block = get_block(bp);
 			last_bp = bp;
 		}
 		MapBlock *const block = last_block;
@@ -260,35 +277,39 @@ static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *game
 			continue;
 		}
 
-		if (!air_walkable && block->isAir()) {
-			// Skip ahead if air, like above
+		const MapBlock::Walkability walkability = block->getWalkability(nodedef);
+		if (walkability == MapBlock::WALKABLE_NONE) {
+			// Skip ahead if nothing collides, like above
 			any_position_valid = true;
 			p.X = bp.X * MAP_BLOCKSIZE + MAP_BLOCKSIZE - 1;
 			continue;
 		}
+		if (walkability == MapBlock::WALKABLE_FULL) {
+			// Same as below, without looking at the nodes
+			any_position_valid = true;
+			const s16 rowend = std::min<s16>(max.X,
+				bp.X * MAP_BLOCKSIZE + MAP_BLOCKSIZE - 1);
+			for (; p.X <= rowend; p.X++)
+				cinfo.emplace_back(false, 0, p, getNodeBox(p, BS));
+			p.X = rowend;
+			continue;
+		}
 
 		const MapNode n = block->getNodeNoCheck(relp);
 
 		if (n.getContent() != CONTENT_IGNORE) {
 			any_position_valid = true;
-			const ContentFeatures &f = nodedef->get(n);
-
-			if (!f.walkable)
+			if (!nodedef->getShapeFlags(n).walkable)
 				continue;
 
-			// Negative bouncy may have a meaning, but we need +value here.
-			int n_bouncy_value = abs(itemgroup_get(f.groups, "bouncy"));
-
-			u8 neighbors = n.getNeighbors(p, map);
-
-			nodeboxes.clear();
-			n.getCollisionBoxes(nodedef, &nodeboxes, neighbors);
+			u8 neighbors = get_neighbors(n, p);
+			const auto &entry = nodebox_cache.get(nodedef, n, neighbors);
 
 			v3f posf = intToFloat(p, BS);
-			for (auto box : nodeboxes) {
+			for (auto box : entry.boxes) {
 				box.MinEdge += posf;
 				box.MaxEdge += posf;
-				cinfo.emplace_back(false, n_bouncy_value, p, box);
+				cinfo.emplace_back(false, entry.bouncy, p, box);
 			}
 		} else {
 			// Collide with loaded CONTENT_IGNORE nodes
@@ -300,6 +321,132 @@ static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *game
 	return any_position_valid;
 }
 
+static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *gamedef,
+		Environment *env, std::vector<NearbyCollisionInfo> &cinfo)
+{
+	Map *map = &env->getMap();
+	return add_area_node_boxes(min, max, gamedef->getNodeDefManager(),
+		[map] (v3s16 bp) { return map->getBlockNoCreateNoEx(bp); },
+		[map] (MapNode n, v3s16 p) { return n.getNeighbors(p, map); },
+		cinfo);
+}
+
+// Area that an object may touch while moving, in nodes
+static void get_movement_area(const aabb3f &box_0, f32 dtime,
+		v3f pos_f, v3f aspeed_f, v3s16 &min, v3s16 &max)
+{
+	// Movement if no collisions
+	v3f newpos_f = pos_f + aspeed_f * dtime;
+	v3f minpos_f(
+		MYMIN(pos_f.X, newpos_f.X),
+		MYMIN(pos_f.Y, newpos_f.Y) + 0.01f * BS, // bias rounding, player often at +/-n.5
+		MYMIN(pos_f.Z, newpos_f.Z)
+	);
+	v3f maxpos_f(
+		MYMAX(pos_f.X, newpos_f.X),
+		MYMAX(pos_f.Y, newpos_f.Y),
+		MYMAX(pos_f.Z, newpos_f.Z)
+	);
+	min = floatToInt(minpos_f + box_0.MinEdge, BS) - v3s16(1, 1, 1);
+	max = floatToInt(maxpos_f + box_0.MaxEdge, BS) + v3s16(1, 1, 1);
+}
+
+static v3f get_average_speed(f32 dtime, v3f speed_f, v3f accel_f)
+{
+	v3f aspeed_f = speed_f + accel_f * 0.5f * dtime;
+	// Limit speed for avoiding hangs
+	return truncate(rangelimv(aspeed_f, -5000.0f, 5000.0f), 10000.0f);
+}
+
+// Whether the prepared boxes can be used for a movement in the given area
+static bool node_boxes_valid(Map *map, const CollisionNodeBoxes &node_boxes,
+		v3s16 min, v3s16 max)
+{
+	if (!node_boxes.ready || node_boxes.min != min || node_boxes.max != max)
+		return false;
+	for (const auto &b : node_boxes.blocks) {
+		MapBlock *block = map->getBlockNoCreateNoEx(b.pos);
+		if (block != b.block || (block &&
+				block->getModificationCounter() != b.modification_counter))
+			return false;
+	}
+	return true;
+}
+
+bool collisionPrepareNodeBoxes(Map *map, const aabb3f &box_0, f32 dtime,
+		v3f pos_f, v3f speed_f, v3f accel_f, CollisionNodeBoxes &node_boxes)
+{
+	node_boxes.ready = false;
+	node_boxes.blocks.clear();
+	node_boxes.cinfo.clear();
+
+	// see collisionMoveSimple()
+	if (speed_f == v3f() && accel_f == v3f())
+		return false;
+	dtime = std::min(dtime, DTIME_LIMIT);
+	get_movement_area(box_0, dtime, pos_f,
+		get_average_speed(dtime, speed_f, accel_f),
+		node_boxes.min, node_boxes.max);
+
+	// connected node boxes look at the neighbors
+	const v3s16 bmin = getNodeBlockPos(node_boxes.min - v3s16(1, 1, 1));
+	const v3s16 bmax = getNodeBlockPos(node_boxes.max + v3s16(1, 1, 1));
+	const v3s32 size = v3s32(bmax.X, bmax.Y, bmax.Z) -
+		v3s32(bmin.X, bmin.Y, bmin.Z) + v3s32(1, 1, 1);
+	if ((size_t)size.X * size.Y * size.Z > MAX_PREPARED_BLOCKS)
+		return false;
+
+	v3s16 bp;
+	for (bp.Z = bmin.Z; bp.Z <= bmax.Z; bp.Z++)
+	for (bp.Y = bmin.Y; bp.Y <= bmax.Y; bp.Y++)
+	for (bp.X = bmin.X; bp.X <= bmax.X; bp.X++) {
+		MapBlock *block = map->getBlockNoCreateNoEx(bp);
+		if (block) {
+			// update the cached flag now, gathering must not write to the block
+			block->getWalkability(map->getNodeDefManager());
+			node_boxes.blocks.push_back({bp, block, block->getModificationCounter()});
+		} else {
+			node_boxes.blocks.push_back({bp, nullptr, 0});
+		}
+	}
+	return true;
+}
+
+void collisionGatherNodeBoxes(const NodeDefManager *nodedef,
+		CollisionNodeBoxes &node_boxes)
+{
+	const auto get_block = [&node_boxes] (v3s16 bp) -> MapBlock * {
+		for (const auto &b : node_boxes.blocks) {
+			if (b.pos == bp)
+				return b.block;
+		}
+		return nullptr;
+	};
+	// same as MapNode::getNeighbors()
+	const auto get_neighbors = [&] (MapNode n, v3s16 p) -> u8 {
+		if (!nodedef->getShapeFlags(n).connected)
+			return 0;
+		static const std::pair<v3s16, u8> dirs[6] = {
+			{v3s16(0, 1, 0), 1}, {v3s16(0, -1, 0), 2}, {v3s16(0, 0, -1), 4},
+			{v3s16(-1, 0, 0), 8}, {v3s16(0, 0, 1), 16}, {v3s16(1, 0, 0), 32},
+		};
+		u8 neighbors = 0;
+		for (const auto &dir : dirs) {
+			v3s16 bp, relp;
+			getNodeBlockPosWithOffset(p + dir.first, bp, relp);
+			MapBlock *block = get_block(bp);
+			MapNode n2 = block ? block->getNodeNoCheck(relp) : MapNode(CONTENT_IGNORE);
+			if (nodedef->nodeboxConnects(n, n2, dir.second))
+				neighbors |= dir.second;
+		}
+		return neighbors;
+	};
+
+	node_boxes.any_position_valid = add_area_node_boxes(node_boxes.min,
+		node_boxes.max, nodedef, get_block, get_neighbors, node_boxes.cinfo);
+	node_boxes.ready = true;
+}
+
 static void add_object_boxes(Environment *env,
 		const aabb3f &box_0, f32 dtime,
 		const v3f pos_f, const v3f speed_f, ActiveObject *self,
@@ -378,7 +525,8 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		f32 stepheight, f32 dtime,
 		v3f *pos_f, v3f *speed_f,
 		v3f accel_f, ActiveObject *self,
-		bool collide_with_objects)
+		bool collide_with_objects,
+		CollisionNodeBoxes *node_boxes)
 {
 	static bool time_notification_done = false;
 
@@ -406,9 +554,7 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	}
 
 	// Average speed
-	v3f aspeed_f = *speed_f + accel_f * 0.5f * dtime;
-	// Limit speed for avoiding hangs
-	aspeed_f = truncate(rangelimv(aspeed_f, -5000.0f, 5000.0f), 10000.0f);
+	v3f aspeed_f = get_average_speed(dtime, *speed_f, accel_f);
 
 	// Collect node boxes in movement range
 
@@ -416,22 +562,18 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	thread_local std::vector<NearbyCollisionInfo> cinfo;
 	cinfo.clear();
 	{
-		// Movement if no collisions
-		v3f newpos_f = *pos_f + aspeed_f * dtime;
-		v3f minpos_f(
-			MYMIN(pos_f->X, newpos_f.X),
-			MYMIN(pos_f->Y, newpos_f.Y) + 0.01f * BS, // bias rounding, player often at +/-n.5
-			MYMIN(pos_f->Z, newpos_f.Z)
-		);
-		v3f maxpos_f(
-			MYMAX(pos_f->X, newpos_f.X),
-			MYMAX(pos_f->Y, newpos_f.Y),
-			MYMAX(pos_f->Z, newpos_f.Z)
-		);
-		v3s16 min = floatToInt(minpos_f + box_0.MinEdge, BS) - v3s16(1, 1, 1);
-		v3s16 max = floatToInt(maxpos_f + box_0.MaxEdge, BS) + v3s16(1, 1, 1);
+		v3s16 min, max;
+		get_movement_area(box_0, dtime, *pos_f, aspeed_f, min, max);
 
-		bool any_position_valid = add_area_node_boxes(min, max, gamedef, env, cinfo);
+		bool any_position_valid;
+		if (node_boxes && node_boxes_valid(&env->getMap(), *node_boxes, min, max)) {
+			cinfo = node_boxes->cinfo;
+			any_position_valid = node_boxes->any_position_valid;
+		} else {
+			any_position_valid = add_area_node_boxes(min, max, gamedef, env, cinfo);
+		}
+		if (node_boxes)
+			node_boxes->ready = false;
 
 		// Do not move if world has not loaded yet, since custom node boxes
 		// are not available for collision detection.
@@ -8,7 +8,9 @@
 #include <vector>
 
 class Map;
+class MapBlock;
 class IGameDef;
+class NodeDefManager;
 class Environment;
 class ActiveObject;
 
@@ -49,17 +51,82 @@ struct collisionMoveResult
 	std::vector<CollisionInfo> collisions;
 };
 
+struct NearbyCollisionInfo {
+	// node
+	NearbyCollisionInfo(bool is_ul, int bouncy, v3s16 pos, const aabb3f &box) :
+		obj(nullptr),
+		box(box),
+		position(pos),
+		bouncy(bouncy),
+		is_unloaded(is_ul),
+		is_step_up(false)
+	{}
+
+	// object
+	NearbyCollisionInfo(ActiveObject *obj, int bouncy, const aabb3f &box) :
+		obj(obj),
+		box(box),
+		bouncy(bouncy),
+		is_unloaded(false),
+		is_step_up(false)
+	{}
+
+	inline bool isObject() const { return obj != nullptr; }
+
+	ActiveObject *obj;
+	aabb3f box;
+	v3s16 position;
+	u8 bouncy;
+	// bitfield to save space
+	bool is_unloaded:1, is_step_up:1;
+};
+
+/// Node boxes in the movement range of an object, gathered ahead of
+/// collisionMoveSimple(). The blocks are looked up beforehand, so that
+/// gathering doesn't touch the map and can be done for many objects in
+/// parallel. The boxes are only used if the area and all of its blocks are
+/// still the same, otherwise they are gathered again.
+struct CollisionNodeBoxes
+{
+	struct Block {
+		v3s16 pos;
+		MapBlock *block;
+		u64 modification_counter;
+	};
+
+	// Area of the movement in nodes
+	v3s16 min, max;
+	// Blocks containing the area and the neighbors of its nodes
+	std::vector<Block> blocks;
+	std::vector<NearbyCollisionInfo> cinfo;
+	bool any_position_valid = false;
+	bool ready = false;
+};
+
 /// Status if any problems were ever encountered during collision detection.
 /// @warning For unit test use only.
 extern bool g_collision_problems_encountered;
 
 /// @param self (optional) ActiveObject to ignore in the collision detection.
+/// @param node_boxes (optional) node boxes gathered ahead of time, if any
 collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		const aabb3f &box_0,
 		f32 stepheight, f32 dtime,
 		v3f *pos_f, v3f *speed_f,
 		v3f accel_f, ActiveObject *self=NULL,
-		bool collide_with_objects=true);
+		bool collide_with_objects=true,
+		CollisionNodeBoxes *node_boxes=nullptr);
+
+/// Looks up the blocks for a later collisionMoveSimple() call with
+/// the same arguments. Must be called from the thread that owns the map.
+/// @returns `false` if there is nothing to gather
+bool collisionPrepareNodeBoxes(Map *map, const aabb3f &box_0, f32 dtime,
+		v3f pos_f, v3f speed_f, v3f accel_f, CollisionNodeBoxes &node_boxes);
+
+/// Gathers the node boxes of a prepared CollisionNodeBoxes.
+/// Thread-safe as long as the map isn't modified.
+void collisionGatherNodeBoxes(const NodeDefManager *nodedef,
+		CollisionNodeBoxes &node_boxes);
 
 /// @brief A simpler version of "collisionMoveSimple" that only checks whether
 ///        a collision occurs at the given position.
@@ -6,6 +6,9 @@
 #include <fstream>
 #include <json/json.h>
 #include <algorithm>
+#include <array>
+#include <mutex>
+#include <unordered_map>
 #include "content/mods.h"
 #include "database/database.h"
 #include "filesys.h"
@@ -55,6 +58,87 @@ bool parseDependsString(std::string &dep, std::unordered_set<char> &symbols)
 	return !dep.empty();
 }
 
+namespace {
+
+/*
+	What parseModContents() found, of the mods whose files didn't change.
+	Adding or removing a file changes the modification time of the mod
+	directory, so only the files that are read are checked besides it.
+*/
+class ModContentsCache
+{
+public:
+	// modification times of the directory and the files read, and sizes
+	using Stamp = std::array<u64, 7>;
+
+	static bool getStamp(const std::string &path, Stamp &stamp)
+	{
+		u64 size;
+		if (!fs::GetFileSizeAndTime(path, size, stamp[0]))
+			return false;
+		const char *files[] = {"mod.conf", "depends.txt", "description.txt"};
+		for (size_t i = 0; i < ARRLEN(files); i++) {
+			u64 &file_size = stamp[1 + 2 * i], &mtime = stamp[2 + 2 * i];
+			if (!fs::GetFileSizeAndTime(path + DIR_DELIM + files[i], file_size, mtime))
+				file_size = mtime = 0;
+		}
+		return true;
+	}
+
+	// Returns false if the mod is not cached or changed
+	bool get(const Stamp &stamp, ModSpec &spec, bool &is_mod)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(spec.path);
+		if (it == m_entries.end() || it->second.stamp != stamp)
+			return false;
+		const Entry &entry = it->second;
+		is_mod = entry.is_mod;
+		spec.name = entry.spec.name;
+		spec.author = entry.spec.author;
+		spec.release = entry.spec.release;
+		spec.desc = entry.spec.desc;
+		spec.depends = entry.spec.depends;
+		spec.optdepends = entry.spec.optdepends;
+		spec.is_modpack = entry.spec.is_modpack;
+		spec.deprecation_msgs = entry.spec.deprecation_msgs;
+		return true;
+	}
+
+	// The contents of modpacks aren't stored
+	void set(const Stamp &stamp, const ModSpec &spec, bool is_mod)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Entry &entry = m_entries[spec.path];
+		entry.stamp = stamp;
+		entry.is_mod = is_mod;
+		entry.spec.name = spec.name;
+		entry.spec.author = spec.author;
+		entry.spec.release = spec.release;
+		entry.spec.desc = spec.desc;
+		entry.spec.depends = spec.depends;
+		entry.spec.optdepends = spec.optdepends;
+		entry.spec.is_modpack = spec.is_modpack;
+		entry.spec.deprecation_msgs = spec.deprecation_msgs;
+	}
+
+private:
+	struct Entry {
+		Stamp stamp;
+		bool is_mod;
+		ModSpec spec;
+	};
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+};
+
+ModContentsCache g_mod_contents_cache;
+
+bool readModContents(ModSpec &spec);
+
+}
+
 bool parseModContents(ModSpec &spec)
 {
 	// NOTE: this function works in mutual recursion with getModsInPath
@@ -64,11 +148,28 @@ bool parseModContents(ModSpec &spec)
 	spec.is_modpack = false;
 	spec.modpack_content.clear();
 
+	ModContentsCache::Stamp stamp;
+	const bool have_stamp = ModContentsCache::getStamp(spec.path, stamp);
+	bool is_mod;
+	if (!have_stamp || !g_mod_contents_cache.get(stamp, spec, is_mod)) {
+		is_mod = readModContents(spec);
+		if (have_stamp)
+			g_mod_contents_cache.set(stamp, spec, is_mod);
+	}
+
+	if (is_mod && spec.is_modpack)
+		spec.modpack_content = getModsInPath(spec.path, spec.virtual_path, true);
+	return is_mod;
+}
+
+namespace {
+
+bool readModContents(ModSpec &spec)
+{
 	// Handle modpacks (defined by containing modpack.txt)
 	if (fs::IsFile(spec.path + DIR_DELIM + "modpack.txt") ||
 			fs::IsFile(spec.path + DIR_DELIM + "modpack.conf")) {
 		spec.is_modpack = true;
-		spec.modpack_content = getModsInPath(spec.path, spec.virtual_path, true);
 		return true;
 	} else if (!fs::IsFile(spec.path + DIR_DELIM + "init.lua")) {
 		return false;
@@ -146,6 +247,8 @@ bool parseModContents(ModSpec &spec)
 	return true;
 }
 
+}
+
 std::map<std::string, ModSpec> getModsInPath(
 		const std::string &path, const std::string &virtual_path, bool part_of_modpack)
 {
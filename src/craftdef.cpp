@@ -16,6 +16,8 @@
 #include "util/string.h"
 #include "util/numeric.h"
 #include "util/strfnd.h"
+#include "util/container.h"
+#include "threading/mutex_auto_lock.h"
 #include "exceptions.h"
 
 inline bool isGroupRecipeStr(const std::string &rec_name)
@@ -1020,10 +1022,27 @@ std::string CraftDefinitionFuel::dump() const
 	Craft definition manager
 */
 
+// Key of the craft result cache. Only the parts of the grid that recipes
+// look at are included: counts matter to tool repair, which wants single items.
+static std::string getCraftResultCacheKey(const CraftInput &input)
+{
+	std::string key = itos(input.method) + " " + itos(input.width);
+	for (const ItemStack &item : input.items) {
+		key += '\n';
+		if (item.name.empty())
+			continue;
+		key += item.name;
+		key += item.count == 0 ? " 0 " : item.count == 1 ? " 1 " : " 2 ";
+		key += itos(item.wear);
+	}
+	return key;
+}
+
 class CCraftDefManager: public IWritableCraftDefManager
 {
 public:
-	CCraftDefManager()
+	CCraftDefManager():
+		m_result_cache(RESULT_CACHE_SIZE, &resultCacheMiss, this)
 	{
 		m_craft_defs.resize(craft_hash_type_max + 1);
 	}
@@ -1040,6 +1059,29 @@ class CCraftDefManager: public IWritableCraftDefManager
 		if (input.empty())
 			return false;
 
+		CachedResult result;
+		if (m_hashes_initialized) {
+			MutexAutoLock lock(m_result_cache_mutex);
+			m_cache_miss_input = &input;
+			m_cache_miss_gamedef = gamedef;
+			result = *m_result_cache.lookupCache(getCraftResultCacheKey(input));
+		} else {
+			// Items and aliases may still change while mods are loading
+			result.def = findCraft(input, result.output, gamedef);
+		}
+
+		if (!result.def)
+			return false;
+		output = result.output;
+		if (decrementInput)
+			result.def->decrementInput(input, output_replacement, gamedef);
+		return true;
+	}
+
+	// Returns the highest priority recipe matching the input, or nullptr
+	CraftDefinition *findCraft(const CraftInput &input, CraftOutput &output,
+			IGameDef *gamedef) const
+	{
 		std::vector<std::string> input_names;
 		input_names = craftGetItemNames(input.items, gamedef);
 		std::sort(input_names.begin(), input_names.end());
@@ -1090,11 +1132,7 @@ class CCraftDefManager: public IWritableCraftDefManager
 				}
 			}
 		}
-		if (priority_best == CraftDefinition::PRIORITY_NO_RECIPE)
-			return false;
-		if (decrementInput)
-			def_best->decrementInput(input, output_replacement, gamedef);
-		return true;
+		return def_best;
 	}
 
 	virtual std::vector<CraftDefinition*> getCraftRecipes(CraftOutput &output,
@@ -1124,6 +1162,8 @@ class CCraftDefManager: public IWritableCraftDefManager
 
 	virtual bool clearCraftsByOutput(const CraftOutput &output, IGameDef *gamedef)
 	{
+		invalidateResultCache();
+
 		auto to_clear = m_output_craft_definitions.find(output.item);
 
 		if (to_clear == m_output_craft_definitions.end())
@@ -1144,6 +1184,8 @@ class CCraftDefManager: public IWritableCraftDefManager
 		if (input.empty())
 			return false;
 
+		invalidateResultCache();
+
 		// Recipes are not yet hashed at this point
 		std::vector<CraftDefinition *> &defs = m_craft_defs[(int)CRAFT_HASH_TYPE_UNHASHED][0];
 		std::unordered_set<const CraftDefinition *> defs_to_remove;
@@ -1195,6 +1237,7 @@ class CCraftDefManager: public IWritableCraftDefManager
 	{
 		TRACESTREAM(<< "registerCraft: registering craft definition: "
 				<< def->dump() << std::endl);
+		invalidateResultCache();
 		m_craft_defs[(int) CRAFT_HASH_TYPE_UNHASHED][0].push_back(def);
 
 		CraftInput input;
@@ -1204,6 +1247,8 @@ class CCraftDefManager: public IWritableCraftDefManager
 	}
 	virtual void clear()
 	{
+		invalidateResultCache();
+		m_hashes_initialized = false;
 		for (int type = 0; type <= craft_hash_type_max; ++type) {
 			for (auto &it : m_craft_defs[type]) {
 				for (auto &iit : it.second) {
@@ -1230,12 +1275,44 @@ class CCraftDefManager: public IWritableCraftDefManager
 			m_craft_defs[type][hash].push_back(def);
 		}
 		unhashed.clear();
+
+		invalidateResultCache();
+		m_hashes_initialized = true;
 	}
 private:
+	struct CachedResult {
+		CraftDefinition *def = nullptr; // nullptr: no recipe
+		CraftOutput output;
+	};
+
+	static void resultCacheMiss(void *data, const std::string &key, CachedResult *dest)
+	{
+		const CCraftDefManager *self = (const CCraftDefManager *)data;
+		dest->def = self->findCraft(*self->m_cache_miss_input, dest->output,
+				self->m_cache_miss_gamedef);
+	}
+
+	void invalidateResultCache()
+	{
+		MutexAutoLock lock(m_result_cache_mutex);
+		m_result_cache.invalidate();
+	}
+
+	static constexpr size_t RESULT_CACHE_SIZE = 1024;
+
 	std::vector<std::unordered_map<u64, std::vector<CraftDefinition*> > >
 		m_craft_defs;
 	std::unordered_map<std::string, std::vector<CraftDefinition*> >
 		m_output_craft_definitions;
+
+	// Craft results by grid contents, filled once all recipes are hashed.
+	// Auto-crafters and craft guides query the same grids over and over.
+	bool m_hashes_initialized = false;
+	mutable std::mutex m_result_cache_mutex;
+	mutable LRUCache<std::string, CachedResult> m_result_cache;
+	// Grid being looked up, for resultCacheMiss()
+	mutable const CraftInput *m_cache_miss_input = nullptr;
+	mutable IGameDef *m_cache_miss_gamedef = nullptr;
 };
 
 IWritableCraftDefManager* createCraftDefManager()
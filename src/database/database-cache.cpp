@@ -0,0 +1,146 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "database-cache.h"
+#include "log.h"
+
+ModStorageDatabaseCache::ModStorageDatabaseCache(ModStorageDatabase *backend):
+	m_backend(backend)
+{
+}
+
+ModStorageDatabaseCache::~ModStorageDatabaseCache()
+{
+	try {
+		flush();
+	} catch (std::exception &e) {
+		errorstream << "ModStorageDatabaseCache: failed to write changes: "
+			<< e.what() << std::endl;
+	}
+}
+
+ModStorageDatabaseCache::ModEntries &ModStorageDatabaseCache::getMod(
+	const std::string &modname)
+{
+	auto it = m_mods.find(modname);
+	if (it != m_mods.end())
+		return it->second;
+
+	ModEntries &mod = m_mods[modname];
+	m_backend->getModEntries(modname, &mod.entries);
+	return mod;
+}
+
+void ModStorageDatabaseCache::getModEntries(const std::string &modname, StringMap *storage)
+{
+	const ModEntries &mod = getMod(modname);
+	for (const auto &it : mod.entries)
+		(*storage)[it.first] = it.second;
+}
+
+void ModStorageDatabaseCache::getModKeys(const std::string &modname,
+	std::vector<std::string> *storage)
+{
+	const ModEntries &mod = getMod(modname);
+	storage->reserve(storage->size() + mod.entries.size());
+	for (const auto &it : mod.entries)
+		storage->push_back(it.first);
+}
+
+bool ModStorageDatabaseCache::hasModEntry(const std::string &modname,
+	const std::string &key)
+{
+	const ModEntries &mod = getMod(modname);
+	return mod.entries.find(key) != mod.entries.end();
+}
+
+bool ModStorageDatabaseCache::getModEntry(const std::string &modname,
+	const std::string &key, std::string *value)
+{
+	const ModEntries &mod = getMod(modname);
+	auto it = mod.entries.find(key);
+	if (it == mod.entries.end())
+		return false;
+	*value = it->second;
+	return true;
+}
+
+bool ModStorageDatabaseCache::setModEntry(const std::string &modname,
+	const std::string &key, std::string_view value)
+{
+	ModEntries &mod = getMod(modname);
+	auto it = mod.entries.find(key);
+	if (it != mod.entries.end()) {
+		if (it->second == value)
+			return true;
+		it->second.assign(value);
+	} else {
+		mod.entries.emplace(key, value);
+	}
+	mod.dirty.insert(key);
+	m_modified.insert(modname);
+	return true;
+}
+
+bool ModStorageDatabaseCache::removeModEntry(const std::string &modname,
+	const std::string &key)
+{
+	ModEntries &mod = getMod(modname);
+	if (mod.entries.erase(key) == 0)
+		return false;
+	mod.dirty.insert(key);
+	m_modified.insert(modname);
+	return true;
+}
+
+bool ModStorageDatabaseCache::removeModEntries(const std::string &modname)
+{
+	ModEntries &mod = getMod(modname);
+	if (mod.entries.empty())
+		return false;
+
+	// no point in keeping the changes around
+	m_backend->removeModEntries(modname);
+	mod.entries.clear();
+	mod.dirty.clear();
+	m_modified.erase(modname);
+	return true;
+}
+
+void ModStorageDatabaseCache::listMods(std::vector<std::string> *res)
+{
+	// mods that only exist in memory have to be written first
+	flush();
+	m_backend->listMods(res);
+}
+
+void ModStorageDatabaseCache::beginSave()
+{
+	m_backend->beginSave();
+}
+
+void ModStorageDatabaseCache::endSave()
+{
+	flush();
+	m_backend->endSave();
+}
+
+void ModStorageDatabaseCache::flush()
+{
+	for (const std::string &modname : m_modified) {
+		ModEntries &mod = m_mods[modname];
+		for (const std::string &key : mod.dirty) {
+			auto it = mod.entries.find(key);
+			if (it == mod.entries.end()) {
+				// may never have been written
+				m_backend->removeModEntry(modname, key);
+			} else if (!m_backend->setModEntry(modname, key, it->second)) {
+				errorstream << "ModStorageDatabaseCache[" << modname
+					<< "]: failed to write key \"" << key << "\"" << std::endl;
+			}
+		}
+		mod.dirty.clear();
+	}
+	m_modified.clear();
+}
@@ -0,0 +1,57 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "database.h"
+
+/*
+	Write-back cache in front of another mod storage database.
+
+	The entries of a mod are read from the backend once, when first used,
+	and served from memory after that. Changes are only written on
+	endSave() (or flush()), so a key that is set many times in between is
+	written once.
+*/
+class ModStorageDatabaseCache : public ModStorageDatabase
+{
+public:
+	// Takes ownership of the backend
+	ModStorageDatabaseCache(ModStorageDatabase *backend);
+	virtual ~ModStorageDatabaseCache();
+
+	void getModEntries(const std::string &modname, StringMap *storage) override;
+	void getModKeys(const std::string &modname, std::vector<std::string> *storage) override;
+	bool hasModEntry(const std::string &modname, const std::string &key) override;
+	bool getModEntry(const std::string &modname,
+		const std::string &key, std::string *value) override;
+	bool setModEntry(const std::string &modname,
+		const std::string &key, std::string_view value) override;
+	bool removeModEntry(const std::string &modname, const std::string &key) override;
+	bool removeModEntries(const std::string &modname) override;
+	void listMods(std::vector<std::string> *res) override;
+
+	void beginSave() override;
+	void endSave() override;
+
+	// Writes the pending changes to the backend, in its current transaction
+	void flush();
+
+private:
+	struct ModEntries {
+		StringMap entries;
+		// keys set or removed since the last flush
+		std::unordered_set<std::string> dirty;
+	};
+
+	ModEntries &getMod(const std::string &modname);
+
+	std::unique_ptr<ModStorageDatabase> m_backend;
+	std::unordered_map<std::string, ModEntries> m_mods;
+	// mods with dirty keys
+	std::unordered_set<std::string> m_modified;
+};
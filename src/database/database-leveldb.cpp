@@ -18,6 +18,7 @@
 #include "util/string.h"
 
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 
 #define ENSURE_STATUS_OK(s) \
@@ -61,6 +62,24 @@ void Database_LevelDB::loadBlock(const v3s16 &pos, std::string *block)
 		block->clear();
 }
 
+void Database_LevelDB::loadBlocks(const std::vector<v3s16> &positions,
+	const LoadBlockCallback &cb)
+{
+	leveldb::ReadOptions options;
+	options.snapshot = m_database->GetSnapshot();
+
+	std::string data;
+	for (v3s16 pos : positions) {
+		leveldb::Status status = m_database->Get(options,
+			i64tos(getBlockAsInteger(pos)), &data);
+		if (!status.ok())
+			data.clear();
+		cb(pos, data);
+	}
+
+	m_database->ReleaseSnapshot(options.snapshot);
+}
+
 bool Database_LevelDB::deleteBlock(const v3s16 &pos)
 {
 	leveldb::Status status = m_database->Delete(leveldb::WriteOptions(),
@@ -83,6 +102,95 @@ void Database_LevelDB::listAllLoadableBlocks(std::vector<v3s16> &dst)
 	ENSURE_STATUS_OK(it->status());  // Check for any errors found during the scan
 }
 
+void Database_LevelDB::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+
+	// The cursor is the first key not listed yet
+	std::unique_ptr<leveldb::Iterator> it(m_database->NewIterator(leveldb::ReadOptions()));
+	if (cursor.state.empty())
+		it->SeekToFirst();
+	else
+		it->Seek(cursor.state);
+
+	u32 count = 0;
+	for (; it->Valid() && count < max_count; it->Next(), count++)
+		dst.push_back(getIntegerAsBlock(stoi64(it->key().ToString())));
+	ENSURE_STATUS_OK(it->status());
+
+	if (it->Valid())
+		cursor.state = it->key().ToString();
+	else
+		cursor.done = true;
+}
+
+namespace {
+
+// Copies the entries of a snapshot into a new database
+class Database_LevelDBBackup : public MapDatabaseBackup
+{
+public:
+	Database_LevelDBBackup(leveldb::DB *src, const std::string &dir) :
+		m_src(src)
+	{
+		const std::string path = dir + DIR_DELIM + "map.db";
+		if (!fs::CreateAllDirs(dir) || fs::PathExists(path))
+			throw DatabaseException("Cannot create backup at " + path);
+
+		leveldb::Options options;
+		options.create_if_missing = true;
+		options.error_if_exists = true;
+		leveldb::DB *db;
+		leveldb::Status status = leveldb::DB::Open(options, path, &db);
+		ENSURE_STATUS_OK(status);
+		m_dest.reset(db);
+
+		m_snapshot = m_src->GetSnapshot();
+		leveldb::ReadOptions read_options;
+		read_options.snapshot = m_snapshot;
+		// don't push the blocks the server uses out of the cache
+		read_options.fill_cache = false;
+		m_it.reset(m_src->NewIterator(read_options));
+		m_it->SeekToFirst();
+	}
+
+	~Database_LevelDBBackup()
+	{
+		m_it.reset();
+		m_src->ReleaseSnapshot(m_snapshot);
+	}
+
+	bool step() override
+	{
+		leveldb::WriteBatch batch;
+		for (u32 i = 0; i < BLOCKS_PER_STEP && m_it->Valid(); i++, m_it->Next())
+			batch.Put(m_it->key(), m_it->value());
+		ENSURE_STATUS_OK(m_it->status());
+		leveldb::Status status = m_dest->Write(leveldb::WriteOptions(), &batch);
+		ENSURE_STATUS_OK(status);
+		return !m_it->Valid();
+	}
+
+	const char *getBackend() const override { return "leveldb"; }
+
+private:
+	static constexpr u32 BLOCKS_PER_STEP = 256;
+
+	leveldb::DB *m_src;
+	const leveldb::Snapshot *m_snapshot;
+	std::unique_ptr<leveldb::Iterator> m_it;
+	std::unique_ptr<leveldb::DB> m_dest;
+};
+
+}
+
+std::unique_ptr<MapDatabaseBackup> Database_LevelDB::createBackup(const std::string &dir)
+{
+	return std::make_unique<Database_LevelDBBackup>(m_database.get(), dir);
+}
+
 PlayerDatabaseLevelDB::PlayerDatabaseLevelDB(const std::string &savedir)
 {
 	leveldb::Options options;
@@ -21,8 +21,13 @@ class Database_LevelDB : public MapDatabase
 
 	bool saveBlock(const v3s16 &pos, std::string_view data);
 	void loadBlock(const v3s16 &pos, std::string *block);
+	void loadBlocks(const std::vector<v3s16> &positions,
+		const LoadBlockCallback &cb);
 	bool deleteBlock(const v3s16 &pos);
 	void listAllLoadableBlocks(std::vector<v3s16> &dst);
+	void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+	std::unique_ptr<MapDatabaseBackup> createBackup(const std::string &dir);
 
 	void beginSave() {}
 	void endSave() {}
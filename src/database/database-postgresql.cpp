@@ -15,12 +15,16 @@
 #include <netinet/in.h>
 #endif
 
+#include "database-sqlite3.h"
 #include "debug.h"
 #include "exceptions.h"
+#include "filesys.h"
 #include "settings.h"
 #include "remoteplayer.h"
 #include "server/player_sao.h"
 #include <cstdlib>
+#include <cstring>
+#include <unordered_map>
 
 Database_PostgreSQL::Database_PostgreSQL(const std::string &connect_string,
 	const char *type) :
@@ -156,9 +160,85 @@ MapDatabasePostgreSQL::MapDatabasePostgreSQL(const std::string &connect_string):
 	Database_PostgreSQL(connect_string, ""),
 	MapDatabase()
 {
+	m_save_batch_size = rangelim(g_settings->getU32("pgsql_save_batch_size"), 1, 16383);
 	connectToDatabase();
 }
 
+void MapDatabasePostgreSQL::beginSave()
+{
+	Database_PostgreSQL::beginSave();
+	m_in_save = true;
+}
+
+void MapDatabasePostgreSQL::endSave()
+{
+	m_in_save = false;
+	try {
+		flushPendingBlocks();
+	} catch (DatabaseException &e) {
+		rollback();
+		throw;
+	}
+	Database_PostgreSQL::endSave();
+}
+
+void MapDatabasePostgreSQL::flushPendingBlocks()
+{
+	if (m_pending_blocks.empty())
+		return;
+
+	// Clear in any case, a failure aborts the transaction anyway
+	auto blocks = std::move(m_pending_blocks);
+	m_pending_blocks.clear();
+	m_pending_index.clear();
+
+	// Positions are unique thanks to m_pending_index, the upsert would
+	// fail otherwise
+	std::string sql = "INSERT INTO blocks (posX, posY, posZ, data) VALUES ";
+	std::vector<s32> coords(blocks.size() * 3);
+	std::vector<const void *> args;
+	std::vector<int> argLen;
+	args.reserve(blocks.size() * 4);
+	argLen.reserve(blocks.size() * 4);
+	for (size_t i = 0; i < blocks.size(); i++) {
+		const v3s16 pos = blocks[i].first;
+		const std::string &data = blocks[i].second;
+		s32 *xyz = &coords[i * 3];
+		xyz[0] = htonl(pos.X);
+		xyz[1] = htonl(pos.Y);
+		xyz[2] = htonl(pos.Z);
+
+		const size_t n = i * 4;
+		if (i > 0)
+			sql.append(",");
+		sql.append("($").append(std::to_string(n + 1)).append("::int4,$")
+			.append(std::to_string(n + 2)).append("::int4,$")
+			.append(std::to_string(n + 3)).append("::int4,$")
+			.append(std::to_string(n + 4)).append("::bytea)");
+
+		for (int j = 0; j < 3; j++) {
+			args.push_back(&xyz[j]);
+			argLen.push_back(sizeof(s32));
+		}
+		args.push_back(data.data());
+		argLen.push_back((int)data.size());
+	}
+	sql.append(" ON CONFLICT ON CONSTRAINT blocks_pkey DO UPDATE SET data = EXCLUDED.data");
+
+	// everything is binary
+	std::vector<int> argFmt(args.size(), 1);
+	execParams(sql, args.size(), args.data(), argLen.data(), argFmt.data());
+}
+
+bool MapDatabasePostgreSQL::getPendingBlock(v3s16 pos, std::string &data) const
+{
+	auto it = m_pending_index.find(pos);
+	if (it == m_pending_index.end())
+		return false;
+	data = m_pending_blocks[it->second].second;
+	return true;
+}
+
 
 void MapDatabasePostgreSQL::createDatabase()
 {
@@ -182,6 +262,14 @@ void MapDatabasePostgreSQL::initStatements()
 			"WHERE posX = $1::int4 AND posY = $2::int4 AND "
 			"posZ = $3::int4");
 
+	// multi-argument unnest() needs 9.4
+	if (getPGVersion() >= 90400) {
+		prepareStatement("read_blocks",
+			"SELECT posX, posY, posZ, data FROM blocks "
+				"WHERE (posX, posY, posZ) IN (SELECT * FROM "
+				"unnest($1::int4[], $2::int4[], $3::int4[]))");
+	}
+
 	if (getPGVersion() < 90500) {
 		prepareStatement("write_block_insert",
 			"INSERT INTO blocks (posX, posY, posZ, data) SELECT "
@@ -207,6 +295,11 @@ void MapDatabasePostgreSQL::initStatements()
 
 	prepareStatement("list_all_loadable_blocks",
 		"SELECT posX, posY, posZ FROM blocks");
+
+	prepareStatement("list_loadable_blocks_after",
+		"SELECT posX, posY, posZ FROM blocks "
+			"WHERE (posX, posY, posZ) > ($1::int4, $2::int4, $3::int4) "
+			"ORDER BY posX, posY, posZ LIMIT $4::int4");
 }
 
 bool MapDatabasePostgreSQL::saveBlock(const v3s16 &pos, std::string_view data)
@@ -219,6 +312,20 @@ bool MapDatabasePostgreSQL::saveBlock(const v3s16 &pos, std::string_view data)
 		return false;
 	}
 
+	// Multi-row upserts need ON CONFLICT, so 9.5
+	if (m_in_save && getPGVersion() >= 90500) {
+		auto it = m_pending_index.find(pos);
+		if (it != m_pending_index.end()) {
+			m_pending_blocks[it->second].second.assign(data);
+		} else {
+			m_pending_index.emplace(pos, m_pending_blocks.size());
+			m_pending_blocks.emplace_back(pos, data);
+		}
+		if (m_pending_blocks.size() >= m_save_batch_size)
+			flushPendingBlocks();
+		return true;
+	}
+
 	verifyDatabase();
 
 	s32 x, y, z;
@@ -243,6 +350,9 @@ bool MapDatabasePostgreSQL::saveBlock(const v3s16 &pos, std::string_view data)
 
 void MapDatabasePostgreSQL::loadBlock(const v3s16 &pos, std::string *block)
 {
+	if (getPendingBlock(pos, *block))
+		return;
+
 	verifyDatabase();
 
 	s32 x, y, z;
@@ -265,8 +375,76 @@ void MapDatabasePostgreSQL::loadBlock(const v3s16 &pos, std::string *block)
 	PQclear(results);
 }
 
+// for int4 columns of results in binary format
+static s32 pg_binary_to_int(PGresult *res, int row, int col)
+{
+	u32 val;
+	memcpy(&val, PQgetvalue(res, row, col), sizeof(val));
+	return (s32)ntohl(val);
+}
+
+void MapDatabasePostgreSQL::loadBlocks(const std::vector<v3s16> &positions,
+	const LoadBlockCallback &cb)
+{
+	if (positions.empty())
+		return;
+
+	if (!m_pending_blocks.empty())
+		flushPendingBlocks();
+
+	verifyDatabase();
+
+	if (getPGVersion() < 90400) {
+		MapDatabase::loadBlocks(positions, cb);
+		return;
+	}
+
+	// The coordinates go in as array literals, e.g. {1,-2,3}
+	std::string coords[3];
+	for (auto &str : coords)
+		str.reserve(positions.size() * 4 + 2);
+	for (size_t i = 0; i < positions.size(); i++) {
+		const char *sep = i == 0 ? "{" : ",";
+		coords[0].append(sep).append(itos(positions[i].X));
+		coords[1].append(sep).append(itos(positions[i].Y));
+		coords[2].append(sep).append(itos(positions[i].Z));
+	}
+	for (auto &str : coords)
+		str.push_back('}');
+
+	const void *args[] = { coords[0].c_str(), coords[1].c_str(), coords[2].c_str() };
+	const int argFmt[] = { 0, 0, 0 };
+
+	// the result is in binary format
+	PGresult *results = execPrepared("read_blocks", ARRLEN(args), args,
+		nullptr, argFmt, false);
+
+	std::unordered_map<v3s16, std::string> found;
+	int numrows = PQntuples(results);
+	for (int row = 0; row < numrows; ++row) {
+		v3s16 pos(pg_binary_to_int(results, row, 0),
+			pg_binary_to_int(results, row, 1),
+			pg_binary_to_int(results, row, 2));
+		found[pos] = pg_to_string(results, row, 3);
+	}
+	PQclear(results);
+
+	std::string data;
+	for (v3s16 pos : positions) {
+		auto it = found.find(pos);
+		if (it != found.end())
+			data = std::move(it->second);
+		else
+			data.clear();
+		cb(pos, data);
+	}
+}
+
 bool MapDatabasePostgreSQL::deleteBlock(const v3s16 &pos)
 {
+	if (m_pending_index.count(pos))
+		flushPendingBlocks();
+
 	verifyDatabase();
 
 	s32 x, y, z;
@@ -285,6 +463,8 @@ bool MapDatabasePostgreSQL::deleteBlock(const v3s16 &pos)
 
 void MapDatabasePostgreSQL::listAllLoadableBlocks(std::vector<v3s16> &dst)
 {
+	flushPendingBlocks();
+
 	verifyDatabase();
 
 	PGresult *results = execPrepared("list_all_loadable_blocks", 0,
@@ -298,6 +478,118 @@ void MapDatabasePostgreSQL::listAllLoadableBlocks(std::vector<v3s16> &dst)
 	PQclear(results);
 }
 
+void MapDatabasePostgreSQL::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+
+	flushPendingBlocks();
+
+	verifyDatabase();
+
+	// The cursor is the last position listed, start below any smallint
+	v3s32 last(-32769, 0, 0);
+	if (!cursor.state.empty()) {
+		v3s16 p = getIntegerAsBlock(stoi64(cursor.state));
+		last = v3s32(p.X, p.Y, p.Z);
+	}
+	const std::string x = itos(last.X), y = itos(last.Y), z = itos(last.Z),
+		limit = itos(max_count);
+	const void *args[] = { x.c_str(), y.c_str(), z.c_str(), limit.c_str() };
+	const int argFmt[] = { 0, 0, 0, 0 };
+
+	PGresult *results = execPrepared("list_loadable_blocks_after", ARRLEN(args),
+		args, nullptr, argFmt, false, false);
+
+	int numrows = PQntuples(results);
+	for (int row = 0; row < numrows; ++row)
+		dst.push_back(pg_to_v3s16(results, row, 0));
+
+	if ((u32)numrows < max_count)
+		cursor.done = true;
+	else
+		cursor.state = i64tos(getBlockAsInteger(dst.back()));
+
+	PQclear(results);
+}
+
+namespace {
+
+// Reads the blocks through a cursor in a repeatable read transaction on a
+// connection of its own, which sees the database as it was at the start.
+// There is no file to copy, so they are written to an SQLite database.
+class MapDatabasePostgreSQLBackup : private Database_PostgreSQL, public MapDatabaseBackup
+{
+public:
+	MapDatabasePostgreSQLBackup(const std::string &connect_string,
+		const std::string &dir) :
+		Database_PostgreSQL(connect_string, ""),
+		m_dest(dir)
+	{
+		if (fs::PathExists(dir + DIR_DELIM + "map.sqlite"))
+			throw DatabaseException("Cannot create backup in " + dir);
+
+		connectToDatabase();
+		execParams("BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY",
+			0, nullptr, nullptr, nullptr);
+		execParams("DECLARE backup_blocks NO SCROLL CURSOR FOR "
+			"SELECT posX, posY, posZ, data FROM blocks",
+			0, nullptr, nullptr, nullptr);
+	}
+
+	bool step() override
+	{
+		// the result is in binary format
+		PGresult *results = execParams("FETCH " + itos(BLOCKS_PER_STEP) +
+			" FROM backup_blocks", 0, nullptr, nullptr, nullptr, false);
+
+		int numrows = PQntuples(results);
+		m_dest.beginSave();
+		for (int row = 0; row < numrows; ++row) {
+			v3s16 pos(pg_binary_to_s16(results, row, 0),
+				pg_binary_to_s16(results, row, 1),
+				pg_binary_to_s16(results, row, 2));
+			m_dest.saveBlock(pos, std::string_view(PQgetvalue(results, row, 3),
+				PQgetlength(results, row, 3)));
+		}
+		m_dest.endSave();
+		PQclear(results);
+
+		if (numrows < BLOCKS_PER_STEP) {
+			endSave();
+			return true;
+		}
+		return false;
+	}
+
+	const char *getBackend() const override { return "sqlite3"; }
+
+protected:
+	// the tables exist and nothing is prepared
+	void createDatabase() override {}
+	void initStatements() override {}
+
+private:
+	static constexpr int BLOCKS_PER_STEP = 256;
+
+	static s16 pg_binary_to_s16(PGresult *res, int row, int col)
+	{
+		u16 val;
+		memcpy(&val, PQgetvalue(res, row, col), sizeof(val));
+		return (s16)ntohs(val);
+	}
+
+	MapDatabaseSQLite3 m_dest;
+};
+
+}
+
+std::unique_ptr<MapDatabaseBackup> MapDatabasePostgreSQL::createBackup(const std::string &dir)
+{
+	return std::make_unique<MapDatabasePostgreSQLBackup>(getConnectString(), dir);
+}
+
 /*
  * Player Database
  */
@@ -437,6 +729,18 @@ bool PlayerDatabasePostgreSQL::playerDataExists(const std::string &playername)
 	return res;
 }
 
+void PlayerDatabasePostgreSQL::beginSaveBatch()
+{
+	beginSave();
+	m_in_batch = true;
+}
+
+void PlayerDatabasePostgreSQL::endSaveBatch()
+{
+	m_in_batch = false;
+	endSave();
+}
+
 void PlayerDatabasePostgreSQL::savePlayer(RemotePlayer *player)
 {
 	PlayerSAO* sao = player->getPlayerSAO();
@@ -463,65 +767,78 @@ void PlayerDatabasePostgreSQL::savePlayer(RemotePlayer *player)
 	};
 
 	const char* rmvalues[] = { player->getName().c_str() };
-	beginSave();
+	if (!m_in_batch)
+		beginSave();
 
+	u8 parts = player->getUnsavedParts();
 	if (getPGVersion() < 90500) {
-		if (!playerDataExists(player->getName()))
+		if (!playerDataExists(player->getName())) {
+			parts = RemotePlayer::UNSAVED_ALL;
 			execPrepared("create_player", 8, values, true, false);
-		else
+		} else {
 			execPrepared("update_player", 8, values, true, false);
-	}
-	else
+		}
+	} else {
+		// a new player needs everything, nothing is stored yet
+		if (parts != RemotePlayer::UNSAVED_ALL && !playerDataExists(player->getName()))
+			parts = RemotePlayer::UNSAVED_ALL;
 		execPrepared("save_player", 8, values, true, false);
+	}
 
-	// Write player inventories
-	execPrepared("remove_player_inventories", 1, rmvalues);
-	execPrepared("remove_player_inventory_items", 1, rmvalues);
-
-	const auto &inventory_lists = sao->getInventory()->getLists();
-	std::ostringstream oss;
-	for (u16 i = 0; i < inventory_lists.size(); i++) {
-		const InventoryList* list = inventory_lists[i];
-		const std::string &name = list->getName();
-		std::string width = itos(list->getWidth()),
-			inv_id = itos(i), lsize = itos(list->getSize());
-
-		const char* inv_values[] = {
-			player->getName().c_str(),
-			inv_id.c_str(),
-			width.c_str(),
-			name.c_str(),
-			lsize.c_str()
-		};
-		execPrepared("add_player_inventory", 5, inv_values);
+	if (parts & RemotePlayer::UNSAVED_INVENTORY) {
+		// Write player inventories
+		execPrepared("remove_player_inventories", 1, rmvalues);
+		execPrepared("remove_player_inventory_items", 1, rmvalues);
 
-		for (u32 j = 0; j < list->getSize(); j++) {
-			oss.str("");
-			oss.clear();
-			list->getItem(j).serialize(oss);
-			std::string itemStr = oss.str(), slotId = itos(j);
+		const auto &inventory_lists = sao->getInventory()->getLists();
+		std::ostringstream oss;
+		for (u16 i = 0; i < inventory_lists.size(); i++) {
+			const InventoryList* list = inventory_lists[i];
+			const std::string &name = list->getName();
+			std::string width = itos(list->getWidth()),
+				inv_id = itos(i), lsize = itos(list->getSize());
 
-			const char* invitem_values[] = {
+			const char* inv_values[] = {
 				player->getName().c_str(),
 				inv_id.c_str(),
-				slotId.c_str(),
-				itemStr.c_str()
+				width.c_str(),
+				name.c_str(),
+				lsize.c_str()
 			};
-			execPrepared("add_player_inventory_item", 4, invitem_values);
+			execPrepared("add_player_inventory", 5, inv_values);
+
+			for (u32 j = 0; j < list->getSize(); j++) {
+				oss.str("");
+				oss.clear();
+				list->getItem(j).serialize(oss);
+				std::string itemStr = oss.str(), slotId = itos(j);
+
+				const char* invitem_values[] = {
+					player->getName().c_str(),
+					inv_id.c_str(),
+					slotId.c_str(),
+					itemStr.c_str()
+				};
+				execPrepared("add_player_inventory_item", 4, invitem_values);
+			}
 		}
 	}
 
-	execPrepared("remove_player_metadata", 1, rmvalues);
-	const StringMap &attrs = sao->getMeta().getStrings();
-	for (const auto &attr : attrs) {
-		const char *meta_values[] = {
-			player->getName().c_str(),
-			attr.first.c_str(),
-			attr.second.c_str()
-		};
-		execPrepared("save_player_metadata", 3, meta_values);
+	if (parts & RemotePlayer::UNSAVED_META) {
+		execPrepared("remove_player_metadata", 1, rmvalues);
+		const StringMap &attrs = sao->getMeta().getStrings();
+		for (const auto &attr : attrs) {
+			const char *meta_values[] = {
+				player->getName().c_str(),
+				attr.first.c_str(),
+				attr.second.c_str()
+			};
+			execPrepared("save_player_metadata", 3, meta_values);
+		}
 	}
-	endSave();
+
+	if (!m_in_batch)
+		endSave();
 
 	player->onSuccessfulSave();
 }
@@ -5,6 +5,9 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <libpq-fe.h>
 #include "database.h"
 #include "util/basic_macros.h"
@@ -72,6 +75,16 @@ class Database_PostgreSQL : public Database
 			(const void **)params, NULL, NULL, clear, nobinary);
 	}
 
+	// Unprepared variant of the above, for statements built on the fly
+	inline PGresult *execParams(const std::string &sql, const int paramsNumber,
+		const void **params, const int *paramsLengths, const int *paramsFormats,
+		bool clear = true)
+	{
+		return checkResults(PQexecParams(m_conn, sql.c_str(), paramsNumber,
+			NULL, (const char* const*) params, paramsLengths, paramsFormats,
+			1), clear);
+	}
+
 	void createTableIfNotExists(const std::string &table_name, const std::string &definition);
 
 	// Database initialization
@@ -84,6 +97,7 @@ class Database_PostgreSQL : public Database
 	}
 
 	int getPGVersion() const { return m_pgversion; }
+	const std::string &getConnectString() const { return m_connect_string; }
 
 private:
 	// Database connectivity checks
@@ -112,14 +126,35 @@ class MapDatabasePostgreSQL : private Database_PostgreSQL, public MapDatabase
 
 	bool saveBlock(const v3s16 &pos, std::string_view data);
 	void loadBlock(const v3s16 &pos, std::string *block);
+	void loadBlocks(const std::vector<v3s16> &positions,
+		const LoadBlockCallback &cb);
 	bool deleteBlock(const v3s16 &pos);
 	void listAllLoadableBlocks(std::vector<v3s16> &dst);
+	void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+	std::unique_ptr<MapDatabaseBackup> createBackup(const std::string &dir);
 
-	PARENT_CLASS_FUNCS
+	void beginSave();
+	void endSave();
+	void verifyDatabase() { Database_PostgreSQL::verifyDatabase(); }
 
 protected:
 	virtual void createDatabase();
 	virtual void initStatements();
+
+private:
+	// Writes the blocks saved since the last flush with one statement
+	void flushPendingBlocks();
+	// Looks up data saved in the current transaction but not yet written
+	bool getPendingBlock(v3s16 pos, std::string &data) const;
+
+	// Blocks are collected between beginSave() and endSave() and written
+	// pgsql_save_batch_size at a time, which saves a round trip per block
+	bool m_in_save = false;
+	u32 m_save_batch_size;
+	std::vector<std::pair<v3s16, std::string>> m_pending_blocks;
+	// position -> index in m_pending_blocks
+	std::unordered_map<v3s16, size_t> m_pending_index;
 };
 
 class PlayerDatabasePostgreSQL : private Database_PostgreSQL, public PlayerDatabase
@@ -132,6 +167,8 @@ class PlayerDatabasePostgreSQL : private Database_PostgreSQL, public PlayerDatab
 	bool loadPlayer(RemotePlayer *player, PlayerSAO *sao);
 	bool removePlayer(const std::string &name);
 	void listPlayers(std::vector<std::string> &res);
+	void beginSaveBatch();
+	void endSaveBatch();
 
 	PARENT_CLASS_FUNCS
 
@@ -140,6 +177,8 @@ class PlayerDatabasePostgreSQL : private Database_PostgreSQL, public PlayerDatab
 	virtual void initStatements();
 
 private:
+	bool m_in_batch = false;
+
 	bool playerDataExists(const std::string &playername);
 };
 
@@ -152,6 +152,58 @@ void Database_Redis::loadBlock(const v3s16 &pos, std::string *block)
 		"Redis command 'HGET %s %s' gave invalid reply."));
 }
 
+void Database_Redis::loadBlocks(const std::vector<v3s16> &positions,
+	const LoadBlockCallback &cb)
+{
+	if (positions.empty())
+		return;
+
+	// HMGET <hash> <key>... answers everything in one round trip
+	std::vector<std::string> keys;
+	keys.reserve(positions.size());
+	for (v3s16 pos : positions)
+		keys.push_back(i64tos(getBlockAsInteger(pos)));
+
+	std::vector<const char *> argv;
+	std::vector<size_t> argvlen;
+	argv.reserve(keys.size() + 2);
+	argvlen.reserve(keys.size() + 2);
+	argv.push_back("HMGET");
+	argvlen.push_back(5);
+	argv.push_back(hash.c_str());
+	argvlen.push_back(hash.size());
+	for (const auto &key : keys) {
+		argv.push_back(key.c_str());
+		argvlen.push_back(key.size());
+	}
+
+	redisReply *reply = static_cast<redisReply *>(redisCommandArgv(ctx,
+		argv.size(), argv.data(), argvlen.data()));
+	if (!reply) {
+		throw DatabaseException(std::string(
+			"Redis command 'HMGET %s ...' failed: ") + ctx->errstr);
+	}
+	if (reply->type != REDIS_REPLY_ARRAY || reply->elements != positions.size()) {
+		std::string errstr = reply->type == REDIS_REPLY_ERROR ?
+			std::string(reply->str, reply->len) : "invalid reply";
+		freeReplyObject(reply);
+		throw DatabaseException(std::string(
+			"Redis command 'HMGET %s ...' errored: ") + errstr);
+	}
+
+	std::string data;
+	for (size_t i = 0; i < positions.size(); i++) {
+		const redisReply *element = reply->element[i];
+		if (element->type == REDIS_REPLY_STRING)
+			data.assign(element->str, element->len);
+		else
+			data.clear();
+		cb(positions[i], data);
+	}
+
+	freeReplyObject(reply);
+}
+
 bool Database_Redis::deleteBlock(const v3s16 &pos)
 {
 	std::string tmp = i64tos(getBlockAsInteger(pos));
@@ -195,5 +247,42 @@ void Database_Redis::listAllLoadableBlocks(std::vector<v3s16> &dst)
 	freeReplyObject(reply);
 }
 
+void Database_Redis::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+
+	// HSCAN also returns the values, but keeps the replies small unlike HKEYS.
+	// Its cursor is "0" at the start and again at the end.
+	const char *scan_cursor = cursor.state.empty() ? "0" : cursor.state.c_str();
+	redisReply *reply = static_cast<redisReply *>(redisCommand(ctx,
+		"HSCAN %s %s COUNT %u", hash.c_str(), scan_cursor, max_count));
+	if (!reply) {
+		throw DatabaseException(std::string(
+			"Redis command 'HSCAN %s' failed: ") + ctx->errstr);
+	}
+	if (reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 ||
+			reply->element[0]->type != REDIS_REPLY_STRING ||
+			reply->element[1]->type != REDIS_REPLY_ARRAY) {
+		std::string errstr = reply->type == REDIS_REPLY_ERROR ?
+			std::string(reply->str, reply->len) : "invalid reply";
+		freeReplyObject(reply);
+		throw DatabaseException(std::string(
+			"Redis command 'HSCAN %s' errored: ") + errstr);
+	}
+
+	const redisReply *fields = reply->element[1];
+	for (size_t i = 0; i + 1 < fields->elements; i += 2) {
+		assert(fields->element[i]->type == REDIS_REPLY_STRING);
+		dst.push_back(getIntegerAsBlock(stoi64(fields->element[i]->str)));
+	}
+	cursor.state.assign(reply->element[0]->str, reply->element[0]->len);
+	if (cursor.state == "0")
+		cursor.done = true;
+
+	freeReplyObject(reply);
+}
+
 #endif // USE_REDIS
 
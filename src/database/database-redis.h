@@ -25,8 +25,12 @@ class Database_Redis : public MapDatabase
 
 	bool saveBlock(const v3s16 &pos, std::string_view data);
 	void loadBlock(const v3s16 &pos, std::string *block);
+	void loadBlocks(const std::vector<v3s16> &positions,
+		const LoadBlockCallback &cb);
 	bool deleteBlock(const v3s16 &pos);
 	void listAllLoadableBlocks(std::vector<v3s16> &dst);
+	void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
 
 private:
 	redisContext *ctx = nullptr;
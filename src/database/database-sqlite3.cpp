@@ -13,6 +13,7 @@
 #include "remoteplayer.h"
 #include "irrlicht_changes/printing.h"
 #include "server/player_sao.h"
+#include "threading/workerpool.h"
 
 #include <cassert>
 
@@ -208,8 +209,9 @@ Database_SQLite3::~Database_SQLite3()
  * Map database
  */
 
-MapDatabaseSQLite3::MapDatabaseSQLite3(const std::string &savedir):
-	Database_SQLite3(savedir, "map"),
+MapDatabaseSQLite3::MapDatabaseSQLite3(const std::string &savedir,
+	const std::string &dbname):
+	Database_SQLite3(savedir, dbname),
 	MapDatabase()
 {
 }
@@ -219,6 +221,7 @@ MapDatabaseSQLite3::~MapDatabaseSQLite3()
 	FINALIZE_STATEMENT(read)
 	FINALIZE_STATEMENT(write)
 	FINALIZE_STATEMENT(list)
+	FINALIZE_STATEMENT(list_after)
 	FINALIZE_STATEMENT(delete)
 }
 
@@ -259,11 +262,16 @@ void MapDatabaseSQLite3::initStatements()
 		PREPARE_STATEMENT(write, "REPLACE INTO `blocks` (`x`, `y`, `z`, `data`) VALUES (?, ?, ?, ?)");
 		PREPARE_STATEMENT(delete, "DELETE FROM `blocks` WHERE `x` = ? AND `y` = ? AND `z` = ?");
 		PREPARE_STATEMENT(list, "SELECT `x`, `y`, `z` FROM `blocks`");
+		// (needs SQLite 3.15) in primary key order, so that the index is used
+		PREPARE_STATEMENT(list_after, "SELECT `x`, `y`, `z` FROM `blocks` "
+			"WHERE (`x`, `z`, `y`) > (?, ?, ?) ORDER BY `x`, `z`, `y` LIMIT ?");
 	} else {
 		PREPARE_STATEMENT(read, "SELECT `data` FROM `blocks` WHERE `pos` = ? LIMIT 1");
 		PREPARE_STATEMENT(write, "REPLACE INTO `blocks` (`pos`, `data`) VALUES (?, ?)");
 		PREPARE_STATEMENT(delete, "DELETE FROM `blocks` WHERE `pos` = ?");
 		PREPARE_STATEMENT(list, "SELECT `pos` FROM `blocks`");
+		PREPARE_STATEMENT(list_after, "SELECT `pos` FROM `blocks` "
+			"WHERE `pos` > ? ORDER BY `pos` LIMIT ?");
 	}
 }
 
@@ -328,6 +336,26 @@ void MapDatabaseSQLite3::loadBlock(const v3s16 &pos, std::string *block)
 	sqlite3_reset(m_stmt_read);
 }
 
+void MapDatabaseSQLite3::loadBlocks(const std::vector<v3s16> &positions,
+	const LoadBlockCallback &cb)
+{
+	verifyDatabase();
+
+	// Read everything from one snapshot, unless a transaction is already open
+	const bool own_transaction = sqlite3_get_autocommit(m_database) != 0;
+	if (own_transaction)
+		beginSave();
+
+	std::string data;
+	for (v3s16 pos : positions) {
+		loadBlock(pos, &data);
+		cb(pos, data);
+	}
+
+	if (own_transaction)
+		endSave();
+}
+
 void MapDatabaseSQLite3::listAllLoadableBlocks(std::vector<v3s16> &dst)
 {
 	verifyDatabase();
@@ -347,6 +375,240 @@ void MapDatabaseSQLite3::listAllLoadableBlocks(std::vector<v3s16> &dst)
 	sqlite3_reset(m_stmt_list);
 }
 
+void MapDatabaseSQLite3::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+
+	verifyDatabase();
+
+	// The cursor is the last position listed, continue after it
+	int col = 1;
+	if (cursor.state.empty()) {
+		for (int i = 0; i < (m_new_format ? 3 : 1); i++)
+			int64_to_sqlite(m_stmt_list_after, col++, INT64_MIN);
+	} else if (m_new_format) {
+		v3s16 last = getIntegerAsBlock(stoi64(cursor.state));
+		int_to_sqlite(m_stmt_list_after, col++, last.X);
+		int_to_sqlite(m_stmt_list_after, col++, last.Z);
+		int_to_sqlite(m_stmt_list_after, col++, last.Y);
+	} else {
+		int64_to_sqlite(m_stmt_list_after, col++, stoi64(cursor.state));
+	}
+	int64_to_sqlite(m_stmt_list_after, col, max_count);
+
+	u32 count = 0;
+	v3s16 p;
+	while (sqlite3_step(m_stmt_list_after) == SQLITE_ROW) {
+		if (m_new_format) {
+			p.X = sqlite_to_int(m_stmt_list_after, 0);
+			p.Y = sqlite_to_int(m_stmt_list_after, 1);
+			p.Z = sqlite_to_int(m_stmt_list_after, 2);
+		} else {
+			p = getIntegerAsBlock(sqlite_to_int64(m_stmt_list_after, 0));
+		}
+		dst.push_back(p);
+		count++;
+	}
+
+	sqlite3_reset(m_stmt_list_after);
+
+	if (count < max_count)
+		cursor.done = true;
+	else
+		cursor.state = i64tos(getBlockAsInteger(p));
+}
+
+namespace {
+
+// Uses the online backup API. Since it shares the connection, changes
+// written by the server during the backup end up in the copy too.
+class MapDatabaseSQLite3Backup : public MapDatabaseBackup
+{
+public:
+	MapDatabaseSQLite3Backup(sqlite3 *src, const std::string &dir) :
+		m_src(src)
+	{
+		const std::string path = dir + DIR_DELIM + "map.sqlite";
+		if (!fs::CreateAllDirs(dir) || fs::PathExists(path))
+			throw DatabaseException("Cannot create backup at " + path);
+
+		if (sqlite3_open_v2(path.c_str(), &m_dest,
+				SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+			std::string err = std::string("Failed to open backup database: ") +
+				sqlite3_errmsg(m_dest);
+			sqlite3_close(m_dest);
+			throw DatabaseException(err);
+		}
+		m_backup = sqlite3_backup_init(m_dest, "main", m_src, "main");
+		if (!m_backup) {
+			std::string err = std::string("Failed to start backup: ") +
+				sqlite3_errmsg(m_dest);
+			sqlite3_close(m_dest);
+			throw DatabaseException(err);
+		}
+	}
+
+	~MapDatabaseSQLite3Backup()
+	{
+		if (m_backup)
+			sqlite3_backup_finish(m_backup);
+		sqlite3_close(m_dest);
+	}
+
+	bool step() override
+	{
+		if (!m_backup)
+			return true;
+		// Don't copy a transaction that is still being written
+		if (!sqlite3_get_autocommit(m_src))
+			return false;
+
+		int ret = sqlite3_backup_step(m_backup, PAGES_PER_STEP);
+		if (ret == SQLITE_OK || ret == SQLITE_BUSY || ret == SQLITE_LOCKED)
+			return false;
+
+		sqlite3_backup_finish(m_backup);
+		m_backup = nullptr;
+		if (ret != SQLITE_DONE) {
+			throw DatabaseException(std::string("Backup failed: ") +
+				sqlite3_errstr(ret));
+		}
+		return true;
+	}
+
+	const char *getBackend() const override { return "sqlite3"; }
+
+private:
+	static constexpr int PAGES_PER_STEP = 256;
+
+	sqlite3 *m_src;
+	sqlite3 *m_dest = nullptr;
+	sqlite3_backup *m_backup = nullptr;
+};
+
+}
+
+std::unique_ptr<MapDatabaseBackup> MapDatabaseSQLite3::createBackup(const std::string &dir)
+{
+	verifyDatabase();
+
+	return std::make_unique<MapDatabaseSQLite3Backup>(m_database, dir);
+}
+
+/*
+ * Sharded map database
+ */
+
+MapDatabaseSQLite3Sharded::MapDatabaseSQLite3Sharded(const std::string &savedir,
+	u32 num_shards)
+{
+	const std::string dir = savedir + DIR_DELIM + "map_shards";
+
+	// An existing world keeps its number of shards
+	u32 existing = 0;
+	while (fs::PathExists(dir + DIR_DELIM "map." + itos(existing) + ".sqlite"))
+		existing++;
+	if (existing > 0)
+		num_shards = existing;
+	num_shards = rangelim(num_shards, 1, 256);
+
+	for (u32 i = 0; i < num_shards; i++)
+		m_shards.push_back(std::make_unique<MapDatabaseSQLite3>(dir, "map." + itos(i)));
+
+	m_pool = std::make_unique<WorkerPool>("MapShards", std::min<u32>(num_shards, 4) - 1);
+}
+
+MapDatabaseSQLite3Sharded::~MapDatabaseSQLite3Sharded() = default;
+
+u32 MapDatabaseSQLite3Sharded::getShard(v3s16 pos) const
+{
+	// Neighbouring blocks are mostly saved and loaded together
+	const u64 region = MapDatabase::getBlockAsInteger(v3s16(
+		pos.X >> 3, pos.Y >> 3, pos.Z >> 3));
+	u64 h = region * 0x9e3779b97f4a7c15ULL;
+	h ^= h >> 32;
+	return h % m_shards.size();
+}
+
+bool MapDatabaseSQLite3Sharded::saveBlock(const v3s16 &pos, std::string_view data)
+{
+	return m_shards[getShard(pos)]->saveBlock(pos, data);
+}
+
+void MapDatabaseSQLite3Sharded::loadBlock(const v3s16 &pos, std::string *block)
+{
+	m_shards[getShard(pos)]->loadBlock(pos, block);
+}
+
+bool MapDatabaseSQLite3Sharded::deleteBlock(const v3s16 &pos)
+{
+	return m_shards[getShard(pos)]->deleteBlock(pos);
+}
+
+void MapDatabaseSQLite3Sharded::listAllLoadableBlocks(std::vector<v3s16> &dst)
+{
+	for (auto &shard : m_shards)
+		shard->listAllLoadableBlocks(dst);
+}
+
+void MapDatabaseSQLite3Sharded::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+
+	// "<shard>:<cursor of the shard>"
+	u32 index = 0;
+	ListCursor inner;
+	if (!cursor.state.empty()) {
+		size_t sep = cursor.state.find(':');
+		index = stoi(cursor.state.substr(0, sep));
+		inner.state = cursor.state.substr(sep + 1);
+	}
+
+	m_shards[index]->listLoadableBlocks(inner, max_count, dst);
+	if (inner.done) {
+		index++;
+		inner.state.clear();
+	}
+
+	if (index < m_shards.size())
+		cursor.state = itos(index) + ":" + inner.state;
+	else
+		cursor.done = true;
+}
+
+void MapDatabaseSQLite3Sharded::beginSave()
+{
+	for (auto &shard : m_shards)
+		shard->beginSave();
+}
+
+void MapDatabaseSQLite3Sharded::endSave()
+{
+	// Committing waits for the disk, so do that for all shards at once
+	std::vector<std::string> errors(m_shards.size());
+	m_pool->run(m_shards.size(), [&] (size_t i) {
+		try {
+			m_shards[i]->endSave();
+		} catch (std::exception &e) {
+			errors[i] = e.what();
+		}
+	});
+	for (const auto &error : errors) {
+		if (!error.empty())
+			throw DatabaseException(error);
+	}
+}
+
+void MapDatabaseSQLite3Sharded::verifyDatabase()
+{
+	for (auto &shard : m_shards)
+		shard->verifyDatabase();
+}
+
 /*
  * Player Database
  */
@@ -476,15 +738,31 @@ bool PlayerDatabaseSQLite3::playerDataExists(const std::string &name)
 	return res;
 }
 
+void PlayerDatabaseSQLite3::beginSaveBatch()
+{
+	beginSave();
+	m_in_batch = true;
+}
+
+void PlayerDatabaseSQLite3::endSaveBatch()
+{
+	m_in_batch = false;
+	endSave();
+}
+
 void PlayerDatabaseSQLite3::savePlayer(RemotePlayer *player)
 {
 	PlayerSAO* sao = player->getPlayerSAO();
 	sanity_check(sao);
 
+	u8 parts = player->getUnsavedParts();
 	const v3f &pos = sao->getBasePosition();
-	// Begin save in brace is mandatory
-	if (!playerDataExists(player->getName())) {
+	if (!m_in_batch)
 		beginSave();
+	if (!playerDataExists(player->getName())) {
+		// a new player, nothing is stored yet
+		parts = RemotePlayer::UNSAVED_ALL;
+
 		str_to_sqlite(m_stmt_player_add, 1, player->getName());
 		double_to_sqlite(m_stmt_player_add, 2, sao->getLookPitch());
 		double_to_sqlite(m_stmt_player_add, 3, sao->getRotation().Y);
@@ -497,7 +775,6 @@ void PlayerDatabaseSQLite3::savePlayer(RemotePlayer *player)
 		sqlite3_vrfy(sqlite3_step(m_stmt_player_add), SQLITE_DONE);
 		sqlite3_reset(m_stmt_player_add);
 	} else {
-		beginSave();
 		double_to_sqlite(m_stmt_player_update, 1, sao->getLookPitch());
 		double_to_sqlite(m_stmt_player_update, 2, sao->getRotation().Y);
 		double_to_sqlite(m_stmt_player_update, 3, pos.X);
@@ -511,57 +788,62 @@ void PlayerDatabaseSQLite3::savePlayer(RemotePlayer *player)
 		sqlite3_reset(m_stmt_player_update);
 	}
 
-	// Write player inventories
-	str_to_sqlite(m_stmt_player_remove_inventory, 1, player->getName());
-	sqlite3_vrfy(sqlite3_step(m_stmt_player_remove_inventory), SQLITE_DONE);
-	sqlite3_reset(m_stmt_player_remove_inventory);
-
-	str_to_sqlite(m_stmt_player_remove_inventory_items, 1, player->getName());
-	sqlite3_vrfy(sqlite3_step(m_stmt_player_remove_inventory_items), SQLITE_DONE);
-	sqlite3_reset(m_stmt_player_remove_inventory_items);
-
-	const auto &inventory_lists = sao->getInventory()->getLists();
-	std::ostringstream oss;
-	for (u16 i = 0; i < inventory_lists.size(); i++) {
-		const InventoryList *list = inventory_lists[i];
-
-		str_to_sqlite(m_stmt_player_add_inventory, 1, player->getName());
-		int_to_sqlite(m_stmt_player_add_inventory, 2, i);
-		int_to_sqlite(m_stmt_player_add_inventory, 3, list->getWidth());
-		str_to_sqlite(m_stmt_player_add_inventory, 4, list->getName());
-		int_to_sqlite(m_stmt_player_add_inventory, 5, list->getSize());
-		sqlite3_vrfy(sqlite3_step(m_stmt_player_add_inventory), SQLITE_DONE);
-		sqlite3_reset(m_stmt_player_add_inventory);
-
-		for (u32 j = 0; j < list->getSize(); j++) {
-			oss.str("");
-			oss.clear();
-			list->getItem(j).serialize(oss);
-			std::string itemStr = oss.str();
-
-			str_to_sqlite(m_stmt_player_add_inventory_items, 1, player->getName());
-			int_to_sqlite(m_stmt_player_add_inventory_items, 2, i);
-			int_to_sqlite(m_stmt_player_add_inventory_items, 3, j);
-			str_to_sqlite(m_stmt_player_add_inventory_items, 4, itemStr);
-			sqlite3_vrfy(sqlite3_step(m_stmt_player_add_inventory_items), SQLITE_DONE);
-			sqlite3_reset(m_stmt_player_add_inventory_items);
+	if (parts & RemotePlayer::UNSAVED_INVENTORY) {
+		// Write player inventories
+		str_to_sqlite(m_stmt_player_remove_inventory, 1, player->getName());
+		sqlite3_vrfy(sqlite3_step(m_stmt_player_remove_inventory), SQLITE_DONE);
+		sqlite3_reset(m_stmt_player_remove_inventory);
+
+		str_to_sqlite(m_stmt_player_remove_inventory_items, 1, player->getName());
+		sqlite3_vrfy(sqlite3_step(m_stmt_player_remove_inventory_items), SQLITE_DONE);
+		sqlite3_reset(m_stmt_player_remove_inventory_items);
+
+		const auto &inventory_lists = sao->getInventory()->getLists();
+		std::ostringstream oss;
+		for (u16 i = 0; i < inventory_lists.size(); i++) {
+			const InventoryList *list = inventory_lists[i];
+
+			str_to_sqlite(m_stmt_player_add_inventory, 1, player->getName());
+			int_to_sqlite(m_stmt_player_add_inventory, 2, i);
+			int_to_sqlite(m_stmt_player_add_inventory, 3, list->getWidth());
+			str_to_sqlite(m_stmt_player_add_inventory, 4, list->getName());
+			int_to_sqlite(m_stmt_player_add_inventory, 5, list->getSize());
+			sqlite3_vrfy(sqlite3_step(m_stmt_player_add_inventory), SQLITE_DONE);
+			sqlite3_reset(m_stmt_player_add_inventory);
+
+			for (u32 j = 0; j < list->getSize(); j++) {
+				oss.str("");
+				oss.clear();
+				list->getItem(j).serialize(oss);
+				std::string itemStr = oss.str();
+
+				str_to_sqlite(m_stmt_player_add_inventory_items, 1, player->getName());
+				int_to_sqlite(m_stmt_player_add_inventory_items, 2, i);
+				int_to_sqlite(m_stmt_player_add_inventory_items, 3, j);
+				str_to_sqlite(m_stmt_player_add_inventory_items, 4, itemStr);
+				sqlite3_vrfy(sqlite3_step(m_stmt_player_add_inventory_items), SQLITE_DONE);
+				sqlite3_reset(m_stmt_player_add_inventory_items);
+			}
 		}
 	}
 
-	str_to_sqlite(m_stmt_player_metadata_remove, 1, player->getName());
-	sqlite3_vrfy(sqlite3_step(m_stmt_player_metadata_remove), SQLITE_DONE);
-	sqlite3_reset(m_stmt_player_metadata_remove);
-
-	const StringMap &attrs = sao->getMeta().getStrings();
-	for (const auto &attr : attrs) {
-		str_to_sqlite(m_stmt_player_metadata_add, 1, player->getName());
-		str_to_sqlite(m_stmt_player_metadata_add, 2, attr.first);
-		str_to_sqlite(m_stmt_player_metadata_add, 3, attr.second);
-		sqlite3_vrfy(sqlite3_step(m_stmt_player_metadata_add), SQLITE_DONE);
-		sqlite3_reset(m_stmt_player_metadata_add);
+	if (parts & RemotePlayer::UNSAVED_META) {
+		str_to_sqlite(m_stmt_player_metadata_remove, 1, player->getName());
+		sqlite3_vrfy(sqlite3_step(m_stmt_player_metadata_remove), SQLITE_DONE);
+		sqlite3_reset(m_stmt_player_metadata_remove);
+
+		const StringMap &attrs = sao->getMeta().getStrings();
+		for (const auto &attr : attrs) {
+			str_to_sqlite(m_stmt_player_metadata_add, 1, player->getName());
+			str_to_sqlite(m_stmt_player_metadata_add, 2, attr.first);
+			str_to_sqlite(m_stmt_player_metadata_add, 3, attr.second);
+			sqlite3_vrfy(sqlite3_step(m_stmt_player_metadata_add), SQLITE_DONE);
+			sqlite3_reset(m_stmt_player_metadata_add);
+		}
 	}
 
-	endSave();
+	if (!m_in_batch)
+		endSave();
 
 	player->onSuccessfulSave();
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cstring>
+#include <memory>
 #include <string>
 #include "database.h"
 #include "exceptions.h"
@@ -13,6 +14,8 @@ extern "C" {
 #include "sqlite3.h"
 }
 
+class WorkerPool;
+
 // Template class for SQLite3 based data storage
 class Database_SQLite3 : public Database
 {
@@ -169,13 +172,18 @@ class Database_SQLite3 : public Database
 class MapDatabaseSQLite3 : private Database_SQLite3, public MapDatabase
 {
 public:
-	MapDatabaseSQLite3(const std::string &savedir);
+	MapDatabaseSQLite3(const std::string &savedir, const std::string &dbname = "map");
 	virtual ~MapDatabaseSQLite3();
 
 	bool saveBlock(const v3s16 &pos, std::string_view data);
 	void loadBlock(const v3s16 &pos, std::string *block);
+	void loadBlocks(const std::vector<v3s16> &positions,
+		const LoadBlockCallback &cb);
 	bool deleteBlock(const v3s16 &pos);
 	void listAllLoadableBlocks(std::vector<v3s16> &dst);
+	void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+	std::unique_ptr<MapDatabaseBackup> createBackup(const std::string &dir);
 
 	PARENT_CLASS_FUNCS
 
@@ -193,9 +201,44 @@ class MapDatabaseSQLite3 : private Database_SQLite3, public MapDatabase
 	sqlite3_stmt *m_stmt_read = nullptr;
 	sqlite3_stmt *m_stmt_write = nullptr;
 	sqlite3_stmt *m_stmt_list = nullptr;
+	sqlite3_stmt *m_stmt_list_after = nullptr;
 	sqlite3_stmt *m_stmt_delete = nullptr;
 };
 
+/*
+	Spreads the blocks over several SQLite databases in map_shards/,
+	by regions of 8x8x8 blocks. Saves are committed in parallel and every
+	file stays small enough to be vacuumed on its own.
+
+	The number of shards is fixed once the world exists.
+*/
+class MapDatabaseSQLite3Sharded : public MapDatabase
+{
+public:
+	// num_shards is used for new worlds only
+	MapDatabaseSQLite3Sharded(const std::string &savedir, u32 num_shards);
+	virtual ~MapDatabaseSQLite3Sharded();
+
+	bool saveBlock(const v3s16 &pos, std::string_view data);
+	void loadBlock(const v3s16 &pos, std::string *block);
+	bool deleteBlock(const v3s16 &pos);
+	void listAllLoadableBlocks(std::vector<v3s16> &dst);
+	void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+
+	void beginSave();
+	void endSave();
+	void verifyDatabase();
+
+	u32 getShardCount() const { return m_shards.size(); }
+	u32 getShard(v3s16 pos) const;
+
+private:
+	std::vector<std::unique_ptr<MapDatabaseSQLite3>> m_shards;
+	// commits the shards in parallel
+	std::unique_ptr<WorkerPool> m_pool;
+};
+
 class PlayerDatabaseSQLite3 : private Database_SQLite3, public PlayerDatabase
 {
 public:
@@ -206,6 +249,8 @@ class PlayerDatabaseSQLite3 : private Database_SQLite3, public PlayerDatabase
 	bool loadPlayer(RemotePlayer *player, PlayerSAO *sao);
 	bool removePlayer(const std::string &name);
 	void listPlayers(std::vector<std::string> &res);
+	void beginSaveBatch();
+	void endSaveBatch();
 
 	PARENT_CLASS_FUNCS
 
@@ -214,6 +259,8 @@ class PlayerDatabaseSQLite3 : private Database_SQLite3, public PlayerDatabase
 	virtual void initStatements();
 
 private:
+	bool m_in_batch = false;
+
 	bool playerDataExists(const std::string &name);
 
 	// Players
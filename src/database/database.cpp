@@ -27,3 +27,23 @@ v3s16 MapDatabase::getIntegerAsBlock(s64 i)
 	         (s16)(((i >> 12) & 0xFFF) - 0x800),
 	         (s16)(((i >> 24) & 0xFFF) - 0x800) };
 }
+
+
+void MapDatabase::loadBlocks(const std::vector<v3s16> &positions,
+	const LoadBlockCallback &cb)
+{
+	std::string data;
+	for (v3s16 pos : positions) {
+		loadBlock(pos, &data);
+		cb(pos, data);
+	}
+}
+
+void MapDatabase::listLoadableBlocks(ListCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (cursor.done)
+		return;
+	listAllLoadableBlocks(dst);
+	cursor.done = true;
+}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -24,6 +26,21 @@ class Database
 	virtual void verifyDatabase() {};
 };
 
+/// Copies a map database into another directory while it stays in use
+class MapDatabaseBackup
+{
+public:
+	virtual ~MapDatabaseBackup() = default;
+
+	/// Copies the next part of the database. Must not run at the same time
+	/// as other calls on the source database.
+	/// @return true once the copy is complete
+	virtual bool step() = 0;
+
+	/// Backend of the copy, for its world.mt
+	virtual const char *getBackend() const = 0;
+};
+
 class MapDatabase : public Database
 {
 public:
@@ -33,10 +50,42 @@ class MapDatabase : public Database
 	virtual void loadBlock(const v3s16 &pos, std::string *block) = 0;
 	virtual bool deleteBlock(const v3s16 &pos) = 0;
 
+	/// Receives the data of a block, which is empty if it does not exist.
+	/// The callee may take the data.
+	using LoadBlockCallback = std::function<void(v3s16 pos, std::string &data)>;
+
+	/// Loads several blocks at once, calling cb once per position in order.
+	/// Backends override this to save round trips, by default every block
+	/// is loaded on its own.
+	virtual void loadBlocks(const std::vector<v3s16> &positions,
+		const LoadBlockCallback &cb);
+
 	static s64 getBlockAsInteger(const v3s16 &pos);
 	static v3s16 getIntegerAsBlock(s64 i);
 
 	virtual void listAllLoadableBlocks(std::vector<v3s16> &dst) = 0;
+
+	/// Where a listing by listLoadableBlocks() left off
+	struct ListCursor {
+		/// Backend specific, empty at the start
+		std::string state;
+		/// Set once every block was listed
+		bool done = false;
+	};
+
+	/// Appends the positions of roughly max_count more blocks to dst, so that
+	/// huge maps can be processed in chunks. Blocks saved or deleted in the
+	/// meantime may or may not be listed, some backends list a few twice.
+	/// By default everything is listed at once.
+	virtual void listLoadableBlocks(ListCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+
+	/// Starts a backup into dir, using whatever the backend has for copying
+	/// a consistent state of the database. nullptr if it has nothing.
+	virtual std::unique_ptr<MapDatabaseBackup> createBackup(const std::string &dir)
+	{
+		return nullptr;
+	}
 };
 
 class PlayerSAO;
@@ -47,10 +96,16 @@ class PlayerDatabase
 public:
 	virtual ~PlayerDatabase() = default;
 
+	/// Backends may skip the parts that didn't change since the last save,
+	/// see RemotePlayer::getUnsavedParts().
 	virtual void savePlayer(RemotePlayer *player) = 0;
 	virtual bool loadPlayer(RemotePlayer *player, PlayerSAO *sao) = 0;
 	virtual bool removePlayer(const std::string &name) = 0;
 	virtual void listPlayers(std::vector<std::string> &res) = 0;
+
+	/// Players saved in between are written in one transaction, if supported
+	virtual void beginSaveBatch() {}
+	virtual void endSaveBatch() {}
 };
 
 struct AuthEntry
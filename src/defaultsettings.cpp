@@ -104,6 +104,7 @@ void set_default_settings()
 	settings->setDefault("sound_extensions_blacklist", "");
 	settings->setDefault("mesh_generation_interval", "0");
 	settings->setDefault("mesh_generation_threads", "0");
+	settings->setDefault("mesh_update_time_budget", "4");
 	settings->setDefault("mesh_buffer_min_vertices", "300");
 	settings->setDefault("free_move", "false");
 	settings->setDefault("pitch_move", "false");
@@ -114,6 +115,8 @@ void set_default_settings()
 	settings->setDefault("screenshot_quality", "0");
 	settings->setDefault("client_unload_unused_data_timeout", "600");
 	settings->setDefault("client_mapblock_limit", "7500"); // about 120 MB
+	settings->setDefault("client_block_memory_budget", "0");
+	settings->setDefault("client_mesh_memory_budget", "0");
 	settings->setDefault("enable_build_where_you_stand", "false");
 	settings->setDefault("curl_timeout", "20000");
 	settings->setDefault("curl_parallel_limit", "8");
@@ -126,6 +129,8 @@ void set_default_settings()
 	settings->setDefault("enable_split_login_register", "true");
 	settings->setDefault("occlusion_culler", "bfs");
 	settings->setDefault("enable_raytraced_culling", "true");
+	settings->setDefault("enable_depth_culling", "true");
+	settings->setDefault("threaded_draw_list", "true");
 	settings->setDefault("chat_weblink_color", "#8888FF");
 
 	// Keymap
@@ -245,6 +250,9 @@ void set_default_settings()
 #endif
 	settings->setDefault("fsaa", "2");
 	settings->setDefault("undersampling", "1");
+	settings->setDefault("dynamic_resolution", "false");
+	settings->setDefault("dynamic_resolution_target_fps", "60");
+	settings->setDefault("dynamic_resolution_min_scale", "0.5");
 	settings->setDefault("world_aligned_mode", "enable");
 	settings->setDefault("autoscale_mode", "disable");
 	settings->setDefault("texture_min_size", std::to_string(TEXTURE_FILTER_MIN_SIZE));
@@ -269,6 +277,15 @@ void set_default_settings()
 	settings->setDefault("connected_glass", "false");
 	settings->setDefault("smooth_lighting", "true");
 	settings->setDefault("performance_tradeoffs", "false");
+	settings->setDefault("merge_solid_faces", "false");
+	settings->setDefault("mesh_lod_distance", "0");
+	settings->setDefault("enable_texture_arrays", "false");
+	settings->setDefault("texture_disk_cache", "true");
+	settings->setDefault("texture_memory_budget", "0");
+	settings->setDefault("model_disk_cache", "true");
+	settings->setDefault("enable_hardware_skinning", "true");
+	settings->setDefault("enable_entity_instancing", "true");
+	settings->setDefault("cheap_particle_collision", "false");
 	settings->setDefault("lighting_alpha", "0.0");
 	settings->setDefault("lighting_beta", "1.5");
 	settings->setDefault("display_gamma", "1.0");
@@ -277,6 +294,7 @@ void set_default_settings()
 	settings->setDefault("lighting_boost_spread", "0.2");
 	settings->setDefault("texture_path", "");
 	settings->setDefault("shader_path", "");
+	settings->setDefault("shader_cache", "true");
 	settings->setDefault("video_driver", "");
 	settings->setDefault("cinematic", "false");
 	settings->setDefault("camera_smoothing", "0.0");
@@ -304,6 +322,7 @@ void set_default_settings()
 	settings->setDefault("smooth_scrolling", "true");
 	settings->setDefault("hud_hotbar_max_width", "1.0");
 	settings->setDefault("enable_local_map_saving", "false");
+	settings->setDefault("client_block_cache", "true");
 	settings->setDefault("show_entity_selectionbox", "false");
 	settings->setDefault("ambient_occlusion_gamma", "1.8");
 	settings->setDefault("arm_inertia", "true");
@@ -338,7 +357,9 @@ void set_default_settings()
 	settings->setDefault("antialiasing", "none");
 	settings->setDefault("enable_bloom", "false");
 	settings->setDefault("enable_bloom_debug", "false");
+	settings->setDefault("bloom_resolution_scale", "1.0");
 	settings->setDefault("enable_volumetric_lighting", "false");
+	settings->setDefault("volumetric_lighting_resolution_scale", "1.0");
 	settings->setDefault("enable_water_reflections", "false");
 	settings->setDefault("enable_translucent_foliage", "false");
 
@@ -436,6 +457,9 @@ void set_default_settings()
 	settings->setDefault("enable_ipv6", "true");
 	settings->setDefault("ipv6_server", "true");
 	settings->setDefault("max_packets_per_iteration", "1024");
+	settings->setDefault("packet_decode_async", "false");
+	settings->setDefault("congestion_control", "bbr");
+	settings->setDefault("network_stream_compression", "false");
 	settings->setDefault("port", "30000");
 	settings->setDefault("strict_protocol_version_checking", "false");
 	settings->setDefault("protocol_version_min", "1");
@@ -463,13 +487,22 @@ void set_default_settings()
 
 	settings->setDefault("chat_message_format", "<@name> @message");
 	settings->setDefault("profiler_print_interval", "0");
+	settings->setDefault("frame_timings_csv", "");
+	settings->setDefault("packet_record_file", "");
+	settings->setDefault("fixed_random_seed", "");
 	settings->setDefault("active_object_send_range_blocks", "8");
+	settings->setDefault("active_object_full_rate_distance", "24");
+	settings->setDefault("max_ephemeral_sounds_per_step", "0");
+	settings->setDefault("ephemeral_sound_coalesce_time", "0.0");
 	settings->setDefault("active_block_range", "4");
 	//settings->setDefault("max_simultaneous_block_sends_per_client", "1");
 	// This causes frametime jitter on client side, or does it?
 	settings->setDefault("max_block_send_distance", "12");
 	settings->setDefault("block_send_optimize_distance", "4");
 	settings->setDefault("block_cull_optimize_distance", "25");
+	settings->setDefault("lua_gc_idle_fraction", "0.0");
+	settings->setDefault("lua_gc_pause", "200");
+	settings->setDefault("lua_gc_stepmul", "200");
 	settings->setDefault("server_side_occlusion_culling", "true");
 	settings->setDefault("csm_restriction_flags", "62");
 	settings->setDefault("csm_restriction_noderange", "0");
@@ -478,19 +511,38 @@ void set_default_settings()
 	settings->setDefault("world_start_time", "6125");
 	settings->setDefault("server_unload_unused_data_timeout", "29");
 	settings->setDefault("max_objects_per_block", "256");
+	settings->setDefault("compact_mapblocks", "false");
 	settings->setDefault("server_map_save_interval", "5.3");
+	settings->setDefault("map_save_async", "false");
+	settings->setDefault("block_serialize_threads", "0");
+	settings->setDefault("block_prefetch_cache_size", "0");
+	settings->setDefault("block_existence_index", "false");
 	settings->setDefault("chat_message_max_size", "500");
 	settings->setDefault("chat_message_limit_per_10sec", "8.0");
 	settings->setDefault("chat_message_limit_trigger_kick", "50");
 	settings->setDefault("sqlite_synchronous", "2");
+	settings->setDefault("pgsql_save_batch_size", "256");
 	settings->setDefault("map_compression_level_disk", "-1");
+	settings->setDefault("map_compression_dictionary", "false");
 	settings->setDefault("map_compression_level_net", "-1");
+	settings->setDefault("block_send_cache_size", "64");
 	settings->setDefault("full_block_send_enable_min_time_from_building", "2.0");
 	settings->setDefault("dedicated_server_step", "0.09");
 	settings->setDefault("active_block_mgmt_interval", "2.0");
 	settings->setDefault("abm_interval", "1.0");
 	settings->setDefault("abm_time_budget", "0.2");
+	settings->setDefault("abm_scan_threads", "0");
+	settings->setDefault("entity_physics_threads", "0");
+	settings->setDefault("raycast_batch_threads", "0");
+	settings->setDefault("active_object_index", "kdtree");
+	settings->setDefault("entity_sleep_distance", "40.0");
+	settings->setDefault("object_activation_threads", "0");
+	settings->setDefault("object_activation_time_budget", "0.05");
+	settings->setDefault("pathfinder_hierarchical", "true");
+	settings->setDefault("pathfinder_async_threads", "1");
+	settings->setDefault("pathfinder_async_max_jobs", "64");
 	settings->setDefault("nodetimer_interval", "0.2");
+	settings->setDefault("nodetimer_time_budget", "0.5");
 	settings->setDefault("ignore_world_load_errors", "false");
 	settings->setDefault("remote_media", "");
 	settings->setDefault("debug_log_level", "action");
@@ -500,6 +552,7 @@ void set_default_settings()
 	settings->setDefault("emergequeue_limit_diskonly", "128");
 	settings->setDefault("emergequeue_limit_generate", "128");
 	settings->setDefault("num_emerge_threads", "1");
+	settings->setDefault("mapgen_column_cache_size", "32");
 	settings->setDefault("secure.enable_security", "true");
 	settings->setDefault("secure.trusted_mods", "");
 	settings->setDefault("secure.http_mods", "");
@@ -521,6 +574,7 @@ void set_default_settings()
 	// Liquids
 	settings->setDefault("liquid_loop_max", "100000");
 	settings->setDefault("liquid_queue_purge_time", "0");
+	settings->setDefault("liquid_threads", "0");
 	settings->setDefault("liquid_update", "1.0");
 
 	// Mapgen
@@ -542,6 +596,7 @@ void set_default_settings()
 	settings->setDefault("server_announce_send_players", "true");
 
 	settings->setDefault("enable_console", "false");
+	settings->setDefault("job_threads", "0");
 	settings->setDefault("display_density_factor", "1");
 	settings->setDefault("dpi_change_notifier", "0");
 
@@ -567,6 +622,8 @@ void set_default_settings()
 	settings->setDefault("sqlite_synchronous", "1");
 	settings->setDefault("server_map_save_interval", "15");
 	settings->setDefault("client_mapblock_limit", "1500");
+	settings->setDefault("client_block_memory_budget", "256");
+	settings->setDefault("client_mesh_memory_budget", "256");
 	settings->setDefault("active_block_range", "2");
 	settings->setDefault("viewing_range", "70");
 	settings->setDefault("leaves_style", "simple");
@@ -6,6 +6,7 @@
 
 #include "emerge_internal.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "util/container.h"
@@ -19,6 +20,7 @@
 #include "database/database.h"
 #include "mapblock.h"
 #include "mapgen/mg_biome.h"
+#include "mapgen/mg_columncache.h"
 #include "mapgen/mg_ore.h"
 #include "mapgen/mg_decoration.h"
 #include "mapgen/mg_schematic.h"
@@ -27,6 +29,7 @@
 #include "scripting_server.h"
 #include "scripting_emerge.h"
 #include "server.h"
+#include "server/blockprefetcher.h"
 #include "settings.h"
 #include "voxel.h"
 
@@ -44,16 +47,18 @@ EmergeParams::~EmergeParams()
 EmergeParams::EmergeParams(EmergeManager *parent, const BiomeGen *biomegen,
 	const BiomeManager *biomemgr,
 	const OreManager *oremgr, const DecorationManager *decomgr,
-	const SchematicManager *schemmgr) :
+	const SchematicManager *schemmgr, MapgenColumnCache *column_cache) :
 	ndef(parent->ndef),
 	enable_mapgen_debug_info(parent->enable_mapgen_debug_info),
 	gen_notify_on(parent->gen_notify_on),
 	gen_notify_on_deco_ids(&parent->gen_notify_on_deco_ids),
 	gen_notify_on_custom(&parent->gen_notify_on_custom),
 	biomemgr(biomemgr->clone()), oremgr(oremgr->clone()),
-	decomgr(decomgr->clone()), schemmgr(schemmgr->clone())
+	decomgr(decomgr->clone()), schemmgr(schemmgr->clone()),
+	column_cache(column_cache)
 {
 	this->biomegen = biomegen->clone(this->biomemgr);
+	this->biomegen->column_cache = column_cache;
 }
 
 ////
@@ -110,6 +115,10 @@ EmergeManager::EmergeManager(Server *server, MetricsBackend *mb)
 	m_qlimit_generate = rangelim(m_qlimit_generate, 1, 1000000);
 	m_qlimit_total = std::max(m_qlimit_total, std::max(m_qlimit_diskonly, m_qlimit_generate));
 
+	u32 cache_mb = g_settings->getU32("mapgen_column_cache_size");
+	if (cache_mb > 0)
+		m_column_cache = std::make_unique<MapgenColumnCache>((size_t)cache_mb * 1024 * 1024);
+
 	for (s16 i = 0; i < nthreads; i++)
 		m_threads.push_back(new EmergeThread(server, i));
 
@@ -195,7 +204,7 @@ void EmergeManager::initMapgens(MapgenParams *params)
 
 	for (u32 i = 0; i != m_threads.size(); i++) {
 		EmergeParams *p = new EmergeParams(this, biomegen,
-			biomemgr, oremgr, decomgr, schemmgr);
+			biomemgr, oremgr, decomgr, schemmgr, m_column_cache.get());
 		infostream << "EmergeManager: Created params " << p
 			<< " for thread " << i << std::endl;
 		m_mapgens.push_back(Mapgen::createMapgen(params->mgtype, params, p));
@@ -218,6 +227,15 @@ Mapgen *EmergeManager::getCurrentMapgen()
 }
 
 
+size_t EmergeManager::getScriptMemoryUsage()
+{
+	size_t bytes = 0;
+	for (EmergeThread *thread : m_threads)
+		bytes += thread->m_script_memory.load(std::memory_order_relaxed);
+	return bytes;
+}
+
+
 void EmergeManager::startThreads()
 {
 	if (m_threads_active)
@@ -278,7 +296,7 @@ bool EmergeManager::enqueueBlockEmergeEx(
 	EmergeCompletionCallback callback,
 	void *callback_param)
 {
-	EmergeThread *thread = NULL;
+	EmergeThread *thread = nullptr;
 	bool entry_already_exists = false;
 
 	{
@@ -291,11 +309,15 @@ bool EmergeManager::enqueueBlockEmergeEx(
 		if (entry_already_exists)
 			return true;
 
-		thread = getOptimalThread();
-		thread->pushBlock(blockpos);
+		if (!m_idle_threads.empty()) {
+			thread = m_idle_threads.back();
+			m_idle_threads.pop_back();
+		}
 	}
 
-	thread->signal();
+	// Otherwise a busy thread takes it once it is done
+	if (thread)
+		thread->signal();
 
 	return true;
 }
@@ -313,6 +335,60 @@ bool EmergeManager::isBlockInQueue(v3s16 pos)
 	return m_blocks_enqueued.find(pos) != m_blocks_enqueued.end();
 }
 
+size_t EmergeManager::cancelBlockEmerges(session_t peer_id, v3s16 center, s16 max_d)
+{
+	MutexAutoLock queuelock(m_queue_mutex);
+
+	m_peer_centers[peer_id] = center;
+	return cancelEmerges(peer_id, [&] (v3s16 pos) {
+		v3s16 d = pos - center;
+		return std::max({std::abs(d.X), std::abs(d.Y), std::abs(d.Z)}) > max_d;
+	});
+}
+
+size_t EmergeManager::removePeer(session_t peer_id)
+{
+	MutexAutoLock queuelock(m_queue_mutex);
+
+	m_peer_centers.erase(peer_id);
+	return cancelEmerges(peer_id, [] (v3s16) {
+		return true;
+	});
+}
+
+size_t EmergeManager::cancelEmerges(session_t peer_id,
+	const std::function<bool(v3s16)> &drop)
+{
+	auto count_it = m_peer_queue_count.find(peer_id);
+	if (count_it == m_peer_queue_count.end() || count_it->second == 0)
+		return 0;
+
+	size_t cancelled = 0;
+	for (auto it = m_blocks_enqueued.begin(); it != m_blocks_enqueued.end();) {
+		BlockEmergeData &bedata = it->second;
+		if (bedata.peer_requested != peer_id) {
+			++it;
+			continue;
+		}
+		if (!bedata.callbacks.empty() ||
+				(bedata.flags & BLOCK_EMERGE_FORCE_QUEUE) || !drop(it->first)) {
+			// the player moved, so did the distance
+			setPriority(it->first, bedata, getPriority(it->first));
+			++it;
+			continue;
+		}
+
+		m_block_queue.erase(std::make_pair(bedata.priority, bedata.seq));
+		it = m_blocks_enqueued.erase(it);
+		assert(count_it->second != 0);
+		count_it->second--;
+		reportCompletedEmerge(EMERGE_CANCELLED);
+		cancelled++;
+	}
+
+	return cancelled;
+}
+
 
 //
 // Mapgen-related helper functions
@@ -383,11 +459,17 @@ bool EmergeManager::pushBlockEmergeData(
 	if (callback)
 		bedata.callbacks.emplace_back(callback, callback_param);
 
+	const u32 priority = getPriority(pos);
 	if (*entry_already_exists) {
 		bedata.flags |= flags;
+		if (priority < bedata.priority)
+			setPriority(pos, bedata, priority);
 	} else {
 		bedata.flags = flags;
 		bedata.peer_requested = peer_requested;
+		bedata.priority = priority;
+		bedata.seq = m_next_seq++;
+		m_block_queue.emplace(std::make_pair(priority, bedata.seq), pos);
 
 		count_peer++;
 	}
@@ -402,41 +484,41 @@ bool EmergeManager::popBlockEmergeData(v3s16 pos, BlockEmergeData *bedata)
 	if (it == m_blocks_enqueued.end())
 		return false;
 
-	*bedata = it->second;
+	*bedata = std::move(it->second);
+	m_block_queue.erase(std::make_pair(bedata->priority, bedata->seq));
+	m_blocks_enqueued.erase(it);
 
 	auto it2 = m_peer_queue_count.find(bedata->peer_requested);
-	if (it2 == m_peer_queue_count.end())
-		return false;
-
-	u32 &count_peer = it2->second;
-
-	assert(count_peer != 0);
-	count_peer--;
-
-	m_blocks_enqueued.erase(it);
+	if (it2 != m_peer_queue_count.end()) {
+		assert(it2->second != 0);
+		it2->second--;
+	}
 
 	return true;
 }
 
 
-EmergeThread *EmergeManager::getOptimalThread()
+u32 EmergeManager::getPriority(v3s16 pos) const
 {
-	size_t nthreads = m_threads.size();
-
-	FATAL_ERROR_IF(nthreads == 0, "No emerge threads!");
+	// Without players the queue is first come, first served
+	u32 priority = m_peer_centers.empty() ? 0 : U32_MAX;
+	for (const auto &it : m_peer_centers) {
+		v3s16 d = pos - it.second;
+		priority = std::min<u32>(priority,
+			std::max({std::abs(d.X), std::abs(d.Y), std::abs(d.Z)}));
+	}
+	return priority;
+}
 
-	size_t index = 0;
-	size_t nitems_lowest = m_threads[0]->m_block_queue.size();
 
-	for (size_t i = 1; i < nthreads; i++) {
-		size_t nitems = m_threads[i]->m_block_queue.size();
-		if (nitems < nitems_lowest) {
-			index = i;
-			nitems_lowest = nitems;
-		}
-	}
+void EmergeManager::setPriority(v3s16 pos, BlockEmergeData &bedata, u32 priority)
+{
+	if (priority == bedata.priority)
+		return;
 
-	return m_threads[index];
+	m_block_queue.erase(std::make_pair(bedata.priority, bedata.seq));
+	bedata.priority = priority;
+	m_block_queue.emplace(std::make_pair(priority, bedata.seq), pos);
 }
 
 void EmergeManager::reportCompletedEmerge(EmergeAction action)
@@ -469,23 +551,15 @@ void EmergeThread::signal()
 }
 
 
-bool EmergeThread::pushBlock(v3s16 pos)
-{
-	m_block_queue.push(pos);
-	return true;
-}
-
-
 void EmergeThread::cancelPendingItems()
 {
 	MutexAutoLock queuelock(m_emerge->m_queue_mutex);
 
-	while (!m_block_queue.empty()) {
+	// All threads stop together, the first one cancels everything
+	auto &queue = m_emerge->m_block_queue;
+	while (!queue.empty()) {
 		BlockEmergeData bedata;
-		v3s16 pos;
-
-		pos = m_block_queue.front();
-		m_block_queue.pop();
+		v3s16 pos = queue.begin()->second;
 
 		m_emerge->popBlockEmergeData(pos, &bedata);
 
@@ -515,23 +589,110 @@ bool EmergeThread::popBlockEmerge(v3s16 *pos, BlockEmergeData *bedata)
 {
 	MutexAutoLock queuelock(m_emerge->m_queue_mutex);
 
-	if (m_block_queue.empty())
+	auto &queue = m_emerge->m_block_queue;
+	if (queue.empty()) {
+		// signaled by the next enqueueBlockEmergeEx()
+		auto &idle = m_emerge->m_idle_threads;
+		if (std::find(idle.begin(), idle.end(), this) == idle.end())
+			idle.push_back(this);
 		return false;
+	}
+
+	*pos = queue.begin()->second;
+	return m_emerge->popBlockEmergeData(*pos, bedata);
+}
 
-	*pos = m_block_queue.front();
-	m_block_queue.pop();
 
-	m_emerge->popBlockEmergeData(*pos, bedata);
+void EmergeThread::loadFromDatabase(v3s16 pos, std::string &data)
+{
+	// Blocks to fetch together with the requested one
+	constexpr size_t PREFETCH_MAX = 32;
+	// A prefetched block might have been loaded, changed, saved and unloaded
+	// again by now. Keeping the data only briefly makes that impossible in
+	// practice, unloading takes much longer.
+	constexpr u64 PREFETCH_MAX_AGE_MS = 1000;
 
-	return true;
+	auto &m_db = *m_emerge->m_db;
+	// blocks read ahead based on player movement, see ServerMap::prefetchBlocks()
+	if (m_db.prefetcher && m_db.prefetcher->take(pos, data)) {
+		g_profiler->add(m_name + ": prefetched blocks used [#]", 1);
+		return;
+	}
+
+	std::vector<v3s16> batch{pos};
+	{
+		MutexAutoLock queuelock(m_emerge->m_queue_mutex);
+		auto &prefetched = m_emerge->m_prefetched;
+		const u64 now = porting::getTimeMs();
+		auto it = prefetched.find(pos);
+		if (it != prefetched.end() && now - it->second.time < PREFETCH_MAX_AGE_MS) {
+			data = std::move(it->second.data);
+			prefetched.erase(it);
+			g_profiler->add(m_name + ": prefetched blocks used [#]", 1);
+			return;
+		}
+		for (auto it = prefetched.begin(); it != prefetched.end();) {
+			if (now - it->second.time >= PREFETCH_MAX_AGE_MS)
+				it = prefetched.erase(it);
+			else
+				++it;
+		}
+
+		// the front of the queue is what the threads take next
+		auto &prefetching = m_emerge->m_prefetching;
+		for (const auto &it : m_emerge->m_block_queue) {
+			if (batch.size() >= PREFETCH_MAX)
+				break;
+			v3s16 p = it.second;
+			if (p != pos && prefetched.find(p) == prefetched.end() &&
+					prefetching.insert(p).second)
+				batch.push_back(p);
+		}
+	}
+	if (batch.size() > 1) {
+		Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
+		std::vector<v3s16> loaded;
+		auto it = std::remove_if(batch.begin() + 1, batch.end(), [&] (v3s16 p) {
+			return blockpos_over_max_limit(p) || m_map->getBlockNoCreateNoEx(p);
+		});
+		loaded.assign(it, batch.end());
+		batch.erase(it, batch.end());
+		if (!loaded.empty()) {
+			MutexAutoLock queuelock(m_emerge->m_queue_mutex);
+			for (v3s16 p : loaded)
+				m_emerge->m_prefetching.erase(p);
+		}
+	}
+
+	std::vector<std::pair<v3s16, std::string>> results;
+	{
+		MutexAutoLock dblock(m_db.mutex);
+		// Note: this can throw an exception, but there isn't really
+		// a good, safe way to handle it.
+		m_db.loadBlocks(batch, [&] (v3s16 p, std::string &blob) {
+			if (p == pos)
+				data = std::move(blob);
+			else
+				results.emplace_back(p, std::move(blob));
+		});
+	}
+	if (batch.size() == 1)
+		return;
+
+	MutexAutoLock queuelock(m_emerge->m_queue_mutex);
+	const u64 now = porting::getTimeMs();
+	for (auto &it : results)
+		m_emerge->m_prefetched[it.first] = {std::move(it.second), now};
+	for (size_t i = 1; i < batch.size(); i++)
+		m_emerge->m_prefetching.erase(batch[i]);
 }
 
 
 EmergeAction EmergeThread::getBlockOrStartGen(const v3s16 pos, bool allow_gen,
-	 const std::string *from_db, MapBlock **block, BlockMakeData *bmdata)
+	 const std::string *from_db, MapBlock **block)
 {
 	//TimeTaker tt("", nullptr, PRECISION_MICRO);
-	Server::EnvAutoLock envlock(m_server);
+	Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
 	//g_profiler->avg("EmergeThread: lock wait time [us]", tt.stop());
 
 	auto block_ok = [] (MapBlock *b) {
@@ -561,8 +722,8 @@ EmergeAction EmergeThread::getBlockOrStartGen(const v3s16 pos, bool allow_gen,
 		}
 	}
 
-	// 3). Attempt to start generation
-	if (allow_gen && m_map->initBlockMake(pos, bmdata))
+	// 3). Generate it, see startGen()
+	if (allow_gen)
 		return EMERGE_GENERATED;
 
 	// All attempts failed; cancel this block emerge
@@ -570,12 +731,70 @@ EmergeAction EmergeThread::getBlockOrStartGen(const v3s16 pos, bool allow_gen,
 }
 
 
+EmergeAction EmergeThread::startGen(v3s16 pos, MapBlock **block,
+	BlockMakeData *bmdata)
+{
+	const s16 csize = m_emerge->mgparams->chunksize;
+	const v3s16 bpmin = EmergeManager::getContainingChunk(pos, csize);
+	const v3s16 full_bpmin = bpmin - v3s16(1, 1, 1);
+	const v3s16 full_bpmax = bpmin + v3s16(1, 1, 1) * csize;
+
+	{
+		static const ProfilerKey prof_key("EmergeThread: wait for chunk (sum)",
+			SPT_ADD, PRECISION_MILLI);
+		ScopeProfiler sp(g_profiler, prof_key);
+		m_map->reserveChunk(bpmin);
+	}
+
+	std::vector<v3s16> to_load;
+	{
+		Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
+		// generated by another thread while we were waiting
+		*block = m_map->getBlockNoCreateNoEx(pos);
+		if (*block && (*block)->isGenerated()) {
+			m_map->releaseChunk(bpmin);
+			return EMERGE_FROM_MEMORY;
+		}
+
+		for (s16 x = full_bpmin.X; x <= full_bpmax.X; x++)
+		for (s16 z = full_bpmin.Z; z <= full_bpmax.Z; z++)
+		for (s16 y = full_bpmin.Y; y <= full_bpmax.Y; y++) {
+			v3s16 p(x, y, z);
+			if (!blockpos_over_max_limit(p) && !m_map->getBlockNoCreateNoEx(p))
+				to_load.push_back(p);
+		}
+	}
+
+	// Nobody else generates this area now, so the blocks can be read
+	// without holding up the server
+	std::unordered_map<v3s16, std::string> preloaded;
+	if (!to_load.empty()) {
+		static const ProfilerKey prof_key("EmergeThread: load chunk - async (sum)",
+			SPT_ADD, PRECISION_MILLI);
+		ScopeProfiler sp(g_profiler, prof_key);
+		auto &db = *m_emerge->m_db;
+		MutexAutoLock dblock(db.mutex);
+		db.loadBlocks(to_load, [&] (v3s16 p, std::string &data) {
+			preloaded[p] = std::move(data);
+		});
+	}
+
+	Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
+	if (!m_map->initBlockMake(pos, bmdata, preloaded)) {
+		m_map->releaseChunk(bpmin);
+		return EMERGE_CANCELLED;
+	}
+	return EMERGE_GENERATED;
+}
+
+
 MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
 	std::map<v3s16, MapBlock *> *modified_blocks)
 {
-	Server::EnvAutoLock envlock(m_server);
-	ScopeProfiler sp(g_profiler,
-		"EmergeThread: after Mapgen::makeChunk", SPT_AVG);
+	Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
+	static const ProfilerKey prof_key("EmergeThread: after Mapgen::makeChunk",
+		SPT_AVG, PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, prof_key);
 
 	/*
 		Perform post-processing on blocks (invalidate lighting, queue liquid
@@ -670,6 +889,8 @@ void *EmergeThread::run()
 	if (!initScripting()) {
 		m_script.reset();
 		stop(); // do not enter main loop
+	} else {
+		m_script_memory.store(m_script->getMemoryUsage(), std::memory_order_relaxed);
 	}
 
 	try {
@@ -694,38 +915,41 @@ void *EmergeThread::run()
 		bool allow_gen = bedata.flags & BLOCK_EMERGE_ALLOW_GEN;
 		EMERGE_DBG_OUT("pos=" << pos << " allow_gen=" << allow_gen);
 
-		action = getBlockOrStartGen(pos, allow_gen, nullptr, &block, &bmdata);
+		action = getBlockOrStartGen(pos, allow_gen, nullptr, &block);
 
 		/* Try to load it */
 		if (action == EMERGE_FROM_DISK) {
-			auto &m_db = *m_emerge->m_db;
 			{
-				ScopeProfiler sp(g_profiler, "EmergeThread: load block - async (sum)");
-				MutexAutoLock dblock(m_db.mutex);
-				// Note: this can throw an exception, but there isn't really
-				// a good, safe way to handle it.
-				m_db.loadBlock(pos, databuf);
+				static const ProfilerKey prof_key("EmergeThread: load block - async (sum)",
+					SPT_ADD, PRECISION_MILLI);
+				ScopeProfiler sp(g_profiler, prof_key);
+				loadFromDatabase(pos, databuf);
 			}
 			// actually load it, then decide again
-			action = getBlockOrStartGen(pos, allow_gen, &databuf, &block, &bmdata);
+			action = getBlockOrStartGen(pos, allow_gen, &databuf, &block);
 			databuf.clear();
 		}
 
+		if (action == EMERGE_GENERATED)
+			action = startGen(pos, &block, &bmdata);
+
 		/* Generate it */
 		if (action == EMERGE_GENERATED) {
 			bool error = false;
 			m_trans_liquid = &bmdata.transforming_liquid;
 
 			{
-				ScopeProfiler sp(g_profiler,
-					"EmergeThread: Mapgen::makeChunk", SPT_AVG);
+				static const ProfilerKey prof_key_mapgen("EmergeThread: Mapgen::makeChunk",
+					SPT_AVG, PRECISION_MILLI);
+				ScopeProfiler sp(g_profiler, prof_key_mapgen);
 
 				m_mapgen->makeChunk(&bmdata);
 			}
 
 			{
-				ScopeProfiler sp(g_profiler,
-					"EmergeThread: Lua on_generated", SPT_AVG);
+				static const ProfilerKey prof_key_lua("EmergeThread: Lua on_generated",
+					SPT_AVG, PRECISION_MILLI);
+				ScopeProfiler sp(g_profiler, prof_key_lua);
 
 				try {
 					m_script->on_generated(&bmdata, m_mapgen->blockseed);
@@ -733,18 +957,20 @@ void *EmergeThread::run()
 					m_server->setAsyncFatalError(e);
 					error = true;
 				}
+				m_script_memory.store(m_script->getMemoryUsage(),
+					std::memory_order_relaxed);
 			}
 
 			if (!error)
 				block = finishGen(pos, &bmdata, &modified_blocks);
+			else
+				m_map->releaseChunk(bmdata.blockpos_min);
 			if (!block || error)
 				action = EMERGE_ERRORED;
 
 			m_trans_liquid = nullptr;
 		}
 
-		runCompletionCallbacks(pos, action, bedata.callbacks);
-
 		if (block)
 			modified_blocks[pos] = block;
 
@@ -752,10 +978,14 @@ void *EmergeThread::run()
 			MapEditEvent event;
 			event.type = MEET_OTHER;
 			event.setModifiedBlocks(modified_blocks);
-			Server::EnvAutoLock envlock(m_server);
+			Server::EnvAutoLock envlock(m_server, ENV_LOCK_EMERGE);
 			m_map->dispatchEvent(event);
 		}
 		modified_blocks.clear();
+
+		// After the event, so that the server can tell the clients about
+		// the block without it being marked as not sent afterwards
+		runCompletionCallbacks(pos, action, bedata.callbacks);
 	}
 	} catch (VersionMismatchException &e) {
 		std::ostringstream err;
@@ -4,8 +4,13 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "network/networkprotocol.h"
 #include "irr_v3d.h"
 #include "util/metricsbackend.h"
@@ -28,6 +33,7 @@ class BiomeManager;
 class OreManager;
 class DecorationManager;
 class SchematicManager;
+class MapgenColumnCache;
 class Server;
 class ModApiMapgen;
 struct MapDatabaseAccessor;
@@ -79,6 +85,9 @@ struct BlockEmergeData {
 	u16 peer_requested;
 	u16 flags;
 	EmergeCallbackList callbacks;
+	// key in EmergeManager::m_block_queue
+	u32 priority;
+	u64 seq;
 };
 
 class EmergeParams {
@@ -100,6 +109,7 @@ class EmergeParams {
 	OreManager *oremgr;
 	DecorationManager *decomgr;
 	SchematicManager *schemmgr;
+	MapgenColumnCache *column_cache; // shared, may be nullptr
 
 	inline GenerateNotifier createNotifier() const {
 		return GenerateNotifier(gen_notify_on, gen_notify_on_deco_ids,
@@ -110,7 +120,7 @@ class EmergeParams {
 	EmergeParams(EmergeManager *parent, const BiomeGen *biomegen,
 		const BiomeManager *biomemgr,
 		const OreManager *oremgr, const DecorationManager *decomgr,
-		const SchematicManager *schemmgr);
+		const SchematicManager *schemmgr, MapgenColumnCache *column_cache);
 };
 
 class EmergeManager {
@@ -119,6 +129,8 @@ class EmergeManager {
 	 * - using schemmgr to load and place schematics
 	 */
 	friend class ModApiMapgen;
+	// runs the mapgens directly
+	friend class MapgenBenchmark;
 public:
 	const NodeDefManager *ndef;
 	bool enable_mapgen_debug_info;
@@ -183,8 +195,20 @@ class EmergeManager {
 	size_t getQueueSize();
 	bool isBlockInQueue(v3s16 pos);
 
+	// Drops queued emerges requested by peer_id that are further than max_d
+	// (in blocks, per axis) away from center. Requests with callbacks or
+	// BLOCK_EMERGE_FORCE_QUEUE set are kept. Returns the number cancelled.
+	// center also becomes the position the queue is ordered by for this peer.
+	size_t cancelBlockEmerges(session_t peer_id, v3s16 center, s16 max_d);
+
+	// Same for a peer that disconnected, regardless of the distance
+	size_t removePeer(session_t peer_id);
+
 	Mapgen *getCurrentMapgen();
 
+	// Sum of the Lua heap sizes of the mapgen environments of all threads
+	size_t getScriptMemoryUsage();
+
 	// Mapgen helpers methods
 	int getSpawnLevelAtPoint(v2s16 p);
 	bool isBlockUnderground(v3s16 blockpos);
@@ -202,6 +226,24 @@ class EmergeManager {
 	std::mutex m_queue_mutex;
 	std::map<v3s16, BlockEmergeData> m_blocks_enqueued;
 	std::unordered_map<u16, u32> m_peer_queue_count;
+	// Queued positions, nearest to a player first, then oldest first.
+	// All threads take from here.
+	std::map<std::pair<u32, u64>, v3s16> m_block_queue;
+	u64 m_next_seq = 0;
+	// Last known position of each player, in blocks
+	std::unordered_map<session_t, v3s16> m_peer_centers;
+	// Threads waiting for something to be queued
+	std::vector<EmergeThread *> m_idle_threads;
+
+	// Blocks read from the database along with others, see
+	// EmergeThread::loadFromDatabase()
+	struct PrefetchedBlock {
+		std::string data;
+		u64 time;
+	};
+	std::unordered_map<v3s16, PrefetchedBlock> m_prefetched;
+	// being read by some thread right now
+	std::unordered_set<v3s16> m_prefetching;
 
 	u32 m_qlimit_total;
 	u32 m_qlimit_diskonly;
@@ -218,8 +260,17 @@ class EmergeManager {
 	DecorationManager *decomgr;
 	SchematicManager *schemmgr;
 
-	// Requires m_queue_mutex held
-	EmergeThread *getOptimalThread();
+	// Noise maps shared between the mapgens of all threads
+	std::unique_ptr<MapgenColumnCache> m_column_cache;
+
+	// The following require m_queue_mutex held
+
+	// Distance to the nearest player, lower is more urgent
+	u32 getPriority(v3s16 pos) const;
+	void setPriority(v3s16 pos, BlockEmergeData &bedata, u32 priority);
+	// Drops the requests of peer_id for which drop() says so, with the
+	// exceptions of cancelBlockEmerges(). The others are reordered.
+	size_t cancelEmerges(session_t peer_id, const std::function<bool(v3s16)> &drop);
 
 	bool pushBlockEmergeData(
 		v3s16 pos,
@@ -8,10 +8,9 @@
 /* may only be included by emerge.cpp or emerge scripting related */
 /******************************************************************/
 
+#include <atomic>
 #include "emerge.h"
 
-#include <queue>
-
 #include "util/thread.h"
 #include "threading/event.h"
 
@@ -33,9 +32,6 @@ class EmergeThread : public Thread {
 	void *run();
 	void signal();
 
-	// Requires queue mutex held
-	bool pushBlock(v3s16 pos);
-
 	void cancelPendingItems();
 
 	EmergeManager *getEmergeManager() { return m_emerge; }
@@ -54,16 +50,24 @@ class EmergeThread : public Thread {
 	Mapgen *m_mapgen;
 
 	std::unique_ptr<EmergeScripting> m_script;
+	// Lua heap size of m_script, published for other threads
+	std::atomic<size_t> m_script_memory{0};
 	// read from scripting:
 	UniqueQueue<v3s16> *m_trans_liquid; //< non-null only when generating a mapblock
 
 	Event m_queue_event;
-	std::queue<v3s16> m_block_queue;
 
 	bool initScripting();
 
 	bool popBlockEmerge(v3s16 *pos, BlockEmergeData *bedata);
 
+	/**
+	 * Reads a block from the database. The blocks queued after it that are
+	 * not loaded yet are fetched in the same batch and kept for a little while,
+	 * for whichever thread gets to them.
+	 */
+	void loadFromDatabase(v3s16 pos, std::string &data);
+
 	/**
 	 * Try to get a block from memory and decide what to do.
 	 *
@@ -72,11 +76,19 @@ class EmergeThread : public Thread {
 	 *                (for second call after EMERGE_FROM_DISK was returned)
 	 * @param allow_gen allow invoking mapgen?
 	 * @param block output pointer for block
-	 * @param data info for mapgen
-	 * @return what to do for this block
+	 * @return what to do for this block, EMERGE_GENERATED means startGen()
 	 */
 	EmergeAction getBlockOrStartGen(v3s16 pos, bool allow_gen,
-		const std::string *from_db,  MapBlock **block, BlockMakeData *data);
+		const std::string *from_db,  MapBlock **block);
+
+	/**
+	 * Claims the chunk of a block and prepares it for the mapgen.
+	 * The env lock is only taken for looking at the map, waiting for other
+	 * threads and reading from the database happen without it.
+	 *
+	 * @return EMERGE_GENERATED if the mapgen should run
+	 */
+	EmergeAction startGen(v3s16 pos, MapBlock **block, BlockMakeData *data);
 
 	MapBlock *finishGen(v3s16 pos, BlockMakeData *bmdata,
 		std::map<v3s16, MapBlock *> *modified_blocks);
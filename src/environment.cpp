@@ -10,6 +10,7 @@
 #include "server.h"
 #include "daynightratio.h"
 #include "emerge.h"
+#include "threading/workerpool.h"
 
 
 Environment::Environment(IGameDef *gamedef):
@@ -80,6 +81,85 @@ bool Environment::line_of_sight(v3f pos1, v3f pos2, v3s16 *p)
 	return true;
 }
 
+void Environment::line_of_sight_batch(const std::vector<core::line3d<f32>> &lines,
+	std::vector<std::optional<v3s16>> &blocked, WorkerPool *pool)
+{
+	Map &map = getMap();
+	blocked.assign(lines.size(), std::nullopt);
+
+	// Lines that start in the same block likely pass the same blocks
+	std::vector<u32> order(lines.size());
+	for (u32 i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::vector<v3s16> origins(lines.size());
+	for (u32 i = 0; i < lines.size(); i++)
+		origins[i] = getNodeBlockPos(floatToInt(lines[i].start, BS));
+	std::sort(order.begin(), order.end(), [&] (u32 a, u32 b) {
+		const v3s16 &pa = origins[a], &pb = origins[b];
+		return std::tie(pa.Z, pa.Y, pa.X) < std::tie(pb.Z, pb.Y, pb.X);
+	});
+
+	// Walk the lines on the block grid to look up each block once.
+	// Nodes in blocks that are missed due to rounding are handled below.
+	std::unordered_map<v3s16, MapBlock *> blocks;
+	for (u32 i : order) {
+		const v3f start = (lines[i].start / BS - v3f(MAP_BLOCKSIZE / 2 - 0.5f)) /
+			MAP_BLOCKSIZE;
+		voxalgo::VoxelLineIterator iterator(start,
+			lines[i].getVector() / (BS * MAP_BLOCKSIZE));
+		do {
+			const v3s16 bp = iterator.m_current_node_pos;
+			if (blocks.find(bp) == blocks.end())
+				blocks[bp] = map.getBlockNoCreateNoEx(bp);
+			iterator.next();
+		} while (iterator.m_current_index <= iterator.m_last_index);
+	}
+
+	// Only reads the blocks, which don't change during the call
+	std::vector<u8> missed(lines.size(), 0);
+	const auto trace = [&] (u32 i) {
+		voxalgo::VoxelLineIterator iterator(lines[i].start / BS,
+			lines[i].getVector() / BS);
+		MapBlock *block = nullptr;
+		v3s16 block_pos;
+		bool have_block = false;
+		do {
+			const v3s16 p = iterator.m_current_node_pos;
+			const v3s16 bp = getNodeBlockPos(p);
+			if (!have_block || bp != block_pos) {
+				auto it = blocks.find(bp);
+				if (it == blocks.end()) {
+					missed[i] = 1;
+					return;
+				}
+				block = it->second;
+				block_pos = bp;
+				have_block = true;
+			}
+			// unloaded blocks are ignore, like in line_of_sight()
+			if (!block || block->getNodeNoCheck(p - bp * MAP_BLOCKSIZE)
+					.getContent() != CONTENT_AIR) {
+				blocked[i] = p;
+				return;
+			}
+			iterator.next();
+		} while (iterator.m_current_index <= iterator.m_last_index);
+	};
+
+	if (pool) {
+		pool->run(order.size(), [&] (size_t k) { trace(order[k]); });
+	} else {
+		for (u32 i : order)
+			trace(i);
+	}
+
+	for (u32 i = 0; i < lines.size(); i++) {
+		v3s16 p;
+		if (missed[i] && !line_of_sight(lines[i].start, lines[i].end, &p))
+			blocked[i] = p;
+	}
+}
+
 /*
 	Check how a node can be pointed at
 */
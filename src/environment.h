@@ -20,6 +20,7 @@
 #include <atomic>
 #include <mutex>
 #include <optional>
+#include <vector>
 #include "irr_v3d.h"
 #include "util/basic_macros.h"
 #include "line3d.h"
@@ -29,6 +30,7 @@ class Map;
 struct PointedThing;
 class RaycastState;
 struct Pointabilities;
+class WorkerPool;
 
 class Environment
 {
@@ -73,6 +75,15 @@ class Environment
 	 */
 	bool line_of_sight(v3f pos1, v3f pos2, v3s16 *p = nullptr);
 
+	/*!
+	 * line_of_sight() for many lines. Every mapblock is looked up once,
+	 * then the lines are traversed, on the threads of pool if given.
+	 * \param blocked output, set to the position of the first non-air node
+	 * on each line, if there is one
+	 */
+	void line_of_sight_batch(const std::vector<core::line3d<f32>> &lines,
+		std::vector<std::optional<v3s16>> &blocked, WorkerPool *pool = nullptr);
+
 	/*!
 	 * Gets the objects pointed by the shootline as
 	 * pointed things.
@@ -149,6 +149,18 @@ bool IsExecutable(const std::string &path)
 	return GetBinaryType(path.c_str(), &type) != 0;
 }
 
+bool GetFileSizeAndTime(const std::string &path, u64 &size, u64 &mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data))
+		return false;
+	size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	// in 100 ns
+	mtime = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) |
+		data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
 bool RecursiveDelete(const std::string &path)
 {
 	infostream << "Recursively deleting \"" << path << "\"" << std::endl;
@@ -363,6 +375,21 @@ bool IsExecutable(const std::string &path)
 	return access(path.c_str(), X_OK) == 0;
 }
 
+bool GetFileSizeAndTime(const std::string &path, u64 &size, u64 &mtime)
+{
+	struct stat statbuf{};
+	if (stat(path.c_str(), &statbuf))
+		return false;
+	size = statbuf.st_size;
+#if defined(__APPLE__)
+	const struct timespec &t = statbuf.st_mtimespec;
+#else
+	const struct timespec &t = statbuf.st_mtim;
+#endif
+	mtime = (u64)t.tv_sec * 1000000000ULL + t.tv_nsec;
+	return true;
+}
+
 bool RecursiveDelete(const std::string &path)
 {
 	/*
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "config.h"
+#include "irrlichttypes.h"
 #include <set>
 #include <string>
 #include <string_view>
@@ -52,6 +53,11 @@ bool CreateDir(const std::string &path);
 
 [[nodiscard]] bool IsFile(const std::string &path);
 
+// Gets the size and the time of the last modification of a file. The time
+// is only good for comparing with another one of the same file.
+[[nodiscard]] bool GetFileSizeAndTime(const std::string &path, u64 &size,
+		u64 &mtime);
+
 [[nodiscard]] inline bool IsDirDelimiter(char c)
 {
 	return c == '/' || c == DIR_DELIM_CHAR;
@@ -21,7 +21,7 @@ class ModStorage;
 class ModStorageDatabase;
 struct SubgameSpec;
 struct ModSpec;
-struct ModIPCStore;
+class ModIPCStore;
 
 namespace scene {
 	class IAnimatedMesh;
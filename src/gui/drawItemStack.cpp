@@ -20,162 +20,119 @@ struct MeshTimeInfo {
 	scene::IMesh *mesh = nullptr;
 };
 
-void drawItemStack(
+static MeshTimeInfo rotation_time_infos[IT_ROT_NONE];
+
+void drawItemMesh(video::IVideoDriver *driver, const ItemStack &item,
+		ItemMesh *imesh, const core::rect<s32> &rect,
+		const core::rect<s32> &viewrect, const core::matrix4 &world,
+		Client *client)
+{
+	scene::IMesh *mesh = imesh->mesh;
+	ItemVisualsManager *item_visuals = client->getItemVisualsManager();
+
+	driver->clearBuffers(video::ECBF_DEPTH);
+
+	core::rect<s32> oldViewPort = driver->getViewPort();
+	core::matrix4 oldProjMat = driver->getTransform(video::ETS_PROJECTION);
+	core::matrix4 oldViewMat = driver->getTransform(video::ETS_VIEW);
+
+	core::matrix4 ProjMatrix;
+	ProjMatrix.buildProjectionMatrixOrthoLH(2.0f, 2.0f, -1.0f, 100.0f);
+
+	core::matrix4 ViewMatrix;
+	ViewMatrix.buildProjectionMatrixOrthoLH(
+		2.0f * viewrect.getWidth() / rect.getWidth(),
+		2.0f * viewrect.getHeight() / rect.getHeight(),
+		-1.0f,
+		100.0f);
+	ViewMatrix.setTranslation(core::vector3df(
+		1.0f * (rect.LowerRightCorner.X + rect.UpperLeftCorner.X -
+				viewrect.LowerRightCorner.X - viewrect.UpperLeftCorner.X) /
+				viewrect.getWidth(),
+		1.0f * (viewrect.LowerRightCorner.Y + viewrect.UpperLeftCorner.Y -
+				rect.LowerRightCorner.Y - rect.UpperLeftCorner.Y) /
+				viewrect.getHeight(),
+		0.0f));
+
+	driver->setTransform(video::ETS_PROJECTION, ProjMatrix);
+	driver->setTransform(video::ETS_VIEW, ViewMatrix);
+
+	driver->setTransform(video::ETS_WORLD, world);
+	driver->setViewPort(viewrect);
+
+	video::SColor basecolor = item_visuals->getItemstackColor(item, client);
+
+	const u32 mc = mesh->getMeshBufferCount();
+	if (mc > imesh->buffer_info.size())
+		imesh->buffer_info.resize(mc);
+	for (u32 j = 0; j < mc; ++j) {
+		scene::IMeshBuffer *buf = mesh->getMeshBuffer(j);
+		video::SColor c = basecolor;
+
+		auto &p = imesh->buffer_info[j];
+		p.applyOverride(c);
+
+		// TODO: could be moved to a shader
+		if (p.needColorize(c)) {
+			buf->setDirty(scene::EBT_VERTEX);
+			if (imesh->needs_shading)
+				colorizeMeshBuffer(buf, &c);
+			else
+				setMeshBufferColor(buf, c);
+		}
+
+		video::SMaterial &material = buf->getMaterial();
+
+		// Texture animation
+		if (p.animation_info) {
+			p.animation_info->updateTexture(material, client->getAnimationTime());
+		}
+
+		material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+		driver->setMaterial(material);
+		driver->drawMeshBuffer(buf);
+	}
+
+	driver->setTransform(video::ETS_VIEW, oldViewMat);
+	driver->setTransform(video::ETS_PROJECTION, oldProjMat);
+	driver->setViewPort(oldViewPort);
+}
+
+// Returns the atlas texture if the item stack is drawn from the icon atlas
+static video::ITexture *getItemStackIcon(const ItemStack &item,
+		const core::rect<s32> &rect, Client *client,
+		ItemRotationKind rotation_kind, const v3s16 &angle,
+		core::rect<s32> *area)
+{
+	// Rotated meshes can't be drawn from a still image
+	if (g_settings->getBool("inventory_items_animations") &&
+			(rotation_kind < IT_ROT_NONE || angle != v3s16(0, 0, 0)))
+		return nullptr;
+	if (!item.getInventoryImage(client->idef()).empty())
+		return nullptr;
+
+	return client->getItemVisualsManager()->getInventoryIcon(item, client,
+		rect.getSize(), area);
+}
+
+// Draws the overlay, wear bar and count of an item stack
+static void drawItemStackForeground(
 		video::IVideoDriver *driver,
 		gui::IGUIFont *font,
 		const ItemStack &item,
 		const core::rect<s32> &rect,
 		const core::rect<s32> *clip,
 		Client *client,
-		ItemRotationKind rotation_kind,
-		const v3s16 &angle,
-		const v3s16 &rotation_speed)
+		bool draw_overlay)
 {
-	static MeshTimeInfo rotation_time_infos[IT_ROT_NONE];
-
-	if (item.empty()) {
-		if (rotation_kind < IT_ROT_NONE && rotation_kind != IT_ROT_OTHER) {
-			rotation_time_infos[rotation_kind].mesh = NULL;
-		}
-		return;
-	}
-
-	const bool enable_animations = g_settings->getBool("inventory_items_animations");
-
 	auto *idef = client->idef();
 	const ItemDefinition &def = item.getDefinition(idef);
-	ItemVisualsManager* item_visuals = client->getItemVisualsManager();
-
-	bool draw_overlay = false;
-
-	const std::string inventory_image = item.getInventoryImage(idef);
 	const std::string inventory_overlay = item.getInventoryOverlay(idef);
 
-	bool has_mesh = false;
-	ItemMesh *imesh;
-
 	core::rect<s32> viewrect = rect;
 	if (clip != nullptr)
 		viewrect.clipAgainst(*clip);
 
-	// Render as mesh if animated or no inventory image
-	if ((enable_animations && rotation_kind < IT_ROT_NONE) || inventory_image.empty()) {
-		imesh = item_visuals->getWieldMesh(item, client);
-		has_mesh = imesh && imesh->mesh;
-	}
-	if (has_mesh) {
-		scene::IMesh *mesh = imesh->mesh;
-		driver->clearBuffers(video::ECBF_DEPTH);
-		s32 delta = 0;
-		if (rotation_kind < IT_ROT_NONE) {
-			MeshTimeInfo &ti = rotation_time_infos[rotation_kind];
-			if (mesh != ti.mesh && rotation_kind != IT_ROT_OTHER) {
-				ti.mesh = mesh;
-				ti.time = porting::getTimeMs();
-			} else {
-				delta = porting::getDeltaMs(ti.time, porting::getTimeMs()) % 100000;
-			}
-		}
-		core::rect<s32> oldViewPort = driver->getViewPort();
-		core::matrix4 oldProjMat = driver->getTransform(video::ETS_PROJECTION);
-		core::matrix4 oldViewMat = driver->getTransform(video::ETS_VIEW);
-
-		core::matrix4 ProjMatrix;
-		ProjMatrix.buildProjectionMatrixOrthoLH(2.0f, 2.0f, -1.0f, 100.0f);
-
-		core::matrix4 ViewMatrix;
-		ViewMatrix.buildProjectionMatrixOrthoLH(
-			2.0f * viewrect.getWidth() / rect.getWidth(),
-			2.0f * viewrect.getHeight() / rect.getHeight(),
-			-1.0f,
-			100.0f);
-		ViewMatrix.setTranslation(core::vector3df(
-			1.0f * (rect.LowerRightCorner.X + rect.UpperLeftCorner.X -
-					viewrect.LowerRightCorner.X - viewrect.UpperLeftCorner.X) /
-					viewrect.getWidth(),
-			1.0f * (viewrect.LowerRightCorner.Y + viewrect.UpperLeftCorner.Y -
-					rect.LowerRightCorner.Y - rect.UpperLeftCorner.Y) /
-					viewrect.getHeight(),
-			0.0f));
-
-		driver->setTransform(video::ETS_PROJECTION, ProjMatrix);
-		driver->setTransform(video::ETS_VIEW, ViewMatrix);
-
-		core::matrix4 matrix;
-		matrix.makeIdentity();
-
-		if (enable_animations) {
-			float timer_f = (float) delta / 5000.f;
-			matrix.setRotationDegrees(v3f(
-				angle.X + rotation_speed.X * 3.60f * timer_f,
-				angle.Y + rotation_speed.Y * 3.60f * timer_f,
-				angle.Z + rotation_speed.Z * 3.60f * timer_f)
-			);
-		}
-
-		driver->setTransform(video::ETS_WORLD, matrix);
-		driver->setViewPort(viewrect);
-
-		video::SColor basecolor = item_visuals->getItemstackColor(item, client);
-
-		const u32 mc = mesh->getMeshBufferCount();
-		if (mc > imesh->buffer_info.size())
-			imesh->buffer_info.resize(mc);
-		for (u32 j = 0; j < mc; ++j) {
-			scene::IMeshBuffer *buf = mesh->getMeshBuffer(j);
-			video::SColor c = basecolor;
-
-			auto &p = imesh->buffer_info[j];
-			p.applyOverride(c);
-
-			// TODO: could be moved to a shader
-			if (p.needColorize(c)) {
-				buf->setDirty(scene::EBT_VERTEX);
-				if (imesh->needs_shading)
-					colorizeMeshBuffer(buf, &c);
-				else
-					setMeshBufferColor(buf, c);
-			}
-
-			video::SMaterial &material = buf->getMaterial();
-
-			// Texture animation
-			if (p.animation_info) {
-				p.animation_info->updateTexture(material, client->getAnimationTime());
-			}
-
-			material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
-			driver->setMaterial(material);
-			driver->drawMeshBuffer(buf);
-		}
-
-		driver->setTransform(video::ETS_VIEW, oldViewMat);
-		driver->setTransform(video::ETS_PROJECTION, oldProjMat);
-		driver->setViewPort(oldViewPort);
-
-		draw_overlay = def.type == ITEM_NODE && inventory_image.empty();
-	} else { // Otherwise just draw as 2D
-		video::ITexture *texture = item_visuals->getInventoryTexture(item, client);
-		video::SColor color;
-		if (texture) {
-			color = item_visuals->getItemstackColor(item, client);
-		} else {
-			color = video::SColor(255, 255, 255, 255);
-			ITextureSource *tsrc = client->getTextureSource();
-			texture = tsrc->getTexture("no_texture.png");
-			if (!texture)
-				return;
-		}
-
-		const video::SColor colors[] = { color, color, color, color };
-
-		draw2DImageFilterScaled(driver, texture, rect,
-			core::rect<s32>({0, 0}, core::dimension2di(texture->getOriginalSize())),
-			clip, colors, true);
-
-		draw_overlay = true;
-	}
-
 	// draw the inventory_overlay
 	if (!inventory_overlay.empty() && draw_overlay) {
 		ITextureSource *tsrc = client->getTextureSource();
@@ -235,7 +192,7 @@ void drawItemStack(
 		driver->draw2DRectangle(color, progressrect2, clip);
 	}
 
-	const std::string &count_text = item.metadata.getString("count_meta");
+	const std::string &count_text = item.getMetadata().getString("count_meta");
 	if (font != nullptr && (item.count >= 2 || !count_text.empty())) {
 		// Get the item count as a string
 		std::string text = count_text.empty() ? itos(item.count) : count_text;
@@ -248,7 +205,7 @@ void drawItemStack(
 		);
 
 		// get the count alignment
-		s32 count_alignment = stoi(item.metadata.getString("count_alignment"));
+		s32 count_alignment = stoi(item.getMetadata().getString("count_alignment"));
 		if (count_alignment != 0) {
 			s32 a_x = count_alignment & 3;
 			s32 a_y = (count_alignment >> 2) & 3;
@@ -300,6 +257,108 @@ void drawItemStack(
 	}
 }
 
+void drawItemStack(
+		video::IVideoDriver *driver,
+		gui::IGUIFont *font,
+		const ItemStack &item,
+		const core::rect<s32> &rect,
+		const core::rect<s32> *clip,
+		Client *client,
+		ItemRotationKind rotation_kind,
+		const v3s16 &angle,
+		const v3s16 &rotation_speed)
+{
+	if (item.empty()) {
+		if (rotation_kind < IT_ROT_NONE && rotation_kind != IT_ROT_OTHER) {
+			rotation_time_infos[rotation_kind].mesh = NULL;
+		}
+		return;
+	}
+
+	const bool enable_animations = g_settings->getBool("inventory_items_animations");
+
+	auto *idef = client->idef();
+	const ItemDefinition &def = item.getDefinition(idef);
+	ItemVisualsManager* item_visuals = client->getItemVisualsManager();
+
+	bool draw_overlay = false;
+
+	const std::string inventory_image = item.getInventoryImage(idef);
+
+	bool has_mesh = false;
+	ItemMesh *imesh;
+
+	core::rect<s32> viewrect = rect;
+	if (clip != nullptr)
+		viewrect.clipAgainst(*clip);
+
+	// Render as mesh if animated or no inventory image
+	if ((enable_animations && rotation_kind < IT_ROT_NONE) || inventory_image.empty()) {
+		imesh = item_visuals->getWieldMesh(item, client);
+		has_mesh = imesh && imesh->mesh;
+	}
+	core::rect<s32> icon_area;
+	video::ITexture *icon = has_mesh ? getItemStackIcon(item, rect, client,
+		rotation_kind, angle, &icon_area) : nullptr;
+	if (icon) {
+		// Rendered once at this size
+		driver->draw2DImage(icon, rect.UpperLeftCorner, icon_area, clip,
+			video::SColor(255, 255, 255, 255), true);
+
+		draw_overlay = def.type == ITEM_NODE && inventory_image.empty();
+	} else if (has_mesh) {
+		scene::IMesh *mesh = imesh->mesh;
+		s32 delta = 0;
+		if (rotation_kind < IT_ROT_NONE) {
+			MeshTimeInfo &ti = rotation_time_infos[rotation_kind];
+			if (mesh != ti.mesh && rotation_kind != IT_ROT_OTHER) {
+				ti.mesh = mesh;
+				ti.time = porting::getTimeMs();
+			} else {
+				delta = porting::getDeltaMs(ti.time, porting::getTimeMs()) % 100000;
+			}
+		}
+
+		core::matrix4 matrix;
+		matrix.makeIdentity();
+
+		if (enable_animations) {
+			float timer_f = (float) delta / 5000.f;
+			matrix.setRotationDegrees(v3f(
+				angle.X + rotation_speed.X * 3.60f * timer_f,
+				angle.Y + rotation_speed.Y * 3.60f * timer_f,
+				angle.Z + rotation_speed.Z * 3.60f * timer_f)
+			);
+		}
+
+		drawItemMesh(driver, item, imesh, rect, viewrect, matrix, client);
+
+		draw_overlay = def.type == ITEM_NODE && inventory_image.empty();
+	} else { // Otherwise just draw as 2D
+		video::ITexture *texture = item_visuals->getInventoryTexture(item, client);
+		video::SColor color;
+		if (texture) {
+			color = item_visuals->getItemstackColor(item, client);
+		} else {
+			color = video::SColor(255, 255, 255, 255);
+			ITextureSource *tsrc = client->getTextureSource();
+			texture = tsrc->getTexture("no_texture.png");
+			if (!texture)
+				return;
+		}
+
+		const video::SColor colors[] = { color, color, color, color };
+
+		draw2DImageFilterScaled(driver, texture, rect,
+			core::rect<s32>({0, 0}, core::dimension2di(texture->getOriginalSize())),
+			clip, colors, true);
+
+		draw_overlay = true;
+	}
+
+	drawItemStackForeground(driver, font, item, rect, clip, client, draw_overlay);
+}
+
 void drawItemStack(
 		video::IVideoDriver *driver,
 		gui::IGUIFont *font,
@@ -312,3 +371,44 @@ void drawItemStack(
 	drawItemStack(driver, font, item, rect, clip, client, rotation_kind,
 		v3s16(0, 0, 0), v3s16(0, 100, 0));
 }
+
+ItemStackBatch::ItemStackBatch(video::IVideoDriver *driver, gui::IGUIFont *font,
+		const core::rect<s32> *clip, Client *client) :
+	m_driver(driver), m_font(font), m_clip(clip), m_client(client)
+{
+}
+
+void ItemStackBatch::add(const ItemStack &item, const core::rect<s32> &rect,
+		ItemRotationKind rotation_kind)
+{
+	core::rect<s32> area;
+	video::ITexture *icon = item.empty() ? nullptr : getItemStackIcon(item,
+		rect, m_client, rotation_kind, v3s16(0, 0, 0), &area);
+	if (!icon) {
+		drawItemStack(m_driver, m_font, item, rect, m_clip, m_client, rotation_kind);
+		return;
+	}
+
+	Icons &icons = m_icons[icon];
+	icons.positions.push_back(rect.UpperLeftCorner);
+	icons.areas.push_back(area);
+	m_foreground.emplace_back(item, rect);
+}
+
+void ItemStackBatch::flush()
+{
+	for (auto &it : m_icons) {
+		m_driver->draw2DImageBatch(it.first, it.second.positions,
+			it.second.areas, m_clip, video::SColor(255, 255, 255, 255), true);
+	}
+	m_icons.clear();
+
+	// Icons are only used for items without inventory image
+	for (auto &it : m_foreground) {
+		const bool draw_overlay =
+			it.first.getDefinition(m_client->idef()).type == ITEM_NODE;
+		drawItemStackForeground(m_driver, m_font, it.first, it.second, m_clip,
+			m_client, draw_overlay);
+	}
+	m_foreground.clear();
+}
@@ -6,11 +6,15 @@
 
 #include <IGUIFont.h>
 #include <IVideoDriver.h>
+#include <map>
+#include <utility>
+#include <vector>
 #include "irrlichttypes.h"
 #include "irr_v3d.h"
+#include "inventory.h"
 
-struct ItemStack;
 class Client;
+struct ItemMesh;
 
 enum ItemRotationKind
 {
@@ -39,3 +43,43 @@ void drawItemStack(
 		ItemRotationKind rotation_kind,
 		const v3s16 &angle,
 		const v3s16 &rotation_speed);
+
+// Draws the mesh of an item into rect, clipped to viewrect.
+void drawItemMesh(video::IVideoDriver *driver,
+		const ItemStack &item,
+		ItemMesh *imesh,
+		const core::rect<s32> &rect,
+		const core::rect<s32> &viewrect,
+		const core::matrix4 &world,
+		Client *client);
+
+/*
+	Draws item stacks like drawItemStack(). The ones that have an icon in the
+	icon atlas are drawn by flush(), with one draw call per atlas page.
+	The stacks must not overlap each other.
+*/
+class ItemStackBatch
+{
+public:
+	ItemStackBatch(video::IVideoDriver *driver, gui::IGUIFont *font,
+			const core::rect<s32> *clip, Client *client);
+
+	void add(const ItemStack &item, const core::rect<s32> &rect,
+			ItemRotationKind rotation_kind);
+
+	void flush();
+
+private:
+	struct Icons {
+		core::array<core::position2d<s32>> positions;
+		core::array<core::rect<s32>> areas;
+	};
+
+	video::IVideoDriver *m_driver;
+	gui::IGUIFont *m_font;
+	const core::rect<s32> *m_clip;
+	Client *m_client;
+	std::map<video::ITexture *, Icons> m_icons;
+	// Drawn on top of the icons
+	std::vector<std::pair<ItemStack, core::rect<s32>>> m_foreground;
+};
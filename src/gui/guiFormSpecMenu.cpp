@@ -3087,6 +3087,8 @@ void GUIFormSpecMenu::regenerateGui(v2u32 screensize)
 
 	std::vector<std::string> elements = split(m_formspec_string,']');
 	unsigned int i = 0;
+	m_element_guis.assign(elements.size(), nullptr);
+	m_elements_prepend = m_formspec_prepend;
 
 	/* try to read version from first element only */
 	if (!elements.empty()) {
@@ -3265,8 +3267,14 @@ void GUIFormSpecMenu::regenerateGui(v2u32 screensize)
 	}
 
 	for (; i< elements.size(); i++) {
+		gui::IGUIElement *parent = mydata.current_parent;
+		const size_t child_count = parent->getChildren().size();
 		parseElement(&mydata, elements[i]);
+		if (mydata.current_parent == parent &&
+				parent->getChildren().size() == child_count + 1)
+			m_element_guis[i] = parent->getChildren().back();
 	}
+	m_elements = std::move(elements);
 
 	if (mydata.current_parent != this) {
 		errorstream << "Invalid formspec string: scroll_container was never closed!"
@@ -3337,6 +3345,109 @@ void GUIFormSpecMenu::regenerateGui(v2u32 screensize)
 	}
 }
 
+bool GUIFormSpecMenu::updateElements()
+{
+	if (!m_is_form_regenerated || m_elements.empty() ||
+			m_text_dst->m_formname != m_last_formname ||
+			m_elements_prepend != m_formspec_prepend)
+		return false;
+
+	std::vector<std::string> elements = split(m_formspec_string, ']');
+	if (elements.size() != m_elements.size())
+		return false;
+
+	// Check everything first, the form is either updated or regenerated as a whole
+	std::vector<size_t> changed;
+	for (size_t i = 0; i < elements.size(); i++) {
+		if (elements[i] == m_elements[i])
+			continue;
+		if (!m_element_guis[i] ||
+				!updateElement(m_element_guis[i], m_elements[i], elements[i], false))
+			return false;
+		changed.push_back(i);
+	}
+
+	for (size_t i : changed)
+		updateElement(m_element_guis[i], m_elements[i], elements[i], true);
+	m_elements = std::move(elements);
+	return true;
+}
+
+bool GUIFormSpecMenu::updateElement(gui::IGUIElement *e,
+	const std::string &old_element, const std::string &new_element, bool apply)
+{
+	size_t pos = new_element.find('[');
+	if (pos == std::string::npos || old_element.find('[') != pos)
+		return false;
+	std::string type = trim(new_element.substr(0, pos));
+	if (type != trim(old_element.substr(0, pos)))
+		return false;
+
+	std::vector<std::string> old_parts = split(old_element.substr(pos + 1), ';');
+	std::vector<std::string> parts = split(new_element.substr(pos + 1), ';');
+	if (parts.size() != old_parts.size())
+		return false;
+
+	// Everything but the texture or the text must be the same
+	size_t changed_part;
+	if (type == "image" && parts.size() >= 3)
+		changed_part = 2; // without a size, it depends on the texture
+	else if (type == "label")
+		changed_part = parts.size() - 1;
+	else
+		return false;
+	for (size_t i = 0; i < parts.size(); i++) {
+		if (i != changed_part && parts[i] != old_parts[i])
+			return false;
+	}
+
+	if (type == "image") {
+		std::string old_name = unescape_string(old_parts[2]);
+		std::string name = unescape_string(parts[2]);
+		// The texture is also the name of the element
+		for (const std::string *n : {&old_name, &name}) {
+			if (theme_by_name.count(*n) || m_tooltips.count(*n))
+				return false;
+		}
+		if (!apply)
+			return true;
+
+		video::ITexture *texture = m_tsrc->getTexture(name);
+		if (e->getType() == gui::EGUIET_IMAGE)
+			static_cast<gui::IGUIImage *>(e)->setImage(texture);
+		else
+			static_cast<GUIAnimatedImage *>(e)->setTexture(texture);
+		for (FieldSpec &spec : m_fields) {
+			if (spec.fid == e->getID()) {
+				spec.fname = name;
+				break;
+			}
+		}
+		return true;
+	}
+
+	auto *text = static_cast<gui::IGUIStaticText *>(e);
+	EnrichedString str(unescape_string(utf8_to_wide(parts[changed_part])));
+	// Labels without a size are made of one element per line
+	const bool word_wrap = text->isWordWrapEnabled();
+	if (!word_wrap && str.getString().find(L'\n') != std::wstring::npos)
+		return false;
+	if (!apply)
+		return true;
+
+	setStaticText(text, str);
+	if (!word_wrap) {
+		gui::IGUIFont *font = text->getOverrideFont();
+		if (!font)
+			font = m_font;
+		core::rect<s32> rect = e->getRelativePosition();
+		rect.LowerRightCorner.X = rect.UpperLeftCorner.X +
+			font->getDimension(str.c_str()).Width;
+		e->setRelativePosition(rect);
+	}
+	return true;
+}
+
 void GUIFormSpecMenu::legacySortElements(std::list<IGUIElement *>::iterator from)
 {
 	/*
@@ -3474,8 +3585,10 @@ void GUIFormSpecMenu::drawMenu()
 		const std::string &newform = m_form_src->getForm();
 		if (newform != m_formspec_string) {
 			m_formspec_string = newform;
-			m_is_form_regenerated = false;
-			regenerateGui(m_screensize_old);
+			if (!updateElements()) {
+				m_is_form_regenerated = false;
+				regenerateGui(m_screensize_old);
+			}
 		}
 	}
 
@@ -172,8 +172,11 @@ class GUIFormSpecMenu : public GUIModalMenu
 	void setFormSpec(const std::string &formspec_string,
 			const InventoryLocation &current_inventory_location)
 	{
+		bool same_location = m_current_inventory_location == current_inventory_location;
 		m_formspec_string = formspec_string;
 		m_current_inventory_location = current_inventory_location;
+		if (same_location && updateElements())
+			return;
 		m_is_form_regenerated = false;
 		regenerateGui(m_screensize_old);
 	}
@@ -258,6 +261,11 @@ class GUIFormSpecMenu : public GUIModalMenu
 		Remove and re-add (or reposition) stuff
 	*/
 	void regenerateGui(v2u32 screensize);
+	// Applies a new formspec string of the same form without regenerating it,
+	// if only labels and images changed. Returns false if that's not possible.
+	bool updateElements();
+	bool updateElement(gui::IGUIElement *e, const std::string &old_element,
+		const std::string &new_element, bool apply);
 
 	GUIInventoryList::ItemSpec getItemAtPos(v2s32 p) const;
 	void drawSelectedItem();
@@ -325,6 +333,11 @@ class GUIFormSpecMenu : public GUIModalMenu
 
 	std::string m_formspec_string;
 	std::string m_formspec_prepend;
+	// The elements of the last generated form and the GUI element that
+	// each of them created, if it was exactly one. See updateElements().
+	std::vector<std::string> m_elements;
+	std::vector<gui::IGUIElement *> m_element_guis;
+	std::string m_elements_prepend;
 	InventoryLocation m_current_inventory_location;
 
 	// Default true because we can't control regeneration on resizing, but
@@ -77,6 +77,8 @@ void GUIInventoryList::draw()
 
 	const s32 list_size = (s32)ilist->getSize();
 
+	ItemStackBatch batch(driver, m_font, &AbsoluteClippingRect, client);
+
 	for (s32 i = 0; i < m_geom.X * m_geom.Y; i++) {
 		s32 item_i = i + m_start_item_i;
 		if (item_i >= list_size)
@@ -137,8 +139,7 @@ void GUIInventoryList::draw()
 
 		if (!item.empty()) {
 			// Draw item stack
-			drawItemStack(driver, m_font, item, rect, &AbsoluteClippingRect,
-					client, rotation_kind);
+			batch.add(item, rect, rotation_kind);
 		}
 
 		// Add hovering tooltip. The tooltip disappears if any item is selected,
@@ -169,6 +170,8 @@ void GUIInventoryList::draw()
 		}
 	}
 
+	batch.flush();
+
 	IGUIElement::draw();
 }
 
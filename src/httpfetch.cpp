@@ -198,6 +198,9 @@ class HTTPFetchOngoing
 	const HTTPFetchRequest &getRequest()    const { return request; };
 	const CURL             *getEasyHandle() const { return curl; };
 
+	// Whether the transfer was multiplexed over HTTP/2 or later
+	bool wasMultiplexed() const;
+
 private:
 	CurlHandlePool *pool;
 	CURL *curl = nullptr;
@@ -224,6 +227,16 @@ HTTPFetchOngoing::HTTPFetchOngoing(const HTTPFetchRequest &request_,
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
 	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3);
 	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // = all supported ones
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1);
+#if LIBCURL_VERSION_NUM >= 0x072F00
+	// Use HTTP/2 over TLS if the server supports it (default since curl 7.62.0)
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	// Prefer waiting for a connection that can be multiplexed over
+	// opening a new one to the same host
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1);
+#endif
 
 	std::string bind_address = g_settings->get("bind_address");
 	if (!bind_address.empty()) {
@@ -399,6 +412,17 @@ const HTTPFetchResult * HTTPFetchOngoing::complete(CURLcode res)
 	return &result;
 }
 
+bool HTTPFetchOngoing::wasMultiplexed() const
+{
+#if LIBCURL_VERSION_NUM >= 0x073200
+	long version = 0;
+	if (curl && curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION,
+			&version) == CURLE_OK)
+		return version >= CURL_HTTP_VERSION_2_0;
+#endif
+	return false;
+}
+
 HTTPFetchOngoing::~HTTPFetchOngoing()
 {
 	if (multi) {
@@ -454,9 +478,17 @@ class CurlFetchThread : public Thread
 		Event *event = nullptr;
 	};
 
+	// Upper bound for the adaptive limit, relative to m_parallel_limit.
+	// The additional fetches only share existing HTTP/2 connections.
+	static constexpr size_t MULTIPLEX_FACTOR = 8;
+
 	CURLM *m_multi;
 	MutexedQueue<Request> m_requests;
+	// Configured number of connections per host
 	size_t m_parallel_limit;
+	// Number of fetches that may be ongoing at once. Grows while servers
+	// multiplex the transfers and falls back when they don't.
+	size_t m_active_limit;
 
 	// Variables exclusively used within thread
 	std::vector<std::unique_ptr<HTTPFetchOngoing>> m_all_ongoing;
@@ -470,6 +502,7 @@ class CurlFetchThread : public Thread
 			m_parallel_limit = parallel_limit;
 		else
 			m_parallel_limit = 1;
+		m_active_limit = m_parallel_limit;
 	}
 
 	void requestFetch(const HTTPFetchRequest &fetch_request)
@@ -503,7 +536,7 @@ class CurlFetchThread : public Thread
 	{
 		if (req.type == RT_FETCH) {
 			// New fetch, queue until there are less
-			// than m_parallel_limit ongoing fetches
+			// than m_active_limit ongoing fetches
 			m_queued_fetches.push_back(std::move(req.fetch_request));
 
 			// see processQueued() for what happens next
@@ -536,10 +569,10 @@ class CurlFetchThread : public Thread
 			req.event->signal();
 	}
 
-	// Start new ongoing fetches if m_parallel_limit allows
+	// Start new ongoing fetches if m_active_limit allows
 	void processQueued(CurlHandlePool *pool)
 	{
-		while (m_all_ongoing.size() < m_parallel_limit &&
+		while (m_all_ongoing.size() < m_active_limit &&
 				!m_queued_fetches.empty()) {
 			HTTPFetchRequest request = std::move(m_queued_fetches.front());
 			m_queued_fetches.pop_front();
@@ -568,12 +601,29 @@ class CurlFetchThread : public Thread
 			auto &ongoing = **it;
 			if (ongoing.getEasyHandle() != msg->easy_handle)
 				continue;
+			updateActiveLimit(ongoing, msg->data.result);
 			httpfetch_deliver_result(*ongoing.complete(msg->data.result));
 			m_all_ongoing.erase(it);
 			return;
 		}
 	}
 
+	// Adapt the number of ongoing fetches to how the last one went
+	void updateActiveLimit(const HTTPFetchOngoing &ongoing, CURLcode res)
+	{
+		const size_t max_limit = m_parallel_limit * MULTIPLEX_FACTOR;
+		if (res == CURLE_OPERATION_TIMEDOUT) {
+			// Fetches waiting for a connection count towards their timeout
+			m_active_limit = std::max(m_parallel_limit, m_active_limit / 2);
+		} else if (res != CURLE_OK) {
+			return;
+		} else if (ongoing.wasMultiplexed()) {
+			m_active_limit = std::min(max_limit, m_active_limit + 1);
+		} else if (m_active_limit > m_parallel_limit) {
+			m_active_limit--;
+		}
+	}
+
 	// Wait for a request from another thread, or timeout elapses
 	void waitForRequest(long timeout)
 	{
@@ -632,6 +682,16 @@ class CurlFetchThread : public Thread
 		m_multi = curl_multi_init();
 		FATAL_ERROR_IF(!m_multi, "curl_multi_init returned NULL");
 
+		// Connections are kept alive in the connection cache of the multi
+		// handle and reused by later fetches to the same host.
+#if LIBCURL_VERSION_NUM >= 0x071E00
+		curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+				(long)m_parallel_limit);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072B00
+		curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
 		FATAL_ERROR_IF(!m_all_ongoing.empty(), "Expected empty");
 
 		while (!stopRequested()) {
@@ -46,6 +46,7 @@ void ItemStack::serialize(std::ostream &os, bool serialize_meta) const
 		return;
 
 	// Check how many parts of the itemstring are needed
+	const ItemStackMetadata &metadata = getMetadata();
 	int parts = 1;
 	if (!metadata.empty())
 		parts = 4;
@@ -205,7 +206,10 @@ void ItemStack::deSerialize(std::istream &is, IItemDefManager *itemdef)
 			wear = stoi(wear_str);
 
 			// Read metadata
+			ItemStackMetadata metadata;
 			metadata.deSerialize(is);
+			if (!metadata.empty())
+				m_metadata = std::make_shared<ItemStackMetadata>(std::move(metadata));
 
 			// In case fields are added after metadata, skip space here:
 			//std::getline(is, tmp, ' ');
@@ -227,6 +231,17 @@ void ItemStack::deSerialize(const std::string &str, IItemDefManager *itemdef)
 	deSerialize(is, itemdef);
 }
 
+const ItemStackMetadata ItemStack::s_empty_metadata;
+
+ItemStackMetadata &ItemStack::getWritableMetadata()
+{
+	if (!m_metadata)
+		m_metadata = std::make_shared<ItemStackMetadata>();
+	else if (m_metadata.use_count() > 1)
+		m_metadata = std::make_shared<ItemStackMetadata>(*m_metadata);
+	return *m_metadata;
+}
+
 std::string ItemStack::getItemString(bool include_meta) const
 {
 	std::ostringstream os(std::ios::binary);
@@ -236,7 +251,7 @@ std::string ItemStack::getItemString(bool include_meta) const
 
 std::string ItemStack::getDescription(const IItemDefManager *itemdef) const
 {
-	std::string desc = metadata.getString("description");
+	std::string desc = getMetadata().getString("description");
 	if (desc.empty())
 		desc = getDefinition(itemdef).description;
 	return desc.empty() ? name : desc;
@@ -244,7 +259,7 @@ std::string ItemStack::getDescription(const IItemDefManager *itemdef) const
 
 std::string ItemStack::getShortDescription(const IItemDefManager *itemdef) const
 {
-	std::string desc = metadata.getString("short_description");
+	std::string desc = getMetadata().getString("short_description");
 	if (desc.empty())
 		desc = getDefinition(itemdef).short_description;
 	if (!desc.empty())
@@ -258,7 +273,7 @@ std::string ItemStack::getShortDescription(const IItemDefManager *itemdef) const
 
 std::string ItemStack::getInventoryImage(const IItemDefManager *itemdef) const
 {
-	std::string texture = metadata.getString("inventory_image");
+	std::string texture = getMetadata().getString("inventory_image");
 	if (texture.empty())
 		texture = getDefinition(itemdef).inventory_image;
 
@@ -267,7 +282,7 @@ std::string ItemStack::getInventoryImage(const IItemDefManager *itemdef) const
 
 std::string ItemStack::getInventoryOverlay(const IItemDefManager *itemdef) const
 {
-	std::string texture = metadata.getString("inventory_overlay");
+	std::string texture = getMetadata().getString("inventory_overlay");
 	if (texture.empty())
 		texture = getDefinition(itemdef).inventory_overlay;
 
@@ -276,7 +291,7 @@ std::string ItemStack::getInventoryOverlay(const IItemDefManager *itemdef) const
 
 std::string ItemStack::getWieldImage(const IItemDefManager *itemdef) const
 {
-	std::string texture = metadata.getString("wield_image");
+	std::string texture = getMetadata().getString("wield_image");
 	if (texture.empty())
 		texture = getDefinition(itemdef).wield_image;
 
@@ -285,7 +300,7 @@ std::string ItemStack::getWieldImage(const IItemDefManager *itemdef) const
 
 std::string ItemStack::getWieldOverlay(const IItemDefManager *itemdef) const
 {
-	std::string texture = metadata.getString("wield_overlay");
+	std::string texture = getMetadata().getString("wield_overlay");
 	if (texture.empty())
 		texture = getDefinition(itemdef).wield_overlay;
 
@@ -294,7 +309,7 @@ std::string ItemStack::getWieldOverlay(const IItemDefManager *itemdef) const
 
 v3f ItemStack::getWieldScale(const IItemDefManager *itemdef) const
 {
-	std::string scale = metadata.getString("wield_scale");
+	std::string scale = getMetadata().getString("wield_scale");
 
 	return str_to_v3f(scale).value_or(getDefinition(itemdef).wield_scale);
 }
@@ -314,7 +329,7 @@ ItemStack ItemStack::addItem(ItemStack newitem, IItemDefManager *itemdef)
 	}
 	// If item name or metadata differs, bail out
 	else if (name != newitem.name
-		|| metadata != newitem.metadata)
+		|| !metadataEquals(newitem))
 	{
 		// cannot be added
 	}
@@ -353,7 +368,7 @@ bool ItemStack::itemFits(ItemStack newitem,
 	}
 	// If item name or metadata differs, bail out
 	else if (name != newitem.name
-		|| metadata != newitem.metadata)
+		|| !metadataEquals(newitem))
 	{
 		// cannot be added
 	}
@@ -379,7 +394,7 @@ bool ItemStack::stacksWith(const ItemStack &other) const
 {
 	return (this->name == other.name &&
 			this->wear == other.wear &&
-			this->metadata == other.metadata);
+			metadataEquals(other));
 }
 
 ItemStack ItemStack::takeItem(u32 takecount)
@@ -467,16 +482,16 @@ void InventoryList::serialize(std::ostream &os, bool incremental) const
 
 	os<<"Width "<<m_width<<"\n";
 
-	for (const auto &item : m_items) {
-		if (item.empty()) {
+	for (u32 i = 0; i < m_items.size(); i++) {
+		const ItemStack &item = m_items[i];
+		if (incremental && !checkSlotModified(i)) {
+			os<<"Keep";
+		} else if (item.empty()) {
 			os<<"Empty";
 		} else {
 			os<<"Item ";
 			item.serialize(os);
 		}
-		// TODO: Implement this:
-		// if (!incremental || item.checkModified())
-		// os << "Keep";
 		os<<"\n";
 	}
 
@@ -548,7 +563,7 @@ InventoryList & InventoryList::operator = (const InventoryList &other)
 	m_width = other.m_width;
 	m_name = other.m_name;
 	m_itemdef = other.m_itemdef;
-	//setDirty(true);
+	setModified();
 
 	return *this;
 }
@@ -578,6 +593,33 @@ u32 InventoryList::getUsedSlots() const
 	return num;
 }
 
+size_t InventoryList::getMemoryUsage() const
+{
+	size_t bytes = sizeof(InventoryList) + string_heap_usage(m_name) +
+		m_items.capacity() * sizeof(ItemStack);
+	for (const ItemStack &item : m_items)
+		bytes += string_heap_usage(item.name) + item.getMetadata().getMemoryUsage();
+	return bytes;
+}
+
+void InventoryList::setModified(bool dirty)
+{
+	m_dirty = dirty;
+	m_dirty_all = dirty;
+	if (!dirty)
+		m_dirty_slots.assign(m_items.size(), false);
+}
+
+void InventoryList::setSlotModified(u32 i)
+{
+	m_dirty = true;
+	if (m_dirty_all)
+		return;
+	if (i >= m_dirty_slots.size())
+		m_dirty_slots.resize(m_items.size(), false);
+	m_dirty_slots[i] = true;
+}
+
 ItemStack InventoryList::changeItem(u32 i, const ItemStack &newitem)
 {
 	if(i >= m_items.size())
@@ -586,7 +628,7 @@ ItemStack InventoryList::changeItem(u32 i, const ItemStack &newitem)
 	ItemStack olditem = m_items[i];
 	if (olditem != newitem) {
 		m_items[i] = newitem;
-		setModified();
+		setSlotModified(i);
 	}
 	return olditem;
 }
@@ -595,7 +637,7 @@ void InventoryList::deleteItem(u32 i)
 {
 	assert(i < m_items.size()); // Pre-condition
 	m_items[i].clear();
-	setModified();
+	setSlotModified(i);
 }
 
 ItemStack InventoryList::addItem(const ItemStack &newitem_)
@@ -644,7 +686,7 @@ ItemStack InventoryList::addItem(u32 i, const ItemStack &newitem)
 
 	ItemStack leftover = m_items[i].addItem(newitem, m_itemdef);
 	if (leftover != newitem)
-		setModified();
+		setSlotModified(i);
 	return leftover;
 }
 
@@ -683,7 +725,7 @@ bool InventoryList::containsItem(const ItemStack &item, bool match_meta) const
 	for (auto i = m_items.rbegin(); i != m_items.rend(); ++i) {
 		if (count == 0)
 			break;
-		if (i->name == item.name && (!match_meta || (i->metadata == item.metadata))) {
+		if (i->name == item.name && (!match_meta || i->metadataEquals(item))) {
 			if (i->count >= count)
 				return true;
 
@@ -696,11 +738,14 @@ bool InventoryList::containsItem(const ItemStack &item, bool match_meta) const
 ItemStack InventoryList::removeItem(const ItemStack &item, bool match_meta)
 {
 	ItemStack removed;
-	for (auto i = m_items.rbegin(); i != m_items.rend(); ++i) {
-		if (i->name == item.name && (!match_meta || i->metadata == item.metadata)) {
+	for (u32 i = m_items.size(); i-- > 0;) {
+		ItemStack &stack = m_items[i];
+		if (stack.name == item.name && (!match_meta || stack.metadataEquals(item))) {
 			u32 still_to_remove = item.count - removed.count;
-			ItemStack leftover = removed.addItem(i->takeItem(still_to_remove),
-					m_itemdef);
+			ItemStack taken = stack.takeItem(still_to_remove);
+			if (!taken.empty())
+				setSlotModified(i);
+			ItemStack leftover = removed.addItem(taken, m_itemdef);
 			// Allow oversized stacks
 			removed.count += leftover.count;
 
@@ -708,8 +753,6 @@ ItemStack InventoryList::removeItem(const ItemStack &item, bool match_meta)
 				break;
 		}
 	}
-	if (!removed.empty())
-		setModified();
 	return removed;
 }
 
@@ -720,7 +763,7 @@ ItemStack InventoryList::takeItem(u32 i, u32 takecount)
 
 	ItemStack taken = m_items[i].takeItem(takecount);
 	if (!taken.empty())
-		setModified();
+		setSlotModified(i);
 	return taken;
 }
 
@@ -999,6 +1042,14 @@ bool Inventory::deleteList(const std::string &name)
 	return true;
 }
 
+size_t Inventory::getMemoryUsage() const
+{
+	size_t bytes = sizeof(Inventory) + m_lists.capacity() * sizeof(InventoryList *);
+	for (const InventoryList *list : m_lists)
+		bytes += list->getMemoryUsage();
+	return bytes;
+}
+
 const InventoryList *Inventory::getList(const std::string &name) const
 {
 	s32 i = getListIndex(name);
@@ -8,6 +8,7 @@
 #include "irrlichttypes.h"
 #include "itemstackmetadata.h"
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -56,7 +57,7 @@ struct ItemStack
 		name = "";
 		count = 0;
 		wear = 0;
-		metadata.clear();
+		m_metadata.reset();
 	}
 
 	void add(u16 n)
@@ -109,14 +110,14 @@ struct ItemStack
 		const ToolCapabilities *item_cap = itemdef->get(name).tool_capabilities;
 
 		if (item_cap) {
-			return metadata.getToolCapabilities(*item_cap); // Check for override
+			return getMetadata().getToolCapabilities(*item_cap); // Check for override
 		}
 
 		// Fall back to the hand's tool capabilities
 		if (hand) {
 			item_cap = itemdef->get(hand->name).tool_capabilities;
 			if (item_cap) {
-				return hand->metadata.getToolCapabilities(*item_cap);
+				return hand->getMetadata().getToolCapabilities(*item_cap);
 			}
 		}
 
@@ -128,7 +129,7 @@ struct ItemStack
 	const std::optional<WearBarParams> &getWearBarParams(
 			const IItemDefManager *itemdef) const
 	{
-		auto &meta_override = metadata.getWearBarParamOverride();
+		auto &meta_override = getMetadata().getWearBarParamOverride();
 		if (meta_override.has_value())
 			return meta_override;
 		return itemdef->get(name).wear_bar_params;
@@ -182,7 +183,7 @@ struct ItemStack
 		return (this->name     == s.name &&
 				this->count    == s.count &&
 				this->wear     == s.wear &&
-				this->metadata == s.metadata);
+				metadataEquals(s));
 	}
 
 	bool operator !=(const ItemStack &s) const
@@ -190,13 +191,37 @@ struct ItemStack
 		return !(*this == s);
 	}
 
+	bool metadataEquals(const ItemStack &s) const
+	{
+		return m_metadata == s.m_metadata || getMetadata() == s.getMetadata();
+	}
+
+	/*
+		Metadata
+
+		Copies of a stack share their metadata until one of them changes it,
+		and stacks without metadata don't allocate any. So copying the
+		common stack without metadata only copies the name.
+	*/
+	const ItemStackMetadata &getMetadata() const
+	{
+		return m_metadata ? *m_metadata : s_empty_metadata;
+	}
+	// Makes the metadata unique to this stack, don't keep the reference
+	// across copies of the stack
+	ItemStackMetadata &getWritableMetadata();
+
 	/*
 		Properties
 	*/
 	std::string name = "";
 	u16 count = 0;
 	u16 wear = 0;
-	ItemStackMetadata metadata;
+
+private:
+	std::shared_ptr<ItemStackMetadata> m_metadata;
+
+	static const ItemStackMetadata s_empty_metadata;
 };
 
 class InventoryList
@@ -224,6 +249,8 @@ class InventoryList
 	u32 getWidth() const { return m_width; }
 	// Count used slots
 	u32 getUsedSlots() const;
+	// Approximate memory used by the list
+	size_t getMemoryUsage() const;
 
 	// Get reference to item
 	const ItemStack &getItem(u32 i) const
@@ -231,11 +258,6 @@ class InventoryList
 		assert(i < m_size); // Pre-condition
 		return m_items[i];
 	}
-	ItemStack &getItem(u32 i)
-	{
-		assert(i < m_size); // Pre-condition
-		return m_items[i];
-	}
 	// Get reference to all items
 	const std::vector<ItemStack> &getItems() const { return m_items; }
 	// Returns old item. Parameter can be an empty item.
@@ -289,7 +311,13 @@ class InventoryList
 	void moveItemSomewhere(u32 i, InventoryList *dest, u32 count);
 
 	inline bool checkModified() const { return m_dirty; }
-	inline void setModified(bool dirty = true) { m_dirty = dirty; }
+	// Marks every slot as modified, or all of them as sent
+	void setModified(bool dirty = true);
+	// Whether slot i changed since the last setModified(false)
+	bool checkSlotModified(u32 i) const
+	{
+		return m_dirty_all || (i < m_dirty_slots.size() && m_dirty_slots[i]);
+	}
 
 	// Problem: C++ keeps references to InventoryList and ItemStack indices
 	// until a better solution is found, this serves as a guard to prevent side-effects
@@ -310,12 +338,17 @@ class InventoryList
 	}
 
 private:
+	void setSlotModified(u32 i);
+
 	std::vector<ItemStack> m_items;
 	std::string m_name;
 	u32 m_size; // always the same as m_items.size()
 	u32 m_width = 0;
 	IItemDefManager *m_itemdef;
 	bool m_dirty = true;
+	// Slot granular part of m_dirty, used by incremental serialization
+	bool m_dirty_all = true;
+	std::vector<bool> m_dirty_slots;
 	int m_resize_locks = 0; // Lua callback sanity
 };
 
@@ -345,6 +378,8 @@ class Inventory
 	const InventoryList * getList(const std::string &name) const;
 	const std::vector<InventoryList *> &getLists() const { return m_lists; }
 	bool deleteList(const std::string &name);
+	// Approximate memory used by the inventory
+	size_t getMemoryUsage() const;
 	// A shorthand for adding items. Returns leftover item (possibly empty).
 	ItemStack addItem(const std::string &listname, const ItemStack &newitem)
 	{
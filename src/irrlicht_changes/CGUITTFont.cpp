@@ -217,11 +217,16 @@ void SGUITTGlyph::preload(u32 char_index, FT_Face face, CGUITTFont *parent, u32
 	}
 
 	FT_GlyphSlot glyph = face->glyph;
-	const FT_Bitmap &bits = glyph->bitmap;
+	preloadBitmap(glyph->bitmap, core::vector2di(glyph->advance.x, glyph->advance.y),
+		core::vector2di(glyph->bitmap_left, glyph->bitmap_top), parent, font_size);
+}
 
+void SGUITTGlyph::preloadBitmap(const FT_Bitmap &bits, core::vector2di glyph_advance,
+	core::vector2di glyph_offset, CGUITTFont *parent, u32 font_size)
+{
 	// Setup the glyph information here:
-	advance = core::vector2di(glyph->advance.x, glyph->advance.y);
-	offset = core::vector2di(glyph->bitmap_left, glyph->bitmap_top);
+	advance = glyph_advance;
+	offset = glyph_offset;
 
 	// Try to get the last page with available slots.
 	CGUITTGlyphPage* page = parent->getLastGlyphPage();
@@ -264,6 +269,62 @@ void SGUITTGlyph::unload()
 
 //////////////////////
 
+CGUITTGlyphPreloader::CGUITTGlyphPreloader(SGUITTFace *face, u32 size,
+		FT_Int32 load_flags, std::vector<char32_t> &&chars) :
+	Thread("FontPreload"), face(face), size(size), load_flags(load_flags),
+	chars(std::move(chars))
+{
+	// keeps the font data alive
+	face->grab();
+}
+
+CGUITTGlyphPreloader::~CGUITTGlyphPreloader()
+{
+	stop();
+	wait();
+	face->drop();
+}
+
+void *CGUITTGlyphPreloader::run()
+{
+	// FreeType objects may not be shared between threads
+	FT_Library ft;
+	if (FT_Init_FreeType(&ft))
+		return nullptr;
+	FT_Face ft_face;
+	if (FT_New_Memory_Face(ft,
+			reinterpret_cast<const FT_Byte*>(face->face_buffer.data()),
+			face->face_buffer.size(), 0, &ft_face)) {
+		FT_Done_FreeType(ft);
+		return nullptr;
+	}
+	FT_Set_Pixel_Sizes(ft_face, 0, size);
+
+	for (char32_t c : chars) {
+		if (stopRequested())
+			break;
+		u32 char_index = FT_Get_Char_Index(ft_face, c);
+		if (char_index == 0 || FT_Load_Glyph(ft_face, char_index, load_flags) != FT_Err_Ok)
+			continue;
+
+		FT_GlyphSlot glyph = ft_face->glyph;
+		Result &result = results.emplace_back();
+		result.char_index = char_index;
+		result.advance = core::vector2di(glyph->advance.x, glyph->advance.y);
+		result.offset = core::vector2di(glyph->bitmap_left, glyph->bitmap_top);
+		result.bits = glyph->bitmap;
+		const u8 *buffer = glyph->bitmap.buffer;
+		result.data.assign(buffer, buffer + std::abs(glyph->bitmap.pitch) * glyph->bitmap.rows);
+		result.bits.buffer = result.data.data();
+	}
+
+	FT_Done_Face(ft_face);
+	FT_Done_FreeType(ft);
+	return nullptr;
+}
+
+//////////////////////
+
 CGUITTFont* CGUITTFont::createTTFont(IGUIEnvironment *env,
 		SGUITTFace *face, u32 size, bool antialias,
 		bool transparency, u32 shadow, u32 shadow_alpha)
@@ -287,7 +348,7 @@ CGUITTFont* CGUITTFont::createTTFont(IGUIEnvironment *env,
 //! Constructor.
 CGUITTFont::CGUITTFont(IGUIEnvironment *env)
 : use_monochrome(false), use_transparency(true), use_hinting(true), use_auto_hinting(true),
-batch_load_size(1), Driver(0), GlobalKerningWidth(0), GlobalKerningHeight(0),
+batch_load_size(1), Driver(0), tt_face_owner(0), GlobalKerningWidth(0), GlobalKerningHeight(0),
 shadow_offset(0), shadow_alpha(0), fallback(0)
 {
 
@@ -316,6 +377,7 @@ bool CGUITTFont::load(SGUITTFace *face, const u32 size, const bool antialias, co
 
 	// Store our face.
 	face->grab();
+	tt_face_owner = face;
 	tt_face = face->face;
 
 	// Store font metrics.
@@ -351,6 +413,9 @@ CGUITTFont::~CGUITTFont()
 
 void CGUITTFont::reset_images()
 {
+	// Preloaded glyphs were rendered with the old flags.
+	stop_preloader();
+
 	// Delete the glyphs.
 	for (u32 i = 0; i != Glyphs.size(); ++i)
 		Glyphs[i].unload();
@@ -373,6 +438,44 @@ void CGUITTFont::update_glyph_pages() const
 	}
 }
 
+void CGUITTFont::preloadGlyphs(std::vector<char32_t> &&chars)
+{
+	stop_preloader();
+	preloader = std::make_unique<CGUITTGlyphPreloader>(tt_face_owner, size,
+		load_flags, std::move(chars));
+	if (!preloader->start())
+		preloader.reset();
+}
+
+void CGUITTFont::take_preloaded_glyphs() const
+{
+	// Never wait for it, glyphs that are needed earlier are loaded as usual.
+	if (!preloader || preloader->isRunning())
+		return;
+	preloader->wait();
+
+	auto *this2 = const_cast<CGUITTFont*>(this);
+	for (const auto &result : preloader->results) {
+		if (result.char_index == 0 || result.char_index > Glyphs.size())
+			continue;
+		SGUITTGlyph &glyph = Glyphs[result.char_index - 1];
+		if (glyph.isLoaded())
+			continue;
+		glyph.preloadBitmap(result.bits, result.advance, result.offset, this2, size);
+		if (glyph.glyph_page < Glyph_Pages.size())
+			Glyph_Pages[glyph.glyph_page]->pushGlyphToBePaged(&glyph);
+	}
+	verbosestream << "CGUITTFont: took " << preloader->results.size()
+		<< " preloaded glyphs" << std::endl;
+	preloader.reset();
+}
+
+void CGUITTFont::stop_preloader() const
+{
+	// the destructor stops the thread
+	preloader.reset();
+}
+
 CGUITTGlyphPage* CGUITTFont::getLastGlyphPage() const
 {
 	CGUITTGlyphPage* page = 0;
@@ -749,6 +852,11 @@ u32 CGUITTFont::getGlyphIndexByChar(char32_t c) const
 	if (glyph != 0 && Glyphs[glyph - 1].isLoaded())
 		return glyph;
 
+	// It may have been rendered in the background.
+	take_preloaded_glyphs();
+	if (Glyphs[glyph - 1].isLoaded())
+		return glyph;
+
 	// Determine our batch loading positions.
 	u32 half_size = (batch_load_size / 2);
 	u32 start_pos = 0;
@@ -831,10 +939,6 @@ core::vector2di CGUITTFont::getKerning(const char32_t thisLetter, const char32_t
 	if (tt_face == 0 || thisLetter == 0 || previousLetter == 0)
 		return core::vector2di();
 
-	// Set the size of the face.
-	// This is because we cache faces and the face may have been set to a different size.
-	FT_Set_Pixel_Sizes(tt_face, 0, size);
-
 	core::vector2di ret(GlobalKerningWidth, GlobalKerningHeight);
 
 	u32 n = getGlyphIndexByChar(thisLetter);
@@ -851,6 +955,11 @@ core::vector2di CGUITTFont::getKerning(const char32_t thisLetter, const char32_t
 	if (!FT_HAS_KERNING(tt_face))
 		return ret;
 
+	// Set the size of the face.
+	// This is because we cache faces and the face may have been set to a different size.
+	// Only done here because it's expensive, and this runs for every character drawn.
+	FT_Set_Pixel_Sizes(tt_face, 0, size);
+
 	// Get the kerning information.
 	FT_Vector v;
 	FT_Get_Kerning(tt_face, getGlyphIndexByChar(previousLetter), n, FT_KERNING_DEFAULT, &v);
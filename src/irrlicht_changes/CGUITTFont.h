@@ -42,9 +42,12 @@
 #include "IrrlichtDevice.h"
 #include "util/enriched_string.h"
 #include "util/basic_macros.h"
+#include "threading/thread.h"
 
 #include <map>
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace gui
 {
@@ -119,6 +122,10 @@ namespace gui
 		//! before the batch draw call.
 		void preload(u32 char_index, FT_Face face, CGUITTFont *parent, u32 font_size, const FT_Int32 loadFlags);
 
+		//! Like preload, for a glyph that has already been rendered.
+		void preloadBitmap(const FT_Bitmap &bits, core::vector2di glyph_advance,
+			core::vector2di glyph_offset, CGUITTFont *parent, u32 font_size);
+
 		//! Unloads the glyph.
 		void unload();
 
@@ -241,6 +248,37 @@ namespace gui
 			io::path name;
 	};
 
+	//! Renders glyphs in the background, with its own FreeType instance.
+	//! The results may only be accessed once the thread is no longer running.
+	class CGUITTGlyphPreloader : public Thread
+	{
+		public:
+			struct Result
+			{
+				u32 char_index;
+				core::vector2di advance;
+				core::vector2di offset;
+				//! Points into the data
+				FT_Bitmap bits;
+				std::vector<u8> data;
+			};
+
+			CGUITTGlyphPreloader(SGUITTFace *face, u32 size, FT_Int32 load_flags,
+				std::vector<char32_t> &&chars);
+			~CGUITTGlyphPreloader();
+
+			std::vector<Result> results;
+
+		protected:
+			void *run() override;
+
+		private:
+			SGUITTFace *face;
+			u32 size;
+			FT_Int32 load_flags;
+			std::vector<char32_t> chars;
+	};
+
 	//! Class representing a TrueType font.
 	class CGUITTFont : public IGUIFont
 	{
@@ -321,6 +359,10 @@ namespace gui
 			//! Returns the distance between letters
 			virtual core::vector2di getKerning(const wchar_t thisLetter, const wchar_t previousLetter) const override;
 
+			//! Renders the glyphs for these characters in the background, so that
+			//! drawing them later doesn't have to.
+			void preloadGlyphs(std::vector<char32_t> &&chars);
+
 			//! Define which characters should not be drawn by the font.
 			virtual void setInvisibleCharacters(const wchar_t *s) override;
 
@@ -374,6 +416,8 @@ namespace gui
 			bool load(SGUITTFace *face, const u32 size, const bool antialias, const bool transparency);
 			void reset_images();
 			void update_glyph_pages() const;
+			void take_preloaded_glyphs() const;
+			void stop_preloader() const;
 			void update_load_flags()
 			{
 				// Set up our loading flags.
@@ -390,12 +434,14 @@ namespace gui
 
 			video::IVideoDriver* Driver;
 			std::optional<io::path> filename;
+			SGUITTFace *tt_face_owner;
 			FT_Face tt_face;
 			FT_Size_Metrics font_metrics;
 			FT_Int32 load_flags;
 
 			mutable core::array<CGUITTGlyphPage*> Glyph_Pages;
 			mutable core::array<SGUITTGlyph> Glyphs;
+			mutable std::unique_ptr<CGUITTGlyphPreloader> preloader;
 
 			s32 GlobalKerningWidth;
 			s32 GlobalKerningHeight;
@@ -405,6 +405,7 @@ class CItemDefManager: public IWritableItemDefManager
 
 	void applyTextureOverrides(const std::vector<TextureOverride> &overrides)
 	{
+		m_modification_counter++;
 		infostream << "ItemDefManager::applyTextureOverrides(): Applying "
 			"overrides to textures" << std::endl;
 
@@ -424,6 +425,7 @@ class CItemDefManager: public IWritableItemDefManager
 	}
 	void clear()
 	{
+		m_modification_counter++;
 		for (auto &i : m_item_definitions)
 		{
 			delete i.second;
@@ -461,6 +463,7 @@ class CItemDefManager: public IWritableItemDefManager
 	}
 	virtual void registerItem(const ItemDefinition &def)
 	{
+		m_modification_counter++;
 		TRACESTREAM(<< "ItemDefManager: registering " << def.name << std::endl);
 		// Ensure that the "" item (the hand) always has ToolCapabilities
 		if (def.name.empty())
@@ -479,6 +482,7 @@ class CItemDefManager: public IWritableItemDefManager
 	}
 	virtual void unregisterItem(const std::string &name)
 	{
+		m_modification_counter++;
 		verbosestream<<"ItemDefManager: unregistering \""<<name<<"\""<<std::endl;
 
 		delete m_item_definitions[name];
@@ -487,6 +491,7 @@ class CItemDefManager: public IWritableItemDefManager
 	virtual void registerAlias(const std::string &name,
 			const std::string &convert_to)
 	{
+		m_modification_counter++;
 		if (m_item_definitions.find(name) == m_item_definitions.end()) {
 			TRACESTREAM(<< "ItemDefManager: setting alias " << name
 				<< " -> " << convert_to << std::endl);
@@ -514,6 +519,10 @@ class CItemDefManager: public IWritableItemDefManager
 			os << serializeString16(it.second);
 		}
 	}
+	u32 getModificationCounter() const
+	{
+		return m_modification_counter;
+	}
 	void deSerialize(std::istream &is, u16 protocol_version)
 	{
 		// Clear everything
@@ -546,6 +555,7 @@ class CItemDefManager: public IWritableItemDefManager
 	std::map<std::string, ItemDefinition*> m_item_definitions;
 	// Aliases
 	StringMap m_aliases;
+	u32 m_modification_counter = 0;
 };
 
 IWritableItemDefManager* createItemDefManager()
@@ -135,6 +135,9 @@ class IItemDefManager
 	virtual bool isKnown(const std::string &name) const=0;
 
 	virtual void serialize(std::ostream &os, u16 protocol_version)=0;
+
+	// Changes whenever definitions or aliases change
+	virtual u32 getModificationCounter() const=0;
 };
 
 class IWritableItemDefManager : public IItemDefManager
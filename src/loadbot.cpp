@@ -0,0 +1,572 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "loadbot.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "config.h"
+#include "constants.h"
+#include "log.h"
+#include "mapblock.h"
+#include "noise.h"
+#include "porting.h"
+#include "serialization.h" // SER_FMT_VER_HIGHEST_READ
+#include "version.h"
+#include "network/connection.h"
+#include "network/networkexceptions.h"
+#include "network/networkpacket.h"
+#include "network/networkprotocol.h"
+#include "network/peerhandler.h"
+#include "util/auth.h"
+#include "util/numeric.h"
+#include "util/pointedthing.h"
+#include "util/srp.h"
+#include "util/string.h"
+
+// Bots connecting at the same time would mostly measure the authentication
+static constexpr u64 JOIN_INTERVAL_US = 100 * 1000;
+// Same as the default viewing_range of 190 nodes
+static constexpr u8 WANTED_RANGE_BLOCKS = 12;
+static constexpr float WALK_SPEED = 4.0f * BS;
+static constexpr float FLY_SPEED = 20.0f * BS;
+static constexpr float TELEPORT_INTERVAL = 5.0f;
+// in nodes
+static constexpr s32 TELEPORT_DISTANCE = 2000;
+static constexpr float DIG_PLACE_INTERVAL = 1.0f;
+static constexpr float RTT_INTERVAL = 1.0f;
+
+static const struct {
+	const char *name;
+	LoadBotPattern pattern;
+} pattern_names[] = {
+	{"walk", LOAD_BOT_WALK},
+	{"fly", LOAD_BOT_FLY},
+	{"teleport", LOAD_BOT_TELEPORT},
+	{"digplace", LOAD_BOT_DIG_PLACE},
+};
+
+bool parse_load_bot_pattern(const std::string &name, LoadBotPattern &pattern)
+{
+	for (const auto &it : pattern_names) {
+		if (name == it.name) {
+			pattern = it.pattern;
+			return true;
+		}
+	}
+	pattern = LOAD_BOT_WALK;
+	return false;
+}
+
+namespace {
+
+struct LoadBotStats
+{
+	// all in seconds
+	std::vector<float> join_times;
+	std::vector<float> block_latencies;
+	std::vector<float> rtts;
+	u64 blocks_received = 0;
+	u32 failed = 0;
+};
+
+/*
+	A single bot. Its connection runs its own send and receive threads,
+	everything else is done by the thread calling step().
+*/
+class LoadBot : public con::PeerHandler
+{
+public:
+	LoadBot(const std::string &name, LoadBotPattern pattern, u64 seed);
+	~LoadBot();
+
+	DISABLE_CLASS_COPY(LoadBot)
+
+	void connect(const Address &address);
+	void disconnect();
+	void step(float dtime, LoadBotStats &stats);
+
+	bool isJoined() const { return m_state == STATE_JOINED; }
+	bool hasFailed() const { return m_state == STATE_FAILED; }
+	const std::string &getName() const { return m_name; }
+
+	void peerAdded(con::IPeer *peer) override {}
+	void deletingPeer(con::IPeer *peer, bool timeout) override;
+
+private:
+	enum State : u8 {
+		STATE_IDLE,
+		STATE_AUTHENTICATING,
+		STATE_JOINING,
+		STATE_JOINED,
+		STATE_FAILED,
+	};
+
+	void fail(const std::string &reason);
+	void send(NetworkPacket &pkt);
+	void handlePacket(NetworkPacket &pkt, LoadBotStats &stats);
+	void startAuth(u32 auth_mechs);
+	void move(float dtime);
+	void digPlace();
+	void writePlayerPos(NetworkPacket &pkt) const;
+	void sendPlayerPos();
+
+	const std::string m_name;
+	const LoadBotPattern m_pattern;
+	PcgRandom m_rand;
+	std::unique_ptr<con::IConnection> m_con;
+	State m_state = STATE_IDLE;
+	u64 m_connect_time_us = 0;
+	SRPUser *m_srp_user = nullptr;
+	// from TOCLIENT_AUTH_ACCEPT
+	float m_send_interval = 0.1f;
+	float m_send_timer = 0.0f;
+	float m_rtt_timer = 0.0f;
+
+	// in BS units, like the protocol
+	v3f m_position;
+	v3f m_speed;
+	v3f m_spawn;
+	float m_yaw = 0.0f;
+	float m_pattern_timer = 0.0f;
+	bool m_dug = false;
+
+	std::unordered_set<v3s16> m_received_blocks;
+	// the block the bot is in, if it was not received yet
+	bool m_waiting = false;
+	v3s16 m_waiting_block;
+	u64 m_waiting_since_us = 0;
+};
+
+LoadBot::LoadBot(const std::string &name, LoadBotPattern pattern, u64 seed) :
+	m_name(name),
+	m_pattern(pattern),
+	m_rand(seed)
+{
+}
+
+LoadBot::~LoadBot()
+{
+	disconnect();
+	if (m_srp_user)
+		srp_user_delete(m_srp_user);
+}
+
+void LoadBot::connect(const Address &address)
+{
+	m_con.reset(con::createMTP(CONNECTION_TIMEOUT, address.isIPv6(), this));
+	m_con->Connect(address);
+	m_connect_time_us = porting::getTimeUs();
+	m_state = STATE_AUTHENTICATING;
+
+	NetworkPacket pkt(TOSERVER_INIT, 1 + 2 + 2 + 2 + (2 + m_name.size()));
+	pkt << SER_FMT_VER_HIGHEST_READ << (u16) 0 /* unused */;
+	pkt << CLIENT_PROTOCOL_VERSION_MIN << LATEST_PROTOCOL_VERSION;
+	pkt << m_name;
+	send(pkt);
+}
+
+void LoadBot::disconnect()
+{
+	if (!m_con)
+		return;
+	m_con->Disconnect();
+	m_con.reset();
+}
+
+void LoadBot::deletingPeer(con::IPeer *peer, bool timeout)
+{
+	if (m_state != STATE_FAILED && m_state != STATE_IDLE)
+		fail(timeout ? "connection timed out" : "disconnected");
+}
+
+void LoadBot::fail(const std::string &reason)
+{
+	errorstream << "LoadBot " << m_name << ": " << reason << std::endl;
+	m_state = STATE_FAILED;
+}
+
+void LoadBot::send(NetworkPacket &pkt)
+{
+	// Same as in the table of the client
+	u8 channel = 1;
+	bool reliable = true;
+	switch (pkt.getCommand()) {
+	case TOSERVER_INIT:
+		reliable = false;
+		break;
+	case TOSERVER_PLAYERPOS:
+		channel = 0;
+		reliable = false;
+		break;
+	case TOSERVER_GOTBLOCKS:
+		channel = 2;
+		break;
+	case TOSERVER_INTERACT:
+		channel = 0;
+		break;
+	default:
+		break;
+	}
+	m_con->Send(PEER_ID_SERVER, channel, &pkt, reliable);
+}
+
+void LoadBot::step(float dtime, LoadBotStats &stats)
+{
+	if (!m_con)
+		return;
+
+	NetworkPacket pkt;
+	while (m_state != STATE_FAILED) {
+		pkt.clear();
+		try {
+			if (!m_con->TryReceive(&pkt))
+				break;
+			handlePacket(pkt, stats);
+		} catch (const con::InvalidIncomingDataException &e) {
+			infostream << "LoadBot " << m_name << ": " << e.what() << std::endl;
+		} catch (const SerializationError &e) {
+			infostream << "LoadBot " << m_name << ": invalid packet "
+				<< pkt.getCommand() << ": " << e.what() << std::endl;
+		}
+	}
+
+	if (m_state == STATE_FAILED) {
+		stats.failed++;
+		disconnect();
+		return;
+	}
+	if (m_state != STATE_JOINED)
+		return;
+
+	move(dtime);
+
+	const v3s16 bp = getNodeBlockPos(floatToInt(m_position, BS));
+	if (!m_received_blocks.count(bp) && !(m_waiting && bp == m_waiting_block)) {
+		m_waiting = true;
+		m_waiting_block = bp;
+		m_waiting_since_us = porting::getTimeUs();
+	} else if (m_received_blocks.count(bp)) {
+		m_waiting = false;
+	}
+
+	m_send_timer += dtime;
+	if (m_send_timer >= m_send_interval) {
+		m_send_timer = 0.0f;
+		sendPlayerPos();
+	}
+
+	m_rtt_timer += dtime;
+	if (m_rtt_timer >= RTT_INTERVAL) {
+		m_rtt_timer = 0.0f;
+		const float rtt = m_con->getPeerStat(PEER_ID_SERVER, con::AVG_RTT);
+		if (rtt > 0.0f)
+			stats.rtts.push_back(rtt);
+	}
+}
+
+void LoadBot::handlePacket(NetworkPacket &pkt, LoadBotStats &stats)
+{
+	switch (pkt.getCommand()) {
+	case TOCLIENT_HELLO: {
+		u8 ser_ver;
+		u16 unused_compression_mode, proto_ver;
+		u32 auth_mechs;
+		std::string unused;
+		pkt >> ser_ver >> unused_compression_mode >> proto_ver >> auth_mechs
+			>> unused;
+		if (!ser_ver_supported_read(ser_ver)) {
+			fail("unsupported serialization version");
+			return;
+		}
+		startAuth(auth_mechs);
+		break;
+	}
+	case TOCLIENT_SRP_BYTES_S_B: {
+		if (!m_srp_user)
+			return;
+		std::string s, B;
+		pkt >> s >> B;
+		char *bytes_M = nullptr;
+		size_t len_M = 0;
+		srp_user_process_challenge(m_srp_user,
+			(const unsigned char *) s.c_str(), s.size(),
+			(const unsigned char *) B.c_str(), B.size(),
+			(unsigned char **) &bytes_M, &len_M);
+		if (!bytes_M) {
+			fail("SRP-6a S_B safety check violation");
+			return;
+		}
+		NetworkPacket resp_pkt(TOSERVER_SRP_BYTES_M, 0);
+		resp_pkt << std::string(bytes_M, len_M);
+		send(resp_pkt);
+		break;
+	}
+	case TOCLIENT_AUTH_ACCEPT: {
+		v3f unused_pos;
+		u64 unused_seed;
+		pkt >> unused_pos >> unused_seed >> m_send_interval;
+		m_send_interval = rangelim(m_send_interval, 0.01f, 1.0f);
+		if (m_srp_user) {
+			srp_user_delete(m_srp_user);
+			m_srp_user = nullptr;
+		}
+
+		NetworkPacket resp_pkt(TOSERVER_INIT2, 2);
+		resp_pkt << std::string();
+		send(resp_pkt);
+
+		// There is no media to load, so the bot is ready right away
+		const size_t hash_len = strlen(g_version_hash);
+		NetworkPacket ready_pkt(TOSERVER_CLIENT_READY, 1 + 1 + 1 + 1 + 2 + hash_len + 2);
+		ready_pkt << (u8) VERSION_MAJOR << (u8) VERSION_MINOR << (u8) VERSION_PATCH
+			<< (u8) 0 << (u16) hash_len;
+		ready_pkt.putRawString(g_version_hash, (u16) hash_len);
+		ready_pkt << (u16) FORMSPEC_API_VERSION;
+		send(ready_pkt);
+		m_state = STATE_JOINING;
+		break;
+	}
+	case TOCLIENT_ACCESS_DENIED: {
+		u8 code = 0;
+		if (pkt.getRemainingBytes() >= 1)
+			pkt >> code;
+		fail("access denied (code " + std::to_string(code) + ")");
+		break;
+	}
+	case TOCLIENT_MOVE_PLAYER: {
+		// The first one is sent when the player was emerged
+		float pitch;
+		pkt >> m_position >> pitch >> m_yaw;
+		if (m_state == STATE_JOINING) {
+			m_state = STATE_JOINED;
+			m_spawn = m_position;
+			stats.join_times.push_back(
+				(porting::getTimeUs() - m_connect_time_us) / 1e6f);
+		}
+		break;
+	}
+	case TOCLIENT_BLOCKDATA: {
+		v3s16 p;
+		pkt >> p;
+		stats.blocks_received++;
+		m_received_blocks.insert(p);
+		if (m_waiting && p == m_waiting_block) {
+			m_waiting = false;
+			stats.block_latencies.push_back(
+				(porting::getTimeUs() - m_waiting_since_us) / 1e6f);
+		}
+
+		NetworkPacket resp_pkt(TOSERVER_GOTBLOCKS, 1 + 6);
+		resp_pkt << (u8) 1 << p;
+		send(resp_pkt);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void LoadBot::startAuth(u32 auth_mechs)
+{
+	const std::string password;
+
+	if (auth_mechs & AUTH_MECHANISM_SRP) {
+		const std::string name_lower = lowercase(m_name);
+		m_srp_user = srp_user_new(SRP_SHA256, SRP_NG_2048,
+			m_name.c_str(), name_lower.c_str(),
+			(const unsigned char *) password.c_str(), password.size(),
+			nullptr, nullptr);
+		char *bytes_A = nullptr;
+		size_t len_A = 0;
+		if (srp_user_start_authentication(m_srp_user, nullptr, nullptr, 0,
+				(unsigned char **) &bytes_A, &len_A) != SRP_OK) {
+			fail("creating the SRP user failed");
+			return;
+		}
+		NetworkPacket resp_pkt(TOSERVER_SRP_BYTES_A, 0);
+		resp_pkt << std::string(bytes_A, len_A) << (u8) 1;
+		send(resp_pkt);
+	} else if (auth_mechs & AUTH_MECHANISM_FIRST_SRP) {
+		std::string verifier, salt;
+		generate_srp_verifier_and_salt(m_name, password, &verifier, &salt);
+		NetworkPacket resp_pkt(TOSERVER_FIRST_SRP, 0);
+		resp_pkt << salt << verifier << (u8) 1;
+		send(resp_pkt);
+	} else {
+		fail("no supported authentication mechanism");
+	}
+}
+
+void LoadBot::move(float dtime)
+{
+	m_pattern_timer -= dtime;
+
+	switch (m_pattern) {
+	case LOAD_BOT_WALK:
+	case LOAD_BOT_FLY: {
+		if (m_pattern_timer <= 0.0f) {
+			m_pattern_timer = m_rand.range(5, 10);
+			m_yaw = m_rand.range(0, 359);
+			const float speed = m_pattern == LOAD_BOT_WALK ? WALK_SPEED : FLY_SPEED;
+			const float yaw = m_yaw * core::DEGTORAD;
+			m_speed = v3f(-std::sin(yaw), 0.0f, std::cos(yaw)) * speed;
+			if (m_pattern == LOAD_BOT_FLY)
+				m_speed.Y = m_rand.range(-5, 5) * BS;
+		}
+		m_position += m_speed * dtime;
+		break;
+	}
+	case LOAD_BOT_TELEPORT: {
+		if (m_pattern_timer <= 0.0f) {
+			m_pattern_timer = TELEPORT_INTERVAL;
+			m_position = m_spawn + v3f(m_rand.range(-TELEPORT_DISTANCE, TELEPORT_DISTANCE),
+				0, m_rand.range(-TELEPORT_DISTANCE, TELEPORT_DISTANCE)) * BS;
+		}
+		break;
+	}
+	case LOAD_BOT_DIG_PLACE: {
+		if (m_pattern_timer <= 0.0f) {
+			m_pattern_timer = DIG_PLACE_INTERVAL;
+			digPlace();
+		}
+		break;
+	}
+	}
+}
+
+void LoadBot::digPlace()
+{
+	const v3s16 feet = floatToInt(m_position, BS);
+	const v3s16 below = feet - v3s16(0, 1, 0);
+
+	std::vector<std::pair<InteractAction, PointedThing>> actions;
+	if (!m_dug) {
+		// pointing at the top of the node below
+		const PointedThing pointed(below, feet, below, intToFloat(below, BS),
+			v3f(0, 1, 0), 0, BS * BS, PointabilityType::POINTABLE);
+		actions.emplace_back(INTERACT_START_DIGGING, pointed);
+		actions.emplace_back(INTERACT_DIGGING_COMPLETED, pointed);
+	} else {
+		// placing onto the node below the hole
+		const v3s16 under = below - v3s16(0, 1, 0);
+		const PointedThing pointed(under, below, under, intToFloat(under, BS),
+			v3f(0, 1, 0), 0, 4 * BS * BS, PointabilityType::POINTABLE);
+		actions.emplace_back(INTERACT_PLACE, pointed);
+	}
+	m_dug = !m_dug;
+
+	for (const auto &it : actions) {
+		NetworkPacket pkt(TOSERVER_INTERACT, 1 + 2 + 0);
+		pkt << (u8) it.first << (u16) 0;
+		std::ostringstream os(std::ios::binary);
+		it.second.serialize(os);
+		pkt.putLongString(os.str());
+		writePlayerPos(pkt);
+		send(pkt);
+	}
+}
+
+void LoadBot::writePlayerPos(NetworkPacket &pkt) const
+{
+	const v3s32 position = v3s32::from(m_position * 100);
+	const v3s32 speed = v3s32::from(m_speed * 100);
+	// forward key while moving
+	const u32 keys = m_speed.getLengthSQ() > 0.0f ? 1 : 0;
+	// the default fov of 72 degrees scaled by 80
+	const u8 fov = 100;
+
+	pkt << position << speed << (s32) 0 << (s32) (m_yaw * 100) << keys;
+	pkt << fov << WANTED_RANGE_BLOCKS;
+	pkt << (u8) 0; // camera_inverted
+	pkt << (f32) (m_speed.getLengthSQ() > 0.0f ? 1.0f : 0.0f) << (f32) 0.0f;
+}
+
+void LoadBot::sendPlayerPos()
+{
+	NetworkPacket pkt(TOSERVER_PLAYERPOS, 12 + 12 + 4 + 4 + 4 + 1 + 1 + 1 + 4 + 4);
+	writePlayerPos(pkt);
+	send(pkt);
+}
+
+void print_distribution(const char *name, std::vector<float> &values)
+{
+	rawstream << "  " << name << ": ";
+	if (values.empty()) {
+		rawstream << "no samples" << std::endl;
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	const auto percentile = [&] (double fraction) {
+		const size_t rank = std::max<size_t>(1, std::ceil(values.size() * fraction));
+		return values[rank - 1] * 1000.0f;
+	};
+	rawstream << "count=" << values.size() << std::fixed << std::setprecision(1)
+		<< " p50=" << percentile(0.50) << "ms p95=" << percentile(0.95)
+		<< "ms p99=" << percentile(0.99) << "ms max=" << values.back() * 1000.0f
+		<< "ms" << std::defaultfloat << std::endl;
+}
+
+} // namespace
+
+bool run_load_bots(const LoadBotParams &params)
+{
+	volatile auto &kill = *porting::signal_handler_killstatus();
+
+	actionstream << "Starting " << params.count << " load bots for "
+		<< params.duration << " s" << std::endl;
+
+	std::vector<std::unique_ptr<LoadBot>> bots;
+	LoadBotStats stats;
+	const u64 start_us = porting::getTimeUs();
+	const u64 end_us = start_us + (u64)(params.duration * 1e6f);
+	u64 next_join_us = start_us;
+	u64 last_us = start_us;
+
+	while (!kill) {
+		const u64 now_us = porting::getTimeUs();
+		if (now_us >= end_us)
+			break;
+
+		while (bots.size() < params.count && now_us >= next_join_us) {
+			const std::string name = params.name_prefix +
+				std::to_string(bots.size() + 1);
+			bots.push_back(std::make_unique<LoadBot>(name, params.pattern,
+				start_us + bots.size()));
+			bots.back()->connect(params.address);
+			next_join_us += JOIN_INTERVAL_US;
+		}
+
+		const float dtime = (now_us - last_us) / 1e6f;
+		last_us = now_us;
+		for (auto &bot : bots)
+			bot->step(dtime, stats);
+
+		sleep_ms(10);
+	}
+
+	u32 joined = 0;
+	for (auto &bot : bots) {
+		if (bot->isJoined())
+			joined++;
+		else if (!bot->hasFailed())
+			errorstream << "LoadBot " << bot->getName() << " did not join" << std::endl;
+		bot->disconnect();
+	}
+
+	rawstream << "Load bot results (" << joined << " of " << params.count
+		<< " bots joined, " << stats.failed << " failed, "
+		<< stats.blocks_received << " blocks received):" << std::endl;
+	print_distribution("join time", stats.join_times);
+	print_distribution("block latency", stats.block_latencies);
+	print_distribution("round trip time", stats.rtts);
+
+	return joined == params.count;
+}
@@ -0,0 +1,48 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <string>
+#include "irrlichttypes.h"
+#include "network/address.h"
+
+enum LoadBotPattern : u8
+{
+	// random walk at walking speed, keeping the height of the spawn point
+	LOAD_BOT_WALK,
+	// random flight at fast speed, also going up and down
+	LOAD_BOT_FLY,
+	// jumps to a random place every few seconds
+	LOAD_BOT_TELEPORT,
+	// stands still and digs and places the node below it in turns
+	LOAD_BOT_DIG_PLACE,
+};
+
+struct LoadBotParams
+{
+	Address address;
+	// bots are named name_prefix1, name_prefix2, ...
+	std::string name_prefix = "bot";
+	u32 count = 10;
+	LoadBotPattern pattern = LOAD_BOT_WALK;
+	// in seconds
+	float duration = 60.0f;
+};
+
+// Returns LOAD_BOT_WALK and false for unknown names
+bool parse_load_bot_pattern(const std::string &name, LoadBotPattern &pattern);
+
+/*
+	Connects headless bots to a server to put load on it, moves them
+	according to the pattern and prints the distributions of the join time,
+	the time until the block a bot entered is received and the round trip
+	time at the end.
+
+	The bots speak the network protocol themselves, they have no map,
+	definitions or media. Passwords are empty.
+
+	Returns false if a bot failed to join.
+*/
+bool run_load_bots(const LoadBotParams &params);
@@ -20,6 +20,7 @@
 #include "util/quicktune.h"
 #include "httpfetch.h"
 #include "gameparams.h"
+#include "loadbot.h"
 #include "database/database.h"
 #include "config.h"
 #include "player.h"
@@ -27,6 +28,10 @@
 #include "serialization.h" // SER_FMT_VER_HIGHEST_*
 #include "network/socket.h"
 #include "mapblock.h"
+#include "server/packetrecord.h"
+#include "server/stepphaseprofiler.h"
+#include "threading/workerpool.h"
+#include <iomanip>
 #if USE_CURSES
 	#include "terminal_chat_console.h"
 #endif
@@ -113,6 +118,8 @@ static bool determine_subgame(GameParams *game_params);
 static bool run_dedicated_server(const GameParams &game_params, const Settings &cmd_args);
 static bool migrate_map_database(const GameParams &game_params, const Settings &cmd_args);
 static bool recompress_map_database(const GameParams &game_params, const Settings &cmd_args);
+static bool run_bots(const Settings &cmd_args);
+static bool replay_packets(const GameParams &game_params, const Settings &cmd_args);
 
 /**********************************************************************/
 
@@ -242,6 +249,12 @@ int main(int argc, char *argv[])
 #endif
 	}
 
+	// Put load on a server
+	if (cmd_args.exists("run-bots")) {
+		porting::attachOrCreateConsole();
+		return run_bots(cmd_args) ? 0 : 1;
+	}
+
 	GameStartData game_params;
 #if !CHECK_CLIENT_BUILD()
 	porting::attachOrCreateConsole();
@@ -341,6 +354,18 @@ static void set_allowed_options(OptionList *allowed_options)
 			_("Run benchmarks and exit"))));
 	allowed_options->insert(std::make_pair("test-module", ValueSpec(VALUETYPE_STRING,
 			_("Only run the specified test module or benchmark"))));
+	allowed_options->insert(std::make_pair("run-bots", ValueSpec(VALUETYPE_STRING,
+			_("Connect headless load bots to the given server address, "
+			"print the measured latencies and exit"))));
+	allowed_options->insert(std::make_pair("bot-count", ValueSpec(VALUETYPE_STRING,
+			_("Number of load bots (default: 10)"))));
+	allowed_options->insert(std::make_pair("bot-pattern", ValueSpec(VALUETYPE_STRING,
+			_("Movement of the load bots ('walk', 'fly', 'teleport' or 'digplace'), "
+			"defaults to 'walk'"))));
+	allowed_options->insert(std::make_pair("bot-duration", ValueSpec(VALUETYPE_STRING,
+			_("Seconds to run the load bots for (default: 60)"))));
+	allowed_options->insert(std::make_pair("bot-name", ValueSpec(VALUETYPE_STRING,
+			_("Name prefix of the load bots (default: 'bot')"))));
 	allowed_options->insert(std::make_pair("map-dir", ValueSpec(VALUETYPE_STRING,
 			_("Same as --world (deprecated)"))));
 	allowed_options->insert(std::make_pair("world", ValueSpec(VALUETYPE_STRING,
@@ -374,10 +399,21 @@ static void set_allowed_options(OptionList *allowed_options)
 		_("Migrate from current auth backend to another" SERVER_ONLY))));
 	allowed_options->insert(std::make_pair("migrate-mod-storage", ValueSpec(VALUETYPE_STRING,
 		_("Migrate from current mod storage backend to another" SERVER_ONLY))));
+	allowed_options->insert(std::make_pair("replay-packets", ValueSpec(VALUETYPE_STRING,
+			_("Run a copy of the world with the packets recorded to the given "
+			"packet_record_file and print step timings" SERVER_ONLY))));
+	allowed_options->insert(std::make_pair("replay-dtime", ValueSpec(VALUETYPE_STRING,
+			_("Length of a step while replaying packets (default: dedicated_server_step)" SERVER_ONLY))));
+	allowed_options->insert(std::make_pair("replay-seed", ValueSpec(VALUETYPE_STRING,
+			_("Random seed while replaying packets (default: 1)" SERVER_ONLY))));
 	allowed_options->insert(std::make_pair("terminal", ValueSpec(VALUETYPE_FLAG,
 			_("Enable ncurses interactive terminal" SERVER_ONLY))));
 	allowed_options->insert(std::make_pair("recompress", ValueSpec(VALUETYPE_FLAG,
 			_("Recompress the blocks of the given map database" SERVER_ONLY))));
+	allowed_options->insert(std::make_pair("recompress-level", ValueSpec(VALUETYPE_STRING,
+			_("Compression level to recompress with (default: map_compression_level_disk)" SERVER_ONLY))));
+	allowed_options->insert(std::make_pair("recompress-threads", ValueSpec(VALUETYPE_STRING,
+			_("Number of threads to recompress with (default: one per CPU)" SERVER_ONLY))));
 #if CHECK_CLIENT_BUILD()
 	allowed_options->insert(std::make_pair("address", ValueSpec(VALUETYPE_STRING,
 			_("Address to connect to ('' = local game)"))));
@@ -702,7 +738,9 @@ static bool init_common(const Settings &cmd_args, int argc, char *argv[])
 
 	// Initialize random seed
 	u64 seed;
-	if (!porting::secure_rand_fill_buf(&seed, sizeof(seed))) {
+	if (!g_settings->get("fixed_random_seed").empty()) {
+		seed = g_settings->getU64("fixed_random_seed");
+	} else if (!porting::secure_rand_fill_buf(&seed, sizeof(seed))) {
 		infostream << "Secure randomness not available to seed global RNG!" << std::endl;
 		std::ostringstream oss;
 		// stuff that's somewhat unpredictable:
@@ -1099,6 +1137,9 @@ static bool run_dedicated_server(const GameParams &game_params, const Settings &
 	if (cmd_args.getFlag("recompress"))
 		return recompress_map_database(game_params, cmd_args);
 
+	if (cmd_args.exists("replay-packets"))
+		return replay_packets(game_params, cmd_args);
+
 	// Bind address
 	std::string bind_str = g_settings->get("bind_address");
 	Address bind_addr(0, 0, 0, 0, game_params.socket_port);
@@ -1211,7 +1252,7 @@ static bool migrate_map_database(const GameParams &game_params, const Settings &
 	if (!world_mt.exists("backend")) {
 		errorstream << "Please specify your current backend in world.mt:"
 			<< std::endl
-			<< "	backend = {sqlite3|leveldb|redis|dummy|postgresql}"
+			<< "	backend = {sqlite3|sqlite3_sharded|leveldb|redis|dummy|postgresql}"
 			<< std::endl;
 		return false;
 	}
@@ -1230,26 +1271,30 @@ static bool migrate_map_database(const GameParams &game_params, const Settings &
 	u64 last_update_time = 0;
 	volatile auto &kill = *porting::signal_handler_killstatus();
 
+	// The old database is listed in chunks so that huge maps fit into memory
+	MapDatabase::ListCursor cursor;
 	std::vector<v3s16> blocks;
-	old_db->listAllLoadableBlocks(blocks);
 	new_db->beginSave();
-	for (auto it = blocks.begin(); it != blocks.end(); ++it) {
-		if (kill) return false;
-
-		std::string data;
-		old_db->loadBlock(*it, &data);
-		if (!data.empty()) {
-			new_db->saveBlock(*it, data);
-			count++;
-		} else {
-			errorstream << "Failed to load block " << *it << ", skipping it." << std::endl;
-		}
-		if (porting::getTimeS() - last_update_time >= 1) {
-			std::cerr << " Migrated " << count << " blocks, "
-				<< (100.0 * count / blocks.size()) << "% completed.\r" << std::flush;
-			new_db->endSave();
-			new_db->beginSave();
-			last_update_time = porting::getTimeS();
+	while (!cursor.done) {
+		blocks.clear();
+		old_db->listLoadableBlocks(cursor, 10000, blocks);
+		for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+			if (kill) return false;
+
+			std::string data;
+			old_db->loadBlock(*it, &data);
+			if (!data.empty()) {
+				new_db->saveBlock(*it, data);
+				count++;
+			} else {
+				errorstream << "Failed to load block " << *it << ", skipping it." << std::endl;
+			}
+			if (porting::getTimeS() - last_update_time >= 1) {
+				std::cerr << " Migrated " << count << " blocks.\r" << std::flush;
+				new_db->endSave();
+				new_db->beginSave();
+				last_update_time = porting::getTimeS();
+			}
 		}
 	}
 	std::cerr << std::endl;
@@ -1280,55 +1325,182 @@ static bool recompress_map_database(const GameParams &game_params, const Setting
 	Server server(game_params.world_path, game_params.game_spec, false, Address(), false);
 	MapDatabase *db = ServerMap::createDatabase(backend, game_params.world_path, world_mt);
 
-	u32 count = 0;
-	u64 last_update_time = 0;
 	volatile auto &kill = *porting::signal_handler_killstatus();
 	const u8 serialize_as_ver = SER_FMT_VER_HIGHEST_WRITE;
-	const s16 map_compression_level = rangelim(g_settings->getS16("map_compression_level_disk"), -1, 9);
-
-	// This is ok because the server doesn't actually run
+	const s16 map_compression_level = rangelim(cmd_args.exists("recompress-level") ?
+		cmd_args.getS32("recompress-level") :
+		g_settings->getS16("map_compression_level_disk"), -1, 9);
+	const u32 num_threads = cmd_args.exists("recompress-threads") ?
+		(u32)std::max(cmd_args.getS32("recompress-threads"), 1) :
+		std::max(Thread::getNumberOfProcessors(), 1U);
+	// Blocks keep using the dictionary if the world has one
+	const auto dict = ServerMap::loadDictionary(game_params.world_path, map_compression_level);
+
+	// The database is only accessed from this thread, the blocks of each
+	// chunk are converted in parallel.
+	WorkerPool pool("Recompress", num_threads - 1);
+	actionstream << "Recompressing with level " << map_compression_level
+		<< " using " << num_threads << " threads" << std::endl;
+
+	// This is ok because the server doesn't actually run.
+	// Blocks may be rewritten while the database is listed in chunks.
+	MapDatabase::ListCursor cursor;
 	std::vector<v3s16> blocks;
-	db->listAllLoadableBlocks(blocks);
-	db->beginSave();
-	std::istringstream iss(std::ios_base::binary);
-	std::ostringstream oss(std::ios_base::binary);
-	for (auto it = blocks.begin(); it != blocks.end(); ++it) {
-		if (kill) return false;
-
-		std::string data;
-		db->loadBlock(*it, &data);
-		if (data.empty()) {
-			errorstream << "Failed to load block " << *it << std::endl;
+	std::vector<std::string> data;
+	std::atomic<bool> failed(false);
+	u64 count = 0, in_bytes = 0, out_bytes = 0;
+	const u64 start_time = porting::getTimeMs();
+	while (!cursor.done) {
+		if (kill)
 			return false;
-		}
-
-		iss.str(data);
-		iss.clear();
-
-		{
-			MapBlock mb(v3s16(0,0,0), &server);
-			ServerMap::deSerializeBlock(&mb, iss);
 
-			oss.str("");
-			oss.clear();
-			writeU8(oss, serialize_as_ver);
-			mb.serialize(oss, serialize_as_ver, true, map_compression_level);
+		blocks.clear();
+		db->listLoadableBlocks(cursor, 10000, blocks);
+		data.resize(blocks.size());
+		for (size_t i = 0; i < blocks.size(); i++) {
+			data[i].clear();
+			db->loadBlock(blocks[i], &data[i]);
+			if (data[i].empty()) {
+				errorstream << "Failed to load block " << blocks[i] << std::endl;
+				return false;
+			}
+			in_bytes += data[i].size();
 		}
 
-		db->saveBlock(*it, oss.str());
-		count++;
+		pool.run(blocks.size(), [&] (size_t i) {
+			if (failed || kill)
+				return;
+			try {
+				std::istringstream iss(data[i], std::ios_base::binary);
+				std::ostringstream oss(std::ios_base::binary);
+				MapBlock mb(v3s16(0,0,0), &server);
+				ServerMap::deSerializeBlock(&mb, iss, dict.get());
+
+				writeU8(oss, serialize_as_ver);
+				if (dict) {
+					std::ostringstream raw(std::ios_base::binary);
+					mb.serialize(raw, serialize_as_ver, true, map_compression_level, false);
+					compress(raw.str(), oss, serialize_as_ver, map_compression_level, dict.get());
+				} else {
+					mb.serialize(oss, serialize_as_ver, true, map_compression_level);
+				}
+				data[i] = oss.str();
+			} catch (std::exception &e) {
+				errorstream << "Failed to convert block " << blocks[i]
+					<< ": " << e.what() << std::endl;
+				failed = true;
+			}
+		});
+		if (failed || kill)
+			return false;
 
-		if (porting::getTimeS() - last_update_time >= 1) {
-			std::cerr << " Recompressed " << count << " blocks, "
-				<< (100.0f * count / blocks.size()) << "% completed.\r" << std::flush;
-			db->endSave();
-			db->beginSave();
-			last_update_time = porting::getTimeS();
+		db->beginSave();
+		for (size_t i = 0; i < blocks.size(); i++) {
+			db->saveBlock(blocks[i], data[i]);
+			out_bytes += data[i].size();
 		}
+		db->endSave();
+		count += blocks.size();
+
+		const u64 elapsed = std::max<u64>(porting::getTimeMs() - start_time, 1);
+		std::cerr << " Recompressed " << count << " blocks ("
+			<< (count * 1000 / elapsed) << " blocks/s, "
+			<< (in_bytes >> 20) << " MiB -> " << (out_bytes >> 20) << " MiB).\r"
+			<< std::flush;
 	}
 	std::cerr << std::endl;
-	db->endSave();
 
 	actionstream << "Done, " << count << " blocks were recompressed." << std::endl;
 	return true;
 }
+
+static bool run_bots(const Settings &cmd_args)
+{
+	LoadBotParams params;
+	try {
+		params.address.Resolve(cmd_args.get("run-bots").c_str());
+	} catch (const ResolveError &e) {
+		errorstream << "Couldn't resolve \"" << cmd_args.get("run-bots")
+			<< "\": " << e.what() << std::endl;
+		return false;
+	}
+	params.address.setPort(cmd_args.exists("port") ?
+		cmd_args.getU16("port") : g_settings->getU16("port"));
+
+	if (cmd_args.exists("bot-count"))
+		params.count = std::max(cmd_args.getS32("bot-count"), 1);
+	if (cmd_args.exists("bot-duration"))
+		params.duration = std::max(cmd_args.getFloat("bot-duration"), 1.0f);
+	if (cmd_args.exists("bot-name"))
+		params.name_prefix = cmd_args.get("bot-name");
+	if (cmd_args.exists("bot-pattern") &&
+			!parse_load_bot_pattern(cmd_args.get("bot-pattern"), params.pattern)) {
+		errorstream << "Unknown bot pattern \"" << cmd_args.get("bot-pattern")
+			<< "\"" << std::endl;
+		return false;
+	}
+
+	return run_load_bots(params);
+}
+
+static bool replay_packets(const GameParams &game_params, const Settings &cmd_args)
+{
+	const std::string record_path = cmd_args.get("replay-packets");
+	auto con = std::make_shared<ReplayConnection>(record_path);
+	if (!con->isOpen())
+		return false;
+
+	const float dtime = cmd_args.exists("replay-dtime") ?
+		std::max(cmd_args.getFloat("replay-dtime"), 0.001f) :
+		g_settings->getFloat("dedicated_server_step");
+	const u64 seed = cmd_args.exists("replay-seed") ? cmd_args.getU64("replay-seed") : 1;
+	srand(seed);
+	mysrand(seed);
+	// for math.random
+	g_settings->set("fixed_random_seed", std::to_string(seed));
+
+	// The world is left as it was, so that the replay can be repeated
+	const std::string world_path = fs::CreateTempDir();
+	if (world_path.empty() || !fs::CopyDir(game_params.world_path, world_path)) {
+		errorstream << "Could not copy the world to a temporary directory" << std::endl;
+		return false;
+	}
+	actionstream << "Replaying " << record_path << " on a copy of the world in "
+		<< world_path << std::endl;
+
+	bool success = true;
+	try {
+		Server server(world_path, game_params.game_spec, false, Address(), true,
+			nullptr, nullptr, con);
+		volatile auto &kill = *porting::signal_handler_killstatus();
+
+		const u64 t0 = porting::getTimeUs();
+		const u64 steps = server.replay(*con, dtime, kill);
+		const float duration = (porting::getTimeUs() - t0) / 1e6f;
+
+		rawstream << "Replayed " << steps << " steps of " << dtime << " s in "
+			<< duration << " s, " << con->getSentPackets() << " packets ("
+			<< con->getSentBytes() << " bytes) were sent" << std::endl;
+		rawstream << "Step phase durations in ms:" << std::endl;
+		const StepPhaseProfiler *profiler = server.getStepPhaseProfiler();
+		for (u8 i = 0; i < STEP_PHASE_COUNT; i++) {
+			const StepPhase phase = (StepPhase)i;
+			const auto stats = profiler->getStats(phase);
+			rawstream << "  " << std::left << std::setw(22)
+				<< StepPhaseProfiler::getName(phase) << std::right << std::fixed
+				<< std::setprecision(3) << " count=" << stats.count
+				<< " p50=" << stats.p50 / 1000.0f << " p95=" << stats.p95 / 1000.0f
+				<< " p99=" << stats.p99 / 1000.0f << " max=" << stats.max / 1000.0f
+				<< std::defaultfloat << std::endl;
+		}
+	} catch (const ModError &e) {
+		errorstream << "ModError: " << e.what() << std::endl;
+		success = false;
+	} catch (const ServerError &e) {
+		errorstream << "ServerError: " << e.what() << std::endl;
+		success = false;
+	}
+
+	fs::RecursiveDelete(world_path);
+	return success;
+}
@@ -33,6 +33,7 @@ Map::~Map()
 	/*
 		Free all MapSectors
 	*/
+	m_block_index.clear();
 	for (auto &sector : m_sectors) {
 		delete sector.second;
 	}
@@ -57,10 +58,9 @@ void Map::dispatchEvent(const MapEditEvent &event)
 
 MapSector * Map::getSectorNoGenerateNoLock(v2s16 p)
 {
-	if(m_sector_cache != NULL && p == m_sector_cache_p){
-		MapSector * sector = m_sector_cache;
-		return sector;
-	}
+	MapSector *cached = m_sector_cache.load(std::memory_order_relaxed);
+	if (cached && cached->getPos() == p)
+		return cached;
 
 	auto n = m_sectors.find(p);
 
@@ -70,8 +70,7 @@ MapSector * Map::getSectorNoGenerateNoLock(v2s16 p)
 	MapSector *sector = n->second;
 
 	// Cache the last result
-	m_sector_cache_p = p;
-	m_sector_cache = sector;
+	m_sector_cache.store(sector, std::memory_order_relaxed);
 
 	return sector;
 }
@@ -81,16 +80,121 @@ MapSector *Map::getSectorNoGenerate(v2s16 p)
 	return getSectorNoGenerateNoLock(p);
 }
 
+/*
+	Incremented whenever a block is removed from any map, so that the last
+	block found by each thread is only used while it can't have been freed.
+*/
+static std::atomic<u32> s_block_index_generation {0};
+
+namespace {
+	struct LastBlock {
+		const Map *map = nullptr;
+		u32 generation = 0;
+		MapBlock *block = nullptr;
+	};
+	thread_local LastBlock t_last_block;
+}
+
 MapBlock *Map::getBlockNoCreateNoEx(v3s16 p3d)
 {
-	v2s16 p2d(p3d.X, p3d.Z);
-	MapSector *sector = getSectorNoGenerate(p2d);
-	if (!sector)
-		return nullptr;
-	MapBlock *block = sector->getBlockNoCreateNoEx(p3d.Y);
+	LastBlock &last = t_last_block;
+	const u32 generation = s_block_index_generation.load(std::memory_order_relaxed);
+	if (last.map == this && last.generation == generation &&
+			last.block->getPos() == p3d)
+		return last.block;
+
+	MapBlock *block = m_block_index.get(p3d);
+	if (block)
+		last = {this, generation, block};
 	return block;
 }
 
+void Map::blockInserted(MapBlock *block)
+{
+	m_block_index.insert(block->getPos(), block);
+
+	block->setUsageClock(&m_usage_clock);
+	const s64 bucket = std::floor(m_usage_clock);
+	block->m_unload_bucket = bucket;
+	m_unload_buckets[bucket].push_back(block->getPos());
+}
+
+void Map::blockRemoved(MapBlock *block)
+{
+	m_block_index.erase(block->getPos());
+	s_block_index_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+	MapBlockIndex
+*/
+
+void MapBlockIndex::insert(v3s16 p, MapBlock *block)
+{
+	assert(block);
+	// Keep the table at most half full
+	if ((m_count + 1) * 2 > m_slots.size())
+		rehash(std::max<size_t>(m_slots.size() * 2, 64));
+
+	for (size_t i = slotOf(p);; i = (i + 1) & m_mask) {
+		Slot &slot = m_slots[i];
+		if (!slot.block) {
+			slot = {p, block};
+			m_count++;
+			return;
+		}
+		if (slot.pos == p) {
+			slot.block = block;
+			return;
+		}
+	}
+}
+
+void MapBlockIndex::erase(v3s16 p)
+{
+	if (m_count == 0)
+		return;
+	size_t i = slotOf(p);
+	for (;; i = (i + 1) & m_mask) {
+		if (!m_slots[i].block)
+			return;
+		if (m_slots[i].pos == p)
+			break;
+	}
+	m_count--;
+
+	// Move back the following entries that would no longer be found
+	for (size_t j = (i + 1) & m_mask; m_slots[j].block; j = (j + 1) & m_mask) {
+		const size_t home = slotOf(m_slots[j].pos);
+		// The entry can fill the hole if its home isn't between them
+		if (((j - home) & m_mask) >= ((j - i) & m_mask)) {
+			m_slots[i] = m_slots[j];
+			i = j;
+		}
+	}
+	m_slots[i] = Slot();
+}
+
+void MapBlockIndex::clear()
+{
+	m_slots.clear();
+	m_mask = 0;
+	m_count = 0;
+}
+
+void MapBlockIndex::rehash(size_t capacity)
+{
+	std::vector<Slot> old;
+	old.swap(m_slots);
+	m_slots.resize(capacity);
+	m_mask = capacity - 1;
+	m_count = 0;
+	for (const Slot &slot : old) {
+		if (slot.block)
+			insert(slot.pos, slot.block);
+	}
+}
+
 MapBlock *Map::getBlockNoCreate(v3s16 p3d)
 {
 	MapBlock *block = getBlockNoCreateNoEx(p3d);
@@ -149,19 +253,16 @@ void Map::setNode(v3s16 p, MapNode n)
 	set_node_in_block(m_gamedef->ndef(), block, relpos, n);
 }
 
-void Map::addNodeAndUpdate(v3s16 p, MapNode n,
-		std::map<v3s16, MapBlock*> &modified_blocks,
-		bool remove_metadata)
+bool Map::setNodeBeforeLighting(MapBlock *block, v3s16 p, MapNode n,
+		MapNode &oldnode, bool remove_metadata)
 {
 	// Collect old node for rollback
 	RollbackNode rollback_oldnode(this, p, m_gamedef);
 
-	v3s16 blockpos = getNodeBlockPos(p);
-	MapBlock *block = getBlockNoCreate(blockpos);
-	v3s16 relpos = p - blockpos * MAP_BLOCKSIZE;
+	v3s16 relpos = p - block->getPosRelative();
 
 	// This is needed for updating the lighting
-	MapNode oldnode = block->getNodeNoCheck(relpos);
+	oldnode = block->getNodeNoCheck(relpos);
 
 	// Remove node metadata
 	if (remove_metadata) {
@@ -171,24 +272,17 @@ void Map::addNodeAndUpdate(v3s16 p, MapNode n,
 	// Set the node on the map
 	ContentLightingFlags f = m_nodedef->getLightingFlags(n);
 	ContentLightingFlags oldf = m_nodedef->getLightingFlags(oldnode);
-	if (f == oldf) {
+	bool update_light = f != oldf;
+	if (!update_light) {
 		// No light update needed, just copy over the old light.
 		n.setLight(LIGHTBANK_DAY, oldnode.getLightRaw(LIGHTBANK_DAY, oldf), f);
 		n.setLight(LIGHTBANK_NIGHT, oldnode.getLightRaw(LIGHTBANK_NIGHT, oldf), f);
-		set_node_in_block(m_gamedef->ndef(), block, relpos, n);
-
-		modified_blocks[blockpos] = block;
 	} else {
 		// Ignore light (because calling voxalgo::update_lighting_nodes)
 		n.setLight(LIGHTBANK_DAY, 0, f);
 		n.setLight(LIGHTBANK_NIGHT, 0, f);
-		set_node_in_block(m_gamedef->ndef(), block, relpos, n);
-
-		// Update lighting
-		std::vector<std::pair<v3s16, MapNode> > oldnodes;
-		oldnodes.emplace_back(p, oldnode);
-		voxalgo::update_lighting_nodes(this, oldnodes, modified_blocks);
 	}
+	set_node_in_block(m_gamedef->ndef(), block, relpos, n);
 
 	if (n.getContent() != oldnode.getContent() &&
 			(oldnode.getContent() == CONTENT_AIR || n.getContent() == CONTENT_AIR))
@@ -202,6 +296,26 @@ void Map::addNodeAndUpdate(v3s16 p, MapNode n,
 		action.setSetNode(p, rollback_oldnode, rollback_newnode);
 		m_gamedef->rollback()->reportAction(action);
 	}
+
+	return update_light;
+}
+
+void Map::addNodeAndUpdate(v3s16 p, MapNode n,
+		std::map<v3s16, MapBlock*> &modified_blocks,
+		bool remove_metadata)
+{
+	v3s16 blockpos = getNodeBlockPos(p);
+	MapBlock *block = getBlockNoCreate(blockpos);
+
+	MapNode oldnode;
+	if (setNodeBeforeLighting(block, p, n, oldnode, remove_metadata)) {
+		// Update lighting
+		std::vector<std::pair<v3s16, MapNode> > oldnodes;
+		oldnodes.emplace_back(p, oldnode);
+		voxalgo::update_lighting_nodes(this, oldnodes, modified_blocks);
+	} else {
+		modified_blocks[blockpos] = block;
+	}
 }
 
 void Map::removeNodeAndUpdate(v3s16 p,
@@ -233,6 +347,47 @@ bool Map::addNodeWithEvent(v3s16 p, MapNode n, bool remove_metadata)
 	return succeeded;
 }
 
+bool Map::addNodesWithEvent(std::vector<v3s16> &positions, MapNode n,
+		bool remove_metadata)
+{
+	std::map<v3s16, MapBlock*> modified_blocks;
+	std::vector<std::pair<v3s16, MapNode> > oldnodes;
+	std::unordered_map<v3s16, BlockNodeChanges> changed_nodes;
+
+	MapBlock *block = nullptr;
+	size_t count = 0;
+	for (v3s16 p : positions) {
+		v3s16 blockpos = getNodeBlockPos(p);
+		if (!block || block->getPos() != blockpos)
+			block = getBlockNoCreateNoEx(blockpos);
+		if (!block)
+			continue;
+
+		MapNode oldnode;
+		if (setNodeBeforeLighting(block, p, n, oldnode, remove_metadata))
+			oldnodes.emplace_back(p, oldnode);
+		modified_blocks[blockpos] = block;
+		changed_nodes[blockpos].add(BlockNodeChanges::getIndex(
+			p - block->getPosRelative()), remove_metadata);
+
+		positions[count++] = p;
+	}
+	bool succeeded = count == positions.size();
+	positions.resize(count);
+
+	voxalgo::update_lighting_nodes(this, oldnodes, modified_blocks);
+
+	if (!modified_blocks.empty()) {
+		MapEditEvent event;
+		event.type = MEET_OTHER;
+		event.setModifiedBlocks(modified_blocks);
+		event.changed_nodes = std::move(changed_nodes);
+		dispatchEvent(event);
+	}
+
+	return succeeded;
+}
+
 bool Map::removeNodeWithEvent(v3s16 p)
 {
 	MapEditEvent event;
@@ -255,21 +410,6 @@ bool Map::removeNodeWithEvent(v3s16 p)
 	return succeeded;
 }
 
-struct TimeOrderedMapBlock {
-	MapSector *sect;
-	MapBlock *block;
-
-	TimeOrderedMapBlock(MapSector *sect, MapBlock *block) :
-		sect(sect),
-		block(block)
-	{}
-
-	bool operator<(const TimeOrderedMapBlock &b) const
-	{
-		return block->getUsageTimer() < b.block->getUsageTimer();
-	};
-};
-
 /*
 	Updates usage timers
 */
@@ -290,92 +430,77 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 	const auto start_time = porting::getTimeUs();
 	beginSave();
 
-	// If there is no practical limit, we spare creation of mapblock_queue
-	if (max_loaded_blocks < 0) {
-		MapBlockVect blocks;
-		for (auto &sector_it : m_sectors) {
-			MapSector *sector = sector_it.second;
-
-			bool all_blocks_deleted = true;
+	// This advances the usage timers of all blocks
+	m_usage_clock += dtime;
 
-			blocks.clear();
-			sector->getBlocks(blocks);
-
-			for (MapBlock *block : blocks) {
-				block->incrementUsageTimer(dtime);
+	for (auto &sector_it : m_sectors) {
+		block_count_all += sector_it.second->size();
+		if (sector_it.second->empty())
+			sector_deletion_queue.push_back(sector_it.first);
+	}
 
-				if (block->refGet() == 0
-						&& block->getUsageTimer() > unload_timeout) {
-					v3s16 p = block->getPos();
+	// Blocks last used before this have timed out
+	const double unused_since = m_usage_clock - unload_timeout;
 
-					// Save if modified
-					if (block->getModified() != MOD_STATE_CLEAN
-							&& save_before_unloading) {
-						modprofiler.add(block->getModifiedReasonString(), 1);
-						if (!saveBlock(block))
-							continue;
-						saved_blocks_count++;
-					}
+	// Blocks that stay filed in the bucket that is looked at
+	std::vector<std::pair<s64, v3s16>> kept;
 
-					// Delete from memory
-					sector->deleteBlock(block);
+	// Go through the blocks from the least recently used one, until the
+	// remaining ones are neither timed out nor over the limit
+	while (!m_unload_buckets.empty()) {
+		auto bucket_it = m_unload_buckets.begin();
+		const s64 bucket = bucket_it->first;
+		if (bucket > unused_since && (max_loaded_blocks < 0 ||
+				block_count_all <= (u32)max_loaded_blocks))
+			break;
 
-					if (unloaded_blocks)
-						unloaded_blocks->push_back(p);
+		std::vector<v3s16> positions = std::move(bucket_it->second);
+		m_unload_buckets.erase(bucket_it);
 
-					deleted_blocks_count++;
-				} else {
-					all_blocks_deleted = false;
-					block_count_all++;
-				}
-			}
+		for (v3s16 p : positions) {
+			MapBlock *block = getBlockNoCreateNoEx(p);
+			// Unloaded or filed again since
+			if (!block || block->m_unload_bucket != bucket)
+				continue;
 
-			// Delete sector if we emptied it
-			if (all_blocks_deleted) {
-				sector_deletion_queue.push_back(sector_it.first);
+			// Used since it was filed, so look at it again later
+			const s64 last_used = std::floor(m_usage_clock - block->getUsageTimer());
+			if (last_used > bucket) {
+				block->m_unload_bucket = last_used;
+				m_unload_buckets[last_used].push_back(p);
+				continue;
 			}
-		}
-	} else {
-		std::priority_queue<TimeOrderedMapBlock> mapblock_queue;
-		MapBlockVect blocks;
-		for (auto &sector_it : m_sectors) {
-			MapSector *sector = sector_it.second;
-
-			blocks.clear();
-			sector->getBlocks(blocks);
 
-			for (MapBlock *block : blocks) {
-				block->incrementUsageTimer(dtime);
-				mapblock_queue.push(TimeOrderedMapBlock(sector, block));
+			const bool over_limit = max_loaded_blocks >= 0 &&
+				block_count_all > (u32)max_loaded_blocks;
+			if (!over_limit && block->getUsageTimer() <= unload_timeout) {
+				kept.emplace_back(bucket, p);
+				continue;
 			}
-		}
-		block_count_all = mapblock_queue.size();
-
-		// Delete old blocks, and blocks over the limit from the memory
-		while (!mapblock_queue.empty() && ((s32)mapblock_queue.size() > max_loaded_blocks
-				|| mapblock_queue.top().block->getUsageTimer() > unload_timeout)) {
-			TimeOrderedMapBlock b = mapblock_queue.top();
-			mapblock_queue.pop();
-
-			MapBlock *block = b.block;
 
 			if (block->refGet() != 0) {
 				locked_blocks++;
+				kept.emplace_back(bucket, p);
 				continue;
 			}
 
-			v3s16 p = block->getPos();
-
 			// Save if modified
 			if (block->getModified() != MOD_STATE_CLEAN && save_before_unloading) {
 				modprofiler.add(block->getModifiedReasonString(), 1);
-				if (!saveBlock(block))
+				if (!saveBlock(block)) {
+					kept.emplace_back(bucket, p);
 					continue;
+				}
 				saved_blocks_count++;
 			}
 
 			// Delete from memory
-			b.sect->deleteBlock(block);
+			MapSector *sector = getSectorNoGenerate(v2s16(p.X, p.Z));
+			sector->deleteBlock(block);
+
+			// Delete sector if we emptied it
+			if (sector->empty())
+				sector_deletion_queue.push_back(sector->getPos());
 
 			if (unloaded_blocks)
 				unloaded_blocks->push_back(p);
@@ -383,15 +508,11 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 			deleted_blocks_count++;
 			block_count_all--;
 		}
-
-		// Delete empty sectors
-		for (auto &sector_it : m_sectors) {
-			if (sector_it.second->empty()) {
-				sector_deletion_queue.push_back(sector_it.first);
-			}
-		}
 	}
 
+	for (auto &it : kept)
+		m_unload_buckets[it.first].push_back(it.second);
+
 	endSave();
 	const auto end_time = porting::getTimeUs();
 
@@ -663,22 +784,41 @@ bool Map::isOccluded(const v3s16 pos_camera, const v3s16 pos_target,
 
 	v3f pos_origin_f = intToFloat(pos_camera, BS);
 	u32 count = 0;
-	bool is_valid_position;
+
+	// Consecutive steps mostly land in the same block, so keep it around.
+	// Its opacity summary spares looking at single nodes in most blocks.
+	MapBlock *block = nullptr;
+	v3s16 block_pos;
+	auto opacity = MapBlock::OPACITY_UNKNOWN;
+	bool have_block = false;
 
 	for (; offset < distance + end_offset; offset += step) {
 		v3f pos_node_f = pos_origin_f + direction * offset;
 		v3s16 pos_node = floatToInt(pos_node_f, BS);
+		step *= stepfac;
 
-		MapNode node = getNode(pos_node, &is_valid_position);
+		v3s16 pos_block = getNodeBlockPos(pos_node);
+		if (!have_block || pos_block != block_pos) {
+			block = getBlockNoCreateNoEx(pos_block);
+			block_pos = pos_block;
+			have_block = true;
+			if (block)
+				opacity = block->getOpacity(m_nodedef);
+		}
 
-		if (is_valid_position &&
-				!m_nodedef->getLightingFlags(node).light_propagates) {
-			// Cannot see through light-blocking nodes --> occluded
-			count++;
-			if (count >= needed_count)
-				return true;
+		if (!block || opacity == MapBlock::OPACITY_NONE)
+			continue;
+
+		if (opacity == MapBlock::OPACITY_MIXED) {
+			MapNode node = block->getNodeNoCheck(pos_node - pos_block * MAP_BLOCKSIZE);
+			if (m_nodedef->getLightingFlags(node).light_propagates)
+				continue;
 		}
-		step *= stepfac;
+
+		// Cannot see through light-blocking nodes --> occluded
+		count++;
+		if (count >= needed_count)
+			return true;
 	}
 	return false;
 }
@@ -845,8 +985,34 @@ std::map<v3s16, bool> MMVManip::getCoveredBlocks() const
 	return ret;
 }
 
+// Finds the nodes of a block that the voxel manipulator is going to change
+static void find_changed_nodes(const NodeDefManager *ndef,
+	const VoxelManipulator &vm, MapBlock *block, BlockNodeChanges &changes)
+{
+	const v3s16 offset = block->getPosRelative();
+	v3s16 relpos;
+	for (relpos.Z = 0; relpos.Z < MAP_BLOCKSIZE; relpos.Z++)
+	for (relpos.Y = 0; relpos.Y < MAP_BLOCKSIZE; relpos.Y++) {
+		u32 i = vm.m_area.index(offset.X, offset.Y + relpos.Y, offset.Z + relpos.Z);
+		for (relpos.X = 0; relpos.X < MAP_BLOCKSIZE; relpos.X++, i++) {
+			const MapNode n = vm.m_data[i];
+			if (n.getContent() == CONTENT_IGNORE)
+				continue; // not written back
+			const MapNode old = block->getNodeNoCheck(relpos);
+			if (n.getContent() == old.getContent() && n.param2 == old.param2 &&
+					(n.param1 == old.param1 ||
+					ndef->get(n).param_type == CPT_LIGHT))
+				continue;
+			changes.add(BlockNodeChanges::getIndex(relpos));
+			if (changes.all)
+				return;
+		}
+	}
+}
+
 void MMVManip::blitBackAll(std::map<v3s16, MapBlock*> *modified_blocks,
-	bool overwrite_generated) const
+	bool overwrite_generated,
+	std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes) const
 {
 	if (m_area.hasEmptyExtent())
 		return;
@@ -875,10 +1041,19 @@ void MMVManip::blitBackAll(std::map<v3s16, MapBlock*> *modified_blocks,
 		if (!overwrite_generated && block->isGenerated())
 			continue;
 
-		block->copyFrom(*this);
+		BlockNodeChanges changes;
+		if (changed_nodes)
+			find_changed_nodes(m_map->getNodeDefManager(), *this, block, changes);
+
+		// Blocks that stay the same aren't modified
+		if (!block->copyFrom(*this))
+			continue;
 		block->raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_VMANIP);
 		block->expireIsAirCache();
 
+		if (changes.all || !changes.nodes.empty())
+			(*changed_nodes)[p] = std::move(changes);
+
 		if(modified_blocks)
 			(*modified_blocks)[p] = block;
 	}
@@ -4,9 +4,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <iostream>
+#include <optional>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "irrlichttypes_bloated.h"
 #include "mapblock.h"
@@ -40,6 +44,58 @@ enum MapEditEventType {
 	MEET_OTHER
 };
 
+// Nodes that changed within one block, see MapEditEvent::changed_nodes
+struct BlockNodeChanges
+{
+	// Beyond this sending the whole block is cheaper
+	static constexpr size_t MAX_NODES = 256;
+
+	struct Entry {
+		// (z * MAP_BLOCKSIZE + y) * MAP_BLOCKSIZE + x
+		u16 index;
+		bool remove_metadata;
+	};
+
+	// may contain duplicates
+	std::vector<Entry> nodes;
+	// too many changes to list them
+	bool all = false;
+
+	static u16 getIndex(v3s16 relpos)
+	{
+		return (relpos.Z * MAP_BLOCKSIZE + relpos.Y) * MAP_BLOCKSIZE + relpos.X;
+	}
+
+	static v3s16 getRelPos(u16 index)
+	{
+		return v3s16(index % MAP_BLOCKSIZE, (index / MAP_BLOCKSIZE) % MAP_BLOCKSIZE,
+			index / (MAP_BLOCKSIZE * MAP_BLOCKSIZE));
+	}
+
+	void add(u16 index, bool remove_metadata = false)
+	{
+		if (all)
+			return;
+		if (nodes.size() >= MAX_NODES) {
+			all = true;
+			nodes.clear();
+			return;
+		}
+		nodes.push_back({index, remove_metadata});
+	}
+
+	void add(const BlockNodeChanges &other)
+	{
+		if (other.all) {
+			all = true;
+			nodes.clear();
+			return;
+		}
+		for (const Entry &e : other.nodes)
+			add(e.index, e.remove_metadata);
+	}
+};
+
 struct MapEditEvent
 {
 	MapEditEventType type = MEET_OTHER;
@@ -50,6 +106,10 @@ struct MapEditEvent
 	// Setting low_priority to true allows the server
 	// to send this change to clients with some delay.
 	bool low_priority = false;
+	// MEET_OTHER only, optional: what changed in the modified blocks.
+	// Lighting isn't listed since clients compute it on their own, so
+	// modified blocks missing here only had their lighting changed.
+	std::optional<std::unordered_map<v3s16, BlockNodeChanges>> changed_nodes;
 
 	MapEditEvent() = default;
 
@@ -100,6 +160,53 @@ class MapEventReceiver
 	virtual void onMapEditEvent(const MapEditEvent &event) = 0;
 };
 
+/*
+	Flat hash table from block positions to the loaded blocks of a map,
+	with open addressing and linear probing. The blocks are still owned
+	by their sectors, this only spares the two lookups.
+*/
+class MapBlockIndex
+{
+public:
+	MapBlock *get(v3s16 p) const
+	{
+		if (m_count == 0)
+			return nullptr;
+		for (size_t i = slotOf(p);; i = (i + 1) & m_mask) {
+			const Slot &slot = m_slots[i];
+			if (!slot.block)
+				return nullptr;
+			if (slot.pos == p)
+				return slot.block;
+		}
+	}
+
+	void insert(v3s16 p, MapBlock *block);
+	void erase(v3s16 p);
+	void clear();
+
+	size_t size() const { return m_count; }
+
+private:
+	struct Slot {
+		v3s16 pos;
+		MapBlock *block = nullptr;
+	};
+
+	size_t slotOf(v3s16 p) const
+	{
+		u64 key = (u64)(u16)p.X | (u64)(u16)p.Y << 16 | (u64)(u16)p.Z << 32;
+		key *= 0x9E3779B97F4A7C15ULL;
+		return (key >> 32) & m_mask;
+	}
+
+	void rehash(size_t capacity);
+
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;
+};
+
 class Map /*: public NodeContainer*/
 {
 public:
@@ -162,6 +269,15 @@ class Map /*: public NodeContainer*/
 	bool addNodeWithEvent(v3s16 p, MapNode n, bool remove_metadata = true);
 	bool removeNodeWithEvent(v3s16 p);
 
+	/*
+		Sets the same node at many positions, with a single lighting update
+		and a single MEET_OTHER event. Positions in blocks that are not loaded
+		are removed from the vector.
+		Returns true if all nodes were set.
+	*/
+	virtual bool addNodesWithEvent(std::vector<v3s16> &positions, MapNode n,
+			bool remove_metadata = true);
+
 	// Call these before and after saving of many blocks
 	virtual void beginSave() {}
 	virtual void endSave() {}
@@ -185,6 +301,12 @@ class Map /*: public NodeContainer*/
 	void timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 			std::vector<v3s16> *unloaded_blocks=NULL);
 
+	// Called by the sectors when a block is inserted.
+	// Indexes the block, starts its usage timer and files it for unloading.
+	void blockInserted(MapBlock *block);
+	// Called by the sectors before a block is removed
+	void blockRemoved(MapBlock *block);
+
 	/*
 		Unloads all blocks with a zero refCount().
 		Saves modified blocks before unloading if possible.
@@ -242,6 +364,26 @@ class Map /*: public NodeContainer*/
 	// as its second. If it returns false, forEachNodeInArea returns early.
 	template<typename F>
 	void forEachNodeInArea(v3s16 minp, v3s16 maxp, F func)
+	{
+		forEachNodeInSelectedBlocks(minp, maxp, func, [] (MapBlock *) { return true; });
+	}
+
+	// Like the above, but only visits the nodes of the blocks that contain one
+	// of the given content types. Missing blocks count as CONTENT_IGNORE.
+	template<typename F>
+	void forEachNodeInArea(v3s16 minp, v3s16 maxp,
+		const std::vector<content_t> &filter, F func)
+	{
+		const bool want_ignore = CONTAINS(filter, CONTENT_IGNORE);
+		forEachNodeInSelectedBlocks(minp, maxp, func, [&] (MapBlock *block) {
+			return block ? block->containsAnyContent(filter) : want_ignore;
+		});
+	}
+
+	// Like forEachNodeInArea, but only visits the blocks for which
+	// visit_block returns true. The block is nullptr if it isn't loaded.
+	template<typename F, typename B>
+	void forEachNodeInSelectedBlocks(v3s16 minp, v3s16 maxp, F func, B visit_block)
 	{
 		v3s16 bpmin = getNodeBlockPos(minp);
 		v3s16 bpmax = getNodeBlockPos(maxp);
@@ -251,6 +393,8 @@ class Map /*: public NodeContainer*/
 			// y is iterated innermost to make use of the sector cache.
 			v3s16 bp(bx, by, bz);
 			MapBlock *block = getBlockNoCreateNoEx(bp);
+			if (!visit_block(block))
+				continue;
 			v3s16 basep = bp * MAP_BLOCKSIZE;
 			s16 minx_block = rangelim(minp.X - basep.X, 0, MAP_BLOCKSIZE - 1);
 			s16 miny_block = rangelim(minp.Y - basep.Y, 0, MAP_BLOCKSIZE - 1);
@@ -283,10 +427,19 @@ class Map /*: public NodeContainer*/
 	std::set<MapEventReceiver*> m_event_receivers;
 
 	std::unordered_map<v2s16, MapSector*> m_sectors;
+	// All blocks of the sectors by position
+	MapBlockIndex m_block_index;
+
+	// Time that the usage timers of the blocks run on, advanced by timerUpdate()
+	double m_usage_clock = 0;
+	// Positions of the blocks by the whole second they were last used in,
+	// as far as timerUpdate() knows. Blocks are only looked at again when
+	// their bucket could have expired, and filed anew if they were used.
+	std::map<s64, std::vector<v3s16>> m_unload_buckets;
 
-	// Be sure to set this to NULL when the cached sector is deleted
-	MapSector *m_sector_cache = nullptr;
-	v2s16 m_sector_cache_p;
+	// Be sure to set this to NULL when the cached sector is deleted.
+	// Atomic since the client builds its draw list in another thread.
+	std::atomic<MapSector *> m_sector_cache {nullptr};
 
 	// This stores the properties of the nodes on the map.
 	const NodeDefManager *m_nodedef;
@@ -294,6 +447,11 @@ class Map /*: public NodeContainer*/
 	// Can be implemented by child class
 	virtual void reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks) {}
 
+	// Sets the node like addNodeAndUpdate() without updating the lighting.
+	// Returns true if the lighting must be updated for oldnode.
+	bool setNodeBeforeLighting(MapBlock *block, v3s16 p, MapNode n,
+		MapNode &oldnode, bool remove_metadata);
+
 	bool determineAdditionalOcclusionCheck(v3s16 pos_camera,
 		const core::aabbox3d<s16> &block_bounds, v3s16 &to_check);
 	bool isOccluded(v3s16 pos_camera, v3s16 pos_target,
@@ -329,9 +487,11 @@ class MMVManip : public VoxelManipulator
 		to ensure that the relevant parts of m_data are initialized.
 		@param modified_blocks output array of touched blocks (optional)
 		@param overwrite_generated if false, blocks marked as generate in the map are not changed
+		@param changed_nodes output of the nodes that changed, except for lighting (optional)
 	*/
 	void blitBackAll(std::map<v3s16, MapBlock*> * modified_blocks,
-		bool overwrite_generated = true) const;
+		bool overwrite_generated = true,
+		std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes = nullptr) const;
 
 	/*
 		Creates a copy of this VManip including contents, the copy will not be
@@ -4,6 +4,7 @@
 
 #include "mapblock.h"
 
+#include <algorithm>
 #include <sstream>
 #include "map.h"
 #include "light.h"
@@ -98,6 +99,8 @@ static const char *modified_reason_strings[] = {
 	MapBlock
 */
 
+std::atomic<u64> MapBlock::s_modification_counter{0};
+
 MapBlock::MapBlock(v3s16 pos, IGameDef *gamedef):
 		m_pos(pos),
 		m_pos_relative(pos * MAP_BLOCKSIZE),
@@ -130,7 +133,7 @@ static inline size_t get_max_objects_per_block()
 bool MapBlock::onObjectsActivation()
 {
 	// Ignore if no stored objects (to not set changed flag)
-	if (m_static_objects.getAllStored().empty())
+	if (m_static_objects.getStoredSize() == 0)
 		return false;
 
 	const auto count = m_static_objects.getStoredSize();
@@ -212,18 +215,146 @@ void MapBlock::copyTo(VoxelManipulator &dst)
 	VoxelArea data_area(v3s16(0,0,0), data_size - v3s16(1,1,1));
 
 	// Copy from data to VoxelManipulator
-	dst.copyFrom(data, data_area, v3s16(0,0,0),
+	if (isUniform()) {
+		dst.fill(data_area + getPosRelative(), m_palette->getPalette()[0]);
+		return;
+	}
+	dst.copyFrom(getFlatNodes(), data_area, v3s16(0,0,0),
 			getPosRelative(), data_size);
 }
 
-void MapBlock::copyFrom(const VoxelManipulator &src)
+void MapBlock::copyTo(VoxelManipulator &dst, const VoxelArea &area)
+{
+	v3s16 data_size(MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE);
+	VoxelArea data_area(v3s16(0,0,0), data_size - v3s16(1,1,1));
+	const v3s16 pos_relative = getPosRelative();
+
+	VoxelArea copy_area = area.intersect(data_area + pos_relative);
+	if (copy_area.hasEmptyExtent())
+		return;
+
+	if (isUniform()) {
+		dst.fill(copy_area, m_palette->getPalette()[0]);
+		return;
+	}
+	dst.copyFrom(getFlatNodes(), data_area, copy_area.MinEdge - pos_relative,
+			copy_area.MinEdge, v3s16::from(copy_area.getExtent()));
+}
+
+bool MapBlock::copyFrom(const VoxelManipulator &src)
 {
 	v3s16 data_size(MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE);
 	VoxelArea data_area(v3s16(0,0,0), data_size - v3s16(1,1,1));
 
 	// Copy from VoxelManipulator to data
-	src.copyTo(data, data_area, v3s16(0,0,0),
-			getPosRelative(), data_size);
+	if (data) {
+		return src.copyTo(data, data_area, v3s16(0,0,0),
+				getPosRelative(), data_size);
+	}
+
+	// Compact blocks that stay the same are left compact
+	MapNode *nodes = getFlatNodes();
+	if (!src.copyTo(nodes, data_area, v3s16(0,0,0), getPosRelative(), data_size))
+		return false;
+	memcpy(makeFlat(false), nodes, nodecount * sizeof(MapNode));
+	return true;
+}
+
+bool MapBlock::compactIfIdle()
+{
+	if (!data)
+		return true;
+
+	// Only blocks that were left alone for a while are worth it,
+	// otherwise they are likely to be expanded again soon.
+	if (m_compact_check_counter != m_modification_counter) {
+		m_compact_check_counter = m_modification_counter;
+		m_compact_failed = false;
+		return false;
+	}
+	if (m_compact_failed)
+		return false;
+
+	auto palette = std::make_unique<NodePalette>();
+	if (!palette->pack(data, nodecount)) {
+		// don't try again until the block changes
+		m_compact_failed = true;
+		return false;
+	}
+
+	m_palette = std::move(palette);
+	delete[] data;
+	data = nullptr;
+	return true;
+}
+
+bool MapBlock::compactIfUniform()
+{
+	if (!data)
+		return isUniform();
+
+	const MapNode n = data[0];
+	for (u32 i = 1; i < nodecount; i++) {
+		if (data[i] != n)
+			return false;
+	}
+
+	m_palette = std::make_unique<NodePalette>();
+	m_palette->pack(data, nodecount);
+	delete[] data;
+	data = nullptr;
+	return true;
+}
+
+size_t MapBlock::getNodeDataMemoryUsage() const
+{
+	if (data)
+		return nodecount * sizeof(MapNode);
+	return sizeof(NodePalette) + m_palette->getMemoryUsage();
+}
+
+void MapBlock::getContents(std::vector<content_t> &dest) const
+{
+	const size_t start = dest.size();
+	if (!data) {
+		for (const MapNode &n : m_palette->getPalette())
+			dest.push_back(n.getContent());
+	} else {
+		// Runs of the same content are common
+		content_t previous_c = data[0].getContent();
+		dest.push_back(previous_c);
+		for (u32 i = 1; i < nodecount; i++) {
+			const content_t c = data[i].getContent();
+			if (c != previous_c) {
+				dest.push_back(c);
+				previous_c = c;
+			}
+		}
+	}
+	std::sort(dest.begin() + start, dest.end());
+	dest.erase(std::unique(dest.begin() + start, dest.end()), dest.end());
+}
+
+MapNode *MapBlock::makeFlat(bool keep_nodes)
+{
+	if (data)
+		return data;
+
+	data = new MapNode[nodecount];
+	if (keep_nodes)
+		m_palette->unpack(data);
+	m_palette.reset();
+	return data;
+}
+
+MapNode *MapBlock::getFlatNodes() const
+{
+	if (data)
+		return data;
+
+	thread_local std::unique_ptr<MapNode[]> decoded(new MapNode[nodecount]);
+	m_palette->unpack(decoded.get());
+	return decoded.get();
 }
 
 void MapBlock::actuallyUpdateIsAir()
@@ -231,9 +362,17 @@ void MapBlock::actuallyUpdateIsAir()
 	// Running this function un-expires m_is_air
 	m_is_air_expired = false;
 
+	// For compact blocks it suffices to look at the palette
+	const MapNode *nodes = data;
+	u32 count = nodecount;
+	if (!nodes) {
+		nodes = m_palette->getPalette().data();
+		count = m_palette->getPalette().size();
+	}
+
 	bool only_air = true;
-	for (u32 i = 0; i < nodecount; i++) {
-		MapNode &n = data[i];
+	for (u32 i = 0; i < count; i++) {
+		const MapNode &n = nodes[i];
 		if (n.getContent() != CONTENT_AIR) {
 			only_air = false;
 			break;
@@ -247,6 +386,97 @@ void MapBlock::actuallyUpdateIsAir()
 void MapBlock::expireIsAirCache()
 {
 	m_is_air_expired = true;
+	// callers modified the nodes without raiseModified()
+	m_opacity = OPACITY_UNKNOWN;
+	m_walkability = WALKABLE_UNKNOWN;
+	m_content_types_valid = false;
+}
+
+void MapBlock::actuallyUpdateOpacity(const NodeDefManager *nodedef)
+{
+	m_opacity_counter = m_modification_counter;
+
+	// For compact blocks it suffices to look at the palette
+	const MapNode *nodes = data;
+	u32 count = nodecount;
+	if (!nodes) {
+		nodes = m_palette->getPalette().data();
+		count = m_palette->getPalette().size();
+	}
+
+	bool any_opaque = false, any_transparent = false;
+	for (u32 i = 0; i < count; i++) {
+		if (nodedef->getLightingFlags(nodes[i]).light_propagates)
+			any_transparent = true;
+		else
+			any_opaque = true;
+		if (any_opaque && any_transparent)
+			break;
+	}
+
+	if (any_opaque && any_transparent)
+		m_opacity = OPACITY_MIXED;
+	else
+		m_opacity = any_opaque ? OPACITY_FULL : OPACITY_NONE;
+}
+
+void MapBlock::actuallyUpdateWalkability(const NodeDefManager *nodedef)
+{
+	m_walkability_counter = m_modification_counter;
+
+	if (!m_content_types_valid ||
+			m_content_types_counter != m_modification_counter)
+		actuallyUpdateContentTypes();
+
+	bool any_walkable = false, all_full = true;
+	for (content_t c : m_content_types) {
+		// unknown nodes collide like unloaded ones
+		if (c == CONTENT_IGNORE) {
+			any_walkable = true;
+			all_full = false;
+			continue;
+		}
+		const ContentShapeFlags f = nodedef->getShapeFlags(c);
+		if (!f.walkable) {
+			all_full = false;
+			continue;
+		}
+		any_walkable = true;
+		if (!f.full_collision_box)
+			all_full = false;
+	}
+
+	if (!any_walkable)
+		m_walkability = WALKABLE_NONE;
+	else
+		m_walkability = all_full ? WALKABLE_FULL : WALKABLE_MIXED;
+}
+
+void MapBlock::actuallyUpdateContentTypes()
+{
+	m_content_types_valid = true;
+	m_content_types_counter = m_modification_counter;
+	m_content_types.clear();
+
+	// For compact blocks it suffices to look at the palette
+	const MapNode *nodes = data;
+	u32 count = nodecount;
+	if (!nodes) {
+		nodes = m_palette->getPalette().data();
+		count = m_palette->getPalette().size();
+	}
+
+	content_t last = CONTENT_IGNORE;
+	for (u32 i = 0; i < count; i++) {
+		content_t c = nodes[i].getContent();
+		// runs of the same node are common
+		if (c == last && !m_content_types.empty())
+			continue;
+		last = c;
+		if (!CONTAINS(m_content_types, c))
+			m_content_types.push_back(c);
+	}
+	std::sort(m_content_types.begin(), m_content_types.end());
 }
 
 /*
@@ -341,7 +571,8 @@ void MapBlock::correctBlockNodeIds(const NameIdMapping *nimap, MapNode *nodes,
 	}
 }
 
-void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int compression_level)
+void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int compression_level,
+	bool compress_all)
 {
 	if (!ser_ver_supported_write(version))
 		throw VersionMismatchException("ERROR: MapBlock format not supported");
@@ -377,7 +608,10 @@ void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int
 	if(disk)
 	{
 		MapNode *tmp_nodes = new MapNode[nodecount];
-		memcpy(tmp_nodes, data, nodecount * sizeof(MapNode));
+		if (data)
+			memcpy(tmp_nodes, data, nodecount * sizeof(MapNode));
+		else
+			m_palette->unpack(tmp_nodes);
 		getBlockNodeIdMapping(&nimap, tmp_nodes, m_gamedef->ndef());
 
 		buf = MapNode::serializeBulk(version, tmp_nodes, nodecount,
@@ -393,7 +627,7 @@ void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int
 	}
 	else
 	{
-		buf = MapNode::serializeBulk(version, data, nodecount,
+		buf = MapNode::serializeBulk(version, getFlatNodes(), nodecount,
 				content_width, params_width);
 	}
 
@@ -446,7 +680,10 @@ void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int
 
 	if (version >= 29) {
 		// now compress the whole thing
-		compress(os_raw.str(), os_compressed, version, compression_level);
+		if (compress_all)
+			compress(os_raw.str(), os_compressed, version, compression_level);
+		else
+			os_compressed << os_raw.str();
 	}
 }
 
@@ -455,7 +692,8 @@ void MapBlock::serializeNetworkSpecific(std::ostream &os)
 	writeU8(os, 2); // version
 }
 
-void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk)
+void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk,
+	const ZstdDictionary *dict)
 {
 	if (!ser_ver_supported_read(version))
 		throw VersionMismatchException("ERROR: MapBlock format not supported");
@@ -463,6 +701,9 @@ void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk)
 	TRACESTREAM(<<"MapBlock::deSerialize "<<getPos()<<std::endl);
 
 	m_is_air_expired = true;
+	bumpModificationCounter();
+	// all nodes are overwritten below
+	makeFlat(false);
 
 	if(version <= 21)
 	{
@@ -473,7 +714,7 @@ void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk)
 	// Decompress the whole block (version >= 29)
 	std::stringstream in_raw(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
 	if (version >= 29)
-		decompress(in_compressed, in_raw, version);
+		decompress(in_compressed, in_raw, version, dict);
 	std::istream &is = version >= 29 ? in_raw : in_compressed;
 
 	u8 flags = readU8(is);
@@ -596,6 +837,10 @@ void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk)
 		m_is_air_expired = false;
 	}
 
+	// Blocks of a single node are common (air, deep stone, ocean water),
+	// they only get an array of nodes once something is changed
+	compactIfUniform();
+
 	TRACESTREAM(<<"MapBlock::deSerialize "<<getPos()
 			<<": Done."<<std::endl);
 }
@@ -614,6 +859,19 @@ void MapBlock::deSerializeNetworkSpecific(std::istream &is)
 	}
 }
 
+void MapBlock::takeContentsFrom(MapBlock &block)
+{
+	m_is_air_expired = true;
+	bumpModificationCounter();
+
+	std::swap(data, block.data);
+	std::swap(m_palette, block.m_palette);
+	is_underground = block.is_underground;
+	m_lighting_complete = block.m_lighting_complete;
+	m_generated = block.m_generated;
+	m_node_metadata.swap(block.m_node_metadata);
+}
+
 bool MapBlock::storeActiveObject(u16 id)
 {
 	if (m_static_objects.storeActiveObject(id)) {
@@ -4,9 +4,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include "irr_v3d.h"
 #include "mapnode.h"
+#include "nodepalette.h"
 #include "exceptions.h"
 #include "constants.h"
 #include "staticobject.h"
@@ -21,7 +25,9 @@ class NodeMetadataList;
 class IGameDef;
 class MapBlockMesh;
 class VoxelManipulator;
+class VoxelArea;
 class NameIdMapping;
+class ZstdDictionary;
 
 #define BLOCK_TIMESTAMP_UNDEFINED 0xffffffff
 
@@ -76,6 +82,7 @@ class MapBlock
 
 	void reallocate()
 	{
+		makeFlat(false);
 		for (u32 i = 0; i < nodecount; i++)
 			data[i] = MapNode(CONTENT_IGNORE);
 		raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_REALLOCATE);
@@ -86,6 +93,9 @@ class MapBlock
 	////
 	void raiseModified(u32 mod, u32 reason=MOD_REASON_UNKNOWN)
 	{
+		// the timestamp is not part of what others see of the block
+		if (reason & ~(MOD_REASON_SET_TIMESTAMP | MOD_REASON_BLOCK_EXPIRED))
+			bumpModificationCounter();
 		if (mod > m_modified) {
 			m_modified = mod;
 			m_modified_reason = reason;
@@ -116,6 +126,14 @@ class MapBlock
 		m_modified_reason = 0;
 	}
 
+	// Returns a value that changes whenever the block contents are modified.
+	// Values are never reused, not even across different blocks, so together
+	// with the position it identifies one version of a block.
+	inline u64 getModificationCounter() const
+	{
+		return m_modification_counter;
+	}
+
 	////
 	//// Flags
 	////
@@ -232,7 +250,7 @@ class MapBlock
 		if (!*valid_position)
 			return {CONTENT_IGNORE};
 
-		return data[z * zstride + y * ystride + x];
+		return getNodeAt(z * zstride + y * ystride + x);
 	}
 
 	inline MapNode getNode(v3s16 p, bool *valid_position)
@@ -251,7 +269,7 @@ class MapBlock
 		if (!isValidPosition(x, y, z))
 			throw InvalidPositionException();
 
-		data[z * zstride + y * ystride + x] = n;
+		setNodeAt(z * zstride + y * ystride + x, n);
 		raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_SET_NODE);
 	}
 
@@ -266,7 +284,7 @@ class MapBlock
 
 	inline MapNode getNodeNoCheck(s16 x, s16 y, s16 z)
 	{
-		return data[z * zstride + y * ystride + x];
+		return getNodeAt(z * zstride + y * ystride + x);
 	}
 
 	inline MapNode getNodeNoCheck(v3s16 p)
@@ -276,7 +294,7 @@ class MapBlock
 
 	inline void setNodeNoCheck(s16 x, s16 y, s16 z, MapNode n)
 	{
-		data[z * zstride + y * ystride + x] = n;
+		setNodeAt(z * zstride + y * ystride + x, n);
 		raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_SET_NODE);
 	}
 
@@ -287,9 +305,42 @@ class MapBlock
 
 	// Copies data to VoxelManipulator to getPosRelative()
 	void copyTo(VoxelManipulator &dst);
+	// Only copies the part that is inside area
+	void copyTo(VoxelManipulator &dst, const VoxelArea &area);
 
 	// Copies data from VoxelManipulator to getPosRelative()
-	void copyFrom(const VoxelManipulator &src);
+	// Returns true if any node changed.
+	bool copyFrom(const VoxelManipulator &src);
+
+	////
+	//// Compact storage (see NodePalette)
+	////
+
+	inline bool isCompact() const
+	{
+		return !data;
+	}
+
+	// Switches to palette-compressed storage if the block has not been
+	// modified since the last call and has few enough distinct nodes.
+	// Meant to be called periodically. Returns true if the block is compact.
+	bool compactIfIdle();
+
+	// Switches to compact storage if all nodes are the same.
+	// Returns true if the block is uniform.
+	bool compactIfUniform();
+
+	// True if all nodes are the same, then only that node is stored
+	inline bool isUniform() const
+	{
+		return !data && m_palette->getBitsPerNode() == 0;
+	}
+
+	// Approximate memory used for the node data
+	size_t getNodeDataMemoryUsage() const;
+
+	// Appends the distinct content types of the nodes, sorted
+	void getContents(std::vector<content_t> &dest) const;
 
 	// Update is air flag.
 	// Sets m_is_air to appropriate value.
@@ -306,6 +357,60 @@ class MapBlock
 		return m_is_air;
 	}
 
+	// Whether light (and sight) passes through the nodes of the block,
+	// recomputed lazily after the block was modified.
+	// Used to shortcut occlusion checks.
+	enum Opacity : u8 {
+		OPACITY_UNKNOWN,
+		// all nodes propagate light
+		OPACITY_NONE,
+		// no node propagates light
+		OPACITY_FULL,
+		OPACITY_MIXED,
+	};
+
+	inline Opacity getOpacity(const NodeDefManager *nodedef)
+	{
+		if (m_opacity == OPACITY_UNKNOWN ||
+				m_opacity_counter != m_modification_counter)
+			actuallyUpdateOpacity(nodedef);
+		return m_opacity;
+	}
+
+	// How the nodes of the block collide, recomputed lazily after the block
+	// was modified. Used to shortcut collision detection.
+	enum Walkability : u8 {
+		WALKABLE_UNKNOWN,
+		// no node collides
+		WALKABLE_NONE,
+		// all nodes are walkable, non-bouncy full cubes
+		WALKABLE_FULL,
+		WALKABLE_MIXED,
+	};
+
+	inline Walkability getWalkability(const NodeDefManager *nodedef)
+	{
+		if (m_walkability == WALKABLE_UNKNOWN ||
+				m_walkability_counter != m_modification_counter)
+			actuallyUpdateWalkability(nodedef);
+		return m_walkability;
+	}
+
+	// Whether any node of the block has one of the given content types,
+	// the content types are collected lazily after the block was modified.
+	// Used to skip blocks in node searches.
+	inline bool containsAnyContent(const std::vector<content_t> &filter)
+	{
+		if (!m_content_types_valid ||
+				m_content_types_counter != m_modification_counter)
+			actuallyUpdateContentTypes();
+		for (content_t c : filter) {
+			if (std::binary_search(m_content_types.begin(), m_content_types.end(), c))
+				return true;
+		}
+		return false;
+	}
+
 	bool onObjectsActivation();
 	bool saveStaticObject(u16 id, const StaticObject &obj, u32 reason);
 
@@ -346,17 +451,20 @@ class MapBlock
 
 	inline void resetUsageTimer()
 	{
-		m_usage_timer = 0;
+		if (m_usage_clock)
+			m_last_used = *m_usage_clock;
 	}
 
-	inline void incrementUsageTimer(float dtime)
+	inline float getUsageTimer() const
 	{
-		m_usage_timer += dtime;
+		return m_usage_clock ? *m_usage_clock - m_last_used : 0;
 	}
 
-	inline float getUsageTimer()
+	// Called by the map the block is inserted into, also resets the timer
+	inline void setUsageClock(const double *clock)
 	{
-		return m_usage_timer;
+		m_usage_clock = clock;
+		m_last_used = clock ? *clock : 0;
 	}
 
 	////
@@ -404,6 +512,27 @@ class MapBlock
 		m_node_timers.clear();
 	}
 
+	// Lets the queue decide when step() has to be called, see NodeTimerList
+	inline void attachNodeTimers(NodeTimerQueue *queue)
+	{
+		m_node_timers.attach(queue, getPos());
+	}
+
+	inline void detachNodeTimers()
+	{
+		m_node_timers.detach();
+	}
+
+	inline bool hasNodeTimersAttached(const NodeTimerQueue *queue) const
+	{
+		return m_node_timers.isAttached(queue);
+	}
+
+	inline bool takeScheduledNodeTimers(const NodeTimerQueue *queue, double due)
+	{
+		return m_node_timers.takeScheduled(queue, due);
+	}
+
 	////
 	//// Serialization
 	///
@@ -411,14 +540,24 @@ class MapBlock
 	// These don't write or read version by itself
 	// Set disk to true for on-disk format, false for over-the-network format
 	// Precondition: version >= SER_FMT_VER_LOWEST_WRITE
-	void serialize(std::ostream &result, u8 version, bool disk, int compression_level);
+	// With compress_all == false the final compression step of version >= 29
+	// is left out, the caller must then compress() the result itself.
+	void serialize(std::ostream &result, u8 version, bool disk, int compression_level,
+		bool compress_all = true);
 	// If disk == true: In addition to doing other things, will add
 	// unknown blocks from id-name mapping to wndef
-	void deSerialize(std::istream &is, u8 version, bool disk);
+	// dict is needed for data that was compressed with a dictionary
+	void deSerialize(std::istream &is, u8 version, bool disk,
+		const ZstdDictionary *dict = nullptr);
 
 	void serializeNetworkSpecific(std::ostream &os);
 	void deSerializeNetworkSpecific(std::istream &is);
 
+	// Replaces everything that deSerialize() reads from the network by the
+	// contents of a block that isn't part of a map, e.g. one that was
+	// deserialized on another thread. That block is left in an unspecified state.
+	void takeContentsFrom(MapBlock &block);
+
 	bool storeActiveObject(u16 id);
 	// clearObject and return removed objects count
 	u32 clearObjects();
@@ -435,6 +574,39 @@ class MapBlock
 
 	void deSerialize_pre22(std::istream &is, u8 version, bool disk);
 
+	inline MapNode getNodeAt(u32 i) const
+	{
+		if (data)
+			return data[i];
+		return m_palette->get(i);
+	}
+
+	inline void setNodeAt(u32 i, MapNode n)
+	{
+		if (data)
+			data[i] = n;
+		else if (!m_palette->set(i, n))
+			makeFlat(true)[i] = n;
+	}
+
+	// Switches to flat storage, returns the node array.
+	// If keep_nodes is false the contents are left undefined.
+	MapNode *makeFlat(bool keep_nodes);
+
+	// Returns a flat array of all nodes, which is either the node data itself
+	// or a decoded copy in a thread-local buffer.
+	MapNode *getFlatNodes() const;
+
+	inline void bumpModificationCounter()
+	{
+		m_modification_counter = s_modification_counter.fetch_add(1,
+			std::memory_order_relaxed) + 1;
+	}
+
+	void actuallyUpdateOpacity(const NodeDefManager *nodedef);
+	void actuallyUpdateWalkability(const NodeDefManager *nodedef);
+	void actuallyUpdateContentTypes();
+
 	static void getBlockNodeIdMapping(NameIdMapping *nimap, MapNode *nodes,
 		const NodeDefManager *nodedef);
 	static void correctBlockNodeIds(const NameIdMapping *nimap, MapNode *nodes,
@@ -480,19 +652,27 @@ class MapBlock
 	 * Note that this is not an inline array because that has implications for
 	 * heap fragmentation (the array is exactly 16K), CPU caches and/or
 	 * optimizability of algorithms working on this array.
+	 * nullptr if the block is compact, m_palette holds the nodes then.
 	 */
-	MapNode *const data; // of `nodecount` elements
+	MapNode *data; // of `nodecount` elements
+	std::unique_ptr<NodePalette> m_palette;
 
 	// provides the item and node definitions
 	IGameDef *m_gamedef;
 
 	/*
-		When the block is accessed, this is set to 0.
-		Map will unload the block when this reaches a timeout.
+		When the block is accessed, the usage timer is set to 0.
+		Map will unload the block when it reaches a timeout.
+		The timer is the time of the map's clock since m_last_used, so
+		that the map doesn't have to advance it for every block.
 	*/
-	float m_usage_timer = 0;
+	const double *m_usage_clock = nullptr;
+	double m_last_used = 0;
 
 public:
+	// Bucket of Map::m_unload_buckets that the block was filed in, if any
+	s64 m_unload_bucket = -1;
+
 	//// ABM optimizations ////
 	// True if we never want to cache content types for this block
 	bool do_not_cache_contents = false;
@@ -514,6 +694,22 @@ class MapBlock
 	*/
 	u16 m_modified = MOD_STATE_CLEAN;
 	u32 m_modified_reason = 0;
+	// see getModificationCounter()
+	u64 m_modification_counter = 0;
+	static std::atomic<u64> s_modification_counter;
+	// modification counter seen by the last compactIfIdle() call
+	u64 m_compact_check_counter = 0;
+	bool m_compact_failed = false;
+	// see getOpacity(), valid while m_opacity_counter is current
+	Opacity m_opacity = OPACITY_UNKNOWN;
+	u64 m_opacity_counter = 0;
+	// see getWalkability(), valid while m_walkability_counter is current
+	Walkability m_walkability = WALKABLE_UNKNOWN;
+	u64 m_walkability_counter = 0;
+	// see containsAnyContent(), sorted
+	bool m_content_types_valid = false;
+	u64 m_content_types_counter = 0;
+	std::vector<content_t> m_content_types;
 
 	/*
 		When block is removed from active blocks, this is set to gametime.
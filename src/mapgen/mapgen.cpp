@@ -4,12 +4,14 @@
 // Copyright (C) 2013-2018 kwolekr, Ryan Kwolek <kwolekr@minetest.net>
 // Copyright (C) 2015-2018 paramat
 
+#include <algorithm>
 #include <cmath>
 #include "mapgen.h"
 #include "voxel.h"
 #include "noise.h"
 #include "gamedef.h"
 #include "mg_biome.h"
+#include "mg_columncache.h"
 #include "mapblock.h"
 #include "mapnode.h"
 #include "map.h"
@@ -416,7 +418,9 @@ void Mapgen::updateLiquid(UniqueQueue<v3s16> *trans_liquid, v3s16 nmin, v3s16 nm
 
 void Mapgen::setLighting(u8 light, v3s16 nmin, v3s16 nmax)
 {
-	ScopeProfiler sp(g_profiler, "EmergeThread: update lighting", SPT_AVG);
+	static const ProfilerKey prof_key("EmergeThread: update lighting",
+		SPT_AVG, PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, prof_key);
 	VoxelArea a(nmin, nmax);
 
 	for (int z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
@@ -429,50 +433,15 @@ void Mapgen::setLighting(u8 light, v3s16 nmin, v3s16 nmax)
 }
 
 
-void Mapgen::lightSpread(VoxelArea &a, std::queue<std::pair<v3s16, u8>> &queue,
-	const v3s16 &p, u8 light)
-{
-	if (light <= 1 || !a.contains(p))
-		return;
-
-	u32 vi = vm->m_area.index(p);
-	MapNode &n = vm->m_data[vi];
-
-	// Decay light in each of the banks separately
-	u8 light_day = light & 0x0F;
-	if (light_day > 0)
-		light_day -= 0x01;
-
-	u8 light_night = light & 0xF0;
-	if (light_night > 0)
-		light_night -= 0x10;
-
-	// Bail out only if we have no more light from either bank to propogate, or
-	// we hit a solid block that light cannot pass through.
-	if ((light_day  <= (n.param1 & 0x0F) &&
-			light_night <= (n.param1 & 0xF0)) ||
-			!ndef->getLightingFlags(n).light_propagates)
-		return;
-
-	// MYMAX still needed here because we only exit early if both banks have
-	// nothing to propagate anymore.
-	light = MYMAX(light_day, n.param1 & 0x0F) |
-			MYMAX(light_night, n.param1 & 0xF0);
-
-	n.param1 = light;
-
-	// add to queue
-	queue.emplace(p, light);
-}
-
-
 void Mapgen::calcLighting(v3s16 nmin, v3s16 nmax, v3s16 full_nmin, v3s16 full_nmax,
 	bool propagate_shadow)
 {
-	ScopeProfiler sp(g_profiler, "EmergeThread: update lighting", SPT_AVG);
+	static const ProfilerKey prof_key("EmergeThread: update lighting",
+		SPT_AVG, PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, prof_key);
 
 	propagateSunlight(nmin, nmax, propagate_shadow);
-	spreadLight(full_nmin, full_nmax);
+	spreadLight(full_nmin, full_nmax, true);
 }
 
 
@@ -483,11 +452,16 @@ void Mapgen::propagateSunlight(v3s16 nmin, v3s16 nmax, bool propagate_shadow)
 	bool block_is_underground = (water_level >= nmax.Y);
 	const v3s32 &em = vm->m_area.getExtent();
 
+	m_sun_min = nmin;
+	m_sun_max = nmax;
+	m_sun_bottom.assign(a.getExtent().X * a.getExtent().Z, a.MaxEdge.Y + 1);
+	s16 *bottom = m_sun_bottom.data();
+
 	// NOTE: Direct access to the low 4 bits of param1 is okay here because,
 	// by definition, sunlight will never be in the night lightbank.
 
 	for (int z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
-		for (int x = a.MinEdge.X; x <= a.MaxEdge.X; x++) {
+		for (int x = a.MinEdge.X; x <= a.MaxEdge.X; x++, bottom++) {
 			// see if we can get a light value from the overtop
 			u32 i = vm->m_area.index(x, a.MaxEdge.Y + 1, z);
 			if (vm->m_data[i].getContent() == CONTENT_IGNORE) {
@@ -504,6 +478,7 @@ void Mapgen::propagateSunlight(v3s16 nmin, v3s16 nmax, bool propagate_shadow)
 				if (!ndef->getLightingFlags(n).sunlight_propagates)
 					break;
 				n.param1 = LIGHT_SUN;
+				*bottom = y;
 				VoxelArea::add_y(em, i, -1);
 			}
 		}
@@ -512,15 +487,56 @@ void Mapgen::propagateSunlight(v3s16 nmin, v3s16 nmax, bool propagate_shadow)
 }
 
 
-void Mapgen::spreadLight(const v3s16 &nmin, const v3s16 &nmax)
+void Mapgen::addLightSeed(v3s16 p, u8 light)
+{
+	// a light of 1 doesn't reach any further
+	u8 light_day = light & 0x0F;
+	if (light_day > 1)
+		m_light_buckets[0][light_day].push_back(p);
+
+	u8 light_night = light >> 4;
+	if (light_night > 1)
+		m_light_buckets[1][light_night].push_back(p);
+}
+
+
+void Mapgen::spreadLight(const v3s16 &nmin, const v3s16 &nmax, bool skip_sunlit)
 {
 	//TimeTaker t("spreadLight");
-	std::queue<std::pair<v3s16, u8>> queue;
 	VoxelArea a(nmin, nmax);
+	const s32 size_x = a.getExtent().X;
+
+	// A node inside a sunlit column, with sunlit columns all around it, only
+	// has sunlit neighbors and nothing to spread. That is most of the air
+	// above ground, so find where it starts in every column.
+	s16 skip_max = S16_MIN;
+	if (skip_sunlit && !m_sun_bottom.empty()) {
+		skip_max = m_sun_max.Y - 1;
+		m_sun_skip.assign(size_x * a.getExtent().Z, S16_MAX);
+
+		const s32 sun_size_x = m_sun_max.X - m_sun_min.X + 1;
+		auto bottom = [&] (s32 x, s32 z) -> s16 {
+			return m_sun_bottom[(z - m_sun_min.Z) * sun_size_x + (x - m_sun_min.X)];
+		};
+		const s32 z_max = std::min<s32>(m_sun_max.Z - 1, a.MaxEdge.Z);
+		const s32 x_max = std::min<s32>(m_sun_max.X - 1, a.MaxEdge.X);
+		for (s32 z = std::max<s32>(m_sun_min.Z + 1, a.MinEdge.Z); z <= z_max; z++)
+		for (s32 x = std::max<s32>(m_sun_min.X + 1, a.MinEdge.X); x <= x_max; x++) {
+			m_sun_skip[(z - a.MinEdge.Z) * size_x + (x - a.MinEdge.X)] =
+				std::max({(s16)(bottom(x, z) + 1), bottom(x - 1, z),
+					bottom(x + 1, z), bottom(x, z - 1), bottom(x, z + 1)});
+		}
+	}
+
+	// Light sources replace the light they had, so nodes next to them
+	// that were skipped have to spread again
+	std::vector<v3s16> sources;
 
 	for (int z = a.MinEdge.Z; z <= a.MaxEdge.Z; z++) {
 		for (int y = a.MinEdge.Y; y <= a.MaxEdge.Y; y++) {
 			u32 i = vm->m_area.index(a.MinEdge.X, y, z);
+			const s16 *skip = skip_max == S16_MIN ? nullptr :
+				&m_sun_skip[(z - a.MinEdge.Z) * size_x];
 			for (int x = a.MinEdge.X; x <= a.MaxEdge.X; x++, i++) {
 				MapNode &n = vm->m_data[i];
 				if (n.getContent() == CONTENT_IGNORE)
@@ -534,26 +550,62 @@ void Mapgen::spreadLight(const v3s16 &nmin, const v3s16 &nmax)
 				// wrapper, but something lighter than MapNode::get/setLight
 
 				u8 light_produced = cf.light_source;
-				if (light_produced)
+				if (light_produced) {
 					n.param1 = light_produced | (light_produced << 4);
-
-				u8 light = n.param1;
-				if (light) {
-					const v3s16 p(x, y, z);
-					// spread to all 6 neighbor nodes
-					for (const auto &dir : g_6dirs)
-						lightSpread(a, queue, p + dir, light);
+					sources.emplace_back(x, y, z);
+				} else if (skip && y <= skip_max && y >= skip[x - a.MinEdge.X] &&
+						n.param1 == LIGHT_SUN) {
+					continue;
 				}
+
+				if (n.param1)
+					addLightSeed(v3s16(x, y, z), n.param1);
 			}
 		}
 	}
 
-	while (!queue.empty()) {
-		const auto &i = queue.front();
-		// spread to all 6 neighbor nodes
-		for (const auto &dir : g_6dirs)
-			lightSpread(a, queue, i.first + dir, i.second);
-		queue.pop();
+	for (v3s16 p : sources) {
+		for (const auto &dir : g_6dirs) {
+			const v3s16 p2 = p + dir;
+			if (!a.contains(p2))
+				continue;
+			const MapNode &n = vm->m_data[vm->m_area.index(p2)];
+			if (n.getContent() != CONTENT_IGNORE &&
+					ndef->getLightingFlags(n).light_propagates)
+				addLightSeed(p2, n.param1);
+		}
+	}
+
+	// Each bank on its own, brightest first. A node only ever gets light
+	// from a brighter one, so it has its final light the first time it is
+	// reached and the levels are done one after the other.
+	for (int bank = 0; bank < 2; bank++) {
+		const int shift = bank * 4;
+		for (u8 light = LIGHT_SUN; light > 1; light--) {
+			std::vector<v3s16> &bucket = m_light_buckets[bank][light];
+			const u8 light_next = light - 1;
+			for (size_t k = 0; k < bucket.size(); k++) {
+				const v3s16 p = bucket[k];
+				// got brighter since, and spread that already
+				if (((vm->m_data[vm->m_area.index(p)].param1 >> shift) & 0x0F) != light)
+					continue;
+
+				// spread to all 6 neighbor nodes
+				for (const auto &dir : g_6dirs) {
+					const v3s16 p2 = p + dir;
+					if (!a.contains(p2))
+						continue;
+					MapNode &n = vm->m_data[vm->m_area.index(p2)];
+					if (((n.param1 >> shift) & 0x0F) >= light_next ||
+							!ndef->getLightingFlags(n).light_propagates)
+						continue;
+					n.param1 = (n.param1 & ~(0x0F << shift)) | (light_next << shift);
+					if (light_next > 1)
+						m_light_buckets[bank][light_next].push_back(p2);
+				}
+			}
+			bucket.clear();
+		}
 	}
 
 	//printf("spreadLight: %lums\n", t.stop());
@@ -632,7 +684,15 @@ void MapgenBasic::generateBiomes()
 	const v3s32 &em = vm->m_area.getExtent();
 	u32 index = 0;
 
-	noise_filler_depth->noiseMap2D(node_min.X, node_min.Z);
+	MapgenColumnCache *column_cache = m_emerge->column_cache;
+	const v2s16 column(node_min.X, node_min.Z);
+	const std::vector<float *> maps = {noise_filler_depth->result};
+	if (!column_cache || !column_cache->get(COLUMN_FILLER_DEPTH, column,
+			maps, csize.X * csize.Z)) {
+		noise_filler_depth->noiseMap2D(node_min.X, node_min.Z);
+		if (column_cache)
+			column_cache->put(COLUMN_FILLER_DEPTH, column, maps, csize.X * csize.Z);
+	}
 
 	for (s16 z = node_min.Z; z <= node_max.Z; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index++) {
@@ -223,8 +223,11 @@ class Mapgen {
 	 * Artificial light is taken from nodedef, sunlight must already be set.
 	 * @param nmin Area to operate on
 	 * @param nmax ^
+	 * @param skip_sunlit Don't spread from inside the columns lit by the last
+	 *        propagateSunlight() call, the VManip must not have changed since
 	 */
-	void spreadLight(const v3s16 &nmin, const v3s16 &nmax);
+	void spreadLight(const v3s16 &nmin, const v3s16 &nmax,
+		bool skip_sunlit = false);
 
 	virtual void makeChunk(BlockMakeData *data) {}
 	virtual int getGroundLevelAtPoint(v2s16 p) { return 0; }
@@ -247,16 +250,22 @@ class Mapgen {
 
 private:
 	/**
-	 * Spread light to the node at the given position, add to queue if changed.
-	 * The given light value is diminished once.
-	 * @param a VoxelArea being operated on
-	 * @param queue Queue for later lightSpread() calls
+	 * Queues a node to spread its light from, for each bank that has some.
 	 * @param p Node position
 	 * @param light Light value (contains both banks)
-	 *
 	 */
-	void lightSpread(VoxelArea &a, std::queue<std::pair<v3s16, u8>> &queue,
-		const v3s16 &p, u8 light);
+	void addLightSeed(v3s16 p, u8 light);
+
+	// Area of the last propagateSunlight() call and the lowest y reached
+	// by sunlight in each of its columns
+	v3s16 m_sun_min, m_sun_max;
+	std::vector<s16> m_sun_bottom;
+	// Per column of the spreadLight() area, where nodes start to be
+	// surrounded by sunlight
+	std::vector<s16> m_sun_skip;
+	// Nodes to spread light from, by bank (day, night) and light level.
+	// Kept so that they don't have to be allocated again for every chunk.
+	std::vector<v3s16> m_light_buckets[2][LIGHT_SUN + 1];
 
 	// isLiquidHorizontallyFlowable() is a helper function for updateLiquid()
 	// that checks whether there are floodable nodes without liquid beneath
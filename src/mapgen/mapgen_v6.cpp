@@ -22,6 +22,7 @@
 #include "treegen.h"
 #include "mg_ore.h"
 #include "mg_decoration.h"
+#include "mg_columncache.h"
 #include "mapgen_v6.h"
 
 
@@ -632,20 +633,44 @@ void MapgenV6::calculateNoise()
 	int fx = full_node_min.X;
 	int fz = full_node_min.Z;
 
+	// All of these are the same for the whole column of chunks
+	MapgenColumnCache *column_cache = m_emerge->column_cache;
+
+	std::vector<float *> maps = {noise_beach->result};
 	if (!(spflags & MGV6_FLAT)) {
-		noise_terrain_base->noiseMap2D_PO(x, 0.5, z, 0.5);
-		noise_terrain_higher->noiseMap2D_PO(x, 0.5, z, 0.5);
-		noise_steepness->noiseMap2D_PO(x, 0.5, z, 0.5);
-		noise_height_select->noiseMap2D_PO(x, 0.5, z, 0.5);
-		noise_mud->noiseMap2D_PO(x, 0.5, z, 0.5);
+		maps.insert(maps.end(), {noise_terrain_base->result,
+			noise_terrain_higher->result, noise_steepness->result,
+			noise_height_select->result, noise_mud->result});
 	}
+	const u32 map_size = csize.X * csize.Z;
+	if (!column_cache || !column_cache->get(COLUMN_TERRAIN, v2s16(x, z),
+			maps, map_size)) {
+		if (!(spflags & MGV6_FLAT)) {
+			noise_terrain_base->noiseMap2D_PO(x, 0.5, z, 0.5);
+			noise_terrain_higher->noiseMap2D_PO(x, 0.5, z, 0.5);
+			noise_steepness->noiseMap2D_PO(x, 0.5, z, 0.5);
+			noise_height_select->noiseMap2D_PO(x, 0.5, z, 0.5);
+			noise_mud->noiseMap2D_PO(x, 0.5, z, 0.5);
+		}
 
-	noise_beach->noiseMap2D_PO(x, 0.2, z, 0.7);
+		noise_beach->noiseMap2D_PO(x, 0.2, z, 0.7);
 
-	noise_biome->noiseMap2D_PO(fx, 0.6, fz, 0.2);
-	noise_humidity->noiseMap2D_PO(fx, 0.0, fz, 0.0);
-	// Humidity map does not need range limiting 0 to 1,
-	// only humidity at point does
+		if (column_cache)
+			column_cache->put(COLUMN_TERRAIN, v2s16(x, z), maps, map_size);
+	}
+
+	maps = {noise_biome->result, noise_humidity->result};
+	const u32 full_map_size = (csize.X + 2 * MAP_BLOCKSIZE) * (csize.Z + 2 * MAP_BLOCKSIZE);
+	if (!column_cache || !column_cache->get(COLUMN_BIOME, v2s16(fx, fz),
+			maps, full_map_size)) {
+		noise_biome->noiseMap2D_PO(fx, 0.6, fz, 0.2);
+		noise_humidity->noiseMap2D_PO(fx, 0.0, fz, 0.0);
+		// Humidity map does not need range limiting 0 to 1,
+		// only humidity at point does
+
+		if (column_cache)
+			column_cache->put(COLUMN_BIOME, v2s16(fx, fz), maps, full_map_size);
+	}
 }
 
 
@@ -19,6 +19,7 @@
 #include "dungeongen.h"
 #include "cavegen.h"
 #include "mg_biome.h"
+#include "mg_columncache.h"
 #include "mg_ore.h"
 #include "mg_decoration.h"
 #include "mapgen_v7.h"
@@ -472,17 +473,31 @@ int MapgenV7::generateTerrain()
 	MapNode n_water(c_water_source);
 
 	//// Calculate noise for terrain generation
-	noise_terrain_persist->noiseMap2D(node_min.X, node_min.Z);
+	// The 2D noises are the same for the whole column of chunks
+	MapgenColumnCache *column_cache = m_emerge->column_cache;
+	const v2s16 column(node_min.X, node_min.Z);
+	const u32 map_size = csize.X * csize.Z;
 	float *persistmap = noise_terrain_persist->result;
 
-	noise_terrain_base->noiseMap2D(node_min.X, node_min.Z, persistmap);
-	noise_terrain_alt->noiseMap2D(node_min.X, node_min.Z, persistmap);
-	noise_height_select->noiseMap2D(node_min.X, node_min.Z);
+	std::vector<float *> maps = {persistmap, noise_terrain_base->result,
+		noise_terrain_alt->result, noise_height_select->result};
+	if (spflags & MGV7_MOUNTAINS)
+		maps.push_back(noise_mount_height->result);
+
+	if (!column_cache || !column_cache->get(COLUMN_TERRAIN, column, maps, map_size)) {
+		noise_terrain_persist->noiseMap2D(node_min.X, node_min.Z);
+		noise_terrain_base->noiseMap2D(node_min.X, node_min.Z, persistmap);
+		noise_terrain_alt->noiseMap2D(node_min.X, node_min.Z, persistmap);
+		noise_height_select->noiseMap2D(node_min.X, node_min.Z);
+		if (spflags & MGV7_MOUNTAINS)
+			noise_mount_height->noiseMap2D(node_min.X, node_min.Z);
+
+		if (column_cache)
+			column_cache->put(COLUMN_TERRAIN, column, maps, map_size);
+	}
 
-	if (spflags & MGV7_MOUNTAINS) {
-		noise_mount_height->noiseMap2D(node_min.X, node_min.Z);
+	if (spflags & MGV7_MOUNTAINS)
 		noise_mountain->noiseMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-	}
 
 	//// Floatlands
 	// 'Generate floatlands in this mapchunk' bool for
@@ -519,7 +534,14 @@ int MapgenV7::generateTerrain()
 		!gen_floatlands;
 	if (gen_rivers) {
 		noise_ridge->noiseMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-		noise_ridge_uwater->noiseMap2D(node_min.X, node_min.Z);
+
+		maps = {noise_ridge_uwater->result};
+		if (!column_cache ||
+				!column_cache->get(COLUMN_TERRAIN_EXTRA, column, maps, map_size)) {
+			noise_ridge_uwater->noiseMap2D(node_min.X, node_min.Z);
+			if (column_cache)
+				column_cache->put(COLUMN_TERRAIN_EXTRA, column, maps, map_size);
+		}
 	}
 
 	//// Place nodes
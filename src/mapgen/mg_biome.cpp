@@ -5,6 +5,7 @@
 
 #include "mg_biome.h"
 #include "mg_decoration.h"
+#include "mg_columncache.h"
 #include "emerge.h"
 #include "server.h"
 #include "nodedef.h"
@@ -139,6 +140,8 @@ BiomeGenOriginal::BiomeGenOriginal(BiomeManager *biomemgr,
 	values.erase(std::unique(values.begin(), values.end()), values.end());
 
 	m_transitions_y = std::move(values);
+
+	buildBiomeBands();
 }
 
 BiomeGenOriginal::~BiomeGenOriginal()
@@ -185,6 +188,12 @@ void BiomeGenOriginal::calcBiomeNoise(v3s16 pmin)
 {
 	m_pmin = pmin;
 
+	const v2s16 column(pmin.X, pmin.Z);
+	const u32 map_size = m_csize.X * m_csize.Z;
+	if (column_cache && column_cache->get(COLUMN_BIOME, column,
+			{noise_heat->result, noise_humidity->result}, map_size))
+		return;
+
 	noise_heat->noiseMap2D(pmin.X, pmin.Z);
 	noise_humidity->noiseMap2D(pmin.X, pmin.Z);
 	noise_heat_blend->noiseMap2D(pmin.X, pmin.Z);
@@ -194,6 +203,10 @@ void BiomeGenOriginal::calcBiomeNoise(v3s16 pmin)
 		noise_heat->result[i]     += noise_heat_blend->result[i];
 		noise_humidity->result[i] += noise_humidity_blend->result[i];
 	}
+
+	if (column_cache)
+		column_cache->put(COLUMN_BIOME, column,
+			{noise_heat->result, noise_humidity->result}, map_size);
 }
 
 
@@ -231,27 +244,220 @@ Biome *BiomeGenOriginal::getBiomeAtIndex(size_t index, v3s16 pos) const
 }
 
 
+static inline float biome_dist(const Biome *b, float heat, float humidity)
+{
+	float d_heat = heat - b->heat_point;
+	float d_humidity = humidity - b->humidity_point;
+	float dist = ((d_heat * d_heat) + (d_humidity * d_humidity));
+	if (b->weight > 0.f)
+	       dist /= b->weight;
+	return dist;
+}
+
+
+// Smallest and largest distance of p to a point in [lo, hi]
+static inline void interval_dist(double p, double lo, double hi,
+	double &d_min, double &d_max)
+{
+	d_min = p < lo ? lo - p : (p > hi ? p - hi : 0.0);
+	d_max = std::max(std::fabs(lo - p), std::fabs(hi - p));
+}
+
+
+void BiomeGenOriginal::buildBiomeBands()
+{
+	const size_t count = m_bmgr->getNumObjects();
+	m_biomes.assign(count, nullptr);
+	m_check_xz.assign(count, false);
+
+	std::vector<int> band_starts = {S16_MIN};
+	float point_min[2] = {FLT_MAX, FLT_MAX};
+	float point_max[2] = {-FLT_MAX, -FLT_MAX};
+	for (size_t i = 1; i < count; i++) {
+		Biome *b = (Biome *)m_bmgr->getRaw(i);
+		if (!b)
+			continue;
+		m_biomes[i] = b;
+		m_check_xz[i] =
+			b->min_pos.X > -MAX_MAP_GENERATION_LIMIT || b->max_pos.X < MAX_MAP_GENERATION_LIMIT ||
+			b->min_pos.Z > -MAX_MAP_GENERATION_LIMIT || b->max_pos.Z < MAX_MAP_GENERATION_LIMIT;
+
+		band_starts.push_back(b->min_pos.Y);
+		band_starts.push_back(b->max_pos.Y + 1);
+		band_starts.push_back(b->max_pos.Y + b->vertical_blend + 1);
+
+		point_min[0] = std::min(point_min[0], b->heat_point);
+		point_max[0] = std::max(point_max[0], b->heat_point);
+		point_min[1] = std::min(point_min[1], b->humidity_point);
+		point_max[1] = std::max(point_max[1], b->humidity_point);
+	}
+
+	std::sort(band_starts.begin(), band_starts.end());
+	band_starts.erase(std::unique(band_starts.begin(), band_starts.end()),
+		band_starts.end());
+	while (band_starts.back() > S16_MAX)
+		band_starts.pop_back();
+
+	// The inner cells cover the biome points with some room around them,
+	// the outer ones reach to infinity.
+	double cell_lo[2][GRID_SIZE], cell_hi[2][GRID_SIZE];
+	for (int axis = 0; axis < 2; axis++) {
+		if (point_min[axis] > point_max[axis]) {
+			point_min[axis] = 0.0f;
+			point_max[axis] = 100.0f;
+		}
+		float pad = (point_max[axis] - point_min[axis]) / 2.0f + 1.0f;
+		float lo = point_min[axis] - pad;
+		float hi = point_max[axis] + pad;
+		m_grid_min[axis] = lo;
+		m_grid_inv_step[axis] = (GRID_SIZE - 2) / (hi - lo);
+
+		// a bit larger than the cells, so rounding in getGridCell() doesn't matter
+		double step = 1.0 / m_grid_inv_step[axis];
+		for (int i = 0; i < GRID_SIZE; i++) {
+			cell_lo[axis][i] = (i == 0) ? -INFINITY : lo + (i - 1.01) * step;
+			cell_hi[axis][i] = (i == GRID_SIZE - 1) ? INFINITY : lo + (i + 0.01) * step;
+		}
+	}
+
+	// Adds the biomes of the list that may be the nearest one in the cell.
+	// A biome only needs to be kept if it can be closer than the farthest
+	// distance some other biome that is always there has.
+	auto add_cell = [&] (const std::vector<u16> &list, int hc, int uc) {
+		double d_min[2], d_max[2];
+		double bound = INFINITY;
+		for (u16 i : list) {
+			if (m_check_xz[i])
+				continue;
+			const Biome *b = m_biomes[i];
+			interval_dist(b->heat_point, cell_lo[0][hc], cell_hi[0][hc], d_min[0], d_max[0]);
+			interval_dist(b->humidity_point, cell_lo[1][uc], cell_hi[1][uc], d_min[1], d_max[1]);
+			double upper = (d_max[0] * d_max[0] + d_max[1] * d_max[1]) /
+				(b->weight > 0.f ? b->weight : 1.0);
+			// leave room for float rounding
+			upper = upper * (1.0 + 1e-5) + 1e-6;
+			if (upper < FLT_MAX / 2)
+				bound = std::min(bound, upper);
+		}
+
+		for (u16 i : list) {
+			const Biome *b = m_biomes[i];
+			interval_dist(b->heat_point, cell_lo[0][hc], cell_hi[0][hc], d_min[0], d_max[0]);
+			interval_dist(b->humidity_point, cell_lo[1][uc], cell_hi[1][uc], d_min[1], d_max[1]);
+			double lower = (d_min[0] * d_min[0] + d_min[1] * d_min[1]) /
+				(b->weight > 0.f ? b->weight : 1.0);
+			if (lower * (1.0 - 1e-5) <= bound)
+				m_band_biomes.push_back(i);
+		}
+	};
+
+	m_bands.clear();
+	m_band_biomes.clear();
+	std::vector<u16> within, blend;
+	for (int y : band_starts) {
+		within.clear();
+		blend.clear();
+		for (size_t i = 1; i < count; i++) {
+			const Biome *b = m_biomes[i];
+			if (!b || y < b->min_pos.Y || y > b->max_pos.Y + b->vertical_blend)
+				continue;
+			if (y <= b->max_pos.Y)
+				within.push_back(i);
+			else
+				blend.push_back(i);
+		}
+
+		BiomeBand &band = m_bands.emplace_back();
+		band.y_min = y;
+		band.cells.reserve(2 * GRID_SIZE * GRID_SIZE + 1);
+		for (int hc = 0; hc < GRID_SIZE; hc++)
+		for (int uc = 0; uc < GRID_SIZE; uc++) {
+			band.cells.push_back(m_band_biomes.size());
+			add_cell(within, hc, uc);
+			band.cells.push_back(m_band_biomes.size());
+			add_cell(blend, hc, uc);
+		}
+		band.cells.push_back(m_band_biomes.size());
+	}
+}
+
+
+size_t BiomeGenOriginal::getGridCell(float heat, float humidity) const
+{
+	const float values[2] = {heat, humidity};
+	size_t cell[2];
+	for (int axis = 0; axis < 2; axis++) {
+		float f = (values[axis] - m_grid_min[axis]) * m_grid_inv_step[axis];
+		if (!(f >= 0.0f))
+			cell[axis] = 0;
+		else if (f >= GRID_SIZE - 2)
+			cell[axis] = GRID_SIZE - 1;
+		else
+			cell[axis] = 1 + (size_t)f;
+	}
+	return cell[0] * GRID_SIZE + cell[1];
+}
+
+
 Biome *BiomeGenOriginal::calcBiomeFromNoise(float heat, float humidity, v3s16 pos) const
 {
+	// The lookup structure assumes that biomes unlimited in X and Z apply everywhere
+	if (pos.X < -MAX_MAP_GENERATION_LIMIT || pos.X > MAX_MAP_GENERATION_LIMIT ||
+			pos.Z < -MAX_MAP_GENERATION_LIMIT || pos.Z > MAX_MAP_GENERATION_LIMIT)
+		return calcBiomeFromNoiseLinear(heat, humidity, pos);
+
+	// last band that begins at or below pos.Y, the first one begins at S16_MIN
+	auto band_it = std::upper_bound(m_bands.begin(), m_bands.end(), pos.Y,
+		[] (s16 y, const BiomeBand &band) {
+			return y < band.y_min;
+		});
+	const u32 *cell = &(band_it - 1)->cells[2 * getGridCell(heat, humidity)];
+
 	Biome *biome_closest = nullptr;
 	Biome *biome_closest_blend = nullptr;
 	float dist_min = FLT_MAX;
 	float dist_min_blend = FLT_MAX;
 
-	for (size_t i = 1; i < m_bmgr->getNumObjects(); i++) {
-		Biome *b = (Biome *)m_bmgr->getRaw(i);
+	for (int part = 0; part < 2; part++) {
+		Biome *&closest = part == 0 ? biome_closest : biome_closest_blend;
+		float &closest_dist = part == 0 ? dist_min : dist_min_blend;
+		for (u32 j = cell[part]; j != cell[part + 1]; j++) {
+			u16 i = m_band_biomes[j];
+			Biome *b = m_biomes[i];
+			if (m_check_xz[i] && (
+					pos.X < b->min_pos.X || pos.X > b->max_pos.X ||
+					pos.Z < b->min_pos.Z || pos.Z > b->max_pos.Z))
+				continue;
+
+			float dist = biome_dist(b, heat, humidity);
+			if (dist < closest_dist) {
+				closest_dist = dist;
+				closest = b;
+			}
+		}
+	}
+
+	return selectBiome(biome_closest, dist_min, biome_closest_blend,
+		dist_min_blend, heat, humidity, pos);
+}
+
+
+Biome *BiomeGenOriginal::calcBiomeFromNoiseLinear(float heat, float humidity, v3s16 pos) const
+{
+	Biome *biome_closest = nullptr;
+	Biome *biome_closest_blend = nullptr;
+	float dist_min = FLT_MAX;
+	float dist_min_blend = FLT_MAX;
+
+	for (size_t i = 1; i < m_biomes.size(); i++) {
+		Biome *b = m_biomes[i];
 		if (!b ||
 				pos.Y < b->min_pos.Y || pos.Y > b->max_pos.Y + b->vertical_blend ||
 				pos.X < b->min_pos.X || pos.X > b->max_pos.X ||
 				pos.Z < b->min_pos.Z || pos.Z > b->max_pos.Z)
 			continue;
 
-		float d_heat = heat - b->heat_point;
-		float d_humidity = humidity - b->humidity_point;
-		float dist = ((d_heat * d_heat) + (d_humidity * d_humidity));
-		if (b->weight > 0.f)
-		       dist /= b->weight;
-
+		float dist = biome_dist(b, heat, humidity);
 		if (pos.Y <= b->max_pos.Y) { // Within y limits of biome b
 			if (dist < dist_min) {
 				dist_min = dist;
@@ -263,6 +469,15 @@ Biome *BiomeGenOriginal::calcBiomeFromNoise(float heat, float humidity, v3s16 po
 		}
 	}
 
+	return selectBiome(biome_closest, dist_min, biome_closest_blend,
+		dist_min_blend, heat, humidity, pos);
+}
+
+
+Biome *BiomeGenOriginal::selectBiome(Biome *biome_closest, float dist_min,
+	Biome *biome_closest_blend, float dist_min_blend,
+	float heat, float humidity, v3s16 pos) const
+{
 	// Carefully tune pseudorandom seed variation to avoid single node dither
 	// and create larger scale blending patterns similar to horizontal biome
 	// blend.
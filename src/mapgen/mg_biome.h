@@ -13,6 +13,7 @@
 class Server;
 class Settings;
 class BiomeManager;
+class MapgenColumnCache;
 
 ////
 //// Biome
@@ -130,6 +131,9 @@ class BiomeGen {
 	// Result of calcBiomes bulk computation.
 	biome_t *biomemap = nullptr;
 
+	// Shared cache for the biome noises of a chunk column, may be nullptr
+	MapgenColumnCache *column_cache = nullptr;
+
 protected:
 	BiomeManager *m_bmgr = nullptr;
 	v3s16 m_pmin;
@@ -201,6 +205,41 @@ class BiomeGenOriginal final : public BiomeGen {
 	/// Y values at which biomes may transition.
 	/// This array may only be used for downwards scanning!
 	std::vector<s16> m_transitions_y;
+
+	/*
+		Lookup structure for calcBiomeFromNoise(). The Y axis is split into
+		bands in which the same biomes apply, and the heat/humidity plane
+		into a grid. Each cell of a band lists the biomes that can be the
+		nearest one somewhere in the cell, in biome order, so that the result
+		is the same as when searching all biomes.
+	*/
+	static constexpr int GRID_SIZE = 10;
+
+	struct BiomeBand {
+		// The band ends where the next one begins
+		s16 y_min;
+		// For every cell: start of its biomes within their Y limits, start
+		// of the ones in their blend area, end (= start of the next cell)
+		std::vector<u32> cells;
+	};
+
+	void buildBiomeBands();
+	size_t getGridCell(float heat, float humidity) const;
+	Biome *calcBiomeFromNoiseLinear(float heat, float humidity, v3s16 pos) const;
+	Biome *selectBiome(Biome *biome_closest, float dist_min,
+		Biome *biome_closest_blend, float dist_min_blend,
+		float heat, float humidity, v3s16 pos) const;
+
+	// indexed like the biome manager, nullptr for BIOME_NONE
+	std::vector<Biome *> m_biomes;
+	// the biome may be limited in X or Z within the generation limit
+	std::vector<bool> m_check_xz;
+	std::vector<BiomeBand> m_bands;
+	// biome indices
+	std::vector<u16> m_band_biomes;
+	// lower edge of the inner cells and the inverse of their size
+	float m_grid_min[2];
+	float m_grid_inv_step[2];
 };
 
 
@@ -0,0 +1,81 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "mg_columncache.h"
+#include <cstring>
+#include <functional>
+#include "profiler.h"
+
+MapgenColumnCache::MapgenColumnCache(size_t max_bytes) :
+	m_max_bytes(max_bytes)
+{
+}
+
+size_t MapgenColumnCache::KeyHash::operator()(const Key &key) const
+{
+	u64 h = ((u64)(u16)key.column.X << 48) | ((u64)(u16)key.column.Y << 32) |
+		((u64)key.kind << 24) | ((u64)key.num_maps << 16);
+	return std::hash<u64>()(h ^ key.map_size);
+}
+
+bool MapgenColumnCache::get(ColumnNoiseKind kind, v2s16 column,
+	const std::vector<float *> &maps, u32 map_size)
+{
+	const Key key{column, map_size, (u8)maps.size(), kind};
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it == m_entries.end()) {
+		g_profiler->avg("Mapgen: column cache hit ratio", 0.0f);
+		return false;
+	}
+
+	const float *src = it->second.data.data();
+	for (float *map : maps) {
+		memcpy(map, src, map_size * sizeof(float));
+		src += map_size;
+	}
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+	g_profiler->avg("Mapgen: column cache hit ratio", 1.0f);
+	return true;
+}
+
+void MapgenColumnCache::put(ColumnNoiseKind kind, v2s16 column,
+	const std::vector<float *> &maps, u32 map_size)
+{
+	const Key key{column, map_size, (u8)maps.size(), kind};
+	const size_t bytes = maps.size() * map_size * sizeof(float);
+	if (bytes > m_max_bytes)
+		return;
+
+	std::vector<float> data;
+	data.reserve(maps.size() * map_size);
+	for (const float *map : maps)
+		data.insert(data.end(), map, map + map_size);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it != m_entries.end()) {
+		// another thread generated the same column meanwhile
+		m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+		return;
+	}
+
+	while (m_bytes + bytes > m_max_bytes && !m_lru.empty()) {
+		auto old = m_entries.find(m_lru.back());
+		m_bytes -= old->second.data.size() * sizeof(float);
+		m_entries.erase(old);
+		m_lru.pop_back();
+	}
+
+	m_lru.push_front(key);
+	m_entries[key] = {std::move(data), m_lru.begin()};
+	m_bytes += bytes;
+}
+
+size_t MapgenColumnCache::getCachedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bytes;
+}
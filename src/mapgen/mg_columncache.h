@@ -0,0 +1,79 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v2d.h"
+
+enum ColumnNoiseKind : u8 {
+	// 2D terrain noises of the mapgen
+	COLUMN_TERRAIN,
+	// noises only needed by some chunks of the column
+	COLUMN_TERRAIN_EXTRA,
+	COLUMN_FILLER_DEPTH,
+	// heat and humidity of the biome generator
+	COLUMN_BIOME,
+};
+
+/*
+	Keeps 2D noise maps of recently generated mapchunk columns, so that the
+	chunks above and below don't have to calculate them again.
+
+	It is shared by all emerge threads. Entries are identified by the
+	position of the chunk column, the kind of maps and their size. Only
+	results that depend on nothing but the X and Z position may be cached,
+	heightmaps and biome maps depend on the chunk itself.
+
+	The least recently used columns are dropped once more than max_bytes are
+	cached.
+*/
+class MapgenColumnCache {
+public:
+	MapgenColumnCache(size_t max_bytes);
+
+	// Copies the cached maps, false if they are not cached
+	bool get(ColumnNoiseKind kind, v2s16 column,
+		const std::vector<float *> &maps, u32 map_size);
+
+	void put(ColumnNoiseKind kind, v2s16 column,
+		const std::vector<float *> &maps, u32 map_size);
+
+	size_t getCachedBytes();
+
+private:
+	struct Key {
+		v2s16 column;
+		u32 map_size;
+		u8 num_maps;
+		ColumnNoiseKind kind;
+
+		bool operator==(const Key &other) const
+		{
+			return column == other.column && map_size == other.map_size &&
+				num_maps == other.num_maps && kind == other.kind;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry {
+		std::vector<float> data;
+		std::list<Key>::iterator lru_it;
+	};
+
+	const size_t m_max_bytes;
+
+	std::mutex m_mutex;
+	std::unordered_map<Key, Entry, KeyHash> m_entries;
+	// most recently used first
+	std::list<Key> m_lru;
+	size_t m_bytes = 0;
+};
@@ -39,12 +39,36 @@ DecorationManager::DecorationManager(IGameDef *gamedef) :
 void DecorationManager::placeAllDecos(Mapgen *mg, u32 blockseed,
 	v3s16 nmin, v3s16 nmax)
 {
+	// Biomes that occur in this area. Decorations for none of them would
+	// not find a single column, so they are skipped right away. Every
+	// decoration has its own random numbers, the others are not affected.
+	std::vector<bool> area_biomes;
+	if (mg->biomemap) {
+		const u32 ncolumns = (nmax.X - nmin.X + 1) * (nmax.Z - nmin.Z + 1);
+		for (u32 i = 0; i != ncolumns; i++) {
+			biome_t biome = mg->biomemap[i];
+			if (biome >= area_biomes.size())
+				area_biomes.resize(biome + 1);
+			area_biomes[biome] = true;
+		}
+	}
+	auto in_area = [&] (const Decoration *deco) {
+		if (!mg->biomemap || deco->biomes.empty())
+			return true;
+		for (biome_t biome : deco->biomes) {
+			if (biome < area_biomes.size() && area_biomes[biome])
+				return true;
+		}
+		return false;
+	};
+
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Decoration *deco = (Decoration *)m_objects[i];
 		if (!deco)
 			continue;
 
-		deco->placeDeco(mg, blockseed, nmin, nmax);
+		if (in_area(deco))
+			deco->placeDeco(mg, blockseed, nmin, nmax);
 		blockseed++;
 	}
 }
@@ -140,6 +164,10 @@ void Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 
 	int area = sidelen * sidelen;
 
+	// surfaces of a column, reused for every all-surfaces decoration placed
+	std::vector<s16> floors;
+	std::vector<s16> ceilings;
+
 	for (s16 z0 = 0; z0 < carea_size; z0 += sidelen)
 	for (s16 x0 = 0; x0 < carea_size; x0 += sidelen) {
 		v2s16 p2d_min(nmin.X + x0, nmin.Z + z0);
@@ -195,12 +223,8 @@ void Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 				}
 
 				// Get all floors and ceilings in node column
-				u16 size = (nmax.Y - nmin.Y + 1) / 2;
-				std::vector<s16> floors;
-				std::vector<s16> ceilings;
-				floors.reserve(size);
-				ceilings.reserve(size);
-
+				floors.clear();
+				ceilings.clear();
 				mg->getSurfaces(v2s16(x, z), nmin.Y, nmax.Y, floors, ceilings);
 
 				if (flags & DECO_ALL_FLOORS) {
@@ -34,6 +34,8 @@ size_t OreManager::placeAllOres(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nma
 {
 	size_t nplaced = 0;
 
+	updateWhereinTable();
+
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Ore *ore = (Ore *)m_objects[i];
 		if (!ore)
@@ -47,6 +49,50 @@ size_t OreManager::placeAllOres(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nma
 }
 
 
+void OreManager::updateWhereinTable()
+{
+	if (m_wherein_num_ores == m_objects.size())
+		return;
+	m_wherein_num_ores = m_objects.size();
+
+	// Ores with the same wherein nodes share a bit, so with few enough
+	// distinct sets each node placed over is a single lookup.
+	std::vector<std::vector<content_t>> sets;
+	std::vector<Ore *> ores;
+	content_t c_max = 0;
+	for (ObjDef *object : m_objects) {
+		Ore *ore = (Ore *)object;
+		if (!ore)
+			continue;
+		ore->wherein_lut = nullptr;
+		std::vector<content_t> set = ore->c_wherein;
+		std::sort(set.begin(), set.end());
+		set.erase(std::unique(set.begin(), set.end()), set.end());
+
+		auto it = std::find(sets.begin(), sets.end(), set);
+		if (it == sets.end()) {
+			if (sets.size() == 32)
+				continue; // falls back to searching c_wherein
+			it = sets.insert(sets.end(), std::move(set));
+			if (!it->empty())
+				c_max = std::max(c_max, it->back());
+		}
+		ore->wherein_bit = 1U << (it - sets.begin());
+		ores.push_back(ore);
+	}
+
+	m_wherein_lut.assign(sets.empty() ? 0 : (size_t)c_max + 1, 0);
+	for (size_t i = 0; i != sets.size(); i++) {
+		for (content_t c : sets[i])
+			m_wherein_lut[c] |= 1U << i;
+	}
+	for (Ore *ore : ores) {
+		ore->wherein_lut = m_wherein_lut.data();
+		ore->wherein_lut_size = m_wherein_lut.size();
+	}
+}
+
+
 void OreManager::clear()
 {
 	for (ObjDef *object : m_objects) {
@@ -54,6 +100,8 @@ void OreManager::clear()
 		delete ore;
 	}
 	m_objects.clear();
+	m_wherein_lut.clear();
+	m_wherein_num_ores = 0;
 }
 
 
@@ -167,7 +215,7 @@ void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
 				continue;
 
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			vm->m_data[i] = n_ore;
@@ -236,7 +284,7 @@ void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			vm->m_data[i] = n_ore;
@@ -330,7 +378,7 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			vm->m_data[i] = n_ore;
@@ -386,7 +434,7 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		for (u32 y1 = 0; y1 != csize; y1++)
 		for (u32 x1 = 0; x1 != csize; x1++, index++) {
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			// Lazily generate noise only if there's a chance of ore being placed
@@ -465,7 +513,7 @@ void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		u32 i = vm->m_area.index(x, y, z);
 		if (!vm->m_area.contains(i))
 			continue;
-		if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+		if (!isWherein(vm->m_data[i].getContent()))
 			continue;
 
 		if (biomemap && !biomes.empty()) {
@@ -576,7 +624,7 @@ void OreStratum::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			vm->m_data[i] = n_ore;
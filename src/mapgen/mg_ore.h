@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <unordered_set>
 #include "objdef.h"
 #include "noise.h"
@@ -53,11 +54,24 @@ class Ore : public ObjDef, public NodeResolver {
 	Noise *noise = nullptr;
 	std::unordered_set<biome_t> biomes;
 
+	// Set by OreManager: bit of this ore's wherein set in a table shared by
+	// all ores, indexed by content id.
+	const u32 *wherein_lut = nullptr;
+	size_t wherein_lut_size = 0;
+	u32 wherein_bit = 0;
+
 	explicit Ore(bool needs_noise): needs_noise(needs_noise) {}
 	virtual ~Ore();
 
 	virtual void resolveNodeNames();
 
+	inline bool isWherein(content_t c) const
+	{
+		if (!wherein_lut)
+			return CONTAINS(c_wherein, c);
+		return c < wherein_lut_size && (wherein_lut[c] & wherein_bit);
+	}
+
 	size_t placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
 	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, biome_t *biomemap) = 0;
@@ -182,4 +196,11 @@ class OreManager : public ObjDefManager {
 
 private:
 	OreManager() {};
+
+	// Builds the wherein table if ores have been added since.
+	void updateWhereinTable();
+
+	// For every content id, one bit for each distinct wherein set it is in
+	std::vector<u32> m_wherein_lut;
+	size_t m_wherein_num_ores = 0;
 };
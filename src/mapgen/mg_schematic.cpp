@@ -17,6 +17,7 @@
 #include "filesys.h"
 #include "voxelalgorithms.h"
 #include "porting.h"
+#include "threading/mutex_auto_lock.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -61,6 +62,9 @@ void SchematicManager::clear()
 ///////////////////////////////////////////////////////////////////////////////
 
 
+Schematic::Schematic() = default;
+
+
 Schematic::~Schematic()
 {
 	delete []schemdata;
@@ -91,6 +95,8 @@ ObjDef *Schematic::clone() const
 
 void Schematic::resolveNodeNames()
 {
+	clearCompiled();
+
 	c_nodes.clear();
 	getIdsFromNrBacklog(&c_nodes, true, CONTENT_AIR);
 
@@ -108,10 +114,45 @@ void Schematic::resolveNodeNames()
 }
 
 
-void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+/*
+	A schematic prepared for placement with one rotation: the nodes are in
+	placement order, rotated and with param1 cleared. Every row is split
+	into runs of nodes that are placed by the same rules, so that most of
+	the schematic can be copied as is.
+*/
+struct CompiledSchematic {
+	enum RunType : u8 {
+		// probability 255 and force placed: always copied
+		RUN_FORCE,
+		// probability 255: copied over air and ignore, or if force_place
+		RUN_ALWAYS,
+		// anything else, decided per node
+		RUN_PROB,
+	};
+
+	struct Run {
+		s16 x;
+		s16 length;
+		RunType type;
+	};
+
+	// rotated size
+	s16 sx, sy, sz;
+	std::vector<MapNode> nodes;
+	// original param1 of the nodes, for RUN_PROB
+	std::vector<u8> param1s;
+	std::vector<Run> runs;
+	// the runs of row y * sz + z are runs[row_runs[row]] to runs[row_runs[row + 1]]
+	std::vector<u32> row_runs;
+};
+
+
+const CompiledSchematic *Schematic::getCompiled(Rotation rot)
 {
-	assert(schemdata && slice_probs);
-	sanity_check(m_ndef != NULL);
+	MutexAutoLock lock(m_compiled_mutex);
+	std::unique_ptr<CompiledSchematic> &cs = m_compiled[rot];
+	if (cs)
+		return cs.get();
 
 	int xstride = 1;
 	int ystride = size.X;
@@ -146,44 +187,138 @@ void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_pla
 			i_step_z = zstride;
 	}
 
+	cs = std::make_unique<CompiledSchematic>();
+	cs->sx = sx;
+	cs->sy = sy;
+	cs->sz = sz;
+	size_t nodecount = (size_t)sx * sy * sz;
+	cs->nodes.reserve(nodecount);
+	cs->param1s.reserve(nodecount);
+	cs->row_runs.reserve((size_t)sy * sz + 1);
+
+	for (s16 y = 0; y != sy; y++)
+	for (s16 z = 0; z != sz; z++) {
+		cs->row_runs.push_back(cs->runs.size());
+		bool in_run = false;
+
+		u32 i = z * i_step_z + y * ystride + i_start;
+		for (s16 x = 0; x != sx; x++, i += i_step_x) {
+			MapNode n = schemdata[i];
+			u8 placement_prob = n.param1 & MTSCHEM_PROB_MASK;
+			bool force_place_node = n.param1 & MTSCHEM_FORCE_PLACE;
+
+			cs->param1s.push_back(n.param1);
+			n.param1 = 0;
+			if (rot)
+				n.rotateAlongYAxis(m_ndef, rot);
+			cs->nodes.push_back(n);
+
+			if (n.getContent() == CONTENT_IGNORE ||
+					placement_prob == MTSCHEM_PROB_NEVER) {
+				in_run = false;
+				continue;
+			}
+
+			CompiledSchematic::RunType type = CompiledSchematic::RUN_PROB;
+			if (placement_prob == MTSCHEM_PROB_ALWAYS)
+				type = force_place_node ? CompiledSchematic::RUN_FORCE :
+					CompiledSchematic::RUN_ALWAYS;
+
+			if (in_run && cs->runs.back().type == type) {
+				cs->runs.back().length++;
+			} else {
+				cs->runs.push_back({x, 1, type});
+				in_run = true;
+			}
+		}
+	}
+	cs->row_runs.push_back(cs->runs.size());
+
+	return cs.get();
+}
+
+
+void Schematic::clearCompiled()
+{
+	MutexAutoLock lock(m_compiled_mutex);
+	for (auto &cs : m_compiled)
+		cs.reset();
+}
+
+
+void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+{
+	assert(schemdata && slice_probs);
+	sanity_check(m_ndef != NULL);
+
+	const CompiledSchematic *cs = getCompiled(rot);
+	const VoxelArea &area = vm->m_area;
+
+	// part of the rows that is inside the vmanip
+	const int x_begin = std::max(0, area.MinEdge.X - p.X);
+	const int x_end = std::min<int>(cs->sx, area.MaxEdge.X - p.X + 1);
+
 	s16 y_map = p.Y;
-	for (s16 y = 0; y != sy; y++) {
+	for (s16 y = 0; y != cs->sy; y++) {
 		if ((slice_probs[y] != MTSCHEM_PROB_ALWAYS) &&
 			(slice_probs[y] <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
 			continue;
 
-		for (s16 z = 0; z != sz; z++) {
-			u32 i = z * i_step_z + y * ystride + i_start;
-			for (s16 x = 0; x != sx; x++, i += i_step_x) {
-				v3s16 pos(p.X + x, y_map, p.Z + z);
-				if (!vm->m_area.contains(pos))
-					continue;
-
-				if (schemdata[i].getContent() == CONTENT_IGNORE)
-					continue;
-
-				u8 placement_prob     = schemdata[i].param1 & MTSCHEM_PROB_MASK;
-				bool force_place_node = schemdata[i].param1 & MTSCHEM_FORCE_PLACE;
+		if (x_begin >= x_end || y_map < area.MinEdge.Y || y_map > area.MaxEdge.Y) {
+			y_map++;
+			continue;
+		}
 
-				if (placement_prob == MTSCHEM_PROB_NEVER)
+		for (s16 z = 0; z != cs->sz; z++) {
+			s16 z_map = p.Z + z;
+			if (z_map < area.MinEdge.Z || z_map > area.MaxEdge.Z)
+				continue;
+
+			u32 row = y * cs->sz + z;
+			size_t row_i = (size_t)row * cs->sx;
+			for (u32 r = cs->row_runs[row]; r != cs->row_runs[row + 1]; r++) {
+				const CompiledSchematic::Run &run = cs->runs[r];
+				int x0 = std::max<int>(run.x, x_begin);
+				int x1 = std::min<int>(run.x + run.length, x_end);
+				if (x0 >= x1)
 					continue;
 
-				u32 vi = vm->m_area.index(pos);
-				if (!force_place && !force_place_node) {
-					content_t c = vm->m_data[vi].getContent();
-					if (c != CONTENT_AIR && c != CONTENT_IGNORE)
-						continue;
+				MapNode *dst = &vm->m_data[area.index(p.X + x0, y_map, z_map)];
+				const MapNode *src = &cs->nodes[row_i + x0];
+				const int count = x1 - x0;
+
+				switch (run.type) {
+				case CompiledSchematic::RUN_ALWAYS:
+					if (!force_place) {
+						for (int k = 0; k != count; k++) {
+							content_t c = dst[k].getContent();
+							if (c == CONTENT_AIR || c == CONTENT_IGNORE)
+								dst[k] = src[k];
+						}
+						break;
+					}
+					[[fallthrough]];
+				case CompiledSchematic::RUN_FORCE:
+					memcpy(dst, src, count * sizeof(MapNode));
+					break;
+				case CompiledSchematic::RUN_PROB: {
+					const u8 *param1 = &cs->param1s[row_i + x0];
+					for (int k = 0; k != count; k++) {
+						if (!force_place && !(param1[k] & MTSCHEM_FORCE_PLACE)) {
+							content_t c = dst[k].getContent();
+							if (c != CONTENT_AIR && c != CONTENT_IGNORE)
+								continue;
+						}
+
+						u8 placement_prob = param1[k] & MTSCHEM_PROB_MASK;
+						if (placement_prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS))
+							continue;
+
+						dst[k] = src[k];
+					}
+					break;
+				}
 				}
-
-				if ((placement_prob != MTSCHEM_PROB_ALWAYS) &&
-					(placement_prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
-					continue;
-
-				vm->m_data[vi] = schemdata[i];
-				vm->m_data[vi].param1 = 0;
-
-				if (rot)
-					vm->m_data[vi].rotateAlongYAxis(m_ndef, rot);
 			}
 		}
 		y_map++;
@@ -267,6 +402,8 @@ void Schematic::placeOnMap(ServerMap *map, v3s16 p, u32 flags,
 
 bool Schematic::deserializeFromMts(std::istream *is)
 {
+	clearCompiled();
+
 	std::istream &ss = *is;
 	content_t cignore = CONTENT_IGNORE;
 	bool have_cignore = false;
@@ -531,6 +668,8 @@ bool Schematic::saveSchematicToFile(const std::string &filename,
 
 bool Schematic::getSchematicFromMap(Map *map, v3s16 p1, v3s16 p2)
 {
+	clearCompiled();
+
 	MMVManip *vm = new MMVManip(map);
 
 	v3s16 bp1 = getNodeBlockPos(p1);
@@ -568,6 +707,8 @@ void Schematic::applyProbabilities(v3s16 p0,
 	std::vector<std::pair<v3s16, u8> > *plist,
 	std::vector<std::pair<s16, u8> > *splist)
 {
+	clearCompiled();
+
 	for (size_t i = 0; i != plist->size(); i++) {
 		v3s16 p = (*plist)[i].first - p0;
 		int index = p.Z * (size.Y * size.X) + p.Y * size.X + p.X;
@@ -591,6 +732,8 @@ void Schematic::applyProbabilities(v3s16 p0,
 
 void Schematic::condenseContentIds()
 {
+	clearCompiled();
+
 	std::unordered_map<content_t, content_t> nodeidmap;
 	content_t numids = 0;
 
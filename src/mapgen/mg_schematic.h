@@ -6,6 +6,8 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include "mg_decoration.h"
 #include "util/string.h"
 
@@ -76,9 +78,11 @@ enum SchematicFormatType {
 	SCHEM_FMT_LUA,
 };
 
+struct CompiledSchematic;
+
 class Schematic : public ObjDef, public NodeResolver {
 public:
-	Schematic() = default;
+	Schematic();
 	virtual ~Schematic();
 
 	ObjDef *clone() const;
@@ -112,6 +116,17 @@ class Schematic : public ObjDef, public NodeResolver {
 private:
 	// Counterpart to the node resolver: Condense content_t to a sequential "m_nodenames" list
 	void condenseContentIds();
+
+	/*
+		blitToVManip() works on a copy of schemdata that is compiled for the
+		rotation on first use. It must be dropped whenever schemdata changes
+		after that.
+	*/
+	const CompiledSchematic *getCompiled(Rotation rot);
+	void clearCompiled();
+
+	std::mutex m_compiled_mutex;
+	std::unique_ptr<CompiledSchematic> m_compiled[4];
 };
 
 class SchematicManager : public ObjDefManager {
@@ -5,10 +5,13 @@
 // Copyright (C) 2015-2018 paramat
 
 #include <stack>
+#include <string_view>
+#include <unordered_map>
 #include "treegen.h"
 #include "irr_v3d.h"
 #include "util/pointer.h"
 #include "util/numeric.h"
+#include "threading/mutex_auto_lock.h"
 #include "servermap.h"
 #include "mapblock.h"
 #include "noise.h"
@@ -132,16 +135,47 @@ void make_tree(MMVManip &vmanip, v3s16 p0, bool is_apple_tree,
 treegen::error spawn_ltree(ServerMap *map, v3s16 p0,
 	const TreeDef &tree_definition)
 {
-	MMVManip vmanip(map);
-	v3s16 tree_blockp = getNodeBlockPos(p0);
+	return spawn_ltrees(map, {p0}, tree_definition);
+}
+
+
+treegen::error spawn_ltrees(ServerMap *map, const std::vector<v3s16> &positions,
+	const TreeDef &tree_definition)
+{
+	// Trees are placed in the given order, several at a time into one VManip
+	// as long as the blocks they need stay within a bounded area.
+	constexpr s32 MAX_BATCH_BLOCKS = 8 * 8 * 8;
 
-	vmanip.initialEmerge(tree_blockp - v3s16(1, 1, 1), tree_blockp + v3s16(1, 3, 1));
-	treegen::error e = make_ltree(vmanip, p0, tree_definition);
-	if (e != SUCCESS)
-		return e;
+	if (positions.empty())
+		return SUCCESS;
 
 	std::map<v3s16, MapBlock*> modified_blocks;
-	voxalgo::blit_back_with_light(map, &vmanip, &modified_blocks);
+	size_t i = 0;
+	while (i < positions.size()) {
+		v3s16 bpmin = getNodeBlockPos(positions[i]) - v3s16(1, 1, 1);
+		v3s16 bpmax = getNodeBlockPos(positions[i]) + v3s16(1, 3, 1);
+		size_t end = i + 1;
+		for (; end < positions.size(); end++) {
+			v3s16 tree_blockp = getNodeBlockPos(positions[end]);
+			v3s16 new_min = componentwise_min(bpmin, tree_blockp - v3s16(1, 1, 1));
+			v3s16 new_max = componentwise_max(bpmax, tree_blockp + v3s16(1, 3, 1));
+			v3s32 extent = v3s32::from(new_max - new_min) + v3s32(1, 1, 1);
+			if (extent.X * extent.Y * extent.Z > MAX_BATCH_BLOCKS)
+				break;
+			bpmin = new_min;
+			bpmax = new_max;
+		}
+
+		MMVManip vmanip(map);
+		vmanip.initialEmerge(bpmin, bpmax);
+		for (; i < end; i++) {
+			treegen::error e = make_ltree(vmanip, positions[i], tree_definition);
+			if (e != SUCCESS)
+				return e;
+		}
+
+		voxalgo::blit_back_with_light(map, &vmanip, &modified_blocks);
+	}
 
 	// Send a MEET_OTHER event
 	MapEditEvent event;
@@ -152,15 +186,44 @@ treegen::error spawn_ltree(ServerMap *map, v3s16 p0,
 }
 
 
-treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
-	const TreeDef &tree_definition)
+/*
+	Expanded axioms are kept per definition and iteration count, as long as
+	the rules don't use random symbols: only then they are the same for
+	every tree. Symbols that neither draw nor turn are left out.
+*/
+static std::mutex s_ltree_programs_mutex;
+static std::unordered_map<std::string, std::shared_ptr<const std::string>> s_ltree_programs;
+constexpr size_t MAX_LTREE_PROGRAMS = 64;
+
+static bool has_random_rules(const TreeDef &tree_definition)
 {
-	s32 seed;
-	if (tree_definition.explicit_seed)
-		seed = tree_definition.seed + 14002;
-	else
-		seed = p0.X * 2 + p0.Y * 4 + p0.Z;  // use the tree position to seed PRNG
-	PseudoRandom ps(seed);
+	for (const std::string *str : {&tree_definition.initial_axiom,
+			&tree_definition.rules_a, &tree_definition.rules_b,
+			&tree_definition.rules_c, &tree_definition.rules_d}) {
+		if (str->find_first_of("abcd") != std::string::npos)
+			return true;
+	}
+	return false;
+}
+
+static std::shared_ptr<const std::string> get_ltree_program(
+	const TreeDef &tree_definition, s16 iterations, PseudoRandom &ps)
+{
+	const bool cacheable = !has_random_rules(tree_definition);
+	std::string key;
+	if (cacheable) {
+		key = std::to_string(iterations);
+		for (const std::string *str : {&tree_definition.initial_axiom,
+				&tree_definition.rules_a, &tree_definition.rules_b,
+				&tree_definition.rules_c, &tree_definition.rules_d}) {
+			key.push_back('\0');
+			key.append(*str);
+		}
+		MutexAutoLock lock(s_ltree_programs_mutex);
+		auto it = s_ltree_programs.find(key);
+		if (it != s_ltree_programs.end())
+			return it->second;
+	}
 
 	// chance of inserting abcd rules
 	constexpr float prop_a = 9;
@@ -168,27 +231,6 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 	constexpr float prop_c = 7;
 	constexpr float prop_d = 6;
 
-	//randomize tree growth level, minimum=2
-	s16 iterations = tree_definition.iterations;
-	if (tree_definition.iterations_random_level > 0)
-		iterations -= ps.range(0, tree_definition.iterations_random_level);
-	if (iterations < 2)
-		iterations = 2;
-
-	constexpr s16 MAX_ANGLE_OFFSET = 5;
-	float angle_in_radians = tree_definition.angle * M_PI / 180;
-	float angleOffset_in_radians = (s16)(ps.range(0, 1) % MAX_ANGLE_OFFSET) * M_PI / 180;
-
-	//initialize rotation matrix, position and stacks for branches
-	core::matrix4 rotation;
-	setRotationAxisRadians(rotation, M_PI / 2, v3f(0, 0, 1));
-	v3f position;
-	position.X = p0.X;
-	position.Y = p0.Y;
-	position.Z = p0.Z;
-	std::stack <core::matrix4> stack_orientation;
-	std::stack <v3f> stack_position;
-
 	//generate axiom
 	std::string axiom = tree_definition.initial_axiom;
 	for (s16 i = 0; i < iterations; i++) {
@@ -232,8 +274,75 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 		axiom = temp;
 	}
 
+	// The axiom has always been drawn up to a length that fits into s16
+	constexpr std::string_view drawn_symbols = "GTFfR[]+-&^*/";
+	s16 length = std::max<s16>((s16)axiom.size(), 0);
+	std::string ops;
+	for (s16 i = 0; i < length; i++) {
+		if (drawn_symbols.find(axiom[i]) != std::string_view::npos)
+			ops.push_back(axiom[i]);
+	}
+
+	auto program = std::make_shared<const std::string>(std::move(ops));
+	if (cacheable) {
+		MutexAutoLock lock(s_ltree_programs_mutex);
+		if (s_ltree_programs.size() >= MAX_LTREE_PROGRAMS)
+			s_ltree_programs.clear();
+		s_ltree_programs.emplace(std::move(key), program);
+	}
+	return program;
+}
+
+
+treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
+	const TreeDef &tree_definition)
+{
+	s32 seed;
+	if (tree_definition.explicit_seed)
+		seed = tree_definition.seed + 14002;
+	else
+		seed = p0.X * 2 + p0.Y * 4 + p0.Z;  // use the tree position to seed PRNG
+	PseudoRandom ps(seed);
+
+	//randomize tree growth level, minimum=2
+	s16 iterations = tree_definition.iterations;
+	if (tree_definition.iterations_random_level > 0)
+		iterations -= ps.range(0, tree_definition.iterations_random_level);
+	if (iterations < 2)
+		iterations = 2;
+
+	constexpr s16 MAX_ANGLE_OFFSET = 5;
+	float angle_in_radians = tree_definition.angle * M_PI / 180;
+	float angleOffset_in_radians = (s16)(ps.range(0, 1) % MAX_ANGLE_OFFSET) * M_PI / 180;
+
+	//initialize rotation matrix, position and stacks for branches
+	core::matrix4 rotation;
+	setRotationAxisRadians(rotation, M_PI / 2, v3f(0, 0, 1));
+	v3f position;
+	position.X = p0.X;
+	position.Y = p0.Y;
+	position.Z = p0.Z;
+	std::stack <core::matrix4> stack_orientation;
+	std::stack <v3f> stack_position;
+
+	std::shared_ptr<const std::string> program =
+		get_ltree_program(tree_definition, iterations, ps);
+
+	const bool trunk_double = trunk_double;
+	const bool trunk_crossed = trunk_crossed;
+
+	// Turns by the angle, in the order of "+-&^*/"
+	core::matrix4 turns[6];
+	const float turn_angle = angle_in_radians + angleOffset_in_radians;
+	setRotationAxisRadians(turns[0], turn_angle, v3f(0, 0, 1));
+	setRotationAxisRadians(turns[1], turn_angle, v3f(0, 0, -1));
+	setRotationAxisRadians(turns[2], turn_angle, v3f(0, 1, 0));
+	setRotationAxisRadians(turns[3], turn_angle, v3f(0, -1, 0));
+	setRotationAxisRadians(turns[4], angle_in_radians, v3f(1, 0, 0));
+	setRotationAxisRadians(turns[5], angle_in_radians, v3f(-1, 0, 0));
+
 	// Add trunk nodes below a wide trunk to avoid gaps when tree is on sloping ground
-	if (tree_definition.trunk_type == "double") {
+	if (trunk_double) {
 		tree_trunk_placement(
 			vmanip,
 			v3f(position.X + 1, position.Y - 1, position.Z),
@@ -249,7 +358,7 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 			v3f(position.X + 1, position.Y - 1, position.Z + 1),
 			tree_definition
 		);
-	} else if (tree_definition.trunk_type == "crossed") {
+	} else if (trunk_crossed) {
 		tree_trunk_placement(
 			vmanip,
 			v3f(position.X + 1, position.Y - 1, position.Z),
@@ -301,10 +410,7 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 	 */
 
 	s16 x,y,z;
-	for (s16 i = 0; i < (s16)axiom.size(); i++) {
-		char axiom_char = axiom.at(i);
-		core::matrix4 temp_rotation;
-		temp_rotation.makeIdentity();
+	for (char axiom_char : *program) {
 		v3f dir;
 		switch (axiom_char) {
 		case 'G':
@@ -318,7 +424,7 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 				v3f(position.X, position.Y, position.Z),
 				tree_definition
 			);
-			if (tree_definition.trunk_type == "double" &&
+			if (trunk_double &&
 					!tree_definition.thin_branches) {
 				tree_trunk_placement(
 					vmanip,
@@ -335,7 +441,7 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 					v3f(position.X + 1, position.Y, position.Z + 1),
 					tree_definition
 				);
-			} else if (tree_definition.trunk_type == "crossed" &&
+			} else if (trunk_crossed &&
 					!tree_definition.thin_branches) {
 				tree_trunk_placement(
 					vmanip,
@@ -369,9 +475,9 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 				tree_definition
 			);
 			if ((stack_orientation.empty() &&
-					tree_definition.trunk_type == "double") ||
+					trunk_double) ||
 					(!stack_orientation.empty() &&
-					tree_definition.trunk_type == "double" &&
+					trunk_double &&
 					!tree_definition.thin_branches)) {
 				tree_trunk_placement(
 					vmanip,
@@ -389,9 +495,9 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 					tree_definition
 				);
 			} else if ((stack_orientation.empty() &&
-					tree_definition.trunk_type == "crossed") ||
+					trunk_crossed) ||
 					(!stack_orientation.empty() &&
-					tree_definition.trunk_type == "crossed" &&
+					trunk_crossed &&
 					!tree_definition.thin_branches)) {
 				tree_trunk_placement(
 					vmanip,
@@ -491,40 +597,22 @@ treegen::error make_ltree(MMVManip &vmanip, v3s16 p0,
 			stack_position.pop();
 			break;
 		case '+':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians + angleOffset_in_radians, v3f(0, 0, 1));
-			rotation *= temp_rotation;
+			rotation *= turns[0];
 			break;
 		case '-':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians + angleOffset_in_radians, v3f(0, 0, -1));
-			rotation *= temp_rotation;
+			rotation *= turns[1];
 			break;
 		case '&':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians + angleOffset_in_radians, v3f(0, 1, 0));
-			rotation *= temp_rotation;
+			rotation *= turns[2];
 			break;
 		case '^':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians + angleOffset_in_radians, v3f(0, -1, 0));
-			rotation *= temp_rotation;
+			rotation *= turns[3];
 			break;
 		case '*':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians, v3f(1, 0, 0));
-			rotation *= temp_rotation;
+			rotation *= turns[4];
 			break;
 		case '/':
-			temp_rotation.makeIdentity();
-			setRotationAxisRadians(temp_rotation,
-					angle_in_radians, v3f(-1, 0, 0));
-			rotation *= temp_rotation;
+			rotation *= turns[5];
 			break;
 		default:
 			break;
@@ -566,11 +654,11 @@ void tree_leaves_placement(MMVManip &vmanip, v3f p0,
 		return;
 	if (tree_definition.fruit_chance > 0) {
 		if (ps.range(1, 100) > 100 - tree_definition.fruit_chance)
-			vmanip.m_data[vmanip.m_area.index(p1)] = tree_definition.fruitnode;
+			vmanip.m_data[vi] = tree_definition.fruitnode;
 		else
-			vmanip.m_data[vmanip.m_area.index(p1)] = leavesnode;
+			vmanip.m_data[vi] = leavesnode;
 	} else if (ps.range(1, 100) > 20) {
-		vmanip.m_data[vmanip.m_area.index(p1)] = leavesnode;
+		vmanip.m_data[vi] = leavesnode;
 	}
 }
 
@@ -588,7 +676,7 @@ void tree_single_leaves_placement(MMVManip &vmanip, v3f p0,
 	if (vmanip.m_data[vi].getContent() != CONTENT_AIR
 			&& vmanip.m_data[vi].getContent() != CONTENT_IGNORE)
 		return;
-	vmanip.m_data[vmanip.m_area.index(p1)] = leavesnode;
+	vmanip.m_data[vi] = leavesnode;
 }
 
 
@@ -601,7 +689,7 @@ void tree_fruit_placement(MMVManip &vmanip, v3f p0, const TreeDef &tree_definiti
 	if (vmanip.m_data[vi].getContent() != CONTENT_AIR
 			&& vmanip.m_data[vi].getContent() != CONTENT_IGNORE)
 		return;
-	vmanip.m_data[vmanip.m_area.index(p1)] = tree_definition.fruitnode;
+	vmanip.m_data[vi] = tree_definition.fruitnode;
 }
 
 
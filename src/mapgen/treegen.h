@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "irr_v3d.h"
 #include "nodedef.h"
 #include "mapnode.h"
@@ -68,6 +69,9 @@ namespace treegen {
 	treegen::error make_ltree(MMVManip &vmanip, v3s16 p0, const TreeDef &def);
 	// Helper to spawn it directly on map
 	treegen::error spawn_ltree(ServerMap *map, v3s16 p0, const TreeDef &def);
+	// Spawns several trees on map, updating it once for trees close together
+	treegen::error spawn_ltrees(ServerMap *map, const std::vector<v3s16> &positions,
+		const TreeDef &def);
 
 	// Helper to get a string from the error message
 	std::string error_to_string(error e);
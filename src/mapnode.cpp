@@ -403,9 +403,8 @@ u8 MapNode::getNeighbors(v3s16 p, Map *map) const
 {
 	const NodeDefManager *nodedef = map->getNodeDefManager();
 	u8 neighbors = 0;
-	const ContentFeatures &f = nodedef->get(*this);
 	// locate possible neighboring nodes to connect to
-	if (f.drawtype == NDT_NODEBOX && f.node_box.type == NODEBOX_CONNECTED) {
+	if (nodedef->getShapeFlags(*this).connected) {
 		v3s16 p2 = p;
 
 		p2.Y++;
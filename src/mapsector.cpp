@@ -4,6 +4,7 @@
 
 #include "mapsector.h"
 #include "exceptions.h"
+#include "map.h"
 #include "mapblock.h"
 #include "serialization.h"
 
@@ -24,6 +25,11 @@ void MapSector::deleteBlocks()
 	// Clear cache
 	m_block_cache = nullptr;
 
+	if (m_parent) {
+		for (auto &it : m_blocks)
+			m_parent->blockRemoved(it.second.get());
+	}
+
 	// Delete all blocks
 	m_blocks.clear();
 }
@@ -70,6 +76,8 @@ MapBlock *MapSector::createBlankBlock(s16 y)
 	MapBlock *block = block_u.get();
 
 	m_blocks[y] = std::move(block_u);
+	if (m_parent)
+		m_parent->blockInserted(block);
 
 	return block;
 }
@@ -87,7 +95,10 @@ void MapSector::insertBlock(std::unique_ptr<MapBlock> block)
 	assert(p2d == m_pos);
 
 	// Insert into container
+	MapBlock *block_p = block.get();
 	m_blocks[block_y] = std::move(block);
+	if (m_parent)
+		m_parent->blockInserted(block_p);
 }
 
 void MapSector::deleteBlock(MapBlock *block)
@@ -109,9 +120,13 @@ std::unique_ptr<MapBlock> MapSector::detachBlock(MapBlock *block)
 	std::unique_ptr<MapBlock> ret = std::move(it->second);
 	assert(ret.get() == block);
 	m_blocks.erase(it);
+	if (m_parent)
+		m_parent->blockRemoved(block);
 
 	// Mark as removed
 	block->makeOrphan();
+	block->setUsageClock(nullptr);
+	block->m_unload_bucket = -1;
 
 	return ret;
 }
@@ -88,6 +88,17 @@ size_t SimpleMetadata::size() const
 	return m_stringvars.size();
 }
 
+size_t SimpleMetadata::getMemoryUsage() const
+{
+	size_t bytes = m_stringvars.bucket_count() * sizeof(void *);
+	for (const auto &it : m_stringvars) {
+		// a node holds the pair, the next pointer and the hash
+		bytes += sizeof(it) + 2 * sizeof(void *) +
+			string_heap_usage(it.first) + string_heap_usage(it.second);
+	}
+	return bytes;
+}
+
 bool SimpleMetadata::contains(const std::string &name) const
 {
 	return m_stringvars.find(name) != m_stringvars.end();
@@ -120,9 +131,13 @@ bool SimpleMetadata::setString(const std::string &name, std::string_view var)
 			return false;
 	} else {
 		StringMap::iterator it = m_stringvars.find(name);
-		if (it != m_stringvars.end() && it->second == var)
-			return false;
-		m_stringvars[name].assign(var);
+		if (it == m_stringvars.end()) {
+			m_stringvars.emplace(name, var);
+		} else {
+			if (it->second == var)
+				return false;
+			it->second.assign(var);
+		}
 	}
 	m_modified = true;
 	return true;
@@ -73,6 +73,8 @@ class SimpleMetadata: public virtual IMetadata
 	//
 
 	size_t size() const;
+	// Approximate heap memory of the key-value pairs
+	size_t getMemoryUsage() const;
 	bool contains(const std::string &name) const override;
 	virtual bool setString(const std::string &name, std::string_view var) override;
 	const StringMap &getStrings(StringMap *) const override final;
@@ -0,0 +1,543 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "navigation_cache.h"
+#include "log.h"
+#include "map.h"
+#include "mapblock.h"
+#include "nodedef.h"
+#include "voxel.h"
+#include <algorithm>
+#include <array>
+#include <queue>
+
+namespace {
+
+constexpr u32 CELL_COUNT = MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE;
+constexpr s8 NO_MOVE = -128;
+constexpr u32 UNREACHED = U32_MAX;
+
+// About 20 KB each
+constexpr size_t MAX_CLUSTERS = 1024;
+// Shorter paths are left to the node-level pathfinder
+constexpr int MIN_DISTANCE = 2 * MAP_BLOCKSIZE;
+// Same as in the node-level pathfinder
+constexpr size_t MAX_WAYPOINTS = 700;
+
+const v3s16 move_dirs[4] = {
+	v3s16(1, 0, 0),
+	v3s16(-1, 0, 0),
+	v3s16(0, 0, 1),
+	v3s16(0, 0, -1),
+};
+
+inline u16 cell_index(v3s16 rel)
+{
+	return (rel.Z * MAP_BLOCKSIZE + rel.Y) * MAP_BLOCKSIZE + rel.X;
+}
+
+inline v3s16 cell_pos(u16 i)
+{
+	return v3s16(i % MAP_BLOCKSIZE, i / MAP_BLOCKSIZE % MAP_BLOCKSIZE,
+		i / (MAP_BLOCKSIZE * MAP_BLOCKSIZE));
+}
+
+inline bool is_inside_block(v3s16 rel)
+{
+	return rel.X >= 0 && rel.Y >= 0 && rel.Z >= 0 &&
+		rel.X < MAP_BLOCKSIZE && rel.Y < MAP_BLOCKSIZE && rel.Z < MAP_BLOCKSIZE;
+}
+
+// Same costs as in the node-level pathfinder
+inline u32 move_cost(s8 y_change)
+{
+	return y_change == 0 ? 1 : 2;
+}
+
+inline u64 cluster_key(v3s16 blockpos, u8 max_jump, u8 max_drop)
+{
+	return (u64)(u16)blockpos.X | (u64)(u16)blockpos.Y << 16 |
+		(u64)(u16)blockpos.Z << 32 | (u64)max_jump << 48 | (u64)max_drop << 56;
+}
+
+inline u32 xz_distance(v3s16 a, v3s16 b)
+{
+	return std::abs(a.X - b.X) + std::abs(a.Z - b.Z);
+}
+
+}
+
+struct NavigationCache::Cluster
+{
+	struct Block {
+		v3s16 pos;
+		MapBlock *block;
+		u64 modification_counter;
+	};
+
+	v3s16 blockpos;
+	// Blocks that were looked at, with their version
+	std::vector<Block> blocks;
+	// Y change of the moves of each cell in the directions of move_dirs,
+	// NO_MOVE if the cell isn't standable or the move isn't possible
+	std::array<s8, 4> moves[CELL_COUNT];
+	// Cells that have moves out of or into the block
+	std::vector<u16> entrances;
+	std::unordered_map<u16, u32> entrance_index;
+	// Costs from each entrance to the others, inside of the block
+	std::vector<std::vector<std::pair<u32, u32>>> links;
+	// Search that last used the cluster, it was valid at that time
+	u32 last_used = 0;
+
+	v3s16 getOrigin() const { return blockpos * MAP_BLOCKSIZE; }
+
+	// Target of a move, relative to the block. May be outside of it.
+	v3s16 getTarget(u16 cell, int dir) const
+	{
+		return cell_pos(cell) + move_dirs[dir] + v3s16(0, moves[cell][dir], 0);
+	}
+
+	bool isValid(Map *map) const
+	{
+		for (const Block &b : blocks) {
+			MapBlock *block = map->getBlockNoCreateNoEx(b.pos);
+			if (block != b.block || (block &&
+					block->getModificationCounter() != b.modification_counter))
+				return false;
+		}
+		return true;
+	}
+
+	// Shortest paths inside of the block from a cell, stops at `stop` if given
+	void search(u16 start, std::vector<u32> &dist, std::vector<u16> *parent,
+			s32 stop = -1) const;
+
+	// Shortest paths inside of the block to a cell
+	void searchReverse(u16 goal, std::vector<u32> &dist) const;
+};
+
+void NavigationCache::Cluster::search(u16 start, std::vector<u32> &dist,
+		std::vector<u16> *parent, s32 stop) const
+{
+	dist.assign(CELL_COUNT, UNREACHED);
+	if (parent)
+		parent->resize(CELL_COUNT);
+
+	using Item = std::pair<u32, u16>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+	dist[start] = 0;
+	open.emplace(0, start);
+	while (!open.empty()) {
+		const auto [d, cell] = open.top();
+		open.pop();
+		if (d > dist[cell])
+			continue;
+		if (cell == stop)
+			break;
+		for (int i = 0; i < 4; i++) {
+			if (moves[cell][i] == NO_MOVE)
+				continue;
+			const v3s16 target = getTarget(cell, i);
+			if (!is_inside_block(target))
+				continue;
+			const u16 next = cell_index(target);
+			const u32 next_dist = d + move_cost(moves[cell][i]);
+			if (next_dist < dist[next]) {
+				dist[next] = next_dist;
+				if (parent)
+					(*parent)[next] = cell;
+				open.emplace(next_dist, next);
+			}
+		}
+	}
+}
+
+void NavigationCache::Cluster::searchReverse(u16 goal, std::vector<u32> &dist) const
+{
+	// moves by target cell, as offsets into `incoming`
+	std::vector<u16> first(CELL_COUNT + 1, 0);
+	for (u16 cell = 0; cell < CELL_COUNT; cell++)
+	for (int i = 0; i < 4; i++) {
+		if (moves[cell][i] != NO_MOVE && is_inside_block(getTarget(cell, i)))
+			first[cell_index(getTarget(cell, i)) + 1]++;
+	}
+	for (u32 i = 0; i < CELL_COUNT; i++)
+		first[i + 1] += first[i];
+	std::vector<std::pair<u16, u8>> incoming(first[CELL_COUNT]);
+	std::vector<u16> fill(first.begin(), first.end() - 1);
+	for (u16 cell = 0; cell < CELL_COUNT; cell++)
+	for (int i = 0; i < 4; i++) {
+		if (moves[cell][i] != NO_MOVE && is_inside_block(getTarget(cell, i)))
+			incoming[fill[cell_index(getTarget(cell, i))]++] = {cell, (u8)i};
+	}
+
+	dist.assign(CELL_COUNT, UNREACHED);
+	using Item = std::pair<u32, u16>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+	dist[goal] = 0;
+	open.emplace(0, goal);
+	while (!open.empty()) {
+		const auto [d, cell] = open.top();
+		open.pop();
+		if (d > dist[cell])
+			continue;
+		for (u32 k = first[cell]; k < first[cell + 1]; k++) {
+			const auto [prev, dir] = incoming[k];
+			const u32 prev_dist = d + move_cost(moves[prev][dir]);
+			if (prev_dist < dist[prev]) {
+				dist[prev] = prev_dist;
+				open.emplace(prev_dist, prev);
+			}
+		}
+	}
+}
+
+/*
+	Computes the moves of a cluster. Each node around the block is only
+	looked up once.
+*/
+class NavigationCache::Builder
+{
+public:
+	Builder(Map *map, const NodeDefManager *ndef, u8 max_jump, u8 max_drop) :
+		m_map(map), m_ndef(ndef), m_max_jump(max_jump), m_max_drop(max_drop)
+	{}
+
+	void build(Cluster &cluster, v3s16 blockpos);
+
+private:
+	enum NodeClass : u8 {
+		NODE_UNSET,
+		NODE_FREE,
+		NODE_WALKABLE,
+		// not loaded, nothing may move there
+		NODE_UNKNOWN,
+	};
+
+	NodeClass classify(v3s16 p) const
+	{
+		MapNode n = m_map->getNode(p);
+		if (n.getContent() == CONTENT_IGNORE)
+			return NODE_UNKNOWN;
+		return m_ndef->get(n).walkable ? NODE_WALKABLE : NODE_FREE;
+	}
+
+	NodeClass get(v3s16 p)
+	{
+		if (!m_area.contains(p))
+			return classify(p);
+		NodeClass &c = m_nodes[m_area.index(p)];
+		if (c == NODE_UNSET)
+			c = classify(p);
+		return c;
+	}
+
+	bool isStandable(v3s16 p)
+	{
+		return get(p) == NODE_FREE && get(p - v3s16(0, 1, 0)) == NODE_WALKABLE;
+	}
+
+	// Same as Pathfinder::calcCost(), without the search limits
+	s8 getMove(v3s16 pos, v3s16 dir);
+
+	Map *m_map;
+	const NodeDefManager *m_ndef;
+	const u8 m_max_jump, m_max_drop;
+
+	// Nodes that may be looked at
+	VoxelArea m_area;
+	std::vector<NodeClass> m_nodes;
+};
+
+s8 NavigationCache::Builder::getMove(v3s16 pos, v3s16 dir)
+{
+	const v3s16 pos2 = pos + dir;
+	const NodeClass c2 = get(pos2);
+	if (c2 == NODE_UNKNOWN)
+		return NO_MOVE;
+
+	if (c2 == NODE_FREE) {
+		// same height, or dropping down
+		for (s16 depth = 1; depth <= m_max_drop + 1; depth++) {
+			const NodeClass c = get(pos2 - v3s16(0, depth, 0));
+			if (c == NODE_WALKABLE)
+				return 1 - depth;
+			if (c == NODE_UNKNOWN)
+				return NO_MOVE;
+		}
+		return NO_MOVE;
+	}
+
+	// jumping up, the space above is needed
+	for (s16 height = 1; height <= m_max_jump; height++) {
+		if (get(pos + v3s16(0, height, 0)) != NODE_FREE)
+			return NO_MOVE;
+		const NodeClass c = get(pos2 + v3s16(0, height, 0));
+		if (c == NODE_FREE)
+			return height;
+		if (c == NODE_UNKNOWN)
+			return NO_MOVE;
+	}
+	return NO_MOVE;
+}
+
+void NavigationCache::Builder::build(Cluster &cluster, v3s16 blockpos)
+{
+	const v3s16 origin = blockpos * MAP_BLOCKSIZE;
+	const s16 margin = m_max_jump + m_max_drop + 2;
+	m_area = VoxelArea(origin - v3s16(1, margin, 1),
+		origin + v3s16(MAP_BLOCKSIZE, MAP_BLOCKSIZE - 1 + margin, MAP_BLOCKSIZE));
+	m_nodes.assign(m_area.getVolume(), NODE_UNSET);
+
+	cluster.blockpos = blockpos;
+	cluster.blocks.clear();
+	const v3s16 bmin = getNodeBlockPos(m_area.MinEdge);
+	const v3s16 bmax = getNodeBlockPos(m_area.MaxEdge);
+	v3s16 bp;
+	for (bp.Z = bmin.Z; bp.Z <= bmax.Z; bp.Z++)
+	for (bp.Y = bmin.Y; bp.Y <= bmax.Y; bp.Y++)
+	for (bp.X = bmin.X; bp.X <= bmax.X; bp.X++) {
+		MapBlock *block = m_map->getBlockNoCreateNoEx(bp);
+		cluster.blocks.push_back({bp, block,
+			block ? block->getModificationCounter() : 0});
+	}
+
+	std::vector<bool> is_entrance(CELL_COUNT, false);
+	for (u16 cell = 0; cell < CELL_COUNT; cell++) {
+		auto &moves = cluster.moves[cell];
+		moves.fill(NO_MOVE);
+		const v3s16 p = origin + cell_pos(cell);
+		if (!isStandable(p))
+			continue;
+		for (int i = 0; i < 4; i++) {
+			moves[i] = getMove(p, move_dirs[i]);
+			if (moves[i] != NO_MOVE && !is_inside_block(cluster.getTarget(cell, i)))
+				is_entrance[cell] = true;
+		}
+	}
+
+	// Cells that are entered from outside of the block
+	v3s16 rel;
+	for (rel.Z = -1; rel.Z <= MAP_BLOCKSIZE; rel.Z++)
+	for (rel.Y = -m_max_jump; rel.Y < MAP_BLOCKSIZE + m_max_drop; rel.Y++)
+	for (rel.X = -1; rel.X <= MAP_BLOCKSIZE; rel.X++) {
+		if (is_inside_block(rel) || !isStandable(origin + rel))
+			continue;
+		for (const v3s16 &dir : move_dirs) {
+			v3s16 target = rel + dir;
+			if (target.X < 0 || target.Z < 0 ||
+					target.X >= MAP_BLOCKSIZE || target.Z >= MAP_BLOCKSIZE)
+				continue;
+			const s8 y_change = getMove(origin + rel, dir);
+			if (y_change == NO_MOVE)
+				continue;
+			target.Y += y_change;
+			if (is_inside_block(target))
+				is_entrance[cell_index(target)] = true;
+		}
+	}
+
+	cluster.entrances.clear();
+	cluster.entrance_index.clear();
+	for (u16 cell = 0; cell < CELL_COUNT; cell++) {
+		if (is_entrance[cell]) {
+			cluster.entrance_index[cell] = cluster.entrances.size();
+			cluster.entrances.push_back(cell);
+		}
+	}
+
+	cluster.links.assign(cluster.entrances.size(), {});
+	std::vector<u32> dist;
+	for (u32 i = 0; i < cluster.entrances.size(); i++) {
+		cluster.search(cluster.entrances[i], dist, nullptr);
+		for (u32 j = 0; j < cluster.entrances.size(); j++) {
+			if (j != i && dist[cluster.entrances[j]] != UNREACHED)
+				cluster.links[i].emplace_back(j, dist[cluster.entrances[j]]);
+		}
+	}
+}
+
+NavigationCache::NavigationCache(Map *map, const NodeDefManager *ndef) :
+	m_map(map), m_ndef(ndef)
+{
+}
+
+NavigationCache::~NavigationCache() = default;
+
+NavigationCache::Cluster *NavigationCache::getCluster(v3s16 blockpos,
+		u8 max_jump, u8 max_drop)
+{
+	auto &cluster = m_clusters[cluster_key(blockpos, max_jump, max_drop)];
+	// the map doesn't change during a search
+	if (cluster && cluster->last_used == m_search_id)
+		return cluster.get();
+
+	if (!cluster || !cluster->isValid(m_map)) {
+		if (!cluster)
+			cluster = std::make_unique<Cluster>();
+		Builder(m_map, m_ndef, max_jump, max_drop).build(*cluster, blockpos);
+	}
+	cluster->last_used = m_search_id;
+	return cluster.get();
+}
+
+void NavigationCache::evictClusters()
+{
+	if (m_clusters.size() <= MAX_CLUSTERS)
+		return;
+
+	// drop the least recently used quarter
+	std::vector<std::pair<u32, u64>> by_age;
+	by_age.reserve(m_clusters.size());
+	for (const auto &it : m_clusters)
+		by_age.emplace_back(it.second->last_used, it.first);
+	const size_t count = m_clusters.size() - MAX_CLUSTERS * 3 / 4;
+	std::nth_element(by_age.begin(), by_age.begin() + count, by_age.end());
+	for (size_t i = 0; i < count; i++)
+		m_clusters.erase(by_age[i].second);
+}
+
+NavigationCache::Result NavigationCache::findPath(v3s16 source, v3s16 destination,
+		const core::aabbox3d<s16> &limits,
+		unsigned int max_jump, unsigned int max_drop,
+		std::vector<v3s16> &path)
+{
+	if (max_jump > MAP_BLOCKSIZE || max_drop > MAP_BLOCKSIZE ||
+			getNodeBlockPos(source) == getNodeBlockPos(destination) ||
+			xz_distance(source, destination) < MIN_DISTANCE)
+		return RESULT_NOT_USED;
+
+	evictClusters();
+	m_search_id++;
+
+	const Cluster *source_cluster = getCluster(getNodeBlockPos(source),
+		max_jump, max_drop);
+	const Cluster *dest_cluster = getCluster(getNodeBlockPos(destination),
+		max_jump, max_drop);
+	const u16 source_cell = cell_index(source - source_cluster->getOrigin());
+
+	std::vector<u32> dist, to_dest;
+	dest_cluster->searchReverse(
+		cell_index(destination - dest_cluster->getOrigin()), to_dest);
+
+	/*
+		A* search over the entrances. Each step either stays inside of a
+		block, or is a single move into another one.
+	*/
+	std::unordered_map<v3s16, u32> ids;
+	std::vector<v3s16> cells;
+	std::vector<u32> costs, parents;
+	std::vector<bool> closed;
+	using Item = std::pair<u32, u32>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+
+	const auto relax = [&] (u32 from, v3s16 pos, u32 cost) {
+		if (!limits.isPointInside(pos))
+			return;
+		auto [it, inserted] = ids.emplace(pos, cells.size());
+		const u32 id = it->second;
+		if (inserted) {
+			cells.push_back(pos);
+			costs.push_back(UNREACHED);
+			parents.push_back(from);
+			closed.push_back(false);
+		}
+		if (closed[id] || cost >= costs[id])
+			return;
+		costs[id] = cost;
+		parents[id] = from;
+		open.emplace(cost + xz_distance(pos, destination), id);
+	};
+
+	relax(0, source, 0);
+	bool found = false;
+	while (!open.empty()) {
+		const u32 id = open.top().second;
+		open.pop();
+		if (closed[id])
+			continue;
+		closed[id] = true;
+
+		const v3s16 pos = cells[id];
+		const u32 cost = costs[id];
+		if (pos == destination) {
+			found = true;
+			break;
+		}
+
+		const Cluster *cluster = getCluster(getNodeBlockPos(pos), max_jump, max_drop);
+		const v3s16 origin = cluster->getOrigin();
+		const u16 cell = cell_index(pos - origin);
+
+		if (pos == source) {
+			source_cluster->search(source_cell, dist, nullptr);
+			for (u16 entrance : source_cluster->entrances) {
+				if (dist[entrance] != UNREACHED)
+					relax(id, origin + cell_pos(entrance), cost + dist[entrance]);
+			}
+		} else {
+			auto it = cluster->entrance_index.find(cell);
+			if (it != cluster->entrance_index.end()) {
+				for (const auto &link : cluster->links[it->second]) {
+					relax(id, origin + cell_pos(cluster->entrances[link.first]),
+						cost + link.second);
+				}
+			}
+		}
+
+		if (cluster == dest_cluster && to_dest[cell] != UNREACHED)
+			relax(id, destination, cost + to_dest[cell]);
+
+		for (int i = 0; i < 4; i++) {
+			const s8 y_change = cluster->moves[cell][i];
+			if (y_change == NO_MOVE)
+				continue;
+			const v3s16 target = cluster->getTarget(cell, i);
+			if (!is_inside_block(target))
+				relax(id, origin + target, cost + move_cost(y_change));
+		}
+	}
+
+	if (!found)
+		return RESULT_NO_PATH;
+
+	// Refine the path to single nodes
+	std::vector<v3s16> waypoints;
+	for (u32 id = ids[destination]; ; id = parents[id]) {
+		waypoints.push_back(cells[id]);
+		if (cells[id] == source)
+			break;
+	}
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	path.clear();
+	path.push_back(source);
+	std::vector<u16> parent, segment;
+	for (size_t i = 1; i < waypoints.size(); i++) {
+		const v3s16 from = waypoints[i - 1], to = waypoints[i];
+		if (getNodeBlockPos(from) != getNodeBlockPos(to)) {
+			path.push_back(to);
+			continue;
+		}
+		const Cluster *cluster = getCluster(getNodeBlockPos(from), max_jump, max_drop);
+		const v3s16 origin = cluster->getOrigin();
+		const u16 start = cell_index(from - origin), goal = cell_index(to - origin);
+		cluster->search(start, dist, &parent, goal);
+		if (dist[goal] == UNREACHED)
+			return RESULT_NO_PATH;
+		segment.clear();
+		for (u16 cell = goal; cell != start; cell = parent[cell])
+			segment.push_back(cell);
+		for (auto it = segment.rbegin(); it != segment.rend(); ++it)
+			path.push_back(origin + cell_pos(*it));
+	}
+
+	if (path.size() > MAX_WAYPOINTS) {
+		warningstream << "Pathfinder: path is too long (too many waypoints),"
+			" aborting" << std::endl;
+		path.clear();
+		return RESULT_NO_PATH;
+	}
+	return RESULT_FOUND;
+}
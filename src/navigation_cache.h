@@ -0,0 +1,68 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include "irr_v3d.h"
+#include "irr_aabb3d.h"
+#include "util/basic_macros.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Map;
+class NodeDefManager;
+
+/*
+	Block-level navigation graph for the pathfinder.
+
+	For every mapblock, the walkable surface and the moves between its cells
+	are computed once, together with the cells where paths enter or leave the
+	block ("entrances") and the costs between them. Long paths are searched
+	from entrance to entrance and only refined to single nodes afterwards.
+	A block is computed again once it or one of its neighbors was modified.
+
+	Moves are the same as in the node-level pathfinder: one node in a
+	cardinal direction, jumping up or dropping down a few nodes. The paths
+	are as short as those of the node-level search, but the parts inside of
+	a block may leave the search distance.
+*/
+class NavigationCache
+{
+public:
+	NavigationCache(Map *map, const NodeDefManager *ndef);
+	~NavigationCache();
+
+	DISABLE_CLASS_COPY(NavigationCache)
+
+	enum Result {
+		// the search was not done, use the node-level pathfinder instead
+		RESULT_NOT_USED,
+		RESULT_NO_PATH,
+		RESULT_FOUND,
+	};
+
+	// source and destination must be standable, all cells of the path are
+	// inside of limits. The path includes source and destination.
+	Result findPath(v3s16 source, v3s16 destination,
+			const core::aabbox3d<s16> &limits,
+			unsigned int max_jump, unsigned int max_drop,
+			std::vector<v3s16> &path);
+
+	size_t getClusterCount() const { return m_clusters.size(); }
+
+private:
+	struct Cluster;
+	class Builder;
+
+	Cluster *getCluster(v3s16 blockpos, u8 max_jump, u8 max_drop);
+	void evictClusters();
+
+	Map *m_map;
+	const NodeDefManager *m_ndef;
+
+	std::unordered_map<u64, std::unique_ptr<Cluster>> m_clusters;
+	// incremented for each search, see Cluster::last_used
+	u32 m_search_id = 0;
+};
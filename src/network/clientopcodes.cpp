@@ -46,9 +46,9 @@ const ToClientCommandHandler toClientCommandTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_BLOCKDATA",                TOCLIENT_STATE_CONNECTED, &Client::handleCommand_BlockData }, // 0x20
 	{ "TOCLIENT_ADDNODE",                  TOCLIENT_STATE_CONNECTED, &Client::handleCommand_AddNode }, // 0x21
 	{ "TOCLIENT_REMOVENODE",               TOCLIENT_STATE_CONNECTED, &Client::handleCommand_RemoveNode }, // 0x22
-	null_command_handler,
-	null_command_handler,
-	null_command_handler,
+	{ "TOCLIENT_NODES_CHANGED",            TOCLIENT_STATE_CONNECTED, &Client::handleCommand_NodesChanged }, // 0x23
+	{ "TOCLIENT_BLOCK_HASH",               TOCLIENT_STATE_CONNECTED, &Client::handleCommand_BlockHash }, // 0x24
+	{ "TOCLIENT_OBJECT_MOVEMENT",          TOCLIENT_STATE_CONNECTED, &Client::handleCommand_ObjectMovement }, // 0x25
 	null_command_handler,
 	{ "TOCLIENT_INVENTORY",                TOCLIENT_STATE_CONNECTED, &Client::handleCommand_Inventory }, // 0x27
 	null_command_handler,
@@ -105,12 +105,16 @@ const ToClientCommandHandler toClientCommandTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_SET_MOON",                 TOCLIENT_STATE_CONNECTED, &Client::handleCommand_HudSetMoon }, // 0x5b
 	{ "TOCLIENT_SET_STARS",                TOCLIENT_STATE_CONNECTED, &Client::handleCommand_HudSetStars }, // 0x5c
 	{ "TOCLIENT_MOVE_PLAYER_REL",          TOCLIENT_STATE_CONNECTED, &Client::handleCommand_MovePlayerRel }, // 0x5d,
-	null_command_handler,
-	null_command_handler,
+	{ "TOCLIENT_BUNDLE",                   TOCLIENT_STATE_CONNECTED, &Client::handleCommand_Bundle }, // 0x5e
+	{ "TOCLIENT_SHOW_FORMSPEC_DELTA",      TOCLIENT_STATE_CONNECTED, &Client::handleCommand_ShowFormSpecDelta }, // 0x5f
 	{ "TOCLIENT_SRP_BYTES_S_B",            TOCLIENT_STATE_NOT_CONNECTED, &Client::handleCommand_SrpBytesSandB }, // 0x60
 	{ "TOCLIENT_FORMSPEC_PREPEND",         TOCLIENT_STATE_CONNECTED, &Client::handleCommand_FormspecPrepend }, // 0x61,
 	{ "TOCLIENT_MINIMAP_MODES",            TOCLIENT_STATE_CONNECTED, &Client::handleCommand_MinimapModes }, // 0x62,
 	{ "TOCLIENT_SET_LIGHTING",             TOCLIENT_STATE_CONNECTED, &Client::handleCommand_SetLighting }, // 0x63,
+	{ "TOCLIENT_PARTICLE_DEFINITION",      TOCLIENT_STATE_CONNECTED, &Client::handleCommand_ParticleDefinition }, // 0x64,
+	{ "TOCLIENT_SPAWN_DEFINED_PARTICLE",   TOCLIENT_STATE_CONNECTED, &Client::handleCommand_SpawnDefinedParticle }, // 0x65,
+	{ "TOCLIENT_COMPRESSED_BUNDLE",        TOCLIENT_STATE_NOT_CONNECTED, &Client::handleCommand_CompressedBundle }, // 0x66,
+	{ "TOCLIENT_TRANSFER",                 TOCLIENT_STATE_CONNECTED, &Client::handleCommand_Transfer }, // 0x67,
 };
 
 const static ServerCommandFactory null_command_factory = { nullptr, 0, false };
@@ -161,11 +165,11 @@ const ServerCommandFactory serverCommandFactoryTable[TOSERVER_NUM_MSG_TYPES] =
 	null_command_factory, // 0x1f
 	null_command_factory, // 0x20
 	null_command_factory, // 0x21
-	null_command_factory, // 0x22
+	{ "TOSERVER_PLAYER_MOVE",        0, false }, // 0x22
 	{ "TOSERVER_PLAYERPOS",          0, false }, // 0x23
 	{ "TOSERVER_GOTBLOCKS",          2, true }, // 0x24
 	{ "TOSERVER_DELETEDBLOCKS",      2, true }, // 0x25
-	null_command_factory, // 0x26
+	{ "TOSERVER_REQUEST_BLOCKS",     2, true }, // 0x26
 	null_command_factory, // 0x27
 	null_command_factory, // 0x28
 	null_command_factory, // 0x29
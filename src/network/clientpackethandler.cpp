@@ -7,6 +7,8 @@
 #include "exceptions.h"
 #include "irr_v2d.h"
 #include "util/base64.h"
+#include "client/blockdecoder.h"
+#include "client/clientblockcache.h"
 #include "client/camera.h"
 #include "client/mesh_generator_thread.h"
 #include "chatmessage.h"
@@ -223,10 +225,33 @@ void Client::handleCommand_AccessDenied(NetworkPacket* pkt)
 	}
 }
 
+void Client::handleCommand_Transfer(NetworkPacket* pkt)
+{
+	std::string address;
+	u16 port;
+	*pkt >> address >> port;
+
+	if (address.empty() || port == 0)
+		return;
+
+	infostream << "Client: Server moves us to " << address << ":" << port
+		<< std::endl;
+
+	// The server disconnects us right after this, quit the game without
+	// an error and let the launcher connect to the other server
+	m_transfer_address = address;
+	m_transfer_port = port;
+	m_access_denied = true;
+	m_access_denied_reason = gettext("Moved to another server.");
+}
+
 void Client::handleCommand_RemoveNode(NetworkPacket* pkt)
 {
 	v3s16 p;
 	*pkt >> p;
+	// the node must not be overwritten by an older version of its block
+	if (m_block_decoder->isPending(getNodeBlockPos(p)))
+		insertDecodedBlocks(true);
 	removeNode(p);
 }
 
@@ -244,9 +269,41 @@ void Client::handleCommand_AddNode(NetworkPacket* pkt)
 	bool keep_metadata;
 	*pkt >> keep_metadata;
 
+	if (m_block_decoder->isPending(getNodeBlockPos(p)))
+		insertDecodedBlocks(true);
 	addNode(p, n, !keep_metadata);
 }
 
+void Client::handleCommand_NodesChanged(NetworkPacket* pkt)
+{
+	v3s16 blockpos;
+	u16 count;
+	*pkt >> blockpos >> count;
+
+	if (m_block_decoder->isPending(blockpos))
+		insertDecodedBlocks(true);
+
+	Map &map = m_env.getMap();
+	std::map<v3s16, MapBlock*> modified_blocks;
+	for (u16 i = 0; i < count; i++) {
+		u16 index;
+		MapNode n;
+		bool keep_metadata;
+		*pkt >> index >> n.param0 >> n.param1 >> n.param2 >> keep_metadata;
+		if (index >= MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE)
+			continue;
+
+		const v3s16 p = blockpos * MAP_BLOCKSIZE + BlockNodeChanges::getRelPos(index);
+		try {
+			map.addNodeAndUpdate(p, n, modified_blocks, !keep_metadata);
+		} catch (InvalidPositionException &e) {
+		}
+	}
+
+	for (const auto &modified_block : modified_blocks)
+		addUpdateMeshTaskWithEdge(modified_block.first, false, true);
+}
+
 void Client::handleCommand_NodemetaChanged(NetworkPacket *pkt)
 {
 	if (pkt->getSize() < 1)
@@ -259,6 +316,9 @@ void Client::handleCommand_NodemetaChanged(NetworkPacket *pkt)
 	NodeMetadataList meta_updates_list(false);
 	meta_updates_list.deSerialize(sstr, m_itemdef, true);
 
+	if (m_block_decoder->isPending())
+		insertDecodedBlocks(true);
+
 	Map &map = m_env.getMap();
 	for (auto i = meta_updates_list.begin();
 			i != meta_updates_list.end(); ++i) {
@@ -282,42 +342,26 @@ void Client::handleCommand_BlockData(NetworkPacket* pkt)
 	v3s16 p;
 	*pkt >> p;
 
-	std::string datastring(pkt->getRemainingString(), pkt->getRemainingBytes());
-	std::istringstream istr(datastring, std::ios_base::binary);
-
-	MapSector *sector;
-	MapBlock *block;
-
-	v2s16 p2d(p.X, p.Z);
-	sector = m_env.getMap().emergeSector(p2d);
-
-	assert(sector->getPos() == p2d);
+	// Decompressing and parsing take a while, see insertDecodedBlocks()
+	m_block_decoder->enqueue(p, std::string(pkt->getRemainingString(),
+		pkt->getRemainingBytes()), m_server_ser_ver,
+		m_block_cache ? BlockDecoder::ENQUEUE_KEEP_DATA : 0);
+}
 
-	block = sector->getBlockNoCreateNoEx(p.Y);
-	if (block) {
-		/*
-			Update an existing block
-		*/
-		block->deSerialize(istr, m_server_ser_ver, false);
-		block->deSerializeNetworkSpecific(istr);
-	}
-	else {
-		/*
-			Create a new block
-		*/
-		block = sector->createBlankBlock(p.Y);
-		block->deSerialize(istr, m_server_ser_ver, false);
-		block->deSerializeNetworkSpecific(istr);
-	}
+void Client::handleCommand_BlockHash(NetworkPacket* pkt)
+{
+	v3s16 p;
+	std::string sha1;
+	*pkt >> p >> sha1;
 
-	if (m_localdb) {
-		ServerMap::saveBlock(block, m_localdb.get());
+	std::string data;
+	if (m_block_cache && m_block_cache->load(p, sha1, m_server_ser_ver, data)) {
+		m_block_decoder->enqueue(p, std::move(data), m_server_ser_ver,
+			BlockDecoder::ENQUEUE_FROM_CACHE);
+	} else {
+		// sent in ReceiveAll()
+		m_blocks_to_request.push_back(p);
 	}
-
-	/*
-		Add it to mesh update queue and set it to be acknowledged after update.
-	*/
-	addUpdateMeshTaskWithEdge(p, true);
 }
 
 void Client::handleCommand_Inventory(NetworkPacket* pkt)
@@ -335,7 +379,14 @@ void Client::handleCommand_Inventory(NetworkPacket* pkt)
 
 	m_update_wielded_item = true;
 
-	m_inventory_from_server = std::make_unique<Inventory>(player->inventory);
+	if (m_inventory_from_server) {
+		// Unchanged slots are skipped by the server. Apply the update to the
+		// last server state too, so that it does not pick up predicted slots.
+		std::istringstream is2(datastring, std::ios_base::binary);
+		m_inventory_from_server->deSerialize(is2);
+	} else {
+		m_inventory_from_server = std::make_unique<Inventory>(player->inventory);
+	}
 	m_inventory_from_server_age = 0.0f;
 }
 
@@ -441,32 +492,21 @@ void Client::handleCommand_ActiveObjectRemoveAdd(NetworkPacket* pkt)
 
 void Client::handleCommand_ActiveObjectMessages(NetworkPacket* pkt)
 {
-	/*
-		for all objects
-		{
-			u16 id
-			u16 message length
-			string message
-		}
-	*/
-	std::string datastring(pkt->getString(0), pkt->getSize());
-	std::istringstream is(datastring, std::ios_base::binary);
+	if (pkt->getSize() == 0)
+		return;
 
-	try {
-		while (is.good()) {
-			u16 id = readU16(is);
-			if (!is.good())
-				break;
+	m_env.processActiveObjectMessages(
+		reinterpret_cast<const u8 *>(pkt->getString(0)), pkt->getSize());
+}
 
-			std::string message = deSerializeString16(is);
+void Client::handleCommand_ObjectMovement(NetworkPacket* pkt)
+{
+	u16 seq;
+	*pkt >> seq;
 
-			// Pass on to the environment
-			m_env.processActiveObjectMessage(id, message);
-		}
-	} catch (SerializationError &e) {
-		errorstream << "Client::handleCommand_ActiveObjectMessages: "
-			<< "caught SerializationError: " << e.what() << std::endl;
-	}
+	m_env.processObjectMovement(seq,
+		reinterpret_cast<const u8 *>(pkt->getRemainingString()),
+		pkt->getRemainingBytes());
 }
 
 void Client::handleCommand_Movement(NetworkPacket* pkt)
@@ -596,6 +636,49 @@ void Client::handleCommand_MovePlayerRel(NetworkPacket *pkt)
 	player->addPosition(added_pos);
 }
 
+void Client::handleCommand_Bundle(NetworkPacket *pkt)
+{
+	while (pkt->getRemainingBytes() > 0) {
+		u16 len;
+		*pkt >> len;
+		if (len < 2)
+			throw PacketError("Truncated packet in TOCLIENT_BUNDLE");
+		const u8 *data = (const u8 *)pkt->getRemainingString();
+		pkt->skip(len); // performs length check
+
+		NetworkPacket inner;
+		inner.putRawPacket(data, len, pkt->getPeerId());
+		if (inner.getCommand() == TOCLIENT_BUNDLE ||
+				inner.getCommand() == TOCLIENT_COMPRESSED_BUNDLE) {
+			infostream << "Client: Ignoring nested TOCLIENT_BUNDLE" << std::endl;
+			continue;
+		}
+		ProcessData(&inner);
+	}
+}
+
+void Client::handleCommand_CompressedBundle(NetworkPacket *pkt)
+{
+	// Handled in any state, otherwise the stream would get out of sync
+	u8 channel;
+	*pkt >> channel;
+	if (channel >= ARRLEN(m_bundle_streams))
+		throw PacketError("Invalid channel in TOCLIENT_COMPRESSED_BUNDLE");
+
+	auto &stream = m_bundle_streams[channel];
+	if (!stream)
+		stream = std::make_unique<ZstdStreamDecompressor>(NETPROTO_COMPRESSION_WINDOW_LOG);
+
+	std::string data(2, '\0');
+	writeU16((u8 *)&data[0], TOCLIENT_BUNDLE);
+	stream->decompress(std::string_view(pkt->getRemainingString(),
+		pkt->getRemainingBytes()), data);
+
+	NetworkPacket bundle;
+	bundle.putRawPacket((const u8 *)data.data(), data.size(), pkt->getPeerId());
+	ProcessData(&bundle);
+}
+
 void Client::handleCommand_DeathScreenLegacy(NetworkPacket* pkt)
 {
 	ClientEvent *event = new ClientEvent();
@@ -733,17 +816,7 @@ void Client::handleCommand_NodeDef(NetworkPacket* pkt)
 	// updating content definitions
 	sanity_check(!m_mesh_update_manager->isRunning());
 
-	// Decompress node definitions
-	std::istringstream tmp_is(pkt->readLongString(), std::ios::binary);
-	std::stringstream tmp_os(std::ios::binary | std::ios::in | std::ios::out);
-	if (m_proto_ver >= 48)
-		decompressZstd(tmp_is, tmp_os);
-	else
-		decompressZlib(tmp_is, tmp_os);
-
-	// Deserialize node definitions
-	m_nodedef->deSerialize(tmp_os, m_proto_ver);
-	m_nodedef_received = true;
+	deserializeDefinitions(pkt->readLongString(), true, m_nodedef_received);
 }
 
 void Client::handleCommand_ItemDef(NetworkPacket* pkt)
@@ -755,17 +828,7 @@ void Client::handleCommand_ItemDef(NetworkPacket* pkt)
 	// updating content definitions
 	sanity_check(!m_mesh_update_manager->isRunning());
 
-	// Decompress item definitions
-	std::istringstream tmp_is(pkt->readLongString(), std::ios::binary);
-	std::stringstream tmp_os(std::ios::binary | std::ios::in | std::ios::out);
-	if (m_proto_ver >= 48)
-		decompressZstd(tmp_is, tmp_os);
-	else
-		decompressZlib(tmp_is, tmp_os);
-
-	// Deserialize node definitions
-	m_itemdef->deSerialize(tmp_os, m_proto_ver);
-	m_itemdef_received = true;
+	deserializeDefinitions(pkt->readLongString(), false, m_itemdef_received);
 }
 
 void Client::handleCommand_PlaySound(NetworkPacket* pkt)
@@ -944,6 +1007,9 @@ void Client::handleCommand_ShowFormSpec(NetworkPacket* pkt)
 
 	*pkt >> formname;
 
+	m_last_formspec = formspec;
+	m_last_formspec_name = formname;
+
 	ClientEvent *event = new ClientEvent();
 	event->type = CE_SHOW_FORMSPEC;
 	// pointer is required as event is a struct only!
@@ -953,6 +1019,35 @@ void Client::handleCommand_ShowFormSpec(NetworkPacket* pkt)
 	m_client_event_queue.push(event);
 }
 
+void Client::handleCommand_ShowFormSpecDelta(NetworkPacket* pkt)
+{
+	std::string formname;
+	u32 prefix_len, suffix_len;
+	*pkt >> formname >> prefix_len >> suffix_len;
+	std::string middle = pkt->readLongString();
+
+	// The server only sends these based on the last formspec it sent
+	if (formname != m_last_formspec_name ||
+			(u64)prefix_len + suffix_len > m_last_formspec.size()) {
+		errorstream << "Client: Ignoring TOCLIENT_SHOW_FORMSPEC_DELTA for unknown"
+			" formspec \"" << formname << "\"" << std::endl;
+		return;
+	}
+
+	std::string formspec;
+	formspec.reserve(prefix_len + middle.size() + suffix_len);
+	formspec.append(m_last_formspec, 0, prefix_len);
+	formspec.append(middle);
+	formspec.append(m_last_formspec, m_last_formspec.size() - suffix_len, suffix_len);
+	m_last_formspec = formspec;
+
+	ClientEvent *event = new ClientEvent();
+	event->type = CE_SHOW_FORMSPEC;
+	event->show_formspec.formspec = new std::string(std::move(formspec));
+	event->show_formspec.formname = new std::string(formname);
+	m_client_event_queue.push(event);
+}
+
 void Client::handleCommand_SpawnParticle(NetworkPacket* pkt)
 {
 	std::string datastring(pkt->getString(0), pkt->getSize());
@@ -968,6 +1063,38 @@ void Client::handleCommand_SpawnParticle(NetworkPacket* pkt)
 	m_client_event_queue.push(event);
 }
 
+void Client::handleCommand_ParticleDefinition(NetworkPacket* pkt)
+{
+	u16 id;
+	*pkt >> id;
+	m_particle_definitions[id] = pkt->readRawString(pkt->getRemainingBytes());
+}
+
+void Client::handleCommand_SpawnDefinedParticle(NetworkPacket* pkt)
+{
+	u16 id;
+	*pkt >> id;
+	const auto it = m_particle_definitions.find(id);
+	if (it == m_particle_definitions.end()) {
+		warningstream << "Client: Ignoring particle with unknown definition "
+			<< id << std::endl;
+		return;
+	}
+
+	std::string datastring = pkt->readRawString(ParticleParameters::SERIALIZED_SPAWN_SIZE);
+	datastring.append(it->second);
+	std::istringstream is(datastring, std::ios_base::binary);
+
+	ParticleParameters p;
+	p.deSerialize(is, m_proto_ver);
+
+	ClientEvent *event = new ClientEvent();
+	event->type           = CE_SPAWN_PARTICLE;
+	event->spawn_particle = new ParticleParameters(p);
+
+	m_client_event_queue.push(event);
+}
+
 void Client::handleCommand_AddParticleSpawner(NetworkPacket* pkt)
 {
 	std::string datastring(pkt->getString(0), pkt->getSize());
@@ -1632,7 +1759,7 @@ void Client::handleCommand_MediaPush(NetworkPacket *pkt)
 		}
 
 		// Actually load media
-		loadMedia(filedata, filename, true);
+		loadMedia(filedata, filename, raw_hash, true);
 
 		// Cache file for the next time when this client joins the same server
 		if (cached)
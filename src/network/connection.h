@@ -6,13 +6,15 @@
 #include "irrlichttypes.h"
 #include "socket.h"
 #include "networkprotocol.h" // session_t
+#include <vector>
 
 class NetworkPacket;
-class PeerHandler;
 
 namespace con
 {
 
+class PeerHandler;
+
 enum rtt_stat_type {
 	MIN_RTT,
 	MAX_RTT,
@@ -31,6 +33,20 @@ enum rate_stat_type {
 	AVG_LOSS_RATE,
 };
 
+// Congestion control state of a peer, combined over all channels
+struct CongestionStats {
+	// reliable packets allowed to wait for an ACK
+	u32 window = 0;
+	// reliable packets waiting for an ACK
+	u32 in_flight = 0;
+	// reliable packets and commands waiting for room in the window
+	u32 queued = 0;
+	// estimated bottleneck bandwidth in bytes/s, 0 if unknown
+	float bandwidth = 0;
+	// lowest recently seen round trip time in seconds, negative if unknown
+	float min_rtt = -1;
+};
+
 class IPeer {
 public:
 	// Unique id of the peer
@@ -60,11 +76,20 @@ class IConnection
 	}
 
 	virtual void Send(session_t peer_id, u8 channelnum, NetworkPacket *pkt, bool reliable) = 0;
+	// Sends the same packet to each peer
+	virtual void SendToMany(const std::vector<session_t> &peer_ids, u8 channelnum,
+		NetworkPacket *pkt, bool reliable)
+	{
+		for (session_t peer_id : peer_ids)
+			Send(peer_id, channelnum, pkt, reliable);
+	}
 
 	virtual session_t GetPeerID() const = 0;
 	virtual Address GetPeerAddress(session_t peer_id) = 0;
 	virtual float getPeerStat(session_t peer_id, rtt_stat_type type) = 0;
 	virtual float getLocalStat(rate_stat_type type) = 0;
+	// Returns false if the peer doesn't exist
+	virtual bool getPeerCongestionStats(session_t peer_id, CongestionStats &stats) = 0;
 };
 
 // MTP = Minetest Protocol
@@ -0,0 +1,254 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "network/mtp/congestion.h"
+#include <algorithm>
+#include <iterator>
+#include "log.h"
+#include "util/numeric.h"
+
+namespace con
+{
+
+/*
+	LossCongestionController
+*/
+
+void LossCongestionController::onAck(u32 bytes, float rtt)
+{
+	m_bytes_acked += bytes;
+	m_packet_successful++;
+}
+
+void LossCongestionController::step(float dtime, u32 in_flight)
+{
+	auto set_window = [this] (long size) {
+		m_window_size = (u16)rangelim(size, MIN_RELIABLE_WINDOW_SIZE,
+			MAX_RELIABLE_WINDOW_SIZE_SEND);
+	};
+
+	m_bytes_timer += dtime;
+	m_loss_timer += dtime;
+
+	if (m_loss_timer > 1.0f) {
+		m_loss_timer -= 1.0f;
+
+		unsigned int packet_loss = m_packet_loss;
+		unsigned int packets_successful = m_packet_successful;
+
+		// has half the window even been used?
+		bool reasonable_amount_of_data_transmitted =
+			m_bytes_acked > (unsigned int) (m_window_size*512/2);
+
+		// Packets too late means either packet duplication along the way
+		// or we were too fast in resending it (which should be self-regulating).
+		// Count this a signal of congestion, like packet loss.
+		packet_loss = std::min(packet_loss + m_packet_too_late, packets_successful);
+
+		m_packet_loss = 0;
+		m_packet_too_late = 0;
+		m_packet_successful = 0;
+
+		/* dynamic window size */
+		float successful_to_lost_ratio = 0.0f;
+		bool done = false;
+
+		if (packets_successful > 0) {
+			successful_to_lost_ratio = packet_loss/packets_successful;
+		} else if (packet_loss > 0) {
+			set_window(m_window_size - 10);
+			done = true;
+		}
+
+		if (!done) {
+			if (successful_to_lost_ratio < 0.01f) {
+				/* don't even think about increasing if we didn't even
+				 * use major parts of our window */
+				if (reasonable_amount_of_data_transmitted)
+					set_window(m_window_size + 100);
+			} else if (successful_to_lost_ratio < 0.05f) {
+				/* don't even think about increasing if we didn't even
+				 * use major parts of our window */
+				if (reasonable_amount_of_data_transmitted)
+					set_window(m_window_size + 50);
+			} else if (successful_to_lost_ratio > 0.15f) {
+				set_window(m_window_size - 100);
+			} else if (successful_to_lost_ratio > 0.1f) {
+				set_window(m_window_size - 50);
+			}
+		}
+	}
+
+	if (m_bytes_timer > 10.0f) {
+		m_bytes_timer = 0.0f;
+		m_bytes_acked = 0;
+	}
+}
+
+/*
+	BBRCongestionController
+*/
+
+// Window gain while searching for the bottleneck bandwidth (2/ln(2))
+static constexpr float BBR_STARTUP_GAIN = 2.89f;
+// Window gain in PROBE_BW, relative to the bandwidth-delay product
+static constexpr float BBR_WINDOW_GAIN = 2.0f;
+// Gains cycled through in PROBE_BW, one per round
+static constexpr float BBR_CYCLE_GAINS[] = {1.25f, 0.75f, 1, 1, 1, 1, 1, 1};
+// Bandwidth must grow by this factor within 3 rounds to stay in STARTUP
+static constexpr float BBR_FULL_BW_THRESHOLD = 1.25f;
+// Minimum length of a round, short ones give too noisy delivery rates
+static constexpr float BBR_MIN_ROUND_TIME = 0.1f;
+// Lower limit of the RTT used for the bandwidth-delay product, ACKs are
+// only timed with millisecond precision
+static constexpr float BBR_MIN_RTT_FLOOR = 0.01f;
+// Time after which the minimum RTT is measured again with PROBE_RTT
+static constexpr float BBR_MIN_RTT_EXPIRY = 10.0f;
+// Minimum duration of PROBE_RTT
+static constexpr float BBR_PROBE_RTT_TIME = 0.2f;
+
+BBRCongestionController::BBRCongestionController()
+{
+	std::fill(std::begin(m_bw_samples), std::end(m_bw_samples), 0.0f);
+}
+
+float BBRCongestionController::getBandwidth() const
+{
+	return *std::max_element(std::begin(m_bw_samples), std::end(m_bw_samples));
+}
+
+void BBRCongestionController::onAck(u32 bytes, float rtt)
+{
+	m_round_bytes += bytes;
+	m_acked++;
+	m_avg_packet_size = m_avg_packet_size * 0.95f + bytes * 0.05f;
+
+	if (rtt < 0)
+		return;
+	if (m_state == PROBE_RTT && (m_probe_rtt_min < 0 || rtt < m_probe_rtt_min))
+		m_probe_rtt_min = rtt;
+	if (m_min_rtt < 0 || rtt <= m_min_rtt) {
+		m_min_rtt = rtt;
+		m_min_rtt_age = 0;
+	}
+}
+
+u32 BBRCongestionController::getTargetWindow() const
+{
+	const float bw = getBandwidth();
+	if (bw <= 0 || m_min_rtt < 0)
+		return 0;
+
+	float gain;
+	switch (m_state) {
+	case STARTUP:
+		gain = BBR_STARTUP_GAIN;
+		break;
+	case DRAIN:
+		gain = 1;
+		break;
+	case PROBE_BW:
+		gain = BBR_WINDOW_GAIN * BBR_CYCLE_GAINS[m_cycle_index];
+		break;
+	default:
+		return MIN_RELIABLE_WINDOW_SIZE;
+	}
+	const float bdp = bw * std::max(m_min_rtt, BBR_MIN_RTT_FLOOR);
+	return bdp * gain / std::max(m_avg_packet_size, 1.0f);
+}
+
+void BBRCongestionController::setWindow(u32 size)
+{
+	m_window_size = (u16)rangelim(size, MIN_RELIABLE_WINDOW_SIZE,
+		MAX_RELIABLE_WINDOW_SIZE_SEND);
+}
+
+void BBRCongestionController::endRound()
+{
+	const float rate = m_round_bytes / m_round_time;
+	// Rounds that didn't use the window only tell us the peer didn't need
+	// more, so they may raise the estimate but never lower it
+	const bool app_limited = m_round_max_in_flight * 2 < m_window_size;
+	if (!app_limited || rate > getBandwidth())
+		m_bw_samples[m_bw_index++ % BW_FILTER_LENGTH] = rate;
+
+	if (!m_filled_pipe && !app_limited) {
+		const float bw = getBandwidth();
+		if (bw >= m_full_bw * BBR_FULL_BW_THRESHOLD) {
+			m_full_bw = bw;
+			m_full_bw_rounds = 0;
+		} else if (++m_full_bw_rounds >= 3) {
+			m_filled_pipe = true;
+			if (m_state == STARTUP)
+				m_state = DRAIN;
+		}
+	}
+
+	if (m_state == PROBE_BW)
+		m_cycle_index = (m_cycle_index + 1) % std::size(BBR_CYCLE_GAINS);
+
+	m_round_time = 0;
+	m_round_bytes = 0;
+	m_round_max_in_flight = 0;
+}
+
+void BBRCongestionController::step(float dtime, u32 in_flight)
+{
+	m_in_flight = in_flight;
+	m_round_max_in_flight = std::max(m_round_max_in_flight, in_flight);
+	m_min_rtt_age += dtime;
+	m_round_time += dtime;
+
+	if (m_round_time >= std::max(m_min_rtt, BBR_MIN_ROUND_TIME))
+		endRound();
+
+	if (m_state == PROBE_RTT) {
+		m_probe_rtt_timer -= dtime;
+		if (m_probe_rtt_timer <= 0) {
+			if (m_probe_rtt_min >= 0)
+				m_min_rtt = m_probe_rtt_min;
+			m_min_rtt_age = 0;
+			m_state = m_filled_pipe ? PROBE_BW : STARTUP;
+		}
+	} else if (m_min_rtt >= 0 && m_min_rtt_age > BBR_MIN_RTT_EXPIRY) {
+		m_state = PROBE_RTT;
+		m_probe_rtt_timer = std::max(m_min_rtt, BBR_PROBE_RTT_TIME);
+		m_probe_rtt_min = -1;
+	}
+
+	const u32 target = getTargetWindow();
+	if (m_state == DRAIN && in_flight <= target) {
+		m_state = PROBE_BW;
+		// start with a neutral gain as the queue was just drained
+		m_cycle_index = 2;
+	}
+
+	u32 window = m_window_size;
+	if (m_state == PROBE_RTT) {
+		window = MIN_RELIABLE_WINDOW_SIZE;
+	} else if (target == 0 || !m_filled_pipe) {
+		// Grow by the acknowledged packets (doubling per RTT) but don't
+		// bother as long as the window isn't even used.
+		if (m_in_flight * 2 >= m_window_size)
+			window += m_acked;
+	} else {
+		window = std::min(window + m_acked, target);
+	}
+	m_acked = 0;
+	setWindow(window);
+}
+
+std::unique_ptr<CongestionController> createCongestionController(
+	const std::string &name)
+{
+	if (name == "bbr")
+		return std::make_unique<BBRCongestionController>();
+	if (name != "loss") {
+		warningstream << "Unknown congestion controller \"" << name
+			<< "\", using \"loss\"" << std::endl;
+	}
+	return std::make_unique<LossCongestionController>();
+}
+
+}
@@ -0,0 +1,168 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "irrlichttypes.h"
+
+namespace con
+{
+
+/*
+ * Window sizes to use, in packets (not bytes!).
+ * 0xFFFF is theoretical maximum. don't think about
+ * touching it, the less you're away from it the more likely data corruption
+ * will occur
+ *
+ * Note: window sizes directly translate to maximum possible throughput, e.g.
+ *       (2048 * 512 bytes) / 33ms = 15 MiB/s
+ */
+
+// Due to backwards compatibility we have different window sizes for what we'll
+// accept from peers vs. what we use for sending.
+#define MAX_RELIABLE_WINDOW_SIZE 0x8000
+#define MAX_RELIABLE_WINDOW_SIZE_SEND 2048
+/* starting value for window size */
+#define START_RELIABLE_WINDOW_SIZE 64
+/* minimum value for window size */
+#define MIN_RELIABLE_WINDOW_SIZE 32
+
+/*
+	Decides how many reliable packets of a channel may wait for an ACK.
+
+	All methods are called with the channel's internal mutex held.
+*/
+class CongestionController
+{
+public:
+	virtual ~CongestionController() = default;
+
+	// A reliable packet was acknowledged.
+	// rtt: round trip time in seconds, negative if unknown (e.g. resent packet)
+	virtual void onAck(u32 bytes, float rtt) = 0;
+	// Packets timed out and are about to be resent
+	virtual void onLoss(u32 count) = 0;
+	// An ACK arrived for a packet that was not in flight anymore
+	virtual void onTooLate() = 0;
+	// Called regularly by the send thread.
+	// in_flight: number of packets currently waiting for an ACK
+	virtual void step(float dtime, u32 in_flight) = 0;
+
+	virtual u16 getWindowSize() const = 0;
+	// Estimated bottleneck bandwidth in bytes/s, 0 if unknown
+	virtual float getBandwidth() const { return 0; }
+	// Lowest recently seen round trip time in seconds, negative if unknown
+	virtual float getMinRTT() const { return -1; }
+};
+
+/*
+	Adjusts the window once a second depending on the ratio of lost packets.
+*/
+class LossCongestionController : public CongestionController
+{
+public:
+	void onAck(u32 bytes, float rtt) override;
+	void onLoss(u32 count) override { m_packet_loss += count; }
+	void onTooLate() override { m_packet_too_late++; }
+	void step(float dtime, u32 in_flight) override;
+
+	u16 getWindowSize() const override { return m_window_size; }
+
+private:
+	u16 m_window_size = START_RELIABLE_WINDOW_SIZE;
+
+	u32 m_packet_loss = 0;
+	u32 m_packet_too_late = 0;
+	u32 m_packet_successful = 0;
+	// acknowledged bytes, reset with the same period as the channel's
+	// rate statistics
+	u32 m_bytes_acked = 0;
+	float m_loss_timer = 0.0f;
+	float m_bytes_timer = 0.0f;
+};
+
+/*
+	Model based congestion control in the style of BBR: the window follows
+	the bandwidth-delay product estimated from the delivery rate and the
+	minimum round trip time of acknowledged packets, packet loss is not
+	treated as a congestion signal.
+
+	As there is no pacing the gains are applied to the window only:
+	 - STARTUP grows the window with every ACK until the bandwidth stops
+	   increasing,
+	 - DRAIN shrinks it to get rid of the queue built up during startup,
+	 - PROBE_BW cycles around a window of twice the BDP to notice more
+	   available bandwidth,
+	 - PROBE_RTT briefly shrinks the window to the minimum when the RTT
+	   estimate is outdated, so queueing delay doesn't stick to it.
+*/
+class BBRCongestionController : public CongestionController
+{
+public:
+	BBRCongestionController();
+
+	void onAck(u32 bytes, float rtt) override;
+	void onLoss(u32 count) override {}
+	void onTooLate() override {}
+	void step(float dtime, u32 in_flight) override;
+
+	u16 getWindowSize() const override { return m_window_size; }
+	float getBandwidth() const override;
+	float getMinRTT() const override { return m_min_rtt; }
+
+	enum State : u8 {
+		STARTUP,
+		DRAIN,
+		PROBE_BW,
+		PROBE_RTT,
+	};
+	State getState() const { return m_state; }
+
+private:
+	// Number of samples the bandwidth estimate is the maximum of
+	static constexpr u32 BW_FILTER_LENGTH = 10;
+
+	// Target window in packets for the current state
+	u32 getTargetWindow() const;
+	void endRound();
+	void setWindow(u32 size);
+
+	State m_state = STARTUP;
+	u16 m_window_size = START_RELIABLE_WINDOW_SIZE;
+	// from the last call to step()
+	u32 m_in_flight = 0;
+
+	float m_min_rtt = -1;
+	// time since m_min_rtt was last lowered or confirmed
+	float m_min_rtt_age = 0;
+	float m_probe_rtt_timer = 0;
+	float m_probe_rtt_min = -1;
+
+	// delivery rate samples of the last rounds (bytes/s)
+	float m_bw_samples[BW_FILTER_LENGTH];
+	u32 m_bw_index = 0;
+	float m_round_time = 0;
+	u32 m_round_bytes = 0;
+	u32 m_round_max_in_flight = 0;
+
+	// bandwidth at the time it last grew significantly in STARTUP
+	float m_full_bw = 0;
+	u32 m_full_bw_rounds = 0;
+	bool m_filled_pipe = false;
+	u32 m_cycle_index = 0;
+
+	// moving average of the packet size
+	float m_avg_packet_size = 512;
+	// packets acknowledged since the last window update
+	u32 m_acked = 0;
+};
+
+// Creates the controller called `name` ("loss" or "bbr"), falls back to
+// the loss based one for unknown names
+std::unique_ptr<CongestionController> createCongestionController(
+	const std::string &name);
+
+}
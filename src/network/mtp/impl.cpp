@@ -592,6 +592,19 @@ ConnectionCommandPtr ConnectionCommand::peer_id_set(session_t own_peer_id)
 	return c;
 }
 
+// Same as NetworkPacket::oldForgePacket(), without copying it again when sent
+static SharedBuffer<u8> forge_packet(NetworkPacket *pkt)
+{
+	if (pkt->getCommand() == 0)
+		return SharedBuffer<u8>();
+
+	SharedBuffer<u8> data(2 + pkt->getSize());
+	writeU16(&data[0], pkt->getCommand());
+	if (pkt->getSize() > 0)
+		memcpy(&data[2], pkt->getString(0), pkt->getSize());
+	return data;
+}
+
 ConnectionCommandPtr ConnectionCommand::send(session_t peer_id, u8 channelnum,
 	NetworkPacket *pkt, bool reliable)
 {
@@ -599,7 +612,18 @@ ConnectionCommandPtr ConnectionCommand::send(session_t peer_id, u8 channelnum,
 	c->peer_id = peer_id;
 	c->channelnum = channelnum;
 	c->reliable = reliable;
-	c->data = pkt->oldForgePacket();
+	c->data = forge_packet(pkt);
+	return c;
+}
+
+ConnectionCommandPtr ConnectionCommand::sendToMany(const std::vector<session_t> &peer_ids,
+	u8 channelnum, NetworkPacket *pkt, bool reliable)
+{
+	auto c = create(CONNCMD_SEND_TO_MANY);
+	c->peer_ids = peer_ids;
+	c->channelnum = channelnum;
+	c->reliable = reliable;
+	c->data = forge_packet(pkt);
 	return c;
 }
 
@@ -609,7 +633,7 @@ ConnectionCommandPtr ConnectionCommand::ack(session_t peer_id, u8 channelnum, co
 	c->peer_id = peer_id;
 	c->channelnum = channelnum;
 	c->reliable = false;
-	data.copyTo(c->data);
+	c->data = SharedBuffer<u8>(data);
 	return c;
 }
 
@@ -620,7 +644,7 @@ ConnectionCommandPtr ConnectionCommand::createPeer(session_t peer_id, const Buff
 	c->channelnum = 0;
 	c->reliable = true;
 	c->raw = true;
-	data.copyTo(c->data);
+	c->data = SharedBuffer<u8>(data);
 	return c;
 }
 
@@ -708,11 +732,24 @@ bool Channel::putBackSequenceNumber(u16 seqnum)
 	return false;
 }
 
-void Channel::UpdateBytesSent(unsigned int bytes, unsigned int packets)
+Channel::Channel() :
+	m_congestion(std::make_unique<LossCongestionController>()),
+	m_window_size(m_congestion->getWindowSize())
+{
+}
+
+void Channel::setCongestionController(std::unique_ptr<CongestionController> cc)
+{
+	MutexAutoLock internal(m_internal_mutex);
+	m_congestion = std::move(cc);
+	m_window_size = m_congestion->getWindowSize();
+}
+
+void Channel::UpdatePacketAcked(unsigned int bytes, float rtt)
 {
 	MutexAutoLock internal(m_internal_mutex);
 	current_bytes_transfered += bytes;
-	current_packet_successful += packets;
+	m_congestion->onAck(bytes, rtt);
 }
 
 void Channel::UpdateBytesReceived(unsigned int bytes) {
@@ -730,79 +767,39 @@ void Channel::UpdateBytesLost(unsigned int bytes)
 void Channel::UpdatePacketLossCounter(unsigned int count)
 {
 	MutexAutoLock internal(m_internal_mutex);
-	current_packet_loss += count;
+	m_congestion->onLoss(count);
 }
 
 void Channel::UpdatePacketTooLateCounter()
 {
 	MutexAutoLock internal(m_internal_mutex);
-	current_packet_too_late++;
+	m_congestion->onTooLate();
 }
 
-void Channel::UpdateTimers(float dtime)
+void Channel::getCongestionStats(CongestionStats &stats)
 {
-	bpm_counter += dtime;
-	packet_loss_counter += dtime;
-
-	if (packet_loss_counter > 1.0f) {
-		packet_loss_counter -= 1.0f;
-
-		unsigned int packet_loss;
-		unsigned int packets_successful;
-		unsigned int packet_too_late;
-
-		bool reasonable_amount_of_data_transmitted = false;
-
-		{
-			MutexAutoLock internal(m_internal_mutex);
-			packet_loss = current_packet_loss;
-			packet_too_late = current_packet_too_late;
-			packets_successful = current_packet_successful;
-
-			// has half the window even been used?
-			if (current_bytes_transfered > (unsigned int) (m_window_size*512/2)) {
-				reasonable_amount_of_data_transmitted = true;
-			}
-			current_packet_loss = 0;
-			current_packet_too_late = 0;
-			current_packet_successful = 0;
-		}
-
-		// Packets too late means either packet duplication along the way
-		// or we were too fast in resending it (which should be self-regulating).
-		// Count this a signal of congestion, like packet loss.
-		packet_loss = std::min(packet_loss + packet_too_late, packets_successful);
-
-		/* dynamic window size */
-		float successful_to_lost_ratio = 0.0f;
-		bool done = false;
-
-		if (packets_successful > 0) {
-			successful_to_lost_ratio = packet_loss/packets_successful;
-		} else if (packet_loss > 0) {
-			setWindowSize(m_window_size - 10);
-			done = true;
-		}
+	const u32 in_flight = outgoing_reliables_sent.size();
+	MutexAutoLock internal(m_internal_mutex);
+	stats.window += m_congestion->getWindowSize();
+	stats.in_flight += in_flight;
+	stats.queued += m_queued_count;
+	stats.bandwidth += m_congestion->getBandwidth();
+	const float min_rtt = m_congestion->getMinRTT();
+	if (min_rtt >= 0 && (stats.min_rtt < 0 || min_rtt < stats.min_rtt))
+		stats.min_rtt = min_rtt;
+}
 
-		if (!done) {
-			if (successful_to_lost_ratio < 0.01f) {
-				/* don't even think about increasing if we didn't even
-				 * use major parts of our window */
-				if (reasonable_amount_of_data_transmitted)
-					setWindowSize(m_window_size + 100);
-			} else if (successful_to_lost_ratio < 0.05f) {
-				/* don't even think about increasing if we didn't even
-				 * use major parts of our window */
-				if (reasonable_amount_of_data_transmitted)
-					setWindowSize(m_window_size + 50);
-			} else if (successful_to_lost_ratio > 0.15f) {
-				setWindowSize(m_window_size - 100);
-			} else if (successful_to_lost_ratio > 0.1f) {
-				setWindowSize(m_window_size - 50);
-			}
-		}
+void Channel::UpdateTimers(float dtime)
+{
+	const u32 in_flight = outgoing_reliables_sent.size();
+	m_queued_count = queued_reliables.size() + queued_commands.size();
+	{
+		MutexAutoLock internal(m_internal_mutex);
+		m_congestion->step(dtime, in_flight);
+		m_window_size = m_congestion->getWindowSize();
 	}
 
+	bpm_counter += dtime;
 	if (bpm_counter > 10.0f) {
 		{
 			MutexAutoLock internal(m_internal_mutex);
@@ -979,8 +976,9 @@ void Peer::Drop()
 UDPPeer::UDPPeer(session_t id, const Address &address, Connection *connection) :
 	Peer(id, address, connection)
 {
+	const std::string cc = g_settings->get("congestion_control");
 	for (Channel &channel : channels)
-		channel.setWindowSize(START_RELIABLE_WINDOW_SIZE);
+		channel.setCongestionController(createCongestionController(cc));
 }
 
 bool UDPPeer::isTimedOut(float timeout, std::string &reason)
@@ -1503,23 +1501,40 @@ bool Connection::ReceiveTimeoutMs(NetworkPacket *pkt, u32 timeout_ms)
 	return false;
 }
 
-void Connection::Send(session_t peer_id, u8 channelnum,
-		NetworkPacket *pkt, bool reliable)
+// approximate check similar to UDPPeer::processReliableSendCommand()
+// to get nicer errors / backtraces if this happens.
+static void check_send_size(session_t peer_id, NetworkPacket *pkt, bool reliable)
 {
-	assert(channelnum < CHANNEL_COUNT); // Pre-condition
-
-	// approximate check similar to UDPPeer::processReliableSendCommand()
-	// to get nicer errors / backtraces if this happens.
 	if (reliable && pkt->getSize() > MAX_RELIABLE_WINDOW_SIZE*512) {
 		std::ostringstream oss;
 		oss << "Packet too big for window, peer_id=" << peer_id
 			<< " command=" << pkt->getCommand() << " size=" << pkt->getSize();
 		FATAL_ERROR(oss.str().c_str());
 	}
+}
+
+void Connection::Send(session_t peer_id, u8 channelnum,
+		NetworkPacket *pkt, bool reliable)
+{
+	assert(channelnum < CHANNEL_COUNT); // Pre-condition
+
+	check_send_size(peer_id, pkt, reliable);
 
 	putCommand(ConnectionCommand::send(peer_id, channelnum, pkt, reliable));
 }
 
+void Connection::SendToMany(const std::vector<session_t> &peer_ids, u8 channelnum,
+		NetworkPacket *pkt, bool reliable)
+{
+	assert(channelnum < CHANNEL_COUNT); // Pre-condition
+
+	if (peer_ids.empty())
+		return;
+	check_send_size(peer_ids.front(), pkt, reliable);
+
+	putCommand(ConnectionCommand::sendToMany(peer_ids, channelnum, pkt, reliable));
+}
+
 Address Connection::GetPeerAddress(session_t peer_id)
 {
 	PeerHelper peer = getPeerNoEx(peer_id);
@@ -1537,6 +1552,21 @@ float Connection::getPeerStat(session_t peer_id, rtt_stat_type type)
 	return peer->getStat(type);
 }
 
+bool Connection::getPeerCongestionStats(session_t peer_id, CongestionStats &stats)
+{
+	PeerHelper peer = getPeerNoEx(peer_id);
+	if (!peer)
+		return false;
+	UDPPeer *udp_peer = dynamic_cast<UDPPeer *>(&peer);
+	if (!udp_peer)
+		return false;
+
+	stats = CongestionStats();
+	for (Channel &channel : udp_peer->channels)
+		channel.getCongestionStats(stats);
+	return true;
+}
+
 float Connection::getLocalStat(rate_stat_type type)
 {
 	PeerHelper peer = getPeerNoEx(PEER_ID_SERVER);
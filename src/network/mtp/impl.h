@@ -241,10 +241,13 @@ class Connection final : public IConnection
 	void Disconnect();
 	bool ReceiveTimeoutMs(NetworkPacket *pkt, u32 timeout_ms);
 	void Send(session_t peer_id, u8 channelnum, NetworkPacket *pkt, bool reliable);
+	void SendToMany(const std::vector<session_t> &peer_ids, u8 channelnum,
+			NetworkPacket *pkt, bool reliable);
 	session_t GetPeerID() const { return m_peer_id; }
 	Address GetPeerAddress(session_t peer_id);
 	float getPeerStat(session_t peer_id, rtt_stat_type type);
 	float getLocalStat(rate_stat_type type);
+	bool getPeerCongestionStats(session_t peer_id, CongestionStats &stats);
 	u32 GetProtocolID() const { return m_protocol_id; };
 	const std::string getDesc();
 	void DisconnectPeer(session_t peer_id);
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "network/mtp/impl.h"
+#include "network/mtp/congestion.h"
+#include "util/bufferpool.h"
 
 // Constant that differentiates the protocol from random data and other protocols
 #define PROTOCOL_ID 0x4f457403
@@ -212,7 +214,8 @@ struct BufferedPacket {
 	unsigned int resend_count = 0;
 
 private:
-	std::vector<u8> m_data; // Data of the packet, including headers
+	// Data of the packet, including headers
+	std::vector<u8, bufferpool::Allocator<u8>> m_data;
 };
 
 
@@ -320,7 +323,7 @@ enum ConnectionCommandType{
 	CONNCMD_DISCONNECT,
 	CONNCMD_DISCONNECT_PEER,
 	CONNCMD_SEND,
-	CONNCMD_SEND_TO_ALL,
+	CONNCMD_SEND_TO_MANY,
 	CONCMD_ACK,
 	CONCMD_CREATE_PEER,
 	CONNCMD_RESEND_ONE,
@@ -333,8 +336,10 @@ struct ConnectionCommand
 	const ConnectionCommandType type;
 	Address address;
 	session_t peer_id = PEER_ID_INEXISTENT;
+	// recipients of CONNCMD_SEND_TO_MANY
+	std::vector<session_t> peer_ids;
 	u8 channelnum = 0;
-	Buffer<u8> data;
+	SharedBuffer<u8> data;
 	bool reliable = false;
 	bool raw = false;
 
@@ -347,6 +352,8 @@ struct ConnectionCommand
 	static ConnectionCommandPtr resend_one(session_t peer_id);
 	static ConnectionCommandPtr peer_id_set(session_t own_peer_id);
 	static ConnectionCommandPtr send(session_t peer_id, u8 channelnum, NetworkPacket *pkt, bool reliable);
+	static ConnectionCommandPtr sendToMany(const std::vector<session_t> &peer_ids,
+		u8 channelnum, NetworkPacket *pkt, bool reliable);
 	static ConnectionCommandPtr ack(session_t peer_id, u8 channelnum, const Buffer<u8> &data);
 	static ConnectionCommandPtr createPeer(session_t peer_id, const Buffer<u8> &data);
 
@@ -357,25 +364,6 @@ struct ConnectionCommand
 	static ConnectionCommandPtr create(ConnectionCommandType type);
 };
 
-/*
- * Window sizes to use, in packets (not bytes!).
- * 0xFFFF is theoretical maximum. don't think about
- * touching it, the less you're away from it the more likely data corruption
- * will occur
- *
- * Note: window sizes directly translate to maximum possible throughput, e.g.
- *       (2048 * 512 bytes) / 33ms = 15 MiB/s
- */
-
-// Due to backwards compatibility we have different window sizes for what we'll
-// accept from peers vs. what we use for sending.
-#define MAX_RELIABLE_WINDOW_SIZE 0x8000
-#define MAX_RELIABLE_WINDOW_SIZE_SEND 2048
-/* starting value for window size */
-#define START_RELIABLE_WINDOW_SIZE 64
-/* minimum value for window size */
-#define MIN_RELIABLE_WINDOW_SIZE 32
-
 class Channel
 {
 
@@ -405,12 +393,15 @@ class Channel
 
 	IncomingSplitBuffer incoming_splits;
 
-	Channel() = default;
+	Channel();
 	~Channel() = default;
 
+	void setCongestionController(std::unique_ptr<CongestionController> cc);
+
 	void UpdatePacketLossCounter(unsigned int count);
 	void UpdatePacketTooLateCounter();
-	void UpdateBytesSent(unsigned int bytes,unsigned int packages=1);
+	// A reliable packet was acknowledged, rtt is negative if unknown
+	void UpdatePacketAcked(unsigned int bytes, float rtt);
 	void UpdateBytesLost(unsigned int bytes);
 	void UpdateBytesReceived(unsigned int bytes);
 
@@ -440,25 +431,22 @@ class Channel
 
 	u16 getWindowSize() const { return m_window_size; };
 
-	void setWindowSize(long size)
-	{
-		m_window_size = (u16)rangelim(size, MIN_RELIABLE_WINDOW_SIZE, MAX_RELIABLE_WINDOW_SIZE_SEND);
-	}
+	void getCongestionStats(CongestionStats &stats);
 
 private:
 	std::mutex m_internal_mutex;
-	u16 m_window_size = MIN_RELIABLE_WINDOW_SIZE;
+	std::unique_ptr<CongestionController> m_congestion;
+	// copy of the controller's window that can be read without locking
+	std::atomic<u16> m_window_size;
+	// size of the queues at the last UpdateTimers(), which only the send
+	// thread may access
+	std::atomic<u32> m_queued_count{0};
 
 	u16 next_incoming_seqnum = SEQNUM_INITIAL;
 
 	u16 next_outgoing_seqnum = SEQNUM_INITIAL;
 	u16 next_outgoing_split_seqnum = SEQNUM_INITIAL;
 
-	unsigned int current_packet_loss = 0;
-	unsigned int current_packet_too_late = 0;
-	unsigned int current_packet_successful = 0;
-	float packet_loss_counter = 0.0f;
-
 	unsigned int current_bytes_transfered = 0;
 	unsigned int current_bytes_received = 0;
 	unsigned int current_bytes_lost = 0;
@@ -123,6 +123,8 @@ void *ConnectionSendThread::run()
 		/* send queued packets */
 		sendPackets(dtime, calculate_quota());
 
+		flushSends();
+
 		END_DEBUG_EXCEPTION_HANDLER
 	}
 
@@ -239,7 +241,7 @@ void ConnectionSendThread::runTimeouts(float dtime, u32 peer_packet_quota)
 				m_iteration_packets_avaialble = 0;
 
 			for (const auto &k : timed_outs)
-				resendReliable(channel, k.get(), resend_timeout);
+				resendReliable(channel, k, resend_timeout);
 
 			auto ws_old = channel.getWindowSize();
 			channel.UpdateTimers(dtime);
@@ -269,9 +271,10 @@ void ConnectionSendThread::runTimeouts(float dtime, u32 peer_packet_quota)
 	}
 }
 
-void ConnectionSendThread::resendReliable(Channel &channel, const BufferedPacket *k, float resend_timeout)
+void ConnectionSendThread::resendReliable(Channel &channel,
+	const ConstSharedPtr<BufferedPacket> &k, float resend_timeout)
 {
-	assert(k);
+	assert(k.get());
 	u8 channelnum = readChannel(k->data);
 	u16 seqnum = k->getSeqnum();
 
@@ -296,19 +299,32 @@ void ConnectionSendThread::resendReliable(Channel &channel, const BufferedPacket
 	// lost or really takes more time to transmit
 }
 
-void ConnectionSendThread::rawSend(const BufferedPacket *p)
+void ConnectionSendThread::rawSend(const ConstSharedPtr<BufferedPacket> &p)
 {
-	assert(p);
-	try {
-		m_connection->m_udpSocket.Send(p->address, p->data, p->size());
-		//LOG(dout_con << m_connection->getDesc()
-		//	<< " rawSend: " << p->size()
-		//	<< " bytes sent" << std::endl);
-	} catch (SendFailedException &e) {
+	assert(p.get());
+	// Keeps the packet alive even if it gets acknowledged in the meantime
+	m_send_batch.push_back(p);
+	if (m_send_batch.size() >= UDPSocket::MAX_BATCH)
+		flushSends();
+}
+
+void ConnectionSendThread::flushSends()
+{
+	if (m_send_batch.empty())
+		return;
+
+	std::vector<UDPSocket::OutPacket> packets;
+	packets.reserve(m_send_batch.size());
+	for (const auto &p : m_send_batch)
+		packets.push_back({&p->address, p->data, (int)p->size()});
+
+	int failed = m_connection->m_udpSocket.SendMany(packets.data(), packets.size());
+	if (failed > 0) {
 		LOG(derr_con << m_connection->getDesc()
-			<< "SendFailedException: " << e.what() << " to "
-			<< p->address.serializeString() << std::endl);
+			<< "Failed to send " << failed << " of " << packets.size()
+			<< " packets" << std::endl);
 	}
+	m_send_batch.clear();
 }
 
 void ConnectionSendThread::sendAsPacketReliable(BufferedPacketPtr &p, Channel *channel)
@@ -328,7 +344,7 @@ void ConnectionSendThread::sendAsPacketReliable(BufferedPacketPtr &p, Channel *c
 	}
 
 	// Send the packet
-	rawSend(p.get());
+	rawSend(p);
 }
 
 bool ConnectionSendThread::rawSendAsPacket(session_t peer_id, u8 channelnum,
@@ -381,7 +397,7 @@ bool ConnectionSendThread::rawSendAsPacket(session_t peer_id, u8 channelnum,
 		channelnum);
 
 	// Send the packet
-	rawSend(p.get());
+	rawSend(p);
 	return true;
 }
 
@@ -401,10 +417,10 @@ void ConnectionSendThread::processReliableCommand(ConnectionCommandPtr &c)
 			sendReliable(c);
 			return;
 
-		case CONNCMD_SEND_TO_ALL:
+		case CONNCMD_SEND_TO_MANY:
 			LOG(dout_con << m_connection->getDesc()
-				<< "UDP processing CONNCMD_SEND_TO_ALL" << std::endl);
-			sendToAllReliable(c);
+				<< "UDP processing reliable CONNCMD_SEND_TO_MANY" << std::endl);
+			sendToManyReliable(c);
 			return;
 
 		case CONCMD_CREATE_PEER:
@@ -428,7 +444,7 @@ void ConnectionSendThread::processReliableCommand(ConnectionCommandPtr &c)
 			auto list = channel.outgoing_reliables_sent.getResend(0, 1);
 
 			if (!list.empty())
-				resendReliable(channel, list.front().get(), -1);
+				resendReliable(channel, list.front(), -1);
 
 			return;
 		}
@@ -486,10 +502,10 @@ void ConnectionSendThread::processNonReliableCommand(ConnectionCommandPtr &c_ptr
 				<< " UDP processing CONNCMD_SEND" << std::endl);
 			send(c.peer_id, c.channelnum, c.data);
 			return;
-		case CONNCMD_SEND_TO_ALL:
+		case CONNCMD_SEND_TO_MANY:
 			LOG(dout_con << m_connection->getDesc()
-				<< " UDP processing CONNCMD_SEND_TO_ALL" << std::endl);
-			sendToAll(c.channelnum, c.data);
+				<< " UDP processing CONNCMD_SEND_TO_MANY" << std::endl);
+			sendToMany(c.peer_ids, c.channelnum, c.data);
 			return;
 		case CONCMD_ACK:
 			LOG(dout_con << m_connection->getDesc()
@@ -645,20 +661,18 @@ void ConnectionSendThread::sendReliable(ConnectionCommandPtr &c)
 	peer->PutReliableSendCommand(c, m_max_packet_size);
 }
 
-void ConnectionSendThread::sendToAll(u8 channelnum, const SharedBuffer<u8> &data)
+void ConnectionSendThread::sendToMany(const std::vector<session_t> &peer_ids,
+	u8 channelnum, const SharedBuffer<u8> &data)
 {
-	std::vector<session_t> peerids = m_connection->getPeerIDs();
-
-	for (session_t peerid : peerids) {
+	for (session_t peerid : peer_ids) {
 		send(peerid, channelnum, data);
 	}
 }
 
-void ConnectionSendThread::sendToAllReliable(ConnectionCommandPtr &c)
+// The peers share the command, its data is only read
+void ConnectionSendThread::sendToManyReliable(ConnectionCommandPtr &c)
 {
-	std::vector<session_t> peerids = m_connection->getPeerIDs();
-
-	for (session_t peerid : peerids) {
+	for (session_t peerid : c->peer_ids) {
 		PeerHelper peer = m_connection->getPeerNoEx(peerid);
 
 		if (!peer)
@@ -844,7 +858,8 @@ void *ConnectionReceiveThread::run()
 	// theoretical reliable upper boundary of a udp packet for all IPv6 enabled
 	// infrastructure
 	const unsigned int packet_maxsize = 1500;
-	SharedBuffer<u8> packetdata(packet_maxsize);
+	m_recv_buffer.resize(packet_maxsize * UDPSocket::MAX_BATCH);
+	m_recv_packets.resize(UDPSocket::MAX_BATCH);
 
 	bool packet_queued = true;
 
@@ -866,7 +881,7 @@ void *ConnectionReceiveThread::run()
 #endif
 
 		/* receive packets */
-		receive(packetdata, packet_queued);
+		receive(packet_queued);
 
 #ifdef DEBUG_CONNECTION_KBPS
 		debug_print_timer += dtime;
@@ -926,159 +941,173 @@ void *ConnectionReceiveThread::run()
 }
 
 // Receive packets from the network and buffers and create ConnectionEvents
-void ConnectionReceiveThread::receive(SharedBuffer<u8> &packetdata,
-		bool &packet_queued)
+void ConnectionReceiveThread::receive(bool &packet_queued)
 {
-	try {
-		// First, see if there any buffered packets we can process now
-		if (packet_queued) {
-			session_t peer_id;
-			SharedBuffer<u8> resultdata;
-			while (true) {
-				try {
-					if (!getFromBuffers(peer_id, resultdata))
-						break;
-
-					m_connection->putEvent(ConnectionEvent::dataReceived(peer_id, resultdata));
-				}
-				catch (ProcessedSilentlyException &e) {
-					/* try reading again */
-				}
+	// First, see if there any buffered packets we can process now
+	if (packet_queued) {
+		session_t peer_id;
+		SharedBuffer<u8> resultdata;
+		while (true) {
+			try {
+				if (!getFromBuffers(peer_id, resultdata))
+					break;
+
+				m_connection->putEvent(ConnectionEvent::dataReceived(peer_id, resultdata));
+			}
+			catch (ProcessedSilentlyException &e) {
+				/* try reading again */
+			}
+			catch (InvalidIncomingDataException &e) {
+				break;
 			}
-			packet_queued = false;
 		}
+		packet_queued = false;
+	}
 
-		// Call Receive() to wait for incoming data
-		Address sender;
-		s32 received_size = m_connection->m_udpSocket.Receive(sender,
-			*packetdata, packetdata.getSize());
-		if (received_size < 0)
-			return;
+	// Wait for incoming data and take everything that is there
+	const size_t packet_maxsize = m_recv_buffer.size() / m_recv_packets.size();
+	for (size_t i = 0; i < m_recv_packets.size(); i++) {
+		m_recv_packets[i].data = &m_recv_buffer[i * packet_maxsize];
+		m_recv_packets[i].size = packet_maxsize;
+	}
+	int count = m_connection->m_udpSocket.ReceiveMany(m_recv_packets.data(),
+		m_recv_packets.size());
 
-		if ((received_size < BASE_HEADER_SIZE) ||
-				(readU32(&packetdata[0]) != m_connection->GetProtocolID())) {
-			LOG(derr_con << m_connection->getDesc()
-				<< "Receive(): Invalid incoming packet, "
-				<< "size: " << received_size
-				<< ", protocol: "
-				<< ((received_size >= 4) ? readU32(&packetdata[0]) : -1)
-				<< std::endl);
-			return;
+	for (int i = 0; i < count; i++) {
+		const UDPSocket::InPacket &p = m_recv_packets[i];
+		try {
+			processDatagram(p.sender, (const u8 *)p.data, p.size, packet_queued);
+		}
+		catch (InvalidIncomingDataException &e) {
 		}
+	}
+}
 
-		session_t peer_id = readPeerId(*packetdata);
-		u8 channelnum = readChannel(*packetdata);
+void ConnectionReceiveThread::processDatagram(const Address &sender,
+		const u8 *data, s32 received_size, bool &packet_queued)
+{
+	if ((received_size < BASE_HEADER_SIZE) ||
+			(readU32(&data[0]) != m_connection->GetProtocolID())) {
+		LOG(derr_con << m_connection->getDesc()
+			<< "Receive(): Invalid incoming packet, "
+			<< "size: " << received_size
+			<< ", protocol: "
+			<< ((received_size >= 4) ? readU32(&data[0]) : -1)
+			<< std::endl);
+		return;
+	}
 
-		if (channelnum >= CHANNEL_COUNT) {
-			LOG(derr_con << m_connection->getDesc()
-				<< "Receive(): Invalid channel " << (int)channelnum << std::endl);
-			return;
-		}
+	session_t peer_id = readPeerId(data);
+	u8 channelnum = readChannel(data);
 
-		const bool knew_peer_id = peer_id != PEER_ID_INEXISTENT;
-
-		if (!m_connection->ConnectedToServer()) {
-			// Try to identify peer by sender address
-			if (peer_id == PEER_ID_INEXISTENT) {
-				peer_id = m_connection->lookupPeer(sender);
-				if (peer_id != PEER_ID_INEXISTENT) {
-					/* During join it can happen that the CONTROLTYPE_SET_PEER_ID
-					 * packet is lost. Since resends are not active at this stage
-					 * we need to remind the peer manually. */
-					m_connection->doResendOne(peer_id);
-				}
-			}
+	if (channelnum >= CHANNEL_COUNT) {
+		LOG(derr_con << m_connection->getDesc()
+			<< "Receive(): Invalid channel " << (int)channelnum << std::endl);
+		return;
+	}
 
-			// Someone new is trying to talk to us. Add them.
-			if (peer_id == PEER_ID_INEXISTENT) {
-				auto &l = m_new_peer_ratelimit;
-				l.tick();
-				if (++l.counter > MAX_NEW_PEERS_PER_SEC) {
-					if (!l.logged) {
-						warningstream << m_connection->getDesc()
-							<< "Receive(): More than " << MAX_NEW_PEERS_PER_SEC
-							<< " new clients within 1s. Throttling." << std::endl;
-					}
-					l.logged = true;
-					// We simply drop the packet, the client can try again.
-				} else {
-					peer_id = m_connection->createPeer(sender, 0);
-				}
+	const bool knew_peer_id = peer_id != PEER_ID_INEXISTENT;
+
+	if (!m_connection->ConnectedToServer()) {
+		// Try to identify peer by sender address
+		if (peer_id == PEER_ID_INEXISTENT) {
+			peer_id = m_connection->lookupPeer(sender);
+			if (peer_id != PEER_ID_INEXISTENT) {
+				/* During join it can happen that the CONTROLTYPE_SET_PEER_ID
+				 * packet is lost. Since resends are not active at this stage
+				 * we need to remind the peer manually. */
+				m_connection->doResendOne(peer_id);
 			}
 		}
 
-		PeerHelper peer = m_connection->getPeerNoEx(peer_id);
-		if (!peer) {
-			LOG(dout_con << m_connection->getDesc()
-				<< " got packet from unknown peer_id: "
-				<< peer_id << " Ignoring." << std::endl);
-			return;
+		// Someone new is trying to talk to us. Add them.
+		if (peer_id == PEER_ID_INEXISTENT) {
+			auto &l = m_new_peer_ratelimit;
+			l.tick();
+			if (++l.counter > MAX_NEW_PEERS_PER_SEC) {
+				if (!l.logged) {
+					warningstream << m_connection->getDesc()
+						<< "Receive(): More than " << MAX_NEW_PEERS_PER_SEC
+						<< " new clients within 1s. Throttling." << std::endl;
+				}
+				l.logged = true;
+				// We simply drop the packet, the client can try again.
+			} else {
+				peer_id = m_connection->createPeer(sender, 0);
+			}
 		}
+	}
 
-		// Validate peer address
+	PeerHelper peer = m_connection->getPeerNoEx(peer_id);
+	if (!peer) {
+		LOG(dout_con << m_connection->getDesc()
+			<< " got packet from unknown peer_id: "
+			<< peer_id << " Ignoring." << std::endl);
+		return;
+	}
 
-		if (sender != peer->getAddress()) {
-			LOG(derr_con << m_connection->getDesc()
-				<< " Peer " << peer_id << " sending from different address."
-				" Ignoring." << std::endl);
-			return;
-		}
+	// Validate peer address
 
-		if (knew_peer_id) {
-			peer->SetFullyOpen();
-			// Setup phase has a fixed timeout
-			peer->ResetTimeout();
-		} else if (!peer->isHalfOpen()) {
-			// If the peer talks to us without a peer ID when it has done so
-			// before something is definitely fishy.
-			LOG(derr_con << m_connection->getDesc()
-				<< " Peer " << peer_id << " sending without peer id?!"
-				" Ignoring." << std::endl);
-			return;
-		}
+	if (sender != peer->getAddress()) {
+		LOG(derr_con << m_connection->getDesc()
+			<< " Peer " << peer_id << " sending from different address."
+			" Ignoring." << std::endl);
+		return;
+	}
 
-		auto *udpPeer = dynamic_cast<UDPPeer *>(&peer);
-		if (!udpPeer) {
-			LOG(derr_con << m_connection->getDesc()
-				<< "Receive(): peer_id=" << peer_id << " isn't an UDPPeer?!"
-				" Ignoring." << std::endl);
-			return;
-		}
-		Channel *channel = &udpPeer->channels[channelnum];
+	if (knew_peer_id) {
+		peer->SetFullyOpen();
+		// Setup phase has a fixed timeout
+		peer->ResetTimeout();
+	} else if (!peer->isHalfOpen()) {
+		// If the peer talks to us without a peer ID when it has done so
+		// before something is definitely fishy.
+		LOG(derr_con << m_connection->getDesc()
+			<< " Peer " << peer_id << " sending without peer id?!"
+			" Ignoring." << std::endl);
+		return;
+	}
 
-		channel->UpdateBytesReceived(received_size);
+	auto *udpPeer = dynamic_cast<UDPPeer *>(&peer);
+	if (!udpPeer) {
+		LOG(derr_con << m_connection->getDesc()
+			<< "Receive(): peer_id=" << peer_id << " isn't an UDPPeer?!"
+			" Ignoring." << std::endl);
+		return;
+	}
+	Channel *channel = &udpPeer->channels[channelnum];
 
-		// Throw the received packet to channel->processPacket()
+	channel->UpdateBytesReceived(received_size);
 
-		// Make a new SharedBuffer from the data without the base headers
-		SharedBuffer<u8> strippeddata(received_size - BASE_HEADER_SIZE);
-		memcpy(*strippeddata, &packetdata[BASE_HEADER_SIZE],
-			strippeddata.getSize());
+	// Throw the received packet to channel->processPacket()
 
-		try {
-			// Process it (the result is some data with no headers made by us)
-			SharedBuffer<u8> resultdata = processPacket
-				(channel, strippeddata, peer_id, channelnum, false);
+	// Make a new SharedBuffer from the data without the base headers
+	SharedBuffer<u8> strippeddata(received_size - BASE_HEADER_SIZE);
+	memcpy(*strippeddata, &data[BASE_HEADER_SIZE],
+		strippeddata.getSize());
 
-			LOG(dout_con << m_connection->getDesc()
-				<< " ProcessPacket from peer_id: " << peer_id
-				<< ", channel: " << (u32)channelnum << ", returned "
-				<< resultdata.getSize() << " bytes" << std::endl);
+	try {
+		// Process it (the result is some data with no headers made by us)
+		SharedBuffer<u8> resultdata = processPacket
+			(channel, strippeddata, peer_id, channelnum, false);
 
-			m_connection->putEvent(ConnectionEvent::dataReceived(peer_id, resultdata));
-		}
-		catch (ProcessedSilentlyException &e) {
-		}
-		catch (ProcessedQueued &e) {
-			// we set it to true anyway (see below)
-		}
+		LOG(dout_con << m_connection->getDesc()
+			<< " ProcessPacket from peer_id: " << peer_id
+			<< ", channel: " << (u32)channelnum << ", returned "
+			<< resultdata.getSize() << " bytes" << std::endl);
 
-		/* Every time we receive a packet it can happen that a previously
-		 * buffered packet is now ready to process. */
-		packet_queued = true;
+		m_connection->putEvent(ConnectionEvent::dataReceived(peer_id, resultdata));
+	}
+	catch (ProcessedSilentlyException &e) {
 	}
-	catch (InvalidIncomingDataException &e) {
+	catch (ProcessedQueued &e) {
+		// we set it to true anyway (see below)
 	}
+
+	/* Every time we receive a packet it can happen that a previously
+	 * buffered packet is now ready to process. */
+	packet_queued = true;
+
 }
 
 bool ConnectionReceiveThread::getFromBuffers(session_t &peer_id, SharedBuffer<u8> &dst)
@@ -1201,29 +1230,27 @@ SharedBuffer<u8> ConnectionReceiveThread::handlePacketType_Control(Channel *chan
 			BufferedPacketPtr p = channel->outgoing_reliables_sent.popSeqnum(seqnum);
 
 			// the rtt calculation will be a bit off for re-sent packets but that's okay
+			float rtt = -1;
 			{
 				// Get round trip time
 				u64 current_time = porting::getTimeMs();
 
 				// an overflow is quite unlikely but as it'd result in major
 				// rtt miscalculation we handle it here
-				if (current_time > p->absolute_send_time) {
-					float rtt = (current_time - p->absolute_send_time) / 1000.0f;
-
-					// Let peer calculate stuff according to it
-					// (avg_rtt and resend_timeout)
-					dynamic_cast<UDPPeer *>(peer)->reportRTT(rtt);
-				} else if (p->totaltime > 0) {
-					float rtt = p->totaltime;
-
-					// Let peer calculate stuff according to it
-					// (avg_rtt and resend_timeout)
-					dynamic_cast<UDPPeer *>(peer)->reportRTT(rtt);
-				}
+				if (current_time > p->absolute_send_time)
+					rtt = (current_time - p->absolute_send_time) / 1000.0f;
+				else if (p->totaltime > 0)
+					rtt = p->totaltime;
+
+				// Let peer calculate stuff according to it
+				// (avg_rtt and resend_timeout)
+				dynamic_cast<UDPPeer *>(peer)->reportRTT(rtt);
 			}
 
-			// put bytes for max bandwidth calculation
-			channel->UpdateBytesSent(p->size(), 1);
+			// put bytes for max bandwidth calculation, the congestion
+			// controller only gets exact round trip times
+			channel->UpdatePacketAcked(p->size(),
+				p->resend_count == 0 ? rtt : -1.0f);
 			if (channel->outgoing_reliables_sent.size() == 0)
 				m_connection->TriggerSend();
 		} catch (NotFoundException &e) {
@@ -59,8 +59,12 @@ class ConnectionSendThread : public Thread
 
 private:
 	void runTimeouts(float dtime, u32 peer_packet_quota);
-	void resendReliable(Channel &channel, const BufferedPacket *k, float resend_timeout);
-	void rawSend(const BufferedPacket *p);
+	void resendReliable(Channel &channel, const ConstSharedPtr<BufferedPacket> &k,
+		float resend_timeout);
+	// Queues the packet for flushSends()
+	void rawSend(const ConstSharedPtr<BufferedPacket> &p);
+	// Sends the packets queued by rawSend()
+	void flushSends();
 	bool rawSendAsPacket(session_t peer_id, u8 channelnum,
 			const SharedBuffer<u8> &data, bool reliable);
 
@@ -73,8 +77,9 @@ class ConnectionSendThread : public Thread
 	void fix_peer_id(session_t own_peer_id);
 	void send(session_t peer_id, u8 channelnum, const SharedBuffer<u8> &data);
 	void sendReliable(ConnectionCommandPtr &c);
-	void sendToAll(u8 channelnum, const SharedBuffer<u8> &data);
-	void sendToAllReliable(ConnectionCommandPtr &c);
+	void sendToMany(const std::vector<session_t> &peer_ids, u8 channelnum,
+		const SharedBuffer<u8> &data);
+	void sendToManyReliable(ConnectionCommandPtr &c);
 
 	void sendPackets(float dtime, u32 peer_packet_quota);
 
@@ -89,6 +94,7 @@ class ConnectionSendThread : public Thread
 	unsigned int m_max_packet_size;
 	float m_timeout;
 	std::queue<OutgoingPacket> m_outgoing_queue;
+	std::vector<ConstSharedPtr<BufferedPacket>> m_send_batch;
 	Semaphore m_send_sleep_semaphore;
 
 	unsigned int m_iteration_packets_avaialble;
@@ -110,7 +116,9 @@ class ConnectionReceiveThread : public Thread
 	}
 
 private:
-	void receive(SharedBuffer<u8> &packetdata, bool &packet_queued);
+	void receive(bool &packet_queued);
+	void processDatagram(const Address &sender, const u8 *data, s32 size,
+			bool &packet_queued);
 
 	// Returns next data from a buffer if possible
 	// If found, returns true; if not, false.
@@ -172,5 +180,9 @@ class ConnectionReceiveThread : public Thread
 	Connection *m_connection = nullptr;
 
 	RateLimitHelper m_new_peer_ratelimit;
+
+	// Buffers for the packets of one ReceiveMany() call
+	std::vector<u8> m_recv_buffer;
+	std::vector<UDPSocket::InPacket> m_recv_packets;
 };
 }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "util/bufferpool.h"
 #include "util/pointer.h" // Buffer<T>
 #include "irrlichttypes_bloated.h"
 #include "networkprotocol.h"
@@ -134,7 +135,8 @@ class NetworkPacket
 		}
 	}
 
-	std::vector<u8> m_data;
+	// pooled as packets are short-lived
+	std::vector<u8, bufferpool::Allocator<u8>> m_data;
 	u32 m_datasize = 0;
 	u32 m_read_offset = 0; // read and write offset
 	u16 m_command = 0;
@@ -65,10 +65,22 @@
 	PROTOCOL VERSION 48
 		Add compression to some existing packets
 		[scheduled bump for 5.12.0]
+	PROTOCOL VERSION 49
+		Add TOCLIENT_NODES_CHANGED
+		Add TOCLIENT_BUNDLE
+		Add TOCLIENT_SHOW_FORMSPEC_DELTA
+		Add TOCLIENT_BLOCK_HASH, TOSERVER_REQUEST_BLOCKS and flags
+		to TOSERVER_CLIENT_READY
+		Add TOCLIENT_OBJECT_MOVEMENT and TOSERVER_PLAYER_MOVE
+		Add TOCLIENT_PARTICLE_DEFINITION and TOCLIENT_SPAWN_DEFINED_PARTICLE
+		Add TOCLIENT_COMPRESSED_BUNDLE and network compression modes to
+		TOSERVER_INIT and TOCLIENT_HELLO
+		Add TOCLIENT_TRANSFER
+		[scheduled bump for 5.13.0]
 */
 
 // Note: Also update core.protocol_versions in builtin when bumping
-const u16 LATEST_PROTOCOL_VERSION = 48;
+const u16 LATEST_PROTOCOL_VERSION = 49;
 
 // See also formspec [Version History] in doc/lua_api.md
 const u16 FORMSPEC_API_VERSION = 9;
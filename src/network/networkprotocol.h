@@ -33,7 +33,7 @@ enum ToClientCommand : u16
 		Sent after TOSERVER_INIT.
 
 		u8 deployed serialization version
-		u16 unused (network compression, never implemeneted)
+		u16 network compression mode (NetProtoCompressionMode, at most one)
 		u16 deployed protocol version
 		u32 supported auth methods
 		std::string unused (used to be username)
@@ -85,6 +85,53 @@ enum ToClientCommand : u16
 		v3s16 position
 	*/
 
+	TOCLIENT_NODES_CHANGED = 0x23,
+	/*
+		Changes nodes of a block that the client already has.
+		Clients update the lighting themselves, like for TOCLIENT_ADDNODE.
+
+		v3s16 block position
+		u16 count
+		for each changed node:
+			u16 index: (z * MAP_BLOCKSIZE + y) * MAP_BLOCKSIZE + x
+			u16 param0
+			u8 param1
+			u8 param2
+			u8 keep_metadata
+	*/
+
+	TOCLIENT_BLOCK_HASH = 0x24,
+	/*
+		Sent instead of TOCLIENT_BLOCKDATA to clients that keep a block cache.
+		Clients answer with TOSERVER_REQUEST_BLOCKS if they don't have
+		a block with this hash.
+
+		v3s16 position
+		std::string SHA-1 of the serialized MapBlock
+	*/
+
+	TOCLIENT_OBJECT_MOVEMENT = 0x25,
+	/*
+		Compact form of the unreliable AO_CMD_UPDATE_POSITION messages,
+		sent instead of them in TOCLIENT_ACTIVE_OBJECT_MESSAGES.
+
+		u16 sequence number, counting up per packet, never 0
+		for all objects
+		{
+			u16 id
+			u8 flags (MOVEMENT_*)
+			v3s32 position * 100
+			v3s16 velocity * MOVEMENT_SPEED_SCALE
+			if flags & MOVEMENT_ACCELERATION:
+				v3s16 acceleration * MOVEMENT_SPEED_SCALE
+			v3u16 rotation, 65536 = 360 degrees
+			u16 update interval in ms
+		}
+
+		Clients ignore the update of an object if a packet with a higher
+		sequence number already updated it.
+	*/
+
 	TOCLIENT_INVENTORY = 0x27,
 	/*
 		serialized inventory
@@ -654,6 +701,29 @@ enum ToClientCommand : u16
 		v3f added_pos
 	*/
 
+	TOCLIENT_BUNDLE = 0x5e,
+	/*
+		Small packets of one step sent together. They are handled in order
+		as if they were received one by one, bundles can't be nested.
+
+		for each packet:
+			u16 len
+			u8[len] packet: u16 command, data
+	*/
+
+	TOCLIENT_SHOW_FORMSPEC_DELTA = 0x5f,
+	/*
+		The formspec is the last one sent with TOCLIENT_SHOW_FORMSPEC or this
+		packet, with everything between the prefix and the suffix replaced.
+
+		u16 len
+		u8[len] formname
+		u32 prefix length
+		u32 suffix length
+		u32 len
+		u8[len] new middle part
+	*/
+
 	TOCLIENT_SRP_BYTES_S_B = 0x60,
 	/*
 		Belonging to AUTH_MECHANISM_SRP.
@@ -692,7 +762,52 @@ enum ToClientCommand : u16
 			f32 center_weight_power
 	*/
 
-	TOCLIENT_NUM_MSG_TYPES = 0x64,
+	TOCLIENT_PARTICLE_DEFINITION = 0x64,
+	/*
+		Stores the parameters of particles that don't change between spawns,
+		replacing a previous definition with the same id.
+
+		u16 id
+		serialized ParticleParameters without the fields of
+		TOCLIENT_SPAWN_DEFINED_PARTICLE
+	*/
+
+	TOCLIENT_SPAWN_DEFINED_PARTICLE = 0x65,
+	/*
+		Like TOCLIENT_SPAWN_PARTICLE, with the other parameters taken from
+		a TOCLIENT_PARTICLE_DEFINITION.
+
+		u16 id
+		v3f pos
+		v3f velocity
+		v3f acceleration
+		f32 expirationtime
+		f32 size
+	*/
+
+	TOCLIENT_COMPRESSED_BUNDLE = 0x66,
+	/*
+		A reliable TOCLIENT_BUNDLE, compressed if NETPROTO_COMPRESSION_ZSTD_STREAM
+		was chosen in TOCLIENT_HELLO. Each channel has its own zstd stream,
+		which the bundles of the channel are appended to in the order they
+		are sent.
+
+		u8 channel
+		u8[] zstd stream data, flushed at the end of the bundle
+	*/
+
+	TOCLIENT_TRANSFER = 0x67,
+	/*
+		The player was saved and continues on another server that shares
+		the world's player and auth databases. The server disconnects the
+		client afterwards, which then connects to the given server with the
+		same name and password.
+
+		std::string address
+		u16 port
+	*/
+
+	TOCLIENT_NUM_MSG_TYPES = 0x68,
 };
 
 enum ToServerCommand : u16
@@ -702,7 +817,7 @@ enum ToServerCommand : u16
 		Sent first after connected.
 
 		u8 serialization version (=SER_FMT_VER_HIGHEST_READ)
-		u16 unused (supported network compression modes, never implemeneted)
+		u16 supported network compression modes (NetProtoCompressionMode)
 		u16 minimum supported network protocol version
 		u16 maximum supported network protocol version
 		std::string player name
@@ -734,6 +849,24 @@ enum ToServerCommand : u16
 	 	std::string message
 	 */
 
+	TOSERVER_PLAYER_MOVE = 0x22,
+	/*
+		Compact form of TOSERVER_PLAYERPOS.
+		Servers ignore it if they got one with a higher sequence number.
+
+		u16 sequence number, counting up per packet
+		v3s32 position*100
+		v3s16 speed * MOVEMENT_SPEED_SCALE
+		s16 pitch*100
+		u16 yaw*100
+		u16 keyPressed
+		u8 fov*80
+		u8 ceil(wanted_range / MAP_BLOCKSIZE)
+		u8 camera_inverted (bool)
+		u8 movement_speed*255
+		s16 movement_direction*10000
+	*/
+
 	TOSERVER_PLAYERPOS = 0x23,
 	/*
 		v3s32 position*100
@@ -766,6 +899,18 @@ enum ToServerCommand : u16
 		...
 	*/
 
+	TOSERVER_REQUEST_BLOCKS = 0x26,
+	/*
+		Asks for the full data of blocks that were announced with
+		TOCLIENT_BLOCK_HASH but aren't in the client's cache.
+
+		[0] u16 command
+		[2] u8 count
+		[3] v3s16 pos_0
+		[3+6] v3s16 pos_1
+		...
+	*/
+
 	TOSERVER_INVENTORY_ACTION = 0x31,
 	/*
 		See InventoryAction in inventorymanager.h
@@ -862,6 +1007,8 @@ enum ToServerCommand : u16
 		u8 reserved
 		u16 len
 		u8[len] full_version_string
+		u16 formspec_version
+		u8 flags (CLIENT_READY_*)
 	*/
 
 	TOSERVER_FIRST_SRP = 0x50,
@@ -941,6 +1088,30 @@ enum PlayerListModifer : u8
 	PLAYER_LIST_REMOVE,
 };
 
+enum MovementFlags : u8 {
+	MOVEMENT_INTERPOLATE = 0x01,
+	MOVEMENT_END_POSITION = 0x02,
+	MOVEMENT_ACCELERATION = 0x04,
+};
+
+// Speeds in TOCLIENT_OBJECT_MOVEMENT and TOSERVER_PLAYER_MOVE are in
+// 1/16 BS per second, up to about 2000 BS per second
+constexpr f32 MOVEMENT_SPEED_SCALE = 16.0f;
+
+enum ClientReadyFlags : u8 {
+	// Client keeps a block cache and wants TOCLIENT_BLOCK_HASH
+	CLIENT_READY_BLOCK_CACHE = 0x01,
+};
+
+enum NetProtoCompressionMode : u16 {
+	// Reliable bundles are sent as TOCLIENT_COMPRESSED_BUNDLE
+	NETPROTO_COMPRESSION_ZSTD_STREAM = 0x01,
+};
+
+// Window size of the zstd streams, both sides need about this much memory
+// for each channel
+constexpr int NETPROTO_COMPRESSION_WINDOW_LOG = 16;
+
 enum CSMRestrictionFlags : u64 {
 	CSM_RF_NONE = 0x00000000,
 	// Until server-sent CSM and verifying of builtin are complete,
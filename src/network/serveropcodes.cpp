@@ -45,11 +45,11 @@ const ToServerCommandHandler toServerCommandTable[TOSERVER_NUM_MSG_TYPES] =
 	null_command_handler, // 0x1f
 	null_command_handler, // 0x20
 	null_command_handler, // 0x21
-	null_command_handler, // 0x22
+	{ "TOSERVER_PLAYER_MOVE",              TOSERVER_STATE_INGAME, &Server::handleCommand_PlayerMove }, // 0x22
 	{ "TOSERVER_PLAYERPOS",                TOSERVER_STATE_INGAME, &Server::handleCommand_PlayerPos }, // 0x23
 	{ "TOSERVER_GOTBLOCKS",                TOSERVER_STATE_STARTUP, &Server::handleCommand_GotBlocks }, // 0x24
 	{ "TOSERVER_DELETEDBLOCKS",            TOSERVER_STATE_INGAME, &Server::handleCommand_DeletedBlocks }, // 0x25
-	null_command_handler, // 0x26
+	{ "TOSERVER_REQUEST_BLOCKS",           TOSERVER_STATE_INGAME, &Server::handleCommand_RequestBlocks }, // 0x26
 	null_command_handler, // 0x27
 	null_command_handler, // 0x28
 	null_command_handler, // 0x29
@@ -107,6 +107,9 @@ const static ClientCommandFactory null_command_factory = { nullptr, 0, false };
 
 	Packet order is only guaranteed inside a channel, so packets that operate on
 	the same objects are *required* to be in the same channel.
+
+	Packets marked with `bundle` may be delayed until the end of the step and
+	sent together in a TOCLIENT_BUNDLE.
 */
 
 const ClientCommandFactory clientCommandFactoryTable[TOCLIENT_NUM_MSG_TYPES] =
@@ -146,9 +149,9 @@ const ClientCommandFactory clientCommandFactoryTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_BLOCKDATA",                2, true }, // 0x20
 	{ "TOCLIENT_ADDNODE",                  0, true }, // 0x21
 	{ "TOCLIENT_REMOVENODE",               0, true }, // 0x22
-	null_command_factory, // 0x23
-	null_command_factory, // 0x24
-	null_command_factory, // 0x25
+	{ "TOCLIENT_NODES_CHANGED",            0, true }, // 0x23
+	{ "TOCLIENT_BLOCK_HASH",               2, true }, // 0x24
+	{ "TOCLIENT_OBJECT_MOVEMENT",          1, false }, // 0x25
 	null_command_factory, // 0x26
 	{ "TOCLIENT_INVENTORY",                0, true }, // 0x27
 	null_command_factory, // 0x28
@@ -161,7 +164,7 @@ const ClientCommandFactory clientCommandFactoryTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_CHAT_MESSAGE",             0, true }, // 0x2F
 	null_command_factory, // 0x30
 	{ "TOCLIENT_ACTIVE_OBJECT_REMOVE_ADD", 0, true }, // 0x31
-	{ "TOCLIENT_ACTIVE_OBJECT_MESSAGES",   0, true }, // 0x32 (may be sent as unrel over channel 1 too)
+	{ "TOCLIENT_ACTIVE_OBJECT_MESSAGES",   0, true, true }, // 0x32 (may be sent as unrel over channel 1 too)
 	{ "TOCLIENT_HP",                       0, true }, // 0x33
 	{ "TOCLIENT_MOVE_PLAYER",              0, true }, // 0x34
 	null_command_factory, // 0x35
@@ -174,30 +177,30 @@ const ClientCommandFactory clientCommandFactoryTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_ANNOUNCE_MEDIA",           0, true }, // 0x3C
 	{ "TOCLIENT_ITEMDEF",                  0, true }, // 0x3D
 	null_command_factory, // 0x3E
-	{ "TOCLIENT_PLAY_SOUND",               0, true }, // 0x3f (may be sent as unrel too)
-	{ "TOCLIENT_STOP_SOUND",               0, true }, // 0x40
+	{ "TOCLIENT_PLAY_SOUND",               0, true, true }, // 0x3f (may be sent as unrel too)
+	{ "TOCLIENT_STOP_SOUND",               0, true, true }, // 0x40
 	{ "TOCLIENT_PRIVILEGES",               0, true }, // 0x41
 	{ "TOCLIENT_INVENTORY_FORMSPEC",       0, true }, // 0x42
 	// ^ `channel` MUST be the same as TOCLIENT_SHOW_FORMSPEC
 	{ "TOCLIENT_DETACHED_INVENTORY",       0, true }, // 0x43
 	{ "TOCLIENT_SHOW_FORMSPEC",            0, true }, // 0x44
 	{ "TOCLIENT_MOVEMENT",                 0, true }, // 0x45
-	{ "TOCLIENT_SPAWN_PARTICLE",           0, true }, // 0x46
-	{ "TOCLIENT_ADD_PARTICLESPAWNER",      0, true }, // 0x47
+	{ "TOCLIENT_SPAWN_PARTICLE",           0, true, true }, // 0x46
+	{ "TOCLIENT_ADD_PARTICLESPAWNER",      0, true, true }, // 0x47
 	{ "TOCLIENT_CAMERA",                   0, true }, // 0x48
-	{ "TOCLIENT_HUDADD",                   1, true }, // 0x49
-	{ "TOCLIENT_HUDRM",                    1, true }, // 0x4a
-	{ "TOCLIENT_HUDCHANGE",                1, true }, // 0x4b
-	{ "TOCLIENT_HUD_SET_FLAGS",            1, true }, // 0x4c
-	{ "TOCLIENT_HUD_SET_PARAM",            1, true }, // 0x4d
+	{ "TOCLIENT_HUDADD",                   1, true, true }, // 0x49
+	{ "TOCLIENT_HUDRM",                    1, true, true }, // 0x4a
+	{ "TOCLIENT_HUDCHANGE",                1, true, true }, // 0x4b
+	{ "TOCLIENT_HUD_SET_FLAGS",            1, true, true }, // 0x4c
+	{ "TOCLIENT_HUD_SET_PARAM",            1, true, true }, // 0x4d
 	{ "TOCLIENT_BREATH",                   0, true }, // 0x4e
 	{ "TOCLIENT_SET_SKY",                  0, true }, // 0x4f
 	{ "TOCLIENT_OVERRIDE_DAY_NIGHT_RATIO", 0, true }, // 0x50
 	{ "TOCLIENT_LOCAL_PLAYER_ANIMATIONS",  0, true }, // 0x51
 	{ "TOCLIENT_EYE_OFFSET",               0, true }, // 0x52
-	{ "TOCLIENT_DELETE_PARTICLESPAWNER",   0, true }, // 0x53
+	{ "TOCLIENT_DELETE_PARTICLESPAWNER",   0, true, true }, // 0x53
 	{ "TOCLIENT_CLOUD_PARAMS",             0, true }, // 0x54
-	{ "TOCLIENT_FADE_SOUND",               0, true }, // 0x55
+	{ "TOCLIENT_FADE_SOUND",               0, true, true }, // 0x55
 	{ "TOCLIENT_UPDATE_PLAYER_LIST",       0, true }, // 0x56
 	{ "TOCLIENT_MODCHANNEL_MSG",           0, true }, // 0x57
 	{ "TOCLIENT_MODCHANNEL_SIGNAL",        0, true }, // 0x58
@@ -206,10 +209,15 @@ const ClientCommandFactory clientCommandFactoryTable[TOCLIENT_NUM_MSG_TYPES] =
 	{ "TOCLIENT_SET_MOON",                 0, true }, // 0x5b
 	{ "TOCLIENT_SET_STARS",                0, true }, // 0x5c
 	{ "TOCLIENT_MOVE_PLAYER_REL",          0, true }, // 0x5d
-	null_command_factory, // 0x5e
-	null_command_factory, // 0x5f
+	{ "TOCLIENT_BUNDLE",                   0, true }, // 0x5e
+	{ "TOCLIENT_SHOW_FORMSPEC_DELTA",      0, true }, // 0x5f
+	// ^ `channel` MUST be the same as TOCLIENT_SHOW_FORMSPEC
 	{ "TOCLIENT_SRP_BYTES_S_B",            0, true }, // 0x60
 	{ "TOCLIENT_FORMSPEC_PREPEND",         0, true }, // 0x61
 	{ "TOCLIENT_MINIMAP_MODES",            0, true }, // 0x62
 	{ "TOCLIENT_SET_LIGHTING",             0, true }, // 0x63
+	{ "TOCLIENT_PARTICLE_DEFINITION",      0, true, true }, // 0x64
+	{ "TOCLIENT_SPAWN_DEFINED_PARTICLE",   0, true, true }, // 0x65
+	{ "TOCLIENT_COMPRESSED_BUNDLE",        0, true }, // 0x66
+	{ "TOCLIENT_TRANSFER",                 0, true }, // 0x67
 };
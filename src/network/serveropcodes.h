@@ -28,6 +28,8 @@ struct ClientCommandFactory
 	const char* name;
 	u8 channel;
 	bool reliable;
+	// small and frequent, see TOCLIENT_BUNDLE
+	bool bundle = false;
 };
 
 extern const ToServerCommandHandler toServerCommandTable[TOSERVER_NUM_MSG_TYPES];
@@ -76,12 +76,12 @@ void Server::handleCommand_Init(NetworkPacket* pkt)
 		return;
 
 	u8 max_ser_ver; // SER_FMT_VER_HIGHEST_READ (of client)
-	u16 unused;
+	u16 compression_modes;
 	u16 min_net_proto_version;
 	u16 max_net_proto_version;
 	std::string playerName;
 
-	*pkt >> max_ser_ver >> unused
+	*pkt >> max_ser_ver >> compression_modes
 			>> min_net_proto_version >> max_net_proto_version
 			>> playerName;
 
@@ -252,9 +252,14 @@ void Server::handleCommand_Init(NetworkPacket* pkt)
 	verbosestream << "Sending TOCLIENT_HELLO with auth method field: "
 		<< auth_mechs << std::endl;
 
+	// Older clients sent 0 here
+	if ((compression_modes & NETPROTO_COMPRESSION_ZSTD_STREAM) &&
+			g_settings->getBool("network_stream_compression"))
+		client->compression_mode = NETPROTO_COMPRESSION_ZSTD_STREAM;
+
 	NetworkPacket resp_pkt(TOCLIENT_HELLO, 0, peer_id);
 
-	resp_pkt << serialization_ver << u16(0) /* unused */
+	resp_pkt << serialization_ver << client->compression_mode
 		<< net_proto_version
 		<< auth_mechs << std::string_view() /* unused */;
 
@@ -355,13 +360,17 @@ void Server::handleCommand_ClientReady(NetworkPacket* pkt)
 	// decode all information first
 	u8 major_ver, minor_ver, patch_ver, reserved;
 	u16 formspec_ver = 1; // v1 for clients older than 5.1.0-dev
+	u8 flags = 0;
 	std::string full_ver;
 
 	*pkt >> major_ver >> minor_ver >> patch_ver >> reserved >> full_ver;
 	if (pkt->getRemainingBytes() >= 2)
 		*pkt >> formspec_ver;
+	if (pkt->getRemainingBytes() >= 1)
+		*pkt >> flags;
 
 	client->setVersionInfo(major_ver, minor_ver, patch_ver, full_ver);
+	client->block_cache = flags & CLIENT_READY_BLOCK_CACHE;
 
 	// Since only active clients count for the user limit, two could race the
 	// join process so we have to do a final check for the user limit here.
@@ -406,30 +415,23 @@ void Server::handleCommand_ClientReady(NetworkPacket* pkt)
 
 void Server::handleCommand_GotBlocks(NetworkPacket* pkt)
 {
-	if (pkt->getSize() < 1)
-		return;
-
-	/*
-		[0] u16 command
-		[2] u8 count
-		[3] v3s16 pos_0
-		[3+6] v3s16 pos_1
-		...
-	*/
+	DecodedCommand cmd;
+	decodeCommand(pkt, cmd);
+	handleCommand_GotBlocks(pkt->getPeerId(), std::get<DecodedGotBlocks>(cmd.data));
+}
 
-	u8 count;
-	*pkt >> count;
+void Server::handleCommand_GotBlocks(session_t peer_id, const DecodedGotBlocks &cmd)
+{
+	if (cmd.blocks.empty())
+		return;
 
 	ClientInterface::AutoLock lock(m_clients);
-	RemoteClient *client = m_clients.lockedGetClientNoEx(pkt->getPeerId());
+	RemoteClient *client = m_clients.lockedGetClientNoEx(peer_id);
 	if (!client)
 		return;
 
-	for (u16 i = 0; i < count; i++) {
-		v3s16 p;
-		*pkt >> p;
+	for (v3s16 p : cmd.blocks)
 		client->GotBlock(p);
-	}
 }
 
 void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
@@ -441,65 +443,85 @@ void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
 	v3s32 ps, ss;
 	s32 f32pitch, f32yaw;
 	u8 f32fov;
+	PlayerPosUpdate update;
 
 	*pkt >> ps;
 	*pkt >> ss;
 	*pkt >> f32pitch;
 	*pkt >> f32yaw;
 
-	f32 pitch = (f32)f32pitch / 100.0f;
-	f32 yaw = (f32)f32yaw / 100.0f;
-	u32 keyPressed = 0;
+	update.pitch = (f32)f32pitch / 100.0f;
+	update.yaw = (f32)f32yaw / 100.0f;
+	update.bits = 0; // bits instead of bool so it is extensible later
 
-	f32 fov = 0;
-	u8 wanted_range = 0;
-	u8 bits = 0; // bits instead of bool so it is extensible later
-
-	*pkt >> keyPressed;
-	player->control.unpackKeysPressed(keyPressed);
+	*pkt >> update.keys_pressed;
 
 	*pkt >> f32fov;
-	fov = (f32)f32fov / 80.0f;
-	*pkt >> wanted_range;
+	update.fov = (f32)f32fov / 80.0f;
+	*pkt >> update.wanted_range;
 
 	if (pkt->getRemainingBytes() >= 1)
-		*pkt >> bits;
+		*pkt >> update.bits;
+
+	update.has_movement = pkt->getRemainingBytes() >= 8;
+	if (update.has_movement)
+		*pkt >> update.movement_speed >> update.movement_direction;
 
-	if (pkt->getRemainingBytes() >= 8) {
-		f32 movement_speed;
-		*pkt >> movement_speed;
+	update.position = v3f((f32)ps.X / 100.0f, (f32)ps.Y / 100.0f, (f32)ps.Z / 100.0f);
+	update.speed = v3f((f32)ss.X / 100.0f, (f32)ss.Y / 100.0f, (f32)ss.Z / 100.0f);
+
+	apply_PlayerPos(player, playersao, update);
+}
+
+void Server::apply_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
+	const PlayerPosUpdate &update)
+{
+	player->control.unpackKeysPressed(update.keys_pressed);
+
+	if (update.has_movement) {
+		f32 movement_speed = update.movement_speed;
 		if (movement_speed != movement_speed) // NaN
 			movement_speed = 0.0f;
 		player->control.movement_speed = std::clamp(movement_speed, 0.0f, 1.0f);
-		*pkt >> player->control.movement_direction;
+		player->control.movement_direction = update.movement_direction;
 	} else {
 		player->control.movement_speed = 0.0f;
 		player->control.movement_direction = 0.0f;
 		player->control.setMovementFromKeys();
 	}
 
-	v3f position((f32)ps.X / 100.0f, (f32)ps.Y / 100.0f, (f32)ps.Z / 100.0f);
-	v3f speed((f32)ss.X / 100.0f, (f32)ss.Y / 100.0f, (f32)ss.Z / 100.0f);
-
-	pitch = modulo360f(pitch);
-	yaw = wrapDegrees_0_360(yaw);
+	f32 pitch = modulo360f(update.pitch);
+	f32 yaw = wrapDegrees_0_360(update.yaw);
 
 	if (!playersao->isAttached()) {
 		// Only update player positions when moving freely
 		// to not interfere with attachment handling
-		playersao->setBasePosition(position);
-		player->setSpeed(speed);
+		playersao->setBasePosition(update.position);
+		player->setSpeed(update.speed);
 	}
 	playersao->setLookPitch(pitch);
 	playersao->setPlayerYaw(yaw);
-	playersao->setFov(fov);
-	playersao->setWantedRange(wanted_range);
-	playersao->setCameraInverted(bits & 0x01);
+	playersao->setFov(update.fov);
+	playersao->setWantedRange(update.wanted_range);
+	playersao->setCameraInverted(update.bits & 0x01);
 
-	if (playersao->checkMovementCheat()) {
-		// Call callbacks
-		m_script->on_cheat(playersao, "moved_too_fast");
-		SendMovePlayer(playersao);
+	// Checked in checkPlayerMovements(), so that many packets within a
+	// step are checked only once
+	playersao->queueMovementCheck();
+}
+
+void Server::checkPlayerMovements()
+{
+	for (RemotePlayer *player : m_env->getPlayers()) {
+		PlayerSAO *playersao = player->getPlayerSAO();
+		if (!playersao || !playersao->takeMovementCheck())
+			continue;
+
+		if (playersao->checkMovementCheat()) {
+			// Call callbacks
+			m_script->on_cheat(playersao, "moved_too_fast");
+			SendMovePlayer(playersao);
+		}
 	}
 }
 
@@ -528,6 +550,65 @@ void Server::handleCommand_PlayerPos(NetworkPacket* pkt)
 	process_PlayerPos(player, playersao, pkt);
 }
 
+void Server::handleCommand_PlayerMove(NetworkPacket* pkt)
+{
+	session_t peer_id = pkt->getPeerId();
+	RemotePlayer *player = m_env->getPlayer(peer_id);
+	if (!player) {
+		warningstream << FUNCTION_NAME << ": player is null" << std::endl;
+		return;
+	}
+
+	PlayerSAO *playersao = player->getPlayerSAO();
+	if (!playersao) {
+		warningstream << FUNCTION_NAME << ": player SAO is null" << std::endl;
+		return;
+	}
+
+	// If player is dead we don't care of this packet
+	if (playersao->isDead()) {
+		verbosestream << "TOSERVER_PLAYER_MOVE: " << player->getName()
+				<< " is dead. Ignoring packet";
+		return;
+	}
+
+	u16 seq;
+	v3s32 ps;
+	v3s16 ss;
+	s16 pitch, movement_dir;
+	u16 yaw, keys;
+	u8 fov, movement_speed;
+	PlayerPosUpdate update;
+
+	*pkt >> seq >> ps >> ss >> pitch >> yaw >> keys >> fov
+		>> update.wanted_range >> update.bits >> movement_speed >> movement_dir;
+
+	{
+		// The packets are unreliable, one may arrive after a newer one
+		ClientInterface::AutoLock lock(m_clients);
+		RemoteClient *client = m_clients.lockedGetClientNoEx(peer_id);
+		if (!client)
+			return;
+		if (client->m_player_move_seq_valid &&
+				(s16)(seq - client->m_player_move_seq) <= 0)
+			return;
+		client->m_player_move_seq = seq;
+		client->m_player_move_seq_valid = true;
+	}
+
+	update.position = v3f((f32)ps.X / 100.0f, (f32)ps.Y / 100.0f, (f32)ps.Z / 100.0f);
+	update.speed = v3f((f32)ss.X, (f32)ss.Y, (f32)ss.Z) / MOVEMENT_SPEED_SCALE;
+	update.pitch = (f32)pitch / 100.0f;
+	update.yaw = (f32)yaw / 100.0f;
+	update.keys_pressed = keys;
+	update.fov = (f32)fov / 80.0f;
+	update.has_movement = true;
+	update.movement_speed = (f32)movement_speed / 255.0f;
+	update.movement_direction = (f32)movement_dir / 10000.0f;
+
+	apply_PlayerPos(player, playersao, update);
+}
+
 void Server::handleCommand_DeletedBlocks(NetworkPacket* pkt)
 {
 	if (pkt->getSize() < 1)
@@ -556,6 +637,26 @@ void Server::handleCommand_DeletedBlocks(NetworkPacket* pkt)
 	}
 }
 
+void Server::handleCommand_RequestBlocks(NetworkPacket* pkt)
+{
+	if (pkt->getSize() < 1)
+		return;
+
+	u8 count;
+	*pkt >> count;
+
+	ClientInterface::AutoLock lock(m_clients);
+	RemoteClient *client = m_clients.lockedGetClientNoEx(pkt->getPeerId());
+	if (!client)
+		return;
+
+	for (u16 i = 0; i < count; i++) {
+		v3s16 p;
+		*pkt >> p;
+		client->RequestBlockData(p);
+	}
+}
+
 void Server::handleCommand_InventoryAction(NetworkPacket* pkt)
 {
 	session_t peer_id = pkt->getPeerId();
@@ -871,24 +972,17 @@ static inline void getWieldedItem(const PlayerSAO *playersao, std::optional<Item
 
 void Server::handleCommand_Interact(NetworkPacket *pkt)
 {
-	/*
-		[0] u16 command
-		[2] u8 action
-		[3] u16 item
-		[5] u32 length of the next item (plen)
-		[9] serialized PointedThing
-		[9 + plen] player position information
-	*/
-
-	InteractAction action;
-	u16 item_i;
-
-	*pkt >> (u8 &)action;
-	*pkt >> item_i;
+	DecodedCommand cmd;
+	decodeCommand(pkt, cmd);
+	handleCommand_Interact(pkt, std::get<DecodedInteract>(cmd.data));
+}
 
-	std::istringstream tmp_is(pkt->readLongString(), std::ios::binary);
-	PointedThing pointed;
-	pointed.deSerialize(tmp_is);
+void Server::handleCommand_Interact(NetworkPacket *pkt, const DecodedInteract &cmd)
+{
+	const InteractAction action = cmd.action;
+	const u16 item_i = cmd.item;
+	// may be changed below
+	PointedThing pointed = cmd.pointed;
 
 	verbosestream << "TOSERVER_INTERACT: action=" << (int)action << ", item="
 			<< item_i << ", pointed=" << pointed.dump() << std::endl;
@@ -1289,34 +1383,17 @@ void Server::handleCommand_RemovedSounds(NetworkPacket* pkt)
 	}
 }
 
-static bool pkt_read_formspec_fields(NetworkPacket *pkt, StringMap &fields)
+void Server::handleCommand_NodeMetaFields(NetworkPacket* pkt)
 {
-	u16 field_count;
-	*pkt >> field_count;
-
-	size_t length = 0;
-	for (u16 k = 0; k < field_count; k++) {
-		std::string fieldname, fieldvalue;
-		*pkt >> fieldname;
-		fieldvalue = pkt->readLongString();
-
-		fieldname = sanitize_untrusted(fieldname, false);
-		// We'd love to strip escapes here but some formspec elements reflect data
-		// from the server (e.g. dropdown), which can contain translations.
-		fieldvalue = sanitize_untrusted(fieldvalue);
-
-		length += fieldname.size() + fieldvalue.size();
-
-		fields[std::move(fieldname)] = std::move(fieldvalue);
-	}
-
-	// 640K ought to be enough for anyone
-	return length < 640 * 1024;
+	DecodedCommand cmd;
+	decodeCommand(pkt, cmd);
+	handleCommand_NodeMetaFields(pkt->getPeerId(),
+		std::get<DecodedNodeMetaFields>(cmd.data));
 }
 
-void Server::handleCommand_NodeMetaFields(NetworkPacket* pkt)
+void Server::handleCommand_NodeMetaFields(session_t peer_id,
+	const DecodedNodeMetaFields &cmd)
 {
-	session_t peer_id = pkt->getPeerId();
 	RemotePlayer *player = m_env->getPlayer(peer_id);
 	if (!player) {
 		warningstream << FUNCTION_NAME << ": player is null" << std::endl;
@@ -1329,13 +1406,11 @@ void Server::handleCommand_NodeMetaFields(NetworkPacket* pkt)
 		return;
 	}
 
-	v3s16 p;
-	std::string formname;
-	StringMap fields;
-
-	*pkt >> p >> formname;
+	const v3s16 p = cmd.pos;
+	const std::string &formname = cmd.formname;
+	const StringMap &fields = cmd.fields;
 
-	if (!pkt_read_formspec_fields(pkt, fields)) {
+	if (cmd.too_large) {
 		warningstream << "Too large formspec fields! Ignoring for pos="
 			<< p << ", player=" << player->getName() << std::endl;
 		return;
@@ -1361,7 +1436,15 @@ void Server::handleCommand_NodeMetaFields(NetworkPacket* pkt)
 
 void Server::handleCommand_InventoryFields(NetworkPacket* pkt)
 {
-	session_t peer_id = pkt->getPeerId();
+	DecodedCommand cmd;
+	decodeCommand(pkt, cmd);
+	handleCommand_InventoryFields(pkt->getPeerId(),
+		std::get<DecodedInventoryFields>(cmd.data));
+}
+
+void Server::handleCommand_InventoryFields(session_t peer_id,
+	const DecodedInventoryFields &cmd)
+{
 	RemotePlayer *player = m_env->getPlayer(peer_id);
 
 	if (!player)
@@ -1370,12 +1453,10 @@ void Server::handleCommand_InventoryFields(NetworkPacket* pkt)
 	if (!playersao)
 		return;
 
-	std::string client_formspec_name;
-	StringMap fields;
+	const std::string &client_formspec_name = cmd.formname;
+	const StringMap &fields = cmd.fields;
 
-	*pkt >> client_formspec_name;
-
-	if (!pkt_read_formspec_fields(pkt, fields)) {
+	if (cmd.too_large) {
 		warningstream << "Too large formspec fields! Ignoring for formname=\""
 			<< client_formspec_name << "\", player=" << player->getName() << std::endl;
 		return;
@@ -1565,13 +1646,16 @@ void Server::handleCommand_SrpBytesA(NetworkPacket* pkt)
 
 	client->chosen_mech = chosen;
 
-	std::string salt, verifier;
+	SrpVerifierPool::Request request;
+	request.peer_id = peer_id;
+	request.name = client->getName();
+	request.bytes_A = std::move(bytes_A);
 
 	if (based_on == 0) {
-
-		generate_srp_verifier_and_salt(client->getName(), client->enc_pwd,
-			&verifier, &salt);
-	} else if (!decode_srp_verifier_and_salt(client->enc_pwd, &verifier, &salt)) {
+		request.legacy = true;
+		request.enc_pwd = client->enc_pwd;
+	} else if (!decode_srp_verifier_and_salt(client->enc_pwd,
+			&request.verifier, &request.salt)) {
 		// Non-base64 errors should have been catched in the init handler
 		actionstream << "Server: User " << client->getName() <<
 			" tried to log in, but srp verifier field was invalid (most likely "
@@ -1580,18 +1664,40 @@ void Server::handleCommand_SrpBytesA(NetworkPacket* pkt)
 		return;
 	}
 
-	char *bytes_B = 0;
-	size_t len_B = 0;
+	// The big number math runs on a job, see finishSrpBytesA()
+	if (!m_srp_pool->enqueue(std::move(request))) {
+		actionstream << "Server: Too many logins in progress, refusing "
+			<< client->getName() << " from " << addr_s << std::endl;
+		if (wantSudo) {
+			DenySudoAccess(peer_id);
+			client->resetChosenMech();
+			return;
+		}
+
+		DenyAccess(peer_id, SERVER_ACCESSDENIED_CUSTOM_STRING,
+			"Too many players are logging in, try again later.", true);
+		return;
+	}
+}
 
-	client->auth_data = srp_verifier_new(SRP_SHA256, SRP_NG_2048,
-		client->getName().c_str(),
-		(const unsigned char *) salt.c_str(), salt.size(),
-		(const unsigned char *) verifier.c_str(), verifier.size(),
-		(const unsigned char *) bytes_A.c_str(), bytes_A.size(),
-		NULL, 0,
-		(unsigned char **) &bytes_B, &len_B, NULL, NULL);
+void Server::finishSrpBytesA(SrpVerifierPool::Result &result)
+{
+	const session_t peer_id = result.peer_id;
+	RemoteClient *client = getClientNoEx(peer_id, CS_Invalid);
+	ClientState cstate = client ? client->getState() : CS_Invalid;
+	// The client may have left, or even been replaced, in the meantime
+	if (!((cstate == CS_HelloSent) || (cstate == CS_Active)) ||
+			client->getName() != result.name || client->auth_data ||
+			client->chosen_mech == AUTH_MECHANISM_NONE) {
+		if (result.verifier)
+			srp_verifier_delete(result.verifier);
+		return;
+	}
 
-	if (!bytes_B) {
+	const bool wantSudo = (cstate == CS_Active);
+	client->auth_data = result.verifier;
+
+	if (result.bytes_B.empty()) {
 		actionstream << "Server: User " << client->getName()
 			<< " tried to log in, SRP-6a safety check violated in _A handler."
 			<< std::endl;
@@ -1606,7 +1712,7 @@ void Server::handleCommand_SrpBytesA(NetworkPacket* pkt)
 	}
 
 	NetworkPacket resp_pkt(TOCLIENT_SRP_BYTES_S_B, 0, peer_id);
-	resp_pkt << salt << std::string(bytes_B, len_B);
+	resp_pkt << result.salt << result.bytes_B;
 	Send(&resp_pkt);
 }
 
@@ -1645,6 +1751,13 @@ void Server::handleCommand_SrpBytesM(NetworkPacket* pkt)
 	std::string bytes_M;
 	*pkt >> bytes_M;
 
+	if (!client->auth_data) {
+		actionstream << "Server: User " << playername << " at " << addr_s
+			<< " sent bytes_M before bytes_B was sent" << std::endl;
+		DenyAccess(peer_id, SERVER_ACCESSDENIED_UNEXPECTED_DATA);
+		return;
+	}
+
 	if (srp_verifier_get_session_key_length((SRPVerifier *) client->auth_data)
 			!= bytes_M.size()) {
 		actionstream << "Server: User " << playername << " at " << addr_s
@@ -35,6 +35,13 @@ typedef int socklen_t;
 #define SOCKET_ERR_STR(e) strerror(e)
 #endif
 
+// Batched send and receive syscalls
+#if defined(__linux__)
+#define HAVE_MMSG 1
+#else
+#define HAVE_MMSG 0
+#endif
+
 static bool g_sockets_initialized = false;
 
 // Initialize sockets
@@ -165,6 +172,36 @@ void UDPSocket::Bind(Address addr)
 	}
 }
 
+// Converts the address for use with sendto() and friends
+static socklen_t make_sockaddr(const Address &addr, sockaddr_storage &out)
+{
+	memset(&out, 0, sizeof(out));
+	if (addr.getFamily() == AF_INET6) {
+		auto *address = reinterpret_cast<sockaddr_in6 *>(&out);
+		address->sin6_family = AF_INET6;
+		address->sin6_addr = addr.getAddress6();
+		address->sin6_port = htons(addr.getPort());
+		return sizeof(sockaddr_in6);
+	}
+	auto *address = reinterpret_cast<sockaddr_in *>(&out);
+	address->sin_family = AF_INET;
+	address->sin_addr = addr.getAddress();
+	address->sin_port = htons(addr.getPort());
+	return sizeof(sockaddr_in);
+}
+
+static Address read_sockaddr(unsigned short family, const sockaddr_storage &in)
+{
+	if (family == AF_INET6) {
+		const auto *address = reinterpret_cast<const sockaddr_in6 *>(&in);
+		const auto *bytes = reinterpret_cast<const IPv6AddressBytes *>
+			(address->sin6_addr.s6_addr);
+		return Address(bytes, ntohs(address->sin6_port));
+	}
+	const auto *address = reinterpret_cast<const sockaddr_in *>(&in);
+	return Address(ntohl(address->sin_addr.s_addr), ntohs(address->sin_port));
+}
+
 void UDPSocket::Send(const Address &destination, const void *data, int size)
 {
 	bool dumping_packet = false; // for INTERNET_SIMULATOR
@@ -182,73 +219,133 @@ void UDPSocket::Send(const Address &destination, const void *data, int size)
 	if (destination.getFamily() != m_addr_family)
 		throw SendFailedException("Address family mismatch");
 
-	int sent;
-	if (m_addr_family == AF_INET6) {
-		struct sockaddr_in6 address = {};
-		address.sin6_family = AF_INET6;
-		address.sin6_addr = destination.getAddress6();
-		address.sin6_port = htons(destination.getPort());
-
-		sent = sendto(m_handle, (const char *)data, size, 0,
-				(struct sockaddr *)&address, sizeof(struct sockaddr_in6));
-	} else {
-		struct sockaddr_in address = {};
-		address.sin_family = AF_INET;
-		address.sin_addr = destination.getAddress();
-		address.sin_port = htons(destination.getPort());
-
-		sent = sendto(m_handle, (const char *)data, size, 0,
-				(struct sockaddr *)&address, sizeof(struct sockaddr_in));
-	}
+	sockaddr_storage address;
+	socklen_t address_len = make_sockaddr(destination, address);
+	int sent = sendto(m_handle, (const char *)data, size, 0,
+			(struct sockaddr *)&address, address_len);
 
 	if (sent != size)
 		throw SendFailedException("Failed to send packet");
 }
 
-int UDPSocket::Receive(Address &sender, void *data, int size)
+int UDPSocket::SendMany(const OutPacket *packets, int count)
 {
-	// Return on timeout
-	assert(m_timeout_ms >= 0);
-	if (!WaitData(m_timeout_ms))
-		return -1;
+	int failed = 0;
+#if HAVE_MMSG
+	if (!INTERNET_SIMULATOR) {
+		mmsghdr msgs[MAX_BATCH];
+		iovec iovs[MAX_BATCH];
+		sockaddr_storage addrs[MAX_BATCH];
+
+		for (int done = 0; done < count; ) {
+			int n = 0;
+			for (; n < MAX_BATCH && done + n < count; n++) {
+				const OutPacket &p = packets[done + n];
+				if (p.destination->getFamily() != m_addr_family)
+					break;
+				iovs[n].iov_base = const_cast<void *>(p.data);
+				iovs[n].iov_len = p.size;
+				memset(&msgs[n], 0, sizeof(msgs[n]));
+				msgs[n].msg_hdr.msg_name = &addrs[n];
+				msgs[n].msg_hdr.msg_namelen = make_sockaddr(*p.destination, addrs[n]);
+				msgs[n].msg_hdr.msg_iov = &iovs[n];
+				msgs[n].msg_hdr.msg_iovlen = 1;
+			}
+			int sent = n > 0 ? sendmmsg(m_handle, msgs, n, 0) : -1;
+			if (sent <= 0) {
+				// The first packet failed or has the wrong address family
+				failed++;
+				done++;
+				continue;
+			}
+			done += sent;
+		}
+		return failed;
+	}
+#endif
+	for (int i = 0; i < count; i++) {
+		try {
+			Send(*packets[i].destination, packets[i].data, packets[i].size);
+		} catch (SendFailedException &e) {
+			failed++;
+		}
+	}
+	return failed;
+}
 
+int UDPSocket::receiveNoWait(Address &sender, void *data, int size)
+{
 	size = MYMAX(size, 0);
 
-	int received;
-	if (m_addr_family == AF_INET6) {
-		struct sockaddr_in6 address;
-		memset(&address, 0, sizeof(address));
-		socklen_t address_len = sizeof(address);
+	sockaddr_storage address;
+	memset(&address, 0, sizeof(address));
+	socklen_t address_len = sizeof(address);
 
-		received = recvfrom(m_handle, (char *)data, size, 0,
-				(struct sockaddr *)&address, &address_len);
+	int received = recvfrom(m_handle, (char *)data, size, 0,
+			(struct sockaddr *)&address, &address_len);
 
-		if (received < 0)
-			return -1;
-
-		u16 address_port = ntohs(address.sin6_port);
-		const auto *bytes = reinterpret_cast<IPv6AddressBytes*>
-			(address.sin6_addr.s6_addr);
-		sender = Address(bytes, address_port);
-	} else {
-		struct sockaddr_in address;
-		memset(&address, 0, sizeof(address));
+	if (received < 0)
+		return -1;
 
-		socklen_t address_len = sizeof(address);
+	sender = read_sockaddr(m_addr_family, address);
+	return received;
+}
 
-		received = recvfrom(m_handle, (char *)data, size, 0,
-				(struct sockaddr *)&address, &address_len);
+int UDPSocket::Receive(Address &sender, void *data, int size)
+{
+	// Return on timeout
+	assert(m_timeout_ms >= 0);
+	if (!WaitData(m_timeout_ms))
+		return -1;
 
-		if (received < 0)
-			return -1;
+	return receiveNoWait(sender, data, size);
+}
 
-		u32 address_ip = ntohl(address.sin_addr.s_addr);
-		u16 address_port = ntohs(address.sin_port);
+int UDPSocket::ReceiveMany(InPacket *packets, int count)
+{
+	assert(count > 0);
+	// Return on timeout
+	assert(m_timeout_ms >= 0);
+	if (!WaitData(m_timeout_ms))
+		return -1;
 
-		sender = Address(address_ip, address_port);
+#if HAVE_MMSG
+	count = MYMIN(count, MAX_BATCH);
+	mmsghdr msgs[MAX_BATCH];
+	iovec iovs[MAX_BATCH];
+	sockaddr_storage addrs[MAX_BATCH];
+	for (int i = 0; i < count; i++) {
+		iovs[i].iov_base = packets[i].data;
+		iovs[i].iov_len = MYMAX(packets[i].size, 0);
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
 	}
 
+	int received = recvmmsg(m_handle, msgs, count, MSG_DONTWAIT, nullptr);
+	if (received <= 0)
+		return -1;
+	for (int i = 0; i < received; i++) {
+		packets[i].size = msgs[i].msg_len;
+		packets[i].sender = read_sockaddr(m_addr_family, addrs[i]);
+	}
 	return received;
+#else
+	int received = 0;
+	for (; received < count; received++) {
+		// Only wait for the first one
+		if (received > 0 && !WaitData(0))
+			break;
+		InPacket &p = packets[received];
+		int size = receiveNoWait(p.sender, p.data, p.size);
+		if (size < 0)
+			break;
+		p.size = size;
+	}
+	return received > 0 ? received : -1;
+#endif
 }
 
 void UDPSocket::setTimeoutMs(int timeout_ms)
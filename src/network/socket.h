@@ -23,9 +23,31 @@ class UDPSocket
 
 	void Bind(Address addr);
 
+	// Maximum number of packets handled by a single syscall
+	static constexpr int MAX_BATCH = 64;
+
+	struct OutPacket {
+		const Address *destination;
+		const void *data;
+		int size;
+	};
+
+	struct InPacket {
+		Address sender;
+		void *data;
+		// size of the buffer, set to the size of the packet on return
+		int size;
+	};
+
 	void Send(const Address &destination, const void *data, int size);
+	// Sends several packets, with few syscalls where the system supports it.
+	// Returns the number of packets that could not be sent.
+	int SendMany(const OutPacket *packets, int count);
 	// Returns -1 if there is no data
 	int Receive(Address &sender, void *data, int size);
+	// Like Receive(), but also takes up to count - 1 more packets that are
+	// ready without waiting for them. Returns the number of packets received.
+	int ReceiveMany(InPacket *packets, int count);
 	void setTimeoutMs(int timeout_ms);
 	// Returns true if there is data, false if timeout occurred
 	bool WaitData(int timeout_ms);
@@ -34,6 +56,8 @@ class UDPSocket
 	int GetHandle() const { return m_handle; };
 
 private:
+	int receiveNoWait(Address &sender, void *data, int size);
+
 	int m_handle = -1;
 	int m_timeout_ms = -1;
 	unsigned short m_addr_family = 0;
@@ -29,6 +29,8 @@
 #include <fstream> // Used in applyTextureOverrides()
 #include <algorithm>
 #include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 
 /*
 	NodeBox
@@ -1003,6 +1005,8 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 
 
 
+std::atomic<u32> NodeDefManager::s_modification_counter{0};
+
 NodeDefManager::NodeDefManager()
 {
 	clear();
@@ -1022,7 +1026,10 @@ NodeDefManager::~NodeDefManager()
 
 void NodeDefManager::clear()
 {
+	bumpModificationCounter();
 	m_content_features.clear();
+	m_group_ids.clear();
+	m_content_group_ratings.clear();
 	m_name_id_mapping.clear();
 	m_name_id_mapping_with_aliases.clear();
 	m_group_to_items.clear();
@@ -1047,8 +1054,10 @@ void NodeDefManager::clear()
 		// Insert directly into containers
 		content_t c = CONTENT_UNKNOWN;
 		m_content_features[c] = f;
-		for (u32 ci = 0; ci <= CONTENT_MAX; ci++)
+		for (u32 ci = 0; ci <= CONTENT_MAX; ci++) {
 			m_content_lighting_flag_cache[ci] = f.getLightingFlags();
+			m_content_shape_flag_cache[ci] = f.getShapeFlags();
+		}
 		addNameIdMapping(c, f.name);
 	}
 
@@ -1070,6 +1079,7 @@ void NodeDefManager::clear()
 		content_t c = CONTENT_AIR;
 		m_content_features[c] = f;
 		m_content_lighting_flag_cache[c] = f.getLightingFlags();
+		m_content_shape_flag_cache[c] = f.getShapeFlags();
 		addNameIdMapping(c, f.name);
 	}
 
@@ -1090,6 +1100,7 @@ void NodeDefManager::clear()
 		content_t c = CONTENT_IGNORE;
 		m_content_features[c] = f;
 		m_content_lighting_flag_cache[c] = f.getLightingFlags();
+		m_content_shape_flag_cache[c] = f.getShapeFlags();
 		addNameIdMapping(c, f.name);
 	}
 }
@@ -1294,8 +1305,38 @@ inline void NodeDefManager::fixSelectionBoxIntUnion()
 }
 
 
+u16 NodeDefManager::getGroupId(const std::string &group) const
+{
+	auto it = m_group_ids.find(group);
+	return it == m_group_ids.end() ? GROUP_ID_NONE : it->second;
+}
+
+
+void NodeDefManager::setGroupRatings(content_t id, const ItemGroupList &groups)
+{
+	if (id >= m_content_group_ratings.size())
+		m_content_group_ratings.resize((size_t)id + 1);
+
+	auto &ratings = m_content_group_ratings[id];
+	ratings.clear();
+	ratings.reserve(groups.size());
+	for (const auto &group : groups) {
+		auto it = m_group_ids.emplace(group.first, (u16)m_group_ids.size()).first;
+		if (it->second == GROUP_ID_NONE) {
+			// Can't happen with sane games, but don't hand out the sentinel
+			m_group_ids.erase(it);
+			break;
+		}
+		ratings.emplace_back(it->second, group.second);
+	}
+}
+
+
 void NodeDefManager::eraseIdFromGroups(content_t id)
 {
+	if (id < m_content_group_ratings.size())
+		m_content_group_ratings[id].clear();
+
 	// For all groups in m_group_to_items...
 	for (auto iter_groups = m_group_to_items.begin();
 			iter_groups != m_group_to_items.end();) {
@@ -1317,6 +1358,7 @@ void NodeDefManager::eraseIdFromGroups(content_t id)
 // IWritableNodeDefManager
 content_t NodeDefManager::set(const std::string &name, const ContentFeatures &def)
 {
+	bumpModificationCounter();
 	// Pre-conditions
 	assert(!name.empty());
 	assert(name != "ignore");
@@ -1341,6 +1383,7 @@ content_t NodeDefManager::set(const std::string &name, const ContentFeatures &de
 	m_content_features[id] = def;
 	m_content_features[id].floats = itemgroup_get(def.groups, "float") != 0;
 	m_content_lighting_flag_cache[id] = def.getLightingFlags();
+	m_content_shape_flag_cache[id] = def.getShapeFlags();
 	verbosestream << "NodeDefManager: registering content id " << id
 		<< ": name=\"" << def.name << "\"" << std::endl;
 
@@ -1352,6 +1395,7 @@ content_t NodeDefManager::set(const std::string &name, const ContentFeatures &de
 		const std::string &group_name = group.first;
 		m_group_to_items[group_name].push_back(id);
 	}
+	setGroupRatings(id, def.groups);
 
 	return id;
 }
@@ -1368,6 +1412,7 @@ content_t NodeDefManager::allocateDummy(const std::string &name)
 
 void NodeDefManager::removeNode(const std::string &name)
 {
+	bumpModificationCounter();
 	// Pre-condition
 	assert(!name.empty());
 
@@ -1399,6 +1444,7 @@ void NodeDefManager::updateAliases(IItemDefManager *idef)
 
 void NodeDefManager::applyTextureOverrides(const std::vector<TextureOverride> &overrides)
 {
+	bumpModificationCounter();
 	infostream << "NodeDefManager::applyTextureOverrides(): Applying "
 		"overrides to textures" << std::endl;
 
@@ -1458,6 +1504,75 @@ void NodeDefManager::applyTextureOverrides(const std::vector<TextureOverride> &o
 	}
 }
 
+#if CHECK_CLIENT_BUILD()
+/*
+	Packs the textures of opaque tiles into array textures, one for each
+	texture size, so that a block can draw them with a few buffers.
+	Animated tiles keep their own textures.
+*/
+static void packArrayTextures(std::vector<ContentFeatures> &features,
+	ITextureSource *tsrc, IShaderSource *shdsrc)
+{
+	// the least GL_MAX_ARRAY_TEXTURE_LAYERS of OpenGL 3
+	constexpr size_t MAX_LAYERS = 256;
+
+	const auto is_packable = [] (const TileLayer &layer) {
+		return layer.texture && layer.material_type == TILE_MATERIAL_OPAQUE &&
+			!(layer.material_flags & MATERIAL_FLAG_ANIMATION);
+	};
+
+	std::map<std::pair<u32, u32>, std::vector<u32>> ids_by_size;
+	std::unordered_set<u32> seen;
+	for (const ContentFeatures &f : features) {
+		for (const TileSpec &tile : f.tiles)
+		for (const TileLayer &layer : tile.layers) {
+			if (!is_packable(layer) || !seen.insert(layer.texture_id).second)
+				continue;
+			const auto size = layer.texture->getOriginalSize();
+			ids_by_size[{size.Width, size.Height}].push_back(layer.texture_id);
+		}
+	}
+
+	// texture id -> (array texture, layer)
+	std::unordered_map<u32, std::pair<video::ITexture*, u16>> packed;
+	u32 array_count = 0;
+	for (const auto &it : ids_by_size) {
+		const std::vector<u32> &ids = it.second;
+		// one texture doesn't save anything
+		if (ids.size() < 2)
+			continue;
+		for (size_t begin = 0; begin < ids.size(); begin += MAX_LAYERS) {
+			std::vector<u32> chunk(ids.begin() + begin,
+				ids.begin() + std::min(begin + MAX_LAYERS, ids.size()));
+			video::ITexture *array = tsrc->getArrayTexture(chunk);
+			if (!array)
+				continue;
+			array_count++;
+			for (u16 layer = 0; layer < chunk.size(); layer++)
+				packed[chunk[layer]] = {array, layer};
+		}
+	}
+
+	for (ContentFeatures &f : features) {
+		for (TileSpec &tile : f.tiles)
+		for (TileLayer &layer : tile.layers) {
+			if (!is_packable(layer))
+				continue;
+			auto it = packed.find(layer.texture_id);
+			if (it == packed.end())
+				continue;
+			layer.array_texture = it->second.first;
+			layer.array_layer = it->second.second;
+			layer.array_shader_id = shdsrc->getShader("nodes_shader",
+				layer.material_type, f.drawtype, true);
+		}
+	}
+
+	infostream << "NodeDefManager: packed " << packed.size()
+		<< " node textures into " << array_count << " array textures" << std::endl;
+}
+#endif
+
 void NodeDefManager::updateTextures(IGameDef *gamedef, void *progress_callback_args)
 {
 #if CHECK_CLIENT_BUILD()
@@ -1474,13 +1589,34 @@ void NodeDefManager::updateTextures(IGameDef *gamedef, void *progress_callback_a
 
 	tsrc->setImageCaching(true);
 
+	// Generate the images of the tiles in parallel first,
+	// the loop below then mostly uploads them
+	std::vector<std::string> names;
+	for (const ContentFeatures &f : m_content_features) {
+		for (u32 j = 0; j < 6; j++) {
+			names.push_back(f.tiledef[j].name.empty() ?
+				"no_texture.png" : f.tiledef[j].name);
+			names.push_back(f.tiledef_overlay[j].name);
+		}
+		for (u32 j = 0; j < CF_SPECIAL_COUNT; j++)
+			names.push_back(f.tiledef_special[j].name);
+	}
+	tsrc->prefetchTexturesForMesh(names);
+
 	u32 size = m_content_features.size();
 	for (u32 i = 0; i < size; i++) {
 		ContentFeatures *f = &(m_content_features[i]);
 		f->updateTextures(tsrc, shdsrc, meshmanip, client, tsettings);
+		// drawtype and solidness depend on the texture settings
+		m_content_shape_flag_cache[i] = f->getShapeFlags();
 		client->showUpdateProgressTexture(progress_callback_args, i, size);
 	}
 
+	// the nodes shader only has array textures with OpenGL 3
+	if (g_settings->getBool("enable_texture_arrays") &&
+			RenderingEngine::get_video_driver()->getDriverType() == video::EDT_OPENGL3)
+		packArrayTextures(m_content_features, tsrc, shdsrc);
+
 	tsrc->setImageCaching(false);
 #endif
 }
@@ -1557,6 +1693,8 @@ void NodeDefManager::deSerialize(std::istream &is, u16 protocol_version)
 		m_content_features[i] = f;
 		m_content_features[i].floats = itemgroup_get(f.groups, "float") != 0;
 		m_content_lighting_flag_cache[i] = f.getLightingFlags();
+		m_content_shape_flag_cache[i] = f.getShapeFlags();
+		setGroupRatings(i, f.groups);
 		addNameIdMapping(i, f.name);
 		TRACESTREAM(<< "NodeDef: deserialized " << f.name << std::endl);
 
@@ -1629,6 +1767,7 @@ void NodeDefManager::resetNodeResolveState()
 
 void NodeDefManager::resolveCrossrefs()
 {
+	bumpModificationCounter();
 	for (ContentFeatures &f : m_content_features) {
 		if (f.isLiquid() || f.isLiquidRender()) {
 			f.liquid_alternative_flowing_id = getId(f.liquid_alternative_flowing);
@@ -1648,18 +1787,18 @@ void NodeDefManager::resolveCrossrefs()
 bool NodeDefManager::nodeboxConnects(MapNode from, MapNode to,
 	u8 connect_face) const
 {
-	const ContentFeatures &f1 = get(from);
-
-	if ((f1.drawtype != NDT_NODEBOX) || (f1.node_box.type != NODEBOX_CONNECTED))
+	if (!getShapeFlags(from).connected)
 		return false;
 
+	const ContentFeatures &f1 = get(from);
+
 	// lookup target in connected set
 	if (!CONTAINS(f1.connects_to_ids, to.param0))
 		return false;
 
 	const ContentFeatures &f2 = get(to);
 
-	if ((f2.drawtype == NDT_NODEBOX) && (f2.node_box.type == NODEBOX_CONNECTED))
+	if (getShapeFlags(to).connected)
 		// ignores actually looking if back connection exists
 		return CONTAINS(f2.connects_to_ids, from.param0);
 
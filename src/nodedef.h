@@ -9,6 +9,7 @@
 #include <iostream>
 #include <memory> // shared_ptr
 #include <map>
+#include <atomic>
 #include "mapnode.h"
 #include "nameidmapping.h"
 #if CHECK_CLIENT_BUILD()
@@ -252,6 +253,23 @@ enum AlignStyle : u8 {
 	AlignStyle_END // Dummy for validity check
 };
 
+/*
+	The few properties that collision, liquid and meshing loops read per node,
+	packed so that the lookups stay in cache. See ContentLightingFlags for
+	the lighting ones.
+*/
+struct ContentShapeFlags {
+	NodeDrawType drawtype;
+	LiquidType liquid_type : 2;
+	u8 solidness : 2; // client only
+	bool walkable : 1;
+	// Drawtype nodebox with a connected node box
+	bool connected : 1;
+	// Walkable and collides like a full, regular node
+	bool full_collision_box : 1;
+};
+static_assert(sizeof(ContentShapeFlags) == 2, "Unexpected ContentShapeFlags size");
+
 enum AlphaMode : u8 {
 	ALPHAMODE_BLEND,
 	ALPHAMODE_CLIP,
@@ -500,6 +518,24 @@ struct ContentFeatures
 		return flags;
 	}
 
+	ContentShapeFlags getShapeFlags() const {
+		ContentShapeFlags flags;
+		flags.drawtype = drawtype;
+		flags.liquid_type = liquid_type;
+#if CHECK_CLIENT_BUILD()
+		flags.solidness = solidness;
+#else
+		flags.solidness = 0;
+#endif
+		flags.walkable = walkable;
+		flags.connected = drawtype == NDT_NODEBOX &&
+			node_box.type == NODEBOX_CONNECTED;
+		// see MapNode::getCollisionBoxes()
+		flags.full_collision_box = walkable && collision_box.fixed.empty() &&
+			node_box.type == NODEBOX_REGULAR && itemgroup_get(groups, "bouncy") == 0;
+		return flags;
+	}
+
 	int getGroup(const std::string &group) const
 	{
 		return itemgroup_get(groups, group);
@@ -568,6 +604,15 @@ class NodeDefManager {
 		return getLightingFlags(n.getContent());
 	}
 
+	inline ContentShapeFlags getShapeFlags(content_t c) const {
+		// Same as above, the array's length is CONTENT_MAX + 1.
+		return m_content_shape_flag_cache[c];
+	}
+
+	inline ContentShapeFlags getShapeFlags(const MapNode &n) const {
+		return getShapeFlags(n.getContent());
+	}
+
 	/*!
 	 * Returns the node properties for a node name.
 	 * @param name name of a node
@@ -602,6 +647,33 @@ class NodeDefManager {
 	 */
 	bool getIds(const std::string &name, std::vector<content_t> &result) const;
 
+	/*!
+	 * Returns the dense ID of a node group, so that hot loops don't have to
+	 * look groups up by name. IDs are assigned when the first node of the
+	 * group is registered and stay valid until clear().
+	 * @param group a group name without the "group:" prefix
+	 * @return the group ID or @ref GROUP_ID_NONE if no node has the group
+	 */
+	u16 getGroupId(const std::string &group) const;
+
+	/*!
+	 * Same as `get(c).getGroup(name)`, for the ID of that group.
+	 * @param c a content ID
+	 * @param group_id a group ID from @ref getGroupId
+	 * @return the rating of the node in the group, 0 if not in it
+	 */
+	inline int getGroupRating(content_t c, u16 group_id) const {
+		if (c >= m_content_group_ratings.size())
+			return 0;
+		for (const auto &rating : m_content_group_ratings[c]) {
+			if (rating.first == group_id)
+				return rating.second;
+		}
+		return 0;
+	}
+
+	static constexpr u16 GROUP_ID_NONE = U16_MAX;
+
 	/*!
 	 * Returns the smallest box in integer node coordinates that
 	 * contains all nodes' selection boxes. The returned box might be larger
@@ -729,6 +801,13 @@ class NodeDefManager {
 	 */
 	void resolveCrossrefs();
 
+	/*!
+	 * Returns a value that changes whenever the serialized form of the
+	 * definitions may have changed.
+	 * Values are never reused, not even by different managers.
+	 */
+	u32 getModificationCounter() const { return m_modification_counter; }
+
 private:
 	/*!
 	 * Resets the manager to its initial state.
@@ -759,6 +838,12 @@ class NodeDefManager {
 	 */
 	void eraseIdFromGroups(content_t id);
 
+	/*!
+	 * Stores the group ratings of a content ID by group ID,
+	 * assigning IDs to new groups.
+	 */
+	void setGroupRatings(content_t id, const ItemGroupList &groups);
+
 	/*!
 	 * Recalculates m_selection_box_int_union based on
 	 * m_selection_box_union.
@@ -785,6 +870,17 @@ class NodeDefManager {
 	 */
 	std::unordered_map<std::string, std::vector<content_t>> m_group_to_items;
 
+	/*!
+	 * Dense IDs of all groups seen so far, see @ref getGroupId().
+	 */
+	std::unordered_map<std::string, u16> m_group_ids;
+
+	/*!
+	 * (group ID, rating) pairs of each content ID, see @ref getGroupRating().
+	 * Note: Filled on the client too, unlike \ref m_group_to_items.
+	 */
+	std::vector<std::vector<std::pair<u16, int>>> m_content_group_ratings;
+
 	/*!
 	 * The next ID that might be free to allocate.
 	 * It can be allocated already, because \ref CONTENT_AIR,
@@ -796,6 +892,16 @@ class NodeDefManager {
 	//! True if all nodes have been registered.
 	bool m_node_registration_complete;
 
+	//! See \ref getModificationCounter().
+	u32 m_modification_counter = 0;
+	static std::atomic<u32> s_modification_counter;
+
+	void bumpModificationCounter()
+	{
+		m_modification_counter = s_modification_counter.fetch_add(1,
+			std::memory_order_relaxed) + 1;
+	}
+
 	/*!
 	 * The union of all nodes' selection boxes.
 	 * Might be larger if big nodes are removed from the manager.
@@ -819,6 +925,11 @@ class NodeDefManager {
 	 * Fast cache of content lighting flags.
 	 */
 	ContentLightingFlags m_content_lighting_flag_cache[CONTENT_MAX + 1L];
+
+	/*!
+	 * Fast cache of content shape flags.
+	 */
+	ContentShapeFlags m_content_shape_flag_cache[CONTENT_MAX + 1L];
 };
 
 NodeDefManager *createNodeDefManager();
@@ -10,6 +10,7 @@
 #include "log.h"
 #include "debug.h"
 #include "util/serialize.h"
+#include "util/string.h"
 #include "constants.h" // MAP_BLOCKSIZE
 #include <sstream>
 
@@ -91,10 +92,82 @@ int NodeMetadata::countNonPrivate() const
 	return n;
 }
 
+size_t NodeMetadata::getMemoryUsage() const
+{
+	size_t bytes = sizeof(NodeMetadata) + SimpleMetadata::getMemoryUsage();
+	if (m_inventory)
+		bytes += m_inventory->getMemoryUsage();
+	for (const std::string &name : m_privatevars)
+		bytes += sizeof(name) + 2 * sizeof(void *) + string_heap_usage(name);
+	return bytes;
+}
+
 /*
 	NodeMetadataList
 */
 
+static void copy_serialized_string(std::istream &is, size_t len, std::string &buf)
+{
+	const size_t old_size = buf.size();
+	buf.resize(old_size + len);
+	is.read(&buf[old_size], len);
+	if (is.gcount() != (std::streamsize)len)
+		throw SerializationError("copy_serialized_string: size not read");
+}
+
+// Copies one entry as written by NodeMetadata::serialize() to buf,
+// only looking at as much of it as needed to find its end.
+static void copy_serialized_meta(std::istream &is, u8 version, std::string &buf,
+		bool *empty, bool *has_private)
+{
+	u8 tmp[4];
+	u32 num_vars = readU32(is);
+	writeU32(tmp, num_vars);
+	buf.append((char *)tmp, 4);
+	*has_private = false;
+	for (u32 i = 0; i < num_vars; i++) {
+		u16 name_len = readU16(is);
+		writeU16(tmp, name_len);
+		buf.append((char *)tmp, 2);
+		copy_serialized_string(is, name_len, buf);
+
+		u32 var_len = readU32(is);
+		writeU32(tmp, var_len);
+		buf.append((char *)tmp, 4);
+		copy_serialized_string(is, var_len, buf);
+
+		if (version >= 2) {
+			u8 priv = readU8(is);
+			buf.push_back(priv);
+			*has_private |= priv == 1;
+		}
+	}
+
+	// Same terminators as Inventory::deSerialize and InventoryList::deSerialize
+	bool in_list = false;
+	bool has_lists = false;
+	while (is.good()) {
+		std::string line;
+		std::getline(is, line, '\n');
+		buf.append(line).push_back('\n');
+
+		std::string_view name(line);
+		name = name.substr(0, name.find(' '));
+		if (in_list) {
+			if (name == "EndInventoryList" || name == "end")
+				in_list = false;
+		} else if (name == "EndInventory" || name == "end") {
+			*empty = num_vars == 0 && !has_lists;
+			return;
+		} else if (name == "List") {
+			in_list = true;
+			has_lists = true;
+		}
+	}
+
+	throw SerializationError("Malformatted inventory (damaged?)");
+}
+
 void NodeMetadataList::serialize(std::ostream &os, u8 blockver, bool disk,
 	bool absolute_pos, bool include_empty) const
 {
@@ -102,7 +175,7 @@ void NodeMetadataList::serialize(std::ostream &os, u8 blockver, bool disk,
 		Version 0 is a placeholder for "nothing to see here; go away."
 	*/
 
-	u16 count = include_empty ? m_data.size() : countNonEmpty();
+	u16 count = include_empty ? size() : countNonEmpty();
 	if (count == 0) {
 		writeU8(os, 0); // version
 		return;
@@ -112,13 +185,28 @@ void NodeMetadataList::serialize(std::ostream &os, u8 blockver, bool disk,
 	writeU8(os, version);
 	writeU16(os, count);
 
-	for (NodeMetadataMap::const_iterator
-			i = m_data.begin();
-			i != m_data.end(); ++i) {
-		v3s16 p = i->first;
-		NodeMetadata *data = i->second;
-		if (!include_empty && data->empty())
-			continue;
+	// Both maps are written in position order
+	auto i = m_data.begin();
+	auto j = m_serialized.begin();
+	while (i != m_data.end() || j != m_serialized.end()) {
+		const bool parsed = j == m_serialized.end() ||
+			(i != m_data.end() && i->first < j->first);
+		v3s16 p;
+		NodeMetadata *data = nullptr;
+		const SerializedEntry *entry = nullptr;
+		if (parsed) {
+			p = i->first;
+			data = i->second;
+			++i;
+			if (!include_empty && data->empty())
+				continue;
+		} else {
+			p = j->first;
+			entry = &j->second;
+			++j;
+			if (!include_empty && entry->empty)
+				continue;
+		}
 
 		if (absolute_pos) {
 			writeS16(os, p.X);
@@ -131,7 +219,17 @@ void NodeMetadataList::serialize(std::ostream &os, u8 blockver, bool disk,
 			u16 p16 = (p.Z * MAP_BLOCKSIZE + p.Y) * MAP_BLOCKSIZE + p.X;
 			writeU16(os, p16);
 		}
-		data->serialize(os, version, disk);
+
+		if (data) {
+			data->serialize(os, version, disk);
+		} else if (version == m_serialized_version &&
+				(disk || !entry->has_private)) {
+			// Unchanged since it was loaded
+			os.write(&m_serialized_data[entry->offset], entry->size);
+		} else {
+			std::unique_ptr<NodeMetadata> tmp(deSerializeEntry(*entry));
+			tmp->serialize(os, version, disk);
+		}
 	}
 }
 
@@ -156,6 +254,11 @@ void NodeMetadataList::deSerialize(std::istream &is,
 
 	u16 count = readU16(is);
 
+	if (m_is_metadata_owner) {
+		m_serialized_version = version;
+		m_item_def_mgr = item_def_mgr;
+	}
+
 	for (u16 i = 0; i < count; i++) {
 		v3s16 p;
 		if (absolute_pos) {
@@ -170,16 +273,52 @@ void NodeMetadataList::deSerialize(std::istream &is,
 			p16 /= MAP_BLOCKSIZE;
 			p.Z = p16;
 		}
-		if (m_data.find(p) != m_data.end()) {
+		if (m_data.find(p) != m_data.end() ||
+				m_serialized.find(p) != m_serialized.end()) {
 			warningstream << "NodeMetadataList::deSerialize(): "
 					<< "already set data at position " << p
 					<< ": Ignoring." << std::endl;
 			continue;
 		}
 
-		NodeMetadata *data = new NodeMetadata(item_def_mgr);
-		data->deSerialize(is, version);
-		m_data[p] = data;
+		if (!m_is_metadata_owner) {
+			// The entries will be handed out, parse them right away
+			NodeMetadata *data = new NodeMetadata(item_def_mgr);
+			data->deSerialize(is, version);
+			m_data[p] = data;
+			continue;
+		}
+
+		SerializedEntry entry;
+		entry.offset = m_serialized_data.size();
+		copy_serialized_meta(is, version, m_serialized_data,
+				&entry.empty, &entry.has_private);
+		entry.size = m_serialized_data.size() - entry.offset;
+		m_serialized[p] = entry;
+	}
+}
+
+NodeMetadata *NodeMetadataList::deSerializeEntry(const SerializedEntry &entry) const
+{
+	std::istringstream is(m_serialized_data.substr(entry.offset, entry.size),
+			std::ios::binary);
+	auto data = std::make_unique<NodeMetadata>(m_item_def_mgr);
+	data->deSerialize(is, m_serialized_version);
+	return data.release();
+}
+
+void NodeMetadataList::deSerializeAll()
+{
+	while (!m_serialized.empty())
+		get(m_serialized.begin()->first);
+}
+
+void NodeMetadataList::eraseSerialized(std::map<v3s16, SerializedEntry>::iterator it)
+{
+	m_serialized.erase(it);
+	if (m_serialized.empty()) {
+		m_serialized_data.clear();
+		m_serialized_data.shrink_to_fit();
 	}
 }
 
@@ -191,9 +330,11 @@ NodeMetadataList::~NodeMetadataList()
 std::vector<v3s16> NodeMetadataList::getAllKeys()
 {
 	std::vector<v3s16> keys;
-	keys.reserve(m_data.size());
+	keys.reserve(size());
 	for (const auto &it : m_data)
 		keys.push_back(it.first);
+	for (const auto &it : m_serialized)
+		keys.push_back(it.first);
 
 	return keys;
 }
@@ -201,13 +342,33 @@ std::vector<v3s16> NodeMetadataList::getAllKeys()
 NodeMetadata *NodeMetadataList::get(v3s16 p)
 {
 	NodeMetadataMap::const_iterator n = m_data.find(p);
-	if (n == m_data.end())
+	if (n != m_data.end())
+		return n->second;
+
+	auto it = m_serialized.find(p);
+	if (it == m_serialized.end())
 		return nullptr;
-	return n->second;
+
+	NodeMetadata *data = nullptr;
+	try {
+		data = deSerializeEntry(it->second);
+		m_data[p] = data;
+	} catch (SerializationError &e) {
+		errorstream << "NodeMetadataList: dropping damaged metadata at "
+			<< p << ": " << e.what() << std::endl;
+	}
+	eraseSerialized(it);
+	return data;
 }
 
 void NodeMetadataList::remove(v3s16 p)
 {
+	auto it = m_serialized.find(p);
+	if (it != m_serialized.end()) {
+		eraseSerialized(it);
+		return;
+	}
+
 	NodeMetadata *olddata = get(p);
 	if (olddata) {
 		if (m_is_metadata_owner) {
@@ -234,6 +395,34 @@ void NodeMetadataList::clear()
 			delete it->second;
 	}
 	m_data.clear();
+	m_serialized.clear();
+	m_serialized_data.clear();
+	m_serialized_data.shrink_to_fit();
+}
+
+void NodeMetadataList::swap(NodeMetadataList &other)
+{
+	assert(m_is_metadata_owner && other.m_is_metadata_owner);
+	m_data.swap(other.m_data);
+	m_serialized.swap(other.m_serialized);
+	m_serialized_data.swap(other.m_serialized_data);
+	std::swap(m_serialized_version, other.m_serialized_version);
+	std::swap(m_item_def_mgr, other.m_item_def_mgr);
+}
+
+size_t NodeMetadataList::getMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (const auto &it : m_data) {
+		// a tree node holds the pair, three pointers and the color
+		bytes += sizeof(it) + 4 * sizeof(void *);
+		if (m_is_metadata_owner)
+			bytes += it.second->getMemoryUsage();
+	}
+	bytes += m_serialized.size() *
+		(sizeof(*m_serialized.begin()) + 4 * sizeof(void *));
+	bytes += m_serialized_data.capacity();
+	return bytes;
 }
 
 int NodeMetadataList::countNonEmpty() const
@@ -243,5 +432,9 @@ int NodeMetadataList::countNonEmpty() const
 		if (!it.second->empty())
 			n++;
 	}
+	for (const auto &it : m_serialized) {
+		if (!it.second.empty)
+			n++;
+	}
 	return n;
 }
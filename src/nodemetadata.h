@@ -48,6 +48,9 @@ class NodeMetadata : public SimpleMetadata
 	/// @return metadata modified?
 	bool markPrivate(const std::string &name, bool set);
 
+	// Approximate memory used by the metadata
+	size_t getMemoryUsage() const;
+
 private:
 	int countNonPrivate() const;
 
@@ -58,6 +61,10 @@ class NodeMetadata : public SimpleMetadata
 
 /*
 	List of metadata of all the nodes of a block
+
+	When owning its metadata, deSerialize() only copies the serialized
+	entries into a single buffer. An entry is parsed on first access, so
+	blocks whose metadata is never touched don't pay for it.
 */
 
 typedef std::map<v3s16, NodeMetadata *> NodeMetadataMap;
@@ -86,11 +93,16 @@ class NodeMetadataList
 	void set(v3s16 p, NodeMetadata *d);
 	// Deletes all
 	void clear();
+	// Exchanges the contents with another list that owns its metadata
+	void swap(NodeMetadataList &other);
 
-	size_t size() const { return m_data.size(); }
+	size_t size() const { return m_data.size() + m_serialized.size(); }
+	// Approximate memory used by the metadata of all nodes
+	size_t getMemoryUsage() const;
 
 	NodeMetadataMap::const_iterator begin()
 	{
+		deSerializeAll();
 		return m_data.begin();
 	}
 
@@ -100,8 +112,25 @@ class NodeMetadataList
 	}
 
 private:
+	// Location of a not yet parsed entry in m_serialized_data
+	struct SerializedEntry {
+		size_t offset;
+		size_t size;
+		bool empty;
+		bool has_private;
+	};
+
 	int countNonEmpty() const;
 
+	NodeMetadata *deSerializeEntry(const SerializedEntry &entry) const;
+	void deSerializeAll();
+	void eraseSerialized(std::map<v3s16, SerializedEntry>::iterator it);
+
 	bool m_is_metadata_owner;
 	NodeMetadataMap m_data;
+
+	std::map<v3s16, SerializedEntry> m_serialized;
+	std::string m_serialized_data;
+	u8 m_serialized_version = 0;
+	IItemDefManager *m_item_def_mgr = nullptr;
 };
@@ -0,0 +1,115 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "nodepalette.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+u8 NodePalette::bitsFor(u32 palette_size)
+{
+	if (palette_size <= 1)
+		return 0;
+	if (palette_size <= 2)
+		return 1;
+	if (palette_size <= 4)
+		return 2;
+	if (palette_size <= 16)
+		return 4;
+	return 8;
+}
+
+static inline u32 nodeKey(MapNode n)
+{
+	return (u32)n.param0 << 16 | (u32)n.param1 << 8 | n.param2;
+}
+
+bool NodePalette::pack(const MapNode *nodes, u32 count)
+{
+	m_palette.clear();
+	m_indices.reset();
+	m_bits = 0;
+	m_count = 0;
+
+	// Map nodes to palette indices first, bail out early if there are too many
+	std::unique_ptr<u8[]> tmp(new u8[count]);
+	std::unordered_map<u32, u8> lookup;
+	MapNode prev_n;
+	u8 prev_idx = 0;
+	for (u32 i = 0; i < count; i++) {
+		const MapNode n = nodes[i];
+		// Nodes tend to come in runs, which avoids most map lookups
+		if (i > 0 && n == prev_n) {
+			tmp[i] = prev_idx;
+			continue;
+		}
+		auto it = lookup.find(nodeKey(n));
+		if (it == lookup.end()) {
+			if (m_palette.size() >= MAX_SIZE) {
+				m_palette.clear();
+				return false;
+			}
+			it = lookup.emplace(nodeKey(n), m_palette.size()).first;
+			m_palette.push_back(n);
+		}
+		tmp[i] = prev_idx = it->second;
+		prev_n = n;
+	}
+
+	m_count = count;
+	m_bits = bitsFor(m_palette.size());
+	if (m_bits == 0)
+		return true;
+
+	const u32 bytes = (count * m_bits + 7) / 8;
+	m_indices.reset(new u8[bytes]);
+	memset(m_indices.get(), 0, bytes);
+	for (u32 i = 0; i < count; i++) {
+		const u32 bit = i * m_bits;
+		m_indices[bit >> 3] |= tmp[i] << (bit & 7);
+	}
+	return true;
+}
+
+void NodePalette::unpack(MapNode *nodes) const
+{
+	if (m_bits == 0) {
+		std::fill(nodes, nodes + m_count, m_palette[0]);
+		return;
+	}
+	if (m_bits == 8) {
+		for (u32 i = 0; i < m_count; i++)
+			nodes[i] = m_palette[m_indices[i]];
+		return;
+	}
+	for (u32 i = 0; i < m_count; i++)
+		nodes[i] = get(i);
+}
+
+bool NodePalette::set(u32 i, MapNode n)
+{
+	u32 idx = 0;
+	while (idx < m_palette.size() && m_palette[idx] != n)
+		idx++;
+	if (idx == m_palette.size()) {
+		// Palette entries that fit into the current bit width are free
+		if (m_bits == 0 || idx >= (1U << m_bits))
+			return false;
+		m_palette.push_back(n);
+	}
+	if (m_bits == 0)
+		return true; // index is always 0
+
+	const u32 bit = i * m_bits;
+	const u32 mask = (1U << m_bits) - 1;
+	u8 &b = m_indices[bit >> 3];
+	b = (b & ~(mask << (bit & 7))) | (idx << (bit & 7));
+	return true;
+}
+
+size_t NodePalette::getMemoryUsage() const
+{
+	return m_palette.capacity() * sizeof(MapNode) +
+		(m_bits == 0 ? 0 : (m_count * m_bits + 7) / 8);
+}
@@ -0,0 +1,59 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "irrlichttypes.h"
+#include "mapnode.h"
+
+/*
+	Palette-compressed storage for the nodes of a MapBlock.
+
+	Every distinct MapNode (content and both params) gets a palette entry,
+	the per-node indices into the palette are packed with 0, 1, 2, 4 or 8 bits.
+	A block made of a single node needs no index data at all.
+*/
+class NodePalette
+{
+public:
+	// Maximum number of palette entries
+	static constexpr u32 MAX_SIZE = 256;
+
+	// Builds the palette from a flat node array.
+	// Returns false (and leaves the object empty) if there are too many
+	// distinct nodes.
+	bool pack(const MapNode *nodes, u32 count);
+
+	// Decodes all nodes into a flat array of the packed size
+	void unpack(MapNode *nodes) const;
+
+	inline MapNode get(u32 i) const
+	{
+		if (m_bits == 0)
+			return m_palette[0];
+		const u32 bit = i * m_bits;
+		const u32 mask = (1U << m_bits) - 1;
+		return m_palette[(m_indices[bit >> 3] >> (bit & 7)) & mask];
+	}
+
+	// Changes a node without increasing the number of bits per node.
+	// Returns false if that is not possible.
+	bool set(u32 i, MapNode n);
+
+	const std::vector<MapNode> &getPalette() const { return m_palette; }
+	u8 getBitsPerNode() const { return m_bits; }
+
+	// Approximate heap memory used
+	size_t getMemoryUsage() const;
+
+private:
+	static u8 bitsFor(u32 palette_size);
+
+	u32 m_count = 0;
+	u8 m_bits = 0;
+	std::vector<MapNode> m_palette;
+	std::unique_ptr<u8[]> m_indices;
+};
@@ -48,7 +48,7 @@ void NodeTimerList::serialize(std::ostream &os, u8 map_format_version) const
 	for (const auto &timer : m_timers) {
 		NodeTimer t = timer.second;
 		NodeTimer nt = NodeTimer(t.timeout,
-			t.timeout - (f32)(timer.first - m_time), t.position);
+			t.timeout - (f32)(timer.first - getTime()), t.position);
 		v3s16 p = t.position;
 
 		u16 p16 = p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
@@ -113,15 +113,18 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 std::vector<NodeTimer> NodeTimerList::step(float dtime)
 {
 	std::vector<NodeTimer> elapsed_timers;
-	m_time += dtime;
-	if (m_next_trigger_time == -1. || m_time < m_next_trigger_time) {
+	if (!m_queue)
+		m_time += dtime;
+	const double time = getTime();
+	if (m_next_trigger_time == -1. || time < m_next_trigger_time) {
+		schedule();
 		return elapsed_timers;
 	}
 	auto i = m_timers.begin();
 	// Process timers
-	for (; i != m_timers.end() && i->first <= m_time; ++i) {
+	for (; i != m_timers.end() && i->first <= time; ++i) {
 		NodeTimer t = i->second;
-		t.elapsed = t.timeout + (f32)(m_time - i->first);
+		t.elapsed = t.timeout + (f32)(time - i->first);
 		elapsed_timers.push_back(t);
 		m_iterators.erase(t.position);
 	}
@@ -131,5 +134,75 @@ std::vector<NodeTimer> NodeTimerList::step(float dtime)
 		m_next_trigger_time = -1.;
 	else
 		m_next_trigger_time = m_timers.begin()->first;
+	schedule();
 	return elapsed_timers;
 }
+
+void NodeTimerList::attach(NodeTimerQueue *queue, v3s16 blockpos)
+{
+	detach();
+	m_queue = queue;
+	m_blockpos = blockpos;
+
+	// Move the timers to the time of the queue, so that the queue and the
+	// list agree exactly on when a timer is due
+	const double shift = queue->getTime() - m_time;
+	m_time = queue->getTime();
+	if (shift != 0 && !m_timers.empty()) {
+		std::multimap<double, NodeTimer> timers;
+		m_iterators.clear();
+		for (auto &it : m_timers) {
+			auto it2 = timers.emplace_hint(timers.end(), it.first + shift, it.second);
+			m_iterators.emplace(it.second.position, it2);
+		}
+		m_timers = std::move(timers);
+		m_next_trigger_time = m_timers.begin()->first;
+	}
+	schedule();
+}
+
+void NodeTimerList::detach()
+{
+	if (!m_queue)
+		return;
+	m_time = getTime();
+	m_queue = nullptr;
+	m_scheduled = -1.;
+}
+
+bool NodeTimerList::takeScheduled(const NodeTimerQueue *queue, double due)
+{
+	// Yes, this is float equality, the value is only copied around
+	if (m_queue != queue || m_scheduled != due)
+		return false;
+	m_scheduled = -1.;
+	return true;
+}
+
+double NodeTimerList::getTime() const
+{
+	return m_queue ? m_queue->getTime() : m_time;
+}
+
+void NodeTimerList::schedule()
+{
+	if (!m_queue || m_next_trigger_time == -1.)
+		return;
+	if (m_scheduled == -1. || m_next_trigger_time < m_scheduled) {
+		m_scheduled = m_next_trigger_time;
+		m_queue->push(m_scheduled, m_blockpos);
+	}
+}
+
+/*
+	NodeTimerQueue
+*/
+
+void NodeTimerQueue::step(float dtime, std::vector<Entry> &due)
+{
+	m_time += dtime;
+	while (!m_heap.empty() && m_heap.top().due <= m_time) {
+		due.push_back(m_heap.top());
+		m_heap.pop();
+	}
+}
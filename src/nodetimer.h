@@ -7,6 +7,7 @@
 #include "irr_v3d.h"
 #include <iostream>
 #include <map>
+#include <queue>
 #include <vector>
 
 /*
@@ -35,6 +36,8 @@ class NodeTimer
 	v3s16 position;
 };
 
+class NodeTimerQueue;
+
 /*
 	List of timers of all the nodes of a block
 */
@@ -54,7 +57,7 @@ class NodeTimerList
 		if (n == m_iterators.end())
 			return NodeTimer();
 		NodeTimer t = n->second->second;
-		t.elapsed = t.timeout - (n->second->first - m_time);
+		t.elapsed = t.timeout - (n->second->first - getTime());
 		return t;
 	}
 	// Deletes timer
@@ -78,11 +81,13 @@ class NodeTimerList
 	// Undefined behavior if there already is a timer
 	void insert(const NodeTimer &timer) {
 		v3s16 p = timer.position;
-		double trigger_time = m_time + (double)(timer.timeout - timer.elapsed);
+		double trigger_time = getTime() + (double)(timer.timeout - timer.elapsed);
 		auto it = m_timers.emplace(trigger_time, timer);
 		m_iterators.emplace(p, it);
-		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time)
+		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time) {
 			m_next_trigger_time = trigger_time;
+			schedule();
+		}
 	}
 	// Deletes old timer and sets a new one
 	inline void set(const NodeTimer &timer) {
@@ -96,12 +101,67 @@ class NodeTimerList
 		m_next_trigger_time = -1.;
 	}
 
-	// Move forward in time, returns elapsed timers
+	// Move forward in time, returns elapsed timers.
+	// While attached to a queue the time comes from the queue, use a dtime
+	// of 0 then.
 	std::vector<NodeTimer> step(float dtime);
 
+	/*
+		Attaching makes the timers follow the clock of the queue, which
+		then knows when the next timer of this list elapses.
+		blockpos identifies the list in the queue.
+	*/
+	void attach(NodeTimerQueue *queue, v3s16 blockpos);
+	void detach();
+	bool isAttached(const NodeTimerQueue *queue) const { return m_queue == queue; }
+
+	// Called for an entry popped from the queue.
+	// Returns false if the entry is outdated.
+	bool takeScheduled(const NodeTimerQueue *queue, double due);
+
 private:
+	double getTime() const;
+	// Tells the queue about m_next_trigger_time if it is due earlier than
+	// what was scheduled before
+	void schedule();
+
 	std::multimap<double, NodeTimer> m_timers;
 	std::map<v3s16, std::multimap<double, NodeTimer>::iterator> m_iterators;
 	double m_next_trigger_time = -1.0;
 	double m_time = 0.0;
+
+	NodeTimerQueue *m_queue = nullptr;
+	v3s16 m_blockpos;
+	// due time of the entry in the queue
+	double m_scheduled = -1.0;
+};
+
+/*
+	Shared clock and min-heap of the node timer lists of all active blocks,
+	ordered by when their next timer elapses.
+	A list may have outdated entries in the heap, see takeScheduled().
+*/
+
+class NodeTimerQueue
+{
+public:
+	struct Entry {
+		double due;
+		v3s16 blockpos;
+
+		bool operator>(const Entry &other) const { return due > other.due; }
+	};
+
+	double getTime() const { return m_time; }
+
+	void push(double due, v3s16 blockpos) { m_heap.push({due, blockpos}); }
+
+	// Moves forward in time, appends the entries that are due to `due`
+	void step(float dtime, std::vector<Entry> &due);
+
+	size_t size() const { return m_heap.size(); }
+
+private:
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_heap;
+	double m_time = 0.0;
 };
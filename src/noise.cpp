@@ -379,6 +379,8 @@ Noise::~Noise()
 	delete[] persist_buf;
 	delete[] noise_buf;
 	delete[] result;
+	delete[] cell_x_buf;
+	delete[] weight_x_buf;
 }
 
 
@@ -397,12 +399,16 @@ void Noise::allocBuffers()
 	delete[] value_buf;
 	delete[] persist_buf;
 	delete[] result;
+	delete[] cell_x_buf;
+	delete[] weight_x_buf;
 
 	try {
 		size_t bufsize = sx * sy * sz;
 		this->persist_buf = NULL;
 		this->value_buf = new float[bufsize];
 		this->result = new float[bufsize];
+		this->cell_x_buf = new u32[sx];
+		this->weight_x_buf = new float[sx];
 	} catch (std::bad_alloc &e) {
 		throw InvalidNoiseParamsException();
 	}
@@ -489,14 +495,38 @@ void Noise::resizeNoiseBuf(bool is3d)
  * values from the previous noise lattice as midpoints in the new lattice for the
  * next octave.
  */
+/*
+ * The interpolation runs in the same order as biLinearInterpolation() and
+ * triLinearInterpolation(), along x first, so the results are bit-identical
+ * to interpolating every point on its own.
+ * Only the interpolation weights are computed up front: those along x once per
+ * call, the others once per row. This leaves the inner loops free of
+ * branches and dependencies between points, so the compiler can vectorize them.
+ */
+void Noise::calcWeightsX(float u, float step_x, bool eased)
+{
+	u32 noisex = 0;
+	for (u32 i = 0; i != sx; i++) {
+		cell_x_buf[i] = noisex;
+		weight_x_buf[i] = eased ? easeCurve(u) : u;
+
+		u += step_x;
+		if (u >= 1.0) {
+			u -= 1.0;
+			noisex++;
+		}
+	}
+}
+
+
 #define idx(x, y) ((y) * nlx + (x))
 void Noise::valueMap2D(
 		float x, float y,
 		float step_x, float step_y,
 		s32 seed)
 {
-	float v00, v01, v10, v11, u, v, orig_u;
-	u32 index, i, j, noisex, noisey;
+	float u, v;
+	u32 index, i, j, noisey;
 	u32 nlx, nly;
 	s32 x0, y0;
 
@@ -505,7 +535,6 @@ void Noise::valueMap2D(
 	y0 = std::floor(y);
 	u = x - (float)x0;
 	v = y - (float)y0;
-	orig_u = u;
 
 	//calculate noise point lattice
 	nlx = (u32)(u + sx * step_x) + 2;
@@ -515,30 +544,22 @@ void Noise::valueMap2D(
 		for (i = 0; i != nlx; i++)
 			noise_buf[index++] = noise2d(x0 + i, y0 + j, seed);
 
+	calcWeightsX(u, step_x, eased);
+
 	//calculate interpolations
 	index  = 0;
 	noisey = 0;
 	for (j = 0; j != sy; j++) {
-		v00 = noise_buf[idx(0, noisey)];
-		v10 = noise_buf[idx(1, noisey)];
-		v01 = noise_buf[idx(0, noisey + 1)];
-		v11 = noise_buf[idx(1, noisey + 1)];
+		const float *row0 = &noise_buf[idx(0, noisey)];
+		const float *row1 = &noise_buf[idx(0, noisey + 1)];
+		const float wy = eased ? easeCurve(v) : v;
 
-		u = orig_u;
-		noisex = 0;
 		for (i = 0; i != sx; i++) {
-			value_buf[index++] =
-				biLinearInterpolation(v00, v10, v01, v11, u, v, eased);
-
-			u += step_x;
-			if (u >= 1.0) {
-				u -= 1.0;
-				noisex++;
-				v00 = v10;
-				v01 = v11;
-				v10 = noise_buf[idx(noisex + 1, noisey)];
-				v11 = noise_buf[idx(noisex + 1, noisey + 1)];
-			}
+			const u32 nx = cell_x_buf[i];
+			const float wx = weight_x_buf[i];
+			float u0 = linearInterpolation(row0[nx], row0[nx + 1], wx);
+			float u1 = linearInterpolation(row1[nx], row1[nx + 1], wx);
+			value_buf[index++] = linearInterpolation(u0, u1, wy);
 		}
 
 		v += step_y;
@@ -557,10 +578,8 @@ void Noise::valueMap3D(
 		float step_x, float step_y, float step_z,
 		s32 seed)
 {
-	float v000, v010, v100, v110;
-	float v001, v011, v101, v111;
-	float u, v, w, orig_u, orig_v;
-	u32 index, i, j, k, noisex, noisey, noisez;
+	float u, v, w, orig_v;
+	u32 index, i, j, k, noisey, noisez;
 	u32 nlx, nly, nlz;
 	s32 x0, y0, z0;
 
@@ -572,7 +591,6 @@ void Noise::valueMap3D(
 	u = x - (float)x0;
 	v = y - (float)y0;
 	w = z - (float)z0;
-	orig_u = u;
 	orig_v = v;
 
 	//calculate noise point lattice
@@ -585,45 +603,33 @@ void Noise::valueMap3D(
 			for (i = 0; i != nlx; i++)
 				noise_buf[index++] = noise3d(x0 + i, y0 + j, z0 + k, seed);
 
+	calcWeightsX(u, step_x, eased);
+
 	//calculate interpolations
 	index  = 0;
-	noisey = 0;
 	noisez = 0;
 	for (k = 0; k != sz; k++) {
+		const float wz = eased ? easeCurve(w) : w;
 		v = orig_v;
 		noisey = 0;
 		for (j = 0; j != sy; j++) {
-			v000 = noise_buf[idx(0, noisey,     noisez)];
-			v100 = noise_buf[idx(1, noisey,     noisez)];
-			v010 = noise_buf[idx(0, noisey + 1, noisez)];
-			v110 = noise_buf[idx(1, noisey + 1, noisez)];
-			v001 = noise_buf[idx(0, noisey,     noisez + 1)];
-			v101 = noise_buf[idx(1, noisey,     noisez + 1)];
-			v011 = noise_buf[idx(0, noisey + 1, noisez + 1)];
-			v111 = noise_buf[idx(1, noisey + 1, noisez + 1)];
-
-			u = orig_u;
-			noisex = 0;
+			const float *row00 = &noise_buf[idx(0, noisey,     noisez)];
+			const float *row10 = &noise_buf[idx(0, noisey + 1, noisez)];
+			const float *row01 = &noise_buf[idx(0, noisey,     noisez + 1)];
+			const float *row11 = &noise_buf[idx(0, noisey + 1, noisez + 1)];
+			const float wy = eased ? easeCurve(v) : v;
+
 			for (i = 0; i != sx; i++) {
-				value_buf[index++] = triLinearInterpolation(
-					v000, v100, v010, v110,
-					v001, v101, v011, v111,
-					u, v, w,
-					eased);
-
-				u += step_x;
-				if (u >= 1.0) {
-					u -= 1.0;
-					noisex++;
-					v000 = v100;
-					v010 = v110;
-					v100 = noise_buf[idx(noisex + 1, noisey,     noisez)];
-					v110 = noise_buf[idx(noisex + 1, noisey + 1, noisez)];
-					v001 = v101;
-					v011 = v111;
-					v101 = noise_buf[idx(noisex + 1, noisey,     noisez + 1)];
-					v111 = noise_buf[idx(noisex + 1, noisey + 1, noisez + 1)];
-				}
+				const u32 nx = cell_x_buf[i];
+				const float wx = weight_x_buf[i];
+				float u00 = linearInterpolation(row00[nx], row00[nx + 1], wx);
+				float u10 = linearInterpolation(row10[nx], row10[nx + 1], wx);
+				float u01 = linearInterpolation(row01[nx], row01[nx + 1], wx);
+				float u11 = linearInterpolation(row11[nx], row11[nx + 1], wx);
+				value_buf[index++] = linearInterpolation(
+					linearInterpolation(u00, u10, wy),
+					linearInterpolation(u01, u11, wy),
+					wz);
 			}
 
 			v += step_y;
@@ -194,8 +194,14 @@ class Noise {
 	}
 
 private:
+	// Lattice cell and interpolation weight of every point along x,
+	// they are the same for all rows
+	u32 *cell_x_buf = nullptr;
+	float *weight_x_buf = nullptr;
+
 	void allocBuffers();
 	void resizeNoiseBuf(bool is3d);
+	void calcWeightsX(float u, float step_x, bool eased);
 	void updateResults(float g, float *gmap, const float *persistence_map,
 			size_t bufsize);
 
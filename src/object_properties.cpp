@@ -9,6 +9,7 @@
 #include "log.h"
 #include "util/serialize.h"
 #include "util/enum_string.h"
+#include <cmath>
 #include <sstream>
 #include <tuple>
 
@@ -75,6 +76,7 @@ std::string ObjectProperties::dump() const
 	os << ", rotate_selectionbox=" << rotate_selectionbox;
 	os << ", pointable=" << Pointabilities::toStringPointabilityType(pointable);
 	os << ", static_save=" << static_save;
+	os << ", sleep_interval=" << sleep_interval;
 	os << ", eye_height=" << eye_height;
 	os << ", zoom_fov=" << zoom_fov;
 	os << ", node=(" << (int)node.getContent() << ", " << (int)node.getParam1()
@@ -98,7 +100,7 @@ static auto tie(const ObjectProperties &o)
 	o.node, o.hp_max, o.breath_max, o.glow, o.pointable, o.physical,
 	o.collideWithObjects, o.rotate_selectionbox, o.is_visible, o.makes_footstep_sound,
 	o.automatic_face_movement_dir, o.backface_culling, o.static_save, o.use_texture_alpha,
-	o.shaded, o.show_on_minimap
+	o.shaded, o.show_on_minimap, o.sleep_interval
 	);
 }
 
@@ -136,6 +138,11 @@ bool ObjectProperties::validate()
 		wield_item.clear();
 		ret = false;
 	}
+	if (!std::isfinite(sleep_interval) || sleep_interval < 0) {
+		warningstream << func << "sleep_interval is invalid, disabling sleep." << std::endl;
+		sleep_interval = 0;
+		ret = false;
+	}
 
 	return ret;
 }
@@ -59,6 +59,8 @@ struct ObjectProperties
 	MapNode node = MapNode(CONTENT_IGNORE);
 	u16 hp_max = 1;
 	u16 breath_max = 0;
+	// Server only: idle entities far from players are stepped this often
+	f32 sleep_interval = 0.0f;
 	s8 glow = 0;
 	PointabilityType pointable = PointabilityType::POINTABLE;
 	// In a future protocol these could be a flag field.
@@ -301,6 +301,9 @@ struct ParticleParameters : CommonParticleParams
 	ParticleParamTypes::f32Range bounce;
 	ParticleParamTypes::v3fRange jitter;
 
+	// pos, vel, acc, expirationtime and size come first when serialized
+	static constexpr size_t SERIALIZED_SPAWN_SIZE = 3 * 3 * 4 + 2 * 4;
+
 	void serialize(std::ostream &os, u16 protocol_ver) const;
 	void deSerialize(std::istream &is, u16 protocol_ver);
 };
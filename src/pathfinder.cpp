@@ -9,6 +9,7 @@
 
 #include "pathfinder.h"
 #include "map.h"
+#include "navigation_cache.h"
 #include "nodedef.h"
 #include "irrlicht_changes/printing.h"
 
@@ -167,7 +168,8 @@ class Pathfinder {
 
 public:
 	Pathfinder() = delete;
-	Pathfinder(Map *map, const NodeDefManager *ndef) : m_map(map), m_ndef(ndef) {}
+	Pathfinder(Map *map, const NodeDefManager *ndef, NavigationCache *navcache) :
+		m_map(map), m_ndef(ndef), m_navcache(navcache) {}
 
 	/**
 	 * path evaluation function
@@ -310,6 +312,8 @@ class Pathfinder {
 	Map *m_map = nullptr;
 
 	const NodeDefManager *m_ndef = nullptr;
+	/** block-level graph for long paths, optional */
+	NavigationCache *m_navcache = nullptr;
 
 	friend class PathfinderCompareHeuristic;
 
@@ -397,9 +401,10 @@ std::vector<v3s16> get_path(Map* map, const NodeDefManager *ndef,
 		unsigned int searchdistance,
 		unsigned int max_jump,
 		unsigned int max_drop,
-		PathAlgorithm algo)
+		PathAlgorithm algo,
+		NavigationCache *navcache)
 {
-	return Pathfinder(map, ndef).getPath(source, destination,
+	return Pathfinder(map, ndef, navcache).getPath(source, destination,
 				searchdistance, max_jump, max_drop, algo);
 }
 
@@ -697,6 +702,24 @@ std::vector<v3s16> Pathfinder::getPath(v3s16 source,
 		return retval;
 	}
 
+	//long paths are searched on the block-level graph, if available
+	if (m_navcache && algo != PA_DIJKSTRA) {
+		std::vector<v3s16> path;
+		NavigationCache::Result result = m_navcache->findPath(source,
+				destination, m_limits, m_maxjump, m_maxdrop, path);
+		if (result == NavigationCache::RESULT_NO_PATH) {
+			VERBOSE_TARGET << "No path found on the navigation graph" << std::endl;
+			return retval;
+		}
+		if (result == NavigationCache::RESULT_FOUND) {
+			if (source != true_source)
+				path.insert(path.begin(), true_source);
+			if (destination != true_destination)
+				path.push_back(true_destination);
+			return path;
+		}
+	}
+
 	endpos.target      = true;
 	startpos.source    = true;
 	startpos.totalcost = 0;
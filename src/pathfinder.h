@@ -16,6 +16,7 @@
 
 class NodeDefManager;
 class Map;
+class NavigationCache;
 
 /******************************************************************************/
 /* Typedefs and macros                                                        */
@@ -46,4 +47,5 @@ std::vector<v3s16> get_path(Map *map, const NodeDefManager *ndef,
 		unsigned int searchdistance,
 		unsigned int max_jump,
 		unsigned int max_drop,
-		PathAlgorithm algo);
+		PathAlgorithm algo,
+		NavigationCache *navcache = nullptr);
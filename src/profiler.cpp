@@ -3,8 +3,115 @@
 // Copyright (C) 2015 celeron55, Perttu Ahola <celeron55@gmail.com>
 
 #include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
 #include "porting.h"
 
+/*
+	Names of all keys, shared by all profilers
+*/
+
+namespace {
+
+struct KeyRegistry {
+	struct Key {
+		std::string name;
+		ScopeProfilerType type;
+	};
+
+	std::mutex mutex;
+	// never shrinks, so the names can be read while keys are added
+	std::deque<Key> keys;
+	std::unordered_map<std::string, u32> ids;
+};
+
+KeyRegistry &get_key_registry()
+{
+	static KeyRegistry registry;
+	return registry;
+}
+
+}
+
+static u32 register_key(const std::string &name, ScopeProfilerType type)
+{
+	KeyRegistry &registry = get_key_registry();
+	MutexAutoLock lock(registry.mutex);
+	auto it = registry.ids.find(name);
+	if (it != registry.ids.end()) {
+		assert(registry.keys[it->second].type == type);
+		return it->second;
+	}
+	const u32 id = registry.keys.size();
+	registry.keys.push_back({name, type});
+	registry.ids.emplace(name, id);
+	return id;
+}
+
+ProfilerKey::ProfilerKey(const std::string &name, ScopeProfilerType type) :
+	m_id(register_key(name, type)), m_type(type)
+{
+}
+
+ProfilerKey::ProfilerKey(const std::string &name, ScopeProfilerType type,
+		TimePrecision precision) :
+	m_id(register_key(name + " [" + TimePrecision_units[precision] + "]", type)),
+	m_type(type), m_precision(precision)
+{
+}
+
+/*
+	Values recorded by one thread with keys
+*/
+
+class Profiler::ThreadBuffer
+{
+public:
+	struct Slot {
+		std::atomic<float> value{0.0f};
+		std::atomic<u32> count{0};
+	};
+
+	static constexpr u32 CHUNK_SIZE = 256;
+	static constexpr u32 MAX_CHUNKS = 256;
+
+	~ThreadBuffer()
+	{
+		for (auto &chunk : m_chunks)
+			delete[] chunk.load(std::memory_order_relaxed);
+	}
+
+	// Only called by the owning thread
+	Slot *getSlot(u32 id)
+	{
+		if (id >= CHUNK_SIZE * MAX_CHUNKS)
+			return nullptr;
+		auto &chunk = m_chunks[id / CHUNK_SIZE];
+		Slot *slots = chunk.load(std::memory_order_relaxed);
+		if (!slots) {
+			slots = new Slot[CHUNK_SIZE];
+			chunk.store(slots, std::memory_order_release);
+		}
+		return &slots[id % CHUNK_SIZE];
+	}
+
+	// Called by any thread, nullptr if nothing was recorded there yet
+	Slot *findSlot(u32 id)
+	{
+		Slot *slots = m_chunks[id / CHUNK_SIZE].load(std::memory_order_acquire);
+		return slots ? &slots[id % CHUNK_SIZE] : nullptr;
+	}
+
+	// cleared when the owning thread exits
+	std::atomic<bool> alive{true};
+
+private:
+	std::array<std::atomic<Slot *>, MAX_CHUNKS> m_chunks{};
+};
+
 static Profiler main_profiler;
 Profiler *g_profiler = &main_profiler;
 
@@ -17,6 +124,13 @@ ScopeProfiler::ScopeProfiler(Profiler *profiler, const std::string &name,
 	m_time1 = porting::getTime(prec);
 }
 
+ScopeProfiler::ScopeProfiler(Profiler *profiler, const ProfilerKey &key) :
+	m_profiler(profiler), m_key(&key),
+	m_type(key.getType()), m_precision(key.getPrecision())
+{
+	m_time1 = porting::getTime(m_precision);
+}
+
 void ScopeProfiler::stop() noexcept
 {
 	if (!m_profiler)
@@ -24,6 +138,12 @@ void ScopeProfiler::stop() noexcept
 
 	float duration = porting::getTime(m_precision) - m_time1;
 
+	if (m_key) {
+		m_profiler->record(*m_key, duration);
+		m_profiler = nullptr;
+		return;
+	}
+
 	switch (m_type) {
 	case SPT_ADD:
 		m_profiler->add(m_name, duration);
@@ -42,56 +162,174 @@ void ScopeProfiler::stop() noexcept
 	m_profiler = nullptr; // don't stop a second time
 }
 
-Profiler::Profiler()
+static std::atomic<u64> next_profiler_id{0};
+
+Profiler::Profiler() :
+	m_id(next_profiler_id.fetch_add(1, std::memory_order_relaxed))
 {
 	m_start_time = porting::getTimeMs();
 }
 
-void Profiler::add(const std::string &name, float value)
+Profiler::~Profiler() = default;
+
+void Profiler::addLocked(const std::string &name, float value,
+		ScopeProfilerType type, u32 count)
 {
-	MutexAutoLock lock(m_mutex);
+	if (type == SPT_GRAPH_ADD) {
+		m_graphvalues[name] += value;
+		return;
+	}
 
 	auto it = m_data.find(name);
 	if (it == m_data.end()) {
-		// mark with special value for checking
-		m_data.emplace(name, DataPair{value, -SPT_ADD});
-	} else {
-		assert(it->second.avgcount == -SPT_ADD);
-		it->second.value += value;
+		// mark add and max with special values for checking
+		m_data.emplace(name, DataPair{value,
+			type == SPT_AVG ? (int)count : -(int)type});
+		return;
+	}
+
+	DataPair &data = it->second;
+	switch (type) {
+	case SPT_ADD:
+		assert(data.avgcount == -SPT_ADD);
+		data.value += value;
+		break;
+	case SPT_AVG:
+		assert(data.avgcount >= 0);
+		data.value += value;
+		data.avgcount += count;
+		break;
+	case SPT_MAX:
+		assert(data.avgcount == -SPT_MAX);
+		data.value = std::max(value, data.value);
+		break;
+	default:
+		break;
 	}
 }
 
+void Profiler::add(const std::string &name, float value)
+{
+	MutexAutoLock lock(m_mutex);
+	addLocked(name, value, SPT_ADD);
+}
+
 void Profiler::max(const std::string &name, float value)
 {
 	MutexAutoLock lock(m_mutex);
+	addLocked(name, value, SPT_MAX);
+}
 
-	auto it = m_data.find(name);
-	if (it == m_data.end()) {
-		// mark with special value for checking
-		m_data.emplace(name, DataPair{value, -SPT_MAX});
+void Profiler::avg(const std::string &name, float value)
+{
+	MutexAutoLock lock(m_mutex);
+	addLocked(name, value, SPT_AVG);
+}
+
+Profiler::ThreadBuffer &Profiler::getThreadBuffer()
+{
+	struct Entry {
+		u64 profiler_id;
+		std::shared_ptr<ThreadBuffer> buffer;
+	};
+	struct Entries {
+		std::vector<Entry> list;
+
+		~Entries()
+		{
+			for (Entry &entry : list)
+				entry.buffer->alive.store(false, std::memory_order_release);
+		}
+	};
+	thread_local Entries entries;
+
+	for (Entry &entry : entries.list) {
+		if (entry.profiler_id == m_id)
+			return *entry.buffer;
+	}
+
+	// Drop the buffers of profilers that are gone
+	for (auto it = entries.list.begin(); it != entries.list.end();) {
+		if (it->buffer.use_count() == 1)
+			it = entries.list.erase(it);
+		else
+			++it;
+	}
+
+	auto buffer = std::make_shared<ThreadBuffer>();
+	{
+		MutexAutoLock lock(m_mutex);
+		m_buffers.push_back(buffer);
+	}
+	entries.list.push_back({m_id, buffer});
+	return *buffer;
+}
+
+void Profiler::record(const ProfilerKey &key, float value)
+{
+	ThreadBuffer::Slot *slot = getThreadBuffer().getSlot(key.getId());
+	if (!slot)
+		return;
+
+	// Only the merging thread competes for the slot, by taking its values
+	float old = slot->value.load(std::memory_order_relaxed);
+	if (key.getType() == SPT_MAX) {
+		while (value > old && !slot->value.compare_exchange_weak(old, value,
+				std::memory_order_relaxed)) {}
 	} else {
-		assert(it->second.avgcount == -SPT_MAX);
-		it->second.value = std::max(value, it->second.value);
+		while (!slot->value.compare_exchange_weak(old, old + value,
+				std::memory_order_relaxed)) {}
 	}
+	slot->count.fetch_add(1, std::memory_order_relaxed);
 }
 
-void Profiler::avg(const std::string &name, float value)
+void Profiler::merge()
 {
 	MutexAutoLock lock(m_mutex);
+	mergeLocked();
+}
 
-	auto it = m_data.find(name);
-	if (it == m_data.end()) {
-		m_data.emplace(name, DataPair{value, 1});
-	} else {
-		assert(it->second.avgcount >= 0);
-		it->second.value += value;
-		it->second.avgcount++;
+void Profiler::mergeLocked()
+{
+	if (m_buffers.empty())
+		return;
+
+	KeyRegistry &registry = get_key_registry();
+	MutexAutoLock lock(registry.mutex);
+	const u32 key_count = std::min<u32>(registry.keys.size(),
+		ThreadBuffer::CHUNK_SIZE * ThreadBuffer::MAX_CHUNKS);
+
+	for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+		ThreadBuffer &buffer = **it;
+		// checked first, so nothing recorded before the thread exited is lost
+		const bool alive = buffer.alive.load(std::memory_order_acquire);
+		for (u32 id = 0; id < key_count; id++) {
+			ThreadBuffer::Slot *slot = buffer.findSlot(id);
+			if (!slot) {
+				// skip the rest of the chunk
+				id |= ThreadBuffer::CHUNK_SIZE - 1;
+				continue;
+			}
+			const u32 count = slot->count.exchange(0, std::memory_order_relaxed);
+			if (count == 0)
+				continue;
+			const float value = slot->value.exchange(0.0f, std::memory_order_relaxed);
+			const KeyRegistry::Key &key = registry.keys[id];
+			addLocked(key.name, value, key.type, count);
+		}
+
+		if (alive)
+			++it;
+		else
+			it = m_buffers.erase(it);
 	}
 }
 
 void Profiler::clear()
 {
 	MutexAutoLock lock(m_mutex);
+	// recorded before, so it's dropped
+	mergeLocked();
 	for (auto &it : m_data)
 		it.second.reset();
 	m_start_time = porting::getTimeMs();
@@ -150,6 +388,7 @@ int Profiler::print(std::ostream &o, u32 page, u32 pagecount)
 void Profiler::getPage(GraphValues &o, u32 page, u32 pagecount)
 {
 	MutexAutoLock lock(m_mutex);
+	mergeLocked();
 
 	u32 minindex, maxindex;
 	paging(m_data.size(), page, pagecount, minindex, maxindex);
@@ -8,7 +8,9 @@
 #include <cassert>
 #include <string>
 #include <map>
+#include <memory>
 #include <ostream>
+#include <vector>
 
 #include "threading/mutex_auto_lock.h"
 #include "util/timetaker.h"
@@ -20,6 +22,39 @@
 class Profiler;
 extern Profiler *g_profiler;
 
+enum ScopeProfilerType : u8
+{
+	SPT_ADD = 1,
+	SPT_AVG,
+	SPT_GRAPH_ADD,
+	SPT_MAX
+};
+
+/*
+	Name and type of a profiler value, interned once.
+
+	Values recorded with a key don't take a lock or look up the name: they
+	are accumulated in a buffer of the recording thread and merged into the
+	profiler whenever it is read. Keep keys in static variables.
+*/
+class ProfilerKey
+{
+public:
+	ProfilerKey(const std::string &name, ScopeProfilerType type = SPT_ADD);
+	// For ScopeProfiler, appends the unit of the precision to the name like it
+	ProfilerKey(const std::string &name, ScopeProfilerType type,
+			TimePrecision precision);
+
+	u32 getId() const { return m_id; }
+	ScopeProfilerType getType() const { return m_type; }
+	TimePrecision getPrecision() const { return m_precision; }
+
+private:
+	u32 m_id;
+	ScopeProfilerType m_type;
+	TimePrecision m_precision = PRECISION_MILLI;
+};
+
 /*
 	Time profiler
 */
@@ -28,10 +63,18 @@ class Profiler
 {
 public:
 	Profiler();
+	~Profiler();
+
+	DISABLE_CLASS_COPY(Profiler)
 
 	void add(const std::string &name, float value);
 	void avg(const std::string &name, float value);
 	void max(const std::string &name, float value);
+	// Does what the method matching the type of the key does, without locking
+	void record(const ProfilerKey &key, float value);
+	// Takes the values recorded with keys by all threads.
+	// Done by clear(), getPage(), print() and graphPop().
+	void merge();
 	void clear();
 
 	float getValue(const std::string &name) const;
@@ -62,6 +105,7 @@ class Profiler
 	void graphPop(GraphValues &result)
 	{
 		MutexAutoLock lock(m_mutex);
+		mergeLocked();
 		assert(result.empty());
 		std::swap(result, m_graphvalues);
 	}
@@ -88,20 +132,24 @@ class Profiler
 		}
 	};
 
+	class ThreadBuffer;
+
+	ThreadBuffer &getThreadBuffer();
+	// These need m_mutex
+	void mergeLocked();
+	void addLocked(const std::string &name, float value, ScopeProfilerType type,
+			u32 count = 1);
+
+	// tells apart the buffers of profilers at the same address
+	const u64 m_id;
 	std::mutex m_mutex;
 	std::map<std::string, DataPair> m_data;
 	std::map<std::string, float> m_graphvalues;
+	// of every thread that recorded something with a key
+	std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
 	u64 m_start_time;
 };
 
-enum ScopeProfilerType : u8
-{
-	SPT_ADD = 1,
-	SPT_AVG,
-	SPT_GRAPH_ADD,
-	SPT_MAX
-};
-
 // Note: this class should be kept lightweight.
 
 class ScopeProfiler
@@ -110,6 +158,8 @@ class ScopeProfiler
 	ScopeProfiler(Profiler *profiler, const std::string &name,
 			ScopeProfilerType type = SPT_ADD,
 			TimePrecision precision = PRECISION_MILLI);
+	// Cheaper, see ProfilerKey. The key must outlive the ScopeProfiler.
+	ScopeProfiler(Profiler *profiler, const ProfilerKey &key);
 	inline ~ScopeProfiler() { stop(); }
 
 	// End profiled scope early
@@ -119,6 +169,7 @@ class ScopeProfiler
 
 private:
 	Profiler *m_profiler = nullptr;
+	const ProfilerKey *m_key = nullptr;
 	std::string m_name;
 	u64 m_time1;
 	ScopeProfilerType m_type;
@@ -30,6 +30,8 @@ void ReflowScan::scan(MapBlock *block, UniqueQueue<v3s16> *liquid_queue)
 	int block_idx = 1 + (1 * 9) + (1 * 3);
 	m_lookup[block_idx] = block;
 	m_lookup_state_bitset = 1 << block_idx;
+	m_liquid_checked_bitset = 0;
+	m_has_liquid_bitset = 0;
 
 	// Scan the columns in the block
 	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
@@ -67,6 +69,31 @@ inline MapBlock *ReflowScan::lookupBlock(int x, int y, int z)
 	return result;
 }
 
+bool ReflowScan::hasLiquid(int x, int y, int z)
+{
+	// Tells whether the block containing (x,y,z) has any liquid nodes.
+	// Uses the same indices as lookupBlock().
+	int bx = (MAP_BLOCKSIZE + x) / MAP_BLOCKSIZE;
+	int by = (MAP_BLOCKSIZE + y) / MAP_BLOCKSIZE;
+	int bz = (MAP_BLOCKSIZE + z) / MAP_BLOCKSIZE;
+	int idx = (bx + (by * 9) + (bz * 3));
+	if ((m_liquid_checked_bitset & (1 << idx)) == 0) {
+		m_liquid_checked_bitset |= 1 << idx;
+		MapBlock *block = lookupBlock(x, y, z);
+		if (block && !block->isAir()) {
+			m_contents.clear();
+			block->getContents(m_contents);
+			for (content_t c : m_contents) {
+				if (m_ndef->get(c).isLiquid()) {
+					m_has_liquid_bitset |= 1 << idx;
+					break;
+				}
+			}
+		}
+	}
+	return (m_has_liquid_bitset & (1 << idx)) != 0;
+}
+
 inline bool ReflowScan::isLiquidFlowableTo(int x, int y, int z)
 {
 	// Tests whether (x,y,z) is a node to which liquid might flow.
@@ -104,6 +131,12 @@ void ReflowScan::scanColumn(int x, int z)
 	if (!block)
 		return;
 
+	// Only liquid in the column, or right above or below it, ends up in the
+	// queue. Most blocks and their neighbors contain none at all.
+	if (!hasLiquid(x, 0, z) && !hasLiquid(x, MAP_BLOCKSIZE, z) &&
+			!hasLiquid(x, -1, z))
+		return;
+
 	MapBlock *above = lookupBlock(x, MAP_BLOCKSIZE, z);
 	int dx = (MAP_BLOCKSIZE + x) % MAP_BLOCKSIZE;
 	int dz = (MAP_BLOCKSIZE + z) % MAP_BLOCKSIZE;
@@ -4,9 +4,11 @@
 
 #pragma once
 
+#include <vector>
 #include "util/container.h"
 #include "irrlichttypes.h"
 #include "irr_v3d.h"
+#include "mapnode.h"
 
 class NodeDefManager;
 class Map;
@@ -19,6 +21,7 @@ class ReflowScan {
 
 private:
 	MapBlock *lookupBlock(int x, int y, int z);
+	bool hasLiquid(int x, int y, int z);
 	bool isLiquidFlowableTo(int x, int y, int z);
 	bool isLiquidHorizontallyFlowable(int x, int y, int z);
 	void scanColumn(int x, int z);
@@ -30,4 +33,8 @@ class ReflowScan {
 	UniqueQueue<v3s16> *m_liquid_queue = nullptr;
 	MapBlock *m_lookup[3 * 3 * 3];
 	u32 m_lookup_state_bitset;
+	// same indices as m_lookup
+	u32 m_liquid_checked_bitset;
+	u32 m_has_liquid_bitset;
+	std::vector<content_t> m_contents;
 };
@@ -99,6 +99,16 @@ RemotePlayerChatResult RemotePlayer::canSendChatMessage()
 	return RPLAYER_CHATRESULT_OK;
 }
 
+u8 RemotePlayer::getUnsavedParts() const
+{
+	u8 parts = m_unsaved_parts;
+	if (inventory.checkModified())
+		parts |= UNSAVED_INVENTORY;
+	if (m_sao && m_sao->getMeta().isModified())
+		parts |= UNSAVED_META;
+	return parts;
+}
+
 void RemotePlayer::onSuccessfulSave()
 {
 	setModified(false);
@@ -94,9 +94,26 @@ class RemotePlayer : public Player
 
 	const CloudParams &getCloudParams() const { return m_cloud_params; }
 
-	bool checkModified() const { return m_dirty || inventory.checkModified(); }
+	// Parts of the player that are written to the database only if they changed
+	enum UnsavedPart : u8 {
+		UNSAVED_INVENTORY = 1 << 0,
+		UNSAVED_META = 1 << 1,
+		UNSAVED_ALL = UNSAVED_INVENTORY | UNSAVED_META,
+	};
 
-	inline void setModified(const bool x) { m_dirty = x; }
+	bool checkModified() const { return m_dirty || getUnsavedParts() != 0; }
+
+	// true marks everything for saving
+	inline void setModified(const bool x)
+	{
+		m_dirty = x;
+		m_unsaved_parts = x ? UNSAVED_ALL : 0;
+	}
+
+	// UnsavedPart flags
+	u8 getUnsavedParts() const;
+
+	void setInventoryDirty() { m_unsaved_parts |= UNSAVED_INVENTORY; }
 
 	void setLocalAnimations(v2f frames[4], float frame_speed)
 	{
@@ -133,6 +150,7 @@ class RemotePlayer : public Player
 private:
 	PlayerSAO *m_sao = nullptr;
 	bool m_dirty = false;
+	u8 m_unsaved_parts = 0;
 
 	static bool m_setting_cache_loaded;
 	static float m_setting_chat_message_limit_per_10sec;
@@ -22,6 +22,7 @@
 #include "debug.h" // For FATAL_ERROR
 #include <SColor.h>
 #include <json/json.h>
+#include <type_traits>
 #include "mapgen/treegen.h"
 
 struct EnumString es_TileAnimationType[] =
@@ -267,7 +268,7 @@ void push_item_definition_full(lua_State *L, const ItemDefinition &i)
 }
 
 /******************************************************************************/
-const std::array<const char *, 33> object_property_keys = {
+const std::array<const char *, 34> object_property_keys = {
 	"hp_max",
 	"breath_max",
 	"physical",
@@ -301,6 +302,7 @@ const std::array<const char *, 33> object_property_keys = {
 	"shaded",
 	"damage_texture_modifier",
 	"show_on_minimap",
+	"sleep_interval",
 	// "node" is intentionally not here as it's gated behind `fallback` below!
 };
 
@@ -479,6 +481,7 @@ void read_object_properties(lua_State *L, int index,
 
 	getstringfield(L, -1, "infotext", prop->infotext);
 	getboolfield(L, -1, "static_save", prop->static_save);
+	getfloatfield(L, -1, "sleep_interval", prop->sleep_interval);
 
 	lua_getfield(L, -1, "wield_item");
 	if (!lua_isnil(L, -1))
@@ -581,6 +584,8 @@ void push_object_properties(lua_State *L, const ObjectProperties *prop)
 	lua_setfield(L, -2, "infotext");
 	lua_pushboolean(L, prop->static_save);
 	lua_setfield(L, -2, "static_save");
+	lua_pushnumber(L, prop->sleep_interval);
+	lua_setfield(L, -2, "sleep_interval");
 	lua_pushlstring(L, prop->wield_item.c_str(), prop->wield_item.size());
 	lua_setfield(L, -2, "wield_item");
 	lua_pushnumber(L, prop->zoom_fov);
@@ -1419,7 +1424,8 @@ ItemStack read_item(lua_State* L, int index, IItemDefManager *idef)
 
 		// BACKWARDS COMPATIBLITY
 		std::string value = getstringfield_default(L, index, "metadata", "");
-		istack.metadata.setString("", value);
+		if (!value.empty())
+			istack.getWritableMetadata().setString("", value);
 
 		// Get meta
 		lua_getfield(L, index, "meta");
@@ -1432,7 +1438,7 @@ ItemStack read_item(lua_State* L, int index, IItemDefManager *idef)
 				size_t value_len;
 				const char *value_cs = lua_tolstring(L, -1, &value_len);
 				std::string value(value_cs, value_len);
-				istack.metadata.setString(key, value);
+				istack.getWritableMetadata().setString(key, value);
 				lua_pop(L, 1); // removes value, keeps key for next iteration
 			}
 		}
@@ -2404,7 +2410,8 @@ void push_hud_element(lua_State *L, HudElement *elem)
 	lua_setfield(L, -2, "style");
 }
 
-bool read_hud_change(lua_State *L, HudElementStat &stat, HudElement *elem, void **value)
+bool read_hud_change(lua_State *L, HudElementStat &stat, HudElement *elem, void **value,
+	bool *changed)
 {
 	std::string statstr = lua_tostring(L, 3);
 	if (!string_to_enum(es_HudElementStat, stat, statstr)) {
@@ -2412,70 +2419,68 @@ bool read_hud_change(lua_State *L, HudElementStat &stat, HudElement *elem, void
 		return false;
 	}
 
+	bool differs = false;
+	const auto set = [&] (auto &field, auto new_value) {
+		std::remove_reference_t<decltype(field)> converted = new_value;
+		differs = !(field == converted);
+		field = std::move(converted);
+		*value = &field;
+	};
+
 	switch (stat) {
 		case HUD_STAT_POS:
-			elem->pos = read_v2f(L, 4);
-			*value = &elem->pos;
+			set(elem->pos, read_v2f(L, 4));
 			break;
 		case HUD_STAT_NAME:
-			elem->name = luaL_checkstring(L, 4);
-			*value = &elem->name;
+			set(elem->name, luaL_checkstring(L, 4));
 			break;
 		case HUD_STAT_SCALE:
-			elem->scale = read_v2f(L, 4);
-			*value = &elem->scale;
+			set(elem->scale, read_v2f(L, 4));
 			break;
 		case HUD_STAT_TEXT:
-			elem->text = luaL_checkstring(L, 4);
-			*value = &elem->text;
+			set(elem->text, luaL_checkstring(L, 4));
 			break;
 		case HUD_STAT_NUMBER:
-			elem->number = luaL_checknumber(L, 4);
-			*value = &elem->number;
+			set(elem->number, luaL_checknumber(L, 4));
 			break;
-		case HUD_STAT_ITEM:
-			elem->item = luaL_checknumber(L, 4);
+		case HUD_STAT_ITEM: {
+			u32 item = luaL_checknumber(L, 4);
 			if (elem->type == HUD_ELEM_WAYPOINT && statstr == "precision")
-				elem->item++;
-			*value = &elem->item;
+				item++;
+			set(elem->item, item);
 			break;
+		}
 		case HUD_STAT_DIR:
-			elem->dir = luaL_checknumber(L, 4);
-			*value = &elem->dir;
+			set(elem->dir, luaL_checknumber(L, 4));
 			break;
 		case HUD_STAT_ALIGN:
-			elem->align = read_v2f(L, 4);
-			*value = &elem->align;
+			set(elem->align, read_v2f(L, 4));
 			break;
 		case HUD_STAT_OFFSET:
-			elem->offset = read_v2f(L, 4);
-			*value = &elem->offset;
+			set(elem->offset, read_v2f(L, 4));
 			break;
 		case HUD_STAT_WORLD_POS:
-			elem->world_pos = read_v3f(L, 4);
-			*value = &elem->world_pos;
+			set(elem->world_pos, read_v3f(L, 4));
 			break;
 		case HUD_STAT_SIZE:
-			elem->size = read_v2s32(L, 4);
-			*value = &elem->size;
+			set(elem->size, read_v2s32(L, 4));
 			break;
 		case HUD_STAT_Z_INDEX:
-			elem->z_index = MYMAX(S16_MIN, MYMIN(S16_MAX, luaL_checknumber(L, 4)));
-			*value = &elem->z_index;
+			set(elem->z_index, MYMAX(S16_MIN, MYMIN(S16_MAX, luaL_checknumber(L, 4))));
 			break;
 		case HUD_STAT_TEXT2:
-			elem->text2 = luaL_checkstring(L, 4);
-			*value = &elem->text2;
+			set(elem->text2, luaL_checkstring(L, 4));
 			break;
 		case HUD_STAT_STYLE:
-			elem->style = luaL_checknumber(L, 4);
-			*value = &elem->style;
+			set(elem->style, luaL_checknumber(L, 4));
 			break;
 		case HudElementStat_END:
 			return false;
 			break;
 	}
 
+	if (changed)
+		*changed = differs;
 	return true;
 }
 
@@ -61,7 +61,7 @@ extern struct EnumString es_ItemType[];
 extern struct EnumString es_TouchInteractionMode[];
 
 
-extern const std::array<const char *, 33> object_property_keys;
+extern const std::array<const char *, 34> object_property_keys;
 
 void read_content_features(lua_State *L, ContentFeatures &f, int index);
 void push_content_features(lua_State *L, const ContentFeatures &c);
@@ -167,7 +167,9 @@ void read_hud_element(lua_State *L, HudElement *elem);
 
 void push_hud_element(lua_State *L, HudElement *elem);
 
-bool read_hud_change(lua_State *L, HudElementStat &stat, HudElement *elem, void **value);
+// changed is set to whether the value differs from the previous one
+bool read_hud_change(lua_State *L, HudElementStat &stat, HudElement *elem, void **value,
+	bool *changed = nullptr);
 
 void push_collision_move_result(lua_State *L, const collisionMoveResult &res);
 
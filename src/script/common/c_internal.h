@@ -46,6 +46,8 @@ enum {
 	CUSTOM_RIDX_ERROR_HANDLER,
 	CUSTOM_RIDX_HTTP_API_LUA,
 	CUSTOM_RIDX_METATABLE_MAP,
+	// { [content ID] = node definition table }, see ScriptApiItem::getNodeCallback
+	CUSTOM_RIDX_NODE_DEF_CACHE,
 
 	// The following functions are implemented in Lua because LuaJIT can
 	// trace them and optimize tables/string better than from the C API.
@@ -30,7 +30,7 @@ static inline int absidx(lua_State *L, int idx)
 	return lua_gettop(L) + idx + 1;
 }
 
-// does the type put anything into PackedInstr::sdata?
+// does the type put anything into the string data of PackedInstr?
 static inline bool uses_sdata(int type)
 {
 	switch (type) {
@@ -148,6 +148,14 @@ namespace {
 		PackOutFunc fout;
 	};
 
+	struct PackState {
+		// seen objects (see record_object) -> instruction index
+		std::unordered_map<const void *, s32> seen;
+		// Lua string data -> offset in PackedValue::strings
+		// Since Lua interns strings identical strings have the same pointer.
+		std::unordered_map<const char *, u32> interned;
+	};
+
 	typedef std::pair<std::string, Packer> PackerTuple;
 }
 
@@ -175,6 +183,36 @@ static inline auto emplace(PackedValue &pv, s16 type)
 	return ref;
 }
 
+/**
+ * Store the string data of an instruction.
+ *
+ * @param pv target
+ * @param r instruction
+ * @param str string
+ * @param len length of string
+ * @param interned if not null, `str` must belong to a Lua string that stays
+ *        alive during packing and is only stored once
+*/
+static void set_sdata(PackedValue &pv, PackedInstr &r, const char *str,
+		size_t len, std::unordered_map<const char *, u32> *interned = nullptr)
+{
+	if (interned) {
+		auto [it, first_time] = interned->try_emplace(str, pv.strings.size());
+		if (!first_time) {
+			r.soffset = it->second;
+			r.slength = len;
+			return;
+		}
+	}
+
+	if (len >= U32_MAX || pv.strings.size() >= U32_MAX - len - 1)
+		throw LuaError("Packed value is too large");
+	r.soffset = pv.strings.size();
+	r.slength = len;
+	pv.strings.append(str, len);
+	pv.strings.push_back('\0');
+}
+
 //
 // Management of registered packers
 //
@@ -304,11 +342,10 @@ static VectorRef<PackedInstr> record_object(lua_State *L, int idx, PackedValue &
 {
 	const void *ptr = lua_topointer(L, idx);
 	assert(ptr);
-	auto found = seen.find(ptr);
-	if (found == seen.end()) {
-		// first time, record index
-		assert(pv.i.size() <= S32_MAX);
-		seen[ptr] = pv.i.size();
+	assert(pv.i.size() <= S32_MAX);
+	auto [found, first_time] = seen.try_emplace(ptr, pv.i.size());
+	if (first_time) {
+		// the index is recorded now
 		return VectorRef<PackedInstr>();
 	}
 
@@ -328,11 +365,11 @@ static VectorRef<PackedInstr> record_object(lua_State *L, int idx, PackedValue &
  * @param idx Index of value on Lua stack. Must be positive, use absidx if not!
  * @param vidx Next free index on the stack as it would look during unpacking. (v = virtual)
  * @param pv target
- * @param seen Map of seen objects (see record_object)
+ * @param st Packing state
  * @return reference to the instruction that creates the value
 */
 static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, PackedValue &pv,
-		std::unordered_map<const void *, s32> &seen)
+		PackState &st)
 {
 #ifndef NDEBUG
 	StackChecker checker(L);
@@ -359,17 +396,17 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 			size_t len;
 			const char *str = lua_tolstring(L, idx, &len);
 			assert(str);
-			r->sdata.assign(str, len);
+			set_sdata(pv, *r, str, len, &st.interned);
 			return r;
 		}
 		case LUA_TTABLE: {
-			auto r = record_object(L, idx, pv, seen);
+			auto r = record_object(L, idx, pv, st.seen);
 			if (r)
 				return r;
 			break; // execution continues
 		}
 		case LUA_TFUNCTION: {
-			auto r = record_object(L, idx, pv, seen);
+			auto r = record_object(L, idx, pv, st.seen);
 			if (r)
 				return r;
 			r = emplace(pv, LUA_TFUNCTION);
@@ -377,12 +414,13 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 			size_t len;
 			const char *str = lua_tolstring(L, -1, &len);
 			assert(str);
-			r->sdata.assign(str, len);
+			// popped right after, so not interned
+			set_sdata(pv, *r, str, len);
 			lua_pop(L, 1);
 			return r;
 		}
 		case LUA_TUSERDATA: {
-			auto r = record_object(L, idx, pv, seen);
+			auto r = record_object(L, idx, pv, st.seen);
 			if (r)
 				return r;
 			PackerTuple ser;
@@ -391,7 +429,7 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 			// use packer callback to turn into a void*
 			pv.contains_userdata = true;
 			r = emplace(pv, LUA_TUSERDATA);
-			r->sdata = ser.first;
+			set_sdata(pv, *r, ser.first.c_str(), ser.first.size());
 			r->ptrdata = ser.second.fin(L, idx);
 			return r;
 		}
@@ -423,14 +461,16 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 		// only works in certain circumstances, hence the check:
 		if (can_set_into(ktype, vtype) && suitable_key(L, -2)) {
 			// push only the value
-			auto rval = pack_inner(L, absidx(L, -1), vidx, pv, seen);
+			auto rval = pack_inner(L, absidx(L, -1), vidx, pv, st);
 			vidx++;
 			rval->pop = rval->type != LUA_TTABLE;
 			// where to put it:
 			rval->set_into = vi_table;
-			if (ktype == LUA_TSTRING)
-				rval->sdata = lua_tostring(L, -2);
-			else
+			if (ktype == LUA_TSTRING) {
+				size_t len;
+				const char *str = lua_tolstring(L, -2, &len);
+				set_sdata(pv, *rval, str, len, &st.interned);
+			} else
 				rval->sidata1 = lua_tointeger(L, -2);
 			// since tables take multiple instructions to populate we have to
 			// pop them separately afterwards.
@@ -441,9 +481,9 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 			vidx--;
 		} else {
 			// push the key and value
-			pack_inner(L, absidx(L, -2), vidx, pv, seen);
+			pack_inner(L, absidx(L, -2), vidx, pv, st);
 			vidx++;
-			pack_inner(L, absidx(L, -1), vidx, pv, seen);
+			pack_inner(L, absidx(L, -1), vidx, pv, st);
 			vidx++;
 			// push an instruction to set them
 			auto ri1 = emplace(pv, INSTR_SETTABLE);
@@ -463,7 +503,8 @@ static VectorRef<PackedInstr> pack_inner(lua_State *L, int idx, int vidx, Packed
 		lua_gettable(L, -2);
 		if (lua_isstring(L, -1)) {
 			auto r = emplace(pv, INSTR_SETMETATABLE);
-			r->sdata = std::string(lua_tostring(L, -1));
+			const char *str = lua_tostring(L, -1);
+			set_sdata(pv, *r, str, strlen(str));
 			r->set_into = vi_table;
 		}
 		lua_pop(L, 2);
@@ -480,8 +521,8 @@ PackedValue *script_pack(lua_State *L, int idx)
 		idx = absidx(L, idx);
 
 	PackedValue pv;
-	std::unordered_map<const void *, s32> seen;
-	pack_inner(L, idx, 1, pv, seen);
+	PackState st;
+	pack_inner(L, idx, 1, pv, st);
 
 	// allocate last for exception safety
 	return new PackedValue(std::move(pv));
@@ -536,7 +577,7 @@ void script_unpack(lua_State *L, PackedValue *pv)
 				break;
 			case INSTR_SETMETATABLE:
 				if (get_known_lua_metatables(L)) {
-					lua_getfield(L, -1, i.sdata.c_str());
+					lua_getfield(L, -1, pv->sdata(i));
 					lua_remove(L, -2);
 					if (lua_istable(L, -1))
 						lua_setmetatable(L, top + i.set_into);
@@ -556,17 +597,17 @@ void script_unpack(lua_State *L, PackedValue *pv)
 				lua_pushnumber(L, i.ndata);
 				break;
 			case LUA_TSTRING:
-				lua_pushlstring(L, i.sdata.data(), i.sdata.size());
+				lua_pushlstring(L, pv->sdata(i), i.slength);
 				break;
 			case LUA_TTABLE:
 				lua_createtable(L, i.uidata1, i.uidata2);
 				break;
 			case LUA_TFUNCTION:
-				luaL_loadbuffer(L, i.sdata.data(), i.sdata.size(), nullptr);
+				luaL_loadbuffer(L, pv->sdata(i), i.slength, nullptr);
 				break;
 			case LUA_TUSERDATA: {
 				PackerTuple ser;
-				sanity_check(find_packer(i.sdata.c_str(), ser));
+				sanity_check(find_packer(pv->sdata(i), ser));
 				ser.second.fout(L, i.ptrdata);
 				i.ptrdata = nullptr; // ownership taken by packer callback
 				break;
@@ -587,10 +628,15 @@ void script_unpack(lua_State *L, PackedValue *pv)
 		if (i.set_into) {
 			if (!i.pop) // set will consume
 				lua_pushvalue(L, -1);
-			if (uses_sdata(i.type))
+			if (uses_sdata(i.type)) {
 				lua_rawseti(L, top + i.set_into, i.sidata1);
-			else
-				lua_setfield(L, top + i.set_into, i.sdata.c_str());
+			} else {
+				// the table is new and has no metatable yet, so this is
+				// the same as lua_setfield but doesn't need strlen
+				lua_pushlstring(L, pv->sdata(i), i.slength);
+				lua_insert(L, -2);
+				lua_rawset(L, top + i.set_into);
+			}
 		} else {
 			if (i.pop)
 				lua_pop(L, 1);
@@ -598,7 +644,9 @@ void script_unpack(lua_State *L, PackedValue *pv)
 	}
 
 	// as part of the unpacking process all userdata is "used up"
-	pv->contains_userdata = false;
+	// (only written if needed, values without are unpacked concurrently)
+	if (pv->contains_userdata)
+		pv->contains_userdata = false;
 	// leave exactly one value on the stack
 	lua_settop(L, top+1);
 	lua_remove(L, top);
@@ -615,7 +663,7 @@ PackedValue::~PackedValue()
 	for (auto &i : this->i) {
 		if (i.type == LUA_TUSERDATA && i.ptrdata) {
 			PackerTuple ser;
-			if (find_packer(i.sdata.c_str(), ser)) {
+			if (find_packer(sdata(i), ser)) {
 				// tell packer to deallocate object
 				ser.second.fout(nullptr, i.ptrdata);
 			} else {
@@ -645,7 +693,7 @@ void script_dump_packed(const PackedValue *val)
 				printf("PUSHREF(%d)", i.sidata1);
 				break;
 			case INSTR_SETMETATABLE:
-				printf("SETMETATABLE(%s)", i.sdata.c_str());
+				printf("SETMETATABLE(%s)", val->sdata(i));
 				break;
 			case LUA_TNIL:
 				printf("nil");
@@ -657,16 +705,16 @@ void script_dump_packed(const PackedValue *val)
 				printf("%f", i.ndata);
 				break;
 			case LUA_TSTRING:
-				printf("\"%s\"", i.sdata.c_str());
+				printf("\"%s\"", val->sdata(i));
 				break;
 			case LUA_TTABLE:
 				printf("table(%d, %d)", i.uidata1, i.uidata2);
 				break;
 			case LUA_TFUNCTION:
-				printf("function(%d bytes)", (int)i.sdata.size());
+				printf("function(%d bytes)", (int)i.slength);
 				break;
 			case LUA_TUSERDATA:
-				printf("userdata %s %p", i.sdata.c_str(), i.ptrdata);
+				printf("userdata %s %p", val->sdata(i), i.ptrdata);
 				break;
 			default:
 				FATAL_ERROR("unknown type");
@@ -676,7 +724,7 @@ void script_dump_packed(const PackedValue *val)
 			if (i.type >= 0 && uses_sdata(i.type))
 				printf(", k=%d, into=%d", i.sidata1, i.set_into);
 			else if (i.type >= 0)
-				printf(", k=\"%s\", into=%d", i.sdata.c_str(), i.set_into);
+				printf(", k=\"%s\", into=%d", val->sdata(i), i.set_into);
 			else
 				printf(", into=%d", i.set_into);
 		}
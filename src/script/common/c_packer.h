@@ -52,15 +52,17 @@ struct PackedInstr
 		void *ptrdata; // userdata: implementation defined
 	};
 	/*
+		Offset into PackedValue::strings and length of:
 		- string: value
 		- function: buffer
 		- w/ set_into: string key (no null bytes!)
 		- userdata: name in registry
 		- INSTR_SETMETATABLE: name of the metatable
 	*/
-	std::string sdata;
+	u32 soffset, slength;
 
-	PackedInstr() : type(0), set_into(0), keep_ref(false), pop(false) {}
+	PackedInstr() : type(0), set_into(0), keep_ref(false), pop(false),
+		soffset(0), slength(0) {}
 };
 
 /**
@@ -71,9 +73,18 @@ struct PackedInstr
 struct PackedValue
 {
 	std::vector<PackedInstr> i;
+	// The string data of all instructions, each string is followed by a null
+	// byte. Strings that occur repeatedly (like table keys) are stored once.
+	std::string strings;
 	// Indicates whether there are any userdata pointers that need to be deallocated
 	bool contains_userdata = false;
 
+	// Null-terminated string data of an instruction
+	const char *sdata(const PackedInstr &instr) const
+	{
+		return strings.data() + instr.soffset;
+	}
+
 	PackedValue() = default;
 	~PackedValue();
 
@@ -108,6 +119,7 @@ void script_register_packer(lua_State *L, const char *regname,
 PackedValue *script_pack(lua_State *L, int idx);
 // Unpack a Lua value (left on top of stack)
 // Note that this may modify the PackedValue, reusability is not guaranteed!
+// Values without userdata are left alone and may be unpacked concurrently.
 void script_unpack(lua_State *L, PackedValue *val);
 
 // Dump contents of PackedValue to stdout for debugging
@@ -95,6 +95,15 @@ void AsyncEngine::addWorkerThread()
 	toAdd->start();
 }
 
+/******************************************************************************/
+size_t AsyncEngine::getMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (const AsyncWorkerThread *workerThread : workerThreads)
+		bytes += workerThread->memoryUsage.load(std::memory_order_relaxed);
+	return bytes;
+}
+
 /******************************************************************************/
 u32 AsyncEngine::queueAsyncJob(std::string &&func, std::string &&params,
 		const std::string &mod_origin)
@@ -315,6 +324,7 @@ AsyncWorkerThread::AsyncWorkerThread(AsyncEngine* jobDispatcher,
 		isErrored = true;
 	}
 	lua_pop(L, 1);
+	memoryUsage.store(getMemoryUsage(), std::memory_order_relaxed);
 }
 
 AsyncWorkerThread::~AsyncWorkerThread()
@@ -409,6 +419,8 @@ void* AsyncWorkerThread::run()
 
 		lua_pop(L, 1);  // Pop retval
 
+		memoryUsage.store(getMemoryUsage(), std::memory_order_relaxed);
+
 		// Put job result
 		if (result == 0)
 			jobDispatcher->putJobResult(std::move(j));
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <deque>
 #include <unordered_set>
@@ -61,6 +62,8 @@ class AsyncWorkerThread : public Thread,
 private:
 	AsyncEngine *jobDispatcher = nullptr;
 	bool isErrored = false;
+	// Lua heap size after the last job, for AsyncEngine::getMemoryUsage()
+	std::atomic<size_t> memoryUsage{0};
 };
 
 // Asynchornous thread and job management
@@ -108,6 +111,11 @@ class AsyncEngine {
 	 */
 	void step(lua_State *L);
 
+	/**
+	 * Sum of the Lua heap sizes of the worker threads, as of their last job
+	 */
+	size_t getMemoryUsage() const;
+
 protected:
 	/**
 	 * Get a Job from queue to be processed
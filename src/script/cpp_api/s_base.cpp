@@ -394,6 +394,7 @@ void ScriptApiBase::stackDump(std::ostream &o)
 void ScriptApiBase::setOriginDirect(const char *origin)
 {
 	m_last_run_mod = origin ? origin : "??";
+	switchTimingTarget();
 }
 
 void ScriptApiBase::setOriginFromTableRaw(int index, const char *fxn)
@@ -401,6 +402,76 @@ void ScriptApiBase::setOriginFromTableRaw(int index, const char *fxn)
 	lua_State *L = getStack();
 	m_last_run_mod = lua_istable(L, index) ?
 		getstringfield_default(L, index, "mod_origin", "") : "";
+	switchTimingTarget();
+}
+
+std::vector<std::pair<std::string, u64>> ScriptApiBase::getModTimes()
+{
+	RecursiveMutexAutoLock lock(m_luastackmutex);
+	// include the call that is running right now
+	if (m_timing_depth > 0)
+		chargeTime(porting::getTimeUs());
+	return {m_mod_times.begin(), m_mod_times.end()};
+}
+
+size_t ScriptApiBase::getMemoryUsage()
+{
+	lua_State *L = getStack();
+	return (size_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+void ScriptApiBase::setGarbageCollectorParams(int pause, int stepmul)
+{
+	lua_State *L = getStack();
+	lua_gc(L, LUA_GCSETPAUSE, pause);
+	lua_gc(L, LUA_GCSETSTEPMUL, stepmul);
+}
+
+u64 ScriptApiBase::stepGarbageCollector(u64 max_us)
+{
+	lua_State *L = getStack();
+	const u64 start = porting::getTimeUs();
+	u64 now = start;
+	while (now - start < max_us) {
+		// returns 1 when a cycle was finished
+		bool finished = lua_gc(L, LUA_GCSTEP, 0);
+		now = porting::getTimeUs();
+		if (finished)
+			break;
+	}
+	return now - start;
+}
+
+u64 *ScriptApiBase::beginTiming()
+{
+	if (m_timing_depth++ == 0) {
+		m_timing_start = porting::getTimeUs();
+		m_timing_target = nullptr;
+	}
+	return m_timing_target;
+}
+
+void ScriptApiBase::endTiming(u64 *caller_target)
+{
+	chargeTime(porting::getTimeUs());
+	m_timing_target = --m_timing_depth > 0 ? caller_target : nullptr;
+}
+
+void ScriptApiBase::chargeTime(u64 now)
+{
+	if (m_timing_target)
+		*m_timing_target += now - m_timing_start;
+	m_timing_start = now;
+}
+
+void ScriptApiBase::switchTimingTarget()
+{
+	if (m_timing_depth == 0)
+		return;
+	chargeTime(porting::getTimeUs());
+	// the pointer stays valid, elements of unordered_map are never moved
+	m_timing_target = m_last_run_mod.empty() ? nullptr :
+		&m_mod_times[m_last_run_mod];
 }
 
 /*
@@ -9,6 +9,8 @@
 #include <thread>
 #include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "common/helper.h"
 #include "util/basic_macros.h"
 
@@ -101,6 +103,32 @@ class ScriptApiBase : protected LuaHelper {
 	void setOriginDirect(const char *origin);
 	void setOriginFromTableRaw(int index, const char *fxn);
 
+	/*
+		Time spent running Lua is charged to the origin set above, for as long
+		as a call into the script API is running. Nested calls charge the
+		caller again when they return.
+		This is just as fuzzy as the origin itself, but good enough to tell
+		which mods take up the time.
+	*/
+	// Returns the total time per mod, in microseconds
+	std::vector<std::pair<std::string, u64>> getModTimes();
+
+	// Size of the Lua heap in bytes, like collectgarbage("count") * 1024.
+	// Must be called from the thread that runs this environment.
+	size_t getMemoryUsage();
+
+	// Sets the pause and step multiplier of the incremental collector,
+	// like collectgarbage("setpause") and collectgarbage("setstepmul").
+	void setGarbageCollectorParams(int pause, int stepmul);
+	// Runs garbage collection steps until max_us have passed or a cycle is
+	// finished. Returns the time used in microseconds.
+	// Must be called from the thread that runs this environment.
+	u64 stepGarbageCollector(u64 max_us);
+
+	// Used by SCRIPTAPI_PRECHECKHEADER, returns what to pass to endTiming()
+	u64 *beginTiming();
+	void endTiming(u64 *caller_target);
+
 	/**
 	 * Returns the currently running mod, only during init time.
 	 * The reason this is insecure is that mods can mess with each others code,
@@ -178,6 +206,16 @@ class ScriptApiBase : protected LuaHelper {
 private:
 	static int luaPanic(lua_State *L);
 
+	void chargeTime(u64 now);
+	void switchTimingTarget();
+
+	// see getModTimes()
+	std::unordered_map<std::string, u64> m_mod_times;
+	// entry of m_mod_times the current time is charged to, if any
+	u64 *m_timing_target = nullptr;
+	u64 m_timing_start = 0;
+	int m_timing_depth = 0;
+
 	lua_State      *m_luastack = nullptr;
 
 	IGameDef       *m_gamedef = nullptr;
@@ -355,6 +355,28 @@ void ScriptApiEnv::check_for_falling(v3s16 p)
 	PCALL_RES(lua_pcall(L, 1, 0, error_handler));
 }
 
+void ScriptApiEnv::on_find_path_async_done(u32 id, const std::vector<v3s16> &path)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	int error_handler = PUSH_ERROR_HANDLER(L);
+	lua_getglobal(L, "core");
+	lua_getfield(L, -1, "find_path_async_handler");
+	luaL_checktype(L, -1, LUA_TFUNCTION);
+	lua_pushinteger(L, id);
+	if (path.empty()) {
+		lua_pushnil(L);
+	} else {
+		lua_createtable(L, path.size(), 0);
+		for (size_t i = 0; i < path.size(); i++) {
+			push_v3s16(L, path[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+	}
+	PCALL_RES(lua_pcall(L, 2, 0, error_handler));
+	lua_pop(L, 2); // Pop core and error handler
+}
+
 void ScriptApiEnv::on_liquid_transformed(
 	const std::vector<std::pair<v3s16, MapNode>> &list)
 {
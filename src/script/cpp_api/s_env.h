@@ -32,6 +32,9 @@ class ScriptApiEnv : virtual public ScriptApiBase
 
 	void check_for_falling(v3s16 p);
 
+	// Called with the result of core.find_path_async(), path is empty on failure
+	void on_find_path_async_done(u32 id, const std::vector<v3s16> &path);
+
 	// Called after liquid transform changes
 	void on_liquid_transformed(const std::vector<std::pair<v3s16, MapNode>> &list);
 
@@ -62,9 +62,27 @@ class LockChecker {
 	#define SCRIPTAPI_LOCK_CHECK while(0)
 #endif
 
+// Charges the time spent in the script to the origin, see getModTimes()
+class ScriptTimingScope {
+public:
+	ScriptTimingScope(ScriptApiBase *script) :
+		m_script(script), m_caller_target(script->beginTiming())
+	{}
+
+	~ScriptTimingScope()
+	{
+		m_script->endTiming(m_caller_target);
+	}
+
+private:
+	ScriptApiBase *m_script;
+	u64 *m_caller_target;
+};
+
 #define SCRIPTAPI_PRECHECKHEADER                                               \
 		RecursiveMutexAutoLock scriptlock(this->m_luastackmutex);              \
 		SCRIPTAPI_LOCK_CHECK;                                                  \
+		ScriptTimingScope script_timing(this);                                 \
 		realityCheck();                                                        \
 		lua_State *L = getStack();                                             \
 		assert(lua_checkstack(L, 20));                                         \
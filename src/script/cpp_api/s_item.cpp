@@ -9,6 +9,8 @@
 #include "lua_api/l_item.h"
 #include "lua_api/l_inventory.h"
 #include "server.h"
+#include "gamedef.h"
+#include "nodedef.h"
 #include "log.h"
 #include "util/pointedthing.h"
 #include "inventory.h"
@@ -208,11 +210,9 @@ bool ScriptApiItem::item_CraftPredict(ItemStack &item, ServerActiveObject *user,
 // function onto the stack
 // If core.registered_items[name] doesn't exist, core.nodedef_default
 // is tried instead so unknown items can still be manipulated to some degree
-bool ScriptApiItem::getItemCallback(const char *name, const char *callbackname,
-		const v3s16 *p)
+// Pushes the definition of the item, or core.nodedef_default if there is none
+static void push_item_def(lua_State *L, const char *name, const v3s16 *p)
 {
-	lua_State* L = getStack();
-
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "registered_items");
 	lua_remove(L, -2); // Remove core
@@ -234,9 +234,12 @@ bool ScriptApiItem::getItemCallback(const char *name, const char *callbackname,
 		lua_remove(L, -2);
 		luaL_checktype(L, -1, LUA_TTABLE);
 	}
+}
 
-	setOriginFromTable(-1);
-
+// Replaces the definition on top of the stack with its callback
+static bool get_def_callback(lua_State *L, const char *name,
+	const char *callbackname)
+{
 	lua_getfield(L, -1, callbackname);
 	lua_remove(L, -2); // Remove item def
 	// Should be a function or nil
@@ -252,6 +255,47 @@ bool ScriptApiItem::getItemCallback(const char *name, const char *callbackname,
 	return false;
 }
 
+bool ScriptApiItem::getItemCallback(const char *name, const char *callbackname,
+		const v3s16 *p)
+{
+	lua_State* L = getStack();
+
+	push_item_def(L, name, p);
+
+	setOriginFromTable(-1);
+
+	return get_def_callback(L, name, callbackname);
+}
+
+bool ScriptApiItem::getNodeCallback(content_t c, const char *callbackname,
+		const v3s16 *p)
+{
+	lua_State* L = getStack();
+	const std::string &name = getGameDef()->ndef()->get(c).name;
+
+	// Only the tables are cached, so that changing a callback in a
+	// definition still works
+	lua_rawgeti(L, LUA_REGISTRYINDEX, CUSTOM_RIDX_NODE_DEF_CACHE);
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, LUA_REGISTRYINDEX, CUSTOM_RIDX_NODE_DEF_CACHE);
+	}
+	lua_rawgeti(L, -1, c);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		push_item_def(L, name.c_str(), p);
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, -3, c);
+	}
+	lua_remove(L, -2); // Remove cache
+
+	setOriginFromTable(-1);
+
+	return get_def_callback(L, name.c_str(), callbackname);
+}
+
 void ScriptApiItem::pushPointedThing(const PointedThing &pointed, bool hitpoint)
 {
 	lua_State* L = getStack();
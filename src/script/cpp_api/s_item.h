@@ -6,6 +6,7 @@
 
 #include "cpp_api/s_base.h"
 #include "irr_v3d.h"
+#include "mapnode.h"
 #include <optional>
 
 struct PointedThing;
@@ -46,6 +47,9 @@ class ScriptApiItem
 	friend class ModApiItem;
 
 	bool getItemCallback(const char *name, const char *callbackname, const v3s16 *p = nullptr);
+	// Same for the callbacks of nodes, but the definition tables are cached
+	// by content ID until items are registered again
+	bool getNodeCallback(content_t c, const char *callbackname, const v3s16 *p = nullptr);
 	/*!
 	 * Pushes a `pointed_thing` tabe to the stack.
 	 * \param hitpoint If true, the exact pointing location is also pushed
@@ -96,10 +96,8 @@ bool ScriptApiNode::node_on_punch(v3s16 p, MapNode node,
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_punch", &p))
+	if (!getNodeCallback(node.getContent(), "on_punch", &p))
 		return false;
 
 	// Call function
@@ -119,10 +117,8 @@ bool ScriptApiNode::node_on_dig(v3s16 p, MapNode node,
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_dig", &p))
+	if (!getNodeCallback(node.getContent(), "on_dig", &p))
 		return false;
 
 	// Call function
@@ -145,10 +141,8 @@ void ScriptApiNode::node_on_construct(v3s16 p, MapNode node)
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_construct", &p))
+	if (!getNodeCallback(node.getContent(), "on_construct", &p))
 		return;
 
 	// Call function
@@ -163,10 +157,8 @@ void ScriptApiNode::node_on_destruct(v3s16 p, MapNode node)
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_destruct", &p))
+	if (!getNodeCallback(node.getContent(), "on_destruct", &p))
 		return;
 
 	// Call function
@@ -181,10 +173,8 @@ bool ScriptApiNode::node_on_flood(v3s16 p, MapNode node, MapNode newnode)
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_flood", &p))
+	if (!getNodeCallback(node.getContent(), "on_flood", &p))
 		return false;
 
 	// Call function
@@ -202,10 +192,8 @@ void ScriptApiNode::node_after_destruct(v3s16 p, MapNode node)
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "after_destruct", &p))
+	if (!getNodeCallback(node.getContent(), "after_destruct", &p))
 		return;
 
 	// Call function
@@ -221,10 +209,8 @@ bool ScriptApiNode::node_on_timer(v3s16 p, MapNode node, f32 dtime)
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_timer", &p))
+	if (!getNodeCallback(node.getContent(), "on_timer", &p))
 		return false;
 
 	// Call function
@@ -244,15 +230,13 @@ void ScriptApiNode::node_on_receive_fields(v3s16 p,
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// If node doesn't exist, we don't know what callback to call
 	MapNode node = getEnv()->getMap().getNode(p);
 	if (node.getContent() == CONTENT_IGNORE)
 		return;
 
 	// Push callback function on stack
-	if (!getItemCallback(ndef->get(node).name.c_str(), "on_receive_fields", &p))
+	if (!getNodeCallback(node.getContent(), "on_receive_fields", &p))
 		return;
 
 	// Call function
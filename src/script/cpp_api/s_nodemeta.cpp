@@ -29,7 +29,7 @@ int ScriptApiNodemeta::nodemeta_inventory_AllowMove(
 
 	// Push callback function on stack
 	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "allow_metadata_inventory_move", &ma.to_inv.p))
+	if (!getNodeCallback(node.getContent(), "allow_metadata_inventory_move", &ma.to_inv.p))
 		return count;
 
 	// function(pos, from_list, from_index, to_list, to_index, count, player)
@@ -67,7 +67,7 @@ int ScriptApiNodemeta::nodemeta_inventory_AllowPut(
 
 	// Push callback function on stack
 	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "allow_metadata_inventory_put", &ma.to_inv.p))
+	if (!getNodeCallback(node.getContent(), "allow_metadata_inventory_put", &ma.to_inv.p))
 		return stack.count;
 
 	// Call function(pos, listname, index, stack, player)
@@ -103,7 +103,7 @@ int ScriptApiNodemeta::nodemeta_inventory_AllowTake(
 
 	// Push callback function on stack
 	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "allow_metadata_inventory_take", &ma.from_inv.p))
+	if (!getNodeCallback(node.getContent(), "allow_metadata_inventory_take", &ma.from_inv.p))
 		return stack.count;
 
 	// Call function(pos, listname, index, count, player)
@@ -130,16 +130,13 @@ void ScriptApiNodemeta::nodemeta_inventory_OnMove(
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// If node doesn't exist, we don't know what callback to call
 	MapNode node = getEnv()->getMap().getNode(ma.from_inv.p);
 	if (node.getContent() == CONTENT_IGNORE)
 		return;
 
 	// Push callback function on stack
-	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "on_metadata_inventory_move", &ma.from_inv.p))
+	if (!getNodeCallback(node.getContent(), "on_metadata_inventory_move", &ma.from_inv.p))
 		return;
 
 	// function(pos, from_list, from_index, to_list, to_index, count, player)
@@ -163,16 +160,13 @@ void ScriptApiNodemeta::nodemeta_inventory_OnPut(
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// If node doesn't exist, we don't know what callback to call
 	MapNode node = getEnv()->getMap().getNode(ma.to_inv.p);
 	if (node.getContent() == CONTENT_IGNORE)
 		return;
 
 	// Push callback function on stack
-	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "on_metadata_inventory_put", &ma.to_inv.p))
+	if (!getNodeCallback(node.getContent(), "on_metadata_inventory_put", &ma.to_inv.p))
 		return;
 
 	// Call function(pos, listname, index, stack, player)
@@ -194,16 +188,13 @@ void ScriptApiNodemeta::nodemeta_inventory_OnTake(
 
 	int error_handler = PUSH_ERROR_HANDLER(L);
 
-	const NodeDefManager *ndef = getServer()->ndef();
-
 	// If node doesn't exist, we don't know what callback to call
 	MapNode node = getEnv()->getMap().getNode(ma.from_inv.p);
 	if (node.getContent() == CONTENT_IGNORE)
 		return;
 
 	// Push callback function on stack
-	const auto &nodename = ndef->get(node).name;
-	if (!getItemCallback(nodename.c_str(), "on_metadata_inventory_take", &ma.from_inv.p))
+	if (!getNodeCallback(node.getContent(), "on_metadata_inventory_take", &ma.from_inv.p))
 		return;
 
 	// Call function(pos, listname, index, stack, player)
@@ -11,11 +11,14 @@
 #include "client/client.h"
 #endif
 #include "settings.h"
+#include "threading/mutex_auto_lock.h"
+#include "util/hashing.h"
 
 #include <cerrno>
 #include <string>
 #include <algorithm>
 #include <iostream>
+#include <unordered_map>
 
 
 #define SECURE_API(lib, name) \
@@ -441,6 +444,42 @@ bool ScriptApiSecurity::safeLoadString(lua_State *L, std::string_view code, cons
 	return true;
 }
 
+/*
+	Files are compiled once per process. The server, async and emerge
+	environments all load the same mods, so they can share the bytecode.
+	Only bytecode compiled here from the same source and chunk name
+	is reused, so this doesn't allow loading bytecode from mods.
+*/
+static std::mutex s_chunk_cache_mutex;
+static std::unordered_map<std::string, std::string> s_chunk_cache;
+
+static int write_chunk(lua_State *L, const void *p, size_t size, void *ud)
+{
+	static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+	return 0;
+}
+
+static bool load_cached_chunk(lua_State *L, std::string_view code, const char *chunk_name)
+{
+	std::string key = hashing::sha1(code);
+	key.append(chunk_name);
+	{
+		MutexAutoLock lock(s_chunk_cache_mutex);
+		auto it = s_chunk_cache.find(key);
+		if (it != s_chunk_cache.end())
+			return !luaL_loadbuffer(L, it->second.data(), it->second.size(), chunk_name);
+	}
+
+	if (luaL_loadbuffer(L, code.data(), code.size(), chunk_name))
+		return false;
+	std::string bytecode;
+	if (lua_dump(L, write_chunk, &bytecode) == 0) {
+		MutexAutoLock lock(s_chunk_cache_mutex);
+		s_chunk_cache.emplace(std::move(key), std::move(bytecode));
+	}
+	return true;
+}
+
 bool ScriptApiSecurity::safeLoadFile(lua_State *L, const char *path, const char *display_name)
 {
 	FILE *fp;
@@ -503,7 +542,13 @@ bool ScriptApiSecurity::safeLoadFile(lua_State *L, const char *path, const char
 		return false;
 	}
 
-	bool result = safeLoadString(L, code, chunk_name);
+	bool result;
+	if (code.size() > 0 && code[0] == LUA_SIGNATURE[0]) {
+		lua_pushliteral(L, "Bytecode prohibited when mod security is enabled.");
+		result = false;
+	} else {
+		result = load_cached_chunk(L, code, chunk_name);
+	}
 	if (path)
 		delete [] chunk_name;
 	return result;
@@ -126,6 +126,40 @@ int LuaAreaStore::l_get_areas_for_pos(lua_State *L)
 	return 1;
 }
 
+// get_areas_for_positions(positions, include_corners, include_data)
+int LuaAreaStore::l_get_areas_for_positions(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaAreaStore *o = checkObject<LuaAreaStore>(L, 1);
+	AreaStore *ast = o->as;
+
+	luaL_checktype(L, 2, LUA_TTABLE);
+	std::vector<v3s16> positions;
+	const size_t count = lua_objlen(L, 2);
+	positions.reserve(count);
+	for (size_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, 2, i);
+		positions.push_back(check_v3s16(L, -1));
+		lua_pop(L, 1);
+	}
+
+	bool include_corners = true;
+	bool include_data = false;
+	get_data_and_corner_flags(L, 3, &include_corners, &include_data);
+
+	std::vector<std::vector<Area *>> res;
+	ast->getAreasForPositions(&res, positions);
+
+	lua_createtable(L, res.size(), 0);
+	for (size_t i = 0; i < res.size(); i++) {
+		push_areas(L, res[i], include_corners, include_data);
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
 // get_areas_in_area(corner1, corner2, accept_overlap, include_corners, include_data)
 int LuaAreaStore::l_get_areas_in_area(lua_State *L)
 {
@@ -298,7 +332,9 @@ LuaAreaStore::LuaAreaStore(const std::string &type)
 		as = new SpatialAreaStore();
 	} else
 #endif
-	{
+	if (type == "LibSpatial" || type == "Tree") {
+		as = new TreeAreaStore();
+	} else {
 		as = new VectorAreaStore();
 	}
 }
@@ -340,6 +376,7 @@ const char LuaAreaStore::className[] = "AreaStore";
 const luaL_Reg LuaAreaStore::methods[] = {
 	luamethod(LuaAreaStore, get_area),
 	luamethod(LuaAreaStore, get_areas_for_pos),
+	luamethod(LuaAreaStore, get_areas_for_positions),
 	luamethod(LuaAreaStore, get_areas_in_area),
 	luamethod(LuaAreaStore, insert_area),
 	luamethod(LuaAreaStore, reserve),
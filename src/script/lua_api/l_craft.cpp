@@ -346,13 +346,10 @@ int ModApiCraft::l_clear_craft(lua_State *L)
 	return 1;
 }
 
-// get_craft_result(input)
-int ModApiCraft::l_get_craft_result(lua_State *L)
+// Reads the input table at index input_i, crafts it and pushes
+// output and decremented input
+void ModApiCraft::pushCraftResult(lua_State *L, int input_i, IGameDef *gdef)
 {
-	NO_MAP_LOCK_REQUIRED;
-	IGameDef *gdef = getGameDef(L);
-
-	const int input_i = 1;
 	std::string method_s = getstringfield_default(L, input_i, "method", "normal");
 	enum CraftMethod method = (CraftMethod)getenumfield(L, input_i, "method",
 				es_CraftMethod, CRAFT_METHOD_NORMAL);
@@ -393,9 +390,42 @@ int ModApiCraft::l_get_craft_result(lua_State *L)
 	lua_setfield(L, -2, "width");
 	push_items(L, input.items);
 	lua_setfield(L, -2, "items");
+}
+
+// get_craft_result(input)
+int ModApiCraft::l_get_craft_result(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	IGameDef *gdef = getGameDef(L);
+
+	pushCraftResult(L, 1, gdef);
 	return 2;
 }
 
+// get_craft_results(inputs)
+int ModApiCraft::l_get_craft_results(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	IGameDef *gdef = getGameDef(L);
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	const size_t count = lua_objlen(L, 1);
+	lua_createtable(L, count, 0);
+	for (size_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, 1, i);
+		luaL_checktype(L, -1, LUA_TTABLE);
+		const int input_i = lua_gettop(L);
+
+		lua_createtable(L, 0, 2);
+		pushCraftResult(L, input_i, gdef);
+		lua_setfield(L, -3, "decremented_input");
+		lua_setfield(L, -2, "output");
+
+		lua_rawseti(L, -3, i);
+		lua_pop(L, 1); // input
+	}
+	return 1;
+}
 
 static void push_craft_recipe(lua_State *L, IGameDef *gdef,
 		const CraftDefinition *recipe,
@@ -501,6 +531,7 @@ void ModApiCraft::Initialize(lua_State *L, int top)
 	API_FCT(get_all_craft_recipes);
 	API_FCT(get_craft_recipe);
 	API_FCT(get_craft_result);
+	API_FCT(get_craft_results);
 	API_FCT(register_craft);
 	API_FCT(clear_craft);
 }
@@ -511,4 +542,5 @@ void ModApiCraft::InitializeAsync(lua_State *L, int top)
 	API_FCT(get_all_craft_recipes);
 	API_FCT(get_craft_recipe);
 	API_FCT(get_craft_result);
+	API_FCT(get_craft_results);
 }
@@ -10,6 +10,7 @@
 #include "lua_api/l_base.h"
 
 struct CraftReplacements;
+class IGameDef;
 
 class ModApiCraft : public ModApiBase {
 private:
@@ -17,6 +18,7 @@ class ModApiCraft : public ModApiBase {
 	static int l_get_craft_recipe(lua_State *L);
 	static int l_get_all_craft_recipes(lua_State *L);
 	static int l_get_craft_result(lua_State *L);
+	static int l_get_craft_results(lua_State *L);
 	static int l_clear_craft(lua_State *L);
 
 	static bool readCraftReplacements(lua_State *L, int index,
@@ -25,6 +27,7 @@ class ModApiCraft : public ModApiBase {
 			std::vector<std::string> &recipe);
 	static bool readCraftRecipeShaped(lua_State *L, int index,
 			int &width, std::vector<std::string> &recipe);
+	static void pushCraftResult(lua_State *L, int input_i, IGameDef *gdef);
 
 	static struct EnumString es_CraftMethod[];
 
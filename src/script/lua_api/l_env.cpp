@@ -18,6 +18,9 @@
 #include "server.h"
 #include "nodedef.h"
 #include "daynightratio.h"
+#include "filesys.h"
+#include "gettime.h"
+#include "servermap.h"
 #include "util/pointedthing.h"
 #include "mapgen/treegen.h"
 #include "emerge_internal.h"
@@ -25,6 +28,7 @@
 #include "face_position_cache.h"
 #include "remoteplayer.h"
 #include "server/luaentity_sao.h"
+#include "server/pathfinderpool.h"
 #include "server/player_sao.h"
 #include "util/string.h"
 #include "translation.h"
@@ -145,7 +149,7 @@ void LuaEmergeAreaCallback(v3s16 blockpos, EmergeAction action, void *param)
 
 	// state must be protected by envlock
 	Server *server = state->script->getServer();
-	Server::EnvAutoLock envlock(server);
+	Server::EnvAutoLock envlock(server, ENV_LOCK_EMERGE);
 
 	state->refcount--;
 
@@ -191,15 +195,17 @@ int ModApiEnv::l_bulk_set_node(lua_State *L)
 
 	MapNode n = readnode(L, 2);
 
-	// Do it
-	bool succeeded = true;
+	std::vector<v3s16> positions;
+	positions.reserve(len);
 	for (s32 i = 1; i <= len; i++) {
 		lua_rawgeti(L, 1, i);
-		if (!env->setNode(read_v3s16(L, -1), n))
-			succeeded = false;
+		positions.push_back(read_v3s16(L, -1));
 		lua_pop(L, 1);
 	}
 
+	// Do it
+	bool succeeded = env->setNodes(positions, n);
+
 	lua_pushboolean(L, succeeded);
 	return 1;
 }
@@ -250,15 +256,17 @@ int ModApiEnv::l_bulk_swap_node(lua_State *L)
 
 	MapNode n = readnode(L, 2);
 
-	// Do it
-	bool succeeded = true;
+	std::vector<v3s16> positions;
+	positions.reserve(len);
 	for (s32 i = 1; i <= len; i++) {
 		lua_rawgeti(L, 1, i);
-		if (!env->swapNode(read_v3s16(L, -1), n))
-			succeeded = false;
+		positions.push_back(read_v3s16(L, -1));
 		lua_pop(L, 1);
 	}
 
+	// Do it
+	bool succeeded = env->swapNodes(positions, n);
+
 	lua_pushboolean(L, succeeded);
 	return 1;
 }
@@ -805,6 +813,71 @@ void ModApiEnvBase::collectNodeIds(lua_State *L, int idx, const NodeDefManager *
 	}
 }
 
+/*
+	Node lookups through the blocks of a map for the searches below.
+	Remembers the last block and whether it contains any of the searched
+	nodes, blocks that don't are never looked into.
+*/
+class BlockSearchCache
+{
+public:
+	BlockSearchCache(Map &map, const std::vector<content_t> &filter) :
+		m_map(map), m_filter(filter),
+		m_want_ignore(CONTAINS(filter, CONTENT_IGNORE))
+	{}
+
+	// Nodes in blocks without any matches are replaced by one that doesn't
+	// match either
+	MapNode getNode(v3s16 p)
+	{
+		v3s16 bp = getNodeBlockPos(p);
+		select(bp);
+		if (!m_may_match)
+			return m_no_match;
+		if (!m_block)
+			return MapNode(CONTENT_IGNORE);
+		return m_block->getNodeNoCheck(p - bp * MAP_BLOCKSIZE);
+	}
+
+	// Number of nodes from p to the top of its block if the block has no
+	// matches, 0 otherwise
+	int getSkip(v3s16 p)
+	{
+		v3s16 bp = getNodeBlockPos(p);
+		select(bp);
+		if (m_may_match)
+			return 0;
+		return (bp.Y + 1) * MAP_BLOCKSIZE - p.Y;
+	}
+
+private:
+	void select(v3s16 bp)
+	{
+		if (m_selected && bp == m_blockpos)
+			return;
+		m_selected = true;
+		m_blockpos = bp;
+		m_block = m_map.getBlockNoCreateNoEx(bp);
+		if (!m_block) {
+			m_may_match = m_want_ignore;
+			m_no_match = MapNode(CONTENT_IGNORE);
+		} else {
+			m_may_match = m_block->containsAnyContent(m_filter);
+			m_no_match = m_block->getNodeNoCheck(0, 0, 0);
+		}
+	}
+
+	Map &m_map;
+	const std::vector<content_t> &m_filter;
+	const bool m_want_ignore;
+
+	bool m_selected = false;
+	v3s16 m_blockpos;
+	MapBlock *m_block = nullptr;
+	bool m_may_match = true;
+	MapNode m_no_match;
+};
+
 template <typename F>
 int ModApiEnvBase::findNodeNear(lua_State *L, v3s16 pos, int radius,
 		const std::vector<content_t> &filter, int start_radius, F &&getNode)
@@ -845,8 +918,9 @@ int ModApiEnv::l_find_node_near(lua_State *L)
 		radius = client->CSMClampRadius(pos, radius);
 #endif
 
-	auto getNode = [&map] (v3s16 p) -> MapNode {
-		return map.getNode(p);
+	BlockSearchCache cache(map, filter);
+	auto getNode = [&cache] (v3s16 p) -> MapNode {
+		return cache.getNode(p);
 	};
 	return findNodeNear(L, pos, radius, filter, start_radius, getNode);
 }
@@ -965,14 +1039,14 @@ int ModApiEnv::l_find_nodes_in_area(lua_State *L)
 	bool grouped = lua_isboolean(L, 4) && readParam<bool>(L, 4);
 
 	auto iterate = [&] (auto &&callback) {
-		map.forEachNodeInArea(minp, maxp, callback);
+		map.forEachNodeInArea(minp, maxp, filter, callback);
 	};
 	return findNodesInArea(L, ndef, filter, grouped, iterate);
 }
 
-template <typename F>
+template <typename F, typename S>
 int ModApiEnvBase::findNodesInAreaUnderAir(lua_State *L, v3s16 minp, v3s16 maxp,
-	const std::vector<content_t> &filter, F &&getNode)
+	const std::vector<content_t> &filter, F &&getNode, S &&getSkip)
 {
 	lua_newtable(L);
 	u32 i = 0;
@@ -982,6 +1056,14 @@ int ModApiEnvBase::findNodesInAreaUnderAir(lua_State *L, v3s16 minp, v3s16 maxp,
 		p.Y = minp.Y;
 		content_t c = getNode(p).getContent();
 		for (; p.Y <= maxp.Y; p.Y++) {
+			if (int skip = getSkip(p)) {
+				// continue with the first node that may match
+				if (p.Y + skip > maxp.Y)
+					break;
+				p.Y += skip - 1;
+				c = getNode(v3s16(p.X, p.Y + 1, p.Z)).getContent();
+				continue;
+			}
 			v3s16 psurf(p.X, p.Y + 1, p.Z);
 			content_t csurf = getNode(psurf).getContent();
 			if (c != CONTENT_AIR && csurf == CONTENT_AIR &&
@@ -1024,10 +1106,14 @@ int ModApiEnv::l_find_nodes_in_area_under_air(lua_State *L)
 	std::vector<content_t> filter;
 	collectNodeIds(L, 3, ndef, filter);
 
+	BlockSearchCache cache(map, filter);
 	auto getNode = [&map] (v3s16 p) -> MapNode {
 		return map.getNode(p);
 	};
-	return findNodesInAreaUnderAir(L, minp, maxp, filter, getNode);
+	auto getSkip = [&cache] (v3s16 p) -> int {
+		return cache.getSkip(p);
+	};
+	return findNodesInAreaUnderAir(L, minp, maxp, filter, getNode, getSkip);
 }
 
 // get_value_noise(seeddiff, octaves, persistence, scale)
@@ -1099,6 +1185,44 @@ int ModApiEnv::l_clear_objects(lua_State *L)
 	return 0;
 }
 
+// create_map_snapshot([name]) -> path or nil, error
+// copies the map database into <world>/snapshots/<name> in the background
+int ModApiEnv::l_create_map_snapshot(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	std::string name;
+	if (lua_isnoneornil(L, 1)) {
+		name = getTimestamp();
+		str_replace(name, ' ', '_');
+		str_replace(name, ':', '-');
+	} else {
+		name = luaL_checkstring(L, 1);
+		if (name.empty() || !string_allowed(name,
+				"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_")) {
+			throw LuaError("Invalid snapshot name");
+		}
+	}
+
+	const std::string dir = getServer(L)->getWorldPath() + DIR_DELIM "snapshots"
+		DIR_DELIM + name;
+	if (fs::PathExists(dir)) {
+		lua_pushnil(L);
+		lua_pushstring(L, "Snapshot already exists");
+		return 2;
+	}
+
+	try {
+		env->getServerMap().startBackup(dir);
+	} catch (BaseException &e) {
+		lua_pushnil(L);
+		lua_pushstring(L, e.what());
+		return 2;
+	}
+	lua_pushstring(L, dir.c_str());
+	return 1;
+}
+
 // line_of_sight(pos1, pos2) -> true/false, pos
 int ModApiEnv::l_line_of_sight(lua_State *L)
 {
@@ -1120,6 +1244,101 @@ int ModApiEnv::l_line_of_sight(lua_State *L)
 	return 1;
 }
 
+// Reads a list of {pos1, pos2}
+static std::vector<core::line3d<f32>> read_lines(lua_State *L, int index)
+{
+	luaL_checktype(L, index, LUA_TTABLE);
+	std::vector<core::line3d<f32>> lines;
+	lines.reserve(lua_objlen(L, index));
+	for (size_t i = 1; i <= lua_objlen(L, index); i++) {
+		lua_rawgeti(L, index, i);
+		luaL_checktype(L, -1, LUA_TTABLE);
+		lua_rawgeti(L, -1, 1);
+		lua_rawgeti(L, -2, 2);
+		lines.emplace_back(checkFloatPos(L, -2), checkFloatPos(L, -1));
+		lua_pop(L, 3);
+	}
+	return lines;
+}
+
+// Lines starting close to each other are likely to meet the same nodes
+static std::vector<u32> sort_lines(const std::vector<core::line3d<f32>> &lines)
+{
+	std::vector<u32> order(lines.size());
+	std::vector<v3s16> origins(lines.size());
+	for (u32 i = 0; i < lines.size(); i++) {
+		order[i] = i;
+		origins[i] = getNodeBlockPos(floatToInt(lines[i].start, BS));
+	}
+	std::sort(order.begin(), order.end(), [&] (u32 a, u32 b) {
+		const v3s16 &pa = origins[a], &pb = origins[b];
+		return std::tie(pa.Z, pa.Y, pa.X) < std::tie(pb.Z, pb.Y, pb.X);
+	});
+	return order;
+}
+
+// line_of_sight_batch({{pos1, pos2}, ...}) -> {true or pos, ...}
+int ModApiEnv::l_line_of_sight_batch(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	std::vector<core::line3d<f32>> lines = read_lines(L, 1);
+
+	std::vector<std::optional<v3s16>> blocked;
+	// not worth waking up threads for a few lines
+	WorkerPool *pool = lines.size() >= 64 ? env->getRaycastPool() : nullptr;
+	env->line_of_sight_batch(lines, blocked, pool);
+
+	lua_createtable(L, blocked.size(), 0);
+	for (size_t i = 0; i < blocked.size(); i++) {
+		if (blocked[i])
+			push_v3s16(L, *blocked[i]);
+		else
+			lua_pushboolean(L, true);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
+// raycast_batch({{pos1, pos2}, ...}, objects, liquids, pointabilities)
+//     -> {pointed_thing or false, ...}
+int ModApiEnv::l_raycast_batch(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	std::vector<core::line3d<f32>> lines = read_lines(L, 1);
+	bool objects = true;
+	bool liquids = false;
+	std::optional<Pointabilities> pointabilities = std::nullopt;
+	if (lua_isboolean(L, 2))
+		objects = readParam<bool>(L, 2);
+	if (lua_isboolean(L, 3))
+		liquids = readParam<bool>(L, 3);
+	if (lua_istable(L, 4))
+		pointabilities = read_pointabilities(L, 4);
+
+	lua_createtable(L, lines.size(), 0);
+	for (u32 i : sort_lines(lines)) {
+		RaycastState state(lines[i], objects, liquids, pointabilities);
+		PointedThing pointed;
+		for (;;) {
+			env->continueRaycast(&state, &pointed);
+			if (pointed.type != POINTEDTHING_OBJECT)
+				break;
+			const auto *obj = env->getActiveObject(pointed.object_id);
+			if (obj && !obj->isGone())
+				break;
+			// skip gone object
+		}
+		if (pointed.type == POINTEDTHING_NOTHING)
+			lua_pushboolean(L, false);
+		else
+			push_pointed_thing(L, pointed, false, true);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
 // fix_light(p1, p2)
 int ModApiEnv::l_fix_light(lua_State *L)
 {
@@ -1256,6 +1475,21 @@ int ModApiEnv::l_delete_area(lua_State *L)
 	return 1;
 }
 
+static PathAlgorithm read_path_algorithm(lua_State *L, int index)
+{
+	PathAlgorithm algo = PA_PLAIN_NP;
+	if (!lua_isnoneornil(L, index)) {
+		std::string algorithm = luaL_checkstring(L, index);
+
+		if (algorithm == "A*")
+			algo = PA_PLAIN;
+
+		if (algorithm == "Dijkstra")
+			algo = PA_DIJKSTRA;
+	}
+	return algo;
+}
+
 // find_path(pos1, pos2, searchdistance,
 //     max_jump, max_drop, algorithm) -> table containing path
 int ModApiEnv::l_find_path(lua_State *L)
@@ -1267,19 +1501,10 @@ int ModApiEnv::l_find_path(lua_State *L)
 	unsigned int searchdistance = luaL_checkint(L, 3);
 	unsigned int max_jump       = luaL_checkint(L, 4);
 	unsigned int max_drop       = luaL_checkint(L, 5);
-	PathAlgorithm algo          = PA_PLAIN_NP;
-	if (!lua_isnoneornil(L, 6)) {
-		std::string algorithm = luaL_checkstring(L,6);
-
-		if (algorithm == "A*")
-			algo = PA_PLAIN;
-
-		if (algorithm == "Dijkstra")
-			algo = PA_DIJKSTRA;
-	}
+	PathAlgorithm algo          = read_path_algorithm(L, 6);
 
 	std::vector<v3s16> path = get_path(&env->getServerMap(), env->getGameDef()->ndef(), pos1, pos2,
-		searchdistance, max_jump, max_drop, algo);
+		searchdistance, max_jump, max_drop, algo, env->getNavigationCache());
 
 	if (!path.empty()) {
 		lua_createtable(L, path.size(), 0);
@@ -1297,12 +1522,54 @@ int ModApiEnv::l_find_path(lua_State *L)
 	return 0;
 }
 
-// spawn_tree(pos, treedef)
+// do_find_path_async(pos1, pos2, searchdistance,
+//     max_jump, max_drop, algorithm) -> id or nil
+int ModApiEnv::l_do_find_path_async(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	PathfinderPool::Request request;
+	request.source         = read_v3s16(L, 1);
+	request.destination    = read_v3s16(L, 2);
+	request.searchdistance = luaL_checkint(L, 3);
+	request.max_jump       = luaL_checkint(L, 4);
+	request.max_drop       = luaL_checkint(L, 5);
+	request.algo           = read_path_algorithm(L, 6);
+
+	u32 id = env->getPathfinderPool()->enqueue(request);
+	if (id == 0)
+		return 0;
+	lua_pushinteger(L, id);
+	return 1;
+}
+
+// do_cancel_find_path(id) -> true/false
+int ModApiEnv::l_do_cancel_find_path(lua_State *L)
+{
+	GET_ENV_PTR;
+
+	u32 id = luaL_checkinteger(L, 1);
+	lua_pushboolean(L, env->getPathfinderPool()->cancel(id));
+	return 1;
+}
+
+// spawn_tree(pos or {pos1, pos2, ...}, treedef)
 int ModApiEnv::l_spawn_tree(lua_State *L)
 {
 	GET_ENV_PTR;
 
-	v3s16 p0 = read_v3s16(L, 1);
+	std::vector<v3s16> positions;
+	s32 len = lua_istable(L, 1) ? lua_objlen(L, 1) : 0;
+	if (len > 0) {
+		positions.reserve(len);
+		for (s32 i = 1; i <= len; i++) {
+			lua_rawgeti(L, 1, i);
+			positions.push_back(read_v3s16(L, -1));
+			lua_pop(L, 1);
+		}
+	} else {
+		positions.push_back(read_v3s16(L, 1));
+	}
 
 	treegen::TreeDef tree_def;
 	const NodeDefManager *ndef = env->getGameDef()->ndef();
@@ -1312,7 +1579,7 @@ int ModApiEnv::l_spawn_tree(lua_State *L)
 
 	ServerMap *map = &env->getServerMap();
 	treegen::error e;
-	if ((e = treegen::spawn_ltree (map, p0, tree_def)) != treegen::SUCCESS) {
+	if ((e = treegen::spawn_ltrees(map, positions, tree_def)) != treegen::SUCCESS) {
 		throw LuaError("spawn_tree(): " + treegen::error_to_string(e));
 	}
 
@@ -1426,10 +1693,15 @@ void ModApiEnv::Initialize(lua_State *L, int top)
 	API_FCT(get_value_noise_map);
 	API_FCT(get_voxel_manip);
 	API_FCT(clear_objects);
+	API_FCT(create_map_snapshot);
 	API_FCT(spawn_tree);
 	API_FCT(find_path);
+	API_FCT(do_find_path_async);
+	API_FCT(do_cancel_find_path);
 	API_FCT(line_of_sight);
 	API_FCT(raycast);
+	API_FCT(line_of_sight_batch);
+	API_FCT(raycast_batch);
 	API_FCT(transforming_liquid_add);
 	API_FCT(forceload_block);
 	API_FCT(forceload_free_block);
@@ -1525,14 +1797,32 @@ int ModApiEnvVM::l_add_node_level(lua_State *L)
 int ModApiEnvVM::l_find_node_near(lua_State *L)
 {
 	GET_VM_PTR;
+	return findNodeNearVM(L, vm, 1);
+}
+
+// find_nodes_in_area(minp, maxp, nodenames, [grouped])
+int ModApiEnvVM::l_find_nodes_in_area(lua_State *L)
+{
+	GET_VM_PTR;
+	return findNodesInAreaVM(L, vm, 1);
+}
+
+// find_nodes_in_area_under_air(minp, maxp, nodenames)
+int ModApiEnvVM::l_find_nodes_in_area_under_air(lua_State *L)
+{
+	GET_VM_PTR;
+	return findNodesInAreaUnderAirVM(L, vm, 1);
+}
 
+int ModApiEnvVM::findNodeNearVM(lua_State *L, MMVManip *vm, int idx)
+{
 	const NodeDefManager *ndef = getGameDef(L)->ndef();
 
-	v3s16 pos = read_v3s16(L, 1);
-	int radius = luaL_checkinteger(L, 2);
+	v3s16 pos = read_v3s16(L, idx);
+	int radius = luaL_checkinteger(L, idx + 1);
 	std::vector<content_t> filter;
-	collectNodeIds(L, 3, ndef, filter);
-	int start_radius = (lua_isboolean(L, 4) && readParam<bool>(L, 4)) ? 0 : 1;
+	collectNodeIds(L, idx + 2, ndef, filter);
+	int start_radius = (lua_isboolean(L, idx + 3) && readParam<bool>(L, idx + 3)) ? 0 : 1;
 
 	auto getNode = [&vm] (v3s16 p) -> MapNode {
 		return vm->getNodeNoExNoEmerge(p);
@@ -1540,15 +1830,12 @@ int ModApiEnvVM::l_find_node_near(lua_State *L)
 	return findNodeNear(L, pos, radius, filter, start_radius, getNode);
 }
 
-// find_nodes_in_area(minp, maxp, nodenames, [grouped])
-int ModApiEnvVM::l_find_nodes_in_area(lua_State *L)
+int ModApiEnvVM::findNodesInAreaVM(lua_State *L, MMVManip *vm, int idx)
 {
-	GET_VM_PTR;
-
 	const NodeDefManager *ndef = getGameDef(L)->ndef();
 
-	v3s16 minp = read_v3s16(L, 1);
-	v3s16 maxp = read_v3s16(L, 2);
+	v3s16 minp = read_v3s16(L, idx);
+	v3s16 maxp = read_v3s16(L, idx + 1);
 	sortBoxVerticies(minp, maxp);
 
 	checkArea(minp, maxp);
@@ -1560,9 +1847,9 @@ int ModApiEnvVM::l_find_nodes_in_area(lua_State *L)
 	}
 
 	std::vector<content_t> filter;
-	collectNodeIds(L, 3, ndef, filter);
+	collectNodeIds(L, idx + 2, ndef, filter);
 
-	bool grouped = lua_isboolean(L, 4) && readParam<bool>(L, 4);
+	bool grouped = lua_isboolean(L, idx + 3) && readParam<bool>(L, idx + 3);
 
 	auto iterate = [&] (auto callback) {
 		for (s16 z = minp.Z; z <= maxp.Z; z++)
@@ -1580,25 +1867,25 @@ int ModApiEnvVM::l_find_nodes_in_area(lua_State *L)
 	return findNodesInArea(L, ndef, filter, grouped, iterate);
 }
 
-// find_nodes_in_area_under_air(minp, maxp, nodenames)
-int ModApiEnvVM::l_find_nodes_in_area_under_air(lua_State *L)
+int ModApiEnvVM::findNodesInAreaUnderAirVM(lua_State *L, MMVManip *vm, int idx)
 {
-	GET_VM_PTR;
-
 	const NodeDefManager *ndef = getGameDef(L)->ndef();
 
-	v3s16 minp = read_v3s16(L, 1);
-	v3s16 maxp = read_v3s16(L, 2);
+	v3s16 minp = read_v3s16(L, idx);
+	v3s16 maxp = read_v3s16(L, idx + 1);
 	sortBoxVerticies(minp, maxp);
 	checkArea(minp, maxp);
 
 	std::vector<content_t> filter;
-	collectNodeIds(L, 3, ndef, filter);
+	collectNodeIds(L, idx + 2, ndef, filter);
 
 	auto getNode = [&vm] (v3s16 p) -> MapNode {
 		return vm->getNodeNoExNoEmerge(p);
 	};
-	return findNodesInAreaUnderAir(L, minp, maxp, filter, getNode);
+	auto getSkip = [] (v3s16) -> int {
+		return 0;
+	};
+	return findNodesInAreaUnderAir(L, minp, maxp, filter, getNode, getSkip);
 }
 
 // spawn_tree(pos, treedef)
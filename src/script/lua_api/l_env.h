@@ -31,9 +31,11 @@ class ModApiEnvBase : public ModApiBase {
 		const std::vector<content_t> &filter, bool grouped, F &&iterate);
 
 	// F must be (v3s16 pos) -> MapNode
-	template <typename F>
+	// S must be (v3s16 pos) -> int, the number of nodes upwards from pos
+	// that can't be in the filter (usually 0)
+	template <typename F, typename S>
 	static int findNodesInAreaUnderAir(lua_State *L, v3s16 minp, v3s16 maxp,
-		const std::vector<content_t> &filter, F &&getNode);
+		const std::vector<content_t> &filter, F &&getNode, S &&getSkip);
 
 	static const EnumString es_ClearObjectsMode[];
 	static const EnumString es_BlockStatusType[];
@@ -195,7 +197,10 @@ class ModApiEnv : public ModApiEnvBase {
 	// clear all objects in the environment
 	static int l_clear_objects(lua_State *L);
 
-	// spawn_tree(pos, treedef)
+	// create_map_snapshot([name]) -> path or nil, error
+	static int l_create_map_snapshot(lua_State *L);
+
+	// spawn_tree(pos or {pos1, pos2, ...}, treedef)
 	static int l_spawn_tree(lua_State *L);
 
 	// line_of_sight(pos1, pos2) -> true/false
@@ -204,10 +209,24 @@ class ModApiEnv : public ModApiEnvBase {
 	// raycast(pos1, pos2, objects, liquids) -> Raycast
 	static int l_raycast(lua_State *L);
 
+	// line_of_sight_batch({{pos1, pos2}, ...}) -> {true or pos, ...}
+	static int l_line_of_sight_batch(lua_State *L);
+
+	// raycast_batch({{pos1, pos2}, ...}, objects, liquids, pointabilities)
+	//     -> {pointed_thing or false, ...}
+	static int l_raycast_batch(lua_State *L);
+
 	// find_path(pos1, pos2, searchdistance,
 	//     max_jump, max_drop, algorithm) -> table containing path
 	static int l_find_path(lua_State *L);
 
+	// do_find_path_async(pos1, pos2, searchdistance,
+	//     max_jump, max_drop, algorithm) -> id or nil
+	static int l_do_find_path_async(lua_State *L);
+
+	// do_cancel_find_path(id) -> true/false
+	static int l_do_cancel_find_path(lua_State *L);
+
 	// transforming_liquid_add(pos)
 	static int l_transforming_liquid_add(lua_State *L);
 
@@ -268,6 +287,12 @@ class ModApiEnvVM : public ModApiEnvBase {
 	static MMVManip *getVManip(lua_State *L);
 
 public:
+	// The searches above on the given vmanip, with the arguments from idx on.
+	// Shared with the VoxelManip methods of the same names.
+	static int findNodeNearVM(lua_State *L, MMVManip *vm, int idx);
+	static int findNodesInAreaVM(lua_State *L, MMVManip *vm, int idx);
+	static int findNodesInAreaUnderAirVM(lua_State *L, MMVManip *vm, int idx);
+
 	static void InitializeEmerge(lua_State *L, int top);
 };
 
@@ -8,10 +8,7 @@
 #include "debug.h"
 #include <chrono>
 
-typedef std::shared_lock<std::shared_mutex> SharedReadLock;
-typedef std::unique_lock<std::shared_mutex> SharedWriteLock;
-
-static inline auto read_pv(lua_State *L, int idx)
+static inline ModIPCStore::Value read_pv(lua_State *L, int idx)
 {
 	std::unique_ptr<PackedValue> ret;
 	if (!lua_isnil(L, idx)) {
@@ -28,14 +25,12 @@ int ModApiIPC::l_ipc_get(lua_State *L)
 
 	auto key = readParam<std::string>(L, 1);
 
-	{
-		SharedReadLock autolock(store->mutex);
-		auto it = store->map.find(key);
-		if (it == store->map.end())
-			lua_pushnil(L);
-		else
-			script_unpack(L, it->second.get());
-	}
+	// the value can't change anymore, so no lock is needed to unpack it
+	auto pv = store->get(key);
+	if (!pv)
+		lua_pushnil(L);
+	else
+		script_unpack(L, pv.get());
 	return 1;
 }
 
@@ -48,14 +43,8 @@ int ModApiIPC::l_ipc_set(lua_State *L)
 	luaL_checkany(L, 2);
 	auto pv = read_pv(L, 2);
 
-	{
-		SharedWriteLock autolock(store->mutex);
-		if (pv)
-			store->map[key] = std::move(pv);
-		else
-			store->map.erase(key); // delete the map value for nil
-	}
-	store->signal();
+	// delete the map value for nil
+	store->set(key, std::move(pv));
 	return 0;
 }
 
@@ -71,29 +60,22 @@ int ModApiIPC::l_ipc_cas(lua_State *L)
 	luaL_checkany(L, 3);
 	auto pv_new = read_pv(L, 3);
 
-	bool ok = false;
-	{
-		SharedWriteLock autolock(store->mutex);
+	bool ok;
+	while (true) {
 		// unpack and compare old value
-		auto it = store->map.find(key);
-		if (it == store->map.end()) {
+		auto pv_old = store->get(key);
+		if (!pv_old) {
 			ok = lua_isnil(L, idx_old);
 		} else {
-			script_unpack(L, it->second.get());
+			script_unpack(L, pv_old.get());
 			ok = lua_equal(L, idx_old, -1);
 			lua_pop(L, 1);
 		}
-		// put new value
-		if (ok) {
-			if (pv_new)
-				store->map[key] = std::move(pv_new);
-			else
-				store->map.erase(key);
-		}
+		// put new value, unless the old one was replaced in the meantime
+		if (!ok || store->replace(key, pv_old, pv_new))
+			break;
 	}
 
-	if (ok)
-		store->signal();
 	lua_pushboolean(L, ok);
 	return 1;
 }
@@ -108,15 +90,8 @@ int ModApiIPC::l_ipc_poll(lua_State *L)
 		std::max<int>(0, luaL_checkinteger(L, 2))
 	);
 
-	bool ret;
-	{
-		SharedReadLock autolock(store->mutex);
-
-		// wait until value exists or timeout
-		ret = store->condvar.wait_for(autolock, timeout, [&] () -> bool {
-			return store->map.count(key) != 0;
-		});
-	}
+	// wait until value exists or timeout
+	bool ret = store->waitFor(key, timeout);
 
 	lua_pushboolean(L, ret);
 	return 1;
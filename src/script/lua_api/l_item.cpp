@@ -151,7 +151,7 @@ int LuaItemStack::l_get_metadata(lua_State *L)
 
 	log_deprecated(L, "ItemStack:get_metadata is deprecated", 1, true);
 
-	const std::string &value = item.metadata.getString("");
+	const std::string &value = item.getMetadata().getString("");
 	lua_pushlstring(L, value.c_str(), value.size());
 	return 1;
 }
@@ -168,7 +168,7 @@ int LuaItemStack::l_set_metadata(lua_State *L)
 
 	size_t len = 0;
 	const char *ptr = luaL_checklstring(L, 2, &len);
-	item.metadata.setString("", std::string(ptr, len));
+	item.getWritableMetadata().setString("", std::string(ptr, len));
 
 	lua_pushboolean(L, true);
 	return 1;
@@ -244,12 +244,12 @@ int LuaItemStack::l_to_table(lua_State *L)
 		lua_pushinteger(L, item.wear);
 		lua_setfield(L, -2, "wear");
 
-		const std::string &metadata_str = item.metadata.getString("");
+		const std::string &metadata_str = item.getMetadata().getString("");
 		lua_pushlstring(L, metadata_str.c_str(), metadata_str.size());
 		lua_setfield(L, -2, "metadata");
 
 		lua_newtable(L);
-		const StringMap &fields = item.metadata.getStrings();
+		const StringMap &fields = item.getMetadata().getStrings();
 		for (const auto &field : fields) {
 			const std::string &name = field.first;
 			if (name.empty())
@@ -570,6 +570,13 @@ const luaL_Reg LuaItemStack::methods[] = {
 	ItemDefinition
 */
 
+// The cached definitions may be outdated, see ScriptApiItem::getNodeCallback
+static void clear_node_def_cache(lua_State *L)
+{
+	lua_pushnil(L);
+	lua_rawseti(L, LUA_REGISTRYINDEX, CUSTOM_RIDX_NODE_DEF_CACHE);
+}
+
 // register_item_raw({lots of stuff})
 int ModApiItem::l_register_item_raw(lua_State *L)
 {
@@ -615,6 +622,7 @@ int ModApiItem::l_register_item_raw(lua_State *L)
 
 	// Read the node definition (content features) and register it
 	if (def.type == ITEM_NODE) {
+		clear_node_def_cache(L);
 		ContentFeatures f;
 		read_content_features(L, f, table);
 		// when a mod reregisters ignore, only texture changes and such should
@@ -648,6 +656,7 @@ int ModApiItem::l_unregister_item_raw(lua_State *L)
 
 	// Unregister the node
 	if (idef->get(name).type == ITEM_NODE) {
+		clear_node_def_cache(L);
 		NodeDefManager *ndef =
 			getServer(L)->getWritableNodeDefManager();
 		ndef->removeNode(name);
@@ -16,12 +16,18 @@
 
 IMetadata* ItemStackMetaRef::getmeta(bool auto_create)
 {
-	return &istack->getItem().metadata;
+	ItemStack &item = istack->getItem();
+	// don't allocate metadata for stacks that have none
+	if (!auto_create && item.getMetadata().empty())
+		return nullptr;
+	return &item.getWritableMetadata();
 }
 
 void ItemStackMetaRef::clearMeta()
 {
-	istack->getItem().metadata.clear();
+	ItemStack &item = istack->getItem();
+	if (!item.getMetadata().empty())
+		item.getWritableMetadata().clear();
 }
 
 void ItemStackMetaRef::reportMetadataChange(const std::string *name)
@@ -95,6 +101,8 @@ const luaL_Reg ItemStackMetaRef::methods[] = {
 	luamethod(MetaDataRef, get_float),
 	luamethod(MetaDataRef, set_float),
 	luamethod(MetaDataRef, get_keys),
+	luamethod(MetaDataRef, get_strings),
+	luamethod(MetaDataRef, set_strings),
 	luamethod(MetaDataRef, to_table),
 	luamethod(MetaDataRef, from_table),
 	luamethod(MetaDataRef, equals),
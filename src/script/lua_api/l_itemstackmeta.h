@@ -26,22 +26,22 @@ class ItemStackMetaRef : public MetaDataRef
 
 	void setToolCapabilities(const ToolCapabilities &caps)
 	{
-		istack->getItem().metadata.setToolCapabilities(caps);
+		istack->getItem().getWritableMetadata().setToolCapabilities(caps);
 	}
 
 	void clearToolCapabilities()
 	{
-		istack->getItem().metadata.clearToolCapabilities();
+		istack->getItem().getWritableMetadata().clearToolCapabilities();
 	}
 
 	void setWearBarParams(const WearBarParams &params)
 	{
-		istack->getItem().metadata.setWearBarParams(params);
+		istack->getItem().getWritableMetadata().setWearBarParams(params);
 	}
 
 	void clearWearBarParams()
 	{
-		istack->getItem().metadata.clearWearBarParams();
+		istack->getItem().getWritableMetadata().clearWearBarParams();
 	}
 
 	// Exported functions
@@ -214,6 +214,71 @@ int MetaDataRef::l_get_keys(lua_State *L)
 	return 1;
 }
 
+// get_strings(self, {name, ...})
+int MetaDataRef::l_get_strings(lua_State *L)
+{
+	MAP_LOCK_REQUIRED;
+
+	MetaDataRef *ref = checkAnyMetadata(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+	const int count = lua_objlen(L, 2);
+
+	IMetadata *meta = ref->getmeta(false);
+
+	lua_createtable(L, count, 0);
+	// reused for every key
+	std::string name, str_;
+	for (int i = 1; i <= count; i++) {
+		if (!meta) {
+			lua_pushlstring(L, "", 0);
+			lua_rawseti(L, -2, i);
+			continue;
+		}
+		lua_rawgeti(L, 2, i);
+		name = readParam<std::string_view>(L, -1);
+		lua_pop(L, 1);
+		const std::string &str = meta->getString(name, &str_);
+		lua_pushlstring(L, str.c_str(), str.size());
+		lua_rawseti(L, -2, i);
+	}
+	return 1;
+}
+
+// set_strings(self, {name = var, ...})
+int MetaDataRef::l_set_strings(lua_State *L)
+{
+	MAP_LOCK_REQUIRED;
+
+	MetaDataRef *ref = checkAnyMetadata(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	IMetadata *meta = nullptr;
+	std::string name, changed_name;
+	u32 changed = 0;
+	lua_pushnil(L);
+	while (lua_next(L, 2) != 0) {
+		// key at index -2 and value at index -1
+		// (converting a number key would confuse lua_next)
+		if (lua_type(L, -2) != LUA_TSTRING)
+			throw LuaError("set_strings: keys must be strings");
+		name = readParam<std::string_view>(L, -2);
+		std::string_view str = readParam<std::string_view>(L, -1);
+		// only create the metadata for something to store
+		if (!meta)
+			meta = ref->getmeta(!str.empty());
+		if (meta && meta->setString(name, str)) {
+			if (changed++ == 0)
+				changed_name = name;
+		}
+		lua_pop(L, 1); // Remove value, keep key for next iteration
+	}
+
+	// a single change can be private, several are reported as public
+	if (changed > 0)
+		ref->reportMetadataChange(changed == 1 ? &changed_name : nullptr);
+	return 0;
+}
+
 // to_table(self)
 int MetaDataRef::l_to_table(lua_State *L)
 {
@@ -264,16 +329,16 @@ int MetaDataRef::l_from_table(lua_State *L)
 
 void MetaDataRef::handleToTable(lua_State *L, IMetadata *meta)
 {
-	lua_newtable(L);
 	{
 		StringMap fields_;
 		const StringMap &fields = meta->getStrings(&fields_);
+		lua_createtable(L, 0, fields.size());
 		for (const auto &field : fields) {
 			const std::string &name = field.first;
 			const std::string &value = field.second;
 			lua_pushlstring(L, name.c_str(), name.size());
 			lua_pushlstring(L, value.c_str(), value.size());
-			lua_settable(L, -3);
+			lua_rawset(L, -3);
 		}
 	}
 	lua_setfield(L, -2, "fields");
@@ -77,6 +77,12 @@ class MetaDataRef : public ModApiBase
 	// get_keys(self)
 	static int l_get_keys(lua_State *L);
 
+	// get_strings(self, {name, ...})
+	static int l_get_strings(lua_State *L);
+
+	// set_strings(self, {name = var, ...})
+	static int l_set_strings(lua_State *L);
+
 	// to_table(self)
 	static int l_to_table(lua_State *L);
 
@@ -200,6 +200,8 @@ const luaL_Reg NodeMetaRef::methodsServer[] = {
 	luamethod(MetaDataRef, get_float),
 	luamethod(MetaDataRef, set_float),
 	luamethod(MetaDataRef, get_keys),
+	luamethod(MetaDataRef, get_strings),
+	luamethod(MetaDataRef, set_strings),
 	luamethod(MetaDataRef, to_table),
 	luamethod(MetaDataRef, from_table),
 	luamethod(NodeMetaRef, get_inventory),
@@ -222,6 +224,7 @@ const luaL_Reg NodeMetaRef::methodsClient[] = {
 	luamethod(MetaDataRef, get_int),
 	luamethod(MetaDataRef, get_float),
 	luamethod(MetaDataRef, get_keys),
+	luamethod(MetaDataRef, get_strings),
 	luamethod(MetaDataRef, to_table),
 	{0,0}
 };
@@ -1864,11 +1864,11 @@ int ObjectRef::l_hud_change(lua_State *L)
 
 	HudElementStat stat;
 	void *value = nullptr;
-	bool ok = read_hud_change(L, stat, elem, &value);
+	bool changed;
+	bool ok = read_hud_change(L, stat, elem, &value, &changed);
 
-	// FIXME: only send when actually changed
-	if (ok)
-		getServer(L)->hudChange(player, id, stat, value);
+	if (ok && changed)
+		getServer(L)->hudChange(player, id, stat);
 
 	lua_pushboolean(L, ok);
 	return 1;
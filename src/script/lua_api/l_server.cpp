@@ -11,6 +11,8 @@
 #include "cpp_api/s_security.h"
 #include "scripting_server.h"
 #include "server.h"
+#include "server/memorystats.h"
+#include "server/stepphaseprofiler.h"
 #include "environment.h"
 #include "remoteplayer.h"
 #include "log.h"
@@ -28,11 +30,12 @@ int ModApiServer::l_request_shutdown(lua_State *L)
 	return 0;
 }
 
-// get_server_status()
+// get_server_status(name, joined)
 int ModApiServer::l_get_server_status(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	lua_pushstring(L, getServer(L)->getStatusString().c_str());
+	bool joined = readParam<bool>(L, 2, false);
+	lua_pushstring(L, getServer(L)->getStatusString(!joined).c_str());
 	return 1;
 }
 
@@ -53,6 +56,49 @@ int ModApiServer::l_get_server_max_lag(lua_State *L)
 	return 1;
 }
 
+// get_step_phase_stats([reset])
+int ModApiServer::l_get_step_phase_stats(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	StepPhaseProfiler *profiler = getServer(L)->getStepPhaseProfiler();
+	if (!profiler)
+		return 0;
+
+	lua_createtable(L, 0, STEP_PHASE_COUNT);
+	for (u8 i = 0; i < STEP_PHASE_COUNT; i++) {
+		const auto phase = static_cast<StepPhase>(i);
+		const StepPhaseProfiler::Stats stats = profiler->getStats(phase);
+		lua_createtable(L, 0, 5);
+		setintfield(L, -1, "count", stats.count);
+		setfloatfield(L, -1, "p50", stats.p50 / 1e6);
+		setfloatfield(L, -1, "p95", stats.p95 / 1e6);
+		setfloatfield(L, -1, "p99", stats.p99 / 1e6);
+		setfloatfield(L, -1, "max", stats.max / 1e6);
+		lua_setfield(L, -2, StepPhaseProfiler::getName(phase));
+	}
+	if (readParam<bool>(L, 1, false))
+		profiler->reset();
+	return 1;
+}
+
+// get_memory_usage()
+int ModApiServer::l_get_memory_usage(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	const MemoryStats &stats = getServer(L)->updateMemoryStats();
+
+	// as numbers, the sizes don't fit into an int
+	lua_createtable(L, 0, MEMORY_SUBSYSTEM_COUNT + 1);
+	for (u8 i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		const auto subsystem = static_cast<MemorySubsystem>(i);
+		lua_pushnumber(L, stats.get(subsystem));
+		lua_setfield(L, -2, MemoryStats::getName(subsystem));
+	}
+	lua_pushnumber(L, stats.getTotal());
+	lua_setfield(L, -2, "total");
+	return 1;
+}
+
 // print(text)
 int ModApiServer::l_print(lua_State *L)
 {
@@ -380,6 +426,31 @@ int ModApiServer::l_disconnect_player(lua_State *L)
 	return 1;
 }
 
+int ModApiServer::l_transfer_player(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	if (!getEnv(L))
+		throw LuaError("Can't transfer player before server has started up");
+
+	const char *name = luaL_checkstring(L, 1);
+	std::string address = luaL_checkstring(L, 2);
+	const lua_Integer port = luaL_checkinteger(L, 3);
+	if (address.empty() || port <= 0 || port > U16_MAX)
+		throw LuaError("Invalid server address");
+
+	Server *server = getServer(L);
+
+	RemotePlayer *player = server->getEnv().getPlayer(name);
+	if (!player) {
+		lua_pushboolean(L, false); // No such player
+		return 1;
+	}
+
+	lua_pushboolean(L, server->transferPlayer(player->getPeerId(), address, port));
+	return 1;
+}
+
 int ModApiServer::l_remove_player(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
@@ -716,6 +787,8 @@ void ModApiServer::Initialize(lua_State *L, int top)
 	API_FCT(get_server_status);
 	API_FCT(get_server_uptime);
 	API_FCT(get_server_max_lag);
+	API_FCT(get_step_phase_stats);
+	API_FCT(get_memory_usage);
 	API_FCT(get_mod_data_path);
 	API_FCT(get_worldpath);
 	API_FCT(is_singleplayer);
@@ -743,6 +816,7 @@ void ModApiServer::Initialize(lua_State *L, int top)
 	API_FCT(get_ban_description);
 	API_FCT(ban_player);
 	API_FCT(disconnect_player);
+	API_FCT(transfer_player);
 	API_FCT(remove_player);
 	API_FCT(unban_player_or_ip);
 	API_FCT(notify_authentication_modified);
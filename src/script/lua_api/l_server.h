@@ -21,6 +21,12 @@ class ModApiServer : public ModApiBase
 	// get_server_max_lag()
 	static int l_get_server_max_lag(lua_State *L);
 
+	// get_step_phase_stats([reset])
+	static int l_get_step_phase_stats(lua_State *L);
+
+	// get_memory_usage()
+	static int l_get_memory_usage(lua_State *L);
+
 	// get_worldpath()
 	static int l_get_worldpath(lua_State *L);
 
@@ -94,6 +100,9 @@ class ModApiServer : public ModApiBase
 	// disconnect_player(name[, reason[, reconnect]]) -> success
 	static int l_disconnect_player(lua_State *L);
 
+	// transfer_player(name, address, port) -> success
+	static int l_transfer_player(lua_State *L);
+
 	// remove_player(name)
 	static int l_remove_player(lua_State *L);
 
@@ -60,6 +60,8 @@ const luaL_Reg StorageRef::methods[] = {
 	luamethod(MetaDataRef, get_float),
 	luamethod(MetaDataRef, set_float),
 	luamethod(MetaDataRef, get_keys),
+	luamethod(MetaDataRef, get_strings),
+	luamethod(MetaDataRef, set_strings),
 	luamethod(MetaDataRef, to_table),
 	luamethod(MetaDataRef, from_table),
 	luamethod(MetaDataRef, equals),
@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 // Copyright (C) 2013 kwolekr, Ryan Kwolek <kwolekr@minetest.net>
 
+#include <cstddef>
 #include <map>
 #include "lua_api/l_vmanip.h"
+#include "lua_api/l_env.h"
 #include "lua_api/l_mapgen.h"
 #include "lua_api/l_internal.h"
 #include "common/c_content.h"
@@ -152,15 +154,20 @@ int LuaVoxelManip::l_write_to_map(lua_State *L)
 
 	ServerMap *map = &(env->getServerMap());
 
+	MapEditEvent event;
+	event.type = MEET_OTHER;
+
 	std::map<v3s16, MapBlock*> modified_blocks;
 	if (o->is_mapgen_vm || !update_light) {
 		o->vm->blitBackAll(&modified_blocks);
 	} else {
-		voxalgo::blit_back_with_light(map, o->vm, &modified_blocks);
+		// Clients update the lighting on their own, so the changed nodes
+		// are enough for them
+		event.changed_nodes.emplace();
+		voxalgo::blit_back_with_light(map, o->vm, &modified_blocks,
+			&*event.changed_nodes);
 	}
 
-	MapEditEvent event;
-	event.type = MEET_OTHER;
 	event.setModifiedBlocks(modified_blocks);
 	map->dispatchEvent(event);
 
@@ -190,6 +197,33 @@ int LuaVoxelManip::l_set_node_at(lua_State *L)
 	return 1;
 }
 
+// find_node_near(self, pos, radius, nodenames, [search_center])
+int LuaVoxelManip::l_find_node_near(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, 1);
+	return ModApiEnvVM::findNodeNearVM(L, o->vm, 2);
+}
+
+// find_nodes_in_area(self, minp, maxp, nodenames, [grouped])
+int LuaVoxelManip::l_find_nodes_in_area(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, 1);
+	return ModApiEnvVM::findNodesInAreaVM(L, o->vm, 2);
+}
+
+// find_nodes_in_area_under_air(self, minp, maxp, nodenames)
+int LuaVoxelManip::l_find_nodes_in_area_under_air(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, 1);
+	return ModApiEnvVM::findNodesInAreaUnderAirVM(L, o->vm, 2);
+}
+
 int LuaVoxelManip::l_update_liquids(lua_State *L)
 {
 	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, 1);
@@ -346,6 +380,57 @@ int LuaVoxelManip::l_set_param2_data(lua_State *L)
 	return 0;
 }
 
+int LuaVoxelManip::l_get_data_buffer(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer::create(L, 1, LuaVoxelManipBuffer::FIELD_CONTENT);
+	return 1;
+}
+
+int LuaVoxelManip::l_get_light_data_buffer(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer::create(L, 1, LuaVoxelManipBuffer::FIELD_PARAM1);
+	return 1;
+}
+
+int LuaVoxelManip::l_get_param2_data_buffer(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer::create(L, 1, LuaVoxelManipBuffer::FIELD_PARAM2);
+	return 1;
+}
+
+// The layout is part of the API, see get_data_pointer() in lua_api.md
+static_assert(sizeof(MapNode) == 4 && offsetof(MapNode, param1) == 2 &&
+	offsetof(MapNode, param2) == 3, "Unexpected MapNode layout");
+
+int LuaVoxelManip::l_get_data_pointer(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, 1);
+	MMVManip *vm = o->vm;
+	const u32 volume = vm->m_area.getVolume();
+	if (volume == 0)
+		return 0;
+
+	// The caller can't see the flags, so make every node valid like
+	// set_data() would. Nodes without data become ignore, which isn't
+	// written back to the map.
+	for (u32 i = 0; i != volume; i++) {
+		if (vm->m_flags[i] & VOXELFLAG_NO_DATA)
+			vm->m_data[i] = MapNode(CONTENT_IGNORE);
+	}
+	vm->clearFlags(vm->m_area, VOXELFLAG_NO_DATA);
+
+	lua_pushlightuserdata(L, vm->m_data);
+	return 1;
+}
+
 int LuaVoxelManip::l_update_map(lua_State *L)
 {
 	return 0;
@@ -478,6 +563,8 @@ void LuaVoxelManip::Register(lua_State *L)
 	lua_register(L, className, create_object);
 
 	script_register_packer(L, className, packIn, packOut);
+
+	LuaVoxelManipBuffer::Register(L);
 }
 
 const char LuaVoxelManip::className[] = "VoxelManip";
@@ -488,6 +575,9 @@ const luaL_Reg LuaVoxelManip::methods[] = {
 	luamethod(LuaVoxelManip, set_data),
 	luamethod(LuaVoxelManip, get_node_at),
 	luamethod(LuaVoxelManip, set_node_at),
+	luamethod(LuaVoxelManip, find_node_near),
+	luamethod(LuaVoxelManip, find_nodes_in_area),
+	luamethod(LuaVoxelManip, find_nodes_in_area_under_air),
 	luamethod(LuaVoxelManip, write_to_map),
 	luamethod(LuaVoxelManip, update_map),
 	luamethod(LuaVoxelManip, update_liquids),
@@ -497,8 +587,140 @@ const luaL_Reg LuaVoxelManip::methods[] = {
 	luamethod(LuaVoxelManip, set_light_data),
 	luamethod(LuaVoxelManip, get_param2_data),
 	luamethod(LuaVoxelManip, set_param2_data),
+	luamethod(LuaVoxelManip, get_data_buffer),
+	luamethod(LuaVoxelManip, get_light_data_buffer),
+	luamethod(LuaVoxelManip, get_param2_data_buffer),
+	luamethod(LuaVoxelManip, get_data_pointer),
 	luamethod(LuaVoxelManip, was_modified),
 	luamethod(LuaVoxelManip, get_emerged_area),
 	luamethod(LuaVoxelManip, close),
 	{0,0}
 };
+
+/*
+	LuaVoxelManipBuffer
+*/
+
+LuaVoxelManipBuffer::LuaVoxelManipBuffer(LuaVoxelManip *o, int vm_ref, Field field) :
+	m_vm_obj(o),
+	m_vm_ref(vm_ref),
+	m_field(field)
+{
+}
+
+void LuaVoxelManipBuffer::create(lua_State *L, int idx, Field field)
+{
+	if (idx < 0)
+		idx = lua_gettop(L) + idx + 1;
+	LuaVoxelManip *o = checkObject<LuaVoxelManip>(L, idx);
+
+	lua_pushvalue(L, idx);
+	int vm_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	auto *buf = new LuaVoxelManipBuffer(o, vm_ref, field);
+	*(void **)(lua_newuserdata(L, sizeof(void *))) = buf;
+	luaL_getmetatable(L, className);
+	lua_setmetatable(L, -2);
+}
+
+u32 LuaVoxelManipBuffer::checkIndex(lua_State *L, const MMVManip *vm, int idx)
+{
+	// The volume is checked on every access, the VoxelManip may be
+	// re-initialized while the buffer exists.
+	lua_Integer i = luaL_checkinteger(L, idx);
+	if (i < 1 || i > (lua_Integer)vm->m_area.getVolume())
+		throw LuaError("VoxelManipBuffer index " + std::to_string(i) +
+			" out of range");
+	return i - 1;
+}
+
+int LuaVoxelManipBuffer::gc_object(lua_State *L)
+{
+	LuaVoxelManipBuffer *o = *(LuaVoxelManipBuffer **)(lua_touserdata(L, 1));
+	luaL_unref(L, LUA_REGISTRYINDEX, o->m_vm_ref);
+	delete o;
+
+	return 0;
+}
+
+int LuaVoxelManipBuffer::mt_index(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer *o = checkObject<LuaVoxelManipBuffer>(L, 1);
+	const MMVManip *vm = o->m_vm_obj->vm;
+	u32 i = checkIndex(L, vm, 2);
+
+	// Do not push unintialized data to Lua, same as get_data() and co.
+	bool no_data = vm->m_flags[i] & VOXELFLAG_NO_DATA;
+	const MapNode &n = vm->m_data[i];
+	switch (o->m_field) {
+	case FIELD_CONTENT:
+		lua_pushinteger(L, no_data ? CONTENT_IGNORE : n.getContent());
+		break;
+	case FIELD_PARAM1:
+		lua_pushinteger(L, no_data ? 0 : n.getParam1());
+		break;
+	case FIELD_PARAM2:
+		lua_pushinteger(L, no_data ? 0 : n.getParam2());
+		break;
+	}
+	return 1;
+}
+
+int LuaVoxelManipBuffer::mt_newindex(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer *o = checkObject<LuaVoxelManipBuffer>(L, 1);
+	MMVManip *vm = o->m_vm_obj->vm;
+	u32 i = checkIndex(L, vm, 2);
+	lua_Integer value = luaL_checkinteger(L, 3);
+
+	MapNode &n = vm->m_data[i];
+	switch (o->m_field) {
+	case FIELD_CONTENT:
+		n.setContent(value);
+		// like set_data(), the node has data now
+		vm->m_flags[i] &= ~VOXELFLAG_NO_DATA;
+		break;
+	case FIELD_PARAM1:
+		n.param1 = value;
+		break;
+	case FIELD_PARAM2:
+		n.param2 = value;
+		break;
+	}
+	return 0;
+}
+
+int LuaVoxelManipBuffer::mt_len(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	LuaVoxelManipBuffer *o = checkObject<LuaVoxelManipBuffer>(L, 1);
+	lua_pushinteger(L, o->m_vm_obj->vm->m_area.getVolume());
+	return 1;
+}
+
+void LuaVoxelManipBuffer::Register(lua_State *L)
+{
+	static const luaL_Reg metamethods[] = {
+		{"__gc", gc_object},
+		{"__len", mt_len},
+		{"__newindex", mt_newindex},
+		{0, 0}
+	};
+	registerClass<LuaVoxelManipBuffer>(L, methods, metamethods);
+
+	// Indexing goes to the nodes, there are no methods
+	luaL_getmetatable(L, className);
+	lua_pushcfunction(L, mt_index);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+}
+
+const char LuaVoxelManipBuffer::className[] = "VoxelManipBuffer";
+const luaL_Reg LuaVoxelManipBuffer::methods[] = {
+	{0,0}
+};
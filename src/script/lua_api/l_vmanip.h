@@ -32,6 +32,10 @@ class LuaVoxelManip : public ModApiBase
 	static int l_get_node_at(lua_State *L);
 	static int l_set_node_at(lua_State *L);
 
+	static int l_find_node_near(lua_State *L);
+	static int l_find_nodes_in_area(lua_State *L);
+	static int l_find_nodes_in_area_under_air(lua_State *L);
+
 	static int l_update_map(lua_State *L);
 	static int l_update_liquids(lua_State *L);
 
@@ -43,6 +47,11 @@ class LuaVoxelManip : public ModApiBase
 	static int l_get_param2_data(lua_State *L);
 	static int l_set_param2_data(lua_State *L);
 
+	static int l_get_data_buffer(lua_State *L);
+	static int l_get_light_data_buffer(lua_State *L);
+	static int l_get_param2_data_buffer(lua_State *L);
+	static int l_get_data_pointer(lua_State *L);
+
 	static int l_was_modified(lua_State *L);
 	static int l_get_emerged_area(lua_State *L);
 
@@ -68,3 +77,42 @@ class LuaVoxelManip : public ModApiBase
 
 	static const char className[];
 };
+
+/*
+  VoxelManipBuffer: indexes one field of the nodes of a VoxelManip directly,
+  without copying them into a table
+ */
+class LuaVoxelManipBuffer : public ModApiBase
+{
+public:
+	enum Field : u8 {
+		FIELD_CONTENT,
+		FIELD_PARAM1,
+		FIELD_PARAM2,
+	};
+
+	LuaVoxelManipBuffer(LuaVoxelManip *o, int vm_ref, Field field);
+
+	// Creates a buffer on the VoxelManip at idx and leaves it on top of stack
+	static void create(lua_State *L, int idx, Field field);
+
+	static void Register(lua_State *L);
+
+	static const char className[];
+
+private:
+	LuaVoxelManip *m_vm_obj;
+	// registry reference that keeps the VoxelManip alive
+	int m_vm_ref;
+	Field m_field;
+
+	static const luaL_Reg methods[];
+
+	// Checks that the key at idx is a valid index, returns it zero-based
+	static u32 checkIndex(lua_State *L, const MMVManip *vm, int idx);
+
+	static int gc_object(lua_State *L);
+	static int mt_index(lua_State *L);
+	static int mt_newindex(lua_State *L);
+	static int mt_len(lua_State *L);
+};
@@ -50,6 +50,9 @@ class ServerScripting:
 	u32 queueAsync(std::string &&serialized_func,
 		PackedValue *param, const std::string &mod_origin);
 
+	// Lua heap sizes of the async threads, see AsyncEngine::getMemoryUsage()
+	size_t getAsyncMemoryUsage() const { return asyncEngine.getMemoryUsage(); }
+
 protected:
 	// from ScriptApiSecurity:
 	bool checkPathInternal(const std::string &abs_path, bool write_required,
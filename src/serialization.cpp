@@ -8,6 +8,7 @@
 
 #include <zlib.h>
 #include <zstd.h>
+#include <zdict.h>
 #include <memory>
 
 /* report a zlib or i/o error */
@@ -186,13 +187,61 @@ struct ZSTD_Deleter {
 	}
 };
 
-void compressZstd(const u8 *data, size_t data_size, std::ostream &os, int level)
+ZstdDictionary::ZstdDictionary(std::string_view data, int level) :
+	m_data(data)
+{
+	m_id = ZDICT_getDictID(m_data.data(), m_data.size());
+	if (m_id == 0)
+		throw SerializationError("ZstdDictionary: invalid dictionary");
+	m_cdict = ZSTD_createCDict(m_data.data(), m_data.size(), level);
+	m_ddict = ZSTD_createDDict(m_data.data(), m_data.size());
+	if (!m_cdict || !m_ddict) {
+		ZSTD_freeCDict(m_cdict);
+		ZSTD_freeDDict(m_ddict);
+		throw SerializationError("ZstdDictionary: failed to load dictionary");
+	}
+}
+
+ZstdDictionary::~ZstdDictionary()
+{
+	ZSTD_freeCDict(m_cdict);
+	ZSTD_freeDDict(m_ddict);
+}
+
+std::string ZstdDictionary::train(const std::vector<std::string> &samples, size_t max_size)
+{
+	std::string buf;
+	std::vector<size_t> sizes;
+	sizes.reserve(samples.size());
+	for (const std::string &sample : samples) {
+		buf.append(sample);
+		sizes.push_back(sample.size());
+	}
+
+	std::string dict(max_size, '\0');
+	size_t ret = ZDICT_trainFromBuffer(&dict[0], dict.size(),
+		buf.data(), sizes.data(), sizes.size());
+	if (ZDICT_isError(ret)) {
+		infostream << "ZstdDictionary::train(): " << ZDICT_getErrorName(ret) << std::endl;
+		return "";
+	}
+	dict.resize(ret);
+	return dict;
+}
+
+void compressZstd(const u8 *data, size_t data_size, std::ostream &os, int level,
+	const ZstdDictionary *dict)
 {
 	// reusing the context is recommended for performance
 	// it will be destroyed when the thread ends
 	thread_local std::unique_ptr<ZSTD_CStream, ZSTD_Deleter> stream(ZSTD_createCStream());
 
-	ZSTD_initCStream(stream.get(), level);
+	if (dict) {
+		ZSTD_CCtx_reset(stream.get(), ZSTD_reset_session_only);
+		ZSTD_CCtx_refCDict(stream.get(), dict->m_cdict);
+	} else {
+		ZSTD_initCStream(stream.get(), level);
+	}
 
 	const size_t bufsize = 16384;
 	char output_buffer[bufsize];
@@ -227,7 +276,7 @@ void compressZstd(const u8 *data, size_t data_size, std::ostream &os, int level)
 
 }
 
-void decompressZstd(std::istream &is, std::ostream &os)
+void decompressZstd(std::istream &is, std::ostream &os, const ZstdDictionary *dict)
 {
 	// reusing the context is recommended for performance
 	// it will be destroyed when the thread ends
@@ -241,6 +290,19 @@ void decompressZstd(std::istream &is, std::ostream &os)
 
 	ZSTD_outBuffer output = { output_buffer, bufsize, 0 };
 	ZSTD_inBuffer input = { input_buffer, 0, 0 };
+
+	// Check which dictionary the frame was compressed with, if any
+	is.read(input_buffer, bufsize);
+	input.size = is.gcount();
+	if (input.size == 0)
+		throw SerializationError("decompressZstd: data ended too early");
+	const u32 dict_id = ZSTD_getDictID_fromFrame(input_buffer, input.size);
+	if (dict_id != 0) {
+		if (!dict || dict->getId() != dict_id)
+			throw SerializationError("decompressZstd: data needs unknown dictionary");
+		ZSTD_DCtx_refDDict(stream.get(), dict->m_ddict);
+	}
+
 	size_t ret;
 	do
 	{
@@ -272,12 +334,77 @@ void decompressZstd(std::istream &is, std::ostream &os)
 	}
 }
 
-void compress(const u8 *data, u32 size, std::ostream &os, u8 version, int level)
+ZstdStreamCompressor::ZstdStreamCompressor(int level, int window_log)
+{
+	m_stream = ZSTD_createCCtx();
+	if (!m_stream)
+		throw SerializationError("ZstdStreamCompressor: out of memory");
+	ZSTD_CCtx_setParameter(m_stream, ZSTD_c_compressionLevel, level);
+	ZSTD_CCtx_setParameter(m_stream, ZSTD_c_windowLog, window_log);
+}
+
+ZstdStreamCompressor::~ZstdStreamCompressor()
+{
+	ZSTD_freeCCtx(m_stream);
+}
+
+void ZstdStreamCompressor::compress(std::string_view data, std::string &out)
+{
+	char output_buffer[4096];
+	ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+
+	size_t ret;
+	do {
+		ZSTD_outBuffer output = { output_buffer, sizeof(output_buffer), 0 };
+		ret = ZSTD_compressStream2(m_stream, &output, &input, ZSTD_e_flush);
+		if (ZSTD_isError(ret)) {
+			dstream << ZSTD_getErrorName(ret) << std::endl;
+			throw SerializationError("ZstdStreamCompressor: failed");
+		}
+		out.append(output_buffer, output.pos);
+	} while (ret != 0);
+}
+
+ZstdStreamDecompressor::ZstdStreamDecompressor(int window_log)
+{
+	m_stream = ZSTD_createDCtx();
+	if (!m_stream)
+		throw SerializationError("ZstdStreamDecompressor: out of memory");
+	// Refuse streams that would need more memory than agreed on
+	ZSTD_DCtx_setParameter(m_stream, ZSTD_d_windowLogMax, window_log);
+}
+
+ZstdStreamDecompressor::~ZstdStreamDecompressor()
+{
+	ZSTD_freeDCtx(m_stream);
+}
+
+void ZstdStreamDecompressor::decompress(std::string_view data, std::string &out)
+{
+	char output_buffer[4096];
+	ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+
+	// The message was flushed, so everything is there once the input is
+	// used up and the output buffer wasn't filled
+	for (;;) {
+		ZSTD_outBuffer output = { output_buffer, sizeof(output_buffer), 0 };
+		size_t ret = ZSTD_decompressStream(m_stream, &output, &input);
+		if (ZSTD_isError(ret))
+			throw SerializationError(std::string("ZstdStreamDecompressor: ") +
+				ZSTD_getErrorName(ret));
+		out.append(output_buffer, output.pos);
+		if (input.pos == input.size && output.pos < output.size)
+			break;
+	}
+}
+
+void compress(const u8 *data, u32 size, std::ostream &os, u8 version, int level,
+	const ZstdDictionary *dict)
 {
 	if(version >= 29)
 	{
 		// map the zlib levels [0,9] to [1,10]. -1 becomes 0 which indicates the default (currently 3)
-		compressZstd(data, size, os, level + 1);
+		compressZstd(data, size, os, level + 1, dict);
 		return;
 	}
 
@@ -322,11 +449,12 @@ void compress(const u8 *data, u32 size, std::ostream &os, u8 version, int level)
 	os.write((char*)&current_byte, 1);
 }
 
-void decompress(std::istream &is, std::ostream &os, u8 version)
+void decompress(std::istream &is, std::ostream &os, u8 version,
+	const ZstdDictionary *dict)
 {
 	if(version >= 29)
 	{
-		decompressZstd(is, os);
+		decompressZstd(is, os, dict);
 		return;
 	}
 
@@ -6,8 +6,12 @@
 
 #include "irrlichttypes.h"
 #include "exceptions.h"
+#include "util/basic_macros.h"
 #include <iostream>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 
 /*
 	Map format serialization version
@@ -85,17 +89,104 @@ inline void compressZlib(std::string_view data, std::ostream &os, int level = -1
 }
 void decompressZlib(std::istream &is, std::ostream &os, size_t limit = 0);
 
-void compressZstd(const u8 *data, size_t data_size, std::ostream &os, int level = 0);
-inline void compressZstd(std::string_view data, std::ostream &os, int level = 0)
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+/*
+	A trained zstd dictionary, shared by many small inputs of the same kind.
+
+	The dictionary ID is stored in every frame compressed with it, so
+	decompressZstd() can tell which dictionary it needs.
+	Thread-safe after construction.
+*/
+class ZstdDictionary
 {
-	compressZstd(reinterpret_cast<const u8*>(data.data()), data.size(), os, level);
+public:
+	// Throws SerializationError if data is not a valid dictionary
+	ZstdDictionary(std::string_view data, int level = 0);
+	~ZstdDictionary();
+
+	u32 getId() const { return m_id; }
+	const std::string &getData() const { return m_data; }
+
+	// Trains a dictionary of at most max_size bytes.
+	// Returns an empty string if there isn't enough sample data.
+	static std::string train(const std::vector<std::string> &samples, size_t max_size);
+
+private:
+	friend void compressZstd(const u8 *, size_t, std::ostream &, int,
+		const ZstdDictionary *);
+	friend void decompressZstd(std::istream &, std::ostream &,
+		const ZstdDictionary *);
+
+	std::string m_data;
+	u32 m_id;
+	ZSTD_CDict_s *m_cdict;
+	ZSTD_DDict_s *m_ddict;
+};
+
+// If a dictionary is given, level is ignored in favor of the dictionary's
+void compressZstd(const u8 *data, size_t data_size, std::ostream &os, int level = 0,
+	const ZstdDictionary *dict = nullptr);
+inline void compressZstd(std::string_view data, std::ostream &os, int level = 0,
+	const ZstdDictionary *dict = nullptr)
+{
+	compressZstd(reinterpret_cast<const u8*>(data.data()), data.size(), os, level, dict);
 }
-void decompressZstd(std::istream &is, std::ostream &os);
+// Throws SerializationError if the data needs a dictionary other than dict
+void decompressZstd(std::istream &is, std::ostream &os,
+	const ZstdDictionary *dict = nullptr);
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+/*
+	A zstd stream carrying a sequence of messages, e.g. network packets.
+
+	Each message is flushed on its own, so it can be decompressed as soon as
+	it arrives, but it may refer back to the earlier ones. This makes small
+	and repetitive messages compress well. The messages must be decompressed
+	in the order they were compressed in, by one ZstdStreamDecompressor.
+*/
+class ZstdStreamCompressor
+{
+public:
+	// window_log limits the memory both sides need for the stream
+	ZstdStreamCompressor(int level, int window_log);
+	~ZstdStreamCompressor();
+	DISABLE_CLASS_COPY(ZstdStreamCompressor);
+
+	// Appends the compressed message to out
+	void compress(std::string_view data, std::string &out);
+
+private:
+	ZSTD_CCtx_s *m_stream;
+};
+
+class ZstdStreamDecompressor
+{
+public:
+	ZstdStreamDecompressor(int window_log);
+	~ZstdStreamDecompressor();
+	DISABLE_CLASS_COPY(ZstdStreamDecompressor);
+
+	// Appends the decompressed message to out.
+	// Throws SerializationError if the data is broken, the stream can't be
+	// used anymore then.
+	void decompress(std::string_view data, std::string &out);
+
+private:
+	ZSTD_DCtx_s *m_stream;
+};
 
-// These choose between zstd, zlib and a self-made one according to version
-void compress(const u8 *data, u32 size, std::ostream &os, u8 version, int level = -1);
-inline void compress(std::string_view data, std::ostream &os, u8 version, int level = -1)
+// These choose between zstd, zlib and a self-made one according to version.
+// The dictionary is only used with zstd.
+void compress(const u8 *data, u32 size, std::ostream &os, u8 version, int level = -1,
+	const ZstdDictionary *dict = nullptr);
+inline void compress(std::string_view data, std::ostream &os, u8 version, int level = -1,
+	const ZstdDictionary *dict = nullptr)
 {
-	compress(reinterpret_cast<const u8*>(data.data()), data.size(), os, version, level);
+	compress(reinterpret_cast<const u8*>(data.data()), data.size(), os, version, level, dict);
 }
-void decompress(std::istream &is, std::ostream &os, u8 version);
+void decompress(std::istream &is, std::ostream &os, u8 version,
+	const ZstdDictionary *dict = nullptr);
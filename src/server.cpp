@@ -6,6 +6,7 @@
 #include <iostream>
 #include <queue>
 #include <algorithm>
+#include <set>
 #include "irr_v2d.h"
 #include "network/connection.h"
 #include "network/networkpacket.h"
@@ -15,6 +16,7 @@
 #include "environment.h"
 #include "servermap.h"
 #include "threading/mutex_auto_lock.h"
+#include "threading/workerpool.h"
 #include "constants.h"
 #include "voxel.h"
 #include "config.h"
@@ -53,6 +55,10 @@
 #include "remoteplayer.h"
 #include "server/player_sao.h"
 #include "server/serverinventorymgr.h"
+#include "server/memorystats.h"
+#include "server/stepphaseprofiler.h"
+#include "server/packetrecord.h"
+#include "server/mediahasher.h"
 #include "translation.h"
 #include "database/database-sqlite3.h"
 #if USE_POSTGRESQL
@@ -60,6 +66,7 @@
 #endif
 #include "database/database-files.h"
 #include "database/database-dummy.h"
+#include "database/database-cache.h"
 #include "gameparams.h"
 #include "particles.h"
 #include "gettext.h"
@@ -67,6 +74,9 @@
 
 #include <csignal>
 
+// Logins whose SRP verifier may be computed at the same time, more are refused
+static constexpr size_t MAX_SRP_LOGINS_IN_PROGRESS = 64;
+
 class ClientNotFoundException : public BaseException
 {
 public:
@@ -78,12 +88,78 @@ class ClientNotFoundException : public BaseException
 ModIPCStore::~ModIPCStore()
 {
 	// we don't have to do this, it's pure debugging aid
-	if (!std::unique_lock(mutex, std::try_to_lock).owns_lock()) {
-		errorstream << FUNCTION_NAME << ": lock is still in use!" << std::endl;
-		assert(0);
+	for (Shard &shard : m_shards) {
+		if (!std::unique_lock(shard.mutex, std::try_to_lock).owns_lock()) {
+			errorstream << FUNCTION_NAME << ": lock is still in use!" << std::endl;
+			assert(0);
+		}
 	}
 }
 
+ModIPCStore::Value ModIPCStore::get(const std::string &key)
+{
+	Shard &shard = getShard(key);
+	std::shared_lock lock(shard.mutex);
+	auto it = shard.map.find(key);
+	return it == shard.map.end() ? nullptr : it->second;
+}
+
+void ModIPCStore::set(const std::string &key, Value value)
+{
+	Shard &shard = getShard(key);
+	std::unique_lock lock(shard.mutex);
+	if (!value) {
+		shard.map.erase(key);
+		return;
+	}
+	shard.map[key] = std::move(value);
+	signal(shard, lock);
+}
+
+bool ModIPCStore::replace(const std::string &key, const Value &expected,
+	const Value &value)
+{
+	Shard &shard = getShard(key);
+	std::unique_lock lock(shard.mutex);
+	auto it = shard.map.find(key);
+	if ((it == shard.map.end() ? nullptr : it->second) != expected)
+		return false;
+	if (!value) {
+		if (it != shard.map.end())
+			shard.map.erase(it);
+		return true;
+	}
+	if (it != shard.map.end())
+		it->second = value;
+	else
+		shard.map.emplace(key, value);
+	signal(shard, lock);
+	return true;
+}
+
+bool ModIPCStore::waitFor(const std::string &key, std::chrono::milliseconds timeout)
+{
+	Shard &shard = getShard(key);
+	std::shared_lock lock(shard.mutex);
+	if (shard.map.count(key) != 0)
+		return true;
+	// counted while holding the lock, so that signal() can't miss us
+	shard.waiters++;
+	bool ret = shard.condvar.wait_for(lock, timeout, [&] () -> bool {
+		return shard.map.count(key) != 0;
+	});
+	shard.waiters--;
+	return ret;
+}
+
+void ModIPCStore::signal(Shard &shard, std::unique_lock<std::shared_mutex> &lock)
+{
+	bool notify = shard.waiters.load() > 0;
+	lock.unlock();
+	if (notify)
+		shard.condvar.notify_all();
+}
+
 class ServerThread : public Thread
 {
 public:
@@ -142,6 +218,9 @@ void *ServerThread::run()
 
 			m_server->AsyncRunStep(step_settings.pause ? 0.0f : dtime);
 
+			m_server->collectLuaGarbage(step_settings.steplen
+					- 1e-6f * (porting::getTimeUs() - t0));
+
 			const float remaining_time = step_settings.steplen
 					- 1e-6f * (porting::getTimeUs() - t0);
 			m_server->Receive(remaining_time);
@@ -261,7 +340,8 @@ Server::Server(
 		Address bind_addr,
 		bool dedicated,
 		ChatInterface *iface,
-		std::string *shutdown_errmsg
+		std::string *shutdown_errmsg,
+		std::shared_ptr<con::IConnection> connection
 	):
 	m_bind_addr(bind_addr),
 	m_path_world(path_world),
@@ -269,7 +349,8 @@ Server::Server(
 	m_simple_singleplayer_mode(simple_singleplayer_mode),
 	m_dedicated(dedicated),
 	m_async_fatal_error(""),
-	m_con(con::createMTP(CONNECTION_TIMEOUT, m_bind_addr.isIPv6(), this)),
+	m_con(connection ? std::move(connection) : std::shared_ptr<con::IConnection>(
+		con::createMTP(CONNECTION_TIMEOUT, m_bind_addr.isIPv6(), this))),
 	m_itemdef(createItemDefManager()),
 	m_nodedef(createNodeDefManager()),
 	m_craftdef(createCraftDefManager()),
@@ -327,6 +408,25 @@ Server::Server(
 			"minetest_core_map_edit_events",
 			"Number of map edit events");
 
+	m_buffer_heap_counter = m_metrics_backend->addCounter(
+			"minetest_core_buffer_allocations",
+			"Number of packet buffers allocated", {{"type", "heap"}});
+	m_buffer_reused_counter = m_metrics_backend->addCounter(
+			"minetest_core_buffer_allocations",
+			"Number of packet buffers allocated", {{"type", "reused"}});
+	m_buffer_pool_stats = bufferpool::getStats();
+
+	m_blockdata_bytes_counter[0] = m_metrics_backend->addCounter(
+			"minetest_core_blockdata_serialized_bytes",
+			"Size of blocks serialized for sending", {{"type", "uncompressed"}});
+	m_blockdata_bytes_counter[1] = m_metrics_backend->addCounter(
+			"minetest_core_blockdata_serialized_bytes",
+			"Size of blocks serialized for sending", {{"type", "compressed"}});
+
+	m_step_phase_profiler = std::make_unique<StepPhaseProfiler>(m_metrics_backend.get());
+	m_memory_stats = std::make_unique<MemoryStats>(m_metrics_backend.get());
+	m_env_lock_stats = std::make_unique<EnvLockStats>(m_metrics_backend.get());
+
 	m_lag_gauge->set(g_settings->getFloat("dedicated_server_step"));
 
 	m_path_mod_data = porting::path_user + DIR_DELIM "mod_data";
@@ -334,6 +434,32 @@ Server::Server(
 		throw ServerError("Failed to create mod data dir");
 }
 
+Server::EnvAutoLock::EnvAutoLock(Server *server, EnvLockSite site) :
+	m_stats(server->m_env_lock_stats.get()),
+	m_site(site),
+	m_lock(server->m_env_mutex, std::defer_lock)
+{
+	if (!m_stats) {
+		m_lock.lock();
+		return;
+	}
+
+	const u64 start_us = porting::getTimeUs();
+	if (!m_lock.try_lock()) {
+		m_stats->startWaiting();
+		m_lock.lock();
+		m_stats->stopWaiting();
+	}
+	m_locked_us = porting::getTimeUs();
+	m_wait_us = m_locked_us - start_us;
+}
+
+Server::EnvAutoLock::~EnvAutoLock()
+{
+	if (m_stats)
+		m_stats->record(m_site, m_wait_us, porting::getTimeUs() - m_locked_us);
+}
+
 Server::~Server()
 {
 	// Send shutdown message
@@ -431,8 +557,47 @@ Server::~Server()
 	}
 }
 
+namespace {
+
+// Logs how long the phases of the server startup took
+class StartupTimer
+{
+public:
+	StartupTimer() : m_start_us(porting::getTimeUs()), m_phase_start_us(m_start_us) {}
+
+	// Ends the current phase
+	void phase(const char *name)
+	{
+		const u64 now = porting::getTimeUs();
+		m_phases.emplace_back(name, now - m_phase_start_us);
+		m_phase_start_us = now;
+	}
+
+	void log() const
+	{
+		std::ostringstream os;
+		os << "Server: initialized in " << (porting::getTimeUs() - m_start_us) / 1000
+			<< " ms (";
+		for (size_t i = 0; i < m_phases.size(); i++) {
+			os << (i > 0 ? ", " : "") << m_phases[i].first << ": "
+				<< m_phases[i].second / 1000 << " ms";
+		}
+		os << ")";
+		actionstream << os.str() << std::endl;
+	}
+
+private:
+	const u64 m_start_us;
+	u64 m_phase_start_us;
+	std::vector<std::pair<const char *, u64>> m_phases;
+};
+
+}
+
 void Server::init()
 {
+	StartupTimer timer;
+
 	infostream << "Server created for gameid \"" << m_gamespec.id << "\"";
 	if (m_simple_singleplayer_mode)
 		infostream << " in simple singleplayer mode" << std::endl;
@@ -471,6 +636,12 @@ void Server::init()
 		throw ServerError(error);
 	}
 
+	// Read Textures and calculate sha1 sums, the jobs are waited for if
+	// anything below throws
+	MediaHasher media_hasher(m_path_world + DIR_DELIM + "media_hashes.txt");
+	startMediaHashing(media_hasher);
+	timer.phase("world");
+
 	//lock environment
 	EnvAutoLock envlock(this);
 
@@ -484,24 +655,29 @@ void Server::init()
 			"Failed to initialize the map database. The world may be "
 			"corrupted or in an unsupported format.\n") + e.what());
 	}
+	timer.phase("map");
 
 	// Initialize scripting
 	infostream << "Server: Initializing Lua" << std::endl;
 
 	m_script = std::make_unique<ServerScripting>(this);
+	m_script->setGarbageCollectorParams(g_settings->getS32("lua_gc_pause"),
+		g_settings->getS32("lua_gc_stepmul"));
 
 	// Must be created before mod loading because we have some inventory creation
 	m_inventory_mgr = std::make_unique<ServerInventoryManager>();
 
 	m_script->loadBuiltin();
+	timer.phase("builtin");
 
 	m_gamespec.checkAndLog();
 	m_modmgr->loadMods(*m_script);
 
 	m_script->saveGlobals();
+	timer.phase("mods");
 
-	// Read Textures and calculate sha1 sums
-	fillMediaCache();
+	fillMediaCache(media_hasher);
+	timer.phase("media");
 
 	// Apply item aliases in the node definition manager
 	m_nodedef->updateAliases(m_itemdef);
@@ -526,6 +702,7 @@ void Server::init()
 
 	// init the recipe hashes to speed up crafting
 	m_craftdef->initHashes(this);
+	timer.phase("definitions");
 
 	// Initialize Environment
 	m_env = new ServerEnvironment(std::move(startup_server_map),
@@ -556,6 +733,7 @@ void Server::init()
 	servermap.addEventReceiver(this);
 
 	m_env->loadMeta();
+	timer.phase("environment");
 
 	// Those settings can be overwritten in world.mt, they are
 	// intended to be cached after environment loading.
@@ -563,6 +741,31 @@ void Server::init()
 	m_max_chatmessage_length = g_settings->getU16("chat_message_max_size");
 	m_csm_restriction_flags = g_settings->getU64("csm_restriction_flags");
 	m_csm_restriction_noderange = g_settings->getU32("csm_restriction_noderange");
+
+	m_max_ephemeral_sounds_per_step = g_settings->getU32("max_ephemeral_sounds_per_step");
+	m_ephemeral_sound_coalesce_time =
+		std::max(g_settings->getFloat("ephemeral_sound_coalesce_time"), 0.0f);
+
+	u32 block_send_cache_size = g_settings->getU32("block_send_cache_size");
+	if (block_send_cache_size > 0) {
+		m_block_send_cache = std::make_unique<SerializedBlockCache>(
+			(size_t)block_send_cache_size * 1024 * 1024);
+	}
+
+	m_srp_pool = std::make_unique<SrpVerifierPool>(MAX_SRP_LOGINS_IN_PROGRESS);
+
+	u16 block_serialize_threads = g_settings->getU16("block_serialize_threads");
+	if (block_serialize_threads > 0) {
+		m_block_serialize_pool = std::make_unique<WorkerPool>("BlockSerialize",
+			block_serialize_threads);
+	}
+
+	// Prepare the definitions for clients of the current version, so that
+	// joining doesn't have to
+	getDefinitionPayload(m_itemdef, LATEST_PROTOCOL_VERSION, true);
+	getDefinitionPayload(m_nodedef, LATEST_PROTOCOL_VERSION, true);
+	timer.phase("payloads");
+	timer.log();
 }
 
 void Server::start()
@@ -577,6 +780,18 @@ void Server::start()
 	// Initialize connection
 	m_con->Serve(m_bind_addr);
 
+	if (g_settings->getBool("packet_decode_async")) {
+		m_packet_decoder = std::make_unique<PacketDecodeThread>(m_con.get());
+		m_packet_decoder->start();
+	}
+
+	const std::string record_path = g_settings->get("packet_record_file");
+	if (!record_path.empty()) {
+		m_packet_recorder = std::make_unique<PacketRecorder>(record_path);
+		if (!m_packet_recorder->isOpen())
+			m_packet_recorder.reset();
+	}
+
 	// Start thread
 	m_thread->start();
 
@@ -611,7 +826,11 @@ void Server::stop()
 
 	// Stop threads (set run=false first so both start stopping)
 	m_thread->stop();
+	if (m_packet_decoder)
+		m_packet_decoder->stop();
 	m_thread->wait();
+	if (m_packet_decoder)
+		m_packet_decoder->wait();
 
 	infostream<<"Server: Threads stopped"<<std::endl;
 }
@@ -630,6 +849,126 @@ void Server::step()
 	}
 }
 
+namespace {
+
+// Layout of AO_CMD_UPDATE_POSITION, see UnitSAO::generateUpdatePositionCommand()
+constexpr size_t AOM_POSITION_OFFSET = 1;
+constexpr size_t AOM_VELOCITY_OFFSET = 13;
+constexpr size_t AOM_ACCELERATION_OFFSET = 25;
+constexpr size_t AOM_ROTATION_OFFSET = 37;
+constexpr size_t AOM_INTERPOLATE_OFFSET = 49;
+constexpr size_t AOM_END_POSITION_OFFSET = 50;
+constexpr size_t AOM_UPDATE_INTERVAL_OFFSET = 51;
+constexpr size_t AOM_UPDATE_POSITION_SIZE = 55;
+
+// Maximum factor by which position updates are slowed down
+constexpr float MAX_OBJECT_UPDATE_SCALE = 8.0f;
+
+/*
+	By how much position updates of an object can be slowed down for a
+	player, based on the position and velocity contained in the update.
+	Returns 1 for objects that should get every update.
+*/
+float get_object_update_scale(const std::string &aom, PlayerSAO *player,
+	float full_rate_distance)
+{
+	if (aom.size() < AOM_UPDATE_POSITION_SIZE)
+		return 1.0f;
+	const u8 *data = reinterpret_cast<const u8 *>(aom.data());
+
+	v3f camera_pos = player->getEyePosition();
+	v3f rel = readV3F32(data + AOM_POSITION_OFFSET) - camera_pos;
+	float d = rel.getLength() / BS;
+	if (d <= full_rate_distance)
+		return 1.0f;
+	float scale = d / full_rate_distance;
+
+	v3f camera_dir = v3f(0, 0, 1);
+	camera_dir.rotateYZBy(player->getLookPitch());
+	camera_dir.rotateXZBy(player->getRotation().Y);
+	if (player->getCameraInverted())
+		camera_dir = -camera_dir;
+	if (rel.dotProduct(camera_dir) < 0)
+		scale *= 2.0f;
+
+	// Fast objects stray from their predicted path sooner
+	float speed = readV3F32(data + AOM_VELOCITY_OFFSET).getLength() / BS;
+	scale /= 1.0f + speed / 10.0f;
+
+	return rangelim(scale, 1.0f, MAX_OBJECT_UPDATE_SCALE);
+}
+
+// Appends an object message to the data of a TOCLIENT_ACTIVE_OBJECT_MESSAGES
+void append_ao_message(std::string &buffer, u16 id, const std::string &data)
+{
+	char idbuf[2];
+	writeU16((u8*) idbuf, id);
+	// u16 id
+	// std::string data
+	buffer.append(idbuf, sizeof(idbuf));
+	buffer.append(serializeString16(data));
+}
+
+template <typename T>
+T quantize(f32 value, f32 scale)
+{
+	return (T)std::clamp<f64>(std::round((f64)value * scale),
+		std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+}
+
+u16 quantize_degrees(f32 degrees)
+{
+	return (u16)(u32)std::lround(wrapDegrees_0_360(degrees) * (65536.0f / 360.0f));
+}
+
+/*
+	Appends an AO_CMD_UPDATE_POSITION to the data of a
+	TOCLIENT_OBJECT_MOVEMENT. Returns false for other messages.
+*/
+bool append_movement(std::string &buffer, u16 id, const std::string &aom)
+{
+	if (aom.size() != AOM_UPDATE_POSITION_SIZE || aom[0] != AO_CMD_UPDATE_POSITION)
+		return false;
+	const u8 *data = reinterpret_cast<const u8 *>(aom.data());
+
+	const v3f position = readV3F32(data + AOM_POSITION_OFFSET);
+	const v3f velocity = readV3F32(data + AOM_VELOCITY_OFFSET);
+	const v3f acceleration = readV3F32(data + AOM_ACCELERATION_OFFSET);
+	const v3f rotation = readV3F32(data + AOM_ROTATION_OFFSET);
+	u8 flags = 0;
+	if (data[AOM_INTERPOLATE_OFFSET])
+		flags |= MOVEMENT_INTERPOLATE;
+	if (data[AOM_END_POSITION_OFFSET])
+		flags |= MOVEMENT_END_POSITION;
+	if (acceleration != v3f())
+		flags |= MOVEMENT_ACCELERATION;
+
+	u8 buf[2 + 1 + 12 + 6 + 6 + 6 + 2];
+	u8 *p = buf;
+	writeU16(p, id); p += 2;
+	writeU8(p, flags); p += 1;
+	for (f32 v : {position.X, position.Y, position.Z}) {
+		writeS32(p, quantize<s32>(v, 100.0f)); p += 4;
+	}
+	for (f32 v : {velocity.X, velocity.Y, velocity.Z}) {
+		writeS16(p, quantize<s16>(v, MOVEMENT_SPEED_SCALE)); p += 2;
+	}
+	if (flags & MOVEMENT_ACCELERATION) {
+		for (f32 v : {acceleration.X, acceleration.Y, acceleration.Z}) {
+			writeS16(p, quantize<s16>(v, MOVEMENT_SPEED_SCALE)); p += 2;
+		}
+	}
+	for (f32 v : {rotation.X, rotation.Y, rotation.Z}) {
+		writeU16(p, quantize_degrees(v)); p += 2;
+	}
+	writeU16(p, quantize<u16>(readF32(data + AOM_UPDATE_INTERVAL_OFFSET), 1000.0f));
+	p += 2;
+	buffer.append(reinterpret_cast<char *>(buf), p - buf);
+	return true;
+}
+
+}
+
 void Server::AsyncRunStep(float dtime, bool initial_step)
 {
 	ZoneScoped;
@@ -640,6 +979,20 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		return;
 	}
 
+	if (!initial_step) {
+		m_step_count++;
+		if (m_packet_recorder)
+			m_packet_recorder->flush();
+	}
+
+	{
+		// Answer the logins whose SRP verifiers were computed
+		std::vector<SrpVerifierPool::Result> srp_results;
+		m_srp_pool->take(srp_results);
+		for (auto &result : srp_results)
+			finishSrpBytesA(result);
+	}
+
 	{
 		// Send blocks to clients
 		SendBlocks(dtime);
@@ -650,12 +1003,16 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		return;
 
 	ScopeProfiler sp(g_profiler, "Server::AsyncRunStep()", SPT_AVG);
+	StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+		STEP_PHASE_SERVER_STEP);
 
 	/*
 		Update uptime
 	*/
 	m_uptime_counter->increment(dtime);
 
+	m_env_lock_stats->flush();
+
 	/*
 		Update time of day and overall game time
 	*/
@@ -677,7 +1034,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	}
 
 	{
-		EnvAutoLock lock(this);
+		EnvAutoLock lock(this, ENV_LOCK_STEP);
 		float max_lag = m_env->getMaxLagEstimate();
 		constexpr float lag_warn_threshold = 1.0f;
 
@@ -703,19 +1060,28 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 
 		m_env->reportMaxLagEstimate(max_lag);
 
+		checkPlayerMovements();
+		stepEphemeralSounds();
+
 		// Step environment
 		m_env->step(dtime);
+
+		sendHudChanges();
 	}
 
 	static const float map_timer_and_unload_dtime = 2.92;
 	if(m_map_timer_and_unload_interval.step(dtime, map_timer_and_unload_dtime))
 	{
-		EnvAutoLock lock(this);
+		EnvAutoLock lock(this, ENV_LOCK_STEP);
 		// Run Map's timers and unload unused data
 		ScopeProfiler sp(g_profiler, "Server: map timer and unload");
+		StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+			STEP_PHASE_MAP_TIMERS);
 		m_env->getMap().timerUpdate(map_timer_and_unload_dtime,
 			std::max(g_settings->getFloat("server_unload_unused_data_timeout"), 0.0f),
 			-1);
+		m_env->getServerMap().compactIdleBlocks();
+		updateMemoryStats();
 	}
 
 	/*
@@ -728,7 +1094,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	*/
 	if (m_admin_chat) {
 		if (!m_admin_chat->command_queue.empty()) {
-			EnvAutoLock lock(this);
+			EnvAutoLock lock(this, ENV_LOCK_STEP);
 			while (!m_admin_chat->command_queue.empty()) {
 				ChatEvent *evt = m_admin_chat->command_queue.pop_frontNoEx();
 				handleChatInterfaceEvent(evt);
@@ -749,18 +1115,23 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	{
 		m_liquid_transform_timer -= m_liquid_transform_every;
 
-		EnvAutoLock lock(this);
+		EnvAutoLock lock(this, ENV_LOCK_STEP);
 
 		ScopeProfiler sp(g_profiler, "Server: liquid transform");
+		StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+			STEP_PHASE_LIQUIDS);
 
 		std::map<v3s16, MapBlock*> modified_blocks;
-		m_env->getServerMap().transformLiquids(modified_blocks, m_env);
+		std::unordered_map<v3s16, BlockNodeChanges> changed_nodes;
+		m_env->getServerMap().transformLiquids(modified_blocks, m_env,
+			&changed_nodes);
 
 		if (!modified_blocks.empty()) {
 			MapEditEvent event;
 			event.type = MEET_OTHER;
 			event.low_priority = true;
 			event.setModifiedBlocks(modified_blocks);
+			event.changed_nodes = std::move(changed_nodes);
 			m_env->getMap().dispatchEvent(event);
 		}
 	}
@@ -773,6 +1144,18 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		m_lag_gauge->increment(dtime/100);
 	}
 
+	{
+		// Buffer allocations of all threads since the last step
+		const bufferpool::Stats stats = bufferpool::getStats();
+		const u64 heap = stats.heap_allocations - m_buffer_pool_stats.heap_allocations;
+		const u64 reused = stats.reused - m_buffer_pool_stats.reused;
+		m_buffer_pool_stats = stats;
+		g_profiler->avg("Server: buffers from heap per step", heap);
+		g_profiler->avg("Server: buffers reused per step", reused);
+		m_buffer_heap_counter->increment(heap);
+		m_buffer_reused_counter->increment(reused);
+	}
+
 	{
 		float &counter = m_step_pending_dyn_media_timer;
 		counter += dtime;
@@ -782,6 +1165,17 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		}
 	}
 
+	{
+		float &counter = m_peer_metrics_timer;
+		counter += dtime;
+		if (counter >= 1.0f) {
+			updatePeerMetrics();
+			updateSendMetrics();
+			updateModTimeMetrics();
+			counter = 0;
+		}
+	}
+
 
 #if USE_CURL
 	// send masterserver announce
@@ -811,7 +1205,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	*/
 	{
 		//infostream<<"Server: Checking added and deleted active objects"<<std::endl;
-		EnvAutoLock envlock(this);
+		EnvAutoLock envlock(this, ENV_LOCK_STEP);
 
 		// This guarantees that each object recomputes its cache only once per server step,
 		// unless get_effective_observers is called.
@@ -823,6 +1217,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			ClientInterface::AutoLock clientlock(m_clients);
 			const RemoteClientMap &clients = m_clients.getClientList();
 			ScopeProfiler sp(g_profiler, "Server: update objects within range");
+			StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+				STEP_PHASE_SEND_OBJECTS);
 
 			m_player_gauge->set(clients.size());
 			for (const auto &client_it : clients) {
@@ -856,8 +1252,10 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		Send object messages
 	*/
 	{
-		EnvAutoLock envlock(this);
+		EnvAutoLock envlock(this, ENV_LOCK_STEP);
 		ScopeProfiler sp(g_profiler, "Server: send SAO messages");
+		StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+			STEP_PHASE_SEND_OBJECT_MESSAGES);
 
 		// Key = object id
 		// Value = data sent by object
@@ -889,15 +1287,20 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		m_aom_buffer_counter[1]->increment(count_unreliable);
 
 		{
+			const float full_rate_distance = m_active_object_full_rate_distance.get();
+			const float send_interval = m_env->getSendRecommendedInterval();
+
 			ClientInterface::AutoLock clientlock(m_clients);
 			const RemoteClientMap &clients = m_clients.getClientList();
 			// Route data to every client
-			std::string reliable_data, unreliable_data;
+			std::string reliable_data, unreliable_data, movement_data;
 			for (const auto &client_it : clients) {
 				reliable_data.clear();
 				unreliable_data.clear();
+				movement_data.clear();
 				RemoteClient *client = client_it.second;
 				PlayerSAO *player = getPlayerSAO(client->peer_id);
+				const bool compact_movement = client->net_proto_version >= 49;
 				// Go through all objects in message buffer
 				for (const auto &buffered_message : buffered_messages) {
 					// If object does not exist or is not known by client, skip it
@@ -912,7 +1315,7 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 					for (const ActiveObjectMessage &aom : *list) {
 						// Send position updates to players who do not see the attachment
 						if (aom.datastring[0] == AO_CMD_UPDATE_POSITION) {
-							if (sao->getId() == player->getId())
+							if (!player || sao->getId() == player->getId())
 								continue;
 
 							// Do not send position updates for attached players
@@ -923,16 +1326,65 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 								continue;
 						}
 
+						// Far away objects only get every few updates, the
+						// latest one is kept until it's time to send it
+						if (aom.priority == ActiveObjectMessage::PRIO_STATE &&
+								full_rate_distance > 0 && player &&
+								get_object_update_scale(aom.datastring, player,
+									full_rate_distance) > 1.0f) {
+							auto [it, inserted] = client->m_object_updates.try_emplace(id);
+							// The first update after a pause is sent right away
+							if (inserted)
+								it->second.timer = MAX_OBJECT_UPDATE_SCALE * send_interval;
+							it->second.pending = aom.datastring;
+							continue;
+						}
+						if (aom.priority == ActiveObjectMessage::PRIO_STATE) {
+							auto it = client->m_object_updates.find(id);
+							if (it != client->m_object_updates.end()) {
+								it->second.timer = 0;
+								it->second.pending.clear();
+							}
+						}
+
+						if (!aom.reliable && compact_movement &&
+								append_movement(movement_data, aom.id, aom.datastring))
+							continue;
+
 						// Add full new data to appropriate buffer
 						std::string &buffer = aom.reliable ? reliable_data : unreliable_data;
-						char idbuf[2];
-						writeU16((u8*) idbuf, aom.id);
-						// u16 id
-						// std::string data
-						buffer.append(idbuf, sizeof(idbuf));
-						buffer.append(serializeString16(aom.datastring));
+						append_ao_message(buffer, aom.id, aom.datastring);
 					}
 				}
+
+				// Send delayed updates that are due
+				for (auto it = client->m_object_updates.begin();
+						it != client->m_object_updates.end();) {
+					auto &state = it->second;
+					state.timer += dtime;
+					if (state.pending.empty()) {
+						// Forget objects that weren't updated for a while
+						if (state.timer > MAX_OBJECT_UPDATE_SCALE * 2 * send_interval)
+							it = client->m_object_updates.erase(it);
+						else
+							++it;
+						continue;
+					}
+					const float scale = player ? get_object_update_scale(
+						state.pending, player, full_rate_distance) : 1.0f;
+					if (state.timer + 0.5f * dtime >= scale * send_interval) {
+						// Let the client interpolate for as long as it takes
+						// until the next update
+						writeF32(reinterpret_cast<u8 *>(&state.pending[
+							AOM_UPDATE_INTERVAL_OFFSET]), scale * send_interval);
+						if (!compact_movement ||
+								!append_movement(movement_data, it->first, state.pending))
+							append_ao_message(unreliable_data, it->first, state.pending);
+						state.timer = 0;
+						state.pending.clear();
+					}
+					++it;
+				}
 				/*
 					reliable_data and unreliable_data are now ready.
 					Send them.
@@ -944,6 +1396,16 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 				if (!unreliable_data.empty()) {
 					SendActiveObjectMessages(client->peer_id, unreliable_data, false);
 				}
+
+				if (!movement_data.empty()) {
+					if (++client->m_object_movement_seq == 0)
+						client->m_object_movement_seq = 1;
+					NetworkPacket pkt(TOCLIENT_OBJECT_MOVEMENT,
+						2 + movement_data.size(), client->peer_id);
+					pkt << client->m_object_movement_seq;
+					pkt.putRawString(movement_data);
+					Send(&pkt);
+				}
 			}
 		}
 
@@ -958,7 +1420,9 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	*/
 	{
 		// We will be accessing the environment
-		EnvAutoLock lock(this);
+		EnvAutoLock lock(this, ENV_LOCK_STEP);
+		StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+			STEP_PHASE_MAP_EVENTS);
 
 		// Single change sending is disabled if queue size is big
 		bool disable_single_change_sending = false;
@@ -974,6 +1438,21 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		size_t block_count = 0;
 		std::unordered_set<v3s16> node_meta_updates;
 
+		// Changes that are sent per block
+		std::unordered_map<v3s16, BlockNodeChanges> node_changes;
+		std::vector<v3s16> light_blocks;
+		bool node_changes_low_priority = true;
+		auto add_node_change = [&] (const MapEditEvent *event, bool remove_metadata) {
+			const v3s16 blockpos = getNodeBlockPos(event->p);
+			node_changes[blockpos].add(BlockNodeChanges::getIndex(
+				event->p - blockpos * MAP_BLOCKSIZE), remove_metadata);
+			for (v3s16 p : event->modified_blocks) {
+				if (p != blockpos)
+					light_blocks.push_back(p);
+			}
+			node_changes_low_priority &= event->low_priority;
+		};
+
 		while (!m_unsent_map_edit_queue.empty()) {
 			MapEditEvent* event = m_unsent_map_edit_queue.front();
 			m_unsent_map_edit_queue.pop();
@@ -987,14 +1466,18 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			case MEET_ADDNODE:
 			case MEET_SWAPNODE:
 				prof.add("MEET_ADDNODE", 1);
-				sendAddNode(event->p, event->n, &far_players,
-						disable_single_change_sending ? 5 : 30,
-						event->type == MEET_ADDNODE);
+				if (disable_single_change_sending)
+					add_node_change(event, event->type == MEET_ADDNODE);
+				else
+					sendAddNode(event->p, event->n, &far_players, 30,
+							event->type == MEET_ADDNODE);
 				break;
 			case MEET_REMOVENODE:
 				prof.add("MEET_REMOVENODE", 1);
-				sendRemoveNode(event->p, &far_players,
-						disable_single_change_sending ? 5 : 30);
+				if (disable_single_change_sending)
+					add_node_change(event, true);
+				else
+					sendRemoveNode(event->p, &far_players, 30);
 				break;
 			case MEET_BLOCK_NODE_METADATA_CHANGED: {
 				prof.add("MEET_BLOCK_NODE_METADATA_CHANGED", 1);
@@ -1011,7 +1494,18 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			}
 			case MEET_OTHER:
 				prof.add("MEET_OTHER", 1);
-				m_clients.markBlocksNotSent(event->modified_blocks, event->low_priority);
+				if (!event->changed_nodes) {
+					m_clients.markBlocksNotSent(event->modified_blocks, event->low_priority);
+					break;
+				}
+				for (v3s16 p : event->modified_blocks) {
+					auto it = event->changed_nodes->find(p);
+					if (it == event->changed_nodes->end())
+						light_blocks.push_back(p);
+					else
+						node_changes[p].add(it->second);
+				}
+				node_changes_low_priority &= event->low_priority;
 				break;
 			default:
 				prof.add("unknown", 1);
@@ -1039,9 +1533,19 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			prof.print(verbosestream);
 		}
 
+		if (!node_changes.empty()) {
+			sendNodeChanges(node_changes, light_blocks, node_changes_low_priority);
+		} else if (!light_blocks.empty()) {
+			m_clients.markBlocksNotSent(light_blocks, node_changes_low_priority);
+		}
+
 		// Send all metadata updates
 		if (!node_meta_updates.empty())
 			sendMetadataChanged(node_meta_updates);
+
+		// The map edit events of these blocks are handled by now, so they
+		// won't be marked as not sent again
+		sendEmergedBlocks();
 	}
 
 	/*
@@ -1062,11 +1566,10 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	{
 		float &counter = m_savemap_timer;
 		counter += dtime;
-		static thread_local const float save_interval =
-			g_settings->getFloat("server_map_save_interval");
+		const float save_interval = m_server_map_save_interval.get();
 		if (counter >= save_interval) {
 			counter = 0.0;
-			EnvAutoLock lock(this);
+			EnvAutoLock lock(this, ENV_LOCK_MAP_SAVE);
 
 			ScopeProfiler sp(g_profiler, "Server: map saving (sum)");
 
@@ -1087,6 +1590,9 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	}
 
 	m_shutdown_state.tick(dtime, this);
+
+	// Send the small packets of this step
+	m_clients.flushBundles();
 }
 
 void Server::Receive(float min_time)
@@ -1101,9 +1607,11 @@ void Server::Receive(float min_time)
 	};
 
 	NetworkPacket pkt;
+	PacketDecodeThread::Item item;
 	session_t peer_id;
 	for (;;) {
 		pkt.clear();
+		item = PacketDecodeThread::Item();
 		peer_id = 0;
 		try {
 			// Round up since the target step length is the minimum step length,
@@ -1111,7 +1619,10 @@ void Server::Receive(float min_time)
 			// by calling ReceiveTimeoutMs(.., 0) repeatedly.
 			const u32 cur_timeout_ms = std::ceil(remaining_time_us() / 1000.0f);
 
-			if (!m_con->ReceiveTimeoutMs(&pkt, cur_timeout_ms)) {
+			const bool received = m_packet_decoder ?
+				m_packet_decoder->pop(item, cur_timeout_ms) :
+				m_con->ReceiveTimeoutMs(&pkt, cur_timeout_ms);
+			if (!received) {
 				// No incoming data.
 				if (remaining_time_us() > 0.0f)
 					continue;
@@ -1119,9 +1630,26 @@ void Server::Receive(float min_time)
 					break;
 			}
 
-			peer_id = pkt.getPeerId();
+			switch (item.type) {
+			case PacketDecodeThread::Item::PEER_ADDED:
+				handlePeerAdded(item.peer_id);
+				continue;
+			case PacketDecodeThread::Item::PEER_REMOVED:
+				handlePeerRemoved(item.peer_id, item.timeout);
+				continue;
+			case PacketDecodeThread::Item::BIND_FAILED:
+				throw con::ConnectionBindFailed(item.error.c_str());
+			default:
+				break;
+			}
+
+			NetworkPacket *cur_pkt = item.pkt ? item.pkt.get() : &pkt;
+			peer_id = cur_pkt->getPeerId();
 			m_packet_recv_counter->increment();
-			ProcessData(&pkt);
+			if (m_packet_recorder)
+				m_packet_recorder->packet(m_step_count, *cur_pkt);
+			ProcessData(cur_pkt, item.pkt ? &item.cmd : nullptr);
+			m_clients.flushBundles();
 			m_packet_recv_processed_counter->increment();
 		} catch (const con::InvalidIncomingDataException &e) {
 			infostream << "Server::Receive(): InvalidIncomingDataException: what()="
@@ -1139,6 +1667,24 @@ void Server::Receive(float min_time)
 			infostream << "Server: ClientNotFoundException" << std::endl;
 		}
 	}
+
+	if (m_packet_decoder) {
+		g_profiler->avg("Server: decoded packets queued",
+			m_packet_decoder->getQueueSize());
+	}
+}
+
+void Server::collectLuaGarbage(float idle_time)
+{
+	const float fraction = g_settings->getFloat("lua_gc_idle_fraction", 0.0f, 1.0f);
+	if (fraction <= 0.0f || idle_time <= 0.0f || !m_script)
+		return;
+
+	ScopeProfiler sp(g_profiler, "Server: Lua GC in idle time", SPT_AVG);
+	StepPhaseProfiler::Scope sp_phase(m_step_phase_profiler.get(),
+		STEP_PHASE_LUA_GC);
+	EnvAutoLock lock(this, ENV_LOCK_STEP);
+	m_script->stepGarbageCollector(idle_time * fraction * 1e6f);
 }
 
 void Server::yieldToOtherThreads(float dtime)
@@ -1270,18 +1816,35 @@ PlayerSAO *Server::StageTwoClientInit(session_t peer_id)
 	return playersao;
 }
 
-inline void Server::handleCommand(NetworkPacket *pkt)
+inline void Server::handleCommand(NetworkPacket *pkt, const DecodedCommand *cmd)
 {
+	if (cmd && !cmd->empty()) {
+		if (!cmd->error.empty())
+			throw PacketError(cmd->error);
+
+		const session_t peer_id = pkt->getPeerId();
+		if (auto *got = std::get_if<DecodedGotBlocks>(&cmd->data))
+			return handleCommand_GotBlocks(peer_id, *got);
+		if (auto *interact = std::get_if<DecodedInteract>(&cmd->data))
+			return handleCommand_Interact(pkt, *interact);
+		if (auto *fields = std::get_if<DecodedNodeMetaFields>(&cmd->data))
+			return handleCommand_NodeMetaFields(peer_id, *fields);
+		if (auto *fields = std::get_if<DecodedInventoryFields>(&cmd->data))
+			return handleCommand_InventoryFields(peer_id, *fields);
+	}
+
 	const ToServerCommandHandler &opHandle = toServerCommandTable[pkt->getCommand()];
 	(this->*opHandle.handler)(pkt);
 }
 
-void Server::ProcessData(NetworkPacket *pkt)
+void Server::ProcessData(NetworkPacket *pkt, const DecodedCommand *cmd)
 {
 	// Environment is locked first.
-	EnvAutoLock envlock(this);
+	EnvAutoLock envlock(this, ENV_LOCK_PACKETS);
 
-	ScopeProfiler sp(g_profiler, "Server: Process network packet (sum)");
+	static const ProfilerKey prof_key("Server: Process network packet (sum)",
+		SPT_ADD, PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, prof_key);
 	u32 peer_id = pkt->getPeerId();
 
 	try {
@@ -1295,7 +1858,7 @@ void Server::ProcessData(NetworkPacket *pkt)
 		}
 
 		if (toServerCommandTable[command].state == TOSERVER_STATE_NOT_CONNECTED) {
-			handleCommand(pkt);
+			handleCommand(pkt, cmd);
 			return;
 		}
 
@@ -1310,7 +1873,7 @@ void Server::ProcessData(NetworkPacket *pkt)
 
 		/* Handle commands related to client startup */
 		if (toServerCommandTable[command].state == TOSERVER_STATE_STARTUP) {
-			handleCommand(pkt);
+			handleCommand(pkt, cmd);
 			return;
 		}
 
@@ -1322,7 +1885,7 @@ void Server::ProcessData(NetworkPacket *pkt)
 			return;
 		}
 
-		handleCommand(pkt);
+		handleCommand(pkt, cmd);
 	} catch (SendFailedException &e) {
 		errorstream << "Server::ProcessData(): SendFailedException: "
 				<< "what=" << e.what()
@@ -1348,20 +1911,102 @@ void Server::onMapEditEvent(const MapEditEvent &event)
 	m_unsent_map_edit_queue.push(new MapEditEvent(event));
 }
 
-void Server::peerAdded(con::IPeer *peer)
+u64 Server::replay(ReplayConnection &con, float dtime, volatile std::sig_atomic_t &kill)
 {
-	verbosestream << "Server::peerAdded(): id=" << peer->id << std::endl;
+	sanity_check(m_con.get() == &con);
+
+	init();
+	m_con->Serve(m_bind_addr);
+	AsyncRunStep(0.0f, true);
+
+	PacketRecord record;
+	while (!kill && !con.isFinished()) {
+		// Throws if there was an error
+		step();
+		AsyncRunStep(dtime);
+
+		while (con.pop(m_step_count, record)) {
+			switch (record.type) {
+			case PacketRecord::PEER_ADDED:
+				handlePeerAdded(record.peer_id);
+				continue;
+			case PacketRecord::PEER_REMOVED:
+				handlePeerRemoved(record.peer_id, record.timeout);
+				continue;
+			case PacketRecord::PACKET:
+				break;
+			}
+
+			NetworkPacket pkt;
+			record.toPacket(pkt);
+			try {
+				ProcessData(&pkt);
+				m_clients.flushBundles();
+			} catch (const SerializationError &e) {
+				infostream << "Server::replay(): SerializationError: what()="
+						<< e.what() << std::endl;
+			} catch (const ClientStateError &e) {
+				errorstream << "ClientStateError: peer=" << record.peer_id
+						<< " what()=" << e.what() << std::endl;
+				DenyAccess(record.peer_id, SERVER_ACCESSDENIED_UNEXPECTED_DATA);
+			} catch (con::PeerNotFoundException &e) {
+				infostream << "Server: PeerNotFoundException" << std::endl;
+			} catch (ClientNotFoundException &e) {
+				infostream << "Server: ClientNotFoundException" << std::endl;
+			}
+		}
+	}
+	step();
+	return m_step_count;
+}
 
-	m_clients.CreateClient(peer->id);
+void Server::peerAdded(con::IPeer *peer)
+{
+	// Keep the order with the packets that are already queued
+	if (m_packet_decoder) {
+		m_packet_decoder->pushPeerEvent(PacketDecodeThread::Item::PEER_ADDED,
+			peer->id, false);
+		return;
+	}
+	handlePeerAdded(peer->id);
 }
 
 void Server::deletingPeer(con::IPeer *peer, bool timeout)
 {
-	verbosestream << "Server::deletingPeer(): id=" << peer->id
+	if (m_packet_decoder) {
+		m_packet_decoder->pushPeerEvent(PacketDecodeThread::Item::PEER_REMOVED,
+			peer->id, timeout);
+		return;
+	}
+	handlePeerRemoved(peer->id, timeout);
+}
+
+void Server::handlePeerAdded(session_t peer_id)
+{
+	verbosestream << "Server::peerAdded(): id=" << peer_id << std::endl;
+
+	if (m_packet_recorder) {
+		Address address;
+		try {
+			address = m_con->GetPeerAddress(peer_id);
+		} catch (con::PeerNotFoundException &e) {
+		}
+		m_packet_recorder->peerAdded(m_step_count, peer_id, address);
+	}
+
+	m_clients.CreateClient(peer_id);
+}
+
+void Server::handlePeerRemoved(session_t peer_id, bool timeout)
+{
+	verbosestream << "Server::deletingPeer(): id=" << peer_id
 		<< ", timeout=" << timeout << std::endl;
 
-	m_clients.event(peer->id, CSE_Disconnect);
-	DeleteClient(peer->id, timeout ? CDR_TIMEOUT : CDR_LEAVE);
+	if (m_packet_recorder)
+		m_packet_recorder->peerRemoved(m_step_count, peer_id, timeout);
+
+	m_clients.event(peer_id, CSE_Disconnect);
+	DeleteClient(peer_id, timeout ? CDR_TIMEOUT : CDR_LEAVE);
 }
 
 bool Server::getClientConInfo(session_t peer_id, con::rtt_stat_type type, float* retval)
@@ -1487,24 +2132,48 @@ void Server::SendAccessDenied(session_t peer_id, AccessDeniedCode reason,
 	Send(&pkt);
 }
 
-void Server::SendItemDef(session_t peer_id,
-		IItemDefManager *itemdef, u16 protocol_version)
+template <typename T>
+const std::string &Server::getDefinitionPayload(T *defs, u16 protocol_version,
+	bool zstd)
 {
-	auto *client = m_clients.getClientNoEx(peer_id, CS_Created);
-	assert(client);
-
-	NetworkPacket pkt(TOCLIENT_ITEMDEF, 0, peer_id);
+	const u32 counter = defs->getModificationCounter();
+	for (auto it = m_definition_payloads.begin(); it != m_definition_payloads.end();) {
+		if (it->defs != defs) {
+			++it;
+		} else if (it->modification_counter != counter) {
+			// Definitions were changed at runtime
+			it = m_definition_payloads.erase(it);
+		} else if (it->protocol_version == protocol_version && it->zstd == zstd) {
+			return it->data;
+		} else {
+			++it;
+		}
+	}
 
+	ScopeProfiler sp(g_profiler, "Server: serialize definitions", SPT_AVG);
 	std::ostringstream tmp_os2(std::ios::binary);
 	{
 		std::ostringstream tmp_os(std::ios::binary);
-		itemdef->serialize(tmp_os, protocol_version);
-		if (client->net_proto_version >= 48)
+		defs->serialize(tmp_os, protocol_version);
+		if (zstd)
 			compressZstd(tmp_os.str(), tmp_os2);
 		else
 			compressZlib(tmp_os.str(), tmp_os2);
 	}
-	pkt.putLongString(tmp_os2.str());
+	m_definition_payloads.push_back({defs, protocol_version, zstd, counter,
+		tmp_os2.str()});
+	return m_definition_payloads.back().data;
+}
+
+void Server::SendItemDef(session_t peer_id,
+		IItemDefManager *itemdef, u16 protocol_version)
+{
+	auto *client = m_clients.getClientNoEx(peer_id, CS_Created);
+	assert(client);
+
+	NetworkPacket pkt(TOCLIENT_ITEMDEF, 0, peer_id);
+	pkt.putLongString(getDefinitionPayload(itemdef, protocol_version,
+		client->net_proto_version >= 48));
 
 	// Make data buffer
 	verbosestream << "Server: Sending item definitions to id(" << peer_id
@@ -1520,17 +2189,8 @@ void Server::SendNodeDef(session_t peer_id,
 	assert(client);
 
 	NetworkPacket pkt(TOCLIENT_NODEDEF, 0, peer_id);
-
-	std::ostringstream tmp_os2(std::ios::binary);
-	{
-		std::ostringstream tmp_os(std::ios::binary);
-		nodedef->serialize(tmp_os, protocol_version);
-		if (client->net_proto_version >= 48)
-			compressZstd(tmp_os.str(), tmp_os2);
-		else
-			compressZlib(tmp_os.str(), tmp_os2);
-	}
-	pkt.putLongString(tmp_os2.str());
+	pkt.putLongString(getDefinitionPayload(nodedef, protocol_version,
+		client->net_proto_version >= 48));
 
 	// Make data buffer
 	verbosestream << "Server: Sending node definitions to id(" << peer_id
@@ -1559,7 +2219,7 @@ void Server::SendInventory(RemotePlayer *player, bool incremental)
 	std::ostringstream os(std::ios::binary);
 	player->inventory.serialize(os, incremental);
 	player->inventory.setModified(false);
-	player->setModified(true);
+	player->setInventoryDirty();
 
 	pkt.putRawString(os.str());
 	Send(&pkt);
@@ -1584,6 +2244,38 @@ void Server::SendChatMessage(session_t peer_id, const ChatMessage &message)
 void Server::SendShowFormspecMessage(session_t peer_id, const std::string &formspec,
 	const std::string &formname)
 {
+	// Forms that are shown again, usually after a small change, are sent as delta
+	auto last = m_last_sent_formspecs.find(peer_id);
+	if (!formspec.empty() && last != m_last_sent_formspecs.end() &&
+			last->second.first == formname &&
+			m_clients.getProtocolVersion(peer_id) >= 49) {
+		const std::string &old = last->second.second;
+		const size_t max_len = std::min(old.size(), formspec.size());
+		size_t prefix_len = 0;
+		while (prefix_len < max_len && old[prefix_len] == formspec[prefix_len])
+			prefix_len++;
+		size_t suffix_len = 0;
+		while (suffix_len < max_len - prefix_len &&
+				old[old.size() - 1 - suffix_len] == formspec[formspec.size() - 1 - suffix_len])
+			suffix_len++;
+
+		if (prefix_len + suffix_len >= 64) {
+			NetworkPacket pkt(TOCLIENT_SHOW_FORMSPEC_DELTA, 0, peer_id);
+			pkt << formname << (u32)prefix_len << (u32)suffix_len;
+			pkt.putLongString(std::string_view(formspec).substr(prefix_len,
+				formspec.size() - prefix_len - suffix_len));
+			Send(&pkt);
+			last->second.second = formspec;
+			m_formspec_state_data[peer_id] = formname;
+			return;
+		}
+	}
+
+	if (formspec.empty())
+		m_last_sent_formspecs.erase(peer_id);
+	else
+		m_last_sent_formspecs[peer_id] = {formname, formspec};
+
 	NetworkPacket pkt(TOCLIENT_SHOW_FORMSPEC, 0, peer_id);
 	if (formspec.empty()){
 		// The client should close the formspec
@@ -1608,13 +2300,21 @@ void Server::SendShowFormspecMessage(session_t peer_id, const std::string &forms
 void Server::SendSpawnParticle(session_t peer_id, u16 protocol_version,
 	const ParticleParameters &p)
 {
-	static thread_local const float radius =
-			g_settings->getS16("max_block_send_distance") * MAP_BLOCKSIZE * BS;
+	const float radius = m_max_block_send_distance.get() * MAP_BLOCKSIZE * BS;
+
+	// NetworkPacket and iostreams are incompatible...
+	const auto serialize = [&p] (u16 protocol_version) {
+		std::ostringstream oss(std::ios_base::binary);
+		p.serialize(oss, protocol_version);
+		return oss.str();
+	};
 
 	if (peer_id == PEER_ID_INEXISTENT) {
 		std::vector<session_t> clients = m_clients.getClientIDs();
 		const v3f pos = p.pos * BS;
 		const float radius_sq = radius * radius;
+		// serialized once for each protocol version
+		std::unordered_map<u16, std::string> datas;
 
 		for (const session_t client_id : clients) {
 			RemotePlayer *player = m_env->getPlayer(client_id);
@@ -1629,21 +2329,61 @@ void Server::SendSpawnParticle(session_t peer_id, u16 protocol_version,
 			if (sao->getBasePosition().getDistanceFromSQ(pos) > radius_sq)
 				continue;
 
-			SendSpawnParticle(client_id, player->protocol_version, p);
+			const u16 proto = player->protocol_version;
+			auto it = datas.find(proto);
+			if (it == datas.end())
+				it = datas.emplace(proto, serialize(proto)).first;
+			SendSpawnParticleData(client_id, proto, it->second);
 		}
 		return;
 	}
 	assert(protocol_version != 0);
 
-	NetworkPacket pkt(TOCLIENT_SPAWN_PARTICLE, 0, peer_id);
+	SendSpawnParticleData(peer_id, protocol_version, serialize(protocol_version));
+}
 
-	{
-		// NetworkPacket and iostreams are incompatible...
-		std::ostringstream oss(std::ios_base::binary);
-		p.serialize(oss, protocol_version);
-		pkt.putRawString(oss.str());
+void Server::SendSpawnParticleData(session_t peer_id, u16 protocol_version,
+	const std::string &data)
+{
+	constexpr size_t spawn_size = ParticleParameters::SERIALIZED_SPAWN_SIZE;
+	if (protocol_version < 49 || data.size() < spawn_size) {
+		NetworkPacket pkt(TOCLIENT_SPAWN_PARTICLE, 0, peer_id);
+		pkt.putRawString(data);
+		Send(&pkt);
+		return;
 	}
 
+	/*
+		Particles spawned again and again differ only in the leading fields,
+		so the rest is sent once as a definition and referenced by its id.
+	*/
+	ParticleDefinitions &defs = m_particle_definitions[peer_id];
+	std::string key = data.substr(spawn_size);
+	u16 id;
+	auto it = defs.ids.find(key);
+	if (it != defs.ids.end()) {
+		id = it->second;
+	} else {
+		if (defs.keys.size() < MAX_PARTICLE_DEFINITIONS) {
+			id = defs.keys.size();
+			defs.keys.push_back(nullptr);
+		} else {
+			id = defs.next_replaced;
+			defs.next_replaced = (id + 1) % MAX_PARTICLE_DEFINITIONS;
+			defs.ids.erase(*defs.keys[id]);
+		}
+		it = defs.ids.emplace(std::move(key), id).first;
+		defs.keys[id] = &it->first;
+
+		NetworkPacket pkt(TOCLIENT_PARTICLE_DEFINITION, 2 + it->first.size(), peer_id);
+		pkt << id;
+		pkt.putRawString(it->first);
+		Send(&pkt);
+	}
+
+	NetworkPacket pkt(TOCLIENT_SPAWN_DEFINED_PARTICLE, 2 + spawn_size, peer_id);
+	pkt << id;
+	pkt.putRawString(data.data(), spawn_size);
 	Send(&pkt);
 }
 
@@ -1651,8 +2391,7 @@ void Server::SendSpawnParticle(session_t peer_id, u16 protocol_version,
 void Server::SendAddParticleSpawner(session_t peer_id, u16 protocol_version,
 	const ParticleSpawnerParameters &p, u16 attached_id, u32 id)
 {
-	static thread_local const float radius =
-			g_settings->getS16("max_block_send_distance") * MAP_BLOCKSIZE * BS;
+	const float radius = m_max_block_send_distance.get() * MAP_BLOCKSIZE * BS;
 
 	if (peer_id == PEER_ID_INEXISTENT) {
 		std::vector<session_t> clients = m_clients.getClientIDs();
@@ -2096,16 +2835,14 @@ void Server::SendPlayerFormspecPrepend(session_t peer_id)
 void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersao)
 {
 	// Radius inside which objects are active
-	static thread_local const s16 radius =
-		g_settings->getS16("active_object_send_range_blocks") * MAP_BLOCKSIZE;
+	const s16 radius = m_active_object_send_range_blocks.get() * MAP_BLOCKSIZE;
 
 	// Radius inside which players are active
 	static thread_local const bool is_transfer_limited =
 		g_settings->exists("unlimited_player_transfer_distance") &&
 		!g_settings->getBool("unlimited_player_transfer_distance");
 
-	static thread_local const s16 player_transfer_dist =
-		g_settings->getS16("player_transfer_distance") * MAP_BLOCKSIZE;
+	const s16 player_transfer_dist = m_player_transfer_distance.get() * MAP_BLOCKSIZE;
 
 	s16 player_radius = player_transfer_dist == 0 && is_transfer_limited ?
 		radius : player_transfer_dist;
@@ -2119,7 +2856,7 @@ void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersa
 	m_env->getRemovedActiveObjects(playersao, my_radius, player_radius,
 		client->m_known_objects, removed_objects);
 	m_env->getAddedActiveObjects(playersao, my_radius, player_radius,
-		client->m_known_objects, added_objects);
+		client->m_known_objects, added_objects, &client->m_known_object_cells);
 
 	if (removed_objects.empty() && added_objects.empty())
 		return;
@@ -2138,6 +2875,7 @@ void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersa
 
 		// Remove from known objects
 		client->m_known_objects.erase(id);
+		client->m_object_updates.erase(id);
 		if (obj && obj->m_known_by_count > 0)
 			obj->m_known_by_count--;
 	}
@@ -2258,6 +2996,9 @@ s32 Server::playSound(ServerPlayingSound &params, bool ephemeral)
 		}
 	}
 
+	if (ephemeral)
+		filterEphemeralSound(params, pos, pos_exists, dst_clients);
+
 	if(dst_clients.empty())
 		return -1;
 
@@ -2285,6 +3026,76 @@ s32 Server::playSound(ServerPlayingSound &params, bool ephemeral)
 		m_playing_sounds[id] = std::move(params);
 	return id;
 }
+
+// Below this gain a sound can't be heard
+static constexpr float MIN_AUDIBLE_GAIN = 0.005f;
+
+void Server::filterEphemeralSound(const ServerPlayingSound &params, v3f pos,
+	bool positional, std::vector<session_t> &dst_clients)
+{
+	const float gain = params.gain * params.spec.gain;
+	const double now = getUptime();
+	std::string key;
+	if (m_ephemeral_sound_coalesce_time > 0.0f) {
+		key = params.spec.name;
+		if (positional) {
+			const v3s16 p = floatToInt(pos, BS);
+			key.append(reinterpret_cast<const char *>(&p), sizeof(p));
+		}
+	}
+
+	auto is_dropped = [&] (session_t peer_id) {
+		if (positional) {
+			RemotePlayer *player = m_env->getPlayer(peer_id);
+			PlayerSAO *sao = player ? player->getPlayerSAO() : nullptr;
+			if (sao) {
+				// Like the inverse distance model of the client, which
+				// multiplies positional sounds by 3
+				const float d = sao->getBasePosition().getDistanceFrom(pos) / BS;
+				if (3.0f * gain / std::max(d, 1.0f) < MIN_AUDIBLE_GAIN)
+					return true;
+			}
+		}
+
+		if (m_max_ephemeral_sounds_per_step == 0 && key.empty())
+			return false;
+		EphemeralSounds &sounds = m_ephemeral_sounds[peer_id];
+		if (m_max_ephemeral_sounds_per_step > 0 &&
+				sounds.sent_this_step >= m_max_ephemeral_sounds_per_step)
+			return true;
+		if (!key.empty()) {
+			auto it = sounds.recent.find(key);
+			if (it != sounds.recent.end() &&
+					now - it->second < m_ephemeral_sound_coalesce_time)
+				return true;
+			sounds.recent[key] = now;
+		}
+		sounds.sent_this_step++;
+		return false;
+	};
+	dst_clients.erase(std::remove_if(dst_clients.begin(), dst_clients.end(),
+		is_dropped), dst_clients.end());
+}
+
+void Server::stepEphemeralSounds()
+{
+	const double now = getUptime();
+	for (auto it = m_ephemeral_sounds.begin(); it != m_ephemeral_sounds.end();) {
+		EphemeralSounds &sounds = it->second;
+		sounds.sent_this_step = 0;
+		for (auto it2 = sounds.recent.begin(); it2 != sounds.recent.end();) {
+			if (now - it2->second >= m_ephemeral_sound_coalesce_time)
+				it2 = sounds.recent.erase(it2);
+			else
+				++it2;
+		}
+		if (sounds.recent.empty())
+			it = m_ephemeral_sounds.erase(it);
+		else
+			++it;
+	}
+}
+
 void Server::stopSound(s32 handle)
 {
 	auto it = m_playing_sounds.find(handle);
@@ -2378,6 +3189,76 @@ void Server::sendNodeChangePkt(NetworkPacket &pkt, v3s16 block_pos,
 	}
 }
 
+void Server::sendNodeChanges(std::unordered_map<v3s16, BlockNodeChanges> &changes,
+		const std::vector<v3s16> &light_blocks, bool low_priority)
+{
+	Map &map = m_env->getMap();
+	std::vector<v3s16> resend_blocks;
+	std::vector<std::pair<v3s16, NetworkPacket>> packets;
+
+	for (auto &it : changes) {
+		const v3s16 blockpos = it.first;
+		auto &nodes = it.second.nodes;
+		MapBlock *block = map.getBlockNoCreateNoEx(blockpos);
+		if (it.second.all || !block) {
+			resend_blocks.push_back(blockpos);
+			continue;
+		}
+
+		// Merge changes of the same node
+		std::sort(nodes.begin(), nodes.end(), [] (const auto &a, const auto &b) {
+			return a.index < b.index;
+		});
+		size_t count = 0;
+		for (const auto &e : nodes) {
+			if (count > 0 && nodes[count - 1].index == e.index)
+				nodes[count - 1].remove_metadata |= e.remove_metadata;
+			else
+				nodes[count++] = e;
+		}
+		nodes.resize(count);
+
+		NetworkPacket pkt(TOCLIENT_NODES_CHANGED, 6 + 2 + count * 7);
+		pkt << blockpos << (u16)count;
+		for (const auto &e : nodes) {
+			const MapNode n = block->getNodeNoCheck(BlockNodeChanges::getRelPos(e.index));
+			pkt << e.index << n.param0 << n.param1 << n.param2
+				<< (u8)(e.remove_metadata ? 0 : 1);
+		}
+		packets.emplace_back(blockpos, std::move(pkt));
+	}
+
+	// Without the changes clients can't compute the lighting around them
+	if (!resend_blocks.empty()) {
+		resend_blocks.insert(resend_blocks.end(), light_blocks.begin(), light_blocks.end());
+		m_clients.markBlocksNotSent(resend_blocks, low_priority);
+	}
+	if (packets.empty())
+		return;
+
+	std::vector<session_t> clients = m_clients.getClientIDs();
+	ClientInterface::AutoLock clientlock(m_clients);
+
+	for (session_t client_id : clients) {
+		RemoteClient *client = m_clients.lockedGetClientNoEx(client_id);
+		if (!client)
+			continue;
+
+		const bool supported = client->net_proto_version >= 49;
+		bool missed = false;
+		for (auto &it : packets) {
+			if (supported && client->isBlockSent(it.first)) {
+				Send(client_id, &it.second);
+			} else {
+				client->SetBlockNotSent(it.first, low_priority);
+				missed = true;
+			}
+		}
+		if (missed)
+			client->SetBlocksNotSent(light_blocks, low_priority);
+	}
+}
+
 void Server::sendMetadataChanged(const std::unordered_set<v3s16> &positions, float far_d_nodes)
 {
 	NodeMetadataList meta_updates_list(false);
@@ -2430,47 +3311,121 @@ void Server::sendMetadataChanged(const std::unordered_set<v3s16> &positions, flo
 	}
 }
 
-void Server::SendBlockNoLock(session_t peer_id, MapBlock *block, u8 ver,
-		u16 net_proto_version, SerializedBlockCache *cache)
+// Compresses the output of MapBlock::serialize(..., false) for versions >= 29,
+// without the part written by MapBlock::serializeNetworkSpecific()
+static std::string compressNetBlock(const std::string &raw, u8 ver, int level)
 {
-	thread_local const int net_compression_level = rangelim(g_settings->getS16("map_compression_level_net"), -1, 9);
-	std::string s, *sptr = nullptr;
+	std::ostringstream os(std::ios_base::binary);
+	compress(raw, os, ver, level);
+	return os.str();
+}
+
+void Server::prepareBlocks(const std::vector<std::pair<MapBlock *, u8>> &blocks,
+	SerializedBlockCache *cache)
+{
+	const int net_compression_level = rangelim(m_map_compression_level_net.get(), -1, 9);
+
+	struct Job {
+		MapBlock *block;
+		u8 ver;
+		u64 mod_counter;
+		std::string raw;
+		std::string compressed;
+	};
+	std::vector<Job> jobs;
+	std::set<std::pair<v3s16, u8>> seen;
+	for (auto [block, ver] : blocks) {
+		// Older formats are compressed in parts while serializing
+		if (ver < 29)
+			continue;
+		const u64 mod_counter = block->getModificationCounter();
+		if (cache->get(block->getPos(), ver, mod_counter))
+			continue;
+		if (!seen.emplace(block->getPos(), ver).second)
+			continue;
+		// The snapshot needs the environment lock, compressing it doesn't
+		std::ostringstream os_raw(std::ios_base::binary);
+		block->serialize(os_raw, ver, false, net_compression_level, false);
+		jobs.push_back({block, ver, mod_counter, os_raw.str(), {}});
+	}
+	if (jobs.empty())
+		return;
+
+	m_block_serialize_pool->run(jobs.size(), [&] (size_t i) {
+		Job &job = jobs[i];
+		job.compressed = compressNetBlock(job.raw, job.ver, net_compression_level);
+	});
 
-	if (cache) {
-		auto it = cache->find({block->getPos(), ver});
-		if (it != cache->end())
-			sptr = &it->second;
+	for (Job &job : jobs) {
+		m_blockdata_bytes_counter[0]->increment(job.raw.size());
+		m_blockdata_bytes_counter[1]->increment(job.compressed.size());
+		std::ostringstream os(std::ios_base::binary);
+		os << job.compressed;
+		job.block->serializeNetworkSpecific(os);
+		cache->put(job.block->getPos(), job.ver, job.mod_counter, os.str());
 	}
+}
+
+void Server::SendBlockNoLock(session_t peer_id, MapBlock *block, u8 ver,
+		u16 net_proto_version, SerializedBlockCache *cache, bool hash_only)
+{
+	const int net_compression_level = rangelim(m_map_compression_level_net.get(), -1, 9);
+	const u64 mod_counter = block->getModificationCounter();
+	std::string s;
+	const std::string *sptr = nullptr;
+
+	if (cache)
+		sptr = cache->get(block->getPos(), ver, mod_counter);
 
 	// Serialize the block in the right format
 	if (!sptr) {
 		std::ostringstream os(std::ios_base::binary);
-		block->serialize(os, ver, false, net_compression_level);
+		if (ver >= 29) {
+			// Compressed here to know how well it works
+			std::ostringstream os_raw(std::ios_base::binary);
+			block->serialize(os_raw, ver, false, net_compression_level, false);
+			const std::string raw = os_raw.str();
+			os << compressNetBlock(raw, ver, net_compression_level);
+			m_blockdata_bytes_counter[0]->increment(raw.size());
+			m_blockdata_bytes_counter[1]->increment(os.tellp());
+		} else {
+			block->serialize(os, ver, false, net_compression_level);
+		}
 		block->serializeNetworkSpecific(os);
 		s = os.str();
-		sptr = &s;
+		// Store away in cache
+		if (cache)
+			sptr = &cache->put(block->getPos(), ver, mod_counter, std::move(s));
+		else
+			sptr = &s;
+	}
+
+	if (hash_only) {
+		NetworkPacket pkt(TOCLIENT_BLOCK_HASH, 2 + 2 + 2 + 2 + hashing::SHA1_DIGEST_SIZE,
+			peer_id);
+		pkt << block->getPos() << hashing::sha1(*sptr);
+		Send(&pkt);
+		return;
 	}
 
 	NetworkPacket pkt(TOCLIENT_BLOCKDATA, 2 + 2 + 2 + sptr->size(), peer_id);
 	pkt << block->getPos();
 	pkt.putRawString(*sptr);
 	Send(&pkt);
-
-	// Store away in cache
-	if (cache && sptr == &s)
-		(*cache)[{block->getPos(), ver}] = std::move(s);
 }
 
 void Server::SendBlocks(float dtime)
 {
-	EnvAutoLock envlock(this);
+	EnvAutoLock envlock(this, ENV_LOCK_SEND_BLOCKS);
 
 	std::vector<PrioritySortedBlockTransfer> queue;
 
 	u32 total_sending = 0, unique_clients = 0;
 
 	{
-		ScopeProfiler sp2(g_profiler, "Server::SendBlocks(): Collect list");
+		static const ProfilerKey prof_key_collect("Server::SendBlocks(): Collect list",
+			SPT_ADD, PRECISION_MILLI);
+		ScopeProfiler sp2(g_profiler, prof_key_collect);
 
 		std::vector<session_t> clients = m_clients.getClientIDs();
 
@@ -2488,29 +3443,85 @@ void Server::SendBlocks(float dtime)
 		}
 	}
 
+	ClientInterface::AutoLock clientlock(m_clients);
+	sendBlockTransfers(queue, total_sending, unique_clients > 1);
+}
+
+void Server::addEmergedBlock(v3s16 blockpos)
+{
+	MutexAutoLock lock(m_emerged_blocks_mutex);
+	m_emerged_blocks.push_back(blockpos);
+}
+
+void Server::sendEmergedBlocks()
+{
+	std::vector<v3s16> emerged;
+	{
+		MutexAutoLock lock(m_emerged_blocks_mutex);
+		emerged.swap(m_emerged_blocks);
+	}
+	if (emerged.empty())
+		return;
+
+	Map &map = m_env->getMap();
+	std::vector<PrioritySortedBlockTransfer> queue;
+	u32 total_sending = 0, unique_clients = 0;
+
+	ClientInterface::AutoLock clientlock(m_clients);
+	for (const session_t client_id : m_clients.getClientIDs()) {
+		RemoteClient *client = m_clients.lockedGetClientNoEx(client_id, CS_Active);
+		if (!client)
+			continue;
+
+		total_sending += client->getSendingCount();
+		const auto old_count = queue.size();
+		float priority;
+		for (v3s16 pos : emerged) {
+			if (client->takeEmergedBlock(pos, map.getBlockNoCreateNoEx(pos), &priority))
+				queue.emplace_back(priority, pos, client_id);
+		}
+		unique_clients += queue.size() > old_count ? 1 : 0;
+	}
+
+	if (!queue.empty())
+		sendBlockTransfers(queue, total_sending, unique_clients > 1);
+}
+
+void Server::sendBlockTransfers(std::vector<PrioritySortedBlockTransfer> &queue,
+	u32 total_sending, bool shared)
+{
 	// Sort.
 	// Lowest priority number comes first.
 	// Lowest is most important.
 	std::sort(queue.begin(), queue.end());
 
-	ClientInterface::AutoLock clientlock(m_clients);
-
 	// Maximal total count calculation
 	// The per-client block sends is halved with the maximal online users
 	u32 max_blocks_to_send = (m_env->getPlayerCount() + g_settings->getU32("max_users")) *
 		g_settings->getU32("max_simultaneous_block_sends_per_client") / 4 + 1;
 
-	ScopeProfiler sp(g_profiler, "Server::SendBlocks(): Send to clients");
+	static const ProfilerKey prof_key_send("Server::SendBlocks(): Send to clients",
+		SPT_ADD, PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, prof_key_send);
 	Map &map = m_env->getMap();
 
-	SerializedBlockCache cache, *cache_ptr = nullptr;
-	if (unique_clients > 1) {
-		// caching is pointless with a single client
-		cache_ptr = &cache;
+	SerializedBlockCache pass_cache(SIZE_MAX);
+	SerializedBlockCache *cache_ptr = m_block_send_cache.get();
+	if (!cache_ptr && shared) {
+		// Without the persistent cache, still share blocks between the
+		// clients handled in this pass.
+		// (caching is pointless with a single client)
+		cache_ptr = &pass_cache;
 	}
 
+	struct BlockToSend {
+		const PrioritySortedBlockTransfer *transfer;
+		MapBlock *block;
+		RemoteClient *client;
+	};
+	std::vector<BlockToSend> to_send;
 	for (const PrioritySortedBlockTransfer &block_to_send : queue) {
-		if (total_sending >= max_blocks_to_send)
+		if (total_sending + to_send.size() >= max_blocks_to_send)
 			break;
 
 		MapBlock *block = map.getBlockNoCreateNoEx(block_to_send.pos);
@@ -2522,12 +3533,33 @@ void Server::SendBlocks(float dtime)
 		if (!client)
 			continue;
 
-		SendBlockNoLock(block_to_send.peer_id, block, client->serialization_version,
-				client->net_proto_version, cache_ptr);
+		to_send.push_back({&block_to_send, block, client});
+	}
+
+	if (m_block_serialize_pool && to_send.size() > 1) {
+		if (!cache_ptr)
+			cache_ptr = &pass_cache;
+		std::vector<std::pair<MapBlock *, u8>> blocks;
+		blocks.reserve(to_send.size());
+		for (const BlockToSend &it : to_send)
+			blocks.emplace_back(it.block, it.client->serialization_version);
+		prepareBlocks(blocks, cache_ptr);
+	}
 
-		client->SentBlock(block_to_send.pos);
+	for (const BlockToSend &it : to_send) {
+		const v3s16 pos = it.transfer->pos;
+		SendBlockNoLock(it.transfer->peer_id, it.block, it.client->serialization_version,
+				it.client->net_proto_version, cache_ptr,
+				it.client->useBlockHash(pos));
+
+		it.client->SentBlock(pos);
 		total_sending++;
 	}
+
+	if (m_block_send_cache) {
+		g_profiler->avg("Server: block send cache size [KiB]",
+			m_block_send_cache->getBytes() / 1024);
+	}
 }
 
 bool Server::SendBlock(session_t peer_id, const v3s16 &blockpos)
@@ -2541,7 +3573,7 @@ bool Server::SendBlock(session_t peer_id, const v3s16 &blockpos)
 	if (!client || client->isBlockSent(blockpos))
 		return false;
 	SendBlockNoLock(peer_id, block, client->serialization_version,
-			client->net_proto_version);
+			client->net_proto_version, m_block_send_cache.get());
 
 	return true;
 }
@@ -2550,29 +3582,8 @@ bool Server::addMediaFile(const std::string &filename,
 	const std::string &filepath, std::string *filedata_to,
 	std::string *digest_to)
 {
-	// If name contains illegal characters, ignore the file
-	if (!string_allowed(filename, TEXTURENAME_ALLOWED_CHARS)) {
-		warningstream << "Server: ignoring file as it has disallowed characters: \""
-				<< filename << "\"" << std::endl;
-		return false;
-	}
-
-	// If name is not in a supported format, ignore it
-	const char *supported_ext[] = {
-		".png", ".jpg", ".tga",
-		".ogg",
-		".x", ".b3d", ".obj", ".gltf", ".glb",
-		// Translation file formats
-		".tr", ".po", ".mo",
-		// Fonts
-		".ttf", ".woff",
-		NULL
-	};
-	if (removeStringEnd(filename, supported_ext).empty()) {
-		infostream << "Server: ignoring unsupported file extension: \""
-				<< filename << "\"" << std::endl;
+	if (!is_media_filename_allowed(filename))
 		return false;
-	}
 	// Ok, attempt to load the file and add to cache
 
 	// Read data
@@ -2581,17 +3592,8 @@ bool Server::addMediaFile(const std::string &filename,
 		return false;
 	}
 
-	if (filedata.empty()) {
-		errorstream << "Server::addMediaFile(): Empty file \""
-				<< filepath << "\"" << std::endl;
-		return false;
-	}
-	if (filedata.size() > MEDIAFILE_MAX_SIZE) {
-		errorstream << "Server::addMediaFile(): \""
-				<< filepath << "\" is too big (" << (filedata.size() >> 10)
-				<< "KiB). The internal limit is " << (MEDIAFILE_MAX_SIZE >> 10) << "KiB." << std::endl;
+	if (!is_media_size_allowed(filepath, filedata.size()))
 		return false;
-	}
 
 	std::string sha1 = hashing::sha1(filedata);
 	std::string sha1_hex = hex_encode(sha1);
@@ -2608,7 +3610,7 @@ bool Server::addMediaFile(const std::string &filename,
 	return true;
 }
 
-void Server::fillMediaCache()
+void Server::startMediaHashing(MediaHasher &hasher)
 {
 	infostream << "Server: Calculating media file checksums" << std::endl;
 
@@ -2621,24 +3623,27 @@ void Server::fillMediaCache()
 	fs::GetRecursiveDirs(paths, m_gamespec.path + DIR_DELIM + "textures");
 	m_modmgr->getModsMediaPaths(paths);
 
-	// Collect media file information from paths into cache
-	for (const std::string &mediapath : paths) {
-		std::vector<fs::DirListNode> dirlist = fs::GetDirListing(mediapath);
-		for (const fs::DirListNode &dln : dirlist) {
-			if (dln.dir) // Ignore dirs (already in paths)
-				continue;
+	hasher.start(paths);
+}
 
-			const std::string &filename = dln.name;
-			if (m_media.find(filename) != m_media.end()) // Do not override
-				continue;
+void Server::fillMediaCache(MediaHasher &hasher)
+{
+	// Collect media file information from paths into cache. Files added by
+	// mods while loading come first.
+	for (const MediaHasher::File &file : hasher.wait()) {
+		if (file.sha1_digest.empty())
+			continue;
+		if (m_media.find(file.name) != m_media.end()) // Do not override
+			continue;
 
-			std::string filepath = mediapath;
-			filepath.append(DIR_DELIM).append(filename);
-			addMediaFile(filename, filepath);
-		}
+		m_media[file.name] = MediaInfo(file.path, file.sha1_digest);
+		verbosestream << "Server: " << hex_encode(file.sha1_digest) << " is "
+				<< file.name << " (" << (file.size >> 10) << "KiB)" << std::endl;
 	}
 
-	infostream << "Server: " << m_media.size() << " media files collected" << std::endl;
+	infostream << "Server: " << m_media.size() << " media files collected, "
+			<< hasher.getHashedCount() << " hashed and "
+			<< hasher.getCachedCount() << " unchanged" << std::endl;
 }
 
 void Server::sendMediaAnnouncement(session_t peer_id, const std::string &lang_code)
@@ -2835,9 +3840,116 @@ void Server::sendRequestedMedia(session_t peer_id,
 	}
 }
 
+void Server::updatePeerMetrics()
+{
+	const std::vector<session_t> peers = m_clients.getClientIDs(CS_Created);
+
+	// Forget disconnected peers, which also drops their gauges
+	for (auto it = m_peer_metrics.begin();
+			it != m_peer_metrics.end();) {
+		if (std::find(peers.begin(), peers.end(), it->first) == peers.end())
+			it = m_peer_metrics.erase(it);
+		else
+			++it;
+	}
+
+	for (session_t peer_id : peers) {
+		con::CongestionStats stats;
+		if (!m_con->getPeerCongestionStats(peer_id, stats))
+			continue;
+
+		auto it = m_peer_metrics.find(peer_id);
+		if (it == m_peer_metrics.end()) {
+			const std::string id = std::to_string(peer_id);
+			MetricsBackend *mb = m_metrics_backend.get();
+			PeerMetrics m;
+			m.window = mb->addGauge("minetest_core_peer_congestion_window",
+				"Reliable packets allowed in flight", {{"peer_id", id}});
+			m.in_flight = mb->addGauge("minetest_core_peer_packets_in_flight",
+				"Reliable packets waiting for an ACK", {{"peer_id", id}});
+			m.bandwidth = mb->addGauge("minetest_core_peer_bandwidth",
+				"Estimated bottleneck bandwidth (in bytes/s)", {{"peer_id", id}});
+			m.min_rtt = mb->addGauge("minetest_core_peer_min_rtt",
+				"Lowest recent round trip time (in seconds)", {{"peer_id", id}});
+			m.queued = mb->addGauge("minetest_core_peer_send_queue",
+				"Reliable packets waiting for room in the window", {{"peer_id", id}});
+			m.sent_packets = mb->addCounter("minetest_core_peer_sent_packets",
+				"Packets sent to the peer", {{"peer_id", id}});
+			m.sent_bytes = mb->addCounter("minetest_core_peer_sent_bytes",
+				"Command and payload bytes sent to the peer", {{"peer_id", id}});
+			it = m_peer_metrics.emplace(peer_id, std::move(m)).first;
+		}
+		PeerMetrics &m = it->second;
+		m.window->set(stats.window);
+		m.in_flight->set(stats.in_flight);
+		m.bandwidth->set(stats.bandwidth);
+		m.min_rtt->set(stats.min_rtt);
+		m.queued->set(stats.queued);
+
+		u64 packets, bytes;
+		if (m_clients.getClientSendStats(peer_id, packets, bytes)) {
+			m.sent_packets->increment(packets - m.sent_packets->get());
+			m.sent_bytes->increment(bytes - m.sent_bytes->get());
+		}
+	}
+}
+
+void Server::updateSendMetrics()
+{
+	ClientInterface::SendStats stats;
+	m_clients.getSendStats(stats);
+	for (u16 command = 0; command < TOCLIENT_NUM_MSG_TYPES; command++) {
+		if (stats.packets[command] == 0)
+			continue;
+		MetricCounterPtr &packets = m_sent_packets_counter[command];
+		MetricCounterPtr &bytes = m_sent_bytes_counter[command];
+		if (!packets) {
+			const char *name = clientCommandFactoryTable[command].name;
+			packets = m_metrics_backend->addCounter("minetest_core_sent_packets",
+				"Packets sent to clients by command", {{"command", name}});
+			bytes = m_metrics_backend->addCounter("minetest_core_sent_bytes",
+				"Command and payload bytes sent to clients by command",
+				{{"command", name}});
+		}
+		packets->increment(stats.packets[command] - packets->get());
+		bytes->increment(stats.bytes[command] - bytes->get());
+	}
+}
+
+void Server::updateModTimeMetrics()
+{
+	for (const auto &[mod, time_us] : m_script->getModTimes()) {
+		auto it = m_mod_time_counters.find(mod);
+		if (it == m_mod_time_counters.end()) {
+			it = m_mod_time_counters.emplace(mod, m_metrics_backend->addCounter(
+				"minetest_core_mod_lua_time",
+				"Time spent running Lua code of a mod (in seconds)",
+				{{"mod", mod}})).first;
+		}
+		MetricCounterPtr &counter = it->second;
+		counter->increment(time_us / 1e6 - counter->get());
+	}
+}
+
+const MemoryStats &Server::updateMemoryStats()
+{
+	MemoryStats &stats = *m_memory_stats;
+	const ServerMap::MemoryUsage map_usage = m_env->getServerMap().getMemoryUsage();
+	stats.set(MEMORY_MAPBLOCKS, map_usage.blocks);
+	stats.set(MEMORY_NODE_METADATA, map_usage.node_metadata);
+	stats.set(MEMORY_STATIC_OBJECTS, map_usage.static_objects);
+	stats.set(MEMORY_BLOCK_CACHE,
+		m_block_send_cache ? m_block_send_cache->getBytes() : 0);
+	stats.set(MEMORY_NETWORK_BUFFERS, bufferpool::getStats().heap_bytes);
+	stats.set(MEMORY_LUA_SERVER, m_script->getMemoryUsage());
+	stats.set(MEMORY_LUA_ASYNC, m_script->getAsyncMemoryUsage());
+	stats.set(MEMORY_LUA_MAPGEN, m_emerge->getScriptMemoryUsage());
+	return stats;
+}
+
 void Server::stepPendingDynMediaCallbacks(float dtime)
 {
-	EnvAutoLock lock(this);
+	EnvAutoLock lock(this, ENV_LOCK_STEP);
 
 	for (auto it = m_pending_dyn_media.begin(); it != m_pending_dyn_media.end();) {
 		it->second.expiry_timer -= dtime;
@@ -2878,30 +3990,59 @@ void Server::SendMinimapModes(session_t peer_id,
 	Send(&pkt);
 }
 
-void Server::sendDetachedInventory(Inventory *inventory, const std::string &name, session_t peer_id)
+void Server::sendDetachedInventory(Inventory *inventory, const std::string &name,
+		session_t peer_id, bool incremental)
 {
-	NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
-	pkt << name;
-
 	if (!inventory) {
-		pkt << false; // Remove inventory
-	} else {
-		pkt << true; // Update inventory
+		NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
+		pkt << name << false; // Remove inventory
+
+		if (peer_id == PEER_ID_INEXISTENT)
+			m_clients.sendToAll(&pkt);
+		else
+			Send(&pkt);
+		return;
+	}
+
+	auto fill_packet = [&] (NetworkPacket &pkt, bool slot_delta) {
+		pkt << name << true; // Update inventory
 
 		// Serialization & NetworkPacket isn't a love story
 		std::ostringstream os(std::ios_base::binary);
-		inventory->serialize(os);
-		inventory->setModified(false);
+		inventory->serialize(os, slot_delta);
 
 		const std::string &os_str = os.str();
 		pkt << static_cast<u16>(os_str.size()); // HACK: to keep compatibility with 5.0.0 clients
 		pkt.putRawString(os_str);
+	};
+
+	if (peer_id != PEER_ID_INEXISTENT) {
+		// Do not clear the modified flags: the other clients still need them
+		NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
+		fill_packet(pkt, incremental && m_clients.getProtocolVersion(peer_id) >= 38);
+		Send(&pkt);
+		return;
 	}
 
-	if (peer_id == PEER_ID_INEXISTENT)
+	if (!incremental) {
+		NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
+		fill_packet(pkt, false);
 		m_clients.sendToAll(&pkt);
-	else
-		Send(&pkt);
+	} else {
+		// Unchanged lists and slots are only skipped for clients that
+		// understand it. Deltas also go to joining clients, which already
+		// received the full inventory in handleCommand_Init2.
+		NetworkPacket pkt_delta(TOCLIENT_DETACHED_INVENTORY, 0);
+		NetworkPacket pkt_full(TOCLIENT_DETACHED_INVENTORY, 0);
+		for (const session_t client_id : m_clients.getClientIDs(CS_InitDone)) {
+			const bool slot_delta = m_clients.getProtocolVersion(client_id) >= 38;
+			NetworkPacket &pkt = slot_delta ? pkt_delta : pkt_full;
+			if (pkt.getSize() == 0)
+				fill_packet(pkt, slot_delta);
+			Send(client_id, &pkt);
+		}
+	}
+	inventory->setModified(false);
 }
 
 void Server::sendDetachedInventories(session_t peer_id, bool incremental)
@@ -2912,8 +4053,8 @@ void Server::sendDetachedInventories(session_t peer_id, bool incremental)
 		peer_name = getClient(peer_id, CS_Created)->getName();
 	}
 
-	auto send_cb = [this, peer_id](const std::string &name, Inventory *inv) {
-		sendDetachedInventory(inv, name, peer_id);
+	auto send_cb = [this, peer_id, incremental](const std::string &name, Inventory *inv) {
+		sendDetachedInventory(inv, name, peer_id, incremental);
 	};
 
 	m_inventory_mgr->sendDetachedInventories(peer_name, incremental, send_cb);
@@ -2959,6 +4100,31 @@ void Server::kickAllPlayers(AccessDeniedCode reason,
 	}
 }
 
+bool Server::transferPlayer(session_t peer_id, const std::string &address,
+	u16 port)
+{
+	RemoteClient *client = getClientNoEx(peer_id, CS_Active);
+	if (!client || client->net_proto_version < 49)
+		return false;
+
+	// The other server reads the player from the shared database when the
+	// client arrives, which can be before this one removes the player
+	RemotePlayer *player = m_env->getPlayer(peer_id);
+	if (player && player->getPlayerSAO())
+		m_env->savePlayer(player);
+
+	actionstream << "Server: Transferring " << client->getName() << " to "
+		<< address << ":" << port << std::endl;
+
+	NetworkPacket pkt(TOCLIENT_TRANSFER, 2 + address.size() + 2, peer_id);
+	pkt << address << port;
+	Send(&pkt);
+
+	m_clients.event(peer_id, CSE_SetDenied);
+	DisconnectPeer(peer_id);
+	return true;
+}
+
 void Server::DisconnectPeer(session_t peer_id)
 {
 	m_modchannel_mgr->leaveAllChannels(peer_id);
@@ -3008,6 +4174,10 @@ void Server::DeleteClient(session_t peer_id, ClientDeletionReason reason)
 
 		// clear formspec info so the next client can't abuse the current state
 		m_formspec_state_data.erase(peer_id);
+		m_last_sent_formspecs.erase(peer_id);
+		m_ephemeral_sounds.erase(peer_id);
+		m_particle_definitions.erase(peer_id);
+		m_hud_changes.erase(peer_id);
 
 		RemotePlayer *player = m_env->getPlayer(peer_id);
 
@@ -3059,6 +4229,11 @@ void Server::DeleteClient(session_t peer_id, ClientDeletionReason reason)
 			EnvAutoLock envlock(this);
 			m_clients.DeleteClient(peer_id);
 		}
+
+		// nobody is waiting for these anymore
+		size_t cancelled = m_emerge->removePeer(peer_id);
+		if (cancelled > 0)
+			g_profiler->add("Server: cancelled emerges", cancelled);
 	}
 
 	// Send leave chat message to all remaining clients
@@ -3241,7 +4416,7 @@ PlayerSAO *Server::getPlayerSAO(session_t peer_id)
 	return player->getPlayerSAO();
 }
 
-std::string Server::getStatusString()
+std::string Server::getStatusString(bool detailed)
 {
 	std::ostringstream os(std::ios_base::binary);
 	os << "# Server: ";
@@ -3275,6 +4450,20 @@ std::string Server::getStatusString()
 	if (m_env && !((ServerMap*)(&m_env->getMap()))->isSavingEnabled())
 		os << std::endl << "# Server: " << " WARNING: Map saving is disabled.";
 
+	if (detailed && m_script) {
+		auto mod_times = m_script->getModTimes();
+		std::sort(mod_times.begin(), mod_times.end(), [] (auto &a, auto &b) {
+			return a.second > b.second;
+		});
+		const double uptime_us = std::max(getUptime(), 1.0) * 1e6;
+		os << std::endl << "# Server: Lua time by mod:";
+		for (size_t i = 0; i < std::min<size_t>(mod_times.size(), 5); i++) {
+			os << (i == 0 ? " " : ", ") << mod_times[i].first << " "
+				<< std::fixed << std::setprecision(1)
+				<< (mod_times[i].second * 100 / uptime_us) << "%";
+		}
+	}
+
 	if (!g_settings->get("motd").empty())
 		os << std::endl << "# Server: " << g_settings->get("motd");
 
@@ -3433,19 +4622,66 @@ bool Server::hudRemove(RemotePlayer *player, u32 id) {
 
 	delete todel;
 
-	SendHUDRemove(player->getPeerId(), id);
+	const session_t peer_id = player->getPeerId();
+	auto it = m_hud_changes.find(peer_id);
+	if (it != m_hud_changes.end()) {
+		auto &changes = it->second;
+		changes.erase(changes.lower_bound({id, HudElementStat(0)}),
+			changes.lower_bound({id, HudElementStat_END}));
+	}
+
+	SendHUDRemove(peer_id, id);
 	return true;
 }
 
-bool Server::hudChange(RemotePlayer *player, u32 id, HudElementStat stat, void *data)
+bool Server::hudChange(RemotePlayer *player, u32 id, HudElementStat stat)
 {
 	if (!player)
 		return false;
 
-	SendHUDChange(player->getPeerId(), id, stat, data);
+	// Changes of one step are merged, the elements have the latest values
+	m_hud_changes[player->getPeerId()].emplace(id, stat);
 	return true;
 }
 
+static void *get_hud_stat(HudElement *elem, HudElementStat stat)
+{
+	switch (stat) {
+	case HUD_STAT_POS:       return &elem->pos;
+	case HUD_STAT_NAME:      return &elem->name;
+	case HUD_STAT_SCALE:     return &elem->scale;
+	case HUD_STAT_TEXT:      return &elem->text;
+	case HUD_STAT_NUMBER:    return &elem->number;
+	case HUD_STAT_ITEM:      return &elem->item;
+	case HUD_STAT_DIR:       return &elem->dir;
+	case HUD_STAT_ALIGN:     return &elem->align;
+	case HUD_STAT_OFFSET:    return &elem->offset;
+	case HUD_STAT_WORLD_POS: return &elem->world_pos;
+	case HUD_STAT_SIZE:      return &elem->size;
+	case HUD_STAT_Z_INDEX:   return &elem->z_index;
+	case HUD_STAT_TEXT2:     return &elem->text2;
+	case HUD_STAT_STYLE:     return &elem->style;
+	case HudElementStat_END: break;
+	}
+	return nullptr;
+}
+
+void Server::sendHudChanges()
+{
+	for (const auto &[peer_id, changes] : m_hud_changes) {
+		RemotePlayer *player = m_env->getPlayer(peer_id);
+		if (!player)
+			continue;
+		for (const auto &[id, stat] : changes) {
+			HudElement *elem = player->getHud(id);
+			void *value = elem ? get_hud_stat(elem, stat) : nullptr;
+			if (value)
+				SendHUDChange(peer_id, id, stat, value);
+		}
+	}
+	m_hud_changes.clear();
+}
+
 bool Server::hudSetFlags(RemotePlayer *player, u32 flags, u32 mask)
 {
 	if (!player)
@@ -4231,13 +5467,15 @@ void Server::broadcastModChannelMessage(const std::string &channel,
 	NetworkPacket resp_pkt(TOCLIENT_MODCHANNEL_MSG,
 			2 + channel.size() + 2 + sender.size() + 2 + message.size());
 	resp_pkt << channel << sender << message;
-	for (session_t peer_id : peers) {
-		// Ignore sender
-		if (peer_id == from_peer)
-			continue;
 
-		Send(peer_id, &resp_pkt);
+	// Ignore sender
+	std::vector<session_t> recipients;
+	recipients.reserve(peers.size());
+	for (session_t peer_id : peers) {
+		if (peer_id != from_peer)
+			recipients.push_back(peer_id);
 	}
+	m_clients.send(recipients, &resp_pkt);
 
 	if (from_peer != PEER_ID_SERVER) {
 		m_script->on_modchannel_message(channel, sender, message);
@@ -4296,7 +5534,12 @@ ModStorageDatabase *Server::openModStorageDatabase(const std::string &world_path
 			<< std::endl << "Switching to SQLite3 is advised, "
 			<< "please read https://docs.luanti.org/for-server-hosts/database-backends." << std::endl;
 
-	return openModStorageDatabase(backend, world_path, world_mt);
+	ModStorageDatabase *db = openModStorageDatabase(backend, world_path, world_mt);
+	// Mods may write the same keys over and over, only write them once per save.
+	// The files and dummy backends are entirely in memory already.
+	if (backend == "sqlite3" || backend == "postgresql")
+		db = new ModStorageDatabaseCache(db);
+	return db;
 }
 
 ModStorageDatabase *Server::openModStorageDatabase(const std::string &backend,
@@ -16,11 +16,18 @@
 #include "util/numeric.h"
 #include "util/thread.h"
 #include "util/basic_macros.h"
+#include "util/bufferpool.h"
 #include "util/metricsbackend.h"
+#include "util/tracy_wrapper.h"
 #include "serverenvironment.h"
 #include "server/clientiface.h"
+#include "server/envlockstats.h"
+#include "server/packetdecoder.h"
+#include "server/serializedblockcache.h"
+#include "server/srpverifierpool.h"
 #include "threading/ordered_mutex.h"
 #include "chatmessage.h"
+#include "settings.h"
 #include "sound.h"
 #include "translation.h"
 #include "script/common/c_types.h" // LuaError
@@ -29,12 +36,16 @@
 #include <string>
 #include <list>
 #include <map>
+#include <set>
 #include <vector>
 #include <unordered_set>
 #include <optional>
 #include <string_view>
+#include <mutex>
 #include <shared_mutex>
 #include <condition_variable>
+#include <chrono>
+#include <memory>
 
 class ChatEvent;
 struct ChatEventChat;
@@ -64,9 +75,15 @@ struct Lighting;
 class ServerThread;
 class ServerModManager;
 class ServerInventoryManager;
+class StepPhaseProfiler;
+class MemoryStats;
+class PacketRecorder;
+class MediaHasher;
+class ReplayConnection;
 struct PackedValue;
 struct ParticleParameters;
 struct ParticleSpawnerParameters;
+class WorkerPool;
 
 // Anticheat flags
 enum {
@@ -145,23 +162,62 @@ struct ClientInfo {
 	std::string vers_string, lang_code;
 };
 
-struct ModIPCStore {
+/*
+	Key-value store shared by all Lua environments (see l_ipc.cpp).
+
+	The keys are spread over independently locked shards, values are
+	immutable once stored and can be read without holding any lock.
+*/
+class ModIPCStore {
+public:
+	typedef std::shared_ptr<PackedValue> Value;
+
 	ModIPCStore() = default;
 	~ModIPCStore();
 
-	/// RW lock for this entire structure
-	std::shared_mutex mutex;
-	/// Signalled on any changes to the map contents
-	std::condition_variable_any condvar;
+	/// @return value stored at the key or nullptr
+	Value get(const std::string &key);
+
+	/// Stores a value, nullptr deletes the key
+	void set(const std::string &key, Value value);
+
+	/**
+	 * Stores a value if the key still holds `expected`.
+	 * Values are compared by identity, as returned by get().
+	 * @return whether the value was stored
+	 */
+	bool replace(const std::string &key, const Value &expected, const Value &value);
+
 	/**
-	 * Map storing the data
-	 *
-	 * @note Do not store `nil` data in this map, instead remove the whole key.
+	 * Waits until a value is stored at the key.
+	 * Only the shard of the key is woken up by changes.
+	 * @return false on timeout
 	 */
-	std::unordered_map<std::string, std::unique_ptr<PackedValue>> map;
+	bool waitFor(const std::string &key, std::chrono::milliseconds timeout);
 
-	/// @note Should be called without holding the lock.
-	inline void signal() { condvar.notify_all(); }
+private:
+	static constexpr size_t NUM_SHARDS = 32;
+
+	struct Shard {
+		std::shared_mutex mutex;
+		/// Signalled when a value is stored, if there are waiters
+		std::condition_variable_any condvar;
+		std::atomic<u32> waiters{0};
+		/**
+		 * @note Do not store `nil` data in this map, instead remove the whole key.
+		 */
+		std::unordered_map<std::string, Value> map;
+	};
+
+	Shard &getShard(const std::string &key)
+	{
+		return m_shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+	}
+
+	/// @note Must be called with the lock held, notifies after unlocking
+	void signal(Shard &shard, std::unique_lock<std::shared_mutex> &lock);
+
+	Shard m_shards[NUM_SHARDS];
 };
 
 class Server : public con::PeerHandler, public MapEventReceiver,
@@ -179,7 +235,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 		Address bind_addr,
 		bool dedicated,
 		ChatInterface *iface = nullptr,
-		std::string *shutdown_errmsg = nullptr
+		std::string *shutdown_errmsg = nullptr,
+		// used instead of a network connection if set
+		std::shared_ptr<con::IConnection> connection = nullptr
 	);
 	~Server();
 	DISABLE_CLASS_COPY(Server);
@@ -196,6 +254,15 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	/// @param min_time minimum time to take [s]
 	void Receive(float min_time);
 	void yieldToOtherThreads(float dtime);
+	// Runs the Lua garbage collector in a part of the time left until the
+	// next step, see lua_gc_idle_fraction
+	void collectLuaGarbage(float idle_time);
+
+	// Runs the server on the calling thread instead of start(), with steps
+	// of a fixed dtime and the recorded packets processed after the same
+	// steps as when they were recorded. con must be the connection that was
+	// passed to the constructor. Returns the number of steps.
+	u64 replay(ReplayConnection &con, float dtime, volatile std::sig_atomic_t &kill);
 
 	// Full player initialization after they processed all static media
 	// This is a helper function for TOSERVER_CLIENT_READY
@@ -205,7 +272,8 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	 * Command Handlers
 	 */
 
-	void handleCommand(NetworkPacket* pkt);
+	// cmd: pre-parsed form of the command, if any
+	void handleCommand(NetworkPacket* pkt, const DecodedCommand *cmd = nullptr);
 
 	void handleCommand_Null(NetworkPacket* pkt) {};
 	void handleCommand_Deprecated(NetworkPacket* pkt);
@@ -218,7 +286,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void handleCommand_ClientReady(NetworkPacket* pkt);
 	void handleCommand_GotBlocks(NetworkPacket* pkt);
 	void handleCommand_PlayerPos(NetworkPacket* pkt);
+	void handleCommand_PlayerMove(NetworkPacket* pkt);
 	void handleCommand_DeletedBlocks(NetworkPacket* pkt);
+	void handleCommand_RequestBlocks(NetworkPacket* pkt);
 	void handleCommand_InventoryAction(NetworkPacket* pkt);
 	void handleCommand_ChatMessage(NetworkPacket* pkt);
 	void handleCommand_Damage(NetworkPacket* pkt);
@@ -230,17 +300,46 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void handleCommand_FirstSrp(NetworkPacket* pkt);
 	void handleCommand_SrpBytesA(NetworkPacket* pkt);
 	void handleCommand_SrpBytesM(NetworkPacket* pkt);
+	// Sends the result of the SRP computation started by handleCommand_SrpBytesA
+	void finishSrpBytesA(SrpVerifierPool::Result &result);
 	void handleCommand_HaveMedia(NetworkPacket *pkt);
 	void handleCommand_UpdateClientInfo(NetworkPacket *pkt);
 
-	void ProcessData(NetworkPacket *pkt);
+	// Handlers for commands pre-parsed by decodeCommand()
+	void handleCommand_GotBlocks(session_t peer_id, const DecodedGotBlocks &cmd);
+	void handleCommand_Interact(NetworkPacket *pkt, const DecodedInteract &cmd);
+	void handleCommand_NodeMetaFields(session_t peer_id,
+		const DecodedNodeMetaFields &cmd);
+	void handleCommand_InventoryFields(session_t peer_id,
+		const DecodedInventoryFields &cmd);
+
+	void ProcessData(NetworkPacket *pkt, const DecodedCommand *cmd = nullptr);
 
 	void Send(NetworkPacket *pkt);
 	void Send(session_t peer_id, NetworkPacket *pkt);
 
+	// Decoded TOSERVER_PLAYERPOS or TOSERVER_PLAYER_MOVE
+	struct PlayerPosUpdate {
+		v3f position;
+		v3f speed;
+		f32 pitch;
+		f32 yaw;
+		u32 keys_pressed;
+		f32 fov;
+		u8 wanted_range;
+		u8 bits;
+		bool has_movement;
+		f32 movement_speed;
+		f32 movement_direction;
+	};
+
 	// Helper for handleCommand_PlayerPos and handleCommand_Interact
 	void process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
 		NetworkPacket *pkt);
+	void apply_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
+		const PlayerPosUpdate &update);
+	// Checks the movement of players whose position changed since the last step
+	void checkPlayerMovements();
 
 	// Both setter and getter need no envlock,
 	// can be called freely from threads
@@ -254,7 +353,8 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void onMapEditEvent(const MapEditEvent &event);
 
 	// Connection must be locked when called
-	std::string getStatusString();
+	// detailed adds the Lua time used by each mod
+	std::string getStatusString(bool detailed = false);
 	inline double getUptime() const { return m_uptime_counter->get(); }
 
 	// read shutdown state
@@ -303,7 +403,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	bool dynamicAddMedia(const DynamicMediaArgs &args);
 
 	ServerInventoryManager *getInventoryMgr() const { return m_inventory_mgr.get(); }
-	void sendDetachedInventory(Inventory *inventory, const std::string &name, session_t peer_id);
+	// incremental: only send the lists and slots modified since the last broadcast
+	void sendDetachedInventory(Inventory *inventory, const std::string &name,
+			session_t peer_id, bool incremental = false);
 
 	// Envlock and conlock should be locked when using scriptapi
 	inline ServerScripting *getScriptIface() { return m_script.get(); }
@@ -353,17 +455,25 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 		setAsyncFatalError(std::string("Lua: ") + e.what());
 	}
 
+	// Called by the emerge threads when a block that a client waits for is
+	// done, the block is sent in the next step (thread-safe)
+	void addEmergedBlock(v3s16 blockpos);
+
 	// Not thread-safe.
 	void addShutdownError(const ModError &e);
 
 	bool showFormspec(const char *name, const std::string &formspec, const std::string &formname);
 	Map & getMap() { return m_env->getMap(); }
 	ServerEnvironment & getEnv() { return *m_env; }
+	StepPhaseProfiler *getStepPhaseProfiler() { return m_step_phase_profiler.get(); }
+	// Measures the memory usage of the subsystems, requires the env lock
+	const MemoryStats &updateMemoryStats();
 	v3f findSpawnPos();
 
 	u32 hudAdd(RemotePlayer *player, HudElement *element);
 	bool hudRemove(RemotePlayer *player, u32 id);
-	bool hudChange(RemotePlayer *player, u32 id, HudElementStat stat, void *value);
+	// Sends the stat of the element at the end of the server step
+	bool hudChange(RemotePlayer *player, u32 id, HudElementStat stat);
 	bool hudSetFlags(RemotePlayer *player, u32 flags, u32 mask);
 	bool hudSetHotbarItemcount(RemotePlayer *player, s32 hotbar_itemcount);
 	void hudSetHotbarImage(RemotePlayer *player, const std::string &name);
@@ -390,12 +500,18 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	/* con::PeerHandler implementation. */
 	void peerAdded(con::IPeer *peer);
 	void deletingPeer(con::IPeer *peer, bool timeout);
+	// Actual handling of the above, on the server thread
+	void handlePeerAdded(session_t peer_id);
+	void handlePeerRemoved(session_t peer_id, bool timeout);
 
 	void DenySudoAccess(session_t peer_id);
 	void DenyAccess(session_t peer_id, AccessDeniedCode reason,
 		std::string_view custom_reason = "", bool reconnect = false);
 	void kickAllPlayers(AccessDeniedCode reason,
 		const std::string &str_reason, bool reconnect);
+	// Saves the player and moves the client to another server of the same
+	// world. Returns false if the client doesn't support this.
+	bool transferPlayer(session_t peer_id, const std::string &address, u16 port);
 	void acceptAuth(session_t peer_id, bool forSudoMode);
 	void DisconnectPeer(session_t peer_id);
 	bool getClientConInfo(session_t peer_id, con::rtt_stat_type type, float *retval);
@@ -458,12 +574,20 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	Address m_bind_addr;
 
 	// Public helper for taking the envlock in a scope
+	// Locks the environment mutex, site tells who waited for it and held it
 	class EnvAutoLock {
 	public:
-		EnvAutoLock(Server *server): m_lock(server->m_env_mutex) {}
+		EnvAutoLock(Server *server, EnvLockSite site = ENV_LOCK_OTHER);
+		~EnvAutoLock();
+
+		DISABLE_CLASS_COPY(EnvAutoLock)
 
 	private:
-		std::lock_guard<ordered_mutex> m_lock;
+		EnvLockStats *m_stats;
+		EnvLockSite m_site;
+		u64 m_wait_us = 0;
+		u64 m_locked_us = 0;
+		std::unique_lock<LockableBase(ordered_mutex)> m_lock;
 	};
 
 protected:
@@ -506,15 +630,6 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 		std::unordered_set<session_t> waiting_players;
 	};
 
-	// The standard library does not implement std::hash for pairs so we have this:
-	struct SBCHash {
-		size_t operator() (const std::pair<v3s16, u16> &p) const {
-			return std::hash<v3s16>()(p.first) ^ p.second;
-		}
-	};
-
-	typedef std::unordered_map<std::pair<v3s16, u16>, std::string, SBCHash> SerializedBlockCache;
-
 	void init();
 
 	void SendMovement(session_t peer_id);
@@ -523,6 +638,10 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void SendAccessDenied(session_t peer_id, AccessDeniedCode reason,
 		std::string_view custom_reason, bool reconnect = false);
 	void SendItemDef(session_t peer_id, IItemDefManager *itemdef, u16 protocol_version);
+	// Serialized and compressed definitions, cached until they change
+	template <typename T>
+	const std::string &getDefinitionPayload(T *defs, u16 protocol_version,
+		bool zstd);
 	void SendNodeDef(session_t peer_id, const NodeDefManager *nodedef,
 		u16 protocol_version);
 
@@ -567,25 +686,56 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 			float far_d_nodes = 100, bool remove_metadata = true);
 	void sendNodeChangePkt(NetworkPacket &pkt, v3s16 block_pos,
 			v3f p, float far_d_nodes, std::unordered_set<u16> *far_players);
+	/*
+		Sends the changed nodes to the clients that have the blocks, everyone
+		else gets the blocks again. light_blocks only had their lighting
+		changed, they are resent to clients that missed any of the changes.
+	*/
+	void sendNodeChanges(std::unordered_map<v3s16, BlockNodeChanges> &changes,
+			const std::vector<v3s16> &light_blocks, bool low_priority);
 
 	void sendMetadataChanged(const std::unordered_set<v3s16> &positions,
 			float far_d_nodes = 100);
 
 	// Environment and Connection must be locked when called
 	// `cache` may only be very short lived! (invalidation not handeled)
+	// hash_only: send TOCLIENT_BLOCK_HASH instead of the data
 	void SendBlockNoLock(session_t peer_id, MapBlock *block, u8 ver,
-		u16 net_proto_version, SerializedBlockCache *cache = nullptr);
+		u16 net_proto_version, SerializedBlockCache *cache = nullptr,
+		bool hash_only = false);
 
 	// Sends blocks to clients (locks env and con on its own)
 	void SendBlocks(float dtime);
+	// Sends the blocks added by addEmergedBlock() to the clients waiting for
+	// them, without searching through the map again.
+	// Environment must be locked, after the map edit events were processed.
+	void sendEmergedBlocks();
+	// Sends as many of the blocks as the limits allow, most important first
+	// Environment and clients must be locked when called
+	void sendBlockTransfers(std::vector<PrioritySortedBlockTransfer> &queue,
+		u32 total_sending, bool shared);
+
+	// Serializes the blocks that aren't in the cache yet into it, with
+	// the compression done on m_block_serialize_pool.
+	// Environment must be locked when called
+	void prepareBlocks(const std::vector<std::pair<MapBlock *, u8>> &blocks,
+		SerializedBlockCache *cache);
 
 	bool addMediaFile(const std::string &filename, const std::string &filepath,
 			std::string *filedata = nullptr, std::string *digest = nullptr);
-	void fillMediaCache();
+	// The media is hashed while the mods are loaded
+	void startMediaHashing(MediaHasher &hasher);
+	void fillMediaCache(MediaHasher &hasher);
 	void sendMediaAnnouncement(session_t peer_id, const std::string &lang_code);
 	void sendRequestedMedia(session_t peer_id,
 			const std::unordered_set<std::string> &tosend);
 	void stepPendingDynMediaCallbacks(float dtime);
+	// Updates the per-peer congestion control gauges and send counters
+	void updatePeerMetrics();
+	// Updates the counters of the packets sent by command
+	void updateSendMetrics();
+	// Updates the counters of Lua time per mod
+	void updateModTimeMetrics();
 
 	// Adds a ParticleSpawner on peer with peer_id (PEER_ID_INEXISTENT == all)
 	void SendAddParticleSpawner(session_t peer_id, u16 protocol_version,
@@ -596,6 +746,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// Spawns particle on peer with peer_id (PEER_ID_INEXISTENT == all)
 	void SendSpawnParticle(session_t peer_id, u16 protocol_version,
 		const ParticleParameters &p);
+	// data is the ParticleParameters serialized for the protocol version
+	void SendSpawnParticleData(session_t peer_id, u16 protocol_version,
+		const std::string &data);
 
 	void SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersao);
 	void SendActiveObjectMessages(session_t peer_id, const std::string &datas,
@@ -645,7 +798,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	*/
 
 	// Environment mutex (envlock)
-	ordered_mutex m_env_mutex;
+	TracyLockableN(ordered_mutex, m_env_mutex, "Env mutex");
+	// Who waits for it and holds it how long
+	std::unique_ptr<EnvLockStats> m_env_lock_stats;
 
 	// World directory
 	std::string m_path_world;
@@ -680,6 +835,12 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 
 	// server connection
 	std::shared_ptr<con::IConnection> m_con;
+	// Receives from m_con if packet_decode_async is enabled, else nullptr
+	std::unique_ptr<PacketDecodeThread> m_packet_decoder;
+	// Writes what is received to packet_record_file, if set
+	std::unique_ptr<PacketRecorder> m_packet_recorder;
+	// Steps that were not the initial one, to tag the recorded packets with
+	u64 m_step_count = 0;
 
 	// Ban checking
 	BanManager *m_banmanager = nullptr;
@@ -690,6 +851,25 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// Emerge manager
 	std::unique_ptr<EmergeManager> m_emerge;
 
+	// Network-serialized blocks shared by all clients (behind m_env_mutex),
+	// nullptr if disabled
+	std::unique_ptr<SerializedBlockCache> m_block_send_cache;
+	// Compresses blocks to send, nullptr if disabled
+	std::unique_ptr<WorkerPool> m_block_serialize_pool;
+	// Computes the SRP verifiers of logins
+	std::unique_ptr<SrpVerifierPool> m_srp_pool;
+
+	// Compressed TOCLIENT_ITEMDEF/TOCLIENT_NODEDEF payloads, built once per
+	// format (behind m_env_mutex)
+	struct DefinitionPayload {
+		const void *defs;
+		u16 protocol_version;
+		bool zstd;
+		u32 modification_counter;
+		std::string data;
+	};
+	std::vector<DefinitionPayload> m_definition_payloads;
+
 	// Item definition manager
 	IWritableItemDefManager *m_itemdef;
 
@@ -703,6 +883,14 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 
 	ModIPCStore m_ipcstore;
 
+	// Settings read in hot paths
+	CachedSetting<u16> m_active_object_full_rate_distance{"active_object_full_rate_distance"};
+	CachedSetting<float> m_server_map_save_interval{"server_map_save_interval"};
+	CachedSetting<s16> m_max_block_send_distance{"max_block_send_distance"};
+	CachedSetting<s16> m_active_object_send_range_blocks{"active_object_send_range_blocks"};
+	CachedSetting<s16> m_player_transfer_distance{"player_transfer_distance"};
+	CachedSetting<s16> m_map_compression_level_net{"map_compression_level_net"};
+
 	/*
 		Threads
 	*/
@@ -718,6 +906,24 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	ClientInterface m_clients;
 
 	std::unordered_map<session_t, std::string> m_formspec_state_data;
+	// Last formspec sent to each client: formname, formspec
+	std::unordered_map<session_t, std::pair<std::string, std::string>> m_last_sent_formspecs;
+
+	// HUD element stats changed by hudChange, by client: element id, stat
+	std::unordered_map<session_t, std::set<std::pair<u32, HudElementStat>>> m_hud_changes;
+	void sendHudChanges();
+
+	// Particle definitions known by a client, see TOCLIENT_PARTICLE_DEFINITION
+	struct ParticleDefinitions {
+		// id by serialized parameters
+		std::unordered_map<std::string, u16> ids;
+		// keys of ids, by id
+		std::vector<const std::string *> keys;
+		// id replaced next when all are used
+		u16 next_replaced = 0;
+	};
+	std::unordered_map<session_t, ParticleDefinitions> m_particle_definitions;
+	static constexpr u16 MAX_PARTICLE_DEFINITIONS = 256;
 
 	/*
 		Random stuff
@@ -746,6 +952,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 		This is behind m_env_mutex
 	*/
 	std::queue<MapEditEvent*> m_unsent_map_edit_queue;
+	// Blocks added by addEmergedBlock()
+	std::mutex m_emerged_blocks_mutex;
+	std::vector<v3s16> m_emerged_blocks;
 	/*
 		If a non-empty area, map edit events contained within are left
 		unsent. Done at map generation time to speed up editing of the
@@ -760,6 +969,7 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// pending dynamic media callbacks, clients inform the server when they have a file fetched
 	std::unordered_map<u32, PendingDynamicMediaCallback> m_pending_dyn_media;
 	float m_step_pending_dyn_media_timer = 0.0f;
+	float m_peer_metrics_timer = 0.0f;
 
 	/*
 		Sounds
@@ -768,6 +978,20 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	s32 m_playing_sounds_id_last_used = 0; // positive values only
 	s32 nextSoundId();
 
+	// Ephemeral sounds recently sent to a client
+	struct EphemeralSounds {
+		u32 sent_this_step = 0;
+		// by sound name and node position, uptime when sent
+		std::unordered_map<std::string, double> recent;
+	};
+	std::unordered_map<session_t, EphemeralSounds> m_ephemeral_sounds;
+	u32 m_max_ephemeral_sounds_per_step = 0;
+	float m_ephemeral_sound_coalesce_time = 0.0f;
+	// Removes the clients that can't hear the sound, or have just heard it
+	void filterEphemeralSound(const ServerPlayingSound &params, v3f pos,
+		bool positional, std::vector<session_t> &dst_clients);
+	void stepEphemeralSounds();
+
 	ModStorageDatabase *m_mod_storage_database = nullptr;
 	float m_mod_storage_save_timer = 10.0f;
 
@@ -793,6 +1017,34 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	MetricCounterPtr m_packet_recv_counter;
 	MetricCounterPtr m_packet_recv_processed_counter;
 	MetricCounterPtr m_map_edit_event_counter;
+	MetricCounterPtr m_buffer_heap_counter;
+	MetricCounterPtr m_buffer_reused_counter;
+	// BLOCKDATA before and after compression, of the blocks serialized
+	// for sending ([0] = uncompressed, [1] = compressed)
+	MetricCounterPtr m_blockdata_bytes_counter[2];
+	// by ToClientCommand, created when the first packet is sent
+	MetricCounterPtr m_sent_packets_counter[TOCLIENT_NUM_MSG_TYPES];
+	MetricCounterPtr m_sent_bytes_counter[TOCLIENT_NUM_MSG_TYPES];
+
+	// Durations of the phases of AsyncRunStep
+	std::unique_ptr<StepPhaseProfiler> m_step_phase_profiler;
+	// Updated together with the map timers
+	std::unique_ptr<MemoryStats> m_memory_stats;
+	// totals at the last step
+	bufferpool::Stats m_buffer_pool_stats;
+
+	struct PeerMetrics {
+		MetricGaugePtr window;
+		MetricGaugePtr in_flight;
+		MetricGaugePtr bandwidth;
+		MetricGaugePtr min_rtt;
+		MetricGaugePtr queued;
+		MetricCounterPtr sent_packets;
+		MetricCounterPtr sent_bytes;
+	};
+	std::unordered_map<session_t, PeerMetrics> m_peer_metrics;
+	// by mod name
+	std::unordered_map<std::string, MetricCounterPtr> m_mod_time_counters;
 };
 
 /*
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 // Copyright (C) 2010-2018 nerzhul, Loic BLOT <loic.blot@unix-experience.fr>
 
+#include <algorithm>
+#include <cmath>
 #include <log.h>
 #include "mapblock.h"
 #include "profiler.h"
@@ -10,6 +12,15 @@
 namespace server
 {
 
+// Range queries are mostly a few nodes large
+static constexpr f32 GRID_CELL_SIZE = 16 * BS;
+
+ActiveObjectMgr::ActiveObjectMgr(SpatialIndexType type)
+{
+	if (type == SPATIAL_INDEX_GRID)
+		m_spatial_index.emplace<SpatialHashGrid<3, f32, u16>>(GRID_CELL_SIZE);
+}
+
 ActiveObjectMgr::~ActiveObjectMgr()
 {
 	if (!m_active_objects.empty()) {
@@ -77,8 +88,18 @@ bool ActiveObjectMgr::registerObject(std::unique_ptr<ServerActiveObject> obj)
 	}
 
 	auto obj_id = obj->getId();
+	const bool is_player = obj->getType() == ACTIVEOBJECT_TYPE_PLAYER;
 	m_active_objects.put(obj_id, std::move(obj));
-	m_spatial_index.insert(pos.toArray(), obj_id);
+	std::visit([&](auto &index) {
+		index.insert(pos.toArray(), obj_id);
+	}, m_spatial_index);
+	if (is_player) {
+		m_player_objects.insert(obj_id);
+	} else {
+		const v3s16 cellpos = getInterestCellPos(pos);
+		m_object_cells[obj_id] = cellpos;
+		addToInterestCell(cellpos, obj_id);
+	}
 
 	auto new_size = m_active_objects.size();
 	verbosestream << "Server::ActiveObjectMgr::addActiveObjectRaw(): "
@@ -102,7 +123,14 @@ void ActiveObjectMgr::removeObject(u16 id)
 		infostream << "Server::ActiveObjectMgr::removeObject(): "
 				<< "id=" << id << " not found" << std::endl;
 	} else {
-		m_spatial_index.remove(id);
+		std::visit([&](auto &index) { index.remove(id); }, m_spatial_index);
+		auto it = m_object_cells.find(id);
+		if (it != m_object_cells.end()) {
+			removeFromInterestCell(it->second, id);
+			m_object_cells.erase(it);
+		}
+		m_player_objects.erase(id);
+		m_managed_objects.erase(id);
 	}
 }
 
@@ -113,6 +141,17 @@ void ActiveObjectMgr::invalidateActiveObjectObserverCaches()
 		if (!obj)
 			continue;
 		obj->invalidateEffectiveObservers();
+
+		// Anything with observers is checked again for all players, so is
+		// anything that had observers before
+		const u16 id = active_object.first;
+		if (obj->m_observers || obj->getParent())
+			m_managed_objects.insert(id);
+		else if (m_managed_objects.erase(id) == 0)
+			continue;
+		auto it = m_object_cells.find(id);
+		if (it != m_object_cells.end())
+			changeInterestCell(it->second);
 	}
 }
 
@@ -121,8 +160,57 @@ void ActiveObjectMgr::updateObjectPos(u16 id, v3f pos)
 	// HACK defensively only update if we already know the object,
 	// otherwise we're still waiting to be inserted into the index
 	// (or have already been removed).
-	if (m_active_objects.get(id))
-		m_spatial_index.update(pos.toArray(), id);
+	if (m_active_objects.get(id)) {
+		std::visit([&](auto &index) {
+			index.update(pos.toArray(), id);
+		}, m_spatial_index);
+
+		auto it = m_object_cells.find(id);
+		if (it == m_object_cells.end())
+			return;
+		const v3s16 cellpos = getInterestCellPos(pos);
+		if (cellpos != it->second) {
+			removeFromInterestCell(it->second, id);
+			addToInterestCell(cellpos, id);
+			it->second = cellpos;
+		}
+	}
+}
+
+v3s16 ActiveObjectMgr::getInterestCellPos(v3f pos)
+{
+	const f32 size = MAP_BLOCKSIZE * BS;
+	const auto cell = [size] (f32 p) {
+		return (s16)rangelim(std::floor(p / size), -S16_MAX, S16_MAX);
+	};
+	return v3s16(cell(pos.X), cell(pos.Y), cell(pos.Z));
+}
+
+void ActiveObjectMgr::addToInterestCell(v3s16 cellpos, u16 id)
+{
+	m_interest_cells[cellpos].objects.push_back(id);
+	changeInterestCell(cellpos);
+}
+
+void ActiveObjectMgr::removeFromInterestCell(v3s16 cellpos, u16 id)
+{
+	auto it = m_interest_cells.find(cellpos);
+	assert(it != m_interest_cells.end());
+	std::vector<u16> &objects = it->second.objects;
+	auto obj_it = std::find(objects.begin(), objects.end(), id);
+	assert(obj_it != objects.end());
+	*obj_it = objects.back();
+	objects.pop_back();
+	if (objects.empty())
+		m_interest_cells.erase(it);
+	else
+		changeInterestCell(cellpos);
+}
+
+void ActiveObjectMgr::changeInterestCell(v3s16 cellpos)
+{
+	// Unique, so that a removed and added cell never has an old version
+	m_interest_cells[cellpos].version = ++m_interest_version;
 }
 
 void ActiveObjectMgr::getObjectsInsideRadius(v3f pos, float radius,
@@ -130,7 +218,7 @@ void ActiveObjectMgr::getObjectsInsideRadius(v3f pos, float radius,
 		std::function<bool(ServerActiveObject *obj)> include_obj_cb)
 {
 	float r_squared = radius * radius;
-	m_spatial_index.rangeQuery((pos - v3f(radius)).toArray(), (pos + v3f(radius)).toArray(), [&](auto objPos, u16 id) {
+	const auto cb = [&](auto objPos, u16 id) {
 		if (v3f(objPos).getDistanceFromSQ(pos) > r_squared)
 			return;
 
@@ -139,65 +227,106 @@ void ActiveObjectMgr::getObjectsInsideRadius(v3f pos, float radius,
 			return;
 		if (!include_obj_cb || include_obj_cb(obj))
 			result.push_back(obj);
-	});
+	};
+	const auto min = (pos - v3f(radius)).toArray();
+	const auto max = (pos + v3f(radius)).toArray();
+	std::visit([&](const auto &index) {
+		index.rangeQuery(min, max, cb);
+	}, m_spatial_index);
 }
 
 void ActiveObjectMgr::getObjectsInArea(const aabb3f &box,
 		std::vector<ServerActiveObject *> &result,
 		std::function<bool(ServerActiveObject *obj)> include_obj_cb)
 {
-	m_spatial_index.rangeQuery(box.MinEdge.toArray(), box.MaxEdge.toArray(), [&](auto _, u16 id) {
+	const auto cb = [&](auto _, u16 id) {
 		auto obj = m_active_objects.get(id).get();
 		if (!obj)
 			return;
 		if (!include_obj_cb || include_obj_cb(obj))
 			result.push_back(obj);
-	});
+	};
+	std::visit([&](const auto &index) {
+		index.rangeQuery(box.MinEdge.toArray(), box.MaxEdge.toArray(), cb);
+	}, m_spatial_index);
 }
 
 void ActiveObjectMgr::getAddedActiveObjectsAroundPos(
 		v3f player_pos, const std::string &player_name,
 		f32 radius, f32 player_radius,
 		const std::set<u16> &current_objects,
-		std::vector<u16> &added_objects)
+		std::vector<u16> &added_objects,
+		std::unordered_map<v3s16, u32> *seen_cells)
 {
 	/*
-		Go through the object list,
+		Go through the objects of the cells in range and the players,
 		- discard removed/deactivated objects,
 		- discard objects that are too far away,
 		- discard objects that are found in current_objects,
 		- discard objects that are not observed by the player.
 		- add remaining objects to added_objects
 	*/
-	for (auto &ao_it : m_active_objects.iter()) {
-		u16 id = ao_it.first;
-
-		// Get object
-		ServerActiveObject *object = ao_it.second.get();
+	const auto check_object = [&] (u16 id) {
+		ServerActiveObject *object = m_active_objects.get(id).get();
 		if (!object)
-			continue;
+			return;
 
 		if (object->isGone())
-			continue;
+			return;
 
 		f32 distance_f = object->getBasePosition().getDistanceFrom(player_pos);
 		if (object->getType() == ACTIVEOBJECT_TYPE_PLAYER) {
 			// Discard if too far
 			if (distance_f > player_radius && player_radius != 0)
-				continue;
+				return;
 		} else if (distance_f > radius)
-			continue;
+			return;
 
 		if (!object->isEffectivelyObservedBy(player_name))
-			continue;
+			return;
 
 		// Discard if already on current_objects
 		auto n = current_objects.find(id);
 		if (n != current_objects.end())
-			continue;
+			return;
 		// Add to added_objects
 		added_objects.push_back(id);
+	};
+
+	for (u16 id : m_player_objects)
+		check_object(id);
+
+	std::unordered_map<v3s16, u32> now_seen;
+	const f32 radius_sq = radius * radius;
+	const f32 size = MAP_BLOCKSIZE * BS;
+	for (const auto &it : m_interest_cells) {
+		// with some room for rounding errors
+		const v3f min = v3f(it.first.X, it.first.Y, it.first.Z) * size - v3f(1);
+		const v3f max = min + v3f(size + 2);
+		const v3f nearest(rangelim(player_pos.X, min.X, max.X),
+			rangelim(player_pos.Y, min.Y, max.Y),
+			rangelim(player_pos.Z, min.Z, max.Z));
+		if (nearest.getDistanceFromSQ(player_pos) > radius_sq)
+			continue;
+
+		const v3f farthest(
+			player_pos.X < (min.X + max.X) / 2 ? max.X : min.X,
+			player_pos.Y < (min.Y + max.Y) / 2 ? max.Y : min.Y,
+			player_pos.Z < (min.Z + max.Z) / 2 ? max.Z : min.Z);
+		if (seen_cells && farthest.getDistanceFromSQ(player_pos) <= radius_sq) {
+			const u32 version = it.second.version;
+			now_seen.emplace(it.first, version);
+			auto seen = seen_cells->find(it.first);
+			if (seen != seen_cells->end() && seen->second == version)
+				continue;
+		}
+
+		for (u16 id : it.second.objects)
+			check_object(id);
 	}
+
+	if (seen_cells)
+		seen_cells->swap(now_seen);
 }
 
 } // namespace server
@@ -5,16 +5,28 @@
 #pragma once
 
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
 #include <vector>
 #include "../activeobjectmgr.h"
 #include "serveractiveobject.h"
 #include "util/k_d_tree.h"
+#include "util/spatial_grid.h"
 
 namespace server
 {
 class ActiveObjectMgr final : public ::ActiveObjectMgr<ServerActiveObject>
 {
 public:
+	enum SpatialIndexType {
+		// forest of k-d trees, fastest queries
+		SPATIAL_INDEX_KD_TREE,
+		// uniform grid, fastest updates
+		SPATIAL_INDEX_GRID,
+	};
+
+	ActiveObjectMgr(SpatialIndexType type = SPATIAL_INDEX_KD_TREE);
 	~ActiveObjectMgr() override;
 
 	// If cb returns true, the obj will be deleted
@@ -24,6 +36,8 @@ class ActiveObjectMgr final : public ::ActiveObjectMgr<ServerActiveObject>
 	bool registerObject(std::unique_ptr<ServerActiveObject> obj) override;
 	void removeObject(u16 id) override;
 
+	// Must be called after observers or attachments were changed,
+	// before getAddedActiveObjectsAroundPos() is called again
 	void invalidateActiveObjectObserverCaches();
 
 	void updateObjectPos(u16 id, v3f pos);
@@ -34,13 +48,42 @@ class ActiveObjectMgr final : public ::ActiveObjectMgr<ServerActiveObject>
 	void getObjectsInArea(const aabb3f &box,
 			std::vector<ServerActiveObject *> &result,
 			std::function<bool(ServerActiveObject *obj)> include_obj_cb);
+	// seen_cells: versions of the cells that were completely in range in
+	// the last call for this player, kept by the caller. Their objects were
+	// all added then, unless they were gone or not observed by the player,
+	// so they are skipped until the cell changes.
 	void getAddedActiveObjectsAroundPos(
 			v3f player_pos, const std::string &player_name,
 			f32 radius, f32 player_radius,
 			const std::set<u16> &current_objects,
-			std::vector<u16> &added_objects);
+			std::vector<u16> &added_objects,
+			std::unordered_map<v3s16, u32> *seen_cells = nullptr);
 
 private:
-	k_d_tree::DynamicKdTrees<3, f32, u16> m_spatial_index;
+	/*
+		Interest grid: objects other than players by mapblock-sized cell.
+		The version of a cell changes when objects enter or leave it, or when
+		the observers of one of its objects may have changed.
+	*/
+	struct InterestCell {
+		std::vector<u16> objects;
+		u32 version;
+	};
+
+	static v3s16 getInterestCellPos(v3f pos);
+	void addToInterestCell(v3s16 cellpos, u16 id);
+	void removeFromInterestCell(v3s16 cellpos, u16 id);
+	void changeInterestCell(v3s16 cellpos);
+
+	std::unordered_map<v3s16, InterestCell> m_interest_cells;
+	std::unordered_map<u16, v3s16> m_object_cells;
+	// Checked one by one, they have their own range
+	std::unordered_set<u16> m_player_objects;
+	// Objects that had observers or a parent in the last invalidation
+	std::unordered_set<u16> m_managed_objects;
+	u32 m_interest_version = 0;
+
+	std::variant<k_d_tree::DynamicKdTrees<3, f32, u16>,
+			SpatialHashGrid<3, f32, u16>> m_spatial_index;
 };
 } // namespace server
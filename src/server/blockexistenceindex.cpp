@@ -0,0 +1,126 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "blockexistenceindex.h"
+#include "database/database.h"
+#include "debug.h"
+#include "log.h"
+#include "porting.h"
+#include "servermap.h"
+
+// splitmix64 finalizer
+static inline u64 mix(u64 x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+BlockExistenceIndex::BlockExistenceIndex(MapDatabaseAccessor *db) :
+	Thread("BlockIndex"),
+	m_db(db)
+{
+	if (m_db)
+		start();
+}
+
+BlockExistenceIndex::~BlockExistenceIndex()
+{
+	// listing can't be interrupted
+	wait();
+}
+
+bool BlockExistenceIndex::mayExist(v3s16 pos)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_ready)
+		return true;
+
+	const u64 h = mix(MapDatabase::getBlockAsInteger(pos));
+	const u64 h1 = h, h2 = (h >> 32) | 1;
+	for (u32 i = 0; i < NUM_HASHES; i++) {
+		u64 bit = (h1 + i * h2) & m_mask;
+		if (!(m_bits[bit >> 6] & (1ULL << (bit & 63))))
+			return false;
+	}
+	return true;
+}
+
+void BlockExistenceIndex::add(v3s16 pos)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_ready)
+		insert(pos);
+	else
+		m_added.push_back(pos);
+}
+
+bool BlockExistenceIndex::isReady()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ready;
+}
+
+void BlockExistenceIndex::insert(v3s16 pos)
+{
+	const u64 h = mix(MapDatabase::getBlockAsInteger(pos));
+	const u64 h1 = h, h2 = (h >> 32) | 1;
+	for (u32 i = 0; i < NUM_HASHES; i++) {
+		u64 bit = (h1 + i * h2) & m_mask;
+		m_bits[bit >> 6] |= 1ULL << (bit & 63);
+	}
+}
+
+void BlockExistenceIndex::build(const std::vector<v3s16> &positions)
+{
+	// ~10 bits per block are enough for 1%, leave room for the world to grow
+	u64 nbits = 1 << 20;
+	while (nbits < positions.size() * 20)
+		nbits <<= 1;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bits.assign(nbits / 64, 0);
+	m_mask = nbits - 1;
+	for (v3s16 pos : positions)
+		insert(pos);
+	for (v3s16 pos : m_added)
+		insert(pos);
+	m_added.clear();
+	m_added.shrink_to_fit();
+	m_ready = true;
+}
+
+void *BlockExistenceIndex::run()
+{
+	BEGIN_DEBUG_EXCEPTION_HANDLER
+
+	const u64 start_time = porting::getTimeMs();
+	std::vector<v3s16> positions;
+	try {
+		// in chunks, so that the database isn't locked all the time
+		MapDatabase::ListCursor cursor, cursor_ro;
+		while (!cursor.done || (m_db->dbase_ro && !cursor_ro.done)) {
+			std::lock_guard<std::mutex> dblock(m_db->mutex);
+			if (!cursor.done)
+				m_db->dbase->listLoadableBlocks(cursor, LIST_CHUNK_SIZE, positions);
+			else
+				m_db->dbase_ro->listLoadableBlocks(cursor_ro, LIST_CHUNK_SIZE, positions);
+		}
+	} catch (std::exception &e) {
+		errorstream << "BlockExistenceIndex: listing blocks failed: "
+			<< e.what() << std::endl;
+		return nullptr;
+	}
+
+	build(positions);
+	infostream << "BlockExistenceIndex: indexed " << positions.size()
+		<< " blocks in " << (porting::getTimeMs() - start_time) << "ms" << std::endl;
+
+	END_DEBUG_EXCEPTION_HANDLER
+
+	return nullptr;
+}
@@ -0,0 +1,61 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "threading/thread.h"
+
+struct MapDatabaseAccessor;
+
+/*
+	Bloom filter over the positions of the blocks stored in the map
+	database, so that loading a block that was never saved doesn't have to
+	ask the database.
+
+	The filter is built in the background from listLoadableBlocks(),
+	until then every block may exist. Saved blocks must be added with add().
+	Deleted blocks simply stay in, which only costs a lookup.
+
+	Around 20 bits are used per block, for a false positive rate well below
+	one percent. Once more blocks were added than the filter was sized for,
+	it gets less precise but never wrong.
+*/
+class BlockExistenceIndex : public Thread
+{
+public:
+	BlockExistenceIndex(MapDatabaseAccessor *db);
+	~BlockExistenceIndex();
+
+	// false if the block is certainly not in the database
+	bool mayExist(v3s16 pos);
+
+	void add(v3s16 pos);
+
+	bool isReady();
+
+	void *run() override;
+
+	// for the unit test: builds the filter directly
+	void build(const std::vector<v3s16> &positions);
+
+private:
+	static constexpr u32 NUM_HASHES = 7;
+	static constexpr u32 LIST_CHUNK_SIZE = 10000;
+
+	void insert(v3s16 pos);
+
+	MapDatabaseAccessor *m_db;
+
+	std::mutex m_mutex;
+	bool m_ready = false;
+	std::vector<u64> m_bits;
+	// m_bits.size() * 64 - 1, a power of two minus one
+	u64 m_mask = 0;
+	// added while building
+	std::vector<v3s16> m_added;
+};
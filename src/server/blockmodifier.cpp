@@ -9,6 +9,8 @@
 #include "mapblock.h"
 #include "nodedef.h"
 #include "gamedef.h"
+#include "noise.h" // PcgRandom
+#include "threading/workerpool.h"
 
 /*
 	ABMs
@@ -30,12 +32,51 @@ struct ActiveABM
 	ActiveBlockModifier *abm;
 	std::vector<content_t> required_neighbors;
 	std::vector<content_t> without_neighbors;
+	// Bits of the neighbor sets in ABMHandler::m_neighbor_set_masks,
+	// 0 if there is no bit for a set
+	u32 required_bit = 0;
+	u32 without_bit = 0;
 	int chance;
 	s16 min_y, max_y;
 };
 
 #define CONTENT_TYPE_CACHE_MAX 64
 
+struct ABMMatch
+{
+	ActiveABM *aabm;
+	MapNode n;
+	v3s16 p0; // block-relative
+};
+
+struct ABMBlockScan
+{
+	MapBlock *block;
+	// 3x3x3 neighborhood of the block (index 13 is the block itself),
+	// nullptr if not loaded
+	MapBlock *neighbors[27];
+	u64 seed;
+	bool cached = false;
+	bool scanned = false;
+	std::vector<ABMMatch> matches;
+
+	MapNode getNode(v3s16 p0) const
+	{
+		if (p0.X >= 0 && p0.X < MAP_BLOCKSIZE && p0.Y >= 0 && p0.Y < MAP_BLOCKSIZE &&
+				p0.Z >= 0 && p0.Z < MAP_BLOCKSIZE)
+			return block->getNodeNoCheck(p0);
+		v3s16 bp = getContainerPos(p0, MAP_BLOCKSIZE);
+		MapBlock *b = neighbors[(bp.Z + 1) * 9 + (bp.Y + 1) * 3 + (bp.X + 1)];
+		if (!b)
+			return MapNode(CONTENT_IGNORE);
+		return b->getNodeNoCheck(p0 - bp * MAP_BLOCKSIZE);
+	}
+};
+
+/*
+	ABMHandler
+*/
+
 ABMHandler::ABMHandler(std::vector<ABMWithState> &abms,
 	float dtime_s, ServerEnvironment *env,
 	bool use_timers):
@@ -86,6 +127,9 @@ ABMHandler::ABMHandler(std::vector<ABMWithState> &abms,
 			ndef->getIds(s, aabm.without_neighbors);
 		SORT_AND_UNIQUE(aabm.without_neighbors);
 
+		aabm.required_bit = getNeighborSetBit(aabm.required_neighbors);
+		aabm.without_bit = getNeighborSetBit(aabm.without_neighbors);
+
 		// Trigger contents
 		std::vector<content_t> ids;
 		for (const auto &s : abm->getTriggerContents())
@@ -101,6 +145,26 @@ ABMHandler::ABMHandler(std::vector<ABMWithState> &abms,
 	}
 }
 
+u32 ABMHandler::getNeighborSetBit(const std::vector<content_t> &set)
+{
+	if (set.empty())
+		return 0;
+	auto it = std::find(m_neighbor_sets.begin(), m_neighbor_sets.end(), set);
+	if (it != m_neighbor_sets.end())
+		return 1U << (it - m_neighbor_sets.begin());
+	if (m_neighbor_sets.size() >= 32)
+		return 0;
+
+	const u32 bit = 1U << m_neighbor_sets.size();
+	m_neighbor_sets.push_back(set);
+	for (content_t c : set) {
+		if (c >= m_neighbor_set_masks.size())
+			m_neighbor_set_masks.resize(c + 1, 0);
+		m_neighbor_set_masks[c] |= bit;
+	}
+	return bit;
+}
+
 ABMHandler::~ABMHandler()
 {
 	for (auto &aabms : m_aabms)
@@ -130,27 +194,82 @@ u32 ABMHandler::countObjects(MapBlock *block, ServerMap *map, u32 &wider)
 	return active_object_count;
 }
 
-void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int &blocks_cached)
+// Checks the required and without neighbors of an ABM around p0.
+// get_content(p1) returns the content at the block-relative position p1.
+template <typename F>
+static bool checkNeighbors(const ActiveABM &aabm, v3s16 p0, const F &get_content)
 {
-	if (m_aabms.empty())
-		return;
+	const bool check_required_neighbors = !aabm.required_neighbors.empty();
+	const bool check_without_neighbors = !aabm.without_neighbors.empty();
+	if (!check_required_neighbors && !check_without_neighbors)
+		return true;
+
+	v3s16 p1;
+	bool have_required = false;
+	for(p1.X = p0.X-1; p1.X <= p0.X+1; p1.X++)
+	for(p1.Y = p0.Y-1; p1.Y <= p0.Y+1; p1.Y++)
+	for(p1.Z = p0.Z-1; p1.Z <= p0.Z+1; p1.Z++)
+	{
+		if (p1 == p0)
+			continue;
+		content_t c = get_content(p1);
+		if (check_required_neighbors && !have_required) {
+			if (CONTAINS(aabm.required_neighbors, c)) {
+				if (!check_without_neighbors)
+					return true;
+				have_required = true;
+			}
+		}
+		if (check_without_neighbors) {
+			if (CONTAINS(aabm.without_neighbors, c))
+				return false;
+		}
+	}
+	// No required neighbor found?
+	return have_required || !check_required_neighbors;
+}
 
+bool ABMHandler::checkContentCache(MapBlock *block, int &blocks_cached) const
+{
 	// Check the content type cache first
 	// to see whether there are any ABMs
 	// to be run at all for this block.
-	if (!block->contents.empty()) {
-		assert(!block->do_not_cache_contents); // invariant
-		blocks_cached++;
-		bool run_abms = false;
-		for (content_t c : block->contents) {
-			if (c < m_aabms.size() && m_aabms[c]) {
-				run_abms = true;
-				break;
-			}
-		}
-		if (!run_abms)
-			return;
+	if (block->contents.empty())
+		return true;
+
+	assert(!block->do_not_cache_contents); // invariant
+	blocks_cached++;
+	for (content_t c : block->contents) {
+		if (c < m_aabms.size() && m_aabms[c])
+			return true;
 	}
+	return false;
+}
+
+// Caches content types in the block as we go, returns false once there are
+// too many different nodes to cache
+static bool cacheContent(MapBlock *block, content_t c)
+{
+	if (CONTAINS(block->contents, c))
+		return true;
+	if (block->contents.size() >= CONTENT_TYPE_CACHE_MAX) {
+		// Too many different nodes... don't try to cache
+		block->do_not_cache_contents = true;
+		decltype(block->contents) empty;
+		std::swap(block->contents, empty);
+		return false;
+	}
+	block->contents.push_back(c);
+	return true;
+}
+
+void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int &blocks_cached)
+{
+	if (m_aabms.empty())
+		return;
+
+	if (!checkContentCache(block, blocks_cached))
+		return;
 	blocks_scanned++;
 
 	ServerMap *map = &m_env->getServerMap();
@@ -161,6 +280,16 @@ void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int
 
 	bool want_contents_cached = block->contents.empty() && !block->do_not_cache_contents;
 
+	auto get_content = [&] (v3s16 p1) -> content_t {
+		if (block->isValidPosition(p1)) {
+			// if the neighbor is found on the same map block
+			// get it straight from there
+			return block->getNodeNoCheck(p1).getContent();
+		}
+		// otherwise consult the map
+		return map->getNode(p1 + block->getPosRelative()).getContent();
+	};
+
 	v3s16 p0;
 	for(p0.Z=0; p0.Z<MAP_BLOCKSIZE; p0.Z++)
 	for(p0.Y=0; p0.Y<MAP_BLOCKSIZE; p0.Y++)
@@ -169,18 +298,8 @@ void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int
 		MapNode n = block->getNodeNoCheck(p0);
 		content_t c = n.getContent();
 
-		// Cache content types as we go
-		if (want_contents_cached && !CONTAINS(block->contents, c)) {
-			if (block->contents.size() >= CONTENT_TYPE_CACHE_MAX) {
-				// Too many different nodes... don't try to cache
-				want_contents_cached = false;
-				block->do_not_cache_contents = true;
-				decltype(block->contents) empty;
-				std::swap(block->contents, empty);
-			} else {
-				block->contents.push_back(c);
-			}
-		}
+		if (want_contents_cached)
+			want_contents_cached = cacheContent(block, c);
 
 		if (c >= m_aabms.size() || !m_aabms[c])
 			continue;
@@ -193,49 +312,8 @@ void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int
 			if (myrand() % aabm.chance != 0)
 				continue;
 
-			// Check neighbors
-			const bool check_required_neighbors = !aabm.required_neighbors.empty();
-			const bool check_without_neighbors = !aabm.without_neighbors.empty();
-			if (check_required_neighbors || check_without_neighbors) {
-				v3s16 p1;
-				bool have_required = false;
-				for(p1.X = p0.X-1; p1.X <= p0.X+1; p1.X++)
-				for(p1.Y = p0.Y-1; p1.Y <= p0.Y+1; p1.Y++)
-				for(p1.Z = p0.Z-1; p1.Z <= p0.Z+1; p1.Z++)
-				{
-					if (p1 == p0)
-						continue;
-					content_t c;
-					if (block->isValidPosition(p1)) {
-						// if the neighbor is found on the same map block
-						// get it straight from there
-						const MapNode &n = block->getNodeNoCheck(p1);
-						c = n.getContent();
-					} else {
-						// otherwise consult the map
-						MapNode n = map->getNode(p1 + block->getPosRelative());
-						c = n.getContent();
-					}
-					if (check_required_neighbors && !have_required) {
-						if (CONTAINS(aabm.required_neighbors, c)) {
-							if (!check_without_neighbors)
-								goto neighbor_found;
-							have_required = true;
-						}
-					}
-					if (check_without_neighbors) {
-						if (CONTAINS(aabm.without_neighbors, c))
-							goto neighbor_invalid;
-					}
-				}
-				if (have_required || !check_required_neighbors)
-					goto neighbor_found;
-				// No required neighbor found
-neighbor_invalid:
+			if (!checkNeighbors(aabm, p0, get_content))
 				continue;
-			}
-
-neighbor_found:
 
 			abms_run++;
 			// Call all the trigger variations
@@ -260,6 +338,214 @@ void ABMHandler::apply(MapBlock *block, int &blocks_scanned, int &abms_run, int
 	}
 }
 
+/*
+	For each node of a block, the neighbor sets that any of the nodes in its
+	3x3x3 neighborhood (including itself) belongs to, as bits.
+*/
+class NeighborSetMasks
+{
+	static constexpr s16 W = MAP_BLOCKSIZE + 2;
+
+	// of the block including a border of one node
+	std::vector<u32> m_masks;
+	std::vector<u32> m_tmp;
+
+	static u32 index(s16 x, s16 y, s16 z)
+	{
+		return ((z + 1) * W + (y + 1)) * W + (x + 1);
+	}
+
+public:
+	NeighborSetMasks() : m_masks(W * W * W), m_tmp(W * W * W) {}
+
+	void build(const ABMBlockScan &scan, const std::vector<u32> &set_masks)
+	{
+		auto mask_of = [&] (MapNode n) -> u32 {
+			content_t c = n.getContent();
+			return c < set_masks.size() ? set_masks[c] : 0;
+		};
+		for (s16 z = -1; z <= MAP_BLOCKSIZE; z++)
+		for (s16 y = -1; y <= MAP_BLOCKSIZE; y++)
+		for (s16 x = -1; x <= MAP_BLOCKSIZE; x++)
+			m_masks[index(x, y, z)] = mask_of(scan.getNode(v3s16(x, y, z)));
+
+		// Combine the neighbors one axis at a time
+		for (s16 z = -1; z <= MAP_BLOCKSIZE; z++)
+		for (s16 y = -1; y <= MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			const u32 i = index(x, y, z);
+			m_tmp[i] = m_masks[i - 1] | m_masks[i] | m_masks[i + 1];
+		}
+		for (s16 z = -1; z <= MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			const u32 i = index(x, y, z);
+			m_masks[i] = m_tmp[i - W] | m_tmp[i] | m_tmp[i + W];
+		}
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			const u32 i = index(x, y, z);
+			m_tmp[i] = m_masks[i - W * W] | m_masks[i] | m_masks[i + W * W];
+		}
+	}
+
+	u32 get(v3s16 p0) const
+	{
+		return m_tmp[index(p0.X, p0.Y, p0.Z)];
+	}
+};
+
+void ABMHandler::scanBlock(ABMBlockScan &scan)
+{
+	MapBlock *block = scan.block;
+
+	int blocks_cached = 0;
+	if (!checkContentCache(block, blocks_cached))
+		return;
+	scan.cached = blocks_cached > 0;
+	scan.scanned = true;
+
+	bool want_contents_cached = block->contents.empty() && !block->do_not_cache_contents;
+
+	PcgRandom pr(scan.seed);
+	auto get_content = [&] (v3s16 p1) -> content_t {
+		return scan.getNode(p1).getContent();
+	};
+
+	// Built once the first node needs its neighbors checked
+	thread_local NeighborSetMasks neighbor_masks;
+	bool have_neighbor_masks = false;
+
+	// Decides the neighbor conditions with the neighbor set masks where
+	// possible. They include the node itself, so that case needs the
+	// actual neighbors.
+	auto check_neighbors = [&] (const ActiveABM &aabm, v3s16 p0, content_t c) -> bool {
+		const bool need_required = !aabm.required_neighbors.empty();
+		const bool need_without = !aabm.without_neighbors.empty();
+		if (!need_required && !need_without)
+			return true;
+		const u32 bits = aabm.required_bit | aabm.without_bit;
+		const u32 self = c < m_neighbor_set_masks.size() ? m_neighbor_set_masks[c] : 0;
+		if ((need_required && !aabm.required_bit) ||
+				(need_without && !aabm.without_bit) || (self & bits))
+			return checkNeighbors(aabm, p0, get_content);
+
+		if (!have_neighbor_masks) {
+			neighbor_masks.build(scan, m_neighbor_set_masks);
+			have_neighbor_masks = true;
+		}
+		const u32 near = neighbor_masks.get(p0);
+		return (!need_required || (near & aabm.required_bit)) &&
+			!(near & aabm.without_bit);
+	};
+
+	v3s16 p0;
+	for(p0.Z=0; p0.Z<MAP_BLOCKSIZE; p0.Z++)
+	for(p0.Y=0; p0.Y<MAP_BLOCKSIZE; p0.Y++)
+	for(p0.X=0; p0.X<MAP_BLOCKSIZE; p0.X++)
+	{
+		MapNode n = block->getNodeNoCheck(p0);
+		content_t c = n.getContent();
+
+		if (want_contents_cached)
+			want_contents_cached = cacheContent(block, c);
+
+		if (c >= m_aabms.size() || !m_aabms[c])
+			continue;
+
+		s16 y = p0.Y + block->getPosRelative().Y;
+		for (ActiveABM &aabm : *m_aabms[c]) {
+			if (y < aabm.min_y || y > aabm.max_y)
+				continue;
+
+			if (pr.next() % aabm.chance != 0)
+				continue;
+
+			if (!check_neighbors(aabm, p0, c))
+				continue;
+
+			scan.matches.push_back({&aabm, n, p0});
+		}
+	}
+}
+
+void ABMHandler::applyScan(ABMBlockScan &scan, int &abms_run)
+{
+	MapBlock *block = scan.block;
+	if (scan.matches.empty() || block->isOrphan())
+		return;
+
+	ServerMap *map = &m_env->getServerMap();
+
+	u32 active_object_count_wider;
+	u32 active_object_count = countObjects(block, map, active_object_count_wider);
+	m_env->m_added_objects = 0;
+
+	for (const ABMMatch &match : scan.matches) {
+		// The node may have been changed by a previous ABM
+		MapNode n = block->getNodeNoCheck(match.p0);
+		if (n.getContent() != match.n.getContent())
+			continue;
+
+		v3s16 p = match.p0 + block->getPosRelative();
+		abms_run++;
+		// Call all the trigger variations
+		match.aabm->abm->trigger(m_env, p, n);
+		match.aabm->abm->trigger(m_env, p, n,
+			active_object_count, active_object_count_wider);
+
+		if (block->isOrphan())
+			return;
+
+		// Count surrounding objects again if the abms added any
+		if (m_env->m_added_objects > 0) {
+			active_object_count = countObjects(block, map, active_object_count_wider);
+			m_env->m_added_objects = 0;
+		}
+	}
+}
+
+void ABMHandler::applyParallel(WorkerPool *pool, const std::vector<MapBlock *> &blocks,
+	int &blocks_scanned, int &abms_run, int &blocks_cached)
+{
+	if (m_aabms.empty() || blocks.empty())
+		return;
+
+	ServerMap *map = &m_env->getServerMap();
+
+	// Everything that touches shared state (map lookups, the global random
+	// generator) is done here beforehand
+	std::vector<ABMBlockScan> scans(blocks.size());
+	for (size_t i = 0; i < blocks.size(); i++) {
+		ABMBlockScan &scan = scans[i];
+		scan.block = blocks[i];
+		scan.seed = ((u64)myrand() << 32) | myrand();
+		v3s16 bp = scan.block->getPos();
+		v3s16 d;
+		for (d.Z = -1; d.Z <= 1; d.Z++)
+		for (d.Y = -1; d.Y <= 1; d.Y++)
+		for (d.X = -1; d.X <= 1; d.X++) {
+			scan.neighbors[(d.Z + 1) * 9 + (d.Y + 1) * 3 + (d.X + 1)] =
+				d == v3s16(0, 0, 0) ? scan.block : map->getBlockNoCreateNoEx(bp + d);
+		}
+	}
+
+	pool->run(scans.size(), [&] (size_t i) {
+		scanBlock(scans[i]);
+	});
+
+	// Run the actions in the original block order
+	for (ABMBlockScan &scan : scans) {
+		if (scan.cached)
+			blocks_cached++;
+		if (!scan.scanned)
+			continue;
+		blocks_scanned++;
+		applyScan(scan, abms_run);
+	}
+}
+
 /*
 	LBMs
 */
@@ -471,39 +757,39 @@ void LBMManager::applyLBMs(ServerEnvironment *env, MapBlock *block,
 	// Collect a list of all LBMs and associated positions
 	std::unordered_map<content_t, LBMToRun> to_run;
 
+	// Look up the LBMs for each distinct content only
+	std::vector<content_t> contents;
+	block->getContents(contents);
+
 	// Note: the iteration count of this outer loop is typically very low, so it's ok.
 	for (auto it = getLBMsIntroducedAfter(stamp); it != m_lbm_lookup.end(); ++it) {
-		v3s16 pos;
-		content_t c;
+		for (content_t c : contents) {
+			if (auto *lbm_list = it->second.lookup(c))
+				to_run[c].insertLBMs(*lbm_list);
+		}
+	}
 
-		// Cache previous lookups since it has a high performance penalty.
+	if (to_run.empty())
+		return;
+
+	// Gather the positions of the nodes to run on
+	{
+		v3s16 pos;
 		content_t previous_c = CONTENT_IGNORE;
-		const LBMContentMapping::lbm_vector *lbm_list = nullptr;
 		LBMToRun *batch = nullptr;
-
+		bool first = true;
 		for (pos.Z = 0; pos.Z < MAP_BLOCKSIZE; pos.Z++)
 		for (pos.Y = 0; pos.Y < MAP_BLOCKSIZE; pos.Y++)
 		for (pos.X = 0; pos.X < MAP_BLOCKSIZE; pos.X++) {
-			c = block->getNodeNoCheck(pos).getContent();
-
-			bool c_changed = false;
-			if (previous_c != c) {
-				c_changed = true;
-				lbm_list = it->second.lookup(c);
-				if (lbm_list)
-					batch = &to_run[c]; // creates entry
+			content_t c = block->getNodeNoCheck(pos).getContent();
+			if (first || c != previous_c) {
+				auto it = to_run.find(c);
+				batch = it == to_run.end() ? nullptr : &it->second;
 				previous_c = c;
+				first = false;
 			}
-
-			if (!lbm_list)
-				continue;
-			batch->p.insert(pos);
-			if (c_changed) {
-				batch->insertLBMs(*lbm_list);
-			} else {
-				// we were here before so the list must be filled
-				assert(!batch->l.empty());
-			}
+			if (batch)
+				batch->p.insert(pos);
 		}
 	}
 
@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -61,12 +62,31 @@ struct ABMWithState
 };
 
 struct ActiveABM; // hidden
+struct ABMBlockScan; // hidden
+class WorkerPool;
 
 class ABMHandler
 {
 	ServerEnvironment *m_env;
 	// vector index = content_t
 	std::vector<std::vector<ActiveABM>*> m_aabms;
+	// Distinct sets of required and without neighbors, at most 32
+	std::vector<std::vector<content_t>> m_neighbor_sets;
+	// vector index = content_t, bit i is set if it is in m_neighbor_sets[i]
+	std::vector<u32> m_neighbor_set_masks;
+
+	// Returns the bit of a set of neighbors in m_neighbor_set_masks,
+	// 0 if the set is empty or there are too many sets.
+	u32 getNeighborSetBit(const std::vector<content_t> &set);
+
+	// Returns false if the content cache tells us that nothing is to be done
+	bool checkContentCache(MapBlock *block, int &blocks_cached) const;
+	// Scans a block for nodes to trigger on without calling any ABMs.
+	// Only reads from the map, so it is safe to call from multiple threads
+	// as long as nothing modifies the map meanwhile.
+	void scanBlock(ABMBlockScan &scan);
+	// Runs the ABM actions collected by scanBlock()
+	void applyScan(ABMBlockScan &scan, int &abms_run);
 
 public:
 	ABMHandler(std::vector<ABMWithState> &abms,
@@ -81,6 +101,14 @@ class ABMHandler
 	static u32 countObjects(MapBlock *block, ServerMap * map, u32 &wider);
 
 	void apply(MapBlock *block, int &blocks_scanned, int &abms_run, int &blocks_cached);
+
+	// Same as calling apply() for each block, except that the search for nodes
+	// to trigger on is done on the worker pool beforehand.
+	// Since all blocks are scanned first, neighbor conditions are evaluated
+	// against the state before any ABM of this batch ran. A match is skipped if
+	// its node was changed in between.
+	void applyParallel(WorkerPool *pool, const std::vector<MapBlock *> &blocks,
+		int &blocks_scanned, int &abms_run, int &blocks_cached);
 };
 
 /*
@@ -0,0 +1,152 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "blockprefetcher.h"
+#include <algorithm>
+#include "debug.h"
+#include "porting.h"
+#include "profiler.h"
+#include "servermap.h"
+
+BlockPrefetcher::BlockPrefetcher(MapDatabaseAccessor *db, size_t max_bytes) :
+	Thread("BlockPrefetch"),
+	m_db(db),
+	m_max_bytes(max_bytes)
+{
+	start();
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+	stop();
+	{
+		// make sure the thread either sees the stop request or is waiting
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_request_cv.notify_all();
+	wait();
+}
+
+void BlockPrefetcher::request(std::vector<v3s16> &&positions)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requested = std::move(positions);
+	// no need to read what we already have
+	m_requested.erase(std::remove_if(m_requested.begin(), m_requested.end(),
+		[this] (v3s16 p) {
+			return m_cache.find(p) != m_cache.end();
+		}), m_requested.end());
+	if (!m_requested.empty())
+		m_request_cv.notify_one();
+}
+
+bool BlockPrefetcher::take(v3s16 pos, std::string &data)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_cache.find(pos);
+	if (it == m_cache.end())
+		return false;
+
+	bool fresh = porting::getTimeMs() - it->second.time < MAX_AGE_MS;
+	if (fresh)
+		data = std::move(it->second.data);
+	m_bytes -= it->second.data.size();
+	m_cache.erase(it);
+	return fresh;
+}
+
+void BlockPrefetcher::invalidate(v3s16 pos)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_cache.find(pos);
+	if (it != m_cache.end()) {
+		m_bytes -= it->second.data.size();
+		m_cache.erase(it);
+	}
+	if (m_loading)
+		m_dropped.insert(pos);
+}
+
+size_t BlockPrefetcher::getCachedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bytes;
+}
+
+void BlockPrefetcher::insert(v3s16 pos, std::string &&data, u64 time)
+{
+	Entry &entry = m_cache[pos];
+	m_bytes -= entry.data.size();
+	m_bytes += data.size();
+	entry.data = std::move(data);
+	entry.time = time;
+	entry.seq = m_next_seq++;
+	m_order.emplace_back(pos, entry.seq);
+
+	while (m_bytes > m_max_bytes && !m_order.empty()) {
+		auto [p, seq] = m_order.front();
+		m_order.pop_front();
+		auto it = m_cache.find(p);
+		if (it == m_cache.end() || it->second.seq != seq)
+			continue;
+		m_bytes -= it->second.data.size();
+		m_cache.erase(it);
+	}
+	// entries taken or invalidated leave their position behind
+	while (!m_order.empty() && m_order.size() > 2 * m_cache.size() + BATCH_SIZE) {
+		auto [p, seq] = m_order.front();
+		m_order.pop_front();
+		auto it = m_cache.find(p);
+		if (it != m_cache.end() && it->second.seq == seq) {
+			// keep it, move to the back
+			m_order.emplace_back(p, seq);
+		}
+	}
+}
+
+void *BlockPrefetcher::run()
+{
+	BEGIN_DEBUG_EXCEPTION_HANDLER
+
+	std::vector<v3s16> batch;
+	std::vector<std::pair<v3s16, std::string>> results;
+	while (true) {
+		batch.clear();
+		results.clear();
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_request_cv.wait(lock, [this] {
+				return !m_requested.empty() || stopRequested();
+			});
+			if (stopRequested())
+				break;
+			size_t n = std::min(m_requested.size(), BATCH_SIZE);
+			batch.assign(m_requested.begin(), m_requested.begin() + n);
+			m_requested.erase(m_requested.begin(), m_requested.begin() + n);
+			m_loading = true;
+		}
+
+		{
+			ScopeProfiler sp(g_profiler, "BlockPrefetch: load blocks (sum)");
+			std::lock_guard<std::mutex> dblock(m_db->mutex);
+			m_db->loadBlocks(batch, [&] (v3s16 pos, std::string &data) {
+				results.emplace_back(pos, std::move(data));
+			});
+		}
+
+		const u64 now = porting::getTimeMs();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto &it : results) {
+			if (m_dropped.find(it.first) == m_dropped.end())
+				insert(it.first, std::move(it.second), now);
+		}
+		m_dropped.clear();
+		m_loading = false;
+		g_profiler->add("BlockPrefetch: prefetched blocks [#]", results.size());
+	}
+
+	END_DEBUG_EXCEPTION_HANDLER
+
+	return nullptr;
+}
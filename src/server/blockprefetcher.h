@@ -0,0 +1,82 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "threading/thread.h"
+
+struct MapDatabaseAccessor;
+
+/*
+	Reads mapblocks from the map database ahead of time, so that emerge
+	threads don't have to wait for the database when they get to them.
+
+	Only the serialized data is kept, it is deserialized by whoever takes
+	it. Blocks that are not in the database are remembered too, so they can
+	be generated right away.
+
+	The cache holds up to max_bytes of data, the oldest entries are dropped
+	first. Entries also expire after a while and must be invalidated when
+	the block is written, so that a block is never loaded in an outdated
+	state.
+*/
+class BlockPrefetcher : public Thread
+{
+public:
+	BlockPrefetcher(MapDatabaseAccessor *db, size_t max_bytes);
+	~BlockPrefetcher();
+
+	// Replaces the requests that were not started yet
+	void request(std::vector<v3s16> &&positions);
+
+	// Takes the prefetched data of a block, empty if it is not in the database
+	bool take(v3s16 pos, std::string &data);
+
+	// Forgets a block that was written or deleted
+	void invalidate(v3s16 pos);
+
+	size_t getCachedBytes();
+
+	void *run() override;
+
+private:
+	// Maximum number of blocks read in one go
+	static constexpr size_t BATCH_SIZE = 64;
+	static constexpr u64 MAX_AGE_MS = 10000;
+
+	struct Entry {
+		std::string data;
+		u64 time;
+		// identifies the entry in m_order
+		u64 seq;
+	};
+
+	void insert(v3s16 pos, std::string &&data, u64 time);
+
+	MapDatabaseAccessor *m_db;
+	const size_t m_max_bytes;
+
+	std::mutex m_mutex;
+	// signaled when something is requested
+	std::condition_variable m_request_cv;
+	std::vector<v3s16> m_requested;
+	std::unordered_map<v3s16, Entry> m_cache;
+	// insertion order for eviction, entries that are gone are skipped
+	std::deque<std::pair<v3s16, u64>> m_order;
+	size_t m_bytes = 0;
+	u64 m_next_seq = 0;
+	// invalidated while being read, the result must be dropped
+	bool m_loading = false;
+	std::unordered_set<v3s16> m_dropped;
+};
@@ -12,15 +12,19 @@
 #include "serialization.h" // SER_FMT_VER_INVALID
 #include "settings.h"
 #include "mapblock.h"
+#include "server.h"
 #include "serverenvironment.h"
 #include "map.h"
+#include "servermap.h"
 #include "emerge.h"
 #include "server/luaentity_sao.h"
 #include "server/player_sao.h"
 #include "log.h"
+#include "util/serialize.h"
 #include "util/srp.h"
 #include "util/string.h"
 #include "face_position_cache.h"
+#include "profiler.h"
 
 static std::string string_sanitize_ascii(const std::string &s, u32 max_length)
 {
@@ -83,6 +87,12 @@ static LuaEntitySAO *getAttachedObject(PlayerSAO *sao, ServerEnvironment *env)
 	return ao == sao ? nullptr : dynamic_cast<LuaEntitySAO*>(ao);
 }
 
+// Runs on the emerge thread
+static void on_block_emerged(v3s16 blockpos, EmergeAction action, void *param)
+{
+	static_cast<Server *>(param)->addEmergedBlock(blockpos);
+}
+
 void RemoteClient::GetNextBlocks (
 		ServerEnvironment *env,
 		EmergeManager * emerge,
@@ -101,6 +111,7 @@ void RemoteClient::GetNextBlocks (
 				<< std::endl;
 		m_map_send_completion_timer = 0.0f;
 		m_nearest_unsent_d = 0;
+		m_nearest_unsent_index = 0;
 	}
 
 	if (m_nothing_to_send_pause_timer >= 0)
@@ -183,8 +194,10 @@ void RemoteClient::GetNextBlocks (
 	/*
 		Get the starting value of the block finder radius.
 	*/
-	if (m_last_center != center) {
+	const bool center_changed = m_last_center != center;
+	if (center_changed) {
 		m_nearest_unsent_d = 0;
+		m_nearest_unsent_index = 0;
 		m_last_center = center;
 		m_map_send_completion_timer = 0.0f;
 	}
@@ -192,6 +205,7 @@ void RemoteClient::GetNextBlocks (
 	// (this matches isBlockInSight which allows for an extra 10%)
 	if (camera_dir.dotProduct(m_last_camera_dir) < std::cos(camera_fov * 0.1f)) {
 		m_nearest_unsent_d = 0;
+		m_nearest_unsent_index = 0;
 		m_last_camera_dir = camera_dir;
 		m_map_send_completion_timer = 0.0f;
 	}
@@ -218,6 +232,17 @@ void RemoteClient::GetNextBlocks (
 	s16 d_max_gen = std::min(adjustDist(m_max_gen_distance, prop_zoom_fov),
 		wanted_range);
 
+	// Blocks requested earlier may have gone out of range by now, don't
+	// let them hold up the emerge queue
+	if (center_changed) {
+		size_t cancelled = emerge->cancelBlockEmerges(peer_id, center, full_d_max);
+		if (cancelled > 0)
+			g_profiler->add("Server: cancelled emerges", cancelled);
+	}
+
+	if (playerspeed.getLength() > 1.0f * BS)
+		prefetchAhead(env, playerpos, playerspeed, camera_dir, full_d_max);
+
 	s16 d_max = full_d_max;
 
 	// Don't loop very much at a time
@@ -235,11 +260,14 @@ void RemoteClient::GetNextBlocks (
 
 	s32 nearest_emerged_d = -1;
 	s32 nearest_sent_d = -1;
+	size_t nearest_emerged_i = 0;
+	size_t nearest_sent_i = 0;
 	//bool queue_is_full = false;
 
 	const v3s16 cam_pos_nodes = floatToInt(camera_pos, BS);
 
 	s16 d;
+	size_t i = 0;
 	for (d = d_start; d <= d_max; d++) {
 		/*
 			Get the border/face dot coordinates of a "d-radiused"
@@ -247,8 +275,10 @@ void RemoteClient::GetNextBlocks (
 		*/
 		const auto &list = FacePositionCache::getFacePositions(d);
 
-		for (auto li = list.begin(); li != list.end(); ++li) {
-			v3s16 p = *li + center;
+		// Blocks before the resume index were sent, skipped or are still
+		// being emerged, the latter keep the index from advancing past them
+		for (i = d == d_start ? m_nearest_unsent_index : 0; i < list.size(); i++) {
+			v3s16 p = list[i] + center;
 
 			/*
 				Send throttling
@@ -356,16 +386,32 @@ void RemoteClient::GetNextBlocks (
 				Add inexistent block to emerge queue.
 			*/
 			if (want_emerge) {
-				if (nearest_emerged_d == -1)
+				if (nearest_emerged_d == -1) {
 					nearest_emerged_d = d;
-				if (emerge->enqueueBlockEmerge(peer_id, p, generate))
+					nearest_emerged_i = i;
+				}
+				// Only the first request registers for completion, the
+				// block is still queued when it is found again
+				bool queued;
+				if (m_blocks_emerging.find(p) == m_blocks_emerging.end()) {
+					queued = emerge->enqueueBlockEmergeEx(p, peer_id,
+						generate ? BLOCK_EMERGE_ALLOW_GEN : 0,
+						on_block_emerged, env->getGameDef());
+					if (queued)
+						m_blocks_emerging[p] = {dist, d >= d_opt};
+				} else {
+					queued = emerge->enqueueBlockEmerge(peer_id, p, generate);
+				}
+				if (queued)
 					continue;
 				else
 					goto queue_full_break;
 			}
 
-			if (nearest_sent_d == -1)
+			if (nearest_sent_d == -1) {
 				nearest_sent_d = d;
+				nearest_sent_i = i;
+			}
 
 			/*
 				Add block to send queue
@@ -379,8 +425,10 @@ void RemoteClient::GetNextBlocks (
 
 	// If nothing was found for sending and nothing was queued for
 	// emerging, continue next time browsing from here
+	size_t new_nearest_unsent_index = 0;
 	if (nearest_emerged_d != -1) {
 		new_nearest_unsent_d = nearest_emerged_d;
+		new_nearest_unsent_index = nearest_emerged_i;
 	} else {
 		if (d > full_d_max) {
 			new_nearest_unsent_d = 0;
@@ -390,18 +438,76 @@ void RemoteClient::GetNextBlocks (
 				<< "s, restarting" << std::endl;
 			m_map_send_completion_timer = 0.0f;
 		} else {
-			if (nearest_sent_d != -1)
+			if (nearest_sent_d != -1) {
 				new_nearest_unsent_d = nearest_sent_d;
-			else
+				new_nearest_unsent_index = nearest_sent_i;
+			} else {
 				new_nearest_unsent_d = d;
+				// i is only meaningful if the loop stopped inside of d
+				if (d <= d_max)
+					new_nearest_unsent_index = i;
+			}
 		}
 	}
 
-	if (new_nearest_unsent_d != -1 && m_nearest_unsent_d != new_nearest_unsent_d) {
-		m_nearest_unsent_d = new_nearest_unsent_d;
-		// if the distance has changed, clear the occlusion cache
-		m_blocks_occ.clear();
+	if (new_nearest_unsent_d != -1) {
+		if (m_nearest_unsent_d != new_nearest_unsent_d) {
+			m_nearest_unsent_d = new_nearest_unsent_d;
+			// if the distance has changed, clear the occlusion cache
+			m_blocks_occ.clear();
+		}
+		m_nearest_unsent_index = new_nearest_unsent_index;
+	}
+}
+
+void RemoteClient::prefetchAhead(ServerEnvironment *env, v3f playerpos,
+	v3f playerspeed, v3f camera_dir, s16 d_max)
+{
+	// Where the player will be in a while, shifted a bit towards where they look
+	constexpr float predict_time = 2.0f;
+	constexpr s16 radius = 2;
+	v3f predicted = playerpos + playerspeed * predict_time +
+		camera_dir * (2 * MAP_BLOCKSIZE * BS);
+	v3s16 center = getNodeBlockPos(floatToInt(predicted, BS));
+	if (center == m_last_prefetch_center)
+		return;
+	m_last_prefetch_center = center;
+
+	ServerMap &map = env->getServerMap();
+	std::vector<v3s16> positions;
+	for (s16 z = -radius; z <= radius; z++)
+	for (s16 y = -radius; y <= radius; y++)
+	for (s16 x = -radius; x <= radius; x++) {
+		v3s16 p = center + v3s16(x, y, z);
+		v3s16 d = p - m_last_center;
+		if (std::max({std::abs(d.X), std::abs(d.Y), std::abs(d.Z)}) > d_max)
+			continue;
+		if (blockpos_over_max_limit(p) || m_blocks_sent.count(p) ||
+				map.getBlockNoCreateNoEx(p))
+			continue;
+		positions.push_back(p);
 	}
+	map.prefetchBlocks(std::move(positions));
+}
+
+bool RemoteClient::takeEmergedBlock(v3s16 p, MapBlock *block, float *priority)
+{
+	auto it = m_blocks_emerging.find(p);
+	if (it == m_blocks_emerging.end())
+		return false;
+	const EmergingBlock emerging = it->second;
+	m_blocks_emerging.erase(it);
+
+	// Same checks as in GetNextBlocks()
+	if (!block || !block->isGenerated() || (emerging.skip_air && block->isAir()))
+		return false;
+	if (m_blocks_sending.count(p) || m_blocks_sent.count(p))
+		return false;
+	if (m_blocks_sending.size() >= m_max_simul_sends)
+		return false;
+
+	*priority = emerging.priority;
+	return true;
 }
 
 void RemoteClient::GotBlock(v3s16 p)
@@ -415,6 +521,20 @@ void RemoteClient::GotBlock(v3s16 p)
 	}
 }
 
+bool RemoteClient::useBlockHash(v3s16 p)
+{
+	return m_blocks_need_data.erase(p) == 0 && block_cache;
+}
+
+void RemoteClient::RequestBlockData(v3s16 p)
+{
+	// Only blocks on the way can be requested, this bounds the set
+	if (m_blocks_sending.count(p) == 0)
+		return;
+	m_blocks_need_data.insert(p);
+	SetBlockNotSent(p);
+}
+
 void RemoteClient::SentBlock(v3s16 p)
 {
 	if (!m_blocks_sending.insert(p).second)
@@ -441,7 +561,10 @@ void RemoteClient::SetBlockNotSent(v3s16 p, bool low_priority)
 			// will reset m_nearest_unsent_d to 0 anyway (see getNextBlocks).
 			p -= m_last_center;
 			s16 this_d = std::max({std::abs(p.X), std::abs(p.Y), std::abs(p.Z)});
-			m_nearest_unsent_d = std::min(m_nearest_unsent_d, this_d);
+			if (this_d <= m_nearest_unsent_d) {
+				m_nearest_unsent_d = this_d;
+				m_nearest_unsent_index = 0;
+			}
 		}
 	}
 }
@@ -752,26 +875,163 @@ void ClientInterface::send(session_t peer_id, NetworkPacket *pkt)
 	auto &ccf = clientCommandFactoryTable[pkt->getCommand()];
 	FATAL_ERROR_IF(!ccf.name, "packet type missing in table");
 
-	m_con->Send(peer_id, ccf.channel, pkt, ccf.reliable);
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	lockedSend(lockedGetClientNoEx(peer_id, CS_Invalid), peer_id, ccf.channel,
+		pkt, ccf.reliable, ccf.bundle);
 }
 
 void ClientInterface::sendCustom(session_t peer_id, u8 channel, NetworkPacket *pkt, bool reliable)
 {
 	// check table anyway to prevent mistakes
-	FATAL_ERROR_IF(!clientCommandFactoryTable[pkt->getCommand()].name,
-		"packet type missing in table");
+	auto &ccf = clientCommandFactoryTable[pkt->getCommand()];
+	FATAL_ERROR_IF(!ccf.name, "packet type missing in table");
+
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	lockedSend(lockedGetClientNoEx(peer_id, CS_Invalid), peer_id, channel,
+		pkt, reliable, ccf.bundle);
+}
+
+void ClientInterface::send(const std::vector<session_t> &peer_ids, NetworkPacket *pkt)
+{
+	auto &ccf = clientCommandFactoryTable[pkt->getCommand()];
+	FATAL_ERROR_IF(!ccf.name, "packet type missing in table");
 
-	m_con->Send(peer_id, channel, pkt, reliable);
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	std::vector<session_t> direct;
+	for (session_t peer_id : peer_ids) {
+		if (!lockedBundle(lockedGetClientNoEx(peer_id, CS_Invalid), ccf.channel,
+				pkt, ccf.reliable, ccf.bundle))
+			direct.push_back(peer_id);
+	}
+	m_con->SendToMany(direct, ccf.channel, pkt, ccf.reliable);
 }
 
 void ClientInterface::sendToAll(NetworkPacket *pkt, ClientState state_min)
 {
 	auto &ccf = clientCommandFactoryTable[pkt->getCommand()];
 	FATAL_ERROR_IF(!ccf.name, "packet type missing in table");
+
 	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	// The packet is serialized once for the clients it isn't bundled for
+	std::vector<session_t> direct;
 	for (auto &[peer_id, client] : m_clients) {
-		if (client->getState() >= state_min)
-			m_con->Send(peer_id, ccf.channel, pkt, ccf.reliable);
+		if (client->getState() >= state_min &&
+				!lockedBundle(client, ccf.channel, pkt, ccf.reliable, ccf.bundle))
+			direct.push_back(peer_id);
+	}
+	m_con->SendToMany(direct, ccf.channel, pkt, ccf.reliable);
+}
+
+void ClientInterface::getSendStats(SendStats &stats)
+{
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	stats = m_send_stats;
+}
+
+bool ClientInterface::getClientSendStats(session_t peer_id, u64 &packets,
+	u64 &bytes)
+{
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	RemoteClient *client = lockedGetClientNoEx(peer_id, CS_Invalid);
+	if (!client)
+		return false;
+	packets = client->m_sent_packets;
+	bytes = client->m_sent_bytes;
+	return true;
+}
+
+void ClientInterface::lockedSend(RemoteClient *client, session_t peer_id,
+	u8 channel, NetworkPacket *pkt, bool reliable, bool bundle)
+{
+	if (!lockedBundle(client, channel, pkt, reliable, bundle))
+		m_con->Send(peer_id, channel, pkt, reliable);
+}
+
+bool ClientInterface::lockedBundle(RemoteClient *client, u8 channel,
+	NetworkPacket *pkt, bool reliable, bool bundle)
+{
+	const u16 command = pkt->getCommand();
+	const u64 bytes = 2 + pkt->getSize();
+	if (command < TOCLIENT_NUM_MSG_TYPES) {
+		m_send_stats.packets[command]++;
+		m_send_stats.bytes[command] += bytes;
+	}
+	if (client) {
+		client->m_sent_packets++;
+		client->m_sent_bytes += bytes;
+	}
+
+	if (!client || channel >= ARRLEN(client->m_bundles))
+		return false;
+
+	std::string &pending = client->m_bundles[channel][reliable];
+	const size_t size = 2 + 2 + pkt->getSize();
+	if (!bundle || client->net_proto_version < 49 || size > BUNDLE_MAX_SIZE) {
+		// Packet order within a channel must not change
+		if (!pending.empty())
+			lockedFlushBundle(client, channel, reliable);
+		return false;
+	}
+
+	if (pending.size() + size > BUNDLE_MAX_SIZE)
+		lockedFlushBundle(client, channel, reliable);
+
+	char buf[4];
+	writeU16((u8 *)&buf[0], size - 2);
+	writeU16((u8 *)&buf[2], pkt->getCommand());
+	pending.append(buf, sizeof(buf));
+	if (pkt->getSize() > 0)
+		pending.append(pkt->getString(0), pkt->getSize());
+	return true;
+}
+
+void ClientInterface::lockedFlushBundle(RemoteClient *client, u8 channel,
+	bool reliable)
+{
+	if (client->m_bundles[channel][reliable].empty())
+		return;
+	std::string data;
+	data.swap(client->m_bundles[channel][reliable]);
+
+	if (reliable && (client->compression_mode & NETPROTO_COMPRESSION_ZSTD_STREAM)) {
+		// Even single packets go into the stream, as they are likely to
+		// resemble the ones sent before
+		auto &stream = client->m_bundle_streams[channel];
+		if (!stream) {
+			stream = std::make_unique<ZstdStreamCompressor>(
+				BUNDLE_COMPRESSION_LEVEL, NETPROTO_COMPRESSION_WINDOW_LOG);
+		}
+		std::string compressed(1, (char)channel);
+		stream->compress(data, compressed);
+		NetworkPacket pkt(TOCLIENT_COMPRESSED_BUNDLE, compressed.size(), client->peer_id);
+		pkt.putRawString(compressed);
+		m_con->Send(client->peer_id, channel, &pkt, reliable);
+		return;
+	}
+
+	const u16 first_size = readU16((const u8 *)data.data());
+	if (first_size + 2 == data.size()) {
+		// Just one packet, no need to wrap it
+		NetworkPacket pkt;
+		pkt.putRawPacket((const u8 *)data.data() + 2, first_size,
+			client->peer_id);
+		m_con->Send(client->peer_id, channel, &pkt, reliable);
+	} else {
+		NetworkPacket pkt(TOCLIENT_BUNDLE, data.size(), client->peer_id);
+		pkt.putRawString(data);
+		m_con->Send(client->peer_id, channel, &pkt, reliable);
+	}
+}
+
+void ClientInterface::flushBundles()
+{
+	RecursiveMutexAutoLock clientslock(m_clients_mutex);
+	for (auto &it : m_clients) {
+		RemoteClient *client = it.second;
+		for (u8 channel = 0; channel < ARRLEN(client->m_bundles); channel++) {
+			lockedFlushBundle(client, channel, false);
+			lockedFlushBundle(client, channel, true);
+		}
 	}
 }
 
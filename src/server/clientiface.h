@@ -9,6 +9,7 @@
 #include "network/address.h"
 #include "network/networkprotocol.h" // session_t
 #include "porting.h"
+#include "serialization.h" // ZstdStreamCompressor
 #include "threading/mutex_auto_lock.h"
 #include "clientdynamicinfo.h"
 
@@ -221,6 +222,20 @@ class RemoteClient
 	u8 serialization_version;
 	//
 	u16 net_proto_version = 0;
+	// The client keeps a block cache, see TOCLIENT_BLOCK_HASH
+	bool block_cache = false;
+
+	// Small packets to be sent as one TOCLIENT_BUNDLE, by channel and
+	// reliability. See ClientInterface::send().
+	std::string m_bundles[3][2];
+	// Chosen in TOCLIENT_HELLO, see NetProtoCompressionMode
+	u16 compression_mode = 0;
+	// Streams of the reliable bundles, by channel
+	std::unique_ptr<ZstdStreamCompressor> m_bundle_streams[3];
+
+	// Sent to the client, counting the command and payload of each packet
+	u64 m_sent_packets = 0;
+	u64 m_sent_bytes = 0;
 
 	/* Authentication information */
 	std::string enc_pwd = "";
@@ -247,6 +262,10 @@ class RemoteClient
 	void GetNextBlocks(ServerEnvironment *env, EmergeManager* emerge,
 			float dtime, std::vector<PrioritySortedBlockTransfer> &dest);
 
+	// A block that GetNextBlocks() queued for emerging is done, see
+	// Server::sendEmergedBlocks(). Returns false if it isn't to be sent now.
+	bool takeEmergedBlock(v3s16 p, MapBlock *block, float *priority);
+
 	void GotBlock(v3s16 p);
 
 	void SentBlock(v3s16 p);
@@ -254,6 +273,12 @@ class RemoteClient
 	void SetBlockNotSent(v3s16 p, bool low_priority = false);
 	void SetBlocksNotSent(const std::vector<v3s16> &blocks, bool low_priority = false);
 
+	// Whether the block may be sent as TOCLIENT_BLOCK_HASH.
+	// Call this once per send, it forgets RequestBlockData().
+	bool useBlockHash(v3s16 p);
+	// The client didn't have a block that was announced by its hash
+	void RequestBlockData(v3s16 p);
+
 	/**
 	 * tell client about this block being modified right now.
 	 * this information is required to requeue the block in case it's "on wire"
@@ -292,6 +317,25 @@ class RemoteClient
 		List of active objects that the client knows of.
 	*/
 	std::set<u16> m_known_objects;
+	// see server::ActiveObjectMgr::getAddedActiveObjectsAroundPos
+	std::unordered_map<v3s16, u32> m_known_object_cells;
+
+	/*
+		Known objects whose position updates are sent at a reduced rate
+	*/
+	struct ObjectUpdateState {
+		// Time since an update was last sent
+		float timer = 0;
+		// Latest update that wasn't sent yet
+		std::string pending;
+	};
+	std::unordered_map<u16, ObjectUpdateState> m_object_updates;
+
+	// Sequence number of the last TOCLIENT_OBJECT_MOVEMENT
+	u16 m_object_movement_seq = 0;
+	// Sequence number of the last TOSERVER_PLAYER_MOVE that was used
+	u16 m_player_move_seq = 0;
+	bool m_player_move_seq_valid = false;
 
 	ClientState getState() const { return m_state; }
 
@@ -365,8 +409,13 @@ class RemoteClient
 	std::unordered_set<v3s16> m_blocks_occ;
 
 	s16 m_nearest_unsent_d = 0;
+	// Index in the faces of distance m_nearest_unsent_d to resume the scan
+	// from, everything before it needs no further work for now
+	size_t m_nearest_unsent_index = 0;
 	v3s16 m_last_center;
 	v3f m_last_camera_dir;
+	// center of the blocks last handed to the prefetcher
+	v3s16 m_last_prefetch_center;
 
 	const u16 m_max_simul_sends;
 	const float m_min_time_from_building;
@@ -391,6 +440,23 @@ class RemoteClient
 	*/
 	std::unordered_set<v3s16> m_blocks_sending;
 
+	/*
+		Blocks that GetNextBlocks() queued for emerging, with the priority to
+		send them at. They are sent right when the emerge completes instead
+		of waiting to be found again.
+	*/
+	struct EmergingBlock {
+		float priority;
+		bool skip_air;
+	};
+	std::unordered_map<v3s16, EmergingBlock> m_blocks_emerging;
+
+	/*
+		Blocks that the client asked for with TOSERVER_REQUEST_BLOCKS.
+		These are sent with BLOCKDATA even if the client has a block cache.
+	*/
+	std::unordered_set<v3s16> m_blocks_need_data;
+
 	/*
 		Count of excess GotBlocks().
 		There is an excess amount because the client sometimes
@@ -424,6 +490,10 @@ class RemoteClient
 		time this client was created
 	 */
 	const u64 m_connection_time = porting::getTimeS();
+
+	// Asks the map to read the blocks the player is heading to
+	void prefetchAhead(ServerEnvironment *env, v3f playerpos, v3f playerspeed,
+		v3f camera_dir, s16 d_max);
 };
 
 typedef std::unordered_map<u16, RemoteClient*> RemoteClientMap;
@@ -457,9 +527,27 @@ class ClientInterface {
 	/* send to one client, deviating from the standard params */
 	void sendCustom(session_t peer_id, u8 channel, NetworkPacket *pkt, bool reliable);
 
+	/* send to several clients */
+	void send(const std::vector<session_t> &peer_ids, NetworkPacket *pkt);
+
 	/* send to all clients */
 	void sendToAll(NetworkPacket *pkt, ClientState state_min = CS_Active);
 
+	/* send packets that were held back for bundling */
+	void flushBundles();
+
+	struct SendStats {
+		// by ToClientCommand, counting the command and payload of each packet
+		u64 packets[TOCLIENT_NUM_MSG_TYPES] = {};
+		u64 bytes[TOCLIENT_NUM_MSG_TYPES] = {};
+	};
+
+	/* get the totals of everything sent since the start */
+	void getSendStats(SendStats &stats);
+
+	/* get the totals sent to one client, false if there's no such client */
+	bool getClientSendStats(session_t peer_id, u64 &packets, u64 &bytes);
+
 	/* delete a client */
 	void DeleteClient(session_t peer_id);
 
@@ -505,6 +593,21 @@ class ClientInterface {
 	/* update internal player list */
 	void UpdatePlayerList();
 
+	// Keeps the packet for the next TOCLIENT_BUNDLE if possible
+	// @note call with m_clients_mutex locked
+	void lockedSend(RemoteClient *client, session_t peer_id, u8 channel,
+		NetworkPacket *pkt, bool reliable, bool bundle);
+	// Returns false if the packet must be sent now, the bundle was sent before
+	// @note call with m_clients_mutex locked
+	bool lockedBundle(RemoteClient *client, u8 channel, NetworkPacket *pkt,
+		bool reliable, bool bundle);
+	void lockedFlushBundle(RemoteClient *client, u8 channel, bool reliable);
+
+	// Bundles are kept small enough to fit into one MTP packet
+	static constexpr size_t BUNDLE_MAX_SIZE = 480;
+	// Fast, the window of the stream does most of the work
+	static constexpr int BUNDLE_COMPRESSION_LEVEL = 1;
+
 	// Connection
 	std::shared_ptr<con::IConnection> m_con;
 
@@ -515,6 +618,8 @@ class ClientInterface {
 	// Connected clients (behind the mutex)
 	RemoteClientMap m_clients;
 	std::vector<std::string> m_clients_names; // for announcing to server list
+	// behind m_clients_mutex
+	SendStats m_send_stats;
 
 	// Environment
 	ServerEnvironment *m_env = nullptr;
@@ -0,0 +1,80 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "envlockstats.h"
+#include "util/tracy_wrapper.h"
+
+static const char *const site_names[ENV_LOCK_SITE_COUNT] = {
+	"other",
+	"step",
+	"packets",
+	"send_blocks",
+	"map_save",
+	"emerge",
+};
+
+EnvLockStats::EnvLockStats(MetricsBackend *mb)
+{
+	for (u8 i = 0; i < ENV_LOCK_SITE_COUNT; i++) {
+		Site &site = m_sites[i];
+		site.count_counter = mb->addCounter("minetest_core_env_lock_acquisitions",
+			"Number of times the environment mutex was locked",
+			{{"site", site_names[i]}});
+		site.wait_counter = mb->addCounter("minetest_core_env_lock_wait_seconds",
+			"Time spent waiting for the environment mutex (in seconds)",
+			{{"site", site_names[i]}});
+		site.hold_counter = mb->addCounter("minetest_core_env_lock_hold_seconds",
+			"Time the environment mutex was held (in seconds)",
+			{{"site", site_names[i]}});
+	}
+	m_waiters_gauge = mb->addGauge("minetest_core_env_lock_waiters",
+		"Highest number of threads waiting for the environment mutex at "
+		"once during the last server step");
+}
+
+const char *EnvLockStats::getName(EnvLockSite site)
+{
+	return site_names[site];
+}
+
+void EnvLockStats::startWaiting()
+{
+	const u32 waiters = m_waiters.fetch_add(1, std::memory_order_relaxed) + 1;
+	u32 max = m_max_waiters.load(std::memory_order_relaxed);
+	while (waiters > max && !m_max_waiters.compare_exchange_weak(max, waiters,
+			std::memory_order_relaxed)) {}
+}
+
+void EnvLockStats::stopWaiting()
+{
+	m_waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EnvLockStats::record(EnvLockSite site, u64 wait_us, u64 hold_us)
+{
+	Site &s = m_sites[site];
+	s.count.fetch_add(1, std::memory_order_relaxed);
+	s.wait_us.fetch_add(wait_us, std::memory_order_relaxed);
+	s.hold_us.fetch_add(hold_us, std::memory_order_relaxed);
+}
+
+void EnvLockStats::flush()
+{
+	for (Site &site : m_sites) {
+		const u64 count = site.count.exchange(0, std::memory_order_relaxed);
+		if (count == 0)
+			continue;
+		site.count_counter->increment(count);
+		site.wait_counter->increment(
+			site.wait_us.exchange(0, std::memory_order_relaxed) / 1e6);
+		site.hold_counter->increment(
+			site.hold_us.exchange(0, std::memory_order_relaxed) / 1e6);
+	}
+
+	// start over with the threads that are still waiting
+	const u32 max_waiters = m_max_waiters.exchange(
+		m_waiters.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_waiters_gauge->set(max_waiters);
+	TracyPlot("Env lock waiters", (int64_t)max_waiters);
+}
@@ -0,0 +1,67 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+#include "util/metricsbackend.h"
+
+// Where the environment mutex is taken, see Server::EnvAutoLock
+enum EnvLockSite : u8
+{
+	ENV_LOCK_OTHER,
+	// Server::AsyncRunStep
+	ENV_LOCK_STEP,
+	ENV_LOCK_PACKETS,
+	ENV_LOCK_SEND_BLOCKS,
+	ENV_LOCK_MAP_SAVE,
+	// emerge threads, including the callbacks of core.emerge_area()
+	ENV_LOCK_EMERGE,
+	ENV_LOCK_SITE_COUNT
+};
+
+/*
+	Counts how long the environment mutex is waited for and held, per call
+	site, and how many threads wait for it.
+
+	Recording only touches atomics and can be done by any thread. The values
+	are moved to the metrics backend by flush().
+*/
+class EnvLockStats
+{
+public:
+	EnvLockStats(MetricsBackend *mb);
+
+	DISABLE_CLASS_COPY(EnvLockStats)
+
+	// Around waiting for the mutex
+	void startWaiting();
+	void stopWaiting();
+
+	void record(EnvLockSite site, u64 wait_us, u64 hold_us);
+
+	// Called by the server thread once per step
+	void flush();
+
+	static const char *getName(EnvLockSite site);
+
+private:
+	struct Site {
+		std::atomic<u64> count{0};
+		std::atomic<u64> wait_us{0};
+		std::atomic<u64> hold_us{0};
+		MetricCounterPtr count_counter;
+		MetricCounterPtr wait_counter;
+		MetricCounterPtr hold_counter;
+	};
+
+	std::array<Site, ENV_LOCK_SITE_COUNT> m_sites;
+	std::atomic<u32> m_waiters{0};
+	// highest value of m_waiters since the last flush
+	std::atomic<u32> m_max_waiters{0};
+	MetricGaugePtr m_waiters_gauge;
+};
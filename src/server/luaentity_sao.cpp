@@ -14,13 +14,32 @@
 #include "serverenvironment.h"
 
 LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &data)
+	: LuaEntitySAO(env, pos, readStaticData(data))
+{
+}
+
+LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos, StaticData &&data)
 	: UnitSAO(env, pos)
 {
-	std::string name;
-	std::string state;
-	u16 hp = 1;
-	v3f velocity;
-	v3f rotation;
+	// create object
+	infostream << "LuaEntitySAO(name=\"" << data.name << "\" state is ";
+	if (data.state.empty())
+		infostream << "empty";
+	else
+		infostream << data.state.size() << " bytes";
+	infostream << ")" << std::endl;
+
+	m_init_name = std::move(data.name);
+	m_init_state = std::move(data.state);
+	m_hp = data.hp;
+	m_velocity = data.velocity;
+	m_rotation = data.rotation;
+	m_guid = data.new_guid ? env->getGUIDGenerator().next() : data.guid;
+}
+
+LuaEntitySAO::StaticData LuaEntitySAO::readStaticData(const std::string &data)
+{
+	StaticData result;
 
 	while (!data.empty()) { // breakable, run for one iteration
 		std::istringstream is(data, std::ios::binary);
@@ -29,16 +48,16 @@ LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &d
 		u8 version2 = 0;
 		u8 version = readU8(is);
 
-		name = deSerializeString16(is);
-		state = deSerializeString32(is);
+		result.name = deSerializeString16(is);
+		result.state = deSerializeString32(is);
 
 		if (version < 1)
 			break;
 
-		hp = readU16(is);
-		velocity = readV3F1000(is);
+		result.hp = readU16(is);
+		result.velocity = readV3F1000(is);
 		// yaw must be yaw to be backwards-compatible
-		rotation.Y = readF1000(is);
+		result.rotation.Y = readF1000(is);
 
 		if (is.good()) // EOF for old formats
 			version2 = readU8(is);
@@ -47,34 +66,22 @@ LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &d
 			break;
 
 		// version2 >= 1
-		rotation.X = readF1000(is);
-		rotation.Z = readF1000(is);
+		result.rotation.X = readF1000(is);
+		result.rotation.Z = readF1000(is);
 
 		if (version2 < 2) {
-			m_guid = env->getGUIDGenerator().next();
+			result.new_guid = true;
 			break;
 		}
 
-		m_guid.deSerialize(is);
+		result.guid.deSerialize(is);
 
 		// if (version2 < 3)
 		//     break;
 		// <read new values>
 		break;
 	}
-	// create object
-	infostream << "LuaEntitySAO(name=\"" << name << "\" state is ";
-	if (state.empty())
-		infostream << "empty";
-	else
-		infostream << state.size() << " bytes";
-	infostream << ")" << std::endl;
-
-	m_init_name = name;
-	m_init_state = state;
-	m_hp = hp;
-	m_velocity = velocity;
-	m_rotation = rotation;
+	return result;
 }
 
 LuaEntitySAO::LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &name,
@@ -155,7 +162,28 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 		sendPosition(false, true);
 	}
 
-	m_last_sent_position_timer += dtime;
+	// Entities that don't move and are far from players are only stepped
+	// every sleep_interval seconds, with the time that was skipped.
+	// Not moving, they don't need physics for that time.
+	float step_dtime = dtime;
+	if (m_prop.sleep_interval > 0 && !getParent() &&
+			m_velocity == v3f() && m_acceleration == v3f() &&
+			m_env->isFarFromPlayers(getBasePosition())) {
+		m_sleep_dtime += dtime;
+		if (m_sleep_dtime < m_prop.sleep_interval) {
+			if (send_recommended)
+				sendOutdatedData();
+			return;
+		}
+		step_dtime = m_sleep_dtime;
+		m_sleep_dtime = 0;
+	} else if (m_sleep_dtime > 0) {
+		// woken up
+		step_dtime += m_sleep_dtime;
+		m_sleep_dtime = 0;
+	}
+
+	m_last_sent_position_timer += step_dtime;
 
 	collisionMoveResult moveresult, *moveresult_p = nullptr;
 
@@ -176,7 +204,7 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 			moveresult = collisionMoveSimple(m_env, m_env->getGameDef(),
 					box, m_prop.stepheight, dtime,
 					&p_pos, &p_velocity, p_acceleration,
-					this, m_prop.collideWithObjects);
+					this, m_prop.collideWithObjects, &m_node_boxes);
 			moveresult_p = &moveresult;
 
 			// Apply results
@@ -207,12 +235,12 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 	}
 
 	if (std::abs(m_prop.automatic_rotate) > 0.001f) {
-		m_rotation_add_yaw = modulo360f(m_rotation_add_yaw + dtime * core::RADTODEG *
+		m_rotation_add_yaw = modulo360f(m_rotation_add_yaw + step_dtime * core::RADTODEG *
 				m_prop.automatic_rotate);
 	}
 
 	if(m_registered) {
-		m_env->getScriptIface()->luaentity_Step(m_id, dtime, moveresult_p);
+		m_env->getScriptIface()->luaentity_Step(m_id, step_dtime, moveresult_p);
 	}
 
 	if (!send_recommended)
@@ -242,6 +270,21 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 	sendOutdatedData();
 }
 
+CollisionNodeBoxes *LuaEntitySAO::prepareNodeBoxes(float dtime)
+{
+	// same conditions as in step()
+	if (isGone() || getParent() || !m_prop.physical)
+		return nullptr;
+
+	aabb3f box = m_prop.collisionbox;
+	box.MinEdge *= BS;
+	box.MaxEdge *= BS;
+	if (!collisionPrepareNodeBoxes(&m_env->getMap(), box, dtime,
+			getBasePosition(), m_velocity, m_acceleration, m_node_boxes))
+		return nullptr;
+	return &m_node_boxes;
+}
+
 std::string LuaEntitySAO::getClientInitializationData(u16 protocol_version)
 {
 	std::ostringstream os(std::ios::binary);
@@ -513,9 +556,12 @@ std::string LuaEntitySAO::getName()
 	return m_init_name;
 }
 
-std::string LuaEntitySAO::getPropertyPacket()
+const std::string &LuaEntitySAO::getPropertyPacket()
 {
-	return generateSetPropertiesCommand(m_prop);
+	if (m_property_packet.empty()) {
+		m_property_packet = generateSetPropertiesCommand(m_prop);
+	}
+	return m_property_packet;
 }
 
 void LuaEntitySAO::sendPosition(bool do_interpolate, bool is_movement_end)
@@ -547,7 +593,7 @@ void LuaEntitySAO::sendPosition(bool do_interpolate, bool is_movement_end)
 		update_interval
 	);
 	// create message and add to list
-	m_messages_out.emplace(getId(), false, str);
+	m_messages_out.emplace(getId(), false, str, ActiveObjectMessage::PRIO_STATE);
 }
 
 bool LuaEntitySAO::getCollisionBox(aabb3f *toset) const
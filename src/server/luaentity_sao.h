@@ -6,14 +6,29 @@
 #pragma once
 
 #include "unit_sao.h"
+#include "collision.h"
 #include "util/guid.h"
 
 class LuaEntitySAO : public UnitSAO
 {
 public:
+	// Contents of the static data
+	struct StaticData
+	{
+		std::string name;
+		std::string state;
+		u16 hp = 1;
+		v3f velocity;
+		v3f rotation;
+		MyGUID guid{};
+		// old data without a GUID
+		bool new_guid = false;
+	};
+
 	LuaEntitySAO() = delete;
 	// Used by the environment to load SAO
 	LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &data);
+	LuaEntitySAO(ServerEnvironment *env, v3f pos, StaticData &&data);
 	// Used by the Lua API
 	LuaEntitySAO(ServerEnvironment *env, v3f pos, const std::string &name,
 			const std::string &state);
@@ -23,11 +38,16 @@ class LuaEntitySAO : public UnitSAO
 	ActiveObjectType getSendType() const { return ACTIVEOBJECT_TYPE_GENERIC; }
 	virtual void addedToEnvironment(u32 dtime_s);
 	void step(float dtime, bool send_recommended);
+	// Looks up the blocks for the node collisions of the next step()
+	// Returns the boxes to gather, or nullptr if there is nothing to do.
+	CollisionNodeBoxes *prepareNodeBoxes(float dtime);
 	std::string getClientInitializationData(u16 protocol_version);
 
 	bool isStaticAllowed() const { return m_prop.static_save; }
 	bool shouldUnload() const { return true; }
 	void getStaticData(std::string *result) const;
+	// Doesn't use the environment, may be called on any thread
+	static StaticData readStaticData(const std::string &data);
 
 	u32 punch(v3f dir, const ToolCapabilities *toolcap = nullptr,
 			ServerActiveObject *puncher = nullptr,
@@ -74,7 +94,7 @@ class LuaEntitySAO : public UnitSAO
 	}
 
 private:
-	std::string getPropertyPacket();
+	const std::string &getPropertyPacket();
 	void sendPosition(bool do_interpolate, bool is_movement_end);
 	std::string generateSetTextureModCommand() const;
 	static std::string generateSetSpriteCommand(v2s16 p, u16 num_frames,
@@ -89,12 +109,18 @@ class LuaEntitySAO : public UnitSAO
 	v3f m_velocity;
 	v3f m_acceleration;
 
+	// Gathered by the environment ahead of step(), optional
+	CollisionNodeBoxes m_node_boxes;
+
 	v3f m_last_sent_position;
 	v3f m_last_sent_velocity;
 	v3f m_last_sent_rotation;
 	float m_last_sent_position_timer = 0.0f;
 	float m_last_sent_move_precision = 0.0f;
 
+	// time skipped while sleeping, see ObjectProperties::sleep_interval
+	float m_sleep_dtime = 0.0f;
+
 	std::string m_texture_modifier;
 	bool m_texture_modifier_sent = false;
 };
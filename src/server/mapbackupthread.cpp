@@ -0,0 +1,115 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "mapbackupthread.h"
+#include <algorithm>
+#include <chrono>
+#include "database/database.h"
+#include "debug.h"
+#include "exceptions.h"
+#include "filesys.h"
+#include "log.h"
+#include "porting.h"
+#include "servermap.h"
+#include "settings.h"
+
+MapBackupThread::MapBackupThread(MapDatabaseAccessor *db,
+		std::unique_ptr<MapDatabaseBackup> backup,
+		const std::string &world_dir, const std::string &dir) :
+	Thread("MapBackup"),
+	m_db(db),
+	m_backup(std::move(backup)),
+	m_world_dir(world_dir),
+	m_dir(dir)
+{
+	start();
+}
+
+MapBackupThread::~MapBackupThread()
+{
+	stop();
+	{
+		// make sure the thread either sees the stop request or is waiting
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_stop_cv.notify_all();
+	wait();
+}
+
+bool MapBackupThread::isDone()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_done;
+}
+
+void MapBackupThread::finish()
+{
+	// These are small and hardly ever change
+	const std::string files[] = {"map_meta.txt", "map_dict.zst"};
+	for (const auto &name : files) {
+		const std::string path = m_world_dir + DIR_DELIM + name;
+		if (fs::PathExists(path) &&
+				!fs::CopyFileContents(path, m_dir + DIR_DELIM + name)) {
+			errorstream << "MapBackupThread: failed to copy " << name << std::endl;
+		}
+	}
+
+	Settings world_mt;
+	if (!world_mt.readConfigFile((m_world_dir + DIR_DELIM + "world.mt").c_str()))
+		throw BaseException("Cannot read world.mt");
+	world_mt.set("backend", m_backup->getBackend());
+	world_mt.remove("pgsql_connection");
+	if (!world_mt.updateConfigFile((m_dir + DIR_DELIM + "world.mt").c_str()))
+		throw BaseException("Cannot write world.mt");
+}
+
+void *MapBackupThread::run()
+{
+	BEGIN_DEBUG_EXCEPTION_HANDLER
+
+	const u64 start_time = porting::getTimeMs();
+	bool done = false;
+	try {
+		while (!stopRequested() && !done) {
+			const u64 step_start = porting::getTimeMs();
+			{
+				std::lock_guard<std::mutex> dblock(m_db->mutex);
+				done = m_backup->step();
+			}
+			const u64 step_time = porting::getTimeMs() - step_start;
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop_cv.wait_for(lock,
+				std::chrono::milliseconds(std::max<u64>(step_time, 10)),
+				[this] { return stopRequested(); });
+		}
+		if (done)
+			finish();
+	} catch (std::exception &e) {
+		errorstream << "MapBackupThread: backup to " << m_dir << " failed: "
+			<< e.what() << std::endl;
+		done = false;
+	}
+
+	if (done) {
+		actionstream << "Map backup to " << m_dir << " done in "
+			<< (porting::getTimeMs() - start_time) / 1000 << "s" << std::endl;
+	} else if (stopRequested()) {
+		warningstream << "Map backup to " << m_dir << " was interrupted" << std::endl;
+	}
+	{
+		// it may use the connection of the database
+		std::lock_guard<std::mutex> dblock(m_db->mutex);
+		m_backup.reset();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done = true;
+	}
+
+	END_DEBUG_EXCEPTION_HANDLER
+
+	return nullptr;
+}
@@ -0,0 +1,50 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "threading/thread.h"
+
+struct MapDatabaseAccessor;
+class MapDatabaseBackup;
+
+/*
+	Copies the map database of the running server into another directory,
+	see MapDatabase::createBackup().
+
+	Every step of the copy is done with the database locked. Afterwards the
+	thread pauses at least as long as the step took, so saving and loading
+	blocks gets slower but is never starved.
+
+	world.mt is written into the directory last, an incomplete copy can't
+	be opened as world by accident.
+*/
+class MapBackupThread : public Thread
+{
+public:
+	MapBackupThread(MapDatabaseAccessor *db, std::unique_ptr<MapDatabaseBackup> backup,
+		const std::string &world_dir, const std::string &dir);
+	~MapBackupThread();
+
+	bool isDone();
+
+	void *run() override;
+
+private:
+	void finish();
+
+	MapDatabaseAccessor *m_db;
+	std::unique_ptr<MapDatabaseBackup> m_backup;
+	const std::string m_world_dir;
+	const std::string m_dir;
+
+	std::mutex m_mutex;
+	// signaled when the thread should stop
+	std::condition_variable m_stop_cv;
+	bool m_done = false;
+};
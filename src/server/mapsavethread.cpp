@@ -0,0 +1,215 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "mapsavethread.h"
+#include <sstream>
+#include "database/database.h"
+#include "debug.h"
+#include "log.h"
+#include "porting.h"
+#include "profiler.h"
+#include "serialization.h"
+#include "servermap.h"
+#include "threading/workerpool.h"
+#include "irrlicht_changes/printing.h"
+
+MapSaveThread::MapSaveThread(MapDatabaseAccessor *db, int compression_level,
+		size_t max_bytes, unsigned int compress_threads) :
+	Thread("MapSave"),
+	m_db(db),
+	m_compression_level(compression_level),
+	m_max_bytes(max_bytes)
+{
+	if (compress_threads > 0)
+		m_compress_pool = std::make_unique<WorkerPool>("MapSaveCompress", compress_threads);
+	start();
+}
+
+MapSaveThread::~MapSaveThread()
+{
+	flush();
+	stop();
+	{
+		// make sure the thread either sees the stop request or is waiting
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_queue_cv.notify_all();
+	wait();
+}
+
+void MapSaveThread::enqueue(v3s16 pos, u8 version, std::string &&raw,
+	const ZstdDictionary *dict)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// Backpressure: wait for the writer to catch up
+	if (m_bytes > m_max_bytes) {
+		ScopeProfiler sp(g_profiler, "ServerMap: save queue full (sum)");
+		m_done_cv.wait(lock, [this] { return m_bytes <= m_max_bytes; });
+	}
+
+	Job &job = m_pending[pos];
+	if (job.raw)
+		m_bytes -= job.raw->size();
+	m_bytes += raw.size();
+	job.raw = std::make_shared<const std::string>(std::move(raw));
+	job.dict = dict;
+	job.version = version;
+	job.seq = m_next_seq++;
+	if (!job.queued) {
+		job.queued = true;
+		m_queue.push_back(pos);
+		m_queue_cv.notify_one();
+	}
+}
+
+bool MapSaveThread::getPending(v3s16 pos, std::string &blob)
+{
+	std::shared_ptr<const std::string> raw;
+	const ZstdDictionary *dict;
+	u8 version;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_pending.find(pos);
+		if (it == m_pending.end())
+			return false;
+		raw = it->second.raw;
+		dict = it->second.dict;
+		version = it->second.version;
+	}
+	blob = makeBlob(version, *raw, m_compression_level, dict);
+	return true;
+}
+
+void MapSaveThread::cancel(v3s16 pos)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_pending.find(pos);
+	if (it == m_pending.end())
+		return;
+	// the position may stay in m_queue, the writer skips it
+	m_bytes -= it->second.raw->size();
+	m_pending.erase(it);
+	m_done_cv.notify_all();
+}
+
+void MapSaveThread::flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_cv.wait(lock, [this] { return m_pending.empty(); });
+}
+
+size_t MapSaveThread::getPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending.size();
+}
+
+size_t MapSaveThread::getPendingBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bytes;
+}
+
+std::string MapSaveThread::makeBlob(u8 version, const std::string &raw, int level,
+	const ZstdDictionary *dict)
+{
+	/*
+		[0] u8 serialization version
+		[1] data
+	*/
+	std::ostringstream o(std::ios_base::binary);
+	o.write((char*) &version, 1);
+	compress(raw, o, version, level, dict);
+	return o.str();
+}
+
+void *MapSaveThread::run()
+{
+	BEGIN_DEBUG_EXCEPTION_HANDLER
+
+	std::vector<std::pair<Item, std::shared_ptr<const std::string>>> todo;
+	std::vector<Item> batch;
+	while (true) {
+		todo.clear();
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queue_cv.wait(lock, [this] {
+				return !m_queue.empty() || stopRequested();
+			});
+			if (m_queue.empty())
+				break;
+
+			while (!m_queue.empty() && todo.size() < BATCH_SIZE) {
+				v3s16 pos = m_queue.front();
+				m_queue.pop_front();
+				auto it = m_pending.find(pos);
+				if (it == m_pending.end() || !it->second.queued)
+					continue; // cancelled
+				Job &job = it->second;
+				job.queued = false;
+				todo.emplace_back(Item{pos, job.seq, job.dict, job.version, {}}, job.raw);
+			}
+		}
+
+		// Compress without holding any locks
+		auto compress_item = [&] (size_t i) {
+			Item &item = todo[i].first;
+			item.blob = makeBlob(item.version, *todo[i].second, m_compression_level, item.dict);
+		};
+		if (m_compress_pool && todo.size() > 1) {
+			m_compress_pool->run(todo.size(), compress_item);
+		} else {
+			for (size_t i = 0; i < todo.size(); i++)
+				compress_item(i);
+		}
+		batch.clear();
+		for (auto &it : todo)
+			batch.push_back(std::move(it.first));
+		if (!batch.empty())
+			writeBatch(batch);
+	}
+
+	END_DEBUG_EXCEPTION_HANDLER
+
+	return nullptr;
+}
+
+void MapSaveThread::writeBatch(std::vector<Item> &batch)
+{
+	const u64 start_time = porting::getTimeUs();
+	u32 count = 0;
+
+	std::lock_guard<std::mutex> dblock(m_db->mutex);
+	MapDatabase *db = m_db->dbase;
+	db->beginSave();
+	for (Item &item : batch) {
+		{
+			// Skip blocks deleted since the batch was collected. Replaced
+			// ones are still written, the newer data follows later anyway.
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_pending.find(item.pos) == m_pending.end())
+				continue;
+		}
+		// cancel() can't run while we hold the database lock
+		if (!db->saveBlock(item.pos, item.blob)) {
+			errorstream << "MapSaveThread: Failed to save block "
+				<< item.pos << std::endl;
+		}
+		count++;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_pending.find(item.pos);
+		if (it != m_pending.end() && it->second.seq == item.seq) {
+			m_bytes -= it->second.raw->size();
+			m_pending.erase(it);
+		}
+	}
+	db->endSave();
+	m_done_cv.notify_all();
+
+	g_profiler->avg("ServerMap: async save batch [blocks]", count);
+	g_profiler->avg("ServerMap: async save batch [ms]",
+		(porting::getTimeUs() - start_time) / 1000.0f);
+}
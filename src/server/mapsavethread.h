@@ -0,0 +1,103 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "threading/thread.h"
+
+struct MapDatabaseAccessor;
+class ZstdDictionary;
+class WorkerPool;
+
+/*
+	Writes mapblocks to the map database in the background.
+
+	The env thread only hands over an uncompressed serialization of each
+	block (see MapBlock::serialize()), compressing and writing happens here.
+	Pending blocks are readable through getPending() so that a block that
+	is loaded again before it was written doesn't come back outdated.
+
+	enqueue() blocks while more than max_bytes of data is pending.
+	With compress_threads > 0 each batch is compressed in parallel.
+*/
+class MapSaveThread : public Thread
+{
+public:
+	MapSaveThread(MapDatabaseAccessor *db, int compression_level, size_t max_bytes,
+		unsigned int compress_threads = 0);
+	// Writes everything that is still pending
+	~MapSaveThread();
+
+	// Queues a block, replacing older pending data for the same position.
+	// raw: serialized block without the version byte and final compression
+	// dict: compression dictionary, must stay valid until the block is written
+	void enqueue(v3s16 pos, u8 version, std::string &&raw,
+		const ZstdDictionary *dict = nullptr);
+
+	// Gets pending data in the format stored in the database.
+	// @note call with the database mutex locked
+	bool getPending(v3s16 pos, std::string &blob);
+
+	// Drops pending data for a block that is being deleted.
+	// @note call with the database mutex locked
+	void cancel(v3s16 pos);
+
+	// Waits until all blocks queued so far are written
+	void flush();
+
+	size_t getPendingCount();
+	size_t getPendingBytes();
+
+	void *run() override;
+
+private:
+	// Maximum number of blocks written in one database transaction
+	static constexpr size_t BATCH_SIZE = 256;
+
+	struct Job {
+		std::shared_ptr<const std::string> raw;
+		const ZstdDictionary *dict;
+		u8 version;
+		// changes whenever the data is replaced
+		u64 seq;
+		bool queued;
+	};
+
+	struct Item {
+		v3s16 pos;
+		u64 seq;
+		const ZstdDictionary *dict;
+		u8 version;
+		std::string blob;
+	};
+
+	static std::string makeBlob(u8 version, const std::string &raw, int level,
+		const ZstdDictionary *dict);
+
+	void writeBatch(std::vector<Item> &batch);
+
+	MapDatabaseAccessor *m_db;
+	const int m_compression_level;
+	const size_t m_max_bytes;
+	std::unique_ptr<WorkerPool> m_compress_pool;
+
+	std::mutex m_mutex;
+	// signaled when something is queued
+	std::condition_variable m_queue_cv;
+	// signaled when something was written
+	std::condition_variable m_done_cv;
+	std::unordered_map<v3s16, Job> m_pending;
+	std::deque<v3s16> m_queue;
+	size_t m_bytes = 0;
+	u64 m_next_seq = 0;
+};
@@ -0,0 +1,227 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "mediahasher.h"
+#include <sstream>
+#include "filesys.h"
+#include "log.h"
+#include "network/networkprotocol.h"
+#include "threading/jobsystem.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "util/string.h"
+
+static const char *CACHE_HEADER = "MediaHashes 1";
+
+static bool decode_hex(const std::string &hex, std::string &data)
+{
+	if (hex.size() % 2 != 0)
+		return false;
+	data.resize(hex.size() / 2);
+	for (size_t i = 0; i < data.size(); i++) {
+		unsigned char high, low;
+		if (!hex_digit_decode(hex[2 * i], high) ||
+				!hex_digit_decode(hex[2 * i + 1], low))
+			return false;
+		data[i] = (char)((high << 4) | low);
+	}
+	return true;
+}
+
+bool is_media_filename_allowed(const std::string &filename)
+{
+	// If name contains illegal characters, ignore the file
+	if (!string_allowed(filename, TEXTURENAME_ALLOWED_CHARS)) {
+		warningstream << "Server: ignoring file as it has disallowed characters: \""
+				<< filename << "\"" << std::endl;
+		return false;
+	}
+
+	// If name is not in a supported format, ignore it
+	const char *supported_ext[] = {
+		".png", ".jpg", ".tga",
+		".ogg",
+		".x", ".b3d", ".obj", ".gltf", ".glb",
+		// Translation file formats
+		".tr", ".po", ".mo",
+		// Fonts
+		".ttf", ".woff",
+		NULL
+	};
+	if (removeStringEnd(filename, supported_ext).empty()) {
+		infostream << "Server: ignoring unsupported file extension: \""
+				<< filename << "\"" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool is_media_size_allowed(const std::string &filepath, u64 size)
+{
+	if (size == 0) {
+		errorstream << "Server::addMediaFile(): Empty file \""
+				<< filepath << "\"" << std::endl;
+		return false;
+	}
+	if (size > MEDIAFILE_MAX_SIZE) {
+		errorstream << "Server::addMediaFile(): \""
+				<< filepath << "\" is too big (" << (size >> 10)
+				<< "KiB). The internal limit is " << (MEDIAFILE_MAX_SIZE >> 10) << "KiB." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+MediaHasher::MediaHasher(const std::string &cache_path) :
+	MediaHasher(cache_path, &JobSystem::get())
+{
+}
+
+MediaHasher::MediaHasher(const std::string &cache_path, JobSystem *jobs) :
+	m_cache_path(cache_path),
+	m_jobs(jobs)
+{
+}
+
+MediaHasher::~MediaHasher()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this] { return m_pending == 0; });
+}
+
+void MediaHasher::start(const std::vector<std::string> &paths)
+{
+	loadCache();
+
+	for (const std::string &mediapath : paths) {
+		std::vector<fs::DirListNode> dirlist = fs::GetDirListing(mediapath);
+		for (const fs::DirListNode &dln : dirlist) {
+			if (dln.dir) // Ignore dirs (already in paths)
+				continue;
+			if (!is_media_filename_allowed(dln.name))
+				continue;
+
+			File file;
+			file.name = dln.name;
+			file.path = mediapath;
+			file.path.append(DIR_DELIM).append(dln.name);
+			m_files.push_back(std::move(file));
+		}
+	}
+	m_mtimes.assign(m_files.size(), 0);
+
+	m_waited = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending = m_files.size();
+	}
+	// The jobs only touch their own file
+	for (size_t i = 0; i < m_files.size(); i++)
+		m_jobs->submit([this, i] { hash(i); });
+}
+
+const std::vector<MediaHasher::File> &MediaHasher::wait()
+{
+	if (m_waited)
+		return m_files;
+	m_waited = true;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_pending == 0; });
+	}
+
+	// Files that are gone are removed from the cache too
+	if (m_cache_changed || m_cached_count != m_cache.size())
+		saveCache();
+	return m_files;
+}
+
+void MediaHasher::hash(size_t index)
+{
+	File &file = m_files[index];
+	bool cached = false;
+	u64 mtime = 0;
+	if (fs::GetFileSizeAndTime(file.path, file.size, mtime)) {
+		auto it = m_cache.find(file.path);
+		if (it != m_cache.end() && it->second.size == file.size &&
+				it->second.mtime == mtime) {
+			file.sha1_digest = it->second.sha1_digest;
+			cached = true;
+		}
+	}
+
+	if (!cached) {
+		std::string filedata;
+		if (fs::ReadFile(file.path, filedata, true)) {
+			file.size = filedata.size();
+			if (is_media_size_allowed(file.path, file.size))
+				file.sha1_digest = hashing::sha1(filedata);
+		}
+	}
+
+	if (!file.sha1_digest.empty())
+		m_mtimes[index] = mtime;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (cached) {
+		m_cached_count++;
+	} else if (!file.sha1_digest.empty()) {
+		m_hashed_count++;
+		m_cache_changed |= mtime != 0;
+	}
+	m_pending--;
+	if (m_pending == 0)
+		m_cv.notify_all();
+}
+
+void MediaHasher::loadCache()
+{
+	if (m_cache_path.empty())
+		return;
+	std::string data;
+	if (!fs::ReadFile(m_cache_path, data))
+		return;
+
+	std::istringstream is(data);
+	std::string line;
+	if (!std::getline(is, line) || line != CACHE_HEADER) {
+		infostream << "MediaHasher: ignoring " << m_cache_path << std::endl;
+		return;
+	}
+	// <SHA-1 in hex> <size> <mtime> <path>
+	while (std::getline(is, line)) {
+		std::istringstream ls(line);
+		std::string sha1_hex;
+		CacheEntry entry;
+		if (!(ls >> sha1_hex >> entry.size >> entry.mtime) || sha1_hex.size() != 40 ||
+				!decode_hex(sha1_hex, entry.sha1_digest))
+			continue;
+		ls.get();
+		std::string path;
+		std::getline(ls, path);
+		if (!path.empty())
+			m_cache[path] = std::move(entry);
+	}
+	verbosestream << "MediaHasher: " << m_cache.size() << " digests in "
+		<< m_cache_path << std::endl;
+}
+
+void MediaHasher::saveCache()
+{
+	if (m_cache_path.empty())
+		return;
+
+	std::ostringstream os;
+	os << CACHE_HEADER << "\n";
+	for (size_t i = 0; i < m_files.size(); i++) {
+		const File &file = m_files[i];
+		if (m_mtimes[i] == 0 || file.path.find('\n') != std::string::npos)
+			continue;
+		os << hex_encode(file.sha1_digest) << " " << file.size << " "
+			<< m_mtimes[i] << " " << file.path << "\n";
+	}
+	if (!fs::safeWriteToFile(m_cache_path, os.str()))
+		warningstream << "MediaHasher: couldn't write " << m_cache_path << std::endl;
+}
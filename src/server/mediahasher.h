@@ -0,0 +1,90 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+
+class JobSystem;
+
+// Log and return false if the server can't send such a media file
+bool is_media_filename_allowed(const std::string &filename);
+bool is_media_size_allowed(const std::string &filepath, u64 size);
+
+/*
+	Computes the SHA-1 digests of the media files of the server as jobs of the
+	JobSystem, so that the server thread can load the mods meanwhile.
+
+	The digests are kept in a file together with the size and modification
+	time of each file, so that unchanged files don't need to be read on the
+	next start.
+*/
+class MediaHasher
+{
+public:
+	struct File {
+		std::string name;
+		std::string path;
+		// raw, empty if the file can't be sent
+		std::string sha1_digest;
+		u64 size = 0;
+	};
+
+	// cache_path: file to keep the digests in, or empty for none
+	MediaHasher(const std::string &cache_path);
+	MediaHasher(const std::string &cache_path, JobSystem *jobs);
+	// Waits for the jobs
+	~MediaHasher();
+
+	DISABLE_CLASS_COPY(MediaHasher)
+
+	// Starts hashing the files in the paths, which are in descending priority
+	void start(const std::vector<std::string> &paths);
+
+	/*
+		Waits for the jobs and writes the cache. The files are in the order
+		of the paths, a name may appear several times.
+	*/
+	const std::vector<File> &wait();
+
+	// of the files of start(), available after wait()
+	u32 getCachedCount() const { return m_cached_count; }
+	u32 getHashedCount() const { return m_hashed_count; }
+
+private:
+	struct CacheEntry {
+		u64 size;
+		u64 mtime;
+		std::string sha1_digest;
+	};
+
+	void loadCache();
+	void saveCache();
+	void hash(size_t index);
+
+	const std::string m_cache_path;
+	JobSystem *m_jobs;
+
+	// read-only while jobs are running
+	std::unordered_map<std::string, CacheEntry> m_cache;
+
+	std::vector<File> m_files;
+	// modification times of the files with a digest, 0 if unknown
+	std::vector<u64> m_mtimes;
+	u32 m_cached_count = 0;
+	u32 m_hashed_count = 0;
+	bool m_waited = true;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	size_t m_pending = 0;
+	// the cache needs to be written
+	bool m_cache_changed = false;
+};
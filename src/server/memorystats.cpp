@@ -0,0 +1,44 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "memorystats.h"
+
+static const char *const subsystem_names[MEMORY_SUBSYSTEM_COUNT] = {
+	"mapblocks",
+	"node_metadata",
+	"static_objects",
+	"block_cache",
+	"network_buffers",
+	"lua_server",
+	"lua_async",
+	"lua_mapgen",
+};
+
+MemoryStats::MemoryStats(MetricsBackend *mb)
+{
+	for (u8 i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		m_gauges[i] = mb->addGauge("minetest_core_memory_bytes",
+			"Estimated memory used by a subsystem (in bytes)",
+			{{"subsystem", subsystem_names[i]}});
+	}
+}
+
+const char *MemoryStats::getName(MemorySubsystem subsystem)
+{
+	return subsystem_names[subsystem];
+}
+
+void MemoryStats::set(MemorySubsystem subsystem, size_t bytes)
+{
+	m_bytes[subsystem] = bytes;
+	m_gauges[subsystem]->set(bytes);
+}
+
+size_t MemoryStats::getTotal() const
+{
+	size_t total = 0;
+	for (size_t bytes : m_bytes)
+		total += bytes;
+	return total;
+}
@@ -0,0 +1,55 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+#include "util/metricsbackend.h"
+
+enum MemorySubsystem : u8
+{
+	// nodes and fixed size of the loaded mapblocks
+	MEMORY_MAPBLOCKS,
+	MEMORY_NODE_METADATA,
+	MEMORY_STATIC_OBJECTS,
+	// SerializedBlockCache of the block sending
+	MEMORY_BLOCK_CACHE,
+	// see util/bufferpool.h
+	MEMORY_NETWORK_BUFFERS,
+	// Lua heaps of the scripting environments
+	MEMORY_LUA_SERVER,
+	MEMORY_LUA_ASYNC,
+	MEMORY_LUA_MAPGEN,
+	MEMORY_SUBSYSTEM_COUNT
+};
+
+/*
+	Memory used by the big consumers of the server.
+
+	These are tracked sizes, not allocator statistics: each subsystem
+	estimates its usage from the sizes of its containers, so allocator
+	overhead and fragmentation are not included. The values are also
+	exported as gauges of the metrics backend.
+
+	Must only be used by the server thread.
+*/
+class MemoryStats
+{
+public:
+	MemoryStats(MetricsBackend *mb);
+
+	DISABLE_CLASS_COPY(MemoryStats)
+
+	void set(MemorySubsystem subsystem, size_t bytes);
+	size_t get(MemorySubsystem subsystem) const { return m_bytes[subsystem]; }
+	size_t getTotal() const;
+
+	static const char *getName(MemorySubsystem subsystem);
+
+private:
+	std::array<size_t, MEMORY_SUBSYSTEM_COUNT> m_bytes{};
+	std::array<MetricGaugePtr, MEMORY_SUBSYSTEM_COUNT> m_gauges;
+};
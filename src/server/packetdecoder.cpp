@@ -0,0 +1,182 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "server/packetdecoder.h"
+#include <chrono>
+#include <sstream>
+#include "debug.h"
+#include "exceptions.h"
+#include "log.h"
+#include "network/connection.h"
+#include "network/networkpacket.h"
+
+bool readFormspecFields(NetworkPacket *pkt, StringMap &fields)
+{
+	u16 field_count;
+	*pkt >> field_count;
+
+	size_t length = 0;
+	for (u16 k = 0; k < field_count; k++) {
+		std::string fieldname, fieldvalue;
+		*pkt >> fieldname;
+		fieldvalue = pkt->readLongString();
+
+		fieldname = sanitize_untrusted(fieldname, false);
+		// We'd love to strip escapes here but some formspec elements reflect data
+		// from the server (e.g. dropdown), which can contain translations.
+		fieldvalue = sanitize_untrusted(fieldvalue);
+
+		length += fieldname.size() + fieldvalue.size();
+
+		fields[std::move(fieldname)] = std::move(fieldvalue);
+	}
+
+	// 640K ought to be enough for anyone
+	return length < 640 * 1024;
+}
+
+void decodeCommand(NetworkPacket *pkt, DecodedCommand &cmd)
+{
+	switch (pkt->getCommand()) {
+	case TOSERVER_GOTBLOCKS: {
+		/*
+			[0] u16 command
+			[2] u8 count
+			[3] v3s16 pos_0
+			[3+6] v3s16 pos_1
+			...
+		*/
+		auto &got = cmd.data.emplace<DecodedGotBlocks>();
+		if (pkt->getSize() < 1)
+			return;
+		u8 count;
+		*pkt >> count;
+		got.blocks.resize(count);
+		for (v3s16 &p : got.blocks)
+			*pkt >> p;
+		return;
+	}
+	case TOSERVER_INTERACT: {
+		/*
+			[0] u16 command
+			[2] u8 action
+			[3] u16 item
+			[5] u32 length of the next item (plen)
+			[9] serialized PointedThing
+			[9 + plen] player position information
+		*/
+		auto &interact = cmd.data.emplace<DecodedInteract>();
+		*pkt >> (u8 &)interact.action;
+		*pkt >> interact.item;
+
+		std::istringstream tmp_is(pkt->readLongString(), std::ios::binary);
+		interact.pointed.deSerialize(tmp_is);
+		return;
+	}
+	case TOSERVER_NODEMETA_FIELDS: {
+		auto &fields = cmd.data.emplace<DecodedNodeMetaFields>();
+		*pkt >> fields.pos >> fields.formname;
+		fields.too_large = !readFormspecFields(pkt, fields.fields);
+		if (fields.too_large)
+			fields.fields.clear();
+		return;
+	}
+	case TOSERVER_INVENTORY_FIELDS: {
+		auto &fields = cmd.data.emplace<DecodedInventoryFields>();
+		*pkt >> fields.formname;
+		fields.too_large = !readFormspecFields(pkt, fields.fields);
+		if (fields.too_large)
+			fields.fields.clear();
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+PacketDecodeThread::PacketDecodeThread(con::IConnection *con) :
+	Thread("PacketDecode"),
+	m_con(con)
+{
+}
+
+PacketDecodeThread::~PacketDecodeThread()
+{
+	stop();
+	wait();
+}
+
+void PacketDecodeThread::pushPeerEvent(Item::Type type, session_t peer_id,
+	bool timeout)
+{
+	Item item;
+	item.type = type;
+	item.peer_id = peer_id;
+	item.timeout = timeout;
+	push(std::move(item));
+}
+
+void PacketDecodeThread::push(Item &&item)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	// Peer events are never held back, the connection waits for us
+	while (item.type == Item::PACKET && m_queue.size() >= MAX_QUEUED &&
+			!stopRequested())
+		m_space_cv.wait_for(lock, std::chrono::milliseconds(100));
+	m_queue.push_back(std::move(item));
+	m_queue_cv.notify_one();
+}
+
+bool PacketDecodeThread::pop(Item &item, u32 timeout_ms)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_queue_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+			[this] { return !m_queue.empty(); }))
+		return false;
+	item = std::move(m_queue.front());
+	m_queue.pop_front();
+	m_space_cv.notify_one();
+	return true;
+}
+
+size_t PacketDecodeThread::getQueueSize()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.size();
+}
+
+void *PacketDecodeThread::run()
+{
+	BEGIN_DEBUG_EXCEPTION_HANDLER
+
+	while (!stopRequested()) {
+		auto pkt = std::make_unique<NetworkPacket>();
+		try {
+			if (!m_con->ReceiveTimeoutMs(pkt.get(), 100))
+				continue;
+		} catch (const con::ConnectionBindFailed &e) {
+			Item item;
+			item.type = Item::BIND_FAILED;
+			item.error = e.what();
+			push(std::move(item));
+			break;
+		}
+
+		Item item;
+		item.type = Item::PACKET;
+		item.peer_id = pkt->getPeerId();
+		try {
+			decodeCommand(pkt.get(), item.cmd);
+		} catch (const BaseException &e) {
+			item.cmd.data = std::monostate();
+			item.cmd.error = e.what();
+		}
+		item.pkt = std::move(pkt);
+		push(std::move(item));
+	}
+
+	END_DEBUG_EXCEPTION_HANDLER
+
+	return nullptr;
+}
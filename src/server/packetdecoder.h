@@ -0,0 +1,139 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <variant>
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "network/networkprotocol.h" // session_t
+#include "threading/thread.h"
+#include "util/pointedthing.h"
+#include "util/string.h" // StringMap
+
+class NetworkPacket;
+
+namespace con {
+class IConnection;
+}
+
+/*
+	Pre-parsed forms of client commands whose parsing is costly enough to
+	be moved off the server thread. See decodeCommand().
+*/
+
+// TOSERVER_GOTBLOCKS
+struct DecodedGotBlocks {
+	std::vector<v3s16> blocks;
+};
+
+// TOSERVER_INTERACT, the player position part stays in the packet
+struct DecodedInteract {
+	InteractAction action;
+	u16 item;
+	PointedThing pointed;
+};
+
+// TOSERVER_NODEMETA_FIELDS
+struct DecodedNodeMetaFields {
+	v3s16 pos;
+	std::string formname;
+	StringMap fields;
+	// fields were dropped for being too large
+	bool too_large;
+};
+
+// TOSERVER_INVENTORY_FIELDS
+struct DecodedInventoryFields {
+	std::string formname;
+	StringMap fields;
+	// fields were dropped for being too large
+	bool too_large;
+};
+
+struct DecodedCommand {
+	std::variant<std::monostate, DecodedGotBlocks, DecodedInteract,
+		DecodedNodeMetaFields, DecodedInventoryFields> data;
+	// set if the packet could not be parsed
+	std::string error;
+
+	bool empty() const
+	{
+		return error.empty() && std::holds_alternative<std::monostate>(data);
+	}
+};
+
+// Parses the command of pkt if it has a pre-parsed form, leaving the read
+// offset after the parsed part. Throws like the NetworkPacket readers do.
+void decodeCommand(NetworkPacket *pkt, DecodedCommand &cmd);
+
+// Returns false if the fields exceed the size limit
+bool readFormspecFields(NetworkPacket *pkt, StringMap &fields);
+
+/*
+	Receives from the server's connection on its own thread and decodes
+	packets with decodeCommand(), so that the server thread only has to
+	apply them while holding the env lock.
+
+	Peer events are queued in the same order as the packets, the server
+	forwards them from its peer handler callbacks with pushPeerEvent().
+
+	Receiving stalls while more than MAX_QUEUED items wait, leaving the
+	rest to the connection's own queue.
+*/
+class PacketDecodeThread : public Thread
+{
+public:
+	struct Item {
+		enum Type : u8 {
+			NONE,
+			PACKET,
+			PEER_ADDED,
+			PEER_REMOVED,
+			BIND_FAILED,
+		};
+
+		Type type = NONE;
+		session_t peer_id = 0;
+		// PEER_REMOVED: peer timed out
+		bool timeout = false;
+		std::unique_ptr<NetworkPacket> pkt;
+		DecodedCommand cmd;
+		// BIND_FAILED: error message
+		std::string error;
+	};
+
+	PacketDecodeThread(con::IConnection *con);
+	~PacketDecodeThread();
+
+	// @note call from within the connection's peer handler
+	void pushPeerEvent(Item::Type type, session_t peer_id, bool timeout);
+
+	// Waits up to timeout_ms for the next item
+	bool pop(Item &item, u32 timeout_ms);
+
+	size_t getQueueSize();
+
+	void *run() override;
+
+private:
+	static constexpr size_t MAX_QUEUED = 1024;
+
+	void push(Item &&item);
+
+	con::IConnection *m_con;
+
+	std::mutex m_mutex;
+	// signaled when something is queued
+	std::condition_variable m_queue_cv;
+	// signaled when something is taken
+	std::condition_variable m_space_cv;
+	std::deque<Item> m_queue;
+};
@@ -0,0 +1,173 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "packetrecord.h"
+#include <cstring>
+#include "exceptions.h"
+#include "log.h"
+#include "porting.h"
+#include "network/networkexceptions.h"
+#include "network/networkpacket.h"
+#include "util/serialize.h"
+
+static const char RECORD_MAGIC[8] = {'L', 'T', 'P', 'K', 'T', 'R', 'E', 'C'};
+static constexpr u8 RECORD_VERSION = 1;
+
+void PacketRecord::toPacket(NetworkPacket &pkt) const
+{
+	std::string raw(2, '\0');
+	writeU16((u8 *)&raw[0], command);
+	raw += data;
+	pkt.clear();
+	pkt.putRawPacket((const u8 *)raw.data(), raw.size(), peer_id);
+}
+
+PacketRecorder::PacketRecorder(const std::string &path) :
+	m_os(path, std::ios::binary | std::ios::trunc),
+	m_start_us(porting::getTimeUs())
+{
+	if (!m_os.good()) {
+		errorstream << "PacketRecorder: couldn't open " << path << std::endl;
+		return;
+	}
+	m_os.write(RECORD_MAGIC, sizeof(RECORD_MAGIC));
+	writeU8(m_os, RECORD_VERSION);
+	actionstream << "Recording received packets to " << path << std::endl;
+}
+
+PacketRecorder::~PacketRecorder()
+{
+	flush();
+}
+
+void PacketRecorder::writeHeader(PacketRecord::Type type, u64 step, session_t peer_id)
+{
+	writeU8(m_os, type);
+	writeU64(m_os, step);
+	writeU64(m_os, porting::getTimeUs() - m_start_us);
+	writeU16(m_os, peer_id);
+}
+
+void PacketRecorder::peerAdded(u64 step, session_t peer_id, const Address &address)
+{
+	writeHeader(PacketRecord::PEER_ADDED, step, peer_id);
+	m_os << serializeString16(address.serializeString());
+	writeU16(m_os, address.getPort());
+}
+
+void PacketRecorder::peerRemoved(u64 step, session_t peer_id, bool timeout)
+{
+	writeHeader(PacketRecord::PEER_REMOVED, step, peer_id);
+	writeU8(m_os, timeout);
+}
+
+void PacketRecorder::packet(u64 step, const NetworkPacket &pkt)
+{
+	writeHeader(PacketRecord::PACKET, step, pkt.getPeerId());
+	writeU16(m_os, pkt.getCommand());
+	writeU32(m_os, pkt.getSize());
+	if (pkt.getSize() > 0)
+		m_os.write(pkt.getString(0), pkt.getSize());
+}
+
+void PacketRecorder::flush()
+{
+	m_os.flush();
+}
+
+ReplayConnection::ReplayConnection(const std::string &path) :
+	m_is(path, std::ios::binary)
+{
+	char magic[sizeof(RECORD_MAGIC)] = {};
+	m_is.read(magic, sizeof(magic));
+	if (!m_is.good() || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0) {
+		errorstream << "ReplayConnection: " << path
+			<< " is not a packet recording" << std::endl;
+		return;
+	}
+	const u8 version = readU8(m_is);
+	if (version != RECORD_VERSION) {
+		errorstream << "ReplayConnection: unsupported recording version "
+			<< (int)version << std::endl;
+		return;
+	}
+	m_opened = true;
+	readNext();
+}
+
+void ReplayConnection::readNext()
+{
+	m_have_next = false;
+	if (m_is.peek() == std::char_traits<char>::eof())
+		return;
+
+	PacketRecord &r = m_next;
+	try {
+		r.type = (PacketRecord::Type)readU8(m_is);
+		r.step = readU64(m_is);
+		r.time_us = readU64(m_is);
+		r.peer_id = readU16(m_is);
+		switch (r.type) {
+		case PacketRecord::PEER_ADDED: {
+			const std::string host = deSerializeString16(m_is);
+			const u16 port = readU16(m_is);
+			try {
+				r.address.Resolve(host.c_str());
+			} catch (const ResolveError &e) {
+				r.address = Address(127, 0, 0, 1, 0);
+			}
+			r.address.setPort(port);
+			break;
+		}
+		case PacketRecord::PEER_REMOVED:
+			r.timeout = readU8(m_is) != 0;
+			break;
+		case PacketRecord::PACKET:
+			r.command = readU16(m_is);
+			r.data = deSerializeString32(m_is);
+			break;
+		default:
+			throw SerializationError("unknown record type");
+		}
+	} catch (const SerializationError &e) {
+		// The recording server probably didn't shut down cleanly
+		warningstream << "ReplayConnection: recording ends with a broken record: "
+			<< e.what() << std::endl;
+		return;
+	}
+	if (!m_is.good()) {
+		warningstream << "ReplayConnection: recording ends with a truncated record"
+			<< std::endl;
+		return;
+	}
+	m_have_next = true;
+}
+
+bool ReplayConnection::pop(u64 step, PacketRecord &record)
+{
+	if (!m_have_next || m_next.step > step)
+		return false;
+
+	record = std::move(m_next);
+	m_next = PacketRecord();
+	if (record.type == PacketRecord::PEER_ADDED)
+		m_addresses[record.peer_id] = record.address;
+	readNext();
+	return true;
+}
+
+void ReplayConnection::Send(session_t peer_id, u8 channelnum, NetworkPacket *pkt,
+		bool reliable)
+{
+	m_sent_packets++;
+	m_sent_bytes += pkt->getSize();
+}
+
+Address ReplayConnection::GetPeerAddress(session_t peer_id)
+{
+	auto it = m_addresses.find(peer_id);
+	if (it == m_addresses.end())
+		throw con::PeerNotFoundException("No address for peer found!");
+	return it->second;
+}
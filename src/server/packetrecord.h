@@ -0,0 +1,125 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include "constants.h"
+#include "irrlichttypes.h"
+#include "network/address.h"
+#include "network/connection.h"
+#include "util/basic_macros.h"
+
+class NetworkPacket;
+
+/*
+	Something the server thread received, tagged with the number of the
+	server step after which it was processed.
+*/
+struct PacketRecord
+{
+	enum Type : u8 {
+		PEER_ADDED,
+		PEER_REMOVED,
+		PACKET,
+	};
+
+	Type type = PACKET;
+	u64 step = 0;
+	// since the start of the recording
+	u64 time_us = 0;
+	session_t peer_id = 0;
+	// PEER_ADDED
+	Address address;
+	// PEER_REMOVED: peer timed out
+	bool timeout = false;
+	// PACKET
+	u16 command = 0;
+	std::string data;
+
+	// Fills pkt like it was received from the connection
+	void toPacket(NetworkPacket &pkt) const;
+};
+
+/*
+	Writes everything the server thread receives to a file, so it can be
+	replayed with ReplayConnection.
+
+	Must only be used by the server thread.
+*/
+class PacketRecorder
+{
+public:
+	PacketRecorder(const std::string &path);
+	~PacketRecorder();
+
+	DISABLE_CLASS_COPY(PacketRecorder)
+
+	bool isOpen() const { return m_os.good(); }
+
+	void peerAdded(u64 step, session_t peer_id, const Address &address);
+	void peerRemoved(u64 step, session_t peer_id, bool timeout);
+	void packet(u64 step, const NetworkPacket &pkt);
+	// At the end of a step
+	void flush();
+
+private:
+	void writeHeader(PacketRecord::Type type, u64 step, session_t peer_id);
+
+	std::ofstream m_os;
+	const u64 m_start_us;
+};
+
+/*
+	Connection that doesn't talk to the network. The records of a recording
+	are taken by Server::replay() and everything sent is dropped.
+*/
+class ReplayConnection : public con::IConnection
+{
+public:
+	ReplayConnection(const std::string &path);
+
+	bool isOpen() const { return m_opened; }
+
+	// Takes the next record of a step up to the given one
+	bool pop(u64 step, PacketRecord &record);
+	bool isFinished() const { return !m_have_next; }
+
+	u64 getSentPackets() const { return m_sent_packets; }
+	u64 getSentBytes() const { return m_sent_bytes; }
+
+	void Serve(Address bind_addr) override {}
+	void Connect(Address address) override {}
+	bool Connected() override { return false; }
+	void Disconnect() override {}
+	void DisconnectPeer(session_t peer_id) override {}
+
+	bool ReceiveTimeoutMs(NetworkPacket *pkt, u32 timeout_ms) override { return false; }
+
+	void Send(session_t peer_id, u8 channelnum, NetworkPacket *pkt, bool reliable) override;
+
+	session_t GetPeerID() const override { return PEER_ID_SERVER; }
+	Address GetPeerAddress(session_t peer_id) override;
+	float getPeerStat(session_t peer_id, con::rtt_stat_type type) override { return 0; }
+	float getLocalStat(con::rate_stat_type type) override { return 0; }
+	bool getPeerCongestionStats(session_t peer_id, con::CongestionStats &stats) override
+	{
+		return false;
+	}
+
+private:
+	void readNext();
+
+	std::ifstream m_is;
+	bool m_opened = false;
+	bool m_have_next = false;
+	PacketRecord m_next;
+
+	// addresses of the peers that were added
+	std::unordered_map<session_t, Address> m_addresses;
+	u64 m_sent_packets = 0;
+	u64 m_sent_bytes = 0;
+};
@@ -0,0 +1,185 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "pathfinderpool.h"
+#include <algorithm>
+#include "debug.h"
+#include "dummymap.h"
+#include "gamedef.h"
+#include "log.h"
+#include "map.h"
+#include "mapblock.h"
+#include "profiler.h"
+#include "threading/jobsystem.h"
+#include "util/numeric.h"
+
+// About 16 MB for the copy of the area
+static constexpr s64 MAX_AREA_BLOCKS = 1024;
+
+// Blocks containing every node the search may look at
+static void get_search_blocks(const PathfinderPool::Request &request,
+		v3s32 &bpmin, v3s32 &bpmax)
+{
+	// anything larger covers the whole map anyway
+	const s32 distance = std::min(request.searchdistance, 65535U);
+	const s32 margin_xz = distance + 1;
+	// the pathfinder looks for the ground below the source and destination
+	const s32 margin_y = distance +
+		std::min(std::max(request.max_jump, request.max_drop), 65535U) + 1;
+	const v3s32 source(request.source.X, request.source.Y, request.source.Z);
+	const v3s32 destination(request.destination.X, request.destination.Y,
+		request.destination.Z);
+	const v3s32 margin(margin_xz, margin_y, margin_xz);
+	const auto block = [] (s32 n) {
+		n = rangelim(n, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT);
+		return (s32)getContainerPos((s16)n, MAP_BLOCKSIZE);
+	};
+	const v3s32 pmin = v3s32(std::min(source.X, destination.X),
+		std::min(source.Y, destination.Y), std::min(source.Z, destination.Z)) - margin;
+	const v3s32 pmax = v3s32(std::max(source.X, destination.X),
+		std::max(source.Y, destination.Y), std::max(source.Z, destination.Z)) + margin;
+	bpmin = v3s32(block(pmin.X), block(pmin.Y), block(pmin.Z));
+	bpmax = v3s32(block(pmax.X), block(pmax.Y), block(pmax.Z));
+}
+
+PathfinderPool::PathfinderPool(IGameDef *gamedef, unsigned int num_threads,
+		size_t max_jobs) :
+	PathfinderPool(gamedef, num_threads, max_jobs, &JobSystem::get())
+{
+}
+
+PathfinderPool::PathfinderPool(IGameDef *gamedef, unsigned int num_threads,
+		size_t max_jobs, JobSystem *jobs) :
+	m_gamedef(gamedef),
+	m_jobs(jobs),
+	m_num_threads(num_threads),
+	m_max_jobs(max_jobs)
+{
+}
+
+PathfinderPool::~PathfinderPool()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_stop = true;
+	m_cv.wait(lock, [this] { return m_busy == 0; });
+}
+
+u32 PathfinderPool::enqueue(const Request &request)
+{
+	if (m_queued.size() + m_started.size() >= m_max_jobs)
+		return 0;
+
+	v3s32 bpmin, bpmax;
+	get_search_blocks(request, bpmin, bpmax);
+	const v3s32 size = bpmax - bpmin + v3s32(1, 1, 1);
+	if ((s64)size.X * size.Y * size.Z > MAX_AREA_BLOCKS)
+		return 0;
+
+	Job job;
+	job.id = m_next_id++;
+	// 0 means failure
+	if (m_next_id == 0)
+		m_next_id = 1;
+	job.request = request;
+	m_queued.push_back(std::move(job));
+	return m_queued.back().id;
+}
+
+bool PathfinderPool::cancel(u32 id)
+{
+	auto it = std::find_if(m_queued.begin(), m_queued.end(),
+		[id] (const Job &job) { return job.id == id; });
+	if (it != m_queued.end()) {
+		m_queued.erase(it);
+		return true;
+	}
+	if (m_started.count(id) == 0)
+		return false;
+	return m_cancelled.insert(id).second;
+}
+
+void PathfinderPool::step(Map *map, std::vector<Result> &results)
+{
+	std::vector<Result> done;
+	size_t free_workers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		done.swap(m_done);
+		free_workers = m_num_threads - std::min(m_busy, m_num_threads);
+	}
+
+	for (Result &result : done) {
+		m_started.erase(result.id);
+		if (m_cancelled.erase(result.id) == 0)
+			results.push_back(std::move(result));
+	}
+
+	if (free_workers == 0 || m_queued.empty())
+		return;
+
+	// Copy the areas on this thread, the map isn't used anywhere else
+	std::vector<Job> jobs;
+	{
+		ScopeProfiler sp(g_profiler, "PathfinderPool: copy areas (sum)");
+		while (free_workers > 0 && !m_queued.empty()) {
+			Job job = std::move(m_queued.front());
+			m_queued.pop_front();
+			v3s32 bpmin, bpmax;
+			get_search_blocks(job.request, bpmin, bpmax);
+			job.vmanip = std::make_unique<MMVManip>(map);
+			job.vmanip->initialEmerge(v3s16(bpmin.X, bpmin.Y, bpmin.Z),
+				v3s16(bpmax.X, bpmax.Y, bpmax.Z), false);
+			m_started.insert(job.id);
+			jobs.push_back(std::move(job));
+			free_workers--;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_busy += jobs.size();
+	}
+	for (Job &job : jobs) {
+		// std::function needs a copyable callable
+		auto shared_job = std::make_shared<Job>(std::move(job));
+		m_jobs->submit([this, shared_job] { work(*shared_job); },
+			JOB_PRIORITY_LOW);
+	}
+}
+
+void PathfinderPool::work(Job &job)
+{
+	bool stop;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stop = m_stop;
+	}
+
+	Result result;
+	result.id = job.id;
+	if (!stop)
+		result.path = search(job);
+	job.vmanip.reset();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_done.push_back(std::move(result));
+	m_busy--;
+	m_cv.notify_all();
+}
+
+std::vector<v3s16> PathfinderPool::search(const Job &job)
+{
+	// Blocks that weren't loaded are left as ignore, like in the real map
+	const VoxelArea &area = job.vmanip->m_area;
+	DummyMap map(m_gamedef, getNodeBlockPos(area.MinEdge),
+		getNodeBlockPos(area.MaxEdge));
+	for (const auto &it : job.vmanip->getCoveredBlocks()) {
+		if (it.second)
+			map.getBlockNoCreateNoEx(it.first)->copyFrom(*job.vmanip);
+	}
+
+	const Request &r = job.request;
+	return get_path(&map, m_gamedef->ndef(), r.source, r.destination,
+		r.searchdistance, r.max_jump, r.max_drop, r.algo);
+}
@@ -0,0 +1,100 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include "irr_v3d.h"
+#include "pathfinder.h"
+#include "util/basic_macros.h"
+
+class IGameDef;
+class JobSystem;
+class Map;
+class MMVManip;
+
+/*
+	Runs the searches of core.find_path_async() as low priority jobs of the
+	JobSystem.
+
+	When fewer than num_threads searches run, the area the next search may
+	look at is copied from the map on the server thread and the search runs
+	on the copy, so the map is never accessed by the jobs. Results are picked
+	up by the server thread in its next step.
+*/
+class PathfinderPool
+{
+public:
+	struct Request {
+		v3s16 source;
+		v3s16 destination;
+		unsigned int searchdistance;
+		unsigned int max_jump;
+		unsigned int max_drop;
+		PathAlgorithm algo;
+	};
+
+	struct Result {
+		u32 id;
+		// empty if no path was found
+		std::vector<v3s16> path;
+	};
+
+	// num_threads: searches that may run at the same time,
+	// max_jobs: searches that may be queued or running at the same time
+	PathfinderPool(IGameDef *gamedef, unsigned int num_threads, size_t max_jobs);
+	PathfinderPool(IGameDef *gamedef, unsigned int num_threads, size_t max_jobs,
+			JobSystem *jobs);
+	~PathfinderPool();
+
+	DISABLE_CLASS_COPY(PathfinderPool)
+
+	// Returns the id of the search,
+	// or 0 if there are too many searches or the area is too large
+	u32 enqueue(const Request &request);
+
+	// Drops a search that has not finished yet. Returns false if there is none.
+	bool cancel(u32 id);
+
+	// Starts queued searches on free workers and takes the finished ones.
+	// Must be called by the thread that owns the map.
+	void step(Map *map, std::vector<Result> &results);
+
+private:
+	struct Job {
+		u32 id;
+		Request request;
+		std::unique_ptr<MMVManip> vmanip;
+	};
+
+	void work(Job &job);
+	std::vector<v3s16> search(const Job &job);
+
+	IGameDef *m_gamedef;
+	JobSystem *m_jobs;
+	const size_t m_num_threads;
+	const size_t m_max_jobs;
+	u32 m_next_id = 1;
+
+	// Only used by the server thread
+	std::deque<Job> m_queued;
+	// passed to the workers and not picked up yet
+	std::unordered_set<u32> m_started;
+	// results of these are dropped
+	std::unordered_set<u32> m_cancelled;
+
+	std::mutex m_mutex;
+	// signaled when a search finished
+	std::condition_variable m_cv;
+	std::vector<Result> m_done;
+	// searches submitted to the job system that didn't finish yet
+	size_t m_busy = 0;
+	// searches that didn't start yet are skipped
+	bool m_stop = false;
+};
@@ -285,7 +285,7 @@ void PlayerSAO::step(float dtime, bool send_recommended)
 			update_interval
 		);
 		// create message and add to list
-		m_messages_out.emplace(getId(), false, str);
+		m_messages_out.emplace(getId(), false, str, ActiveObjectMessage::PRIO_STATE);
 	}
 
 	if (!m_physics_override_sent) {
@@ -523,7 +523,7 @@ void PlayerSAO::setHP(s32 target_hp, const PlayerHPChangeReason &reason, bool fr
 
 	// Update properties on death
 	if ((hp == 0) != (m_hp == 0))
-		m_properties_sent = false;
+		notifyObjectPropertiesModified();
 
 	if (hp != m_hp) {
 		m_hp = hp;
@@ -609,10 +609,13 @@ void PlayerSAO::unlinkPlayerSessionAndSave()
 	m_env->removePlayer(m_player);
 }
 
-std::string PlayerSAO::getPropertyPacket()
+const std::string &PlayerSAO::getPropertyPacket()
 {
-	m_prop.is_visible = (true);
-	return generateSetPropertiesCommand(m_prop);
+	if (m_property_packet.empty()) {
+		m_prop.is_visible = (true);
+		m_property_packet = generateSetPropertiesCommand(m_prop);
+	}
+	return m_property_packet;
 }
 
 void PlayerSAO::setMaxSpeedOverride(const v3f &vel)
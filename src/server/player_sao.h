@@ -154,6 +154,14 @@ class PlayerSAO : public UnitSAO
 	void setMaxSpeedOverride(const v3f &vel);
 	// Returns true if cheated
 	bool checkMovementCheat();
+	// Positions received from the client are checked once per server step
+	void queueMovementCheck() { m_movement_check_queued = true; }
+	bool takeMovementCheck()
+	{
+		bool queued = m_movement_check_queued;
+		m_movement_check_queued = false;
+		return queued;
+	}
 
 	// Other
 
@@ -178,7 +186,7 @@ class PlayerSAO : public UnitSAO
 	inline SimpleMetadata &getMeta() { return m_meta; }
 
 private:
-	std::string getPropertyPacket();
+	const std::string &getPropertyPacket();
 	void unlinkPlayerSessionAndSave();
 	std::string generateUpdatePhysicsOverrideCommand() const;
 
@@ -191,6 +199,7 @@ class PlayerSAO : public UnitSAO
 	LagPool m_dig_pool;
 	LagPool m_move_pool;
 	v3f m_last_good_position;
+	bool m_movement_check_queued = false;
 	float m_time_from_last_teleport = 0.0f;
 	float m_time_from_last_punch = 0.0f;
 	v3s16 m_nocheat_dig_pos = v3s16(32767, 32767, 32767);
@@ -3,6 +3,7 @@
 // Copyright (C) 2013 celeron55, Perttu Ahola <celeron55@gmail.com>
 
 #include "rollback.h"
+#include <chrono>
 #include <fstream>
 #include <list>
 #include <sstream>
@@ -16,9 +17,20 @@
 #include "inventorymanager.h" // deserializing InventoryLocations
 #include "sqlite3.h"
 #include "filesys.h"
+#include "debug.h"
+#include "porting.h"
+#include "threading/thread.h"
 
 #define POINTS_PER_NODE (16.0)
 
+// Actions are written once this many are queued, or after WRITE_INTERVAL
+static constexpr size_t WRITE_BATCH_SIZE = 500;
+static constexpr auto WRITE_INTERVAL = std::chrono::seconds(1);
+// The server thread writes by itself if the write thread falls this far behind
+static constexpr size_t MAX_QUEUED = 50000;
+// How long actions are kept for getSuspect()
+static constexpr time_t LATEST_BUFFER_SECONDS = 100;
+
 #define SQLRES(f, good) \
 	if ((f) != (good)) {\
 		throw FileNotGoodException(std::string("RollbackManager: " \
@@ -74,6 +86,48 @@ struct Entity {
 
 
 
+/*
+	Writes queued actions to the database in the background, so that the
+	server thread only has to append them to RollbackManager::m_queue.
+*/
+class RollbackWriteThread : public Thread
+{
+public:
+	RollbackWriteThread(RollbackManager *mgr) :
+		Thread("Rollback"),
+		m_mgr(mgr)
+	{}
+
+	void *run() override
+	{
+		BEGIN_DEBUG_EXCEPTION_HANDLER
+
+		while (!stopRequested()) {
+			{
+				std::unique_lock<std::mutex> lock(m_mgr->m_queue_mutex);
+				m_mgr->m_queue_cv.wait_for(lock, WRITE_INTERVAL, [this] {
+					return m_mgr->m_queue.size() >= WRITE_BATCH_SIZE ||
+						stopRequested();
+				});
+			}
+			// whatever is left on stop is written by the destructor
+			if (stopRequested())
+				break;
+
+			std::lock_guard<std::mutex> lock(m_mgr->m_db_mutex);
+			m_mgr->writeQueued();
+		}
+
+		END_DEBUG_EXCEPTION_HANDLER
+
+		return nullptr;
+	}
+
+private:
+	RollbackManager *m_mgr;
+};
+
+
 RollbackManager::RollbackManager(const std::string & world_path,
 		IGameDef * gamedef_) :
 	gamedef(gamedef_)
@@ -84,11 +138,23 @@ RollbackManager::RollbackManager(const std::string & world_path,
 	database_path = world_path + DIR_DELIM "rollback.sqlite";
 
 	initDatabase();
+
+	m_write_thread = std::make_unique<RollbackWriteThread>(this);
+	m_write_thread->start();
 }
 
 
 RollbackManager::~RollbackManager()
 {
+	m_write_thread->stop();
+	{
+		// make sure the thread either sees the stop request or is waiting
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+	}
+	m_queue_cv.notify_all();
+	m_write_thread->wait();
+	m_write_thread.reset();
+
 	flush();
 
 	FINALIZE_STATEMENT(stmt_insert);
@@ -769,41 +835,68 @@ std::string RollbackManager::getSuspect(v3s16 p, float nearness_shortcut,
 
 void RollbackManager::flush()
 {
+	std::lock_guard<std::mutex> lock(m_db_mutex);
+	writeQueued();
+}
+
+
+void RollbackManager::writeQueued()
+{
+	std::vector<RollbackAction> actions;
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		actions.swap(m_queue);
+	}
+	if (actions.empty())
+		return;
+
+	const u64 start_time = porting::getTimeMs();
 	sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
 
-	for (auto iter = action_todisk_buffer.begin();
-			iter != action_todisk_buffer.end();
-			++iter) {
-		if (iter->actor.empty()) {
+	for (const RollbackAction &action : actions) {
+		if (action.actor.empty()) {
 			continue;
 		}
 
-		registerRow(actionRowFromRollbackAction(*iter));
+		registerRow(actionRowFromRollbackAction(action));
 	}
 
 	sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
-	action_todisk_buffer.clear();
+	verbosestream << "RollbackManager: wrote " << actions.size() << " actions in "
+		<< (porting::getTimeMs() - start_time) << "ms" << std::endl;
 }
 
 
 void RollbackManager::addAction(const RollbackAction & action)
 {
-	action_todisk_buffer.push_back(action);
-	action_latest_buffer.push_back(action);
-
-	// Flush to disk sometimes
-	if (action_todisk_buffer.size() >= 500) {
-		flush();
+	size_t queued;
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		m_queue.push_back(action);
+		queued = m_queue.size();
 	}
+	if (queued >= MAX_QUEUED)
+		flush();
+	else if (queued == WRITE_BATCH_SIZE)
+		m_queue_cv.notify_one();
+
+	// Forget actions that are too old for getSuspect()
+	const time_t first_time = action.unix_time - LATEST_BUFFER_SECONDS;
+	while (!action_latest_buffer.empty() &&
+			action_latest_buffer.front().unix_time < first_time)
+		action_latest_buffer.pop_front();
+	action_latest_buffer.push_back(action);
 }
 
 std::list<RollbackAction> RollbackManager::getNodeActors(v3s16 pos, int range,
 		time_t seconds, int limit)
 {
-	flush();
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
+	std::lock_guard<std::mutex> lock(m_db_mutex);
+	writeQueued();
+
 	return getActionsSince_range(first_time, pos, range, limit);
 }
 
@@ -814,8 +907,8 @@ std::list<RollbackAction> RollbackManager::getRevertActions(
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
-	flush();
+	std::lock_guard<std::mutex> lock(m_db_mutex);
+	writeQueued();
 
 	return getActionsSince(first_time, actor_filter);
 }
-
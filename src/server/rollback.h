@@ -7,7 +7,10 @@
 #include <string>
 #include "irr_v3d.h"
 #include "rollback_interface.h"
+#include <condition_variable>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include "sqlite3.h"
 
@@ -15,6 +18,7 @@ class IGameDef;
 
 struct ActionRow;
 struct Entity;
+class RollbackWriteThread;
 
 class RollbackManager: public IRollbackManager
 {
@@ -28,6 +32,7 @@ class RollbackManager: public IRollbackManager
 	void setActor(const std::string & actor, bool is_guess);
 	std::string getSuspect(v3s16 p, float nearness_shortcut,
 			float min_nearness);
+	// Writes all reported actions to the database
 	void flush();
 
 	void addAction(const RollbackAction & action);
@@ -37,6 +42,11 @@ class RollbackManager: public IRollbackManager
 			const std::string & actor_filter, time_t seconds);
 
 private:
+	friend class RollbackWriteThread;
+
+	// Writes the actions queued so far, call with m_db_mutex locked
+	void writeQueued();
+
 	void registerNewActor(const int id, const std::string & name);
 	void registerNewNode(const int id, const std::string & name);
 	int getActorId(const std::string & name);
@@ -67,9 +77,19 @@ class RollbackManager: public IRollbackManager
 	std::string current_actor;
 	bool current_actor_is_guess = false;
 
-	std::list<RollbackAction> action_todisk_buffer;
+	// Recent actions for getSuspect(), only used by the server thread
 	std::list<RollbackAction> action_latest_buffer;
 
+	// Guards the database and everything below that is used with it.
+	// Lock before m_queue_mutex.
+	std::mutex m_db_mutex;
+
+	// Actions waiting for the write thread
+	std::mutex m_queue_mutex;
+	std::condition_variable m_queue_cv;
+	std::vector<RollbackAction> m_queue;
+	std::unique_ptr<RollbackWriteThread> m_write_thread;
+
 	std::string database_path;
 	sqlite3 * db;
 	sqlite3_stmt * stmt_insert;
@@ -0,0 +1,56 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "serializedblockcache.h"
+
+const std::string *SerializedBlockCache::get(v3s16 pos, u8 ser_ver, u64 mod_counter)
+{
+	auto it = m_map.find({pos, ser_ver});
+	if (it == m_map.end() || it->second.mod_counter != mod_counter)
+		return nullptr;
+
+	Entry &entry = it->second;
+	m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+	return &entry.data;
+}
+
+const std::string &SerializedBlockCache::put(v3s16 pos, u8 ser_ver, u64 mod_counter,
+	std::string &&data)
+{
+	Key key{pos, ser_ver};
+	auto it = m_map.find(key);
+	if (it != m_map.end()) {
+		Entry &entry = it->second;
+		m_bytes -= entry.data.size();
+		m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+	} else {
+		m_lru.push_front(key);
+		it = m_map.emplace(key, Entry{0, {}, m_lru.begin()}).first;
+	}
+
+	Entry &entry = it->second;
+	entry.mod_counter = mod_counter;
+	entry.data = std::move(data);
+	m_bytes += entry.data.size();
+
+	// evict() keeps the entry at the front, so the reference stays valid
+	evict();
+	return entry.data;
+}
+
+void SerializedBlockCache::erase(std::unordered_map<Key, Entry, KeyHash>::iterator it)
+{
+	m_bytes -= it->second.data.size();
+	m_lru.erase(it->second.lru_it);
+	m_map.erase(it);
+}
+
+void SerializedBlockCache::evict()
+{
+	// never evict the most recently used entry
+	while (m_bytes > m_max_bytes && m_lru.size() > 1) {
+		auto it = m_map.find(m_lru.back());
+		erase(it);
+	}
+}
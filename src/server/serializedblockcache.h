@@ -0,0 +1,75 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+
+/*
+	Cache of network-serialized mapblocks, shared between all clients.
+
+	Entries are keyed by block position and serialization version, and
+	store the modification counter (see MapBlock::getModificationCounter())
+	of the block they were made from. An entry for an older block version
+	is never returned and gets replaced on the next insert.
+
+	The least recently used entries are evicted once the total size of the
+	cached data exceeds the given budget.
+
+	Not thread-safe.
+*/
+class SerializedBlockCache
+{
+public:
+	SerializedBlockCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+	// Returns nullptr if the block is not cached in exactly this version.
+	// The pointer is valid until the next non-const call.
+	const std::string *get(v3s16 pos, u8 ser_ver, u64 mod_counter);
+
+	// Inserts or replaces the data for a block, returns the stored copy
+	const std::string &put(v3s16 pos, u8 ser_ver, u64 mod_counter,
+		std::string &&data);
+
+	size_t size() const { return m_map.size(); }
+	size_t getBytes() const { return m_bytes; }
+
+private:
+	struct Key {
+		v3s16 pos;
+		u8 ser_ver;
+
+		bool operator==(const Key &other) const
+		{
+			return pos == other.pos && ser_ver == other.ser_ver;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &k) const
+		{
+			return std::hash<v3s16>()(k.pos) ^ k.ser_ver;
+		}
+	};
+
+	struct Entry {
+		u64 mod_counter;
+		std::string data;
+		// position in m_lru
+		std::list<Key>::iterator lru_it;
+	};
+
+	void erase(std::unordered_map<Key, Entry, KeyHash>::iterator it);
+	void evict();
+
+	size_t m_max_bytes;
+	size_t m_bytes = 0;
+	std::unordered_map<Key, Entry, KeyHash> m_map;
+	// most recently used first
+	std::list<Key> m_lru;
+};
@@ -65,7 +65,7 @@ void ServerInventoryManager::setInventoryModified(const InventoryLocation &loc)
 		if (!player)
 			return;
 
-		player->setModified(true);
+		player->setInventoryDirty();
 		player->inventory.setModified(true);
 		// Updates are sent in ServerEnvironment::step()
 	} break;
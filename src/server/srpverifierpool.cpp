@@ -0,0 +1,87 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "srpverifierpool.h"
+#include <memory>
+#include "threading/jobsystem.h"
+#include "util/auth.h"
+#include "util/srp.h"
+
+SrpVerifierPool::SrpVerifierPool(size_t max_jobs) :
+	SrpVerifierPool(max_jobs, &JobSystem::get())
+{
+}
+
+SrpVerifierPool::SrpVerifierPool(size_t max_jobs, JobSystem *jobs) :
+	m_jobs(jobs),
+	m_max_jobs(max_jobs)
+{
+}
+
+SrpVerifierPool::~SrpVerifierPool()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this] { return m_busy == 0; });
+	for (Result &result : m_done) {
+		if (result.verifier)
+			srp_verifier_delete(result.verifier);
+	}
+}
+
+bool SrpVerifierPool::enqueue(Request request)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// finished but not taken results count too, as they hold memory
+		if (m_busy + m_done.size() >= m_max_jobs)
+			return false;
+		m_busy++;
+	}
+
+	// std::function needs a copyable callable
+	auto shared_request = std::make_shared<Request>(std::move(request));
+	m_jobs->submit([this, shared_request] { work(*shared_request); });
+	return true;
+}
+
+void SrpVerifierPool::take(std::vector<Result> &results)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (Result &result : m_done)
+		results.push_back(std::move(result));
+	m_done.clear();
+}
+
+void SrpVerifierPool::work(const Request &request)
+{
+	Result result;
+	result.peer_id = request.peer_id;
+	result.name = request.name;
+
+	std::string verifier;
+	if (request.legacy) {
+		generate_srp_verifier_and_salt(request.name, request.enc_pwd,
+			&verifier, &result.salt);
+	} else {
+		verifier = request.verifier;
+		result.salt = request.salt;
+	}
+
+	char *bytes_B = nullptr;
+	size_t len_B = 0;
+	result.verifier = srp_verifier_new(SRP_SHA256, SRP_NG_2048,
+		request.name.c_str(),
+		(const unsigned char *) result.salt.c_str(), result.salt.size(),
+		(const unsigned char *) verifier.c_str(), verifier.size(),
+		(const unsigned char *) request.bytes_A.c_str(), request.bytes_A.size(),
+		nullptr, 0,
+		(unsigned char **) &bytes_B, &len_B, nullptr, nullptr);
+	if (bytes_B)
+		result.bytes_B.assign(bytes_B, len_B);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_done.push_back(std::move(result));
+	m_busy--;
+	m_cv.notify_all();
+}
@@ -0,0 +1,76 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+
+class JobSystem;
+struct SRPVerifier;
+
+typedef u16 session_t;
+
+/*
+	Runs the expensive part of SRP logins, srp_verifier_new(), as jobs of
+	the JobSystem, so that many logins at once don't stall the server thread.
+
+	At most max_jobs logins can be in progress; further ones are refused by
+	enqueue(). Results are picked up by the server thread in its next step.
+*/
+class SrpVerifierPool
+{
+public:
+	struct Request {
+		session_t peer_id;
+		std::string name;
+		// Generate the verifier from the legacy password hash in enc_pwd
+		// instead of using salt and verifier
+		bool legacy = false;
+		std::string enc_pwd;
+		std::string salt;
+		std::string verifier;
+		std::string bytes_A;
+	};
+
+	struct Result {
+		session_t peer_id;
+		std::string name;
+		std::string salt;
+		// Owned by the receiver, nullptr if it couldn't be created
+		SRPVerifier *verifier = nullptr;
+		// empty if the SRP-6a safety check failed
+		std::string bytes_B;
+	};
+
+	SrpVerifierPool(size_t max_jobs);
+	SrpVerifierPool(size_t max_jobs, JobSystem *jobs);
+	// Waits for running jobs and deletes the verifiers not taken
+	~SrpVerifierPool();
+
+	DISABLE_CLASS_COPY(SrpVerifierPool)
+
+	// Returns false if there are too many logins in progress
+	bool enqueue(Request request);
+
+	// Takes the finished logins
+	void take(std::vector<Result> &results);
+
+private:
+	void work(const Request &request);
+
+	JobSystem *m_jobs;
+	const size_t m_max_jobs;
+
+	std::mutex m_mutex;
+	// signaled when a job finished
+	std::condition_variable m_cv;
+	std::vector<Result> m_done;
+	// submitted jobs that didn't finish yet
+	size_t m_busy = 0;
+};
@@ -0,0 +1,112 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "stepphaseprofiler.h"
+#include <algorithm>
+#include <cmath>
+#include "porting.h"
+
+static const char *const phase_names[STEP_PHASE_COUNT] = {
+	"server_step",
+	"environment",
+	"active_blocks",
+	"node_timers",
+	"abms",
+	"globalstep",
+	"objects",
+	"liquids",
+	"map_timers",
+	"send_objects",
+	"send_object_messages",
+	"map_events",
+	"lua_gc",
+};
+
+StepPhaseProfiler::StepPhaseProfiler(MetricsBackend *mb)
+{
+	// in seconds, like Prometheus wants it
+	const std::vector<double> buckets = {
+		0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+		0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+	};
+	for (u8 i = 0; i < STEP_PHASE_COUNT; i++) {
+		m_phases[i].metric = mb->addHistogram("minetest_core_step_phase_seconds",
+			"Time spent in a phase of the server step (in seconds)", buckets,
+			{{"phase", phase_names[i]}});
+	}
+}
+
+const char *StepPhaseProfiler::getName(StepPhase phase)
+{
+	return phase_names[phase];
+}
+
+size_t StepPhaseProfiler::getBucket(u64 duration_us)
+{
+	if (duration_us <= 1)
+		return 0;
+	const size_t bucket = (size_t)std::ceil(std::log2((double)duration_us) * 4);
+	return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+u64 StepPhaseProfiler::getBucketLimit(size_t bucket)
+{
+	return (u64)std::floor(std::exp2(bucket / 4.0));
+}
+
+void StepPhaseProfiler::record(StepPhase phase, u64 duration_us)
+{
+	Phase &p = m_phases[phase];
+	p.buckets[getBucket(duration_us)]++;
+	p.count++;
+	p.max = std::max(p.max, duration_us);
+	p.metric->observe(duration_us / 1e6);
+}
+
+StepPhaseProfiler::Stats StepPhaseProfiler::getStats(StepPhase phase) const
+{
+	const Phase &p = m_phases[phase];
+	Stats stats;
+	stats.count = p.count;
+	stats.max = p.max;
+	if (p.count == 0)
+		return stats;
+
+	const auto percentile = [&] (double fraction) {
+		const u64 rank = std::max<u64>(1, (u64)std::ceil(p.count * fraction));
+		u64 seen = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; i++) {
+			seen += p.buckets[i];
+			if (seen >= rank)
+				return std::min(getBucketLimit(i), p.max);
+		}
+		return p.max;
+	};
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	return stats;
+}
+
+void StepPhaseProfiler::reset()
+{
+	for (Phase &p : m_phases) {
+		p.buckets.fill(0);
+		p.count = 0;
+		p.max = 0;
+	}
+}
+
+StepPhaseProfiler::Scope::Scope(StepPhaseProfiler *profiler, StepPhase phase) :
+	m_profiler(profiler),
+	m_phase(phase),
+	m_start_us(profiler ? porting::getTimeUs() : 0)
+{
+}
+
+StepPhaseProfiler::Scope::~Scope()
+{
+	if (m_profiler)
+		m_profiler->record(m_phase, porting::getTimeUs() - m_start_us);
+}
@@ -0,0 +1,97 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+#include "util/metricsbackend.h"
+
+enum StepPhase : u8
+{
+	// whole Server::AsyncRunStep
+	STEP_PHASE_SERVER_STEP,
+	// whole ServerEnvironment::step
+	STEP_PHASE_ENVIRONMENT,
+	// active block list, object (de)activation and LBMs
+	STEP_PHASE_ACTIVE_BLOCKS,
+	STEP_PHASE_NODE_TIMERS,
+	STEP_PHASE_ABMS,
+	STEP_PHASE_GLOBALSTEP,
+	STEP_PHASE_OBJECTS,
+	STEP_PHASE_LIQUIDS,
+	STEP_PHASE_MAP_TIMERS,
+	// objects coming into or leaving the range of players
+	STEP_PHASE_SEND_OBJECTS,
+	STEP_PHASE_SEND_OBJECT_MESSAGES,
+	STEP_PHASE_MAP_EVENTS,
+	// incremental Lua garbage collection in the idle time after the step
+	STEP_PHASE_LUA_GC,
+	STEP_PHASE_COUNT
+};
+
+/*
+	Durations of the phases of the server step.
+
+	Unlike the Profiler, which keeps averages, every duration goes into a
+	histogram with buckets of about 19% width, so percentiles of the time
+	since the last reset() can be shown. The durations are also exported as
+	histograms of the metrics backend.
+
+	Must only be used by the server thread.
+*/
+class StepPhaseProfiler
+{
+public:
+	StepPhaseProfiler(MetricsBackend *mb);
+
+	DISABLE_CLASS_COPY(StepPhaseProfiler)
+
+	struct Stats {
+		u32 count = 0;
+		// in microseconds, each percentile is the upper bound of its bucket
+		u64 p50 = 0;
+		u64 p95 = 0;
+		u64 p99 = 0;
+		u64 max = 0;
+	};
+
+	void record(StepPhase phase, u64 duration_us);
+	Stats getStats(StepPhase phase) const;
+	void reset();
+
+	static const char *getName(StepPhase phase);
+
+	// Records the duration of a scope, profiler may be nullptr
+	class Scope
+	{
+	public:
+		Scope(StepPhaseProfiler *profiler, StepPhase phase);
+		~Scope();
+
+		DISABLE_CLASS_COPY(Scope)
+
+	private:
+		StepPhaseProfiler *m_profiler;
+		StepPhase m_phase;
+		u64 m_start_us;
+	};
+
+private:
+	// 4 buckets per power of two from 1 µs to about 2 minutes
+	static constexpr size_t BUCKET_COUNT = 4 * 27;
+
+	static size_t getBucket(u64 duration_us);
+	static u64 getBucketLimit(size_t bucket);
+
+	struct Phase {
+		std::array<u32, BUCKET_COUNT> buckets{};
+		u32 count = 0;
+		u64 max = 0;
+		MetricHistogramPtr metric;
+	};
+
+	std::array<Phase, STEP_PHASE_COUNT> m_phases;
+};
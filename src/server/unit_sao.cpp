@@ -283,6 +283,7 @@ ObjectProperties *UnitSAO::accessObjectProperties()
 void UnitSAO::notifyObjectPropertiesModified()
 {
 	m_properties_sent = false;
+	m_property_packet.clear();
 }
 
 std::string UnitSAO::generateUpdateAttachmentCommand() const
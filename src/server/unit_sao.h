@@ -103,6 +103,9 @@ class UnitSAO : public ServerActiveObject
 	// Object properties
 	bool m_properties_sent = true;
 	ObjectProperties m_prop;
+	// Serialized properties, shared by all clients until they change
+	// (empty when outdated)
+	std::string m_property_packet;
 
 	// Stores position and rotation for each bone name
 	std::unordered_map<std::string, BoneOverride> m_bone_override;
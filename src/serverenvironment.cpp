@@ -3,6 +3,9 @@
 // Copyright (C) 2010-2017 celeron55, Perttu Ahola <celeron55@gmail.com>
 
 #include <algorithm>
+#include <cmath>
+#include <exception>
+#include <optional>
 #include <stack>
 #include <utility>
 #include "serverenvironment.h"
@@ -10,6 +13,7 @@
 #include "settings.h"
 #include "log.h"
 #include "mapblock.h"
+#include "navigation_cache.h"
 #include "nodedef.h"
 #include "nodemetadata.h"
 #include "gamedef.h"
@@ -24,6 +28,7 @@
 #include "util/basic_macros.h"
 #include "util/pointedthing.h"
 #include "threading/mutex_auto_lock.h"
+#include "threading/workerpool.h"
 #include "filesys.h"
 #include "gameparams.h"
 #include "database/database-dummy.h"
@@ -37,7 +42,9 @@
 #endif
 #include "irrlicht_changes/printing.h"
 #include "server/luaentity_sao.h"
+#include "server/pathfinderpool.h"
 #include "server/player_sao.h"
+#include "server/stepphaseprofiler.h"
 
 // A number that is much smaller than the timeout for particle spawners should/could ever be
 #define PARTICLE_SPAWNER_NO_EXPIRY -1024.f
@@ -51,19 +58,6 @@ static constexpr u32 BLOCK_RESAVE_TIMESTAMP_DIFF = 60; // in units of game time
 	ActiveBlockList
 */
 
-static void fillRadiusBlock(v3s16 p0, s16 r, std::set<v3s16> &list)
-{
-	v3s16 p;
-	for(p.X=p0.X-r; p.X<=p0.X+r; p.X++)
-	for(p.Y=p0.Y-r; p.Y<=p0.Y+r; p.Y++)
-	for(p.Z=p0.Z-r; p.Z<=p0.Z+r; p.Z++) {
-		// limit to a sphere
-		if (p.getDistanceFrom(p0) <= r) {
-			list.insert(p);
-		}
-	}
-}
-
 static void fillViewConeBlock(v3s16 p0,
 	const s16 r,
 	const v3f camera_pos,
@@ -89,14 +83,12 @@ void ActiveBlockList::update(std::vector<PlayerSAO*> &active_players,
 	std::set<v3s16> &blocks_added,
 	std::set<v3s16> &extra_blocks_added)
 {
-	/*
-		Create the new list
-	*/
-	std::set<v3s16> newlist = m_forceloaded_list;
+	std::vector<PlayerRange> players;
+	players.reserve(active_players.size());
 	std::set<v3s16> extralist;
 	for (const PlayerSAO *playersao : active_players) {
 		v3s16 pos = getNodeBlockPos(floatToInt(playersao->getBasePosition(), BS));
-		fillRadiusBlock(pos, active_block_range, newlist);
+		players.push_back({playersao->getId(), pos});
 
 		s16 player_ao_range = std::min(active_object_range, playersao->getWantedRange());
 		// only do this if this would add blocks
@@ -115,51 +107,179 @@ void ActiveBlockList::update(std::vector<PlayerSAO*> &active_players,
 		}
 	}
 
-	m_abm_list = newlist;
-
-	// 1. Find out which blocks on the new list are not on the old list
-	std::set_difference(newlist.begin(), newlist.end(), m_list.begin(), m_list.end(),
-			std::inserter(blocks_added, blocks_added.end()));
+	updateRanges(players, active_block_range, extralist,
+		blocks_removed, blocks_added, extra_blocks_added);
+}
 
-	// 2. remove duplicate blocks from the extra list
-	for (v3s16 p : newlist) {
-		extralist.erase(p);
+void ActiveBlockList::updateRanges(const std::vector<PlayerRange> &players,
+	s16 active_block_range,
+	std::set<v3s16> &extralist,
+	std::set<v3s16> &blocks_removed,
+	std::set<v3s16> &blocks_added,
+	std::set<v3s16> &extra_blocks_added)
+{
+	/*
+		Update the reference counts of the player ranges
+	*/
+	m_generation++;
+	for (const PlayerRange &player : players) {
+		const Sphere sphere{player.blockpos, active_block_range};
+		auto it = m_player_ranges.find(player.id);
+		if (it == m_player_ranges.end()) {
+			moveSphere(Sphere(), sphere);
+			m_player_ranges[player.id] = {sphere, m_generation};
+			continue;
+		}
+		TrackedRange &tracked = it->second;
+		if (tracked.sphere.center != sphere.center ||
+				tracked.sphere.radius != sphere.radius) {
+			moveSphere(tracked.sphere, sphere);
+			tracked.sphere = sphere;
+		}
+		tracked.generation = m_generation;
+	}
+	// Players that are gone
+	for (auto it = m_player_ranges.begin(); it != m_player_ranges.end();) {
+		if (it->second.generation != m_generation) {
+			moveSphere(it->second.sphere, Sphere());
+			it = m_player_ranges.erase(it);
+		} else {
+			++it;
+		}
 	}
 
-	// 3. Find out which blocks on the extra list are not on the old list
-	std::set_difference(extralist.begin(), extralist.end(), m_list.begin(), m_list.end(),
-			std::inserter(extra_blocks_added, extra_blocks_added.end()));
-
-	// 4. make sure newlist has all new block
-	newlist.insert(extralist.begin(), extralist.end());
+	/*
+		Forceloaded blocks count like a player range
+	*/
+	std::vector<v3s16> diff;
+	std::set_difference(m_forceloaded_list.begin(), m_forceloaded_list.end(),
+			m_forceloaded_applied.begin(), m_forceloaded_applied.end(),
+			std::back_inserter(diff));
+	for (v3s16 p : diff)
+		ref(p);
+	const bool forceloads_changed = !diff.empty();
+	diff.clear();
+	std::set_difference(m_forceloaded_applied.begin(), m_forceloaded_applied.end(),
+			m_forceloaded_list.begin(), m_forceloaded_list.end(),
+			std::back_inserter(diff));
+	for (v3s16 p : diff)
+		unref(p);
+	if (forceloads_changed || !diff.empty())
+		m_forceloaded_applied = m_forceloaded_list;
 
-	// 5. Find out which blocks on the old list are not on the new + extra list
-	std::set_difference(m_list.begin(), m_list.end(), newlist.begin(), newlist.end(),
-			std::inserter(blocks_removed, blocks_removed.end()));
+	/*
+		Update the lists, only blocks that may have changed are looked at
+	*/
+	m_dirty.insert(m_dirty.end(), m_extra_list.begin(), m_extra_list.end());
+	m_dirty.insert(m_dirty.end(), extralist.begin(), extralist.end());
+	std::sort(m_dirty.begin(), m_dirty.end());
+	m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+
+	std::set<v3s16> new_extra_list;
+	for (v3s16 p : m_dirty) {
+		const bool in_range = m_refcount.find(p) != m_refcount.end();
+		const bool in_extra = !in_range && extralist.count(p) > 0;
+		const bool was_active = m_list.count(p) > 0;
+
+		if (in_range)
+			m_abm_list.insert(p);
+		else
+			m_abm_list.erase(p);
+		if (in_extra)
+			new_extra_list.insert(new_extra_list.end(), p);
+
+		if (in_range || in_extra) {
+			if (!was_active) {
+				auto &target = in_range ? blocks_added : extra_blocks_added;
+				target.insert(target.end(), p);
+				m_list.insert(p);
+			}
+		} else if (was_active) {
+			blocks_removed.insert(blocks_removed.end(), p);
+			m_list.erase(p);
+		}
+	}
+	m_dirty.clear();
+	m_extra_list = std::move(new_extra_list);
 
 	/*
 		Do some least-effort sanity checks to hopefully catch code bugs.
 	*/
-	assert(newlist.size() >= extralist.size());
-	assert(newlist.size() >= m_abm_list.size());
-	assert(blocks_removed.size() <= m_list.size());
-	if (!blocks_added.empty()) {
-		assert(newlist.count(*blocks_added.begin()) > 0);
-		assert(blocks_removed.count(*blocks_added.begin()) == 0);
-	}
-	if (!extra_blocks_added.empty()) {
-		assert(newlist.count(*extra_blocks_added.begin()) > 0);
-		assert(extralist.count(*extra_blocks_added.begin()) > 0);
-		assert(blocks_added.count(*extra_blocks_added.begin()) == 0);
-	}
-	if (!blocks_removed.empty()) {
-		assert(newlist.count(*blocks_removed.begin()) == 0);
-		assert(extralist.count(*blocks_removed.begin()) == 0);
-		assert(m_list.count(*blocks_removed.begin()) > 0);
+	assert(m_list.size() == m_abm_list.size() + m_extra_list.size());
+	assert(m_abm_list.size() == m_refcount.size());
+}
+
+void ActiveBlockList::ref(v3s16 p)
+{
+	if (m_refcount[p]++ == 0)
+		m_dirty.push_back(p);
+}
+
+void ActiveBlockList::unref(v3s16 p)
+{
+	auto it = m_refcount.find(p);
+	assert(it != m_refcount.end());
+	if (--it->second == 0) {
+		m_refcount.erase(it);
+		m_dirty.push_back(p);
 	}
+}
 
-	// Update m_list
-	m_list = std::move(newlist);
+/*
+	Gets the Z range of the blocks of a sphere in the row at (x, y).
+	A block p is in the sphere if p.getDistanceFrom(center) <= radius,
+	the distance being rounded down.
+*/
+static bool sphere_row(v3s16 center, s16 radius, s32 x, s32 y, s32 &z0, s32 &z1)
+{
+	if (radius < 0)
+		return false;
+	const s32 dx = x - center.X, dy = y - center.Y;
+	const s32 m = (radius + 1) * (radius + 1) - dx * dx - dy * dy;
+	if (m <= 0)
+		return false;
+	// largest h with h * h < m
+	s32 h = std::sqrt((float)(m - 1));
+	while (h * h >= m)
+		h--;
+	while ((h + 1) * (h + 1) < m)
+		h++;
+	z0 = center.Z - h;
+	z1 = center.Z + h;
+	return true;
+}
+
+void ActiveBlockList::moveSphere(const Sphere &a, const Sphere &b)
+{
+	// For each row of the sphere `from`, calls cb on every block that is
+	// not in the sphere `other`
+	auto for_each_exclusive = [] (const Sphere &from, const Sphere &other,
+			auto &&cb) {
+		if (from.radius < 0)
+			return;
+		const v3s16 c = from.center;
+		for (s32 x = c.X - from.radius; x <= c.X + from.radius; x++)
+		for (s32 y = c.Y - from.radius; y <= c.Y + from.radius; y++) {
+			s32 z0, z1, oz0, oz1;
+			if (!sphere_row(c, from.radius, x, y, z0, z1))
+				continue;
+			if (!sphere_row(other.center, other.radius, x, y, oz0, oz1)) {
+				// no overlap
+				oz0 = z1 + 1;
+				oz1 = z0 - 1;
+			}
+			for (s32 z = z0; z <= z1; z++) {
+				if (z >= oz0 && z <= oz1) {
+					z = oz1; // skip the common part
+					continue;
+				}
+				cb(v3s16(x, y, z));
+			}
+		}
+	};
+
+	for_each_exclusive(b, a, [this] (v3s16 p) { ref(p); });
+	for_each_exclusive(a, b, [this] (v3s16 p) { unref(p); });
 }
 
 /*
@@ -178,17 +298,59 @@ void OnMapblocksChangedReceiver::onMapEditEvent(const MapEditEvent &event)
 	ServerEnvironment
 */
 
+static server::ActiveObjectMgr::SpatialIndexType get_active_object_index()
+{
+	const std::string type = g_settings->get("active_object_index");
+	if (type == "grid")
+		return server::ActiveObjectMgr::SPATIAL_INDEX_GRID;
+	if (type != "kdtree")
+		warningstream << "Unknown active_object_index \"" << type
+			<< "\", using kdtree" << std::endl;
+	return server::ActiveObjectMgr::SPATIAL_INDEX_KD_TREE;
+}
+
 ServerEnvironment::ServerEnvironment(std::unique_ptr<ServerMap> map,
 		Server *server, MetricsBackend *mb):
 	Environment(server),
 	m_map(std::move(map)),
 	m_script(server->getScriptIface()),
-	m_server(server)
+	m_server(server),
+	m_ao_manager(get_active_object_index())
 {
 	m_cache_active_block_mgmt_interval = g_settings->getFloat("active_block_mgmt_interval");
 	m_cache_abm_interval = rangelim(g_settings->getFloat("abm_interval"), 0.1f, 30);
 	m_cache_nodetimer_interval = rangelim(g_settings->getFloat("nodetimer_interval"), 0.1f, 1);
 	m_cache_abm_time_budget = g_settings->getFloat("abm_time_budget");
+	m_cache_nodetimer_time_budget = g_settings->getFloat("nodetimer_time_budget");
+	m_cache_entity_sleep_distance = std::max(g_settings->getFloat("entity_sleep_distance"), 0.0f) * BS;
+	m_cache_object_time_budget = g_settings->getFloat("object_activation_time_budget");
+
+	u16 abm_scan_threads = g_settings->getU16("abm_scan_threads");
+	if (abm_scan_threads > 0)
+		m_abm_scan_pool = std::make_unique<WorkerPool>("ABMScan", abm_scan_threads);
+
+	u16 entity_physics_threads = g_settings->getU16("entity_physics_threads");
+	if (entity_physics_threads > 0)
+		m_entity_physics_pool = std::make_unique<WorkerPool>("EntityPhysics",
+			entity_physics_threads);
+
+	u16 raycast_batch_threads = g_settings->getU16("raycast_batch_threads");
+	if (raycast_batch_threads > 0)
+		m_raycast_pool = std::make_unique<WorkerPool>("RaycastBatch",
+			raycast_batch_threads);
+
+	u16 object_activation_threads = g_settings->getU16("object_activation_threads");
+	if (object_activation_threads > 0)
+		m_object_activation_pool = std::make_unique<WorkerPool>("ObjectActivation",
+			object_activation_threads);
+
+	if (g_settings->getBool("pathfinder_hierarchical"))
+		m_navigation_cache = std::make_unique<NavigationCache>(m_map.get(),
+			server->ndef());
+
+	m_pathfinder_pool = std::make_unique<PathfinderPool>(server,
+		rangelim(g_settings->getU16("pathfinder_async_threads"), 1, 64),
+		g_settings->getU16("pathfinder_async_max_jobs"));
 
 	m_step_time_counter = mb->addCounter(
 		"minetest_env_step_time", "Time spent in environment step (in microseconds)");
@@ -278,6 +440,11 @@ void ServerEnvironment::init()
 
 void ServerEnvironment::deactivateBlocksAndObjects()
 {
+	for (const v3s16 &p : m_active_blocks.m_list) {
+		if (MapBlock *block = m_map->getBlockNoCreateNoEx(p))
+			block->detachNodeTimers();
+	}
+
 	// Clear active block list.
 	// This makes the next one delete all active objects.
 	m_active_blocks.clear();
@@ -290,6 +457,8 @@ ServerEnvironment::~ServerEnvironment()
 	assert(m_active_blocks.size() == 0); // deactivateBlocksAndObjects does this
 
 	// Drop/delete map
+	m_pathfinder_pool.reset();
+	m_navigation_cache.reset();
 	m_map.reset();
 
 	// Delete ActiveBlockModifiers
@@ -338,6 +507,17 @@ RemotePlayer *ServerEnvironment::getPlayer(const std::string &name, bool match_i
 	return nullptr;
 }
 
+bool ServerEnvironment::isFarFromPlayers(v3f pos) const
+{
+	const f32 distance_sq = m_cache_entity_sleep_distance * m_cache_entity_sleep_distance;
+	for (RemotePlayer *player : m_players) {
+		PlayerSAO *sao = player->getPlayerSAO();
+		if (sao && sao->getBasePosition().getDistanceFromSQ(pos) <= distance_sq)
+			return false;
+	}
+	return true;
+}
+
 void ServerEnvironment::addPlayer(RemotePlayer *player)
 {
 	/*
@@ -372,9 +552,12 @@ bool ServerEnvironment::removePlayerFromDatabase(const std::string &name)
 
 void ServerEnvironment::saveLoadedPlayers(bool force)
 {
+	// all players in one transaction
+	m_player_database->beginSaveBatch();
 	for (RemotePlayer *player : m_players) {
-		if (force || player->checkModified() || (player->getPlayerSAO() &&
-				player->getPlayerSAO()->getMeta().isModified())) {
+		if (force)
+			player->setModified(true);
+		if (player->checkModified()) {
 			try {
 				m_player_database->savePlayer(player);
 			} catch (DatabaseException &e) {
@@ -384,6 +567,7 @@ void ServerEnvironment::saveLoadedPlayers(bool force)
 			}
 		}
 	}
+	m_player_database->endSaveBatch();
 }
 
 void ServerEnvironment::savePlayer(RemotePlayer *player)
@@ -575,6 +759,10 @@ void ServerEnvironment::activateBlock(MapBlock *block)
 	block->step((float)dtime_s, [&](v3s16 p, MapNode n, f32 d) -> bool {
 		return m_script->node_on_timer(p, n, d);
 	});
+	if (block->isOrphan())
+		return;
+	// From now on they run from m_node_timer_queue
+	block->attachNodeTimers(&m_node_timer_queue);
 }
 
 void ServerEnvironment::addActiveBlockModifier(ActiveBlockModifier *abm)
@@ -656,6 +844,52 @@ bool ServerEnvironment::swapNode(v3s16 p, const MapNode &n)
 	return true;
 }
 
+bool ServerEnvironment::setNodes(std::vector<v3s16> &positions, const MapNode &n)
+{
+	const NodeDefManager *ndef = m_server->ndef();
+
+	// Call destructors, all of them see the old nodes
+	std::vector<std::pair<v3s16, MapNode>> after_destruct;
+	for (v3s16 p : positions) {
+		MapNode n_old = m_map->getNode(p);
+		const ContentFeatures &cf_old = ndef->get(n_old);
+		if (cf_old.has_on_destruct)
+			m_script->node_on_destruct(p, n_old);
+		if (cf_old.has_after_destruct)
+			after_destruct.emplace_back(p, n_old);
+	}
+
+	// Replace nodes
+	bool succeeded = m_map->addNodesWithEvent(positions, n);
+
+	// Update active VoxelManipulator if a mapgen thread
+	for (v3s16 p : positions)
+		m_map->updateVManip(p);
+
+	// Call post-destructors
+	for (const auto &it : after_destruct)
+		m_script->node_after_destruct(it.first, it.second);
+
+	// Call constructors
+	if (ndef->get(n).has_on_construct) {
+		for (v3s16 p : positions)
+			m_script->node_on_construct(p, n);
+	}
+
+	return succeeded;
+}
+
+bool ServerEnvironment::swapNodes(std::vector<v3s16> &positions, const MapNode &n)
+{
+	bool succeeded = m_map->addNodesWithEvent(positions, n, false);
+
+	// Update active VoxelManipulator if a mapgen thread
+	for (v3s16 p : positions)
+		m_map->updateVManip(p);
+
+	return succeeded;
+}
+
 u8 ServerEnvironment::findSunlight(v3s16 pos) const
 {
 	// Directions for neighboring nodes with specified order
@@ -774,21 +1008,9 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 		<< "Done listing all loaded blocks: "
 		<< loaded_blocks.size()<<std::endl;
 
-	// Get list of loadable blocks
-	std::vector<v3s16> loadable_blocks;
-	if (mode == CLEAR_OBJECTS_MODE_FULL) {
-		infostream << "ServerEnvironment::clearObjects(): "
-			<< "Listing all loadable blocks" << std::endl;
-		m_map->listAllLoadableBlocks(loadable_blocks);
-		infostream << "ServerEnvironment::clearObjects(): "
-			<< "Done listing all loadable blocks: "
-			<< loadable_blocks.size() << std::endl;
-	} else {
-		loadable_blocks = loaded_blocks;
-	}
-
 	actionstream << "ServerEnvironment::clearObjects(): "
-		<< "Now clearing objects in " << loadable_blocks.size()
+		<< "Now clearing objects in "
+		<< (mode == CLEAR_OBJECTS_MODE_FULL ? "all loadable" : "all loaded")
 		<< " blocks" << std::endl;
 
 	// Grab a reference on each loaded block to avoid unloading it
@@ -804,18 +1026,15 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 		unload_interval = g_settings->getS32("max_clearobjects_extra_loaded_blocks");
 		unload_interval = MYMAX(unload_interval, 1);
 	}
-	u32 report_interval = loadable_blocks.size() / 10;
 	u32 num_blocks_checked = 0;
 	u32 num_blocks_cleared = 0;
 	u32 num_objs_cleared = 0;
-	for (auto i = loadable_blocks.begin();
-		i != loadable_blocks.end(); ++i) {
-		v3s16 p = *i;
+	auto clear_block = [&] (v3s16 p) {
 		MapBlock *block = m_map->emergeBlock(p, false);
 		if (!block) {
 			errorstream << "ServerEnvironment::clearObjects(): "
 				<< "Failed to emerge block " << p << std::endl;
-			continue;
+			return;
 		}
 
 		u32 num_cleared = block->clearObjects();
@@ -825,18 +1044,31 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 		}
 		num_blocks_checked++;
 
-		if (report_interval != 0 &&
-			num_blocks_checked % report_interval == 0) {
-			float percent = 100.0 * (float)num_blocks_checked /
-				loadable_blocks.size();
-			actionstream << "ServerEnvironment::clearObjects(): "
-				<< "Cleared " << num_objs_cleared << " objects"
-				<< " in " << num_blocks_cleared << " blocks ("
-				<< percent << "%)" << std::endl;
-		}
 		if (num_blocks_checked % unload_interval == 0) {
 			m_map->unloadUnreferencedBlocks();
 		}
+	};
+
+	if (mode == CLEAR_OBJECTS_MODE_FULL) {
+		// The database is listed a chunk at a time, as it may hold far more
+		// blocks than fit into memory at once
+		ServerMap::LoadableBlocksCursor cursor;
+		std::vector<v3s16> loadable_blocks;
+		bool more;
+		do {
+			loadable_blocks.clear();
+			more = m_map->listLoadableBlocks(cursor, 10000, loadable_blocks);
+			for (v3s16 p : loadable_blocks)
+				clear_block(p);
+
+			actionstream << "ServerEnvironment::clearObjects(): "
+				<< "Cleared " << num_objs_cleared << " objects"
+				<< " in " << num_blocks_cleared << " blocks ("
+				<< num_blocks_checked << " checked)" << std::endl;
+		} while (more);
+	} else {
+		for (v3s16 p : loaded_blocks)
+			clear_block(p);
 	}
 	m_map->unloadUnreferencedBlocks();
 
@@ -857,6 +1089,8 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 void ServerEnvironment::step(float dtime)
 {
 	ScopeProfiler sp2(g_profiler, "ServerEnv::step()", SPT_AVG);
+	StepPhaseProfiler *phases = m_server->getStepPhaseProfiler();
+	StepPhaseProfiler::Scope sp2_phase(phases, STEP_PHASE_ENVIRONMENT);
 	const auto start_time = porting::getTimeUs();
 
 	/* Step time of day */
@@ -879,11 +1113,21 @@ void ServerEnvironment::step(float dtime)
 		m_game_time_fraction_counter -= (float)inc_i;
 	}
 
+	// Fix lighting between the blocks loaded since the last step
+	m_map->updateBorderLighting();
+
+	/*
+		Activate objects left over from the last steps, before new ones
+	*/
+	m_object_time_us = 0;
+	activateDeferredObjects();
+
 	/*
 		Manage active block list
 	*/
 	if (m_active_blocks_mgmt_interval.step(dtime, m_cache_active_block_mgmt_interval / m_fast_active_block_divider)) {
 		ScopeProfiler sp(g_profiler, "ServerEnv: update active blocks", SPT_AVG);
+		StepPhaseProfiler::Scope sp_phase(phases, STEP_PHASE_ACTIVE_BLOCKS);
 
 		/*
 			Get player block positions
@@ -930,6 +1174,7 @@ void ServerEnvironment::step(float dtime)
 
 			// Set current time as timestamp (and let it set ChangedFlag)
 			block->setTimestamp(m_game_time);
+			block->detachNodeTimers();
 		}
 
 		/*
@@ -973,6 +1218,7 @@ void ServerEnvironment::step(float dtime)
 	*/
 	if (m_active_blocks_nodemetadata_interval.step(dtime, m_cache_nodetimer_interval)) {
 		ScopeProfiler sp(g_profiler, "ServerEnv: Run node timers", SPT_AVG);
+		StepPhaseProfiler::Scope sp_phase(phases, STEP_PHASE_NODE_TIMERS);
 
 		// FIXME: this is not actually correct, because the block may have been
 		// activated just moments ago. In practice the intervnal is very small
@@ -998,15 +1244,49 @@ void ServerEnvironment::step(float dtime)
 					MOD_REASON_BLOCK_EXPIRED);
 			}
 
-			// Run node timers
-			block->step(dtime, [&](v3s16 p, MapNode n, f32 d) -> bool {
+			// The block may have been replaced since it was activated
+			if (!block->hasNodeTimersAttached(&m_node_timer_queue))
+				block->attachNodeTimers(&m_node_timer_queue);
+		}
+
+		// Run node timers, only blocks that have elapsed timers are visited
+		std::vector<NodeTimerQueue::Entry> due;
+		m_node_timer_queue.step(dtime, due);
+		const u64 start_ms = porting::getTimeMs();
+		const u64 max_time_ms = m_cache_nodetimer_interval * 1000 *
+			m_cache_nodetimer_time_budget;
+		size_t deferred = 0;
+		for (const auto &entry : due) {
+			if (deferred > 0 || porting::getTimeMs() - start_ms > max_time_ms) {
+				// Out of time, these go first in the next step
+				m_node_timer_queue.push(entry.due, entry.blockpos);
+				deferred++;
+				continue;
+			}
+			MapBlock *block = m_map->getBlockNoCreateNoEx(entry.blockpos);
+			if (!block || !block->takeScheduledNodeTimers(&m_node_timer_queue, entry.due))
+				continue;
+			if (!m_active_blocks.contains(entry.blockpos)) {
+				block->detachNodeTimers();
+				continue;
+			}
+			block->step(0, [&](v3s16 p, MapNode n, f32 d) -> bool {
 				return m_script->node_on_timer(p, n, d);
 			});
 		}
+		if (deferred > 0) {
+			infostream << "node timers took " << (porting::getTimeMs() - start_ms)
+				<< "ms, deferred " << deferred << " of " << due.size()
+				<< " blocks" << std::endl;
+		}
+		g_profiler->avg("ServerEnv: node timer blocks run", due.size() - deferred);
+		g_profiler->avg("ServerEnv: node timer blocks deferred", deferred);
+		g_profiler->avg("ServerEnv: node timer queue size", m_node_timer_queue.size());
 	}
 
 	if (m_active_block_modifier_interval.step(dtime, m_cache_abm_interval)) {
 		ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per interval", SPT_AVG);
+		StepPhaseProfiler::Scope sp_phase(phases, STEP_PHASE_ABMS);
 		TimeTaker timer("modify in active blocks per interval");
 
 		// Shuffle to prevent persistent artifacts of ordering
@@ -1030,26 +1310,59 @@ void ServerEnvironment::step(float dtime)
 		int i = 0;
 		// determine the time budget for ABMs
 		u32 max_time_ms = m_cache_abm_interval * 1000 * m_cache_abm_time_budget;
-		for (const v3s16 &p : output) {
-			MapBlock *block = m_map->getBlockNoCreateNoEx(p);
-			if (!block)
-				continue;
+		if (m_abm_scan_pool) {
+			// Hand out blocks in batches so that the time budget is still
+			// checked regularly
+			const size_t batch_size = 16 * (m_abm_scan_pool->getThreadCount() + 1);
+			std::vector<MapBlock *> batch;
+			batch.reserve(batch_size);
+			for (auto it = output.begin(); it != output.end(); ) {
+				batch.clear();
+				for (; it != output.end() && batch.size() < batch_size; ++it) {
+					MapBlock *block = m_map->getBlockNoCreateNoEx(*it);
+					if (!block)
+						continue;
+					// Set current time as timestamp
+					block->setTimestampNoChangedFlag(m_game_time);
+					batch.push_back(block);
+				}
+				i += batch.size();
 
-			i++;
+				/* Handle ActiveBlockModifiers */
+				abmhandler.applyParallel(m_abm_scan_pool.get(), batch,
+					blocks_scanned, abms_run, blocks_cached);
 
-			// Set current time as timestamp
-			block->setTimestampNoChangedFlag(m_game_time);
+				u32 time_ms = timer.getTimerTime();
 
-			/* Handle ActiveBlockModifiers */
-			abmhandler.apply(block, blocks_scanned, abms_run, blocks_cached);
+				if (time_ms > max_time_ms) {
+					warningstream << "active block modifiers took "
+						  << time_ms << "ms (processed " << i << " of "
+						  << output.size() << " active blocks)" << std::endl;
+					break;
+				}
+			}
+		} else {
+			for (const v3s16 &p : output) {
+				MapBlock *block = m_map->getBlockNoCreateNoEx(p);
+				if (!block)
+					continue;
 
-			u32 time_ms = timer.getTimerTime();
+				i++;
 
-			if (time_ms > max_time_ms) {
-				warningstream << "active block modifiers took "
-					  << time_ms << "ms (processed " << i << " of "
-					  << output.size() << " active blocks)" << std::endl;
-				break;
+				// Set current time as timestamp
+				block->setTimestampNoChangedFlag(m_game_time);
+
+				/* Handle ActiveBlockModifiers */
+				abmhandler.apply(block, blocks_scanned, abms_run, blocks_cached);
+
+				u32 time_ms = timer.getTimerTime();
+
+				if (time_ms > max_time_ms) {
+					warningstream << "active block modifiers took "
+						  << time_ms << "ms (processed " << i << " of "
+						  << output.size() << " active blocks)" << std::endl;
+					break;
+				}
 			}
 		}
 		g_profiler->avg("ServerEnv: active blocks", m_active_blocks.m_abm_list.size());
@@ -1063,15 +1376,52 @@ void ServerEnvironment::step(float dtime)
 	/*
 		Step script environment (run global on_step())
 	*/
-	m_script->environment_Step(dtime);
+	{
+		StepPhaseProfiler::Scope sp_phase(phases, STEP_PHASE_GLOBALSTEP);
+		m_script->environment_Step(dtime);
+	}
 
 	m_script->stepAsync();
 
+	/*
+		Deliver the paths of core.find_path_async()
+	*/
+	{
+		std::vector<PathfinderPool::Result> paths;
+		m_pathfinder_pool->step(m_map.get(), paths);
+		for (const PathfinderPool::Result &result : paths)
+			m_script->on_find_path_async_done(result.id, result.path);
+	}
+
+	/*
+		Gather the node collisions of moving entities
+	*/
+	if (m_entity_physics_pool) {
+		ScopeProfiler sp(g_profiler, "ServerEnv: gather entity collisions", SPT_AVG);
+
+		// The map isn't modified until the objects are stepped. Anything that
+		// changes before an entity's step is detected and gathered again.
+		std::vector<CollisionNodeBoxes *> node_boxes;
+		m_ao_manager.step(dtime, [&](ServerActiveObject *obj) {
+			if (obj->getType() != ACTIVEOBJECT_TYPE_LUAENTITY)
+				return;
+			auto *boxes = static_cast<LuaEntitySAO *>(obj)->prepareNodeBoxes(dtime);
+			if (boxes)
+				node_boxes.push_back(boxes);
+		});
+		const NodeDefManager *ndef = m_server->ndef();
+		m_entity_physics_pool->run(node_boxes.size(), [&](size_t i) {
+			collisionGatherNodeBoxes(ndef, *node_boxes[i]);
+		});
+		g_profiler->avg("ServerEnv: entities gathered in parallel [#]", node_boxes.size());
+	}
+
 	/*
 		Step active objects
 	*/
 	{
 		ScopeProfiler sp(g_profiler, "ServerEnv: Run SAO::step()", SPT_AVG);
+		StepPhaseProfiler::Scope sp_phase(phases, STEP_PHASE_OBJECTS);
 
 		// This helps the objects to send data at the same time
 		bool send_recommended = false;
@@ -1225,7 +1575,8 @@ void ServerEnvironment::invalidateActiveObjectObserverCaches()
 void ServerEnvironment::getAddedActiveObjects(PlayerSAO *playersao, s16 radius,
 	s16 player_radius,
 	const std::set<u16> &current_objects,
-	std::vector<u16> &added_objects)
+	std::vector<u16> &added_objects,
+	std::unordered_map<v3s16, u32> *seen_cells)
 {
 	f32 radius_f = radius * BS;
 	f32 player_radius_f = player_radius * BS;
@@ -1239,7 +1590,7 @@ void ServerEnvironment::getAddedActiveObjects(PlayerSAO *playersao, s16 radius,
 	m_ao_manager.getAddedActiveObjectsAroundPos(
 		playersao->getBasePosition(), playersao->getPlayer()->getName(),
 		radius_f, player_radius_f,
-		current_objects, added_objects);
+		current_objects, added_objects, seen_cells);
 }
 
 /*
@@ -1575,12 +1926,51 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 	if (!block->onObjectsActivation())
 		return;
 
+	const u64 start_us = porting::getTimeUs();
+	const std::vector<StaticObject> &stored = block->m_static_objects.getAllStored();
+
+	// Read the static data of entities on the worker threads first,
+	// creating the objects and on_activate stay on this thread
+	std::vector<std::optional<LuaEntitySAO::StaticData>> entity_data;
+	std::vector<std::exception_ptr> entity_errors;
+	if (m_object_activation_pool && stored.size() >= 8) {
+		ScopeProfiler sp(g_profiler, "ServerEnv: read static objects", SPT_AVG);
+		entity_data.resize(stored.size());
+		entity_errors.resize(stored.size());
+		m_object_activation_pool->run(stored.size(), [&](size_t i) {
+			if (stored[i].type != ACTIVEOBJECT_TYPE_LUAENTITY)
+				return;
+			try {
+				entity_data[i] = LuaEntitySAO::readStaticData(stored[i].data);
+			} catch (...) {
+				entity_errors[i] = std::current_exception();
+			}
+		});
+	}
+
 	// Activate stored objects
 	std::vector<StaticObject> new_stored;
-	for (const StaticObject &s_obj : block->m_static_objects.getAllStored()) {
+	for (size_t i = 0; i < stored.size(); i++) {
+		const StaticObject &s_obj = stored[i];
+
+		if (i > 0 && isObjectTimeBudgetUsed(start_us)) {
+			// Out of time, the rest is activated in the next steps
+			new_stored.insert(new_stored.end(), stored.begin() + i, stored.end());
+			m_deferred_object_blocks.emplace_back(block->getPos(), dtime_s);
+			infostream << "ServerEnvironment::activateObjects(): deferred "
+				<< (stored.size() - i) << " objects in block " << block->getPos()
+				<< std::endl;
+			break;
+		}
+
 		// Create an active object from the data
-		std::unique_ptr<ServerActiveObject> obj =
-				createSAO((ActiveObjectType)s_obj.type, s_obj.pos, s_obj.data);
+		std::unique_ptr<ServerActiveObject> obj;
+		if (i < entity_errors.size() && entity_errors[i])
+			std::rethrow_exception(entity_errors[i]);
+		if (i < entity_data.size() && entity_data[i])
+			obj = std::make_unique<LuaEntitySAO>(this, s_obj.pos, std::move(*entity_data[i]));
+		else
+			obj = createSAO((ActiveObjectType)s_obj.type, s_obj.pos, s_obj.data);
 		// If couldn't create object, store static data back.
 		if (!obj) {
 			errorstream << "ServerEnvironment::activateObjects(): "
@@ -1605,16 +1995,19 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 		}
 
 		// callbacks could invalidate this block
-		if (block->isOrphan())
+		if (block->isOrphan()) {
+			m_object_time_us += porting::getTimeUs() - start_us;
 			return;
+		}
 	}
 
 	// Clear stored list
 	block->m_static_objects.clearStored();
-	// Add leftover failed stuff to stored list
+	// Add leftover failed and deferred stuff to stored list
 	for (const StaticObject &s_obj : new_stored) {
 		block->m_static_objects.pushStored(s_obj);
 	}
+	m_object_time_us += porting::getTimeUs() - start_us;
 
 	/*
 		Note: Block hasn't really been modified here.
@@ -1626,6 +2019,29 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 	*/
 }
 
+void ServerEnvironment::activateDeferredObjects()
+{
+	// Blocks deferred again go to the back
+	size_t count = m_deferred_object_blocks.size();
+	while (count-- > 0 && !isObjectTimeBudgetUsed(porting::getTimeUs())) {
+		const auto [blockpos, dtime_s] = m_deferred_object_blocks.front();
+		m_deferred_object_blocks.pop_front();
+		// Inactive blocks keep their objects stored until they are activated again
+		if (!m_active_blocks.contains(blockpos))
+			continue;
+		if (MapBlock *block = m_map->getBlockNoCreateNoEx(blockpos))
+			activateObjects(block, dtime_s);
+	}
+}
+
+bool ServerEnvironment::isObjectTimeBudgetUsed(u64 start_us) const
+{
+	if (m_cache_object_time_budget <= 0)
+		return false;
+	const u64 used_us = m_object_time_us + (porting::getTimeUs() - start_us);
+	return used_us > m_cache_object_time_budget * 1000000;
+}
+
 /*
 	Convert objects that are not standing inside active blocks to static.
 
@@ -1639,7 +2055,8 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 */
 void ServerEnvironment::deactivateFarObjects(const bool _force_delete)
 {
-	auto cb_deactivate = [this, _force_delete](ServerActiveObject *obj, u16 id) {
+	const u64 start_us = porting::getTimeUs();
+	auto cb_deactivate = [this, _force_delete, start_us](ServerActiveObject *obj, u16 id) {
 		// force_delete might be overridden per object
 		bool force_delete = _force_delete;
 
@@ -1651,6 +2068,10 @@ void ServerEnvironment::deactivateFarObjects(const bool _force_delete)
 		if (!force_delete && obj->isGone())
 			return false;
 
+		// Out of time, the rest is done in the next call
+		if (!force_delete && isObjectTimeBudgetUsed(start_us))
+			return false;
+
 		const v3f &objectpos = obj->getBasePosition();
 
 		// The block in which the object resides in
@@ -1759,6 +2180,7 @@ void ServerEnvironment::deactivateFarObjects(const bool _force_delete)
 	};
 
 	m_ao_manager.clearIf(cb_deactivate);
+	m_object_time_us += porting::getTimeUs() - start_us;
 }
 
 void ServerEnvironment::deleteStaticFromBlock(
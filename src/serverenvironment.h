@@ -4,14 +4,18 @@
 
 #pragma once
 
+#include <deque>
 #include <set>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "activeobject.h"
 #include "environment.h"
 #include "servermap.h"
 #include "util/guid.h"
 #include "map.h"
+#include "nodetimer.h"
 #include "settings.h"
 #include "server/activeobjectmgr.h"
 #include "server/blockmodifier.h"
@@ -29,6 +33,8 @@ struct StaticObject;
 class ServerActiveObject;
 class Server;
 class ServerScripting;
+class NavigationCache;
+class PathfinderPool;
 enum AccessDeniedCode : u8;
 typedef u16 session_t;
 
@@ -46,6 +52,24 @@ class ActiveBlockList
 		std::set<v3s16> &blocks_added,
 		std::set<v3s16> &extra_blocks_added);
 
+	struct PlayerRange {
+		// any id that stays the same while the player is active
+		u16 id;
+		v3s16 blockpos;
+	};
+
+	/**
+	 * Does the work of update(), with the view cone blocks already collected.
+	 * Only the blocks entering or leaving a player's range are looked at,
+	 * so this is cheap while the players stay in their blocks.
+	 */
+	void updateRanges(const std::vector<PlayerRange> &players,
+		s16 active_block_range,
+		std::set<v3s16> &extralist,
+		std::set<v3s16> &blocks_removed,
+		std::set<v3s16> &blocks_added,
+		std::set<v3s16> &extra_blocks_added);
+
 	bool contains(v3s16 p) const {
 		return (m_list.find(p) != m_list.end());
 	}
@@ -56,12 +80,20 @@ class ActiveBlockList
 
 	void clear() {
 		m_list.clear();
+		m_abm_list.clear();
+		m_extra_list.clear();
+		m_refcount.clear();
+		m_player_ranges.clear();
+		m_forceloaded_applied.clear();
+		m_dirty.clear();
 	}
 
 	/// @return true if block was newly added
 	bool add(v3s16 p) {
 		if (m_list.insert(p).second) {
 			m_abm_list.insert(p);
+			// checked again on the next update
+			m_dirty.push_back(p);
 			return true;
 		}
 		return false;
@@ -70,6 +102,7 @@ class ActiveBlockList
 	void remove(v3s16 p) {
 		m_list.erase(p);
 		m_abm_list.erase(p);
+		m_dirty.push_back(p);
 	}
 
 	// list of all active blocks
@@ -79,6 +112,33 @@ class ActiveBlockList
 	std::set<v3s16> m_abm_list;
 	// list of blocks that are always active, not modified by this class
 	std::set<v3s16> m_forceloaded_list;
+
+private:
+	struct Sphere {
+		v3s16 center;
+		s16 radius = -1; // < 0 means empty
+	};
+
+	struct TrackedRange {
+		Sphere sphere;
+		u32 generation;
+	};
+
+	void ref(v3s16 p);
+	void unref(v3s16 p);
+	// Adjusts the reference counts for a sphere moving from a to b
+	void moveSphere(const Sphere &a, const Sphere &b);
+
+	// number of player ranges and forceloads that contain each block
+	std::unordered_map<v3s16, u32> m_refcount;
+	std::unordered_map<u16, TrackedRange> m_player_ranges;
+	// view cone blocks of the last update, subset of `m_list`
+	std::set<v3s16> m_extra_list;
+	// forceloaded blocks counted in m_refcount
+	std::set<v3s16> m_forceloaded_applied;
+	// blocks that may have to be added to or removed from the lists
+	std::vector<v3s16> m_dirty;
+	u32 m_generation = 0;
 };
 
 /*
@@ -115,6 +175,15 @@ class ServerEnvironment final : public Environment
 
 	ServerMap & getServerMap();
 
+	// nullptr if disabled
+	NavigationCache *getNavigationCache() { return m_navigation_cache.get(); }
+
+	// Runs the searches of core.find_path_async()
+	PathfinderPool *getPathfinderPool() { return m_pathfinder_pool.get(); }
+
+	// Worker threads for core.line_of_sight_batch(), nullptr if disabled
+	WorkerPool *getRaycastPool() { return m_raycast_pool.get(); }
+
 	//TODO find way to remove this fct!
 	ServerScripting* getScriptIface()
 	{ return m_script; }
@@ -125,6 +194,9 @@ class ServerEnvironment final : public Environment
 	float getSendRecommendedInterval()
 	{ return m_recommended_send_interval; }
 
+	// No player is within entity_sleep_distance of pos
+	bool isFarFromPlayers(v3f pos) const;
+
 	GUIDGenerator & getGUIDGenerator()
 	{ return m_guid_generator; }
 
@@ -175,7 +247,8 @@ class ServerEnvironment final : public Environment
 	void getAddedActiveObjects(PlayerSAO *playersao, s16 radius,
 		s16 player_radius,
 		const std::set<u16> &current_objects,
-		std::vector<u16> &added_objects);
+		std::vector<u16> &added_objects,
+		std::unordered_map<v3s16, u32> *seen_cells = nullptr);
 
 	/*
 		Find out what new objects have been removed from
@@ -221,6 +294,11 @@ class ServerEnvironment final : public Environment
 	bool setNode(v3s16 p, const MapNode &n);
 	bool removeNode(v3s16 p);
 	bool swapNode(v3s16 p, const MapNode &n);
+	// Bulk versions with a single event and lighting update. The callbacks
+	// run after all nodes were set. Positions that couldn't be set are
+	// removed from the vector.
+	bool setNodes(std::vector<v3s16> &positions, const MapNode &n);
+	bool swapNodes(std::vector<v3s16> &positions, const MapNode &n);
 
 	// Find the daylight value at pos with a Depth First Search
 	u8 findSunlight(v3s16 pos) const;
@@ -324,8 +402,15 @@ class ServerEnvironment final : public Environment
 
 	/*
 		Convert stored objects from block to active
+
+		Objects that don't fit into the time budget of the step stay stored
+		and are activated by activateDeferredObjects() in the next steps.
 	*/
 	void activateObjects(MapBlock *block, u32 dtime_s);
+	void activateDeferredObjects();
+	// Whether the time for (de)activating objects in this step is used up,
+	// start_us is when the current call started
+	bool isObjectTimeBudgetUsed(u64 start_us) const;
 
 	/*
 		Convert objects that are not in active blocks to static.
@@ -374,6 +459,8 @@ class ServerEnvironment final : public Environment
 	IntervalLimiter m_active_blocks_mgmt_interval;
 	IntervalLimiter m_active_block_modifier_interval;
 	IntervalLimiter m_active_blocks_nodemetadata_interval;
+	// Node timers of all active blocks
+	NodeTimerQueue m_node_timer_queue;
 	// Whether the variables below have been read from file yet
 	bool m_meta_loaded = false;
 	// Time from the beginning of the game in seconds.
@@ -386,6 +473,21 @@ class ServerEnvironment final : public Environment
 	u32 m_last_clear_objects_time = 0;
 	// Active block modifiers
 	std::vector<ABMWithState> m_abms;
+	// Worker threads for scanning blocks for ABMs, optional
+	std::unique_ptr<WorkerPool> m_abm_scan_pool;
+	// Worker threads for gathering the node collisions of entities, optional
+	std::unique_ptr<WorkerPool> m_entity_physics_pool;
+	// Worker threads for batches of line of sight checks, optional
+	std::unique_ptr<WorkerPool> m_raycast_pool;
+	// Worker threads for reading the static data of activated objects, optional
+	std::unique_ptr<WorkerPool> m_object_activation_pool;
+	// Blocks with objects left to activate, and their dtime_s
+	std::deque<std::pair<v3s16, u32>> m_deferred_object_blocks;
+	// Time spent (de)activating objects in this step
+	u64 m_object_time_us = 0;
+	// Block-level graph for long paths, optional
+	std::unique_ptr<NavigationCache> m_navigation_cache;
+	std::unique_ptr<PathfinderPool> m_pathfinder_pool;
 	LBMManager m_lbm_mgr;
 	// An interval for generally sending object positions and stuff
 	float m_recommended_send_interval = 0.1f;
@@ -402,6 +504,9 @@ class ServerEnvironment final : public Environment
 	float m_cache_abm_interval;
 	float m_cache_nodetimer_interval;
 	float m_cache_abm_time_budget;
+	float m_cache_nodetimer_time_budget;
+	float m_cache_entity_sleep_distance;
+	float m_cache_object_time_budget;
 
 	// peer_ids in here should be unique, except that there may be many 0s
 	std::vector<RemotePlayer*> m_players;
@@ -21,6 +21,11 @@
 #include "mapgen/mg_biome.h"
 #include "config.h"
 #include "server.h"
+#include "server/blockexistenceindex.h"
+#include "server/blockprefetcher.h"
+#include "server/mapbackupthread.h"
+#include "server/mapsavethread.h"
+#include "threading/workerpool.h"
 #include "database/database.h"
 #include "database/database-dummy.h"
 #include "database/database-sqlite3.h"
@@ -43,11 +48,40 @@
 void MapDatabaseAccessor::loadBlock(v3s16 blockpos, std::string &ret)
 {
 	ret.clear();
+	if (save_thread && save_thread->getPending(blockpos, ret))
+		return;
+	if (index && !index->mayExist(blockpos))
+		return;
 	dbase->loadBlock(blockpos, &ret);
 	if (ret.empty() && dbase_ro)
 		dbase_ro->loadBlock(blockpos, &ret);
 }
 
+void MapDatabaseAccessor::loadBlocks(const std::vector<v3s16> &positions,
+	const MapDatabase::LoadBlockCallback &cb)
+{
+	std::vector<v3s16> from_db, from_ro;
+	std::string data;
+	for (v3s16 pos : positions) {
+		data.clear();
+		if (save_thread && save_thread->getPending(pos, data))
+			cb(pos, data);
+		else if (index && !index->mayExist(pos))
+			cb(pos, data);
+		else
+			from_db.push_back(pos);
+	}
+
+	dbase->loadBlocks(from_db, [&] (v3s16 pos, std::string &data) {
+		if (data.empty() && dbase_ro)
+			from_ro.push_back(pos);
+		else
+			cb(pos, data);
+	});
+	if (!from_ro.empty())
+		dbase_ro->loadBlocks(from_ro, cb);
+}
+
 /*
 	ServerMap
 */
@@ -94,8 +128,45 @@ ServerMap::ServerMap(const std::string &savedir, IGameDef *gamedef,
 		"minetest_map_saved_blocks", "Number of blocks saved");
 	m_loaded_blocks_gauge = mb->addGauge(
 		"minetest_map_loaded_blocks", "Number of loaded blocks");
+	m_compact_blocks_gauge = mb->addGauge(
+		"minetest_map_compact_blocks", "Number of loaded blocks in compact storage");
+	m_save_queue_gauge = mb->addGauge(
+		"minetest_map_save_queue", "Number of blocks waiting to be written");
 
 	m_map_compression_level = rangelim(g_settings->getS16("map_compression_level_disk"), -1, 9);
+	m_compact_blocks = g_settings->getBool("compact_mapblocks");
+
+	u16 liquid_threads = g_settings->getU16("liquid_threads");
+	if (liquid_threads > 0)
+		m_liquid_pool = std::make_unique<WorkerPool>("Liquid", liquid_threads);
+
+	// Blocks compressed with the dictionary can't be read without it, so it
+	// is always loaded even if the setting was turned off later
+	m_zstd_dict = loadDictionary(savedir, m_map_compression_level);
+	m_use_zstd_dict = g_settings->getBool("map_compression_dictionary");
+
+	if (g_settings->getBool("map_save_async")) {
+		// Limit for uncompressed data waiting to be written
+		const size_t max_bytes = 256 * 1024 * 1024;
+		m_save_thread = std::make_unique<MapSaveThread>(&m_db,
+			m_map_compression_level, max_bytes,
+			g_settings->getU16("block_serialize_threads"));
+		MutexAutoLock dblock(m_db.mutex);
+		m_db.save_thread = m_save_thread.get();
+	}
+
+	if (g_settings->getBool("block_existence_index")) {
+		m_existence_index = std::make_unique<BlockExistenceIndex>(&m_db);
+		MutexAutoLock dblock(m_db.mutex);
+		m_db.index = m_existence_index.get();
+	}
+
+	if (u32 cache_mb = g_settings->getU32("block_prefetch_cache_size")) {
+		m_prefetcher = std::make_unique<BlockPrefetcher>(&m_db,
+			(size_t)cache_mb * 1024 * 1024);
+		MutexAutoLock dblock(m_db.mutex);
+		m_db.prefetcher = m_prefetcher.get();
+	}
 
 	try {
 		// If directory exists, check contents and load if possible
@@ -157,8 +228,34 @@ ServerMap::~ServerMap()
 				 << ", exception: " << e.what() << std::endl;
 	}
 
+	if (m_prefetcher) {
+		{
+			MutexAutoLock dblock(m_db.mutex);
+			m_db.prefetcher = nullptr;
+		}
+		m_prefetcher.reset();
+	}
+
+	// An unfinished backup is abandoned
+	m_backup_thread.reset();
+
+	if (m_save_thread) {
+		// Waits for all pending blocks to be written
+		m_save_thread.reset();
+		MutexAutoLock dblock(m_db.mutex);
+		m_db.save_thread = nullptr;
+	}
+
 	m_emerge->resetMap();
 
+	if (m_existence_index) {
+		{
+			MutexAutoLock dblock(m_db.mutex);
+			m_db.index = nullptr;
+		}
+		m_existence_index.reset();
+	}
+
 	{
 		MutexAutoLock dblock(m_db.mutex);
 		delete m_db.dbase;
@@ -195,16 +292,42 @@ bool ServerMap::blockpos_over_mapgen_limit(v3s16 p)
 		p.Z >  mapgen_limit_bp;
 }
 
-bool ServerMap::initBlockMake(v3s16 blockpos, BlockMakeData *data)
+void ServerMap::reserveChunk(v3s16 bpmin)
+{
+	const s16 csize = getMapgenParams()->chunksize;
+	auto overlaps = [&] () {
+		// the border overlaps the neighbors', including diagonally
+		for (s16 z = -1; z <= 1; z++)
+		for (s16 y = -1; y <= 1; y++)
+		for (s16 x = -1; x <= 1; x++) {
+			if (m_chunks_in_progress.count(bpmin + v3s16(x, y, z) * csize))
+				return true;
+		}
+		return false;
+	};
+
+	std::unique_lock<std::mutex> lock(m_chunks_mutex);
+	m_chunks_cv.wait(lock, [&] { return !overlaps(); });
+	m_chunks_in_progress.insert(bpmin);
+}
+
+void ServerMap::releaseChunk(v3s16 bpmin)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_chunks_mutex);
+		m_chunks_in_progress.erase(bpmin);
+	}
+	m_chunks_cv.notify_all();
+}
+
+bool ServerMap::initBlockMake(v3s16 blockpos, BlockMakeData *data,
+	const std::unordered_map<v3s16, std::string> &preloaded)
 {
 	assert(data);
 	s16 csize = getMapgenParams()->chunksize;
 	v3s16 bpmin = EmergeManager::getContainingChunk(blockpos, csize);
 	v3s16 bpmax = bpmin + v3s16(1, 1, 1) * (csize - 1);
 
-	if (!m_chunks_in_progress.insert(bpmin).second)
-		return false;
-
 	bool enable_mapgen_debug_info = m_emerge->enable_mapgen_debug_info;
 	EMERGE_DBG_OUT("initBlockMake(): " << bpmin << " - " << bpmax);
 
@@ -235,7 +358,14 @@ bool ServerMap::initBlockMake(v3s16 blockpos, BlockMakeData *data)
 		for (s16 y = full_bpmin.Y; y <= full_bpmax.Y; y++) {
 			v3s16 p(x, y, z);
 
-			MapBlock *block = emergeBlock(p, false);
+			MapBlock *block = getBlockNoCreateNoEx(p);
+			if (!block) {
+				auto it = preloaded.find(p);
+				if (it == preloaded.end())
+					block = emergeBlock(p, false);
+				else if (!it->second.empty())
+					block = loadBlock(it->second, p);
+			}
 			if (block == NULL) {
 				block = createBlock(p);
 
@@ -317,7 +447,7 @@ void ServerMap::finishBlockMake(BlockMakeData *data,
 		block->setTimestampNoChangedFlag(now);
 	}
 
-	m_chunks_in_progress.erase(bpmin);
+	releaseChunk(bpmin);
 }
 
 MapSector *ServerMap::createSector(v2s16 p2d)
@@ -426,7 +556,20 @@ void ServerMap::addNodeAndUpdate(v3s16 p, MapNode n,
 		bool remove_metadata)
 {
 	Map::addNodeAndUpdate(p, n, modified_blocks, remove_metadata);
+	queueLiquidNeighbors(p);
+}
 
+bool ServerMap::addNodesWithEvent(std::vector<v3s16> &positions, MapNode n,
+		bool remove_metadata)
+{
+	bool succeeded = Map::addNodesWithEvent(positions, n, remove_metadata);
+	for (v3s16 p : positions)
+		queueLiquidNeighbors(p);
+	return succeeded;
+}
+
+void ServerMap::queueLiquidNeighbors(v3s16 p)
+{
 	/*
 		Add neighboring liquid nodes and this node to transform queue.
 		(it's vital for the node itself to get updated last, if it was removed.)
@@ -471,6 +614,8 @@ void ServerMap::reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks
 	m_loaded_blocks_gauge->set(all_blocks);
 	m_save_time_counter->increment(save_time_us);
 	m_save_count_counter->increment(saved_blocks);
+	if (m_save_thread)
+		m_save_queue_gauge->set(m_save_thread->getPendingCount());
 }
 
 void ServerMap::save(ModifiedState save_level)
@@ -547,12 +692,66 @@ void ServerMap::save(ModifiedState save_level)
 
 void ServerMap::listAllLoadableBlocks(std::vector<v3s16> &dst)
 {
+	if (m_save_thread)
+		m_save_thread->flush();
 	MutexAutoLock dblock(m_db.mutex);
 	m_db.dbase->listAllLoadableBlocks(dst);
 	if (m_db.dbase_ro)
 		m_db.dbase_ro->listAllLoadableBlocks(dst);
 }
 
+bool ServerMap::listLoadableBlocks(LoadableBlocksCursor &cursor, u32 max_count,
+	std::vector<v3s16> &dst)
+{
+	if (m_save_thread)
+		m_save_thread->flush();
+	MutexAutoLock dblock(m_db.mutex);
+	if (!cursor.main.done) {
+		m_db.dbase->listLoadableBlocks(cursor.main, max_count, dst);
+		if (!cursor.main.done || m_db.dbase_ro)
+			return true;
+	}
+	if (!m_db.dbase_ro)
+		return false;
+	m_db.dbase_ro->listLoadableBlocks(cursor.ro, max_count, dst);
+	return !cursor.ro.done;
+}
+
+void ServerMap::startBackup(const std::string &dir)
+{
+	if (isBackupRunning())
+		throw BaseException("A map backup is still running");
+	m_backup_thread.reset();
+
+	// Blocks only changed in memory should be in it
+	save(MOD_STATE_WRITE_NEEDED);
+	if (m_save_thread)
+		m_save_thread->flush();
+
+	std::unique_ptr<MapDatabaseBackup> backup;
+	{
+		MutexAutoLock dblock(m_db.mutex);
+		backup = m_db.dbase->createBackup(dir);
+	}
+	if (!backup)
+		throw BaseException("The map backend can't make backups");
+
+	actionstream << "Starting map backup to " << dir << std::endl;
+	m_backup_thread = std::make_unique<MapBackupThread>(&m_db,
+		std::move(backup), m_savedir, dir);
+}
+
+bool ServerMap::isBackupRunning()
+{
+	return m_backup_thread && !m_backup_thread->isDone();
+}
+
+void ServerMap::prefetchBlocks(std::vector<v3s16> &&positions)
+{
+	if (m_prefetcher && !positions.empty())
+		m_prefetcher->request(std::move(positions));
+}
+
 void ServerMap::listAllLoadedBlocks(std::vector<v3s16> &dst)
 {
 	for (auto &sector_it : m_sectors) {
@@ -568,6 +767,42 @@ void ServerMap::listAllLoadedBlocks(std::vector<v3s16> &dst)
 	}
 }
 
+ServerMap::MemoryUsage ServerMap::getMemoryUsage() const
+{
+	MemoryUsage usage;
+	for (auto &sector_it : m_sectors) {
+		const MapSector *sector = sector_it.second;
+		usage.blocks += sizeof(MapSector);
+		for (auto &block_it : sector->getBlocks()) {
+			const MapBlock *block = block_it.second.get();
+			usage.block_count++;
+			usage.blocks += sizeof(MapBlock) + block->getNodeDataMemoryUsage() +
+				block->contents.capacity() * sizeof(content_t);
+			usage.node_metadata += block->m_node_metadata.getMemoryUsage();
+			usage.static_objects += block->m_static_objects.getMemoryUsage();
+		}
+	}
+	return usage;
+}
+
+void ServerMap::compactIdleBlocks()
+{
+	if (!m_compact_blocks)
+		return;
+
+	u32 compact_count = 0;
+	MapBlockVect blocks;
+	for (auto &sector_it : m_sectors) {
+		blocks.clear();
+		sector_it.second->getBlocks(blocks);
+		for (MapBlock *block : blocks) {
+			if (block->compactIfIdle())
+				compact_count++;
+		}
+	}
+	m_compact_blocks_gauge->set(compact_count);
+}
+
 MapDatabase *ServerMap::createDatabase(
 	const std::string &name,
 	const std::string &savedir,
@@ -578,6 +813,11 @@ MapDatabase *ServerMap::createDatabase(
 
 	if (name == "sqlite3")
 		db = new MapDatabaseSQLite3(savedir);
+	if (name == "sqlite3_sharded") {
+		u32 num_shards = 16;
+		conf.getU32NoEx("sqlite3_shards", num_shards);
+		db = new MapDatabaseSQLite3Sharded(savedir, num_shards);
+	}
 	if (name == "dummy")
 		db = new Database_Dummy();
 	#if USE_LEVELDB
@@ -606,24 +846,58 @@ MapDatabase *ServerMap::createDatabase(
 
 void ServerMap::beginSave()
 {
+	// the save thread uses its own transactions
+	if (m_save_thread)
+		return;
 	MutexAutoLock dblock(m_db.mutex);
 	m_db.dbase->beginSave();
 }
 
 void ServerMap::endSave()
 {
+	if (m_save_thread)
+		return;
 	MutexAutoLock dblock(m_db.mutex);
 	m_db.dbase->endSave();
 }
 
 bool ServerMap::saveBlock(MapBlock *block)
 {
+	if (m_use_zstd_dict && !m_zstd_dict)
+		addDictionarySample(block);
+	const ZstdDictionary *dict = m_use_zstd_dict ? m_zstd_dict.get() : nullptr;
+
+	// before the block can be read back
+	if (m_existence_index)
+		m_existence_index->add(block->getPos());
+
+	if (m_save_thread) {
+		// Only take a snapshot here, compression and the database write
+		// happen on the save thread
+		u8 version = SER_FMT_VER_HIGHEST_WRITE;
+		static_assert(SER_FMT_VER_HIGHEST_WRITE >= 29,
+			"compression must be separate from serialization");
+		std::ostringstream o(std::ios_base::binary);
+		block->serialize(o, version, true, m_map_compression_level, false);
+		m_save_thread->enqueue(block->getPos(), version, o.str(), dict);
+		block->resetModified();
+		// the prefetcher reads pending blocks from the save thread, so
+		// only data read before the enqueue can be outdated
+		if (m_prefetcher)
+			m_prefetcher->invalidate(block->getPos());
+		return true;
+	}
+
 	// FIXME: serialization happens under mutex
 	MutexAutoLock dblock(m_db.mutex);
-	return saveBlock(block, m_db.dbase, m_map_compression_level);
+	bool ret = saveBlock(block, m_db.dbase, m_map_compression_level, dict);
+	if (m_prefetcher)
+		m_prefetcher->invalidate(block->getPos());
+	return ret;
 }
 
-bool ServerMap::saveBlock(MapBlock *block, MapDatabase *db, int compression_level)
+bool ServerMap::saveBlock(MapBlock *block, MapDatabase *db, int compression_level,
+	const ZstdDictionary *dict)
 {
 	v3s16 p3d = block->getPos();
 
@@ -636,7 +910,13 @@ bool ServerMap::saveBlock(MapBlock *block, MapDatabase *db, int compression_leve
 	*/
 	std::ostringstream o(std::ios_base::binary);
 	o.write((char*) &version, 1);
-	block->serialize(o, version, true, compression_level);
+	if (dict) {
+		std::ostringstream raw(std::ios_base::binary);
+		block->serialize(raw, version, true, compression_level, false);
+		compress(raw.str(), o, version, compression_level, dict);
+	} else {
+		block->serialize(o, version, true, compression_level);
+	}
 
 	// FIXME: zero copy possible in c++20 or with custom rdbuf
 	bool ret = db->saveBlock(p3d, o.str());
@@ -647,7 +927,8 @@ bool ServerMap::saveBlock(MapBlock *block, MapDatabase *db, int compression_leve
 	return ret;
 }
 
-void ServerMap::deSerializeBlock(MapBlock *block, std::istream &is)
+void ServerMap::deSerializeBlock(MapBlock *block, std::istream &is,
+	const ZstdDictionary *dict)
 {
 	ScopeProfiler sp(g_profiler, "ServerMap: deSer block", SPT_AVG, PRECISION_MICRO);
 
@@ -655,7 +936,59 @@ void ServerMap::deSerializeBlock(MapBlock *block, std::istream &is)
 	if (is.fail())
 		throw SerializationError("Failed to read MapBlock version");
 
-	block->deSerialize(is, version, true);
+	block->deSerialize(is, version, true, dict);
+}
+
+static std::string getDictionaryPath(const std::string &savedir)
+{
+	return savedir + DIR_DELIM + "map_dict.zst";
+}
+
+std::unique_ptr<ZstdDictionary> ServerMap::loadDictionary(
+	const std::string &savedir, int compression_level)
+{
+	std::string data;
+	if (!fs::ReadFile(getDictionaryPath(savedir), data))
+		return nullptr;
+	// same level mapping as compress()
+	return std::make_unique<ZstdDictionary>(data, compression_level + 1);
+}
+
+void ServerMap::addDictionarySample(MapBlock *block)
+{
+	// a few MB of typical blocks are enough for a good dictionary
+	constexpr size_t SAMPLE_COUNT = 500;
+	if (m_dict_samples.size() >= SAMPLE_COUNT)
+		return;
+
+	std::ostringstream o(std::ios_base::binary);
+	block->serialize(o, SER_FMT_VER_HIGHEST_WRITE, true, m_map_compression_level, false);
+	m_dict_samples.push_back(o.str());
+	if (m_dict_samples.size() == SAMPLE_COUNT)
+		trainDictionary();
+}
+
+void ServerMap::trainDictionary()
+{
+	ScopeProfiler sp(g_profiler, "ServerMap: train dictionary", SPT_AVG);
+
+	std::string data = ZstdDictionary::train(m_dict_samples, 64 * 1024);
+	m_dict_samples.clear();
+	if (data.empty()) {
+		warningstream << "ServerMap: Failed to train a compression dictionary" << std::endl;
+		m_use_zstd_dict = false;
+		return;
+	}
+
+	// The dictionary must be on disk before any block uses it
+	if (!fs::safeWriteToFile(getDictionaryPath(m_savedir), data)) {
+		errorstream << "ServerMap: Failed to write compression dictionary" << std::endl;
+		m_use_zstd_dict = false;
+		return;
+	}
+	m_zstd_dict = std::make_unique<ZstdDictionary>(data, m_map_compression_level + 1);
+	actionstream << "ServerMap: Trained compression dictionary of "
+		<< data.size() << " bytes" << std::endl;
 }
 
 MapBlock *ServerMap::loadBlock(const std::string &blob, v3s16 p3d, bool save_after_load)
@@ -677,7 +1010,7 @@ MapBlock *ServerMap::loadBlock(const std::string &blob, v3s16 p3d, bool save_aft
 
 		{
 			std::istringstream iss(blob, std::ios_base::binary);
-			deSerializeBlock(block, iss);
+			deSerializeBlock(block, iss, m_zstd_dict.get());
 		}
 
 		// If it's a new block, insert it to the map
@@ -707,16 +1040,9 @@ MapBlock *ServerMap::loadBlock(const std::string &blob, v3s16 p3d, bool save_aft
 		ReflowScan scanner(this, m_emerge->ndef);
 		scanner.scan(block, &m_transforming_liquid);
 
-		std::map<v3s16, MapBlock*> modified_blocks;
-		// Fix lighting if necessary
-		voxalgo::update_block_border_lighting(this, block, modified_blocks);
-		if (!modified_blocks.empty()) {
-			MapEditEvent event;
-			event.type = MEET_OTHER;
-			event.low_priority = true;
-			event.setModifiedBlocks(modified_blocks);
-			dispatchEvent(event);
-		}
+		// Fix lighting if necessary, together with the other blocks
+		// loaded during this step
+		m_border_lighting_queue.push_back(p3d);
 	}
 
 	if (save_after_load)
@@ -745,6 +1071,10 @@ MapBlock* ServerMap::loadBlock(v3s16 blockpos)
 bool ServerMap::deleteBlock(v3s16 blockpos)
 {
 	MutexAutoLock dblock(m_db.mutex);
+	if (m_save_thread)
+		m_save_thread->cancel(blockpos);
+	if (m_prefetcher)
+		m_prefetcher->invalidate(blockpos);
 	if (!m_db.dbase->deleteBlock(blockpos))
 		return false;
 
@@ -784,6 +1114,32 @@ void ServerMap::PrintInfo(std::ostream &out)
 	out<<"ServerMap: ";
 }
 
+void ServerMap::updateBorderLighting()
+{
+	if (m_border_lighting_queue.empty())
+		return;
+
+	ScopeProfiler sp(g_profiler, "ServerMap: border lighting", SPT_AVG);
+	// Blocks may have been unloaded again in the meantime
+	std::vector<MapBlock *> blocks;
+	blocks.reserve(m_border_lighting_queue.size());
+	for (v3s16 p : m_border_lighting_queue) {
+		if (MapBlock *block = getBlockNoCreateNoEx(p))
+			blocks.push_back(block);
+	}
+	m_border_lighting_queue.clear();
+
+	std::map<v3s16, MapBlock*> modified_blocks;
+	voxalgo::update_block_border_lighting(this, blocks, modified_blocks);
+	if (!modified_blocks.empty()) {
+		MapEditEvent event;
+		event.type = MEET_OTHER;
+		event.low_priority = true;
+		event.setModifiedBlocks(modified_blocks);
+		dispatchEvent(event);
+	}
+}
+
 bool ServerMap::repairBlockLight(v3s16 blockpos,
 	std::map<v3s16, MapBlock *> *modified_blocks)
 {
@@ -862,268 +1218,347 @@ void ServerMap::transforming_liquid_add(v3s16 p)
 	m_transforming_liquid.push_back(p);
 }
 
-void ServerMap::transformLiquids(std::map<v3s16, MapBlock*> &modified_blocks,
-		ServerEnvironment *env)
+namespace {
+
+// Outcome of the read-only part of transforming one liquid node
+struct LiquidUpdate
 {
-	u32 loopcount = 0;
-	u32 initial_size = m_transforming_liquid.size();
+	v3s16 p;
+	MapNode n_old;
+	MapNode n_new;
+	bool changed = false;
+	// the node was already changed on the map
+	bool applied = false;
+	// the node didn't reach its final level because of viscosity
+	bool reflow = false;
+	bool check_for_falling = false;
+	// a floodable node is replaced, on_flood() must be called first
+	bool on_flood = false;
+	// neighbors to enqueue in any case, and if the node changed
+	u8 num_queued = 0;
+	u8 num_queued_changed = 0;
+	v3s16 queued[6];
+	v3s16 queued_changed[6];
+};
 
-	/*if(initial_size != 0)
-		infostream<<"transformLiquids(): initial_size="<<initial_size<<std::endl;*/
+// Queued nodes of one block, transformed in parallel with other blocks
+struct LiquidBlockGroup
+{
+	v3s16 pos;
+	// 3x3x3 neighborhood of the block (index 13 is the block itself),
+	// nullptr if not loaded
+	MapBlock *blocks[27];
+	std::vector<LiquidUpdate> updates;
 
-	// list of nodes that due to viscosity have not reached their max level height
-	std::vector<v3s16> must_reflow;
+	MapBlock *block() const { return blocks[13]; }
 
-	std::vector<std::pair<v3s16, MapNode> > changed_nodes;
+	MapNode getNode(v3s16 p) const
+	{
+		v3s16 bp = getNodeBlockPos(p);
+		v3s16 d = bp - pos;
+		MapBlock *b = blocks[(d.Z + 1) * 9 + (d.Y + 1) * 3 + (d.X + 1)];
+		if (!b)
+			return MapNode(CONTENT_IGNORE);
+		return b->getNodeNoCheck(p - bp * MAP_BLOCKSIZE);
+	}
+};
 
-	std::vector<v3s16> check_for_falling;
+}
 
-	u32 liquid_loop_max = g_settings->getS32("liquid_loop_max");
-	u32 loop_max = liquid_loop_max;
+// Decides what happens to the liquid node at u.p.
+// Only reads nodes through get_node, never modifies anything.
+template <typename F>
+static void compute_liquid_update(const NodeDefManager *nodedef, const F &get_node,
+		LiquidUpdate &u)
+{
+	const v3s16 p0 = u.p;
+	MapNode n0 = get_node(p0);
+	u.n_old = n0;
 
-	while (m_transforming_liquid.size() != 0)
-	{
-		// This should be done here so that it is done when continue is used
-		if (loopcount >= initial_size || loopcount >= loop_max)
+	/*
+		Collect information about current node
+	 */
+	s8 liquid_level = -1;
+	// The liquid node which will be placed there if
+	// the liquid flows into this node.
+	content_t liquid_kind = CONTENT_IGNORE;
+	// The node which will be placed there if liquid
+	// can't flow into this node.
+	content_t floodable_node = CONTENT_AIR;
+	const ContentFeatures &cf = nodedef->get(n0);
+	LiquidType liquid_type = cf.liquid_type;
+	switch (liquid_type) {
+		case LIQUID_SOURCE:
+			liquid_level = LIQUID_LEVEL_SOURCE;
+			liquid_kind = cf.liquid_alternative_flowing_id;
 			break;
-		loopcount++;
-
-		/*
-			Get a queued transforming liquid node
-		*/
-		v3s16 p0 = m_transforming_liquid.front();
-		m_transforming_liquid.pop_front();
-
-		MapNode n0 = getNode(p0);
+		case LIQUID_FLOWING:
+			liquid_level = (n0.param2 & LIQUID_LEVEL_MASK);
+			liquid_kind = n0.getContent();
+			break;
+		case LIQUID_NONE:
+			// if this node is 'floodable', it *could* be transformed
+			// into a liquid, otherwise, continue with the next node.
+			if (!cf.floodable)
+				return;
+			floodable_node = n0.getContent();
+			liquid_kind = CONTENT_AIR;
+			break;
+		case LiquidType_END:
+			break;
+	}
 
-		/*
-			Collect information about current node
-		 */
-		s8 liquid_level = -1;
-		// The liquid node which will be placed there if
-		// the liquid flows into this node.
-		content_t liquid_kind = CONTENT_IGNORE;
-		// The node which will be placed there if liquid
-		// can't flow into this node.
-		content_t floodable_node = CONTENT_AIR;
-		const ContentFeatures &cf = m_nodedef->get(n0);
-		LiquidType liquid_type = cf.liquid_type;
-		switch (liquid_type) {
-			case LIQUID_SOURCE:
-				liquid_level = LIQUID_LEVEL_SOURCE;
-				liquid_kind = cf.liquid_alternative_flowing_id;
+	/*
+		Collect information about the environment
+	 */
+	NodeNeighbor sources[6]; // surrounding sources
+	int num_sources = 0;
+	NodeNeighbor flows[6]; // surrounding flowing liquid nodes
+	int num_flows = 0;
+	NodeNeighbor airs[6]; // surrounding air
+	int num_airs = 0;
+	NodeNeighbor neutrals[6]; // nodes that are solid or another kind of liquid
+	int num_neutrals = 0;
+	bool flowing_down = false;
+	bool ignored_sources = false;
+	bool floating_node_above = false;
+	for (u16 i = 0; i < 6; i++) {
+		NeighborType nt = NEIGHBOR_SAME_LEVEL;
+		switch (i) {
+			case 0:
+				nt = NEIGHBOR_UPPER;
 				break;
-			case LIQUID_FLOWING:
-				liquid_level = (n0.param2 & LIQUID_LEVEL_MASK);
-				liquid_kind = n0.getContent();
+			case 5:
+				nt = NEIGHBOR_LOWER;
 				break;
-			case LIQUID_NONE:
-				// if this node is 'floodable', it *could* be transformed
-				// into a liquid, otherwise, continue with the next node.
-				if (!cf.floodable)
-					continue;
-				floodable_node = n0.getContent();
-				liquid_kind = CONTENT_AIR;
-				break;
-			case LiquidType_END:
+			default:
 				break;
 		}
-
-		/*
-			Collect information about the environment
-		 */
-		NodeNeighbor sources[6]; // surrounding sources
-		int num_sources = 0;
-		NodeNeighbor flows[6]; // surrounding flowing liquid nodes
-		int num_flows = 0;
-		NodeNeighbor airs[6]; // surrounding air
-		int num_airs = 0;
-		NodeNeighbor neutrals[6]; // nodes that are solid or another kind of liquid
-		int num_neutrals = 0;
-		bool flowing_down = false;
-		bool ignored_sources = false;
-		bool floating_node_above = false;
-		for (u16 i = 0; i < 6; i++) {
-			NeighborType nt = NEIGHBOR_SAME_LEVEL;
-			switch (i) {
-				case 0:
-					nt = NEIGHBOR_UPPER;
-					break;
-				case 5:
-					nt = NEIGHBOR_LOWER;
-					break;
-				default:
-					break;
-			}
-			v3s16 npos = p0 + liquid_6dirs[i];
-			NodeNeighbor nb(getNode(npos), nt, npos);
-			const ContentFeatures &cfnb = m_nodedef->get(nb.n);
-			if (nt == NEIGHBOR_UPPER && cfnb.floats)
-				floating_node_above = true;
-			switch (cfnb.liquid_type) {
-				case LIQUID_NONE:
-					if (cfnb.floodable) {
-						airs[num_airs++] = nb;
-						// if the current node is a water source the neighbor
-						// should be enqueded for transformation regardless of whether the
-						// current node changes or not.
-						if (nb.t != NEIGHBOR_UPPER && liquid_type != LIQUID_NONE)
-							m_transforming_liquid.push_back(npos);
-						// if the current node happens to be a flowing node, it will start to flow down here.
+		v3s16 npos = p0 + liquid_6dirs[i];
+		NodeNeighbor nb(get_node(npos), nt, npos);
+		const ContentFeatures &cfnb = nodedef->get(nb.n);
+		if (nt == NEIGHBOR_UPPER && cfnb.floats)
+			floating_node_above = true;
+		switch (cfnb.liquid_type) {
+			case LIQUID_NONE:
+				if (cfnb.floodable) {
+					airs[num_airs++] = nb;
+					// if the current node is a water source the neighbor
+					// should be enqueded for transformation regardless of whether the
+					// current node changes or not.
+					if (nb.t != NEIGHBOR_UPPER && liquid_type != LIQUID_NONE)
+						u.queued[u.num_queued++] = npos;
+					// if the current node happens to be a flowing node, it will start to flow down here.
+					if (nb.t == NEIGHBOR_LOWER)
+						flowing_down = true;
+				} else {
+					neutrals[num_neutrals++] = nb;
+					if (nb.n.getContent() == CONTENT_IGNORE) {
+						// If node below is ignore prevent water from
+						// spreading outwards and otherwise prevent from
+						// flowing away as ignore node might be the source
 						if (nb.t == NEIGHBOR_LOWER)
 							flowing_down = true;
-					} else {
-						neutrals[num_neutrals++] = nb;
-						if (nb.n.getContent() == CONTENT_IGNORE) {
-							// If node below is ignore prevent water from
-							// spreading outwards and otherwise prevent from
-							// flowing away as ignore node might be the source
-							if (nb.t == NEIGHBOR_LOWER)
-								flowing_down = true;
-							else
-								ignored_sources = true;
-						}
+						else
+							ignored_sources = true;
 					}
-					break;
-				case LIQUID_SOURCE:
+				}
+				break;
+			case LIQUID_SOURCE:
+				// if this node is not (yet) of a liquid type, choose the first liquid type we encounter
+				if (liquid_kind == CONTENT_AIR)
+					liquid_kind = cfnb.liquid_alternative_flowing_id;
+				if (cfnb.liquid_alternative_flowing_id != liquid_kind) {
+					neutrals[num_neutrals++] = nb;
+				} else {
+					// Do not count bottom source, it will screw things up
+					if(nt != NEIGHBOR_LOWER)
+						sources[num_sources++] = nb;
+				}
+				break;
+			case LIQUID_FLOWING:
+				if (nb.t != NEIGHBOR_SAME_LEVEL ||
+					(nb.n.param2 & LIQUID_FLOW_DOWN_MASK) != LIQUID_FLOW_DOWN_MASK) {
 					// if this node is not (yet) of a liquid type, choose the first liquid type we encounter
-					if (liquid_kind == CONTENT_AIR)
+					// but exclude falling liquids on the same level, they cannot flow here anyway
+
+					// used to determine if the neighbor can even flow into this node
+					s8 max_level_from_neighbor = get_max_liquid_level(nb, -1);
+					u8 range = nodedef->get(cfnb.liquid_alternative_flowing_id).liquid_range;
+
+					if (liquid_kind == CONTENT_AIR &&
+							max_level_from_neighbor >= (LIQUID_LEVEL_MAX + 1 - range))
 						liquid_kind = cfnb.liquid_alternative_flowing_id;
-					if (cfnb.liquid_alternative_flowing_id != liquid_kind) {
-						neutrals[num_neutrals++] = nb;
-					} else {
-						// Do not count bottom source, it will screw things up
-						if(nt != NEIGHBOR_LOWER)
-							sources[num_sources++] = nb;
-					}
-					break;
-				case LIQUID_FLOWING:
-					if (nb.t != NEIGHBOR_SAME_LEVEL ||
-						(nb.n.param2 & LIQUID_FLOW_DOWN_MASK) != LIQUID_FLOW_DOWN_MASK) {
-						// if this node is not (yet) of a liquid type, choose the first liquid type we encounter
-						// but exclude falling liquids on the same level, they cannot flow here anyway
-
-						// used to determine if the neighbor can even flow into this node
-						s8 max_level_from_neighbor = get_max_liquid_level(nb, -1);
-						u8 range = m_nodedef->get(cfnb.liquid_alternative_flowing_id).liquid_range;
-
-						if (liquid_kind == CONTENT_AIR &&
-								max_level_from_neighbor >= (LIQUID_LEVEL_MAX + 1 - range))
-							liquid_kind = cfnb.liquid_alternative_flowing_id;
-					}
-					if (cfnb.liquid_alternative_flowing_id != liquid_kind) {
-						neutrals[num_neutrals++] = nb;
-					} else {
-						flows[num_flows++] = nb;
-						if (nb.t == NEIGHBOR_LOWER)
-							flowing_down = true;
-					}
-					break;
-				case LiquidType_END:
-					break;
-			}
+				}
+				if (cfnb.liquid_alternative_flowing_id != liquid_kind) {
+					neutrals[num_neutrals++] = nb;
+				} else {
+					flows[num_flows++] = nb;
+					if (nb.t == NEIGHBOR_LOWER)
+						flowing_down = true;
+				}
+				break;
+			case LiquidType_END:
+				break;
 		}
+	}
 
-		/*
-			decide on the type (and possibly level) of the current node
-		 */
-		content_t new_node_content;
-		s8 new_node_level = -1;
-		s8 max_node_level = -1;
-
-		u8 range = m_nodedef->get(liquid_kind).liquid_range;
-		if (range > LIQUID_LEVEL_MAX + 1)
-			range = LIQUID_LEVEL_MAX + 1;
-
-		if ((num_sources >= 2 && m_nodedef->get(liquid_kind).liquid_renewable) || liquid_type == LIQUID_SOURCE) {
-			// liquid_kind will be set to either the flowing alternative of the node (if it's a liquid)
-			// or the flowing alternative of the first of the surrounding sources (if it's air), so
-			// it's perfectly safe to use liquid_kind here to determine the new node content.
-			new_node_content = m_nodedef->get(liquid_kind).liquid_alternative_source_id;
-		} else if (num_sources >= 1 && sources[0].t != NEIGHBOR_LOWER) {
-			// liquid_kind is set properly, see above
-			max_node_level = new_node_level = LIQUID_LEVEL_MAX;
-			if (new_node_level >= (LIQUID_LEVEL_MAX + 1 - range))
-				new_node_content = liquid_kind;
-			else
-				new_node_content = floodable_node;
-		} else if (ignored_sources && liquid_level >= 0) {
-			// Maybe there are neighboring sources that aren't loaded yet
-			// so prevent flowing away.
-			new_node_level = liquid_level;
+	/*
+		decide on the type (and possibly level) of the current node
+	 */
+	content_t new_node_content;
+	s8 new_node_level = -1;
+	s8 max_node_level = -1;
+
+	u8 range = nodedef->get(liquid_kind).liquid_range;
+	if (range > LIQUID_LEVEL_MAX + 1)
+		range = LIQUID_LEVEL_MAX + 1;
+
+	if ((num_sources >= 2 && nodedef->get(liquid_kind).liquid_renewable) || liquid_type == LIQUID_SOURCE) {
+		// liquid_kind will be set to either the flowing alternative of the node (if it's a liquid)
+		// or the flowing alternative of the first of the surrounding sources (if it's air), so
+		// it's perfectly safe to use liquid_kind here to determine the new node content.
+		new_node_content = nodedef->get(liquid_kind).liquid_alternative_source_id;
+	} else if (num_sources >= 1 && sources[0].t != NEIGHBOR_LOWER) {
+		// liquid_kind is set properly, see above
+		max_node_level = new_node_level = LIQUID_LEVEL_MAX;
+		if (new_node_level >= (LIQUID_LEVEL_MAX + 1 - range))
 			new_node_content = liquid_kind;
+		else
+			new_node_content = floodable_node;
+	} else if (ignored_sources && liquid_level >= 0) {
+		// Maybe there are neighboring sources that aren't loaded yet
+		// so prevent flowing away.
+		new_node_level = liquid_level;
+		new_node_content = liquid_kind;
+	} else {
+		// no surrounding sources, so get the maximum level that can flow into this node
+		for (u16 i = 0; i < num_flows; i++) {
+			max_node_level = get_max_liquid_level(flows[i], max_node_level);
+		}
+
+		u8 viscosity = nodedef->get(liquid_kind).liquid_viscosity;
+		if (viscosity > 1 && max_node_level != liquid_level) {
+			// amount to gain, limited by viscosity
+			// must be at least 1 in absolute value
+			s8 level_inc = max_node_level - liquid_level;
+			if (level_inc < -viscosity || level_inc > viscosity)
+				new_node_level = liquid_level + level_inc/viscosity;
+			else if (level_inc < 0)
+				new_node_level = liquid_level - 1;
+			else if (level_inc > 0)
+				new_node_level = liquid_level + 1;
+			if (new_node_level != max_node_level)
+				u.reflow = true;
 		} else {
-			// no surrounding sources, so get the maximum level that can flow into this node
-			for (u16 i = 0; i < num_flows; i++) {
-				max_node_level = get_max_liquid_level(flows[i], max_node_level);
-			}
+			new_node_level = max_node_level;
+		}
 
-			u8 viscosity = m_nodedef->get(liquid_kind).liquid_viscosity;
-			if (viscosity > 1 && max_node_level != liquid_level) {
-				// amount to gain, limited by viscosity
-				// must be at least 1 in absolute value
-				s8 level_inc = max_node_level - liquid_level;
-				if (level_inc < -viscosity || level_inc > viscosity)
-					new_node_level = liquid_level + level_inc/viscosity;
-				else if (level_inc < 0)
-					new_node_level = liquid_level - 1;
-				else if (level_inc > 0)
-					new_node_level = liquid_level + 1;
-				if (new_node_level != max_node_level)
-					must_reflow.push_back(p0);
-			} else {
-				new_node_level = max_node_level;
-			}
+		if (max_node_level >= (LIQUID_LEVEL_MAX + 1 - range))
+			new_node_content = liquid_kind;
+		else
+			new_node_content = floodable_node;
 
-			if (max_node_level >= (LIQUID_LEVEL_MAX + 1 - range))
-				new_node_content = liquid_kind;
-			else
-				new_node_content = floodable_node;
+	}
 
-		}
+	/*
+		check if anything has changed. if not, just continue with the next node.
+	 */
+	if (new_node_content == n0.getContent() &&
+			(nodedef->get(n0.getContent()).liquid_type != LIQUID_FLOWING ||
+			((n0.param2 & LIQUID_LEVEL_MASK) == (u8)new_node_level &&
+			((n0.param2 & LIQUID_FLOW_DOWN_MASK) == LIQUID_FLOW_DOWN_MASK)
+			== flowing_down)))
+		return;
 
-		/*
-			check if anything has changed. if not, just continue with the next node.
-		 */
-		if (new_node_content == n0.getContent() &&
-				(m_nodedef->get(n0.getContent()).liquid_type != LIQUID_FLOWING ||
-				((n0.param2 & LIQUID_LEVEL_MASK) == (u8)new_node_level &&
-				((n0.param2 & LIQUID_FLOW_DOWN_MASK) == LIQUID_FLOW_DOWN_MASK)
-				== flowing_down)))
-			continue;
+	u.changed = true;
 
-		/*
-			check if there is a floating node above that needs to be updated.
-		 */
-		if (floating_node_above && new_node_content == CONTENT_AIR)
-			check_for_falling.push_back(p0);
+	/*
+		check if there is a floating node above that needs to be updated.
+	 */
+	if (floating_node_above && new_node_content == CONTENT_AIR)
+		u.check_for_falling = true;
 
-		/*
-			update the current node
-		 */
-		MapNode n00 = n0;
-		//bool flow_down_enabled = (flowing_down && ((n0.param2 & LIQUID_FLOW_DOWN_MASK) != LIQUID_FLOW_DOWN_MASK));
-		if (m_nodedef->get(new_node_content).liquid_type == LIQUID_FLOWING) {
-			// set level to last 3 bits, flowing down bit to 4th bit
-			n0.param2 = (flowing_down ? LIQUID_FLOW_DOWN_MASK : 0x00) | (new_node_level & LIQUID_LEVEL_MASK);
-		} else {
-			// set the liquid level and flow bits to 0
-			n0.param2 &= ~(LIQUID_LEVEL_MASK | LIQUID_FLOW_DOWN_MASK);
-		}
+	/*
+		update the current node
+	 */
+	//bool flow_down_enabled = (flowing_down && ((n0.param2 & LIQUID_FLOW_DOWN_MASK) != LIQUID_FLOW_DOWN_MASK));
+	if (nodedef->get(new_node_content).liquid_type == LIQUID_FLOWING) {
+		// set level to last 3 bits, flowing down bit to 4th bit
+		n0.param2 = (flowing_down ? LIQUID_FLOW_DOWN_MASK : 0x00) | (new_node_level & LIQUID_LEVEL_MASK);
+	} else {
+		// set the liquid level and flow bits to 0
+		n0.param2 &= ~(LIQUID_LEVEL_MASK | LIQUID_FLOW_DOWN_MASK);
+	}
 
-		// change the node.
-		n0.setContent(new_node_content);
+	// change the node.
+	n0.setContent(new_node_content);
 
-		// on_flood() the node
-		if (floodable_node != CONTENT_AIR) {
-			if (env->getScriptIface()->node_on_flood(p0, n00, n0))
-				continue;
-		}
+	// on_flood() the node
+	u.on_flood = floodable_node != CONTENT_AIR;
+
+	// Ignore light (because calling voxalgo::update_lighting_nodes)
+	ContentLightingFlags f0 = nodedef->getLightingFlags(n0);
+	n0.setLight(LIGHTBANK_DAY, 0, f0);
+	n0.setLight(LIGHTBANK_NIGHT, 0, f0);
+	u.n_new = n0;
+
+	/*
+		enqueue neighbors for update if necessary
+	 */
+	switch (nodedef->get(n0.getContent()).liquid_type) {
+		case LIQUID_SOURCE:
+		case LIQUID_FLOWING:
+			// make sure source flows into all neighboring nodes
+			for (u16 i = 0; i < num_flows; i++)
+				if (flows[i].t != NEIGHBOR_UPPER)
+					u.queued_changed[u.num_queued_changed++] = flows[i].p;
+			for (u16 i = 0; i < num_airs; i++)
+				if (airs[i].t != NEIGHBOR_UPPER)
+					u.queued_changed[u.num_queued_changed++] = airs[i].p;
+			break;
+		case LIQUID_NONE:
+			// this flow has turned to air; neighboring flows might need to do the same
+			for (u16 i = 0; i < num_flows; i++)
+				u.queued_changed[u.num_queued_changed++] = flows[i].p;
+			break;
+		case LiquidType_END:
+			break;
+	}
+}
+
+void ServerMap::transformLiquids(std::map<v3s16, MapBlock*> &modified_blocks,
+		ServerEnvironment *env,
+		std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes_out)
+{
+	u32 liquid_loop_max = g_settings->getS32("liquid_loop_max");
+	// Nodes queued during this step are processed in the next one
+	const u32 count = std::min<u32>(m_transforming_liquid.size(), liquid_loop_max);
+
+	// list of nodes that due to viscosity have not reached their max level height
+	std::vector<v3s16> must_reflow;
+
+	std::vector<std::pair<v3s16, MapNode> > changed_nodes;
 
-		// Ignore light (because calling voxalgo::update_lighting_nodes)
-		ContentLightingFlags f0 = m_nodedef->getLightingFlags(n0);
-		n0.setLight(LIGHTBANK_DAY, 0, f0);
-		n0.setLight(LIGHTBANK_NIGHT, 0, f0);
+	std::vector<v3s16> check_for_falling;
+
+	// Everything of a liquid update that must happen on this thread
+	auto apply = [&] (const LiquidUpdate &u) {
+		for (u8 i = 0; i < u.num_queued; i++)
+			m_transforming_liquid.push_back(u.queued[i]);
+		if (u.reflow)
+			must_reflow.push_back(u.p);
+		if (!u.changed)
+			return;
+		if (u.check_for_falling)
+			check_for_falling.push_back(u.p);
+
+		const v3s16 p0 = u.p;
+		if (u.on_flood) {
+			assert(!u.applied);
+			if (env->getScriptIface()->node_on_flood(p0, u.n_old, u.n_new))
+				return;
+		}
 
 		// Find out whether there is a suspect for this action
 		std::string suspect;
@@ -1133,57 +1568,125 @@ void ServerMap::transformLiquids(std::map<v3s16, MapBlock*> &modified_blocks,
 		if (m_gamedef->rollback() && !suspect.empty()) {
 			// Blame suspect
 			RollbackScopeActor rollback_scope(m_gamedef->rollback(), suspect, true);
-			// Get old node for rollback
-			RollbackNode rollback_oldnode(this, p0, m_gamedef);
-			// Set node
-			setNode(p0, n0);
+			RollbackNode rollback_oldnode, rollback_newnode;
+			if (u.applied) {
+				// Only the node changed, the metadata is still the same
+				rollback_newnode = RollbackNode(this, p0, m_gamedef);
+				rollback_oldnode = rollback_newnode;
+				rollback_oldnode.name = m_nodedef->get(u.n_old).name;
+				rollback_oldnode.param1 = u.n_old.param1;
+				rollback_oldnode.param2 = u.n_old.param2;
+			} else {
+				// Get old node for rollback
+				rollback_oldnode = RollbackNode(this, p0, m_gamedef);
+				// Set node
+				setNode(p0, u.n_new);
+				rollback_newnode = RollbackNode(this, p0, m_gamedef);
+			}
 			// Report
-			RollbackNode rollback_newnode(this, p0, m_gamedef);
 			RollbackAction action;
 			action.setSetNode(p0, rollback_oldnode, rollback_newnode);
 			m_gamedef->rollback()->reportAction(action);
-		} else {
+		} else if (!u.applied) {
 			// Set node
-			setNode(p0, n0);
+			setNode(p0, u.n_new);
 		}
 
 		v3s16 blockpos = getNodeBlockPos(p0);
 		MapBlock *block = getBlockNoCreateNoEx(blockpos);
 		if (block != NULL) {
 			modified_blocks[blockpos] =  block;
-			changed_nodes.emplace_back(p0, n00);
+			changed_nodes.emplace_back(p0, u.n_old);
 		}
 
-		/*
-			enqueue neighbors for update if necessary
-		 */
-		switch (m_nodedef->get(n0.getContent()).liquid_type) {
-			case LIQUID_SOURCE:
-			case LIQUID_FLOWING:
-				// make sure source flows into all neighboring nodes
-				for (u16 i = 0; i < num_flows; i++)
-					if (flows[i].t != NEIGHBOR_UPPER)
-						m_transforming_liquid.push_back(flows[i].p);
-				for (u16 i = 0; i < num_airs; i++)
-					if (airs[i].t != NEIGHBOR_UPPER)
-						m_transforming_liquid.push_back(airs[i].p);
-				break;
-			case LIQUID_NONE:
-				// this flow has turned to air; neighboring flows might need to do the same
-				for (u16 i = 0; i < num_flows; i++)
-					m_transforming_liquid.push_back(flows[i].p);
-				break;
-			case LiquidType_END:
-				break;
+		for (u8 i = 0; i < u.num_queued_changed; i++)
+			m_transforming_liquid.push_back(u.queued_changed[i]);
+	};
+
+	if (m_liquid_pool && count > 1) {
+		// Group the nodes by block. The block lookup caches of the map aren't
+		// thread-safe, so all blocks are looked up beforehand.
+		std::vector<LiquidBlockGroup> groups;
+		std::unordered_map<v3s16, size_t> group_index;
+		for (u32 i = 0; i < count; i++) {
+			LiquidUpdate u;
+			u.p = m_transforming_liquid.front();
+			m_transforming_liquid.pop_front();
+
+			const v3s16 bp = getNodeBlockPos(u.p);
+			auto it = group_index.find(bp);
+			if (it == group_index.end()) {
+				it = group_index.emplace(bp, groups.size()).first;
+				LiquidBlockGroup &group = groups.emplace_back();
+				group.pos = bp;
+				MapBlock **b = group.blocks;
+				for (s16 z = -1; z <= 1; z++)
+				for (s16 y = -1; y <= 1; y++)
+				for (s16 x = -1; x <= 1; x++)
+					*b++ = getBlockNoCreateNoEx(bp + v3s16(x, y, z));
+			}
+			groups[it->second].updates.push_back(u);
+		}
+
+		// Blocks whose coordinates have the same parities are never adjacent.
+		// Such blocks are processed in parallel: every worker only writes to
+		// its own block and reads from the neighboring ones. Whatever must
+		// happen on this thread (callbacks, queueing, rollback) follows after
+		// each pass, so the next pass already sees the changes.
+		std::vector<LiquidBlockGroup *> todo;
+		for (int parity = 0; parity < 8; parity++) {
+			todo.clear();
+			for (LiquidBlockGroup &group : groups) {
+				// nodes of unloaded blocks are ignore and can't change
+				if (group.block() && ((group.pos.X & 1) | (group.pos.Y & 1) << 1 |
+						(group.pos.Z & 1) << 2) == parity)
+					todo.push_back(&group);
+			}
+
+			m_liquid_pool->run(todo.size(), [&] (size_t i) {
+				LiquidBlockGroup &group = *todo[i];
+				auto get_node = [&group] (v3s16 p) { return group.getNode(p); };
+				for (LiquidUpdate &u : group.updates) {
+					compute_liquid_update(m_nodedef, get_node, u);
+					// on_flood() has to be called before changing the node
+					if (u.changed && !u.on_flood &&
+							u.n_new.getContent() != CONTENT_IGNORE) {
+						group.block()->setNodeNoCheck(u.p - group.pos * MAP_BLOCKSIZE,
+							u.n_new);
+						u.applied = true;
+					}
+				}
+			});
+
+			for (LiquidBlockGroup *group : todo) {
+				for (const LiquidUpdate &u : group->updates)
+					apply(u);
+			}
+		}
+	} else {
+		auto get_node = [this] (v3s16 p) { return getNode(p); };
+		for (u32 i = 0; i < count; i++) {
+			LiquidUpdate u;
+			u.p = m_transforming_liquid.front();
+			m_transforming_liquid.pop_front();
+			compute_liquid_update(m_nodedef, get_node, u);
+			apply(u);
 		}
 	}
-	//infostream<<"Map::transformLiquids(): loopcount="<<loopcount<<std::endl;
 
 	for (const auto &iter : must_reflow)
 		m_transforming_liquid.push_back(iter);
 
 	voxalgo::update_lighting_nodes(this, changed_nodes, modified_blocks);
 
+	if (changed_nodes_out) {
+		for (const auto &it : changed_nodes) {
+			const v3s16 blockpos = getNodeBlockPos(it.first);
+			(*changed_nodes_out)[blockpos].add(BlockNodeChanges::getIndex(
+				it.first - blockpos * MAP_BLOCKSIZE));
+		}
+	}
+
 	for (const v3s16 &p : check_for_falling) {
 		env->getScriptIface()->check_for_falling(p);
 	}
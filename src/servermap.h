@@ -4,10 +4,15 @@
 
 #pragma once
 
-#include <vector>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "map.h"
+#include "database/database.h"
 #include "util/container.h" // UniqueQueue
 #include "util/metricsbackend.h" // ptr typedefs
 #include "map_settings_manager.h"
@@ -19,6 +24,12 @@ class EmergeManager;
 class ServerEnvironment;
 struct BlockMakeData;
 class MetricsBackend;
+class MapSaveThread;
+class BlockPrefetcher;
+class BlockExistenceIndex;
+class MapBackupThread;
+class ZstdDictionary;
+class WorkerPool;
 
 // TODO: this could wrap all calls to MapDatabase, including locking
 struct MapDatabaseAccessor {
@@ -28,10 +39,20 @@ struct MapDatabaseAccessor {
 	MapDatabase *dbase = nullptr;
 	/// Fallback database for read operations
 	MapDatabase *dbase_ro = nullptr;
-
-	/// Load a block, taking dbase_ro into account.
+	/// Blocks not yet written by the save thread, if enabled
+	MapSaveThread *save_thread = nullptr;
+	/// Blocks read ahead of time, must be told about writes, if enabled
+	BlockPrefetcher *prefetcher = nullptr;
+	/// Which blocks can be in the database at all, if enabled
+	BlockExistenceIndex *index = nullptr;
+
+	/// Load a block, taking dbase_ro and save_thread into account.
 	/// @note call locked
 	void loadBlock(v3s16 blockpos, std::string &ret);
+	/// Load several blocks like loadBlock(), in no particular order.
+	/// @note call locked
+	void loadBlocks(const std::vector<v3s16> &positions,
+		const MapDatabase::LoadBlockCallback &cb);
 };
 
 /*
@@ -61,10 +82,20 @@ class ServerMap : public Map
 		Blocks are generated by using these and makeBlock().
 	*/
 	bool blockpos_over_mapgen_limit(v3s16 p);
-	/// @brief copy data from map to prepare for mapgen
+	/// @brief claim a chunk for generation, does not need the env lock
+	/// Waits while the chunk or one next to it is being generated, so that
+	/// the areas of chunks in progress (with their borders) never overlap.
+	/// @param bpmin first block of the chunk
+	void reserveChunk(v3s16 bpmin);
+	/// @brief give up a chunk from reserveChunk() without generating it
+	void releaseChunk(v3s16 bpmin);
+	/// @brief copy data from map to prepare for mapgen, the chunk must be reserved
+	/// @param preloaded data of blocks that were read from the database
+	///                  beforehand, empty if they don't exist
 	/// @return true if mapgen should actually happen
-	bool initBlockMake(v3s16 blockpos, BlockMakeData *data);
-	/// @brief write data back to map after mapgen
+	bool initBlockMake(v3s16 blockpos, BlockMakeData *data,
+		const std::unordered_map<v3s16, std::string> &preloaded);
+	/// @brief write data back to map after mapgen, releases the chunk
 	/// @param now current game time
 	void finishBlockMake(BlockMakeData *data,
 		std::map<v3s16, MapBlock*> *changed_blocks, u32 now);
@@ -98,6 +129,8 @@ class ServerMap : public Map
 	void addNodeAndUpdate(v3s16 p, MapNode n,
 			std::map<v3s16, MapBlock*> &modified_blocks,
 			bool remove_metadata) override;
+	bool addNodesWithEvent(std::vector<v3s16> &positions, MapNode n,
+			bool remove_metadata = true) override;
 
 	/*
 		Database functions
@@ -112,10 +145,43 @@ class ServerMap : public Map
 	void listAllLoadableBlocks(std::vector<v3s16> &dst);
 	void listAllLoadedBlocks(std::vector<v3s16> &dst);
 
+	// Approximate memory used by the loaded blocks, in bytes
+	struct MemoryUsage {
+		u32 block_count = 0;
+		// the blocks themselves and their nodes
+		size_t blocks = 0;
+		size_t node_metadata = 0;
+		size_t static_objects = 0;
+	};
+	MemoryUsage getMemoryUsage() const;
+
+	// Lists the loadable blocks in chunks of roughly max_count,
+	// see MapDatabase::listLoadableBlocks(). Returns false once done.
+	struct LoadableBlocksCursor {
+		MapDatabase::ListCursor main, ro;
+	};
+	bool listLoadableBlocks(LoadableBlocksCursor &cursor, u32 max_count,
+		std::vector<v3s16> &dst);
+
+	// Saves the map and starts copying the database into dir in the
+	// background, see MapBackupThread. Throws BaseException if a backup is
+	// still running or the backend can't make one.
+	void startBackup(const std::string &dir);
+	bool isBackupRunning();
+
+	// Reads blocks from the database in the background, to be picked up
+	// by the emerge threads later. Does nothing unless enabled.
+	void prefetchBlocks(std::vector<v3s16> &&positions);
+
+	// Moves blocks that haven't been modified for a while to compact storage,
+	// if enabled. Call this periodically.
+	void compactIdleBlocks();
+
 	MapgenParams *getMapgenParams();
 
 	bool saveBlock(MapBlock *block) override;
-	static bool saveBlock(MapBlock *block, MapDatabase *db, int compression_level = -1);
+	static bool saveBlock(MapBlock *block, MapDatabase *db, int compression_level = -1,
+		const ZstdDictionary *dict = nullptr);
 
 	// Load block in a synchronous fashion
 	MapBlock *loadBlock(v3s16 p);
@@ -125,7 +191,13 @@ class ServerMap : public Map
 
 	// Helper for deserializing blocks from disk
 	// @throws SerializationError
-	static void deSerializeBlock(MapBlock *block, std::istream &is);
+	static void deSerializeBlock(MapBlock *block, std::istream &is,
+		const ZstdDictionary *dict = nullptr);
+
+	// Loads the compression dictionary of a world, nullptr if it has none
+	// @throws SerializationError
+	static std::unique_ptr<ZstdDictionary> loadDictionary(
+		const std::string &savedir, int compression_level);
 
 	// Blocks are removed from the map but not deleted from memory until
 	// deleteDetachedBlocks() is called, since pointers to them may still exist
@@ -155,8 +227,14 @@ class ServerMap : public Map
 	bool repairBlockLight(v3s16 blockpos,
 		std::map<v3s16, MapBlock *> *modified_blocks);
 
+	// Fixes the lighting at the borders of the blocks loaded since the last
+	// call, all at once. Called every step with the environment locked.
+	void updateBorderLighting();
+
+	// changed_nodes: optional output of the changed nodes, except for lighting
 	void transformLiquids(std::map<v3s16, MapBlock*> & modified_blocks,
-			ServerEnvironment *env);
+			ServerEnvironment *env,
+			std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes = nullptr);
 
 	void transforming_liquid_add(v3s16 p);
 
@@ -169,6 +247,9 @@ class ServerMap : public Map
 private:
 	friend class ModApiMapgen; // for m_transforming_liquid
 
+	// Queues the node and the liquids around it after it was changed
+	void queueLiquidNeighbors(v3s16 p);
+
 	// Emerge manager
 	EmergeManager *m_emerge;
 
@@ -176,15 +257,33 @@ class ServerMap : public Map
 	bool m_map_saving_enabled;
 
 	int m_map_compression_level;
+	bool m_compact_blocks;
 
+	// Collects samples of saved blocks and trains the dictionary from them
+	void addDictionarySample(MapBlock *block);
+	void trainDictionary();
+
+	// Dictionary for disk compression (see map_compression_dictionary)
+	std::unique_ptr<ZstdDictionary> m_zstd_dict;
+	bool m_use_zstd_dict = false;
+	std::vector<std::string> m_dict_samples;
+
+	// Chunks being generated, by their first block
+	std::mutex m_chunks_mutex;
+	std::condition_variable m_chunks_cv;
 	std::set<v3s16> m_chunks_in_progress;
 
 	// used by deleteBlock() and deleteDetachedBlocks()
 	std::vector<std::unique_ptr<MapBlock>> m_detached_blocks;
 
+	// Loaded blocks waiting for updateBorderLighting()
+	std::vector<v3s16> m_border_lighting_queue;
+
 	// Queued transforming water nodes
 	UniqueQueue<v3s16> m_transforming_liquid;
 	f32 m_transforming_liquid_loop_count_multiplier = 1.0f;
+	// Transforms liquids of separate blocks in parallel if liquid_threads > 0
+	std::unique_ptr<WorkerPool> m_liquid_pool;
 	u32 m_unprocessed_count = 0;
 	u64 m_inc_trending_up_start_time = 0; // milliseconds
 	bool m_queue_size_timer_started = false;
@@ -196,9 +295,19 @@ class ServerMap : public Map
 	bool m_map_metadata_changed = true;
 
 	MapDatabaseAccessor m_db;
+	// Writes blocks in the background if map_save_async is enabled
+	std::unique_ptr<MapSaveThread> m_save_thread;
+	// Reads blocks ahead of the emerge threads if block_prefetch_cache_size is set
+	std::unique_ptr<BlockPrefetcher> m_prefetcher;
+	// Spares database lookups for blocks that were never saved
+	std::unique_ptr<BlockExistenceIndex> m_existence_index;
+	// The last backup started, if any
+	std::unique_ptr<MapBackupThread> m_backup_thread;
 
 	// Map metrics
 	MetricGaugePtr m_loaded_blocks_gauge;
+	MetricGaugePtr m_compact_blocks_gauge;
+	MetricGaugePtr m_save_queue_gauge;
 	MetricCounterPtr m_save_time_counter;
 	MetricCounterPtr m_save_count_counter;
 };
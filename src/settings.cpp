@@ -1080,3 +1080,76 @@ void Settings::doCallbacks(const std::string &name) const
 			(it->first)(name, it->second);
 	}
 }
+
+/*
+ * CachedSetting
+ */
+
+static void read_cached_setting(const Settings *s, const std::string &name, bool &val)
+{
+	val = s->getBool(name);
+}
+
+static void read_cached_setting(const Settings *s, const std::string &name, u16 &val)
+{
+	val = s->getU16(name);
+}
+
+static void read_cached_setting(const Settings *s, const std::string &name, s16 &val)
+{
+	val = s->getS16(name);
+}
+
+static void read_cached_setting(const Settings *s, const std::string &name, u32 &val)
+{
+	val = s->getU32(name);
+}
+
+static void read_cached_setting(const Settings *s, const std::string &name, s32 &val)
+{
+	val = s->getS32(name);
+}
+
+static void read_cached_setting(const Settings *s, const std::string &name, float &val)
+{
+	val = s->getFloat(name);
+}
+
+template <typename T>
+CachedSetting<T>::CachedSetting(const std::string &name, Settings *settings) :
+	m_settings(settings), m_name(name)
+{
+	update();
+	m_settings->registerChangedCallback(m_name, &CachedSetting::changedCallback, this);
+}
+
+template <typename T>
+CachedSetting<T>::~CachedSetting()
+{
+	m_settings->deregisterAllChangedCallbacks(this);
+}
+
+template <typename T>
+void CachedSetting<T>::changedCallback(const std::string &name, void *data)
+{
+	static_cast<CachedSetting *>(data)->update();
+}
+
+template <typename T>
+void CachedSetting<T>::update()
+{
+	try {
+		T value;
+		read_cached_setting(m_settings, m_name, value);
+		m_value.store(value, std::memory_order_relaxed);
+	} catch (SettingNotFoundException &e) {
+		// keep the previous value
+	}
+}
+
+template class CachedSetting<bool>;
+template class CachedSetting<u16>;
+template class CachedSetting<s16>;
+template class CachedSetting<u32>;
+template class CachedSetting<s32>;
+template class CachedSetting<float>;
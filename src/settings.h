@@ -11,6 +11,7 @@
 #include <set>
 #include <map>
 #include <mutex>
+#include <atomic>
 
 class Settings;
 struct NoiseParams;
@@ -279,3 +280,30 @@ class Settings {
 
 	static std::unordered_map<std::string, const FlagDesc *> s_flags;
 };
+
+/*
+ * Typed handle for a setting that is read in hot paths.
+ * The parsed value is refreshed by a changed callback of `settings`, so get()
+ * neither takes a lock nor parses. Like any changed callback, it only sees
+ * changes made to that layer. Must not outlive the Settings object.
+ * Instantiated for bool, u16, s16, u32, s32 and float.
+ */
+template <typename T>
+class CachedSetting {
+public:
+	CachedSetting(const std::string &name, Settings *settings = g_settings);
+	~CachedSetting();
+
+	DISABLE_CLASS_COPY(CachedSetting)
+
+	T get() const { return m_value.load(std::memory_order_relaxed); }
+	operator T() const { return get(); }
+
+private:
+	static void changedCallback(const std::string &name, void *data);
+	void update();
+
+	Settings *m_settings;
+	const std::string m_name;
+	std::atomic<T> m_value{};
+};
@@ -165,6 +165,12 @@ fake_function() {
 	gettext("View distance in nodes.");
 	gettext("Undersampling");
 	gettext("Undersampling is similar to using a lower screen resolution, but it applies\nto the game world only, keeping the GUI intact.\nIt should give a significant performance boost at the cost of less detailed image.\nHigher values result in a less detailed image.\nNote: Undersampling is currently not supported if the \"3d_mode\" setting is set\nto a non-default value.");
+	gettext("Dynamic resolution");
+	gettext("Lowers the resolution of the game world while frames take too long, and\nraises it again when there is time left, keeping the GUI intact.\nFrame times are measured without the time spent waiting for the FPS limit.\nWorks best with VSync disabled.");
+	gettext("Dynamic resolution target FPS");
+	gettext("FPS that dynamic resolution tries to reach.");
+	gettext("Dynamic resolution minimum scale");
+	gettext("Lowest fraction of the screen resolution that dynamic resolution uses.");
 	gettext("3D");
 	gettext("3D mode");
 	gettext("3D support.\nCurrently supported:\n-    none: no 3d output.\n-    anaglyph: cyan/magenta color 3d.\n-    interlaced: odd/even line based polarization screen support.\n-    topbottom: split screen top/bottom.\n-    sidebyside: split screen side by side.\n-    crossview: Cross-eyed 3d");
@@ -898,7 +904,7 @@ fake_function() {
 	gettext("cURL interactive timeout");
 	gettext("Maximum time an interactive request (e.g. server list fetch) may take, stated in milliseconds.");
 	gettext("cURL parallel limit");
-	gettext("Limits number of parallel HTTP requests. Affects:\n-    Media fetch if server uses remote_media setting.\n-    Serverlist download and server announcement.\n-    Downloads performed by main menu (e.g. mod manager).\nOnly has an effect if compiled with cURL.");
+	gettext("Limits number of parallel HTTP requests. Affects:\n-    Media fetch if server uses remote_media setting.\n-    Serverlist download and server announcement.\n-    Downloads performed by main menu (e.g. mod manager).\nServers that support HTTP/2 get more requests multiplexed over\nthe same connections.\nOnly has an effect if compiled with cURL.");
 	gettext("cURL file download timeout");
 	gettext("Maximum time a file download (e.g. a mod download) may take, stated in milliseconds.");
 	gettext("Client Debugging");
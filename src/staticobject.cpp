@@ -3,7 +3,9 @@
 // Copyright (C) 2010-2013 celeron55, Perttu Ahola <celeron55@gmail.com>
 
 #include "staticobject.h"
+#include "exceptions.h"
 #include "util/serialize.h"
+#include "util/string.h"
 #include "server/serveractiveobject.h"
 
 StaticObject::StaticObject(const ServerActiveObject *s_obj, const v3f &pos_):
@@ -63,8 +65,11 @@ void StaticObjectList::serialize(std::ostream &os)
 	u8 version = 0;
 	writeU8(os, version);
 
+	if (m_stored_serialized_version != version)
+		deSerializeStored();
+
 	// count
-	size_t count = m_stored.size() + m_active.size();
+	size_t count = getStoredSize() + m_active.size();
 	// Make sure it fits into u16, else it would get truncated and cause e.g.
 	// issue #2610 (Invalid block data in database: unsupported NameIdMapping version).
 	if (count > U16_MAX) {
@@ -76,6 +81,12 @@ void StaticObjectList::serialize(std::ostream &os)
 	}
 	writeU16(os, count);
 
+	if (m_stored_serialized_count > 0) {
+		// Not accessed since deSerialize(), so m_stored is empty
+		assert(m_stored.empty());
+		os << m_stored_serialized;
+	}
+
 	for (StaticObject &s_obj : m_stored) {
 		s_obj.serialize(os);
 	}
@@ -95,17 +106,66 @@ void StaticObjectList::deSerialize(std::istream &is)
 			<< m_stored.size() << " stored objects _were_ cleared"
 			<< std::endl;
 	}
-	m_stored.clear();
+	clearStored();
 
 	// version
 	u8 version = readU8(is);
 	// count
 	u16 count = readU16(is);
-	for(u16 i = 0; i < count; i++) {
+
+	// Only find the end of the objects, they are parsed on first access
+	std::string &buf = m_stored_serialized;
+	for (u16 i = 0; i < count; i++) {
+		// type + pos
+		const size_t old_size = buf.size();
+		buf.resize(old_size + 1 + 3 * 4 + 2);
+		is.read(&buf[old_size], buf.size() - old_size);
+		if (is.gcount() != (std::streamsize)(buf.size() - old_size))
+			throw SerializationError("StaticObjectList: size not read");
+		// data
+		const u16 data_size = readU16((const u8 *)&buf[buf.size() - 2]);
+		buf.resize(buf.size() + data_size);
+		is.read(&buf[buf.size() - data_size], data_size);
+		if (is.gcount() != data_size)
+			throw SerializationError("StaticObjectList: size not read");
+	}
+	m_stored_serialized_count = count;
+	m_stored_serialized_version = version;
+}
+
+void StaticObjectList::deSerializeStored() const
+{
+	if (m_stored_serialized_count == 0)
+		return;
+
+	std::istringstream is(m_stored_serialized, std::ios::binary);
+	m_stored.reserve(m_stored.size() + m_stored_serialized_count);
+	for (u16 i = 0; i < m_stored_serialized_count; i++) {
 		StaticObject s_obj;
-		s_obj.deSerialize(is, version);
-		m_stored.push_back(s_obj);
+		s_obj.deSerialize(is, m_stored_serialized_version);
+		m_stored.push_back(std::move(s_obj));
+	}
+	clearStoredSerialized();
+}
+
+void StaticObjectList::clearStoredSerialized() const
+{
+	m_stored_serialized.clear();
+	m_stored_serialized.shrink_to_fit();
+	m_stored_serialized_count = 0;
+}
+
+size_t StaticObjectList::getMemoryUsage() const
+{
+	size_t bytes = m_stored.capacity() * sizeof(StaticObject) +
+		m_stored_serialized.capacity();
+	for (const StaticObject &obj : m_stored)
+		bytes += string_heap_usage(obj.data);
+	for (const auto &it : m_active) {
+		// a tree node holds the pair, three pointers and the color
+		bytes += sizeof(it) + 4 * sizeof(void *) + string_heap_usage(it.second.data);
 	}
+	return bytes;
 }
 
 bool StaticObjectList::storeActiveObject(u16 id)
@@ -114,7 +174,7 @@ bool StaticObjectList::storeActiveObject(u16 id)
 	if (i == m_active.end())
 		return false;
 
-	m_stored.push_back(i->second);
+	pushStored(i->second);
 	m_active.erase(id);
 	return true;
 }
@@ -36,7 +36,7 @@ class StaticObjectList
 	void insert(u16 id, const StaticObject &obj)
 	{
 		if (id == 0) {
-			m_stored.push_back(obj);
+			pushStored(obj);
 		} else {
 			if (m_active.find(id) != m_active.end()) {
 				dstream << "ERROR: StaticObjectList::insert(): "
@@ -62,33 +62,61 @@ class StaticObjectList
 	void deSerialize(std::istream &is);
 
 	// Never permit to modify outside of here. Only this object is responsible of m_stored and m_active modifications
-	const std::vector<StaticObject>& getAllStored() const { return m_stored; }
+	const std::vector<StaticObject>& getAllStored() const
+	{
+		deSerializeStored();
+		return m_stored;
+	}
 	const std::map<u16, StaticObject> &getAllActives() const { return m_active; }
 
 	inline void setActive(u16 id, const StaticObject &obj) { m_active[id] = obj; }
 	inline size_t getActiveSize() const { return m_active.size(); }
-	inline size_t getStoredSize() const { return m_stored.size(); }
-	inline void clearStored() { m_stored.clear(); }
-	void pushStored(const StaticObject &obj) { m_stored.push_back(obj); }
+	inline size_t getStoredSize() const
+	{
+		return m_stored.size() + m_stored_serialized_count;
+	}
+	inline void clearStored()
+	{
+		m_stored.clear();
+		clearStoredSerialized();
+	}
+	void pushStored(const StaticObject &obj)
+	{
+		deSerializeStored();
+		m_stored.push_back(obj);
+	}
 
 	bool storeActiveObject(u16 id);
 
 	inline void clear()
 	{
 		m_active.clear();
-		m_stored.clear();
+		clearStored();
 	}
 
 	inline size_t size()
 	{
-		return m_active.size() + m_stored.size();
+		return m_active.size() + getStoredSize();
 	}
 
+	// Approximate memory used by the objects
+	size_t getMemoryUsage() const;
+
 private:
+	void deSerializeStored() const;
+	void clearStoredSerialized() const;
+
 	/*
 		NOTE: When an object is transformed to active, it is removed
 		from m_stored and inserted to m_active.
 	*/
-	std::vector<StaticObject> m_stored;
+	// mutable: filled by deSerializeStored() from const getters
+	mutable std::vector<StaticObject> m_stored;
 	std::map<u16, StaticObject> m_active;
+
+	// Stored objects as read by deSerialize(), parsed into m_stored on
+	// first access. Until then serialize() writes them back verbatim.
+	mutable std::string m_stored_serialized;
+	mutable u16 m_stored_serialized_count = 0;
+	mutable u8 m_stored_serialized_version = 0;
 };
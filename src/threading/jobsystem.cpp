@@ -0,0 +1,130 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "jobsystem.h"
+#include <algorithm>
+#include "debug.h"
+#include "log.h"
+#include "settings.h"
+#include "threading/thread.h"
+
+class JobSystem::Worker : public Thread
+{
+public:
+	Worker(JobSystem *system, size_t index) :
+		Thread("Job"),
+		m_system(system),
+		m_index(index)
+	{}
+
+protected:
+	void *run() override
+	{
+		BEGIN_DEBUG_EXCEPTION_HANDLER
+		m_system->work(m_index);
+		END_DEBUG_EXCEPTION_HANDLER
+		return nullptr;
+	}
+
+private:
+	JobSystem *m_system;
+	const size_t m_index;
+};
+
+JobSystem::JobSystem(unsigned int num_threads)
+{
+	for (unsigned int i = 0; i < num_threads; i++)
+		m_queues.push_back(std::make_unique<Queue>());
+	for (unsigned int i = 0; i < num_threads; i++) {
+		m_workers.push_back(std::make_unique<Worker>(this, i));
+		m_workers.back()->start();
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_stop = true;
+	}
+	m_sleep_cv.notify_all();
+	for (auto &worker : m_workers)
+		worker->wait();
+}
+
+JobSystem &JobSystem::get()
+{
+	static JobSystem system([] {
+		unsigned int threads = g_settings->getU16("job_threads");
+		// leave a core to the main thread
+		if (threads == 0)
+			threads = std::max(Thread::getNumberOfProcessors(), 2U) - 1;
+		infostream << "JobSystem: starting " << threads << " threads" << std::endl;
+		return threads;
+	}());
+	return system;
+}
+
+void JobSystem::submit(Job job, JobPriority priority, int affinity)
+{
+	if (m_queues.empty()) {
+		job();
+		return;
+	}
+
+	const size_t index = affinity >= 0 ? (size_t)affinity % m_queues.size() :
+		m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+	{
+		Queue &queue = *m_queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs[priority].push_back(std::move(job));
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_pending++;
+	}
+	m_sleep_cv.notify_one();
+}
+
+bool JobSystem::take(size_t index, Job &job)
+{
+	const size_t count = m_queues.size();
+	for (u8 priority = 0; priority < JOB_PRIORITY_COUNT; priority++) {
+		for (size_t i = 0; i < count; i++) {
+			Queue &queue = *m_queues[(index + i) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			auto &jobs = queue.jobs[priority];
+			if (jobs.empty())
+				continue;
+			if (i == 0) {
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			} else {
+				// steal the job that was queued last
+				job = std::move(jobs.back());
+				jobs.pop_back();
+			}
+			m_pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::work(size_t index)
+{
+	Job job;
+	while (true) {
+		if (take(index, job)) {
+			job();
+			job = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		m_sleep_cv.wait(lock, [this] { return m_pending > 0 || m_stop; });
+		if (m_pending == 0 && m_stop)
+			break;
+	}
+}
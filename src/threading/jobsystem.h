@@ -0,0 +1,83 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "irrlichttypes.h"
+#include "util/basic_macros.h"
+
+enum JobPriority : u8
+{
+	// somebody waits for it, e.g. WorkerPool::run()
+	JOB_PRIORITY_HIGH,
+	JOB_PRIORITY_NORMAL,
+	// background work that may take long, e.g. async pathfinding
+	JOB_PRIORITY_LOW,
+	JOB_PRIORITY_COUNT
+};
+
+/*
+	Threads shared by the whole engine for running jobs, so that the
+	subsystems don't each start their own threads and oversubscribe the CPU.
+
+	Every worker has a queue per priority. A worker takes jobs from the front
+	of its own queues and steals from the back of the others, higher
+	priorities first. The affinity hint picks the queue a job goes into, so
+	related jobs tend to run on the same thread.
+
+	Jobs must not wait for other jobs, as there may be no thread left to
+	run them.
+*/
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	// With 0 threads, jobs are run by submit() itself
+	JobSystem(unsigned int num_threads);
+	// Runs the jobs that are still queued first
+	~JobSystem();
+
+	DISABLE_CLASS_COPY(JobSystem)
+
+	// Instance of the engine, started on first use with job_threads threads
+	static JobSystem &get();
+
+	// affinity: preferred worker, taken modulo the number of threads,
+	// or -1 for any
+	void submit(Job job, JobPriority priority = JOB_PRIORITY_NORMAL,
+			int affinity = -1);
+
+	size_t getThreadCount() const { return m_workers.size(); }
+
+private:
+	class Worker;
+
+	struct Queue {
+		std::mutex mutex;
+		std::array<std::deque<Job>, JOB_PRIORITY_COUNT> jobs;
+	};
+
+	bool take(size_t index, Job &job);
+	void work(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	// for jobs without affinity
+	std::atomic<size_t> m_next_queue{0};
+
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_sleep_cv;
+	// jobs in the queues, only increased with m_sleep_mutex
+	std::atomic<size_t> m_pending{0};
+	bool m_stop = false;
+};
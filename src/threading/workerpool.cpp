@@ -0,0 +1,92 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "workerpool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "threading/jobsystem.h"
+#include "util/tracy_wrapper.h"
+
+namespace {
+
+// Kept alive by the helper jobs, which may start after run() returned
+struct RunState {
+	const std::function<void(size_t)> *func;
+	size_t count;
+	std::atomic<size_t> next{0};
+	// helpers that may still call func
+	std::atomic<size_t> active{0};
+	std::mutex mutex;
+	std::condition_variable cv;
+#if BUILD_WITH_TRACY
+	// the pool may be gone when a helper starts
+	std::string name;
+#endif
+
+	void work()
+	{
+		size_t i;
+		while ((i = next++) < count)
+			(*func)(i);
+	}
+};
+
+}
+
+WorkerPool::WorkerPool(const std::string &name, unsigned int num_threads) :
+	WorkerPool(name, num_threads, num_threads > 0 ? &JobSystem::get() : nullptr)
+{
+}
+
+WorkerPool::WorkerPool(const std::string &name, unsigned int num_threads,
+		JobSystem *jobs) :
+	m_name(name),
+	m_jobs(jobs),
+	m_num_threads(jobs ? std::min<size_t>(num_threads, jobs->getThreadCount()) : 0)
+{
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)> &func)
+{
+	if (count == 0)
+		return;
+
+	// Don't submit more helpers than there is work for
+	// (the calling thread takes a share too)
+	const size_t num_helpers = std::min(m_num_threads, count - 1);
+	if (num_helpers == 0) {
+		for (size_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	auto state = std::make_shared<RunState>();
+	state->func = &func;
+	state->count = count;
+#if BUILD_WITH_TRACY
+	state->name = m_name;
+#endif
+	for (size_t h = 0; h < num_helpers; h++) {
+		m_jobs->submit([state] {
+			ZoneScoped;
+			ZoneText(state->name.c_str(), state->name.size());
+			// Announced before taking any item, so that run() can't miss it
+			state->active++;
+			state->work();
+			if (--state->active == 0) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->cv.notify_all();
+			}
+		}, JOB_PRIORITY_HIGH, (int)h);
+	}
+
+	state->work();
+
+	// Helpers that start from now on find no items left
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->cv.wait(lock, [&] { return state->active == 0; });
+}
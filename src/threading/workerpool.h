@@ -0,0 +1,40 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include "util/basic_macros.h"
+
+class JobSystem;
+
+/*
+	Splits a loop over independent items between the calling thread and
+	the threads of the JobSystem.
+	Only one thread may call run() at a time.
+*/
+class WorkerPool
+{
+public:
+	// name: shown in Tracy,
+	// num_threads: maximum number of threads in addition to the caller
+	WorkerPool(const std::string &name, unsigned int num_threads);
+	WorkerPool(const std::string &name, unsigned int num_threads,
+			JobSystem *jobs);
+	DISABLE_CLASS_COPY(WorkerPool)
+
+	// Calls func(i) for every i in [0, count), distributed over the job
+	// threads and the calling thread. Returns once all calls have finished.
+	// Doesn't wait for job threads that are busy with other work, so it may
+	// also be called by jobs.
+	void run(size_t count, const std::function<void(size_t)> &func);
+
+	size_t getThreadCount() const { return m_num_threads; }
+
+private:
+	const std::string m_name;
+	JobSystem *m_jobs;
+	size_t m_num_threads;
+};
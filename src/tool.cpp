@@ -491,8 +491,8 @@ PunchDamageResult getPunchDamage(
 f32 getToolRange(const ItemStack &wielded_item, const ItemStack &hand_item,
 		const IItemDefManager *itemdef_manager)
 {
-	const std::string &wielded_meta_range = wielded_item.metadata.getString("range");
-	const std::string &hand_meta_range = hand_item.metadata.getString("range");
+	const std::string &wielded_meta_range = wielded_item.getMetadata().getString("range");
+	const std::string &hand_meta_range = hand_item.getMetadata().getString("range");
 
 	f32 max_d = wielded_meta_range.empty() ? wielded_item.getDefinition(itemdef_manager).range :
 			stof(wielded_meta_range);
@@ -30,10 +30,28 @@ const std::string_view Translations::getFileLanguage(const std::string &filename
 	return basename.substr(pos+1);
 }
 
+// Entries of the cache of translated strings
+static constexpr size_t MAX_TRANSLATED_STRINGS = 4096;
+
 void Translations::clear()
 {
 	m_translations.clear();
 	m_plural_translations.clear();
+	m_translated_strings.clear();
+}
+
+const std::wstring *Translations::getTranslatedString(const std::wstring &s) const
+{
+	auto it = m_translated_strings.find(s);
+	return it != m_translated_strings.end() ? &it->second : nullptr;
+}
+
+void Translations::cacheTranslatedString(const std::wstring &s,
+		const std::wstring &translated)
+{
+	if (m_translated_strings.size() >= MAX_TRANSLATED_STRINGS)
+		m_translated_strings.clear();
+	m_translated_strings.emplace(s, translated);
 }
 
 const std::wstring &Translations::getTranslation(
@@ -628,6 +646,8 @@ void Translations::loadMoTranslation(const std::string &basefilename, const std:
 
 void Translations::loadTranslation(const std::string &filename, const std::string &data)
 {
+	// The new translations can change the result
+	m_translated_strings.clear();
 	const char *trExtension[] = { ".tr", NULL };
 	const char *poExtension[] = { ".po", NULL };
 	const char *moExtension[] = { ".mo", NULL };
@@ -29,6 +29,11 @@ class Translations
 	{
 		return getFileLanguage(filename) != "";
 	}
+
+	// Results of translate_string(), by the string with escape sequences
+	const std::wstring *getTranslatedString(const std::wstring &s) const;
+	void cacheTranslatedString(const std::wstring &s, const std::wstring &translated);
+
 	// for testing
 	inline size_t size()
 	{
@@ -38,6 +43,8 @@ class Translations
 private:
 	std::unordered_map<std::wstring, std::wstring> m_translations;
 	std::unordered_map<std::wstring, std::pair<GettextPluralForm::Ptr, std::vector<std::wstring>>> m_plural_translations;
+	// Cleared when translations are added, or when it gets too large
+	std::unordered_map<std::wstring, std::wstring> m_translated_strings;
 
 	void addTranslation(const std::wstring &textdomain, const std::wstring &original,
 			const std::wstring &translated);
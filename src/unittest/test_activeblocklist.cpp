@@ -0,0 +1,115 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include <random>
+#include "serverenvironment.h"
+
+namespace {
+
+// How the list used to be built: from scratch on every update
+std::set<v3s16> expected_range(const std::vector<ActiveBlockList::PlayerRange> &players,
+	s16 r, const std::set<v3s16> &forceloaded)
+{
+	std::set<v3s16> list = forceloaded;
+	for (auto &player : players) {
+		v3s16 p0 = player.blockpos, p;
+		for (p.X = p0.X - r; p.X <= p0.X + r; p.X++)
+		for (p.Y = p0.Y - r; p.Y <= p0.Y + r; p.Y++)
+		for (p.Z = p0.Z - r; p.Z <= p0.Z + r; p.Z++) {
+			if (p.getDistanceFrom(p0) <= r)
+				list.insert(p);
+		}
+	}
+	return list;
+}
+
+}
+
+TEST_CASE("ActiveBlockList") {
+
+SECTION("single player") {
+	ActiveBlockList abl;
+	std::set<v3s16> removed, added, extra_added, extralist;
+	abl.updateRanges({{1, {0, 0, 0}}}, 2, extralist, removed, added, extra_added);
+	CHECK(abl.m_list == expected_range({{1, {0, 0, 0}}}, 2, {}));
+	CHECK(added == abl.m_list);
+	CHECK(removed.empty());
+
+	// moving by one block only changes the shell
+	added.clear();
+	abl.updateRanges({{1, {1, 0, 0}}}, 2, extralist, removed, added, extra_added);
+	CHECK(abl.contains({3, 0, 0}));
+	CHECK(!abl.contains({-2, 0, 0}));
+	CHECK(added.count({3, 0, 0}) == 1);
+	CHECK(added.count({1, 0, 0}) == 0);
+	CHECK(removed.count({-2, 0, 0}) == 1);
+
+	// player leaves, only the view cone block stays
+	removed.clear();
+	extralist = {{10, 0, 0}};
+	abl.updateRanges({}, 2, extralist, removed, added, extra_added);
+	CHECK(abl.size() == 1);
+	CHECK(abl.m_abm_list.empty());
+	CHECK(extra_added.count({10, 0, 0}) == 1);
+	CHECK(removed.count({1, 0, 0}) == 1);
+}
+
+SECTION("random movement") {
+	ActiveBlockList abl;
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> step(-1, 1), jump(-20, 20), pick(0, 9);
+	std::vector<ActiveBlockList::PlayerRange> players;
+	for (u16 id = 1; id <= 6; id++)
+		players.push_back({id, v3s16(id * 3, 0, 0)});
+
+	for (int i = 0; i < 200; i++) {
+		for (auto &player : players) {
+			if (pick(rng) == 0)
+				player.blockpos = v3s16(jump(rng), jump(rng), jump(rng));
+			else
+				player.blockpos += v3s16(step(rng), step(rng), step(rng));
+		}
+		// players joining and leaving
+		if (pick(rng) == 0 && players.size() > 1)
+			players.erase(players.begin());
+		if (pick(rng) == 0)
+			players.push_back({(u16)(100 + i), v3s16(jump(rng), 0, 0)});
+		if (pick(rng) == 0)
+			abl.m_forceloaded_list.insert(v3s16(jump(rng), jump(rng), jump(rng)));
+		if (pick(rng) == 0 && !abl.m_forceloaded_list.empty())
+			abl.m_forceloaded_list.erase(abl.m_forceloaded_list.begin());
+		// blocks added or removed by the environment
+		if (pick(rng) == 0)
+			abl.add(v3s16(50, 50, 50));
+		if (pick(rng) == 0 && abl.size() > 0)
+			abl.remove(*abl.m_list.begin());
+
+		std::set<v3s16> extralist;
+		if (pick(rng) < 3)
+			extralist.insert(v3s16(jump(rng), jump(rng), jump(rng)));
+
+		const std::set<v3s16> old_list = abl.m_list;
+		std::set<v3s16> removed, added, extra_added;
+		abl.updateRanges(players, 3, extralist, removed, added, extra_added);
+
+		const std::set<v3s16> range = expected_range(players, 3,
+			abl.m_forceloaded_list);
+		std::set<v3s16> list = range;
+		list.insert(extralist.begin(), extralist.end());
+		REQUIRE(abl.m_abm_list == range);
+		REQUIRE(abl.m_list == list);
+
+		for (v3s16 p : added)
+			CHECK((range.count(p) && !old_list.count(p)));
+		for (v3s16 p : extra_added)
+			CHECK((!range.count(p) && !old_list.count(p)));
+		for (v3s16 p : removed)
+			CHECK((!list.count(p) && old_list.count(p)));
+		CHECK(old_list.size() + added.size() + extra_added.size() - removed.size()
+			== list.size());
+	}
+}
+
+}
@@ -5,6 +5,8 @@
 #include "test.h"
 
 #include "util/areastore.h"
+#include "noise.h"
+#include <set>
 
 class TestAreaStore : public TestBase {
 public:
@@ -16,6 +18,7 @@ class TestAreaStore : public TestBase {
 	void genericStoreTest(AreaStore *store);
 	void testVectorStore();
 	void testSpatialStore();
+	void testTreeStore();
 	void testSerialization();
 };
 
@@ -27,6 +30,7 @@ void TestAreaStore::runTests(IGameDef *gamedef)
 #if USE_SPATIAL
 	TEST(testSpatialStore);
 #endif
+	TEST(testTreeStore);
 	TEST(testSerialization);
 }
 
@@ -46,6 +50,50 @@ void TestAreaStore::testSpatialStore()
 #endif
 }
 
+void TestAreaStore::testTreeStore()
+{
+	TreeAreaStore store;
+	genericStoreTest(&store);
+
+	// Enough areas to build the index, compared against a linear search
+	TreeAreaStore tree;
+	VectorAreaStore ref;
+	PcgRandom pr(42);
+	for (int i = 0; i < 200; i++) {
+		v3s16 minedge(pr.range(-100, 100), pr.range(-20, 20), pr.range(-100, 100));
+		v3s16 extent(pr.range(0, 30), pr.range(0, 10), pr.range(0, 30));
+		Area area(minedge, minedge + extent);
+		tree.insertArea(&area);
+		ref.insertArea(&area);
+	}
+	for (u32 id = 0; id < 200; id += 7) {
+		tree.removeArea(id);
+		ref.removeArea(id);
+	}
+
+	std::vector<v3s16> positions;
+	for (int i = 0; i < 50; i++)
+		positions.emplace_back(pr.range(-110, 110), pr.range(-25, 25), pr.range(-110, 110));
+
+	std::vector<std::vector<Area *>> tree_res, ref_res;
+	tree.getAreasForPositions(&tree_res, positions);
+	ref.getAreasForPositions(&ref_res, positions);
+	UASSERTEQ(size_t, tree_res.size(), positions.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		std::set<u32> tree_ids, ref_ids;
+		for (Area *area : tree_res[i])
+			tree_ids.insert(area->id);
+		for (Area *area : ref_res[i])
+			ref_ids.insert(area->id);
+		UASSERT(tree_ids == ref_ids);
+	}
+
+	std::vector<Area *> tree_in, ref_in;
+	tree.getAreasInArea(&tree_in, v3s16(-30, -5, -30), v3s16(30, 5, 30), true);
+	ref.getAreasInArea(&ref_in, v3s16(-30, -5, -30), v3s16(30, 5, 30), true);
+	UASSERTEQ(size_t, tree_in.size(), ref_in.size());
+}
+
 void TestAreaStore::genericStoreTest(AreaStore *store)
 {
 	Area a(v3s16(-10, -3, 5), v3s16(0, 29, 7));
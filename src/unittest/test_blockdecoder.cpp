@@ -0,0 +1,128 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include <sstream>
+#include "client/blockdecoder.h"
+#include "gamedef.h"
+#include "mapblock.h"
+#include "nodemetadata.h"
+#include "serialization.h"
+#include "threading/jobsystem.h"
+
+class TestBlockDecoder : public TestBase
+{
+public:
+	TestBlockDecoder() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestBlockDecoder"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testDecode(IGameDef *gamedef);
+	void testNewest(IGameDef *gamedef);
+	void testBroken(IGameDef *gamedef);
+};
+
+static TestBlockDecoder g_test_instance;
+
+void TestBlockDecoder::runTests(IGameDef *gamedef)
+{
+	TEST(testDecode, gamedef);
+	TEST(testNewest, gamedef);
+	TEST(testBroken, gamedef);
+}
+
+// The block like the server sends it, with one stone node at p
+static std::string make_block_data(IGameDef *gamedef, v3s16 p, const char *infotext)
+{
+	MapBlock block({}, gamedef);
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+		block.setNodeNoCheck(x, y, z, MapNode(CONTENT_AIR));
+	block.setNodeNoCheck(p, MapNode(t_CONTENT_STONE));
+	auto *meta = new NodeMetadata(gamedef->idef());
+	meta->setString("infotext", infotext);
+	block.m_node_metadata.set(p, meta);
+
+	std::ostringstream os(std::ios::binary);
+	block.serialize(os, SER_FMT_VER_HIGHEST_WRITE, false, -1);
+	block.serializeNetworkSpecific(os);
+	return os.str();
+}
+
+void TestBlockDecoder::testDecode(IGameDef *gamedef)
+{
+	JobSystem jobs(2);
+	BlockDecoder decoder(gamedef, &jobs);
+
+	const v3s16 pos(1, -2, 3);
+	decoder.enqueue(pos, make_block_data(gamedef, {4, 5, 6}, "chest"),
+		SER_FMT_VER_HIGHEST_WRITE);
+	UASSERT(decoder.isPending(pos));
+	UASSERT(!decoder.isPending(v3s16(0, 0, 0)));
+
+	std::vector<BlockDecoder::Result> results;
+	decoder.take(results, true);
+	UASSERT(!decoder.isPending());
+	UASSERTEQ(size_t, results.size(), 1);
+	UASSERT(results[0].pos == pos);
+	UASSERT(results[0].block);
+
+	// like the client moves it into its map
+	MapBlock block(pos, gamedef);
+	const u64 counter = block.getModificationCounter();
+	block.takeContentsFrom(*results[0].block);
+	UASSERT(block.getModificationCounter() != counter);
+	UASSERT(block.getNodeNoCheck(4, 5, 6).getContent() == t_CONTENT_STONE);
+	UASSERT(block.getNodeNoCheck(0, 0, 0).getContent() == CONTENT_AIR);
+	NodeMetadata *meta = block.m_node_metadata.get({4, 5, 6});
+	UASSERT(meta);
+	UASSERTEQ(std::string, meta->getString("infotext"), "chest");
+	UASSERTEQ(size_t, results[0].block->m_node_metadata.size(), 0);
+}
+
+void TestBlockDecoder::testNewest(IGameDef *gamedef)
+{
+	JobSystem jobs(2);
+	BlockDecoder decoder(gamedef, &jobs);
+
+	const v3s16 pos(0, 0, 0);
+	for (s16 i = 0; i < 10; i++) {
+		decoder.enqueue(pos, make_block_data(gamedef, {i, 0, 0}, "a"),
+			SER_FMT_VER_HIGHEST_WRITE);
+	}
+	decoder.enqueue(v3s16(0, 1, 0), make_block_data(gamedef, {0, 0, 0}, "b"),
+		SER_FMT_VER_HIGHEST_WRITE);
+
+	std::vector<BlockDecoder::Result> results;
+	decoder.take(results, true);
+	UASSERTEQ(size_t, results.size(), 2);
+	for (const auto &result : results) {
+		UASSERT(result.block);
+		if (result.pos == pos)
+			UASSERT(result.block->getNodeNoCheck(9, 0, 0).getContent() == t_CONTENT_STONE);
+	}
+
+	results.clear();
+	decoder.take(results);
+	UASSERT(results.empty());
+}
+
+void TestBlockDecoder::testBroken(IGameDef *gamedef)
+{
+	JobSystem jobs(0);
+	BlockDecoder decoder(gamedef, &jobs);
+
+	std::string data = make_block_data(gamedef, {0, 0, 0}, "a");
+	data.resize(data.size() / 2);
+	decoder.enqueue(v3s16(0, 0, 0), data, SER_FMT_VER_HIGHEST_WRITE);
+
+	std::vector<BlockDecoder::Result> results;
+	decoder.take(results);
+	UASSERTEQ(size_t, results.size(), 1);
+	UASSERT(!results[0].block);
+	UASSERT(!results[0].error.empty());
+}
@@ -0,0 +1,58 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "database/database-dummy.h"
+#include "porting.h"
+#include "servermap.h"
+#include "server/blockexistenceindex.h"
+
+TEST_CASE("BlockExistenceIndex") {
+
+SECTION("no false negatives") {
+	BlockExistenceIndex index(nullptr);
+	CHECK(index.mayExist({1, 2, 3}));
+
+	std::vector<v3s16> positions;
+	for (s16 i = -500; i < 500; i++)
+		positions.emplace_back(i, i / 3, -i);
+	// added before the filter exists
+	index.add({7, 7, 7});
+	index.build(positions);
+	REQUIRE(index.isReady());
+
+	for (v3s16 p : positions)
+		CHECK(index.mayExist(p));
+	CHECK(index.mayExist({7, 7, 7}));
+	index.add({100, 200, 300});
+	CHECK(index.mayExist({100, 200, 300}));
+
+	u32 false_positives = 0;
+	for (s16 i = 0; i < 1000; i++)
+		false_positives += index.mayExist({i, 1000, 0});
+	CHECK(false_positives < 10);
+}
+
+SECTION("built from the database") {
+	Database_Dummy db;
+	MapDatabaseAccessor acc;
+	acc.dbase = &db;
+	db.saveBlock({1, 2, 3}, "block data");
+
+	BlockExistenceIndex index(&acc);
+	for (int i = 0; i < 200 && !index.isReady(); i++)
+		sleep_ms(10);
+	REQUIRE(index.isReady());
+	acc.index = &index;
+
+	std::string data;
+	CHECK(index.mayExist({1, 2, 3}));
+	acc.loadBlock({1, 2, 3}, data);
+	CHECK(data == "block data");
+	CHECK(!index.mayExist({3, 2, 1}));
+	acc.loadBlock({3, 2, 1}, data);
+	CHECK(data.empty());
+}
+
+}
@@ -0,0 +1,68 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "database/database-dummy.h"
+#include "porting.h"
+#include "servermap.h"
+#include "server/blockprefetcher.h"
+
+// The prefetcher works in the background, wait for it to get to the block
+static bool waitFor(BlockPrefetcher &prefetcher, v3s16 pos, std::string &data)
+{
+	for (int i = 0; i < 200; i++) {
+		if (prefetcher.take(pos, data))
+			return true;
+		sleep_ms(10);
+	}
+	return false;
+}
+
+TEST_CASE("BlockPrefetcher") {
+
+	Database_Dummy db;
+	MapDatabaseAccessor acc;
+	acc.dbase = &db;
+	db.saveBlock({1, 2, 3}, "block data");
+
+SECTION("existing and missing blocks") {
+	BlockPrefetcher prefetcher(&acc, 1024 * 1024);
+	prefetcher.request({{1, 2, 3}, {4, 5, 6}});
+
+	std::string data;
+	REQUIRE(waitFor(prefetcher, {1, 2, 3}, data));
+	CHECK(data == "block data");
+	// known to be absent
+	data = "not empty";
+	REQUIRE(waitFor(prefetcher, {4, 5, 6}, data));
+	CHECK(data.empty());
+
+	// taking removes the entry
+	CHECK(!prefetcher.take({1, 2, 3}, data));
+	CHECK(prefetcher.getCachedBytes() == 0);
+}
+
+SECTION("invalidation") {
+	BlockPrefetcher prefetcher(&acc, 1024 * 1024);
+	prefetcher.request({{4, 5, 6}, {1, 2, 3}});
+
+	std::string data;
+	REQUIRE(waitFor(prefetcher, {4, 5, 6}, data));
+	// both come in the same batch
+	prefetcher.invalidate({1, 2, 3});
+	CHECK(!prefetcher.take({1, 2, 3}, data));
+}
+
+SECTION("size limit") {
+	BlockPrefetcher prefetcher(&acc, 4);
+	prefetcher.request({{1, 2, 3}});
+	for (int i = 0; i < 50; i++)
+		sleep_ms(10);
+	// too large to be kept at all
+	std::string data;
+	CHECK(!prefetcher.take({1, 2, 3}, data));
+	CHECK(prefetcher.getCachedBytes() == 0);
+}
+
+}
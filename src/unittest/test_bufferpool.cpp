@@ -0,0 +1,56 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "util/bufferpool.h"
+#include "util/pointer.h"
+#include <thread>
+#include <vector>
+
+TEST_CASE("bufferpool") {
+
+SECTION("blocks are recycled within a size class") {
+	void *a = bufferpool::allocate(100);
+	bufferpool::release(a, 100);
+	// 100 and 120 share the 128 byte class
+	void *b = bufferpool::allocate(120);
+	CHECK(b == a);
+	bufferpool::release(b, 120);
+
+	// different class
+	void *c = bufferpool::allocate(300);
+	CHECK(c != a);
+	bufferpool::release(c, 300);
+}
+
+SECTION("large blocks bypass the pool") {
+	const size_t size = bufferpool::MAX_POOLED_SIZE + 1;
+	const bufferpool::Stats before = bufferpool::getStats();
+	void *a = bufferpool::allocate(size);
+	const bufferpool::Stats during = bufferpool::getStats();
+	bufferpool::release(a, size);
+	const bufferpool::Stats after = bufferpool::getStats();
+	CHECK(after.heap_allocations == before.heap_allocations + 1);
+	CHECK(during.heap_bytes == before.heap_bytes + size);
+	CHECK(after.heap_bytes == before.heap_bytes);
+}
+
+SECTION("buffers freed by another thread") {
+	std::vector<Buffer<u8>> buffers;
+	for (int i = 0; i < 1000; i++)
+		buffers.emplace_back(512);
+	// freed by a thread that exits, so its cache goes to the shared pool
+	std::thread([&] { buffers.clear(); }).join();
+	// the refcount of SharedBuffer comes from a class that may still be empty
+	{ SharedBuffer<u8> warmup(500); }
+
+	const bufferpool::Stats before = bufferpool::getStats();
+	for (int i = 0; i < 100; i++)
+		SharedBuffer<u8> buf(500);
+	const bufferpool::Stats after = bufferpool::getStats();
+	CHECK(after.heap_allocations == before.heap_allocations);
+	CHECK(after.reused >= before.reused + 100);
+}
+
+}
@@ -144,8 +144,14 @@ void TestClientActiveObjectMgr::testGetActiveSelectableObjects()
 		UASSERTEQ(auto, actual.size(), 0u);
 	};
 
+	// Positions are looked at in step()
+	const auto step = [&] () {
+		caomgr.step(0, [] (ClientActiveObject *) {});
+	};
+
 	float x = 12, y = 3, z = 6;
 	obj->position = {x, y, z};
+	step();
 
 	assert_obj_selected({0, 0, 0}, {x-1, y-1, z-1});
 	assert_obj_selected({0, 0, 0}, {2*(x-1), 2*(y-1), 2*(z-1)});
@@ -169,5 +175,12 @@ void TestClientActiveObjectMgr::testGetActiveSelectableObjects()
 	assert_obj_selected({-21, 6, -13}, {x, y, z-1.4f});
 	assert_obj_missed({-21, 6, -13}, {x, y, z-3.f});
 
+	// Moved far away
+	obj->position = {x + 1000, y, z};
+	step();
+	assert_obj_missed({0, 0, 0}, {20, 5, 10});
+	assert_obj_selected({x + 990, y, z}, {x + 1010, y, z});
+
 	caomgr.clear();
+	assert_obj_missed({x + 990, y, z}, {x + 1010, y, z});
 }
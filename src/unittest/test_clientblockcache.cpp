@@ -0,0 +1,87 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "client/clientblockcache.h"
+#include "filesys.h"
+#include "util/hashing.h"
+
+class TestClientBlockCache : public TestBase
+{
+public:
+	TestClientBlockCache() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestClientBlockCache"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testStoreLoad();
+	void testMismatch();
+	void testReopen();
+
+private:
+	std::string m_dir;
+};
+
+static TestClientBlockCache g_test_instance;
+
+void TestClientBlockCache::runTests(IGameDef *gamedef)
+{
+	m_dir = getTestTempDirectory() + DIR_DELIM + "blocks";
+
+	TEST(testStoreLoad);
+	TEST(testMismatch);
+	TEST(testReopen);
+
+	fs::RecursiveDelete(m_dir);
+}
+
+void TestClientBlockCache::testStoreLoad()
+{
+	ClientBlockCache cache(m_dir);
+	const std::string data = "some block data";
+	const std::string sha1 = hashing::sha1(data);
+
+	std::string loaded;
+	UASSERT(!cache.load({1, 2, 3}, sha1, 29, loaded));
+	cache.store({1, 2, 3}, sha1, 29, data);
+	UASSERT(cache.load({1, 2, 3}, sha1, 29, loaded));
+	UASSERTEQ(std::string, loaded, data);
+
+	// replaced when stored again
+	const std::string data2 = "other block data";
+	cache.store({1, 2, 3}, hashing::sha1(data2), 29, data2);
+	UASSERT(!cache.load({1, 2, 3}, sha1, 29, loaded));
+	UASSERT(cache.load({1, 2, 3}, hashing::sha1(data2), 29, loaded));
+	UASSERTEQ(std::string, loaded, data2);
+}
+
+void TestClientBlockCache::testMismatch()
+{
+	ClientBlockCache cache(m_dir);
+	const std::string data = "mismatch";
+	const std::string sha1 = hashing::sha1(data);
+	cache.store({-4, 0, 7}, sha1, 29, data);
+
+	std::string loaded;
+	UASSERT(!cache.load({-4, 0, 7}, hashing::sha1("x"), 29, loaded));
+	UASSERT(!cache.load({-4, 0, 7}, sha1, 28, loaded));
+	UASSERT(!cache.load({-4, 0, 7}, "", 29, loaded));
+	UASSERT(!cache.load({-4, 1, 7}, sha1, 29, loaded));
+}
+
+void TestClientBlockCache::testReopen()
+{
+	const std::string data = "persistent";
+	const std::string sha1 = hashing::sha1(data);
+	{
+		ClientBlockCache cache(m_dir);
+		cache.store({0, -100, 0}, sha1, 29, data);
+	}
+
+	ClientBlockCache cache(m_dir);
+	std::string loaded;
+	UASSERT(cache.load({0, -100, 0}, sha1, 29, loaded));
+	UASSERTEQ(std::string, loaded, data);
+}
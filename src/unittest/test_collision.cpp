@@ -5,6 +5,7 @@
 #include "test.h"
 #include "dummymap.h"
 #include "environment.h"
+#include "gamedef.h"
 #include "irrlicht_changes/printing.h"
 
 #include "collision.h"
@@ -18,6 +19,7 @@ class TestCollision : public TestBase {
 
 	void testAxisAlignedCollision();
 	void testCollisionMoveSimple(IGameDef *gamedef);
+	void testPreparedNodeBoxes(IGameDef *gamedef);
 };
 
 static TestCollision g_test_instance;
@@ -26,6 +28,7 @@ void TestCollision::runTests(IGameDef *gamedef)
 {
 	TEST(testAxisAlignedCollision);
 	TEST(testCollisionMoveSimple, gamedef);
+	TEST(testPreparedNodeBoxes, gamedef);
 }
 
 namespace {
@@ -377,3 +380,57 @@ void TestCollision::testCollisionMoveSimple(IGameDef *gamedef)
 	// No warnings should have been raised during our test.
 	UASSERT(!g_collision_problems_encountered);
 }
+
+void TestCollision::testPreparedNodeBoxes(IGameDef *gamedef)
+{
+	auto env = std::make_unique<TestEnvironment>(gamedef);
+	Map *map = &env->getMap();
+	g_collision_problems_encountered = false;
+
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		map->setNode({x, 0, z}, MapNode(t_CONTENT_STONE));
+
+	const aabb3f box(fpos(-0.1f, 0, -0.1f), fpos(0.1f, 1.4f, 0.1f));
+	const v3f start_pos = fpos(5.5f, 0.5f, 5.5f);
+	const v3f start_speed = fpos(-1.0f, 0.0f, -0.1f);
+	const v3f accel = fpos(0, -9.81f, 0);
+	CollisionNodeBoxes node_boxes;
+
+	/* not moving, nothing to prepare */
+	UASSERT(!collisionPrepareNodeBoxes(map, box, 1.0f,
+		start_pos, v3f(), v3f(), node_boxes));
+
+	/* same result as without preparing */
+	UASSERT(collisionPrepareNodeBoxes(map, box, 1.0f,
+		start_pos, start_speed, accel, node_boxes));
+	collisionGatherNodeBoxes(gamedef->ndef(), node_boxes);
+	UASSERT(node_boxes.ready && !node_boxes.cinfo.empty());
+
+	v3f pos = start_pos, speed = start_speed;
+	collisionMoveResult res = collisionMoveSimple(env.get(), gamedef, box,
+		0.0f, 1.0f, &pos, &speed, accel, nullptr, true, &node_boxes);
+	UASSERT(!node_boxes.ready);
+	UASSERT(res.touching_ground);
+	UASSERTEQ_V3F(pos, fpos(4.5f, 0.5f, 5.4f));
+	UASSERT(res.collisions.size() == 1);
+	UASSERTEQ(v3s16, res.collisions.front().node_p, v3s16(5, 0, 5));
+
+	/* the map changed after gathering */
+	UASSERT(collisionPrepareNodeBoxes(map, box, 1.0f,
+		start_pos, start_speed, accel, node_boxes));
+	collisionGatherNodeBoxes(gamedef->ndef(), node_boxes);
+	map->setNode({4, 1, 5}, MapNode(t_CONTENT_STONE));
+
+	pos = start_pos, speed = start_speed;
+	res = collisionMoveSimple(env.get(), gamedef, box,
+		0.0f, 1.0f, &pos, &speed, accel, nullptr, true, &node_boxes);
+	// stopped by the new node
+	UASSERT(pos.X > fpos(4.5f, 0, 0).X);
+	bool hit_wall = false;
+	for (auto &ci : res.collisions)
+		hit_wall |= ci.axis == COLLISION_AXIS_X && ci.node_p == v3s16(4, 1, 5);
+	UASSERT(hit_wall);
+
+	UASSERT(!g_collision_problems_encountered);
+}
@@ -22,6 +22,8 @@ class TestCompression : public TestBase {
 	void testZlibCompression();
 	void testZlibLargeData();
 	void testZstdLargeData();
+	void testZstdDictionary();
+	void testZstdStream();
 	void testZlibLimit();
 	void _testZlibLimit(u32 size, u32 limit);
 };
@@ -34,6 +36,8 @@ void TestCompression::runTests(IGameDef *gamedef)
 	TEST(testZlibCompression);
 	TEST(testZlibLargeData);
 	TEST(testZstdLargeData);
+	TEST(testZstdDictionary);
+	TEST(testZstdStream);
 	TEST(testZlibLimit);
 }
 
@@ -196,6 +200,90 @@ void TestCompression::testZstdLargeData()
 	}
 }
 
+void TestCompression::testZstdDictionary()
+{
+	// Samples that share a lot of content, like mapblocks do
+	PseudoRandom pseudorandom(1234);
+	std::vector<std::string> samples;
+	for (int i = 0; i < 300; i++) {
+		std::string s;
+		for (int j = 0; j < 50; j++) {
+			s.append(pseudorandom.range(0, 3) == 0 ? "default:stone" : "default:dirt_with_grass");
+			s.push_back((char)pseudorandom.range(0, 255));
+		}
+		samples.push_back(s);
+	}
+
+	std::string dict_data = ZstdDictionary::train(samples, 4096);
+	UASSERT(!dict_data.empty());
+	ZstdDictionary dict(dict_data);
+	UASSERT(dict.getId() != 0);
+
+	const std::string &data_in = samples[0];
+	std::ostringstream os_plain(std::ios::binary), os_dict(std::ios::binary);
+	compressZstd(data_in, os_plain, 0);
+	compressZstd(data_in, os_dict, 0, &dict);
+	UASSERT(os_dict.str().size() < os_plain.str().size());
+
+	{
+		std::istringstream is(os_dict.str(), std::ios::binary);
+		std::ostringstream os(std::ios::binary);
+		decompressZstd(is, os, &dict);
+		UASSERT(os.str() == data_in);
+	}
+	{
+		// data without dictionary is still readable
+		std::istringstream is(os_plain.str(), std::ios::binary);
+		std::ostringstream os(std::ios::binary);
+		decompressZstd(is, os, &dict);
+		UASSERT(os.str() == data_in);
+	}
+	{
+		std::istringstream is(os_dict.str(), std::ios::binary);
+		std::ostringstream os(std::ios::binary);
+		EXCEPTION_CHECK(SerializationError, decompressZstd(is, os));
+	}
+}
+
+void TestCompression::testZstdStream()
+{
+	ZstdStreamCompressor compressor(1, 16);
+	ZstdStreamDecompressor decompressor(16);
+
+	// Each message can be decompressed on its own, in order
+	size_t size_in = 0, size_compressed = 0;
+	for (int i = 0; i < 100; i++) {
+		const std::string data_in = "object " + std::to_string(i % 7) +
+			" set_properties textures=default_stone.png^[colorize:#ff0000";
+		std::string compressed, data_out;
+		compressor.compress(data_in, compressed);
+		decompressor.decompress(compressed, data_out);
+		UASSERT(data_out == data_in);
+		size_in += data_in.size();
+		size_compressed += compressed.size();
+	}
+	// Repeated messages refer to the earlier ones
+	UASSERT(size_compressed * 4 < size_in);
+
+	{
+		// larger than the buffers used internally
+		std::string data_in(100000, '\0');
+		PseudoRandom pseudorandom(1234);
+		for (char &c : data_in)
+			c = (char)pseudorandom.range(0, 255);
+		std::string compressed, data_out;
+		compressor.compress(data_in, compressed);
+		decompressor.decompress(compressed, data_out);
+		UASSERT(data_out == data_in);
+	}
+
+	{
+		std::string data_out;
+		ZstdStreamDecompressor other(16);
+		EXCEPTION_CHECK(SerializationError, other.decompress("not zstd", data_out));
+	}
+}
+
 void TestCompression::testZlibLimit()
 {
 	// edge cases
@@ -0,0 +1,85 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "network/mtp/congestion.h"
+#include <deque>
+#include <utility>
+
+using namespace con;
+
+namespace {
+
+// A link with a bottleneck of `bandwidth` bytes/s and a base round trip
+// time of `base_rtt`, the sender always has data to fill the window.
+void simulate(CongestionController &cc, float bandwidth, float base_rtt,
+	float duration)
+{
+	constexpr float dtime = 0.001f;
+	constexpr u32 packet_size = 512;
+	// (send time, ACK time) of each packet in flight
+	std::deque<std::pair<double, double>> in_flight;
+	double link_free = 0;
+	for (double t = 0; t < duration; t += dtime) {
+		while (in_flight.size() < cc.getWindowSize()) {
+			link_free = std::max(t, link_free) + packet_size / bandwidth;
+			in_flight.emplace_back(t, link_free + base_rtt);
+		}
+		while (!in_flight.empty() && in_flight.front().second <= t) {
+			cc.onAck(packet_size, t - in_flight.front().first);
+			in_flight.pop_front();
+		}
+		cc.step(dtime, in_flight.size());
+	}
+}
+
+}
+
+TEST_CASE("CongestionController") {
+
+SECTION("BBR estimates the link") {
+	BBRCongestionController cc;
+	const float bandwidth = 1024 * 1024;
+	const float base_rtt = 0.05f;
+	simulate(cc, bandwidth, base_rtt, 30);
+
+	CHECK(cc.getState() != BBRCongestionController::STARTUP);
+	CHECK(cc.getBandwidth() > bandwidth * 0.8f);
+	CHECK(cc.getBandwidth() < bandwidth * 1.2f);
+	CHECK(cc.getMinRTT() >= base_rtt);
+	CHECK(cc.getMinRTT() < base_rtt * 1.5f);
+	// the window stays around twice the bandwidth-delay product
+	const float bdp_packets = bandwidth * base_rtt / 512;
+	CHECK(cc.getWindowSize() >= bdp_packets);
+	CHECK(cc.getWindowSize() <= bdp_packets * 3);
+}
+
+SECTION("BBR doesn't grow an unused window") {
+	BBRCongestionController cc;
+	for (int i = 0; i < 1000; i++) {
+		cc.onAck(512, 0.05f);
+		cc.step(0.01f, 1);
+	}
+	CHECK(cc.getWindowSize() == START_RELIABLE_WINDOW_SIZE);
+}
+
+SECTION("loss based window") {
+	LossCongestionController cc;
+	CHECK(cc.getWindowSize() == START_RELIABLE_WINDOW_SIZE);
+
+	// a well used window without loss grows
+	for (int i = 0; i < 200; i++)
+		cc.onAck(512, 0.05f);
+	cc.step(1.1f, 64);
+	CHECK(cc.getWindowSize() == START_RELIABLE_WINDOW_SIZE + 100);
+
+	// heavy loss shrinks it
+	for (int i = 0; i < 10; i++)
+		cc.onAck(512, 0.05f);
+	cc.onLoss(50);
+	cc.step(1.0f, 64);
+	CHECK(cc.getWindowSize() == START_RELIABLE_WINDOW_SIZE);
+}
+
+}
@@ -349,6 +349,26 @@ void TestConnection::testConnectSendReceive()
 		UASSERT(peer_id == PEER_ID_SERVER);
 	}
 
+	/*
+		Send the same packet to several peers
+	*/
+	{
+		NetworkPacket pkt(0xdd, 3);
+		pkt << (u8) 'x' << (u8) 'y' << (u8) 'z';
+		// unknown peers are skipped
+		server.SendToMany({peer_id_client, 1234}, 0, &pkt, true);
+
+		bool received = false;
+		u64 timems0 = porting::getTimeMs();
+		NetworkPacket recvpacket;
+		while (!received && porting::getTimeMs() - timems0 < 5000)
+			received = client.ReceiveTimeoutMs(&recvpacket, timeout_ms);
+		UASSERT(received);
+		UASSERT(recvpacket.getCommand() == 0xdd);
+		UASSERT(recvpacket.getSize() == 3);
+		UASSERT(memcmp(recvpacket.getString(0), "xyz", 3) == 0);
+	}
+
 	// Check peer handlers
 	UASSERT(hand_client.count == 1);
 	UASSERT(hand_client.last_id == 1);
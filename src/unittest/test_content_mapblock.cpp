@@ -144,6 +144,8 @@ class TestMapblockMeshGenerator : public TestBase {
 	void testSurroundedNode();
 	void testInterliquidSame();
 	void testInterliquidDifferent();
+	void testMergedFaces();
+	void testLodMesh();
 };
 
 static TestMapblockMeshGenerator g_test_instance;
@@ -155,6 +157,8 @@ void TestMapblockMeshGenerator::runTests(IGameDef *gamedef)
 	TEST(testSurroundedNode);
 	TEST(testInterliquidSame);
 	TEST(testInterliquidDifferent);
+	TEST(testMergedFaces);
+	TEST(testLodMesh);
 }
 
 namespace quad {
@@ -252,4 +256,91 @@ void TestMapblockMeshGenerator::testInterliquidDifferent()
 	UASSERT(checkMeshEqual(buf.vertices, buf.indices, {quad::xn, quad::xp, quad::yn, quad::yp, quad::zn, quad::zp}));
 }
 
+void TestMapblockMeshGenerator::testMergedFaces()
+{
+	MockGameDef gamedef;
+	content_t stone = gamedef.addSimpleNode("stone", 42);
+	content_t wood = gamedef.addSimpleNode("wood", 13);
+	gamedef.finalize();
+
+	for (bool smooth_lighting : {false, true}) {
+		// a flat 2x2 layer of nodes, the same or not
+		for (bool same : {true, false}) {
+			MeshMakeData data{gamedef.ndef(), 2, MeshGrid{1}};
+			data.m_smooth_lighting = smooth_lighting;
+			data.m_merge_solid_faces = true;
+			data.m_blockpos = {0, 0, 0};
+			for (s16 x = -1; x <= 2; x++)
+			for (s16 y = -1; y <= 2; y++)
+			for (s16 z = -1; z <= 2; z++)
+				data.m_vmanip.setNode({x, y, z}, {CONTENT_AIR, 0, 0});
+			data.m_vmanip.setNode({0, 0, 0}, {stone, 0, 0});
+			data.m_vmanip.setNode({1, 0, 0}, {stone, 0, 0});
+			data.m_vmanip.setNode({0, 0, 1}, {stone, 0, 0});
+			data.m_vmanip.setNode({1, 0, 1}, {same ? stone : wood, 0, 0});
+
+			MeshCollector col{{}};
+			MapblockMeshGenerator mg{&data, &col};
+			mg.generate();
+			UASSERTEQ(std::size_t, col.prebuffers[1].size(), 0);
+
+			std::size_t vertex_count = 0;
+			f32 max_u = 0.0f;
+			for (auto &&buf : col.prebuffers[0]) {
+				vertex_count += buf.vertices.size();
+				UASSERTEQ(std::size_t, buf.indices.size(), buf.vertices.size() / 4 * 6);
+				for (auto &&vertex : buf.vertices)
+					max_u = std::max(max_u, vertex.TCoords.X);
+			}
+			if (same) {
+				// one quad on each side, with the texture repeated
+				UASSERTEQ(std::size_t, col.prebuffers[0].size(), 1);
+				UASSERTEQ(std::size_t, vertex_count, 6 * 4);
+				UASSERTEQ(f32, max_u, 2.0f);
+			} else {
+				// the wood node on its own, the stone nodes in two quads
+				// on the top and the bottom and in one on each side
+				UASSERTEQ(std::size_t, col.prebuffers[0].size(), 2);
+				UASSERTEQ(std::size_t, vertex_count, (4 + 2 * 2 + 2 + 2) * 4);
+			}
+		}
+	}
+}
+
+void TestMapblockMeshGenerator::testLodMesh()
+{
+	MockGameDef gamedef;
+	content_t stone = gamedef.addSimpleNode("stone", 42);
+	gamedef.finalize();
+
+	// a layer of 4x4 nodes, 1 or 2 nodes thick, drawn as cells of 2 nodes
+	for (s16 thickness : {1, 2}) {
+		MeshMakeData data{gamedef.ndef(), 4, MeshGrid{1}};
+		data.m_lod = 2;
+		data.m_blockpos = {0, 0, 0};
+		for (s16 x = -2; x <= 5; x++)
+		for (s16 y = -2; y <= 5; y++)
+		for (s16 z = -2; z <= 5; z++)
+			data.m_vmanip.setNode({x, y, z}, {CONTENT_AIR, 0, 0});
+		for (s16 x = 0; x < 4; x++)
+		for (s16 y = 0; y < thickness; y++)
+		for (s16 z = 0; z < 4; z++)
+			data.m_vmanip.setNode({x, y, z}, {stone, 0, 0});
+
+		MeshCollector col{{}};
+		MapblockMeshGenerator mg{&data, &col};
+		mg.generate();
+		UASSERTEQ(std::size_t, col.prebuffers[0].size(), 1);
+		UASSERTEQ(std::size_t, col.prebuffers[1].size(), 0);
+
+		// a cuboid of one row of cells, with one quad on each side
+		auto &&buf = col.prebuffers[0][0];
+		UASSERTEQ(std::size_t, buf.vertices.size(), 6 * 4);
+		f32 max_y = -BS;
+		for (auto &&vertex : buf.vertices)
+			max_y = std::max(max_y, vertex.Pos.Y);
+		UASSERTEQ(f32, max_y, 1.5f * BS);
+	}
+}
+
 }
@@ -19,6 +19,7 @@ class TestCraft : public TestBase
 			const std::vector<std::string> &groups, IGameDef *gamedef);
 
 	void testShapeless(IGameDef *gamedef);
+	void testResultCache(IGameDef *gamedef);
 };
 
 static TestCraft g_test_instance;
@@ -26,6 +27,7 @@ static TestCraft g_test_instance;
 void TestCraft::runTests(IGameDef *gamedef)
 {
 	TEST(testShapeless, gamedef);
+	TEST(testResultCache, gamedef);
 }
 
 std::string TestCraft::getDumpedCraftResult(CraftInput input, IGameDef *gamedef)
@@ -258,3 +260,56 @@ void TestCraft::testShapeless(IGameDef *gamedef)
 			}), gamedef),
 			"(item=\"crafttest:i4\", time=0)");
 }
+
+void TestCraft::testResultCache(IGameDef *gamedef)
+{
+	IWritableItemDefManager *idef = (IWritableItemDefManager *)gamedef->getItemDefManager();
+	IWritableCraftDefManager *cdef = (IWritableCraftDefManager *)gamedef->getCraftDefManager();
+
+	cdef->clear();
+
+	registerItemWithGroups("crafttest:i1", {}, gamedef);
+	registerItemWithGroups("crafttest:i2", {}, gamedef);
+	registerItemWithGroups("crafttest:i3", {}, gamedef);
+
+	cdef->registerCraft(new CraftDefinitionShapeless(
+				"crafttest:i3",
+				{"crafttest:i1", "crafttest:i2"},
+				CraftReplacements{}
+			), gamedef);
+	cdef->initHashes(gamedef);
+
+	const CraftInput grid(CRAFT_METHOD_NORMAL, 2, {
+		ItemStack("crafttest:i1", 5, 0, idef),
+		ItemStack("crafttest:i2", 1, 0, idef),
+	});
+	UASSERTEQ(std::string, getDumpedCraftResult(grid, gamedef),
+			"(item=\"crafttest:i3\", time=0)");
+
+	// Cached results still decrement the given input
+	for (u16 count = 5; count > 3; count--) {
+		CraftInput input = grid;
+		input.items[0].count = count;
+		CraftOutput output;
+		std::vector<ItemStack> replacements;
+		UASSERT(cdef->getCraftResult(input, output, replacements, true, gamedef));
+		UASSERTEQ(u16, input.items[0].count, count - 1);
+		UASSERT(input.items[1].empty());
+	}
+
+	const CraftInput other_grid(CRAFT_METHOD_NORMAL, 2, {
+		ItemStack("crafttest:i3", 1, 0, idef),
+		ItemStack("crafttest:i3", 1, 0, idef),
+	});
+	UASSERTEQ(std::string, getDumpedCraftResult(other_grid, gamedef),
+			"(item=\"\", time=0)");
+
+	// Registering a recipe drops the cached result
+	cdef->registerCraft(new CraftDefinitionShapeless(
+				"crafttest:i1",
+				{"crafttest:i3", "crafttest:i3"},
+				CraftReplacements{}
+			), gamedef);
+	UASSERTEQ(std::string, getDumpedCraftResult(other_grid, gamedef),
+			"(item=\"crafttest:i1\", time=0)");
+}
@@ -0,0 +1,36 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "noise.h"
+
+TEST_CASE("hashing")
+{
+	SECTION("sha1 of known inputs") {
+		CHECK(hex_encode(hashing::sha1("")) ==
+			"da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		CHECK(hex_encode(hashing::sha1("abc")) ==
+			"a9993e364706816aba3e25717850c26c9cd0d89d");
+		CHECK(hex_encode(hashing::sha1(std::string(1000000, 'a'))) ==
+			"34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+
+	SECTION("sha1 with and without CPU extensions") {
+		PcgRandom pr(42);
+		// around the block size and the padding boundary
+		for (size_t size : {0, 1, 55, 56, 63, 64, 65, 119, 128, 1000, 4099}) {
+			std::string data(size, '\0');
+			for (char &c : data)
+				c = pr.next();
+			CAPTURE(size);
+
+			hashing::sha1UseCPUExtensions(false);
+			const std::string expected = hashing::sha1(data);
+			hashing::sha1UseCPUExtensions(true);
+			CHECK(hashing::sha1(data) == expected);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch_amalgamated.hpp"
+#include "irrlichttypes.h"
+#include "irr_ptr.h"
+#include "client/imagefilters.h"
+#include "noise.h"
+
+#include "IImage.h"
+#include "IVideoDriver.h"
+#include "irrlicht.h"
+
+#include <cstring>
+
+namespace {
+
+irr_ptr<video::IImage> makeImage(video::IVideoDriver *driver, u32 w, u32 h)
+{
+	irr_ptr<video::IImage> img(driver->createImage(video::ECF_A8R8G8B8, {w, h}));
+	REQUIRE(img);
+	return img;
+}
+
+// Random colors, with runs of transparent pixels like in real textures
+irr_ptr<video::IImage> makeRandomImage(video::IVideoDriver *driver, u32 w, u32 h,
+		PcgRandom &pr)
+{
+	auto img = makeImage(driver, w, h);
+	u32 *data = reinterpret_cast<u32 *>(img->getData());
+	for (u32 i = 0; i < w * h; i++) {
+		data[i] = pr.next();
+		if (pr.range(0, 2) == 0)
+			data[i] &= 0x00ffffff;
+	}
+	return img;
+}
+
+irr_ptr<video::IImage> copyImage(video::IVideoDriver *driver, video::IImage *img)
+{
+	const auto dim = img->getDimension();
+	auto copy = makeImage(driver, dim.Width, dim.Height);
+	memcpy(copy->getData(), img->getData(), img->getImageDataSizeInBytes());
+	return copy;
+}
+
+bool sameImage(video::IImage *img1, video::IImage *img2)
+{
+	return img1->getDimension() == img2->getDimension() &&
+		memcmp(img1->getData(), img2->getData(), img1->getImageDataSizeInBytes()) == 0;
+}
+
+}
+
+TEST_CASE("imagefilters SIMD matches portable code")
+{
+	SIrrlichtCreationParameters p;
+	p.DriverType = video::EDT_NULL;
+	auto *device = createDeviceEx(p);
+	REQUIRE(device);
+	auto *driver = device->getVideoDriver();
+
+	PcgRandom pr(1234);
+	// odd sizes leave a remainder after the SIMD loops
+	const core::dimension2du sizes[] = {{16, 16}, {17, 5}, {1, 1}, {64, 31}};
+
+	SECTION("imageCleanTransparent") {
+		for (auto dim : sizes)
+		for (u32 threshold : {0U, 127U, 255U}) {
+			auto img = makeRandomImage(driver, dim.Width, dim.Height, pr);
+			auto expected = copyImage(driver, img.get());
+
+			imageFiltersUseSIMD(false);
+			imageCleanTransparent(expected.get(), threshold);
+			imageFiltersUseSIMD(true);
+			imageCleanTransparent(img.get(), threshold);
+
+			CHECK(sameImage(img.get(), expected.get()));
+		}
+	}
+
+	SECTION("imageScaleNNAA") {
+		const core::dimension2du targets[] = {{8, 8}, {32, 32}, {5, 7}, {48, 3}};
+		for (auto dim : sizes)
+		for (auto target : targets) {
+			auto src = makeRandomImage(driver, dim.Width, dim.Height, pr);
+			auto expected = makeImage(driver, target.Width, target.Height);
+			auto result = makeImage(driver, target.Width, target.Height);
+			const core::rect<s32> rect(0, 0, dim.Width, dim.Height);
+
+			imageFiltersUseSIMD(false);
+			imageScaleNNAA(src.get(), rect, expected.get());
+			imageFiltersUseSIMD(true);
+			imageScaleNNAA(src.get(), rect, result.get());
+
+			CHECK(sameImage(result.get(), expected.get()));
+		}
+	}
+
+	imageFiltersUseSIMD(true);
+	device->closeDevice();
+	device->drop();
+}
@@ -17,10 +17,13 @@ class TestInventory : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testSerializeDeserialize(IItemDefManager *idef);
+	void testSharedMetadata(IItemDefManager *idef);
+	void testSlotDelta(IItemDefManager *idef);
 
 	static const char *serialized_inventory_in;
 	static const char *serialized_inventory_out;
 	static const char *serialized_inventory_inc;
+	static const char *serialized_inventory_delta;
 };
 
 static TestInventory g_test_instance;
@@ -28,6 +31,8 @@ static TestInventory g_test_instance;
 void TestInventory::runTests(IGameDef *gamedef)
 {
 	TEST(testSerializeDeserialize, gamedef->getItemDefManager());
+	TEST(testSharedMetadata, gamedef->getItemDefManager());
+	TEST(testSlotDelta, gamedef->getItemDefManager());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -65,6 +70,67 @@ void TestInventory::testSerializeDeserialize(IItemDefManager *idef)
 	UASSERT(leftover == wanted);
 }
 
+void TestInventory::testSharedMetadata(IItemDefManager *idef)
+{
+	ItemStack stack1("default:dirt", 5, 0, idef);
+	UASSERT(stack1.getMetadata().empty());
+
+	stack1.getWritableMetadata().setString("color", "red");
+	ItemStack stack2 = stack1;
+	UASSERT(&stack2.getMetadata() == &stack1.getMetadata());
+	UASSERT(stack1 == stack2);
+
+	// changing the copy leaves the original alone
+	stack2.getWritableMetadata().setString("color", "blue");
+	UASSERT(&stack2.getMetadata() != &stack1.getMetadata());
+	UASSERTEQ(std::string, stack1.getMetadata().getString("color"), "red");
+	UASSERTEQ(std::string, stack2.getMetadata().getString("color"), "blue");
+	UASSERT(!stack1.stacksWith(stack2));
+
+	// same contents compare equal without being shared
+	stack2.getWritableMetadata().setString("color", "red");
+	UASSERT(stack1.stacksWith(stack2));
+
+	// round trip keeps the metadata, stacks without any share the empty one
+	ItemStack stack3;
+	stack3.deSerialize(stack1.getItemString());
+	UASSERT(stack3 == stack1);
+	stack3.deSerialize("default:dirt 5");
+	UASSERT(&stack3.getMetadata() == &ItemStack().getMetadata());
+	UASSERT(!(stack3 == stack1));
+}
+
+void TestInventory::testSlotDelta(IItemDefManager *idef)
+{
+	Inventory server_inv(idef);
+	std::istringstream is(serialized_inventory_in, std::ios::binary);
+	server_inv.deSerialize(is);
+	Inventory client_inv(server_inv);
+	server_inv.setModified(false);
+
+	InventoryList *list = server_inv.getList("0");
+	UASSERT(!list->checkSlotModified(7));
+	list->takeItem(7, 9);
+	list->changeItem(0, ItemStack("default:stick", 2, 0, idef));
+	UASSERT(list->checkModified());
+	UASSERT(list->checkSlotModified(0));
+	UASSERT(list->checkSlotModified(7));
+	UASSERT(!list->checkSlotModified(8));
+
+	std::ostringstream os(std::ios::binary);
+	server_inv.serialize(os, true);
+	UASSERTEQ(std::string, os.str(), serialized_inventory_delta);
+
+	std::istringstream delta_is(os.str(), std::ios::binary);
+	client_inv.deSerialize(delta_is);
+	UASSERT(client_inv == server_inv);
+
+	// Structural changes resend every slot
+	server_inv.setModified(false);
+	list->setWidth(4);
+	UASSERT(list->checkSlotModified(8));
+}
+
 const char *TestInventory::serialized_inventory_in =
 	"List 0 10\n"
 	"Width 3\n"
@@ -109,3 +175,20 @@ const char *TestInventory::serialized_inventory_inc =
 	"KeepList main\n"
 	"KeepList abc\n"
 	"EndInventory\n";
+
+const char *TestInventory::serialized_inventory_delta =
+	"List 0 10\n"
+	"Width 3\n"
+	"Item default:stick 2\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Item default:dirt 90\n"
+	"Keep\n"
+	"Keep\n"
+	"EndInventoryList\n"
+	"KeepList abc\n"
+	"EndInventory\n";
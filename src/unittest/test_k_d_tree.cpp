@@ -5,6 +5,7 @@
 #include "irrTypes.h"
 #include "noise.h"
 #include "util/k_d_tree.h"
+#include "util/spatial_grid.h"
 
 #include <algorithm>
 #include <unordered_set>
@@ -55,23 +56,13 @@ class ObjectVector
 	std::vector<Entry> entries;
 };
 
-TEST_CASE("k-d-tree") {
-
-SECTION("single update") {
-	k_d_tree::DynamicKdTrees<3, u16, u16> kds;
-	for (u16 i = 1; i <= 5; ++i)
-		kds.insert({i, i, i}, i);
-	for (u16 i = 1; i <= 5; ++i) {
-		u16 j = i - 1;
-		kds.update({j, j, j}, i);
-	}
-}
-
-SECTION("random operations") {
+// Compares the index kds to a list of the points
+template<typename Index>
+static void testRandomOperations(Index &kds)
+{
 	PseudoRandom pr(Catch::getSeed());
 
 	ObjectVector<3, f32, u16> objvec;
-	k_d_tree::DynamicKdTrees<3, f32, u16> kds;
 
 	const auto randPos = [&]() {
 		std::array<f32, 3> point;
@@ -135,4 +126,61 @@ SECTION("random operations") {
 	}
 }
 
+TEST_CASE("k-d-tree") {
+
+SECTION("single update") {
+	k_d_tree::DynamicKdTrees<3, u16, u16> kds;
+	for (u16 i = 1; i <= 5; ++i)
+		kds.insert({i, i, i}, i);
+	for (u16 i = 1; i <= 5; ++i) {
+		u16 j = i - 1;
+		kds.update({j, j, j}, i);
+	}
+}
+
+SECTION("random operations") {
+	k_d_tree::DynamicKdTrees<3, f32, u16> kds;
+	testRandomOperations(kds);
+}
+
+}
+
+TEST_CASE("spatial hash grid") {
+
+SECTION("update inside of a cell") {
+	SpatialHashGrid<3, f32, u16> grid(10);
+	grid.insert({1, 1, 1}, 1);
+	grid.insert({2, 2, 2}, 2);
+	grid.update({3, 3, 3}, 1);
+	CHECK(grid.cellCount() == 1);
+	grid.update({15, 3, 3}, 1);
+	CHECK(grid.cellCount() == 2);
+	grid.remove(2);
+	CHECK(grid.cellCount() == 1);
+	CHECK(grid.size() == 1);
+
+	std::vector<u16> found;
+	grid.rangeQuery({10, 0, 0}, {20, 5, 5}, [&](auto point, u16 id) {
+		CHECK(point[0] == 15);
+		found.push_back(id);
+	});
+	CHECK(found == std::vector<u16>{1});
+}
+
+SECTION("random operations") {
+	SpatialHashGrid<3, f32, u16> grid(100);
+	testRandomOperations(grid);
+	CHECK(grid.size() == 0);
+	CHECK(grid.cellCount() == 0);
+}
+
+SECTION("huge query") {
+	SpatialHashGrid<3, f32, u16> grid(1);
+	grid.insert({0, 0, 0}, 1);
+	size_t count = 0;
+	grid.rangeQuery({-1e30f, -1e30f, -1e30f}, {1e30f, 1e30f, 1e30f},
+			[&](auto, u16) { count++; });
+	CHECK(count == 1);
+}
+
 }
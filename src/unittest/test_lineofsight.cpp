@@ -0,0 +1,90 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "dummymap.h"
+#include "environment.h"
+#include "gamedef.h"
+#include "noise.h"
+#include "threading/workerpool.h"
+#include "irrlicht_changes/printing.h"
+
+class TestLineOfSight : public TestBase {
+public:
+	TestLineOfSight() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestLineOfSight"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testBatch(IGameDef *gamedef);
+};
+
+static TestLineOfSight g_test_instance;
+
+void TestLineOfSight::runTests(IGameDef *gamedef)
+{
+	TEST(testBatch, gamedef);
+}
+
+namespace {
+	class TestEnvironment : public Environment {
+		DummyMap map;
+	public:
+		TestEnvironment(IGameDef *gamedef)
+			: Environment(gamedef), map(gamedef, {-1, -1, -1}, {1, 1, 1})
+		{
+			map.fill({-1, -1, -1}, {1, 1, 1}, MapNode(CONTENT_AIR));
+		}
+
+		void step(f32 dtime) override {}
+
+		Map &getMap() override { return map; }
+
+		void getSelectedActiveObjects(const core::line3d<f32> &shootline_on_map,
+			std::vector<PointedThing> &objects,
+			const std::optional<Pointabilities> &pointabilities) override {}
+	};
+}
+
+void TestLineOfSight::testBatch(IGameDef *gamedef)
+{
+	TestEnvironment env(gamedef);
+	Map &map = env.getMap();
+	// some pillars, the lines also leave the loaded area
+	for (s16 x = -12; x <= 12; x += 6)
+	for (s16 z = -12; z <= 12; z += 6)
+	for (s16 y = -4; y <= 4; y++)
+		map.setNode(v3s16(x, y, z), MapNode(t_CONTENT_STONE));
+
+	PcgRandom pr(1234);
+	std::vector<core::line3d<f32>> lines;
+	for (int i = 0; i < 500; i++) {
+		v3f start(pr.range(-300, 300), pr.range(-60, 60), pr.range(-300, 300));
+		v3f end = start + v3f(pr.range(-400, 400), pr.range(-100, 100),
+			pr.range(-400, 400));
+		lines.emplace_back(start * (BS / 10), end * (BS / 10));
+	}
+	// along the block borders
+	lines.emplace_back(v3f(15.5f, 0, -20) * BS, v3f(15.5f, 0, 20) * BS);
+	lines.emplace_back(v3f(-0.5f, -0.5f, -20) * BS, v3f(-0.5f, -0.5f, 20) * BS);
+
+	WorkerPool pool("TestLineOfSight", 2);
+	for (WorkerPool *p : {(WorkerPool *)nullptr, &pool}) {
+		std::vector<std::optional<v3s16>> blocked;
+		env.line_of_sight_batch(lines, blocked, p);
+		UASSERTEQ(size_t, blocked.size(), lines.size());
+		size_t count = 0;
+		for (size_t i = 0; i < lines.size(); i++) {
+			v3s16 pos;
+			bool clear = env.line_of_sight(lines[i].start, lines[i].end, &pos);
+			UASSERTEQ(bool, !blocked[i], clear);
+			if (!clear)
+				UASSERTEQ(v3s16, *blocked[i], pos);
+			count += clear;
+		}
+		// both kinds are tested
+		UASSERT(count > 0 && count < lines.size());
+	}
+}
@@ -5,7 +5,9 @@
 
 #include "test.h"
 #include "config.h"
+#include "cpp_api/s_security.h"
 
+#include <fstream>
 #include <stdexcept>
 
 extern "C" {
@@ -35,6 +37,7 @@ class TestLua : public TestBase
 
 	void testLuaDestructors();
 	void testCxxExceptions();
+	void testSafeLoadFile();
 };
 
 static TestLua g_test_instance;
@@ -43,6 +46,7 @@ void TestLua::runTests(IGameDef *gamedef)
 {
 	TEST(testLuaDestructors);
 	TEST(testCxxExceptions);
+	TEST(testSafeLoadFile);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -138,3 +142,29 @@ void TestLua::testCxxExceptions()
 	UASSERTEQ(int, caught, 2);
 	UASSERT(errmsg.find("example") != std::string::npos);
 }
+
+/*
+	Check that files are compiled again when they change, even though the
+	bytecode is shared between Lua states.
+*/
+
+void TestLua::testSafeLoadFile()
+{
+	const std::string path = getTestTempFile();
+	const auto run_file = [&] (const char *code) -> int {
+		std::ofstream(path, std::ios::binary) << code;
+		lua_State *L = luaL_newstate();
+		int ret = -1;
+		if (ScriptApiSecurity::safeLoadFile(L, path.c_str()) &&
+				lua_pcall(L, 0, 1, 0) == 0)
+			ret = lua_tointeger(L, -1);
+		lua_close(L);
+		return ret;
+	};
+
+	UASSERTEQ(int, run_file("return 42"), 42);
+	UASSERTEQ(int, run_file("return 42"), 42);
+	UASSERTEQ(int, run_file("return 7"), 7);
+	UASSERTEQ(int, run_file("#!/bin/lua\nreturn 7"), 7);
+	UASSERTEQ(int, run_file(LUA_SIGNATURE "return 7"), -1);
+}
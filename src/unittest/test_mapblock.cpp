@@ -3,6 +3,7 @@
 
 #include "test.h"
 
+#include <algorithm>
 #include <sstream>
 #include "gamedef.h"
 #include "nodedef.h"
@@ -10,6 +11,9 @@
 #include "serialization.h"
 #include "noise.h"
 #include "inventory.h"
+#include "nodemetadata.h"
+#include "staticobject.h"
+#include "voxel.h"
 
 class TestMapBlock : public TestBase
 {
@@ -33,6 +37,20 @@ class TestMapBlock : public TestBase
 
 	// Tests loading a non-standard MapBlock
 	void testLoadNonStd(IGameDef *gamedef);
+
+	void testCompact(IGameDef *gamedef);
+
+	void testUniform(IGameDef *gamedef);
+
+	void testOpacity(IGameDef *gamedef);
+
+	void testWalkability(IGameDef *gamedef);
+
+	void testContentTypes(IGameDef *gamedef);
+
+	void testLazyMetadata(IGameDef *gamedef);
+
+	void testLazyStaticObjects();
 };
 
 static TestMapBlock g_test_instance;
@@ -45,6 +63,13 @@ void TestMapBlock::runTests(IGameDef *gamedef)
 	TEST(testLoad29, gamedef);
 	TEST(testLoad20, gamedef);
 	TEST(testLoadNonStd, gamedef);
+	TEST(testCompact, gamedef);
+	TEST(testUniform, gamedef);
+	TEST(testOpacity, gamedef);
+	TEST(testWalkability, gamedef);
+	TEST(testContentTypes, gamedef);
+	TEST(testLazyMetadata, gamedef);
+	TEST(testLazyStaticObjects);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -366,3 +391,282 @@ void TestMapBlock::testLoadNonStd(IGameDef *gamedef)
 	for (s16 i = 0; i < 16; i++)
 		UASSERTEQ(int, block.getNodeNoEx({i, 1, 0}).param2, data_lo[i]);
 }
+
+void TestMapBlock::testCompact(IGameDef *gamedef)
+{
+	MapBlock block({}, gamedef);
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(y < 8 ? t_CONTENT_STONE : CONTENT_AIR));
+	}
+
+	// must be idle for one call first
+	UASSERT(!block.compactIfIdle());
+	UASSERT(block.compactIfIdle());
+	UASSERT(block.isCompact());
+	UASSERT(block.getNodeDataMemoryUsage() < 1024);
+	UASSERT(block.isAir() == false);
+	UASSERT(block.getNodeNoCheck(3, 7, 3) == MapNode(t_CONTENT_STONE));
+	UASSERT(block.getNodeNoCheck(3, 8, 3) == MapNode(CONTENT_AIR));
+	{
+		std::vector<content_t> contents;
+		block.getContents(contents);
+		std::vector<content_t> expected = {CONTENT_AIR, t_CONTENT_STONE};
+		std::sort(expected.begin(), expected.end());
+		UASSERT(contents == expected);
+	}
+
+	// fits into the palette (1 bit per node)
+	block.setNodeNoCheck(1, 2, 3, MapNode(CONTENT_AIR));
+	UASSERT(block.isCompact());
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(CONTENT_AIR));
+	UASSERT(block.getNodeNoCheck(0, 2, 3) == MapNode(t_CONTENT_STONE));
+
+	// doesn't fit
+	block.setNodeNoCheck(4, 5, 6, MapNode(t_CONTENT_WATER));
+	UASSERT(!block.isCompact());
+	UASSERT(block.getNodeNoCheck(4, 5, 6) == MapNode(t_CONTENT_WATER));
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(CONTENT_AIR));
+	UASSERT(block.getNodeNoCheck(3, 7, 3) == MapNode(t_CONTENT_STONE));
+	{
+		std::vector<content_t> contents;
+		block.getContents(contents);
+		std::vector<content_t> expected = {CONTENT_AIR, t_CONTENT_STONE, t_CONTENT_WATER};
+		std::sort(expected.begin(), expected.end());
+		UASSERT(contents == expected);
+	}
+
+	// the serialized form must not depend on the storage
+	std::ostringstream flat_os(std::ios_base::binary);
+	block.serialize(flat_os, SER_FMT_VER_HIGHEST_WRITE, true, -1);
+	UASSERT(!block.compactIfIdle());
+	UASSERT(block.compactIfIdle());
+	std::ostringstream compact_os(std::ios_base::binary);
+	block.serialize(compact_os, SER_FMT_VER_HIGHEST_WRITE, true, -1);
+	UASSERT(flat_os.str() == compact_os.str());
+}
+
+void TestMapBlock::testUniform(IGameDef *gamedef)
+{
+	std::stringstream ss;
+	{
+		MapBlock block({}, gamedef);
+		for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x=0; x < MAP_BLOCKSIZE; x++)
+			block.setNodeNoCheck(x, y, z, MapNode(t_CONTENT_STONE, 0, 3));
+		UASSERT(!block.isUniform());
+		block.serialize(ss, SER_FMT_VER_HIGHEST_WRITE, true, -1);
+	}
+
+	MapBlock block({}, gamedef);
+	block.deSerialize(ss, SER_FMT_VER_HIGHEST_WRITE, true);
+	UASSERT(block.isUniform());
+	UASSERT(block.getNodeDataMemoryUsage() < 1024);
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(t_CONTENT_STONE, 0, 3));
+
+	// copies into a voxel manipulator like any other block
+	VoxelManipulator vm;
+	VoxelArea area({-1, -1, -1}, {MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE});
+	vm.addArea(area);
+	block.copyTo(vm, area);
+	UASSERT(vm.getNodeNoExNoEmerge({0, 0, 0}) == MapNode(t_CONTENT_STONE, 0, 3));
+	UASSERT(vm.getNodeNoExNoEmerge({-1, 0, 0}).getContent() == CONTENT_IGNORE);
+	UASSERT(vm.getNodeNoExNoEmerge({15, 15, 15}) == MapNode(t_CONTENT_STONE, 0, 3));
+
+	// the first different node makes the array
+	block.setNodeNoCheck(4, 5, 6, MapNode(CONTENT_AIR));
+	UASSERT(!block.isCompact());
+	UASSERT(block.getNodeNoCheck(4, 5, 6) == MapNode(CONTENT_AIR));
+	UASSERT(block.getNodeNoCheck(4, 5, 7) == MapNode(t_CONTENT_STONE, 0, 3));
+}
+
+void TestMapBlock::testOpacity(IGameDef *gamedef)
+{
+	auto *ndef = gamedef->getNodeDefManager();
+	MapBlock block({}, gamedef);
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(CONTENT_AIR));
+	}
+	UASSERT(block.getOpacity(ndef) == MapBlock::OPACITY_NONE);
+
+	block.setNodeNoCheck(1, 2, 3, MapNode(t_CONTENT_STONE));
+	UASSERT(block.getOpacity(ndef) == MapBlock::OPACITY_MIXED);
+
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(t_CONTENT_STONE));
+	}
+	UASSERT(block.getOpacity(ndef) == MapBlock::OPACITY_FULL);
+
+	// also after switching to compact storage
+	UASSERT(!block.compactIfIdle());
+	UASSERT(block.compactIfIdle());
+	block.setNodeNoCheck(4, 5, 6, MapNode(t_CONTENT_TORCH));
+	UASSERT(block.getOpacity(ndef) == MapBlock::OPACITY_MIXED);
+}
+
+void TestMapBlock::testWalkability(IGameDef *gamedef)
+{
+	auto *ndef = gamedef->getNodeDefManager();
+	MapBlock block({}, gamedef);
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(CONTENT_AIR));
+	}
+	UASSERT(block.getWalkability(ndef) == MapBlock::WALKABLE_NONE);
+
+	block.setNodeNoCheck(1, 2, 3, MapNode(t_CONTENT_STONE));
+	UASSERT(block.getWalkability(ndef) == MapBlock::WALKABLE_MIXED);
+
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(t_CONTENT_STONE));
+	}
+	UASSERT(block.getWalkability(ndef) == MapBlock::WALKABLE_FULL);
+
+	// unknown nodes collide, but not like a full node
+	block.setNodeNoCheck(4, 5, 6, MapNode(CONTENT_IGNORE));
+	UASSERT(block.getWalkability(ndef) == MapBlock::WALKABLE_MIXED);
+}
+
+void TestMapBlock::testContentTypes(IGameDef *gamedef)
+{
+	MapBlock block({}, gamedef);
+	for (s16 z=0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y=0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x=0; x < MAP_BLOCKSIZE; x++) {
+		block.setNodeNoCheck(x, y, z, MapNode(CONTENT_AIR));
+	}
+	const std::vector<content_t> stone{t_CONTENT_STONE};
+	const std::vector<content_t> torch_or_air{t_CONTENT_TORCH, CONTENT_AIR};
+	UASSERT(!block.containsAnyContent(stone));
+	UASSERT(block.containsAnyContent(torch_or_air));
+	UASSERT(!block.containsAnyContent({}));
+
+	block.setNodeNoCheck(1, 2, 3, MapNode(t_CONTENT_STONE));
+	UASSERT(block.containsAnyContent(stone));
+
+	block.setNodeNoCheck(1, 2, 3, MapNode(CONTENT_AIR));
+	UASSERT(!block.containsAnyContent(stone));
+
+	// also after switching to compact storage
+	UASSERT(!block.compactIfIdle());
+	UASSERT(block.compactIfIdle());
+	UASSERT(!block.containsAnyContent(stone));
+	block.setNodeNoCheck(4, 5, 6, MapNode(t_CONTENT_STONE));
+	UASSERT(block.containsAnyContent(stone));
+}
+
+void TestMapBlock::testLazyMetadata(IGameDef *gamedef)
+{
+	IItemDefManager *idef = gamedef->idef();
+	std::string disk_data, net_data;
+	{
+		NodeMetadataList list;
+		auto *meta = new NodeMetadata(idef);
+		meta->setString("infotext", "Chest");
+		meta->setString("owner", "singleplayer");
+		meta->markPrivate("owner", true);
+		meta->getInventory()->addList("main", 4)->changeItem(1,
+			ItemStack("default:stone", 5, 0, idef));
+		list.set({1, 2, 3}, meta);
+		list.set({4, 5, 6}, new NodeMetadata(idef)); // empty
+		auto *sign = new NodeMetadata(idef);
+		sign->setString("text", "hello");
+		list.set({0, 0, 1}, sign);
+
+		std::ostringstream os(std::ios::binary);
+		list.serialize(os, SER_FMT_VER_HIGHEST_WRITE, true, false, true);
+		disk_data = os.str();
+		os.str("");
+		list.serialize(os, SER_FMT_VER_HIGHEST_WRITE, false, false, true);
+		net_data = os.str();
+	}
+
+	NodeMetadataList list;
+	std::istringstream is(disk_data, std::ios::binary);
+	list.deSerialize(is, idef);
+	UASSERTEQ(size_t, list.size(), 3);
+	UASSERTEQ(size_t, list.getAllKeys().size(), 3);
+
+	// Untouched entries are written back as they were read
+	std::ostringstream os(std::ios::binary);
+	list.serialize(os, SER_FMT_VER_HIGHEST_WRITE, true, false, true);
+	UASSERT(os.str() == disk_data);
+	os.str("");
+	list.serialize(os, SER_FMT_VER_HIGHEST_WRITE, false, false, true);
+	UASSERT(os.str() == net_data);
+
+	// Access parses only the requested entry
+	NodeMetadata *meta = list.get({1, 2, 3});
+	UASSERT(meta);
+	UASSERTEQ(size_t, list.size(), 3);
+	UASSERT(meta->getString("infotext") == "Chest");
+	UASSERT(meta->isPrivate("owner"));
+	UASSERT(meta->getInventory()->getList("main")->getItem(1).name == "default:stone");
+	UASSERT(!list.get({2, 2, 2}));
+
+	// Empty entries are skipped without being parsed
+	os.str("");
+	list.serialize(os, SER_FMT_VER_HIGHEST_WRITE, true);
+	std::istringstream is2(os.str(), std::ios::binary);
+	NodeMetadataList list2;
+	list2.deSerialize(is2, idef);
+	UASSERTEQ(size_t, list2.size(), 2);
+
+	list.remove({0, 0, 1});
+	UASSERTEQ(size_t, list.size(), 2);
+	UASSERT(!list.get({0, 0, 1}));
+}
+
+void TestMapBlock::testLazyStaticObjects()
+{
+	std::string data;
+	{
+		StaticObjectList list;
+		StaticObject obj;
+		obj.type = 7;
+		obj.pos = v3f(1.5f, -2, 300);
+		obj.data = "first";
+		list.insert(0, obj);
+		obj.data = std::string(1000, 'x');
+		list.insert(0, obj);
+		std::ostringstream os(std::ios::binary);
+		list.serialize(os);
+		data = os.str();
+	}
+
+	StaticObjectList list;
+	std::istringstream is(data, std::ios::binary);
+	list.deSerialize(is);
+	UASSERTEQ(size_t, list.getStoredSize(), 2);
+	UASSERTEQ(size_t, list.size(), 2);
+
+	// Written back verbatim
+	std::ostringstream os(std::ios::binary);
+	list.serialize(os);
+	UASSERT(os.str() == data);
+
+	const auto &stored = list.getAllStored();
+	UASSERTEQ(size_t, stored.size(), 2);
+	UASSERTEQ(int, stored[0].type, 7);
+	UASSERT(stored[0].pos == v3f(1.5f, -2, 300));
+	UASSERT(stored[0].data == "first");
+	UASSERTEQ(size_t, stored[1].data.size(), 1000);
+
+	os.str("");
+	list.serialize(os);
+	UASSERT(os.str() == data);
+
+	// Truncated data is rejected when loading
+	std::istringstream is2(data.substr(0, data.size() - 10), std::ios::binary);
+	StaticObjectList list2;
+	EXCEPTION_CHECK(SerializationError, list2.deSerialize(is2));
+}
@@ -6,6 +6,7 @@
 
 #include "test.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -70,7 +71,11 @@ class TestMapDatabase : public TestBase
 
 	void testSave();
 	void testLoad();
+	void testLoadBatch();
+	void testLoadInSave();
 	void testList(int expect);
+	void testListChunked();
+	void testBackup();
 	void testRemove();
 	void testPositionEncoding();
 
@@ -111,6 +116,14 @@ void TestMapDatabase::runTests(IGameDef *gamedef)
 	runTestsForCurrentDB();
 	delete provider;
 
+	rawstream << "-------- SQLite3 sharded" << std::endl;
+
+	provider = new MapDatabaseProvider([&] () {
+		return new MapDatabaseSQLite3Sharded(test_dir, 4);
+	});
+	runTestsForCurrentDB();
+	delete provider;
+
 #if USE_LEVELDB
 	rawstream << "-------- LevelDB" << std::endl;
 
@@ -142,7 +155,11 @@ void TestMapDatabase::runTestsForCurrentDB()
 	// order-sensitive
 	TEST(testSave);
 	TEST(testLoad);
+	TEST(testLoadBatch);
+	TEST(testLoadInSave);
 	TEST(testList, 1);
+	TEST(testListChunked);
+	TEST(testBackup);
 	TEST(testRemove);
 	TEST(testList, 0);
 }
@@ -175,6 +192,45 @@ void TestMapDatabase::testLoad()
 	}
 }
 
+void TestMapDatabase::testLoadBatch()
+{
+	auto *db = provider->get();
+
+	const std::vector<v3s16> positions = {{0, 0, 0}, {1, 2, 3}, {-1, -2, -3}};
+	std::vector<v3s16> seen;
+	db->loadBlocks(positions, [&] (v3s16 pos, std::string &data) {
+		seen.push_back(pos);
+		if (pos == v3s16(1, 2, 3)) {
+			UASSERT(data == test_data);
+		} else {
+			UASSERT(data.empty());
+		}
+	});
+	UASSERT(seen == positions);
+
+	// nothing to do
+	db->loadBlocks({}, [] (v3s16, std::string &) {
+		UASSERT(false);
+	});
+}
+
+void TestMapDatabase::testLoadInSave()
+{
+	// blocks saved in the ongoing transaction must be visible
+	auto *db = provider->get();
+	std::string dest;
+
+	UASSERT(db->saveBlock({1, 2, 3}, "other"));
+	db->loadBlock({1, 2, 3}, &dest);
+	UASSERT(dest == "other");
+
+	UASSERT(db->saveBlock({1, 2, 3}, test_data));
+	db->loadBlocks({{1, 2, 3}}, [&] (v3s16, std::string &data) {
+		dest = data;
+	});
+	UASSERT(dest == test_data);
+}
+
 void TestMapDatabase::testList(int expect)
 {
 	auto *db = provider->get();
@@ -185,6 +241,65 @@ void TestMapDatabase::testList(int expect)
 		UASSERT(dest.front() == v3s16(1, 2, 3));
 }
 
+void TestMapDatabase::testListChunked()
+{
+	auto *db = provider->get();
+	const std::vector<v3s16> extra = {
+		{-2048, 5, 5}, {0, 0, 0}, {0, 0, -1}, {0, -1, 0}, {2047, 2047, 2047}
+	};
+	for (v3s16 pos : extra)
+		UASSERT(db->saveBlock(pos, test_data));
+
+	MapDatabase::ListCursor cursor;
+	std::vector<v3s16> dest;
+	for (int i = 0; i < 100 && !cursor.done; i++)
+		db->listLoadableBlocks(cursor, 2, dest);
+	UASSERT(cursor.done);
+
+	std::vector<v3s16> expect = extra;
+	expect.emplace_back(1, 2, 3);
+	auto less = [] (v3s16 a, v3s16 b) {
+		return MapDatabase::getBlockAsInteger(a) < MapDatabase::getBlockAsInteger(b);
+	};
+	std::sort(dest.begin(), dest.end(), less);
+	std::sort(expect.begin(), expect.end(), less);
+	UASSERT(dest == expect);
+
+	for (v3s16 pos : extra)
+		UASSERT(db->deleteBlock(pos));
+}
+
+void TestMapDatabase::testBackup()
+{
+	auto *db = provider->get();
+	const std::string dir = getTestTempFile();
+	auto backup = db->createBackup(dir);
+	if (!backup)
+		return; // not supported
+
+	// changes after the start may or may not be in it
+	UASSERT(db->saveBlock({1, 2, 4}, "later"));
+	int steps = 0;
+	while (!backup->step())
+		UASSERT(++steps < 1000);
+	const std::string backend = backup->getBackend();
+	backup.reset();
+
+	std::unique_ptr<MapDatabase> copy;
+	if (backend == "sqlite3")
+		copy = std::make_unique<MapDatabaseSQLite3>(dir);
+#if USE_LEVELDB
+	else
+		copy = std::make_unique<Database_LevelDB>(dir);
+#endif
+	UASSERT(copy);
+	std::string dest;
+	copy->loadBlock({1, 2, 3}, &dest);
+	UASSERT(dest == test_data);
+
+	UASSERT(db->deleteBlock({1, 2, 4}));
+}
+
 void TestMapDatabase::testRemove()
 {
 	auto *db = provider->get();
@@ -4,10 +4,14 @@
 
 #include "test.h"
 
+#include "dummymap.h"
 #include "emerge.h"
 #include "mapgen/mapgen.h"
 #include "mapgen/mg_biome.h"
+#include "mapgen/mg_columncache.h"
 #include "mock_server.h"
+#include "noise.h"
+#include "util/directiontables.h"
 
 class TestMapgen : public TestBase
 {
@@ -18,6 +22,9 @@ class TestMapgen : public TestBase
 	void runTests(IGameDef *gamedef);
 
 	void testBiomeGen(IGameDef *gamedef);
+	void testBiomeLookup(IGameDef *gamedef);
+	void testColumnCache();
+	void testCalcLighting(IGameDef *gamedef);
 };
 
 static TestMapgen g_test_instance;
@@ -37,6 +44,9 @@ namespace {
 void TestMapgen::runTests(IGameDef *gamedef)
 {
 	TEST(testBiomeGen, gamedef);
+	TEST(testBiomeLookup, gamedef);
+	TEST(testColumnCache);
+	TEST(testCalcLighting, gamedef);
 }
 
 void TestMapgen::testBiomeGen(IGameDef *gamedef)
@@ -123,3 +133,234 @@ void TestMapgen::testBiomeGen(IGameDef *gamedef)
 	}
 }
 
+// Searches all biomes, like BiomeGenOriginal::calcBiomeFromNoise() used to
+static Biome *find_biome_linear(const BiomeManager &bmgr,
+	float heat, float humidity, v3s16 pos)
+{
+	Biome *biome_closest = nullptr;
+	Biome *biome_closest_blend = nullptr;
+	float dist_min = FLT_MAX;
+	float dist_min_blend = FLT_MAX;
+
+	for (size_t i = 1; i < bmgr.getNumObjects(); i++) {
+		Biome *b = (Biome *)bmgr.getRaw(i);
+		if (!b ||
+				pos.Y < b->min_pos.Y || pos.Y > b->max_pos.Y + b->vertical_blend ||
+				pos.X < b->min_pos.X || pos.X > b->max_pos.X ||
+				pos.Z < b->min_pos.Z || pos.Z > b->max_pos.Z)
+			continue;
+
+		float d_heat = heat - b->heat_point;
+		float d_humidity = humidity - b->humidity_point;
+		float dist = ((d_heat * d_heat) + (d_humidity * d_humidity));
+		if (b->weight > 0.f)
+			dist /= b->weight;
+
+		if (pos.Y <= b->max_pos.Y) {
+			if (dist < dist_min) {
+				dist_min = dist;
+				biome_closest = b;
+			}
+		} else if (dist < dist_min_blend) {
+			dist_min_blend = dist;
+			biome_closest_blend = b;
+		}
+	}
+
+	const u64 seed = static_cast<s64>(pos.Y + (heat + humidity) * 0.9f);
+	PcgRandom rng(seed);
+
+	if (biome_closest_blend && dist_min_blend <= dist_min &&
+			rng.range(0, biome_closest_blend->vertical_blend) >=
+			pos.Y - biome_closest_blend->max_pos.Y)
+		return biome_closest_blend;
+
+	return biome_closest ? biome_closest : (Biome *)bmgr.getRaw(BIOME_NONE);
+}
+
+void TestMapgen::testBiomeLookup(IGameDef *gamedef)
+{
+	MockServer server(getTestTempDirectory());
+	MockBiomeManager bmgr(&server);
+	bmgr.setNodeDefManager(gamedef->getNodeDefManager());
+
+	// Biomes with coinciding points, weights, Y limits, blending and X/Z limits
+	PcgRandom pr(1234);
+	for (int i = 0; i < 60; i++) {
+		Biome *b = BiomeManager::create(BIOMETYPE_NORMAL);
+		b->name = "biome" + std::to_string(i);
+		b->heat_point = pr.range(0, 1) ? pr.range(0, 4) * 25 : pr.range(-100, 1100) / 10.0f;
+		b->humidity_point = pr.range(0, 1) ? pr.range(0, 4) * 25 : pr.range(-100, 1100) / 10.0f;
+		if (pr.range(0, 3) == 0)
+			b->weight = pr.range(0, 30) / 10.0f;
+		switch (pr.range(0, 3)) {
+		case 1:
+			b->min_pos.Y = pr.range(-100, 100);
+			break;
+		case 2:
+			b->max_pos.Y = pr.range(-100, 100);
+			break;
+		case 3:
+			b->min_pos.Y = pr.range(-300, -200);
+			b->max_pos.Y = pr.range(-20, 20);
+			break;
+		}
+		if (pr.range(0, 2) == 0)
+			b->vertical_blend = pr.range(1, 8);
+		if (pr.range(0, 5) == 0) {
+			b->min_pos.X = pr.range(-1000, 1000);
+			b->max_pos.Z = pr.range(-1000, 1000);
+		}
+		UASSERT(bmgr.add(b) != OBJDEF_INVALID_HANDLE);
+	}
+
+	std::unique_ptr<BiomeParams> params(BiomeManager::createBiomeParams(BIOMEGEN_ORIGINAL));
+	std::unique_ptr<BiomeGen> biomegen(
+		bmgr.createBiomeGen(BIOMEGEN_ORIGINAL, params.get(), v3s16(16, 16, 16))
+	);
+	auto *bgo = (BiomeGenOriginal *)biomegen.get();
+
+	for (int i = 0; i < 100000; i++) {
+		float heat = pr.range(0, 3) == 0 ? pr.range(0, 8) * 12.5f : pr.range(-800, 1800) / 10.0f;
+		float humidity = pr.range(0, 3) == 0 ? pr.range(0, 8) * 12.5f : pr.range(-800, 1800) / 10.0f;
+		v3s16 pos(pr.range(-2000, 2000), pr.range(-300, 300), pr.range(-2000, 2000));
+		if (i % 1000 == 0)
+			pos.X = MAX_MAP_GENERATION_LIMIT + 100;
+
+		UASSERT(bgo->calcBiomeFromNoise(heat, humidity, pos) ==
+			find_biome_linear(bmgr, heat, humidity, pos));
+	}
+}
+
+void TestMapgen::testColumnCache()
+{
+	constexpr u32 map_size = 16;
+	// room for three entries of two maps
+	MapgenColumnCache cache(3 * 2 * map_size * sizeof(float));
+
+	float map1[map_size], map2[map_size], out1[map_size], out2[map_size];
+	for (u32 i = 0; i < map_size; i++) {
+		map1[i] = i;
+		map2[i] = -(float)i;
+	}
+
+	UASSERT(!cache.get(COLUMN_TERRAIN, v2s16(0, 0), {out1, out2}, map_size));
+	cache.put(COLUMN_TERRAIN, v2s16(0, 0), {map1, map2}, map_size);
+	UASSERT(cache.get(COLUMN_TERRAIN, v2s16(0, 0), {out1, out2}, map_size));
+	for (u32 i = 0; i < map_size; i++) {
+		UASSERTEQ(float, out1[i], map1[i]);
+		UASSERTEQ(float, out2[i], map2[i]);
+	}
+
+	// other kinds, positions and layouts are separate
+	UASSERT(!cache.get(COLUMN_BIOME, v2s16(0, 0), {out1, out2}, map_size));
+	UASSERT(!cache.get(COLUMN_TERRAIN, v2s16(80, 0), {out1, out2}, map_size));
+	UASSERT(!cache.get(COLUMN_TERRAIN, v2s16(0, 0), {out1}, map_size));
+
+	// the least recently used column is dropped
+	cache.put(COLUMN_TERRAIN, v2s16(80, 0), {map1, map2}, map_size);
+	cache.put(COLUMN_TERRAIN, v2s16(160, 0), {map1, map2}, map_size);
+	UASSERT(cache.get(COLUMN_TERRAIN, v2s16(0, 0), {out1, out2}, map_size));
+	cache.put(COLUMN_TERRAIN, v2s16(240, 0), {map1, map2}, map_size);
+	UASSERTEQ(size_t, cache.getCachedBytes(), 3 * 2 * map_size * sizeof(float));
+	UASSERT(!cache.get(COLUMN_TERRAIN, v2s16(80, 0), {out1, out2}, map_size));
+	UASSERT(cache.get(COLUMN_TERRAIN, v2s16(0, 0), {out1, out2}, map_size));
+	UASSERT(cache.get(COLUMN_TERRAIN, v2s16(240, 0), {out1, out2}, map_size));
+}
+
+// Light sources, then spreads until nothing changes anymore
+static void spread_light_reference(MMVManip *vm, const NodeDefManager *ndef,
+	v3s16 nmin, v3s16 nmax)
+{
+	const VoxelArea a(nmin, nmax);
+	for (s16 z = nmin.Z; z <= nmax.Z; z++)
+	for (s16 y = nmin.Y; y <= nmax.Y; y++)
+	for (s16 x = nmin.X; x <= nmax.X; x++) {
+		MapNode &n = vm->m_data[vm->m_area.index(x, y, z)];
+		ContentLightingFlags cf = ndef->getLightingFlags(n);
+		if (cf.light_propagates && cf.light_source)
+			n.param1 = cf.light_source | (cf.light_source << 4);
+	}
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (s16 z = nmin.Z; z <= nmax.Z; z++)
+		for (s16 y = nmin.Y; y <= nmax.Y; y++)
+		for (s16 x = nmin.X; x <= nmax.X; x++) {
+			MapNode &n = vm->m_data[vm->m_area.index(x, y, z)];
+			if (!ndef->getLightingFlags(n).light_propagates)
+				continue;
+			for (const v3s16 &dir : g_6dirs) {
+				const v3s16 p = v3s16(x, y, z) + dir;
+				if (!a.contains(p))
+					continue;
+				const MapNode &n2 = vm->m_data[vm->m_area.index(p)];
+				if (!ndef->getLightingFlags(n2).light_propagates)
+					continue;
+				for (int shift = 0; shift <= 4; shift += 4) {
+					int light = ((n2.param1 >> shift) & 0x0F) - 1;
+					if (light > ((n.param1 >> shift) & 0x0F)) {
+						n.param1 = (n.param1 & ~(0x0F << shift)) | (light << shift);
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+void TestMapgen::testCalcLighting(IGameDef *gamedef)
+{
+	const NodeDefManager *ndef = gamedef->getNodeDefManager();
+	const content_t contents[] = {
+		CONTENT_AIR, CONTENT_AIR, CONTENT_AIR, t_CONTENT_STONE, t_CONTENT_STONE,
+		t_CONTENT_TORCH, t_CONTENT_WATER, t_CONTENT_LAVA,
+	};
+	const v3s16 bpmin(-1, -1, -1), bpmax(1, 1, 1);
+	// like a chunk of one block, with the block around it
+	const v3s16 nmin(0, -1, 0), nmax(MAP_BLOCKSIZE - 1, MAP_BLOCKSIZE, MAP_BLOCKSIZE - 1);
+	const v3s16 full_nmin = bpmin * MAP_BLOCKSIZE;
+	const v3s16 full_nmax = (bpmax + 1) * MAP_BLOCKSIZE - 1;
+
+	DummyMap map(gamedef, bpmin, bpmax);
+	MMVManip vm(&map);
+	vm.initialEmerge(bpmin, bpmax, false);
+	const u32 volume = vm.m_area.getVolume();
+
+	Mapgen mg;
+	mg.vm = &vm;
+	mg.ndef = ndef;
+	PcgRandom pr(42);
+	std::vector<MapNode> initial(volume);
+	for (int i = 0; i < 50; i++) {
+		// mostly stone below, mostly air above, or neither
+		for (s16 z = full_nmin.Z; z <= full_nmax.Z; z++)
+		for (s16 y = full_nmin.Y; y <= full_nmax.Y; y++)
+		for (s16 x = full_nmin.X; x <= full_nmax.X; x++) {
+			content_t c = contents[pr.range(0, ARRLEN(contents) - 1)];
+			if (i % 3 == 0 && y < 0 && pr.range(0, 3) > 0)
+				c = t_CONTENT_STONE;
+			else if (i % 3 == 1 && y >= 0 && pr.range(0, 3) > 0)
+				c = CONTENT_AIR;
+			MapNode &n = initial[vm.m_area.index(x, y, z)];
+			n = MapNode(c, pr.range(0, 4) == 0 ? pr.range(0, 255) : 0);
+			// the area above wasn't generated yet
+			if (i % 2 == 0 && y > nmax.Y)
+				n = MapNode(CONTENT_IGNORE);
+		}
+		mg.water_level = i % 4 == 0 ? 100 : 0;
+		const bool propagate_shadow = i % 5 != 0;
+
+		std::copy(initial.begin(), initial.end(), vm.m_data);
+		mg.calcLighting(nmin, nmax, full_nmin, full_nmax, propagate_shadow);
+		std::vector<MapNode> result(vm.m_data, vm.m_data + volume);
+
+		std::copy(initial.begin(), initial.end(), vm.m_data);
+		mg.propagateSunlight(nmin, nmax, propagate_shadow);
+		spread_light_reference(&vm, ndef, full_nmin, full_nmax);
+
+		for (u32 j = 0; j < volume; j++)
+			UASSERTEQ(int, result[j].param1, vm.m_data[j].param1);
+	}
+}
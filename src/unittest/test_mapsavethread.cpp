@@ -0,0 +1,90 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include <sstream>
+#include "database/database-dummy.h"
+#include "dummygamedef.h"
+#include "mapblock.h"
+#include "serialization.h"
+#include "servermap.h"
+#include "server/mapsavethread.h"
+
+static std::string serializeRaw(MapBlock &block)
+{
+	std::ostringstream os(std::ios_base::binary);
+	block.serialize(os, SER_FMT_VER_HIGHEST_WRITE, true, -1, false);
+	return os.str();
+}
+
+static std::string serializeFull(MapBlock &block)
+{
+	std::ostringstream os(std::ios_base::binary);
+	u8 version = SER_FMT_VER_HIGHEST_WRITE;
+	os.write((char*) &version, 1);
+	block.serialize(os, version, true, -1);
+	return os.str();
+}
+
+TEST_CASE("MapSaveThread") {
+
+	Database_Dummy db;
+	MapDatabaseAccessor acc;
+	acc.dbase = &db;
+
+	DummyGameDef gamedef;
+	MapBlock block({1, 2, 3}, &gamedef);
+	block.setNode({1, 1, 1}, MapNode(CONTENT_AIR));
+	const std::string expected = serializeFull(block);
+
+SECTION("write and read back") {
+	MapSaveThread thread(&acc, -1, 1024 * 1024);
+	acc.save_thread = &thread;
+
+	thread.enqueue(block.getPos(), SER_FMT_VER_HIGHEST_WRITE, serializeRaw(block));
+	{
+		// pending or already written, the result must be the same
+		std::string data;
+		MutexAutoLock dblock(acc.mutex);
+		acc.loadBlock(block.getPos(), data);
+		CHECK(data == expected);
+	}
+
+	thread.flush();
+	CHECK(thread.getPendingCount() == 0);
+	CHECK(thread.getPendingBytes() == 0);
+	std::string data;
+	db.loadBlock(block.getPos(), &data);
+	CHECK(data == expected);
+}
+
+SECTION("cancel") {
+	MapSaveThread thread(&acc, -1, 1024 * 1024);
+	{
+		// keep the thread from writing
+		MutexAutoLock dblock(acc.mutex);
+		thread.enqueue(block.getPos(), SER_FMT_VER_HIGHEST_WRITE, serializeRaw(block));
+		thread.cancel(block.getPos());
+		std::string data;
+		CHECK(!thread.getPending(block.getPos(), data));
+	}
+	thread.flush();
+	std::string data;
+	db.loadBlock(block.getPos(), &data);
+	CHECK(data.empty());
+}
+
+SECTION("flush on destruction") {
+	{
+		// tiny limit to exercise the backpressure
+		MapSaveThread thread(&acc, -1, 1);
+		for (s16 i = 0; i < 20; i++)
+			thread.enqueue({i, 0, 0}, SER_FMT_VER_HIGHEST_WRITE, serializeRaw(block));
+	}
+	std::vector<v3s16> blocks;
+	db.listAllLoadableBlocks(blocks);
+	CHECK(blocks.size() == 20);
+}
+
+}
@@ -0,0 +1,115 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "client/mediapack.h"
+#include "filesys.h"
+#include "util/hashing.h"
+#include <fstream>
+
+class TestMediaPack : public TestBase
+{
+public:
+	TestMediaPack() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestMediaPack"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testAddLoad();
+	void testReopen();
+	void testTruncated();
+};
+
+static TestMediaPack g_test_instance;
+
+void TestMediaPack::runTests(IGameDef *gamedef)
+{
+	TEST(testAddLoad);
+	TEST(testReopen);
+	TEST(testTruncated);
+}
+
+void TestMediaPack::testAddLoad()
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "add.pack";
+	MediaPack pack(path);
+	const std::string a = "first file", b(1000, 'x');
+
+	UASSERT(!pack.exists(hashing::sha1(a)));
+	UASSERT(pack.add(hashing::sha1(a), a));
+	UASSERT(!pack.add(hashing::sha1(a), a));
+	UASSERT(pack.add(hashing::sha1(b), b));
+	// not a hash
+	UASSERT(!pack.add("abc", a));
+
+	std::string data;
+	UASSERT(pack.load(hashing::sha1(a), data));
+	UASSERTEQ(std::string, data, a);
+	UASSERT(pack.load(hashing::sha1(b), data));
+	UASSERTEQ(std::string, data, b);
+	UASSERT(!pack.load(hashing::sha1("missing"), data));
+}
+
+void TestMediaPack::testReopen()
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "reopen.pack";
+	const std::string a = "first file", b = "second file", c = "";
+	{
+		MediaPack pack(path);
+		UASSERT(pack.add(hashing::sha1(a), a));
+		UASSERT(pack.add(hashing::sha1(b), b));
+		UASSERT(pack.add(hashing::sha1(c), c));
+	}
+
+	MediaPack pack(path);
+	std::string data;
+	UASSERT(pack.load(hashing::sha1(b), data));
+	UASSERTEQ(std::string, data, b);
+	UASSERT(pack.load(hashing::sha1(c), data));
+	UASSERT(data.empty());
+	// mapped and appended files side by side
+	const std::string d = "fourth file";
+	UASSERT(pack.add(hashing::sha1(d), d));
+	UASSERT(pack.load(hashing::sha1(d), data));
+	UASSERTEQ(std::string, data, d);
+	UASSERT(pack.load(hashing::sha1(a), data));
+	UASSERTEQ(std::string, data, a);
+}
+
+void TestMediaPack::testTruncated()
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "truncated.pack";
+	const std::string a = "first file", b = "second file";
+	{
+		MediaPack pack(path);
+		UASSERT(pack.add(hashing::sha1(a), a));
+		UASSERT(pack.add(hashing::sha1(b), b));
+	}
+	std::string contents;
+	UASSERT(fs::ReadFile(path, contents));
+	contents.pop_back();
+	UASSERT(fs::safeWriteToFile(path, contents));
+
+	std::string data;
+	{
+		MediaPack pack(path);
+		UASSERT(pack.load(hashing::sha1(a), data));
+		UASSERTEQ(std::string, data, a);
+		UASSERT(!pack.exists(hashing::sha1(b)));
+		// the broken file is overwritten
+		UASSERT(pack.add(hashing::sha1(b), b));
+	}
+	{
+		MediaPack pack(path);
+		UASSERT(pack.load(hashing::sha1(b), data));
+		UASSERTEQ(std::string, data, b);
+	}
+
+	// not a pack at all
+	UASSERT(fs::safeWriteToFile(path, "garbage"));
+	MediaPack pack(path);
+	UASSERT(!pack.exists(hashing::sha1(a)));
+	UASSERT(pack.add(hashing::sha1(a), a));
+}
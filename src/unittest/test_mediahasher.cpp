@@ -0,0 +1,128 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "filesys.h"
+#include "server/mediahasher.h"
+#include "threading/jobsystem.h"
+#include "util/hashing.h"
+
+class TestMediaHasher : public TestBase
+{
+public:
+	TestMediaHasher() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestMediaHasher"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testHash();
+	void testCache();
+};
+
+static TestMediaHasher g_test_instance;
+
+void TestMediaHasher::runTests(IGameDef *gamedef)
+{
+	TEST(testHash);
+	TEST(testCache);
+}
+
+static std::string make_media_dir(const std::string &base, const char *name)
+{
+	const std::string dir = base + DIR_DELIM + name;
+	fs::RecursiveDelete(dir);
+	fs::CreateAllDirs(dir);
+	return dir;
+}
+
+void TestMediaHasher::testHash()
+{
+	const std::string base = getTestTempDirectory();
+	const std::string high = make_media_dir(base, "media_high");
+	const std::string low = make_media_dir(base, "media_low");
+	UASSERT(fs::safeWriteToFile(high + DIR_DELIM "a.png", "high a"));
+	UASSERT(fs::safeWriteToFile(low + DIR_DELIM "a.png", "low a"));
+	UASSERT(fs::safeWriteToFile(low + DIR_DELIM "b.ogg", "low b"));
+	UASSERT(fs::safeWriteToFile(low + DIR_DELIM "empty.png", ""));
+	UASSERT(fs::safeWriteToFile(low + DIR_DELIM "readme.txt", "not media"));
+
+	JobSystem jobs(2);
+	MediaHasher hasher("", &jobs);
+	hasher.start({high, low});
+	std::vector<MediaHasher::File> files = hasher.wait();
+
+	// in the order of the paths, duplicates are left to the server
+	UASSERTEQ(size_t, files.size(), 4);
+	UASSERTEQ(std::string, files[0].name, "a.png");
+	UASSERTEQ(std::string, files[0].path, high + DIR_DELIM "a.png");
+	UASSERT(files[0].sha1_digest == hashing::sha1("high a"));
+	UASSERTEQ(u64, files[0].size, 6);
+	for (size_t i = 1; i < files.size(); i++) {
+		const MediaHasher::File &file = files[i];
+		if (file.name == "a.png") {
+			UASSERT(file.sha1_digest == hashing::sha1("low a"));
+		} else if (file.name == "b.ogg") {
+			UASSERT(file.sha1_digest == hashing::sha1("low b"));
+		} else {
+			UASSERTEQ(std::string, file.name, "empty.png");
+			UASSERT(file.sha1_digest.empty());
+		}
+	}
+	UASSERTEQ(u32, hasher.getHashedCount(), 3);
+	UASSERTEQ(u32, hasher.getCachedCount(), 0);
+}
+
+void TestMediaHasher::testCache()
+{
+	const std::string base = getTestTempDirectory();
+	const std::string dir = make_media_dir(base, "media_cached");
+	const std::string cache_path = base + DIR_DELIM "media_hashes.txt";
+	fs::DeleteSingleFileOrEmptyDirectory(cache_path);
+	UASSERT(fs::safeWriteToFile(dir + DIR_DELIM "a.png", "first"));
+	UASSERT(fs::safeWriteToFile(dir + DIR_DELIM "b.png", "second"));
+
+	JobSystem jobs(2);
+	{
+		MediaHasher hasher(cache_path, &jobs);
+		hasher.start({dir});
+		UASSERTEQ(size_t, hasher.wait().size(), 2);
+		UASSERTEQ(u32, hasher.getHashedCount(), 2);
+	}
+	UASSERT(fs::PathExists(cache_path));
+
+	{
+		MediaHasher hasher(cache_path, &jobs);
+		hasher.start({dir});
+		for (const MediaHasher::File &file : hasher.wait()) {
+			UASSERT(file.sha1_digest == hashing::sha1(
+				file.name == "a.png" ? "first" : "second"));
+		}
+		UASSERTEQ(u32, hasher.getHashedCount(), 0);
+		UASSERTEQ(u32, hasher.getCachedCount(), 2);
+	}
+
+	// a different size is always noticed
+	UASSERT(fs::safeWriteToFile(dir + DIR_DELIM "a.png", "changed"));
+	{
+		MediaHasher hasher(cache_path, &jobs);
+		hasher.start({dir});
+		for (const MediaHasher::File &file : hasher.wait()) {
+			if (file.name == "a.png") {
+				UASSERT(file.sha1_digest == hashing::sha1("changed"));
+			}
+		}
+		UASSERTEQ(u32, hasher.getHashedCount(), 1);
+		UASSERTEQ(u32, hasher.getCachedCount(), 1);
+	}
+
+	// a broken cache is ignored
+	UASSERT(fs::safeWriteToFile(cache_path, "garbage"));
+	{
+		MediaHasher hasher(cache_path, &jobs);
+		hasher.start({dir});
+		UASSERTEQ(size_t, hasher.wait().size(), 2);
+		UASSERTEQ(u32, hasher.getHashedCount(), 2);
+	}
+}
@@ -0,0 +1,176 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "client/modelcache.h"
+#include "content/subgames.h"
+#include "filesys.h"
+#include "irr_ptr.h"
+#include "util/hashing.h"
+
+#include "IFileSystem.h"
+#include "IMeshCache.h"
+#include "IReadFile.h"
+#include "ISceneManager.h"
+#include "SkinnedMesh.h"
+#include "irrlicht.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+void checkSameVertices(scene::SkinnedMesh *expected, scene::SkinnedMesh *actual)
+{
+	REQUIRE(actual->getMeshBufferCount() == expected->getMeshBufferCount());
+	for (u32 i = 0; i < expected->getMeshBufferCount(); i++) {
+		auto *buf1 = expected->getMeshBuffer(i);
+		auto *buf2 = actual->getMeshBuffer(i);
+		REQUIRE(buf2->getVertexCount() == buf1->getVertexCount());
+		for (u32 j = 0; j < buf1->getVertexCount(); j++) {
+			CHECK(buf2->getPosition(j).equals(buf1->getPosition(j)));
+			CHECK(buf2->getNormal(j).equals(buf1->getNormal(j)));
+		}
+	}
+}
+
+std::vector<core::matrix4> getGlobalMatrices(scene::SkinnedMesh *mesh, f32 frame)
+{
+	std::vector<core::matrix4> matrices;
+	for (const auto &transform : mesh->animateMesh(frame)) {
+		if (const auto *matrix = std::get_if<core::matrix4>(&transform))
+			matrices.push_back(*matrix);
+		else
+			matrices.push_back(std::get<core::Transform>(transform).buildMatrix());
+	}
+	mesh->calculateGlobalMatrices(matrices);
+	return matrices;
+}
+
+}
+
+TEST_CASE("model cache")
+{
+	const auto gamespec = findSubgame("devtest");
+	if (!gamespec.isValid())
+		SKIP();
+
+	SIrrlichtCreationParameters p;
+	p.DriverType = video::EDT_NULL;
+	auto *device = createDeviceEx(p);
+	REQUIRE(device);
+	auto *smgr = device->getSceneManager();
+
+	const std::string dir = fs::CreateTempDir();
+	REQUIRE(!dir.empty());
+	ModelCache cache(dir);
+
+	const auto readFile = [] (const std::string &path) {
+		std::ifstream is(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(is), {});
+	};
+	const auto parse = [&] (const std::string &path) {
+		irr_ptr<io::IReadFile> file(device->getFileSystem()->createAndOpenFile(path.c_str()));
+		REQUIRE(file);
+		auto *mesh = smgr->getMesh(file.get());
+		REQUIRE(mesh);
+		mesh->grab();
+		smgr->getMeshCache()->removeMesh(mesh);
+		return mesh;
+	};
+
+	const std::string mods = gamespec.gamemods_path + DIR_DELIM;
+	const std::string models[] = {
+		mods + "gltf" + DIR_DELIM + "models" + DIR_DELIM + "gltf_spider_animated.gltf",
+		mods + "gltf" + DIR_DELIM + "models" + DIR_DELIM + "gltf_simple_skin.gltf",
+		mods + "testentities" + DIR_DELIM + "models" + DIR_DELIM + "testentities_sam.b3d",
+		mods + "testentities" + DIR_DELIM + "models" + DIR_DELIM + "testentities_lava_flan.x",
+	};
+
+	for (const auto &path : models) {
+		const std::string name = fs::GetFilenameFromPath(path.c_str());
+		const std::string sha1 = hashing::sha1(readFile(path));
+		CAPTURE(name);
+
+		CHECK(!cache.load(name, sha1));
+		auto *parsed = parse(path);
+		cache.store(name, sha1, parsed);
+		auto *loaded = cache.load(name, sha1);
+		REQUIRE(loaded);
+
+		REQUIRE(loaded->getMeshType() == scene::EAMT_SKINNED);
+		auto *mesh1 = static_cast<scene::SkinnedMesh *>(parsed);
+		auto *mesh2 = static_cast<scene::SkinnedMesh *>(loaded);
+		CHECK(mesh2->getSourceFormat() == mesh1->getSourceFormat());
+		CHECK(mesh2->getMaxFrameNumber() == mesh1->getMaxFrameNumber());
+		CHECK(mesh2->getAnimationSpeed() == mesh1->getAnimationSpeed());
+		CHECK(mesh2->getBoundingBox() == mesh1->getBoundingBox());
+
+		REQUIRE(mesh2->getMeshBufferCount() == mesh1->getMeshBufferCount());
+		for (u32 i = 0; i < mesh1->getMeshBufferCount(); i++) {
+			auto *buf1 = static_cast<scene::SSkinMeshBuffer *>(mesh1->getMeshBuffer(i));
+			auto *buf2 = static_cast<scene::SSkinMeshBuffer *>(mesh2->getMeshBuffer(i));
+			CHECK(mesh2->getTextureSlot(i) == mesh1->getTextureSlot(i));
+			CHECK(buf2->Material == buf1->Material);
+			CHECK(buf2->Transformation == buf1->Transformation);
+			CHECK(buf2->getVertexType() == buf1->getVertexType());
+			REQUIRE(buf2->getIndexCount() == buf1->getIndexCount());
+			CHECK(memcmp(buf2->getIndices(), buf1->getIndices(),
+				buf1->getIndexCount() * sizeof(u16)) == 0);
+		}
+
+		const auto &joints1 = mesh1->getAllJoints();
+		const auto &joints2 = mesh2->getAllJoints();
+		REQUIRE(joints2.size() == joints1.size());
+		for (size_t i = 0; i < joints1.size(); i++) {
+			CHECK(joints2[i]->Name == joints1[i]->Name);
+			CHECK(joints2[i]->ParentJointID == joints1[i]->ParentJointID);
+			CHECK(joints2[i]->AttachedMeshes == joints1[i]->AttachedMeshes);
+			CHECK(joints2[i]->GlobalInversedMatrix == joints1[i]->GlobalInversedMatrix);
+			CHECK(joints2[i]->Weights.size() == joints1[i]->Weights.size());
+		}
+
+		checkSameVertices(mesh1, mesh2);
+		if (!mesh1->isStatic()) {
+			const f32 frame = mesh1->getMaxFrameNumber() / 3;
+			mesh1->skinMesh(getGlobalMatrices(mesh1, frame));
+			mesh2->skinMesh(getGlobalMatrices(mesh2, frame));
+			checkSameVertices(mesh1, mesh2);
+		}
+
+		parsed->drop();
+		loaded->drop();
+	}
+
+	SECTION("broken files are ignored")
+	{
+		const std::string path = models[0];
+		const std::string name = fs::GetFilenameFromPath(path.c_str());
+		const std::string sha1 = hashing::sha1(readFile(path));
+		std::vector<std::string> files;
+		for (const auto &entry : fs::GetDirListing(dir))
+			files.push_back(dir + DIR_DELIM + entry.name);
+		for (const auto &file : files) {
+			std::string data = readFile(file);
+			data.resize(data.size() / 2);
+			std::ofstream(file, std::ios::binary) << data;
+		}
+		CHECK(!cache.load(name, sha1));
+	}
+
+	SECTION("static meshes aren't stored")
+	{
+		const std::string path = mods + "testnodes" + DIR_DELIM + "models" +
+			DIR_DELIM + "testnodes_pyramid.obj";
+		const std::string sha1 = hashing::sha1(readFile(path));
+		auto *mesh = parse(path);
+		cache.store("testnodes_pyramid.obj", sha1, mesh);
+		CHECK(!cache.load("testnodes_pyramid.obj", sha1));
+		mesh->drop();
+	}
+
+	fs::RecursiveDelete(dir);
+	device->closeDevice();
+	device->drop();
+}
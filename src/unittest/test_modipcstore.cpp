@@ -0,0 +1,86 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include <thread>
+#include "server.h"
+#include "script/common/c_packer.h"
+
+class TestModIPCStore : public TestBase
+{
+public:
+	TestModIPCStore() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestModIPCStore"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testSetGet();
+	void testReplace();
+	void testWait();
+};
+
+static TestModIPCStore g_test_instance;
+
+void TestModIPCStore::runTests(IGameDef *gamedef)
+{
+	TEST(testSetGet);
+	TEST(testReplace);
+	TEST(testWait);
+}
+
+void TestModIPCStore::testSetGet()
+{
+	ModIPCStore store;
+	UASSERT(!store.get("test:a"));
+
+	auto a = std::make_shared<PackedValue>();
+	auto b = std::make_shared<PackedValue>();
+	store.set("test:a", a);
+	store.set("test:b", b);
+	UASSERT(store.get("test:a") == a);
+	UASSERT(store.get("test:b") == b);
+
+	store.set("test:a", nullptr);
+	UASSERT(!store.get("test:a"));
+	UASSERT(store.get("test:b") == b);
+}
+
+void TestModIPCStore::testReplace()
+{
+	ModIPCStore store;
+	auto a = std::make_shared<PackedValue>();
+	auto b = std::make_shared<PackedValue>();
+
+	// missing keys compare equal to nullptr
+	UASSERT(!store.replace("test:a", a, b));
+	UASSERT(store.replace("test:a", nullptr, a));
+	UASSERT(store.get("test:a") == a);
+
+	UASSERT(!store.replace("test:a", b, b));
+	UASSERT(store.replace("test:a", a, b));
+	UASSERT(store.get("test:a") == b);
+
+	UASSERT(store.replace("test:a", b, nullptr));
+	UASSERT(!store.get("test:a"));
+}
+
+void TestModIPCStore::testWait()
+{
+	ModIPCStore store;
+	using namespace std::chrono_literals;
+
+	UASSERT(!store.waitFor("test:a", 1ms));
+
+	std::thread setter([&] () {
+		std::this_thread::sleep_for(10ms);
+		// doesn't concern the waiter
+		store.set("test:b", std::make_shared<PackedValue>());
+		store.set("test:a", std::make_shared<PackedValue>());
+	});
+	UASSERT(store.waitFor("test:a", 10s));
+	setter.join();
+
+	UASSERT(store.waitFor("test:a", 0ms));
+}
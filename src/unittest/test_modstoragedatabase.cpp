@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include "database/database-cache.h"
 #include "database/database-dummy.h"
 #include "database/database-files.h"
 #include "database/database-sqlite3.h"
@@ -159,6 +160,7 @@ class TestModStorageDatabase : public TestBase
 	void testRecallChanged();
 	void testListMods();
 	void testRemove();
+	void testCacheWriteBack(const std::string &test_dir);
 
 private:
 	ModStorageDatabaseProvider *mod_storage_provider;
@@ -231,6 +233,20 @@ void TestModStorageDatabase::runTests(IGameDef *gamedef)
 
 	delete mod_storage_provider;
 
+	// reset database
+	fs::DeleteSingleFileOrEmptyDirectory(test_dir + DIR_DELIM + "mod_storage.sqlite");
+
+	rawstream << "-------- Cached SQLite3 database (same object)" << std::endl;
+
+	mod_storage_db = new ModStorageDatabaseCache(new ModStorageDatabaseSQLite3(test_dir));
+	mod_storage_provider = new FixedProvider(mod_storage_db);
+
+	runTestsForCurrentDB();
+	TEST(testCacheWriteBack, test_dir);
+
+	delete mod_storage_db;
+	delete mod_storage_provider;
+
 #if USE_POSTGRESQL
 	const char *env_postgresql_connect_string = getenv("MINETEST_POSTGRESQL_CONNECT_STRING");
 	if (env_postgresql_connect_string) {
@@ -348,3 +364,25 @@ void TestModStorageDatabase::testRemove()
 	UASSERT(!mod_storage_db->removeModEntries("mod1"));
 	UASSERT(mod_storage_db->removeModEntries("mod2"));
 }
+
+void TestModStorageDatabase::testCacheWriteBack(const std::string &test_dir)
+{
+	ModStorageDatabase *mod_storage_db = mod_storage_provider->getModStorageDatabase();
+	mod_storage_db->beginSave();
+	for (int i = 0; i < 10; i++)
+		UASSERT(mod_storage_db->setModEntry("mod3", "key1", std::to_string(i)));
+	UASSERT(mod_storage_db->setModEntry("mod3", "key2", "gone"));
+	UASSERT(mod_storage_db->removeModEntry("mod3", "key2"));
+
+	// nothing is written before the save
+	ModStorageDatabaseSQLite3 other(test_dir);
+	UASSERT(!other.hasModEntry("mod3", "key1"));
+
+	mod_storage_db->endSave();
+	std::string value;
+	UASSERT(other.getModEntry("mod3", "key1", &value));
+	UASSERTCMP(std::string, ==, value, "9");
+	UASSERT(!other.hasModEntry("mod3", "key2"));
+
+	UASSERT(mod_storage_db->removeModEntries("mod3"));
+}
@@ -9,6 +9,7 @@
 #include <catch.h>
 
 #include <ios>
+#include <memory>
 #include <sstream>
 
 
@@ -32,3 +33,97 @@ TEST_CASE("Given a node definition, "
 	CHECK(f.walkable == f2.walkable);
 	CHECK(f.node_box.type == f2.node_box.type);
 }
+
+TEST_CASE("NodeDefManager modification counter", "[nodedef]")
+{
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	u32 counter = ndef->getModificationCounter();
+
+	ContentFeatures f;
+	f.name = "default:stone";
+	ndef->set(f.name, f);
+	CHECK(ndef->getModificationCounter() != counter);
+
+	// lookups don't count
+	counter = ndef->getModificationCounter();
+	CHECK(ndef->getId("default:stone") != CONTENT_IGNORE);
+	CHECK(ndef->getModificationCounter() == counter);
+
+	ndef->removeNode(f.name);
+	CHECK(ndef->getModificationCounter() != counter);
+}
+
+TEST_CASE("NodeDefManager shape flags follow the node definitions", "[nodedef]")
+{
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+
+	ContentLightingFlags air_light = ndef->getLightingFlags(CONTENT_AIR);
+	ContentShapeFlags air = ndef->getShapeFlags(CONTENT_AIR);
+	CHECK(air_light.has_light);
+	CHECK(air.drawtype == NDT_AIRLIKE);
+	CHECK(!air.walkable);
+
+	ContentFeatures f;
+	f.name = "default:fence";
+	f.drawtype = NDT_NODEBOX;
+	f.node_box.type = NODEBOX_CONNECTED;
+	f.liquid_type = LIQUID_SOURCE;
+	content_t id = ndef->set(f.name, f);
+
+	ContentShapeFlags fence = ndef->getShapeFlags(id);
+	CHECK(fence.drawtype == NDT_NODEBOX);
+	CHECK((LiquidType)fence.liquid_type == LIQUID_SOURCE);
+	CHECK(fence.walkable);
+	CHECK(fence.connected);
+	CHECK(!fence.full_collision_box);
+
+	f.name = "default:stone";
+	f.drawtype = NDT_NORMAL;
+	f.node_box.type = NODEBOX_REGULAR;
+	f.liquid_type = LIQUID_NONE;
+	id = ndef->set(f.name, f);
+	CHECK(ndef->getShapeFlags(id).full_collision_box);
+#if CHECK_CLIENT_BUILD()
+	CHECK(ndef->getShapeFlags(id).solidness == 2);
+#endif
+
+	// Unregistered ids look like the unknown node
+	CHECK(ndef->getShapeFlags(CONTENT_MAX).drawtype == NDT_NORMAL);
+}
+
+TEST_CASE("NodeDefManager group IDs", "[nodedef]")
+{
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	CHECK(ndef->getGroupId("cracky") == NodeDefManager::GROUP_ID_NONE);
+
+	ContentFeatures f;
+	f.name = "default:stone";
+	f.groups["cracky"] = 3;
+	f.groups["stone"] = 1;
+	content_t stone = ndef->set(f.name, f);
+
+	f.name = "default:dirt";
+	f.groups.clear();
+	f.groups["crumbly"] = 2;
+	content_t dirt = ndef->set(f.name, f);
+
+	u16 cracky = ndef->getGroupId("cracky");
+	u16 crumbly = ndef->getGroupId("crumbly");
+	REQUIRE(cracky != NodeDefManager::GROUP_ID_NONE);
+	REQUIRE(crumbly != NodeDefManager::GROUP_ID_NONE);
+	CHECK(cracky != crumbly);
+
+	CHECK(ndef->getGroupRating(stone, cracky) == 3);
+	CHECK(ndef->getGroupRating(stone, crumbly) == 0);
+	CHECK(ndef->getGroupRating(dirt, crumbly) == 2);
+	CHECK(ndef->getGroupRating(CONTENT_AIR, cracky) == 0);
+
+	// Re-registration replaces the ratings, the ID stays
+	f.groups["crumbly"] = 1;
+	ndef->set(f.name, f);
+	CHECK(ndef->getGroupId("crumbly") == crumbly);
+	CHECK(ndef->getGroupRating(dirt, crumbly) == 1);
+
+	ndef->removeNode("default:stone");
+	CHECK(ndef->getGroupRating(stone, cracky) == 0);
+}
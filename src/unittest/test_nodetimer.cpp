@@ -0,0 +1,83 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include <cmath>
+#include "nodetimer.h"
+
+TEST_CASE("NodeTimerQueue") {
+	NodeTimerQueue queue;
+	std::vector<NodeTimerQueue::Entry> due;
+	const v3s16 bp(1, 2, 3);
+
+SECTION("due lists only") {
+	NodeTimerList list, idle;
+	list.insert(NodeTimer(1.0f, 0.0f, v3s16(1, 1, 1)));
+	list.step(0.5f);
+	list.attach(&queue, bp);
+	idle.attach(&queue, v3s16(0, 0, 0));
+	CHECK(queue.size() == 1);
+
+	queue.step(0.4f, due);
+	CHECK(due.empty());
+	CHECK(std::fabs(list.get(v3s16(1, 1, 1)).elapsed - 0.9f) < 1e-4f);
+
+	queue.step(0.2f, due);
+	REQUIRE(due.size() == 1);
+	CHECK(due[0].blockpos == bp);
+	CHECK(list.takeScheduled(&queue, due[0].due));
+	auto elapsed = list.step(0);
+	REQUIRE(elapsed.size() == 1);
+	CHECK(std::fabs(elapsed[0].elapsed - 1.1f) < 1e-4f);
+	CHECK(queue.size() == 0);
+}
+
+SECTION("outdated entries") {
+	NodeTimerList list;
+	list.attach(&queue, bp);
+	list.insert(NodeTimer(2.0f, 0.0f, v3s16(1, 1, 1)));
+	// an earlier timer adds a second entry
+	list.insert(NodeTimer(1.0f, 0.0f, v3s16(2, 2, 2)));
+	CHECK(queue.size() == 2);
+
+	queue.step(1.5f, due);
+	REQUIRE(due.size() == 1);
+	REQUIRE(list.takeScheduled(&queue, due[0].due));
+	CHECK(list.step(0).size() == 1);
+
+	// the first timer was scheduled again, only one of its entries counts
+	due.clear();
+	queue.step(1.0f, due);
+	REQUIRE(due.size() == 2);
+	CHECK(list.takeScheduled(&queue, due[0].due));
+	CHECK(!list.takeScheduled(&queue, due[1].due));
+	CHECK(list.step(0).size() == 1);
+
+	// removed timers leave an entry that is ignored
+	list.insert(NodeTimer(1.0f, 0.0f, v3s16(3, 3, 3)));
+	list.remove(v3s16(3, 3, 3));
+	due.clear();
+	queue.step(1.0f, due);
+	REQUIRE(due.size() == 1);
+	CHECK(list.takeScheduled(&queue, due[0].due));
+	CHECK(list.step(0).empty());
+	CHECK(queue.size() == 0);
+}
+
+SECTION("detach") {
+	NodeTimerList list;
+	list.insert(NodeTimer(1.0f, 0.0f, v3s16(1, 1, 1)));
+	list.attach(&queue, bp);
+	queue.step(0.5f, due);
+	list.detach();
+	CHECK(!list.isAttached(&queue));
+	// time stands still for detached lists, the entry is outdated
+	queue.step(1.0f, due);
+	REQUIRE(due.size() == 1);
+	CHECK(!list.takeScheduled(&queue, due[0].due));
+	CHECK(std::fabs(list.get(v3s16(1, 1, 1)).elapsed - 0.5f) < 1e-4f);
+	CHECK(list.step(0.5f).size() == 1);
+}
+
+}
@@ -0,0 +1,93 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "client/occlusion_buffer.h"
+
+class TestOcclusionBuffer : public TestBase
+{
+public:
+	TestOcclusionBuffer() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestOcclusionBuffer"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testOccluded();
+	void testPartiallyOccluded();
+	void testReset();
+};
+
+static TestOcclusionBuffer g_test_instance;
+
+void TestOcclusionBuffer::runTests(IGameDef *gamedef)
+{
+	TEST(testOccluded);
+	TEST(testPartiallyOccluded);
+	TEST(testReset);
+}
+
+// A wall across the view at z = 10, from -size to size
+static void add_wall(OcclusionBuffer &buffer, f32 size)
+{
+	const v3f corners[4] = {
+		v3f(-size, -size, 10) * BS,
+		v3f(size, -size, 10) * BS,
+		v3f(size, size, 10) * BS,
+		v3f(-size, size, 10) * BS,
+	};
+	buffer.addOccluder(corners);
+}
+
+static aabb3f make_box(v3f min, v3f max)
+{
+	return aabb3f(min * BS, max * BS);
+}
+
+void TestOcclusionBuffer::testOccluded()
+{
+	OcclusionBuffer buffer;
+	buffer.reset(v3f(0, 0, 0), v3f(0, 0, 1), 0.5f);
+	UASSERT(!buffer.hasOccluders());
+	UASSERT(!buffer.isOccluded(make_box(v3f(-1, -1, 20), v3f(1, 1, 21))));
+
+	add_wall(buffer, 20);
+	UASSERT(buffer.hasOccluders());
+	// behind the wall
+	UASSERT(buffer.isOccluded(make_box(v3f(-1, -1, 20), v3f(1, 1, 21))));
+	UASSERT(buffer.isOccluded(make_box(v3f(2, 3, 11), v3f(3, 4, 100))));
+	// in front of it, or going through it
+	UASSERT(!buffer.isOccluded(make_box(v3f(-1, -1, 5), v3f(1, 1, 6))));
+	UASSERT(!buffer.isOccluded(make_box(v3f(-1, -1, 9), v3f(1, 1, 11))));
+	// behind the camera
+	UASSERT(!buffer.isOccluded(make_box(v3f(-1, -1, -21), v3f(1, 1, -20))));
+}
+
+void TestOcclusionBuffer::testPartiallyOccluded()
+{
+	OcclusionBuffer buffer;
+	buffer.reset(v3f(0, 0, 0), v3f(0, 0, 1), 0.5f);
+	add_wall(buffer, 2);
+
+	UASSERT(buffer.isOccluded(make_box(v3f(-1, -1, 20), v3f(1, 1, 21))));
+	// sticks out at the side
+	UASSERT(!buffer.isOccluded(make_box(v3f(3, -1, 20), v3f(5, 1, 21))));
+	// outside of the buffer
+	UASSERT(!buffer.isOccluded(make_box(v3f(-100, -1, 20), v3f(100, 1, 21))));
+}
+
+void TestOcclusionBuffer::testReset()
+{
+	OcclusionBuffer buffer;
+	buffer.reset(v3f(0, 0, 0), v3f(0, 0, 1), 0.5f);
+	add_wall(buffer, 20);
+	UASSERT(buffer.isOccluded(make_box(v3f(-1, -1, 20), v3f(1, 1, 21))));
+
+	// the same wall, now seen from behind the box
+	buffer.reset(v3f(0, 0, 30) * BS, v3f(0, 0, -1), 0.5f);
+	UASSERT(!buffer.hasOccluders());
+	add_wall(buffer, 20);
+	UASSERT(!buffer.isOccluded(make_box(v3f(-1, -1, 20), v3f(1, 1, 21))));
+	UASSERT(buffer.isOccluded(make_box(v3f(-1, -1, 0), v3f(1, 1, 1))));
+}
@@ -0,0 +1,101 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "exceptions.h"
+#include "network/networkpacket.h"
+#include "server/packetdecoder.h"
+#include <sstream>
+
+// Packets are read like they arrive from the connection
+static NetworkPacket received(NetworkPacket &sent)
+{
+	Buffer<u8> data = sent.oldForgePacket();
+	NetworkPacket pkt;
+	pkt.putRawPacket(*data, data.getSize(), 1);
+	return pkt;
+}
+
+TEST_CASE("decodeCommand") {
+
+SECTION("got blocks") {
+	NetworkPacket sent(TOSERVER_GOTBLOCKS, 0);
+	sent << (u8)2 << v3s16(1, 2, 3) << v3s16(-4, 5, -6);
+	NetworkPacket pkt = received(sent);
+
+	DecodedCommand cmd;
+	decodeCommand(&pkt, cmd);
+	REQUIRE(!cmd.empty());
+	const auto &got = std::get<DecodedGotBlocks>(cmd.data);
+	REQUIRE(got.blocks.size() == 2);
+	CHECK(got.blocks[0] == v3s16(1, 2, 3));
+	CHECK(got.blocks[1] == v3s16(-4, 5, -6));
+}
+
+SECTION("interact leaves player position in the packet") {
+	PointedThing pointed(v3s16(1, 2, 3), v3s16(1, 3, 3), v3s16(1, 2, 3),
+		v3f(0.5f, 1, 0.5f), v3f(0, 1, 0), 0, 0.25f,
+		PointabilityType::POINTABLE);
+	std::ostringstream os(std::ios::binary);
+	pointed.serialize(os);
+
+	NetworkPacket sent(TOSERVER_INTERACT, 0);
+	sent << (u8)INTERACT_PLACE << (u16)3;
+	sent.putLongString(os.str());
+	sent << (u8)42;
+	NetworkPacket pkt = received(sent);
+
+	DecodedCommand cmd;
+	decodeCommand(&pkt, cmd);
+	const auto &interact = std::get<DecodedInteract>(cmd.data);
+	CHECK(interact.action == INTERACT_PLACE);
+	CHECK(interact.item == 3);
+	CHECK(interact.pointed == pointed);
+
+	u8 rest;
+	pkt >> rest;
+	CHECK(rest == 42);
+}
+
+SECTION("formspec fields") {
+	NetworkPacket sent(TOSERVER_INVENTORY_FIELDS, 0);
+	sent << "form" << (u16)1 << "quit";
+	sent.putLongString("true");
+	NetworkPacket pkt = received(sent);
+
+	DecodedCommand cmd;
+	decodeCommand(&pkt, cmd);
+	const auto &fields = std::get<DecodedInventoryFields>(cmd.data);
+	CHECK(fields.formname == "form");
+	CHECK(!fields.too_large);
+	CHECK(fields.fields.at("quit") == "true");
+
+	NetworkPacket sent_big(TOSERVER_NODEMETA_FIELDS, 0);
+	sent_big << v3s16(0, 1, 0) << "" << (u16)1 << "x";
+	sent_big.putLongString(std::string(1024 * 1024, 'a'));
+	NetworkPacket big = received(sent_big);
+	DecodedCommand cmd2;
+	decodeCommand(&big, cmd2);
+	const auto &meta = std::get<DecodedNodeMetaFields>(cmd2.data);
+	CHECK(meta.pos == v3s16(0, 1, 0));
+	CHECK(meta.too_large);
+	CHECK(meta.fields.empty());
+}
+
+SECTION("other commands and truncated packets") {
+	NetworkPacket sent(TOSERVER_PLAYERPOS, 0);
+	sent << (u8)0;
+	NetworkPacket pkt = received(sent);
+	DecodedCommand cmd;
+	decodeCommand(&pkt, cmd);
+	CHECK(cmd.empty());
+
+	NetworkPacket sent_truncated(TOSERVER_GOTBLOCKS, 0);
+	sent_truncated << (u8)2 << v3s16(1, 2, 3);
+	NetworkPacket truncated = received(sent_truncated);
+	DecodedCommand cmd2;
+	CHECK_THROWS_AS(decodeCommand(&truncated, cmd2), PacketError);
+}
+
+}
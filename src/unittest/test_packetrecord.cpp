@@ -0,0 +1,96 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "filesys.h"
+#include "network/networkpacket.h"
+#include "server/packetrecord.h"
+#include <fstream>
+
+TEST_CASE("PacketRecorder and ReplayConnection") {
+	const std::string path = fs::CreateTempFile();
+	REQUIRE(!path.empty());
+
+	{
+		PacketRecorder recorder(path);
+		REQUIRE(recorder.isOpen());
+		recorder.peerAdded(1, 2, Address(127, 0, 0, 1, 30001));
+		NetworkPacket pkt(TOSERVER_INIT, 0, 2);
+		pkt << (u8)29 << std::string("singleplayer");
+		recorder.packet(1, pkt);
+		NetworkPacket empty(TOSERVER_CLIENT_READY, 0, 2);
+		recorder.packet(3, empty);
+		recorder.peerRemoved(4, 2, true);
+	}
+
+SECTION("records come back in the recorded steps") {
+	ReplayConnection con(path);
+	REQUIRE(con.isOpen());
+	CHECK_THROWS_AS(con.GetPeerAddress(2), con::PeerNotFoundException);
+
+	PacketRecord record;
+	CHECK(!con.pop(0, record));
+	REQUIRE(con.pop(1, record));
+	CHECK(record.type == PacketRecord::PEER_ADDED);
+	CHECK(record.peer_id == 2);
+	CHECK(con.GetPeerAddress(2).getPort() == 30001);
+
+	REQUIRE(con.pop(1, record));
+	CHECK(record.type == PacketRecord::PACKET);
+	CHECK(record.command == TOSERVER_INIT);
+	NetworkPacket pkt;
+	record.toPacket(pkt);
+	CHECK(pkt.getPeerId() == 2);
+	u8 ser_ver;
+	std::string name;
+	pkt >> ser_ver >> name;
+	CHECK(ser_ver == 29);
+	CHECK(name == "singleplayer");
+
+	CHECK(!con.pop(2, record));
+	REQUIRE(con.pop(3, record));
+	CHECK(record.command == TOSERVER_CLIENT_READY);
+	CHECK(record.data.empty());
+	CHECK(!con.isFinished());
+
+	REQUIRE(con.pop(10, record));
+	CHECK(record.type == PacketRecord::PEER_REMOVED);
+	CHECK(record.timeout);
+	CHECK(con.isFinished());
+	CHECK(!con.pop(10, record));
+
+	NetworkPacket sent(TOCLIENT_HELLO, 0, 2);
+	sent << (u32)1234;
+	con.Send(2, 0, &sent, true);
+	CHECK(con.getSentPackets() == 1);
+	CHECK(con.getSentBytes() == 4);
+}
+
+SECTION("truncated recording ends early") {
+	{
+		std::ofstream os(path, std::ios::binary | std::ios::app);
+		os.write("\x02\x00", 2);
+	}
+	ReplayConnection con(path);
+	REQUIRE(con.isOpen());
+	PacketRecord record;
+	int count = 0;
+	while (con.pop(100, record))
+		count++;
+	CHECK(count == 4);
+	CHECK(con.isFinished());
+}
+
+SECTION("other files are rejected") {
+	{
+		std::ofstream os(path, std::ios::binary | std::ios::trunc);
+		os << "not a recording";
+	}
+	ReplayConnection con(path);
+	CHECK(!con.isOpen());
+	CHECK(con.isFinished());
+}
+
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+}
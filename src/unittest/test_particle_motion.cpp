@@ -0,0 +1,64 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "client/particles.h"
+
+class TestParticleMotion : public TestBase
+{
+public:
+	TestParticleMotion() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestParticleMotion"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testIntegrate();
+	void testSwapRemove();
+};
+
+static TestParticleMotion g_test_instance;
+
+void TestParticleMotion::runTests(IGameDef *gamedef)
+{
+	TEST(testIntegrate);
+	TEST(testSwapRemove);
+}
+
+void TestParticleMotion::testIntegrate()
+{
+	ParticleMotion motion;
+	const v3f pos(1, 2, 3), vel(-2, 0, 4), acc(0, -10, 0), drag(0.5f, 0, 0.25f);
+	motion.push(pos, vel, acc, drag);
+	motion.push(v3f(), v3f(), v3f(), v3f());
+
+	const f32 dtime = 0.1f;
+	motion.integrate(dtime);
+
+	// the drag keeps the direction of the velocity
+	v3f v = vel - vel * drag * dtime;
+	v3f p = pos + (v + acc * 0.5f * dtime) * dtime;
+	v += acc * dtime;
+	UASSERT(motion.getPos(0).equals(p));
+	UASSERT(v3f(motion.vel[0][0], motion.vel[1][0], motion.vel[2][0]).equals(v));
+	UASSERT(motion.getPos(1) == v3f());
+}
+
+void TestParticleMotion::testSwapRemove()
+{
+	ParticleMotion motion;
+	for (int i = 0; i < 3; i++)
+		motion.push(v3f(i, 0, 0), v3f(0, i, 0), v3f(), v3f());
+
+	motion.swapRemove(0);
+	UASSERTEQ(size_t, motion.size(), 2);
+	UASSERT(motion.getPos(0) == v3f(2, 0, 0));
+	UASSERT(motion.vel[1][0] == 2.0f);
+	UASSERT(motion.getPos(1) == v3f(1, 0, 0));
+
+	motion.swapRemove(1);
+	UASSERTEQ(size_t, motion.size(), 1);
+	motion.clear();
+	UASSERTEQ(size_t, motion.size(), 0);
+}
@@ -0,0 +1,143 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "dummymap.h"
+#include "gamedef.h"
+#include "navigation_cache.h"
+#include "nodedef.h"
+#include "pathfinder.h"
+#include "porting.h"
+#include "server/pathfinderpool.h"
+
+class TestPathfinder : public TestBase {
+public:
+	TestPathfinder() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestPathfinder"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testNavigationCache(IGameDef *gamedef);
+	void testPathfinderPool(IGameDef *gamedef);
+};
+
+static TestPathfinder g_test_instance;
+
+void TestPathfinder::runTests(IGameDef *gamedef)
+{
+	TEST(testNavigationCache, gamedef);
+	TEST(testPathfinderPool, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+	// Every step of the path is a move the node-level pathfinder can do
+	bool is_walkable_path(Map &map, const NodeDefManager *ndef,
+			const std::vector<v3s16> &path)
+	{
+		for (size_t i = 0; i < path.size(); i++) {
+			const v3s16 p = path[i];
+			if (ndef->get(map.getNode(p)).walkable ||
+					!ndef->get(map.getNode(p - v3s16(0, 1, 0))).walkable)
+				return false;
+			if (i > 0) {
+				const v3s16 d = p - path[i - 1];
+				if (std::abs(d.X) + std::abs(d.Z) != 1 || std::abs(d.Y) > 1)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool passes(const std::vector<v3s16> &path, v3s16 p)
+	{
+		return std::find(path.begin(), path.end(), p) != path.end();
+	}
+}
+
+void TestPathfinder::testNavigationCache(IGameDef *gamedef)
+{
+	const NodeDefManager *ndef = gamedef->getNodeDefManager();
+	DummyMap map(gamedef, {-1, 0, 0}, {2, 0, 0});
+	map.fill({-1, 0, 0}, {2, 0, 0}, MapNode(CONTENT_AIR));
+
+	// A floor along four blocks, with a wall that has a gap at Z = 12
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 x = -MAP_BLOCKSIZE; x < 3 * MAP_BLOCKSIZE; x++)
+		map.setNode(v3s16(x, 0, z), MapNode(t_CONTENT_STONE));
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 1; y <= 3; y++) {
+		if (z != 12)
+			map.setNode(v3s16(30, y, z), MapNode(t_CONTENT_STONE));
+	}
+
+	NavigationCache navcache(&map, ndef);
+	const v3s16 source(-10, 1, 2), destination(45, 1, 3);
+	std::vector<v3s16> path = get_path(&map, ndef, source, destination,
+		16, 1, 1, PA_PLAIN, &navcache);
+	UASSERT(path.size() > 1);
+	UASSERT(path.front() == source);
+	UASSERT(path.back() == destination);
+	UASSERT(is_walkable_path(map, ndef, path));
+	UASSERT(passes(path, v3s16(30, 1, 12)));
+	UASSERT(navcache.getClusterCount() > 0);
+
+	// As short as the node-level path
+	std::vector<v3s16> node_path = get_path(&map, ndef, source, destination,
+		16, 1, 1, PA_PLAIN);
+	UASSERTEQ(size_t, path.size(), node_path.size());
+
+	// Changes of the map are seen by the next search
+	for (s16 y = 1; y <= 3; y++)
+		map.setNode(v3s16(30, y, 12), MapNode(t_CONTENT_STONE));
+	path = get_path(&map, ndef, source, destination, 16, 1, 1, PA_PLAIN, &navcache);
+	UASSERT(path.empty());
+
+	map.setNode(v3s16(30, 1, 5), MapNode(CONTENT_AIR));
+	map.setNode(v3s16(30, 2, 5), MapNode(CONTENT_AIR));
+	map.setNode(v3s16(30, 3, 5), MapNode(CONTENT_AIR));
+	path = get_path(&map, ndef, source, destination, 16, 1, 1, PA_PLAIN, &navcache);
+	UASSERT(is_walkable_path(map, ndef, path));
+	UASSERT(passes(path, v3s16(30, 1, 5)));
+}
+
+void TestPathfinder::testPathfinderPool(IGameDef *gamedef)
+{
+	DummyMap map(gamedef, {0, 0, 0}, {1, 0, 0});
+	map.fill({0, 0, 0}, {1, 0, 0}, MapNode(CONTENT_AIR));
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 x = 0; x < 2 * MAP_BLOCKSIZE; x++)
+		map.setNode(v3s16(x, 0, z), MapNode(t_CONTENT_STONE));
+
+	PathfinderPool pool(gamedef, 1, 2);
+	PathfinderPool::Request request{v3s16(2, 1, 2), v3s16(28, 1, 9), 4, 1, 1, PA_PLAIN};
+	const u32 id = pool.enqueue(request);
+	const u32 canceled = pool.enqueue(request);
+	UASSERT(id != 0 && canceled != 0 && id != canceled);
+	// the queue is full
+	UASSERTEQ(u32, pool.enqueue(request), 0);
+	UASSERT(pool.cancel(canceled));
+	UASSERT(!pool.cancel(canceled));
+
+	// too large
+	request.searchdistance = 1000;
+	UASSERTEQ(u32, pool.enqueue(request), 0);
+
+	std::vector<PathfinderPool::Result> results;
+	for (int i = 0; i < 500 && results.empty(); i++) {
+		pool.step(&map, results);
+		if (results.empty())
+			sleep_ms(10);
+	}
+	UASSERTEQ(size_t, results.size(), 1);
+	UASSERTEQ(u32, results[0].id, id);
+	const std::vector<v3s16> &path = results[0].path;
+	UASSERT(!path.empty());
+	UASSERT(path.front() == v3s16(2, 1, 2));
+	UASSERT(path.back() == v3s16(28, 1, 9));
+	UASSERT(is_walkable_path(map, gamedef->getNodeDefManager(), path));
+	UASSERT(!pool.cancel(id));
+}
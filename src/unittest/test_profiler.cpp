@@ -5,6 +5,7 @@
 #include "test.h"
 
 #include "profiler.h"
+#include <thread>
 
 class TestProfiler : public TestBase
 {
@@ -15,6 +16,7 @@ class TestProfiler : public TestBase
 	void runTests(IGameDef *gamedef);
 
 	void testProfilerAverage();
+	void testProfilerKeys();
 };
 
 static TestProfiler g_test_instance;
@@ -22,6 +24,7 @@ static TestProfiler g_test_instance;
 void TestProfiler::runTests(IGameDef *gamedef)
 {
 	TEST(testProfilerAverage);
+	TEST(testProfilerKeys);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,3 +59,42 @@ void TestProfiler::testProfilerAverage()
 
 	UASSERT(p.getValue("Test2") == 123.57f);
 }
+
+void TestProfiler::testProfilerKeys()
+{
+	Profiler p;
+	static const ProfilerKey key_add("TestKeyAdd", SPT_ADD);
+	static const ProfilerKey key_avg("TestKeyAvg", SPT_AVG);
+	static const ProfilerKey key_max("TestKeyMax", SPT_MAX);
+
+	// Same slot as the string methods
+	p.add("TestKeyAdd", 1.f);
+	p.record(key_add, 2.f);
+	p.record(key_avg, 1.f);
+	p.record(key_avg, 3.f);
+	p.record(key_max, 5.f);
+	p.record(key_max, 4.f);
+
+	std::thread thread([&] {
+		p.record(key_add, 4.f);
+		p.record(key_avg, 8.f);
+		p.record(key_max, 7.f);
+	});
+	thread.join();
+
+	p.merge();
+	UASSERT(p.getValue("TestKeyAdd") == 7.f);
+	UASSERT(p.getValue("TestKeyAvg") == 4.f);
+	UASSERT(p.getAvgCount("TestKeyAvg") == 3);
+	UASSERT(p.getValue("TestKeyMax") == 7.f);
+
+	// Nothing is merged twice
+	p.merge();
+	UASSERT(p.getValue("TestKeyAdd") == 7.f);
+
+	p.clear();
+	p.record(key_add, 1.f);
+	p.merge();
+	UASSERT(p.getValue("TestKeyAdd") == 1.f);
+	UASSERT(p.getValue("TestKeyMax") == 0.f);
+}
@@ -0,0 +1,51 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include <ctime>
+#include "filesys.h"
+#include "server/rollback.h"
+
+static RollbackAction make_set_node(const std::string &actor, v3s16 p)
+{
+	RollbackNode n_old, n_new;
+	n_old.name = "air";
+	n_new.name = "default:stone";
+	RollbackAction action;
+	action.setSetNode(p, n_old, n_new);
+	action.unix_time = time(0);
+	action.actor = actor;
+	return action;
+}
+
+TEST_CASE("RollbackManager") {
+	const std::string dir = fs::CreateTempDir();
+	REQUIRE(!dir.empty());
+
+SECTION("lookups see queued actions") {
+	RollbackManager mgr(dir, nullptr);
+	for (s16 x = 0; x < 10; x++)
+		mgr.addAction(make_set_node("player1", v3s16(x, 0, 0)));
+	mgr.addAction(make_set_node("player2", v3s16(0, 1, 0)));
+
+	// no explicit flush
+	auto actions = mgr.getRevertActions("player1", 60);
+	CHECK(actions.size() == 10);
+	actions = mgr.getNodeActors(v3s16(0, 0, 0), 1, 60, 100);
+	// (0, 0, 0), (1, 0, 0) and (0, 1, 0)
+	CHECK(actions.size() == 3);
+}
+
+SECTION("actions are written on destruction") {
+	{
+		RollbackManager mgr(dir, nullptr);
+		for (s16 x = 0; x < 1200; x++)
+			mgr.addAction(make_set_node("player1", v3s16(x, 0, 0)));
+	}
+	RollbackManager mgr(dir, nullptr);
+	CHECK(mgr.getRevertActions("player1", 60).size() == 1200);
+}
+
+	fs::RecursiveDelete(dir);
+}
@@ -26,6 +26,7 @@ class TestSAO : public TestBase
 	void testActivate(ServerEnvironment *env);
 	void testStaticToFalse(ServerEnvironment *env);
 	void testStaticToTrue(ServerEnvironment *env);
+	void testPropertyPacket(ServerEnvironment *env);
 
 private:
 	// enough for both removeRemovedObjects and deactivateFarObjects to be called
@@ -85,6 +86,7 @@ void TestSAO::runTests(IGameDef *gamedef)
 	TEST(testActivate, &env);
 	TEST(testStaticToFalse, &env);
 	TEST(testStaticToTrue, &env);
+	TEST(testPropertyPacket, &env);
 
 	env.deactivateBlocksAndObjects();
 }
@@ -298,3 +300,28 @@ void TestSAO::testStaticToTrue(ServerEnvironment *env)
 	UASSERTEQ(size_t, block->m_static_objects.getStoredSize(), 1);
 	UASSERTEQ(size_t, block->m_static_objects.getActiveSize(), 0);
 }
+
+void TestSAO::testPropertyPacket(ServerEnvironment *env)
+{
+	const v3f testpos(0, 7 * BS, -50 * BS);
+
+	auto obj = add_entity(env, testpos, "test:non_static");
+	UASSERT(obj);
+	const u16 obj_id = obj->getId();
+
+	const std::string data1 = obj->getClientInitializationData(LATEST_PROTOCOL_VERSION);
+	UASSERT(data1 == obj->getClientInitializationData(LATEST_PROTOCOL_VERSION));
+	UASSERT(data1.find("test nametag") == std::string::npos);
+
+	// the serialized properties must be renewed once they change
+	obj->accessObjectProperties()->nametag = "test nametag";
+	obj->notifyObjectPropertiesModified();
+	const std::string data2 = obj->getClientInitializationData(LATEST_PROTOCOL_VERSION);
+	UASSERT(data2.find("test nametag") != std::string::npos);
+
+	obj->markForRemoval();
+	env->step(m_step_interval);
+
+	obj = nullptr;
+	UASSERT(!env->getActiveObject(obj_id));
+}
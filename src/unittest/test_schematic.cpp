@@ -7,6 +7,8 @@
 #include "mapgen/mg_schematic.h"
 #include "gamedef.h"
 #include "nodedef.h"
+#include "dummymap.h"
+#include "noise.h"
 
 class TestSchematic : public TestBase {
 public:
@@ -18,6 +20,7 @@ class TestSchematic : public TestBase {
 	void testMtsSerializeDeserialize(const NodeDefManager *ndef);
 	void testLuaTableSerialize(const NodeDefManager *ndef);
 	void testFileSerializeDeserialize(const NodeDefManager *ndef);
+	void testBlitToVManip(IGameDef *gamedef);
 
 	static const content_t test_schem1_data[7 * 6 * 4];
 	static const content_t test_schem2_data[3 * 3 * 3];
@@ -37,6 +40,7 @@ void TestSchematic::runTests(IGameDef *gamedef)
 	TEST(testMtsSerializeDeserialize, ndef);
 	TEST(testLuaTableSerialize, ndef);
 	TEST(testFileSerializeDeserialize, ndef);
+	TEST(testBlitToVManip, gamedef);
 
 	ndef->resetNodeResolveState();
 }
@@ -172,6 +176,170 @@ void TestSchematic::testFileSerializeDeserialize(const NodeDefManager *ndef)
 }
 
 
+// Places the schematic node by node, like blitToVManip() used to
+static void blit_per_node(const Schematic &schem, const NodeDefManager *ndef,
+	MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+{
+	int xstride = 1;
+	int ystride = schem.size.X;
+	int zstride = schem.size.X * schem.size.Y;
+
+	s16 sx = schem.size.X;
+	s16 sy = schem.size.Y;
+	s16 sz = schem.size.Z;
+
+	int i_start, i_step_x, i_step_z;
+	switch (rot) {
+		case ROTATE_90:
+			i_start  = sx - 1;
+			i_step_x = zstride;
+			i_step_z = -xstride;
+			std::swap(sx, sz);
+			break;
+		case ROTATE_180:
+			i_start  = zstride * (sz - 1) + sx - 1;
+			i_step_x = -xstride;
+			i_step_z = -zstride;
+			break;
+		case ROTATE_270:
+			i_start  = zstride * (sz - 1);
+			i_step_x = -zstride;
+			i_step_z = xstride;
+			std::swap(sx, sz);
+			break;
+		default:
+			i_start  = 0;
+			i_step_x = xstride;
+			i_step_z = zstride;
+	}
+
+	s16 y_map = p.Y;
+	for (s16 y = 0; y != sy; y++) {
+		if ((schem.slice_probs[y] != MTSCHEM_PROB_ALWAYS) &&
+			(schem.slice_probs[y] <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
+			continue;
+
+		for (s16 z = 0; z != sz; z++) {
+			u32 i = z * i_step_z + y * ystride + i_start;
+			for (s16 x = 0; x != sx; x++, i += i_step_x) {
+				v3s16 pos(p.X + x, y_map, p.Z + z);
+				if (!vm->m_area.contains(pos))
+					continue;
+
+				const MapNode &n = schem.schemdata[i];
+				if (n.getContent() == CONTENT_IGNORE)
+					continue;
+
+				u8 placement_prob     = n.param1 & MTSCHEM_PROB_MASK;
+				bool force_place_node = n.param1 & MTSCHEM_FORCE_PLACE;
+
+				if (placement_prob == MTSCHEM_PROB_NEVER)
+					continue;
+
+				u32 vi = vm->m_area.index(pos);
+				if (!force_place && !force_place_node) {
+					content_t c = vm->m_data[vi].getContent();
+					if (c != CONTENT_AIR && c != CONTENT_IGNORE)
+						continue;
+				}
+
+				if ((placement_prob != MTSCHEM_PROB_ALWAYS) &&
+					(placement_prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
+					continue;
+
+				vm->m_data[vi] = n;
+				vm->m_data[vi].param1 = 0;
+				if (rot)
+					vm->m_data[vi].rotateAlongYAxis(ndef, rot);
+			}
+		}
+		y_map++;
+	}
+}
+
+
+void TestSchematic::testBlitToVManip(IGameDef *gamedef)
+{
+	const NodeDefManager *ndef = gamedef->getNodeDefManager();
+	static const v3s16 size(6, 4, 5);
+	static const u32 volume = size.X * size.Y * size.Z;
+	const content_t contents[] = {
+		CONTENT_AIR, CONTENT_IGNORE, t_CONTENT_STONE, t_CONTENT_TORCH,
+	};
+	const u8 probs[] = {
+		MTSCHEM_PROB_ALWAYS,
+		MTSCHEM_PROB_ALWAYS | MTSCHEM_FORCE_PLACE,
+		MTSCHEM_PROB_ALWAYS_OLD,
+		MTSCHEM_PROB_NEVER,
+		100,
+		30 | MTSCHEM_FORCE_PLACE,
+	};
+
+	Schematic schem;
+	schem.m_ndef      = ndef;
+	schem.size        = size;
+	schem.schemdata   = new MapNode[volume];
+	schem.slice_probs = new u8[size.Y];
+
+	PcgRandom pr(42);
+	for (size_t i = 0; i != volume; i++) {
+		// mostly runs of the same kind
+		if (i == 0 || pr.range(0, 3) == 0)
+			schem.schemdata[i] = MapNode(contents[pr.range(0, 3)], probs[pr.range(0, 5)]);
+		else
+			schem.schemdata[i] = schem.schemdata[i - 1];
+		schem.schemdata[i].param2 = pr.range(0, 5);
+	}
+	for (s16 y = 0; y != size.Y; y++)
+		schem.slice_probs[y] = MTSCHEM_PROB_ALWAYS;
+	schem.slice_probs[1] = 150;
+
+	DummyMap map(gamedef, {0, 0, 0}, {0, 0, 0});
+	const VoxelArea area(v3s16(0, 0, 0), v3s16(7, 5, 7));
+	// inside, and cut off on every side
+	const v3s16 positions[] = {
+		v3s16(1, 1, 1), v3s16(-3, -2, 4), v3s16(4, 3, -2), v3s16(-8, 0, 0),
+	};
+
+	for (int rot = ROTATE_0; rot <= ROTATE_270; rot++)
+	for (v3s16 p : positions)
+	for (bool force_place : {false, true}) {
+		MMVManip vm1(&map), vm2(&map);
+		vm1.addArea(area);
+		vm2.addArea(area);
+		for (u32 i = 0; i != area.getVolume(); i++) {
+			vm1.m_data[i] = MapNode(contents[i % 3]);
+			vm2.m_data[i] = vm1.m_data[i];
+		}
+
+		mysrand(rot * 10 + p.X);
+		schem.blitToVManip(&vm1, p, (Rotation)rot, force_place);
+		u32 next1 = myrand();
+		mysrand(rot * 10 + p.X);
+		blit_per_node(schem, ndef, &vm2, p, (Rotation)rot, force_place);
+		u32 next2 = myrand();
+
+		UASSERTEQ(u32, next1, next2);
+		for (u32 i = 0; i != area.getVolume(); i++)
+			UASSERT(vm1.m_data[i] == vm2.m_data[i]);
+	}
+
+	// changing the schematic must not keep using the old data
+	std::vector<std::pair<v3s16, u8>> plist;
+	std::vector<std::pair<s16, u8>> splist;
+	for (s16 x = 0; x != size.X; x++)
+		plist.emplace_back(v3s16(x, 0, 0), MTSCHEM_PROB_ALWAYS | MTSCHEM_FORCE_PLACE);
+	schem.applyProbabilities(v3s16(0, 0, 0), &plist, &splist);
+
+	MMVManip vm1(&map), vm2(&map);
+	vm1.addArea(area);
+	vm2.addArea(area);
+	schem.blitToVManip(&vm1, v3s16(0, 0, 0), ROTATE_0, false);
+	blit_per_node(schem, ndef, &vm2, v3s16(0, 0, 0), ROTATE_0, false);
+	for (u32 i = 0; i != area.getVolume(); i++)
+		UASSERT(vm1.m_data[i] == vm2.m_data[i]);
+}
+
 // Should form a cross-shaped-thing...?
 const content_t TestSchematic::test_schem1_data[7 * 6 * 4] = {
 	3, 3, 1, 1, 1, 3, 3, // Y=0, Z=0
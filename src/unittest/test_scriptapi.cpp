@@ -11,6 +11,7 @@
 #include "script/common/c_converter.h"
 #include "irrlicht_changes/printing.h"
 #include "server.h"
+#include "porting.h"
 
 namespace {
 	class MyScriptApi : virtual public ScriptApiBase {
@@ -33,6 +34,7 @@ class TestScriptApi : public TestBase
 	void testVectorRead(MyScriptApi *script);
 	void testVectorReadErr(MyScriptApi *script);
 	void testVectorReadMix(MyScriptApi *script);
+	void testModTimes(MyScriptApi *script);
 };
 
 static TestScriptApi g_test_instance;
@@ -73,6 +75,7 @@ void TestScriptApi::runTests(IGameDef *gamedef)
 	TEST(testVectorRead, &script);
 	TEST(testVectorReadErr, &script);
 	TEST(testVectorReadMix, &script);
+	TEST(testModTimes, &script);
 }
 
 // Runs Lua code and leaves `nresults` return values on the stack
@@ -194,3 +197,39 @@ void TestScriptApi::testVectorReadMix(MyScriptApi *script)
 		lua_pop(L, 1);
 	}
 }
+
+void TestScriptApi::testModTimes(MyScriptApi *script)
+{
+	auto get_time = [script] (const std::string &mod) -> u64 {
+		for (auto &it : script->getModTimes()) {
+			if (it.first == mod)
+				return it.second;
+		}
+		return 0;
+	};
+
+	// not counted outside of calls
+	script->setOriginDirect("timing_a");
+	sleep_ms(5);
+	UASSERTEQ(u64, get_time("timing_a"), 0);
+
+	u64 *outer = script->beginTiming();
+	script->setOriginDirect("timing_a");
+	sleep_ms(5);
+	{
+		u64 *inner = script->beginTiming();
+		script->setOriginDirect("timing_b");
+		sleep_ms(5);
+		script->endTiming(inner);
+	}
+	// the time after the nested call belongs to the caller again
+	sleep_ms(5);
+	script->endTiming(outer);
+
+	u64 a = get_time("timing_a"), b = get_time("timing_b");
+	UASSERT(a >= 10000);
+	UASSERT(b >= 5000);
+	sleep_ms(5);
+	UASSERTEQ(u64, get_time("timing_a"), a);
+	UASSERTEQ(u64, get_time("timing_b"), b);
+}
@@ -0,0 +1,65 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "catch.h"
+#include "mapblock.h"
+#include "server/serializedblockcache.h"
+
+TEST_CASE("SerializedBlockCache") {
+
+SECTION("versioned lookup") {
+	SerializedBlockCache cache(1024);
+	const v3s16 pos(1, 2, 3);
+	CHECK(cache.get(pos, 29, 1) == nullptr);
+
+	cache.put(pos, 29, 1, "abc");
+	const std::string *s = cache.get(pos, 29, 1);
+	REQUIRE(s != nullptr);
+	CHECK(*s == "abc");
+	// other block version or serialization version
+	CHECK(cache.get(pos, 29, 2) == nullptr);
+	CHECK(cache.get(pos, 28, 1) == nullptr);
+
+	// replacing an entry
+	cache.put(pos, 29, 2, "defg");
+	CHECK(cache.get(pos, 29, 1) == nullptr);
+	REQUIRE(cache.get(pos, 29, 2) != nullptr);
+	CHECK(cache.size() == 1);
+	CHECK(cache.getBytes() == 4);
+}
+
+SECTION("eviction") {
+	SerializedBlockCache cache(10);
+	cache.put({0, 0, 0}, 29, 1, "aaaa");
+	cache.put({1, 0, 0}, 29, 1, "bbbb");
+	// mark first one as used
+	CHECK(cache.get({0, 0, 0}, 29, 1) != nullptr);
+	cache.put({2, 0, 0}, 29, 1, "cccc");
+
+	CHECK(cache.getBytes() <= 10);
+	CHECK(cache.get({0, 0, 0}, 29, 1) != nullptr);
+	CHECK(cache.get({1, 0, 0}, 29, 1) == nullptr);
+	CHECK(cache.get({2, 0, 0}, 29, 1) != nullptr);
+
+	// an entry larger than the budget is kept until the next insert
+	const std::string &big = cache.put({3, 0, 0}, 29, 1, std::string(20, 'x'));
+	CHECK(big.size() == 20);
+	CHECK(cache.size() == 1);
+}
+
+SECTION("block modification counter") {
+	MapBlock block({0, 0, 0}, nullptr);
+	MapBlock block2({0, 0, 0}, nullptr);
+	CHECK(block.getModificationCounter() != block2.getModificationCounter());
+
+	u64 counter = block.getModificationCounter();
+	block.setNode({1, 1, 1}, MapNode(CONTENT_AIR));
+	CHECK(block.getModificationCounter() != counter);
+
+	counter = block.getModificationCounter();
+	block.setTimestamp(123);
+	CHECK(block.getModificationCounter() == counter);
+}
+
+}
@@ -277,6 +277,52 @@ SECTION("get added active objects around pos") {
 	saomgr.clear();
 }
 
+SECTION("get added active objects with seen cells") {
+	server::ActiveObjectMgr saomgr;
+	auto obj1 = std::make_unique<MockServerActiveObject>(nullptr, v3f(10, 40, 10));
+	auto obj2 = std::make_unique<MockServerActiveObject>(nullptr, v3f(30, 0, 30));
+	auto *ptr1 = obj1.get(), *ptr2 = obj2.get();
+	saomgr.registerObject(std::move(obj1));
+	saomgr.registerObject(std::move(obj2));
+
+	std::vector<u16> result;
+	std::set<u16> cur_objects;
+	std::unordered_map<v3s16, u32> seen_cells;
+	const auto get_added = [&] () {
+		result.clear();
+		saomgr.getAddedActiveObjectsAroundPos(v3f(), "singleplayer", 740, 50,
+			cur_objects, result, &seen_cells);
+		cur_objects.insert(result.begin(), result.end());
+	};
+	get_added();
+	CHECK(result.size() == 2);
+	CHECK(seen_cells.size() == 1);
+
+	// the cell didn't change, not even checked
+	cur_objects.erase(ptr1->getId());
+	get_added();
+	CHECK(result.empty());
+
+	// moved to another cell
+	ptr1->setPos(v3f(300, 0, 0));
+	saomgr.updateObjectPos(ptr1->getId(), ptr1->getBasePosition());
+	get_added();
+	CHECK(result == std::vector<u16>{ptr1->getId()});
+
+	// observers were removed
+	ptr2->m_observers = std::unordered_set<std::string>{"other"};
+	saomgr.invalidateActiveObjectObserverCaches();
+	cur_objects.erase(ptr2->getId());
+	get_added();
+	CHECK(result.empty());
+	ptr2->m_observers.reset();
+	saomgr.invalidateActiveObjectObserverCaches();
+	get_added();
+	CHECK(result == std::vector<u16>{ptr2->getId()});
+
+	saomgr.clear();
+}
+
 SECTION("spatial index") {
 	TestServerActiveObjectMgr saomgr;
 	std::mt19937 gen(0xABCDEF);
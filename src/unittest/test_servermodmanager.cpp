@@ -34,6 +34,7 @@ class TestServerModManager : public TestBase
 	void testGetModNames();
 	void testGetModMediaPathsWrongDir();
 	void testGetModMediaPaths();
+	void testChangedModContents();
 };
 
 static TestServerModManager g_test_instance;
@@ -71,6 +72,7 @@ void TestServerModManager::runTests(IGameDef *gamedef)
 	TEST(testGetModNames);
 	TEST(testGetModMediaPathsWrongDir);
 	TEST(testGetModMediaPaths);
+	TEST(testChangedModContents);
 	// TODO: test MINETEST_GAME_PATH
 
 	unsetenv("MINETEST_MOD_PATH");
@@ -180,3 +182,28 @@ void TestServerModManager::testGetModMediaPaths()
 	UASSERT(it != result.end());
 	UASSERT(std::find(++it, result.end(), sm.getModSpec("basenodes")->path + DIR_DELIM + "textures") != result.end());
 }
+
+void TestServerModManager::testChangedModContents()
+{
+	const auto path = getTestTempDirectory().append(DIR_DELIM "changed_mod");
+	fs::CreateAllDirs(path);
+	std::ofstream(path + DIR_DELIM "init.lua", std::ios::binary) << "\n";
+	std::ofstream(path + DIR_DELIM "mod.conf", std::ios::binary) << "name = one\n";
+
+	ModSpec spec("changed_mod", path, false, "changed_mod");
+	UASSERT(parseModContents(spec));
+	UASSERTEQ(std::string, spec.name, "one");
+	UASSERT(spec.depends.empty());
+
+	// a different size is noticed even within the resolution of the times
+	std::ofstream(path + DIR_DELIM "mod.conf", std::ios::binary)
+		<< "name = two\ndepends = one\n";
+	ModSpec spec2("changed_mod", path, false, "changed_mod");
+	UASSERT(parseModContents(spec2));
+	UASSERTEQ(std::string, spec2.name, "two");
+	UASSERT(spec2.depends.count("one") == 1);
+
+	fs::DeleteSingleFileOrEmptyDirectory(path + DIR_DELIM "init.lua");
+	ModSpec spec3("changed_mod", path, false, "changed_mod");
+	UASSERT(!parseModContents(spec3));
+}
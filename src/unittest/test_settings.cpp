@@ -19,6 +19,7 @@ class TestSettings : public TestBase {
 	void testAllSettings();
 	void testDefaults();
 	void testFlagDesc();
+	void testCachedSetting();
 
 	static const char *config_text_before;
 	static const char *config_text_after;
@@ -31,6 +32,7 @@ void TestSettings::runTests(IGameDef *gamedef)
 	TEST(testAllSettings);
 	TEST(testDefaults);
 	TEST(testFlagDesc);
+	TEST(testCachedSetting);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -310,3 +312,28 @@ void TestSettings::testFlagDesc()
 
 	delete &s;
 }
+
+void TestSettings::testCachedSetting()
+{
+	Settings s;
+	s.set("test_s16", "-12");
+	s.setBool("test_bool", true);
+	{
+		CachedSetting<s16> cached_s16("test_s16", &s);
+		CachedSetting<bool> cached_bool("test_bool", &s);
+		CachedSetting<float> cached_float("test_missing", &s);
+		UASSERTEQ(s16, cached_s16.get(), -12);
+		UASSERTEQ(bool, cached_bool.get(), true);
+		UASSERTEQ(float, cached_float.get(), 0.0f);
+
+		s.set("test_s16", "300");
+		s.setBool("test_bool", false);
+		s.setFloat("test_missing", 2.5f);
+		UASSERTEQ(s16, cached_s16.get(), 300);
+		UASSERTEQ(bool, cached_bool.get(), false);
+		UASSERTEQ(float, cached_float.get(), 2.5f);
+	}
+
+	// Handles deregister their callbacks when destroyed
+	UASSERT(s.m_callbacks["test_s16"].empty());
+}
@@ -0,0 +1,122 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "test.h"
+
+#include "server/srpverifierpool.h"
+#include "threading/jobsystem.h"
+#include "util/auth.h"
+#include "util/srp.h"
+#include "util/string.h"
+
+class TestSrpVerifierPool : public TestBase
+{
+public:
+	TestSrpVerifierPool() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestSrpVerifierPool"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testLogin();
+	void testLimit();
+};
+
+static TestSrpVerifierPool g_test_instance;
+
+void TestSrpVerifierPool::runTests(IGameDef *gamedef)
+{
+	TEST(testLogin);
+	TEST(testLimit);
+}
+
+namespace {
+	// Does the client side of a login, returns whether the server accepted it
+	bool try_login(SrpVerifierPool &pool, const std::string &password,
+			const std::string &stored_password)
+	{
+		const std::string name = "Player";
+		SrpVerifierPool::Request request;
+		request.peer_id = 2;
+		request.name = name;
+		generate_srp_verifier_and_salt(name, stored_password,
+			&request.verifier, &request.salt);
+
+		const std::string name_lower = lowercase(name);
+		SRPUser *user = srp_user_new(SRP_SHA256, SRP_NG_2048,
+			name.c_str(), name_lower.c_str(),
+			(const unsigned char *) password.c_str(), password.size(),
+			nullptr, nullptr);
+		char *bytes_A = nullptr;
+		size_t len_A = 0;
+		UASSERT(srp_user_start_authentication(user, nullptr, nullptr, 0,
+			(unsigned char **) &bytes_A, &len_A) == SRP_OK);
+		request.bytes_A.assign(bytes_A, len_A);
+		UASSERT(pool.enqueue(std::move(request)));
+
+		std::vector<SrpVerifierPool::Result> results;
+		do {
+			pool.take(results);
+		} while (results.empty());
+		UASSERTEQ(size_t, results.size(), 1);
+		SrpVerifierPool::Result &result = results[0];
+		UASSERTEQ(session_t, result.peer_id, 2);
+		UASSERT(result.verifier);
+		UASSERT(!result.bytes_B.empty());
+
+		char *bytes_M = nullptr;
+		size_t len_M = 0;
+		srp_user_process_challenge(user,
+			(const unsigned char *) result.salt.c_str(), result.salt.size(),
+			(const unsigned char *) result.bytes_B.c_str(), result.bytes_B.size(),
+			(unsigned char **) &bytes_M, &len_M);
+		unsigned char *bytes_HAMK = nullptr;
+		if (bytes_M) {
+			UASSERTEQ(size_t, len_M,
+				srp_verifier_get_session_key_length(result.verifier));
+			srp_verifier_verify_session(result.verifier,
+				(const unsigned char *) bytes_M, &bytes_HAMK);
+		}
+
+		srp_verifier_delete(result.verifier);
+		srp_user_delete(user);
+		return bytes_HAMK != nullptr;
+	}
+}
+
+void TestSrpVerifierPool::testLogin()
+{
+	JobSystem jobs(2);
+	SrpVerifierPool pool(4, &jobs);
+	UASSERT(try_login(pool, "secret", "secret"));
+	UASSERT(!try_login(pool, "wrong", "secret"));
+}
+
+void TestSrpVerifierPool::testLimit()
+{
+	// Jobs run inside enqueue()
+	JobSystem jobs(0);
+	SrpVerifierPool pool(1, &jobs);
+
+	SrpVerifierPool::Request request;
+	request.peer_id = 3;
+	request.name = "Player";
+	request.legacy = true;
+	request.enc_pwd = translate_password("Player", "secret");
+	// A = 0 fails the SRP-6a safety check
+	request.bytes_A = std::string(256, '\0');
+	UASSERT(pool.enqueue(request));
+	// The result wasn't taken yet
+	UASSERT(!pool.enqueue(request));
+
+	std::vector<SrpVerifierPool::Result> results;
+	pool.take(results);
+	UASSERTEQ(size_t, results.size(), 1);
+	UASSERT(results[0].bytes_B.empty());
+	UASSERT(!results[0].salt.empty());
+	if (results[0].verifier)
+		srp_verifier_delete(results[0].verifier);
+
+	UASSERT(pool.enqueue(request));
+	// The destructor deletes the verifier that is left
+}
@@ -6,8 +6,11 @@
 
 #include <atomic>
 #include <iostream>
+#include <vector>
+#include "threading/jobsystem.h"
 #include "threading/semaphore.h"
 #include "threading/thread.h"
+#include "threading/workerpool.h"
 
 
 class TestThreading : public TestBase {
@@ -19,6 +22,8 @@ class TestThreading : public TestBase {
 	void testStartStopWait();
 	void testAtomicSemaphoreThread();
 	void testTLS();
+	void testJobSystem();
+	void testWorkerPool();
 };
 
 static TestThreading g_test_instance;
@@ -28,6 +33,8 @@ void TestThreading::runTests(IGameDef *gamedef)
 	TEST(testStartStopWait);
 	TEST(testAtomicSemaphoreThread);
 	TEST(testTLS);
+	TEST(testJobSystem);
+	TEST(testWorkerPool);
 }
 
 class SimpleTestThread : public Thread {
@@ -227,3 +234,51 @@ void TestThreading::testTLS()
 		}
 	}
 }
+
+
+void TestThreading::testJobSystem()
+{
+	std::atomic<u32> done{0};
+	{
+		JobSystem jobs(3);
+		UASSERTEQ(size_t, jobs.getThreadCount(), 3);
+		for (u32 i = 0; i < 100; i++) {
+			jobs.submit([&] { done++; }, (JobPriority)(i % JOB_PRIORITY_COUNT),
+				i % 2 ? (int)i : -1);
+		}
+		// the destructor runs the remaining jobs
+	}
+	UASSERTEQ(u32, done, 100);
+
+	// Without threads, submit() runs the job
+	JobSystem inline_jobs(0);
+	bool ran = false;
+	inline_jobs.submit([&] { ran = true; });
+	UASSERT(ran);
+}
+
+void TestThreading::testWorkerPool()
+{
+	JobSystem jobs(2);
+	WorkerPool pool("TestWorkerPool", 4, &jobs);
+	UASSERTEQ(size_t, pool.getThreadCount(), 2);
+
+	std::vector<u32> calls(1000, 0);
+	pool.run(calls.size(), [&] (size_t i) { calls[i]++; });
+	for (u32 count : calls)
+		UASSERTEQ(u32, count, 1);
+
+	// Runs from inside of jobs may not wait for each other
+	std::atomic<u32> sum{0};
+	Semaphore finished;
+	for (int j = 0; j < 2; j++) {
+		jobs.submit([&] {
+			WorkerPool inner("TestWorkerPoolInner", 2, &jobs);
+			inner.run(100, [&] (size_t i) { sum += i; });
+			finished.post();
+		});
+	}
+	finished.wait();
+	finished.wait();
+	UASSERTEQ(u32, sum, 2 * 4950);
+}
@@ -4,6 +4,7 @@
 #include "translation.h"
 #include "filesys.h"
 #include "content/subgames.h"
+#include "util/string.h"
 #include "catch.h"
 
 #define CONTEXT L"context"
@@ -90,4 +91,18 @@ TEST_CASE("test translations")
 		CHECK(translations.getPluralTranslation(CONTEXT, L"Plural form", 1) == L"Singular result");
 		CHECK(translations.getPluralTranslation(CONTEXT, L"Singular form", 0) == L"Plural result");
 	}
+
+	SECTION("Cache of translated strings")
+	{
+		Translations translations;
+		const std::wstring s = L"\x1b(T@" TEXTDOMAIN_PO L")foo\x1b" L"E";
+		CHECK(translate_string(s, &translations) == L"foo");
+		CHECK(translate_string(s, &translations) == L"foo");
+
+		// Loading translations drops the old results
+		translations.loadTranslation(TEST_PO_NAME, read_translation_file(TEST_PO_NAME));
+		CHECK(translate_string(s, &translations) == L"bar");
+		CHECK(translate_string(s, &translations) == L"bar");
+		CHECK(translate_string(L"no escapes", &translations) == L"no escapes");
+	}
 }
@@ -19,6 +19,7 @@ class TestVoxelAlgorithms : public TestBase {
 
 	void testVoxelLineIterator();
 	void testLighting(IGameDef *gamedef);
+	void testBulkLighting(IGameDef *gamedef);
 };
 
 static TestVoxelAlgorithms g_test_instance;
@@ -27,6 +28,7 @@ void TestVoxelAlgorithms::runTests(IGameDef *gamedef)
 {
 	TEST(testVoxelLineIterator);
 	TEST(testLighting, gamedef);
+	TEST(testBulkLighting, gamedef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -86,31 +88,33 @@ void TestVoxelAlgorithms::testVoxelLineIterator()
 	}
 }
 
+// Makes a 21x21x21 hollow box centered at the origin.
+static void make_hollow_box(Map &map, v3s16 bpmin, v3s16 bpmax)
+{
+	std::map<v3s16, MapBlock*> modified_blocks;
+	MMVManip vm(&map);
+	vm.initialEmerge(bpmin, bpmax, false);
+	u32 volume = vm.m_area.getVolume();
+	for (u32 i = 0; i < volume; i++)
+		vm.m_data[i] = MapNode(CONTENT_AIR);
+	for (s16 z = -10; z <= 10; z++)
+	for (s16 y = -10; y <= 10; y++)
+	for (s16 x = -10; x <= 10; x++)
+		vm.setNodeNoEmerge(v3s16(x, y, z), MapNode(t_CONTENT_STONE));
+	for (s16 z = -9; z <= 9; z++)
+	for (s16 y = -9; y <= 9; y++)
+	for (s16 x = -9; x <= 9; x++)
+		vm.setNodeNoEmerge(v3s16(x, y, z), MapNode(CONTENT_AIR));
+	voxalgo::blit_back_with_light(&map, &vm, &modified_blocks);
+}
+
 void TestVoxelAlgorithms::testLighting(IGameDef *gamedef)
 {
 	v3s16 pmin(-32, -32, -32);
 	v3s16 pmax(31, 31, 31);
 	v3s16 bpmin = getNodeBlockPos(pmin), bpmax = getNodeBlockPos(pmax);
 	DummyMap map(gamedef, bpmin, bpmax);
-
-	// Make a 21x21x21 hollow box centered at the origin.
-	{
-		std::map<v3s16, MapBlock*> modified_blocks;
-		MMVManip vm(&map);
-		vm.initialEmerge(bpmin, bpmax, false);
-		u32 volume = vm.m_area.getVolume();
-		for (u32 i = 0; i < volume; i++)
-			vm.m_data[i] = MapNode(CONTENT_AIR);
-		for (s16 z = -10; z <= 10; z++)
-		for (s16 y = -10; y <= 10; y++)
-		for (s16 x = -10; x <= 10; x++)
-			vm.setNodeNoEmerge(v3s16(x, y, z), MapNode(t_CONTENT_STONE));
-		for (s16 z = -9; z <= 9; z++)
-		for (s16 y = -9; y <= 9; y++)
-		for (s16 x = -9; x <= 9; x++)
-			vm.setNodeNoEmerge(v3s16(x, y, z), MapNode(CONTENT_AIR));
-		voxalgo::blit_back_with_light(&map, &vm, &modified_blocks);
-	}
+	make_hollow_box(map, bpmin, bpmax);
 
 	// Place two holes on the edges a torch in the center.
 	{
@@ -153,3 +157,69 @@ void TestVoxelAlgorithms::testLighting(IGameDef *gamedef)
 		UASSERTEQ(int, n.getParam1(), 153);
 	}
 }
+
+namespace {
+	class EventCounter : public MapEventReceiver {
+	public:
+		void onMapEditEvent(const MapEditEvent &event) override
+		{
+			events.push_back(event.type);
+			if (event.changed_nodes)
+				changed_blocks += event.changed_nodes->size();
+		}
+
+		std::vector<MapEditEventType> events;
+		size_t changed_blocks = 0;
+	};
+}
+
+void TestVoxelAlgorithms::testBulkLighting(IGameDef *gamedef)
+{
+	v3s16 pmin(-32, -32, -32);
+	v3s16 pmax(31, 31, 31);
+	v3s16 bpmin = getNodeBlockPos(pmin), bpmax = getNodeBlockPos(pmax);
+	DummyMap map_single(gamedef, bpmin, bpmax), map_bulk(gamedef, bpmin, bpmax);
+	make_hollow_box(map_single, bpmin, bpmax);
+	make_hollow_box(map_bulk, bpmin, bpmax);
+
+	// Remove a wall, and put a row of torches inside
+	std::vector<v3s16> wall, torches;
+	for (s16 z = -10; z <= 10; z++)
+	for (s16 y = -10; y <= 10; y++)
+		wall.emplace_back(-10, y, z);
+	for (s16 x = -5; x <= 5; x++)
+		torches.emplace_back(x, -9, 0);
+
+	{
+		std::map<v3s16, MapBlock*> modified_blocks;
+		for (v3s16 p : wall)
+			map_single.addNodeAndUpdate(p, MapNode(CONTENT_AIR), modified_blocks);
+		for (v3s16 p : torches)
+			map_single.addNodeAndUpdate(p, MapNode(t_CONTENT_TORCH), modified_blocks);
+	}
+
+	EventCounter counter;
+	map_bulk.addEventReceiver(&counter);
+	UASSERT(map_bulk.addNodesWithEvent(wall, MapNode(CONTENT_AIR)));
+	UASSERT(map_bulk.addNodesWithEvent(torches, MapNode(t_CONTENT_TORCH)));
+	UASSERTEQ(size_t, counter.events.size(), 2);
+	UASSERT(counter.events[0] == MEET_OTHER);
+	// the wall is in 4 blocks, the torches in 2
+	UASSERTEQ(size_t, counter.changed_blocks, 6);
+
+	// including the light
+	for (s16 z = -12; z <= 12; z++)
+	for (s16 y = -12; y <= 12; y++)
+	for (s16 x = -12; x <= 12; x++) {
+		MapNode n_single = map_single.getNode(v3s16(x, y, z));
+		MapNode n_bulk = map_bulk.getNode(v3s16(x, y, z));
+		UASSERT(n_single == n_bulk);
+	}
+
+	// outside of the map
+	std::vector<v3s16> outside = {v3s16(0, 0, 0), v3s16(0, 100, 0)};
+	UASSERT(!map_bulk.addNodesWithEvent(outside, MapNode(t_CONTENT_STONE)));
+	UASSERTEQ(size_t, outside.size(), 1);
+	UASSERT(outside[0] == v3s16(0, 0, 0));
+	map_bulk.removeEventReceiver(&counter);
+}
@@ -23,6 +23,8 @@ class TestVoxelManipulator : public TestBase {
 	void testEmerge(IGameDef *gamedef);
 	void testBlitBack(IGameDef *gamedef);
 	void testBlitBack2(IGameDef *gamedef);
+	void testBlitBackChanges(IGameDef *gamedef);
+	void testBlitBackUnchanged(IGameDef *gamedef);
 };
 
 static TestVoxelManipulator g_test_instance;
@@ -33,6 +35,8 @@ void TestVoxelManipulator::runTests(IGameDef *gamedef)
 	TEST(testEmerge, gamedef);
 	TEST(testBlitBack, gamedef);
 	TEST(testBlitBack2, gamedef);
+	TEST(testBlitBackChanges, gamedef);
+	TEST(testBlitBackUnchanged, gamedef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -179,3 +183,58 @@ void TestVoxelManipulator::testBlitBack2(IGameDef *gamedef)
 	// The upper one should not!
 	UASSERTEQ(auto, map.getNode({0,bs,0}).getContent(), CONTENT_AIR);
 }
+
+void TestVoxelManipulator::testBlitBackChanges(IGameDef *gamedef)
+{
+	DummyMap map(gamedef, {0,0,0}, {1,0,0});
+	map.fill({0,0,0}, {1,0,0}, CONTENT_AIR);
+
+	MMVManip vm(&map);
+	vm.initialEmerge({0,0,0}, {1,0,0});
+	vm.setNodeNoEmerge({1,2,3}, t_CONTENT_STONE);
+	vm.setNodeNoEmerge({4,5,6}, MapNode(CONTENT_AIR, 0, 1));
+	// only the light changes
+	vm.setNodeNoEmerge({7,8,9}, MapNode(CONTENT_AIR, 0xff, 0));
+	// too many changes
+	for (s16 x = MAP_BLOCKSIZE; x < 2 * MAP_BLOCKSIZE; x++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		vm.setNodeNoEmerge({x,y,z}, t_CONTENT_STONE);
+
+	std::map<v3s16, MapBlock*> modified;
+	std::unordered_map<v3s16, BlockNodeChanges> changes;
+	vm.blitBackAll(&modified, true, &changes);
+	UASSERTEQ(size_t, modified.size(), 2);
+	UASSERTEQ(size_t, changes.size(), 2);
+
+	const auto &c = changes[v3s16(0,0,0)];
+	UASSERT(!c.all);
+	UASSERTEQ(size_t, c.nodes.size(), 2);
+	UASSERTEQ(auto, BlockNodeChanges::getRelPos(c.nodes[0].index), v3s16(1,2,3));
+	UASSERTEQ(auto, BlockNodeChanges::getRelPos(c.nodes[1].index), v3s16(4,5,6));
+	const auto &c2 = changes[v3s16(1,0,0)];
+	UASSERT(c2.all);
+	UASSERT(c2.nodes.empty());
+}
+
+void TestVoxelManipulator::testBlitBackUnchanged(IGameDef *gamedef)
+{
+	DummyMap map(gamedef, {0,0,0}, {2,0,0});
+	map.fill({0,0,0}, {2,0,0}, CONTENT_AIR);
+	for (s16 x = 0; x <= 2; x++)
+		map.getBlockNoCreate({x,0,0})->resetModified();
+
+	MMVManip vm(&map);
+	vm.initialEmerge({0,0,0}, {2,0,0});
+	vm.setNodeNoEmerge({MAP_BLOCKSIZE + 1,2,3}, t_CONTENT_STONE);
+	// setting a node to what it already is isn't a change
+	vm.setNodeNoEmerge({2 * MAP_BLOCKSIZE,0,0}, CONTENT_AIR);
+
+	std::map<v3s16, MapBlock*> modified;
+	vm.blitBackAll(&modified);
+	UASSERTEQ(size_t, modified.size(), 1);
+	UASSERTEQ(auto, modified.begin()->first, v3s16(1,0,0));
+	UASSERT(map.getBlockNoCreate({0,0,0})->getModified() == MOD_STATE_CLEAN);
+	UASSERT(map.getBlockNoCreate({1,0,0})->getModified() != MOD_STATE_CLEAN);
+	UASSERTEQ(auto, map.getNode({MAP_BLOCKSIZE + 1,2,3}).getContent(), t_CONTENT_STONE);
+}
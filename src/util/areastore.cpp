@@ -5,6 +5,7 @@
 #include "util/areastore.h"
 #include "util/serialize.h"
 #include "util/container.h"
+#include <algorithm>
 
 #if USE_SPATIAL
 	#include <spatialindex/SpatialIndex.h>
@@ -35,7 +36,7 @@ AreaStore *AreaStore::getOptimalImplementation()
 #if USE_SPATIAL
 	return new SpatialAreaStore();
 #else
-	return new VectorAreaStore();
+	return new TreeAreaStore();
 #endif
 }
 
@@ -168,6 +169,14 @@ void AreaStore::getAreasForPos(std::vector<Area *> *result, v3s16 pos)
 	}
 }
 
+void AreaStore::getAreasForPositions(std::vector<std::vector<Area *>> *result,
+		const std::vector<v3s16> &positions)
+{
+	result->resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+		getAreasForPos(&(*result)[i], positions[i]);
+}
+
 
 ////
 // VectorAreaStore
@@ -226,6 +235,166 @@ void VectorAreaStore::getAreasInArea(std::vector<Area *> *result,
 	}
 }
 
+////
+// TreeAreaStore
+////
+
+// Areas per leaf of the tree
+static constexpr u32 TREE_LEAF_SIZE = 8;
+
+bool TreeAreaStore::insertArea(Area *a)
+{
+	if (a->id == U32_MAX)
+		a->id = getNextId();
+	std::pair<AreaMap::iterator, bool> res =
+			areas_map.insert(std::make_pair(a->id, *a));
+	if (!res.second)
+		// ID is not unique
+		return false;
+	m_area_index[a->id] = m_areas.size();
+	m_areas.push_back(&res.first->second);
+	invalidateCache();
+	return true;
+}
+
+bool TreeAreaStore::removeArea(u32 id)
+{
+	AreaMap::iterator it = areas_map.find(id);
+	if (it == areas_map.end())
+		return false;
+	auto index_it = m_area_index.find(id);
+	assert(index_it != m_area_index.end());
+	m_areas[index_it->second] = nullptr;
+	m_removed++;
+	m_area_index.erase(index_it);
+	areas_map.erase(it);
+	invalidateCache();
+	return true;
+}
+
+void TreeAreaStore::rebuildIfNeeded()
+{
+	// Amortize the rebuild over many insertions and removals
+	const size_t unindexed = m_areas.size() - m_indexed + m_removed;
+	if (unindexed <= 4 * TREE_LEAF_SIZE || unindexed * 8 <= m_areas.size())
+		return;
+
+	m_areas.erase(std::remove(m_areas.begin(), m_areas.end(), nullptr),
+			m_areas.end());
+	m_removed = 0;
+	m_indexed = m_areas.size();
+
+	m_nodes.clear();
+	m_nodes.reserve(2 * m_indexed / TREE_LEAF_SIZE + 1);
+	if (m_indexed > 0)
+		buildNode(0, m_indexed);
+
+	m_area_index.clear();
+	for (size_t i = 0; i < m_areas.size(); i++)
+		m_area_index[m_areas[i]->id] = i;
+}
+
+u32 TreeAreaStore::buildNode(u32 first, u32 count)
+{
+	const u32 index = m_nodes.size();
+	m_nodes.emplace_back();
+
+	Node node;
+	node.minedge = m_areas[first]->minedge;
+	node.maxedge = m_areas[first]->maxedge;
+	// Bounds of the area centers, doubled to stay integer
+	v3s32 center_min(S32_MAX, S32_MAX, S32_MAX), center_max(S32_MIN, S32_MIN, S32_MIN);
+	for (u32 i = first; i < first + count; i++) {
+		const Area *a = m_areas[i];
+		for (u32 d = 0; d < 3; d++) {
+			node.minedge[d] = std::min(node.minedge[d], a->minedge[d]);
+			node.maxedge[d] = std::max(node.maxedge[d], a->maxedge[d]);
+			s32 center = (s32)a->minedge[d] + a->maxedge[d];
+			center_min[d] = std::min(center_min[d], center);
+			center_max[d] = std::max(center_max[d], center);
+		}
+	}
+
+	if (count <= TREE_LEAF_SIZE) {
+		node.first = first;
+		node.count = count;
+		m_nodes[index] = node;
+		return index;
+	}
+
+	// Split at the median along the axis where the centers spread most
+	u32 axis = 0;
+	for (u32 d = 1; d < 3; d++) {
+		if (center_max[d] - center_min[d] > center_max[axis] - center_min[axis])
+			axis = d;
+	}
+	const u32 half = count / 2;
+	auto begin = m_areas.begin() + first;
+	std::nth_element(begin, begin + half, begin + count,
+		[axis] (const Area *a, const Area *b) {
+			return (s32)a->minedge[axis] + a->maxedge[axis] <
+				(s32)b->minedge[axis] + b->maxedge[axis];
+		});
+
+	buildNode(first, half); // left child, at index + 1
+	node.first = buildNode(first + half, count - half);
+	node.count = 0;
+	m_nodes[index] = node;
+	return index;
+}
+
+template <typename F>
+void TreeAreaStore::query(v3s16 minedge, v3s16 maxedge, const F &visit)
+{
+	rebuildIfNeeded();
+
+	if (!m_nodes.empty()) {
+		// The median split keeps the depth at log2 of the area count
+		u32 stack[64];
+		u32 depth = 0;
+		stack[depth++] = 0;
+		while (depth > 0) {
+			const u32 index = stack[--depth];
+			const Node &node = m_nodes[index];
+			if (!AST_AREAS_OVERLAP(minedge, maxedge, &node))
+				continue;
+			if (node.count > 0) {
+				for (u32 i = node.first; i < node.first + node.count; i++) {
+					if (m_areas[i])
+						visit(m_areas[i]);
+				}
+				continue;
+			}
+			stack[depth++] = node.first;
+			stack[depth++] = index + 1;
+		}
+	}
+
+	for (size_t i = m_indexed; i < m_areas.size(); i++) {
+		if (m_areas[i])
+			visit(m_areas[i]);
+	}
+}
+
+void TreeAreaStore::getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos)
+{
+	query(pos, pos, [&] (Area *area) {
+		if (AST_CONTAINS_PT(area, pos))
+			result->push_back(area);
+	});
+}
+
+void TreeAreaStore::getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap)
+{
+	query(minedge, maxedge, [&] (Area *area) {
+		if (accept_overlap ? AST_AREAS_OVERLAP(minedge, maxedge, area) :
+				AST_CONTAINS_AREA(minedge, maxedge, area)) {
+			result->push_back(area);
+		}
+	});
+}
+
 #if USE_SPATIAL
 
 static inline SpatialIndex::Region get_spatial_region(const v3s16 minedge,
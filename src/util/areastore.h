@@ -8,6 +8,7 @@
 #include "noise.h" // for PcgRandom
 #include <map>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include <istream>
 #include "util/container.h"
@@ -62,6 +63,11 @@ class AreaStore {
 	/// Stores output in passed vector.
 	void getAreasForPos(std::vector<Area *> *result, v3s16 pos);
 
+	/// Same as getAreasForPos for many positions at once.
+	/// (*result)[i] receives the areas that contain positions[i].
+	void getAreasForPositions(std::vector<std::vector<Area *>> *result,
+		const std::vector<v3s16> &positions);
+
 	/// Finds areas that are completely contained inside the area defined
 	/// by the passed edges.  If @p accept_overlap is true this finds any
 	/// areas that intersect with the passed area at any point.
@@ -129,6 +135,46 @@ class VectorAreaStore : public AreaStore {
 };
 
 
+/// Built-in bounding volume hierarchy over the areas.
+/// Insertions go to an unindexed tail and removals leave holes, both are
+/// merged into a rebuilt tree once they make up a good part of the store.
+/// Loading many areas at once therefore builds the tree only once.
+class TreeAreaStore : public AreaStore {
+public:
+	virtual void reserve(size_t count) { m_areas.reserve(count); }
+	virtual bool insertArea(Area *a);
+	virtual bool removeArea(u32 id);
+	virtual void getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap);
+
+protected:
+	virtual void getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos);
+
+private:
+	struct Node {
+		// Bounds of all areas below this node
+		v3s16 minedge, maxedge;
+		// Leaf: range of m_areas. Inner node (count == 0): the left child
+		// follows this node, first is the index of the right child.
+		u32 first, count;
+	};
+
+	void rebuildIfNeeded();
+	u32 buildNode(u32 first, u32 count);
+	template <typename F>
+	void query(v3s16 minedge, v3s16 maxedge, const F &visit);
+
+	// Areas [0, m_indexed) are in the tree, the rest is scanned linearly.
+	// Removed areas are nullptr until the next rebuild.
+	std::vector<Area *> m_areas;
+	size_t m_indexed = 0;
+	size_t m_removed = 0;
+	std::vector<Node> m_nodes;
+	// Area ID -> index in m_areas
+	std::unordered_map<u32, size_t> m_area_index;
+};
+
+
 #if USE_SPATIAL
 
 class SpatialAreaStore : public AreaStore {
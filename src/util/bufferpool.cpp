@@ -0,0 +1,223 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#include "util/bufferpool.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace bufferpool
+{
+
+namespace {
+
+// Size classes are 2^MIN_CLASS_SHIFT ... MAX_POOLED_SIZE
+constexpr u32 MIN_CLASS_SHIFT = 4;
+constexpr u32 CLASS_COUNT = 13;
+static_assert((size_t)1 << (MIN_CLASS_SHIFT + CLASS_COUNT - 1) == MAX_POOLED_SIZE);
+
+// Free blocks a thread keeps per class
+constexpr size_t LOCAL_CACHE_BYTES = 1024 * 1024;
+constexpr size_t LOCAL_CACHE_MAX = 128;
+// Free blocks in the shared pool, relative to the local limit
+constexpr size_t SHARED_FACTOR = 4;
+// Thread-local counts are published after this many operations
+constexpr u32 STATS_FLUSH_INTERVAL = 64;
+
+inline u32 class_index(size_t size)
+{
+	u32 index = 0;
+	size_t class_size = (size_t)1 << MIN_CLASS_SHIFT;
+	while (class_size < size) {
+		class_size <<= 1;
+		index++;
+	}
+	return index;
+}
+
+inline size_t class_size(u32 index)
+{
+	return (size_t)1 << (MIN_CLASS_SHIFT + index);
+}
+
+inline size_t local_limit(u32 index)
+{
+	size_t limit = LOCAL_CACHE_BYTES / class_size(index);
+	return limit < LOCAL_CACHE_MAX ? limit : LOCAL_CACHE_MAX;
+}
+
+struct SharedPool
+{
+	std::mutex mutex;
+	std::vector<void *> free[CLASS_COUNT];
+
+	std::atomic<u64> heap_allocations{0};
+	std::atomic<u64> reused{0};
+	std::atomic<u64> heap_bytes{0};
+};
+
+SharedPool &shared_pool()
+{
+	// Never destroyed: threads may still return blocks during shutdown
+	static SharedPool *pool = new SharedPool();
+	return *pool;
+}
+
+void *heap_allocate(size_t size)
+{
+	void *ptr = ::operator new(size);
+	shared_pool().heap_bytes.fetch_add(size, std::memory_order_relaxed);
+	return ptr;
+}
+
+void heap_release(void *ptr, size_t size) noexcept
+{
+	::operator delete(ptr);
+	shared_pool().heap_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+struct LocalCache
+{
+	std::vector<void *> free[CLASS_COUNT];
+	u64 heap_allocations = 0;
+	u64 reused = 0;
+	u32 ops = 0;
+
+	LocalCache()
+	{
+		for (u32 i = 0; i < CLASS_COUNT; i++)
+			free[i].reserve(local_limit(i));
+	}
+	~LocalCache();
+
+	void countOp()
+	{
+		if (++ops >= STATS_FLUSH_INTERVAL)
+			flushStats();
+	}
+
+	void flushStats()
+	{
+		SharedPool &pool = shared_pool();
+		pool.heap_allocations.fetch_add(heap_allocations, std::memory_order_relaxed);
+		pool.reused.fetch_add(reused, std::memory_order_relaxed);
+		heap_allocations = reused = 0;
+		ops = 0;
+	}
+};
+
+thread_local LocalCache t_cache;
+// Set when t_cache is gone, blocks may still be freed after that
+thread_local bool t_cache_destroyed = false;
+
+// Moves up to `count` blocks of a class as long as `to` holds less than
+// `to_limit`. Call with the shared pool locked.
+void move_blocks(std::vector<void *> &from, std::vector<void *> &to,
+	size_t count, size_t to_limit)
+{
+	while (count > 0 && !from.empty() && to.size() < to_limit) {
+		to.push_back(from.back());
+		from.pop_back();
+		count--;
+	}
+}
+
+LocalCache::~LocalCache()
+{
+	SharedPool &pool = shared_pool();
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		for (u32 i = 0; i < CLASS_COUNT; i++)
+			move_blocks(free[i], pool.free[i], free[i].size(),
+				local_limit(i) * SHARED_FACTOR);
+	}
+	for (u32 i = 0; i < CLASS_COUNT; i++) {
+		for (void *ptr : free[i])
+			heap_release(ptr, class_size(i));
+		free[i].clear();
+	}
+	flushStats();
+	t_cache_destroyed = true;
+}
+
+}
+
+void *allocate(size_t size)
+{
+	if (size > MAX_POOLED_SIZE) {
+		if (!t_cache_destroyed) {
+			t_cache.heap_allocations++;
+			t_cache.countOp();
+		}
+		return heap_allocate(size);
+	}
+
+	const u32 index = class_index(size);
+	if (!t_cache_destroyed) {
+		LocalCache &cache = t_cache;
+		auto &blocks = cache.free[index];
+		if (blocks.empty()) {
+			// Refill half of the local cache at once
+			SharedPool &pool = shared_pool();
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			move_blocks(pool.free[index], blocks, local_limit(index) / 2, SIZE_MAX);
+		}
+		cache.countOp();
+		if (!blocks.empty()) {
+			void *ptr = blocks.back();
+			blocks.pop_back();
+			cache.reused++;
+			return ptr;
+		}
+		cache.heap_allocations++;
+	}
+	return heap_allocate(class_size(index));
+}
+
+void release(void *ptr, size_t size) noexcept
+{
+	if (!ptr)
+		return;
+	if (size > MAX_POOLED_SIZE) {
+		heap_release(ptr, size);
+		return;
+	}
+
+	const u32 index = class_index(size);
+	if (t_cache_destroyed) {
+		heap_release(ptr, class_size(index));
+		return;
+	}
+
+	auto &blocks = t_cache.free[index];
+	const size_t limit = local_limit(index);
+	if (blocks.size() >= limit) {
+		// Hand half of the cache over to the other threads
+		SharedPool &pool = shared_pool();
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		move_blocks(blocks, pool.free[index], blocks.size() - limit / 2,
+			limit * SHARED_FACTOR);
+		while (blocks.size() > limit / 2) {
+			heap_release(blocks.back(), class_size(index));
+			blocks.pop_back();
+		}
+	}
+	blocks.push_back(ptr);
+}
+
+Stats getStats()
+{
+	if (!t_cache_destroyed)
+		t_cache.flushStats();
+	SharedPool &pool = shared_pool();
+	Stats stats;
+	stats.heap_allocations = pool.heap_allocations.load(std::memory_order_relaxed);
+	stats.reused = pool.reused.load(std::memory_order_relaxed);
+	stats.heap_bytes = pool.heap_bytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+}
@@ -0,0 +1,69 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <cstddef>
+#include "irrlichttypes.h"
+
+/*
+	Recycles short-lived byte buffers, like the ones of network packets.
+
+	Requests are rounded up to power-of-two size classes. Each thread keeps
+	a small cache of free blocks per class, overflow goes into a shared pool
+	so that buffers allocated by one thread and freed by another (e.g. the
+	server thread and the connection send thread) get reused too.
+	Requests larger than the biggest class go straight to the heap.
+
+	Memory is malloc-aligned, contents are uninitialized.
+*/
+namespace bufferpool
+{
+
+// Largest size served from the pool
+constexpr size_t MAX_POOLED_SIZE = 64 * 1024;
+
+struct Stats {
+	// blocks that had to be taken from the heap
+	u64 heap_allocations = 0;
+	// blocks that were recycled
+	u64 reused = 0;
+	// memory currently taken from the heap, in use or cached
+	u64 heap_bytes = 0;
+};
+
+void *allocate(size_t size);
+// size must be the one passed to allocate()
+void release(void *ptr, size_t size) noexcept;
+
+// Totals since start. Counts are collected per thread and published in
+// batches, so they can lag behind slightly. heap_bytes is always current.
+Stats getStats();
+
+// For standard containers
+template <typename T>
+struct Allocator
+{
+	using value_type = T;
+
+	Allocator() noexcept = default;
+	template <typename U>
+	Allocator(const Allocator<U> &) noexcept {}
+
+	T *allocate(size_t n)
+	{
+		return static_cast<T *>(bufferpool::allocate(n * sizeof(T)));
+	}
+	void deallocate(T *ptr, size_t n) noexcept
+	{
+		bufferpool::release(ptr, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const Allocator<U> &) const noexcept { return true; }
+	template <typename U>
+	bool operator!=(const Allocator<U> &) const noexcept { return false; }
+};
+
+}
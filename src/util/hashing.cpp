@@ -34,6 +34,13 @@ std::string sha1(std::string_view data)
 #endif
 }
 
+void sha1UseCPUExtensions(bool enable)
+{
+#if !USE_OPENSSL
+	SHA1::useCPUExtensions(enable);
+#endif
+}
+
 std::string sha256(std::string_view data)
 {
 	std::string digest(SHA256_DIGEST_SIZE, '\000');
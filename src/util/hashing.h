@@ -18,4 +18,8 @@ constexpr size_t SHA256_DIGEST_SIZE = 32;
 std::string sha1(std::string_view data);
 std::string sha256(std::string_view data);
 
+// For testing: whether the own SHA-1 implementation uses the SHA instructions
+// of the CPU if it has them. The default is true.
+void sha1UseCPUExtensions(bool enable);
+
 }
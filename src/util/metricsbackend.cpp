@@ -3,12 +3,14 @@
 // Copyright (C) 2013-2020 Minetest core developers team
 
 #include "metricsbackend.h"
+#include <algorithm>
 #include "util/thread.h"
 #if USE_PROMETHEUS
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
 #include <prometheus/counter.h>
 #include <prometheus/gauge.h>
+#include <prometheus/histogram.h>
 #include "log.h"
 #include "settings.h"
 #include "exceptions.h"
@@ -72,6 +74,43 @@ class SimpleMetricGauge : public MetricGauge
 	double m_gauge;
 };
 
+class SimpleMetricHistogram : public MetricHistogram
+{
+public:
+	SimpleMetricHistogram(const std::vector<double> &buckets) :
+		MetricHistogram(), m_bounds(buckets), m_buckets(buckets.size() + 1, 0)
+	{}
+
+	virtual ~SimpleMetricHistogram() {}
+
+	void observe(double value) override
+	{
+		size_t i = std::lower_bound(m_bounds.begin(), m_bounds.end(), value) -
+			m_bounds.begin();
+		MutexAutoLock lock(m_mutex);
+		m_buckets[i]++;
+		m_count++;
+		m_sum += value;
+	}
+	u64 getCount() const override
+	{
+		MutexAutoLock lock(m_mutex);
+		return m_count;
+	}
+	double getSum() const override
+	{
+		MutexAutoLock lock(m_mutex);
+		return m_sum;
+	}
+
+private:
+	mutable std::mutex m_mutex;
+	const std::vector<double> m_bounds;
+	std::vector<u64> m_buckets;
+	u64 m_count = 0;
+	double m_sum = 0.0;
+};
+
 MetricCounterPtr MetricsBackend::addCounter(
 		const std::string &name, const std::string &help_str, Labels labels)
 {
@@ -84,6 +123,13 @@ MetricGaugePtr MetricsBackend::addGauge(
 	return std::make_shared<SimpleMetricGauge>();
 }
 
+MetricHistogramPtr MetricsBackend::addHistogram(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &buckets, Labels labels)
+{
+	return std::make_shared<SimpleMetricHistogram>(buckets);
+}
+
 /* Prometheus backend */
 
 #if USE_PROMETHEUS
@@ -132,7 +178,10 @@ class PrometheusMetricGauge : public MetricGauge
 	{
 	}
 
-	virtual ~PrometheusMetricGauge() {}
+	// Removes the labelled gauge again so that short-lived ones (e.g. per
+	// peer) don't pile up. Gauges are never registered twice with the same
+	// labels.
+	virtual ~PrometheusMetricGauge() { m_family.Remove(&m_gauge); }
 
 	virtual void increment(double number) { m_gauge.Increment(number); }
 	virtual void decrement(double number) { m_gauge.Decrement(number); }
@@ -144,6 +193,52 @@ class PrometheusMetricGauge : public MetricGauge
 	prometheus::Gauge &m_gauge;
 };
 
+class PrometheusMetricHistogram : public MetricHistogram
+{
+public:
+	PrometheusMetricHistogram() = delete;
+
+	PrometheusMetricHistogram(const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, MetricsBackend::Labels labels,
+			std::shared_ptr<prometheus::Registry> registry) :
+			MetricHistogram(),
+			m_family(prometheus::BuildHistogram()
+							.Name(name)
+							.Help(help_str)
+							.Register(*registry)),
+			m_histogram(m_family.Add(labels, buckets))
+	{
+	}
+
+	virtual ~PrometheusMetricHistogram() { m_family.Remove(&m_histogram); }
+
+	virtual void observe(double value)
+	{
+		m_histogram.Observe(value);
+		MutexAutoLock lock(m_mutex);
+		m_count++;
+		m_sum += value;
+	}
+	virtual u64 getCount() const
+	{
+		MutexAutoLock lock(m_mutex);
+		return m_count;
+	}
+	virtual double getSum() const
+	{
+		MutexAutoLock lock(m_mutex);
+		return m_sum;
+	}
+
+private:
+	prometheus::Family<prometheus::Histogram> &m_family;
+	prometheus::Histogram &m_histogram;
+	// prometheus::Histogram has no getters for these
+	mutable std::mutex m_mutex;
+	u64 m_count = 0;
+	double m_sum = 0.0;
+};
+
 class PrometheusMetricsBackend : public MetricsBackend
 {
 public:
@@ -162,6 +257,9 @@ class PrometheusMetricsBackend : public MetricsBackend
 	MetricGaugePtr addGauge(
 			const std::string &name, const std::string &help_str,
 			Labels labels = {}) override;
+	MetricHistogramPtr addHistogram(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, Labels labels = {}) override;
 
 private:
 	std::unique_ptr<prometheus::Exposer> m_exposer;
@@ -180,6 +278,14 @@ MetricGaugePtr PrometheusMetricsBackend::addGauge(
 	return std::make_shared<PrometheusMetricGauge>(name, help_str, labels, m_registry);
 }
 
+MetricHistogramPtr PrometheusMetricsBackend::addHistogram(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &buckets, Labels labels)
+{
+	return std::make_shared<PrometheusMetricHistogram>(name, help_str, buckets,
+		labels, m_registry);
+}
+
 MetricsBackend *createPrometheusMetricsBackend()
 {
 	std::string addr;
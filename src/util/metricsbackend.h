@@ -6,7 +6,9 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include "config.h"
+#include "irrlichttypes.h"
 
 class MetricCounter
 {
@@ -35,6 +37,19 @@ class MetricGauge
 
 typedef std::shared_ptr<MetricGauge> MetricGaugePtr;
 
+class MetricHistogram
+{
+public:
+	MetricHistogram() = default;
+	virtual ~MetricHistogram() {}
+
+	virtual void observe(double value) = 0;
+	virtual u64 getCount() const = 0;
+	virtual double getSum() const = 0;
+};
+
+typedef std::shared_ptr<MetricHistogram> MetricHistogramPtr;
+
 class MetricsBackend
 {
 public:
@@ -50,6 +65,10 @@ class MetricsBackend
 	virtual MetricGaugePtr addGauge(
 			const std::string &name, const std::string &help_str,
 			Labels labels = {});
+	// buckets: sorted upper bounds, the +Inf bucket is implicit
+	virtual MetricHistogramPtr addHistogram(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, Labels labels = {});
 };
 
 #if USE_PROMETHEUS
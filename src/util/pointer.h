@@ -6,9 +6,40 @@
 
 #include "irrlichttypes.h"
 #include "util/basic_macros.h"
+#include "util/bufferpool.h"
 #include <cassert>
 #include <cstring>
+#include <new>
 #include <string_view>
+#include <type_traits>
+
+namespace detail
+{
+
+// Arrays of plain types are served from the buffer pool
+template <typename T>
+constexpr bool is_pooled = std::is_trivially_copyable_v<T> &&
+	std::is_trivially_default_constructible_v<T>;
+
+template <typename T>
+T *allocate_array(size_t size)
+{
+	if constexpr (is_pooled<T>)
+		return static_cast<T *>(bufferpool::allocate(sizeof(T) * size));
+	else
+		return new T[size];
+}
+
+template <typename T>
+void free_array(T *data, size_t size)
+{
+	if constexpr (is_pooled<T>)
+		bufferpool::release(data, sizeof(T) * size);
+	else
+		delete[] data;
+}
+
+}
 
 template <typename T>
 class Buffer
@@ -23,7 +54,7 @@ class Buffer
 	{
 		m_size = size;
 		if (size != 0) {
-			data = new T[size];
+			data = detail::allocate_array<T>(size);
 		} else {
 			data = nullptr;
 		}
@@ -49,7 +80,7 @@ class Buffer
 	{
 		m_size = size;
 		if (size != 0) {
-			data = new T[size];
+			data = detail::allocate_array<T>(size);
 			memcpy(data, t, sizeof(T) * size);
 		} else {
 			data = nullptr;
@@ -82,7 +113,7 @@ class Buffer
 		buffer.drop();
 		buffer.m_size = m_size;
 		if (m_size != 0) {
-			buffer.data = new T[m_size];
+			buffer.data = detail::allocate_array<T>(m_size);
 			memcpy(buffer.data, data, sizeof(T) * m_size);
 		} else {
 			buffer.data = nullptr;
@@ -114,7 +145,7 @@ class Buffer
 private:
 	void drop()
 	{
-		delete[] data;
+		detail::free_array(data, m_size);
 	}
 	T *data;
 	size_t m_size;
@@ -135,22 +166,20 @@ class SharedBuffer
 	{
 		m_size = 0;
 		data = nullptr;
-		refcount = new u32;
-		(*refcount) = 1;
+		refcount = newRefcount();
 	}
 
 	SharedBuffer(size_t size)
 	{
 		m_size = size;
 		if (m_size != 0) {
-			data = new T[m_size];
+			data = detail::allocate_array<T>(m_size);
 		} else {
 			data = nullptr;
 		}
 
-		refcount = new u32;
+		refcount = newRefcount();
 		memset(data, 0, sizeof(T) * m_size);
-		(*refcount) = 1;
 	}
 
 	SharedBuffer(const SharedBuffer &buffer)
@@ -178,13 +207,12 @@ class SharedBuffer
 	{
 		m_size = size;
 		if (m_size != 0) {
-			data = new T[m_size];
+			data = detail::allocate_array<T>(m_size);
 			memcpy(data, t, sizeof(T) * m_size);
 		} else {
 			data = nullptr;
 		}
-		refcount = new u32;
-		(*refcount) = 1;
+		refcount = newRefcount();
 	}
 
 	//! Copies whole buffer
@@ -219,13 +247,18 @@ class SharedBuffer
 	}
 
 private:
+	static u32 *newRefcount()
+	{
+		return new (bufferpool::allocate(sizeof(u32))) u32(1);
+	}
+
 	void drop()
 	{
 		assert((*refcount) > 0);
 		(*refcount)--;
 		if (*refcount == 0) {
-			delete[] data;
-			delete refcount;
+			detail::free_array(data, m_size);
+			bufferpool::release(refcount, sizeof(u32));
 		}
 	}
 
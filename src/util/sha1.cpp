@@ -33,6 +33,19 @@ SOFTWARE.
 
 #include "sha1.h"
 
+// SHA-NI needs a runtime check, the functions using it are compiled for it
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+	#include <cpuid.h>
+	#include <immintrin.h>
+	#define SHA1_X86_SHANI 1
+	#define SHANI_TARGET __attribute__((target("sha,sse4.1")))
+#elif defined(_M_X64)
+	#include <intrin.h>
+	#include <immintrin.h>
+	#define SHA1_X86_SHANI 1
+	#define SHANI_TARGET
+#endif
+
 namespace {
 
 // circular left bit rotation.  MSB wraps around to LSB
@@ -50,8 +63,97 @@ inline void storeBigEndianUint32( unsigned char* byte, Uint32 num )
 	byte[3] = (unsigned char)num;
 }
 
+#if SHA1_X86_SHANI
+
+bool cpuHasShaNi()
+{
+	unsigned int regs[4] = {};
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	regs[2] = info[2];
+	__cpuidex(info, 7, 0);
+	regs[1] = info[1];
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	regs[2] = ecx;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+	regs[1] = ebx;
+#endif
+	const bool ssse3 = regs[2] & (1 << 9), sse41 = regs[2] & (1 << 19);
+	const bool sha = regs[1] & (1 << 29);
+	return ssse3 && sse41 && sha;
+}
+
+// Four rounds with function F, the message words are expanded when needed
+template <int F>
+SHANI_TARGET inline void shaNiRounds(int i, __m128i &abcd, __m128i &e, __m128i &prev,
+	__m128i msg[4])
+{
+	if (i >= 4) {
+		msg[i & 3] = _mm_sha1msg2_epu32(_mm_xor_si128(
+			_mm_sha1msg1_epu32(msg[i & 3], msg[(i + 1) & 3]), msg[(i + 2) & 3]),
+			msg[(i + 3) & 3]);
+	}
+	if (i > 0)
+		e = _mm_sha1nexte_epu32(prev, msg[i & 3]);
+	prev = abcd;
+	abcd = _mm_sha1rnds4_epu32(abcd, e, F);
+}
+
+SHANI_TARGET void processBlocksShaNi(Uint32 state[5], const unsigned char *data,
+	size_t count)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd = _mm_shuffle_epi32(
+		_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1b);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (; count > 0; count--, data += 64) {
+		const __m128i abcd_save = abcd, e0_save = e0;
+		__m128i msg[4];
+		for (int i = 0; i < 4; i++) {
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+				reinterpret_cast<const __m128i *>(data + 16 * i)), mask);
+		}
+
+		__m128i e = _mm_add_epi32(e0, msg[0]), prev;
+		int i = 0;
+		for (; i < 5; i++)
+			shaNiRounds<0>(i, abcd, e, prev, msg);
+		for (; i < 10; i++)
+			shaNiRounds<1>(i, abcd, e, prev, msg);
+		for (; i < 15; i++)
+			shaNiRounds<2>(i, abcd, e, prev, msg);
+		for (; i < 20; i++)
+			shaNiRounds<3>(i, abcd, e, prev, msg);
+
+		e0 = _mm_sha1nexte_epu32(prev, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+const bool cpu_has_sha_ni = cpuHasShaNi();
+
+#endif
+
+bool use_cpu_extensions = true;
+
 }
 
+void SHA1::useCPUExtensions(bool enable)
+{
+	use_cpu_extensions = enable;
+}
 
 // Constructor *******************************************************
 SHA1::SHA1()
@@ -73,63 +175,88 @@ SHA1::~SHA1()
 void SHA1::process()
 {
 	assert( unprocessedBytes == 64 );
-	int t;
-	Uint32 a, b, c, d, e, K, f, W[80];
-	// starting values
-	a = H0;
-	b = H1;
-	c = H2;
-	d = H3;
-	e = H4;
-	// copy and expand the message block
-	for( t = 0; t < 16; t++ ) W[t] = (bytes[t*4] << 24)
-									+(bytes[t*4 + 1] << 16)
-									+(bytes[t*4 + 2] << 8)
-									+ bytes[t*4 + 3];
-	for(; t< 80; t++ ) W[t] = lrot( W[t-3]^W[t-8]^W[t-14]^W[t-16], 1 );
-
-	/* main loop */
-	Uint32 temp;
-	for( t = 0; t < 80; t++ )
-	{
-		if( t < 20 ) {
-			K = 0x5a827999;
-			f = (b & c) | ((~b) & d);
-		} else if( t < 40 ) {
-			K = 0x6ed9eba1;
-			f = b ^ c ^ d;
-		} else if( t < 60 ) {
-			K = 0x8f1bbcdc;
-			f = (b & c) | (b & d) | (c & d);
-		} else {
-			K = 0xca62c1d6;
-			f = b ^ c ^ d;
-		}
-		temp = lrot(a,5) + f + e + W[t] + K;
-		e = d;
-		d = c;
-		c = lrot(b,30);
-		b = a;
-		a = temp;
-		//printf( "t=%d %08x %08x %08x %08x %08x\n",t,a,b,c,d,e );
-	}
-	/* add variables */
-	H0 += a;
-	H1 += b;
-	H2 += c;
-	H3 += d;
-	H4 += e;
-	//printf( "Current: %08x %08x %08x %08x %08x\n",H0,H1,H2,H3,H4 );
+	processBlocks( bytes, 1 );
 	/* all bytes have been processed */
 	unprocessedBytes = 0;
 }
 
+void SHA1::processBlocks( const unsigned char* data, size_t count )
+{
+#if SHA1_X86_SHANI
+	if( cpu_has_sha_ni && use_cpu_extensions ) {
+		Uint32 state[5] = { H0, H1, H2, H3, H4 };
+		processBlocksShaNi( state, data, count );
+		H0 = state[0];
+		H1 = state[1];
+		H2 = state[2];
+		H3 = state[3];
+		H4 = state[4];
+		return;
+	}
+#endif
+	for( ; count > 0; count--, data += 64 ) {
+		int t;
+		Uint32 a, b, c, d, e, K, f, W[80];
+		// starting values
+		a = H0;
+		b = H1;
+		c = H2;
+		d = H3;
+		e = H4;
+		// copy and expand the message block
+		for( t = 0; t < 16; t++ ) W[t] = (data[t*4] << 24)
+										+(data[t*4 + 1] << 16)
+										+(data[t*4 + 2] << 8)
+										+ data[t*4 + 3];
+		for(; t< 80; t++ ) W[t] = lrot( W[t-3]^W[t-8]^W[t-14]^W[t-16], 1 );
+
+		/* main loop */
+		Uint32 temp;
+		for( t = 0; t < 80; t++ )
+		{
+			if( t < 20 ) {
+				K = 0x5a827999;
+				f = (b & c) | ((~b) & d);
+			} else if( t < 40 ) {
+				K = 0x6ed9eba1;
+				f = b ^ c ^ d;
+			} else if( t < 60 ) {
+				K = 0x8f1bbcdc;
+				f = (b & c) | (b & d) | (c & d);
+			} else {
+				K = 0xca62c1d6;
+				f = b ^ c ^ d;
+			}
+			temp = lrot(a,5) + f + e + W[t] + K;
+			e = d;
+			d = c;
+			c = lrot(b,30);
+			b = a;
+			a = temp;
+			//printf( "t=%d %08x %08x %08x %08x %08x\n",t,a,b,c,d,e );
+		}
+		/* add variables */
+		H0 += a;
+		H1 += b;
+		H2 += c;
+		H3 += d;
+		H4 += e;
+		//printf( "Current: %08x %08x %08x %08x %08x\n",H0,H1,H2,H3,H4 );
+	}
+}
+
 // addBytes **********************************************************
 void SHA1::addBytes( const char* data, Uint32 num )
 {
 	assert( data );
 	// add these bytes to the running total
 	size += num;
+	// whole blocks are processed without copying them
+	if( unprocessedBytes == 0 && num >= 64 ) {
+		processBlocks( reinterpret_cast<const unsigned char*>(data), num / 64 );
+		data += num / 64 * 64;
+		num %= 64;
+	}
 	// repeat until all data is processed
 	while( num > 0 )
 	{
@@ -49,8 +49,13 @@ class SHA1
 	Uint32 unprocessedBytes = 0;
 	Uint32 size = 0;
 	void process();
+	// Processes count 64-byte blocks
+	void processBlocks(const unsigned char *data, size_t count);
 
 public:
+	// Whether the SHA instructions of the CPU are used if it has them
+	static void useCPUExtensions(bool enable);
+
 	SHA1();
 	~SHA1();
 	void addBytes(const char *data, Uint32 num);
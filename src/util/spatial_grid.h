@@ -0,0 +1,195 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti contributors
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+Spatial index storing points in the cells of a uniform grid.
+
+It has the same interface as k_d_tree::DynamicKdTrees, but is made for
+points that move a lot: moving a point inside of its cell only overwrites
+its position, moving it to another cell removes it from the old cell by
+swapping it with the last point there and appends it to the new one.
+No rebuilds are ever needed.
+
+A range query looks up every cell it overlaps, so the cell size should be
+about the size of typical queries. If a query covers more cells than exist,
+all points are checked instead.
+*/
+template <uint8_t Dim, class Component, class Id>
+class SpatialHashGrid
+{
+public:
+	using Point = std::array<Component, Dim>;
+
+	explicit SpatialHashGrid(Component cell_size) : m_cell_size(cell_size)
+	{
+		assert(cell_size > 0);
+	}
+
+	void insert(const Point &point, Id id)
+	{
+		assert(m_locations.find(id) == m_locations.end());
+		const CellPos pos = getCellPos(point);
+		Cell &cell = m_cells[pos];
+		m_locations[id] = Location{pos, &cell, cell.size()};
+		cell.push_back(Entry{point, id});
+	}
+
+	void remove(Id id)
+	{
+		const auto it = m_locations.find(id);
+		assert(it != m_locations.end());
+		removeFromCell(it->second);
+		m_locations.erase(it);
+	}
+
+	void update(const Point &point, Id id)
+	{
+		const auto it = m_locations.find(id);
+		assert(it != m_locations.end());
+		Location &loc = it->second;
+		const CellPos pos = getCellPos(point);
+		if (pos == loc.pos) {
+			(*loc.cell)[loc.index].point = point;
+			return;
+		}
+		removeFromCell(loc);
+		Cell &cell = m_cells[pos];
+		loc = Location{pos, &cell, cell.size()};
+		cell.push_back(Entry{point, id});
+	}
+
+	template <typename F>
+	void rangeQuery(const Point &min, const Point &max, const F &cb) const
+	{
+		const CellPos cmin = getCellPos(min);
+		const CellPos cmax = getCellPos(max);
+		double cells = 1;
+		for (uint8_t d = 0; d < Dim; ++d) {
+			if (cmax[d] < cmin[d])
+				return;
+			cells *= (double)cmax[d] - cmin[d] + 1;
+		}
+
+		if (cells > m_cells.size()) {
+			for (const auto &it : m_cells)
+				queryCell(it.second, min, max, cb);
+			return;
+		}
+
+		CellPos pos = cmin;
+		while (true) {
+			const auto it = m_cells.find(pos);
+			if (it != m_cells.end())
+				queryCell(it->second, min, max, cb);
+			uint8_t d = 0;
+			for (; d < Dim; ++d) {
+				if (pos[d] < cmax[d]) {
+					++pos[d];
+					break;
+				}
+				pos[d] = cmin[d];
+			}
+			if (d == Dim)
+				break;
+		}
+	}
+
+	bool contains(Id id) const
+	{
+		return m_locations.find(id) != m_locations.end();
+	}
+
+	size_t size() const
+	{
+		return m_locations.size();
+	}
+
+	size_t cellCount() const
+	{
+		return m_cells.size();
+	}
+
+private:
+	using CellPos = std::array<int32_t, Dim>;
+
+	struct CellPosHash {
+		size_t operator()(const CellPos &pos) const
+		{
+			size_t hash = 0;
+			for (uint8_t d = 0; d < Dim; ++d)
+				hash = hash * 73856093 ^ (uint32_t)pos[d];
+			return hash;
+		}
+	};
+
+	struct Entry {
+		Point point;
+		Id id;
+	};
+
+	using Cell = std::vector<Entry>;
+
+	struct Location {
+		CellPos pos;
+		// elements of an unordered_map are never moved
+		Cell *cell;
+		size_t index;
+	};
+
+	CellPos getCellPos(const Point &point) const
+	{
+		// Keeps huge query ranges from overflowing
+		constexpr double limit = 1 << 30;
+		CellPos pos;
+		for (uint8_t d = 0; d < Dim; ++d) {
+			double c = std::floor((double)point[d] / m_cell_size);
+			c = c < -limit ? -limit : (c > limit ? limit : c);
+			pos[d] = (int32_t)c;
+		}
+		return pos;
+	}
+
+	void removeFromCell(const Location &loc)
+	{
+		Cell &cell = *loc.cell;
+		if (loc.index + 1 != cell.size()) {
+			cell[loc.index] = cell.back();
+			m_locations[cell[loc.index].id].index = loc.index;
+		}
+		cell.pop_back();
+		if (cell.empty())
+			m_cells.erase(loc.pos);
+	}
+
+	template <typename F>
+	static void queryCell(const Cell &cell, const Point &min, const Point &max,
+			const F &cb)
+	{
+		for (const Entry &entry : cell) {
+			bool inside = true;
+			for (uint8_t d = 0; d < Dim; ++d) {
+				if (entry.point[d] < min[d] || entry.point[d] > max[d]) {
+					inside = false;
+					break;
+				}
+			}
+			if (inside)
+				cb(entry.point, entry.id);
+		}
+	}
+
+	const Component m_cell_size;
+	std::unordered_map<CellPos, Cell, CellPosHash> m_cells;
+	std::unordered_map<Id, Location> m_locations;
+};
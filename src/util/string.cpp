@@ -870,9 +870,22 @@ static void translate_all(std::wstring_view s, size_t &i,
 // Translate string server side
 std::wstring translate_string(std::wstring_view s, Translations *translations)
 {
+	// Nothing to translate or strip
+	if (s.find(L'\x1b') == std::wstring_view::npos)
+		return std::wstring(s);
+
+	std::wstring key;
+	if (translations) {
+		key = s;
+		if (const std::wstring *cached = translations->getTranslatedString(key))
+			return *cached;
+	}
+
 	size_t i = 0;
 	std::wstring res;
 	translate_all(s, i, translations, res);
+	if (translations)
+		translations->cacheTranslatedString(key, res);
 	return res;
 }
 
@@ -65,6 +65,12 @@ class Translations;
 
 typedef std::unordered_map<std::string, std::string> StringMap;
 
+// Heap memory used by a string, zero while it fits into the inline buffer
+inline size_t string_heap_usage(const std::string &s)
+{
+	return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
 struct FlagDesc {
 	const char *name;
 	u32 flag;
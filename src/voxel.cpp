@@ -9,6 +9,7 @@
 #include "util/directiontables.h"
 #include "util/timetaker.h"
 #include "porting.h"
+#include <algorithm>
 #include <cstring>  // memcpy, memset
 
 /*
@@ -225,21 +226,46 @@ void VoxelManipulator::copyFrom(MapNode *src, const VoxelArea& src_area,
 	}
 }
 
-void VoxelManipulator::copyTo(MapNode *dst, const VoxelArea& dst_area,
+void VoxelManipulator::fill(const VoxelArea &area, MapNode n)
+{
+	if (area.hasEmptyExtent())
+		return;
+
+	assert(m_area.contains(area));
+
+	const s32 stride = area.getExtent().X;
+	for (s32 z = area.MinEdge.Z; z <= area.MaxEdge.Z; z++)
+	for (s32 y = area.MinEdge.Y; y <= area.MaxEdge.Y; y++) {
+		const s32 start = m_area.index(area.MinEdge.X, y, z);
+		std::fill(&m_data[start], &m_data[start + stride], n);
+		memset(&m_flags[start], 0, stride);
+	}
+}
+
+bool VoxelManipulator::copyTo(MapNode *dst, const VoxelArea& dst_area,
 		v3s16 dst_pos, v3s16 from_pos, const v3s16 &size) const
 {
-	for(s16 z=0; z<size.Z; z++)
-	for(s16 y=0; y<size.Y; y++)
-	{
-		s32 i_dst = dst_area.index(dst_pos.X, dst_pos.Y+y, dst_pos.Z+z);
-		s32 i_local = m_area.index(from_pos.X, from_pos.Y+y, from_pos.Z+z);
-		for (s16 x = 0; x < size.X; x++) {
-			if (m_data[i_local].getContent() != CONTENT_IGNORE)
-				dst[i_dst] = m_data[i_local];
-			i_dst++;
-			i_local++;
+	bool changed = false;
+	for (s16 z = 0; z < size.Z; z++)
+	for (s16 y = 0; y < size.Y; y++) {
+		MapNode *row_dst = &dst[dst_area.index(dst_pos.X, dst_pos.Y + y, dst_pos.Z + z)];
+		const MapNode *row_src = &m_data[m_area.index(from_pos.X, from_pos.Y + y, from_pos.Z + z)];
+		// Copy the runs of nodes between ignore nodes in one go
+		s16 x = 0;
+		while (x < size.X) {
+			while (x < size.X && row_src[x].getContent() == CONTENT_IGNORE)
+				x++;
+			const s16 start = x;
+			while (x < size.X && row_src[x].getContent() != CONTENT_IGNORE)
+				x++;
+			const size_t len = (x - start) * sizeof(MapNode);
+			if (len == 0 || (!changed && memcmp(&row_dst[start], &row_src[start], len) == 0))
+				continue;
+			memcpy(&row_dst[start], &row_src[start], len);
+			changed = true;
 		}
 	}
+	return changed;
 }
 
 /*
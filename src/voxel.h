@@ -485,8 +485,15 @@ class VoxelManipulator
 	void copyFrom(MapNode *src, const VoxelArea& src_area,
 			v3s16 from_pos, v3s16 to_pos, const v3s16 &size);
 
-	// Copy data
-	void copyTo(MapNode *dst, const VoxelArea& dst_area,
+	/*
+		Set the nodes of an area to n and their flags to 0, as if they were
+		copied with copyFrom()
+	*/
+	void fill(const VoxelArea &area, MapNode n);
+
+	// Copy data, except for ignore nodes
+	// Returns true if any node in dst was changed.
+	bool copyTo(MapNode *dst, const VoxelArea& dst_area,
 			v3s16 dst_pos, v3s16 from_pos, const v3s16 &size) const;
 
 	/*
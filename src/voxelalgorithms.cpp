@@ -229,6 +229,74 @@ bool step_rel_block_pos(direction dir, relative_v3 &rel_pos,
 	return false;
 }
 
+/*!
+ * Caches the map blocks touched by one light update.
+ * Light crosses block borders all the time, while the map only remembers
+ * the last block that was looked up. The entries are direct-mapped by the
+ * lowest two bits of each block coordinate, so any 4x4x4 group of blocks
+ * fits without collisions. Missing blocks are cached too.
+ */
+class LightBlockCache {
+public:
+	LightBlockCache(Map *map, std::map<v3s16, MapBlock*> &modified_blocks) :
+		m_map(map),
+		m_modified_blocks(modified_blocks)
+	{}
+
+	//! Returns the block or nullptr if it is not loaded.
+	MapBlock *get(mapblock_v3 pos)
+	{
+		return find(pos).block;
+	}
+
+	//! Like Map::getNode(), returns CONTENT_IGNORE for unloaded nodes.
+	MapNode getNode(v3s16 p, bool *is_valid_position)
+	{
+		mapblock_v3 block_pos;
+		relative_v3 rel_pos;
+		getNodeBlockPosWithOffset(p, block_pos, rel_pos);
+		MapBlock *block = get(block_pos);
+		*is_valid_position = block != nullptr;
+		if (!block)
+			return MapNode(CONTENT_IGNORE);
+		return block->getNodeNoCheck(rel_pos);
+	}
+
+	//! Adds the block to modified_blocks.
+	void setModified(mapblock_v3 pos, MapBlock *block)
+	{
+		Entry &e = find(pos);
+		if (!e.modified) {
+			m_modified_blocks[pos] = block;
+			e.modified = true;
+		}
+	}
+
+private:
+	struct Entry {
+		mapblock_v3 pos;
+		MapBlock *block = nullptr;
+		bool valid = false;
+		bool modified = false;
+	};
+
+	Entry &find(mapblock_v3 pos)
+	{
+		Entry &e = m_entries[(pos.X & 3) | (pos.Y & 3) << 2 | (pos.Z & 3) << 4];
+		if (!e.valid || e.pos != pos) {
+			e.pos = pos;
+			e.block = m_map->getBlockNoCreateNoEx(pos);
+			e.valid = true;
+			e.modified = false;
+		}
+		return e;
+	}
+
+	Map *m_map;
+	std::map<v3s16, MapBlock*> &m_modified_blocks;
+	std::array<Entry, 64> m_entries;
+};
+
 /*
  * Removes all light that is potentially emitted by the specified
  * light sources. These nodes will have zero light.
@@ -237,11 +305,10 @@ bool step_rel_block_pos(direction dir, relative_v3 &rel_pos,
  * \param bank the light bank in which the procedure operates
  * \param from_nodes nodes whose light is removed
  * \param light_sources nodes that should be re-lighted
- * \param modified_blocks output, all modified map blocks are added to this
+ * \param blocks block lookups, all modified map blocks are marked in it
  */
-void unspread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
-	UnlightQueue &from_nodes, ReLightQueue &light_sources,
-	std::map<v3s16, MapBlock*> &modified_blocks)
+void unspread_light(LightBlockCache &blocks, const NodeDefManager *nodemgr,
+	LightBank bank, UnlightQueue &from_nodes, ReLightQueue &light_sources)
 {
 	// Stores data popped from from_nodes
 	u8 current_light;
@@ -275,7 +342,7 @@ void unspread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
 			neighbor_block_pos = current.block_position;
 			MapBlock *neighbor_block;
 			if (step_rel_block_pos(i, neighbor_rel_pos, neighbor_block_pos)) {
-				neighbor_block = map->getBlockNoCreateNoEx(neighbor_block_pos);
+				neighbor_block = blocks.get(neighbor_block_pos);
 				if (neighbor_block == NULL) {
 					current.block->setLightingComplete(bank, i, false);
 					continue;
@@ -301,7 +368,7 @@ void unspread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
 					// The current node was modified earlier, so its block
 					// is in modified_blocks.
 					if (current.block != neighbor_block) {
-						modified_blocks[neighbor_block_pos] = neighbor_block;
+						blocks.setModified(neighbor_block_pos, neighbor_block);
 					}
 				}
 			} else {
@@ -337,11 +404,10 @@ void unspread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
  *
  * \param bank the light bank in which the procedure operates
  * \param light_sources starting nodes
- * \param modified_blocks output, all modified map blocks are added to this
+ * \param blocks block lookups, all modified map blocks are marked in it
  */
-void spread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
-	LightQueue &light_sources,
-	std::map<v3s16, MapBlock*> &modified_blocks)
+void spread_light(LightBlockCache &blocks, const NodeDefManager *nodemgr,
+	LightBank bank, LightQueue &light_sources)
 {
 	// The light the current node can provide to its neighbors.
 	u8 spreading_light;
@@ -362,7 +428,7 @@ void spread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
 			neighbor_block_pos = current.block_position;
 			MapBlock *neighbor_block;
 			if (step_rel_block_pos(i, neighbor_rel_pos, neighbor_block_pos)) {
-				neighbor_block = map->getBlockNoCreateNoEx(neighbor_block_pos);
+				neighbor_block = blocks.get(neighbor_block_pos);
 				if (neighbor_block == NULL) {
 					current.block->setLightingComplete(bank, i, false);
 					continue;
@@ -384,7 +450,7 @@ void spread_light(Map *map, const NodeDefManager *nodemgr, LightBank bank,
 					// The current node was modified earlier, so its block
 					// is in modified_blocks.
 					if (current.block != neighbor_block) {
-						modified_blocks[neighbor_block_pos] = neighbor_block;
+						blocks.setModified(neighbor_block_pos, neighbor_block);
 					}
 				}
 			}
@@ -413,7 +479,8 @@ struct SunlightPropagationData{
  *
  * \param pos position of the node.
  */
-bool is_sunlight_above(Map *map, v3s16 pos, const NodeDefManager *ndef)
+bool is_sunlight_above(LightBlockCache &blocks, v3s16 pos,
+	const NodeDefManager *ndef)
 {
 	bool sunlight = true;
 	mapblock_v3 source_block_pos;
@@ -421,10 +488,10 @@ bool is_sunlight_above(Map *map, v3s16 pos, const NodeDefManager *ndef)
 	getNodeBlockPosWithOffset(pos + v3s16(0, 1, 0), source_block_pos,
 		source_rel_pos);
 	// If the node above has sunlight, this node also can get it.
-	MapBlock *source_block = map->getBlockNoCreateNoEx(source_block_pos);
+	MapBlock *source_block = blocks.get(source_block_pos);
 	if (source_block == NULL) {
 		// But if there is no node above, then use heuristics
-		MapBlock *node_block = map->getBlockNoCreateNoEx(getNodeBlockPos(pos));
+		MapBlock *node_block = blocks.get(getNodeBlockPos(pos));
 		if (node_block == NULL) {
 			sunlight = false;
 		} else {
@@ -456,6 +523,7 @@ void update_lighting_nodes(Map *map,
 	std::map<v3s16, MapBlock*> &modified_blocks)
 {
 	const NodeDefManager *ndef = map->getNodeDefManager();
+	LightBlockCache blocks(map, modified_blocks);
 	// For node getter functions
 	bool is_valid_position;
 
@@ -489,7 +557,7 @@ void update_lighting_nodes(Map *map,
 			relative_v3 rel_pos;
 			mapblock_v3 block_pos;
 			getNodeBlockPosWithOffset(p, block_pos, rel_pos);
-			MapBlock *block = map->getBlockNoCreateNoEx(block_pos);
+			MapBlock *block = blocks.get(block_pos);
 			if (block == NULL) {
 				continue;
 			}
@@ -500,20 +568,20 @@ void update_lighting_nodes(Map *map,
 			u8 old_light = it->second.getLight(bank, ndef->getLightingFlags(it->second));
 
 			// Add the block of the added node to modified_blocks
-			modified_blocks[block_pos] = block;
+			blocks.setModified(block_pos, block);
 
 			// Get new light level of the node
 			u8 new_light = 0;
 			ContentLightingFlags f = ndef->getLightingFlags(n);
 			if (f.light_propagates) {
 				if (bank == LIGHTBANK_DAY && f.sunlight_propagates
-					&& is_sunlight_above(map, p, ndef)) {
+					&& is_sunlight_above(blocks, p, ndef)) {
 					new_light = LIGHT_SUN;
 				} else {
 					new_light = f.light_source;
 					for (const v3s16 &neighbor_dir : neighbor_dirs) {
 						v3s16 p2 = p + neighbor_dir;
-						MapNode n2 = map->getNode(p2, &is_valid_position);
+						MapNode n2 = blocks.getNode(p2, &is_valid_position);
 						if (is_valid_position) {
 							u8 spread = n2.getLight(bank, ndef->getLightingFlags(n2));
 							// If it is sure that the neighbor won't be
@@ -545,14 +613,17 @@ void update_lighting_nodes(Map *map,
 
 				// Remove sunlight, if there was any
 				if (bank == LIGHTBANK_DAY && old_light == LIGHT_SUN) {
-					for (s16 y = p.Y - 1;; y--) {
-						v3s16 n2pos(p.X, y, p.Z);
-
-						MapNode n2;
-
-						n2 = map->getNode(n2pos, &is_valid_position);
-						if (!is_valid_position)
-							break;
+					// Walk down the column, block by block
+					relative_v3 rel_pos2 = rel_pos;
+					mapblock_v3 block_pos2 = block_pos;
+					MapBlock *block2 = block;
+					while (true) {
+						if (step_rel_block_pos(4, rel_pos2, block_pos2)) {
+							block2 = blocks.get(block_pos2);
+							if (!block2)
+								break;
+						}
+						MapNode n2 = block2->getNodeNoCheck(rel_pos2);
 
 						// If this node doesn't have sunlight, the nodes below
 						// it don't have too.
@@ -562,12 +633,7 @@ void update_lighting_nodes(Map *map,
 						}
 						// Remove sunlight and add to unlight queue.
 						n2.setLight(LIGHTBANK_DAY, 0, f2);
-						map->setNode(n2pos, n2);
-						relative_v3 rel_pos2;
-						mapblock_v3 block_pos2;
-						getNodeBlockPosWithOffset(n2pos, block_pos2, rel_pos2);
-						MapBlock *block2 = map->getBlockNoCreateNoEx(
-							block_pos2);
+						block2->setNodeNoCheck(rel_pos2, n2);
 						disappearing_lights.push(LIGHT_SUN, rel_pos2,
 							block_pos2, block2,
 							4 /* The node above caused the change */);
@@ -578,14 +644,16 @@ void update_lighting_nodes(Map *map,
 				// one, unlighting is not necessary.
 				// Propagate sunlight
 				if (bank == LIGHTBANK_DAY && new_light == LIGHT_SUN) {
-					for (s16 y = p.Y - 1;; y--) {
-						v3s16 n2pos(p.X, y, p.Z);
-
-						MapNode n2;
-
-						n2 = map->getNode(n2pos, &is_valid_position);
-						if (!is_valid_position)
-							break;
+					relative_v3 rel_pos2 = rel_pos;
+					mapblock_v3 block_pos2 = block_pos;
+					MapBlock *block2 = block;
+					while (true) {
+						if (step_rel_block_pos(4, rel_pos2, block_pos2)) {
+							block2 = blocks.get(block_pos2);
+							if (!block2)
+								break;
+						}
+						MapNode n2 = block2->getNodeNoCheck(rel_pos2);
 
 						// This should not happen, but if the node has sunlight
 						// then the iteration should stop.
@@ -597,11 +665,6 @@ void update_lighting_nodes(Map *map,
 						if (!f2.sunlight_propagates) {
 							break;
 						}
-						relative_v3 rel_pos2;
-						mapblock_v3 block_pos2;
-						getNodeBlockPosWithOffset(n2pos, block_pos2, rel_pos2);
-						MapBlock *block2 = map->getBlockNoCreateNoEx(
-							block_pos2);
 						// Mark node for lighting.
 						light_sources.push(LIGHT_SUN, rel_pos2, block_pos2,
 							block2, 4);
@@ -611,8 +674,7 @@ void update_lighting_nodes(Map *map,
 
 		}
 		// Remove lights
-		unspread_light(map, ndef, bank, disappearing_lights, light_sources,
-			modified_blocks);
+		unspread_light(blocks, ndef, bank, disappearing_lights, light_sources);
 		// Initialize light values for light spreading.
 		for (u8 i = 0; i <= LIGHT_SUN; i++) {
 			const auto &lights = light_sources.lights[i];
@@ -623,7 +685,7 @@ void update_lighting_nodes(Map *map,
 			}
 		}
 		// Spread lights.
-		spread_light(map, ndef, bank, light_sources, modified_blocks);
+		spread_light(blocks, ndef, bank, light_sources);
 	}
 }
 
@@ -650,11 +712,11 @@ const static VoxelArea block_borders[] = {
  * its light source and its brightest neighbor minus one.
  * .
  */
-bool is_light_locally_correct(Map *map, const NodeDefManager *ndef,
+bool is_light_locally_correct(LightBlockCache &blocks, const NodeDefManager *ndef,
 	LightBank bank, v3s16 pos)
 {
 	bool is_valid_position;
-	MapNode n = map->getNode(pos, &is_valid_position);
+	MapNode n = blocks.getNode(pos, &is_valid_position);
 	ContentLightingFlags f = ndef->getLightingFlags(n);
 	if (!f.has_light) {
 		return true;
@@ -663,7 +725,7 @@ bool is_light_locally_correct(Map *map, const NodeDefManager *ndef,
 	assert(f.light_source <= LIGHT_MAX);
 	u8 brightest_neighbor = f.light_source + 1;
 	for (const v3s16 &neighbor_dir : neighbor_dirs) {
-		MapNode n2 = map->getNode(pos + neighbor_dir,
+		MapNode n2 = blocks.getNode(pos + neighbor_dir,
 			&is_valid_position);
 		u8 light2 = n2.getLight(bank, ndef->getLightingFlags(n2));
 		if (brightest_neighbor < light2) {
@@ -676,8 +738,17 @@ bool is_light_locally_correct(Map *map, const NodeDefManager *ndef,
 
 void update_block_border_lighting(Map *map, MapBlock *block,
 	std::map<v3s16, MapBlock*> &modified_blocks)
+{
+	update_block_border_lighting(map, std::vector<MapBlock *>{block},
+		modified_blocks);
+}
+
+void update_block_border_lighting(Map *map,
+	const std::vector<MapBlock *> &border_blocks_to_update,
+	std::map<v3s16, MapBlock*> &modified_blocks)
 {
 	const NodeDefManager *ndef = map->getNodeDefManager();
+	LightBlockCache blocks(map, modified_blocks);
 	// Since invalid light is not common, do not allocate
 	// memory if not needed.
 	UnlightQueue disappearing_lights(0);
@@ -686,12 +757,14 @@ void update_block_border_lighting(Map *map, MapBlock *block,
 	for (LightBank bank : banks) {
 		disappearing_lights.clear();
 		light_sources.clear();
-		// Get incorrect lights
+		// Get incorrect lights of all blocks, so that light is only
+		// spread once even if the blocks touch each other
+		for (MapBlock *block : border_blocks_to_update)
 		for (direction d = 0; d < 6; d++) {
 			// For each direction
 			// Get neighbor block
 			v3s16 otherpos = block->getPos() + neighbor_dirs[d];
-			MapBlock *other = map->getBlockNoCreateNoEx(otherpos);
+			MapBlock *other = blocks.get(otherpos);
 			if (other == NULL) {
 				continue;
 			}
@@ -703,11 +776,11 @@ void update_block_border_lighting(Map *map, MapBlock *block,
 			block->setLightingComplete(bank, d, true);
 			other->setLightingComplete(bank, 5 - d, true);
 			// The two blocks and their connecting surfaces
-			MapBlock *blocks[] = {block, other};
+			MapBlock *border_blocks[] = {block, other};
 			VoxelArea areas[] = {block_borders[d], block_borders[5 - d]};
 			// For both blocks
 			for (u8 blocknum = 0; blocknum < 2; blocknum++) {
-				MapBlock *b = blocks[blocknum];
+				MapBlock *b = border_blocks[blocknum];
 				VoxelArea a = areas[blocknum];
 				// For all nodes
 				for (s32 x = a.MinEdge.X; x <= a.MaxEdge.X; x++)
@@ -719,12 +792,12 @@ void update_block_border_lighting(Map *map, MapBlock *block,
 					// Sunlight is fixed
 					if (light < LIGHT_SUN) {
 						// Unlight if not correct
-						if (!is_light_locally_correct(map, ndef, bank,
+						if (!is_light_locally_correct(blocks, ndef, bank,
 								v3s16(x, y, z) + b->getPosRelative())) {
 							// Initialize for unlighting
 							n.setLight(bank, 0, ndef->getLightingFlags(n));
 							b->setNodeNoCheck(x, y, z, n);
-							modified_blocks[b->getPos()]=b;
+							blocks.setModified(b->getPos(), b);
 							disappearing_lights.push(light,
 								relative_v3(x, y, z), b->getPos(), b,
 								6);
@@ -734,8 +807,7 @@ void update_block_border_lighting(Map *map, MapBlock *block,
 			}
 		}
 		// Remove lights
-		unspread_light(map, ndef, bank, disappearing_lights, light_sources,
-			modified_blocks);
+		unspread_light(blocks, ndef, bank, disappearing_lights, light_sources);
 		// Initialize light values for light spreading.
 		for (u8 i = 0; i <= LIGHT_SUN; i++) {
 			const auto &lights = light_sources.lights[i];
@@ -746,7 +818,7 @@ void update_block_border_lighting(Map *map, MapBlock *block,
 			}
 		}
 		// Spread lights.
-		spread_light(map, ndef, bank, light_sources, modified_blocks);
+		spread_light(blocks, ndef, bank, light_sources);
 	}
 }
 
@@ -966,13 +1038,13 @@ void finish_bulk_light_update(Map *map, mapblock_v3 minblock,
 	std::map<v3s16, MapBlock*> *modified_blocks)
 {
 	const NodeDefManager *ndef = map->getNodeDefManager();
+	LightBlockCache blocks(map, *modified_blocks);
 
 	// --- STEP 1: Do unlighting
 
 	for (size_t bank = 0; bank < 2; bank++) {
 		LightBank b = banks[bank];
-		unspread_light(map, ndef, b, unlight[bank], relight[bank],
-			*modified_blocks);
+		unspread_light(blocks, ndef, b, unlight[bank], relight[bank]);
 	}
 
 	// --- STEP 2: Get all newly inserted light sources
@@ -1023,12 +1095,13 @@ void finish_bulk_light_update(Map *map, mapblock_v3 minblock,
 			}
 		}
 		// Spread lights.
-		spread_light(map, ndef, bank, relight[b], *modified_blocks);
+		spread_light(blocks, ndef, bank, relight[b]);
 	}
 }
 
 void blit_back_with_light(Map *map, MMVManip *vm,
-	std::map<v3s16, MapBlock*> *modified_blocks)
+	std::map<v3s16, MapBlock*> *modified_blocks,
+	std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes)
 {
 	const NodeDefManager *ndef = map->getNodeDefManager();
 
@@ -1119,7 +1192,7 @@ void blit_back_with_light(Map *map, MMVManip *vm,
 
 	// --- STEP 3: All information extracted, overwrite
 
-	vm->blitBackAll(modified_blocks, true);
+	vm->blitBackAll(modified_blocks, true, changed_nodes);
 
 	// --- STEP 4: Finish light update
 
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
 #include "voxel.h"
 #include "mapnode.h"
 #include "util/container.h"
@@ -11,6 +13,7 @@
 class Map;
 class MapBlock;
 class MMVManip;
+struct BlockNodeChanges;
 
 namespace voxalgo
 {
@@ -44,6 +47,15 @@ void update_lighting_nodes(
 void update_block_border_lighting(Map *map, MapBlock *block,
 	std::map<v3s16, MapBlock*> &modified_blocks);
 
+/*!
+ * Like the function above, for many blocks at once.
+ * Light is unspread and spread only once per light bank,
+ * so borders shared by the blocks are processed only once.
+ */
+void update_block_border_lighting(Map *map,
+	const std::vector<MapBlock *> &blocks,
+	std::map<v3s16, MapBlock*> &modified_blocks);
+
 /*!
  * Copies back nodes from a voxel manipulator
  * to the map and updates lighting.
@@ -51,9 +63,12 @@ void update_block_border_lighting(Map *map, MapBlock *block,
  *
  * \param modified_blocks output, contains all map blocks that
  * the function modified
+ * \param changed_nodes optional output, the nodes that changed
+ * apart from their lighting, see MMVManip::blitBackAll()
  */
 void blit_back_with_light(Map *map, MMVManip *vm,
-	std::map<v3s16, MapBlock*> *modified_blocks);
+	std::map<v3s16, MapBlock*> *modified_blocks,
+	std::unordered_map<v3s16, BlockNodeChanges> *changed_nodes = nullptr);
 
 /*!
  * Corrects the light in a map block.